@@ -33,6 +33,11 @@ namespace reshade
 			{
 				if (GetProcAddress(modules[i], "ReShadeVersion") != nullptr)
 				{
+					// Refuse to work with a ReShade build that does not provide all the interface functions this add-on was built against
+					const auto api_version = reinterpret_cast<const uint32_t *>(GetProcAddress(modules[i], "ReShadeAPIVersion"));
+					if (api_version == nullptr || *api_version < RESHADE_API_VERSION)
+						return false;
+
 #ifdef IMGUI_VERSION
 					g_imgui_function_table = *reinterpret_cast<const imgui_function_table *(*)()>(GetProcAddress(modules[i], "ReShadeGetImGuiFunctionTable"))();
 #endif
@@ -48,6 +53,7 @@ namespace reshade
 	/// <summary>
 	/// Registers a callback for the specified event (via template) with ReShade.
 	/// This callback is then called whenever the application performs a task associated with this event (see also the <see cref="addon_event"/> enumeration).
+	/// Callbacks may be registered and unregistered at any time and from any thread, but may still be called for a short while (until the next present) after being unregistered on a different thread.
 	/// </summary>
 	template <reshade::addon_event ev>
 	inline void register_event(typename reshade::addon_event_traits<ev>::decl callback)
@@ -57,7 +63,19 @@ namespace reshade
 		func(ev, static_cast<void *>(callback));
 	}
 	/// <summary>
-	/// Unregisters a callback for the specified event (via template) that was previously registered via 'register_event'.
+	/// Registers a callback for the specified event (via template) with ReShade, which is only called when one of the pipeline, resource or resource view arguments of the event is in the specified list of handles.
+	/// This is faster than filtering in the callback itself, since ReShade skips calling it altogether for events that do not match. Arrays of handles passed to an event (e.g. in 'addon_event::barrier') are not considered.
+	/// Calling this again with the same callback replaces its list of handles.
+	/// </summary>
+	template <reshade::addon_event ev>
+	inline void register_event_with_filter(typename reshade::addon_event_traits<ev>::decl callback, uint32_t num_handles, const uint64_t *handles)
+	{
+		static const auto func = reinterpret_cast<void(*)(reshade::addon_event, void *, uint32_t, const uint64_t *)>(
+			GetProcAddress(g_reshade_module_handle, "ReShadeRegisterEventWithFilter"));
+		func(ev, static_cast<void *>(callback), num_handles, handles);
+	}
+	/// <summary>
+	/// Unregisters a callback for the specified event (via template) that was previously registered via 'register_event' or 'register_event_with_filter'.
 	/// </summary>
 	template <reshade::addon_event ev>
 	inline void unregister_event(typename reshade::addon_event_traits<ev>::decl callback)
@@ -67,6 +85,30 @@ namespace reshade
 		func(ev, static_cast<void *>(callback));
 	}
 
+	/// <summary>
+	/// Allocates a custom data slot for the specified <paramref name="guid"/>, which can then be passed to 'api::api_object::get_user_data_slot' and 'api::api_object::set_user_data_slot' to access custom data in constant time.
+	/// Calling this multiple times with the same GUID returns the same slot. Only a small number of slots is available, so this should only be used for data that is accessed very frequently.
+	/// </summary>
+	/// <returns>The slot index, or <c>UINT32_MAX</c> if no slots are left, in which case the GUID based custom data functions need to be used instead.</returns>
+	inline uint32_t allocate_user_data_slot(const uint8_t guid[16])
+	{
+		static const auto func = reinterpret_cast<decltype(&allocate_user_data_slot)>(
+			GetProcAddress(g_reshade_module_handle, "ReShadeAllocateUserDataSlot"));
+		return func(guid);
+	}
+
+	/// <summary>
+	/// Gets a 64-bit hash of the code of the specified <paramref name="shader"/>, so that add-ons can identify shaders without having to hash the code themselves.
+	/// The hashes of shaders in pipelines created by the application are computed once before the 'addon_event::create_pipeline' and 'addon_event::init_pipeline' events, so that all add-ons calling this during those share the result. Other shaders are hashed on demand.
+	/// </summary>
+	/// <returns>The hash of the shader code, or zero if the shader has no code.</returns>
+	inline uint64_t get_shader_code_hash(const reshade::api::shader_desc &shader)
+	{
+		static const auto func = reinterpret_cast<uint64_t(*)(const void *, size_t)>(
+			GetProcAddress(g_reshade_module_handle, "ReShadeGetShaderCodeHash"));
+		return func(shader.code, shader.code_size);
+	}
+
 	/// <summary>
 	/// Registers an overlay with ReShade. The callback is called whenever the ReShade overlay is visible and allows adding ImGui widgets for user interaction.
 	/// </summary>
@@ -11,6 +11,12 @@
 	#define DECLSPEC_NOVTABLE __declspec(novtable)
 #endif
 
+/// <summary>
+/// Version of the interfaces declared in this header and of the functions exported by ReShade (see 'reshade.hpp'). New virtual functions are only ever appended to the end of an interface that no other interface derives from, so that add-ons built against an older version keep working.
+/// An add-on that uses functionality of a newer version refuses to initialize with a ReShade build that reports an older version (see 'reshade::init_addon').
+/// </summary>
+#define RESHADE_API_VERSION 4
+
 namespace reshade { namespace api
 {
 	/// <summary>
@@ -155,6 +161,53 @@ namespace reshade { namespace api
 		/// If this feature is not present, <see cref="command_list::copy_query_pool_results"/> must not be used.
 		/// </summary>
 		copy_query_pool_results,
+		/// <summary>
+		/// Specifies whether the pixel shading rate can be changed for draw calls.
+		/// If this feature is not present, <see cref="dynamic_state::shading_rate"/> must not be used.
+		/// </summary>
+		shading_rate,
+	};
+
+	/// <summary>
+	/// The components that create resources through <see cref="device::create_resource"/>, as used by <see cref="device::get_resource_memory_usage"/>.
+	/// </summary>
+	enum class resource_memory_owner
+	{
+		/// <summary>
+		/// The effect runtime (including the add-ons built into ReShade).
+		/// </summary>
+		effect_runtime,
+		/// <summary>
+		/// The ReShade overlay.
+		/// </summary>
+		overlay,
+		/// <summary>
+		/// All loaded add-ons together.
+		/// </summary>
+		addons,
+	};
+
+	/// <summary>
+	/// The kinds of resources memory usage is tracked for, as used by <see cref="device::get_resource_memory_usage"/>.
+	/// </summary>
+	enum class resource_memory_category
+	{
+		/// <summary>
+		/// Textures that are only read from in shaders.
+		/// </summary>
+		texture,
+		/// <summary>
+		/// Textures that are used as render target or depth-stencil.
+		/// </summary>
+		render_target,
+		/// <summary>
+		/// Buffers in video memory.
+		/// </summary>
+		buffer,
+		/// <summary>
+		/// Resources in system memory that are used to transfer data between CPU and GPU.
+		/// </summary>
+		staging,
 	};
 
 	/// <summary>
@@ -205,8 +258,46 @@ namespace reshade { namespace api
 			delete res;
 			set_user_data(guid, nullptr);
 		}
+
+		/// <summary>
+		/// Gets the custom data pointer stored in the specified <paramref name="slot"/> of the object, which was previously set via <see cref="set_user_data_slot"/>.
+		/// This is a constant time alternative to the GUID based look up, for data that is accessed very frequently (e.g. on every draw call), which reads the slot directly instead of calling into ReShade.
+		/// This function is not thread-safe!
+		/// </summary>
+		/// <param name="slot">The slot index returned by 'reshade::allocate_user_data_slot'.</param>
+		/// <returns>The pointer stored in the slot or <c>nullptr</c> if none was set.</returns>
+		inline void *get_user_data_slot(uint32_t slot) const { return _user_data_slots[slot]; }
+		/// <summary>
+		/// Sets the custom data pointer stored in the specified <paramref name="slot"/> of the object.
+		/// Slots are separate from the GUID based custom data, so data set via one cannot be retrieved via the other.
+		/// This function is not thread-safe!
+		/// </summary>
+		/// <param name="slot">The slot index returned by 'reshade::allocate_user_data_slot'.</param>
+		inline void set_user_data_slot(uint32_t slot, void * const ptr) { _user_data_slots[slot] = ptr; }
+
+		template <typename T> inline T &get_user_data(uint32_t slot) // Need to call 'destroy_user_data' for this custom data before object is destroyed
+		{
+			T *res = static_cast<T *>(get_user_data_slot(slot));
+			if (res == nullptr)
+				set_user_data_slot(slot, res = new T());
+			return *res;
+		}
+		template <typename T> inline void destroy_user_data(uint32_t slot)
+		{
+			delete static_cast<T *>(get_user_data_slot(slot));
+			set_user_data_slot(slot, nullptr);
+		}
+
+	protected:
+		/// <summary>
+		/// Custom data slots of the object, which the implementation points to storage that is shared by all interfaces the object implements.
+		/// This is a data member rather than a virtual function, so that it does not change the layout of the virtual function table.
+		/// </summary>
+		void **_user_data_slots = nullptr;
 	};
 
+	struct command_list;
+
 	/// <summary>
 	/// A logical render device, used for resource creation and global operations.
 	/// <para>Functionally equivalent to a 'IDirect3DDevice9', 'ID3D10Device', 'ID3D11Device', 'ID3D12Device', 'HGLRC' or 'VkDevice'.</para>
@@ -443,6 +534,35 @@ namespace reshade { namespace api
 		/// <param name="resource">The resource to set the name for.</param>
 		/// <param name="name">A null-terminated name string.</param>
 		virtual void set_resource_name(resource resource, const char *name) = 0;
+
+		/// <summary>
+		/// Creates a new command list, which can be recorded independently of the immediate command list of a queue (e.g. on a worker thread) and is then executed via <see cref="command_queue::execute_command_list"/>.
+		/// A single command list must not be recorded on multiple threads at the same time. This is not supported in D3D9, D3D10 and OpenGL.
+		/// </summary>
+		/// <param name="out">Pointer to a variable that is set to the created command list.</param>
+		/// <returns><c>true</c> if the command list was successfully created, <c>false</c> otherwise (in this case <paramref name="out"/> is set to <c>nullptr</c>).</returns>
+		virtual bool create_command_list(command_list **out) = 0;
+		/// <summary>
+		/// Instantly destroys a command list that was previously created via <see cref="create_command_list"/>.
+		/// <para>Make sure the command list is no longer being executed on the GPU before doing this.</para>
+		/// </summary>
+		virtual void destroy_command_list(command_list *cmd_list) = 0;
+
+		/// <summary>
+		/// Gets the amount of local video memory the operating system or driver wants this process to stay within and how much of it the process currently uses.
+		/// Exceeding the budget causes the driver to page out memory, so check this before creating large resources. This is not supported in D3D9 and OpenGL.
+		/// </summary>
+		/// <param name="budget">Pointer to a variable that is set to the budget in bytes.</param>
+		/// <param name="usage">Pointer to a variable that is set to the current usage in bytes.</param>
+		/// <returns><c>true</c> if the budget could be queried, <c>false</c> otherwise (in this case the variables are left unchanged).</returns>
+		virtual bool get_memory_budget(uint64_t *budget, uint64_t *usage) const = 0;
+
+		/// <summary>
+		/// Gets an estimate of how much memory the resources created through <see cref="create_resource"/> by the specified <paramref name="owner"/> currently occupy.
+		/// Resources created by the application are not included, so these make up the remainder of the usage reported by <see cref="get_memory_budget"/>.
+		/// </summary>
+		/// <returns>The size in bytes of all resources of the specified <paramref name="category"/> that are still alive.</returns>
+		virtual uint64_t get_resource_memory_usage(resource_memory_owner owner, resource_memory_category category) const = 0;
 	};
 
 	/// <summary>
@@ -817,6 +937,34 @@ namespace reshade { namespace api
 		/// <param name="label">A null-terminated string containing the label of the debug marker.</param>
 		/// <param name="color">An optional RGBA color value associated with the debug marker.</param>
 		virtual void insert_debug_marker(const char *label, const float color[4] = nullptr) = 0;
+
+		/// <summary>
+		/// Executes a command list that was previously created via <see cref="device::create_command_list"/> on this queue, after any commands that were recorded on the immediate command list so far.
+		/// The command list can then be used to record new commands right away. Command lists are executed in the order this is called, so when recording on multiple threads, call this from a single thread once recording finished.
+		/// </summary>
+		virtual void execute_command_list(command_list *cmd_list) = 0;
+
+		/// <summary>
+		/// Allocates a range of memory from a persistently mapped ring buffer in CPU-visible memory that belongs to this queue, to stream data to the GPU every frame without creating or renaming resources.
+		/// The memory is recycled once the GPU finished executing the immediate command list it was allocated for, so it may only be referenced by commands that are submitted to this queue before the next call to <see cref="flush_immediate_command_list"/>.
+		/// </summary>
+		/// <param name="size">Number of bytes to allocate.</param>
+		/// <param name="alignment">Required alignment of the offset into the buffer in bytes (must be a power of two, e.g. 256 for constant buffers in D3D12).</param>
+		/// <param name="out_data">Pointer to a variable that is set to a CPU pointer to the allocated memory, which can be written to until the commands referencing it are submitted.</param>
+		/// <param name="out_buffer">Pointer to a variable that is set to the handle of the buffer the memory was allocated from, which can be used as copy source, vertex, index or constant buffer.</param>
+		/// <param name="out_offset">Pointer to a variable that is set to the offset of the allocated memory in that buffer.</param>
+		/// <returns><see langword="true"/> if the memory was successfully allocated, <see langword="false"/> if the ring buffer is currently full or this is not supported by the render API (in which case <see cref="device::map_resource"/> or <see cref="device::upload_buffer_region"/> have to be used instead).</returns>
+		virtual bool allocate_upload_memory(uint64_t size, uint64_t alignment, void **out_data, resource *out_buffer, uint64_t *out_offset) = 0;
+
+		/// <summary>
+		/// Gets a fence value that is reached once all commands recorded on the immediate command list so far finished executing on the GPU (see <see cref="get_completed_fence_value"/>).
+		/// Objects referenced by those commands can be destroyed or reused once the value was reached, without having to wait for the queue to go idle. The commands only make progress once the immediate command list is flushed (see <see cref="flush_immediate_command_list"/>).
+		/// </summary>
+		virtual uint64_t get_pending_fence_value() = 0;
+		/// <summary>
+		/// Gets the highest fence value that was reached on the GPU so far (see <see cref="get_pending_fence_value"/>), without blocking.
+		/// </summary>
+		virtual uint64_t get_completed_fence_value() const = 0;
 	};
 
 	/// <summary>
@@ -853,6 +1001,27 @@ namespace reshade { namespace api
 		inline  struct effect_runtime *get_effect_runtime() { return reinterpret_cast<effect_runtime *>(this); }
 	};
 
+	/// <summary>
+	/// An opaque handle to the uniform variables of all effects that share a "source" annotation value.
+	/// <para>It stays valid for the lifetime of the effect runtime, including across effect reloads.</para>
+	/// </summary>
+	RESHADE_DEFINE_HANDLE(effect_uniform_source);
+	/// <summary>
+	/// An opaque handle to a uniform variable in an effect.
+	/// <para>It stays valid for the lifetime of the effect runtime, including across effect reloads (while the variable does not exist, it refers to nothing and operations on it are ignored).</para>
+	/// </summary>
+	RESHADE_DEFINE_HANDLE(effect_uniform_variable);
+	/// <summary>
+	/// An opaque handle to a texture variable in an effect.
+	/// <para>It stays valid for the lifetime of the effect runtime, including across effect reloads (while the variable does not exist, it refers to nothing and operations on it are ignored).</para>
+	/// </summary>
+	RESHADE_DEFINE_HANDLE(effect_texture_variable);
+	/// <summary>
+	/// An opaque handle to a technique in an effect.
+	/// <para>It stays valid for the lifetime of the effect runtime, including across effect reloads (while the technique does not exist, it refers to nothing and operations on it are ignored).</para>
+	/// </summary>
+	RESHADE_DEFINE_HANDLE(effect_technique);
+
 	/// <summary>
 	/// A ReShade effect runtime, used to control effects.
 	/// <para>A separate runtime is instantiated for every swap chain.</para>
@@ -872,6 +1041,7 @@ namespace reshade { namespace api
 
 		/// <summary>
 		/// Updates all textures that use the specified <paramref name="semantic"/> in all active effects to new resource view.
+		/// This does not wait for the GPU, so frames that are still in flight may continue to reference the previous resource view.
 		/// </summary>
 		virtual void update_texture_bindings(const char *semantic, resource_view shader_resource_view) = 0;
 
@@ -882,5 +1052,122 @@ namespace reshade { namespace api
 		virtual void update_uniform_variables(const char *source, const float *values, size_t count, size_t array_index = 0) = 0;
 		virtual void update_uniform_variables(const char *source, const int32_t *values, size_t count, size_t array_index = 0) = 0;
 		virtual void update_uniform_variables(const char *source, const uint32_t *values, size_t count, size_t array_index = 0) = 0;
+
+		/// <summary>
+		/// Finds the uniform variables with a "source" annotation set to <paramref name="source"/>, so that they can be updated repeatedly without looking them up by name every time.
+		/// </summary>
+		virtual effect_uniform_source find_uniform_source(const char *source) = 0;
+		/// <summary>
+		/// Updates the values of all uniform variables referenced by the specified <paramref name="source"/> handle to the specified <paramref name="values"/>.
+		/// These are separately named from the 'update_uniform_variables' overloads taking a "source" string, since MSVC groups overloaded virtual functions in the virtual function table, which would move the existing ones.
+		/// </summary>
+		virtual void update_uniform_source_variables(effect_uniform_source source, const bool *values, size_t count, size_t array_index = 0) = 0;
+		virtual void update_uniform_source_variables(effect_uniform_source source, const float *values, size_t count, size_t array_index = 0) = 0;
+		virtual void update_uniform_source_variables(effect_uniform_source source, const int32_t *values, size_t count, size_t array_index = 0) = 0;
+		virtual void update_uniform_source_variables(effect_uniform_source source, const uint32_t *values, size_t count, size_t array_index = 0) = 0;
+		inline  void update_uniform_variables(effect_uniform_source source, const bool *values, size_t count, size_t array_index = 0) { update_uniform_source_variables(source, values, count, array_index); }
+		inline  void update_uniform_variables(effect_uniform_source source, const float *values, size_t count, size_t array_index = 0) { update_uniform_source_variables(source, values, count, array_index); }
+		inline  void update_uniform_variables(effect_uniform_source source, const int32_t *values, size_t count, size_t array_index = 0) { update_uniform_source_variables(source, values, count, array_index); }
+		inline  void update_uniform_variables(effect_uniform_source source, const uint32_t *values, size_t count, size_t array_index = 0) { update_uniform_source_variables(source, values, count, array_index); }
+
+		/// <summary>
+		/// Enumerates all uniform variables of loaded effects.
+		/// </summary>
+		/// <param name="effect_name">File name of the effect to enumerate the variables of (e.g. "Example.fx"), or <see langword="nullptr"/> to enumerate those of all effects.</param>
+		/// <param name="callback">Function to call for every uniform variable, with its handle and name.</param>
+		/// <param name="user_data">Optional pointer passed to the callback function.</param>
+		virtual void enumerate_uniform_variables(const char *effect_name, void(*callback)(effect_runtime *runtime, effect_uniform_variable variable, const char *name, void *user_data), void *user_data = nullptr) = 0;
+		/// <summary>
+		/// Finds a specific uniform variable.
+		/// </summary>
+		/// <param name="effect_name">File name of the effect the variable is declared in (e.g. "Example.fx").</param>
+		/// <param name="variable_name">Name of the uniform variable.</param>
+		virtual effect_uniform_variable find_uniform_variable(const char *effect_name, const char *variable_name) = 0;
+		/// <summary>
+		/// Gets the value of the specified uniform <paramref name="variable"/>.
+		/// </summary>
+		/// <returns><see langword="true"/> if the variable currently exists and its value was written to <paramref name="values"/>, <see langword="false"/> otherwise.</returns>
+		virtual bool get_uniform_value(effect_uniform_variable variable, bool *values, size_t count, size_t array_index = 0) = 0;
+		virtual bool get_uniform_value(effect_uniform_variable variable, float *values, size_t count, size_t array_index = 0) = 0;
+		virtual bool get_uniform_value(effect_uniform_variable variable, int32_t *values, size_t count, size_t array_index = 0) = 0;
+		virtual bool get_uniform_value(effect_uniform_variable variable, uint32_t *values, size_t count, size_t array_index = 0) = 0;
+		/// <summary>
+		/// Updates the value of the specified uniform <paramref name="variable"/> to the specified <paramref name="values"/>.
+		/// </summary>
+		virtual void set_uniform_value(effect_uniform_variable variable, const bool *values, size_t count, size_t array_index = 0) = 0;
+		virtual void set_uniform_value(effect_uniform_variable variable, const float *values, size_t count, size_t array_index = 0) = 0;
+		virtual void set_uniform_value(effect_uniform_variable variable, const int32_t *values, size_t count, size_t array_index = 0) = 0;
+		virtual void set_uniform_value(effect_uniform_variable variable, const uint32_t *values, size_t count, size_t array_index = 0) = 0;
+
+		/// <summary>
+		/// Enumerates all texture variables of loaded effects.
+		/// </summary>
+		/// <param name="effect_name">File name of the effect to enumerate the variables of (e.g. "Example.fx"), or <see langword="nullptr"/> to enumerate those of all effects.</param>
+		/// <param name="callback">Function to call for every texture variable, with its handle and name.</param>
+		/// <param name="user_data">Optional pointer passed to the callback function.</param>
+		virtual void enumerate_texture_variables(const char *effect_name, void(*callback)(effect_runtime *runtime, effect_texture_variable variable, const char *name, void *user_data), void *user_data = nullptr) = 0;
+		/// <summary>
+		/// Finds a specific texture variable.
+		/// </summary>
+		/// <param name="effect_name">File name of the effect the variable is declared in (e.g. "Example.fx").</param>
+		/// <param name="variable_name">Unique name of the texture variable as generated by the effect compiler (e.g. "VExampleTex"), which is also the name passed to the callback of <see cref="enumerate_texture_variables"/>.</param>
+		virtual effect_texture_variable find_texture_variable(const char *effect_name, const char *variable_name) = 0;
+		/// <summary>
+		/// Gets the shader resource views of the texture backing the specified texture <paramref name="variable"/>.
+		/// Textures with a semantic have no resource of their own, in which case both views are zero.
+		/// </summary>
+		/// <param name="out_srv">Pointer to a variable that is set to the linear shader resource view.</param>
+		/// <param name="out_srv_srgb">Optional pointer to a variable that is set to the sRGB shader resource view.</param>
+		/// <returns><see langword="true"/> if the variable currently exists, <see langword="false"/> otherwise.</returns>
+		virtual bool get_texture_resource_view(effect_texture_variable variable, resource_view *out_srv, resource_view *out_srv_srgb = nullptr) = 0;
+
+		/// <summary>
+		/// Enumerates all techniques of loaded effects, in the order they are rendered in.
+		/// </summary>
+		/// <param name="effect_name">File name of the effect to enumerate the techniques of (e.g. "Example.fx"), or <see langword="nullptr"/> to enumerate those of all effects.</param>
+		/// <param name="callback">Function to call for every technique, with its handle and name.</param>
+		/// <param name="user_data">Optional pointer passed to the callback function.</param>
+		virtual void enumerate_techniques(const char *effect_name, void(*callback)(effect_runtime *runtime, effect_technique technique, const char *name, void *user_data), void *user_data = nullptr) = 0;
+		/// <summary>
+		/// Finds a specific technique.
+		/// </summary>
+		/// <param name="effect_name">File name of the effect the technique is declared in (e.g. "Example.fx").</param>
+		/// <param name="technique_name">Name of the technique.</param>
+		virtual effect_technique find_technique(const char *effect_name, const char *technique_name) = 0;
+		/// <summary>
+		/// Gets whether the specified <paramref name="technique"/> is enabled.
+		/// </summary>
+		virtual bool get_technique_state(effect_technique technique) = 0;
+		/// <summary>
+		/// Enables or disables the specified <paramref name="technique"/>.
+		/// This does not modify the current preset.
+		/// </summary>
+		virtual void set_technique_state(effect_technique technique, bool enabled) = 0;
+		/// <summary>
+		/// Gets the average time the GPU took to render the specified <paramref name="technique"/> over the last frames, in nanoseconds.
+		/// This is zero while the technique is disabled or GPU statistics are not being gathered (which is the case while the overlay does not show them).
+		/// </summary>
+		virtual uint64_t get_technique_gpu_duration(effect_technique technique) = 0;
+
+		/// <summary>
+		/// Compiles HLSL <paramref name="source"/> code for the specified entry point and profile in the background, using the same compiler as effects do and storing the result in the effect cache, so that compiling the same code again is served from there.
+		/// This is only supported with D3D9, D3D10, D3D11 and D3D12 (the callback is called with an error immediately otherwise).
+		/// </summary>
+		/// <param name="source">HLSL source code to compile.</param>
+		/// <param name="source_size">Length of the source code in bytes.</param>
+		/// <param name="entry_point">Name of the shader entry point function (e.g. "main").</param>
+		/// <param name="profile">Shader profile to compile for (e.g. "ps_5_0", or "ps_6_0" to compile DXIL on D3D12).</param>
+		/// <param name="callback">Function to call once compilation finished (on a worker thread), with the compiled bytecode (or <see langword="nullptr"/> if it failed) and any compiler messages.</param>
+		/// <param name="user_data">Optional pointer passed to the callback function.</param>
+		virtual void compile_shader(const char *source, size_t source_size, const char *entry_point, const char *profile, void(*callback)(effect_runtime *runtime, const void *code, size_t code_size, const char *errors, void *user_data), void *user_data = nullptr) = 0;
+
+		/// <summary>
+		/// Sets the tiles of the back buffer that only contain sky (pixels at the far plane of the depth buffer) this frame.
+		/// Graphics passes of techniques with a "mask_sky" annotation that are rendered at the back buffer resolution then skip those pixels via the stencil test.
+		/// The rectangles are kept until this is called again or the back buffer is resized.
+		/// </summary>
+		/// <param name="num_rects">Number of rectangles in the <paramref name="rects"/> array.</param>
+		/// <param name="rects">Array of rectangles, each as four consecutive values (left, top, right and bottom) in back buffer pixels.</param>
+		virtual void update_sky_mask(uint32_t num_rects, const int32_t *rects) = 0;
 	};
 } }
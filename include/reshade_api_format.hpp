@@ -414,4 +414,26 @@ namespace reshade { namespace api
 		// TODO: Block compressed formats
 		return 0;
 	}
+
+	/// <summary>
+	/// Gets the number of bytes a row of pixels (or a row of 4x4 blocks for block compressed formats) of the specified format <paramref name="value"/> occupies.
+	/// </summary>
+	inline uint32_t format_row_pitch(format value, uint32_t width)
+	{
+		if ((value >= format::bc1_typeless && value <= format::bc1_unorm_srgb) || (value >= format::bc4_typeless && value <= format::bc4_snorm))
+			return ((width + 3) / 4) * 8;
+		if ((value >= format::bc2_typeless && value <= format::bc3_unorm_srgb) || (value >= format::bc5_typeless && value <= format::bc5_snorm) || (value >= format::bc6h_typeless && value <= format::bc7_unorm_srgb))
+			return ((width + 3) / 4) * 16;
+		return width * format_bpp(value);
+	}
+
+	/// <summary>
+	/// Gets the number of bytes a slice of the specified format <paramref name="value"/> occupies, given the number of bytes per row.
+	/// </summary>
+	inline uint32_t format_slice_pitch(format value, uint32_t row_pitch, uint32_t height)
+	{
+		if ((value >= format::bc1_typeless && value <= format::bc5_snorm) || (value >= format::bc6h_typeless && value <= format::bc7_unorm_srgb))
+			return ((height + 3) / 4) * row_pitch;
+		return height * row_pitch;
+	}
 } }
@@ -120,6 +120,11 @@ namespace reshade { namespace api
 		back_stencil_pass_op = 188,
 		back_stencil_fail_op = 186,
 		back_stencil_depth_fail_op = 187,
+
+		// Variable rate shading state
+
+		// Encoded as '(log2(width) << 2) | log2(height)' of the pixel area a single pixel shader invocation covers, which matches 'D3D12_SHADING_RATE' (e.g. 0 for 1x1, 5 for 2x2, 10 for 4x4)
+		shading_rate = 1006,
 	};
 
 	/// <summary>
@@ -945,4 +950,97 @@ namespace reshade { namespace api
 		sampler sampler;
 		resource_view view;
 	};
+
+	/// <summary>
+	/// The type of a command recorded into a command packet stream.
+	/// </summary>
+	enum class command_type : uint32_t
+	{
+		draw,
+		draw_indexed,
+		dispatch,
+		draw_or_dispatch_indirect,
+		bind_viewports,
+		clear_depth_stencil_view,
+		clear_render_target_view
+	};
+
+	/// <summary>
+	/// The header of a single packet in a command packet stream, as passed to the <see cref="addon_event::execute_command_stream"/> event.
+	/// The command specific data directly follows the header and the next packet starts <see cref="size"/> bytes after the start of this one.
+	/// </summary>
+	struct command_packet
+	{
+		command_type type;
+		/// <summary>
+		/// Size of this packet in bytes, including the header and any trailing data. This is always a multiple of 8.
+		/// </summary>
+		uint32_t size;
+
+		inline const command_packet *next() const { return reinterpret_cast<const command_packet *>(reinterpret_cast<const uint8_t *>(this) + size); }
+	};
+
+	struct command_packet_draw : public command_packet
+	{
+		uint32_t vertices;
+		uint32_t instances;
+		uint32_t first_vertex;
+		uint32_t first_instance;
+	};
+	struct command_packet_draw_indexed : public command_packet
+	{
+		uint32_t indices;
+		uint32_t instances;
+		uint32_t first_index;
+		int32_t vertex_offset;
+		uint32_t first_instance;
+	};
+	struct command_packet_dispatch : public command_packet
+	{
+		uint32_t num_groups_x;
+		uint32_t num_groups_y;
+		uint32_t num_groups_z;
+	};
+	struct command_packet_draw_or_dispatch_indirect : public command_packet
+	{
+		indirect_command indirect_type;
+		uint32_t draw_count;
+		resource buffer;
+		uint64_t offset;
+		uint32_t stride;
+	};
+	/// <summary>
+	/// Followed by <see cref="count"/> viewports in the same format as passed to the <see cref="addon_event::bind_viewports"/> event.
+	/// </summary>
+	struct command_packet_bind_viewports : public command_packet
+	{
+		uint32_t first;
+		uint32_t count;
+
+		inline const float *viewports() const { return reinterpret_cast<const float *>(this + 1); }
+	};
+	/// <summary>
+	/// Followed by <see cref="num_rects"/> rectangles in the same format as passed to the <see cref="addon_event::clear_depth_stencil_view"/> event.
+	/// </summary>
+	struct command_packet_clear_depth_stencil_view : public command_packet
+	{
+		resource_view dsv;
+		attachment_type clear_flags;
+		float depth;
+		uint8_t stencil;
+		uint32_t num_rects;
+
+		inline const int32_t *rects() const { return reinterpret_cast<const int32_t *>(this + 1); }
+	};
+	/// <summary>
+	/// Followed by <see cref="num_rects"/> rectangles in the same format as passed to the <see cref="addon_event::clear_render_target_view"/> event.
+	/// </summary>
+	struct command_packet_clear_render_target_view : public command_packet
+	{
+		resource_view rtv;
+		float color[4];
+		uint32_t num_rects;
+
+		inline const int32_t *rects() const { return reinterpret_cast<const int32_t *>(this + 1); }
+	};
 } }
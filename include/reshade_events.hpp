@@ -419,6 +419,24 @@ namespace reshade
 		/// </summary>
 		reshade_finish_effects,
 
+		/// <summary>
+		/// Called after <see cref="execute_command_list"/> with a compact stream of all draw, dispatch, viewport and clear commands recorded into the command list since it was last reset, and before <see cref="present"/> with those recorded on the immediate command list of the presenting queue.
+		/// Installing a callback for this event enables recording, so add-ons can analyze the commands of a whole command list in bulk instead of installing separate callbacks for every command.
+		/// <para>Callback function signature: <c>void (api::command_queue *queue, api::command_list *cmd_list, const api::command_packet *packets, size_t size)</c></para>
+		/// </summary>
+		/// <remarks>
+		/// The packets are only valid for the duration of the callback, so copy them when they need to be processed later or on a different thread.
+		/// Commands skipped by another add-on returning <c>true</c> from their callback are not recorded.
+		/// </remarks>
+		execute_command_stream,
+
+		/// <summary>
+		/// Called when the video memory budget of a device (see <see cref="api::device::get_memory_budget"/>) changed or the usage of the process went above or below it.
+		/// This is checked about once per second while presenting.
+		/// <para>Callback function signature: <c>void (api::device *device, uint64_t budget, uint64_t usage)</c></para>
+		/// </summary>
+		memory_budget_change,
+
 #ifdef RESHADE_ADDON
 		max // Last value used internally by ReShade to determine number of events in this enum
 #endif
@@ -533,6 +551,10 @@ namespace reshade
 	DEFINE_ADDON_EVENT_TYPE_1(addon_event::reshade_begin_effects, api::effect_runtime *runtime, api::command_list *cmd_list);
 	DEFINE_ADDON_EVENT_TYPE_1(addon_event::reshade_finish_effects, api::effect_runtime *runtime, api::command_list *cmd_list);
 
+	DEFINE_ADDON_EVENT_TYPE_1(addon_event::execute_command_stream, api::command_queue *queue, api::command_list *cmd_list, const api::command_packet *packets, size_t size);
+
+	DEFINE_ADDON_EVENT_TYPE_1(addon_event::memory_budget_change, api::device *device, uint64_t budget, uint64_t usage);
+
 #undef DEFINE_ADDON_EVENT_TYPE_1
 #undef DEFINE_ADDON_EVENT_TYPE_2
 }
@@ -11,6 +11,9 @@
 #define IDR_IMGUI_VS_4_0                107
 #define IDR_IMGUI_VS_SPIRV              108
 #define IDR_MIPMAP_CS                   109
+#define IDR_LINEARIZE_DEPTH_CS          111
+#define IDR_HIZ_CS                      112
+#define IDR_SCREENSHOT_CS               113
 #define IDB_MAIN_ICON                   110
 #define IDR_LICENSE_GL3W                701
 #define IDR_LICENSE_IMGUI               702
@@ -26,7 +29,7 @@
 // 
 #ifdef APSTUDIO_INVOKED
 #ifndef APSTUDIO_READONLY_SYMBOLS
-#define _APS_NEXT_RESOURCE_VALUE        111
+#define _APS_NEXT_RESOURCE_VALUE        114
 #define _APS_NEXT_COMMAND_VALUE         40001
 #define _APS_NEXT_CONTROL_VALUE         1001
 #define _APS_NEXT_SYMED_VALUE           102
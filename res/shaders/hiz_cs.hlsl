@@ -0,0 +1,35 @@
+RWTexture2D<float> src_min : register(u0);
+RWTexture2D<float> src_max : register(u1);
+RWTexture2D<float> dest_min : register(u2);
+RWTexture2D<float> dest_max : register(u3);
+
+cbuffer cb0 : register(b0)
+{
+	uint2 src_size;
+	uint2 dest_size;
+}
+
+[numthreads(8, 8, 1)]
+void main(uint3 tid : SV_DispatchThreadID)
+{
+	if (any(tid.xy >= dest_size))
+		return;
+
+	// Each destination texel covers a 2x2 block of the source level, which is extended to 3 texels along a dimension that is odd, so that no source texel is skipped
+	const uint2 first = tid.xy * 2;
+	const uint2 last = min(first + 1 + ((src_size & 1) != 0 && tid.xy == dest_size - 1), src_size - 1);
+
+	float min_depth = src_min[first];
+	float max_depth = src_max[first];
+	for (uint y = first.y; y <= last.y; ++y)
+	{
+		for (uint x = first.x; x <= last.x; ++x)
+		{
+			min_depth = min(min_depth, src_min[uint2(x, y)]);
+			max_depth = max(max_depth, src_max[uint2(x, y)]);
+		}
+	}
+
+	dest_min[tid.xy] = min_depth;
+	dest_max[tid.xy] = max_depth;
+}
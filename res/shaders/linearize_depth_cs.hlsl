@@ -0,0 +1,42 @@
+Texture2D<float> t0 : register(t0);
+RWTexture2D<float> dest : register(u0);
+RWTexture2D<float> dest_half : register(u1);
+
+cbuffer cb0 : register(b0)
+{
+	uint2 size;
+	float far_plane;
+	float multiplier;
+	uint flags; // 0x1 = upside down, 0x2 = reversed, 0x4 = logarithmic
+}
+
+groupshared float linear_depth[8][8];
+
+// Same linearization as 'ReShade::GetLinearizedDepth' in ReShade.fxh
+[numthreads(8, 8, 1)]
+void main(uint3 tid : SV_DispatchThreadID, uint3 gtid : SV_GroupThreadID)
+{
+	uint2 pos = min(tid.xy, size - 1);
+	if (flags & 0x1)
+		pos.y = size.y - 1 - pos.y;
+
+	float depth = t0.Load(int3(pos, 0)) * multiplier;
+	if (flags & 0x4)
+	{
+		const float C = 0.01;
+		depth = (exp(depth * log(C + 1.0)) - 1.0) / C;
+	}
+	if (flags & 0x2)
+		depth = 1.0 - depth;
+	depth /= far_plane - depth * (far_plane - 1.0);
+
+	if (all(tid.xy < size))
+		dest[tid.xy] = depth;
+
+	// Half resolution version is the average of each 2x2 block of the full resolution one
+	linear_depth[gtid.y][gtid.x] = depth;
+	GroupMemoryBarrierWithGroupSync();
+
+	if (all((gtid.xy & 1) == 0))
+		dest_half[tid.xy / 2] = 0.25 * (linear_depth[gtid.y][gtid.x] + linear_depth[gtid.y][gtid.x + 1] + linear_depth[gtid.y + 1][gtid.x] + linear_depth[gtid.y + 1][gtid.x + 1]);
+}
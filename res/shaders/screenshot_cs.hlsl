@@ -0,0 +1,30 @@
+Texture2D<float4> t0 : register(t0);
+RWTexture2D<float4> dest : register(u0);
+
+cbuffer cb0 : register(b0)
+{
+	uint2 size;
+	uint flags; // 0x1 = encode linear input as sRGB, 0x2 = decode sRGB input to linear
+}
+
+[numthreads(8, 8, 1)]
+void main(uint3 tid : SV_DispatchThreadID)
+{
+	if (any(tid.xy >= size))
+		return;
+
+	// Loading through the view already returns the channels in RGBA order and normalized, regardless of the bit depth and channel order of the back buffer format
+	float4 color = t0.Load(int3(tid.xy, 0));
+
+	if (flags & 0x1)
+	{
+		color.rgb = saturate(color.rgb);
+		color.rgb = color.rgb <= 0.0031308 ? color.rgb * 12.92 : 1.055 * pow(color.rgb, 1.0 / 2.4) - 0.055;
+	}
+	if (flags & 0x2)
+	{
+		color.rgb = color.rgb <= 0.04045 ? color.rgb / 12.92 : pow((color.rgb + 0.055) / 1.055, 2.4);
+	}
+
+	dest[tid.xy] = color;
+}
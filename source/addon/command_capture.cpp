@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#if RESHADE_ADDON
+
+#define g_reshade_module_handle g_module_handle
+
+#include "dll_log.hpp"
+#include "ini_file.hpp"
+#include "reshade.hpp"
+#include "addon_manager.hpp"
+#include "command_capture.hpp"
+#include <mutex>
+#include <cstring>
+#include <fstream>
+
+using namespace reshade::api;
+using namespace reshade::addon;
+
+extern std::filesystem::path g_reshade_base_path;
+
+static unsigned int s_capture_frames = 0;
+static std::filesystem::path s_capture_path;
+static uint64_t s_captured_frames = 0;
+// Set while the 'execute_command_stream' event is registered, which is what enables recording the command streams
+static bool s_recording = false;
+static std::ofstream s_capture_file;
+// Records are collected in memory and only written to the file once per frame, to keep submissions from waiting on disk accesses
+static std::vector<uint8_t> s_capture_buffer;
+// Command streams may be submitted on multiple queues from different threads
+static std::mutex s_capture_mutex;
+
+static void append_record(command_capture_record_type type, const void *data, size_t size, const void *extra_data = nullptr, size_t extra_size = 0)
+{
+	const command_capture_record_header header = { type, static_cast<uint32_t>(size + extra_size) };
+
+	const size_t offset = s_capture_buffer.size();
+	s_capture_buffer.resize(offset + sizeof(header) + size + extra_size);
+	std::memcpy(s_capture_buffer.data() + offset, &header, sizeof(header));
+	std::memcpy(s_capture_buffer.data() + offset + sizeof(header), data, size);
+	if (extra_size != 0)
+		std::memcpy(s_capture_buffer.data() + offset + sizeof(header) + size, extra_data, extra_size);
+}
+
+static void on_execute_command_stream(command_queue *queue, command_list *cmd_list, const command_packet *packets, size_t size);
+
+static void stop_recording()
+{
+	if (!s_recording)
+		return;
+
+	s_recording = false;
+	reshade::unregister_event<reshade::addon_event::execute_command_stream>(on_execute_command_stream);
+}
+
+static void on_init_device(device *device)
+{
+	const std::unique_lock<std::mutex> lock(s_capture_mutex);
+
+	// Only capture the first device (which is usually the one the application presents with)
+	if (!s_recording || s_capture_file.is_open())
+		return;
+
+	s_capture_file.open(s_capture_path, std::ios::binary | std::ios::trunc);
+	if (!s_capture_file)
+	{
+		LOG(ERROR) << "Failed to open " << s_capture_path << " for writing command capture!";
+		stop_recording();
+		return;
+	}
+
+	LOG(INFO) << "Capturing commands of " << s_capture_frames << " frames to " << s_capture_path << " ...";
+
+	command_capture_file_header file_header;
+	file_header.device_api = device->get_api();
+	s_capture_file.write(reinterpret_cast<const char *>(&file_header), sizeof(file_header));
+}
+
+static void on_init_resource(device *, const resource_desc &desc, const subresource_data *, resource_usage initial_state, resource resource)
+{
+	const std::unique_lock<std::mutex> lock(s_capture_mutex);
+	if (!s_capture_file.is_open())
+		return;
+
+	const command_capture_init_resource record = { resource, desc, initial_state };
+	append_record(command_capture_record_type::init_resource, &record, sizeof(record));
+}
+
+static void on_execute_command_stream(command_queue *queue, command_list *cmd_list, const command_packet *packets, size_t size)
+{
+	const std::unique_lock<std::mutex> lock(s_capture_mutex);
+	if (!s_capture_file.is_open())
+		return;
+
+	const command_capture_command_stream record = { reinterpret_cast<uintptr_t>(queue), reinterpret_cast<uintptr_t>(cmd_list) };
+	append_record(command_capture_record_type::command_stream, &record, sizeof(record), packets, size);
+}
+
+static void on_present(command_queue *queue, swapchain *swapchain)
+{
+	const std::unique_lock<std::mutex> lock(s_capture_mutex);
+	if (!s_capture_file.is_open())
+		return;
+
+	const command_capture_present record = { reinterpret_cast<uintptr_t>(queue), reinterpret_cast<uintptr_t>(swapchain), s_captured_frames };
+	append_record(command_capture_record_type::present, &record, sizeof(record));
+
+	s_capture_file.write(reinterpret_cast<const char *>(s_capture_buffer.data()), s_capture_buffer.size());
+	s_capture_buffer.clear();
+
+	if (++s_captured_frames < s_capture_frames && s_capture_file.good())
+		return;
+
+	if (s_capture_file.good())
+		LOG(INFO) << "Finished capturing commands of " << s_captured_frames << " frames.";
+	else
+		LOG(ERROR) << "Failed to write command capture to " << s_capture_path << '!';
+
+	s_capture_file.close();
+
+	// Stop recording command streams, since nobody is interested in them anymore
+	stop_recording();
+}
+
+void register_builtin_addon_command_capture(reshade::addon::info &info)
+{
+	info.name = "Command Capture";
+
+	reshade::ini_file &config = reshade::global_config();
+	config.get("ADDON", "CaptureCommandFrames", s_capture_frames);
+	if (s_capture_frames == 0)
+		return;
+
+	if (!config.get("ADDON", "CaptureCommandPath", s_capture_path) || s_capture_path.empty())
+		s_capture_path = L"ReShadeCapture.bin";
+	s_capture_path = g_reshade_base_path / s_capture_path;
+
+	reshade::register_event<reshade::addon_event::init_device>(on_init_device);
+	reshade::register_event<reshade::addon_event::init_resource>(on_init_resource);
+	reshade::register_event<reshade::addon_event::execute_command_stream>(on_execute_command_stream);
+	reshade::register_event<reshade::addon_event::present>(on_present);
+
+	s_recording = true;
+}
+void unregister_builtin_addon_command_capture()
+{
+	if (s_capture_frames == 0)
+		return;
+
+	reshade::unregister_event<reshade::addon_event::init_device>(on_init_device);
+	reshade::unregister_event<reshade::addon_event::init_resource>(on_init_resource);
+	reshade::unregister_event<reshade::addon_event::present>(on_present);
+
+	stop_recording();
+
+	// Keep what was captured so far if the application exits before all frames were captured
+	if (s_capture_file.is_open())
+	{
+		s_capture_file.write(reinterpret_cast<const char *>(s_capture_buffer.data()), s_capture_buffer.size());
+		s_capture_file.close();
+	}
+
+	s_capture_buffer.clear();
+	s_captured_frames = 0;
+}
+
+#endif
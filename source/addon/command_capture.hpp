@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include "reshade_api.hpp"
+
+namespace reshade::addon
+{
+	/// <summary>
+	/// The type of a record in a command capture file.
+	/// </summary>
+	enum class command_capture_record_type : uint32_t
+	{
+		/// <summary>
+		/// Followed by a <see cref="command_capture_init_resource"/>.
+		/// </summary>
+		init_resource,
+		/// <summary>
+		/// Followed by a <see cref="command_capture_command_stream"/> and the command packets as passed to the <see cref="addon_event::execute_command_stream"/> event.
+		/// </summary>
+		command_stream,
+		/// <summary>
+		/// Followed by a <see cref="command_capture_present"/>. Marks the end of a frame.
+		/// </summary>
+		present,
+	};
+
+	/// <summary>
+	/// The header at the start of a command capture file, which is followed by a sequence of records until the end of the file.
+	/// All values are stored in the native byte order and handles are those of the captured process, so they are only meaningful as identifiers.
+	/// </summary>
+	struct command_capture_file_header
+	{
+		static constexpr uint32_t MAGIC = 0x43435352; // "RSCC"
+		static constexpr uint32_t VERSION = 1;
+
+		uint32_t magic = MAGIC;
+		uint32_t version = VERSION;
+		api::device_api device_api = {};
+		uint32_t reserved = 0;
+	};
+
+	/// <summary>
+	/// The header of a single record in a command capture file. The next record starts <see cref="size"/> bytes after the end of this header.
+	/// </summary>
+	struct command_capture_record_header
+	{
+		command_capture_record_type type;
+		uint32_t size;
+	};
+
+	struct command_capture_init_resource
+	{
+		api::resource resource;
+		api::resource_desc desc;
+		api::resource_usage initial_state;
+	};
+	struct command_capture_command_stream
+	{
+		uint64_t queue;
+		uint64_t cmd_list;
+	};
+	struct command_capture_present
+	{
+		uint64_t queue;
+		uint64_t swapchain;
+		uint64_t frame_index;
+	};
+}
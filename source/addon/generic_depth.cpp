@@ -8,9 +8,11 @@
 #define g_reshade_module_handle g_module_handle
 
 #include "dll_log.hpp"
+#include "dll_resources.hpp"
 #include "ini_file.hpp"
 #include "reshade.hpp"
 #include "addon_manager.hpp"
+#include <limits>
 #include <vector>
 #include <unordered_map>
 #include <imgui.h>
@@ -41,13 +43,39 @@ struct depth_stencil_info
 struct state_tracking
 {
 	static constexpr uint8_t GUID[16] = { 0x43, 0x31, 0x9e, 0x83, 0x38, 0x7c, 0x44, 0x8e, 0x88, 0x1c, 0x7e, 0x68, 0xfc, 0x2e, 0x52, 0xc4 };
+	static inline uint32_t slot = std::numeric_limits<uint32_t>::max();
 
 	draw_stats best_copy_stats;
 	bool first_empty_stats = true;
 	bool has_indirect_drawcalls = false;
 	resource current_depth_stencil = { 0 };
 	float current_viewport[6] = {};
-	std::unordered_map<uint64_t, depth_stencil_info> counters_per_used_depth_stencil;
+	// Flat list instead of a map, since a command list usually only uses a handful of depth-stencils, which keeps look ups and merging command lists cheap
+	// Cleared without releasing its memory, so that it does not have to be allocated again for every command list that is recorded
+	std::vector<std::pair<uint64_t, depth_stencil_info>> counters_per_used_depth_stencil;
+	// Index of the entry in 'counters_per_used_depth_stencil' for the current depth-stencil, looked up on the first draw call after it was bound
+	size_t current_counters_index = std::numeric_limits<size_t>::max();
+	// Set when the current viewport was already copied into the stats of the current depth-stencil, so that draw calls do not have to do so again until either changes
+	bool current_viewport_recorded = false;
+
+	state_tracking()
+	{
+		counters_per_used_depth_stencil.reserve(8);
+	}
+
+	depth_stencil_info &find_or_add_counters(uint64_t depth_stencil_handle)
+	{
+		return counters_per_used_depth_stencil[find_or_add_counters_index(depth_stencil_handle)].second;
+	}
+	size_t find_or_add_counters_index(uint64_t depth_stencil_handle)
+	{
+		for (size_t i = 0; i < counters_per_used_depth_stencil.size(); ++i)
+			if (counters_per_used_depth_stencil[i].first == depth_stencil_handle)
+				return i;
+
+		counters_per_used_depth_stencil.emplace_back(depth_stencil_handle, depth_stencil_info {});
+		return counters_per_used_depth_stencil.size() - 1;
+	}
 
 	void reset()
 	{
@@ -60,12 +88,16 @@ struct state_tracking
 		first_empty_stats = true;
 		has_indirect_drawcalls = false;
 		counters_per_used_depth_stencil.clear();
+		current_counters_index = std::numeric_limits<size_t>::max();
+		current_viewport_recorded = false;
 	}
 
 	void merge(const state_tracking &source)
 	{
 		// Executing a command list in a different command list inherits state
 		current_depth_stencil = source.current_depth_stencil;
+		current_counters_index = std::numeric_limits<size_t>::max();
+		current_viewport_recorded = false;
 
 		if (first_empty_stats)
 			first_empty_stats = source.first_empty_stats;
@@ -74,10 +106,16 @@ struct state_tracking
 		if (source.best_copy_stats.vertices > best_copy_stats.vertices)
 			best_copy_stats = source.best_copy_stats;
 
-		counters_per_used_depth_stencil.reserve(source.counters_per_used_depth_stencil.size());
+		// Common case of the first command list executed on a queue in a frame, which can just be copied
+		if (counters_per_used_depth_stencil.empty())
+		{
+			counters_per_used_depth_stencil = source.counters_per_used_depth_stencil;
+			return;
+		}
+
 		for (const auto &[depth_stencil_handle, snapshot] : source.counters_per_used_depth_stencil)
 		{
-			depth_stencil_info &target_snapshot = counters_per_used_depth_stencil[depth_stencil_handle];
+			depth_stencil_info &target_snapshot = find_or_add_counters(depth_stencil_handle);
 			target_snapshot.total_stats.vertices += snapshot.total_stats.vertices;
 			target_snapshot.total_stats.drawcalls += snapshot.total_stats.drawcalls;
 			target_snapshot.current_stats.vertices += snapshot.current_stats.vertices;
@@ -90,6 +128,96 @@ struct state_tracking
 	}
 };
 
+static inline state_tracking &get_state_tracking(api_object *queue_or_cmd_list)
+{
+	// This is called on every draw call, so prefer the constant time slot look up over the GUID one
+	if (state_tracking::slot != std::numeric_limits<uint32_t>::max())
+		return queue_or_cmd_list->get_user_data<state_tracking>(state_tracking::slot);
+	else
+		return queue_or_cmd_list->get_user_data<state_tracking>(state_tracking::GUID);
+}
+
+// Compute pipeline with its layout, which consists of push descriptors for shader resource views and/or unordered access views, followed by push constants in that order
+struct compute_pass
+{
+	descriptor_set_layout set_layouts[2] = {};
+	pipeline_layout layout = { 0 };
+	pipeline pipeline = { 0 };
+
+	// The DXBC shader is loaded from the specified resource for D3D11 and D3D12, while the GLSL shader source is used for OpenGL
+	// All other render APIs are not supported (D3D9 and D3D10 lack compute shaders and no SPIR-V version of the shaders is provided)
+	bool create(device *device, unsigned int dxbc_resource_id, const char *glsl_source, size_t glsl_source_size, uint32_t num_srvs, uint32_t num_uavs, uint32_t num_constants)
+	{
+		if (pipeline != 0)
+			return true;
+
+		pipeline_desc desc = { pipeline_stage::all_compute };
+
+		switch (device->get_api())
+		{
+		case device_api::d3d11:
+		case device_api::d3d12:
+		{
+			const reshade::resources::data_resource cs = reshade::resources::load_data_resource(dxbc_resource_id);
+			desc.compute.shader.code = cs.data;
+			desc.compute.shader.code_size = cs.data_size;
+			desc.compute.shader.format = shader_format::dxbc;
+			break;
+		}
+		case device_api::opengl:
+			desc.compute.shader.code = glsl_source;
+			desc.compute.shader.code_size = glsl_source_size;
+			desc.compute.shader.format = shader_format::glsl;
+			desc.compute.shader.entry_point = "main";
+			break;
+		default:
+			return false;
+		}
+
+		if (!device->check_capability(device_caps::compute_shader))
+			return false;
+
+		uint32_t num_set_layouts = 0;
+		descriptor_range srv_range = { 0, 0, descriptor_type::shader_resource_view, num_srvs, shader_stage::compute };
+		descriptor_range uav_range = { 0, 0, descriptor_type::unordered_access_view, num_uavs, shader_stage::compute };
+		const constant_range constants = { 0, 0, num_constants, shader_stage::compute };
+
+		if ((num_srvs != 0 && !device->create_descriptor_set_layout({ 1, &srv_range, true }, &set_layouts[num_set_layouts++])) ||
+			(num_uavs != 0 && !device->create_descriptor_set_layout({ 1, &uav_range, true }, &set_layouts[num_set_layouts++])) ||
+			!device->create_pipeline_layout({ num_set_layouts, set_layouts, 1, &constants }, &layout))
+		{
+			LOG(ERROR) << "Failed to create pipeline layout for depth compute pass!";
+			return false;
+		}
+
+		desc.layout = layout;
+
+		if (!device->create_pipeline(desc, &pipeline))
+		{
+			LOG(ERROR) << "Failed to create pipeline for depth compute pass!";
+			return false;
+		}
+
+		return true;
+	}
+	void destroy(device *device)
+	{
+		if (pipeline != 0)
+			device->destroy_pipeline(pipeline_stage::all_compute, pipeline);
+		if (layout != 0)
+			device->destroy_pipeline_layout(layout);
+		for (descriptor_set_layout &set_layout : set_layouts)
+		{
+			if (set_layout != 0)
+				device->destroy_descriptor_set_layout(set_layout);
+			set_layout = { 0 };
+		}
+
+		pipeline = { 0 };
+		layout = { 0 };
+	}
+};
+
 struct state_tracking_context
 {
 	static constexpr uint8_t GUID[16] = { 0x7c, 0x63, 0x63, 0xc7, 0xf9, 0x4e, 0x43, 0x7a, 0x91, 0x60, 0x14, 0x17, 0x82, 0xc4, 0x4a, 0x98 };
@@ -102,6 +230,12 @@ struct state_tracking_context
 	// Set to zero for automatic detection, otherwise will use the clear operation at the specific index within a frame
 	size_t force_clear_index = 0;
 
+	// Enable or disable predicting the clear operation to copy at during automatic detection from the stats of the previous frame, so that at most one copy is made per frame instead of one at every candidate clear operation
+	bool predict_clear_index = false;
+	// Clear operation index predicted from the stats of the previous frame (zero if unknown and set to 'no_clear_index' if no clear operation is a better fit than the depth-stencil at present)
+	static constexpr size_t no_clear_index = std::numeric_limits<size_t>::max();
+	size_t predicted_clear_index = 0;
+
 	// Stats of the previous frame for the selected depth-stencil
 	draw_stats previous_stats = {};
 
@@ -119,6 +253,49 @@ struct state_tracking_context
 	// This can be created from either the original depth-stencil of the application (if it supports shader access), or from the backup resource, or from one of the replacement resources
 	resource_view selected_shader_resource = { 0 };
 
+	// Enable or disable building linearized copies of the selected depth-stencil once per frame with a compute shader, which are bound to the 'DEPTH_LINEAR' and 'DEPTH_LINEAR_HALF' texture semantics
+	bool linearize_depth = false;
+	// Layout of the constant buffer of the linearization compute shader (see 'linearize_depth_cs.hlsl')
+	struct
+	{
+		uint32_t size[2];
+		float far_plane = 1000.0f;
+		float multiplier = 1.0f;
+		uint32_t flags = 0x2; // 0x1 = upside down, 0x2 = reversed, 0x4 = logarithmic
+	} linearize_constants;
+	compute_pass linearize_pass;
+	// Full resolution 'R32F' and half resolution 'R16F' linearized depth textures
+	resource linearized_textures[2] = {};
+	resource_view linearized_srvs[2] = {};
+	resource_view linearized_uavs[2] = {};
+
+	// Enable or disable building a hierarchical depth pyramid from the full resolution linearized depth texture, with the minimum and maximum depth of each mipmap level bound to the 'DEPTH_HIZ_MIN' and 'DEPTH_HIZ_MAX' texture semantics
+	bool build_hiz = false;
+	compute_pass hiz_pass;
+	uint32_t hiz_size[2] = {};
+	uint32_t hiz_levels = 0;
+	resource hiz_textures[2] = {};
+	resource_view hiz_srvs[2] = {};
+	// Unordered access views for each mipmap level of the minimum and maximum textures
+	std::vector<resource_view> hiz_uavs[2];
+
+	// Checks whether all hierarchical depth textures and views were created successfully
+	bool has_hiz() const { return hiz_levels != 0 && hiz_uavs[0].size() == hiz_levels && hiz_uavs[1].size() == hiz_levels; }
+
+	// Enable or disable reading back which tiles of the minimum hierarchical depth texture only contain sky, so that the runtime can skip them in techniques with a 'mask_sky' annotation (see 'effect_runtime::update_sky_mask')
+	bool build_sky_mask = false;
+	// Mipmap level of the minimum hierarchical depth texture that is read back, so that every texel covers a tile of 16x16 pixels
+	static constexpr uint32_t sky_mask_level = 4;
+	// Number of copies that can be in flight at once, each of which is only read back once the fence value recorded with it was reached, so that mapping it never waits for the GPU to finish
+	static constexpr uint32_t sky_mask_latency = 4;
+	uint32_t sky_mask_size[2] = {};
+	uint32_t sky_mask_pitch = 0;
+	resource sky_mask_readbacks[sky_mask_latency] = {};
+	uint64_t sky_mask_fence_values[sky_mask_latency] = {};
+	uint64_t sky_mask_frame = 0;
+	std::vector<uint8_t> sky_tiles;
+	std::vector<int32_t> sky_rects;
+
 #if RESHADE_GUI
 	// List of all encountered depth-stencils of the last frame
 	std::vector<std::pair<resource, depth_stencil_info>> current_depth_stencil_list;
@@ -167,14 +344,261 @@ struct state_tracking_context
 		if (!device->create_resource(desc, nullptr, resource_usage::copy_dest, &backup_texture))
 			LOG(ERROR) << "Failed to create backup depth-stencil texture!";
 	}
+
+	// Create the compute pipelines that build the linearized depth textures and the hierarchical depth pyramid
+	bool create_linearize_pipeline(device *device)
+	{
+		static constexpr char glsl_source[] =
+			"#version 430\n"
+			"layout(local_size_x = 8, local_size_y = 8) in;\n"
+			"layout(binding = 0) uniform sampler2D t0;\n"
+			"layout(binding = 0, r32f) uniform writeonly image2D dest;\n"
+			"layout(binding = 1, r16f) uniform writeonly image2D dest_half;\n"
+			"layout(binding = 0) uniform Buf { uvec2 size; float far_plane; float multiplier; uint flags; };\n"
+			"shared float linear_depth[8][8];\n"
+			"void main()\n"
+			"{\n"
+			"	uvec2 tid = gl_GlobalInvocationID.xy, gtid = gl_LocalInvocationID.xy;\n"
+			"	uvec2 pos = min(tid, size - 1);\n"
+			"	if ((flags & 0x1) != 0) pos.y = size.y - 1 - pos.y;\n"
+			"	float depth = texelFetch(t0, ivec2(pos), 0).x * multiplier;\n"
+			"	if ((flags & 0x4) != 0) depth = (exp(depth * log(0.01 + 1.0)) - 1.0) / 0.01;\n"
+			"	if ((flags & 0x2) != 0) depth = 1.0 - depth;\n"
+			"	depth /= far_plane - depth * (far_plane - 1.0);\n"
+			"	if (all(lessThan(tid, size))) imageStore(dest, ivec2(tid), vec4(depth));\n"
+			"	linear_depth[gtid.y][gtid.x] = depth;\n"
+			"	barrier();\n"
+			"	if ((gtid.x & 1) == 0 && (gtid.y & 1) == 0)\n"
+			"		imageStore(dest_half, ivec2(tid / 2), vec4(0.25 * (linear_depth[gtid.y][gtid.x] + linear_depth[gtid.y][gtid.x + 1] + linear_depth[gtid.y + 1][gtid.x] + linear_depth[gtid.y + 1][gtid.x + 1])));\n"
+			"}\n";
+
+		return linearize_pass.create(device, IDR_LINEARIZE_DEPTH_CS, glsl_source, sizeof(glsl_source), 1, 2, sizeof(linearize_constants) / 4);
+	}
+	bool create_hiz_pipeline(device *device)
+	{
+		static constexpr char glsl_source[] =
+			"#version 430\n"
+			"layout(local_size_x = 8, local_size_y = 8) in;\n"
+			"layout(binding = 0, r32f) uniform readonly image2D src_min;\n"
+			"layout(binding = 1, r32f) uniform readonly image2D src_max;\n"
+			"layout(binding = 2, r32f) uniform writeonly image2D dest_min;\n"
+			"layout(binding = 3, r32f) uniform writeonly image2D dest_max;\n"
+			"layout(binding = 0) uniform Buf { uvec2 src_size; uvec2 dest_size; };\n"
+			"void main()\n"
+			"{\n"
+			"	uvec2 tid = gl_GlobalInvocationID.xy;\n"
+			"	if (any(greaterThanEqual(tid, dest_size))) return;\n"
+			"	uvec2 first = tid * 2;\n"
+			"	uvec2 last = min(first + 1 + uvec2(notEqual(src_size & 1, uvec2(0))) * uvec2(equal(tid, dest_size - 1)), src_size - 1);\n"
+			"	float min_depth = imageLoad(src_min, ivec2(first)).x;\n"
+			"	float max_depth = imageLoad(src_max, ivec2(first)).x;\n"
+			"	for (uint y = first.y; y <= last.y; ++y)\n"
+			"	{\n"
+			"		for (uint x = first.x; x <= last.x; ++x)\n"
+			"		{\n"
+			"			min_depth = min(min_depth, imageLoad(src_min, ivec2(x, y)).x);\n"
+			"			max_depth = max(max_depth, imageLoad(src_max, ivec2(x, y)).x);\n"
+			"		}\n"
+			"	}\n"
+			"	imageStore(dest_min, ivec2(tid), vec4(min_depth));\n"
+			"	imageStore(dest_max, ivec2(tid), vec4(max_depth));\n"
+			"}\n";
+
+		return hiz_pass.create(device, IDR_HIZ_CS, glsl_source, sizeof(glsl_source), 0, 4, 4);
+	}
+	void destroy_compute_pipelines(device *device)
+	{
+		update_linearized_textures(device, 0, 0);
+		update_hiz_textures(device, 0, 0);
+		update_sky_mask_readbacks(device, 0, 0);
+
+		linearize_pass.destroy(device);
+		hiz_pass.destroy(device);
+	}
+
+	// Update the linearized depth textures to match the requested dimensions (or destroy them if those are zero)
+	// Returns true if the textures were changed and therefore have to be bound again
+	bool update_linearized_textures(device *device, uint32_t width, uint32_t height)
+	{
+		if (linearized_textures[0] != 0)
+		{
+			if (width == linearize_constants.size[0] && height == linearize_constants.size[1])
+				return false; // Textures already match dimensions, so can re-use
+
+			device->wait_idle(); // Textures may still be in use on device, so wait for all operations to finish before destroying them
+
+			for (int i = 0; i < 2; ++i)
+			{
+				device->destroy_resource_view(linearized_uavs[i]);
+				device->destroy_resource_view(linearized_srvs[i]);
+				device->destroy_resource(linearized_textures[i]);
+
+				linearized_uavs[i] = { 0 };
+				linearized_srvs[i] = { 0 };
+				linearized_textures[i] = { 0 };
+			}
+		}
+
+		linearize_constants.size[0] = width;
+		linearize_constants.size[1] = height;
+
+		if (width == 0 || height == 0)
+			return true;
+
+		for (int i = 0; i < 2; ++i)
+		{
+			resource_desc desc = {};
+			desc.type = resource_type::texture_2d;
+			desc.texture.width = std::max(width >> i, 1u);
+			desc.texture.height = std::max(height >> i, 1u);
+			desc.texture.depth_or_layers = 1;
+			desc.texture.levels = 1;
+			desc.texture.format = i == 0 ? format::r32_float : format::r16_float;
+			desc.texture.samples = 1;
+			desc.heap = memory_heap::gpu_only;
+			// The full resolution texture is also the source of the first level of the hierarchical depth textures
+			desc.usage = resource_usage::shader_resource | resource_usage::unordered_access | resource_usage::copy_source;
+
+			if (!device->create_resource(desc, nullptr, resource_usage::shader_resource, &linearized_textures[i]) ||
+				!device->create_resource_view(linearized_textures[i], resource_usage::shader_resource, resource_view_desc(desc.texture.format), &linearized_srvs[i]) ||
+				!device->create_resource_view(linearized_textures[i], resource_usage::unordered_access, resource_view_desc(desc.texture.format), &linearized_uavs[i]))
+			{
+				LOG(ERROR) << "Failed to create linearized depth texture!";
+				break;
+			}
+		}
+
+		return true;
+	}
+
+	// Update the hierarchical depth textures to match the requested dimensions (or destroy them if those are zero)
+	// Returns true if the textures were changed and therefore have to be bound again
+	bool update_hiz_textures(device *device, uint32_t width, uint32_t height)
+	{
+		if (hiz_textures[0] != 0)
+		{
+			if (width == hiz_size[0] && height == hiz_size[1])
+				return false; // Textures already match dimensions, so can re-use
+
+			device->wait_idle(); // Textures may still be in use on device, so wait for all operations to finish before destroying them
+
+			for (int i = 0; i < 2; ++i)
+			{
+				for (const resource_view uav : hiz_uavs[i])
+					device->destroy_resource_view(uav);
+				device->destroy_resource_view(hiz_srvs[i]);
+				device->destroy_resource(hiz_textures[i]);
+
+				hiz_uavs[i].clear();
+				hiz_srvs[i] = { 0 };
+				hiz_textures[i] = { 0 };
+			}
+		}
+
+		hiz_size[0] = width;
+		hiz_size[1] = height;
+		hiz_levels = 0;
+
+		if (width == 0 || height == 0)
+			return true;
+
+		// Full mipmap chain down to a single texel
+		hiz_levels = 1;
+		while ((std::max(width, height) >> hiz_levels) != 0)
+			hiz_levels++;
+
+		for (int i = 0; i < 2; ++i)
+		{
+			resource_desc desc = {};
+			desc.type = resource_type::texture_2d;
+			desc.texture.width = width;
+			desc.texture.height = height;
+			desc.texture.depth_or_layers = 1;
+			desc.texture.levels = static_cast<uint16_t>(hiz_levels);
+			desc.texture.format = format::r32_float;
+			desc.texture.samples = 1;
+			desc.heap = memory_heap::gpu_only;
+			// Copy source usage is needed to read back the sky mask from the minimum texture (see 'update_sky_mask')
+			desc.usage = resource_usage::shader_resource | resource_usage::unordered_access | resource_usage::copy_dest | resource_usage::copy_source;
+
+			if (!device->create_resource(desc, nullptr, resource_usage::shader_resource, &hiz_textures[i]) ||
+				!device->create_resource_view(hiz_textures[i], resource_usage::shader_resource, resource_view_desc(desc.texture.format, 0, hiz_levels, 0, 1), &hiz_srvs[i]))
+			{
+				LOG(ERROR) << "Failed to create hierarchical depth texture!";
+				break;
+			}
+
+			hiz_uavs[i].resize(hiz_levels);
+			for (uint32_t level = 0; level < hiz_levels; ++level)
+			{
+				if (!device->create_resource_view(hiz_textures[i], resource_usage::unordered_access, resource_view_desc(desc.texture.format, level, 1, 0, 1), &hiz_uavs[i][level]))
+				{
+					LOG(ERROR) << "Failed to create hierarchical depth texture view for mipmap level " << level << '!';
+					hiz_uavs[i].resize(level);
+					return true;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	// Update the system memory resources the sky mask is read back into to match the requested dimensions in tiles (or destroy them if those are zero)
+	// Returns true if the resources were changed and therefore any previous sky mask is no longer valid
+	bool update_sky_mask_readbacks(device *device, uint32_t width, uint32_t height)
+	{
+		if (sky_mask_readbacks[0] != 0)
+		{
+			if (width == sky_mask_size[0] && height == sky_mask_size[1])
+				return false; // Resources already match dimensions, so can re-use
+
+			device->wait_idle(); // Resources may still be in use on device, so wait for all operations to finish before destroying them
+
+			for (resource &readback : sky_mask_readbacks)
+			{
+				device->destroy_resource(readback);
+				readback = { 0 };
+			}
+		}
+
+		sky_mask_size[0] = width;
+		sky_mask_size[1] = height;
+		sky_mask_frame = 0;
+
+		if (width == 0 || height == 0)
+			return true;
+
+		sky_mask_pitch = width * 4;
+		if (device->get_api() == device_api::d3d12) // See D3D12_TEXTURE_DATA_PITCH_ALIGNMENT
+			sky_mask_pitch = (sky_mask_pitch + 255) & ~255;
+
+		for (resource &readback : sky_mask_readbacks)
+		{
+			const resource_desc desc = device->check_capability(device_caps::copy_buffer_to_texture) ?
+				resource_desc(static_cast<uint64_t>(sky_mask_pitch) * height, memory_heap::gpu_to_cpu, resource_usage::copy_dest) :
+				resource_desc(width, height, 1, 1, format::r32_float, 1, memory_heap::gpu_to_cpu, resource_usage::copy_dest);
+
+			if (!device->create_resource(desc, nullptr, resource_usage::copy_dest, &readback))
+			{
+				LOG(ERROR) << "Failed to create sky mask readback resource!";
+				update_sky_mask_readbacks(device, 0, 0);
+				break;
+			}
+		}
+
+		return true;
+	}
 };
 
 static void clear_depth_impl(command_list *cmd_list, state_tracking &state, const state_tracking_context &device_state, resource depth_stencil, bool fullscreen_draw_call)
 {
-	if (depth_stencil == 0 || device_state.backup_texture == 0 || depth_stencil != device_state.selected_depth_stencil)
+	// Keep track of clear operations even while there is no backup texture, since they are needed to predict the clear index
+	if (depth_stencil == 0 || depth_stencil != device_state.selected_depth_stencil)
 		return;
 
-	depth_stencil_info &counters = state.counters_per_used_depth_stencil[depth_stencil.handle];
+	depth_stencil_info &counters = state.find_or_add_counters(depth_stencil.handle);
+	// The stats are reset below, so have to copy the viewport again on the next draw call
+	state.current_viewport_recorded = false;
 
 	// Update stats with data from previous frame
 	if (!fullscreen_draw_call && counters.current_stats.drawcalls == 0 && state.first_empty_stats)
@@ -197,13 +621,17 @@ static void clear_depth_impl(command_list *cmd_list, state_tracking &state, cons
 
 	counters.clears.push_back({ counters.current_stats, fullscreen_draw_call });
 
+	size_t copy_clear_index = device_state.force_clear_index;
+	if (copy_clear_index == 0 && device_state.predict_clear_index)
+		copy_clear_index = device_state.predicted_clear_index;
+
 	// Make a backup copy of the depth texture before it is cleared
-	if (device_state.force_clear_index == 0 ?
+	if (device_state.backup_texture != 0 && (copy_clear_index == 0 ?
 		// If clear index override is set to zero, always copy any suitable buffers
 		// Use greater equals operator here to handle case where the same scene is first rendered into a shadow map and then for real (e.g. Mirror's Edge)
 		fullscreen_draw_call || counters.current_stats.vertices >= state.best_copy_stats.vertices :
 		// This is not really correct, since clears may accumulate over multiple command lists, but it's unlikely that the same depth-stencil is used in more than one
-		counters.clears.size() == device_state.force_clear_index)
+		counters.clears.size() == copy_clear_index))
 	{
 		// Since clears from fullscreen draw calls are selected based on their order (last one wins), their stats are ignored for the regular clear heuristic
 		if (!fullscreen_draw_call)
@@ -221,6 +649,28 @@ static void clear_depth_impl(command_list *cmd_list, state_tracking &state, cons
 	counters.current_stats = { 0, 0 };
 }
 
+static size_t predict_clear_index(const depth_stencil_info &snapshot)
+{
+	// Same decision the heuristic in 'clear_depth_impl' ends up with: The last clear operation with the most vertices wins (ignoring those from fullscreen draw calls)
+	size_t best_clear_index = state_tracking_context::no_clear_index;
+	uint32_t best_vertices = 0;
+	for (size_t clear_index = 1; clear_index <= snapshot.clears.size(); ++clear_index)
+	{
+		if (const clear_stats &clear = snapshot.clears[clear_index - 1];
+			!clear.rect && clear.vertices >= best_vertices)
+		{
+			best_clear_index = clear_index;
+			best_vertices = clear.vertices;
+		}
+	}
+
+	// Everything drawn after the last clear operation is still in the depth-stencil at present, so no copy is needed before clears if that is the better fit
+	if (snapshot.current_stats.vertices >= best_vertices)
+		best_clear_index = state_tracking_context::no_clear_index;
+
+	return best_clear_index;
+}
+
 static void on_init_device(device *device)
 {
 	state_tracking_context &device_state = device->get_user_data<state_tracking_context>(state_tracking_context::GUID);
@@ -229,10 +679,39 @@ static void on_init_device(device *device)
 	config.get("DEPTH", "DisableINTZ", s_disable_intz);
 	config.get("DEPTH", "DepthCopyBeforeClears", device_state.preserve_depth_buffers);
 	config.get("DEPTH", "DepthCopyAtClearIndex", device_state.force_clear_index);
+	config.get("DEPTH", "DepthCopyAtPredictedClearIndex", device_state.predict_clear_index);
 	config.get("DEPTH", "UseAspectRatioHeuristics", device_state.use_aspect_ratio_heuristics);
 
 	if (device_state.force_clear_index == std::numeric_limits<uint32_t>::max())
 		device_state.force_clear_index  = 0;
+
+	config.get("DEPTH", "LinearizeDepth", device_state.linearize_depth);
+	config.get("DEPTH", "HierarchicalDepth", device_state.build_hiz);
+	config.get("DEPTH", "SkyTileMask", device_state.build_sky_mask);
+
+	// Use the same linearization parameters as effects do through ReShade.fxh, which are read from the global preprocessor definitions
+	std::vector<std::string> preprocessor_definitions;
+	config.get("GENERAL", "PreprocessorDefinitions", preprocessor_definitions);
+	for (const std::string &definition : preprocessor_definitions)
+	{
+		const size_t equals_index = definition.find('=');
+		if (equals_index == std::string::npos)
+			continue;
+
+		const std::string name = definition.substr(0, equals_index);
+		const char *const value = definition.c_str() + equals_index + 1;
+
+		if (name == "RESHADE_DEPTH_LINEARIZATION_FAR_PLANE")
+			device_state.linearize_constants.far_plane = std::strtof(value, nullptr);
+		else if (name == "RESHADE_DEPTH_MULTIPLIER")
+			device_state.linearize_constants.multiplier = std::strtof(value, nullptr);
+		else if (name == "RESHADE_DEPTH_INPUT_IS_UPSIDE_DOWN")
+			device_state.linearize_constants.flags = (device_state.linearize_constants.flags & ~0x1) | (std::strtol(value, nullptr, 10) != 0 ? 0x1 : 0);
+		else if (name == "RESHADE_DEPTH_INPUT_IS_REVERSED")
+			device_state.linearize_constants.flags = (device_state.linearize_constants.flags & ~0x2) | (std::strtol(value, nullptr, 10) != 0 ? 0x2 : 0);
+		else if (name == "RESHADE_DEPTH_INPUT_IS_LOGARITHMIC")
+			device_state.linearize_constants.flags = (device_state.linearize_constants.flags & ~0x4) | (std::strtol(value, nullptr, 10) != 0 ? 0x4 : 0);
+	}
 }
 static void on_destroy_device(device *device)
 {
@@ -243,11 +722,16 @@ static void on_destroy_device(device *device)
 	if (device_state.selected_shader_resource != 0)
 		device->destroy_resource_view(device_state.selected_shader_resource);
 
+	device_state.destroy_compute_pipelines(device);
+
 	device->destroy_user_data<state_tracking_context>(state_tracking_context::GUID);
 }
 static void on_destroy_queue_or_command_list(api_object *queue_or_cmd_list)
 {
-	queue_or_cmd_list->destroy_user_data<state_tracking>(state_tracking::GUID);
+	if (state_tracking::slot != std::numeric_limits<uint32_t>::max())
+		queue_or_cmd_list->destroy_user_data<state_tracking>(state_tracking::slot);
+	else
+		queue_or_cmd_list->destroy_user_data<state_tracking>(state_tracking::GUID);
 }
 
 static bool on_create_resource(device *device, const resource_desc &desc, const reshade::api::subresource_data *initial_data, resource_usage initial_state, resource *out)
@@ -312,7 +796,7 @@ static bool on_create_resource_view(device *device, resource resource, resource_
 
 static bool on_draw(command_list *cmd_list, uint32_t vertices, uint32_t instances, uint32_t, uint32_t)
 {
-	auto &state = cmd_list->get_user_data<state_tracking>(state_tracking::GUID);
+	auto &state = get_state_tracking(cmd_list);
 	if (state.current_depth_stencil == 0)
 		return false; // This is a draw call with no depth-stencil bound
 
@@ -327,12 +811,20 @@ static bool on_draw(command_list *cmd_list, uint32_t vertices, uint32_t instance
 	}
 #endif
 
-	depth_stencil_info &counters = state.counters_per_used_depth_stencil[state.current_depth_stencil.handle];
+	if (state.current_counters_index == std::numeric_limits<size_t>::max())
+		state.current_counters_index = state.find_or_add_counters_index(state.current_depth_stencil.handle);
+
+	depth_stencil_info &counters = state.counters_per_used_depth_stencil[state.current_counters_index].second;
 	counters.total_stats.vertices += vertices * instances;
 	counters.total_stats.drawcalls += 1;
 	counters.current_stats.vertices += vertices * instances;
 	counters.current_stats.drawcalls += 1;
-	std::memcpy(counters.current_stats.last_viewport, state.current_viewport, 6 * sizeof(float));
+
+	if (!state.current_viewport_recorded)
+	{
+		std::memcpy(counters.current_stats.last_viewport, state.current_viewport, 6 * sizeof(float));
+		state.current_viewport_recorded = true;
+	}
 
 	return false;
 }
@@ -349,7 +841,7 @@ static bool on_draw_indirect(command_list *cmd_list, indirect_command type, reso
 		for (uint32_t i = 0; i < draw_count; ++i)
 			on_draw(cmd_list, 0, 0, 0, 0);
 
-		auto &state = cmd_list->get_user_data<state_tracking>(state_tracking::GUID);
+		auto &state = get_state_tracking(cmd_list);
 		state.has_indirect_drawcalls = true;
 	}
 
@@ -361,13 +853,14 @@ static void on_bind_viewport(command_list *cmd_list, uint32_t first, uint32_t co
 	if (first != 0 || count == 0)
 		return; // Only interested in the main viewport
 
-	auto &state = cmd_list->get_user_data<state_tracking>(state_tracking::GUID);
+	auto &state = get_state_tracking(cmd_list);
 	std::memcpy(state.current_viewport, viewport, 6 * sizeof(float));
+	state.current_viewport_recorded = false;
 }
 static void on_bind_depth_stencil(command_list *cmd_list, render_pass pass)
 {
 	device *const device = cmd_list->get_device();
-	auto &state = cmd_list->get_user_data<state_tracking>(state_tracking::GUID);
+	auto &state = get_state_tracking(cmd_list);
 
 	resource depth_stencil = { 0 };
 	resource_view depth_stencil_view = { 0 };
@@ -382,7 +875,12 @@ static void on_bind_depth_stencil(command_list *cmd_list, render_pass pass)
 		clear_depth_impl(cmd_list, state, device->get_user_data<state_tracking_context>(state_tracking_context::GUID), state.current_depth_stencil, true);
 	}
 
-	state.current_depth_stencil = depth_stencil;
+	if (depth_stencil != state.current_depth_stencil)
+	{
+		state.current_depth_stencil = depth_stencil;
+		state.current_counters_index = std::numeric_limits<size_t>::max();
+		state.current_viewport_recorded = false;
+	}
 }
 static bool on_clear_depth_stencil_attachment(command_list *cmd_list, attachment_type flags, const float[4], float, uint8_t, uint32_t, const int32_t *)
 {
@@ -393,7 +891,7 @@ static bool on_clear_depth_stencil_attachment(command_list *cmd_list, attachment
 	// Also cannot preserve depth buffers here in Vulkan, since it is not valid to issue copy commands inside a render pass (and since this event is being called from 'vkCmdClearAttachments' always is inside one)
 	if ((flags & attachment_type::depth) == attachment_type::depth && device_state.preserve_depth_buffers && device->get_api() != device_api::vulkan)
 	{
-		auto &state = cmd_list->get_user_data<state_tracking>(state_tracking::GUID);
+		auto &state = get_state_tracking(cmd_list);
 
 		clear_depth_impl(cmd_list, state, device_state, state.current_depth_stencil, false);
 	}
@@ -408,7 +906,7 @@ static bool on_clear_depth_stencil(command_list *cmd_list, resource_view dsv, at
 	// Ignore clears that do not affect the depth buffer (stencil clears)
 	if ((flags & attachment_type::depth) == attachment_type::depth && device_state.preserve_depth_buffers)
 	{
-		auto &state = cmd_list->get_user_data<state_tracking>(state_tracking::GUID);
+		auto &state = get_state_tracking(cmd_list);
 
 		resource depth_stencil = { 0 };
 		device->get_resource_from_view(dsv, &depth_stencil);
@@ -421,22 +919,37 @@ static bool on_clear_depth_stencil(command_list *cmd_list, resource_view dsv, at
 
 static void on_reset(command_list *cmd_list)
 {
-	auto &target_state = cmd_list->get_user_data<state_tracking>(state_tracking::GUID);
+	auto &target_state = get_state_tracking(cmd_list);
 	target_state.reset();
 }
 static void on_execute(api_object *queue_or_cmd_list, command_list *cmd_list)
 {
-	auto &source_state = cmd_list->get_user_data<state_tracking>(state_tracking::GUID);
-	auto &target_state = queue_or_cmd_list->get_user_data<state_tracking>(state_tracking::GUID);
+	auto &source_state = get_state_tracking(cmd_list);
+	auto &target_state = get_state_tracking(queue_or_cmd_list);
 	target_state.merge(source_state);
 }
 
+static void update_linearized_depth_bindings(effect_runtime *runtime, const state_tracking_context &device_state)
+{
+	runtime->update_texture_bindings("DEPTH_LINEAR", device_state.linearized_srvs[0]);
+	runtime->update_texture_bindings("DEPTH_LINEAR_HALF", device_state.linearized_srvs[1]);
+
+	const bool bufready_depth_linear_value = device_state.linearized_srvs[0] != 0 && device_state.linearized_srvs[1] != 0;
+	runtime->update_uniform_variables("bufready_depth_linear", &bufready_depth_linear_value, 1);
+
+	runtime->update_texture_bindings("DEPTH_HIZ_MIN", device_state.hiz_srvs[0]);
+	runtime->update_texture_bindings("DEPTH_HIZ_MAX", device_state.hiz_srvs[1]);
+
+	const bool bufready_depth_hiz_value = bufready_depth_linear_value && device_state.has_hiz();
+	runtime->update_uniform_variables("bufready_depth_hiz", &bufready_depth_hiz_value, 1);
+}
+
 static void on_present(command_queue *, swapchain *swapchain)
 {
 	effect_runtime *const runtime = swapchain->get_effect_runtime();
 	device *const device = runtime->get_device();
 	command_queue *const queue = runtime->get_command_queue();
-	state_tracking &queue_state = queue->get_user_data<state_tracking>(state_tracking::GUID);
+	state_tracking &queue_state = get_state_tracking(queue);
 	state_tracking_context &device_state = device->get_user_data<state_tracking_context>(state_tracking_context::GUID);
 
 #if RESHADE_GUI
@@ -489,12 +1002,20 @@ static void on_present(command_queue *, swapchain *swapchain)
 	{
 		best_desc = device->get_resource_desc(device_state.override_depth_stencil);
 		best_match = device_state.override_depth_stencil;
-		best_snapshot = queue_state.counters_per_used_depth_stencil[best_match.handle];
+		best_snapshot = queue_state.find_or_add_counters(best_match.handle);
 	}
 
 	if (best_match != 0)
 	{
-		if (best_match != device_state.selected_depth_stencil)
+		const bool use_predicted_clear_index = device_state.preserve_depth_buffers && device_state.force_clear_index == 0 && device_state.predict_clear_index;
+		// No copies are made before clear operations if the depth-stencil at present was predicted to be the better fit, in which case it can be bound directly if it supports shader access
+		const bool copy_before_clears = device_state.preserve_depth_buffers && !(use_predicted_clear_index && device_state.predicted_clear_index == state_tracking_context::no_clear_index);
+
+		// Need to create backup texture only if doing backup copies or original resource does not support shader access (which is necessary for binding it to effects)
+		// Also always create a backup texture in D3D12 or Vulkan to circument problems in case application makes use of resource aliasing
+		const bool use_backup_texture = copy_before_clears || (best_desc.usage & resource_usage::shader_resource) == resource_usage::undefined || (device->get_api() == device_api::d3d12 || device->get_api() == device_api::vulkan);
+
+		if (best_match != device_state.selected_depth_stencil || use_backup_texture != (device_state.backup_texture != 0))
 		{
 			// Destroy previous resource view, since the underlying resource has changed
 			if (device_state.selected_shader_resource != 0)
@@ -509,9 +1030,7 @@ static void on_present(command_queue *, swapchain *swapchain)
 			// Create two-dimensional resource view to the first level and layer of the depth-stencil resource
 			resource_view_desc srv_desc(device->get_api() != device_api::vulkan ? format_to_default_typed(best_desc.texture.format) : best_desc.texture.format);
 
-			// Need to create backup texture only if doing backup copies or original resource does not support shader access (which is necessary for binding it to effects)
-			// Also always create a backup texture in D3D12 or Vulkan to circument problems in case application makes use of resource aliasing
-			if (device_state.preserve_depth_buffers || (best_desc.usage & resource_usage::shader_resource) == resource_usage::undefined || (device->get_api() == device_api::d3d12 || device->get_api() == device_api::vulkan))
+			if (use_backup_texture)
 			{
 				device_state.update_backup_texture(device, best_desc);
 
@@ -544,7 +1063,13 @@ static void on_present(command_queue *, swapchain *swapchain)
 		{
 			device_state.previous_stats = best_snapshot.current_stats;
 		}
-		else
+
+		if (use_predicted_clear_index)
+		{
+			device_state.predicted_clear_index = predict_clear_index(best_snapshot);
+		}
+
+		if (!copy_before_clears)
 		{
 			// Copy to backup texture unless already copied during the current frame
 			if (device_state.backup_texture != 0 && !best_snapshot.copied_during_frame && (best_desc.usage & resource_usage::copy_source) != resource_usage::undefined)
@@ -561,6 +1086,8 @@ static void on_present(command_queue *, swapchain *swapchain)
 	}
 	else
 	{
+		device_state.predicted_clear_index = 0;
+
 		// Unset any existing depth-stencil selected in previous frames
 		if (device_state.selected_depth_stencil != 0)
 		{
@@ -580,6 +1107,27 @@ static void on_present(command_queue *, swapchain *swapchain)
 		}
 	}
 
+	// Linearized depth textures follow the dimensions of the selected depth-stencil and are destroyed when there is none
+	// The hierarchical depth textures are built from the full resolution linearized depth texture, so require those as well
+	const bool linearize_depth = device_state.linearize_depth && device_state.selected_shader_resource != 0 && device_state.create_linearize_pipeline(device);
+	const bool build_hiz = linearize_depth && device_state.build_hiz && device_state.create_hiz_pipeline(device);
+	if (const bool linearized_textures_changed = device_state.update_linearized_textures(device, linearize_depth ? best_desc.texture.width : 0, linearize_depth ? best_desc.texture.height : 0),
+		hiz_textures_changed = device_state.update_hiz_textures(device, build_hiz ? best_desc.texture.width : 0, build_hiz ? best_desc.texture.height : 0);
+		linearized_textures_changed || hiz_textures_changed)
+	{
+		update_linearized_depth_bindings(runtime, device_state);
+	}
+
+	// The sky mask is read back from the minimum hierarchical depth texture, so requires that as well (and one that has enough levels for the tile size)
+	const bool build_sky_mask = build_hiz && device_state.build_sky_mask && device_state.has_hiz() && device_state.hiz_levels > state_tracking_context::sky_mask_level;
+	if (device_state.update_sky_mask_readbacks(device,
+			build_sky_mask ? std::max(device_state.hiz_size[0] >> state_tracking_context::sky_mask_level, 1u) : 0,
+			build_sky_mask ? std::max(device_state.hiz_size[1] >> state_tracking_context::sky_mask_level, 1u) : 0))
+	{
+		// Tiles of the previous mask no longer match, so render all pixels until a new one was read back
+		runtime->update_sky_mask(0, nullptr);
+	}
+
 	queue_state.reset_on_present();
 }
 
@@ -593,11 +1141,154 @@ static void on_init_effect_runtime(effect_runtime *runtime)
 
 	const bool bufready_depth_value = device_state.selected_shader_resource != 0;
 	runtime->update_uniform_variables("bufready_depth", &bufready_depth_value, 1);
+
+	update_linearized_depth_bindings(runtime, device_state);
 }
+static void build_hiz_pyramid(command_list *cmd_list, const state_tracking_context &device_state)
+{
+	// The first level is a copy of the full resolution linearized depth texture, every following level contains the minimum and maximum of the respective 2x2 texels of the previous level
+	{
+		const resource resources[3] = { device_state.linearized_textures[0], device_state.hiz_textures[0], device_state.hiz_textures[1] };
+		const resource_usage old_states[3] = { resource_usage::shader_resource, resource_usage::shader_resource, resource_usage::shader_resource };
+		const resource_usage new_states[3] = { resource_usage::copy_source, resource_usage::copy_dest, resource_usage::copy_dest };
+		cmd_list->barrier(3, resources, old_states, new_states);
+
+		cmd_list->copy_texture_region(device_state.linearized_textures[0], 0, nullptr, device_state.hiz_textures[0], 0, nullptr);
+		cmd_list->copy_texture_region(device_state.linearized_textures[0], 0, nullptr, device_state.hiz_textures[1], 0, nullptr);
+
+		const resource_usage final_states[3] = { resource_usage::shader_resource, resource_usage::unordered_access, resource_usage::unordered_access };
+		cmd_list->barrier(3, resources, new_states, final_states);
+	}
+
+	const resource_usage unordered_access_states[2] = { resource_usage::unordered_access, resource_usage::unordered_access };
+
+	cmd_list->bind_pipeline(pipeline_stage::all_compute, device_state.hiz_pass.pipeline);
+
+	for (uint32_t level = 1; level < device_state.hiz_levels; ++level)
+	{
+		const uint32_t constants[4] = {
+			std::max(device_state.hiz_size[0] >> (level - 1), 1u),
+			std::max(device_state.hiz_size[1] >> (level - 1), 1u),
+			std::max(device_state.hiz_size[0] >> level, 1u),
+			std::max(device_state.hiz_size[1] >> level, 1u)
+		};
+		const resource_view uavs[4] = {
+			device_state.hiz_uavs[0][level - 1],
+			device_state.hiz_uavs[1][level - 1],
+			device_state.hiz_uavs[0][level],
+			device_state.hiz_uavs[1][level]
+		};
+
+		cmd_list->push_constants(shader_stage::compute, device_state.hiz_pass.layout, 1, 0, 4, constants);
+		cmd_list->push_descriptors(shader_stage::compute, device_state.hiz_pass.layout, 0, descriptor_type::unordered_access_view, 0, 4, uavs);
+		cmd_list->dispatch((constants[2] + 7) / 8, (constants[3] + 7) / 8, 1);
+
+		// Wait for writes to this level to finish before the next level reads from it
+		cmd_list->barrier(2, device_state.hiz_textures, unordered_access_states, unordered_access_states);
+	}
+
+	const resource_usage shader_resource_states[2] = { resource_usage::shader_resource, resource_usage::shader_resource };
+	cmd_list->barrier(2, device_state.hiz_textures, unordered_access_states, shader_resource_states);
+}
+static void read_sky_mask(effect_runtime *runtime, state_tracking_context &device_state, resource readback)
+{
+	device *const device = runtime->get_device();
+
+	const uint32_t width = device_state.sky_mask_size[0];
+	const uint32_t height = device_state.sky_mask_size[1];
+
+	uint8_t *mapped_data = nullptr;
+	uint32_t mapped_pitch = 0;
+	if (!device->map_resource(readback, 0, map_access::read_only, reinterpret_cast<void **>(&mapped_data), &mapped_pitch))
+		return;
+	if (mapped_pitch == 0)
+		mapped_pitch = device_state.sky_mask_pitch;
+
+	// Linearized depth is one at the far plane, so any tile whose minimum is close to that only contains sky
+	device_state.sky_tiles.resize(static_cast<size_t>(width) * height);
+	for (uint32_t y = 0; y < height; ++y, mapped_data += mapped_pitch)
+		for (uint32_t x = 0; x < width; ++x)
+			device_state.sky_tiles[y * width + x] = reinterpret_cast<const float *>(mapped_data)[x] >= 0.999f;
+
+	device->unmap_resource(readback, 0);
+
+	uint32_t frame_width = 0, frame_height = 0;
+	runtime->get_frame_width_and_height(&frame_width, &frame_height);
+
+	// The selected depth-stencil may not exactly match the back buffer dimensions, so scale the tiles to those, rounding inwards to never skip pixels that may contain geometry
+	const auto scale = [](uint32_t value, uint32_t from, uint32_t to, bool round_up) {
+		return static_cast<int32_t>((static_cast<uint64_t>(value) * to + (round_up ? from - 1 : 0)) / from);
+	};
+
+	device_state.sky_rects.clear();
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		for (uint32_t x = 0; x < width;)
+		{
+			// The mask is a few frames old, so only skip a tile if all its neighbors are sky too, which covers objects and the camera moving by up to a tile in the meantime
+			const auto is_sky = [&](uint32_t tile_x) {
+				for (uint32_t ny = (y != 0 ? y - 1 : 0); ny <= std::min(y + 1, height - 1); ++ny)
+					for (uint32_t nx = (tile_x != 0 ? tile_x - 1 : 0); nx <= std::min(tile_x + 1, width - 1); ++nx)
+						if (!device_state.sky_tiles[ny * width + nx])
+							return false;
+				return true;
+			};
+
+			if (!is_sky(x))
+			{
+				++x;
+				continue;
+			}
+
+			// Merge horizontal runs of sky tiles into a single rectangle
+			const uint32_t run_begin = x;
+			while (x < width && is_sky(x))
+				++x;
+
+			const int32_t rect[4] = {
+				scale(run_begin << state_tracking_context::sky_mask_level, device_state.hiz_size[0], frame_width, true),
+				scale(y << state_tracking_context::sky_mask_level, device_state.hiz_size[1], frame_height, true),
+				scale(x << state_tracking_context::sky_mask_level, device_state.hiz_size[0], frame_width, false),
+				scale((y + 1) << state_tracking_context::sky_mask_level, device_state.hiz_size[1], frame_height, false)
+			};
+			if (rect[0] < rect[2] && rect[1] < rect[3])
+				device_state.sky_rects.insert(device_state.sky_rects.end(), std::begin(rect), std::end(rect));
+		}
+	}
+
+	runtime->update_sky_mask(static_cast<uint32_t>(device_state.sky_rects.size() / 4), device_state.sky_rects.data());
+}
+static void update_sky_mask(effect_runtime *runtime, command_list *cmd_list, state_tracking_context &device_state)
+{
+	device *const device = runtime->get_device();
+	command_queue *const queue = runtime->get_command_queue();
+
+	// Read back the copy that was made the last time this resource was used, unless the GPU has not finished it yet, in which case keep the previous sky mask and try again next frame
+	const uint32_t slot = device_state.sky_mask_frame % state_tracking_context::sky_mask_latency;
+	const resource readback = device_state.sky_mask_readbacks[slot];
+	if (device_state.sky_mask_frame >= state_tracking_context::sky_mask_latency)
+	{
+		if (queue->get_completed_fence_value() < device_state.sky_mask_fence_values[slot])
+			return;
+
+		read_sky_mask(runtime, device_state, readback);
+	}
+
+	cmd_list->barrier(device_state.hiz_textures[0], resource_usage::shader_resource, resource_usage::copy_source);
+	if (device->check_capability(device_caps::copy_buffer_to_texture))
+		cmd_list->copy_texture_to_buffer(device_state.hiz_textures[0], state_tracking_context::sky_mask_level, nullptr, readback, 0, device_state.sky_mask_size[0], device_state.sky_mask_size[1]);
+	else
+		cmd_list->copy_texture_region(device_state.hiz_textures[0], state_tracking_context::sky_mask_level, nullptr, readback, 0, nullptr);
+	cmd_list->barrier(device_state.hiz_textures[0], resource_usage::copy_source, resource_usage::shader_resource);
+
+	device_state.sky_mask_fence_values[slot] = queue->get_pending_fence_value();
+	device_state.sky_mask_frame++;
+}
+
 static void on_begin_render_effects(effect_runtime *runtime, command_list *cmd_list)
 {
 	device *const device = runtime->get_device();
-	const state_tracking_context &device_state = device->get_user_data<state_tracking_context>(state_tracking_context::GUID);
+	state_tracking_context &device_state = device->get_user_data<state_tracking_context>(state_tracking_context::GUID);
 
 	if (device_state.selected_shader_resource != 0)
 	{
@@ -612,6 +1303,30 @@ static void on_begin_render_effects(effect_runtime *runtime, command_list *cmd_l
 		{
 			cmd_list->barrier(resource, resource_usage::depth_stencil | resource_usage::shader_resource, resource_usage::shader_resource);
 		}
+
+		// Build the linearized depth textures once, before any effect reads them
+		if (device_state.linearized_uavs[0] != 0 && device_state.linearized_uavs[1] != 0)
+		{
+			const resource_usage old_states[2] = { resource_usage::shader_resource, resource_usage::shader_resource };
+			const resource_usage new_states[2] = { resource_usage::unordered_access, resource_usage::unordered_access };
+			cmd_list->barrier(2, device_state.linearized_textures, old_states, new_states);
+
+			cmd_list->bind_pipeline(pipeline_stage::all_compute, device_state.linearize_pass.pipeline);
+			cmd_list->push_constants(shader_stage::compute, device_state.linearize_pass.layout, 2, 0, sizeof(device_state.linearize_constants) / 4, &device_state.linearize_constants);
+			cmd_list->push_descriptors(shader_stage::compute, device_state.linearize_pass.layout, 0, descriptor_type::shader_resource_view, 0, 1, &device_state.selected_shader_resource);
+			cmd_list->push_descriptors(shader_stage::compute, device_state.linearize_pass.layout, 1, descriptor_type::unordered_access_view, 0, 2, device_state.linearized_uavs);
+			cmd_list->dispatch((device_state.linearize_constants.size[0] + 7) / 8, (device_state.linearize_constants.size[1] + 7) / 8, 1);
+
+			cmd_list->barrier(2, device_state.linearized_textures, new_states, old_states);
+
+			if (device_state.has_hiz())
+			{
+				build_hiz_pyramid(cmd_list, device_state);
+
+				if (device_state.sky_mask_readbacks[0] != 0)
+					update_sky_mask(runtime, cmd_list, device_state);
+			}
+		}
 	}
 }
 static void on_finish_render_effects(effect_runtime *runtime, command_list *cmd_list)
@@ -647,6 +1362,13 @@ static void draw_debug_menu(effect_runtime *runtime, void *)
 
 	modified |= ImGui::Checkbox("Use aspect ratio heuristics", &device_state.use_aspect_ratio_heuristics);
 	modified |= ImGui::Checkbox("Copy depth buffer before clear operations", &device_state.preserve_depth_buffers);
+	if (device_state.preserve_depth_buffers)
+		modified |= ImGui::Checkbox("Predict clear operation to copy at from previous frame", &device_state.predict_clear_index);
+	modified |= ImGui::Checkbox("Build linearized depth textures for effects (DEPTH_LINEAR and DEPTH_LINEAR_HALF)", &device_state.linearize_depth);
+	if (device_state.linearize_depth)
+		modified |= ImGui::Checkbox("Build hierarchical depth pyramid for effects (DEPTH_HIZ_MIN and DEPTH_HIZ_MAX)", &device_state.build_hiz);
+	if (device_state.linearize_depth && device_state.build_hiz)
+		modified |= ImGui::Checkbox("Skip sky tiles in techniques with a \"mask_sky\" annotation", &device_state.build_sky_mask);
 
 	ImGui::Spacing();
 	ImGui::Separator();
@@ -755,6 +1477,7 @@ static void draw_debug_menu(effect_runtime *runtime, void *)
 
 		device_state.selected_depth_stencil = { 0 };
 		device_state.selected_shader_resource = { 0 };
+		device_state.predicted_clear_index = 0;
 
 		on_init_effect_runtime(runtime);
 
@@ -762,6 +1485,10 @@ static void draw_debug_menu(effect_runtime *runtime, void *)
 		config.set("DEPTH", "DisableINTZ", s_disable_intz);
 		config.set("DEPTH", "DepthCopyBeforeClears", device_state.preserve_depth_buffers);
 		config.set("DEPTH", "DepthCopyAtClearIndex", device_state.force_clear_index);
+		config.set("DEPTH", "DepthCopyAtPredictedClearIndex", device_state.predict_clear_index);
+		config.set("DEPTH", "LinearizeDepth", device_state.linearize_depth);
+		config.set("DEPTH", "HierarchicalDepth", device_state.build_hiz);
+		config.set("DEPTH", "SkyTileMask", device_state.build_sky_mask);
 		config.set("DEPTH", "UseAspectRatioHeuristics", device_state.use_aspect_ratio_heuristics);
 	}
 }
@@ -771,6 +1498,8 @@ void register_builtin_addon_depth(reshade::addon::info &info)
 {
 	info.name = "Generic Depth";
 
+	state_tracking::slot = reshade::allocate_user_data_slot(state_tracking::GUID);
+
 #if RESHADE_GUI
 	reshade::register_overlay("Depth", draw_debug_menu);
 #endif
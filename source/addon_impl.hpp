@@ -8,6 +8,14 @@
 #include <string>
 #include <vector>
 
+namespace reshade::addon
+{
+	/// <summary>
+	/// Number of custom data slots every API object provides (see <see cref="api::api_object::get_user_data_slot"/>).
+	/// </summary>
+	constexpr uint32_t max_user_data_slots = 8;
+}
+
 namespace reshade::api
 {
 	template <typename T, typename... api_object_base>
@@ -15,7 +23,11 @@ namespace reshade::api
 	{
 	public:
 		template <typename... Args>
-		explicit api_object_impl(T orig, Args... args) : api_object_base(std::forward<Args>(args)...)..., _orig(orig) {}
+		explicit api_object_impl(T orig, Args... args) : api_object_base(std::forward<Args>(args)...)..., _orig(orig)
+		{
+			// Objects that implement multiple interfaces have a separate 'api_object' base for each, which all need to share the same slots
+			((this->api_object_base::_user_data_slots = _data_slots), ...);
+		}
 
 		api_object_impl(const api_object_impl &) = delete;
 		api_object_impl &operator=(const api_object_impl &) = delete;
@@ -68,5 +80,6 @@ namespace reshade::api
 		};
 
 		std::vector<entry> _data_entries;
+		void *_data_slots[addon::max_user_data_slots] = {};
 	};
 }
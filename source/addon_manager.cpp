@@ -8,21 +8,53 @@
 #include "dll_log.hpp"
 #include "ini_file.hpp"
 #include "addon_manager.hpp"
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <limits>
+#include <cstring>
 #include <Windows.h>
 
 bool g_addons_enabled = true;
-std::vector<void *> reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::max)];
+std::atomic<const std::vector<reshade::addon::event_callback> *> reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::max)] = {};
+std::atomic<uint64_t> reshade::addon::event_mask[(static_cast<uint32_t>(reshade::addon_event::max) + 63) / 64] = {};
+std::atomic<bool> reshade::addon::has_retired_event_lists = false;
+std::atomic<bool> reshade::addon::profile_callbacks = false;
 std::vector<reshade::addon::info> reshade::addon::loaded_info;
 #if RESHADE_GUI
 std::vector<std::pair<std::string, void(*)(reshade::api::effect_runtime *, void *)>> reshade::addon::overlay_list;
 #endif
 static unsigned long s_reference_count = 0;
+// Protects modification of the event lists (reading them does not require a lock)
+static std::mutex s_event_list_mutex;
+static std::atomic<uint64_t> s_event_list_epoch = 0;
+static std::vector<std::pair<const std::vector<reshade::addon::event_callback> *, uint64_t>> s_retired_event_lists;
+// Epoch every thread entered its outermost 'event_list_reader' at, or the maximum value while it is not reading event lists
+struct event_list_reader_slot
+{
+	std::atomic<uint64_t> epoch = std::numeric_limits<uint64_t>::max();
+	unsigned int nesting = 0;
+
+	event_list_reader_slot();
+	~event_list_reader_slot();
+};
+// Protects the list of reader slots, which is separate from the event list lock, so that threads reading event lists for the first time do not have to wait on registration
+static std::mutex s_reader_slots_mutex;
+static std::vector<event_list_reader_slot *> s_reader_slots;
+static thread_local event_list_reader_slot t_reader_slot;
+// Statistics are kept around after a callback was unregistered, so that the lists that are still being iterated can reference them and so that re-registering a callback continues where it left off
+static std::deque<reshade::addon::callback_stats> s_callback_stats;
+static uint64_t s_profile_start_cycles = 0;
+static std::chrono::high_resolution_clock::time_point s_profile_start_time;
+
+extern HMODULE g_module_handle;
 
 extern void register_builtin_addon_depth(reshade::addon::info &info);
 extern void unregister_builtin_addon_depth();
+extern void register_builtin_addon_command_capture(reshade::addon::info &info);
+extern void unregister_builtin_addon_command_capture();
 
-#if RESHADE_VERBOSE_LOG
-static const char *addon_event_to_string(reshade::addon_event ev)
+const char *reshade::addon::addon_event_to_string(reshade::addon_event ev)
 {
 #define CASE(name) case reshade::addon_event::name: return #name
 	switch (ev)
@@ -77,11 +109,12 @@ static const char *addon_event_to_string(reshade::addon_event ev)
 		CASE(present);
 		CASE(reshade_begin_effects);
 		CASE(reshade_finish_effects);
+		CASE(execute_command_stream);
+		CASE(memory_budget_change);
 	}
 #undef  CASE
 	return "unknown";
 }
-#endif
 
 void reshade::addon::load_addons()
 {
@@ -93,6 +126,7 @@ void reshade::addon::load_addons()
 	LOG(INFO) << "Loading built-in add-ons ...";
 #endif
 	register_builtin_addon_depth(loaded_info.emplace_back());
+	register_builtin_addon_command_capture(loaded_info.emplace_back());
 
 #if RESHADE_ADDON_LOAD
 	// Get directory from where to load add-ons from
@@ -157,8 +191,121 @@ void reshade::addon::unload_addons()
 	LOG(INFO) << "Unloading built-in add-ons ...";
 #endif
 	unregister_builtin_addon_depth();
+	unregister_builtin_addon_command_capture();
 
 	loaded_info.clear();
+
+	// No more callbacks can be running at this point, so can free all replaced event lists right away
+	{	const std::lock_guard<std::mutex> lock(s_event_list_mutex);
+		for (const std::pair<const std::vector<reshade::addon::event_callback> *, uint64_t> &retired : s_retired_event_lists)
+			delete retired.first;
+		s_retired_event_lists.clear();
+		has_retired_event_lists.store(false, std::memory_order_relaxed);
+	}
+}
+
+static void update_event_mask()
+{
+	// Recording a command stream requires the events it is built from to be invoked, even if no add-on installed callbacks for them
+	static constexpr reshade::addon_event recorded_events[] = {
+		reshade::addon_event::bind_viewports,
+		reshade::addon_event::draw,
+		reshade::addon_event::draw_indexed,
+		reshade::addon_event::dispatch,
+		reshade::addon_event::draw_or_dispatch_indirect,
+		reshade::addon_event::clear_depth_stencil_view,
+		reshade::addon_event::clear_render_target_view,
+		reshade::addon_event::destroy_command_list,
+		reshade::addon_event::destroy_command_queue,
+		reshade::addon_event::reset_command_list,
+		reshade::addon_event::execute_command_list,
+		reshade::addon_event::execute_secondary_command_list,
+		reshade::addon_event::present,
+	};
+
+	uint64_t mask[std::size(reshade::addon::event_mask)] = {};
+
+	for (size_t event_index = 0; event_index < std::size(reshade::addon::event_list); ++event_index)
+		if (reshade::addon::event_list[event_index].load(std::memory_order_relaxed) != nullptr)
+			mask[event_index / 64] |= 1ull << (event_index % 64);
+
+	if (reshade::addon::event_list[static_cast<size_t>(reshade::addon_event::execute_command_stream)].load(std::memory_order_relaxed) != nullptr)
+		for (const reshade::addon_event ev : recorded_events)
+			mask[static_cast<size_t>(ev) / 64] |= 1ull << (static_cast<size_t>(ev) % 64);
+
+	for (size_t i = 0; i < std::size(mask); ++i)
+		reshade::addon::event_mask[i].store(mask[i], std::memory_order_relaxed);
+}
+
+static void replace_event_list(size_t event_index, std::vector<reshade::addon::event_callback> &&callbacks)
+{
+	// Publish a new list instead of modifying the current one in place, since other threads may be iterating over it right now
+	const std::vector<reshade::addon::event_callback> *const new_list = callbacks.empty() ? nullptr : new std::vector<reshade::addon::event_callback>(std::move(callbacks));
+	const std::vector<reshade::addon::event_callback> *const old_list = reshade::addon::event_list[event_index].exchange(new_list, std::memory_order_acq_rel);
+
+	if (old_list != nullptr)
+	{
+		s_retired_event_lists.emplace_back(old_list, s_event_list_epoch.load(std::memory_order_relaxed));
+		reshade::addon::has_retired_event_lists.store(true, std::memory_order_relaxed);
+	}
+}
+
+event_list_reader_slot::event_list_reader_slot()
+{
+	const std::lock_guard<std::mutex> lock(s_reader_slots_mutex);
+	s_reader_slots.push_back(this);
+}
+event_list_reader_slot::~event_list_reader_slot()
+{
+	const std::lock_guard<std::mutex> lock(s_reader_slots_mutex);
+	s_reader_slots.erase(std::find(s_reader_slots.begin(), s_reader_slots.end(), this));
+}
+
+reshade::addon::event_list_reader::event_list_reader()
+{
+	event_list_reader_slot &slot = t_reader_slot;
+	if (slot.nesting++ != 0)
+		return;
+
+	slot.epoch.store(s_event_list_epoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+	// Only prevent the compiler from moving the event list load before the store above, the processor is serialized by 'FlushProcessWriteBuffers' in 'reclaim_event_lists' instead, which keeps this cheap
+	std::atomic_signal_fence(std::memory_order_seq_cst);
+}
+reshade::addon::event_list_reader::~event_list_reader()
+{
+	event_list_reader_slot &slot = t_reader_slot;
+	if (--slot.nesting != 0)
+		return;
+
+	slot.epoch.store(std::numeric_limits<uint64_t>::max(), std::memory_order_release);
+}
+
+void reshade::addon::reclaim_event_lists()
+{
+	const std::lock_guard<std::mutex> lock(s_event_list_mutex);
+
+	// Make the epochs stored by all threads entering a reader visible here, so that any thread that is not seen reading below is guaranteed to load the replaced lists
+	FlushProcessWriteBuffers();
+
+	uint64_t oldest_reader_epoch = std::numeric_limits<uint64_t>::max();
+	{	const std::lock_guard<std::mutex> slots_lock(s_reader_slots_mutex);
+		for (const event_list_reader_slot *const slot : s_reader_slots)
+			oldest_reader_epoch = std::min(oldest_reader_epoch, slot->epoch.load(std::memory_order_acquire));
+	}
+
+	// A list may still be iterated by threads that entered a reader in the epoch it was replaced in or earlier, so only free those all current readers started after
+	const auto it = std::remove_if(s_retired_event_lists.begin(), s_retired_event_lists.end(),
+		[oldest_reader_epoch](const std::pair<const std::vector<reshade::addon::event_callback> *, uint64_t> &retired) {
+			if (retired.second >= oldest_reader_epoch)
+				return false;
+			delete retired.first;
+			return true;
+		});
+	s_retired_event_lists.erase(it, s_retired_event_lists.end());
+
+	has_retired_event_lists.store(!s_retired_event_lists.empty(), std::memory_order_relaxed);
+
+	s_event_list_epoch.fetch_add(1, std::memory_order_acq_rel);
 }
 
 void reshade::addon::enable_or_disable_addons(bool enabled)
@@ -166,21 +313,179 @@ void reshade::addon::enable_or_disable_addons(bool enabled)
 	if (enabled == g_addons_enabled)
 		return;
 
-	static std::vector<void *> disabled_event_list[std::size(event_list)];
-	if (enabled)
+	const std::lock_guard<std::mutex> lock(s_event_list_mutex);
+
+	static std::vector<reshade::addon::event_callback> disabled_event_list[std::size(event_list)];
+	for (size_t event_index = 0; event_index < std::size(event_list); ++event_index)
 	{
-		for (size_t event_index = 0; event_index < std::size(event_list); ++event_index)
-			event_list[event_index] = std::move(disabled_event_list[event_index]);
+		if (enabled)
+		{
+			replace_event_list(event_index, std::move(disabled_event_list[event_index]));
+			disabled_event_list[event_index].clear();
+		}
+		else if (const std::vector<reshade::addon::event_callback> *const current_list = event_list[event_index].load(std::memory_order_relaxed); current_list != nullptr)
+		{
+			disabled_event_list[event_index] = *current_list;
+			replace_event_list(event_index, {});
+		}
+	}
+
+	update_event_mask();
+
+	g_addons_enabled = enabled;
+}
+
+// Implementation of the xxHash64 algorithm (see https://github.com/Cyan4973/xxHash), which processes 32 bytes per iteration in four independent lanes and is therefore a lot faster than CRC32 or FNV on large shader binaries
+static uint64_t compute_xxhash64(const void *data, size_t size)
+{
+	constexpr uint64_t prime1 = 0x9E3779B185EBCA87ull;
+	constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+	constexpr uint64_t prime3 = 0x165667B19E3779F9ull;
+	constexpr uint64_t prime4 = 0x85EBCA77C2B2AE63ull;
+	constexpr uint64_t prime5 = 0x27D4EB2F165667C5ull;
+
+	const auto rotl = [](uint64_t x, int r) { return (x << r) | (x >> (64 - r)); };
+	const auto round = [rotl](uint64_t acc, uint64_t input) { return rotl(acc + input * prime2, 31) * prime1; };
+	const auto read64 = [](const uint8_t *p) { uint64_t v; std::memcpy(&v, p, sizeof(v)); return v; };
+	const auto read32 = [](const uint8_t *p) { uint32_t v; std::memcpy(&v, p, sizeof(v)); return v; };
+
+	const uint8_t *p = static_cast<const uint8_t *>(data);
+	const uint8_t *const end = p + size;
+
+	uint64_t h;
+	if (size >= 32)
+	{
+		uint64_t v1 = prime1 + prime2, v2 = prime2, v3 = 0, v4 = 0 - prime1;
+		for (; p + 32 <= end; p += 32)
+		{
+			v1 = round(v1, read64(p));
+			v2 = round(v2, read64(p + 8));
+			v3 = round(v3, read64(p + 16));
+			v4 = round(v4, read64(p + 24));
+		}
+
+		h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+		for (const uint64_t v : { v1, v2, v3, v4 })
+			h = (h ^ round(0, v)) * prime1 + prime4;
 	}
 	else
 	{
-		for (size_t event_index = 0; event_index < std::size(event_list); ++event_index)
-			disabled_event_list[event_index] = std::move(event_list[event_index]);
+		h = prime5;
 	}
 
-	g_addons_enabled = enabled;
+	h += size;
+
+	for (; p + 8 <= end; p += 8)
+		h = rotl(h ^ round(0, read64(p)), 27) * prime1 + prime4;
+	if (p + 4 <= end)
+		h = rotl(h ^ (read32(p) * prime1), 23) * prime2 + prime3, p += 4;
+	for (; p < end; ++p)
+		h = rotl(h ^ (*p * prime5), 11) * prime1;
+
+	h ^= h >> 33;
+	h *= prime2;
+	h ^= h >> 29;
+	h *= prime3;
+	h ^= h >> 32;
+
+	return h;
+}
+
+// Hashes of the shaders in the pipeline description the current thread last passed to 'compute_shader_hashes', which is only ever one pipeline with at most five shaders
+static thread_local struct { const void *code; size_t code_size; uint64_t hash; } t_shader_hashes[5] = {};
+
+void reshade::addon::compute_shader_hashes(const api::pipeline_desc &desc)
+{
+	// Only spend time on hashing if there is anyone interested in the result
+	if (!has_addon_event<addon_event::create_pipeline>() && !has_addon_event<addon_event::init_pipeline>())
+		return;
+
+	size_t index = 0;
+	const auto compute_hash = [&index](const api::shader_desc &shader) {
+		if (shader.code == nullptr || shader.code_size == 0)
+			return;
+		t_shader_hashes[index++] = { shader.code, shader.code_size, compute_xxhash64(shader.code, shader.code_size) };
+	};
+
+	if ((desc.type & api::pipeline_stage::all_compute) == api::pipeline_stage::all_compute)
+	{
+		compute_hash(desc.compute.shader);
+	}
+	else
+	{
+		compute_hash(desc.graphics.vertex_shader);
+		compute_hash(desc.graphics.hull_shader);
+		compute_hash(desc.graphics.domain_shader);
+		compute_hash(desc.graphics.geometry_shader);
+		compute_hash(desc.graphics.pixel_shader);
+	}
+
+	for (; index < std::size(t_shader_hashes); ++index)
+		t_shader_hashes[index] = {};
+}
+
+double reshade::addon::get_callback_profile(std::vector<callback_profile> &profile)
+{
+	const std::lock_guard<std::mutex> lock(s_event_list_mutex);
+
+	const uint64_t elapsed_cycles = __rdtsc() - s_profile_start_cycles;
+	const double elapsed_seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - s_profile_start_time).count();
+	// Calibrate cycle counter against the wall clock over the profiling period, rather than relying on a nominal frequency
+	const double seconds_per_cycle = (elapsed_cycles != 0) ? elapsed_seconds / elapsed_cycles : 0.0;
+
+	profile.clear();
+	for (const callback_stats &stats : s_callback_stats)
+	{
+		const uint64_t num_calls = stats.num_calls.load(std::memory_order_relaxed);
+		if (num_calls == 0)
+			continue;
+
+		const uint64_t num_sampled_calls = stats.num_sampled_calls.load(std::memory_order_relaxed);
+		const double average_cycles = (num_sampled_calls != 0) ? static_cast<double>(stats.sampled_cycles.load(std::memory_order_relaxed)) / num_sampled_calls : 0.0;
+
+		profile.push_back({ stats.handle, stats.ev, num_calls, average_cycles * num_calls * seconds_per_cycle });
+	}
+
+	return elapsed_seconds;
+}
+void reshade::addon::reset_callback_profile()
+{
+	const std::lock_guard<std::mutex> lock(s_event_list_mutex);
+
+	for (callback_stats &stats : s_callback_stats)
+	{
+		stats.num_calls.store(0, std::memory_order_relaxed);
+		stats.num_sampled_calls.store(0, std::memory_order_relaxed);
+		stats.sampled_cycles.store(0, std::memory_order_relaxed);
+	}
+
+	s_profile_start_cycles = __rdtsc();
+	s_profile_start_time = std::chrono::high_resolution_clock::now();
 }
 
+static reshade::addon::callback_stats &find_or_add_callback_stats(reshade::addon_event ev, void *callback)
+{
+	const auto stats_it = std::find_if(s_callback_stats.begin(), s_callback_stats.end(),
+		[ev, callback](const reshade::addon::callback_stats &stats) { return stats.func == callback && stats.ev == ev; });
+	const bool new_stats = stats_it == s_callback_stats.end();
+	reshade::addon::callback_stats &stats = new_stats ? s_callback_stats.emplace_back() : *stats_it;
+	if (new_stats)
+	{
+		stats.func = callback;
+		stats.ev = ev;
+
+		// Attribute callback to the add-on whose module contains its code
+		HMODULE handle = nullptr;
+		GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, static_cast<LPCWSTR>(callback), &handle);
+		stats.handle = (handle != g_module_handle) ? handle : nullptr;
+	}
+
+	return stats;
+}
+
+// Export the interface version, so that add-ons built against a newer one can detect that functions they call are missing (see 'reshade::init_addon')
+extern "C" __declspec(dllexport) const uint32_t ReShadeAPIVersion = RESHADE_API_VERSION;
+
 extern "C" __declspec(dllexport) void ReShadeRegisterEvent(reshade::addon_event ev, void *callback)
 {
 	if (ev >= reshade::addon_event::max)
@@ -188,11 +493,55 @@ extern "C" __declspec(dllexport) void ReShadeRegisterEvent(reshade::addon_event
 
 	assert(callback != nullptr);
 
-	auto &event_list = reshade::addon::event_list[static_cast<size_t>(ev)];
-	event_list.push_back(callback);
+	const std::lock_guard<std::mutex> lock(s_event_list_mutex);
+
+	reshade::addon::callback_stats &stats = find_or_add_callback_stats(ev, callback);
+
+	std::vector<reshade::addon::event_callback> callbacks;
+	if (const std::vector<reshade::addon::event_callback> *const current_list = reshade::addon::event_list[static_cast<size_t>(ev)].load(std::memory_order_relaxed); current_list != nullptr)
+		callbacks = *current_list;
+	callbacks.push_back({ callback, &stats });
+
+	replace_event_list(static_cast<size_t>(ev), std::move(callbacks));
+	update_event_mask();
+
+#if RESHADE_VERBOSE_LOG
+	LOG(DEBUG) << "Registered event callback " << callback << " for event " << reshade::addon::addon_event_to_string(ev) << '.';
+#endif
+}
+extern "C" __declspec(dllexport) void ReShadeRegisterEventWithFilter(reshade::addon_event ev, void *callback, uint32_t num_handles, const uint64_t *handles)
+{
+	if (ev >= reshade::addon_event::max)
+		return;
+
+	assert(callback != nullptr && (num_handles == 0 || handles != nullptr));
+
+	// Sort the handles once here, so that the membership test when the event is invoked is a binary search
+	std::vector<uint64_t> filter(handles, handles + num_handles);
+	std::sort(filter.begin(), filter.end());
+	filter.erase(std::unique(filter.begin(), filter.end()), filter.end());
+
+	const std::lock_guard<std::mutex> lock(s_event_list_mutex);
+
+	reshade::addon::callback_stats &stats = find_or_add_callback_stats(ev, callback);
+
+	std::vector<reshade::addon::event_callback> callbacks;
+	if (const std::vector<reshade::addon::event_callback> *const current_list = reshade::addon::event_list[static_cast<size_t>(ev)].load(std::memory_order_relaxed); current_list != nullptr)
+		callbacks = *current_list;
+
+	// Registering a callback that already has a filter again replaces that filter, so that add-ons can update the list of handles they are interested in while keeping their position in the call order
+	const auto callback_it = std::find_if(callbacks.begin(), callbacks.end(),
+		[callback](const reshade::addon::event_callback &it) { return it.func == callback && it.filter != nullptr; });
+	if (callback_it != callbacks.end())
+		callback_it->filter = std::make_shared<const std::vector<uint64_t>>(std::move(filter));
+	else
+		callbacks.push_back({ callback, &stats, std::make_shared<const std::vector<uint64_t>>(std::move(filter)) });
+
+	replace_event_list(static_cast<size_t>(ev), std::move(callbacks));
+	update_event_mask();
 
 #if RESHADE_VERBOSE_LOG
-	LOG(DEBUG) << "Registered event callback " << callback << " for event " << addon_event_to_string(ev) << '.';
+	LOG(DEBUG) << "Registered event callback " << callback << " for event " << reshade::addon::addon_event_to_string(ev) << " with a filter of " << num_handles << " handles.";
 #endif
 }
 extern "C" __declspec(dllexport) void ReShadeUnregisterEvent(reshade::addon_event ev, void *callback)
@@ -202,15 +551,199 @@ extern "C" __declspec(dllexport) void ReShadeUnregisterEvent(reshade::addon_even
 
 	assert(callback != nullptr);
 
-	auto &event_list = reshade::addon::event_list[static_cast<size_t>(ev)];
-	event_list.erase(std::remove(event_list.begin(), event_list.end(), callback), event_list.end());
+	const std::lock_guard<std::mutex> lock(s_event_list_mutex);
+
+	const std::vector<reshade::addon::event_callback> *const current_list = reshade::addon::event_list[static_cast<size_t>(ev)].load(std::memory_order_relaxed);
+	const auto is_callback = [callback](const reshade::addon::event_callback &it) { return it.func == callback; };
+	if (current_list == nullptr || std::find_if(current_list->begin(), current_list->end(), is_callback) == current_list->end())
+		return;
+
+	std::vector<reshade::addon::event_callback> callbacks = *current_list;
+	callbacks.erase(std::remove_if(callbacks.begin(), callbacks.end(), is_callback), callbacks.end());
+
+	replace_event_list(static_cast<size_t>(ev), std::move(callbacks));
+	update_event_mask();
 
 #if RESHADE_VERBOSE_LOG
-	LOG(DEBUG) << "Unregistered event callback " << callback << " for event " << addon_event_to_string(ev) << '.';
+	LOG(DEBUG) << "Unregistered event callback " << callback << " for event " << reshade::addon::addon_event_to_string(ev) << '.';
 #endif
 }
 
+extern "C" __declspec(dllexport) uint32_t ReShadeAllocateUserDataSlot(const uint8_t guid[16])
+{
+	// Slots are never released again, so that add-ons that are reloaded get back the same slot for the same GUID
+	static uint64_t slot_guids[reshade::addon::max_user_data_slots][2] = {};
+	static uint32_t num_slots = 0;
+
+	const uint64_t guid_lo = reinterpret_cast<const uint64_t *>(guid)[0];
+	const uint64_t guid_hi = reinterpret_cast<const uint64_t *>(guid)[1];
+
+	for (uint32_t slot = 0; slot < num_slots; ++slot)
+		if (slot_guids[slot][0] == guid_lo && slot_guids[slot][1] == guid_hi)
+			return slot;
+
+	if (num_slots == reshade::addon::max_user_data_slots)
+	{
+		LOG(WARN) << "Failed to allocate custom data slot, since all " << reshade::addon::max_user_data_slots << " slots are already in use.";
+		return std::numeric_limits<uint32_t>::max();
+	}
+
+	slot_guids[num_slots][0] = guid_lo;
+	slot_guids[num_slots][1] = guid_hi;
+
+#if RESHADE_VERBOSE_LOG
+	LOG(DEBUG) << "Allocated custom data slot " << num_slots << '.';
+#endif
+
+	return num_slots++;
+}
+
+// {7B3F1C5E-2A9D-4E61-B0C8-1F5D6A2E9C47}
+static constexpr uint8_t s_command_stream_guid[16] = { 0x5e, 0x1c, 0x3f, 0x7b, 0x9d, 0x2a, 0x61, 0x4e, 0xb0, 0xc8, 0x1f, 0x5d, 0x6a, 0x2e, 0x9c, 0x47 };
+
+static std::vector<uint64_t> *find_command_stream(reshade::api::command_list *cmd_list)
+{
+	std::vector<uint64_t> *stream = nullptr;
+	cmd_list->get_user_data(s_command_stream_guid, reinterpret_cast<void **>(&stream));
+	return stream;
+}
+static void submit_command_stream(reshade::api::command_queue *queue, reshade::api::command_list *cmd_list)
+{
+	if (const std::vector<uint64_t> *const stream = find_command_stream(cmd_list); stream != nullptr && !stream->empty())
+		reshade::invoke_addon_event<reshade::addon_event::execute_command_stream>(queue, cmd_list, reinterpret_cast<const reshade::api::command_packet *>(stream->data()), stream->size() * sizeof(uint64_t));
+}
+
+template <typename T>
+static T &append_command_packet(reshade::api::command_list *cmd_list, reshade::api::command_type type, size_t extra_size = 0)
+{
+	std::vector<uint64_t> &stream = cmd_list->get_user_data<std::vector<uint64_t>>(s_command_stream_guid);
+
+	// Round packets up to a multiple of 8 bytes, so that handles in the following packet stay aligned
+	const size_t size = (sizeof(T) + extra_size + 7) / 8;
+	const size_t offset = stream.size();
+	stream.resize(offset + size);
+
+	T &packet = *reinterpret_cast<T *>(stream.data() + offset);
+	packet.type = type;
+	packet.size = static_cast<uint32_t>(size * 8);
+	return packet;
+}
+
+void reshade::addon::command_recorder<reshade::addon_event::bind_viewports>::record(api::command_list *cmd_list, uint32_t first, uint32_t count, const float *viewports)
+{
+	auto &packet = append_command_packet<api::command_packet_bind_viewports>(cmd_list, api::command_type::bind_viewports, count * 6 * sizeof(float));
+	packet.first = first;
+	packet.count = count;
+	std::memcpy(&packet + 1, viewports, count * 6 * sizeof(float));
+}
+void reshade::addon::command_recorder<reshade::addon_event::draw>::record(api::command_list *cmd_list, uint32_t vertices, uint32_t instances, uint32_t first_vertex, uint32_t first_instance)
+{
+	auto &packet = append_command_packet<api::command_packet_draw>(cmd_list, api::command_type::draw);
+	packet.vertices = vertices;
+	packet.instances = instances;
+	packet.first_vertex = first_vertex;
+	packet.first_instance = first_instance;
+}
+void reshade::addon::command_recorder<reshade::addon_event::draw_indexed>::record(api::command_list *cmd_list, uint32_t indices, uint32_t instances, uint32_t first_index, int32_t vertex_offset, uint32_t first_instance)
+{
+	auto &packet = append_command_packet<api::command_packet_draw_indexed>(cmd_list, api::command_type::draw_indexed);
+	packet.indices = indices;
+	packet.instances = instances;
+	packet.first_index = first_index;
+	packet.vertex_offset = vertex_offset;
+	packet.first_instance = first_instance;
+}
+void reshade::addon::command_recorder<reshade::addon_event::dispatch>::record(api::command_list *cmd_list, uint32_t num_groups_x, uint32_t num_groups_y, uint32_t num_groups_z)
+{
+	auto &packet = append_command_packet<api::command_packet_dispatch>(cmd_list, api::command_type::dispatch);
+	packet.num_groups_x = num_groups_x;
+	packet.num_groups_y = num_groups_y;
+	packet.num_groups_z = num_groups_z;
+}
+void reshade::addon::command_recorder<reshade::addon_event::draw_or_dispatch_indirect>::record(api::command_list *cmd_list, api::indirect_command type, api::resource buffer, uint64_t offset, uint32_t draw_count, uint32_t stride)
+{
+	auto &packet = append_command_packet<api::command_packet_draw_or_dispatch_indirect>(cmd_list, api::command_type::draw_or_dispatch_indirect);
+	packet.indirect_type = type;
+	packet.draw_count = draw_count;
+	packet.buffer = buffer;
+	packet.offset = offset;
+	packet.stride = stride;
+}
+void reshade::addon::command_recorder<reshade::addon_event::clear_depth_stencil_view>::record(api::command_list *cmd_list, api::resource_view dsv, api::attachment_type clear_flags, float depth, uint8_t stencil, uint32_t num_rects, const int32_t *rects)
+{
+	auto &packet = append_command_packet<api::command_packet_clear_depth_stencil_view>(cmd_list, api::command_type::clear_depth_stencil_view, num_rects * 4 * sizeof(int32_t));
+	packet.dsv = dsv;
+	packet.clear_flags = clear_flags;
+	packet.depth = depth;
+	packet.stencil = stencil;
+	packet.num_rects = num_rects;
+	if (num_rects != 0)
+		std::memcpy(&packet + 1, rects, num_rects * 4 * sizeof(int32_t));
+}
+void reshade::addon::command_recorder<reshade::addon_event::clear_render_target_view>::record(api::command_list *cmd_list, api::resource_view rtv, const float color[4], uint32_t num_rects, const int32_t *rects)
+{
+	auto &packet = append_command_packet<api::command_packet_clear_render_target_view>(cmd_list, api::command_type::clear_render_target_view, num_rects * 4 * sizeof(int32_t));
+	packet.rtv = rtv;
+	std::memcpy(packet.color, color, sizeof(packet.color));
+	packet.num_rects = num_rects;
+	if (num_rects != 0)
+		std::memcpy(&packet + 1, rects, num_rects * 4 * sizeof(int32_t));
+}
+
+void reshade::addon::command_recorder<reshade::addon_event::destroy_command_list>::record(api::command_list *cmd_list)
+{
+	cmd_list->destroy_user_data<std::vector<uint64_t>>(s_command_stream_guid);
+}
+void reshade::addon::command_recorder<reshade::addon_event::destroy_command_queue>::record(api::command_queue *queue)
+{
+	// Immediate command lists are destroyed together with their queue and do not necessarily invoke 'destroy_command_list'
+	if (api::command_list *const cmd_list = queue->get_immediate_command_list(); cmd_list != nullptr)
+		cmd_list->destroy_user_data<std::vector<uint64_t>>(s_command_stream_guid);
+}
+void reshade::addon::command_recorder<reshade::addon_event::reset_command_list>::record(api::command_list *cmd_list)
+{
+	if (std::vector<uint64_t> *const stream = find_command_stream(cmd_list); stream != nullptr)
+		stream->clear();
+}
+void reshade::addon::command_recorder<reshade::addon_event::execute_command_list>::record(api::command_queue *queue, api::command_list *cmd_list)
+{
+	// Keep the stream around afterwards, since a command list may be executed multiple times before it is reset
+	submit_command_stream(queue, cmd_list);
+}
+void reshade::addon::command_recorder<reshade::addon_event::execute_secondary_command_list>::record(api::command_list *cmd_list, api::command_list *secondary_cmd_list)
+{
+	if (const std::vector<uint64_t> *const secondary_stream = find_command_stream(secondary_cmd_list); secondary_stream != nullptr && !secondary_stream->empty())
+	{
+		std::vector<uint64_t> &stream = cmd_list->get_user_data<std::vector<uint64_t>>(s_command_stream_guid);
+		stream.insert(stream.end(), secondary_stream->begin(), secondary_stream->end());
+	}
+}
+void reshade::addon::command_recorder<reshade::addon_event::present>::record(api::command_queue *queue, api::swapchain *)
+{
+	// Commands on the immediate command list are executed right away, so hand them out once per frame instead
+	api::command_list *const cmd_list = queue->get_immediate_command_list();
+	if (cmd_list == nullptr)
+		return;
+
+	submit_command_stream(queue, cmd_list);
+
+	if (std::vector<uint64_t> *const stream = find_command_stream(cmd_list); stream != nullptr)
+		stream->clear();
+}
+
 #if RESHADE_GUI
+extern "C" __declspec(dllexport) uint64_t ReShadeGetShaderCodeHash(const void *code, size_t code_size)
+{
+	if (code == nullptr || code_size == 0)
+		return 0;
+
+	for (const auto &shader : t_shader_hashes)
+		if (shader.code == code && shader.code_size == code_size)
+			return shader.hash;
+
+	return compute_xxhash64(code, code_size);
+}
+
 extern "C" __declspec(dllexport) void ReShadeRegisterOverlay(const char *title, void(*callback)(reshade::api::effect_runtime *runtime, void *imgui_context))
 {
 	assert(callback != nullptr);
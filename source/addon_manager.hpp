@@ -7,29 +7,13 @@
 
 #include "addon_impl.hpp"
 #include "reshade_events.hpp"
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <intrin.h>
 
 #if RESHADE_ADDON
 
-namespace reshade
-{
-	template <addon_event ev, typename... Args>
-	inline std::enable_if_t<addon_event_traits<ev>::type == 1, void> invoke_addon_event(const Args &... args)
-	{
-		std::vector<void *> &event_list = addon::event_list[static_cast<size_t>(ev)];
-		for (size_t cb = 0, count = event_list.size(); cb < count; ++cb) // Generates better code than ranged-based for loop
-			reinterpret_cast<typename reshade::addon_event_traits<ev>::decl>(event_list[cb])(args...);
-	}
-	template <addon_event ev, typename... Args>
-	inline std::enable_if_t<addon_event_traits<ev>::type == 2, bool> invoke_addon_event(const Args &... args)
-	{
-		std::vector<void *> &event_list = addon::event_list[static_cast<size_t>(ev)];
-		for (size_t cb = 0, count = event_list.size(); cb < count; ++cb)
-			if (reinterpret_cast<typename reshade::addon_event_traits<ev>::decl>(event_list[cb])(args...))
-				return true;
-		return false;
-	}
-}
-
 namespace reshade::addon
 {
 	struct info
@@ -45,9 +29,145 @@ namespace reshade::addon
 	extern std::vector<info> loaded_info;
 
 	/// <summary>
-	/// List of installed add-on event callbacks.
+	/// Statistics gathered for a single event callback while <see cref="profile_callbacks"/> is enabled.
+	/// </summary>
+	struct callback_stats
+	{
+		void *func;
+		addon_event ev;
+		/// <summary>
+		/// Module handle of the add-on that registered the callback (or <c>nullptr</c> for built-in add-ons).
+		/// </summary>
+		void *handle;
+		std::atomic<uint64_t> num_calls = 0;
+		std::atomic<uint64_t> num_sampled_calls = 0;
+		std::atomic<uint64_t> sampled_cycles = 0;
+	};
+
+	/// <summary>
+	/// An installed event callback.
+	/// </summary>
+	struct event_callback
+	{
+		void *func;
+		callback_stats *stats;
+		/// <summary>
+		/// Sorted list of handles the callback is restricted to (or <c>nullptr</c> if it is called for every event).
+		/// </summary>
+		std::shared_ptr<const std::vector<uint64_t>> filter;
+	};
+
+	/// <summary>
+	/// Checks whether any of the pipeline, resource or resource view arguments of an event is in the specified handle filter.
+	/// Other arguments (including arrays of handles) are not considered.
+	/// </summary>
+	template <typename... Args>
+	inline bool matches_filter(const std::vector<uint64_t> &filter, const Args &... args)
+	{
+		const auto matches = [&filter](const auto &arg) {
+			using arg_type = std::decay_t<decltype(arg)>;
+			if constexpr (std::is_same_v<arg_type, api::pipeline> || std::is_same_v<arg_type, api::resource> || std::is_same_v<arg_type, api::resource_view>)
+				return std::binary_search(filter.begin(), filter.end(), arg.handle);
+			else
+				return false;
+		};
+
+		return (matches(args) || ...);
+	}
+
+	/// <summary>
+	/// List of installed add-on event callbacks (or <c>nullptr</c> if there are none).
+	/// The lists are never modified after they were published, registration instead replaces them with a new copy, so they can be iterated without a lock while callbacks are registered or unregistered on other threads.
+	/// Replaced lists are kept alive until every thread that may still be iterating them finished doing so (see <see cref="event_list_reader"/>).
+	/// </summary>
+	extern std::atomic<const std::vector<event_callback> *> event_list[];
+	/// <summary>
+	/// Bit mask with a bit set for every event that has at least one callback installed in <see cref="event_list"/>, or that is recorded for the <see cref="addon_event::execute_command_stream"/> event.
+	/// </summary>
+	extern std::atomic<uint64_t> event_mask[];
+
+	/// <summary>
+	/// Enables measuring the time spent in every event callback, so that expensive add-ons can be identified.
+	/// Only every <see cref="callback_sample_interval"/>th call on a thread is timed, the total is then estimated from the number of calls.
+	/// </summary>
+	extern std::atomic<bool> profile_callbacks;
+	constexpr uint32_t callback_sample_interval = 16;
+
+	/// <summary>
+	/// Accumulated profiling results for a single event callback.
 	/// </summary>
-	extern std::vector<void *> event_list[];
+	struct callback_profile
+	{
+		void *handle;
+		addon_event ev;
+		uint64_t num_calls;
+		double seconds;
+	};
+
+	/// <summary>
+	/// Gets the profiling results of all callbacks that were called since profiling was last reset.
+	/// </summary>
+	/// <returns>The time in seconds that passed since profiling was last reset.</returns>
+	double get_callback_profile(std::vector<callback_profile> &profile);
+	/// <summary>
+	/// Resets the profiling statistics of all callbacks.
+	/// </summary>
+	void reset_callback_profile();
+
+	/// <summary>
+	/// Measures the time spent in a single event callback when it is sampled.
+	/// </summary>
+	class callback_timer
+	{
+	public:
+		explicit callback_timer(callback_stats *stats)
+		{
+			static thread_local uint32_t sample_counter = 0;
+
+			if (!profile_callbacks.load(std::memory_order_relaxed))
+				return;
+
+			stats->num_calls.fetch_add(1, std::memory_order_relaxed);
+
+			if (++sample_counter % callback_sample_interval == 0)
+			{
+				_stats = stats;
+				_start = __rdtsc();
+			}
+		}
+		~callback_timer()
+		{
+			if (_stats == nullptr)
+				return;
+
+			_stats->sampled_cycles.fetch_add(__rdtsc() - _start, std::memory_order_relaxed);
+			_stats->num_sampled_calls.fetch_add(1, std::memory_order_relaxed);
+		}
+
+	private:
+		callback_stats *_stats = nullptr;
+		uint64_t _start = 0;
+	};
+
+	/// <summary>
+	/// Marks the calling thread as iterating an event callback list for the lifetime of this object, so that lists replaced in the meantime are not freed while it still reads them.
+	/// This can be nested, only the outermost reader on a thread does any work.
+	/// </summary>
+	class event_list_reader
+	{
+	public:
+		event_list_reader();
+		~event_list_reader();
+	};
+
+	/// <summary>
+	/// Frees replaced event callback lists that no thread can still be iterating (see <see cref="event_list_reader"/>) and begins a new epoch.
+	/// </summary>
+	void reclaim_event_lists();
+	/// <summary>
+	/// Set when there are replaced event callback lists waiting to be freed by <see cref="reclaim_event_lists"/>.
+	/// </summary>
+	extern std::atomic<bool> has_retired_event_lists;
 
 #if RESHADE_GUI
 	/// <summary>
@@ -58,11 +178,12 @@ namespace reshade::addon
 
 	/// <summary>
 	/// Load any add-ons found in the configured search paths.
+	/// This is reference counted and called by every device when it is created (not when ReShade is attached to the process), so processes that never create a device (e.g. launchers or crash handlers) never load any add-ons.
 	/// </summary>
 	void load_addons();
 
 	/// <summary>
-	/// Unload any add-ons previously loaded via <see cref="load_addons"/>.
+	/// Unload any add-ons previously loaded via <see cref="load_addons"/>, once the last device that loaded them was destroyed.
 	/// </summary>
 	void unload_addons();
 
@@ -70,6 +191,125 @@ namespace reshade::addon
 	/// Enable or disable all loaded add-ons.
 	/// </summary>
 	void enable_or_disable_addons(bool enabled);
+
+	/// <summary>
+	/// Computes the hashes of all shaders in a pipeline description created by the application, if there are callbacks installed for the pipeline creation events.
+	/// These are then returned by 'ReShadeGetShaderCodeHash' on the calling thread, so that add-ons do not each have to hash the code during those events.
+	/// </summary>
+	void compute_shader_hashes(const api::pipeline_desc &desc);
+
+	/// <summary>
+	/// Gets the name of the specified event.
+	/// </summary>
+	const char *addon_event_to_string(addon_event ev);
+
+	/// <summary>
+	/// Records the arguments of events into the command packet stream of the command list they were called on, while the <see cref="addon_event::execute_command_stream"/> event has callbacks installed.
+	/// Events without a specialization are not recorded.
+	/// </summary>
+	template <addon_event ev>
+	struct command_recorder
+	{
+		static constexpr bool enabled = false;
+	};
+
+#define DEFINE_COMMAND_RECORDER(ev, ...) \
+	template <> \
+	struct command_recorder<ev> \
+	{ \
+		static constexpr bool enabled = true; \
+		static void record(__VA_ARGS__); \
+	}
+
+	DEFINE_COMMAND_RECORDER(addon_event::bind_viewports, api::command_list *cmd_list, uint32_t first, uint32_t count, const float *viewports);
+	DEFINE_COMMAND_RECORDER(addon_event::draw, api::command_list *cmd_list, uint32_t vertices, uint32_t instances, uint32_t first_vertex, uint32_t first_instance);
+	DEFINE_COMMAND_RECORDER(addon_event::draw_indexed, api::command_list *cmd_list, uint32_t indices, uint32_t instances, uint32_t first_index, int32_t vertex_offset, uint32_t first_instance);
+	DEFINE_COMMAND_RECORDER(addon_event::dispatch, api::command_list *cmd_list, uint32_t num_groups_x, uint32_t num_groups_y, uint32_t num_groups_z);
+	DEFINE_COMMAND_RECORDER(addon_event::draw_or_dispatch_indirect, api::command_list *cmd_list, api::indirect_command type, api::resource buffer, uint64_t offset, uint32_t draw_count, uint32_t stride);
+	DEFINE_COMMAND_RECORDER(addon_event::clear_depth_stencil_view, api::command_list *cmd_list, api::resource_view dsv, api::attachment_type clear_flags, float depth, uint8_t stencil, uint32_t num_rects, const int32_t *rects);
+	DEFINE_COMMAND_RECORDER(addon_event::clear_render_target_view, api::command_list *cmd_list, api::resource_view rtv, const float color[4], uint32_t num_rects, const int32_t *rects);
+
+	// These do not add packets, but manage the lifetime of the stream and hand it to the add-ons once the commands are executed
+	DEFINE_COMMAND_RECORDER(addon_event::destroy_command_list, api::command_list *cmd_list);
+	DEFINE_COMMAND_RECORDER(addon_event::destroy_command_queue, api::command_queue *queue);
+	DEFINE_COMMAND_RECORDER(addon_event::reset_command_list, api::command_list *cmd_list);
+	DEFINE_COMMAND_RECORDER(addon_event::execute_command_list, api::command_queue *queue, api::command_list *cmd_list);
+	DEFINE_COMMAND_RECORDER(addon_event::execute_secondary_command_list, api::command_list *cmd_list, api::command_list *secondary_cmd_list);
+	DEFINE_COMMAND_RECORDER(addon_event::present, api::command_queue *queue, api::swapchain *swapchain);
+
+#undef DEFINE_COMMAND_RECORDER
+}
+
+namespace reshade
+{
+	/// <summary>
+	/// Checks whether any callbacks are installed for the specified event, so that hooks can skip translating arguments for it if there are none.
+	/// </summary>
+	template <addon_event ev>
+	inline bool has_addon_event()
+	{
+		return (addon::event_mask[static_cast<size_t>(ev) / 64].load(std::memory_order_relaxed) & (1ull << (static_cast<size_t>(ev) % 64))) != 0;
+	}
+
+	template <addon_event ev, typename... Args>
+	inline std::enable_if_t<addon_event_traits<ev>::type == 1, void> invoke_addon_event(const Args &... args)
+	{
+		// Only register as a reader when there are any callbacks, then load the list again, since it may have been replaced and freed before that
+		if (addon::event_list[static_cast<size_t>(ev)].load(std::memory_order_relaxed) != nullptr)
+		{
+			const addon::event_list_reader reader;
+
+			if (const std::vector<addon::event_callback> *const event_list = addon::event_list[static_cast<size_t>(ev)].load(std::memory_order_acquire); event_list != nullptr)
+			{
+				for (size_t cb = 0, count = event_list->size(); cb < count; ++cb) // Generates better code than ranged-based for loop
+				{
+					const addon::event_callback &callback = (*event_list)[cb];
+					if (callback.filter != nullptr && !addon::matches_filter(*callback.filter, args...))
+						continue;
+
+					const addon::callback_timer timer(callback.stats);
+					reinterpret_cast<typename reshade::addon_event_traits<ev>::decl>(callback.func)(args...);
+				}
+			}
+		}
+
+		if constexpr (addon::command_recorder<ev>::enabled)
+			if (has_addon_event<addon_event::execute_command_stream>())
+				addon::command_recorder<ev>::record(args...);
+
+		// Present is called regularly, so use it to free event lists that were replaced in the meantime
+		if constexpr (ev == addon_event::present)
+			if (addon::has_retired_event_lists.load(std::memory_order_relaxed))
+				addon::reclaim_event_lists();
+	}
+	template <addon_event ev, typename... Args>
+	inline std::enable_if_t<addon_event_traits<ev>::type == 2, bool> invoke_addon_event(const Args &... args)
+	{
+		if (addon::event_list[static_cast<size_t>(ev)].load(std::memory_order_relaxed) != nullptr)
+		{
+			const addon::event_list_reader reader;
+
+			if (const std::vector<addon::event_callback> *const event_list = addon::event_list[static_cast<size_t>(ev)].load(std::memory_order_acquire); event_list != nullptr)
+			{
+				for (size_t cb = 0, count = event_list->size(); cb < count; ++cb)
+				{
+					const addon::event_callback &callback = (*event_list)[cb];
+					if (callback.filter != nullptr && !addon::matches_filter(*callback.filter, args...))
+						continue;
+
+					const addon::callback_timer timer(callback.stats);
+					if (reinterpret_cast<typename reshade::addon_event_traits<ev>::decl>(callback.func)(args...))
+						return true;
+				}
+			}
+		}
+
+		// Only record commands that are actually executed
+		if constexpr (addon::command_recorder<ev>::enabled)
+			if (has_addon_event<addon_event::execute_command_stream>())
+				addon::command_recorder<ev>::record(args...);
+		return false;
+	}
 }
 
 #endif
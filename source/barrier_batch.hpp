@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include "reshade_api.hpp"
+#include <vector>
+
+namespace reshade
+{
+	/// <summary>
+	/// Collects resource barriers until the next command that depends on them, so that they can be submitted in a single batch.
+	/// Transitions of a resource that follow each other without any command in between are combined, so that one which is reverted right away cancels out entirely.
+	/// </summary>
+	class barrier_batch
+	{
+	public:
+		void add(uint32_t count, const api::resource *barrier_resources, const api::resource_usage *barrier_old_states, const api::resource_usage *barrier_new_states)
+		{
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				// Barriers between the same states (e.g. between two unordered access passes) synchronize memory accesses and therefore are never combined
+				if (barrier_old_states[i] != barrier_new_states[i])
+				{
+					size_t k = resources.size();
+					while (k != 0 && resources[k - 1] != barrier_resources[i])
+						--k;
+
+					if (k != 0 && old_states[k - 1] != new_states[k - 1] && new_states[k - 1] == barrier_old_states[i])
+					{
+						if (old_states[k - 1] == barrier_new_states[i])
+						{
+							// A transition from A to B followed by one from B back to A is a no-op
+							resources.erase(resources.begin() + (k - 1));
+							old_states.erase(old_states.begin() + (k - 1));
+							new_states.erase(new_states.begin() + (k - 1));
+						}
+						else
+						{
+							// A transition from A to B followed by one from B to C is the same as a single one from A to C
+							new_states[k - 1] = barrier_new_states[i];
+						}
+						continue;
+					}
+				}
+
+				resources.push_back(barrier_resources[i]);
+				old_states.push_back(barrier_old_states[i]);
+				new_states.push_back(barrier_new_states[i]);
+			}
+		}
+
+		bool empty() const { return resources.empty(); }
+		uint32_t size() const { return static_cast<uint32_t>(resources.size()); }
+
+		void clear()
+		{
+			resources.clear();
+			old_states.clear();
+			new_states.clear();
+		}
+
+		std::vector<api::resource> resources;
+		std::vector<api::resource_usage> old_states;
+		std::vector<api::resource_usage> new_states;
+	};
+}
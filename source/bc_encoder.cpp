@@ -0,0 +1,301 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "bc_encoder.hpp"
+#include <cmath>
+#include <cfloat>
+#include <climits>
+#include <cstring>
+#include <algorithm>
+
+namespace
+{
+	using texel_block = uint8_t[16][4];
+
+	// Interpolation weights for 4-bit indices (see https://docs.microsoft.com/windows/win32/direct3d11/bc7-format)
+	constexpr int bc7_weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	void fetch_block(const uint8_t *data, uint32_t width, uint32_t height, uint32_t block_x, uint32_t block_y, texel_block &texels)
+	{
+		// Partial blocks at the right and bottom edge repeat the last column and row of the image
+		for (uint32_t y = 0; y < 4; ++y)
+			for (uint32_t x = 0; x < 4; ++x)
+				std::memcpy(texels[y * 4 + x], data + (static_cast<size_t>(std::min(block_y * 4 + y, height - 1)) * width + std::min(block_x * 4 + x, width - 1)) * 4, 4);
+	}
+
+	void encode_bc4_block(const texel_block &texels, uint32_t channel, uint8_t *out)
+	{
+		int min_value = 255, max_value = 0;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			min_value = std::min<int>(min_value, texels[i][channel]);
+			max_value = std::max<int>(max_value, texels[i][channel]);
+		}
+
+		// Use the mode with six interpolated values (instead of four plus zero and one), which is selected by the first endpoint being larger than the second
+		// If both are the same, all indices end up zero below, so it does not matter that the decoder picks the other mode then
+		int palette[8] = { max_value, min_value };
+		for (int i = 1; i < 7; ++i)
+			palette[i + 1] = ((7 - i) * max_value + i * min_value + 3) / 7;
+
+		uint64_t indices = 0;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			uint32_t best_index = 0;
+			int best_error = INT_MAX;
+			for (uint32_t k = 0; k < 8; ++k)
+			{
+				if (const int error = std::abs(palette[k] - texels[i][channel]); error < best_error)
+				{
+					best_index = k;
+					best_error = error;
+				}
+			}
+
+			indices |= static_cast<uint64_t>(best_index) << (3 * i);
+		}
+
+		out[0] = static_cast<uint8_t>(max_value);
+		out[1] = static_cast<uint8_t>(min_value);
+		for (uint32_t i = 0; i < 6; ++i)
+			out[2 + i] = static_cast<uint8_t>(indices >> (8 * i));
+	}
+
+	void encode_bc7_block(const texel_block &texels, uint8_t *out)
+	{
+		// Always use mode 6, which has a single subset with 7-bit RGBA endpoints plus a unique p-bit each and 4-bit indices
+		// This does not handle blocks with very different colors as well as the partitioned modes, but works well for the smooth images textures are usually loaded from (noise, dirt, lookup tables)
+		float mean[4] = {};
+		for (uint32_t i = 0; i < 16; ++i)
+			for (uint32_t c = 0; c < 4; ++c)
+				mean[c] += texels[i][c] / 16.0f;
+
+		float covariance[4][4] = {};
+		for (uint32_t i = 0; i < 16; ++i)
+			for (uint32_t r = 0; r < 4; ++r)
+				for (uint32_t c = 0; c < 4; ++c)
+					covariance[r][c] += (texels[i][r] - mean[r]) * (texels[i][c] - mean[c]);
+
+		// Find the principal axis of the colors in the block with a few power iterations, which is the line the endpoints are placed on
+		float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		for (uint32_t iteration = 0; iteration < 8; ++iteration)
+		{
+			float next_axis[4] = {};
+			for (uint32_t r = 0; r < 4; ++r)
+				for (uint32_t c = 0; c < 4; ++c)
+					next_axis[r] += covariance[r][c] * axis[c];
+
+			const float length = std::sqrt(next_axis[0] * next_axis[0] + next_axis[1] * next_axis[1] + next_axis[2] * next_axis[2] + next_axis[3] * next_axis[3]);
+			if (length < FLT_EPSILON)
+				break; // All texels have the same color, so any axis works
+
+			for (uint32_t c = 0; c < 4; ++c)
+				axis[c] = next_axis[c] / length;
+		}
+
+		float min_t = FLT_MAX, max_t = -FLT_MAX;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			float t = 0.0f;
+			for (uint32_t c = 0; c < 4; ++c)
+				t += (texels[i][c] - mean[c]) * axis[c];
+			min_t = std::min(min_t, t);
+			max_t = std::max(max_t, t);
+		}
+
+		// Quantize both endpoints to 7 bits per channel, choosing the p-bit (which is shared by all channels of an endpoint) that gets them closest to the exact values
+		int endpoints[2][4];
+		uint32_t endpoints_quantized[2][4];
+		uint32_t p_bits[2];
+		for (uint32_t e = 0; e < 2; ++e)
+		{
+			const float t = (e == 0) ? min_t : max_t;
+
+			float best_error = FLT_MAX;
+			for (uint32_t p = 0; p < 2; ++p)
+			{
+				float error = 0.0f;
+				uint32_t quantized[4];
+				for (uint32_t c = 0; c < 4; ++c)
+				{
+					const float value = std::clamp(mean[c] + t * axis[c], 0.0f, 255.0f);
+					quantized[c] = static_cast<uint32_t>(std::clamp(static_cast<int>((value - p) / 2.0f + 0.5f), 0, 127));
+					const float decoded = static_cast<float>((quantized[c] << 1) | p);
+					error += (decoded - value) * (decoded - value);
+				}
+
+				if (error < best_error)
+				{
+					best_error = error;
+					p_bits[e] = p;
+					for (uint32_t c = 0; c < 4; ++c)
+						endpoints_quantized[e][c] = quantized[c];
+				}
+			}
+
+			for (uint32_t c = 0; c < 4; ++c)
+				endpoints[e][c] = static_cast<int>((endpoints_quantized[e][c] << 1) | p_bits[e]);
+		}
+
+		int palette[16][4];
+		for (uint32_t k = 0; k < 16; ++k)
+			for (uint32_t c = 0; c < 4; ++c)
+				palette[k][c] = ((64 - bc7_weights[k]) * endpoints[0][c] + bc7_weights[k] * endpoints[1][c] + 32) >> 6;
+
+		uint32_t indices[16];
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			indices[i] = 0;
+			int best_error = INT_MAX;
+			for (uint32_t k = 0; k < 16; ++k)
+			{
+				int error = 0;
+				for (uint32_t c = 0; c < 4; ++c)
+					error += (palette[k][c] - texels[i][c]) * (palette[k][c] - texels[i][c]);
+
+				if (error < best_error)
+				{
+					indices[i] = k;
+					best_error = error;
+				}
+			}
+		}
+
+		// The most significant bit of the index of the first texel is not stored and implied to be zero, so swap the endpoints if it is set (the weights are symmetric, so this just inverts all indices)
+		if (indices[0] >= 8)
+		{
+			std::swap(endpoints_quantized[0], endpoints_quantized[1]);
+			std::swap(p_bits[0], p_bits[1]);
+			for (uint32_t i = 0; i < 16; ++i)
+				indices[i] = 15 - indices[i];
+		}
+
+		uint64_t bits[2] = {};
+		uint32_t bit_offset = 0;
+		const auto write_bits = [&bits, &bit_offset](uint32_t value, uint32_t count) {
+			for (uint32_t i = 0; i < count; ++i, ++bit_offset)
+				bits[bit_offset / 64] |= static_cast<uint64_t>((value >> i) & 1) << (bit_offset % 64);
+		};
+
+		write_bits(1 << 6, 7); // Mode 6 is selected by six zero bits followed by a one
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			write_bits(endpoints_quantized[0][c], 7);
+			write_bits(endpoints_quantized[1][c], 7);
+		}
+		write_bits(p_bits[0], 1);
+		write_bits(p_bits[1], 1);
+		for (uint32_t i = 0; i < 16; ++i)
+			write_bits(indices[i], i == 0 ? 3 : 4);
+
+		std::memcpy(out, bits, 16);
+	}
+
+	void downsample(const uint8_t *data, uint32_t width, uint32_t height, std::vector<uint8_t> &out)
+	{
+		const uint32_t out_width = std::max(1u, width / 2);
+		const uint32_t out_height = std::max(1u, height / 2);
+
+		out.resize(static_cast<size_t>(out_width) * out_height * 4);
+
+		// Average each 2x2 quad of texels (which falls back to repeating the last row or column for images with an odd size in that dimension)
+		for (uint32_t y = 0; y < out_height; ++y)
+		{
+			const uint32_t y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+
+			for (uint32_t x = 0; x < out_width; ++x)
+			{
+				const uint32_t x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+
+				for (uint32_t c = 0; c < 4; ++c)
+					out[(static_cast<size_t>(y) * out_width + x) * 4 + c] = static_cast<uint8_t>((
+						data[(static_cast<size_t>(y0) * width + x0) * 4 + c] +
+						data[(static_cast<size_t>(y0) * width + x1) * 4 + c] +
+						data[(static_cast<size_t>(y1) * width + x0) * 4 + c] +
+						data[(static_cast<size_t>(y1) * width + x1) * 4 + c] + 2) / 4);
+			}
+		}
+	}
+}
+
+bool reshade::encode_bc_dds(const uint8_t *data, uint32_t width, uint32_t height, uint32_t levels, api::format format, std::vector<uint8_t> &out)
+{
+	if (data == nullptr || width == 0 || height == 0 || levels == 0 ||
+		(format != api::format::bc4_unorm && format != api::format::bc5_unorm && format != api::format::bc7_unorm))
+		return false;
+
+	const uint32_t block_size = (format == api::format::bc4_unorm) ? 8 : 16;
+
+	size_t total_size = 0;
+	for (uint32_t level = 0; level < levels; ++level)
+		total_size += static_cast<size_t>((std::max(1u, width >> level) + 3) / 4) * ((std::max(1u, height >> level) + 3) / 4) * block_size;
+
+	out.clear();
+	out.resize(148 + total_size);
+
+	uint8_t *const header = out.data();
+	const auto write_uint = [header](size_t offset, uint32_t value) { std::memcpy(header + offset, &value, sizeof(value)); };
+
+	// See https://docs.microsoft.com/windows/win32/direct3ddds/dds-header
+	std::memcpy(header, "DDS ", 4);
+	write_uint(4 + 0, 124);
+	write_uint(4 + 4, 0x1 /* DDSD_CAPS */ | 0x2 /* DDSD_HEIGHT */ | 0x4 /* DDSD_WIDTH */ | 0x1000 /* DDSD_PIXELFORMAT */ | 0x20000 /* DDSD_MIPMAPCOUNT */ | 0x80000 /* DDSD_LINEARSIZE */);
+	write_uint(4 + 8, height);
+	write_uint(4 + 12, width);
+	write_uint(4 + 16, ((width + 3) / 4) * ((height + 3) / 4) * block_size);
+	write_uint(4 + 24, levels);
+	write_uint(4 + 72, 32);
+	write_uint(4 + 76, 0x4 /* DDPF_FOURCC */);
+	std::memcpy(header + 4 + 80, "DX10", 4);
+	write_uint(4 + 104, 0x1000 /* DDSCAPS_TEXTURE */ | (levels > 1 ? 0x8 /* DDSCAPS_COMPLEX */ | 0x400000 /* DDSCAPS_MIPMAP */ : 0));
+
+	// See https://docs.microsoft.com/windows/win32/direct3ddds/dds-header-dxt10
+	write_uint(128 + 0, static_cast<uint32_t>(format)); // Formats share their values with 'DXGI_FORMAT'
+	write_uint(128 + 4, 3 /* D3D10_RESOURCE_DIMENSION_TEXTURE2D */);
+	write_uint(128 + 12, 1);
+
+	uint8_t *blocks = out.data() + 148;
+
+	std::vector<uint8_t> level_data[2];
+	const uint8_t *level_pixels = data;
+
+	for (uint32_t level = 0; level < levels; ++level)
+	{
+		if (level != 0)
+		{
+			std::vector<uint8_t> &next_level_data = level_data[level % 2];
+			downsample(level_pixels, width, height, next_level_data);
+			level_pixels = next_level_data.data();
+
+			width = std::max(1u, width / 2);
+			height = std::max(1u, height / 2);
+		}
+
+		for (uint32_t block_y = 0; block_y < (height + 3) / 4; ++block_y)
+		{
+			for (uint32_t block_x = 0; block_x < (width + 3) / 4; ++block_x, blocks += block_size)
+			{
+				texel_block texels;
+				fetch_block(level_pixels, width, height, block_x, block_y, texels);
+
+				switch (format)
+				{
+				case api::format::bc4_unorm:
+					encode_bc4_block(texels, 0, blocks);
+					break;
+				case api::format::bc5_unorm:
+					encode_bc4_block(texels, 0, blocks);
+					encode_bc4_block(texels, 1, blocks + 8);
+					break;
+				default:
+					encode_bc7_block(texels, blocks);
+					break;
+				}
+			}
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,25 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include "reshade_api_format.hpp"
+#include <vector>
+
+namespace reshade
+{
+	/// <summary>
+	/// Encodes a 32bpp RGBA image and a chain of mipmaps generated from it in a block compressed format as a DDS file.
+	/// Each block is encoded with a single fast pass (without searching through partitions or modes), since this is meant to run in the background while effects are loading.
+	/// </summary>
+	/// <param name="data">The image data, with rows tightly packed.</param>
+	/// <param name="width">The width of the image.</param>
+	/// <param name="height">The height of the image.</param>
+	/// <param name="levels">The number of mipmap levels to write, including the image itself.</param>
+	/// <param name="format">The block compressed format to encode to, which is either <see cref="api::format::bc4_unorm"/> (only the red channel), <see cref="api::format::bc5_unorm"/> (red and green channel) or <see cref="api::format::bc7_unorm"/>.</param>
+	/// <param name="out">The buffer the DDS file is written to.</param>
+	/// <returns><see langword="true"/> if the image was encoded successfully, <see langword="false"/> otherwise.</returns>
+	bool encode_bc_dds(const uint8_t *data, uint32_t width, uint32_t height, uint32_t levels, api::format format, std::vector<uint8_t> &out);
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "benchmark.hpp"
+#include "dll_log.hpp"
+#include <fstream>
+#include <iterator>
+
+static void write_json_string(std::ofstream &file, const std::string &value)
+{
+	file << '\"';
+	for (const char c : value)
+	{
+		if (c == '\"' || c == '\\')
+			file << '\\' << c;
+		else if (static_cast<unsigned char>(c) >= 0x20)
+			file << c;
+	}
+	file << '\"';
+}
+
+bool reshade::benchmark_report::write(const std::filesystem::path &path) const
+{
+	std::ofstream file(path, std::ios::trunc);
+	if (!file)
+	{
+		LOG(ERROR) << "Failed to open " << path << " for writing benchmark report!";
+		return false;
+	}
+
+	// All durations are written in milliseconds, which is what people compare them in
+	const auto write_percentiles = [&file](const uint64_t (&values)[4]) {
+		file << "{\"p50\":" << (values[0] * 1e-6) << ",\"p95\":" << (values[1] * 1e-6) << ",\"p99\":" << (values[2] * 1e-6) << ",\"max\":" << (values[3] * 1e-6) << '}';
+	};
+
+	file << "{\n";
+	file << "\"renderer\":" << renderer_id << ",\n";
+	file << "\"width\":" << width << ",\n";
+	file << "\"height\":" << height << ",\n";
+	file << "\"frames\":" << num_frames << ",\n";
+	file << "\"reload_ms\":" << (reload_duration_ns * 1e-6) << ",\n";
+	file << "\"frame_time_ms\":";
+	write_percentiles(frame_time_percentiles_ns);
+	file << ",\n";
+	file << "\"peak_video_memory_bytes\":" << peak_video_memory_usage << ",\n";
+	file << "\"techniques\":[";
+
+	for (size_t i = 0; i < techniques.size(); ++i)
+	{
+		const benchmark_technique_result &tech = techniques[i];
+
+		file << (i != 0 ? ",\n" : "\n") << "{\"name\":";
+		write_json_string(file, tech.name);
+		file << ",\"effect\":";
+		write_json_string(file, tech.effect_name);
+		file << ",\"cpu_ms\":" << (tech.average_cpu_duration_ns * 1e-6);
+		file << ",\"gpu_ms\":" << (tech.average_gpu_duration_ns * 1e-6);
+		file << ",\"gpu_percentiles_ms\":";
+		write_percentiles(tech.gpu_duration_percentiles_ns);
+		file << ",\"pixel_invocations\":" << tech.pixel_invocations;
+		file << ",\"compute_invocations\":" << tech.compute_invocations << '}';
+	}
+
+	file << "\n],\n";
+	file << "\"hook_calls\":[";
+
+	// Only the time spent in the hook itself is measured (e.g. invoking add-on events), not the time spent in the driver
+	for (size_t i = 0; i < calls.size(); ++i)
+	{
+		const benchmark_call_result &call = calls[i];
+
+		file << (i != 0 ? ",\n" : "\n") << "{\"name\":";
+		write_json_string(file, call.name);
+		file << ",\"calls\":" << call.count;
+		file << ",\"ns_per_call\":" << (static_cast<double>(call.duration_ns) / call.count) << '}';
+	}
+
+	file << "\n],\n";
+	file << "\"loads\":[";
+
+	static const char *const phase_names[] = { "preprocess", "parse", "codegen", "compile", "pipelines", "setup", "textures" };
+	static_assert(std::size(phase_names) == static_cast<size_t>(benchmark_load_phase::count));
+
+	for (size_t i = 0; i < loads.size(); ++i)
+	{
+		const benchmark_load_result &load = loads[i];
+
+		file << (i != 0 ? ",\n" : "\n") << "{\"cache\":" << (load.cold_cache ? "\"cold\"" : "\"warm\"");
+		file << ",\"total_ms\":" << (load.duration_ns * 1e-6);
+		for (size_t phase = 0; phase < std::size(phase_names); ++phase)
+			file << ",\"" << phase_names[phase] << "_ms\":" << (load.phase_durations_ns[phase] * 1e-6);
+		file << '}';
+	}
+
+	file << "\n]\n}\n";
+
+	return file.good();
+}
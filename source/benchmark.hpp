@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+
+namespace reshade
+{
+	/// <summary>
+	/// Measurements of a single technique over all frames of a benchmark run.
+	/// </summary>
+	struct benchmark_technique_result
+	{
+		std::string name;
+		std::string effect_name;
+		uint64_t average_cpu_duration_ns;
+		// Timestamp queries are only resolved a few frames later, so this averages the most recent measurement available in every frame
+		uint64_t average_gpu_duration_ns;
+		// 50th, 95th and 99th percentile and maximum of the GPU duration over the last frames
+		uint64_t gpu_duration_percentiles_ns[4];
+		// Average pipeline statistics, which are zero on APIs that do not support them
+		uint64_t pixel_invocations;
+		uint64_t compute_invocations;
+	};
+
+	/// <summary>
+	/// Phases of loading effects that are timed separately during a benchmark run.
+	/// </summary>
+	enum class benchmark_load_phase
+	{
+		preprocess,
+		parse,
+		codegen,
+		compile,
+		pipelines,
+		setup,
+		textures,
+		count
+	};
+
+	/// <summary>
+	/// Measurements of a single reload of all effects during a benchmark run.
+	/// </summary>
+	struct benchmark_load_result
+	{
+		// Whether the effect cache was cleared before this reload
+		bool cold_cache;
+		// Time from the start of the reload until all effects could render again
+		uint64_t duration_ns;
+		// Time spent in each phase, summed over all threads (so these can add up to more than the total when effects are loaded in parallel)
+		uint64_t phase_durations_ns[static_cast<size_t>(benchmark_load_phase::count)];
+	};
+
+	/// <summary>
+	/// Number and total duration of the calls through a hook over all frames of a benchmark run (only measured when built with 'RESHADE_PROFILING').
+	/// </summary>
+	struct benchmark_call_result
+	{
+		std::string name;
+		uint64_t count;
+		uint64_t duration_ns;
+	};
+
+	/// <summary>
+	/// Results of a benchmark run, which renders a fixed number of frames once all effects finished loading and then writes them into a JSON file, so that they can be compared between builds (e.g. in continuous integration).
+	/// </summary>
+	struct benchmark_report
+	{
+		uint32_t renderer_id;
+		uint32_t width;
+		uint32_t height;
+		uint32_t num_frames;
+		// Time it took to load all effects, from the start of the last reload until it finished
+		uint64_t reload_duration_ns;
+		// 50th, 95th and 99th percentile and maximum of the present-to-present time over the last frames
+		uint64_t frame_time_percentiles_ns[4];
+		// Highest video memory usage reported by the device during the run, zero if not supported
+		uint64_t peak_video_memory_usage;
+		std::vector<benchmark_technique_result> techniques;
+		std::vector<benchmark_call_result> calls;
+		std::vector<benchmark_load_result> loads;
+
+		bool write(const std::filesystem::path &path) const;
+	};
+}
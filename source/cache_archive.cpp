@@ -0,0 +1,304 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "dll_log.hpp"
+#include "cache_archive.hpp"
+#include <chrono>
+#include <algorithm>
+#include <Windows.h>
+
+static constexpr uint32_t ARCHIVE_MAGIC = 0x43465352; // 'RSFC'
+static constexpr uint32_t ARCHIVE_VERSION = 1;
+
+static uint64_t current_time()
+{
+	return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+reshade::cache_archive::cache_archive(const std::filesystem::path &path, uint64_t size_limit) :
+	_path(path), _size_limit(size_limit)
+{
+	map();
+}
+reshade::cache_archive::~cache_archive()
+{
+	unmap();
+}
+
+bool reshade::cache_archive::get(uint64_t key, std::vector<char> &data)
+{
+	const std::lock_guard<std::mutex> lock(_mutex);
+
+	size_t size = 0;
+	const char *const blob = lookup(key, size);
+	if (blob == nullptr)
+		return false;
+
+	data.assign(blob, blob + size);
+	return true;
+}
+bool reshade::cache_archive::get(uint64_t key, std::string &data)
+{
+	const std::lock_guard<std::mutex> lock(_mutex);
+
+	size_t size = 0;
+	const char *const blob = lookup(key, size);
+	if (blob == nullptr)
+		return false;
+
+	data.assign(blob, size);
+	return true;
+}
+void reshade::cache_archive::put(uint64_t key, const void *data, size_t size)
+{
+	const std::lock_guard<std::mutex> lock(_mutex);
+
+	_new_entries[key].assign(static_cast<const char *>(data), static_cast<const char *>(data) + size);
+	_dirty = true;
+}
+
+bool reshade::cache_archive::flush()
+{
+	const std::lock_guard<std::mutex> lock(_mutex);
+
+	if (!_dirty)
+		return true;
+
+	// Hold an exclusive lock on a separate file while writing, since the archive itself is replaced and therefore cannot be locked (closing the handle releases the lock again)
+	std::filesystem::path lock_path = _path;
+	lock_path += L".lock";
+
+	const HANDLE lock_file = CreateFileW(lock_path.c_str(), FILE_GENERIC_READ | FILE_GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_HIDDEN, nullptr);
+	if (lock_file == INVALID_HANDLE_VALUE)
+	{
+		LOG(ERROR) << "Failed to open effect cache lock file " << lock_path << " with error code " << GetLastError() << '!';
+		return false;
+	}
+
+	OVERLAPPED lock_range = {};
+	if (!LockFileEx(lock_file, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &lock_range))
+	{
+		LOG(ERROR) << "Failed to lock effect cache file " << _path << " with error code " << GetLastError() << '!';
+		CloseHandle(lock_file);
+		return false;
+	}
+
+	// Another process may have replaced the archive since it was mapped, so map it again to merge with its entries instead of discarding them
+	unmap();
+	map();
+
+	const bool result = write();
+
+	UnlockFileEx(lock_file, 0, 1, 0, &lock_range);
+	CloseHandle(lock_file);
+
+	return result;
+}
+void reshade::cache_archive::clear()
+{
+	const std::lock_guard<std::mutex> lock(_mutex);
+
+	unmap();
+
+	DeleteFileW(_path.c_str());
+
+	_new_entries.clear();
+	_accessed_entries.clear();
+	_dirty = false;
+}
+
+bool reshade::cache_archive::write()
+{
+	// Gather all entries that should be written to the new archive, with those added in this session taking precedence
+	std::vector<std::pair<entry, const char *>> entries;
+	entries.reserve(_new_entries.size());
+
+	const uint64_t now = current_time();
+
+	for (const auto &[key, data] : _new_entries)
+		entries.push_back({ { key, 0, data.size(), now }, data.data() });
+
+	if (_view_base != nullptr)
+	{
+		const header &head = *reinterpret_cast<const header *>(_view_base);
+		const entry *const mapped_entries = reinterpret_cast<const entry *>(_view_base + sizeof(header));
+
+		for (uint64_t i = 0; i < head.num_entries; ++i)
+		{
+			entry e = mapped_entries[i];
+			if (_new_entries.find(e.key) != _new_entries.end())
+				continue;
+
+			if (const auto it = _accessed_entries.find(e.key); it != _accessed_entries.end())
+				e.last_used = it->second;
+
+			entries.push_back({ e, _view_base + e.offset });
+		}
+	}
+
+	// Evict least recently used entries until the archive fits into the size limit again
+	std::sort(entries.begin(), entries.end(),
+		[](const auto &lhs, const auto &rhs) { return lhs.first.last_used > rhs.first.last_used; });
+
+	uint64_t total_size = 0;
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		if (total_size + entries[i].first.size > _size_limit)
+		{
+			entries.resize(i);
+			break;
+		}
+
+		total_size += entries[i].first.size;
+	}
+
+	// Sort index by key, so that look ups can use a binary search on the mapped file
+	std::sort(entries.begin(), entries.end(),
+		[](const auto &lhs, const auto &rhs) { return lhs.first.key < rhs.first.key; });
+
+	uint64_t offset = sizeof(header) + entries.size() * sizeof(entry);
+	for (auto &[e, data] : entries)
+	{
+		e.offset = offset;
+		offset += e.size;
+	}
+
+	// Write to a temporary file first and then replace the archive with it, so that it is never left in a partially written state
+	std::filesystem::path temp_path = _path;
+	temp_path += L".tmp";
+
+	const HANDLE file = CreateFileW(temp_path.c_str(), FILE_GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_ARCHIVE | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		LOG(ERROR) << "Failed to open effect cache file " << temp_path << " for writing!";
+		return false;
+	}
+
+	const header head = { ARCHIVE_MAGIC, ARCHIVE_VERSION, entries.size() };
+
+	bool success = true;
+	DWORD size = 0;
+	success &= WriteFile(file, &head, sizeof(head), &size, nullptr) != FALSE;
+	for (const auto &[e, data] : entries)
+		success &= WriteFile(file, &e, sizeof(e), &size, nullptr) != FALSE;
+	for (const auto &[e, data] : entries)
+		success &= WriteFile(file, data, static_cast<DWORD>(e.size), &size, nullptr) != FALSE;
+	success &= FlushFileBuffers(file) != FALSE;
+
+	CloseHandle(file);
+
+	if (!success)
+	{
+		LOG(ERROR) << "Failed to write effect cache file " << temp_path << '!';
+		DeleteFileW(temp_path.c_str());
+		return false;
+	}
+
+	// Entries reference the mapped archive, so can only unmap it after everything was written
+	entries.clear();
+	unmap();
+
+	const bool replaced = MoveFileExW(temp_path.c_str(), _path.c_str(), MOVEFILE_REPLACE_EXISTING) != FALSE;
+	if (!replaced)
+	{
+		LOG(ERROR) << "Failed to replace effect cache file " << _path << " with error code " << GetLastError() << '!';
+		DeleteFileW(temp_path.c_str());
+	}
+
+	map();
+
+	// Keep entries around in memory if the archive could not be replaced, so that they do not get lost
+	if (replaced)
+	{
+		_new_entries.clear();
+		_accessed_entries.clear();
+		_dirty = false;
+	}
+
+	return replaced;
+}
+
+bool reshade::cache_archive::map()
+{
+	const HANDLE file = CreateFileW(_path.c_str(), FILE_GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER file_size = {};
+	GetFileSizeEx(file, &file_size);
+
+	if (static_cast<uint64_t>(file_size.QuadPart) >= sizeof(header))
+		_file_mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	// The mapping keeps a reference to the file, so can close the file handle right away
+	CloseHandle(file);
+
+	if (_file_mapping == nullptr)
+		return false;
+
+	_view_base = static_cast<const char *>(MapViewOfFile(_file_mapping, FILE_MAP_READ, 0, 0, 0));
+	_view_size = static_cast<size_t>(file_size.QuadPart);
+
+	// Verify that the index is intact and matches the file size before using it
+	if (_view_base != nullptr)
+	{
+		const header &head = *reinterpret_cast<const header *>(_view_base);
+		const entry *const mapped_entries = reinterpret_cast<const entry *>(_view_base + sizeof(header));
+
+		bool valid = head.magic == ARCHIVE_MAGIC && head.version == ARCHIVE_VERSION &&
+			head.num_entries <= (_view_size - sizeof(header)) / sizeof(entry);
+		for (uint64_t i = 0; valid && i < head.num_entries; ++i)
+			valid = mapped_entries[i].offset <= _view_size && mapped_entries[i].size <= _view_size - mapped_entries[i].offset;
+
+		if (valid)
+			return true;
+
+		LOG(WARN) << "Ignoring invalid effect cache file " << _path << '.';
+		_dirty = true; // Overwrite invalid file on next flush
+	}
+
+	unmap();
+	return false;
+}
+void reshade::cache_archive::unmap()
+{
+	if (_view_base != nullptr)
+		UnmapViewOfFile(_view_base);
+	_view_base = nullptr;
+	_view_size = 0;
+
+	if (_file_mapping != nullptr)
+		CloseHandle(_file_mapping);
+	_file_mapping = nullptr;
+}
+
+const char *reshade::cache_archive::lookup(uint64_t key, size_t &size)
+{
+	if (const auto it = _new_entries.find(key); it != _new_entries.end())
+	{
+		size = it->second.size();
+		return it->second.data();
+	}
+
+	if (_view_base == nullptr)
+		return nullptr;
+
+	const header &head = *reinterpret_cast<const header *>(_view_base);
+	const entry *const mapped_entries = reinterpret_cast<const entry *>(_view_base + sizeof(header));
+
+	const entry *const it = std::lower_bound(mapped_entries, mapped_entries + head.num_entries, key,
+		[](const entry &e, uint64_t key) { return e.key < key; });
+	if (it == mapped_entries + head.num_entries || it->key != key)
+		return nullptr;
+
+	// Only need to rewrite the archive for updated access times once a day, to avoid writing it on every launch
+	const uint64_t now = current_time();
+	if (now - it->last_used > 24 * 60 * 60)
+		_dirty = true;
+	_accessed_entries[key] = now;
+
+	size = static_cast<size_t>(it->size);
+	return _view_base + it->offset;
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <unordered_map>
+
+namespace reshade
+{
+	/// <summary>
+	/// A single file archive of binary blobs that are addressed by a hash of whatever input produced them.
+	/// The archive is memory-mapped and starts with an index sorted by key, so look ups do not require any file operations.
+	/// Entries added during a session are kept in memory until <see cref="flush"/> writes a new archive and atomically replaces the old one.
+	/// Multiple processes may use the same archive file, since writing it is serialized through a lock file and merges with the entries other processes wrote in the meantime.
+	/// </summary>
+	class cache_archive
+	{
+	public:
+		/// <summary>
+		/// Opens the archive at the specified <paramref name="path"/> (if it exists).
+		/// </summary>
+		/// <param name="path">The path to the archive file.</param>
+		/// <param name="size_limit">The maximum size of all blobs in the archive in bytes. The least recently used entries are evicted when writing the archive if this is exceeded.</param>
+		cache_archive(const std::filesystem::path &path, uint64_t size_limit);
+		~cache_archive();
+
+		const std::filesystem::path &path() const { return _path; }
+
+		/// <summary>
+		/// Copies the blob associated with the specified <paramref name="key"/> into <paramref name="data"/>.
+		/// </summary>
+		/// <returns>Returns whether an entry exists for that key.</returns>
+		bool get(uint64_t key, std::vector<char> &data);
+		bool get(uint64_t key, std::string &data);
+		/// <summary>
+		/// Adds or replaces the blob associated with the specified <paramref name="key"/>.
+		/// </summary>
+		void put(uint64_t key, const void *data, size_t size);
+
+		/// <summary>
+		/// Writes all entries to disk if anything changed since the archive was opened or last flushed.
+		/// </summary>
+		bool flush();
+		/// <summary>
+		/// Removes all entries and deletes the archive file.
+		/// </summary>
+		void clear();
+
+	private:
+		struct header
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint64_t num_entries;
+		};
+		struct entry
+		{
+			uint64_t key;
+			uint64_t offset;
+			uint64_t size;
+			uint64_t last_used;
+		};
+
+		bool map();
+		void unmap();
+		bool write();
+		const char *lookup(uint64_t key, size_t &size);
+
+		std::mutex _mutex;
+		std::filesystem::path _path;
+		uint64_t _size_limit;
+		void *_file_mapping = nullptr;
+		const char *_view_base = nullptr;
+		size_t _view_size = 0;
+		// Entries that were added during this session, which are not part of the mapped archive file yet
+		std::unordered_map<uint64_t, std::vector<char>> _new_entries;
+		// Keys of entries in the mapped archive that were accessed during this session (to update their last use time when writing)
+		std::unordered_map<uint64_t, uint64_t> _accessed_entries;
+		bool _dirty = false;
+	};
+}
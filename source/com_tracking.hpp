@@ -5,10 +5,14 @@
 
 #pragma once
 
-#include <mutex>
-#include <unordered_set>
+#include "lockfree_hash_table.hpp"
 #include <Unknwn.h>
 
+/// <summary>
+/// Tracks the lifetime of COM objects, by attaching a private data interface to them that unregisters the object from the list once it is destroyed.
+/// Objects are stored in a lock-free hash table, so that threads creating and destroying resources at the same time do not contend on a lock.
+/// </summary>
+
 template <typename T, bool d3d9_style = false>
 class com_object_list
 {
@@ -57,42 +61,54 @@ public:
 	~com_object_list()
 	{
 		// Destroy all lifetime tracker objects, so that there are none referencing this list after it was destroyed
-		for (auto it = _objects.begin(); it != _objects.end(); it = _objects.begin())
-		{
-			T *const object = *it;
+		// This removes the objects from the table while iterating over it, which is fine, since it is not rehashed in the process
+		_objects.for_each([](T *object, tracker_instance *) {
 			object->SetPrivateData(private_guid, 0, nullptr);
-		}
+		});
 	}
 
 	bool has_object(T *object) const
 	{
-		const std::lock_guard<std::mutex> lock(_mutex);
-		return _objects.find(object) != _objects.end();
+		return _objects.at(object) != nullptr;
 	}
 
 	void register_object(T *object)
 	{
 		assert(object != nullptr);
 
-		const std::lock_guard<std::mutex> lock(_mutex);
-		if (_objects.find(object) == _objects.end())
+		// Two threads registering the same object at the same time may both add it, but the tracker of one then replaces the other, whose release removes the duplicate entry again
+		if (_objects.at(object) == nullptr)
 		{
-			_objects.insert(object);
+			tracker_instance *const tracker = new tracker_instance(object, this);
+			_objects.emplace(object, tracker);
 
-			object->SetPrivateDataInterface(private_guid, new tracker_instance(object, this));
+			object->SetPrivateDataInterface(private_guid, tracker);
 		}
 	}
 	void unregister_object(T *object)
 	{
 		assert(object != nullptr);
 
-		const std::lock_guard<std::mutex> lock(_mutex);
 		_objects.erase(object);
+
+		if (const auto callback = _unregister_callback.load(std::memory_order_acquire); callback != nullptr)
+			callback(_unregister_callback_context, object);
+	}
+
+	/// <summary>
+	/// Sets a function that is called whenever an object is unregistered (e.g. to remove it from a cache).
+	/// This may be called from multiple threads at the same time, so the function has to synchronize access to any data it modifies itself.
+	/// </summary>
+	void set_unregister_callback(void(*callback)(void *context, T *object), void *context)
+	{
+		_unregister_callback_context = context;
+		_unregister_callback.store(callback, std::memory_order_release);
 	}
 
 private:
-	mutable std::mutex _mutex;
-	std::unordered_set<T *> _objects;
+	lockfree_hash_table<T *, tracker_instance *> _objects;
+	std::atomic<void(*)(void *context, T *object)> _unregister_callback = nullptr;
+	void *_unregister_callback_context = nullptr;
 };
 
 template <typename T>
@@ -142,29 +158,26 @@ class com_object_list<T, true>
 public:
 	~com_object_list()
 	{
-		for (auto it = _objects.begin(); it != _objects.end(); it = _objects.begin())
-		{
-			T *const object = *it;
+		_objects.for_each([](T *object, tracker_instance *) {
 			object->SetPrivateData(private_guid, nullptr, 0, 0);
-		}
+		});
 	}
 
 	bool has_object(T *object) const
 	{
-		const std::lock_guard<std::mutex> lock(_mutex);
-		return _objects.find(object) != _objects.end();
+		return _objects.at(object) != nullptr;
 	}
 
 	void register_object(T *object)
 	{
 		assert(object != nullptr);
 
-		const std::lock_guard<std::mutex> lock(_mutex);
-		if (_objects.find(object) == _objects.end())
+		if (_objects.at(object) == nullptr)
 		{
-			_objects.insert(object);
+			tracker_instance *const tracker = new tracker_instance(object, this);
+			_objects.emplace(object, tracker);
 
-			IUnknown *const interface_object = new tracker_instance(object, this);
+			IUnknown *const interface_object = tracker;
 			object->SetPrivateData(private_guid, interface_object, sizeof(interface_object), 0x1 /* D3DSPD_IUNKNOWN */);
 		}
 	}
@@ -172,11 +185,24 @@ public:
 	{
 		assert(object != nullptr);
 
-		const std::lock_guard<std::mutex> lock(_mutex);
 		_objects.erase(object);
+
+		if (const auto callback = _unregister_callback.load(std::memory_order_acquire); callback != nullptr)
+			callback(_unregister_callback_context, object);
+	}
+
+	/// <summary>
+	/// Sets a function that is called whenever an object is unregistered (e.g. to remove it from a cache).
+	/// This may be called from multiple threads at the same time, so the function has to synchronize access to any data it modifies itself.
+	/// </summary>
+	void set_unregister_callback(void(*callback)(void *context, T *object), void *context)
+	{
+		_unregister_callback_context = context;
+		_unregister_callback.store(callback, std::memory_order_release);
 	}
 
 private:
-	mutable std::mutex _mutex;
-	std::unordered_set<T *> _objects;
+	lockfree_hash_table<T *, tracker_instance *> _objects;
+	std::atomic<void(*)(void *context, T *object)> _unregister_callback = nullptr;
+	void *_unregister_callback_context = nullptr;
 };
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <mutex>
+#include <shared_mutex>
+#include <type_traits>
+#include <unordered_map>
+
+/// <summary>
+/// A hash map that is split into multiple shards, each protected by its own reader-writer lock.
+/// Look ups only take a shared lock on a single shard, so threads reading or modifying entries in different shards do not block each other.
+/// </summary>
+template <typename TKey, typename TValue, size_t NUM_SHARDS_LOG2 = 4>
+class concurrent_map
+{
+	static constexpr size_t NUM_SHARDS = size_t(1) << NUM_SHARDS_LOG2;
+
+public:
+	/// <summary>
+	/// Adds the specified key-value pair to the map, unless the key already exists.
+	/// </summary>
+	/// <returns><see langword="true"/> if the pair was added, <see langword="false"/> if the key already existed.</returns>
+	template <typename... Args>
+	bool emplace(TKey key, Args &&... args)
+	{
+		shard &s = shard_of(key);
+		const std::unique_lock<std::shared_mutex> lock(s.mutex);
+		return s.map.try_emplace(key, std::forward<Args>(args)...).second;
+	}
+
+	/// <summary>
+	/// Removes the value associated with the specified <paramref name="key"/> from the map.
+	/// </summary>
+	/// <returns><see langword="true"/> if the key existed and was removed, <see langword="false"/> otherwise.</returns>
+	bool erase(TKey key)
+	{
+		shard &s = shard_of(key);
+		const std::unique_lock<std::shared_mutex> lock(s.mutex);
+		return s.map.erase(key) != 0;
+	}
+
+	/// <summary>
+	/// Checks whether a value is associated with the specified <paramref name="key"/>.
+	/// </summary>
+	bool contains(TKey key) const
+	{
+		const shard &s = shard_of(key);
+		const std::shared_lock<std::shared_mutex> lock(s.mutex);
+		return s.map.find(key) != s.map.end();
+	}
+
+	/// <summary>
+	/// Gets a copy of the value associated with the specified <paramref name="key"/>.
+	/// This throws if the key does not exist, same as <c>std::unordered_map::at</c>.
+	/// </summary>
+	TValue at(TKey key) const
+	{
+		const shard &s = shard_of(key);
+		const std::shared_lock<std::shared_mutex> lock(s.mutex);
+		return s.map.at(key);
+	}
+
+	/// <summary>
+	/// Calls <paramref name="func"/> with a reference to the value associated with the specified <paramref name="key"/>, while holding a shared lock on its shard.
+	/// This avoids copying large values, but the reference must not be used after the function returned.
+	/// </summary>
+	template <typename F>
+	auto read(TKey key, F &&func) const
+	{
+		const shard &s = shard_of(key);
+		const std::shared_lock<std::shared_mutex> lock(s.mutex);
+		return func(s.map.at(key));
+	}
+
+private:
+	// Align shards to cache lines, so that locking one does not cause false sharing with its neighbors
+	struct alignas(64) shard
+	{
+		mutable std::shared_mutex mutex;
+		std::unordered_map<TKey, TValue> map;
+	};
+
+	shard &shard_of(TKey key) { return _shards[index_of(key)]; }
+	const shard &shard_of(TKey key) const { return _shards[index_of(key)]; }
+
+	static size_t index_of(TKey key)
+	{
+		uint64_t value;
+		if constexpr (std::is_pointer_v<TKey>)
+			value = reinterpret_cast<uintptr_t>(key);
+		else
+			value = static_cast<uint64_t>(key);
+
+		// Fibonacci hashing, so that handles which only differ in their low bits still end up in different shards
+		return static_cast<size_t>((value * 0x9E3779B97F4A7C15ull) >> (64 - NUM_SHARDS_LOG2));
+	}
+
+	shard _shards[NUM_SHARDS];
+};
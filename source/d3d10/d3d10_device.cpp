@@ -38,7 +38,7 @@ void D3D10Device::invoke_bind_vertex_buffers_event(UINT first, UINT count, ID3D1
 {
 	assert(count <= D3D10_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT);
 
-	if (reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::bind_vertex_buffers)].empty())
+	if (!reshade::has_addon_event<reshade::addon_event::bind_vertex_buffers>())
 		return;
 
 #ifndef WIN64
@@ -60,7 +60,7 @@ void D3D10Device::invoke_bind_samplers_event(reshade::api::shader_stage stage, U
 {
 	assert(count <= D3D10_COMMONSHADER_SAMPLER_SLOT_COUNT);
 
-	if (reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::push_descriptors)].empty())
+	if (!reshade::has_addon_event<reshade::addon_event::push_descriptors>())
 		return;
 
 #ifndef WIN64
@@ -78,7 +78,7 @@ void D3D10Device::invoke_bind_shader_resource_views_event(reshade::api::shader_s
 {
 	assert(count <= D3D10_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT);
 
-	if (reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::push_descriptors)].empty())
+	if (!reshade::has_addon_event<reshade::addon_event::push_descriptors>())
 		return;
 
 #ifndef WIN64
@@ -96,7 +96,7 @@ void D3D10Device::invoke_bind_constant_buffers_event(reshade::api::shader_stage
 {
 	assert(count <= D3D10_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT);
 
-	if (reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::push_descriptors)].empty())
+	if (!reshade::has_addon_event<reshade::addon_event::push_descriptors>())
 		return;
 
 #ifndef WIN64
@@ -408,7 +408,7 @@ void    STDMETHODCALLTYPE D3D10Device::RSSetViewports(UINT NumViewports, const D
 #if RESHADE_ADDON
 	assert(NumViewports <= D3D10_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE);
 
-	if (reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::bind_viewports)].empty())
+	if (!reshade::has_addon_event<reshade::addon_event::bind_viewports>())
 		return;
 
 	float viewport_data[6 * D3D10_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE];
@@ -961,6 +961,7 @@ HRESULT STDMETHODCALLTYPE D3D10Device::CreateInputLayout(const D3D10_INPUT_ELEME
 	reshade::api::pipeline_desc desc = reshade::d3d10::convert_pipeline_desc(pInputElementDescs, NumElements);
 	desc.graphics.vertex_shader.code = pShaderBytecodeWithInputSignature;
 	desc.graphics.vertex_shader.code_size = BytecodeLength;
+	reshade::addon::compute_shader_hashes(desc);
 
 	if (reshade::api::pipeline replacement = { 0 };
 		reshade::invoke_addon_event<reshade::addon_event::create_pipeline>(this, desc, &replacement))
@@ -996,6 +997,7 @@ HRESULT STDMETHODCALLTYPE D3D10Device::CreateVertexShader(const void *pShaderByt
 	desc.graphics.vertex_shader.code = pShaderBytecode;
 	desc.graphics.vertex_shader.code_size = BytecodeLength;
 	desc.graphics.vertex_shader.format = reshade::api::shader_format::dxbc;
+	reshade::addon::compute_shader_hashes(desc);
 
 	if (reshade::api::pipeline replacement = { 0 };
 		reshade::invoke_addon_event<reshade::addon_event::create_pipeline>(this, desc, &replacement))
@@ -1031,6 +1033,7 @@ HRESULT STDMETHODCALLTYPE D3D10Device::CreateGeometryShader(const void *pShaderB
 	desc.graphics.geometry_shader.code = pShaderBytecode;
 	desc.graphics.geometry_shader.code_size = BytecodeLength;
 	desc.graphics.geometry_shader.format = reshade::api::shader_format::dxbc;
+	reshade::addon::compute_shader_hashes(desc);
 
 	if (reshade::api::pipeline replacement = { 0 };
 		reshade::invoke_addon_event<reshade::addon_event::create_pipeline>(this, desc, &replacement))
@@ -1066,6 +1069,7 @@ HRESULT STDMETHODCALLTYPE D3D10Device::CreateGeometryShaderWithStreamOutput(cons
 	desc.graphics.geometry_shader.code = pShaderBytecode;
 	desc.graphics.geometry_shader.code_size = BytecodeLength;
 	desc.graphics.geometry_shader.format = reshade::api::shader_format::dxbc;
+	reshade::addon::compute_shader_hashes(desc);
 
 	if (reshade::api::pipeline replacement = { 0 };
 		NumEntries == 0 &&
@@ -1102,6 +1106,7 @@ HRESULT STDMETHODCALLTYPE D3D10Device::CreatePixelShader(const void *pShaderByte
 	desc.graphics.pixel_shader.code = pShaderBytecode;
 	desc.graphics.pixel_shader.code_size = BytecodeLength;
 	desc.graphics.pixel_shader.format = reshade::api::shader_format::dxbc;
+	reshade::addon::compute_shader_hashes(desc);
 
 	if (reshade::api::pipeline replacement = { 0 };
 		reshade::invoke_addon_event<reshade::addon_event::create_pipeline>(this, desc, &replacement))
@@ -9,3 +9,37 @@ void reshade::d3d10::device_impl::flush_immediate_command_list() const
 {
 	_orig->Flush();
 }
+
+uint64_t reshade::d3d10::device_impl::get_pending_fence_value()
+{
+	com_ptr<ID3D10Query> query;
+	if (!_free_fence_queries.empty())
+	{
+		query = std::move(_free_fence_queries.back());
+		_free_fence_queries.pop_back();
+	}
+	else
+	{
+		const D3D10_QUERY_DESC desc = { D3D10_QUERY_EVENT };
+		// D3D10 keeps resources alive and synchronizes access to them on its own, so a value that was already reached is still safe to hand out if no query can be created
+		if (FAILED(_orig->CreateQuery(&desc, &query)))
+			return get_completed_fence_value();
+	}
+
+	query->End();
+	_fence_queries.emplace_back(++_fence_value, std::move(query));
+
+	return _fence_value;
+}
+uint64_t reshade::d3d10::device_impl::get_completed_fence_value() const
+{
+	// Event queries complete in the order they were issued, so can stop at the first one that has not yet
+	while (!_fence_queries.empty() && _fence_queries.front().second->GetData(nullptr, 0, D3D10_ASYNC_GETDATA_DONOTFLUSH) == S_OK)
+	{
+		_completed_fence_value = _fence_queries.front().first;
+		_free_fence_queries.push_back(std::move(_fence_queries.front().second));
+		_fence_queries.pop_front();
+	}
+
+	return _completed_fence_value;
+}
@@ -7,7 +7,9 @@
 #include "dll_resources.hpp"
 #include "reshade_api_device.hpp"
 #include "reshade_api_type_convert.hpp"
+#include "resource_ledger.hpp"
 #include <algorithm>
+#include <dxgi1_4.h>
 
 reshade::d3d10::device_impl::device_impl(ID3D10Device1 *device) :
 	api_object_impl(device)
@@ -118,6 +120,30 @@ bool reshade::d3d10::device_impl::check_format_support(api::format format, api::
 	return true;
 }
 
+bool reshade::d3d10::device_impl::get_memory_budget(uint64_t *budget, uint64_t *usage) const
+{
+	// Budget information is only available through 'IDXGIAdapter3', which requires Windows 10
+	com_ptr<IDXGIDevice> dxgi_device;
+	com_ptr<IDXGIAdapter> dxgi_adapter;
+	com_ptr<IDXGIAdapter3> dxgi_adapter3;
+	if (FAILED(_orig->QueryInterface(&dxgi_device)) ||
+		FAILED(dxgi_device->GetAdapter(&dxgi_adapter)) ||
+		FAILED(dxgi_adapter->QueryInterface(&dxgi_adapter3)))
+		return false;
+
+	DXGI_QUERY_VIDEO_MEMORY_INFO info;
+	if (FAILED(dxgi_adapter3->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &info)))
+		return false;
+
+	*budget = info.Budget;
+	*usage = info.CurrentUsage;
+	return true;
+}
+uint64_t reshade::d3d10::device_impl::get_resource_memory_usage(api::resource_memory_owner owner, api::resource_memory_category category) const
+{
+	return resource_ledger::get_usage(this, owner, category);
+}
+
 bool reshade::d3d10::device_impl::is_resource_handle_valid(api::resource handle) const
 {
 	return handle.handle != 0 && _resources.has_object(reinterpret_cast<ID3D10Resource *>(handle.handle));
@@ -146,6 +172,9 @@ bool reshade::d3d10::device_impl::create_sampler(const api::sampler_desc &desc,
 }
 bool reshade::d3d10::device_impl::create_resource(const api::resource_desc &desc, const api::subresource_data *initial_data, api::resource_usage, api::resource *out)
 {
+	// Keep track of how much memory ReShade and add-ons allocate (this also covers all the return paths below)
+	const resource_ledger::create_scope ledger_scope(this, desc, out, _ReturnAddress());
+
 	static_assert(sizeof(api::subresource_data) == sizeof(D3D10_SUBRESOURCE_DATA));
 
 	switch (desc.type)
@@ -580,6 +609,8 @@ void reshade::d3d10::device_impl::destroy_sampler(api::sampler handle)
 }
 void reshade::d3d10::device_impl::destroy_resource(api::resource handle)
 {
+	resource_ledger::unregister_resource(this, handle);
+
 	if (handle.handle != 0)
 		reinterpret_cast<IUnknown *>(handle.handle)->Release();
 }
@@ -891,7 +922,11 @@ bool reshade::d3d10::device_impl::get_query_pool_results(api::query_pool pool, u
 
 	for (UINT i = 0; i < count; ++i)
 	{
-		if (FAILED(impl->queries[i + first]->GetData(static_cast<uint8_t *>(results) + i * stride, stride, D3D10_ASYNC_GETDATA_DONOTFLUSH)))
+		ID3D10Query *const query = impl->queries[i + first].get();
+
+		// Returns S_FALSE if the query has not finished on the GPU yet
+		// Pipeline statistics in D3D10 are smaller than 'api::pipeline_statistics', so only ask for as much data as the query actually has
+		if (query->GetData(static_cast<uint8_t *>(results) + i * stride, std::min(stride, query->GetDataSize()), D3D10_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
 			return false;
 	}
 
@@ -8,6 +8,7 @@
 #include "com_ptr.hpp"
 #include "com_tracking.hpp"
 #include "addon_manager.hpp"
+#include <deque>
 #include <d3d10_1.h>
 
 namespace reshade::d3d10
@@ -25,6 +26,9 @@ namespace reshade::d3d10
 		bool check_capability(api::device_caps capability) const final;
 		bool check_format_support(api::format format, api::resource_usage usage) const final;
 
+		bool get_memory_budget(uint64_t *budget, uint64_t *usage) const final;
+		uint64_t get_resource_memory_usage(api::resource_memory_owner owner, api::resource_memory_category category) const final;
+
 		bool is_resource_handle_valid(api::resource handle) const final;
 		bool is_resource_view_handle_valid(api::resource_view handle) const final;
 
@@ -61,6 +65,9 @@ namespace reshade::d3d10
 		void destroy_render_pass(api::render_pass handle) final;
 		void destroy_descriptor_sets(api::descriptor_set_layout layout, uint32_t count, const api::descriptor_set *sets) final;
 
+		bool create_command_list(api::command_list **out) final { *out = nullptr; return false; }
+		void destroy_command_list(api::command_list *) final { assert(false); }
+
 		bool get_attachment(api::render_pass fbo, api::attachment_type type, uint32_t index, api::resource_view *out) const final;
 		uint32_t get_attachment_count(api::render_pass pass, api::attachment_type type) const final;
 
@@ -87,6 +94,12 @@ namespace reshade::d3d10
 
 		void flush_immediate_command_list() const final;
 
+		void execute_command_list(api::command_list *cmd_list) final { assert(cmd_list == this); flush_immediate_command_list(); }
+		bool allocate_upload_memory(uint64_t, uint64_t, void **out_data, api::resource *, uint64_t *) final { *out_data = nullptr; return false; }
+
+		uint64_t get_pending_fence_value() final;
+		uint64_t get_completed_fence_value() const final;
+
 		void barrier(uint32_t count, const api::resource *resources, const api::resource_usage *old_states, const api::resource_usage *new_states) final;
 
 		void begin_render_pass(api::render_pass pass) final;
@@ -144,6 +157,12 @@ namespace reshade::d3d10
 		UINT _push_constants_size = 0;
 		com_ptr<ID3D10Buffer> _push_constants;
 
+		// Event queries that were issued for fence values, in the order they were issued, and queries that can be issued again
+		uint64_t _fence_value = 0;
+		mutable uint64_t _completed_fence_value = 0;
+		mutable std::deque<std::pair<uint64_t, com_ptr<ID3D10Query>>> _fence_queries;
+		mutable std::vector<com_ptr<ID3D10Query>> _free_fence_queries;
+
 	protected:
 		com_object_list<ID3D10View> _views;
 		com_object_list<ID3D10Resource> _resources;
@@ -438,6 +438,7 @@ HRESULT STDMETHODCALLTYPE D3D11Device::CreateInputLayout(const D3D11_INPUT_ELEME
 	reshade::api::pipeline_desc desc = reshade::d3d11::convert_pipeline_desc(pInputElementDescs, NumElements);
 	desc.graphics.vertex_shader.code = pShaderBytecodeWithInputSignature;
 	desc.graphics.vertex_shader.code_size = BytecodeLength;
+	reshade::addon::compute_shader_hashes(desc);
 
 	if (reshade::api::pipeline replacement = { 0 };
 		reshade::invoke_addon_event<reshade::addon_event::create_pipeline>(this, desc, &replacement))
@@ -473,6 +474,7 @@ HRESULT STDMETHODCALLTYPE D3D11Device::CreateVertexShader(const void *pShaderByt
 	desc.graphics.vertex_shader.code = pShaderBytecode;
 	desc.graphics.vertex_shader.code_size = BytecodeLength;
 	desc.graphics.vertex_shader.format = reshade::api::shader_format::dxbc;
+	reshade::addon::compute_shader_hashes(desc);
 
 	if (reshade::api::pipeline replacement = { 0 };
 		pClassLinkage == nullptr &&
@@ -509,6 +511,7 @@ HRESULT STDMETHODCALLTYPE D3D11Device::CreateGeometryShader(const void *pShaderB
 	desc.graphics.geometry_shader.code = pShaderBytecode;
 	desc.graphics.geometry_shader.code_size = BytecodeLength;
 	desc.graphics.geometry_shader.format = reshade::api::shader_format::dxbc;
+	reshade::addon::compute_shader_hashes(desc);
 
 	if (reshade::api::pipeline replacement = { 0 };
 		pClassLinkage == nullptr &&
@@ -545,6 +548,7 @@ HRESULT STDMETHODCALLTYPE D3D11Device::CreateGeometryShaderWithStreamOutput(cons
 	desc.graphics.geometry_shader.code = pShaderBytecode;
 	desc.graphics.geometry_shader.code_size = BytecodeLength;
 	desc.graphics.geometry_shader.format = reshade::api::shader_format::dxbc;
+	reshade::addon::compute_shader_hashes(desc);
 
 	if (reshade::api::pipeline replacement = { 0 };
 		pClassLinkage == nullptr && NumEntries == 0 && NumStrides == 0 &&
@@ -581,6 +585,7 @@ HRESULT STDMETHODCALLTYPE D3D11Device::CreatePixelShader(const void *pShaderByte
 	desc.graphics.pixel_shader.code = pShaderBytecode;
 	desc.graphics.pixel_shader.code_size = BytecodeLength;
 	desc.graphics.pixel_shader.format = reshade::api::shader_format::dxbc;
+	reshade::addon::compute_shader_hashes(desc);
 
 	if (reshade::api::pipeline replacement = { 0 };
 		pClassLinkage == nullptr &&
@@ -617,6 +622,7 @@ HRESULT STDMETHODCALLTYPE D3D11Device::CreateHullShader(const void *pShaderBytec
 	desc.graphics.hull_shader.code = pShaderBytecode;
 	desc.graphics.hull_shader.code_size = BytecodeLength;
 	desc.graphics.hull_shader.format = reshade::api::shader_format::dxbc;
+	reshade::addon::compute_shader_hashes(desc);
 
 	if (reshade::api::pipeline replacement = { 0 };
 		pClassLinkage == nullptr &&
@@ -653,6 +659,7 @@ HRESULT STDMETHODCALLTYPE D3D11Device::CreateDomainShader(const void *pShaderByt
 	desc.graphics.domain_shader.code = pShaderBytecode;
 	desc.graphics.domain_shader.code_size = BytecodeLength;
 	desc.graphics.domain_shader.format = reshade::api::shader_format::dxbc;
+	reshade::addon::compute_shader_hashes(desc);
 
 	if (reshade::api::pipeline replacement = { 0 };
 		pClassLinkage == nullptr &&
@@ -689,6 +696,7 @@ HRESULT STDMETHODCALLTYPE D3D11Device::CreateComputeShader(const void *pShaderBy
 	desc.compute.shader.code = pShaderBytecode;
 	desc.compute.shader.code_size = BytecodeLength;
 	desc.compute.shader.format = reshade::api::shader_format::dxbc;
+	reshade::addon::compute_shader_hashes(desc);
 
 	if (reshade::api::pipeline replacement = { 0 };
 		pClassLinkage == nullptr &&
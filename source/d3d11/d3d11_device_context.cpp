@@ -7,6 +7,7 @@
 #include "d3d11_device.hpp"
 #include "d3d11_device_context.hpp"
 #include "d3d11_command_list.hpp"
+#include "profiling.hpp"
 #include "reshade_api_type_convert.hpp"
 
 D3D11DeviceContext::D3D11DeviceContext(D3D11Device *device, ID3D11DeviceContext  *original) :
@@ -82,7 +83,7 @@ void D3D11DeviceContext::invoke_bind_vertex_buffers_event(UINT first, UINT count
 {
 	assert(count <= D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT);
 
-	if (reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::bind_vertex_buffers)].empty())
+	if (!reshade::has_addon_event<reshade::addon_event::bind_vertex_buffers>())
 		return;
 
 #ifndef WIN64
@@ -104,7 +105,7 @@ void D3D11DeviceContext::invoke_bind_samplers_event(reshade::api::shader_stage s
 {
 	assert(count <= D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT);
 
-	if (reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::push_descriptors)].empty())
+	if (!reshade::has_addon_event<reshade::addon_event::push_descriptors>())
 		return;
 
 #ifndef WIN64
@@ -122,7 +123,7 @@ void D3D11DeviceContext::invoke_bind_shader_resource_views_event(reshade::api::s
 {
 	assert(count <= D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT);
 
-	if (reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::push_descriptors)].empty())
+	if (!reshade::has_addon_event<reshade::addon_event::push_descriptors>())
 		return;
 
 #ifndef WIN64
@@ -140,7 +141,7 @@ void D3D11DeviceContext::invoke_bind_unordered_access_views_event(reshade::api::
 {
 	assert(count <= D3D11_1_UAV_SLOT_COUNT);
 
-	if (reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::push_descriptors)].empty())
+	if (!reshade::has_addon_event<reshade::addon_event::push_descriptors>())
 		return;
 
 #ifndef WIN64
@@ -158,7 +159,7 @@ void D3D11DeviceContext::invoke_bind_constant_buffers_event(reshade::api::shader
 {
 	assert(count <= D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT);
 
-	if (reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::push_descriptors)].empty())
+	if (!reshade::has_addon_event<reshade::addon_event::push_descriptors>())
 		return;
 
 #ifndef WIN64
@@ -237,6 +238,8 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::VSSetConstantBuffers(UINT StartSlo
 {
 	_orig->VSSetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers);
 #if RESHADE_ADDON
+	RESHADE_PROFILE_CALL("ID3D11DeviceContext::VSSetConstantBuffers");
+
 	invoke_bind_constant_buffers_event(reshade::api::shader_stage::vertex, StartSlot, NumBuffers, ppConstantBuffers);
 #endif
 }
@@ -244,6 +247,8 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::PSSetShaderResources(UINT StartSlo
 {
 	_orig->PSSetShaderResources(StartSlot, NumViews, ppShaderResourceViews);
 #if RESHADE_ADDON
+	RESHADE_PROFILE_CALL("ID3D11DeviceContext::PSSetShaderResources");
+
 	invoke_bind_shader_resource_views_event(reshade::api::shader_stage::pixel, StartSlot, NumViews, ppShaderResourceViews);
 #endif
 }
@@ -251,6 +256,8 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::PSSetShader(ID3D11PixelShader *pPi
 {
 	_orig->PSSetShader(pPixelShader, ppClassInstances, NumClassInstances);
 #if RESHADE_ADDON
+	RESHADE_PROFILE_CALL("ID3D11DeviceContext::PSSetShader");
+
 	reshade::invoke_addon_event<reshade::addon_event::bind_pipeline>(this, reshade::api::pipeline_stage::pixel_shader, reshade::api::pipeline { reinterpret_cast<uintptr_t>(pPixelShader) });
 #endif
 }
@@ -258,6 +265,8 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::PSSetSamplers(UINT StartSlot, UINT
 {
 	_orig->PSSetSamplers(StartSlot, NumSamplers, ppSamplers);
 #if RESHADE_ADDON
+	RESHADE_PROFILE_CALL("ID3D11DeviceContext::PSSetSamplers");
+
 	invoke_bind_samplers_event(reshade::api::shader_stage::pixel, StartSlot, NumSamplers, ppSamplers);
 #endif
 }
@@ -265,22 +274,32 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::VSSetShader(ID3D11VertexShader *pV
 {
 	_orig->VSSetShader(pVertexShader, ppClassInstances, NumClassInstances);
 #if RESHADE_ADDON
+	RESHADE_PROFILE_CALL("ID3D11DeviceContext::VSSetShader");
+
 	reshade::invoke_addon_event<reshade::addon_event::bind_pipeline>(this, reshade::api::pipeline_stage::vertex_shader, reshade::api::pipeline { reinterpret_cast<uintptr_t>(pVertexShader) });
 #endif
 }
 void    STDMETHODCALLTYPE D3D11DeviceContext::DrawIndexed(UINT IndexCount, UINT StartIndexLocation, INT BaseVertexLocation)
 {
 #if RESHADE_ADDON
-	if (reshade::invoke_addon_event<reshade::addon_event::draw_indexed>(this, IndexCount, 1, StartIndexLocation, BaseVertexLocation, 0))
-		return;
+	{
+		RESHADE_PROFILE_CALL("ID3D11DeviceContext::DrawIndexed");
+
+		if (reshade::invoke_addon_event<reshade::addon_event::draw_indexed>(this, IndexCount, 1, StartIndexLocation, BaseVertexLocation, 0))
+			return;
+	}
 #endif
 	_orig->DrawIndexed(IndexCount, StartIndexLocation, BaseVertexLocation);
 }
 void    STDMETHODCALLTYPE D3D11DeviceContext::Draw(UINT VertexCount, UINT StartVertexLocation)
 {
 #if RESHADE_ADDON
-	if (reshade::invoke_addon_event<reshade::addon_event::draw>(this, VertexCount, 1, StartVertexLocation, 0))
-		return;
+	{
+		RESHADE_PROFILE_CALL("ID3D11DeviceContext::Draw");
+
+		if (reshade::invoke_addon_event<reshade::addon_event::draw>(this, VertexCount, 1, StartVertexLocation, 0))
+			return;
+	}
 #endif
 	_orig->Draw(VertexCount, StartVertexLocation);
 }
@@ -296,6 +315,8 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::PSSetConstantBuffers(UINT StartSlo
 {
 	_orig->PSSetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers);
 #if RESHADE_ADDON
+	RESHADE_PROFILE_CALL("ID3D11DeviceContext::PSSetConstantBuffers");
+
 	invoke_bind_constant_buffers_event(reshade::api::shader_stage::pixel, StartSlot, NumBuffers, ppConstantBuffers);
 #endif
 }
@@ -303,6 +324,8 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::IASetInputLayout(ID3D11InputLayout
 {
 	_orig->IASetInputLayout(pInputLayout);
 #if RESHADE_ADDON
+	RESHADE_PROFILE_CALL("ID3D11DeviceContext::IASetInputLayout");
+
 	reshade::invoke_addon_event<reshade::addon_event::bind_pipeline>(this, reshade::api::pipeline_stage::input_assembler, reshade::api::pipeline { reinterpret_cast<uintptr_t>(pInputLayout) });
 #endif
 }
@@ -310,6 +333,8 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::IASetVertexBuffers(UINT StartSlot,
 {
 	_orig->IASetVertexBuffers(StartSlot, NumBuffers, ppVertexBuffers, pStrides, pOffsets);
 #if RESHADE_ADDON
+	RESHADE_PROFILE_CALL("ID3D11DeviceContext::IASetVertexBuffers");
+
 	invoke_bind_vertex_buffers_event(StartSlot, NumBuffers, ppVertexBuffers, pStrides, pOffsets);
 #endif
 }
@@ -317,22 +342,32 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::IASetIndexBuffer(ID3D11Buffer *pIn
 {
 	_orig->IASetIndexBuffer(pIndexBuffer, Format, Offset);
 #if RESHADE_ADDON
+	RESHADE_PROFILE_CALL("ID3D11DeviceContext::IASetIndexBuffer");
+
 	reshade::invoke_addon_event<reshade::addon_event::bind_index_buffer>(this, reshade::api::resource { reinterpret_cast<uintptr_t>(pIndexBuffer) }, Offset, Format == DXGI_FORMAT_R16_UINT ? 2 : 4);
 #endif
 }
 void    STDMETHODCALLTYPE D3D11DeviceContext::DrawIndexedInstanced(UINT IndexCountPerInstance, UINT InstanceCount, UINT StartIndexLocation, INT BaseVertexLocation, UINT StartInstanceLocation)
 {
 #if RESHADE_ADDON
-	if (reshade::invoke_addon_event<reshade::addon_event::draw_indexed>(this, IndexCountPerInstance, InstanceCount, StartIndexLocation, BaseVertexLocation, StartInstanceLocation))
-		return;
+	{
+		RESHADE_PROFILE_CALL("ID3D11DeviceContext::DrawIndexedInstanced");
+
+		if (reshade::invoke_addon_event<reshade::addon_event::draw_indexed>(this, IndexCountPerInstance, InstanceCount, StartIndexLocation, BaseVertexLocation, StartInstanceLocation))
+			return;
+	}
 #endif
 	_orig->DrawIndexedInstanced(IndexCountPerInstance, InstanceCount, StartIndexLocation, BaseVertexLocation, StartInstanceLocation);
 }
 void    STDMETHODCALLTYPE D3D11DeviceContext::DrawInstanced(UINT VertexCountPerInstance, UINT InstanceCount, UINT StartVertexLocation, UINT StartInstanceLocation)
 {
 #if RESHADE_ADDON
-	if (reshade::invoke_addon_event<reshade::addon_event::draw>(this, VertexCountPerInstance, InstanceCount, StartVertexLocation, StartInstanceLocation))
-		return;
+	{
+		RESHADE_PROFILE_CALL("ID3D11DeviceContext::DrawInstanced");
+
+		if (reshade::invoke_addon_event<reshade::addon_event::draw>(this, VertexCountPerInstance, InstanceCount, StartVertexLocation, StartInstanceLocation))
+			return;
+	}
 #endif
 	_orig->DrawInstanced(VertexCountPerInstance, InstanceCount, StartVertexLocation, StartInstanceLocation);
 }
@@ -419,6 +454,8 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::OMSetRenderTargets(UINT NumViews,
 	_orig->OMSetRenderTargets(NumViews, ppRenderTargetViews, pDepthStencilView);
 
 #if RESHADE_ADDON
+	RESHADE_PROFILE_CALL("ID3D11DeviceContext::OMSetRenderTargets");
+
 	assert(NumViews <= D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT);
 
 	if (_has_open_render_pass)
@@ -472,6 +509,9 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::OMSetBlendState(ID3D11BlendState *
 	reshade::invoke_addon_event<reshade::addon_event::bind_pipeline>(this,
 		reshade::api::pipeline_stage::output_merger, reshade::api::pipeline { reinterpret_cast<uintptr_t>(pBlendState) });
 
+	if (!reshade::has_addon_event<reshade::addon_event::bind_pipeline_states>())
+		return;
+
 	const reshade::api::dynamic_state states[2] = { reshade::api::dynamic_state::blend_constant, reshade::api::dynamic_state::sample_mask };
 	const uint32_t values[2] = {
 		(BlendFactor == nullptr) ? 0xFFFFFFFF : // Default blend factor is { 1, 1, 1, 1 }
@@ -525,8 +565,12 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::DrawInstancedIndirect(ID3D11Buffer
 void    STDMETHODCALLTYPE D3D11DeviceContext::Dispatch(UINT ThreadGroupCountX, UINT ThreadGroupCountY, UINT ThreadGroupCountZ)
 {
 #if RESHADE_ADDON
-	if (reshade::invoke_addon_event<reshade::addon_event::dispatch>(this, ThreadGroupCountX, ThreadGroupCountY, ThreadGroupCountZ))
-		return;
+	{
+		RESHADE_PROFILE_CALL("ID3D11DeviceContext::Dispatch");
+
+		if (reshade::invoke_addon_event<reshade::addon_event::dispatch>(this, ThreadGroupCountX, ThreadGroupCountY, ThreadGroupCountZ))
+			return;
+	}
 #endif
 	_orig->Dispatch(ThreadGroupCountX, ThreadGroupCountY, ThreadGroupCountZ);
 }
@@ -570,40 +614,44 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::RSSetScissorRects(UINT NumRects, c
 void    STDMETHODCALLTYPE D3D11DeviceContext::CopySubresourceRegion(ID3D11Resource *pDstResource, UINT DstSubresource, UINT DstX, UINT DstY, UINT DstZ, ID3D11Resource *pSrcResource, UINT SrcSubresource, const D3D11_BOX *pSrcBox)
 {
 #if RESHADE_ADDON
-	assert(pDstResource != nullptr && pSrcResource != nullptr);
-
-	D3D11_RESOURCE_DIMENSION type;
-	pDstResource->GetType(&type);
-	if (type == D3D11_RESOURCE_DIMENSION_BUFFER)
+	if (reshade::has_addon_event<reshade::addon_event::copy_buffer_region>() ||
+		reshade::has_addon_event<reshade::addon_event::copy_texture_region>())
 	{
-		assert(SrcSubresource == 0 && DstSubresource == 0);
+		assert(pDstResource != nullptr && pSrcResource != nullptr);
 
-		if (reshade::invoke_addon_event<reshade::addon_event::copy_buffer_region>(this,
-			reshade::api::resource { reinterpret_cast<uintptr_t>(pSrcResource) }, pSrcBox != nullptr ? pSrcBox->left : 0,
-			reshade::api::resource { reinterpret_cast<uintptr_t>(pDstResource) }, DstX, pSrcBox != nullptr ? pSrcBox->right - pSrcBox->left : std::numeric_limits<uint64_t>::max()))
-			return;
-	}
-	else
-	{
-		int32_t dst_box[6] = { static_cast<int32_t>(DstX), static_cast<int32_t>(DstY), static_cast<int32_t>(DstZ) };
-		if (pSrcBox != nullptr)
+		D3D11_RESOURCE_DIMENSION type;
+		pDstResource->GetType(&type);
+		if (type == D3D11_RESOURCE_DIMENSION_BUFFER)
 		{
-			dst_box[3] = dst_box[0] + pSrcBox->right - pSrcBox->left;
-			dst_box[4] = dst_box[1] + pSrcBox->bottom - pSrcBox->top;
-			dst_box[5] = dst_box[2] + pSrcBox->back - pSrcBox->front;
+			assert(SrcSubresource == 0 && DstSubresource == 0);
+
+			if (reshade::invoke_addon_event<reshade::addon_event::copy_buffer_region>(this,
+				reshade::api::resource { reinterpret_cast<uintptr_t>(pSrcResource) }, pSrcBox != nullptr ? pSrcBox->left : 0,
+				reshade::api::resource { reinterpret_cast<uintptr_t>(pDstResource) }, DstX, pSrcBox != nullptr ? pSrcBox->right - pSrcBox->left : std::numeric_limits<uint64_t>::max()))
+				return;
 		}
 		else
 		{
-			// TODO: Destination box size is not implemented (would have to get it from the resource)
-			assert(DstX == 0 && DstY == 0 && DstZ == 0);
+			int32_t dst_box[6] = { static_cast<int32_t>(DstX), static_cast<int32_t>(DstY), static_cast<int32_t>(DstZ) };
+			if (pSrcBox != nullptr)
+			{
+				dst_box[3] = dst_box[0] + pSrcBox->right - pSrcBox->left;
+				dst_box[4] = dst_box[1] + pSrcBox->bottom - pSrcBox->top;
+				dst_box[5] = dst_box[2] + pSrcBox->back - pSrcBox->front;
+			}
+			else
+			{
+				// TODO: Destination box size is not implemented (would have to get it from the resource)
+				assert(DstX == 0 && DstY == 0 && DstZ == 0);
+			}
+
+			static_assert(sizeof(D3D11_BOX) == (sizeof(int32_t) * 6));
+
+			if (reshade::invoke_addon_event<reshade::addon_event::copy_texture_region>(this,
+				reshade::api::resource { reinterpret_cast<uintptr_t>(pSrcResource) }, SrcSubresource, reinterpret_cast<const int32_t *>(pSrcBox),
+				reshade::api::resource { reinterpret_cast<uintptr_t>(pDstResource) }, DstSubresource, DstX != 0 || DstY != 0 || DstZ != 0 ? dst_box : nullptr, reshade::api::filter_type::min_mag_mip_point))
+				return;
 		}
-
-		static_assert(sizeof(D3D11_BOX) == (sizeof(int32_t) * 6));
-
-		if (reshade::invoke_addon_event<reshade::addon_event::copy_texture_region>(this,
-			reshade::api::resource { reinterpret_cast<uintptr_t>(pSrcResource) }, SrcSubresource, reinterpret_cast<const int32_t *>(pSrcBox),
-			reshade::api::resource { reinterpret_cast<uintptr_t>(pDstResource) }, DstSubresource, DstX != 0 || DstY != 0 || DstZ != 0 ? dst_box : nullptr, reshade::api::filter_type::min_mag_mip_point))
-			return;
 	}
 #endif
 	_orig->CopySubresourceRegion(pDstResource, DstSubresource, DstX, DstY, DstZ, pSrcResource, SrcSubresource, pSrcBox);
@@ -619,29 +667,33 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::CopyResource(ID3D11Resource *pDstR
 void    STDMETHODCALLTYPE D3D11DeviceContext::UpdateSubresource(ID3D11Resource *pDstResource, UINT DstSubresource, const D3D11_BOX *pDstBox, const void *pSrcData, UINT SrcRowPitch, UINT SrcDepthPitch)
 {
 #if RESHADE_ADDON
-	assert(pDstResource != nullptr);
-
-	D3D11_RESOURCE_DIMENSION type;
-	pDstResource->GetType(&type);
-	if (type == D3D11_RESOURCE_DIMENSION_BUFFER)
+	if (reshade::has_addon_event<reshade::addon_event::upload_buffer_region>() ||
+		reshade::has_addon_event<reshade::addon_event::upload_texture_region>())
 	{
-		assert(DstSubresource == 0);
+		assert(pDstResource != nullptr);
 
-		if (reshade::invoke_addon_event<reshade::addon_event::upload_buffer_region>(_device,
-			pSrcData,
-			reshade::api::resource { reinterpret_cast<uintptr_t>(pDstResource) },
-			pDstBox != nullptr ? pDstBox->left : 0,
-			pDstBox != nullptr ? pDstBox->right - pDstBox->left : SrcRowPitch))
-			return;
-	}
-	else
-	{
-		static_assert(sizeof(D3D11_BOX) == (sizeof(int32_t) * 6));
+		D3D11_RESOURCE_DIMENSION type;
+		pDstResource->GetType(&type);
+		if (type == D3D11_RESOURCE_DIMENSION_BUFFER)
+		{
+			assert(DstSubresource == 0);
+
+			if (reshade::invoke_addon_event<reshade::addon_event::upload_buffer_region>(_device,
+				pSrcData,
+				reshade::api::resource { reinterpret_cast<uintptr_t>(pDstResource) },
+				pDstBox != nullptr ? pDstBox->left : 0,
+				pDstBox != nullptr ? pDstBox->right - pDstBox->left : SrcRowPitch))
+				return;
+		}
+		else
+		{
+			static_assert(sizeof(D3D11_BOX) == (sizeof(int32_t) * 6));
 
-		if (reshade::invoke_addon_event<reshade::addon_event::upload_texture_region>(_device,
-			reshade::api::subresource_data { pSrcData, SrcRowPitch, SrcDepthPitch },
-			reshade::api::resource { reinterpret_cast<uintptr_t>(pDstResource) }, DstSubresource, reinterpret_cast<const int32_t *>(pDstBox)))
-			return;
+			if (reshade::invoke_addon_event<reshade::addon_event::upload_texture_region>(_device,
+				reshade::api::subresource_data { pSrcData, SrcRowPitch, SrcDepthPitch },
+				reshade::api::resource { reinterpret_cast<uintptr_t>(pDstResource) }, DstSubresource, reinterpret_cast<const int32_t *>(pDstBox)))
+				return;
+		}
 	}
 #endif
 	_orig->UpdateSubresource(pDstResource, DstSubresource, pDstBox, pSrcData, SrcRowPitch, SrcDepthPitch);
@@ -649,18 +701,21 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::UpdateSubresource(ID3D11Resource *
 void    STDMETHODCALLTYPE D3D11DeviceContext::CopyStructureCount(ID3D11Buffer *pDstBuffer, UINT DstAlignedByteOffset, ID3D11UnorderedAccessView *pSrcView)
 {
 #if RESHADE_ADDON
-	assert(pSrcView != nullptr);
+	if (reshade::has_addon_event<reshade::addon_event::copy_buffer_region>())
+	{
+		assert(pSrcView != nullptr);
 
-	com_ptr<ID3D11Resource> src;
-	pSrcView->GetResource(&src);
-	D3D11_UNORDERED_ACCESS_VIEW_DESC desc;
-	pSrcView->GetDesc(&desc);
+		com_ptr<ID3D11Resource> src;
+		pSrcView->GetResource(&src);
+		D3D11_UNORDERED_ACCESS_VIEW_DESC desc;
+		pSrcView->GetDesc(&desc);
 
-	if (desc.ViewDimension == D3D11_UAV_DIMENSION_BUFFER &&
-		reshade::invoke_addon_event<reshade::addon_event::copy_buffer_region>(this,
-		reshade::api::resource { reinterpret_cast<uintptr_t>(src.get()) }, desc.Buffer.FirstElement,
-		reshade::api::resource { reinterpret_cast<uintptr_t>(pDstBuffer) }, DstAlignedByteOffset, desc.Buffer.NumElements))
-		return;
+		if (desc.ViewDimension == D3D11_UAV_DIMENSION_BUFFER &&
+			reshade::invoke_addon_event<reshade::addon_event::copy_buffer_region>(this,
+			reshade::api::resource { reinterpret_cast<uintptr_t>(src.get()) }, desc.Buffer.FirstElement,
+			reshade::api::resource { reinterpret_cast<uintptr_t>(pDstBuffer) }, DstAlignedByteOffset, desc.Buffer.NumElements))
+			return;
+	}
 #endif
 	_orig->CopyStructureCount(pDstBuffer, DstAlignedByteOffset, pSrcView);
 }
@@ -719,7 +774,8 @@ FLOAT   STDMETHODCALLTYPE D3D11DeviceContext::GetResourceMinLOD(ID3D11Resource *
 void    STDMETHODCALLTYPE D3D11DeviceContext::ResolveSubresource(ID3D11Resource *pDstResource, UINT DstSubresource, ID3D11Resource *pSrcResource, UINT SrcSubresource, DXGI_FORMAT Format)
 {
 #if RESHADE_ADDON
-	if (reshade::invoke_addon_event<reshade::addon_event::resolve_texture_region>(this,
+	if (reshade::has_addon_event<reshade::addon_event::resolve_texture_region>() &&
+		reshade::invoke_addon_event<reshade::addon_event::resolve_texture_region>(this,
 		reshade::api::resource { reinterpret_cast<uintptr_t>(pSrcResource) }, SrcSubresource, nullptr,
 		reshade::api::resource { reinterpret_cast<uintptr_t>(pDstResource) }, DstSubresource, nullptr, reshade::d3d11::convert_format(Format)))
 		return;
@@ -734,7 +790,12 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::ExecuteCommandList(ID3D11CommandLi
 	D3D11CommandList *const command_list_proxy = static_cast<D3D11CommandList *>(pCommandList);
 
 #if RESHADE_ADDON
-	reshade::invoke_addon_event<reshade::addon_event::execute_command_list>(this, command_list_proxy);
+	{
+		RESHADE_PROFILE_SCOPE("ID3D11DeviceContext::ExecuteCommandList");
+		RESHADE_PROFILE_CALL("ID3D11DeviceContext::ExecuteCommandList");
+
+		reshade::invoke_addon_event<reshade::addon_event::execute_command_list>(this, command_list_proxy);
+	}
 #endif
 
 	// Get original command list pointer from proxy object and execute with it
@@ -1017,6 +1078,9 @@ HRESULT STDMETHODCALLTYPE D3D11DeviceContext::FinishCommandList(BOOL RestoreDefe
 
 #if RESHADE_ADDON
 		reshade::invoke_addon_event<reshade::addon_event::execute_secondary_command_list>(command_list_proxy, this);
+		// The deferred context starts recording a new command list after this, so the commands recorded so far now belong to the finished one only
+		if (reshade::has_addon_event<reshade::addon_event::execute_command_stream>())
+			reshade::addon::command_recorder<reshade::addon_event::reset_command_list>::record(this);
 #endif
 	}
 
@@ -1039,40 +1103,44 @@ D3D11_DEVICE_CONTEXT_TYPE STDMETHODCALLTYPE D3D11DeviceContext::GetType()
 void    STDMETHODCALLTYPE D3D11DeviceContext::CopySubresourceRegion1(ID3D11Resource *pDstResource, UINT DstSubresource, UINT DstX, UINT DstY, UINT DstZ, ID3D11Resource *pSrcResource, UINT SrcSubresource, const D3D11_BOX *pSrcBox, UINT CopyFlags)
 {
 #if RESHADE_ADDON
-	assert(pDstResource != nullptr && pSrcResource != nullptr);
-
-	D3D11_RESOURCE_DIMENSION type;
-	pDstResource->GetType(&type);
-	if (type == D3D11_RESOURCE_DIMENSION_BUFFER)
+	if (reshade::has_addon_event<reshade::addon_event::copy_buffer_region>() ||
+		reshade::has_addon_event<reshade::addon_event::copy_texture_region>())
 	{
-		assert(SrcSubresource == 0 && DstSubresource == 0);
+		assert(pDstResource != nullptr && pSrcResource != nullptr);
 
-		if (reshade::invoke_addon_event<reshade::addon_event::copy_buffer_region>(this,
-			reshade::api::resource { reinterpret_cast<uintptr_t>(pSrcResource) }, pSrcBox != nullptr ? pSrcBox->left : 0,
-			reshade::api::resource { reinterpret_cast<uintptr_t>(pDstResource) }, DstX, pSrcBox != nullptr ? pSrcBox->right - pSrcBox->left : ~0ull))
-			return;
-	}
-	else
-	{
-		int32_t dst_box[6] = { static_cast<int32_t>(DstX), static_cast<int32_t>(DstY), static_cast<int32_t>(DstZ) };
-		if (pSrcBox != nullptr)
+		D3D11_RESOURCE_DIMENSION type;
+		pDstResource->GetType(&type);
+		if (type == D3D11_RESOURCE_DIMENSION_BUFFER)
 		{
-			dst_box[3] = dst_box[0] + pSrcBox->right - pSrcBox->left;
-			dst_box[4] = dst_box[1] + pSrcBox->bottom - pSrcBox->top;
-			dst_box[5] = dst_box[2] + pSrcBox->back - pSrcBox->front;
+			assert(SrcSubresource == 0 && DstSubresource == 0);
+
+			if (reshade::invoke_addon_event<reshade::addon_event::copy_buffer_region>(this,
+				reshade::api::resource { reinterpret_cast<uintptr_t>(pSrcResource) }, pSrcBox != nullptr ? pSrcBox->left : 0,
+				reshade::api::resource { reinterpret_cast<uintptr_t>(pDstResource) }, DstX, pSrcBox != nullptr ? pSrcBox->right - pSrcBox->left : ~0ull))
+				return;
 		}
 		else
 		{
-			// TODO: Destination box size is not implemented (would have to get it from the resource)
-			assert(DstX == 0 && DstY == 0 && DstZ == 0);
+			int32_t dst_box[6] = { static_cast<int32_t>(DstX), static_cast<int32_t>(DstY), static_cast<int32_t>(DstZ) };
+			if (pSrcBox != nullptr)
+			{
+				dst_box[3] = dst_box[0] + pSrcBox->right - pSrcBox->left;
+				dst_box[4] = dst_box[1] + pSrcBox->bottom - pSrcBox->top;
+				dst_box[5] = dst_box[2] + pSrcBox->back - pSrcBox->front;
+			}
+			else
+			{
+				// TODO: Destination box size is not implemented (would have to get it from the resource)
+				assert(DstX == 0 && DstY == 0 && DstZ == 0);
+			}
+
+			static_assert(sizeof(D3D11_BOX) == (sizeof(int32_t) * 6));
+
+			if (reshade::invoke_addon_event<reshade::addon_event::copy_texture_region>(this,
+				reshade::api::resource { reinterpret_cast<uintptr_t>(pSrcResource) }, SrcSubresource, reinterpret_cast<const int32_t *>(pSrcBox),
+				reshade::api::resource { reinterpret_cast<uintptr_t>(pDstResource) }, DstSubresource, DstX != 0 || DstY != 0 || DstZ != 0 ? dst_box : nullptr, reshade::api::filter_type::min_mag_mip_point))
+				return;
 		}
-
-		static_assert(sizeof(D3D11_BOX) == (sizeof(int32_t) * 6));
-
-		if (reshade::invoke_addon_event<reshade::addon_event::copy_texture_region>(this,
-			reshade::api::resource { reinterpret_cast<uintptr_t>(pSrcResource) }, SrcSubresource, reinterpret_cast<const int32_t *>(pSrcBox),
-			reshade::api::resource { reinterpret_cast<uintptr_t>(pDstResource) }, DstSubresource, DstX != 0 || DstY != 0 || DstZ != 0 ? dst_box : nullptr, reshade::api::filter_type::min_mag_mip_point))
-			return;
 	}
 #endif
 
@@ -1082,29 +1150,33 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::CopySubresourceRegion1(ID3D11Resou
 void    STDMETHODCALLTYPE D3D11DeviceContext::UpdateSubresource1(ID3D11Resource *pDstResource, UINT DstSubresource, const D3D11_BOX *pDstBox, const void *pSrcData, UINT SrcRowPitch, UINT SrcDepthPitch, UINT CopyFlags)
 {
 #if RESHADE_ADDON
-	assert(pDstResource != nullptr);
-
-	D3D11_RESOURCE_DIMENSION type;
-	pDstResource->GetType(&type);
-	if (type == D3D11_RESOURCE_DIMENSION_BUFFER)
+	if (reshade::has_addon_event<reshade::addon_event::upload_buffer_region>() ||
+		reshade::has_addon_event<reshade::addon_event::upload_texture_region>())
 	{
-		assert(DstSubresource == 0);
+		assert(pDstResource != nullptr);
 
-		if (reshade::invoke_addon_event<reshade::addon_event::upload_buffer_region>(_device,
-			pSrcData,
-			reshade::api::resource { reinterpret_cast<uintptr_t>(pDstResource) },
-			pDstBox != nullptr ? pDstBox->left : 0,
-			pDstBox != nullptr ? pDstBox->right - pDstBox->left : SrcRowPitch))
-			return;
-	}
-	else
-	{
-		static_assert(sizeof(D3D11_BOX) == (sizeof(int32_t) * 6));
+		D3D11_RESOURCE_DIMENSION type;
+		pDstResource->GetType(&type);
+		if (type == D3D11_RESOURCE_DIMENSION_BUFFER)
+		{
+			assert(DstSubresource == 0);
+
+			if (reshade::invoke_addon_event<reshade::addon_event::upload_buffer_region>(_device,
+				pSrcData,
+				reshade::api::resource { reinterpret_cast<uintptr_t>(pDstResource) },
+				pDstBox != nullptr ? pDstBox->left : 0,
+				pDstBox != nullptr ? pDstBox->right - pDstBox->left : SrcRowPitch))
+				return;
+		}
+		else
+		{
+			static_assert(sizeof(D3D11_BOX) == (sizeof(int32_t) * 6));
 
-		if (reshade::invoke_addon_event<reshade::addon_event::upload_texture_region>(_device,
-			reshade::api::subresource_data { pSrcData, SrcRowPitch, SrcDepthPitch },
-			reshade::api::resource { reinterpret_cast<uintptr_t>(pDstResource) }, DstSubresource, reinterpret_cast<const int32_t *>(pDstBox)))
-			return;
+			if (reshade::invoke_addon_event<reshade::addon_event::upload_texture_region>(_device,
+				reshade::api::subresource_data { pSrcData, SrcRowPitch, SrcDepthPitch },
+				reshade::api::resource { reinterpret_cast<uintptr_t>(pDstResource) }, DstSubresource, reinterpret_cast<const int32_t *>(pDstBox)))
+				return;
+		}
 	}
 #endif
 
@@ -1209,20 +1281,20 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::ClearView(ID3D11View *pView, const
 {
 #if RESHADE_ADDON
 	if (com_ptr<ID3D11RenderTargetView> rtv;
-		SUCCEEDED(pView->QueryInterface(&rtv)))
+		reshade::has_addon_event<reshade::addon_event::clear_render_target_view>() && SUCCEEDED(pView->QueryInterface(&rtv)))
 	{
 		if (reshade::invoke_addon_event<reshade::addon_event::clear_render_target_view>(this, reshade::api::resource_view { reinterpret_cast<uintptr_t>(rtv.get()) }, Color, NumRects, reinterpret_cast<const int32_t *>(pRect)))
 			return;
 	}
 	if (com_ptr<ID3D11DepthStencilView> dsv;
-		SUCCEEDED(pView->QueryInterface(&dsv)))
+		reshade::has_addon_event<reshade::addon_event::clear_depth_stencil_view>() && SUCCEEDED(pView->QueryInterface(&dsv)))
 	{
 		// The 'ID3D11DeviceContext1::ClearView' API only works on depth-stencil views to depth-only resources (with no stencil component)
 		if (reshade::invoke_addon_event<reshade::addon_event::clear_depth_stencil_view>(this, reshade::api::resource_view { reinterpret_cast<uintptr_t>(dsv.get()) }, reshade::api::attachment_type::depth, Color[0], static_cast<uint8_t>(0), NumRects, reinterpret_cast<const int32_t *>(pRect)))
 			return;
 	}
 	if (com_ptr<ID3D11UnorderedAccessView> uav;
-		SUCCEEDED(pView->QueryInterface(&uav)))
+		reshade::has_addon_event<reshade::addon_event::clear_unordered_access_view_float>() && SUCCEEDED(pView->QueryInterface(&uav)))
 	{
 		if (reshade::invoke_addon_event<reshade::addon_event::clear_unordered_access_view_float>(this, reshade::api::resource_view { reinterpret_cast<uintptr_t>(uav.get()) }, Color, NumRects, reinterpret_cast<const int32_t *>(pRect)))
 			return;
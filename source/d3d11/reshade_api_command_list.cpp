@@ -41,6 +41,32 @@ reshade::api::device *reshade::d3d11::command_list_impl::get_device()
 	return _device_impl;
 }
 
+void reshade::d3d11::device_context_impl::track_state_usage(const state_usage &usage)
+{
+	// Save the application state before it is overwritten for the first time
+	if (_active_state_block != nullptr)
+		_active_state_block->capture_additional(usage);
+
+	_state_usage = usage;
+}
+void reshade::d3d11::device_context_impl::track_slots(state_usage::slot_type type, api::shader_stage stages, UINT count)
+{
+	state_usage usage = _state_usage;
+
+	bool grown = false;
+	for (UINT stage = 0; stage < state_usage::num_stages; ++stage)
+	{
+		if ((static_cast<uint32_t>(stages) & (1u << stage)) != 0 && count > usage.num_slots[type][stage])
+		{
+			usage.num_slots[type][stage] = count;
+			grown = true;
+		}
+	}
+
+	if (grown)
+		track_state_usage(usage);
+}
+
 void reshade::d3d11::device_context_impl::barrier(uint32_t count, const api::resource *, const api::resource_usage *old_states, const api::resource_usage *new_states)
 {
 	bool transitions_away_from_shader_resource_usage = false;
@@ -56,26 +82,28 @@ void reshade::d3d11::device_context_impl::barrier(uint32_t count, const api::res
 	}
 
 	// TODO: This should really only unbind the specific resources passed to this barrier command
+	// Only resources bound through the API can be in the resource states passed to barriers, so only have to unbind the slots that were used for those
 	if (transitions_away_from_shader_resource_usage)
 	{
 		ID3D11ShaderResourceView *null_srv[D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT] = {};
-		_orig->VSSetShaderResources(0, ARRAYSIZE(null_srv), null_srv);
-		_orig->HSSetShaderResources(0, ARRAYSIZE(null_srv), null_srv);
-		_orig->DSSetShaderResources(0, ARRAYSIZE(null_srv), null_srv);
-		_orig->GSSetShaderResources(0, ARRAYSIZE(null_srv), null_srv);
-		_orig->PSSetShaderResources(0, ARRAYSIZE(null_srv), null_srv);
-		_orig->CSSetShaderResources(0, ARRAYSIZE(null_srv), null_srv);
+		const UINT (&num_srvs)[state_usage::num_stages] = _state_usage.num_slots[state_usage::shader_resources];
+		if (num_srvs[0] != 0)
+			_orig->VSSetShaderResources(0, num_srvs[0], null_srv);
+		if (num_srvs[1] != 0)
+			_orig->HSSetShaderResources(0, num_srvs[1], null_srv);
+		if (num_srvs[2] != 0)
+			_orig->DSSetShaderResources(0, num_srvs[2], null_srv);
+		if (num_srvs[3] != 0)
+			_orig->GSSetShaderResources(0, num_srvs[3], null_srv);
+		if (num_srvs[4] != 0)
+			_orig->PSSetShaderResources(0, num_srvs[4], null_srv);
+		if (num_srvs[5] != 0)
+			_orig->CSSetShaderResources(0, num_srvs[5], null_srv);
 	}
-	if (transitions_away_from_unordered_access_usage)
+	if (transitions_away_from_unordered_access_usage && _state_usage.num_unordered_access_views != 0)
 	{
-		const D3D_FEATURE_LEVEL feature_level = _device_impl->_orig->GetFeatureLevel();
-		const UINT max_uav_bindings =
-			feature_level >= D3D_FEATURE_LEVEL_11_1 ? D3D11_1_UAV_SLOT_COUNT :
-			feature_level == D3D_FEATURE_LEVEL_11_0 ? D3D11_PS_CS_UAV_REGISTER_COUNT :
-			feature_level >= D3D_FEATURE_LEVEL_10_0 ? D3D11_CS_4_X_UAV_REGISTER_COUNT : 0;
-
 		ID3D11UnorderedAccessView *null_uav[D3D11_1_UAV_SLOT_COUNT] = {};
-		_orig->CSSetUnorderedAccessViews(0, max_uav_bindings, null_uav, nullptr);
+		_orig->CSSetUnorderedAccessViews(0, _state_usage.num_unordered_access_views, null_uav, nullptr);
 	}
 }
 
@@ -107,6 +135,22 @@ void reshade::d3d11::device_context_impl::bind_pipeline(api::pipeline_stage type
 {
 	assert(pipeline.handle != 0);
 
+	if (type == api::pipeline_stage::compute_shader)
+	{
+		if (!_state_usage.compute)
+		{
+			state_usage usage = _state_usage;
+			usage.compute = true;
+			track_state_usage(usage);
+		}
+	}
+	else if (!_state_usage.graphics)
+	{
+		state_usage usage = _state_usage;
+		usage.graphics = true;
+		track_state_usage(usage);
+	}
+
 	switch (type)
 	{
 	case api::pipeline_stage::all_graphics:
@@ -149,6 +193,12 @@ void reshade::d3d11::device_context_impl::bind_pipeline(api::pipeline_stage type
 }
 void reshade::d3d11::device_context_impl::bind_pipeline_states(uint32_t count, const api::dynamic_state *states, const uint32_t *values)
 {
+	if (!_state_usage.graphics)
+	{
+		state_usage usage = _state_usage;
+		usage.graphics = true;
+		track_state_usage(usage);
+	}
 	for (UINT i = 0; i < count; ++i)
 	{
 		switch (states[i])
@@ -183,6 +233,8 @@ void reshade::d3d11::device_context_impl::bind_samplers(api::shader_stage stages
 		count = D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT;
 	}
 
+	track_slots(state_usage::samplers, stages, first + count);
+
 #ifndef WIN64
 	ID3D11SamplerState *sampler_ptrs[D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT];
 	for (UINT i = 0; i < count; ++i)
@@ -212,6 +264,8 @@ void reshade::d3d11::device_context_impl::bind_shader_resource_views(api::shader
 		count = D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT;
 	}
 
+	track_slots(state_usage::shader_resources, stages, first + count);
+
 #ifndef WIN64
 	ID3D11ShaderResourceView *view_ptrs[D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT];
 	for (UINT i = 0; i < count; ++i)
@@ -241,6 +295,13 @@ void reshade::d3d11::device_context_impl::bind_unordered_access_views(api::shade
 		count = D3D11_1_UAV_SLOT_COUNT;
 	}
 
+	if ((stages & api::shader_stage::compute) == api::shader_stage::compute && first + count > _state_usage.num_unordered_access_views)
+	{
+		state_usage usage = _state_usage;
+		usage.num_unordered_access_views = first + count;
+		track_state_usage(usage);
+	}
+
 #ifndef WIN64
 	ID3D11UnorderedAccessView *view_ptrs[D3D11_1_UAV_SLOT_COUNT];
 	for (UINT i = 0; i < count; ++i)
@@ -262,6 +323,8 @@ void reshade::d3d11::device_context_impl::bind_constant_buffers(api::shader_stag
 		count = D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT;
 	}
 
+	track_slots(state_usage::constant_buffers, stages, first + count);
+
 #ifndef WIN64
 	ID3D11Buffer *buffer_ptrs[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
 	for (UINT i = 0; i < count; ++i)
@@ -321,6 +384,8 @@ void reshade::d3d11::device_context_impl::push_constants(api::shader_stage stage
 	const UINT push_constants_slot = layout.handle != 0 ?
 		reinterpret_cast<pipeline_layout_impl *>(layout.handle)->shader_registers[layout_index] : 0;
 
+	track_slots(state_usage::constant_buffers, stages, push_constants_slot + 1);
+
 	if ((stages & api::shader_stage::vertex) == api::shader_stage::vertex)
 		_orig->VSSetConstantBuffers(push_constants_slot, 1, &push_constants);
 	if ((stages & api::shader_stage::hull) == api::shader_stage::hull)
@@ -380,6 +445,13 @@ void reshade::d3d11::device_context_impl::bind_index_buffer(api::resource buffer
 	assert(offset <= std::numeric_limits<UINT>::max());
 	assert(buffer.handle == 0 || index_size == 2 || index_size == 4);
 
+	if (!_state_usage.graphics)
+	{
+		state_usage usage = _state_usage;
+		usage.graphics = true;
+		track_state_usage(usage);
+	}
+
 	_orig->IASetIndexBuffer(reinterpret_cast<ID3D11Buffer *>(buffer.handle), index_size == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT, static_cast<UINT>(offset));
 }
 void reshade::d3d11::device_context_impl::bind_vertex_buffers(uint32_t first, uint32_t count, const api::resource *buffers, const uint64_t *offsets, const uint32_t *strides)
@@ -390,6 +462,13 @@ void reshade::d3d11::device_context_impl::bind_vertex_buffers(uint32_t first, ui
 		count = D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT;
 	}
 
+	if (first + count > _state_usage.num_vertex_buffers)
+	{
+		state_usage usage = _state_usage;
+		usage.num_vertex_buffers = first + count;
+		track_state_usage(usage);
+	}
+
 #ifndef WIN64
 	ID3D11Buffer *buffer_ptrs[D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
 	for (UINT i = 0; i < count; ++i)
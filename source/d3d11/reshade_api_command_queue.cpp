@@ -51,3 +51,54 @@ void reshade::d3d11::device_context_impl::flush_immediate_command_list() const
 
 	_orig->Flush();
 }
+
+uint64_t reshade::d3d11::device_context_impl::get_pending_fence_value()
+{
+	assert(_orig->GetType() == D3D11_DEVICE_CONTEXT_IMMEDIATE);
+
+	com_ptr<ID3D11Query> query;
+	if (!_free_fence_queries.empty())
+	{
+		query = std::move(_free_fence_queries.back());
+		_free_fence_queries.pop_back();
+	}
+	else
+	{
+		const D3D11_QUERY_DESC desc = { D3D11_QUERY_EVENT };
+		// D3D11 keeps resources alive and synchronizes access to them on its own, so a value that was already reached is still safe to hand out if no query can be created
+		if (FAILED(_device_impl->_orig->CreateQuery(&desc, &query)))
+			return get_completed_fence_value();
+	}
+
+	_orig->End(query.get());
+	_fence_queries.emplace_back(++_fence_value, std::move(query));
+
+	return _fence_value;
+}
+uint64_t reshade::d3d11::device_context_impl::get_completed_fence_value() const
+{
+	// Event queries complete in the order they were issued, so can stop at the first one that has not yet
+	while (!_fence_queries.empty() && _orig->GetData(_fence_queries.front().second.get(), nullptr, 0, D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK)
+	{
+		_completed_fence_value = _fence_queries.front().first;
+		_free_fence_queries.push_back(std::move(_fence_queries.front().second));
+		_fence_queries.pop_front();
+	}
+
+	return _completed_fence_value;
+}
+
+void reshade::d3d11::device_context_impl::execute_command_list(api::command_list *cmd_list)
+{
+	assert(_orig->GetType() == D3D11_DEVICE_CONTEXT_IMMEDIATE);
+
+	if (cmd_list == this)
+		return;
+
+	// Deferred context is reset after finishing, so it can be used to record new commands right away
+	com_ptr<ID3D11CommandList> d3d_cmd_list;
+	if (FAILED(static_cast<device_context_impl *>(cmd_list)->_orig->FinishCommandList(FALSE, &d3d_cmd_list)))
+		return;
+
+	_orig->ExecuteCommandList(d3d_cmd_list.get(), TRUE);
+}
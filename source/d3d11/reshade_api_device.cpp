@@ -6,8 +6,11 @@
 #include "dll_log.hpp"
 #include "dll_resources.hpp"
 #include "reshade_api_device.hpp"
+#include "reshade_api_device_context.hpp"
 #include "reshade_api_type_convert.hpp"
+#include "resource_ledger.hpp"
 #include <algorithm>
+#include <dxgi1_4.h>
 
 reshade::d3d11::device_impl::device_impl(ID3D11Device *device) :
 	api_object_impl(device)
@@ -16,6 +19,10 @@ reshade::d3d11::device_impl::device_impl(ID3D11Device *device) :
 	// Parent 'D3D11Device' object already holds a reference to this
 	_immediate_context_orig->Release();
 
+	_resources.set_unregister_callback([](void *context, ID3D11Resource *object) {
+		static_cast<device_impl *>(context)->_resource_desc_cache.erase(reinterpret_cast<uintptr_t>(object));
+	}, this);
+
 	// Create copy pipeline
 	{
 		D3D11_SAMPLER_DESC desc = {};
@@ -119,9 +126,40 @@ bool reshade::d3d11::device_impl::check_format_support(api::format format, api::
 	return true;
 }
 
+bool reshade::d3d11::device_impl::get_memory_budget(uint64_t *budget, uint64_t *usage) const
+{
+	// Budget information is only available through 'IDXGIAdapter3', which requires Windows 10
+	com_ptr<IDXGIDevice> dxgi_device;
+	com_ptr<IDXGIAdapter> dxgi_adapter;
+	com_ptr<IDXGIAdapter3> dxgi_adapter3;
+	if (FAILED(_orig->QueryInterface(&dxgi_device)) ||
+		FAILED(dxgi_device->GetAdapter(&dxgi_adapter)) ||
+		FAILED(dxgi_adapter->QueryInterface(&dxgi_adapter3)))
+		return false;
+
+	DXGI_QUERY_VIDEO_MEMORY_INFO info;
+	if (FAILED(dxgi_adapter3->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &info)))
+		return false;
+
+	*budget = info.Budget;
+	*usage = info.CurrentUsage;
+	return true;
+}
+uint64_t reshade::d3d11::device_impl::get_resource_memory_usage(api::resource_memory_owner owner, api::resource_memory_category category) const
+{
+	return resource_ledger::get_usage(this, owner, category);
+}
+
 bool reshade::d3d11::device_impl::is_resource_handle_valid(api::resource handle) const
 {
-	return handle.handle != 0 && _resources.has_object(reinterpret_cast<ID3D11Resource *>(handle.handle));
+	if (handle.handle == 0)
+		return false;
+
+	// Entries are removed from the cache when the resource is destroyed, so a hit means the handle is still valid
+	if (api::resource_desc desc; _resource_desc_cache.lookup(handle.handle, desc))
+		return true;
+
+	return _resources.has_object(reinterpret_cast<ID3D11Resource *>(handle.handle));
 }
 bool reshade::d3d11::device_impl::is_resource_view_handle_valid(api::resource_view handle) const
 {
@@ -147,6 +185,9 @@ bool reshade::d3d11::device_impl::create_sampler(const api::sampler_desc &desc,
 }
 bool reshade::d3d11::device_impl::create_resource(const api::resource_desc &desc, const api::subresource_data *initial_data, api::resource_usage, api::resource *out)
 {
+	// Keep track of how much memory ReShade and add-ons allocate (this also covers all the return paths below)
+	const resource_ledger::create_scope ledger_scope(this, desc, out, _ReturnAddress());
+
 	static_assert(sizeof(api::subresource_data) == sizeof(D3D11_SUBRESOURCE_DATA));
 
 	switch (desc.type)
@@ -755,6 +796,8 @@ void reshade::d3d11::device_impl::destroy_sampler(api::sampler handle)
 }
 void reshade::d3d11::device_impl::destroy_resource(api::resource handle)
 {
+	resource_ledger::unregister_resource(this, handle);
+
 	if (handle.handle != 0)
 		reinterpret_cast<IUnknown *>(handle.handle)->Release();
 }
@@ -794,6 +837,28 @@ void reshade::d3d11::device_impl::destroy_descriptor_sets(api::descriptor_set_la
 		delete reinterpret_cast<descriptor_set_impl *>(sets[i].handle);
 }
 
+bool reshade::d3d11::device_impl::create_command_list(api::command_list **out)
+{
+	com_ptr<ID3D11DeviceContext> context;
+	if (FAILED(_orig->CreateDeferredContext(0, &context)))
+	{
+		*out = nullptr;
+		return false;
+	}
+
+	*out = new device_context_impl(this, context.release());
+	return true;
+}
+void reshade::d3d11::device_impl::destroy_command_list(api::command_list *cmd_list)
+{
+	const auto cmd_list_impl = static_cast<device_context_impl *>(cmd_list);
+	ID3D11DeviceContext *const context = cmd_list_impl->_orig;
+
+	delete cmd_list_impl;
+
+	context->Release();
+}
+
 void reshade::d3d11::device_impl::update_descriptor_sets(uint32_t num_writes, const api::descriptor_set_write *writes, uint32_t num_copies, const api::descriptor_set_copy *copies)
 {
 	for (uint32_t i = 0; i < num_writes; ++i)
@@ -960,7 +1025,21 @@ void reshade::d3d11::device_impl::get_resource_from_view(api::resource_view view
 reshade::api::resource_desc reshade::d3d11::device_impl::get_resource_desc(api::resource resource) const
 {
 	assert(resource.handle != 0);
-	const auto object = reinterpret_cast<ID3D11Resource *>(resource.handle);
+
+	api::resource_desc desc;
+	if (_resource_desc_cache.lookup(resource.handle, desc))
+		return desc;
+
+	// Description of a resource never changes, so can cache it for as long as the resource is alive
+	const uint64_t generation = _resource_desc_cache.generation();
+	desc = get_resource_desc_uncached(reinterpret_cast<ID3D11Resource *>(resource.handle));
+	if (_resources.has_object(reinterpret_cast<ID3D11Resource *>(resource.handle)))
+		_resource_desc_cache.insert(resource.handle, desc, generation);
+
+	return desc;
+}
+reshade::api::resource_desc reshade::d3d11::device_impl::get_resource_desc_uncached(ID3D11Resource *object)
+{
 
 	D3D11_RESOURCE_DIMENSION dimension;
 	object->GetType(&dimension);
@@ -1003,7 +1082,8 @@ bool reshade::d3d11::device_impl::get_query_pool_results(api::query_pool pool, u
 
 	for (UINT i = 0; i < count; ++i)
 	{
-		if (FAILED(_immediate_context_orig->GetData(impl->queries[i + first].get(), static_cast<uint8_t *>(results) + i * stride, stride, D3D11_ASYNC_GETDATA_DONOTFLUSH)))
+		// Returns S_FALSE if the query has not finished on the GPU yet
+		if (_immediate_context_orig->GetData(impl->queries[i + first].get(), static_cast<uint8_t *>(results) + i * stride, stride, D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
 			return false;
 	}
 
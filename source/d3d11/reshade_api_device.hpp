@@ -7,6 +7,7 @@
 
 #include "com_ptr.hpp"
 #include "com_tracking.hpp"
+#include "resource_desc_cache.hpp"
 #include "addon_manager.hpp"
 #include <d3d11_4.h>
 
@@ -25,6 +26,9 @@ namespace reshade::d3d11
 		bool check_capability(api::device_caps capability) const final;
 		bool check_format_support(api::format format, api::resource_usage usage) const final;
 
+		bool get_memory_budget(uint64_t *budget, uint64_t *usage) const final;
+		uint64_t get_resource_memory_usage(api::resource_memory_owner owner, api::resource_memory_category category) const final;
+
 		bool is_resource_handle_valid(api::resource handle) const final;
 		bool is_resource_view_handle_valid(api::resource_view handle) const final;
 
@@ -64,11 +68,15 @@ namespace reshade::d3d11
 		void destroy_render_pass(api::render_pass handle) final;
 		void destroy_descriptor_sets(api::descriptor_set_layout layout, uint32_t count, const api::descriptor_set *sets) final;
 
+		bool create_command_list(api::command_list **out) final;
+		void destroy_command_list(api::command_list *cmd_list) final;
+
 		bool get_attachment(api::render_pass fbo, api::attachment_type type, uint32_t index, api::resource_view *out) const final;
 		uint32_t get_attachment_count(api::render_pass pass, api::attachment_type type) const final;
 
 		void get_resource_from_view(api::resource_view view, api::resource *out) const final;
 		api::resource_desc get_resource_desc(api::resource resource) const final;
+		static api::resource_desc get_resource_desc_uncached(ID3D11Resource *object);
 
 		bool map_resource(api::resource resource, uint32_t subresource, api::map_access access, void **data, uint32_t *row_pitch, uint32_t *slice_pitch) final;
 		void unmap_resource(api::resource resource, uint32_t subresource) final;
@@ -91,6 +99,8 @@ namespace reshade::d3d11
 		com_ptr<ID3D11SamplerState> _copy_sampler_state;
 
 	protected:
+		// Declared before the resource list, since that removes entries from it when destroyed
+		mutable resource_desc_cache _resource_desc_cache;
 		com_object_list<ID3D11View> _views;
 		com_object_list<ID3D11Resource> _resources;
 	};
@@ -5,6 +5,9 @@
 
 #pragma once
 
+#include "state_block.hpp"
+#include <deque>
+
 namespace reshade::d3d11
 {
 	class device_impl;
@@ -80,8 +83,15 @@ namespace reshade::d3d11
 
 		void flush_immediate_command_list() const final;
 
+		void execute_command_list(api::command_list *cmd_list) final;
+		// Buffers cannot stay mapped while the GPU reads from them in D3D11, so there is no persistently mapped ring buffer
+		bool allocate_upload_memory(uint64_t, uint64_t, void **out_data, api::resource *, uint64_t *) final { *out_data = nullptr; return false; }
+
 		void wait_idle() const final { /* no-op */ }
 
+		uint64_t get_pending_fence_value() final;
+		uint64_t get_completed_fence_value() const final;
+
 		void barrier(uint32_t count, const api::resource *resources, const api::resource_usage *old_states, const api::resource_usage *new_states) final;
 
 		void begin_render_pass(api::render_pass pass) final;
@@ -133,13 +143,25 @@ namespace reshade::d3d11
 		void insert_debug_marker(const char *label, const float color[4]) final;
 
 	private:
+		void track_state_usage(const state_usage &usage);
+		void track_slots(state_usage::slot_type type, api::shader_stage stages, UINT count);
+
 		device_impl *const _device_impl;
 		com_ptr<ID3DUserDefinedAnnotation> _annotations;
 		UINT _push_constants_size = 0;
 		com_ptr<ID3D11Buffer> _push_constants;
+		// Event queries that were issued for fence values, in the order they were issued, and queries that can be issued again
+		uint64_t _fence_value = 0;
+		mutable uint64_t _completed_fence_value = 0;
+		mutable std::deque<std::pair<uint64_t, com_ptr<ID3D11Query>>> _fence_queries;
+		mutable std::vector<com_ptr<ID3D11Query>> _free_fence_queries;
 
 	protected:
 		bool _has_open_render_pass = false;
 		struct render_pass_impl *_current_pass;
+		// Parts of the pipeline state that were modified through the API so far, which only ever grows
+		state_usage _state_usage;
+		// State block that currently holds the application state, which has to save any state that is about to be modified for the first time before that happens
+		state_block *_active_state_block = nullptr;
 	};
 }
@@ -85,6 +85,13 @@ bool reshade::d3d11::swapchain_impl::on_init()
 			return false;
 		if (FAILED(static_cast<device_impl *>(_device)->_orig->CreateShaderResourceView(_backbuffer_resolved.get(), nullptr, &_backbuffer_resolved_srv)))
 			return false;
+
+		// Stretching the resolved back buffer back into the multisampled one in 'on_present' modifies state directly on the immediate context (vertex buffer, sampler and shader resource view in the first slot of the pixel stage), so make sure the state block saves that too
+		state_usage &usage = static_cast<device_context_impl *>(_graphics_queue)->_state_usage;
+		usage.graphics = true;
+		usage.num_vertex_buffers = std::max(usage.num_vertex_buffers, 1u);
+		usage.num_slots[state_usage::samplers][4] = std::max(usage.num_slots[state_usage::samplers][4], 1u);
+		usage.num_slots[state_usage::shader_resources][4] = std::max(usage.num_slots[state_usage::shader_resources][4], 1u);
 	}
 	else
 	{
@@ -101,6 +108,10 @@ bool reshade::d3d11::swapchain_impl::on_init()
 	_height = swap_desc.BufferDesc.Height;
 	_backbuffer_format = convert_format(swap_desc.BufferDesc.Format);
 
+	// This fails if the device was created single-threaded, in which case techniques are simply rendered on the immediate context every frame
+	if (SUCCEEDED(static_cast<device_impl *>(_device)->_orig->CreateDeferredContext(0, &_recording_context_orig)))
+		_recording_context = std::make_unique<device_context_impl>(static_cast<device_impl *>(_device), _recording_context_orig.get());
+
 	return runtime::on_init(swap_desc.OutputWindow);
 }
 void reshade::d3d11::swapchain_impl::on_reset()
@@ -126,6 +137,34 @@ void reshade::d3d11::swapchain_impl::on_reset()
 	_backbuffer_resolved.reset();
 	_backbuffer_rtv.reset();
 	_backbuffer_resolved_srv.reset();
+
+	_recording_context.reset();
+	_recording_context_orig.reset();
+}
+
+reshade::api::command_list *reshade::d3d11::swapchain_impl::begin_technique_recording()
+{
+	return _recording_context.get();
+}
+uint64_t reshade::d3d11::swapchain_impl::finish_technique_recording()
+{
+	assert(_recording_context != nullptr);
+
+	// The deferred context is reset to its default state afterwards, which is what recording the next technique expects
+	com_ptr<ID3D11CommandList> cmd_list;
+	if (FAILED(_recording_context_orig->FinishCommandList(FALSE, &cmd_list)))
+		return 0;
+
+	return reinterpret_cast<uintptr_t>(cmd_list.release());
+}
+void reshade::d3d11::swapchain_impl::execute_technique_recording(uint64_t recording)
+{
+	// Keep the state of the immediate context intact, same as 'device_context_impl::execute_command_list'
+	static_cast<device_context_impl *>(_graphics_queue)->_orig->ExecuteCommandList(reinterpret_cast<ID3D11CommandList *>(recording), TRUE);
+}
+void reshade::d3d11::swapchain_impl::destroy_technique_recording(uint64_t recording)
+{
+	reinterpret_cast<ID3D11CommandList *>(recording)->Release();
 }
 
 void reshade::d3d11::swapchain_impl::on_present()
@@ -142,8 +181,12 @@ void reshade::d3d11::swapchain_impl::on_present()
 	if (!is_initialized())
 		return;
 
-	ID3D11DeviceContext *const immediate_context = static_cast<device_context_impl *>(_graphics_queue)->_orig;
-	_app_state.capture(immediate_context);
+	device_context_impl *const immediate_context_impl = static_cast<device_context_impl *>(_graphics_queue);
+	ID3D11DeviceContext *const immediate_context = immediate_context_impl->_orig;
+
+	// Only save the parts of the application state that ReShade modifies, and any additional parts right before these are modified for the first time during this frame
+	_app_state.capture(immediate_context, immediate_context_impl->_state_usage);
+	immediate_context_impl->_active_state_block = &_app_state;
 
 	// Resolve MSAA back buffer if MSAA is active
 	if (_backbuffer_resolved != _backbuffer)
@@ -179,9 +222,10 @@ void reshade::d3d11::swapchain_impl::on_present()
 	}
 
 	// Apply previous state from application
+	immediate_context_impl->_active_state_block = nullptr;
 	_app_state.apply_and_release();
 }
-bool reshade::d3d11::swapchain_impl::on_layer_submit(UINT eye, ID3D11Texture2D *source, const float bounds[4], ID3D11Texture2D **target)
+bool reshade::d3d11::swapchain_impl::on_layer_submit(UINT eye, ID3D11Texture2D *source, const float bounds[4], bool side_by_side, ID3D11Texture2D **target)
 {
 	assert(eye < 2 && source != nullptr);
 
@@ -201,7 +245,7 @@ bool reshade::d3d11::swapchain_impl::on_layer_submit(UINT eye, ID3D11Texture2D *
 	}
 
 	const UINT region_width = source_region.right - source_region.left;
-	const UINT target_width = region_width * 2;
+	const UINT target_width = side_by_side ? region_width * 2 : region_width;
 	const UINT region_height = source_region.bottom - source_region.top;
 
 	if (region_width == 0 || region_height == 0)
@@ -238,7 +282,7 @@ bool reshade::d3d11::swapchain_impl::on_layer_submit(UINT eye, ID3D11Texture2D *
 	}
 
 	// Copy region of the source texture (in case of an array texture, copy from the layer corresponding to the current eye)
-	static_cast<device_context_impl *>(_graphics_queue)->_orig->CopySubresourceRegion(_backbuffer.get(), 0, eye * region_width, 0, 0, source, source_desc.ArraySize == 2 ? eye : 0, &source_region);
+	static_cast<device_context_impl *>(_graphics_queue)->_orig->CopySubresourceRegion(_backbuffer.get(), 0, side_by_side ? eye * region_width : 0, 0, 0, source, source_desc.ArraySize == 2 ? eye : 0, &source_region);
 
 	*target = _backbuffer.get();
 
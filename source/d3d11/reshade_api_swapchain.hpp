@@ -27,14 +27,23 @@ namespace reshade::d3d11
 		bool on_init();
 		void on_reset();
 		void on_present();
-		bool on_layer_submit(UINT eye, ID3D11Texture2D *source, const float bounds[4], ID3D11Texture2D **target);
+		bool on_layer_submit(UINT eye, ID3D11Texture2D *source, const float bounds[4], bool side_by_side, ID3D11Texture2D **target);
 
 	private:
+		api::command_list *begin_technique_recording() final;
+		uint64_t finish_technique_recording() final;
+		void execute_technique_recording(uint64_t recording) final;
+		void destroy_technique_recording(uint64_t recording) final;
+
 		state_block _app_state;
 
 		com_ptr<ID3D11Texture2D> _backbuffer;
 		com_ptr<ID3D11Texture2D> _backbuffer_resolved;
 		com_ptr<ID3D11RenderTargetView> _backbuffer_rtv;
 		com_ptr<ID3D11ShaderResourceView> _backbuffer_resolved_srv;
+
+		// Deferred context that effect techniques are recorded into, so that the resulting command lists can be executed again in later frames (declared before its wrapper, which does not hold a reference)
+		com_ptr<ID3D11DeviceContext> _recording_context_orig;
+		std::unique_ptr<device_context_impl> _recording_context;
 	};
 }
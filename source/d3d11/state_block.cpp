@@ -4,6 +4,7 @@
  */
 
 #include "state_block.hpp"
+#include <algorithm>
 
 template <typename T>
 static inline void safe_release(T *&object)
@@ -15,6 +16,20 @@ static inline void safe_release(T *&object)
 	}
 }
 
+// Indexed by shader stage (see 'state_usage')
+static void (STDMETHODCALLTYPE ID3D11DeviceContext::*const s_get_constant_buffers[])(UINT, UINT, ID3D11Buffer **) = {
+	&ID3D11DeviceContext::VSGetConstantBuffers, &ID3D11DeviceContext::HSGetConstantBuffers, &ID3D11DeviceContext::DSGetConstantBuffers, &ID3D11DeviceContext::GSGetConstantBuffers, &ID3D11DeviceContext::PSGetConstantBuffers, &ID3D11DeviceContext::CSGetConstantBuffers };
+static void (STDMETHODCALLTYPE ID3D11DeviceContext::*const s_set_constant_buffers[])(UINT, UINT, ID3D11Buffer *const *) = {
+	&ID3D11DeviceContext::VSSetConstantBuffers, &ID3D11DeviceContext::HSSetConstantBuffers, &ID3D11DeviceContext::DSSetConstantBuffers, &ID3D11DeviceContext::GSSetConstantBuffers, &ID3D11DeviceContext::PSSetConstantBuffers, &ID3D11DeviceContext::CSSetConstantBuffers };
+static void (STDMETHODCALLTYPE ID3D11DeviceContext::*const s_get_samplers[])(UINT, UINT, ID3D11SamplerState **) = {
+	&ID3D11DeviceContext::VSGetSamplers, &ID3D11DeviceContext::HSGetSamplers, &ID3D11DeviceContext::DSGetSamplers, &ID3D11DeviceContext::GSGetSamplers, &ID3D11DeviceContext::PSGetSamplers, &ID3D11DeviceContext::CSGetSamplers };
+static void (STDMETHODCALLTYPE ID3D11DeviceContext::*const s_set_samplers[])(UINT, UINT, ID3D11SamplerState *const *) = {
+	&ID3D11DeviceContext::VSSetSamplers, &ID3D11DeviceContext::HSSetSamplers, &ID3D11DeviceContext::DSSetSamplers, &ID3D11DeviceContext::GSSetSamplers, &ID3D11DeviceContext::PSSetSamplers, &ID3D11DeviceContext::CSSetSamplers };
+static void (STDMETHODCALLTYPE ID3D11DeviceContext::*const s_get_shader_resources[])(UINT, UINT, ID3D11ShaderResourceView **) = {
+	&ID3D11DeviceContext::VSGetShaderResources, &ID3D11DeviceContext::HSGetShaderResources, &ID3D11DeviceContext::DSGetShaderResources, &ID3D11DeviceContext::GSGetShaderResources, &ID3D11DeviceContext::PSGetShaderResources, &ID3D11DeviceContext::CSGetShaderResources };
+static void (STDMETHODCALLTYPE ID3D11DeviceContext::*const s_set_shader_resources[])(UINT, UINT, ID3D11ShaderResourceView *const *) = {
+	&ID3D11DeviceContext::VSSetShaderResources, &ID3D11DeviceContext::HSSetShaderResources, &ID3D11DeviceContext::DSSetShaderResources, &ID3D11DeviceContext::GSSetShaderResources, &ID3D11DeviceContext::PSSetShaderResources, &ID3D11DeviceContext::CSSetShaderResources };
+
 reshade::d3d11::state_block::state_block(ID3D11Device *device)
 {
 	ZeroMemory(this, sizeof(*this));
@@ -26,126 +41,176 @@ reshade::d3d11::state_block::~state_block()
 	release_all_device_objects();
 }
 
-void reshade::d3d11::state_block::capture(ID3D11DeviceContext *device_context)
+void reshade::d3d11::state_block::capture(ID3D11DeviceContext *device_context, const state_usage &usage)
 {
 	_device_context = device_context;
+	_captured = {};
 
-	_device_context->IAGetPrimitiveTopology(&_ia_primitive_topology);
-	_device_context->IAGetInputLayout(&_ia_input_layout);
-
-	if (_device_feature_level > D3D_FEATURE_LEVEL_10_0)
-		_device_context->IAGetVertexBuffers(0, D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT, _ia_vertex_buffers, _ia_vertex_strides, _ia_vertex_offsets);
-	else
-		_device_context->IAGetVertexBuffers(0, D3D10_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT, _ia_vertex_buffers, _ia_vertex_strides, _ia_vertex_offsets);
-
-	_device_context->IAGetIndexBuffer(&_ia_index_buffer, &_ia_index_format, &_ia_index_offset);
-
-	_device_context->RSGetState(&_rs_state);
+	// Render targets are modified every frame to render effects and the overlay to the back buffer, so always save them
 	_device_context->RSGetViewports(&_rs_num_viewports, nullptr);
 	_device_context->RSGetViewports(&_rs_num_viewports, _rs_viewports);
 	_device_context->RSGetScissorRects(&_rs_num_scissor_rects, nullptr);
 	_device_context->RSGetScissorRects(&_rs_num_scissor_rects, _rs_scissor_rects);
 
-	_vs_num_class_instances = ARRAYSIZE(_vs_class_instances);
-	_device_context->VSGetShader(&_vs, _vs_class_instances, &_vs_num_class_instances);
-	_device_context->VSGetConstantBuffers(0, ARRAYSIZE(_vs_constant_buffers), _vs_constant_buffers);
-	_device_context->VSGetSamplers(0, ARRAYSIZE(_vs_sampler_states), _vs_sampler_states);
-	_device_context->VSGetShaderResources(0, ARRAYSIZE(_vs_shader_resources), _vs_shader_resources);
+	_device_context->OMGetRenderTargets(ARRAYSIZE(_om_render_targets), _om_render_targets, &_om_depth_stencil);
 
-	if (_device_feature_level >= D3D_FEATURE_LEVEL_10_0)
+	capture_additional(usage);
+}
+void reshade::d3d11::state_block::capture_additional(const state_usage &usage)
+{
+	assert(_device_context != nullptr);
+
+	if (usage.graphics && !_captured.graphics)
 	{
-		if (_device_feature_level >= D3D_FEATURE_LEVEL_11_0)
+		_captured.graphics = true;
+
+		_device_context->IAGetPrimitiveTopology(&_ia_primitive_topology);
+		_device_context->IAGetInputLayout(&_ia_input_layout);
+		_device_context->IAGetIndexBuffer(&_ia_index_buffer, &_ia_index_format, &_ia_index_offset);
+
+		_device_context->RSGetState(&_rs_state);
+
+		_vs_num_class_instances = ARRAYSIZE(_vs_class_instances);
+		_device_context->VSGetShader(&_vs, _vs_class_instances, &_vs_num_class_instances);
+
+		if (_device_feature_level >= D3D_FEATURE_LEVEL_10_0)
 		{
-			_hs_num_class_instances = ARRAYSIZE(_hs_class_instances);
-			_device_context->HSGetShader(&_hs, _hs_class_instances, &_hs_num_class_instances);
+			if (_device_feature_level >= D3D_FEATURE_LEVEL_11_0)
+			{
+				_hs_num_class_instances = ARRAYSIZE(_hs_class_instances);
+				_device_context->HSGetShader(&_hs, _hs_class_instances, &_hs_num_class_instances);
 
-			_ds_num_class_instances = ARRAYSIZE(_ds_class_instances);
-			_device_context->DSGetShader(&_ds, _ds_class_instances, &_ds_num_class_instances);
-		}
+				_ds_num_class_instances = ARRAYSIZE(_ds_class_instances);
+				_device_context->DSGetShader(&_ds, _ds_class_instances, &_ds_num_class_instances);
+			}
 
-		_gs_num_class_instances = ARRAYSIZE(_gs_class_instances);
-		_device_context->GSGetShader(&_gs, _gs_class_instances, &_gs_num_class_instances);
-	}
+			_gs_num_class_instances = ARRAYSIZE(_gs_class_instances);
+			_device_context->GSGetShader(&_gs, _gs_class_instances, &_gs_num_class_instances);
+		}
 
-	_ps_num_class_instances = ARRAYSIZE(_ps_class_instances);
-	_device_context->PSGetShader(&_ps, _ps_class_instances, &_ps_num_class_instances);
-	_device_context->PSGetConstantBuffers(0, ARRAYSIZE(_ps_constant_buffers), _ps_constant_buffers);
-	_device_context->PSGetSamplers(0, ARRAYSIZE(_ps_sampler_states), _ps_sampler_states);
-	_device_context->PSGetShaderResources(0, ARRAYSIZE(_ps_shader_resources), _ps_shader_resources);
+		_ps_num_class_instances = ARRAYSIZE(_ps_class_instances);
+		_device_context->PSGetShader(&_ps, _ps_class_instances, &_ps_num_class_instances);
 
-	_device_context->OMGetBlendState(&_om_blend_state, _om_blend_factor, &_om_sample_mask);
-	_device_context->OMGetDepthStencilState(&_om_depth_stencil_state, &_om_stencil_ref);
-	_device_context->OMGetRenderTargets(ARRAYSIZE(_om_render_targets), _om_render_targets, &_om_depth_stencil);
+		_device_context->OMGetBlendState(&_om_blend_state, _om_blend_factor, &_om_sample_mask);
+		_device_context->OMGetDepthStencilState(&_om_depth_stencil_state, &_om_stencil_ref);
+	}
 
-	if (_device_feature_level >= D3D_FEATURE_LEVEL_10_0)
+	if (usage.compute && !_captured.compute && _device_feature_level >= D3D_FEATURE_LEVEL_10_0)
 	{
+		_captured.compute = true;
+
 		_cs_num_class_instances = ARRAYSIZE(_cs_class_instances);
 		_device_context->CSGetShader(&_cs, _cs_class_instances, &_cs_num_class_instances);
-		_device_context->CSGetConstantBuffers(0, ARRAYSIZE(_cs_constant_buffers), _cs_constant_buffers);
-		_device_context->CSGetSamplers(0, ARRAYSIZE(_cs_sampler_states), _cs_sampler_states);
-		_device_context->CSGetShaderResources(0, ARRAYSIZE(_cs_shader_resources), _cs_shader_resources);
-		_device_context->CSGetUnorderedAccessViews(0,
-			_device_feature_level >= D3D_FEATURE_LEVEL_11_1 ? D3D11_1_UAV_SLOT_COUNT :
-			_device_feature_level == D3D_FEATURE_LEVEL_11_0 ? D3D11_PS_CS_UAV_REGISTER_COUNT : D3D11_CS_4_X_UAV_REGISTER_COUNT, _cs_unordered_access_views);
 	}
-}
-void reshade::d3d11::state_block::apply_and_release()
-{
-	_device_context->IASetPrimitiveTopology(_ia_primitive_topology);
-	_device_context->IASetInputLayout(_ia_input_layout);
 
 	// With D3D_FEATURE_LEVEL_10_0 or less, the maximum number of IA Vertex Input Slots is 16
 	// Starting with D3D_FEATURE_LEVEL_10_1 it is 32
 	// See https://docs.microsoft.com/windows/win32/direct3d11/overviews-direct3d-11-devices-downlevel-intro
-	if (_device_feature_level > D3D_FEATURE_LEVEL_10_0)
-		_device_context->IASetVertexBuffers(0, D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT, _ia_vertex_buffers, _ia_vertex_strides, _ia_vertex_offsets);
-	else
-		_device_context->IASetVertexBuffers(0, D3D10_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT, _ia_vertex_buffers, _ia_vertex_strides, _ia_vertex_offsets);
-
-	_device_context->IASetIndexBuffer(_ia_index_buffer, _ia_index_format, _ia_index_offset);
+	if (const UINT count = std::min<UINT>(usage.num_vertex_buffers, _device_feature_level > D3D_FEATURE_LEVEL_10_0 ? D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT : D3D10_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT);
+		count > _captured.num_vertex_buffers)
+	{
+		const UINT first = _captured.num_vertex_buffers;
+		_device_context->IAGetVertexBuffers(first, count - first, _ia_vertex_buffers + first, _ia_vertex_strides + first, _ia_vertex_offsets + first);
+		_captured.num_vertex_buffers = count;
+	}
 
-	_device_context->RSSetState(_rs_state);
-	_device_context->RSSetViewports(_rs_num_viewports, _rs_viewports);
-	_device_context->RSSetScissorRects(_rs_num_scissor_rects, _rs_scissor_rects);
+	if (const UINT count = std::min<UINT>(usage.num_unordered_access_views,
+			_device_feature_level >= D3D_FEATURE_LEVEL_11_1 ? D3D11_1_UAV_SLOT_COUNT :
+			_device_feature_level == D3D_FEATURE_LEVEL_11_0 ? D3D11_PS_CS_UAV_REGISTER_COUNT :
+			_device_feature_level >= D3D_FEATURE_LEVEL_10_0 ? D3D11_CS_4_X_UAV_REGISTER_COUNT : 0);
+		count > _captured.num_unordered_access_views)
+	{
+		const UINT first = _captured.num_unordered_access_views;
+		_device_context->CSGetUnorderedAccessViews(first, count - first, _cs_unordered_access_views + first);
+		_captured.num_unordered_access_views = count;
+	}
 
-	_device_context->VSSetShader(_vs, _vs_class_instances, _vs_num_class_instances);
-	_device_context->VSSetConstantBuffers(0, ARRAYSIZE(_vs_constant_buffers), _vs_constant_buffers);
-	_device_context->VSSetSamplers(0, ARRAYSIZE(_vs_sampler_states), _vs_sampler_states);
-	_device_context->VSSetShaderResources(0, ARRAYSIZE(_vs_shader_resources), _vs_shader_resources);
+	for (UINT stage = 0; stage < state_usage::num_stages; ++stage)
+	{
+		if (!is_stage_supported(stage))
+			continue;
 
-	if (_device_feature_level >= D3D_FEATURE_LEVEL_10_0)
+		if (const UINT count = std::min<UINT>(usage.num_slots[state_usage::constant_buffers][stage], D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT), first = _captured.num_slots[state_usage::constant_buffers][stage];
+			count > first)
+		{
+			(_device_context.get()->*s_get_constant_buffers[stage])(first, count - first, _constant_buffers[stage] + first);
+			_captured.num_slots[state_usage::constant_buffers][stage] = count;
+		}
+		if (const UINT count = std::min<UINT>(usage.num_slots[state_usage::samplers][stage], D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT), first = _captured.num_slots[state_usage::samplers][stage];
+			count > first)
+		{
+			(_device_context.get()->*s_get_samplers[stage])(first, count - first, _sampler_states[stage] + first);
+			_captured.num_slots[state_usage::samplers][stage] = count;
+		}
+		if (const UINT count = std::min<UINT>(usage.num_slots[state_usage::shader_resources][stage], D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT), first = _captured.num_slots[state_usage::shader_resources][stage];
+			count > first)
+		{
+			(_device_context.get()->*s_get_shader_resources[stage])(first, count - first, _shader_resources[stage] + first);
+			_captured.num_slots[state_usage::shader_resources][stage] = count;
+		}
+	}
+}
+void reshade::d3d11::state_block::apply_and_release()
+{
+	if (_captured.graphics)
 	{
-		if (_device_feature_level >= D3D_FEATURE_LEVEL_11_0)
+		_device_context->IASetPrimitiveTopology(_ia_primitive_topology);
+		_device_context->IASetInputLayout(_ia_input_layout);
+		_device_context->IASetIndexBuffer(_ia_index_buffer, _ia_index_format, _ia_index_offset);
+
+		_device_context->RSSetState(_rs_state);
+
+		_device_context->VSSetShader(_vs, _vs_class_instances, _vs_num_class_instances);
+
+		if (_device_feature_level >= D3D_FEATURE_LEVEL_10_0)
 		{
-			_device_context->HSSetShader(_hs, _hs_class_instances, _hs_num_class_instances);
-			_device_context->DSSetShader(_ds, _ds_class_instances, _ds_num_class_instances);
+			if (_device_feature_level >= D3D_FEATURE_LEVEL_11_0)
+			{
+				_device_context->HSSetShader(_hs, _hs_class_instances, _hs_num_class_instances);
+				_device_context->DSSetShader(_ds, _ds_class_instances, _ds_num_class_instances);
+			}
+
+			_device_context->GSSetShader(_gs, _gs_class_instances, _gs_num_class_instances);
 		}
 
-		_device_context->GSSetShader(_gs, _gs_class_instances, _gs_num_class_instances);
+		_device_context->PSSetShader(_ps, _ps_class_instances, _ps_num_class_instances);
+
+		_device_context->OMSetBlendState(_om_blend_state, _om_blend_factor, _om_sample_mask);
+		_device_context->OMSetDepthStencilState(_om_depth_stencil_state, _om_stencil_ref);
 	}
 
-	_device_context->PSSetShader(_ps, _ps_class_instances, _ps_num_class_instances);
-	_device_context->PSSetConstantBuffers(0, ARRAYSIZE(_ps_constant_buffers), _ps_constant_buffers);
-	_device_context->PSSetSamplers(0, ARRAYSIZE(_ps_sampler_states), _ps_sampler_states);
-	_device_context->PSSetShaderResources(0, ARRAYSIZE(_ps_shader_resources), _ps_shader_resources);
+	if (_captured.compute)
+	{
+		_device_context->CSSetShader(_cs, _cs_class_instances, _cs_num_class_instances);
+	}
 
-	_device_context->OMSetBlendState(_om_blend_state, _om_blend_factor, _om_sample_mask);
-	_device_context->OMSetDepthStencilState(_om_depth_stencil_state, _om_stencil_ref);
-	_device_context->OMSetRenderTargets(ARRAYSIZE(_om_render_targets), _om_render_targets, _om_depth_stencil);
+	if (_captured.num_vertex_buffers != 0)
+	{
+		_device_context->IASetVertexBuffers(0, _captured.num_vertex_buffers, _ia_vertex_buffers, _ia_vertex_strides, _ia_vertex_offsets);
+	}
 
-	if (_device_feature_level >= D3D_FEATURE_LEVEL_10_0)
+	if (_captured.num_unordered_access_views != 0)
 	{
-		_device_context->CSSetShader(_cs, _cs_class_instances, _cs_num_class_instances);
-		_device_context->CSSetConstantBuffers(0, ARRAYSIZE(_cs_constant_buffers), _cs_constant_buffers);
-		_device_context->CSSetSamplers(0, ARRAYSIZE(_cs_sampler_states), _cs_sampler_states);
-		_device_context->CSSetShaderResources(0, ARRAYSIZE(_cs_shader_resources), _cs_shader_resources);
 		UINT uav_initial_counts[D3D11_1_UAV_SLOT_COUNT];
 		FillMemory(uav_initial_counts, sizeof(uav_initial_counts), -1); // Keep the current offset
-		_device_context->CSSetUnorderedAccessViews(0,
-			_device_feature_level >= D3D_FEATURE_LEVEL_11_1 ? D3D11_1_UAV_SLOT_COUNT :
-			_device_feature_level == D3D_FEATURE_LEVEL_11_0 ? D3D11_PS_CS_UAV_REGISTER_COUNT : D3D11_CS_4_X_UAV_REGISTER_COUNT, _cs_unordered_access_views, uav_initial_counts);
+		_device_context->CSSetUnorderedAccessViews(0, _captured.num_unordered_access_views, _cs_unordered_access_views, uav_initial_counts);
 	}
 
+	for (UINT stage = 0; stage < state_usage::num_stages; ++stage)
+	{
+		if (const UINT count = _captured.num_slots[state_usage::constant_buffers][stage]; count != 0)
+			(_device_context.get()->*s_set_constant_buffers[stage])(0, count, _constant_buffers[stage]);
+		if (const UINT count = _captured.num_slots[state_usage::samplers][stage]; count != 0)
+			(_device_context.get()->*s_set_samplers[stage])(0, count, _sampler_states[stage]);
+		if (const UINT count = _captured.num_slots[state_usage::shader_resources][stage]; count != 0)
+			(_device_context.get()->*s_set_shader_resources[stage])(0, count, _shader_resources[stage]);
+	}
+
+	_device_context->RSSetViewports(_rs_num_viewports, _rs_viewports);
+	_device_context->RSSetScissorRects(_rs_num_scissor_rects, _rs_scissor_rects);
+
+	_device_context->OMSetRenderTargets(ARRAYSIZE(_om_render_targets), _om_render_targets, _om_depth_stencil);
+
 	release_all_device_objects();
 
 	_device_context.reset();
@@ -154,18 +219,12 @@ void reshade::d3d11::state_block::apply_and_release()
 void reshade::d3d11::state_block::release_all_device_objects()
 {
 	safe_release(_ia_input_layout);
-	for (auto &vertex_buffer : _ia_vertex_buffers)
-		safe_release(vertex_buffer);
+	for (UINT i = 0; i < _captured.num_vertex_buffers; i++)
+		safe_release(_ia_vertex_buffers[i]);
 	safe_release(_ia_index_buffer);
 	safe_release(_vs);
 	for (UINT i = 0; i < _vs_num_class_instances; i++)
 		safe_release(_vs_class_instances[i]);
-	for (auto &constant_buffer : _vs_constant_buffers)
-		safe_release(constant_buffer);
-	for (auto &sampler_state : _vs_sampler_states)
-		safe_release(sampler_state);
-	for (auto &shader_resource : _vs_shader_resources)
-		safe_release(shader_resource);
 	safe_release(_hs);
 	for (UINT i = 0; i < _hs_num_class_instances; i++)
 		safe_release(_hs_class_instances[i]);
@@ -179,12 +238,6 @@ void reshade::d3d11::state_block::release_all_device_objects()
 	safe_release(_ps);
 	for (UINT i = 0; i < _ps_num_class_instances; i++)
 		safe_release(_ps_class_instances[i]);
-	for (auto &constant_buffer : _ps_constant_buffers)
-		safe_release(constant_buffer);
-	for (auto &sampler_state : _ps_sampler_states)
-		safe_release(sampler_state);
-	for (auto &shader_resource : _ps_shader_resources)
-		safe_release(shader_resource);
 	safe_release(_om_blend_state);
 	safe_release(_om_depth_stencil_state);
 	for (auto &render_target : _om_render_targets)
@@ -193,12 +246,34 @@ void reshade::d3d11::state_block::release_all_device_objects()
 	safe_release(_cs);
 	for (UINT i = 0; i < _cs_num_class_instances; i++)
 		safe_release(_cs_class_instances[i]);
-	for (auto &constant_buffer : _cs_constant_buffers)
-		safe_release(constant_buffer);
-	for (auto &sampler_state : _cs_sampler_states)
-		safe_release(sampler_state);
-	for (auto &shader_resource : _cs_shader_resources)
-		safe_release(shader_resource);
-	for (auto &unordered_access_view : _cs_unordered_access_views)
-		safe_release(unordered_access_view);
+	for (UINT i = 0; i < _captured.num_unordered_access_views; i++)
+		safe_release(_cs_unordered_access_views[i]);
+
+	for (UINT stage = 0; stage < state_usage::num_stages; ++stage)
+	{
+		for (UINT i = 0; i < _captured.num_slots[state_usage::constant_buffers][stage]; i++)
+			safe_release(_constant_buffers[stage][i]);
+		for (UINT i = 0; i < _captured.num_slots[state_usage::samplers][stage]; i++)
+			safe_release(_sampler_states[stage][i]);
+		for (UINT i = 0; i < _captured.num_slots[state_usage::shader_resources][stage]; i++)
+			safe_release(_shader_resources[stage][i]);
+	}
+
+	_vs_num_class_instances = _hs_num_class_instances = _ds_num_class_instances = _gs_num_class_instances = _ps_num_class_instances = _cs_num_class_instances = 0;
+	_captured = {};
+}
+
+bool reshade::d3d11::state_block::is_stage_supported(UINT stage) const
+{
+	switch (stage)
+	{
+	case 1: // Hull
+	case 2: // Domain
+		return _device_feature_level >= D3D_FEATURE_LEVEL_11_0;
+	case 3: // Geometry
+	case 5: // Compute
+		return _device_feature_level >= D3D_FEATURE_LEVEL_10_0;
+	default:
+		return true;
+	}
 }
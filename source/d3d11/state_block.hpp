@@ -10,20 +10,50 @@
 
 namespace reshade::d3d11
 {
+	/// <summary>
+	/// Describes which parts of the pipeline state of a device context were modified through the API so far, which is all that a <see cref="state_block"/> has to save and restore.
+	/// </summary>
+	struct state_usage
+	{
+		enum slot_type { constant_buffers, samplers, shader_resources, num_slot_types };
+
+		// Vertex, hull, domain, geometry, pixel and compute stage (same order as the bits in 'api::shader_stage')
+		static constexpr UINT num_stages = 6;
+
+		// Input assembler, rasterizer and output merger state and the shaders of all graphics stages
+		bool graphics = false;
+		bool compute = false;
+		UINT num_vertex_buffers = 0;
+		// Unordered access views are only saved for the compute stage
+		UINT num_unordered_access_views = 0;
+		UINT num_slots[num_slot_types][num_stages] = {};
+	};
+
 	class state_block
 	{
 	public:
 		explicit state_block(ID3D11Device *device);
 		~state_block();
 
-		void capture(ID3D11DeviceContext *device_context);
+		/// <summary>
+		/// Saves the render targets, viewports and scissor rectangles and all parts of the pipeline state described by <paramref name="usage"/>.
+		/// </summary>
+		void capture(ID3D11DeviceContext *device_context, const state_usage &usage);
+		/// <summary>
+		/// Saves additional parts of the pipeline state after <see cref="capture"/> was called, which have to be restored as well because they are about to be modified for the first time.
+		/// Parts that were already saved are not touched.
+		/// </summary>
+		void capture_additional(const state_usage &usage);
 		void apply_and_release();
 
 	private:
 		void release_all_device_objects();
 
+		bool is_stage_supported(UINT stage) const;
+
 		D3D_FEATURE_LEVEL _device_feature_level;
 		com_ptr<ID3D11DeviceContext> _device_context;
+		state_usage _captured;
 		ID3D11InputLayout *_ia_input_layout;
 		D3D11_PRIMITIVE_TOPOLOGY _ia_primitive_topology;
 		ID3D11Buffer *_ia_vertex_buffers[D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
@@ -35,9 +65,6 @@ namespace reshade::d3d11
 		ID3D11VertexShader *_vs;
 		UINT _vs_num_class_instances;
 		ID3D11ClassInstance *_vs_class_instances[256];
-		ID3D11Buffer *_vs_constant_buffers[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
-		ID3D11SamplerState *_vs_sampler_states[D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT];
-		ID3D11ShaderResourceView *_vs_shader_resources[D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT];
 		ID3D11HullShader *_hs;
 		UINT _hs_num_class_instances;
 		ID3D11ClassInstance *_hs_class_instances[256];
@@ -55,9 +82,6 @@ namespace reshade::d3d11
 		ID3D11PixelShader *_ps;
 		UINT _ps_num_class_instances;
 		ID3D11ClassInstance *_ps_class_instances[256];
-		ID3D11Buffer *_ps_constant_buffers[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
-		ID3D11SamplerState *_ps_sampler_states[D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT];
-		ID3D11ShaderResourceView *_ps_shader_resources[D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT];
 		ID3D11BlendState *_om_blend_state;
 		FLOAT _om_blend_factor[4];
 		UINT _om_sample_mask;
@@ -65,12 +89,13 @@ namespace reshade::d3d11
 		UINT _om_stencil_ref;
 		ID3D11RenderTargetView *_om_render_targets[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT];
 		ID3D11DepthStencilView *_om_depth_stencil;
+		ID3D11ComputeShader *_cs;
 		UINT _cs_num_class_instances;
 		ID3D11ClassInstance *_cs_class_instances[256];
-		ID3D11Buffer *_cs_constant_buffers[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
-		ID3D11SamplerState *_cs_sampler_states[D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT];
-		ID3D11ShaderResourceView *_cs_shader_resources[D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT];
 		ID3D11UnorderedAccessView *_cs_unordered_access_views[D3D11_1_UAV_SLOT_COUNT];
-		ID3D11ComputeShader *_cs;
+		// Indexed by shader stage (see 'state_usage')
+		ID3D11Buffer *_constant_buffers[state_usage::num_stages][D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+		ID3D11SamplerState *_sampler_states[state_usage::num_stages][D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT];
+		ID3D11ShaderResourceView *_shader_resources[state_usage::num_stages][D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT];
 	};
 }
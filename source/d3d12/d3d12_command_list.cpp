@@ -6,13 +6,241 @@
 #include "dll_log.hpp"
 #include "d3d12_device.hpp"
 #include "d3d12_command_list.hpp"
+#include "profiling.hpp"
 #include "reshade_api_type_convert.hpp"
+#include "hook_manager.hpp"
+#include <mutex>
+#include <atomic>
+#include <shared_mutex>
+#include <unordered_map>
+
+// Virtual function table shared by all proxy objects, which is used to identify them (see 'D3D12GraphicsCommandList::from_interface')
+static std::atomic<const void *> s_proxy_vtable = nullptr;
 
 D3D12GraphicsCommandList::D3D12GraphicsCommandList(D3D12Device *device, ID3D12GraphicsCommandList *original) :
 	command_list_impl(device, original),
 	_device(device)
 {
 	assert(_orig != nullptr && _device != nullptr);
+
+	s_proxy_vtable.store(*reinterpret_cast<const void *const *>(static_cast<ID3D12GraphicsCommandList4 *>(this)), std::memory_order_relaxed);
+}
+
+// Virtual function table of the original command lists that was patched to call into the associated proxy objects (see 'D3D12GraphicsCommandList::hook_original_vtable')
+static std::atomic<const void *> s_hooked_vtable = nullptr;
+static std::mutex s_hooked_vtable_install_mutex;
+// Proxy objects associated with original command lists, since those are handed to the application directly in this mode
+static std::shared_mutex s_hooked_lists_mutex;
+static std::unordered_map<ID3D12CommandList *, D3D12GraphicsCommandList *> s_hooked_lists;
+// Incremented whenever the above changes, to invalidate the lookup cache of every thread
+static std::atomic<uint32_t> s_hooked_lists_version = 0;
+
+// Set while a hook calls into a proxy object, so that the calls to the original command list the proxy object (or an add-on) makes go straight to the trampoline
+static thread_local bool t_in_vtable_hook = false;
+// Command lists are usually recorded by one thread at a time, so the last lookup is often a hit
+static thread_local struct { ID3D12CommandList *orig; D3D12GraphicsCommandList *proxy; uint32_t version; } t_last_hooked_lookup = {};
+
+static D3D12GraphicsCommandList *find_hooked_list(ID3D12CommandList *list)
+{
+	const uint32_t version = s_hooked_lists_version.load(std::memory_order_acquire);
+	if (t_last_hooked_lookup.orig == list && t_last_hooked_lookup.version == version)
+		return t_last_hooked_lookup.proxy;
+
+	D3D12GraphicsCommandList *proxy = nullptr;
+	{ const std::shared_lock<std::shared_mutex> lock(s_hooked_lists_mutex);
+		if (const auto it = s_hooked_lists.find(list); it != s_hooked_lists.end())
+			proxy = it->second;
+	}
+
+	t_last_hooked_lookup = { list, proxy, version };
+	return proxy;
+}
+
+template <typename T, T method>
+struct vtable_hook;
+template <typename R, typename... Args, R(STDMETHODCALLTYPE D3D12GraphicsCommandList::*method)(Args...)>
+struct vtable_hook<R(STDMETHODCALLTYPE D3D12GraphicsCommandList::*)(Args...), method>
+{
+	static R STDMETHODCALLTYPE replacement(ID3D12GraphicsCommandList4 *list, Args... args)
+	{
+		static const auto trampoline = reshade::hooks::call(replacement);
+
+		// Command lists created by ReShade itself or while the proxy object is already handling a call are not redirected
+		if (!t_in_vtable_hook)
+		{
+			if (D3D12GraphicsCommandList *const proxy = find_hooked_list(list))
+			{
+				t_in_vtable_hook = true;
+				if constexpr (std::is_void_v<R>)
+				{
+					(proxy->*method)(args...);
+					t_in_vtable_hook = false;
+					return;
+				}
+				else
+				{
+					const R result = (proxy->*method)(args...);
+					t_in_vtable_hook = false;
+					return result;
+				}
+			}
+		}
+
+		return trampoline(list, args...);
+	}
+};
+
+static ULONG STDMETHODCALLTYPE ID3D12GraphicsCommandList_Release(ID3D12GraphicsCommandList4 *list)
+{
+	static const auto trampoline = reshade::hooks::call(ID3D12GraphicsCommandList_Release);
+
+	// Check whether this is the last reference before releasing it, so that the proxy object is destroyed while the original command list is still alive (like in 'D3D12GraphicsCommandList::Release')
+	if (list->AddRef() == 2)
+	{
+		D3D12GraphicsCommandList *proxy = nullptr;
+		{ const std::unique_lock<std::shared_mutex> lock(s_hooked_lists_mutex);
+			if (const auto it = s_hooked_lists.find(list); it != s_hooked_lists.end())
+			{
+				proxy = it->second;
+				s_hooked_lists.erase(it);
+				s_hooked_lists_version.fetch_add(1, std::memory_order_release);
+			}
+		}
+
+		if (proxy != nullptr)
+		{
+			t_in_vtable_hook = true;
+			delete proxy;
+			t_in_vtable_hook = false;
+		}
+	}
+
+	trampoline(list);
+	return trampoline(list);
+}
+
+bool D3D12GraphicsCommandList::hook_original_vtable(ID3D12CommandList *list)
+{
+	// All hooked methods are part of 'ID3D12GraphicsCommandList4', so the original command list has to implement it, with all the command list interfaces sharing a single virtual function table
+	if (!check_and_upgrade_interface(__uuidof(ID3D12GraphicsCommandList4)) || static_cast<ID3D12CommandList *>(_orig) != list)
+		return false;
+
+	reshade::hook::address *const vtable = vtable_from_instance(_orig);
+
+	if (s_hooked_vtable.load(std::memory_order_acquire) != vtable)
+	{
+		const std::lock_guard<std::mutex> lock(s_hooked_vtable_install_mutex);
+
+		// Only a single virtual function table can be patched, since hooks are identified by their replacement function (command lists of a different implementation, like those of the debug layer, keep using proxy objects)
+		if (s_hooked_vtable.load(std::memory_order_relaxed) == nullptr)
+		{
+#define INSTALL_VTABLE_HOOK(index, name) \
+	reshade::hooks::install("ID3D12GraphicsCommandList::" #name, vtable, index, reinterpret_cast<reshade::hook::address>(&vtable_hook<decltype(&D3D12GraphicsCommandList::name), &D3D12GraphicsCommandList::name>::replacement))
+
+			reshade::hooks::install("ID3D12GraphicsCommandList::Release", vtable, 2, reinterpret_cast<reshade::hook::address>(&ID3D12GraphicsCommandList_Release));
+		INSTALL_VTABLE_HOOK(7, GetDevice);
+		INSTALL_VTABLE_HOOK(9, Close);
+		INSTALL_VTABLE_HOOK(10, Reset);
+		INSTALL_VTABLE_HOOK(12, DrawInstanced);
+		INSTALL_VTABLE_HOOK(13, DrawIndexedInstanced);
+		INSTALL_VTABLE_HOOK(14, Dispatch);
+		INSTALL_VTABLE_HOOK(15, CopyBufferRegion);
+		INSTALL_VTABLE_HOOK(16, CopyTextureRegion);
+		INSTALL_VTABLE_HOOK(17, CopyResource);
+		INSTALL_VTABLE_HOOK(19, ResolveSubresource);
+		INSTALL_VTABLE_HOOK(20, IASetPrimitiveTopology);
+		INSTALL_VTABLE_HOOK(21, RSSetViewports);
+		INSTALL_VTABLE_HOOK(22, RSSetScissorRects);
+		INSTALL_VTABLE_HOOK(23, OMSetBlendFactor);
+		INSTALL_VTABLE_HOOK(24, OMSetStencilRef);
+		INSTALL_VTABLE_HOOK(25, SetPipelineState);
+		INSTALL_VTABLE_HOOK(26, ResourceBarrier);
+		INSTALL_VTABLE_HOOK(27, ExecuteBundle);
+		INSTALL_VTABLE_HOOK(28, SetDescriptorHeaps);
+		INSTALL_VTABLE_HOOK(29, SetComputeRootSignature);
+		INSTALL_VTABLE_HOOK(30, SetGraphicsRootSignature);
+		INSTALL_VTABLE_HOOK(31, SetComputeRootDescriptorTable);
+		INSTALL_VTABLE_HOOK(32, SetGraphicsRootDescriptorTable);
+		INSTALL_VTABLE_HOOK(33, SetComputeRoot32BitConstant);
+		INSTALL_VTABLE_HOOK(34, SetGraphicsRoot32BitConstant);
+		INSTALL_VTABLE_HOOK(35, SetComputeRoot32BitConstants);
+		INSTALL_VTABLE_HOOK(36, SetGraphicsRoot32BitConstants);
+		INSTALL_VTABLE_HOOK(37, SetComputeRootConstantBufferView);
+		INSTALL_VTABLE_HOOK(38, SetGraphicsRootConstantBufferView);
+		INSTALL_VTABLE_HOOK(43, IASetIndexBuffer);
+		INSTALL_VTABLE_HOOK(44, IASetVertexBuffers);
+		INSTALL_VTABLE_HOOK(46, OMSetRenderTargets);
+		INSTALL_VTABLE_HOOK(47, ClearDepthStencilView);
+		INSTALL_VTABLE_HOOK(48, ClearRenderTargetView);
+		INSTALL_VTABLE_HOOK(49, ClearUnorderedAccessViewUint);
+		INSTALL_VTABLE_HOOK(50, ClearUnorderedAccessViewFloat);
+		INSTALL_VTABLE_HOOK(59, ExecuteIndirect);
+		INSTALL_VTABLE_HOOK(60, AtomicCopyBufferUINT);
+		INSTALL_VTABLE_HOOK(61, AtomicCopyBufferUINT64);
+		INSTALL_VTABLE_HOOK(62, OMSetDepthBounds);
+		INSTALL_VTABLE_HOOK(63, SetSamplePositions);
+		INSTALL_VTABLE_HOOK(64, ResolveSubresourceRegion);
+		INSTALL_VTABLE_HOOK(65, SetViewInstanceMask);
+		INSTALL_VTABLE_HOOK(66, WriteBufferImmediate);
+		INSTALL_VTABLE_HOOK(67, SetProtectedResourceSession);
+		INSTALL_VTABLE_HOOK(68, BeginRenderPass);
+		INSTALL_VTABLE_HOOK(69, EndRenderPass);
+		INSTALL_VTABLE_HOOK(70, InitializeMetaCommand);
+		INSTALL_VTABLE_HOOK(71, ExecuteMetaCommand);
+		INSTALL_VTABLE_HOOK(72, BuildRaytracingAccelerationStructure);
+		INSTALL_VTABLE_HOOK(73, EmitRaytracingAccelerationStructurePostbuildInfo);
+		INSTALL_VTABLE_HOOK(74, CopyRaytracingAccelerationStructure);
+		INSTALL_VTABLE_HOOK(75, SetPipelineState1);
+		INSTALL_VTABLE_HOOK(76, DispatchRays);
+
+#undef INSTALL_VTABLE_HOOK
+
+			s_hooked_vtable.store(vtable, std::memory_order_release);
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	// The application keeps the reference to the original command list, which the proxy object only borrows from now on (see 'ID3D12GraphicsCommandList_Release')
+	{ const std::unique_lock<std::shared_mutex> lock(s_hooked_lists_mutex);
+		s_hooked_lists[list] = this;
+		s_hooked_lists_version.fetch_add(1, std::memory_order_release);
+	}
+
+	return true;
+}
+
+bool D3D12GraphicsCommandList::is_vtable_hooked(ID3D12CommandList *list)
+{
+	return list != nullptr && *reinterpret_cast<const void *const *>(list) == s_hooked_vtable.load(std::memory_order_relaxed);
+}
+
+D3D12GraphicsCommandList::bypass_vtable_hooks::bypass_vtable_hooks() :
+	_previous(t_in_vtable_hook)
+{
+	t_in_vtable_hook = true;
+}
+D3D12GraphicsCommandList::bypass_vtable_hooks::~bypass_vtable_hooks()
+{
+	t_in_vtable_hook = _previous;
+}
+
+D3D12GraphicsCommandList *D3D12GraphicsCommandList::from_interface(ID3D12CommandList *list)
+{
+	// Applications only ever see the proxy through its 'ID3D12GraphicsCommandList4' base (which all other command list interfaces are a prefix of), so the object starts with that virtual function table
+	if (list == nullptr)
+		return nullptr;
+
+	const void *const vtable = *reinterpret_cast<const void *const *>(list);
+	if (vtable == s_proxy_vtable.load(std::memory_order_relaxed))
+		return static_cast<D3D12GraphicsCommandList *>(static_cast<ID3D12GraphicsCommandList4 *>(list));
+	// Original command lists with a patched virtual function table are not proxy objects themselves, but have one associated with them
+	if (vtable == s_hooked_vtable.load(std::memory_order_relaxed))
+		return find_hooked_list(list);
+
+	return nullptr;
 }
 
 bool D3D12GraphicsCommandList::check_and_upgrade_interface(REFIID riid)
@@ -146,7 +374,7 @@ HRESULT STDMETHODCALLTYPE D3D12GraphicsCommandList::Reset(ID3D12CommandAllocator
 
 	const HRESULT hr = _orig->Reset(pAllocator, pInitialState);
 #if RESHADE_ADDON
-	if (SUCCEEDED(hr))
+	if (SUCCEEDED(hr) && reshade::has_addon_event<reshade::addon_event::bind_pipeline>())
 	{
 		reshade::api::pipeline_stage type = static_cast<reshade::api::pipeline_stage>(0);
 		if (pInitialState != nullptr)
@@ -173,24 +401,36 @@ void STDMETHODCALLTYPE D3D12GraphicsCommandList::ClearState(ID3D12PipelineState
 void STDMETHODCALLTYPE D3D12GraphicsCommandList::DrawInstanced(UINT VertexCountPerInstance, UINT InstanceCount, UINT StartVertexLocation, UINT StartInstanceLocation)
 {
 #if RESHADE_ADDON
-	if (reshade::invoke_addon_event<reshade::addon_event::draw>(this, VertexCountPerInstance, InstanceCount, StartVertexLocation, StartInstanceLocation))
-		return;
+	{
+		RESHADE_PROFILE_CALL("ID3D12GraphicsCommandList::DrawInstanced");
+
+		if (reshade::invoke_addon_event<reshade::addon_event::draw>(this, VertexCountPerInstance, InstanceCount, StartVertexLocation, StartInstanceLocation))
+			return;
+	}
 #endif
 	_orig->DrawInstanced(VertexCountPerInstance, InstanceCount, StartVertexLocation, StartInstanceLocation);
 }
 void STDMETHODCALLTYPE D3D12GraphicsCommandList::DrawIndexedInstanced(UINT IndexCountPerInstance, UINT InstanceCount, UINT StartIndexLocation, INT BaseVertexLocation, UINT StartInstanceLocation)
 {
 #if RESHADE_ADDON
-	if (reshade::invoke_addon_event<reshade::addon_event::draw_indexed>(this, IndexCountPerInstance, InstanceCount, StartIndexLocation, BaseVertexLocation, StartInstanceLocation))
-		return;
+	{
+		RESHADE_PROFILE_CALL("ID3D12GraphicsCommandList::DrawIndexedInstanced");
+
+		if (reshade::invoke_addon_event<reshade::addon_event::draw_indexed>(this, IndexCountPerInstance, InstanceCount, StartIndexLocation, BaseVertexLocation, StartInstanceLocation))
+			return;
+	}
 #endif
 	_orig->DrawIndexedInstanced(IndexCountPerInstance, InstanceCount, StartIndexLocation, BaseVertexLocation, StartInstanceLocation);
 }
 void STDMETHODCALLTYPE D3D12GraphicsCommandList::Dispatch(UINT ThreadGroupCountX, UINT ThreadGroupCountY, UINT ThreadGroupCountZ)
 {
 #if RESHADE_ADDON
-	if (reshade::invoke_addon_event<reshade::addon_event::dispatch>(this, ThreadGroupCountX, ThreadGroupCountY, ThreadGroupCountZ))
-		return;
+	{
+		RESHADE_PROFILE_CALL("ID3D12GraphicsCommandList::Dispatch");
+
+		if (reshade::invoke_addon_event<reshade::addon_event::dispatch>(this, ThreadGroupCountX, ThreadGroupCountY, ThreadGroupCountZ))
+			return;
+	}
 #endif
 	_orig->Dispatch(ThreadGroupCountX, ThreadGroupCountY, ThreadGroupCountZ);
 }
@@ -277,7 +517,8 @@ void STDMETHODCALLTYPE D3D12GraphicsCommandList::CopyTiles(ID3D12Resource *pTile
 void STDMETHODCALLTYPE D3D12GraphicsCommandList::ResolveSubresource(ID3D12Resource *pDstResource, UINT DstSubresource, ID3D12Resource *pSrcResource, UINT SrcSubresource, DXGI_FORMAT Format)
 {
 #if RESHADE_ADDON
-	if (reshade::invoke_addon_event<reshade::addon_event::resolve_texture_region>(this,
+	if (reshade::has_addon_event<reshade::addon_event::resolve_texture_region>() &&
+		reshade::invoke_addon_event<reshade::addon_event::resolve_texture_region>(this,
 		reshade::api::resource { reinterpret_cast<uintptr_t>(pSrcResource) }, SrcSubresource, nullptr,
 		reshade::api::resource { reinterpret_cast<uintptr_t>(pDstResource) }, DstSubresource, nullptr, reshade::d3d12::convert_format(Format)))
 		return;
@@ -318,6 +559,9 @@ void STDMETHODCALLTYPE D3D12GraphicsCommandList::OMSetBlendFactor(const FLOAT Bl
 	_orig->OMSetBlendFactor(BlendFactor);
 
 #if RESHADE_ADDON
+	if (!reshade::has_addon_event<reshade::addon_event::bind_pipeline_states>())
+		return;
+
 	const reshade::api::dynamic_state state = reshade::api::dynamic_state::blend_constant;
 	const uint32_t value = (BlendFactor == nullptr) ? 0xFFFFFFFF : // Default blend factor is { 1, 1, 1, 1 }
 		((static_cast<uint32_t>(BlendFactor[0] * 255.f) & 0xFF)) |
@@ -341,6 +585,11 @@ void STDMETHODCALLTYPE D3D12GraphicsCommandList::SetPipelineState(ID3D12Pipeline
 	_orig->SetPipelineState(pPipelineState);
 
 #if RESHADE_ADDON
+	RESHADE_PROFILE_CALL("ID3D12GraphicsCommandList::SetPipelineState");
+
+	if (!reshade::has_addon_event<reshade::addon_event::bind_pipeline>())
+		return;
+
 	reshade::api::pipeline_stage type = static_cast<reshade::api::pipeline_stage>(0);
 	if (pPipelineState != nullptr)
 	{
@@ -360,7 +609,9 @@ void STDMETHODCALLTYPE D3D12GraphicsCommandList::ResourceBarrier(UINT NumBarrier
 	_orig->ResourceBarrier(NumBarriers, pBarriers);
 
 #if RESHADE_ADDON
-	if (reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::barrier)].empty())
+	RESHADE_PROFILE_CALL("ID3D12GraphicsCommandList::ResourceBarrier");
+
+	if (!reshade::has_addon_event<reshade::addon_event::barrier>())
 		return;
 
 	const auto resources = static_cast<reshade::api::resource *>(alloca(NumBarriers * (sizeof(reshade::api::resource) + 2 * sizeof(reshade::api::resource_usage))));
@@ -397,7 +648,8 @@ void STDMETHODCALLTYPE D3D12GraphicsCommandList::ExecuteBundle(ID3D12GraphicsCom
 	assert(pCommandList != nullptr);
 
 	// Get original command list pointer from proxy object
-	const auto command_list_proxy = static_cast<D3D12GraphicsCommandList *>(pCommandList);
+	const auto command_list_proxy = from_interface(pCommandList);
+	assert(command_list_proxy != nullptr);
 
 #if RESHADE_ADDON
 	reshade::invoke_addon_event<reshade::addon_event::execute_secondary_command_list>(this, command_list_proxy);
@@ -447,6 +699,8 @@ void STDMETHODCALLTYPE D3D12GraphicsCommandList::SetGraphicsRootDescriptorTable(
 	_orig->SetGraphicsRootDescriptorTable(RootParameterIndex, BaseDescriptor);
 
 #if RESHADE_ADDON
+	RESHADE_PROFILE_CALL("ID3D12GraphicsCommandList::SetGraphicsRootDescriptorTable");
+
 	static_assert(sizeof(BaseDescriptor) == sizeof(reshade::api::descriptor_set));
 
 	reshade::invoke_addon_event<reshade::addon_event::bind_descriptor_sets>(
@@ -508,6 +762,8 @@ void STDMETHODCALLTYPE D3D12GraphicsCommandList::SetGraphicsRoot32BitConstants(U
 	_orig->SetGraphicsRoot32BitConstants(RootParameterIndex, Num32BitValuesToSet, pSrcData, DestOffsetIn32BitValues);
 
 #if RESHADE_ADDON
+	RESHADE_PROFILE_CALL("ID3D12GraphicsCommandList::SetGraphicsRoot32BitConstants");
+
 	reshade::invoke_addon_event<reshade::addon_event::push_constants>(
 		this,
 		reshade::api::shader_stage::all_graphics,
@@ -523,7 +779,7 @@ void STDMETHODCALLTYPE D3D12GraphicsCommandList::SetComputeRootConstantBufferVie
 	_orig->SetComputeRootConstantBufferView(RootParameterIndex, BufferLocation);
 
 #if RESHADE_ADDON
-	if (reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::push_descriptors)].empty())
+	if (!reshade::has_addon_event<reshade::addon_event::push_descriptors>())
 		return;
 
 	reshade::api::resource buffer = { 0 };
@@ -547,7 +803,9 @@ void STDMETHODCALLTYPE D3D12GraphicsCommandList::SetGraphicsRootConstantBufferVi
 	_orig->SetGraphicsRootConstantBufferView(RootParameterIndex, BufferLocation);
 
 #if RESHADE_ADDON
-	if (reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::push_descriptors)].empty())
+	RESHADE_PROFILE_CALL("ID3D12GraphicsCommandList::SetGraphicsRootConstantBufferView");
+
+	if (!reshade::has_addon_event<reshade::addon_event::push_descriptors>())
 		return;
 
 	reshade::api::resource buffer = { 0 };
@@ -586,7 +844,7 @@ void STDMETHODCALLTYPE D3D12GraphicsCommandList::IASetIndexBuffer(const D3D12_IN
 	_orig->IASetIndexBuffer(pView);
 
 #if RESHADE_ADDON
-	if (reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::bind_index_buffer)].empty())
+	if (!reshade::has_addon_event<reshade::addon_event::bind_index_buffer>())
 		return;
 
 	reshade::api::resource buffer = { 0 };
@@ -606,9 +864,11 @@ void STDMETHODCALLTYPE D3D12GraphicsCommandList::IASetVertexBuffers(UINT StartSl
 	_orig->IASetVertexBuffers(StartSlot, NumViews, pViews);
 
 #if RESHADE_ADDON
+	RESHADE_PROFILE_CALL("ID3D12GraphicsCommandList::IASetVertexBuffers");
+
 	assert(NumViews <= D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT);
 
-	if (reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::bind_vertex_buffers)].empty())
+	if (!reshade::has_addon_event<reshade::addon_event::bind_vertex_buffers>())
 		return;
 
 	reshade::api::resource buffers[D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
@@ -632,6 +892,8 @@ void STDMETHODCALLTYPE D3D12GraphicsCommandList::OMSetRenderTargets(UINT NumRend
 	_orig->OMSetRenderTargets(NumRenderTargetDescriptors, pRenderTargetDescriptors, RTsSingleHandleToDescriptorRange, pDepthStencilDescriptor);
 
 #if RESHADE_ADDON
+	RESHADE_PROFILE_CALL("ID3D12GraphicsCommandList::OMSetRenderTargets");
+
 	assert(NumRenderTargetDescriptors <= D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT);
 
 	if (_has_open_render_pass)
@@ -752,23 +1014,26 @@ void STDMETHODCALLTYPE D3D12GraphicsCommandList::SetSamplePositions(UINT NumSamp
 void STDMETHODCALLTYPE D3D12GraphicsCommandList::ResolveSubresourceRegion(ID3D12Resource *pDstResource, UINT DstSubresource, UINT DstX, UINT DstY, ID3D12Resource *pSrcResource, UINT SrcSubresource, D3D12_RECT *pSrcRect, DXGI_FORMAT Format, D3D12_RESOLVE_MODE ResolveMode)
 {
 #if RESHADE_ADDON
-	int32_t src_box[6];
-	const int32_t dst_offset[3] = { static_cast<int32_t>(DstX), static_cast<int32_t>(DstY), 0 };
-	if (pSrcRect != nullptr)
+	if (reshade::has_addon_event<reshade::addon_event::resolve_texture_region>())
 	{
-		src_box[0] = pSrcRect->left;
-		src_box[1] = pSrcRect->top;
-		src_box[2] = 0;
-		src_box[3] = pSrcRect->right;
-		src_box[4] = pSrcRect->bottom;
-		src_box[5] = 1;
-	}
+		int32_t src_box[6];
+		const int32_t dst_offset[3] = { static_cast<int32_t>(DstX), static_cast<int32_t>(DstY), 0 };
+		if (pSrcRect != nullptr)
+		{
+			src_box[0] = pSrcRect->left;
+			src_box[1] = pSrcRect->top;
+			src_box[2] = 0;
+			src_box[3] = pSrcRect->right;
+			src_box[4] = pSrcRect->bottom;
+			src_box[5] = 1;
+		}
 
-	if (reshade::invoke_addon_event<reshade::addon_event::resolve_texture_region>(this,
-		reshade::api::resource { reinterpret_cast<uintptr_t>(pSrcResource) }, SrcSubresource, pSrcRect != nullptr ? src_box : nullptr,
-		reshade::api::resource { reinterpret_cast<uintptr_t>(pDstResource) }, DstSubresource, DstX != 0 || DstY != 0 ? dst_offset : nullptr,
-		reshade::d3d12::convert_format(Format)))
-		return;
+		if (reshade::invoke_addon_event<reshade::addon_event::resolve_texture_region>(this,
+			reshade::api::resource { reinterpret_cast<uintptr_t>(pSrcResource) }, SrcSubresource, pSrcRect != nullptr ? src_box : nullptr,
+			reshade::api::resource { reinterpret_cast<uintptr_t>(pDstResource) }, DstSubresource, DstX != 0 || DstY != 0 ? dst_offset : nullptr,
+			reshade::d3d12::convert_format(Format)))
+			return;
+	}
 #endif
 
 	assert(_interface_version >= 1);
@@ -802,8 +1067,8 @@ void STDMETHODCALLTYPE D3D12GraphicsCommandList::BeginRenderPass(UINT NumRenderT
 	}
 
 	// Use clear events with explicit resource view references here, since this is invoked before render pass begin
-	if (!reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::clear_depth_stencil_view)].empty() ||
-		!reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::clear_render_target_view)].empty())
+	if (reshade::has_addon_event<reshade::addon_event::clear_depth_stencil_view>() ||
+		reshade::has_addon_event<reshade::addon_event::clear_render_target_view>())
 	{
 		for (UINT i = 0; i < NumRenderTargets; ++i)
 		{
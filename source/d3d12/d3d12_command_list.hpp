@@ -111,6 +111,36 @@ struct DECLSPEC_UUID("479B29E3-9A2C-11D0-B696-00A0C903487A") D3D12GraphicsComman
 
 	bool check_and_upgrade_interface(REFIID riid);
 
+	/// <summary>
+	/// Gets the proxy object for the specified command list pointer, or <see langword="nullptr"/> if it is not one (e.g. a compute command list).
+	/// This compares the virtual function table pointer instead of going through <c>QueryInterface</c>, so it does not touch the reference count.
+	/// </summary>
+	static D3D12GraphicsCommandList *from_interface(ID3D12CommandList *list);
+
+	/// <summary>
+	/// Patches the virtual function table of the original command list to call into this proxy object, so that the application can be handed the original command list instead of the proxy object.
+	/// This avoids the indirection through the proxy object on every call and the need to unwrap it again on submission.
+	/// </summary>
+	/// <param name="list">The original command list pointer that is handed to the application.</param>
+	/// <returns><see langword="true"/> if the virtual function table was patched, or <see langword="false"/> if the proxy object has to be handed out instead (e.g. because the command list uses a different virtual function table than the one that was patched first).</returns>
+	bool hook_original_vtable(ID3D12CommandList *list);
+	/// <summary>
+	/// Checks whether the specified command list pointer is an original command list with a patched virtual function table (see <see cref="hook_original_vtable"/>), which is passed to the driver as is.
+	/// </summary>
+	static bool is_vtable_hooked(ID3D12CommandList *list);
+
+	/// <summary>
+	/// Makes calls on the current thread to original command lists with a patched virtual function table go straight to the driver for the lifetime of this object, so that commands ReShade records into a command list of the application are not handled as if the application recorded them.
+	/// </summary>
+	struct bypass_vtable_hooks
+	{
+		bypass_vtable_hooks();
+		~bypass_vtable_hooks();
+
+	private:
+		const bool _previous;
+	};
+
 	ULONG _ref = 1;
 	unsigned int _interface_version = 0;
 	D3D12Device *const _device;
@@ -8,6 +8,7 @@
 #include "d3d12_command_list.hpp"
 #include "d3d12_command_queue.hpp"
 #include "d3d12_command_queue_downlevel.hpp"
+#include "profiling.hpp"
 
 D3D12CommandQueue::D3D12CommandQueue(D3D12Device *device, ID3D12CommandQueue *original) :
 	command_queue_impl(device, original),
@@ -146,31 +147,50 @@ void    STDMETHODCALLTYPE D3D12CommandQueue::CopyTileMappings(ID3D12Resource *pD
 }
 void    STDMETHODCALLTYPE D3D12CommandQueue::ExecuteCommandLists(UINT NumCommandLists, ID3D12CommandList *const *ppCommandLists)
 {
-	std::vector<ID3D12CommandList *> command_lists(NumCommandLists);
-	for (UINT i = 0; i < NumCommandLists; i++)
+	// Use a stack buffer for the common case, to avoid a heap allocation on every submission
+	ID3D12CommandList *command_lists_stack[64];
+	std::vector<ID3D12CommandList *> command_lists_heap;
+	ID3D12CommandList **const command_lists = NumCommandLists <= ARRAYSIZE(command_lists_stack) ? command_lists_stack : (command_lists_heap.resize(NumCommandLists), command_lists_heap.data());
+
 	{
-		assert(ppCommandLists[i] != nullptr);
+		RESHADE_PROFILE_SCOPE("ID3D12CommandQueue::ExecuteCommandLists");
+		RESHADE_PROFILE_CALL("ID3D12CommandQueue::ExecuteCommandLists");
 
-		if (com_ptr<D3D12GraphicsCommandList> command_list_proxy;
-			SUCCEEDED(ppCommandLists[i]->QueryInterface(&command_list_proxy)))
+		for (UINT i = 0; i < NumCommandLists; i++)
 		{
+			assert(ppCommandLists[i] != nullptr);
+
+			// Original command lists with a patched virtual function table are passed on as is, so only need to look up their proxy object when an add-on is interested in them
+			if (D3D12GraphicsCommandList::is_vtable_hooked(ppCommandLists[i]))
+			{
 #if RESHADE_ADDON
-			reshade::invoke_addon_event<reshade::addon_event::execute_command_list>(this, command_list_proxy.get());
+				if (reshade::has_addon_event<reshade::addon_event::execute_command_list>())
+					if (D3D12GraphicsCommandList *const command_list_proxy = D3D12GraphicsCommandList::from_interface(ppCommandLists[i]))
+						reshade::invoke_addon_event<reshade::addon_event::execute_command_list>(this, command_list_proxy);
 #endif
 
-			// Get original command list pointer from proxy object
-			command_lists[i] = command_list_proxy->_orig;
-		}
-		else
-		{
-			// This can be a compute command list too, which have no proxy object
-			command_lists[i] = ppCommandLists[i];
+				command_lists[i] = ppCommandLists[i];
+			}
+			else if (D3D12GraphicsCommandList *const command_list_proxy = D3D12GraphicsCommandList::from_interface(ppCommandLists[i]))
+			{
+#if RESHADE_ADDON
+				reshade::invoke_addon_event<reshade::addon_event::execute_command_list>(this, command_list_proxy);
+#endif
+
+				// Get original command list pointer from proxy object
+				command_lists[i] = command_list_proxy->_orig;
+			}
+			else
+			{
+				// This can be a compute command list too, which have no proxy object
+				command_lists[i] = ppCommandLists[i];
+			}
 		}
-	}
 
-	flush_immediate_command_list();
+		flush_immediate_command_list();
+	}
 
-	_orig->ExecuteCommandLists(NumCommandLists, command_lists.data());
+	_orig->ExecuteCommandLists(NumCommandLists, command_lists);
 }
 void    STDMETHODCALLTYPE D3D12CommandQueue::SetMarker(UINT Metadata, const void *pData, UINT Size)
 {
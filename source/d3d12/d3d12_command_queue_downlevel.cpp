@@ -8,6 +8,7 @@
 #include "d3d12_command_list.hpp"
 #include "d3d12_command_queue.hpp"
 #include "d3d12_command_queue_downlevel.hpp"
+#include "profiling.hpp"
 
 D3D12CommandQueueDownlevel::D3D12CommandQueueDownlevel(D3D12CommandQueue *queue, ID3D12CommandQueueDownlevel *original) :
 	swapchain_impl(queue->_device, queue, nullptr),
@@ -44,19 +45,40 @@ ULONG   STDMETHODCALLTYPE D3D12CommandQueueDownlevel::Release()
 
 HRESULT STDMETHODCALLTYPE D3D12CommandQueueDownlevel::Present(ID3D12GraphicsCommandList *pOpenCommandList, ID3D12Resource *pSourceTex2D, HWND hWindow, D3D12_DOWNLEVEL_PRESENT_FLAGS Flags)
 {
+	// Get original command list pointer from proxy object
+	if (D3D12GraphicsCommandList *const command_list_proxy = D3D12GraphicsCommandList::from_interface(pOpenCommandList))
+		pOpenCommandList = command_list_proxy->_orig;
+
+	{
+		RESHADE_PROFILE_SCOPE("ID3D12CommandQueueDownlevel::Present");
+
 #if RESHADE_ADDON
-	reshade::invoke_addon_event<reshade::addon_event::present>(_parent_queue, this);
+		reshade::invoke_addon_event<reshade::addon_event::present>(_parent_queue, this);
 #endif
 
-	assert(pSourceTex2D != nullptr);
-	swapchain_impl::on_present(pSourceTex2D, hWindow);
+		assert(pSourceTex2D != nullptr);
 
-	_parent_queue->flush_immediate_command_list();
+		// Record effects directly into the open command list of the application, so that they execute right after its rendering to the source texture and are submitted together with it
+		const auto immediate_command_list = static_cast<reshade::d3d12::command_list_immediate_impl *>(_parent_queue->get_immediate_command_list());
+		if (immediate_command_list != nullptr && pOpenCommandList != nullptr)
+		{
+			const D3D12GraphicsCommandList::bypass_vtable_hooks bypass;
 
-	// Get original command list pointer from proxy object
-	if (com_ptr<D3D12GraphicsCommandList> command_list_proxy;
-		SUCCEEDED(pOpenCommandList->QueryInterface(&command_list_proxy)))
-		pOpenCommandList = command_list_proxy->_orig;
+			immediate_command_list->begin_external_recording(_parent_queue->_orig, pOpenCommandList);
+			swapchain_impl::on_present(pSourceTex2D, hWindow);
+			immediate_command_list->end_external_recording();
+		}
+		else
+		{
+			swapchain_impl::on_present(pSourceTex2D, hWindow);
+		}
+	}
+
+	const HRESULT hr = _orig->Present(pOpenCommandList, pSourceTex2D, hWindow, Flags);
+
+	// Only signal completion of the commands recorded during present after they were submitted with the command list of the application
+	_parent_queue->flush_immediate_command_list();
+	_parent_queue->_device->advance_transient_descriptor_heaps(_parent_queue->_orig);
 
-	return _orig->Present(pOpenCommandList, pSourceTex2D, hWindow, Flags);
+	return hr;
 }
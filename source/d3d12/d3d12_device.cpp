@@ -4,6 +4,7 @@
  */
 
 #include "dll_log.hpp"
+#include "ini_file.hpp"
 #include "d3d12_device.hpp"
 #include "d3d12_device_downlevel.hpp"
 #include "d3d12_command_list.hpp"
@@ -21,6 +22,8 @@ D3D12Device::D3D12Device(ID3D12Device *original) :
 	// Add proxy object to the private data of the device, so that it can be retrieved again when only the original device is available
 	D3D12Device *const device_proxy = this;
 	_orig->SetPrivateData(__uuidof(D3D12Device), sizeof(device_proxy), &device_proxy);
+
+	reshade::global_config().get("APP", "PatchCommandListVtables", _patch_command_list_vtables);
 }
 
 bool D3D12Device::check_and_upgrade_interface(REFIID riid)
@@ -197,6 +200,7 @@ HRESULT STDMETHODCALLTYPE D3D12Device::CreateGraphicsPipelineState(const D3D12_G
 		return _orig->CreateGraphicsPipelineState(pDesc, riid, nullptr);
 
 	const reshade::api::pipeline_desc desc = reshade::d3d12::convert_pipeline_desc(*pDesc);
+	reshade::addon::compute_shader_hashes(desc);
 
 	if (reshade::api::pipeline replacement = { 0 };
 		reshade::invoke_addon_event<reshade::addon_event::create_pipeline>(this, desc, &replacement))
@@ -238,6 +242,7 @@ HRESULT STDMETHODCALLTYPE D3D12Device::CreateComputePipelineState(const D3D12_CO
 		return _orig->CreateComputePipelineState(pDesc, riid, nullptr);
 
 	const reshade::api::pipeline_desc desc = reshade::d3d12::convert_pipeline_desc(*pDesc);
+	reshade::addon::compute_shader_hashes(desc);
 
 	if (reshade::api::pipeline replacement = { 0 };
 		reshade::invoke_addon_event<reshade::addon_event::create_pipeline>(this, desc, &replacement))
@@ -275,7 +280,9 @@ HRESULT STDMETHODCALLTYPE D3D12Device::CreateCommandList(UINT nodeMask, D3D12_CO
 		// Upgrade to the actual interface version requested here (and only hook graphics command lists)
 		if (command_list_proxy->check_and_upgrade_interface(riid))
 		{
-			*ppCommandList = command_list_proxy;
+			// Keep handing out the original command list if its virtual function table could be patched to call into the proxy object instead
+			if (!_patch_command_list_vtables || !command_list_proxy->hook_original_vtable(static_cast<ID3D12CommandList *>(*ppCommandList)))
+				*ppCommandList = command_list_proxy;
 		}
 		else // Do not hook object if we do not support the requested interface
 		{
@@ -812,7 +819,9 @@ HRESULT STDMETHODCALLTYPE D3D12Device::CreateCommandList1(UINT NodeMask, D3D12_C
 		// Upgrade to the actual interface version requested here (and only hook graphics command lists)
 		if (command_list_proxy->check_and_upgrade_interface(riid))
 		{
-			*ppCommandList = command_list_proxy;
+			// Keep handing out the original command list if its virtual function table could be patched to call into the proxy object instead
+			if (!_patch_command_list_vtables || !command_list_proxy->hook_original_vtable(static_cast<ID3D12CommandList *>(*ppCommandList)))
+				*ppCommandList = command_list_proxy;
 		}
 		else // Do not hook object if we do not support the requested interface or this is a compute command list
 		{
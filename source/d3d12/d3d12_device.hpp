@@ -103,4 +103,5 @@ struct DECLSPEC_UUID("2523AFF4-978B-4939-BA16-8EE876A4CB2A") D3D12Device final :
 	LONG _ref = 1;
 	unsigned int _interface_version = 0;
 	D3D12DeviceDownlevel *_downlevel = nullptr;
+	bool _patch_command_list_vtables = false;
 };
@@ -6,22 +6,27 @@
 #pragma once
 
 #include "com_ptr.hpp"
+#include <atomic>
 #include <vector>
+#include <algorithm>
+#include <intrin.h>
 #include <d3d12.h>
 
 namespace reshade::d3d12
 {
 	class descriptor_heap_cpu
 	{
+		static const UINT pool_size = 1024;
+
 		struct heap_info
 		{
 			com_ptr<ID3D12DescriptorHeap> heap;
-			std::vector<bool> state;
 			SIZE_T heap_base;
+			UINT num_free;
+			// One bit per descriptor, set when the descriptor is free
+			uint64_t free_mask[pool_size / 64];
 		};
 
-		const UINT pool_size = 1024;
-
 	public:
 		descriptor_heap_cpu(ID3D12Device *device, D3D12_DESCRIPTOR_HEAP_TYPE type) :
 			_device(device), _type(type)
@@ -31,16 +36,25 @@ namespace reshade::d3d12
 
 		bool allocate(D3D12_CPU_DESCRIPTOR_HANDLE &handle)
 		{
-			for (heap_info &heap_info : _heap_infos)
+			// Start with the heap that last had a free slot, which is usually still the one that has space left
+			for (size_t i = 0; i < _heap_infos.size(); ++i)
 			{
-				// Find free empty in the heap
-				if (const auto it = std::find(heap_info.state.begin(), heap_info.state.end(), false);
-					it != heap_info.state.end())
+				const size_t heap_index = (_first_free_heap + i) % _heap_infos.size();
+				heap_info &heap_info = _heap_infos[heap_index];
+				if (heap_info.num_free == 0)
+					continue;
+
+				for (UINT word = 0; word < pool_size / 64; ++word)
 				{
-					const size_t index = it - heap_info.state.begin();
-					heap_info.state[index] = true; // Mark this entry as being in use
+					unsigned long bit;
+					if (!_BitScanForward64(&bit, heap_info.free_mask[word]))
+						continue;
+
+					heap_info.free_mask[word] &= ~(1ull << bit); // Mark this entry as being in use
+					heap_info.num_free--;
 
-					handle.ptr = heap_info.heap_base + index * _increment_size;
+					handle.ptr = heap_info.heap_base + (word * 64 + bit) * _increment_size;
+					_first_free_heap = heap_index;
 					return true;
 				}
 			}
@@ -51,19 +65,23 @@ namespace reshade::d3d12
 
 		void deallocate(D3D12_CPU_DESCRIPTOR_HANDLE handle)
 		{
-			for (heap_info &heap_info : _heap_infos)
-			{
-				const SIZE_T heap_beg = heap_info.heap_base;
-				const SIZE_T heap_end = heap_info.heap_base + pool_size * _increment_size;
+			// Find the heap with the highest base address that is not above the handle, which is the only one that can contain it
+			const auto it = std::upper_bound(_sorted_heaps.begin(), _sorted_heaps.end(), handle.ptr,
+				[](SIZE_T ptr, const std::pair<SIZE_T, size_t> &heap) { return ptr < heap.first; });
+			if (it == _sorted_heaps.begin())
+				return;
 
-				if (handle.ptr >= heap_beg && handle.ptr < heap_end)
-				{
-					const SIZE_T index = (handle.ptr - heap_beg) / _increment_size;
+			heap_info &heap_info = _heap_infos[std::prev(it)->second];
 
-					// Mark free slot in the descriptor heap
-					heap_info.state[index] = false;
-					break;
-				}
+			const SIZE_T index = (handle.ptr - heap_info.heap_base) / _increment_size;
+			if (index >= pool_size)
+				return; // Handle does not belong to this descriptor heap
+
+			// Mark free slot in the descriptor heap
+			if ((heap_info.free_mask[index / 64] & (1ull << (index % 64))) == 0)
+			{
+				heap_info.free_mask[index / 64] |= 1ull << (index % 64);
+				heap_info.num_free++;
 			}
 		}
 
@@ -85,13 +103,22 @@ namespace reshade::d3d12
 			}
 
 			heap_info.heap_base = heap_info.heap->GetCPUDescriptorHandleForHeapStart().ptr;
-			heap_info.state.resize(pool_size);
+			heap_info.num_free = pool_size;
+			std::fill_n(heap_info.free_mask, pool_size / 64, ~0ull);
+
+			_first_free_heap = _heap_infos.size() - 1;
+
+			const std::pair<SIZE_T, size_t> sorted_heap(heap_info.heap_base, _heap_infos.size() - 1);
+			_sorted_heaps.insert(std::upper_bound(_sorted_heaps.begin(), _sorted_heaps.end(), sorted_heap), sorted_heap);
 
 			return true;
 		}
 
 		ID3D12Device *const _device;
 		std::vector<heap_info> _heap_infos;
+		// Base address and index of every heap, sorted by address to find the heap a handle belongs to with a binary search
+		std::vector<std::pair<SIZE_T, size_t>> _sorted_heaps;
+		size_t _first_free_heap = 0;
 		SIZE_T _increment_size;
 		D3D12_DESCRIPTOR_HEAP_TYPE _type;
 	};
@@ -99,6 +126,8 @@ namespace reshade::d3d12
 	template <D3D12_DESCRIPTOR_HEAP_TYPE type, UINT static_size, UINT transient_size>
 	class descriptor_heap_gpu
 	{
+		static const UINT MAX_FRAMES_IN_FLIGHT = 8;
+
 	public:
 		explicit descriptor_heap_gpu(ID3D12Device *device, UINT node_mask = 0)
 		{
@@ -156,24 +185,65 @@ namespace reshade::d3d12
 		}
 		bool allocate_transient(UINT count, D3D12_CPU_DESCRIPTOR_HANDLE &base_handle, D3D12_GPU_DESCRIPTOR_HANDLE &base_handle_gpu)
 		{
-			if (_heap == nullptr)
+			if (_heap == nullptr || count > transient_size)
 				return false;
 
-			SIZE_T index = static_cast<SIZE_T>(_current_transient_tail % transient_size);
+			// Command lists may be recorded on multiple threads, so reserve the range with a compare-and-swap
+			UINT64 tail = _current_transient_tail.load(std::memory_order_relaxed);
+			UINT64 new_tail;
+			SIZE_T index;
+			do
+			{
+				index = static_cast<SIZE_T>(tail % transient_size);
 
-			// Allocations need to be contiguous
-			if (index + count > transient_size)
-				_current_transient_tail += transient_size - index, index = 0;
+				// Allocations need to be contiguous
+				new_tail = tail + count;
+				if (index + count > transient_size)
+					new_tail += transient_size - index, index = 0;
+
+				// Never overwrite descriptors that may still be referenced by frames the GPU has not finished yet
+				if (new_tail - _retired_transient_tail.load(std::memory_order_acquire) > transient_size)
+					return false;
+			}
+			while (!_current_transient_tail.compare_exchange_weak(tail, new_tail, std::memory_order_relaxed));
 
 			const SIZE_T offset = index * _increment_size;
 			base_handle.ptr = _transient_heap_base + offset;
 			base_handle_gpu.ptr = _transient_heap_base_gpu + offset;
 
-			_current_transient_tail += count;
-
 			return true;
 		}
 
+		/// <summary>
+		/// Marks the end of a frame, whose transient descriptors can be reused once the GPU reached the specified fence value.
+		/// This and <see cref="retire_transient_frames"/> have to be called from a single thread (the one presenting).
+		/// </summary>
+		void end_transient_frame(UINT64 fence_value)
+		{
+			// Drop the oldest frame if the GPU is that far behind, which only delays reusing its descriptors until a later frame retires
+			if (_num_pending_frames == MAX_FRAMES_IN_FLIGHT)
+			{
+				_first_pending_frame = (_first_pending_frame + 1) % MAX_FRAMES_IN_FLIGHT;
+				_num_pending_frames--;
+			}
+
+			pending_frame &frame = _pending_frames[(_first_pending_frame + _num_pending_frames) % MAX_FRAMES_IN_FLIGHT];
+			frame.fence_value = fence_value;
+			frame.transient_tail = _current_transient_tail.load(std::memory_order_relaxed);
+			_num_pending_frames++;
+		}
+		/// <summary>
+		/// Makes the transient descriptors of all frames the GPU finished executing (up to the specified fence value) available for allocation again.
+		/// </summary>
+		void retire_transient_frames(UINT64 completed_fence_value)
+		{
+			for (; _num_pending_frames != 0 && _pending_frames[_first_pending_frame].fence_value <= completed_fence_value; _num_pending_frames--)
+			{
+				_retired_transient_tail.store(_pending_frames[_first_pending_frame].transient_tail, std::memory_order_release);
+				_first_pending_frame = (_first_pending_frame + 1) % MAX_FRAMES_IN_FLIGHT;
+			}
+		}
+
 		void deallocate(D3D12_GPU_DESCRIPTOR_HANDLE handle, UINT count = 1)
 		{
 			// Ensure this handle falls into the static range of this heap
@@ -231,7 +301,15 @@ namespace reshade::d3d12
 		SIZE_T _transient_heap_base;
 		UINT64 _transient_heap_base_gpu;
 		SIZE_T _current_static_index = 0;
-		UINT64 _current_transient_tail = 0;
+		std::atomic<UINT64> _current_transient_tail = 0;
+		std::atomic<UINT64> _retired_transient_tail = 0;
+		struct pending_frame
+		{
+			UINT64 fence_value;
+			UINT64 transient_tail;
+		} _pending_frames[MAX_FRAMES_IN_FLIGHT] = {};
+		UINT _first_pending_frame = 0;
+		UINT _num_pending_frames = 0;
 		std::vector<std::pair<UINT64, UINT64>> _free_list;
 	};
 }
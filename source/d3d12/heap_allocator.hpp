@@ -0,0 +1,245 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include "com_ptr.hpp"
+#include <map>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <d3d12.h>
+
+namespace reshade::d3d12
+{
+	/// <summary>
+	/// Sub-allocates small resources as placed resources from a set of larger shared heaps, instead of creating a committed resource (and thus a separate heap) for each one.
+	/// </summary>
+	class heap_allocator
+	{
+		static constexpr UINT64 block_size = 64 * 1024 * 1024;
+		// Resources larger than this are still created as committed resources, to avoid wasting large parts of the shared heaps
+		static constexpr UINT64 max_placed_size = block_size / 4;
+
+		// Heaps are split by resource category, since resource heap tier 1 hardware cannot mix buffers and textures in one heap
+		// Render target and depth-stencil textures are never placed, since placed ones would have to be discarded or fully cleared before their first use, which callers do not guarantee
+		enum heap_category { category_buffers, category_non_rt_ds_textures, num_categories };
+		// Only the default, upload and readback heap types are supported (these are consecutive, starting at one)
+		static constexpr UINT num_heap_types = 3;
+
+		struct heap_block
+		{
+			com_ptr<ID3D12Heap> heap;
+			// Free ranges in this heap, sorted by offset, so that adjacent ranges can be merged again on deallocation
+			std::map<UINT64, UINT64> free_ranges;
+			UINT64 used_size;
+		};
+
+		struct placement
+		{
+			heap_block *block;
+			D3D12_HEAP_TYPE type;
+			heap_category category;
+			UINT64 offset;
+			UINT64 size;
+		};
+
+	public:
+		explicit heap_allocator(ID3D12Device *device) : _device(device) {}
+
+		/// <summary>
+		/// Creates a resource, placing it into one of the shared heaps if possible, or as a committed resource otherwise.
+		/// </summary>
+		HRESULT create_resource(const D3D12_HEAP_PROPERTIES &heap_props, D3D12_HEAP_FLAGS heap_flags, D3D12_RESOURCE_DESC desc, D3D12_RESOURCE_STATES initial_state, const D3D12_CLEAR_VALUE *clear_value, ID3D12Resource **out)
+		{
+			if (heap_flags == D3D12_HEAP_FLAG_NONE && heap_props.Type >= D3D12_HEAP_TYPE_DEFAULT && heap_props.Type <= D3D12_HEAP_TYPE_READBACK && desc.SampleDesc.Count <= 1 &&
+				(desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) == 0)
+			{
+				const heap_category category = desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER ? category_buffers : category_non_rt_ds_textures;
+
+				// Small textures may use a reduced alignment, which the runtime rejects by returning a different alignment if not possible
+				D3D12_RESOURCE_ALLOCATION_INFO alloc_info = { UINT64_MAX, 0 };
+				if (category == category_non_rt_ds_textures)
+				{
+					desc.Alignment = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+					alloc_info = _device->GetResourceAllocationInfo(0, 1, &desc);
+					if (alloc_info.Alignment != D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT)
+						desc.Alignment = 0;
+				}
+				if (desc.Alignment == 0)
+					alloc_info = _device->GetResourceAllocationInfo(0, 1, &desc);
+
+				if (alloc_info.SizeInBytes != UINT64_MAX && alloc_info.SizeInBytes <= max_placed_size)
+				{
+					const std::lock_guard<std::mutex> lock(_mutex);
+
+					if (placement alloc; allocate(heap_props.Type, category, alloc_info, alloc))
+					{
+						if (SUCCEEDED(_device->CreatePlacedResource(alloc.block->heap.get(), alloc.offset, &desc, initial_state, clear_value, IID_PPV_ARGS(out))))
+						{
+							_placements.emplace(*out, alloc);
+							return S_OK;
+						}
+
+						deallocate(alloc);
+					}
+				}
+
+				desc.Alignment = 0;
+			}
+
+			return _device->CreateCommittedResource(&heap_props, heap_flags, &desc, initial_state, clear_value, IID_PPV_ARGS(out));
+		}
+
+		/// <summary>
+		/// Returns the memory of a placed resource to its heap. This has to be called once the resource was destroyed.
+		/// Does nothing if the resource was not created through this allocator.
+		/// </summary>
+		void free(ID3D12Resource *resource)
+		{
+			const std::lock_guard<std::mutex> lock(_mutex);
+
+			if (const auto it = _placements.find(resource); it != _placements.end())
+			{
+				deallocate(it->second);
+				_placements.erase(it);
+			}
+		}
+
+		/// <summary>
+		/// Gets the total size of all shared heaps and how much of that is currently in use by placed resources, to keep track of video memory usage.
+		/// </summary>
+		void get_memory_usage(UINT64 &used_size, UINT64 &heap_size) const
+		{
+			const std::lock_guard<std::mutex> lock(_mutex);
+
+			used_size = heap_size = 0;
+
+			for (UINT type = 0; type < num_heap_types; ++type)
+			{
+				for (UINT category = 0; category < num_categories; ++category)
+				{
+					for (const std::unique_ptr<heap_block> &block : _blocks[type][category])
+					{
+						used_size += block->used_size;
+						heap_size += block_size;
+					}
+				}
+			}
+		}
+
+	private:
+		bool allocate(D3D12_HEAP_TYPE type, heap_category category, const D3D12_RESOURCE_ALLOCATION_INFO &alloc_info, placement &alloc)
+		{
+			std::vector<std::unique_ptr<heap_block>> &blocks = _blocks[type - D3D12_HEAP_TYPE_DEFAULT][category];
+
+			alloc.type = type;
+			alloc.category = category;
+
+			for (const std::unique_ptr<heap_block> &block : blocks)
+				if (allocate_from_block(*block, alloc_info, alloc))
+					return true;
+
+			D3D12_HEAP_DESC heap_desc = {};
+			heap_desc.SizeInBytes = block_size;
+			heap_desc.Properties.Type = type;
+			// Use MSAA alignment for the heap, even though no multisampled resources are placed, since it is a multiple of all other alignments
+			heap_desc.Alignment = D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT;
+			switch (category)
+			{
+			case category_buffers:
+				heap_desc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+				break;
+			case category_non_rt_ds_textures:
+				heap_desc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+				break;
+			}
+
+			auto &block = blocks.emplace_back(std::make_unique<heap_block>());
+			if (FAILED(_device->CreateHeap(&heap_desc, IID_PPV_ARGS(&block->heap))))
+			{
+				blocks.pop_back();
+				return false; // Caller falls back to a committed resource
+			}
+
+			block->free_ranges.emplace(0, block_size);
+			block->used_size = 0;
+
+			return allocate_from_block(*block, alloc_info, alloc);
+		}
+		void deallocate(const placement &alloc)
+		{
+			heap_block &block = *alloc.block;
+			block.used_size -= alloc.size;
+
+			// Merge with the adjacent free ranges
+			UINT64 offset = alloc.offset;
+			UINT64 size = alloc.size;
+
+			auto next = block.free_ranges.lower_bound(offset);
+			if (next != block.free_ranges.end() && offset + size == next->first)
+			{
+				size += next->second;
+				next = block.free_ranges.erase(next);
+			}
+			if (next != block.free_ranges.begin())
+			{
+				auto prev = std::prev(next);
+				if (prev->first + prev->second == offset)
+				{
+					offset = prev->first;
+					size += prev->second;
+					block.free_ranges.erase(prev);
+				}
+			}
+
+			block.free_ranges.emplace(offset, size);
+
+			// Release heaps as soon as they became empty, so that memory is returned once the resources using it are gone
+			std::vector<std::unique_ptr<heap_block>> &blocks = _blocks[alloc.type - D3D12_HEAP_TYPE_DEFAULT][alloc.category];
+			if (block.used_size == 0)
+			{
+				blocks.erase(std::find_if(blocks.begin(), blocks.end(),
+					[&block](const std::unique_ptr<heap_block> &it) { return it.get() == &block; }));
+			}
+		}
+
+		static bool allocate_from_block(heap_block &block, const D3D12_RESOURCE_ALLOCATION_INFO &alloc_info, placement &alloc)
+		{
+			// First fit, which is good enough given the small number of resources the runtime creates
+			for (auto it = block.free_ranges.begin(); it != block.free_ranges.end(); ++it)
+			{
+				const UINT64 range_offset = it->first;
+				const UINT64 range_size = it->second;
+
+				const UINT64 offset = (range_offset + alloc_info.Alignment - 1) & ~(alloc_info.Alignment - 1);
+				if (offset + alloc_info.SizeInBytes > range_offset + range_size)
+					continue;
+
+				block.free_ranges.erase(it);
+				if (offset > range_offset)
+					block.free_ranges.emplace(range_offset, offset - range_offset);
+				if (offset + alloc_info.SizeInBytes < range_offset + range_size)
+					block.free_ranges.emplace(offset + alloc_info.SizeInBytes, (range_offset + range_size) - (offset + alloc_info.SizeInBytes));
+
+				block.used_size += alloc_info.SizeInBytes;
+
+				alloc.block = &block;
+				alloc.offset = offset;
+				alloc.size = alloc_info.SizeInBytes;
+				return true;
+			}
+
+			return false;
+		}
+
+		ID3D12Device *const _device;
+		mutable std::mutex _mutex;
+		std::vector<std::unique_ptr<heap_block>> _blocks[num_heap_types][num_categories];
+		std::unordered_map<ID3D12Resource *, placement> _placements;
+	};
+}
@@ -51,6 +51,21 @@ void reshade::d3d12::command_list_impl::barrier(uint32_t count, const api::resou
 
 	_has_commands = true;
 
+	if (_defer_barriers)
+		_pending_barriers.add(count, resources, old_states, new_states);
+	else
+		submit_barriers(count, resources, old_states, new_states);
+}
+void reshade::d3d12::command_list_impl::flush_barriers()
+{
+	if (_pending_barriers.empty())
+		return;
+
+	submit_barriers(_pending_barriers.size(), _pending_barriers.resources.data(), _pending_barriers.old_states.data(), _pending_barriers.new_states.data());
+	_pending_barriers.clear();
+}
+void reshade::d3d12::command_list_impl::submit_barriers(uint32_t count, const api::resource *resources, const api::resource_usage *old_states, const api::resource_usage *new_states)
+{
 	const auto barriers = static_cast<D3D12_RESOURCE_BARRIER *>(alloca(sizeof(D3D12_RESOURCE_BARRIER) * count));
 	for (UINT i = 0; i < count; ++i)
 	{
@@ -76,6 +91,8 @@ void reshade::d3d12::command_list_impl::barrier(uint32_t count, const api::resou
 
 void reshade::d3d12::command_list_impl::begin_render_pass(api::render_pass pass)
 {
+	flush_barriers();
+
 	assert(pass.handle != 0);
 	const auto pass_impl = reinterpret_cast<const render_pass_impl *>(pass.handle);
 
@@ -133,6 +150,11 @@ void reshade::d3d12::command_list_impl::bind_pipeline_states(uint32_t count, con
 		case api::dynamic_state::primitive_topology:
 			_orig->IASetPrimitiveTopology(convert_primitive_topology(static_cast<api::primitive_topology>(values[i])));
 			break;
+		case api::dynamic_state::shading_rate:
+			if (com_ptr<ID3D12GraphicsCommandList5> cmd_list5;
+				SUCCEEDED(_orig->QueryInterface(&cmd_list5)))
+				cmd_list5->RSSetShadingRate(static_cast<D3D12_SHADING_RATE>(values[i]), nullptr);
+			break;
 		default:
 			assert(false);
 			break;
@@ -332,6 +354,8 @@ void reshade::d3d12::command_list_impl::bind_vertex_buffers(uint32_t first, uint
 
 void reshade::d3d12::command_list_impl::draw(uint32_t vertices, uint32_t instances, uint32_t first_vertex, uint32_t first_instance)
 {
+	flush_barriers();
+
 	_has_commands = true;
 
 	assert(_has_open_render_pass);
@@ -340,6 +364,8 @@ void reshade::d3d12::command_list_impl::draw(uint32_t vertices, uint32_t instanc
 }
 void reshade::d3d12::command_list_impl::draw_indexed(uint32_t indices, uint32_t instances, uint32_t first_index, int32_t vertex_offset, uint32_t first_instance)
 {
+	flush_barriers();
+
 	_has_commands = true;
 
 	assert(_has_open_render_pass);
@@ -348,6 +374,8 @@ void reshade::d3d12::command_list_impl::draw_indexed(uint32_t indices, uint32_t
 }
 void reshade::d3d12::command_list_impl::dispatch(uint32_t num_groups_x, uint32_t num_groups_y, uint32_t num_groups_z)
 {
+	flush_barriers();
+
 	_has_commands = true;
 
 	_orig->Dispatch(num_groups_x, num_groups_y, num_groups_z);
@@ -359,6 +387,8 @@ void reshade::d3d12::command_list_impl::draw_or_dispatch_indirect(api::indirect_
 
 void reshade::d3d12::command_list_impl::copy_resource(api::resource src, api::resource dst)
 {
+	flush_barriers();
+
 	_has_commands = true;
 
 	assert(src.handle != 0 && dst.handle != 0);
@@ -367,6 +397,8 @@ void reshade::d3d12::command_list_impl::copy_resource(api::resource src, api::re
 }
 void reshade::d3d12::command_list_impl::copy_buffer_region(api::resource src, uint64_t src_offset, api::resource dst, uint64_t dst_offset, uint64_t size)
 {
+	flush_barriers();
+
 	_has_commands = true;
 
 	assert(src.handle != 0 && dst.handle != 0);
@@ -378,6 +410,8 @@ void reshade::d3d12::command_list_impl::copy_buffer_region(api::resource src, ui
 }
 void reshade::d3d12::command_list_impl::copy_buffer_to_texture(api::resource src, uint64_t src_offset, uint32_t row_length, uint32_t slice_height, api::resource dst, uint32_t dst_subresource, const int32_t dst_box[6])
 {
+	flush_barriers();
+
 	_has_commands = true;
 
 	assert(src.handle != 0 && dst.handle != 0);
@@ -406,7 +440,7 @@ void reshade::d3d12::command_list_impl::copy_buffer_to_texture(api::resource src
 	src_copy_location.PlacedFootprint.Footprint.Width = row_length != 0 ? row_length : src_box.right - src_box.left;
 	src_copy_location.PlacedFootprint.Footprint.Height = slice_height != 0 ? slice_height : src_box.bottom - src_box.top;
 	src_copy_location.PlacedFootprint.Footprint.Depth = src_box.back - src_box.front;
-	src_copy_location.PlacedFootprint.Footprint.RowPitch = src_copy_location.PlacedFootprint.Footprint.Width * api::format_bpp(convert_format(res_desc.Format));
+	src_copy_location.PlacedFootprint.Footprint.RowPitch = api::format_row_pitch(convert_format(res_desc.Format), src_copy_location.PlacedFootprint.Footprint.Width);
 	src_copy_location.PlacedFootprint.Footprint.RowPitch = (src_copy_location.PlacedFootprint.Footprint.RowPitch + D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1u) & ~(D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1u);
 
 	D3D12_TEXTURE_COPY_LOCATION dst_copy_location;
@@ -420,6 +454,8 @@ void reshade::d3d12::command_list_impl::copy_buffer_to_texture(api::resource src
 }
 void reshade::d3d12::command_list_impl::copy_texture_region(api::resource src, uint32_t src_subresource, const int32_t src_box[6], api::resource dst, uint32_t dst_subresource, const int32_t dst_box[6], api::filter_type)
 {
+	flush_barriers();
+
 	_has_commands = true;
 
 	assert(src.handle != 0 && dst.handle != 0);
@@ -444,6 +480,8 @@ void reshade::d3d12::command_list_impl::copy_texture_region(api::resource src, u
 }
 void reshade::d3d12::command_list_impl::copy_texture_to_buffer(api::resource src, uint32_t src_subresource, const int32_t src_box[6], api::resource dst, uint64_t dst_offset, uint32_t row_length, uint32_t slice_height)
 {
+	flush_barriers();
+
 	_has_commands = true;
 
 	assert(src.handle != 0 && dst.handle != 0);
@@ -463,7 +501,7 @@ void reshade::d3d12::command_list_impl::copy_texture_to_buffer(api::resource src
 	dst_copy_location.PlacedFootprint.Footprint.Width = row_length != 0 ? row_length : std::max(1u, static_cast<UINT>(res_desc.Width) >> (src_subresource % res_desc.MipLevels));
 	dst_copy_location.PlacedFootprint.Footprint.Height = slice_height != 0 ? slice_height : std::max(1u, res_desc.Height >> (src_subresource % res_desc.MipLevels));
 	dst_copy_location.PlacedFootprint.Footprint.Depth = 1;
-	dst_copy_location.PlacedFootprint.Footprint.RowPitch = dst_copy_location.PlacedFootprint.Footprint.Width * api::format_bpp(convert_format(res_desc.Format));
+	dst_copy_location.PlacedFootprint.Footprint.RowPitch = api::format_row_pitch(convert_format(res_desc.Format), dst_copy_location.PlacedFootprint.Footprint.Width);
 	dst_copy_location.PlacedFootprint.Footprint.RowPitch = (dst_copy_location.PlacedFootprint.Footprint.RowPitch + D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1u) & ~(D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1u);
 
 	_orig->CopyTextureRegion(
@@ -472,6 +510,8 @@ void reshade::d3d12::command_list_impl::copy_texture_to_buffer(api::resource src
 }
 void reshade::d3d12::command_list_impl::resolve_texture_region(api::resource src, uint32_t src_subresource, const int32_t src_box[6], api::resource dst, uint32_t dst_subresource, const int32_t dst_offset[3], api::format format)
 {
+	flush_barriers();
+
 	_has_commands = true;
 
 	assert(src.handle != 0 && dst.handle != 0);
@@ -505,6 +545,8 @@ void reshade::d3d12::command_list_impl::resolve_texture_region(api::resource src
 
 void reshade::d3d12::command_list_impl::clear_attachments(api::attachment_type clear_flags, const float color[4], float depth, uint8_t stencil, uint32_t num_rects, const int32_t *rects)
 {
+	flush_barriers();
+
 	_has_commands = true;
 
 	if (static_cast<UINT>(clear_flags & (api::attachment_type::color)) != 0)
@@ -515,6 +557,8 @@ void reshade::d3d12::command_list_impl::clear_attachments(api::attachment_type c
 }
 void reshade::d3d12::command_list_impl::clear_depth_stencil_view(api::resource_view dsv, api::attachment_type clear_flags, float depth, uint8_t stencil, uint32_t num_rects, const int32_t *rects)
 {
+	flush_barriers();
+
 	_has_commands = true;
 
 	assert(dsv.handle != 0);
@@ -523,6 +567,8 @@ void reshade::d3d12::command_list_impl::clear_depth_stencil_view(api::resource_v
 }
 void reshade::d3d12::command_list_impl::clear_render_target_view(api::resource_view rtv, const float color[4], uint32_t num_rects, const int32_t *rects)
 {
+	flush_barriers();
+
 	_has_commands = true;
 
 	assert(rtv.handle != 0);
@@ -531,6 +577,8 @@ void reshade::d3d12::command_list_impl::clear_render_target_view(api::resource_v
 }
 void reshade::d3d12::command_list_impl::clear_unordered_access_view_uint(api::resource_view uav, const uint32_t values[4], uint32_t num_rects, const int32_t *rects)
 {
+	flush_barriers();
+
 	_has_commands = true;
 
 	assert(uav.handle != 0);
@@ -557,6 +605,8 @@ void reshade::d3d12::command_list_impl::clear_unordered_access_view_uint(api::re
 }
 void reshade::d3d12::command_list_impl::clear_unordered_access_view_float(api::resource_view uav, const float values[4], uint32_t num_rects, const int32_t *rects)
 {
+	flush_barriers();
+
 	_has_commands = true;
 
 	assert(uav.handle != 0);
@@ -584,6 +634,8 @@ void reshade::d3d12::command_list_impl::clear_unordered_access_view_float(api::r
 
 void reshade::d3d12::command_list_impl::generate_mipmaps(api::resource_view srv)
 {
+	flush_barriers();
+
 	assert(srv.handle != 0);
 	api::resource resource_handle;
 	_device_impl->get_resource_from_view(srv, &resource_handle);
@@ -626,7 +678,9 @@ void reshade::d3d12::command_list_impl::generate_mipmaps(api::resource_view srv)
 	if (_current_descriptor_heaps[0] != view_heap && _current_descriptor_heaps[1] != view_heap)
 		_orig->SetDescriptorHeaps(1, &view_heap);
 
-	_orig->SetComputeRootSignature(_device_impl->_mipmap_signature.get());
+	// Keep track of the root signature change, so that the next call to 'bind_descriptor_sets' restores the previous one
+	_current_root_signature[1] = _device_impl->_mipmap_signature.get();
+	_orig->SetComputeRootSignature(_current_root_signature[1]);
 	_orig->SetPipelineState(_device_impl->_mipmap_pipeline.get());
 
 	D3D12_RESOURCE_BARRIER transition = { D3D12_RESOURCE_BARRIER_TYPE_TRANSITION };
@@ -687,15 +741,17 @@ void reshade::d3d12::command_list_impl::finish_query(api::query_pool pool, api::
 	UINT private_size = sizeof(ID3D12Resource *);
 	if (SUCCEEDED(heap_object->GetPrivateData(pipeline_extra_data_guid, &private_size, &readback_resource)))
 	{
-		_orig->ResolveQueryData(reinterpret_cast<ID3D12QueryHeap *>(pool.handle), convert_query_type(type), index, 1, readback_resource.get(), index * sizeof(uint64_t));
+		_orig->ResolveQueryData(reinterpret_cast<ID3D12QueryHeap *>(pool.handle), d3d_query_type, index, 1, readback_resource.get(), index * static_cast<UINT64>(convert_query_type_to_result_size(type)));
 	}
 }
 void reshade::d3d12::command_list_impl::copy_query_pool_results(api::query_pool pool, api::query_type type, uint32_t first, uint32_t count, api::resource dst, uint64_t dst_offset, uint32_t stride)
 {
+	flush_barriers();
+
 	_has_commands = true;
 
 	assert(pool.handle != 0);
-	assert(stride == sizeof(uint64_t));
+	assert(stride == convert_query_type_to_result_size(type));
 
 	_orig->ResolveQueryData(reinterpret_cast<ID3D12QueryHeap *>(pool.handle), convert_query_type(type), first, count, reinterpret_cast<ID3D12Resource *>(dst.handle), dst_offset);
 }
@@ -6,6 +6,7 @@
 #pragma once
 
 #include "addon_manager.hpp"
+#include "barrier_batch.hpp"
 #include <d3d12.h>
 
 namespace reshade::d3d12
@@ -22,6 +23,11 @@ namespace reshade::d3d12
 
 		void barrier(uint32_t count, const api::resource *resources, const api::resource_usage *old_states, const api::resource_usage *new_states) final;
 
+		/// <summary>
+		/// Submits all barriers that were deferred since the last command that depended on them (see <see cref="_defer_barriers"/>).
+		/// </summary>
+		void flush_barriers();
+
 		void begin_render_pass(api::render_pass pass) final;
 		void finish_render_pass() final;
 
@@ -65,6 +71,10 @@ namespace reshade::d3d12
 		void finish_debug_event() final;
 		void insert_debug_marker(const char *label, const float color[4]) final;
 
+		// Collect barriers until the next command that depends on them instead of submitting them right away, so that they are batched and redundant transitions cancel out
+		// Only enabled on command lists ReShade records itself, since commands the application records directly would not flush them
+		bool _defer_barriers = false;
+
 	protected:
 		device_impl *const _device_impl;
 		bool _has_commands = false;
@@ -76,5 +86,10 @@ namespace reshade::d3d12
 		// Currently bound render target and depth-stencil views
 		bool _has_open_render_pass = false;
 		struct render_pass_impl *_current_pass;
+
+	private:
+		void submit_barriers(uint32_t count, const api::resource *resources, const api::resource_usage *old_states, const api::resource_usage *new_states);
+
+		barrier_batch _pending_barriers;
 	};
 }
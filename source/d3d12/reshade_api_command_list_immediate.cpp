@@ -7,15 +7,16 @@
 #include "reshade_api_device.hpp"
 #include "reshade_api_command_list_immediate.hpp"
 
-reshade::d3d12::command_list_immediate_impl::command_list_immediate_impl(device_impl *device) :
-	command_list_impl(device, nullptr)
+reshade::d3d12::command_list_immediate_impl::command_list_immediate_impl(device_impl *device, D3D12_COMMAND_LIST_TYPE type) :
+	command_list_impl(device, nullptr),
+	_type(type)
 {
+	_defer_barriers = true;
+
 	// Create multiple command allocators to buffer for multiple frames
-	for (UINT i = 0; i < NUM_COMMAND_FRAMES; ++i)
+	for (UINT i = 0; i < MIN_COMMAND_FRAMES; ++i)
 	{
-		if (FAILED(_device_impl->_orig->CreateFence(_fence_value[i], D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&_fence[i]))))
-			return;
-		if (FAILED(_device_impl->_orig->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&_cmd_alloc[i]))))
+		if (!create_command_frame(i))
 			return;
 	}
 
@@ -25,7 +26,7 @@ reshade::d3d12::command_list_immediate_impl::command_list_immediate_impl(device_
 		return;
 
 	// Create and open the command list for recording
-	if (SUCCEEDED(_device_impl->_orig->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, _cmd_alloc[_cmd_index].get(), nullptr, IID_PPV_ARGS(&_orig))))
+	if (SUCCEEDED(_device_impl->_orig->CreateCommandList(0, type, _cmd_alloc[_cmd_index].get(), nullptr, IID_PPV_ARGS(&_orig))))
 		_orig->SetName(L"ReShade immediate command list");
 }
 reshade::d3d12::command_list_immediate_impl::~command_list_immediate_impl()
@@ -35,15 +36,39 @@ reshade::d3d12::command_list_immediate_impl::~command_list_immediate_impl()
 	if (_fence_event != nullptr)
 		CloseHandle(_fence_event);
 
+	_upload_ring.destroy(_device_impl);
+
 	// Signal to 'command_list_impl' destructor that this is an immediate command list
 	_has_commands = false;
 }
 
+bool reshade::d3d12::command_list_immediate_impl::create_command_frame(UINT index)
+{
+	assert(index == _num_frames && index < MAX_COMMAND_FRAMES);
+
+	if (FAILED(_device_impl->_orig->CreateFence(_fence_value[index], D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&_fence[index]))))
+		return false;
+	if (FAILED(_device_impl->_orig->CreateCommandAllocator(_type, IID_PPV_ARGS(&_cmd_alloc[index]))))
+		return false;
+
+	_num_frames++;
+	return true;
+}
+
 bool reshade::d3d12::command_list_immediate_impl::flush(ID3D12CommandQueue *queue)
 {
-	if (!_has_commands)
+	// Commands recorded into a command list of the application are submitted by the application, so cannot do anything here until recording is redirected back
+	if (_immediate_orig != nullptr)
 		return true;
+
+	if (!_has_commands && !_has_external_commands)
+		return true;
+
+	flush_barriers();
+
+	const bool execute = _has_commands;
 	_has_commands = false;
+	_has_external_commands = false;
 
 	_current_root_signature[0] = nullptr;
 	_current_root_signature[1] = nullptr;
@@ -58,38 +83,120 @@ bool reshade::d3d12::command_list_immediate_impl::flush(ID3D12CommandQueue *queu
 
 		// A command list that failed to close can never be reset, so destroy it and create a new one
 		_device_impl->wait_idle();
+		const D3D12_COMMAND_LIST_TYPE type = _orig->GetType();
 		_orig->Release(); _orig = nullptr;
-		if (SUCCEEDED(_device_impl->_orig->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, _cmd_alloc[_cmd_index].get(), nullptr, IID_PPV_ARGS(&_orig))))
+		if (SUCCEEDED(_device_impl->_orig->CreateCommandList(0, type, _cmd_alloc[_cmd_index].get(), nullptr, IID_PPV_ARGS(&_orig))))
 			_orig->SetName(L"ReShade immediate command list");
 		return false;
 	}
 
-	ID3D12CommandList *const cmd_lists[] = { _orig };
-	queue->ExecuteCommandLists(ARRAYSIZE(cmd_lists), cmd_lists);
+	// Only need to close the immediate command list without executing it when nothing was recorded to it, to use the next command allocator for the commands the application already submitted
+	if (execute)
+	{
+		ID3D12CommandList *const cmd_lists[] = { _orig };
+		queue->ExecuteCommandLists(ARRAYSIZE(cmd_lists), cmd_lists);
+	}
 
-	if (const UINT64 sync_value = _fence_value[_cmd_index] + NUM_COMMAND_FRAMES;
+	if (const UINT64 sync_value = _fence_value[_cmd_index] + 1;
 		SUCCEEDED(queue->Signal(_fence[_cmd_index].get(), sync_value)))
+	{
 		_fence_value[_cmd_index] = sync_value;
+		_upload_ring.submit(_cmd_index);
+	}
+
+	_frame_submission[_cmd_index] = ++_num_submissions;
 
 	// Continue with next command list now that the current one was submitted
-	_cmd_index = (_cmd_index + 1) % NUM_COMMAND_FRAMES;
+	_cmd_index = (_cmd_index + 1) % _num_frames;
 
 	// Make sure all commands for the next command allocator have finished executing before reseting it
 	if (_fence[_cmd_index]->GetCompletedValue() < _fence_value[_cmd_index])
 	{
-		if (SUCCEEDED(_fence[_cmd_index]->SetEventOnCompletion(_fence_value[_cmd_index], _fence_event)))
-			WaitForSingleObject(_fence_event, INFINITE); // Event is automatically reset after this wait is released
+		// Add another command frame instead of waiting if the GPU is behind, but only when wrapping around, so that frames keep being used in submission order
+		if (_cmd_index == 0 && _num_frames < MAX_COMMAND_FRAMES && create_command_frame(_num_frames))
+		{
+			_cmd_index = _num_frames - 1;
+		}
+		else
+		{
+			const auto wait_start = std::chrono::high_resolution_clock::now();
+
+			if (SUCCEEDED(_fence[_cmd_index]->SetEventOnCompletion(_fence_value[_cmd_index], _fence_event)))
+				WaitForSingleObject(_fence_event, INFINITE); // Event is automatically reset after this wait is released
+
+			_num_waits++;
+			_total_wait_time += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - wait_start);
+		}
 	}
 
+	// Upload memory and resources that were referenced by the commands of the next command allocator can be reused now as well
+	_upload_ring.reclaim(_cmd_index);
+	_pending_releases[_cmd_index].clear();
+
 	// Reset command allocator before using it this frame again
 	_cmd_alloc[_cmd_index]->Reset();
 
 	// Reset command list using current command allocator and put it into the recording state
 	return SUCCEEDED(_orig->Reset(_cmd_alloc[_cmd_index].get(), nullptr));
 }
+uint64_t reshade::d3d12::command_list_immediate_impl::get_completed_submission() const
+{
+	// Command frames finish in submission order, so the latest submission of any finished frame means all earlier ones finished too
+	for (UINT i = 0; i < _num_frames; ++i)
+		if (_frame_submission[i] > _completed_submission && _fence[i]->GetCompletedValue() >= _fence_value[i])
+			_completed_submission = _frame_submission[i];
+
+	return _completed_submission;
+}
+
+void reshade::d3d12::command_list_immediate_impl::begin_external_recording(ID3D12CommandQueue *queue, ID3D12GraphicsCommandList *cmd_list)
+{
+	assert(_immediate_orig == nullptr && cmd_list != nullptr);
+
+	flush(queue);
+
+	_immediate_orig = _orig;
+	_orig = cmd_list;
+
+	// Nothing is bound on the command list of the application yet
+	_current_root_signature[0] = nullptr;
+	_current_root_signature[1] = nullptr;
+	_current_descriptor_heaps[0] = nullptr;
+	_current_descriptor_heaps[1] = nullptr;
+}
+void reshade::d3d12::command_list_immediate_impl::end_external_recording()
+{
+	assert(_immediate_orig != nullptr && !_has_open_render_pass);
+
+	flush_barriers();
+
+	_has_external_commands |= _has_commands;
+	_has_commands = false;
+
+	_orig = _immediate_orig;
+	_immediate_orig = nullptr;
+
+	_current_root_signature[0] = nullptr;
+	_current_root_signature[1] = nullptr;
+	_current_descriptor_heaps[0] = nullptr;
+	_current_descriptor_heaps[1] = nullptr;
+}
+
+bool reshade::d3d12::command_list_immediate_impl::allocate_upload_memory(uint64_t size, uint64_t alignment, void **out_data, api::resource *out_buffer, uint64_t *out_offset)
+{
+	// Only create the ring buffer once it is actually used, since most queues never need it
+	if (!_upload_ring.is_valid() && !_upload_ring.create(_device_impl))
+	{
+		*out_data = nullptr;
+		return false;
+	}
+
+	return _upload_ring.allocate(size, alignment, out_data, out_buffer, out_offset);
+}
+
 bool reshade::d3d12::command_list_immediate_impl::flush_and_wait(ID3D12CommandQueue *queue)
 {
-	if (!_has_commands)
+	if (!_has_commands && !_has_external_commands)
 		return true;
 
 	// Index is updated during flush below, so keep track of the current one to wait on
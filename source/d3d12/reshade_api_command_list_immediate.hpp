@@ -6,27 +6,82 @@
 #pragma once
 
 #include "reshade_api_command_list.hpp"
+#include "upload_ring_buffer.hpp"
+#include <chrono>
 
 namespace reshade::d3d12
 {
 	class command_list_immediate_impl : public command_list_impl
 	{
-		static const UINT NUM_COMMAND_FRAMES = 4;
+		// Start with a shallow ring of command frames and only add more (up to the maximum) when the GPU falls behind, so that deep frame queues do not make flushes block, while low latency setups do not waste memory
+		static const UINT MIN_COMMAND_FRAMES = 2;
+		static const UINT MAX_COMMAND_FRAMES = 8;
 
 	public:
-		command_list_immediate_impl(device_impl *device);
+		command_list_immediate_impl(device_impl *device, D3D12_COMMAND_LIST_TYPE type = D3D12_COMMAND_LIST_TYPE_DIRECT);
 		~command_list_immediate_impl();
 
 		bool flush(ID3D12CommandQueue *queue);
 		bool flush_and_wait(ID3D12CommandQueue *queue);
 
-		ID3D12GraphicsCommandList *const begin_commands() { _has_commands = true; return _orig; }
+		ID3D12GraphicsCommandList *const begin_commands() { flush_barriers(); _has_commands = true; return _orig; }
+
+		/// <summary>
+		/// Redirects all commands recorded from now on into the specified open command list of the application, which the application then submits itself.
+		/// Commands recorded before are submitted first, so that they execute before those of the application.
+		/// </summary>
+		void begin_external_recording(ID3D12CommandQueue *queue, ID3D12GraphicsCommandList *cmd_list);
+		/// <summary>
+		/// Stops redirecting commands into the command list of the application (see <see cref="begin_external_recording"/>).
+		/// The next flush then only signals the fence for those commands, so it has to happen after the application submitted them.
+		/// </summary>
+		void end_external_recording();
+		bool is_recording_externally() const { return _immediate_orig != nullptr; }
+
+		/// <summary>
+		/// Gets the number of the submission the commands recorded so far are executed with, which was reached once <see cref="get_completed_submission"/> returns that number or a higher one.
+		/// </summary>
+		uint64_t get_pending_submission() const { return (_has_commands || _has_external_commands) ? _num_submissions + 1 : _num_submissions; }
+		/// <summary>
+		/// Gets the number of the last submission that finished executing on the GPU, without blocking.
+		/// </summary>
+		uint64_t get_completed_submission() const;
+
+		bool allocate_upload_memory(uint64_t size, uint64_t alignment, void **out_data, api::resource *out_buffer, uint64_t *out_offset);
+
+		/// <summary>
+		/// Keeps the specified <paramref name="resource"/> alive until the commands recorded so far finished executing on the GPU, instead of having to wait for that.
+		/// </summary>
+		void release_after_completion(com_ptr<ID3D12Resource> &&resource) { _pending_releases[_cmd_index].push_back(std::move(resource)); }
+
+		/// <summary>
+		/// Gets the number of command frames currently in use, and how often and for how long in total flushes had to block waiting for the GPU to finish with a command frame.
+		/// </summary>
+		void get_wait_statistics(UINT &num_frames, uint64_t &num_waits, std::chrono::nanoseconds &total_wait_time) const
+		{
+			num_frames = _num_frames;
+			num_waits = _num_waits;
+			total_wait_time = _total_wait_time;
+		}
 
 	private:
+		bool create_command_frame(UINT index);
+
+		const D3D12_COMMAND_LIST_TYPE _type;
+		ID3D12GraphicsCommandList *_immediate_orig = nullptr;
+		bool _has_external_commands = false;
 		UINT _cmd_index = 0;
+		UINT _num_frames = 0;
 		HANDLE _fence_event = nullptr;
-		UINT64 _fence_value[NUM_COMMAND_FRAMES] = {};
-		com_ptr<ID3D12Fence> _fence[NUM_COMMAND_FRAMES];
-		com_ptr<ID3D12CommandAllocator> _cmd_alloc[NUM_COMMAND_FRAMES];
+		UINT64 _fence_value[MAX_COMMAND_FRAMES] = {};
+		uint64_t _num_submissions = 0;
+		uint64_t _frame_submission[MAX_COMMAND_FRAMES] = {};
+		mutable uint64_t _completed_submission = 0;
+		com_ptr<ID3D12Fence> _fence[MAX_COMMAND_FRAMES];
+		com_ptr<ID3D12CommandAllocator> _cmd_alloc[MAX_COMMAND_FRAMES];
+		upload_ring_buffer<MAX_COMMAND_FRAMES> _upload_ring;
+		std::vector<com_ptr<ID3D12Resource>> _pending_releases[MAX_COMMAND_FRAMES];
+		uint64_t _num_waits = 0;
+		std::chrono::nanoseconds _total_wait_time = {};
 	};
 }
@@ -17,10 +17,12 @@ reshade::d3d12::command_queue_impl::command_queue_impl(device_impl *device, ID3D
 		_device_impl->_queues.push_back(this);
 	}
 
-	// Only create an immediate command list for graphics queues (since the implemented commands do not work on other queue types)
-	if (queue->GetDesc().Type == D3D12_COMMAND_LIST_TYPE_DIRECT)
+	// Only create an immediate command list for graphics and compute queues (since the implemented commands do not work on copy queues)
+	// Only the compute subset of commands may be used on the immediate command list of a compute queue
+	if (const D3D12_COMMAND_LIST_TYPE type = queue->GetDesc().Type;
+		type == D3D12_COMMAND_LIST_TYPE_DIRECT || type == D3D12_COMMAND_LIST_TYPE_COMPUTE)
 	{
-		_immediate_cmd_list = new command_list_immediate_impl(device);
+		_immediate_cmd_list = new command_list_immediate_impl(device, type);
 		// Ensure the immediate command list was initialized successfully, otherwise disable it
 		if (_immediate_cmd_list->_orig == nullptr)
 		{
@@ -39,6 +41,12 @@ reshade::d3d12::command_queue_impl::command_queue_impl(device_impl *device, ID3D
 		LOG(ERROR) << "Failed to create wait for idle resources for queue " << _orig << '!';
 	}
 
+	// Create fence that other queues can wait on to synchronize with work submitted to this queue
+	if (FAILED(_device_impl->_orig->CreateFence(_sync_fence_value, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&_sync_fence))))
+	{
+		LOG(ERROR) << "Failed to create synchronization fence for queue " << _orig << '!';
+	}
+
 #if RESHADE_ADDON
 	invoke_addon_event<addon_event::init_command_queue>(this);
 #endif
@@ -71,6 +79,25 @@ void reshade::d3d12::command_queue_impl::flush_immediate_command_list() const
 		_immediate_cmd_list->flush(_orig);
 }
 
+void reshade::d3d12::command_queue_impl::execute_command_list(api::command_list *cmd_list)
+{
+	// Commands recorded on the immediate command list so far have to execute before the ones in the specified command list
+	flush_immediate_command_list();
+
+	static_cast<command_list_immediate_impl *>(cmd_list)->flush(_orig);
+}
+
+bool reshade::d3d12::command_queue_impl::allocate_upload_memory(uint64_t size, uint64_t alignment, void **out_data, api::resource *out_buffer, uint64_t *out_offset)
+{
+	if (_immediate_cmd_list == nullptr)
+	{
+		*out_data = nullptr;
+		return false;
+	}
+
+	return _immediate_cmd_list->allocate_upload_memory(size, alignment, out_data, out_buffer, out_offset);
+}
+
 void reshade::d3d12::command_queue_impl::wait_idle() const
 {
 	// Flush command list, to avoid it still referencing resources that may be destroyed after this call
@@ -89,6 +116,23 @@ void reshade::d3d12::command_queue_impl::wait_idle() const
 		WaitForSingleObject(_wait_idle_fence_event, INFINITE);
 }
 
+bool reshade::d3d12::command_queue_impl::wait(command_queue_impl *other_queue)
+{
+	// Flush command list of the other queue, so that work recorded on it so far is included in the synchronization
+	other_queue->flush_immediate_command_list();
+
+	assert(other_queue->_sync_fence != nullptr);
+
+	if (const UINT64 sync_value = other_queue->_sync_fence_value + 1;
+		SUCCEEDED(other_queue->_orig->Signal(other_queue->_sync_fence.get(), sync_value)))
+		other_queue->_sync_fence_value = sync_value;
+	else
+		return false;
+
+	// Wait happens on the GPU, so this does not block the calling thread
+	return SUCCEEDED(_orig->Wait(other_queue->_sync_fence.get(), other_queue->_sync_fence_value));
+}
+
 void reshade::d3d12::command_queue_impl::begin_debug_event(const char *label, const float color[4])
 {
 #if 0
@@ -21,8 +21,17 @@ namespace reshade::d3d12
 
 		void flush_immediate_command_list() const final;
 
+		void execute_command_list(api::command_list *cmd_list) final;
+		bool allocate_upload_memory(uint64_t size, uint64_t alignment, void **out_data, api::resource *out_buffer, uint64_t *out_offset) final;
+
+		uint64_t get_pending_fence_value() final { return _immediate_cmd_list != nullptr ? _immediate_cmd_list->get_pending_submission() : 0; }
+		uint64_t get_completed_fence_value() const final { return _immediate_cmd_list != nullptr ? _immediate_cmd_list->get_completed_submission() : 0; }
+
 		void wait_idle() const final;
 
+		// Makes all work submitted to this queue from now on wait on the GPU for all work submitted to the other queue so far
+		bool wait(command_queue_impl *other_queue);
+
 		void begin_debug_event(const char *label, const float color[4]) final;
 		void finish_debug_event() final;
 		void insert_debug_marker(const char *label, const float color[4]) final;
@@ -33,5 +42,7 @@ namespace reshade::d3d12
 		HANDLE _wait_idle_fence_event = nullptr;
 		mutable UINT64 _wait_idle_fence_value = 0;
 		com_ptr<ID3D12Fence> _wait_idle_fence;
+		UINT64 _sync_fence_value = 0;
+		com_ptr<ID3D12Fence> _sync_fence;
 	};
 }
@@ -8,8 +8,77 @@
 #include "reshade_api_device.hpp"
 #include "reshade_api_command_queue.hpp"
 #include "reshade_api_type_convert.hpp"
+#include "resource_ledger.hpp"
 
 const GUID reshade::d3d12::pipeline_extra_data_guid = { 0xB2257A30, 0x4014, 0x46EA, { 0xBD, 0x88, 0xDE, 0xC2, 0x1D, 0xB6, 0xA0, 0x2B } };
+static const GUID root_signature_hash_guid = { 0x5C7E3A41, 0x9B2D, 0x4F16, { 0xA8, 0x3E, 0x71, 0xD4, 0x0C, 0x95, 0xE2, 0x6B } };
+
+static inline void hash_combine(size_t &hash, const void *data, size_t size)
+{
+	hash ^= std::hash<std::string_view>()(std::string_view(static_cast<const char *>(data), size)) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+}
+static inline void hash_combine(size_t &hash, const D3D12_SHADER_BYTECODE &bytecode)
+{
+	hash_combine(hash, bytecode.pShaderBytecode, bytecode.BytecodeLength);
+}
+static inline bool hash_combine(size_t &hash, ID3D12RootSignature *signature)
+{
+	// Root signature objects differ between sessions, so use the hash of their serialized description that was stored in 'create_pipeline_layout' instead
+	size_t signature_hash = 0;
+	UINT signature_hash_size = sizeof(signature_hash);
+	if (signature == nullptr || FAILED(signature->GetPrivateData(root_signature_hash_guid, &signature_hash_size, &signature_hash)))
+		return false;
+
+	hash_combine(hash, &signature_hash, sizeof(signature_hash));
+	return true;
+}
+
+// Returns an empty name if the pipeline cannot be stored in the library, because its root signature was not created through 'create_pipeline_layout'
+static std::wstring pipeline_library_name(const D3D12_COMPUTE_PIPELINE_STATE_DESC &desc)
+{
+	size_t hash = 0;
+	if (!hash_combine(hash, desc.pRootSignature))
+		return std::wstring();
+	hash_combine(hash, desc.CS);
+	hash_combine(hash, &desc.NodeMask, sizeof(desc.NodeMask));
+	hash_combine(hash, &desc.Flags, sizeof(desc.Flags));
+
+	return L"Compute_" + std::to_wstring(hash);
+}
+static std::wstring pipeline_library_name(const D3D12_GRAPHICS_PIPELINE_STATE_DESC &desc)
+{
+	size_t hash = 0;
+	if (!hash_combine(hash, desc.pRootSignature))
+		return std::wstring();
+	hash_combine(hash, desc.VS);
+	hash_combine(hash, desc.PS);
+	hash_combine(hash, desc.DS);
+	hash_combine(hash, desc.HS);
+	hash_combine(hash, desc.GS);
+	hash_combine(hash, &desc.BlendState, sizeof(desc.BlendState));
+	hash_combine(hash, &desc.SampleMask, sizeof(desc.SampleMask));
+	hash_combine(hash, &desc.RasterizerState, sizeof(desc.RasterizerState));
+	hash_combine(hash, &desc.DepthStencilState, sizeof(desc.DepthStencilState));
+
+	for (UINT i = 0; i < desc.InputLayout.NumElements; ++i)
+	{
+		D3D12_INPUT_ELEMENT_DESC element = desc.InputLayout.pInputElementDescs[i];
+		hash_combine(hash, element.SemanticName, std::strlen(element.SemanticName));
+		element.SemanticName = nullptr;
+		hash_combine(hash, &element, sizeof(element));
+	}
+
+	hash_combine(hash, &desc.IBStripCutValue, sizeof(desc.IBStripCutValue));
+	hash_combine(hash, &desc.PrimitiveTopologyType, sizeof(desc.PrimitiveTopologyType));
+	hash_combine(hash, &desc.NumRenderTargets, sizeof(desc.NumRenderTargets));
+	hash_combine(hash, desc.RTVFormats, sizeof(desc.RTVFormats));
+	hash_combine(hash, &desc.DSVFormat, sizeof(desc.DSVFormat));
+	hash_combine(hash, &desc.SampleDesc, sizeof(desc.SampleDesc));
+	hash_combine(hash, &desc.NodeMask, sizeof(desc.NodeMask));
+	hash_combine(hash, &desc.Flags, sizeof(desc.Flags));
+
+	return L"Graphics_" + std::to_wstring(hash);
+}
 
 reshade::d3d12::device_impl::device_impl(ID3D12Device *device) :
 	api_object_impl(device),
@@ -19,13 +88,25 @@ reshade::d3d12::device_impl::device_impl(ID3D12Device *device) :
 		descriptor_heap_cpu(device, D3D12_DESCRIPTOR_HEAP_TYPE_RTV),
 		descriptor_heap_cpu(device, D3D12_DESCRIPTOR_HEAP_TYPE_DSV) },
 	_gpu_view_heap(device),
-	_gpu_sampler_heap(device)
+	_gpu_sampler_heap(device),
+	_heap_allocator(device)
 {
 	for (UINT type = 0; type < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++type)
 	{
 		_descriptor_handle_size[type] = device->GetDescriptorHandleIncrementSize(static_cast<D3D12_DESCRIPTOR_HEAP_TYPE>(type));
 	}
 
+	if (FAILED(device->CreateFence(_transient_fence_value, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&_transient_fence))))
+		LOG(ERROR) << "Failed to create transient descriptor fence!";
+
+	_resources.set_unregister_callback([](void *context, ID3D12Resource *object) {
+		static_cast<device_impl *>(context)->_resource_desc_cache.erase(reinterpret_cast<uintptr_t>(object));
+		static_cast<device_impl *>(context)->_heap_allocator.free(object);
+#if RESHADE_ADDON
+		static_cast<device_impl *>(context)->unregister_buffer_gpu_address(object);
+#endif
+	}, this);
+
 	// Create mipmap generation states
 	{
 		D3D12_DESCRIPTOR_RANGE srv_range = {};
@@ -108,6 +189,63 @@ reshade::d3d12::device_impl::~device_impl()
 #endif
 }
 
+void reshade::d3d12::device_impl::load_pipeline_cache(std::vector<char> &&data)
+{
+	// Library is shared between all swap chains of this device, so only need to create it once
+	if (_pipeline_library != nullptr)
+		return;
+
+	com_ptr<ID3D12Device1> device1;
+	if (FAILED(_orig->QueryInterface(&device1)))
+		return; // Pipeline libraries are not supported before Windows 10 Anniversary Update (or in d3d12on7)
+
+	_pipeline_library_data = std::move(data);
+
+	if (_pipeline_library_data.empty() ||
+		FAILED(device1->CreatePipelineLibrary(_pipeline_library_data.data(), _pipeline_library_data.size(), IID_PPV_ARGS(&_pipeline_library))))
+	{
+		// Data may be from a different driver version or adapter, so start over with an empty library in that case
+		_pipeline_library_data.clear();
+
+		if (FAILED(device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&_pipeline_library))))
+		{
+			LOG(ERROR) << "Failed to create pipeline library!";
+			_pipeline_library.reset();
+		}
+	}
+}
+bool reshade::d3d12::device_impl::save_pipeline_cache(std::vector<char> &data)
+{
+	if (_pipeline_library == nullptr || !_pipeline_library_dirty.exchange(false))
+		return false;
+
+	data.resize(_pipeline_library->GetSerializedSize());
+	if (FAILED(_pipeline_library->Serialize(data.data(), data.size())))
+	{
+		_pipeline_library_dirty = true; // Try again next time
+		return false;
+	}
+
+	return true;
+}
+
+void reshade::d3d12::device_impl::advance_transient_descriptor_heaps(ID3D12CommandQueue *queue)
+{
+	if (_transient_fence == nullptr)
+		return;
+
+	// Command lists are usually submitted before the frame that recorded them is presented, so the fence signaled after present covers all transient descriptors allocated up to here
+	const UINT64 completed_fence_value = _transient_fence->GetCompletedValue();
+	_gpu_view_heap.retire_transient_frames(completed_fence_value);
+	_gpu_sampler_heap.retire_transient_frames(completed_fence_value);
+
+	if (FAILED(queue->Signal(_transient_fence.get(), ++_transient_fence_value)))
+		return;
+
+	_gpu_view_heap.end_transient_frame(_transient_fence_value);
+	_gpu_sampler_heap.end_transient_frame(_transient_fence_value);
+}
+
 bool reshade::d3d12::device_impl::check_capability(api::device_caps capability) const
 {
 	D3D12_FEATURE_DATA_D3D12_OPTIONS options;
@@ -146,6 +284,11 @@ bool reshade::d3d12::device_impl::check_capability(api::device_caps capability)
 	case api::device_caps::resolve_region:
 	case api::device_caps::copy_query_pool_results:
 		return true;
+	case api::device_caps::shading_rate:
+	{
+		D3D12_FEATURE_DATA_D3D12_OPTIONS6 options6;
+		return SUCCEEDED(_orig->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS6, &options6, sizeof(options6))) && options6.VariableShadingRateTier != D3D12_VARIABLE_SHADING_RATE_TIER_NOT_SUPPORTED;
+	}
 	default:
 		return false;
 	}
@@ -176,9 +319,31 @@ bool reshade::d3d12::device_impl::check_format_support(api::format format, api::
 	return true;
 }
 
+bool reshade::d3d12::device_impl::get_memory_budget(uint64_t *budget, uint64_t *usage) const
+{
+	DXGI_QUERY_VIDEO_MEMORY_INFO info;
+	if (_dxgi_adapter == nullptr || FAILED(_dxgi_adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &info)))
+		return false;
+
+	*budget = info.Budget;
+	*usage = info.CurrentUsage;
+	return true;
+}
+uint64_t reshade::d3d12::device_impl::get_resource_memory_usage(api::resource_memory_owner owner, api::resource_memory_category category) const
+{
+	return resource_ledger::get_usage(this, owner, category);
+}
+
 bool reshade::d3d12::device_impl::is_resource_handle_valid(api::resource handle) const
 {
-	return handle.handle != 0 && _resources.has_object(reinterpret_cast<ID3D12Resource *>(handle.handle));
+	if (handle.handle == 0)
+		return false;
+
+	// Entries are removed from the cache when the resource is destroyed, so a hit means the handle is still valid
+	if (api::resource_desc desc; _resource_desc_cache.lookup(handle.handle, desc))
+		return true;
+
+	return _resources.has_object(reinterpret_cast<ID3D12Resource *>(handle.handle));
 }
 bool reshade::d3d12::device_impl::is_resource_view_handle_valid(api::resource_view handle) const
 {
@@ -205,6 +370,9 @@ bool reshade::d3d12::device_impl::create_sampler(const api::sampler_desc &desc,
 }
 bool reshade::d3d12::device_impl::create_resource(const api::resource_desc &desc, const api::subresource_data *initial_data, api::resource_usage initial_state, api::resource *out)
 {
+	// Keep track of how much memory ReShade and add-ons allocate (this also covers all the return paths below)
+	const resource_ledger::create_scope ledger_scope(this, desc, out, _ReturnAddress());
+
 	assert((desc.usage & initial_state) == initial_state || initial_state == api::resource_usage::cpu_access);
 
 	D3D12_HEAP_FLAGS heap_flags = D3D12_HEAP_FLAG_NONE;
@@ -231,7 +399,7 @@ bool reshade::d3d12::device_impl::create_resource(const api::resource_desc &desc
 	if (com_ptr<ID3D12Resource> object;
 		SUCCEEDED(desc.heap == api::memory_heap::unknown ?
 		_orig->CreateReservedResource(&internal_desc, convert_resource_usage_to_states(initial_state), use_default_clear_value ? &default_clear_value : nullptr, IID_PPV_ARGS(&object)) :
-		_orig->CreateCommittedResource(&heap_props, heap_flags, &internal_desc, convert_resource_usage_to_states(initial_state), use_default_clear_value ? &default_clear_value : nullptr, IID_PPV_ARGS(&object))))
+		_heap_allocator.create_resource(heap_props, heap_flags, internal_desc, convert_resource_usage_to_states(initial_state), use_default_clear_value ? &default_clear_value : nullptr, &object)))
 	{
 		_resources.register_object(object.get());
 		*out = { reinterpret_cast<uintptr_t>(object.release()) };
@@ -367,8 +535,23 @@ bool reshade::d3d12::device_impl::create_compute_pipeline(const api::pipeline_de
 	D3D12_COMPUTE_PIPELINE_STATE_DESC internal_desc = {};
 	convert_pipeline_desc(desc, internal_desc);
 
-	if (com_ptr<ID3D12PipelineState> pipeline;
-		SUCCEEDED(_orig->CreateComputePipelineState(&internal_desc, IID_PPV_ARGS(&pipeline))))
+	com_ptr<ID3D12PipelineState> pipeline;
+	HRESULT hr = E_FAIL;
+
+	std::wstring library_name;
+	if (_pipeline_library != nullptr && !(library_name = pipeline_library_name(internal_desc)).empty())
+	{
+		hr = _pipeline_library->LoadComputePipeline(library_name.c_str(), &internal_desc, IID_PPV_ARGS(&pipeline));
+	}
+
+	if (FAILED(hr) &&
+		SUCCEEDED(hr = _orig->CreateComputePipelineState(&internal_desc, IID_PPV_ARGS(&pipeline))) && !library_name.empty())
+	{
+		if (SUCCEEDED(_pipeline_library->StorePipeline(library_name.c_str(), pipeline.get())))
+			_pipeline_library_dirty = true;
+	}
+
+	if (SUCCEEDED(hr))
 	{
 		*out = { reinterpret_cast<uintptr_t>(pipeline.release()) };
 		return true;
@@ -391,7 +574,8 @@ bool reshade::d3d12::device_impl::create_graphics_pipeline(const api::pipeline_d
 	{
 		if (desc.graphics.dynamic_states[i] != api::dynamic_state::stencil_reference_value &&
 			desc.graphics.dynamic_states[i] != api::dynamic_state::blend_constant &&
-			desc.graphics.dynamic_states[i] != api::dynamic_state::primitive_topology)
+			desc.graphics.dynamic_states[i] != api::dynamic_state::primitive_topology &&
+			desc.graphics.dynamic_states[i] != api::dynamic_state::shading_rate)
 		{
 			*out = { 0 };
 			return false;
@@ -429,8 +613,23 @@ bool reshade::d3d12::device_impl::create_graphics_pipeline(const api::pipeline_d
 		internal_desc.RTVFormats[i] = pass_impl->rtv_format[i];
 	internal_desc.DSVFormat = pass_impl->dsv_format;
 
-	if (com_ptr<ID3D12PipelineState> pipeline;
-		SUCCEEDED(_orig->CreateGraphicsPipelineState(&internal_desc, IID_PPV_ARGS(&pipeline))))
+	com_ptr<ID3D12PipelineState> pipeline;
+	HRESULT hr = E_FAIL;
+
+	std::wstring library_name;
+	if (_pipeline_library != nullptr && !(library_name = pipeline_library_name(internal_desc)).empty())
+	{
+		hr = _pipeline_library->LoadGraphicsPipeline(library_name.c_str(), &internal_desc, IID_PPV_ARGS(&pipeline));
+	}
+
+	if (FAILED(hr) &&
+		SUCCEEDED(hr = _orig->CreateGraphicsPipelineState(&internal_desc, IID_PPV_ARGS(&pipeline))) && !library_name.empty())
+	{
+		if (SUCCEEDED(_pipeline_library->StorePipeline(library_name.c_str(), pipeline.get())))
+			_pipeline_library_dirty = true;
+	}
+
+	if (SUCCEEDED(hr))
 	{
 		pipeline_graphics_impl extra_data;
 		extra_data.topology = convert_primitive_topology(desc.graphics.topology);
@@ -504,10 +703,33 @@ bool reshade::d3d12::device_impl::create_pipeline_layout(const api::pipeline_lay
 	internal_desc.pParameters = params.data();
 
 	com_ptr<ID3DBlob> blob;
-	com_ptr<ID3D12RootSignature> signature;
-	if (SUCCEEDED(D3D12SerializeRootSignature(&internal_desc, D3D_ROOT_SIGNATURE_VERSION_1, &blob, nullptr)) &&
+	if (FAILED(D3D12SerializeRootSignature(&internal_desc, D3D_ROOT_SIGNATURE_VERSION_1, &blob, nullptr)))
+	{
+		*out = { 0 };
+		return false;
+	}
+
+	std::string key(static_cast<const char *>(blob->GetBufferPointer()), blob->GetBufferSize());
+
+	const std::lock_guard<std::mutex> lock(_root_signature_cache_mutex);
+
+	if (const auto it = _root_signature_cache.find(key); it != _root_signature_cache.end())
+	{
+		it->second->AddRef();
+
+		*out = { reinterpret_cast<uintptr_t>(it->second) };
+		return true;
+	}
+
+	if (com_ptr<ID3D12RootSignature> signature;
 		SUCCEEDED(_orig->CreateRootSignature(0, blob->GetBufferPointer(), blob->GetBufferSize(), IID_PPV_ARGS(&signature))))
 	{
+		// Pipelines are stored in the pipeline library under a name that includes this, so that a pipeline is never loaded with a different root signature than it was stored with (see 'pipeline_library_name')
+		const size_t signature_hash = std::hash<std::string>()(key);
+		signature->SetPrivateData(root_signature_hash_guid, sizeof(signature_hash), &signature_hash);
+
+		_root_signature_cache.emplace(std::move(key), signature.get());
+
 		*out = { reinterpret_cast<uintptr_t>(signature.release()) };
 		return true;
 	}
@@ -583,11 +805,13 @@ bool reshade::d3d12::device_impl::create_descriptor_set_layout(const api::descri
 
 bool reshade::d3d12::device_impl::create_query_pool(api::query_type type, uint32_t size, api::query_pool *out)
 {
+	const UINT result_size = convert_query_type_to_result_size(type);
+
 	com_ptr<ID3D12Resource> readback_resource;
 	{
 		D3D12_RESOURCE_DESC readback_desc = {};
 		readback_desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-		readback_desc.Width = size * sizeof(uint64_t);
+		readback_desc.Width = size * static_cast<UINT64>(result_size);
 		readback_desc.Height = 1;
 		readback_desc.DepthOrArraySize = 1;
 		readback_desc.MipLevels = 1;
@@ -600,6 +824,9 @@ bool reshade::d3d12::device_impl::create_query_pool(api::query_type type, uint32
 			*out = { 0 };
 			return false;
 		}
+
+		// Query heaps do not expose their type, so store the size of a single result with the readback resource for 'get_query_pool_results'
+		readback_resource->SetPrivateData(pipeline_extra_data_guid, sizeof(result_size), &result_size);
 	}
 
 	D3D12_QUERY_HEAP_DESC internal_desc = {};
@@ -668,8 +895,23 @@ void reshade::d3d12::device_impl::destroy_sampler(api::sampler handle)
 }
 void reshade::d3d12::device_impl::destroy_resource(api::resource handle)
 {
-	if (handle.handle != 0)
-		reinterpret_cast<IUnknown *>(handle.handle)->Release();
+	resource_ledger::unregister_resource(this, handle);
+
+	if (handle.handle == 0)
+		return;
+
+	// Commands recorded into a command list of the application during present may still reference the resource, but are only submitted after, so keep it alive until they finished executing
+	for (command_queue_impl *const queue : _queues)
+	{
+		const auto immediate_command_list = static_cast<command_list_immediate_impl *>(queue->get_immediate_command_list());
+		if (immediate_command_list != nullptr && immediate_command_list->is_recording_externally())
+		{
+			immediate_command_list->release_after_completion(com_ptr<ID3D12Resource>(reinterpret_cast<ID3D12Resource *>(handle.handle), true));
+			return;
+		}
+	}
+
+	reinterpret_cast<IUnknown *>(handle.handle)->Release();
 }
 void reshade::d3d12::device_impl::destroy_resource_view(api::resource_view handle)
 {
@@ -690,8 +932,21 @@ void reshade::d3d12::device_impl::destroy_pipeline(api::pipeline_stage, api::pip
 }
 void reshade::d3d12::device_impl::destroy_pipeline_layout(api::pipeline_layout handle)
 {
-	if (handle.handle != 0)
-		reinterpret_cast<IUnknown *>(handle.handle)->Release();
+	if (handle.handle == 0)
+		return;
+
+	const auto signature = reinterpret_cast<ID3D12RootSignature *>(handle.handle);
+
+	// Keep the cache locked while releasing, so that no other thread can pick up the root signature from it as the last reference goes away
+	const std::lock_guard<std::mutex> lock(_root_signature_cache_mutex);
+
+	if (signature->Release() == 0)
+	{
+		if (const auto it = std::find_if(_root_signature_cache.begin(), _root_signature_cache.end(),
+				[signature](const auto &entry) { return entry.second == signature; });
+			it != _root_signature_cache.end())
+			_root_signature_cache.erase(it);
+	}
 }
 void reshade::d3d12::device_impl::destroy_descriptor_set_layout(api::descriptor_set_layout handle)
 {
@@ -721,6 +976,26 @@ void reshade::d3d12::device_impl::destroy_descriptor_sets(api::descriptor_set_la
 	}
 }
 
+bool reshade::d3d12::device_impl::create_command_list(api::command_list **out)
+{
+	// Immediate command lists already manage their own allocators and close, submit and reset themselves when flushed, which is exactly what is needed here
+	const auto cmd_list_impl = new command_list_immediate_impl(this);
+	if (cmd_list_impl->_orig == nullptr)
+	{
+		delete cmd_list_impl;
+
+		*out = nullptr;
+		return false;
+	}
+
+	*out = cmd_list_impl;
+	return true;
+}
+void reshade::d3d12::device_impl::destroy_command_list(api::command_list *cmd_list)
+{
+	delete static_cast<command_list_immediate_impl *>(cmd_list);
+}
+
 void reshade::d3d12::device_impl::update_descriptor_sets(uint32_t num_writes, const api::descriptor_set_write *writes, uint32_t num_copies, const api::descriptor_set_copy *copies)
 {
 	for (UINT i = 0; i < num_writes; ++i)
@@ -841,8 +1116,9 @@ void reshade::d3d12::device_impl::upload_buffer_region(const void *data, api::re
 		{
 			immediate_command_list->copy_buffer_region(api::resource { reinterpret_cast<uintptr_t>(intermediate.get()) }, 0, dst, dst_offset, size);
 
-			// Wait for command to finish executing before destroying the upload buffer
-			immediate_command_list->flush_and_wait(queue->_orig);
+			// Submit without waiting for the copy to finish, the upload buffer is destroyed once the GPU is done with it
+			immediate_command_list->release_after_completion(std::move(intermediate));
+			immediate_command_list->flush(queue->_orig);
 			break;
 		}
 	}
@@ -863,9 +1139,11 @@ void reshade::d3d12::device_impl::upload_texture_region(const api::subresource_d
 		num_slices = dst_box[5] - dst_box[2];
 	}
 
-	auto row_pitch = width * api::format_bpp(convert_format(dst_desc.Format));
+	auto row_pitch = api::format_row_pitch(convert_format(dst_desc.Format), width);
 	row_pitch = (row_pitch + D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1u) & ~(D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1u);
-	const auto slice_pitch = num_rows * row_pitch;
+	const auto slice_pitch = api::format_slice_pitch(convert_format(dst_desc.Format), row_pitch, num_rows);
+	// Block compressed formats store a row of 4x4 blocks per row
+	num_rows = slice_pitch / row_pitch;
 
 	// Allocate host memory for upload
 	D3D12_RESOURCE_DESC intermediate_desc = { D3D12_RESOURCE_DIMENSION_BUFFER };
@@ -917,8 +1195,9 @@ void reshade::d3d12::device_impl::upload_texture_region(const api::subresource_d
 		{
 			immediate_command_list->copy_buffer_to_texture(api::resource { reinterpret_cast<uintptr_t>(intermediate.get()) }, 0, 0, 0, dst, dst_subresource, dst_box);
 
-			// Wait for command to finish executing before destroying the upload buffer
-			immediate_command_list->flush_and_wait(queue->_orig);
+			// Submit without waiting for the copy to finish, the upload buffer is destroyed once the GPU is done with it
+			immediate_command_list->release_after_completion(std::move(intermediate));
+			immediate_command_list->flush(queue->_orig);
 			break;
 		}
 	}
@@ -985,12 +1264,26 @@ reshade::api::resource_desc reshade::d3d12::device_impl::get_resource_desc(api::
 {
 	assert(resource.handle != 0);
 
+	api::resource_desc desc;
+	if (_resource_desc_cache.lookup(resource.handle, desc))
+		return desc;
+
+	// Description of a resource never changes, so can cache it for as long as the resource is alive
+	const uint64_t generation = _resource_desc_cache.generation();
+	desc = get_resource_desc_uncached(reinterpret_cast<ID3D12Resource *>(resource.handle));
+	if (_resources.has_object(reinterpret_cast<ID3D12Resource *>(resource.handle)))
+		_resource_desc_cache.insert(resource.handle, desc, generation);
+
+	return desc;
+}
+reshade::api::resource_desc reshade::d3d12::device_impl::get_resource_desc_uncached(ID3D12Resource *object)
+{
 	// This will retrieve the heap properties for placed and comitted resources, not for reserved resources (which will then be translated to 'memory_heap::unknown')
 	D3D12_HEAP_FLAGS heap_flags = D3D12_HEAP_FLAG_NONE;
 	D3D12_HEAP_PROPERTIES heap_props = {};
-	reinterpret_cast<ID3D12Resource *>(resource.handle)->GetHeapProperties(&heap_props, &heap_flags);
+	object->GetHeapProperties(&heap_props, &heap_flags);
 
-	return convert_resource_desc(reinterpret_cast<ID3D12Resource *>(resource.handle)->GetDesc(), heap_props, heap_flags);
+	return convert_resource_desc(object->GetDesc(), heap_props, heap_flags);
 }
 
 bool reshade::d3d12::device_impl::get_query_pool_results(api::query_pool pool, uint32_t first, uint32_t count, void *results, uint32_t stride)
@@ -1004,7 +1297,12 @@ bool reshade::d3d12::device_impl::get_query_pool_results(api::query_pool pool, u
 	UINT private_size = sizeof(ID3D12Resource *);
 	if (SUCCEEDED(heap_object->GetPrivateData(pipeline_extra_data_guid, &private_size, &readback_resource)))
 	{
-		const D3D12_RANGE read_range = { first * sizeof(uint64_t), (first + count) * sizeof(uint64_t) };
+		UINT result_size = sizeof(uint64_t);
+		private_size = sizeof(result_size);
+		readback_resource->GetPrivateData(pipeline_extra_data_guid, &private_size, &result_size);
+		assert(stride >= result_size);
+
+		const D3D12_RANGE read_range = { static_cast<SIZE_T>(first) * result_size, static_cast<SIZE_T>(first + count) * result_size };
 		const D3D12_RANGE write_range = { 0, 0 };
 
 		void *mapped_data = nullptr;
@@ -1012,7 +1310,7 @@ bool reshade::d3d12::device_impl::get_query_pool_results(api::query_pool pool, u
 		{
 			for (UINT i = 0; i < count; ++i)
 			{
-				*reinterpret_cast<uint64_t *>(reinterpret_cast<uint8_t *>(results) + i * stride) = static_cast<uint64_t *>(mapped_data)[i + first];
+				std::memcpy(static_cast<uint8_t *>(results) + i * stride, static_cast<const uint8_t *>(mapped_data) + static_cast<SIZE_T>(i + first) * result_size, result_size);
 			}
 
 			readback_resource->Unmap(0, &write_range);
@@ -6,9 +6,15 @@
 #pragma once
 
 #include "com_tracking.hpp"
+#include "resource_desc_cache.hpp"
 #include "addon_manager.hpp"
 #include "descriptor_heap.hpp"
+#include "heap_allocator.hpp"
 #include <dxgi1_5.h>
+#include <map>
+#include <atomic>
+#include <shared_mutex>
+#include <algorithm>
 #include <unordered_map>
 
 namespace reshade::d3d12
@@ -27,6 +33,9 @@ namespace reshade::d3d12
 		bool check_capability(api::device_caps capability) const final;
 		bool check_format_support(api::format format, api::resource_usage usage) const final;
 
+		bool get_memory_budget(uint64_t *budget, uint64_t *usage) const final;
+		uint64_t get_resource_memory_usage(api::resource_memory_owner owner, api::resource_memory_category category) const final;
+
 		bool is_resource_handle_valid(api::resource handle) const final;
 		bool is_resource_view_handle_valid(api::resource_view handle) const final;
 
@@ -57,11 +66,15 @@ namespace reshade::d3d12
 		void destroy_render_pass(api::render_pass handle) final;
 		void destroy_descriptor_sets(api::descriptor_set_layout layout, uint32_t count, const api::descriptor_set *sets) final;
 
+		bool create_command_list(api::command_list **out) final;
+		void destroy_command_list(api::command_list *cmd_list) final;
+
 		bool get_attachment(api::render_pass fbo, api::attachment_type type, uint32_t index, api::resource_view *out) const final;
 		uint32_t get_attachment_count(api::render_pass pass, api::attachment_type type) const final;
 
 		void get_resource_from_view(api::resource_view view, api::resource *out) const final;
 		api::resource_desc get_resource_desc(api::resource resource) const final;
+		static api::resource_desc get_resource_desc_uncached(ID3D12Resource *object);
 
 		bool map_resource(api::resource resource, uint32_t subresource, api::map_access access, void **data, uint32_t *row_pitch, uint32_t *slice_pitch) final;
 		void unmap_resource(api::resource resource, uint32_t subresource) final;
@@ -77,42 +90,91 @@ namespace reshade::d3d12
 
 		void set_resource_name(api::resource resource, const char *name) final;
 
+		/// <summary>
+		/// Creates the pipeline library used for all pipelines created through this device and initializes it with previously serialized <paramref name="data"/>.
+		/// </summary>
+		void load_pipeline_cache(std::vector<char> &&data);
+		/// <summary>
+		/// Serializes the contents of the pipeline library into <paramref name="data"/>.
+		/// </summary>
+		/// <returns>Returns whether there were any changes since the library was loaded.</returns>
+		bool save_pipeline_cache(std::vector<char> &data);
+
+		/// <summary>
+		/// Marks the end of a frame after it was presented on the specified <paramref name="queue"/>, so that transient descriptors used by frames the GPU finished executing can be reused.
+		/// </summary>
+		void advance_transient_descriptor_heaps(ID3D12CommandQueue *queue);
+
 #if RESHADE_ADDON
-		bool resolve_gpu_address(D3D12_GPU_VIRTUAL_ADDRESS address, api::resource *out_resource, uint64_t *out_offset)
+		bool resolve_gpu_address(D3D12_GPU_VIRTUAL_ADDRESS address, api::resource *out_resource, uint64_t *out_offset) const
 		{
-			const std::lock_guard<std::mutex> lock(_mutex);
-			for (const auto &buffer_info : _buffer_gpu_addresses)
+			const std::shared_lock<std::shared_mutex> lock(_buffer_gpu_addresses_mutex);
+
+			// Walk backwards from the last buffer starting at or before the address, which is usually the one containing it
+			// Placed buffers may alias each other though, so keep going until no buffer could reach the address anymore
+			for (auto it = _buffer_gpu_addresses.upper_bound(address); it != _buffer_gpu_addresses.begin();)
 			{
-				if (address < buffer_info.second.StartAddress)
-					continue;
-				const UINT64 address_offset = address - buffer_info.second.StartAddress;
-				if (address_offset < buffer_info.second.SizeInBytes)
+				--it;
+
+				const UINT64 address_offset = address - it->first;
+				if (address_offset >= _buffer_gpu_addresses_max_size)
+					break;
+
+				if (address_offset < it->second.size)
 				{
 					*out_offset = address_offset;
-					*out_resource = { reinterpret_cast<uintptr_t>(buffer_info.first) };
+					*out_resource = { reinterpret_cast<uintptr_t>(it->second.resource) };
 					return true;
 				}
 			}
+
 			return false;
 		}
 #endif
 
 		// Cached device capabilities for quick access
 		UINT _descriptor_handle_size[D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES];
+		// Adapter this device was created on, which is looked up through the factory of the first swap chain (see 'swapchain_impl::swapchain_impl'), since the device itself does not expose it
+		com_ptr<IDXGIAdapter3> _dxgi_adapter;
 
 	private:
 		mutable std::mutex _mutex;
 		std::vector<command_queue_impl *> _queues;
-		std::vector<std::pair<ID3D12Resource *, D3D12_GPU_VIRTUAL_ADDRESS_RANGE>> _buffer_gpu_addresses;
+
+#if RESHADE_ADDON
+		struct buffer_gpu_address_range
+		{
+			UINT64 size;
+			ID3D12Resource *resource;
+		};
+
+		// Buffers sorted by their start address, so that the buffer containing an address can be found with a binary search
+		mutable std::shared_mutex _buffer_gpu_addresses_mutex;
+		std::multimap<D3D12_GPU_VIRTUAL_ADDRESS, buffer_gpu_address_range> _buffer_gpu_addresses;
+		std::unordered_map<ID3D12Resource *, D3D12_GPU_VIRTUAL_ADDRESS> _buffer_gpu_address_lookup;
+		UINT64 _buffer_gpu_addresses_max_size = 0;
+#endif
 
 		std::unordered_map<UINT64, D3D12_CPU_DESCRIPTOR_HANDLE> _descriptor_set_map;
 
+		std::vector<char> _pipeline_library_data; // Needs to stay alive for the lifetime of the library
+		com_ptr<ID3D12PipelineLibrary> _pipeline_library;
+		// Set by pipeline creation, which may run on any thread
+		std::atomic<bool> _pipeline_library_dirty = false;
+
+		// Root signatures created for 'create_pipeline_layout', indexed by their serialized description, so that effects with identical layouts share one and command lists do not have to switch between them
+		// These do not hold a reference, the entry is removed again when the last reference is released in 'destroy_pipeline_layout'
+		std::mutex _root_signature_cache_mutex;
+		std::unordered_map<std::string, ID3D12RootSignature *> _root_signature_cache;
+
 		com_ptr<ID3D12PipelineState> _mipmap_pipeline;
 		com_ptr<ID3D12RootSignature> _mipmap_signature;
 
 		descriptor_heap_cpu _view_heaps[D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES];
 		descriptor_heap_gpu<D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER, 128, 128> _gpu_sampler_heap;
 		descriptor_heap_gpu<D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 1024, 2048> _gpu_view_heap;
+		UINT64 _transient_fence_value = 0;
+		com_ptr<ID3D12Fence> _transient_fence;
 
 
 	protected:
@@ -126,11 +188,38 @@ namespace reshade::d3d12
 		inline void register_buffer_gpu_address(ID3D12Resource *resource, UINT64 size)
 		{
 			assert(resource != nullptr);
-			const std::lock_guard<std::mutex> lock(_mutex);
-			_buffer_gpu_addresses.emplace_back(resource, D3D12_GPU_VIRTUAL_ADDRESS_RANGE { resource->GetGPUVirtualAddress(), size });
+			const D3D12_GPU_VIRTUAL_ADDRESS address = resource->GetGPUVirtualAddress();
+
+			const std::unique_lock<std::shared_mutex> lock(_buffer_gpu_addresses_mutex);
+			if (!_buffer_gpu_address_lookup.emplace(resource, address).second)
+				return;
+
+			_buffer_gpu_addresses.emplace(address, buffer_gpu_address_range { size, resource });
+			_buffer_gpu_addresses_max_size = std::max(_buffer_gpu_addresses_max_size, size);
+		}
+		inline void unregister_buffer_gpu_address(ID3D12Resource *resource)
+		{
+			const std::unique_lock<std::shared_mutex> lock(_buffer_gpu_addresses_mutex);
+			if (const auto it = _buffer_gpu_address_lookup.find(resource); it != _buffer_gpu_address_lookup.end())
+			{
+				const auto range = _buffer_gpu_addresses.equal_range(it->second);
+				for (auto range_it = range.first; range_it != range.second; ++range_it)
+				{
+					if (range_it->second.resource == resource)
+					{
+						_buffer_gpu_addresses.erase(range_it);
+						break;
+					}
+				}
+
+				_buffer_gpu_address_lookup.erase(it);
+			}
 		}
 #endif
 
+		// Declared before the resource list, since that removes entries from them when destroyed
+		mutable resource_desc_cache _resource_desc_cache;
+		heap_allocator _heap_allocator;
 		com_object_list<ID3D12Resource> _resources;
 		std::unordered_map<uint64_t, ID3D12Resource *> _views;
 	};
@@ -32,6 +32,9 @@ reshade::d3d12::swapchain_impl::swapchain_impl(device_impl *device, command_queu
 
 				LOG(INFO) << "Running on " << desc.Description;
 			}
+
+			if (device->_dxgi_adapter == nullptr)
+				dxgi_adapter->QueryInterface(&device->_dxgi_adapter);
 		}
 	}
 
@@ -39,6 +42,19 @@ reshade::d3d12::swapchain_impl::swapchain_impl(device_impl *device, command_queu
 	reshade::invoke_addon_event<reshade::addon_event::init_swapchain>(this);
 #endif
 
+	// Create a dedicated compute queue, so that compute-only techniques can run asynchronously to the graphics work on the application queue
+	// This is not done for d3d12on7, since effects are recorded into a command list of the application there, which is only submitted after, so work on another queue could not be synchronized to it
+	if (D3D12_COMMAND_QUEUE_DESC queue_desc = { D3D12_COMMAND_LIST_TYPE_COMPUTE };
+		com_ptr<ID3D12CommandQueue> compute_queue;
+		_orig != nullptr && SUCCEEDED(device->_orig->CreateCommandQueue(&queue_desc, IID_PPV_ARGS(&compute_queue))))
+	{
+		compute_queue->SetName(L"ReShade compute queue");
+
+		_compute_queue = new command_queue_impl(device, compute_queue.release());
+		if (_compute_queue->get_immediate_command_list() != nullptr)
+			_async_compute_queue = _compute_queue;
+	}
+
 	// Default to three back buffers for d3d12on7
 	_backbuffers.resize(3);
 
@@ -49,6 +65,13 @@ reshade::d3d12::swapchain_impl::~swapchain_impl()
 {
 	on_reset();
 
+	if (_compute_queue != nullptr)
+	{
+		ID3D12CommandQueue *const compute_queue = _compute_queue->_orig;
+		delete _compute_queue;
+		compute_queue->Release();
+	}
+
 #if RESHADE_ADDON
 	reshade::invoke_addon_event<reshade::addon_event::destroy_swapchain>(this);
 #endif
@@ -68,6 +91,11 @@ uint32_t reshade::d3d12::swapchain_impl::get_current_back_buffer_index() const
 	return _swap_index;
 }
 
+void reshade::d3d12::swapchain_impl::synchronize_queues(api::command_queue *queue, api::command_queue *other_queue)
+{
+	static_cast<command_queue_impl *>(queue)->wait(static_cast<command_queue_impl *>(other_queue));
+}
+
 bool reshade::d3d12::swapchain_impl::on_init()
 {
 	assert(_orig != nullptr);
@@ -104,12 +132,21 @@ bool reshade::d3d12::swapchain_impl::on_init()
 	_height = swap_desc.BufferDesc.Height;
 	_backbuffer_format = convert_format(swap_desc.BufferDesc.Format);
 
+	// Initialize pipeline library with the data from the previous session, so that effect pipelines do not have to be compiled again
+	{	std::vector<char> pipeline_cache_data;
+		load_pipeline_cache(pipeline_cache_data);
+		static_cast<device_impl *>(_device)->load_pipeline_cache(std::move(pipeline_cache_data));
+	}
+
 	return runtime::on_init(swap_desc.OutputWindow);
 }
 void reshade::d3d12::swapchain_impl::on_reset()
 {
 	runtime::on_reset();
 
+	if (std::vector<char> pipeline_cache_data; static_cast<device_impl *>(_device)->save_pipeline_cache(pipeline_cache_data))
+		save_pipeline_cache(pipeline_cache_data);
+
 	// Make sure none of the resources below are currently in use (provided the runtime was initialized previously)
 	_device->wait_idle();
 
@@ -131,11 +168,17 @@ bool reshade::d3d12::swapchain_impl::on_present(ID3D12Resource *source, HWND hwn
 {
 	assert(source != nullptr);
 
-	_swap_index = (_swap_index + 1) % 3;
-
-	// Update source texture render target view
-	if (_backbuffers[_swap_index] != source)
+	// Applications usually cycle through the same few source textures, but not necessarily in a fixed order, so look for it among those seen before
+	if (const auto it = std::find(_backbuffers.begin(), _backbuffers.end(), source); it != _backbuffers.end())
+	{
+		_swap_index = static_cast<UINT>(std::distance(_backbuffers.begin(), it));
+	}
+	else
 	{
+		_swap_index = (_swap_index + 1) % 3;
+
+		// Only the views on the source textures have to be recreated when one is replaced by another with the same dimensions and format, so avoid reloading all effects
+		keep_effects_on_next_reset();
 		runtime::on_reset();
 
 		_backbuffers[_swap_index]  = source;
@@ -162,7 +205,7 @@ bool reshade::d3d12::swapchain_impl::on_present(ID3D12Resource *source, HWND hwn
 	on_present();
 	return true;
 }
-bool reshade::d3d12::swapchain_impl::on_layer_submit(UINT eye, ID3D12Resource *source, const float bounds[4], ID3D12Resource **target)
+bool reshade::d3d12::swapchain_impl::on_layer_submit(UINT eye, ID3D12Resource *source, const float bounds[4], bool side_by_side, ID3D12Resource **target)
 {
 	assert(eye < 2 && source != nullptr);
 
@@ -181,7 +224,7 @@ bool reshade::d3d12::swapchain_impl::on_layer_submit(UINT eye, ID3D12Resource *s
 	}
 
 	const UINT region_width = source_region.right - source_region.left;
-	const UINT target_width = region_width * 2;
+	const UINT target_width = side_by_side ? region_width * 2 : region_width;
 	const UINT region_height = source_region.bottom - source_region.top;
 
 	if (region_width == 0 || region_height == 0)
@@ -244,7 +287,7 @@ bool reshade::d3d12::swapchain_impl::on_layer_submit(UINT eye, ID3D12Resource *s
 	dst_location.pResource = _backbuffers[0].get();
 	dst_location.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
 	dst_location.SubresourceIndex = 0;
-	cmd_list->CopyTextureRegion(&dst_location, eye * region_width, 0, 0, &src_location, &source_region);
+	cmd_list->CopyTextureRegion(&dst_location, side_by_side ? eye * region_width : 0, 0, 0, &src_location, &source_region);
 
 	std::swap(transitions[0].Transition.StateBefore, transitions[0].Transition.StateAfter);
 	std::swap(transitions[1].Transition.StateBefore, transitions[1].Transition.StateAfter);
@@ -27,9 +27,12 @@ namespace reshade::d3d12
 		void on_reset();
 		void on_present();
 		bool on_present(ID3D12Resource *source, HWND hwnd);
-		bool on_layer_submit(UINT eye, ID3D12Resource *source, const float bounds[4], ID3D12Resource **target);
+		bool on_layer_submit(UINT eye, ID3D12Resource *source, const float bounds[4], bool side_by_side, ID3D12Resource **target);
 
 	private:
+		void synchronize_queues(api::command_queue *queue, api::command_queue *other_queue) final;
+
+		command_queue_impl *_compute_queue = nullptr;
 		UINT _swap_index = 0;
 		std::vector<com_ptr<ID3D12Resource>> _backbuffers;
 	};
@@ -1164,6 +1164,10 @@ auto reshade::d3d12::convert_query_type_to_heap_type(api::query_type type) -> D3
 		return static_cast<D3D12_QUERY_HEAP_TYPE>(0xFFFFFFFF);
 	}
 }
+auto reshade::d3d12::convert_query_type_to_result_size(api::query_type type) -> UINT
+{
+	return type == api::query_type::pipeline_statistics ? sizeof(D3D12_QUERY_DATA_PIPELINE_STATISTICS) : sizeof(uint64_t);
+}
 
 auto reshade::d3d12::convert_descriptor_type(api::descriptor_type type) -> D3D12_DESCRIPTOR_RANGE_TYPE
 {
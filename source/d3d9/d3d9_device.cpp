@@ -7,6 +7,8 @@
 #include "d3d9_device.hpp"
 #include "d3d9_swapchain.hpp"
 #include "reshade_api_type_convert.hpp"
+#include "profiling.hpp"
+#include <algorithm>
 
 #define output_interface_object(out, h) \
 	assert(h.handle != 0 && SUCCEEDED(reinterpret_cast<IUnknown *>(h.handle)->QueryInterface(out)) && (*out)->Release() == 1), *out = reinterpret_cast<decltype(*out)>(h.handle)
@@ -54,6 +56,214 @@ bool Direct3DDevice9::check_and_upgrade_interface(REFIID riid)
 	return true;
 }
 
+#if RESHADE_ADDON
+static inline UINT tracked_sampler_slot(DWORD sampler)
+{
+	if (sampler < 16)
+		return sampler;
+	if (sampler == D3DDMAPSAMPLER)
+		return 16;
+	if (sampler >= D3DVERTEXTEXTURESAMPLER0 && sampler <= D3DVERTEXTEXTURESAMPLER3)
+		return 17 + (sampler - D3DVERTEXTEXTURESAMPLER0);
+	return Direct3DDevice9::num_tracked_samplers;
+}
+
+void Direct3DDevice9::flush_pending_states(D3DPRIMITIVETYPE prim_type)
+{
+	if (!_has_pending_states && prim_type == _current_prim_type)
+		return;
+
+	_has_pending_states = false;
+
+	static_assert(
+		(DWORD)reshade::api::dynamic_state::depth_enable                == D3DRS_ZENABLE &&
+		(DWORD)reshade::api::dynamic_state::fill_mode                   == D3DRS_FILLMODE &&
+		(DWORD)reshade::api::dynamic_state::depth_write_mask            == D3DRS_ZWRITEENABLE &&
+		(DWORD)reshade::api::dynamic_state::alpha_test_enable           == D3DRS_ALPHATESTENABLE &&
+		(DWORD)reshade::api::dynamic_state::src_color_blend_factor      == D3DRS_SRCBLEND &&
+		(DWORD)reshade::api::dynamic_state::dst_color_blend_factor      == D3DRS_DESTBLEND &&
+		(DWORD)reshade::api::dynamic_state::cull_mode                   == D3DRS_CULLMODE &&
+		(DWORD)reshade::api::dynamic_state::depth_func                  == D3DRS_ZFUNC &&
+		(DWORD)reshade::api::dynamic_state::alpha_reference_value       == D3DRS_ALPHAREF &&
+		(DWORD)reshade::api::dynamic_state::alpha_func                  == D3DRS_ALPHAFUNC &&
+		(DWORD)reshade::api::dynamic_state::blend_enable                == D3DRS_ALPHABLENDENABLE &&
+		(DWORD)reshade::api::dynamic_state::stencil_enable              == D3DRS_STENCILENABLE &&
+		(DWORD)reshade::api::dynamic_state::front_stencil_fail_op       == D3DRS_STENCILFAIL &&
+		(DWORD)reshade::api::dynamic_state::front_stencil_depth_fail_op == D3DRS_STENCILZFAIL &&
+		(DWORD)reshade::api::dynamic_state::front_stencil_pass_op       == D3DRS_STENCILPASS &&
+		(DWORD)reshade::api::dynamic_state::front_stencil_func          == D3DRS_STENCILFUNC &&
+		(DWORD)reshade::api::dynamic_state::stencil_reference_value     == D3DRS_STENCILREF &&
+		(DWORD)reshade::api::dynamic_state::stencil_read_mask           == D3DRS_STENCILMASK &&
+		(DWORD)reshade::api::dynamic_state::stencil_write_mask          == D3DRS_STENCILWRITEMASK &&
+		(DWORD)reshade::api::dynamic_state::depth_clip_enable           == D3DRS_CLIPPING &&
+		(DWORD)reshade::api::dynamic_state::multisample_enable          == D3DRS_MULTISAMPLEANTIALIAS &&
+		(DWORD)reshade::api::dynamic_state::sample_mask                 == D3DRS_MULTISAMPLEMASK &&
+		(DWORD)reshade::api::dynamic_state::render_target_write_mask    == D3DRS_COLORWRITEENABLE &&
+		(DWORD)reshade::api::dynamic_state::color_blend_op              == D3DRS_BLENDOP &&
+		(DWORD)reshade::api::dynamic_state::scissor_enable              == D3DRS_SCISSORTESTENABLE &&
+		(DWORD)reshade::api::dynamic_state::depth_bias_slope_scaled     == D3DRS_SLOPESCALEDEPTHBIAS &&
+		(DWORD)reshade::api::dynamic_state::antialiased_line_enable     == D3DRS_ANTIALIASEDLINEENABLE &&
+		(DWORD)reshade::api::dynamic_state::back_stencil_fail_op        == D3DRS_CCW_STENCILFAIL &&
+		(DWORD)reshade::api::dynamic_state::back_stencil_depth_fail_op  == D3DRS_CCW_STENCILZFAIL &&
+		(DWORD)reshade::api::dynamic_state::back_stencil_pass_op        == D3DRS_CCW_STENCILPASS &&
+		(DWORD)reshade::api::dynamic_state::back_stencil_func           == D3DRS_CCW_STENCILFUNC &&
+		(DWORD)reshade::api::dynamic_state::blend_constant              == D3DRS_BLENDFACTOR &&
+		(DWORD)reshade::api::dynamic_state::srgb_write_enable           == D3DRS_SRGBWRITEENABLE &&
+		(DWORD)reshade::api::dynamic_state::depth_bias                  == D3DRS_DEPTHBIAS &&
+		(DWORD)reshade::api::dynamic_state::src_alpha_blend_factor      == D3DRS_SRCBLENDALPHA &&
+		(DWORD)reshade::api::dynamic_state::dst_alpha_blend_factor      == D3DRS_DESTBLENDALPHA &&
+		(DWORD)reshade::api::dynamic_state::alpha_blend_op              == D3DRS_BLENDOPALPHA);
+	static_assert(sizeof(D3DRENDERSTATETYPE) == sizeof(reshade::api::dynamic_state) && sizeof(DWORD) == sizeof(uint32_t));
+
+	static_assert(
+		(DWORD)reshade::api::primitive_topology::point_list == D3DPT_POINTLIST &&
+		(DWORD)reshade::api::primitive_topology::line_list == D3DPT_LINELIST &&
+		(DWORD)reshade::api::primitive_topology::line_strip == D3DPT_LINESTRIP &&
+		(DWORD)reshade::api::primitive_topology::triangle_list == D3DPT_TRIANGLELIST &&
+		(DWORD)reshade::api::primitive_topology::triangle_strip == D3DPT_TRIANGLESTRIP &&
+		(DWORD)reshade::api::primitive_topology::triangle_fan == D3DPT_TRIANGLEFAN);
+
+	uint32_t num_states = 0;
+	reshade::api::dynamic_state states[256 + 1];
+	uint32_t values[256 + 1];
+
+	if (prim_type != _current_prim_type)
+	{
+		_current_prim_type = prim_type;
+
+		states[num_states] = reshade::api::dynamic_state::primitive_topology;
+		values[num_states++] = static_cast<uint32_t>(prim_type);
+	}
+
+	for (DWORD i = 0; i < ARRAYSIZE(_render_states_pending); ++i)
+	{
+		for (uint32_t pending_mask = _render_states_pending[i]; pending_mask != 0; pending_mask &= pending_mask - 1)
+		{
+			DWORD bit = 0;
+			while ((pending_mask & (1u << bit)) == 0)
+				++bit;
+
+			const auto State = static_cast<D3DRENDERSTATETYPE>(i * 32 + bit);
+			DWORD Value = _render_states[State];
+
+			switch (State)
+			{
+			case D3DRS_FILLMODE:
+				Value = static_cast<uint32_t>(reshade::d3d9::convert_fill_mode(static_cast<D3DFILLMODE>(Value)));
+				break;
+			case D3DRS_SRCBLEND:
+			case D3DRS_DESTBLEND:
+			case D3DRS_SRCBLENDALPHA:
+			case D3DRS_DESTBLENDALPHA:
+				Value = static_cast<uint32_t>(reshade::d3d9::convert_blend_factor(static_cast<D3DBLEND>(Value)));
+				break;
+			case D3DRS_CULLMODE:
+				Value = static_cast<uint32_t>(reshade::d3d9::convert_cull_mode(static_cast<D3DCULL>(Value), false));
+				break;
+			case D3DRS_ZFUNC:
+			case D3DRS_ALPHAFUNC:
+			case D3DRS_STENCILFUNC:
+			case D3DRS_CCW_STENCILFUNC:
+				Value = static_cast<uint32_t>(reshade::d3d9::convert_compare_op(static_cast<D3DCMPFUNC>(Value)));
+				break;
+			case D3DRS_STENCILFAIL:
+			case D3DRS_STENCILZFAIL:
+			case D3DRS_STENCILPASS:
+			case D3DRS_CCW_STENCILFAIL:
+			case D3DRS_CCW_STENCILZFAIL:
+			case D3DRS_CCW_STENCILPASS:
+				Value = static_cast<uint32_t>(reshade::d3d9::convert_stencil_op(static_cast<D3DSTENCILOP>(Value)));
+				break;
+			case D3DRS_BLENDOP:
+			case D3DRS_BLENDOPALPHA:
+				Value = static_cast<uint32_t>(reshade::d3d9::convert_blend_op(static_cast<D3DBLENDOP>(Value)));
+				break;
+			}
+
+			states[num_states] = static_cast<reshade::api::dynamic_state>(State);
+			values[num_states++] = Value;
+		}
+
+		_render_states_pending[i] = 0;
+	}
+
+	if (num_states != 0)
+		reshade::invoke_addon_event<reshade::addon_event::bind_pipeline_states>(this, num_states, states, values);
+
+	if (_textures_pending == 0 && _samplers_pending == 0)
+		return;
+
+	if (!reshade::has_addon_event<reshade::addon_event::push_descriptors>())
+	{
+		_textures_pending = 0;
+		_samplers_pending = 0;
+		return;
+	}
+
+	// Report the range of changed slots per shader stage with a single event each
+	const struct { reshade::api::shader_stage stage; UINT first_slot, num_slots; DWORD first_sampler, first_register; } stage_ranges[] = {
+		{ reshade::api::shader_stage::pixel, 0, 16, 0, 0 },
+		{ reshade::api::shader_stage::hull, 16, 1, D3DDMAPSAMPLER, D3DDMAPSAMPLER },
+		{ reshade::api::shader_stage::vertex, 17, 4, D3DVERTEXTEXTURESAMPLER0, 0 },
+	};
+
+	for (const auto &range : stage_ranges)
+	{
+		const uint32_t range_mask = ((1u << range.num_slots) - 1) << range.first_slot;
+
+		if (const uint32_t pending_mask = _textures_pending & range_mask; pending_mask != 0)
+		{
+			UINT first = range.first_slot, last = range.first_slot + range.num_slots - 1;
+			while ((pending_mask & (1u << first)) == 0)
+				++first;
+			while ((pending_mask & (1u << last)) == 0)
+				--last;
+
+			reshade::api::resource_view views[16];
+			for (UINT slot = first; slot <= last; ++slot)
+				views[slot - first] = { reinterpret_cast<uintptr_t>(_textures[slot]) };
+
+			reshade::invoke_addon_event<reshade::addon_event::push_descriptors>(this, range.stage, reshade::api::pipeline_layout { 0 }, 0, reshade::api::descriptor_type::shader_resource_view, range.first_register + (first - range.first_slot), last - first + 1, views);
+		}
+
+		if (const uint32_t pending_mask = _samplers_pending & range_mask; pending_mask != 0)
+		{
+			UINT first = range.first_slot, last = range.first_slot + range.num_slots - 1;
+			while ((pending_mask & (1u << first)) == 0)
+				++first;
+			while ((pending_mask & (1u << last)) == 0)
+				--last;
+
+			DWORD sampler_data[16][12];
+			reshade::api::sampler samplers[16];
+			for (UINT slot = first; slot <= last; ++slot)
+			{
+				// Query the complete sampler state only once per draw call, instead of for every single change
+				for (D3DSAMPLERSTATETYPE state = D3DSAMP_ADDRESSU; state <= D3DSAMP_SRGBTEXTURE; state = static_cast<D3DSAMPLERSTATETYPE>(state + 1))
+					_orig->GetSamplerState(range.first_sampler + (slot - range.first_slot), state, &sampler_data[slot - first][state]);
+
+				samplers[slot - first] = { reinterpret_cast<uintptr_t>(sampler_data[slot - first]) };
+			}
+
+			reshade::invoke_addon_event<reshade::addon_event::push_descriptors>(this, range.stage, reshade::api::pipeline_layout { 0 }, 0, reshade::api::descriptor_type::sampler, range.first_register + (first - range.first_slot), last - first + 1, samplers);
+		}
+	}
+
+	_textures_pending = 0;
+	_samplers_pending = 0;
+}
+void Direct3DDevice9::reset_tracked_states()
+{
+	_has_pending_states = false;
+	std::fill_n(_render_states_known, ARRAYSIZE(_render_states_known), 0);
+	std::fill_n(_render_states_pending, ARRAYSIZE(_render_states_pending), 0);
+	_textures_pending = 0;
+	std::fill_n(_textures, ARRAYSIZE(_textures), nullptr);
+	_samplers_pending = 0;
+	std::fill_n(_sampler_states_known, ARRAYSIZE(_sampler_states_known), static_cast<uint16_t>(0));
+}
+#endif
+
 HRESULT STDMETHODCALLTYPE Direct3DDevice9::QueryInterface(REFIID riid, void **ppvObj)
 {
 	if (ppvObj == nullptr)
@@ -222,6 +432,11 @@ HRESULT STDMETHODCALLTYPE Direct3DDevice9::Reset(D3DPRESENT_PARAMETERS *pPresent
 		return hr;
 	}
 
+	// Resetting the device resets all state to its defaults
+#if RESHADE_ADDON
+	reset_tracked_states();
+#endif
+
 	device_impl::on_after_reset(pp);
 	if (!_implicit_swapchain->on_init())
 		LOG(ERROR) << "Failed to recreate Direct3D 9 runtime environment on runtime " << static_cast<reshade::d3d9::swapchain_impl *>(_implicit_swapchain) << '!';
@@ -230,14 +445,18 @@ HRESULT STDMETHODCALLTYPE Direct3DDevice9::Reset(D3DPRESENT_PARAMETERS *pPresent
 }
 HRESULT STDMETHODCALLTYPE Direct3DDevice9::Present(const RECT *pSourceRect, const RECT *pDestRect, HWND hDestWindowOverride, const RGNDATA *pDirtyRegion)
 {
+	{
+		RESHADE_PROFILE_SCOPE("IDirect3DDevice9::Present");
+
 #if RESHADE_ADDON
-	reshade::invoke_addon_event<reshade::addon_event::finish_render_pass>(this);
-	reshade::invoke_addon_event<reshade::addon_event::present>(this, _implicit_swapchain);
+		reshade::invoke_addon_event<reshade::addon_event::finish_render_pass>(this);
+		reshade::invoke_addon_event<reshade::addon_event::present>(this, _implicit_swapchain);
 #endif
 
-	// Only call into the effect runtime if the entire surface is presented, to avoid partial updates messing up effects and the GUI
-	if (Direct3DSwapChain9::is_presenting_entire_surface(pSourceRect, hDestWindowOverride))
-		_implicit_swapchain->on_present();
+		// Only call into the effect runtime if the entire surface is presented, to avoid partial updates messing up effects and the GUI
+		if (Direct3DSwapChain9::is_presenting_entire_surface(pSourceRect, hDestWindowOverride))
+			_implicit_swapchain->on_present();
+	}
 
 	const HRESULT hr = _orig->Present(pSourceRect, pDestRect, hDestWindowOverride, pDirtyRegion);
 
@@ -799,6 +1018,9 @@ HRESULT STDMETHODCALLTYPE Direct3DDevice9::Clear(DWORD Count, const D3DRECT *pRe
 		(DWORD)reshade::api::attachment_type::stencil == D3DCLEAR_STENCIL);
 	static_assert(sizeof(D3DRECT) == (sizeof(int32_t) * 4));
 
+	// Clears are affected by some render states (e.g. the scissor test), so report those first
+	flush_pending_states(_current_prim_type);
+
 	if (const float color[4] = { ((Color >> 16) & 0xFF) / 255.0f, ((Color >> 8) & 0xFF) / 255.0f, (Color & 0xFF) / 255.0f, ((Color >> 24) & 0xFF) / 255.0f };
 		reshade::invoke_addon_event<reshade::addon_event::clear_attachments>(this, static_cast<reshade::api::attachment_type>(Flags), color, Z, static_cast<uint8_t>(Stencil), Count, reinterpret_cast<const int32_t *>(pRects)))
 		return D3D_OK;
@@ -821,7 +1043,7 @@ HRESULT STDMETHODCALLTYPE Direct3DDevice9::SetViewport(const D3DVIEWPORT9 *pView
 {
 	const HRESULT hr = _orig->SetViewport(pViewport);
 #if RESHADE_ADDON
-	if (SUCCEEDED(hr) && !reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::bind_viewports)].empty())
+	if (SUCCEEDED(hr) && reshade::has_addon_event<reshade::addon_event::bind_viewports>())
 	{
 		const float viewport_data[6] = {
 			static_cast<float>(pViewport->X),
@@ -877,83 +1099,16 @@ HRESULT STDMETHODCALLTYPE Direct3DDevice9::SetRenderState(D3DRENDERSTATETYPE Sta
 {
 	const HRESULT hr = _orig->SetRenderState(State, Value);
 #if RESHADE_ADDON
-	if (SUCCEEDED(hr))
+	if (SUCCEEDED(hr) && static_cast<DWORD>(State) < 256)
 	{
-		static_assert(
-			(DWORD)reshade::api::dynamic_state::depth_enable                == D3DRS_ZENABLE &&
-			(DWORD)reshade::api::dynamic_state::fill_mode                   == D3DRS_FILLMODE &&
-			(DWORD)reshade::api::dynamic_state::depth_write_mask            == D3DRS_ZWRITEENABLE &&
-			(DWORD)reshade::api::dynamic_state::alpha_test_enable           == D3DRS_ALPHATESTENABLE &&
-			(DWORD)reshade::api::dynamic_state::src_color_blend_factor      == D3DRS_SRCBLEND &&
-			(DWORD)reshade::api::dynamic_state::dst_color_blend_factor      == D3DRS_DESTBLEND &&
-			(DWORD)reshade::api::dynamic_state::cull_mode                   == D3DRS_CULLMODE &&
-			(DWORD)reshade::api::dynamic_state::depth_func                  == D3DRS_ZFUNC &&
-			(DWORD)reshade::api::dynamic_state::alpha_reference_value       == D3DRS_ALPHAREF &&
-			(DWORD)reshade::api::dynamic_state::alpha_func                  == D3DRS_ALPHAFUNC &&
-			(DWORD)reshade::api::dynamic_state::blend_enable                == D3DRS_ALPHABLENDENABLE &&
-			(DWORD)reshade::api::dynamic_state::stencil_enable              == D3DRS_STENCILENABLE &&
-			(DWORD)reshade::api::dynamic_state::front_stencil_fail_op       == D3DRS_STENCILFAIL &&
-			(DWORD)reshade::api::dynamic_state::front_stencil_depth_fail_op == D3DRS_STENCILZFAIL &&
-			(DWORD)reshade::api::dynamic_state::front_stencil_pass_op       == D3DRS_STENCILPASS &&
-			(DWORD)reshade::api::dynamic_state::front_stencil_func          == D3DRS_STENCILFUNC &&
-			(DWORD)reshade::api::dynamic_state::stencil_reference_value     == D3DRS_STENCILREF &&
-			(DWORD)reshade::api::dynamic_state::stencil_read_mask           == D3DRS_STENCILMASK &&
-			(DWORD)reshade::api::dynamic_state::stencil_write_mask          == D3DRS_STENCILWRITEMASK &&
-			(DWORD)reshade::api::dynamic_state::depth_clip_enable           == D3DRS_CLIPPING &&
-			(DWORD)reshade::api::dynamic_state::multisample_enable          == D3DRS_MULTISAMPLEANTIALIAS &&
-			(DWORD)reshade::api::dynamic_state::sample_mask                 == D3DRS_MULTISAMPLEMASK &&
-			(DWORD)reshade::api::dynamic_state::render_target_write_mask    == D3DRS_COLORWRITEENABLE &&
-			(DWORD)reshade::api::dynamic_state::color_blend_op              == D3DRS_BLENDOP &&
-			(DWORD)reshade::api::dynamic_state::scissor_enable              == D3DRS_SCISSORTESTENABLE &&
-			(DWORD)reshade::api::dynamic_state::depth_bias_slope_scaled     == D3DRS_SLOPESCALEDEPTHBIAS &&
-			(DWORD)reshade::api::dynamic_state::antialiased_line_enable     == D3DRS_ANTIALIASEDLINEENABLE &&
-			(DWORD)reshade::api::dynamic_state::back_stencil_fail_op        == D3DRS_CCW_STENCILFAIL &&
-			(DWORD)reshade::api::dynamic_state::back_stencil_depth_fail_op  == D3DRS_CCW_STENCILZFAIL &&
-			(DWORD)reshade::api::dynamic_state::back_stencil_pass_op        == D3DRS_CCW_STENCILPASS &&
-			(DWORD)reshade::api::dynamic_state::back_stencil_func           == D3DRS_CCW_STENCILFUNC &&
-			(DWORD)reshade::api::dynamic_state::blend_constant              == D3DRS_BLENDFACTOR &&
-			(DWORD)reshade::api::dynamic_state::srgb_write_enable           == D3DRS_SRGBWRITEENABLE &&
-			(DWORD)reshade::api::dynamic_state::depth_bias                  == D3DRS_DEPTHBIAS &&
-			(DWORD)reshade::api::dynamic_state::src_alpha_blend_factor      == D3DRS_SRCBLENDALPHA &&
-			(DWORD)reshade::api::dynamic_state::dst_alpha_blend_factor      == D3DRS_DESTBLENDALPHA &&
-			(DWORD)reshade::api::dynamic_state::alpha_blend_op              == D3DRS_BLENDOPALPHA);
-		static_assert(sizeof(State) == sizeof(reshade::api::dynamic_state) && sizeof(Value) == sizeof(uint32_t));
-
-		switch (State)
+		const uint32_t bit = 1u << (State % 32);
+		if ((_render_states_known[State / 32] & bit) == 0 || _render_states[State] != Value)
 		{
-		case D3DRS_FILLMODE:
-			Value = static_cast<uint32_t>(reshade::d3d9::convert_fill_mode(static_cast<D3DFILLMODE>(Value)));
-			break;
-		case D3DRS_SRCBLEND:
-		case D3DRS_DESTBLEND:
-		case D3DRS_SRCBLENDALPHA:
-		case D3DRS_DESTBLENDALPHA:
-			Value = static_cast<uint32_t>(reshade::d3d9::convert_blend_factor(static_cast<D3DBLEND>(Value)));
-			break;
-		case D3DRS_CULLMODE:
-			Value = static_cast<uint32_t>(reshade::d3d9::convert_cull_mode(static_cast<D3DCULL>(Value), false));
-			break;
-		case D3DRS_ZFUNC:
-		case D3DRS_ALPHAFUNC:
-		case D3DRS_STENCILFUNC:
-		case D3DRS_CCW_STENCILFUNC:
-			Value = static_cast<uint32_t>(reshade::d3d9::convert_compare_op(static_cast<D3DCMPFUNC>(Value)));
-			break;
-		case D3DRS_STENCILFAIL:
-		case D3DRS_STENCILZFAIL:
-		case D3DRS_STENCILPASS:
-		case D3DRS_CCW_STENCILFAIL:
-		case D3DRS_CCW_STENCILZFAIL:
-		case D3DRS_CCW_STENCILPASS:
-			Value = static_cast<uint32_t>(reshade::d3d9::convert_stencil_op(static_cast<D3DSTENCILOP>(Value)));
-			break;
-		case D3DRS_BLENDOP:
-		case D3DRS_BLENDOPALPHA:
-			Value = static_cast<uint32_t>(reshade::d3d9::convert_blend_op(static_cast<D3DBLENDOP>(Value)));
-			break;
+			_render_states[State] = Value;
+			_render_states_known[State / 32] |= bit;
+			_render_states_pending[State / 32] |= bit;
+			_has_pending_states = true;
 		}
-
-		reshade::invoke_addon_event<reshade::addon_event::bind_pipeline_states>(this, 1, reinterpret_cast<const reshade::api::dynamic_state *>(&State), reinterpret_cast<const uint32_t *>(&Value));
 	}
 #endif
 	return hr;
@@ -990,21 +1145,12 @@ HRESULT STDMETHODCALLTYPE Direct3DDevice9::SetTexture(DWORD Stage, IDirect3DBase
 {
 	const HRESULT hr = _orig->SetTexture(Stage, pTexture);
 #if RESHADE_ADDON
-	if (SUCCEEDED(hr) && !reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::push_descriptors)].empty())
+	if (const UINT slot = tracked_sampler_slot(Stage);
+		SUCCEEDED(hr) && slot < num_tracked_samplers && _textures[slot] != pTexture)
 	{
-		reshade::api::shader_stage shader_stage = reshade::api::shader_stage::pixel;
-		if (Stage >= D3DVERTEXTEXTURESAMPLER0)
-		{
-			shader_stage = reshade::api::shader_stage::vertex;
-			Stage -= D3DVERTEXTEXTURESAMPLER0;
-		}
-		else if (Stage == D3DDMAPSAMPLER)
-		{
-			shader_stage = reshade::api::shader_stage::hull;
-		}
-
-		const reshade::api::resource_view view = { reinterpret_cast<uintptr_t>(pTexture) };
-		reshade::invoke_addon_event<reshade::addon_event::push_descriptors>(this, shader_stage, reshade::api::pipeline_layout { 0 }, 0, reshade::api::descriptor_type::shader_resource_view, Stage, 1, &view);
+		_textures[slot] = pTexture;
+		_textures_pending |= 1u << slot;
+		_has_pending_states = true;
 	}
 #endif
 	return hr;
@@ -1025,27 +1171,17 @@ HRESULT STDMETHODCALLTYPE Direct3DDevice9::SetSamplerState(DWORD Sampler, D3DSAM
 {
 	const HRESULT hr = _orig->SetSamplerState(Sampler, Type, Value);
 #if RESHADE_ADDON
-	if (SUCCEEDED(hr) && !reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::push_descriptors)].empty())
+	if (const UINT slot = tracked_sampler_slot(Sampler);
+		SUCCEEDED(hr) && slot < num_tracked_samplers && Type >= D3DSAMP_ADDRESSU && Type <= D3DSAMP_DMAPOFFSET)
 	{
-		reshade::api::shader_stage shader_stage = reshade::api::shader_stage::pixel;
-		if (Sampler >= D3DVERTEXTEXTURESAMPLER0)
-		{
-			shader_stage = reshade::api::shader_stage::vertex;
-			Sampler -= D3DVERTEXTEXTURESAMPLER0;
-		}
-		else if (Sampler == D3DDMAPSAMPLER)
+		const uint16_t bit = static_cast<uint16_t>(1u << Type);
+		if ((_sampler_states_known[slot] & bit) == 0 || _sampler_states[slot][Type] != Value)
 		{
-			shader_stage = reshade::api::shader_stage::hull;
+			_sampler_states[slot][Type] = Value;
+			_sampler_states_known[slot] |= bit;
+			_samplers_pending |= 1u << slot;
+			_has_pending_states = true;
 		}
-
-		DWORD sampler_data[12];
-		for (D3DSAMPLERSTATETYPE state = D3DSAMP_ADDRESSU; state <= D3DSAMP_SRGBTEXTURE; state = static_cast<D3DSAMPLERSTATETYPE>(state + 1))
-		{
-			_orig->GetSamplerState(Sampler, state, &sampler_data[state]);
-		}
-
-		const reshade::api::sampler sampler_handle = { reinterpret_cast<uintptr_t>(sampler_data) };
-		reshade::invoke_addon_event<reshade::addon_event::push_descriptors>(this, shader_stage, reshade::api::pipeline_layout { 0 }, 0, reshade::api::descriptor_type::sampler, Sampler, 1, &sampler_handle);
 	}
 #endif
 	return hr;
@@ -1106,21 +1242,7 @@ float   STDMETHODCALLTYPE Direct3DDevice9::GetNPatchMode()
 HRESULT STDMETHODCALLTYPE Direct3DDevice9::DrawPrimitive(D3DPRIMITIVETYPE PrimitiveType, UINT StartVertex, UINT PrimitiveCount)
 {
 #if RESHADE_ADDON
-	if (PrimitiveType != _current_prim_type)
-	{
-		_current_prim_type = PrimitiveType;
-
-		static_assert(
-			(DWORD)reshade::api::primitive_topology::point_list == D3DPT_POINTLIST &&
-			(DWORD)reshade::api::primitive_topology::line_list == D3DPT_LINELIST &&
-			(DWORD)reshade::api::primitive_topology::line_strip == D3DPT_LINESTRIP &&
-			(DWORD)reshade::api::primitive_topology::triangle_list == D3DPT_TRIANGLELIST &&
-			(DWORD)reshade::api::primitive_topology::triangle_strip == D3DPT_TRIANGLESTRIP &&
-			(DWORD)reshade::api::primitive_topology::triangle_fan == D3DPT_TRIANGLEFAN);
-
-		const reshade::api::dynamic_state state = reshade::api::dynamic_state::primitive_topology;
-		reshade::invoke_addon_event<reshade::addon_event::bind_pipeline_states>(this, 1, &state, reinterpret_cast<const uint32_t *>(&PrimitiveType));
-	}
+	flush_pending_states(PrimitiveType);
 
 	if (reshade::invoke_addon_event<reshade::addon_event::draw>(this, reshade::d3d9::calc_vertex_from_prim_count(PrimitiveType, PrimitiveCount), 1, StartVertex, 0))
 		return D3D_OK;
@@ -1130,13 +1252,7 @@ HRESULT STDMETHODCALLTYPE Direct3DDevice9::DrawPrimitive(D3DPRIMITIVETYPE Primit
 HRESULT STDMETHODCALLTYPE Direct3DDevice9::DrawIndexedPrimitive(D3DPRIMITIVETYPE PrimitiveType, INT BaseVertexIndex, UINT MinVertexIndex, UINT NumVertices, UINT StartIndex, UINT PrimitiveCount)
 {
 #if RESHADE_ADDON
-	if (PrimitiveType != _current_prim_type)
-	{
-		_current_prim_type = PrimitiveType;
-
-		const reshade::api::dynamic_state state = reshade::api::dynamic_state::primitive_topology;
-		reshade::invoke_addon_event<reshade::addon_event::bind_pipeline_states>(this, 1, &state, reinterpret_cast<const uint32_t *>(&PrimitiveType));
-	}
+	flush_pending_states(PrimitiveType);
 
 	if (reshade::invoke_addon_event<reshade::addon_event::draw_indexed>(this, reshade::d3d9::calc_vertex_from_prim_count(PrimitiveType, PrimitiveCount), 1, StartIndex, BaseVertexIndex, 0))
 		return D3D_OK;
@@ -1146,13 +1262,7 @@ HRESULT STDMETHODCALLTYPE Direct3DDevice9::DrawIndexedPrimitive(D3DPRIMITIVETYPE
 HRESULT STDMETHODCALLTYPE Direct3DDevice9::DrawPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT PrimitiveCount, const void *pVertexStreamZeroData, UINT VertexStreamZeroStride)
 {
 #if RESHADE_ADDON
-	if (PrimitiveType != _current_prim_type)
-	{
-		_current_prim_type = PrimitiveType;
-
-		const reshade::api::dynamic_state state = reshade::api::dynamic_state::primitive_topology;
-		reshade::invoke_addon_event<reshade::addon_event::bind_pipeline_states>(this, 1, &state, reinterpret_cast<const uint32_t *>(&PrimitiveType));
-	}
+	flush_pending_states(PrimitiveType);
 
 	if (reshade::invoke_addon_event<reshade::addon_event::draw>(this, reshade::d3d9::calc_vertex_from_prim_count(PrimitiveType, PrimitiveCount), 1, 0, 0))
 		return D3D_OK;
@@ -1162,13 +1272,7 @@ HRESULT STDMETHODCALLTYPE Direct3DDevice9::DrawPrimitiveUP(D3DPRIMITIVETYPE Prim
 HRESULT STDMETHODCALLTYPE Direct3DDevice9::DrawIndexedPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT MinVertexIndex, UINT NumVertices, UINT PrimitiveCount, const void *pIndexData, D3DFORMAT IndexDataFormat, const void *pVertexStreamZeroData, UINT VertexStreamZeroStride)
 {
 #if RESHADE_ADDON
-	if (PrimitiveType != _current_prim_type)
-	{
-		_current_prim_type = PrimitiveType;
-
-		const reshade::api::dynamic_state state = reshade::api::dynamic_state::primitive_topology;
-		reshade::invoke_addon_event<reshade::addon_event::bind_pipeline_states>(this, 1, &state, reinterpret_cast<const uint32_t *>(&PrimitiveType));
-	}
+	flush_pending_states(PrimitiveType);
 
 	if (reshade::invoke_addon_event<reshade::addon_event::draw_indexed>(this, reshade::d3d9::calc_vertex_from_prim_count(PrimitiveType, PrimitiveCount), 1, 0, 0, 0))
 		return D3D_OK;
@@ -1218,6 +1322,7 @@ HRESULT STDMETHODCALLTYPE Direct3DDevice9::CreateVertexShader(const DWORD *pFunc
 	// Total size is at byte offset 24 (see http://timjones.io/blog/archive/2015/09/02/parsing-direct3d-shader-bytecode)
 	desc.graphics.vertex_shader.code_size = pFunction[6];
 	desc.graphics.vertex_shader.format = reshade::api::shader_format::dxbc;
+	reshade::addon::compute_shader_hashes(desc);
 
 	if (reshade::api::pipeline replacement = { 0 };
 		ppShader != nullptr &&
@@ -1370,6 +1475,7 @@ HRESULT STDMETHODCALLTYPE Direct3DDevice9::CreatePixelShader(const DWORD *pFunct
 	// Total size is at byte offset 24 (see http://timjones.io/blog/archive/2015/09/02/parsing-direct3d-shader-bytecode)
 	desc.graphics.pixel_shader.code_size = pFunction[6];
 	desc.graphics.pixel_shader.format = reshade::api::shader_format::dxbc;
+	reshade::addon::compute_shader_hashes(desc);
 
 	if (reshade::api::pipeline replacement = { 0 };
 		ppShader != nullptr &&
@@ -1491,13 +1597,17 @@ HRESULT STDMETHODCALLTYPE Direct3DDevice9::ComposeRects(IDirect3DSurface9 *pSrc,
 }
 HRESULT STDMETHODCALLTYPE Direct3DDevice9::PresentEx(const RECT *pSourceRect, const RECT *pDestRect, HWND hDestWindowOverride, const RGNDATA *pDirtyRegion, DWORD dwFlags)
 {
+	{
+		RESHADE_PROFILE_SCOPE("IDirect3DDevice9Ex::PresentEx");
+
 #if RESHADE_ADDON
-	reshade::invoke_addon_event<reshade::addon_event::finish_render_pass>(this);
-	reshade::invoke_addon_event<reshade::addon_event::present>(this, _implicit_swapchain);
+		reshade::invoke_addon_event<reshade::addon_event::finish_render_pass>(this);
+		reshade::invoke_addon_event<reshade::addon_event::present>(this, _implicit_swapchain);
 #endif
 
-	if (Direct3DSwapChain9::is_presenting_entire_surface(pSourceRect, hDestWindowOverride))
-		_implicit_swapchain->on_present();
+		if (Direct3DSwapChain9::is_presenting_entire_surface(pSourceRect, hDestWindowOverride))
+			_implicit_swapchain->on_present();
+	}
 
 	assert(_extended_interface);
 	const HRESULT hr = static_cast<IDirect3DDevice9Ex *>(_orig)->PresentEx(pSourceRect, pDestRect, hDestWindowOverride, pDirtyRegion, dwFlags);
@@ -1660,6 +1770,11 @@ HRESULT STDMETHODCALLTYPE Direct3DDevice9::ResetEx(D3DPRESENT_PARAMETERS *pPrese
 		return hr;
 	}
 
+	// Resetting the device resets all state to its defaults
+#if RESHADE_ADDON
+	reset_tracked_states();
+#endif
+
 	device_impl::on_after_reset(pp);
 	if (!_implicit_swapchain->on_init())
 		LOG(ERROR) << "Failed to recreate Direct3D 9 runtime environment on runtime " << static_cast<reshade::d3d9::swapchain_impl *>(_implicit_swapchain) << '!';
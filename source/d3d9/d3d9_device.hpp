@@ -157,6 +157,26 @@ struct DECLSPEC_UUID("F1006E9A-1C51-4AF4-ACEF-3605D2D4C8EE") Direct3DDevice9 fin
 
 	bool check_and_upgrade_interface(REFIID riid);
 
+#if RESHADE_ADDON
+	void flush_pending_states(D3DPRIMITIVETYPE prim_type);
+	void reset_tracked_states();
+
+	// Pixel shader samplers, followed by the displacement map sampler and the four vertex shader samplers
+	static constexpr UINT num_tracked_samplers = 16 + 1 + 4;
+
+	// Shadow copy of the render states, textures and sampler states last reported to add-ons, so that redundant changes are not reported again
+	// Changes are collected and only reported right before the next draw or clear call, to combine them into as few events as possible
+	bool _has_pending_states = false;
+	uint32_t _render_states_known[256 / 32] = {};
+	uint32_t _render_states_pending[256 / 32] = {};
+	DWORD _render_states[256];
+	uint32_t _textures_pending = 0;
+	IDirect3DBaseTexture9 *_textures[num_tracked_samplers] = {};
+	uint32_t _samplers_pending = 0;
+	uint16_t _sampler_states_known[num_tracked_samplers] = {};
+	DWORD _sampler_states[num_tracked_samplers][D3DSAMP_DMAPOFFSET + 1];
+#endif
+
 	LONG _ref = 1;
 	bool _extended_interface;
 	bool _use_software_rendering;
@@ -6,6 +6,7 @@
 #include "dll_log.hpp"
 #include "d3d9_device.hpp"
 #include "d3d9_swapchain.hpp"
+#include "profiling.hpp"
 
 Direct3DSwapChain9::Direct3DSwapChain9(Direct3DDevice9 *device, IDirect3DSwapChain9   *original) :
 	swapchain_impl(device, original),
@@ -106,13 +107,17 @@ ULONG   STDMETHODCALLTYPE Direct3DSwapChain9::Release()
 
 HRESULT STDMETHODCALLTYPE Direct3DSwapChain9::Present(const RECT *pSourceRect, const RECT *pDestRect, HWND hDestWindowOverride, const RGNDATA *pDirtyRegion, DWORD dwFlags)
 {
+	{
+		RESHADE_PROFILE_SCOPE("IDirect3DSwapChain9::Present");
+
 #if RESHADE_ADDON
-	reshade::invoke_addon_event<reshade::addon_event::present>(_device, this);
+		reshade::invoke_addon_event<reshade::addon_event::present>(_device, this);
 #endif
 
-	// Only call into the effect runtime if the entire surface is presented, to avoid partial updates messing up effects and the GUI
-	if (is_presenting_entire_surface(pSourceRect, hDestWindowOverride))
-		swapchain_impl::on_present();
+		// Only call into the effect runtime if the entire surface is presented, to avoid partial updates messing up effects and the GUI
+		if (is_presenting_entire_surface(pSourceRect, hDestWindowOverride))
+			swapchain_impl::on_present();
+	}
 
 	return _orig->Present(pSourceRect, pDestRect, hDestWindowOverride, pDirtyRegion, dwFlags);
 }
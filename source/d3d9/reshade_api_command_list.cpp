@@ -8,11 +8,27 @@
 #include "reshade_api_type_convert.hpp"
 #include <algorithm>
 
+void reshade::d3d9::device_impl::track_state_usage(const state_usage &usage)
+{
+	// Save the application state before it is overwritten for the first time
+	if (_active_state_block != nullptr)
+		_active_state_block->capture_additional(usage);
+
+	_state_usage = usage;
+}
+
 void reshade::d3d9::device_impl::begin_render_pass(api::render_pass pass)
 {
 	assert(pass.handle != 0);
 	const auto pass_impl = reinterpret_cast<const render_pass_impl *>(pass.handle);
 
+	if (!_state_usage.has_render_state(D3DRS_SRGBWRITEENABLE))
+	{
+		state_usage usage = _state_usage;
+		usage.add_render_state(D3DRS_SRGBWRITEENABLE);
+		track_state_usage(usage);
+	}
+
 	for (UINT i = 0; i < _caps.NumSimultaneousRTs; ++i)
 		_orig->SetRenderTarget(i, pass_impl->rtv[i]);
 
@@ -30,6 +46,29 @@ void reshade::d3d9::device_impl::bind_pipeline(api::pipeline_stage type, api::pi
 {
 	assert(pipeline.handle != 0);
 
+	state_usage usage = _state_usage;
+
+	switch (type)
+	{
+	case api::pipeline_stage::all_graphics:
+		usage.merge(reinterpret_cast<pipeline_impl *>(pipeline.handle)->usage);
+		break;
+	case api::pipeline_stage::input_assembler:
+		usage.vertex_declaration = true;
+		break;
+	case api::pipeline_stage::vertex_shader:
+		usage.vertex_shader = true;
+		break;
+	case api::pipeline_stage::pixel_shader:
+		usage.pixel_shader = true;
+		break;
+	default:
+		break;
+	}
+
+	if (!_state_usage.includes(usage))
+		track_state_usage(usage);
+
 	switch (type)
 	{
 	case api::pipeline_stage::all_graphics:
@@ -52,6 +91,14 @@ void reshade::d3d9::device_impl::bind_pipeline(api::pipeline_stage type, api::pi
 }
 void reshade::d3d9::device_impl::bind_pipeline_states(uint32_t count, const api::dynamic_state *states, const uint32_t *values)
 {
+	state_usage usage = _state_usage;
+	// Dynamic states that do not map to a render state have values outside the render state range, so are ignored here
+	for (UINT i = 0; i < count; ++i)
+		usage.add_render_state(static_cast<D3DRENDERSTATETYPE>(states[i]));
+
+	if (!_state_usage.includes(usage))
+		track_state_usage(usage);
+
 	for (UINT i = 0; i < count; ++i)
 	{
 		switch (states[i])
@@ -95,6 +142,16 @@ void reshade::d3d9::device_impl::bind_scissor_rects(uint32_t first, uint32_t cou
 
 void reshade::d3d9::device_impl::push_constants(api::shader_stage stages, api::pipeline_layout, uint32_t, uint32_t first, uint32_t count, const void *values)
 {
+	state_usage usage = _state_usage;
+	const UINT num_constants = std::min((first + count + 3) / 4, state_usage::num_shader_constants);
+	if ((stages & api::shader_stage::vertex) == api::shader_stage::vertex)
+		usage.num_vs_constants = std::max(usage.num_vs_constants, num_constants);
+	if ((stages & api::shader_stage::pixel) == api::shader_stage::pixel)
+		usage.num_ps_constants = std::max(usage.num_ps_constants, num_constants);
+
+	if (!_state_usage.includes(usage))
+		track_state_usage(usage);
+
 	if ((stages & api::shader_stage::vertex) == api::shader_stage::vertex)
 		_orig->SetVertexShaderConstantF(first / 4, static_cast<const float *>(values), count / 4);
 	if ((stages & api::shader_stage::pixel) == api::shader_stage::pixel)
@@ -127,6 +184,17 @@ void reshade::d3d9::device_impl::push_descriptors(api::shader_stage stages, api:
 			break;
 		}
 
+		if (type == api::descriptor_type::sampler || type == api::descriptor_type::sampler_with_resource_view || type == api::descriptor_type::shader_resource_view)
+		{
+			state_usage usage = _state_usage;
+			for (UINT i = 0; i < count; ++i)
+				if (const UINT slot = state_usage::sampler_slot(i + first); slot < state_usage::num_samplers)
+					usage.samplers |= 1u << slot;
+
+			if (!_state_usage.includes(usage))
+				track_state_usage(usage);
+		}
+
 		switch (type)
 		{
 		case api::descriptor_type::sampler:
@@ -201,10 +269,24 @@ void reshade::d3d9::device_impl::bind_index_buffer(api::resource buffer, uint64_
 	UNREFERENCED_PARAMETER(index_size);
 #endif
 
+	if (!_state_usage.indices)
+	{
+		state_usage usage = _state_usage;
+		usage.indices = true;
+		track_state_usage(usage);
+	}
+
 	_orig->SetIndices(reinterpret_cast<IDirect3DIndexBuffer9 *>(buffer.handle));
 }
 void reshade::d3d9::device_impl::bind_vertex_buffers(uint32_t first, uint32_t count, const api::resource *buffers, const uint64_t *offsets, const uint32_t *strides)
 {
+	if (first + count > _state_usage.num_stream_sources_used)
+	{
+		state_usage usage = _state_usage;
+		usage.num_stream_sources_used = std::min(first + count, state_usage::num_stream_sources);
+		track_state_usage(usage);
+	}
+
 	for (UINT i = 0; i < count; ++i)
 	{
 		assert(offsets == nullptr || offsets[i] <= std::numeric_limits<UINT>::max());
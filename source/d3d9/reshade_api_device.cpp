@@ -6,6 +6,7 @@
 #include "dll_log.hpp"
 #include "reshade_api_device.hpp"
 #include "reshade_api_type_convert.hpp"
+#include "resource_ledger.hpp"
 #include <algorithm>
 
 static inline bool convert_format_internal(reshade::api::format format, D3DFORMAT &internal_format)
@@ -262,6 +263,10 @@ bool reshade::d3d9::device_impl::check_format_support(api::format format, api::r
 	const D3DFORMAT d3d_format = convert_format(format);
 	return d3d_format != D3DFMT_UNKNOWN && SUCCEEDED(_d3d->CheckDeviceFormat(_cp.AdapterOrdinal, _cp.DeviceType, D3DFMT_X8R8G8B8, d3d_usage, D3DRTYPE_TEXTURE, d3d_format));
 }
+uint64_t reshade::d3d9::device_impl::get_resource_memory_usage(api::resource_memory_owner owner, api::resource_memory_category category) const
+{
+	return resource_ledger::get_usage(this, owner, category);
+}
 
 bool reshade::d3d9::device_impl::is_resource_handle_valid(api::resource handle) const
 {
@@ -298,6 +303,9 @@ bool reshade::d3d9::device_impl::create_sampler(const api::sampler_desc &desc, a
 }
 bool reshade::d3d9::device_impl::create_resource(const api::resource_desc &desc, const api::subresource_data *initial_data, api::resource_usage, api::resource *out)
 {
+	// Keep track of how much memory ReShade and add-ons allocate (this also covers all the return paths below)
+	const resource_ledger::create_scope ledger_scope(this, desc, out, _ReturnAddress());
+
 	switch (desc.type)
 	{
 		case api::resource_type::buffer:
@@ -666,6 +674,17 @@ bool reshade::d3d9::device_impl::create_pipeline_graphics(const api::pipeline_de
 		return false;
 	}
 
+	// Keep track of everything the state block modifies, so that only that has to be saved before it is applied
+	state_usage usage;
+	usage.vertex_declaration = true;
+	usage.vertex_shader = true;
+	usage.pixel_shader = true;
+
+	const auto set_render_state = [this, &usage](D3DRENDERSTATETYPE state, DWORD value) {
+		_orig->SetRenderState(state, value);
+		usage.add_render_state(state);
+	};
+
 	_orig->SetVertexShader(vertex_shader.get());
 	_orig->SetPixelShader(pixel_shader.get());
 
@@ -677,95 +696,96 @@ bool reshade::d3d9::device_impl::create_pipeline_graphics(const api::pipeline_de
 	{
 		// Setup default input (used to have a vertex ID in vertex shaders)
 		_orig->SetStreamSource(0, _default_input_stream.get(), 0, sizeof(float));
+		usage.num_stream_sources_used = 1;
 		_orig->SetVertexDeclaration(_default_input_layout.get());
 	}
 
-	_orig->SetRenderState(D3DRS_ZENABLE,
+	set_render_state(D3DRS_ZENABLE,
 		desc.graphics.depth_stencil_state.depth_enable);
-	_orig->SetRenderState(D3DRS_FILLMODE,
+	set_render_state(D3DRS_FILLMODE,
 		convert_fill_mode(desc.graphics.rasterizer_state.fill_mode));
-	_orig->SetRenderState(D3DRS_ZWRITEENABLE,
+	set_render_state(D3DRS_ZWRITEENABLE,
 		desc.graphics.depth_stencil_state.depth_write_mask);
-	_orig->SetRenderState(D3DRS_ALPHATESTENABLE, FALSE);
-	_orig->SetRenderState(D3DRS_LASTPIXEL, TRUE);
-	_orig->SetRenderState(D3DRS_SRCBLEND,
+	set_render_state(D3DRS_ALPHATESTENABLE, FALSE);
+	set_render_state(D3DRS_LASTPIXEL, TRUE);
+	set_render_state(D3DRS_SRCBLEND,
 		convert_blend_factor(desc.graphics.blend_state.src_color_blend_factor[0]));
-	_orig->SetRenderState(D3DRS_DESTBLEND,
+	set_render_state(D3DRS_DESTBLEND,
 		convert_blend_factor(desc.graphics.blend_state.dst_color_blend_factor[0]));
-	_orig->SetRenderState(D3DRS_CULLMODE,
+	set_render_state(D3DRS_CULLMODE,
 		convert_cull_mode(desc.graphics.rasterizer_state.cull_mode, desc.graphics.rasterizer_state.front_counter_clockwise));
-	_orig->SetRenderState(D3DRS_ZFUNC,
+	set_render_state(D3DRS_ZFUNC,
 		convert_compare_op(desc.graphics.depth_stencil_state.depth_func));
-	_orig->SetRenderState(D3DRS_DITHERENABLE, FALSE);
-	_orig->SetRenderState(D3DRS_ALPHABLENDENABLE,
+	set_render_state(D3DRS_DITHERENABLE, FALSE);
+	set_render_state(D3DRS_ALPHABLENDENABLE,
 		desc.graphics.blend_state.blend_enable[0]);
-	_orig->SetRenderState(D3DRS_FOGENABLE, FALSE);
-	_orig->SetRenderState(D3DRS_STENCILENABLE,
+	set_render_state(D3DRS_FOGENABLE, FALSE);
+	set_render_state(D3DRS_STENCILENABLE,
 		desc.graphics.depth_stencil_state.stencil_enable);
-	_orig->SetRenderState(D3DRS_STENCILZFAIL,
+	set_render_state(D3DRS_STENCILZFAIL,
 		convert_stencil_op(desc.graphics.rasterizer_state.front_counter_clockwise ? desc.graphics.depth_stencil_state.back_stencil_depth_fail_op : desc.graphics.depth_stencil_state.front_stencil_depth_fail_op));
-	_orig->SetRenderState(D3DRS_STENCILFAIL,
+	set_render_state(D3DRS_STENCILFAIL,
 		convert_stencil_op(desc.graphics.rasterizer_state.front_counter_clockwise ? desc.graphics.depth_stencil_state.back_stencil_fail_op : desc.graphics.depth_stencil_state.front_stencil_fail_op));
-	_orig->SetRenderState(D3DRS_STENCILPASS,
+	set_render_state(D3DRS_STENCILPASS,
 		convert_stencil_op(desc.graphics.rasterizer_state.front_counter_clockwise ? desc.graphics.depth_stencil_state.back_stencil_pass_op : desc.graphics.depth_stencil_state.front_stencil_pass_op));
-	_orig->SetRenderState(D3DRS_STENCILFUNC,
+	set_render_state(D3DRS_STENCILFUNC,
 		convert_compare_op(desc.graphics.rasterizer_state.front_counter_clockwise ? desc.graphics.depth_stencil_state.back_stencil_func : desc.graphics.depth_stencil_state.front_stencil_func));
-	_orig->SetRenderState(D3DRS_STENCILREF,
+	set_render_state(D3DRS_STENCILREF,
 		desc.graphics.depth_stencil_state.stencil_reference_value);
-	_orig->SetRenderState(D3DRS_STENCILMASK,
+	set_render_state(D3DRS_STENCILMASK,
 		desc.graphics.depth_stencil_state.stencil_read_mask);
-	_orig->SetRenderState(D3DRS_STENCILWRITEMASK,
+	set_render_state(D3DRS_STENCILWRITEMASK,
 		desc.graphics.depth_stencil_state.stencil_write_mask);
-	_orig->SetRenderState(D3DRS_CLIPPING,
+	set_render_state(D3DRS_CLIPPING,
 		desc.graphics.rasterizer_state.depth_clip_enable);
-	_orig->SetRenderState(D3DRS_LIGHTING, FALSE);
-	_orig->SetRenderState(D3DRS_VERTEXBLEND, D3DVBF_DISABLE);
-	_orig->SetRenderState(D3DRS_CLIPPLANEENABLE, 0);
-	_orig->SetRenderState(D3DRS_MULTISAMPLEANTIALIAS,
+	set_render_state(D3DRS_LIGHTING, FALSE);
+	set_render_state(D3DRS_VERTEXBLEND, D3DVBF_DISABLE);
+	set_render_state(D3DRS_CLIPPLANEENABLE, 0);
+	set_render_state(D3DRS_MULTISAMPLEANTIALIAS,
 		desc.graphics.rasterizer_state.multisample_enable);
-	_orig->SetRenderState(D3DRS_MULTISAMPLEMASK,
+	set_render_state(D3DRS_MULTISAMPLEMASK,
 		desc.graphics.sample_mask);
-	_orig->SetRenderState(D3DRS_COLORWRITEENABLE,
+	set_render_state(D3DRS_COLORWRITEENABLE,
 		desc.graphics.blend_state.render_target_write_mask[0]);
-	_orig->SetRenderState(D3DRS_BLENDOP,
+	set_render_state(D3DRS_BLENDOP,
 		convert_blend_op(desc.graphics.blend_state.color_blend_op[0]));
-	_orig->SetRenderState(D3DRS_SCISSORTESTENABLE,
+	set_render_state(D3DRS_SCISSORTESTENABLE,
 		desc.graphics.rasterizer_state.scissor_enable);
-	_orig->SetRenderState(D3DRS_SLOPESCALEDEPTHBIAS,
+	set_render_state(D3DRS_SLOPESCALEDEPTHBIAS,
 		*reinterpret_cast<const DWORD *>(&desc.graphics.rasterizer_state.slope_scaled_depth_bias));
-	_orig->SetRenderState(D3DRS_ANTIALIASEDLINEENABLE,
+	set_render_state(D3DRS_ANTIALIASEDLINEENABLE,
 		desc.graphics.rasterizer_state.antialiased_line_enable);
-	_orig->SetRenderState(D3DRS_ENABLEADAPTIVETESSELLATION, FALSE);
-	_orig->SetRenderState(D3DRS_TWOSIDEDSTENCILMODE,
+	set_render_state(D3DRS_ENABLEADAPTIVETESSELLATION, FALSE);
+	set_render_state(D3DRS_TWOSIDEDSTENCILMODE,
 		desc.graphics.rasterizer_state.cull_mode == api::cull_mode::none && (
 		desc.graphics.depth_stencil_state.front_stencil_fail_op != desc.graphics.depth_stencil_state.back_stencil_fail_op ||
 		desc.graphics.depth_stencil_state.front_stencil_depth_fail_op != desc.graphics.depth_stencil_state.back_stencil_depth_fail_op ||
 		desc.graphics.depth_stencil_state.front_stencil_pass_op != desc.graphics.depth_stencil_state.back_stencil_pass_op ||
 		desc.graphics.depth_stencil_state.front_stencil_func != desc.graphics.depth_stencil_state.back_stencil_func));
-	_orig->SetRenderState(D3DRS_CCW_STENCILZFAIL,
+	set_render_state(D3DRS_CCW_STENCILZFAIL,
 		convert_stencil_op(desc.graphics.rasterizer_state.front_counter_clockwise ? desc.graphics.depth_stencil_state.front_stencil_depth_fail_op : desc.graphics.depth_stencil_state.back_stencil_depth_fail_op));
-	_orig->SetRenderState(D3DRS_CCW_STENCILFAIL,
+	set_render_state(D3DRS_CCW_STENCILFAIL,
 		convert_stencil_op(desc.graphics.rasterizer_state.front_counter_clockwise ? desc.graphics.depth_stencil_state.front_stencil_fail_op : desc.graphics.depth_stencil_state.back_stencil_fail_op));
-	_orig->SetRenderState(D3DRS_CCW_STENCILPASS,
+	set_render_state(D3DRS_CCW_STENCILPASS,
 		convert_stencil_op(desc.graphics.rasterizer_state.front_counter_clockwise ? desc.graphics.depth_stencil_state.front_stencil_pass_op : desc.graphics.depth_stencil_state.back_stencil_pass_op));
-	_orig->SetRenderState(D3DRS_CCW_STENCILFUNC,
+	set_render_state(D3DRS_CCW_STENCILFUNC,
 		convert_compare_op(desc.graphics.rasterizer_state.front_counter_clockwise ? desc.graphics.depth_stencil_state.front_stencil_func : desc.graphics.depth_stencil_state.back_stencil_func));
-	_orig->SetRenderState(D3DRS_COLORWRITEENABLE1,
+	set_render_state(D3DRS_COLORWRITEENABLE1,
 		desc.graphics.blend_state.render_target_write_mask[1]);
-	_orig->SetRenderState(D3DRS_COLORWRITEENABLE2,
+	set_render_state(D3DRS_COLORWRITEENABLE2,
 		desc.graphics.blend_state.render_target_write_mask[2]);
-	_orig->SetRenderState(D3DRS_COLORWRITEENABLE3,
+	set_render_state(D3DRS_COLORWRITEENABLE3,
 		desc.graphics.blend_state.render_target_write_mask[3]);
-	_orig->SetRenderState(D3DRS_BLENDFACTOR,
+	set_render_state(D3DRS_BLENDFACTOR,
 		desc.graphics.blend_state.blend_constant);
-	_orig->SetRenderState(D3DRS_DEPTHBIAS,
+	set_render_state(D3DRS_DEPTHBIAS,
 		*reinterpret_cast<const DWORD *>(&desc.graphics.rasterizer_state.depth_bias));
-	_orig->SetRenderState(D3DRS_SEPARATEALPHABLENDENABLE, TRUE);
-	_orig->SetRenderState(D3DRS_SRCBLENDALPHA,
+	set_render_state(D3DRS_SEPARATEALPHABLENDENABLE, TRUE);
+	set_render_state(D3DRS_SRCBLENDALPHA,
 		convert_blend_factor(desc.graphics.blend_state.src_alpha_blend_factor[0]));
-	_orig->SetRenderState(D3DRS_DESTBLENDALPHA,
+	set_render_state(D3DRS_DESTBLENDALPHA,
 		convert_blend_factor(desc.graphics.blend_state.dst_alpha_blend_factor[0]));
-	_orig->SetRenderState(D3DRS_BLENDOPALPHA,
+	set_render_state(D3DRS_BLENDOPALPHA,
 		convert_blend_op(desc.graphics.blend_state.alpha_blend_op[0]));
 
 	if (com_ptr<IDirect3DStateBlock9> state_block;
@@ -774,6 +794,7 @@ bool reshade::d3d9::device_impl::create_pipeline_graphics(const api::pipeline_de
 		const auto result = new pipeline_impl();
 		result->prim_type = convert_primitive_topology(desc.graphics.topology);
 		result->state_block = std::move(state_block);
+		result->usage = usage;
 
 		*out = { reinterpret_cast<uintptr_t>(result) };
 		return true;
@@ -980,6 +1001,12 @@ bool reshade::d3d9::device_impl::create_descriptor_set_layout(const api::descrip
 
 bool reshade::d3d9::device_impl::create_query_pool(api::query_type type, uint32_t size, api::query_pool *out)
 {
+	if (type == api::query_type::pipeline_statistics)
+	{
+		*out = { 0 };
+		return false;
+	}
+
 	const auto result = new query_pool_impl();
 	result->type = type;
 	result->queries.resize(size);
@@ -1043,6 +1070,8 @@ void reshade::d3d9::device_impl::destroy_sampler(api::sampler handle)
 }
 void reshade::d3d9::device_impl::destroy_resource(api::resource handle)
 {
+	resource_ledger::unregister_resource(this, handle);
+
 	if (handle.handle != 0)
 		reinterpret_cast<IUnknown *>(handle.handle)->Release();
 }
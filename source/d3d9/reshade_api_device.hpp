@@ -25,6 +25,9 @@ namespace reshade::d3d9
 		bool check_capability(api::device_caps capability) const final;
 		bool check_format_support(api::format format, api::resource_usage usage) const final;
 
+		bool get_memory_budget(uint64_t *, uint64_t *) const final { return false; }
+		uint64_t get_resource_memory_usage(api::resource_memory_owner owner, api::resource_memory_category category) const final;
+
 		bool is_resource_handle_valid(api::resource handle) const final;
 		bool is_resource_view_handle_valid(api::resource_view handle) const final;
 
@@ -57,6 +60,9 @@ namespace reshade::d3d9
 		void destroy_render_pass(api::render_pass handle) final;
 		void destroy_descriptor_sets(api::descriptor_set_layout layout, uint32_t count, const api::descriptor_set *sets) final;
 
+		bool create_command_list(api::command_list **out) final { *out = nullptr; return false; }
+		void destroy_command_list(api::command_list *) final { assert(false); }
+
 		bool get_attachment(api::render_pass pass, api::attachment_type type, uint32_t index, api::resource_view *out) const final;
 		uint32_t get_attachment_count(api::render_pass pass, api::attachment_type type) const final;
 
@@ -83,6 +89,13 @@ namespace reshade::d3d9
 
 		void flush_immediate_command_list() const final { /* no-op */ }
 
+		void execute_command_list(api::command_list *cmd_list) final { assert(cmd_list == this); }
+		bool allocate_upload_memory(uint64_t, uint64_t, void **out_data, api::resource *, uint64_t *) final { *out_data = nullptr; return false; }
+
+		// D3D9 keeps resources alive while they are in use and reads back data synchronously, so every fence value counts as reached right away
+		uint64_t get_pending_fence_value() final { return ++_fence_value; }
+		uint64_t get_completed_fence_value() const final { return _fence_value; }
+
 		void barrier(uint32_t, const api::resource *, const api::resource_usage *, const api::resource_usage *) final { /* no-op */ }
 
 		void begin_render_pass(api::render_pass pass) final;
@@ -134,10 +147,13 @@ namespace reshade::d3d9
 		com_ptr<IDirect3D9> _d3d;
 
 	private:
+		void track_state_usage(const state_usage &usage);
+
 		state_block _backup_state;
 		com_ptr<IDirect3DStateBlock9> _copy_state;
 		com_ptr<IDirect3DVertexBuffer9> _default_input_stream;
 		com_ptr<IDirect3DVertexDeclaration9> _default_input_layout;
+		uint64_t _fence_value = 0;
 
 	protected:
 		void on_reset();
@@ -148,5 +164,9 @@ namespace reshade::d3d9
 		com_object_list<IDirect3DResource9, true> _resources;
 		D3DPRIMITIVETYPE _current_prim_type = static_cast<D3DPRIMITIVETYPE>(0);
 		struct render_pass_impl *_current_pass;
+		// Parts of the device state that were modified through the API so far
+		state_usage _state_usage;
+		// State block that is currently saving the application state, if any
+		state_block *_active_state_block = nullptr;
 	};
 }
@@ -112,7 +112,9 @@ void reshade::d3d9::swapchain_impl::on_present()
 	if (!is_initialized() || FAILED(device_impl->_orig->BeginScene()))
 		return;
 
-	_app_state.capture();
+	// Only save the parts of the application state that are modified through the API, saving everything with a state block is slow
+	_app_state.capture(device_impl->_state_usage);
+	device_impl->_active_state_block = &_app_state;
 	BOOL software_rendering_enabled = FALSE;
 	if ((device_impl->_cp.BehaviorFlags & D3DCREATE_MIXED_VERTEXPROCESSING) != 0)
 		software_rendering_enabled = device_impl->_orig->GetSoftwareVertexProcessing(),
@@ -129,6 +131,7 @@ void reshade::d3d9::swapchain_impl::on_present()
 		device_impl->_orig->StretchRect(_backbuffer_resolved.get(), nullptr, _backbuffer.get(), nullptr, D3DTEXF_NONE);
 
 	// Apply previous state from application
+	device_impl->_active_state_block = nullptr;
 	_app_state.apply_and_release();
 	if ((device_impl->_cp.BehaviorFlags & D3DCREATE_MIXED_VERTEXPROCESSING) != 0)
 		device_impl->_orig->SetSoftwareVertexProcessing(software_rendering_enabled);
@@ -11,6 +11,8 @@ namespace reshade::d3d9
 	{
 		com_ptr<IDirect3DStateBlock9> state_block;
 		D3DPRIMITIVETYPE prim_type;
+		// Parts of the device state the state block modifies when applied
+		state_usage usage;
 	};
 
 	struct pipeline_layout_impl
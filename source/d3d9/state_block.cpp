@@ -4,10 +4,46 @@
  */
 
 #include "state_block.hpp"
+#include <algorithm>
+
+bool reshade::d3d9::state_usage::includes(const state_usage &other) const
+{
+	for (UINT i = 0; i < ARRAYSIZE(render_states); ++i)
+		if ((other.render_states[i] & ~render_states[i]) != 0)
+			return false;
+
+	return (other.samplers & ~samplers) == 0 &&
+		(!other.vertex_declaration || vertex_declaration) &&
+		(!other.vertex_shader || vertex_shader) &&
+		(!other.pixel_shader || pixel_shader) &&
+		(!other.indices || indices) &&
+		other.num_stream_sources_used <= num_stream_sources_used &&
+		other.num_vs_constants <= num_vs_constants &&
+		other.num_ps_constants <= num_ps_constants;
+}
+void reshade::d3d9::state_usage::merge(const state_usage &other)
+{
+	for (UINT i = 0; i < ARRAYSIZE(render_states); ++i)
+		render_states[i] |= other.render_states[i];
+
+	samplers |= other.samplers;
+	vertex_declaration |= other.vertex_declaration;
+	vertex_shader |= other.vertex_shader;
+	pixel_shader |= other.pixel_shader;
+	indices |= other.indices;
+	num_stream_sources_used = std::max(num_stream_sources_used, other.num_stream_sources_used);
+	num_vs_constants = std::max(num_vs_constants, other.num_vs_constants);
+	num_ps_constants = std::max(num_ps_constants, other.num_ps_constants);
+}
 
 reshade::d3d9::state_block::state_block(IDirect3DDevice9 *device) :
 	_device(device)
 {
+	// Pure devices do not support any 'Get*' calls for state that can be stored in state blocks
+	D3DDEVICE_CREATION_PARAMETERS cp = {};
+	_device->GetCreationParameters(&cp);
+	_is_pure_device = (cp.BehaviorFlags & D3DCREATE_PUREDEVICE) != 0;
+
 #ifdef RESHADE_TEST_APPLICATION
 	// Avoid errors from the D3D9 debug runtime because the other slots return D3DERR_NOTFOUND with the test application
 	_num_simultaneous_rts = 1;
@@ -27,6 +63,7 @@ reshade::d3d9::state_block::~state_block()
 void reshade::d3d9::state_block::capture()
 {
 	_state_block->Capture();
+	_captured_all = true;
 
 	_device->GetViewport(&_viewport);
 
@@ -34,9 +71,133 @@ void reshade::d3d9::state_block::capture()
 		_device->GetRenderTarget(target, &_render_targets[target]);
 	_device->GetDepthStencilSurface(&_depth_stencil);
 }
+void reshade::d3d9::state_block::capture(const state_usage &usage)
+{
+	if (_is_pure_device)
+	{
+		capture();
+		return;
+	}
+
+	_captured_all = false;
+	_captured = state_usage();
+
+	_device->GetViewport(&_viewport);
+	// Setting render targets resets the scissor rectangle too, so always have to restore it
+	_device->GetScissorRect(&_scissor_rect);
+
+	for (DWORD target = 0; target < _num_simultaneous_rts; target++)
+		_device->GetRenderTarget(target, &_render_targets[target]);
+	_device->GetDepthStencilSurface(&_depth_stencil);
+
+	capture_additional(usage);
+}
+void reshade::d3d9::state_block::capture_additional(const state_usage &usage)
+{
+	if (_captured_all || _captured.includes(usage))
+		return;
+
+	for (UINT i = 0; i < ARRAYSIZE(usage.render_states); ++i)
+	{
+		for (UINT mask = usage.render_states[i] & ~_captured.render_states[i]; mask != 0; mask &= mask - 1)
+		{
+			UINT bit = 0;
+			while ((mask & (1u << bit)) == 0)
+				++bit;
+
+			const auto state = static_cast<D3DRENDERSTATETYPE>(i * 32 + bit);
+			_device->GetRenderState(state, &_render_states[state]);
+		}
+	}
+
+	for (UINT slot = 0; slot < state_usage::num_samplers; ++slot)
+	{
+		if ((usage.samplers & ~_captured.samplers & (1u << slot)) == 0)
+			continue;
+
+		const DWORD sampler = state_usage::sampler_index(slot);
+		_device->GetTexture(sampler, &_textures[slot]);
+		for (D3DSAMPLERSTATETYPE state = D3DSAMP_ADDRESSU; state <= D3DSAMP_SRGBTEXTURE; state = static_cast<D3DSAMPLERSTATETYPE>(state + 1))
+			_device->GetSamplerState(sampler, state, &_sampler_states[slot][state - 1]);
+	}
+
+	if (usage.vertex_declaration && !_captured.vertex_declaration)
+	{
+		_device->GetFVF(&_fvf);
+		_device->GetVertexDeclaration(&_vertex_declaration);
+	}
+	if (usage.vertex_shader && !_captured.vertex_shader)
+		_device->GetVertexShader(&_vs);
+	if (usage.pixel_shader && !_captured.pixel_shader)
+		_device->GetPixelShader(&_ps);
+	if (usage.indices && !_captured.indices)
+		_device->GetIndices(&_indices);
+
+	for (UINT i = _captured.num_stream_sources_used; i < usage.num_stream_sources_used; ++i)
+		_device->GetStreamSource(i, &_stream_sources[i], &_stream_offsets[i], &_stream_strides[i]);
+
+	if (usage.num_vs_constants > _captured.num_vs_constants)
+		_device->GetVertexShaderConstantF(_captured.num_vs_constants, _vs_constants[_captured.num_vs_constants], usage.num_vs_constants - _captured.num_vs_constants);
+	if (usage.num_ps_constants > _captured.num_ps_constants)
+		_device->GetPixelShaderConstantF(_captured.num_ps_constants, _ps_constants[_captured.num_ps_constants], usage.num_ps_constants - _captured.num_ps_constants);
+
+	_captured.merge(usage);
+}
 void reshade::d3d9::state_block::apply_and_release()
 {
-	_state_block->Apply();
+	if (_captured_all)
+	{
+		_state_block->Apply();
+	}
+	else
+	{
+		for (UINT i = 0; i < ARRAYSIZE(_captured.render_states); ++i)
+		{
+			for (UINT mask = _captured.render_states[i]; mask != 0; mask &= mask - 1)
+			{
+				UINT bit = 0;
+				while ((mask & (1u << bit)) == 0)
+					++bit;
+
+				const auto state = static_cast<D3DRENDERSTATETYPE>(i * 32 + bit);
+				_device->SetRenderState(state, _render_states[state]);
+			}
+		}
+
+		for (UINT slot = 0; slot < state_usage::num_samplers; ++slot)
+		{
+			if ((_captured.samplers & (1u << slot)) == 0)
+				continue;
+
+			const DWORD sampler = state_usage::sampler_index(slot);
+			_device->SetTexture(sampler, _textures[slot].get());
+			for (D3DSAMPLERSTATETYPE state = D3DSAMP_ADDRESSU; state <= D3DSAMP_SRGBTEXTURE; state = static_cast<D3DSAMPLERSTATETYPE>(state + 1))
+				_device->SetSamplerState(sampler, state, _sampler_states[slot][state - 1]);
+		}
+
+		if (_captured.vertex_declaration)
+		{
+			// Restore the flexible vertex format instead of the declaration generated from it, if the application used one
+			if (_fvf != 0)
+				_device->SetFVF(_fvf);
+			else
+				_device->SetVertexDeclaration(_vertex_declaration.get());
+		}
+		if (_captured.vertex_shader)
+			_device->SetVertexShader(_vs.get());
+		if (_captured.pixel_shader)
+			_device->SetPixelShader(_ps.get());
+		if (_captured.indices)
+			_device->SetIndices(_indices.get());
+
+		for (UINT i = 0; i < _captured.num_stream_sources_used; ++i)
+			_device->SetStreamSource(i, _stream_sources[i].get(), _stream_offsets[i], _stream_strides[i]);
+
+		if (_captured.num_vs_constants != 0)
+			_device->SetVertexShaderConstantF(0, _vs_constants[0], _captured.num_vs_constants);
+		if (_captured.num_ps_constants != 0)
+			_device->SetPixelShaderConstantF(0, _ps_constants[0], _captured.num_ps_constants);
+	}
 
 	for (DWORD target = 0; target < _num_simultaneous_rts; target++)
 		_device->SetRenderTarget(target, _render_targets[target].get());
@@ -44,6 +205,8 @@ void reshade::d3d9::state_block::apply_and_release()
 
 	// Set viewport after render targets have been set, since 'SetRenderTarget' causes the viewport to be set to the full size of the render target
 	_device->SetViewport(&_viewport);
+	if (!_captured_all)
+		_device->SetScissorRect(&_scissor_rect);
 
 	release_all_device_objects();
 }
@@ -61,4 +224,19 @@ void reshade::d3d9::state_block::release_all_device_objects()
 	_depth_stencil.reset();
 	for (auto &render_target : _render_targets)
 		render_target.reset();
+
+	if (_captured_all)
+		return;
+
+	for (UINT slot = 0; slot < state_usage::num_samplers; ++slot)
+		if ((_captured.samplers & (1u << slot)) != 0)
+			_textures[slot].reset();
+	_vertex_declaration.reset();
+	_vs.reset();
+	_ps.reset();
+	_indices.reset();
+	for (UINT i = 0; i < _captured.num_stream_sources_used; ++i)
+		_stream_sources[i].reset();
+
+	_captured = state_usage();
 }
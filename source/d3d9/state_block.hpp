@@ -10,6 +10,41 @@
 
 namespace reshade::d3d9
 {
+	/// <summary>
+	/// Describes which parts of the device state were modified through the API so far, which is all that a <see cref="state_block"/> has to save and restore.
+	/// </summary>
+	struct state_usage
+	{
+		// All render state types fit into this (the last one is 'D3DRS_BLENDOPALPHA' with value 209)
+		static constexpr UINT num_render_states = 256;
+		// Pixel shader samplers, followed by the four vertex shader samplers (see 'sampler_index')
+		static constexpr UINT num_samplers = 16 + 4;
+		static constexpr UINT num_stream_sources = 16;
+		static constexpr UINT num_shader_constants = 256;
+
+		static DWORD sampler_index(UINT slot) { return slot < 16 ? slot : D3DVERTEXTEXTURESAMPLER0 + (slot - 16); }
+		static UINT sampler_slot(DWORD sampler) { return sampler < 16 ? sampler : sampler >= D3DVERTEXTEXTURESAMPLER0 && sampler <= D3DVERTEXTEXTURESAMPLER3 ? 16 + (sampler - D3DVERTEXTEXTURESAMPLER0) : num_samplers; }
+
+		bool has_render_state(D3DRENDERSTATETYPE state) const { return state >= num_render_states || (render_states[state / 32] & (1u << (state % 32))) != 0; }
+		void add_render_state(D3DRENDERSTATETYPE state) { if (state < num_render_states) render_states[state / 32] |= 1u << (state % 32); }
+
+		bool includes(const state_usage &other) const;
+		void merge(const state_usage &other);
+
+		// Bit mask of render states, indexed by 'D3DRENDERSTATETYPE'
+		UINT render_states[num_render_states / 32] = {};
+		// Bit mask of sampler slots for which the texture and sampler states were modified
+		UINT samplers = 0;
+		bool vertex_declaration = false;
+		bool vertex_shader = false;
+		bool pixel_shader = false;
+		bool indices = false;
+		UINT num_stream_sources_used = 0;
+		// Number of float constant registers
+		UINT num_vs_constants = 0;
+		UINT num_ps_constants = 0;
+	};
+
 	class state_block
 	{
 	public:
@@ -19,7 +54,20 @@ namespace reshade::d3d9
 		bool init_state_block();
 		void release_state_block();
 
+		/// <summary>
+		/// Saves the render targets, depth-stencil surface and viewport and all other device state (using a state block).
+		/// </summary>
 		void capture();
+		/// <summary>
+		/// Saves the render targets, depth-stencil surface, viewport and scissor rectangle and all parts of the device state described by <paramref name="usage"/>.
+		/// This falls back to saving all device state on pure devices, since those cannot query the current state.
+		/// </summary>
+		void capture(const state_usage &usage);
+		/// <summary>
+		/// Saves additional parts of the device state after <see cref="capture"/> was called, which have to be restored as well because they are about to be modified for the first time.
+		/// Parts that were already saved are not touched.
+		/// </summary>
+		void capture_additional(const state_usage &usage);
 		void apply_and_release();
 
 	private:
@@ -27,9 +75,27 @@ namespace reshade::d3d9
 
 		com_ptr<IDirect3DDevice9> _device;
 		com_ptr<IDirect3DStateBlock9> _state_block;
+		bool _is_pure_device;
+		bool _captured_all = false;
+		state_usage _captured;
 		UINT _num_simultaneous_rts;
 		D3DVIEWPORT9 _viewport = {};
+		RECT _scissor_rect = {};
 		com_ptr<IDirect3DSurface9> _depth_stencil;
 		com_ptr<IDirect3DSurface9> _render_targets[8];
+		DWORD _render_states[state_usage::num_render_states];
+		com_ptr<IDirect3DBaseTexture9> _textures[state_usage::num_samplers];
+		// Only the sampler states that can be modified through the API are saved ('D3DSAMP_ADDRESSU' to 'D3DSAMP_SRGBTEXTURE')
+		DWORD _sampler_states[state_usage::num_samplers][D3DSAMP_SRGBTEXTURE];
+		DWORD _fvf = 0;
+		com_ptr<IDirect3DVertexDeclaration9> _vertex_declaration;
+		com_ptr<IDirect3DVertexShader9> _vs;
+		com_ptr<IDirect3DPixelShader9> _ps;
+		com_ptr<IDirect3DIndexBuffer9> _indices;
+		com_ptr<IDirect3DVertexBuffer9> _stream_sources[state_usage::num_stream_sources];
+		UINT _stream_offsets[state_usage::num_stream_sources];
+		UINT _stream_strides[state_usage::num_stream_sources];
+		float _vs_constants[state_usage::num_shader_constants][4];
+		float _ps_constants[state_usage::num_shader_constants][4];
 	};
 }
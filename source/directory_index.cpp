@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "directory_index.hpp"
+#include "file_watcher.hpp"
+#include <algorithm>
+#include <cwctype>
+
+reshade::directory_index::directory_index()
+{
+}
+reshade::directory_index::~directory_index()
+{
+}
+
+void reshade::directory_index::set_roots(const std::vector<std::filesystem::path> &paths)
+{
+	const std::lock_guard<std::mutex> lock(_mutex);
+
+	if (paths == _roots)
+		return;
+
+	_roots = paths;
+	_root_keys.clear();
+	for (const std::filesystem::path &path : paths)
+		_root_keys.push_back(make_key(path));
+
+	_directories.clear();
+
+	// Removed files have to be reported too, since they invalidate the cached contents just as well
+	if (!_roots.empty())
+		_watcher = std::make_unique<file_watcher>(_roots, true);
+	else
+		_watcher.reset();
+}
+
+void reshade::directory_index::update()
+{
+	const std::lock_guard<std::mutex> lock(_mutex);
+
+	if (_watcher == nullptr)
+		return;
+
+	std::vector<std::filesystem::path> modified_files;
+	if (!_watcher->check(modified_files))
+		return;
+
+	for (const std::filesystem::path &modified_file : modified_files)
+	{
+		// Discard the directory containing the modified file, along with all cached subdirectories of it (in case a directory was renamed or removed)
+		// If the watcher overflowed, this is the parent of the root directory, so everything below the root is discarded
+		const std::wstring parent_key = make_key(modified_file.parent_path());
+
+		for (auto it = _directories.begin(); it != _directories.end();)
+		{
+			if (it->first.compare(0, parent_key.size(), parent_key) == 0)
+				it = _directories.erase(it);
+			else
+				++it;
+		}
+	}
+}
+
+bool reshade::directory_index::exists(const std::filesystem::path &path)
+{
+	const std::filesystem::path normal_path = path.lexically_normal();
+	const std::filesystem::path parent_path = normal_path.parent_path();
+
+	const std::lock_guard<std::mutex> lock(_mutex);
+
+	const std::wstring parent_key = make_key(parent_path);
+	if (!normal_path.has_filename() || !is_below_root(parent_key))
+	{
+		std::error_code ec;
+		return std::filesystem::exists(path, ec);
+	}
+
+	const std::vector<entry> &entries = find_directory(parent_path, parent_key);
+
+	const std::wstring key = make_key(normal_path.filename());
+	const auto it = std::lower_bound(entries.begin(), entries.end(), key,
+		[](const entry &lhs, const std::wstring &rhs) { return lhs.key < rhs; });
+	return it != entries.end() && it->key == key;
+}
+
+std::vector<std::filesystem::path> reshade::directory_index::list_files(const std::filesystem::path &path)
+{
+	const std::filesystem::path normal_path = path.lexically_normal();
+
+	const std::lock_guard<std::mutex> lock(_mutex);
+
+	std::vector<std::filesystem::path> files;
+
+	const std::wstring key = make_key(normal_path);
+	if (!is_below_root(key))
+	{
+		std::error_code ec;
+		for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(normal_path, std::filesystem::directory_options::skip_permission_denied, ec))
+			if (!entry.is_directory(ec))
+				files.emplace_back(entry); // Construct path from directory entry in-place
+		return files;
+	}
+
+	for (const entry &entry : find_directory(normal_path, key))
+		if (!entry.is_directory)
+			files.push_back(entry.path);
+
+	return files;
+}
+
+std::wstring reshade::directory_index::make_key(const std::filesystem::path &path)
+{
+	std::wstring key = path.lexically_normal().make_preferred().wstring();
+	// Remove trailing separator, so that "C:\a\" and "C:\a" refer to the same directory
+	if (key.size() > 1 && key.back() == std::filesystem::path::preferred_separator)
+		key.pop_back();
+	std::transform(key.begin(), key.end(), key.begin(), [](wchar_t c) { return static_cast<wchar_t>(std::towlower(c)); });
+	return key;
+}
+
+bool reshade::directory_index::is_below_root(const std::wstring &key) const
+{
+	return std::any_of(_root_keys.begin(), _root_keys.end(),
+		[&key](const std::wstring &root_key) {
+			return key.compare(0, root_key.size(), root_key) == 0 &&
+				(key.size() == root_key.size() || key[root_key.size()] == std::filesystem::path::preferred_separator);
+		});
+}
+
+const std::vector<reshade::directory_index::entry> &reshade::directory_index::find_directory(const std::filesystem::path &path, const std::wstring &key)
+{
+	if (const auto it = _directories.find(key); it != _directories.end())
+		return it->second;
+
+	std::vector<entry> &entries = _directories[key];
+
+	// A directory that does not exist is cached as empty, so that repeated lookups in it do not go to the file system either
+	std::error_code ec;
+	for (const std::filesystem::directory_entry &directory_entry : std::filesystem::directory_iterator(path, std::filesystem::directory_options::skip_permission_denied, ec))
+		entries.push_back({ directory_entry.path(), make_key(directory_entry.path().filename()), directory_entry.is_directory(ec) });
+
+	std::sort(entries.begin(), entries.end(),
+		[](const entry &lhs, const entry &rhs) { return lhs.key < rhs.key; });
+
+	return entries;
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <unordered_map>
+
+namespace reshade
+{
+	class file_watcher; // Forward declarations to avoid excessive #include
+
+	/// <summary>
+	/// Caches the contents of directories below a set of root directories in memory, so that repeatedly looking up files there does not have to go to the file system (which can be slow on network shares).
+	/// The root directories are watched for changes, and the contents of directories that changed are read again the next time they are accessed.
+	/// </summary>
+	class directory_index
+	{
+	public:
+		directory_index();
+		~directory_index();
+
+		/// <summary>
+		/// Sets the absolute paths of the root directories whose contents (including those of their subdirectories) are cached.
+		/// Paths outside of these are always looked up in the file system. Changing the list discards all cached contents.
+		/// </summary>
+		void set_roots(const std::vector<std::filesystem::path> &paths);
+
+		/// <summary>
+		/// Discards the cached contents of all directories that changed since the last call.
+		/// </summary>
+		void update();
+
+		/// <summary>
+		/// Checks whether a file or directory exists at the specified absolute <paramref name="path"/>.
+		/// </summary>
+		bool exists(const std::filesystem::path &path);
+
+		/// <summary>
+		/// Gets the paths of all files (but not directories) in the directory at the specified absolute <paramref name="path"/>.
+		/// </summary>
+		std::vector<std::filesystem::path> list_files(const std::filesystem::path &path);
+
+	private:
+		struct entry
+		{
+			std::filesystem::path path;
+			// Lower case file name, since the file system is case-insensitive
+			std::wstring key;
+			bool is_directory;
+		};
+
+		static std::wstring make_key(const std::filesystem::path &path);
+		bool is_below_root(const std::wstring &key) const;
+		const std::vector<entry> &find_directory(const std::filesystem::path &path, const std::wstring &key);
+
+		std::mutex _mutex;
+		std::vector<std::filesystem::path> _roots;
+		std::vector<std::wstring> _root_keys;
+		std::unique_ptr<file_watcher> _watcher;
+		// Entries of every cached directory sorted by key, indexed by the key of the directory path
+		std::unordered_map<std::wstring, std::vector<entry>> _directories;
+	};
+}
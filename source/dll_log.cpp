@@ -5,6 +5,11 @@
 
 #include "dll_log.hpp"
 #include <mutex>
+#include <atomic>
+#include <thread>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
 #include <Windows.h>
 
 struct scoped_file_handle
@@ -22,74 +27,256 @@ private:
 	HANDLE handle = INVALID_HANDLE_VALUE;
 };
 
-static std::mutex s_message_mutex;
+// Messages are passed to a writer thread through a ring of fixed-size slots, with longer messages spanning multiple consecutive slots
+// Every slot has a sequence number that tells whether it is free to be written at a position (see 'free_sequence') or contains the data for it (see 'ready_sequence')
+struct log_slot
+{
+	static constexpr size_t data_size = 240;
+
+	std::atomic<uint64_t> sequence;
+	uint32_t size;
+	char data[data_size];
+};
+
+static constexpr uint64_t s_num_slots = 4096;
+// Longer messages are truncated, so that a single message can never occupy the whole ring
+static constexpr uint64_t s_max_slots_per_message = 64;
+
+static log_slot s_slots[s_num_slots];
+static std::atomic<uint64_t> s_write_pos = 0;
+static uint64_t s_read_pos = 0; // Only accessed while holding 's_consumer_mutex'
+static std::string s_write_buffer;
+static std::timed_mutex s_consumer_mutex;
+static std::atomic<bool> s_writer_waiting = false;
+static HANDLE s_writer_event = nullptr;
+static HANDLE s_writer_stopped_event = nullptr;
+static std::atomic<bool> s_writer_started = false;
+static std::atomic<bool> s_writer_stop = false;
 static scoped_file_handle s_file_handle;
-std::ostringstream reshade::log::line_stream;
+thread_local std::ostringstream reshade::log::line_stream;
+
+// Sequence numbers count the passes through the ring, so that zero-initialized slots are free for the first pass (which allows logging from static initializers of other translation units)
+static constexpr uint64_t free_sequence(uint64_t pos) { return (pos / s_num_slots) * 2; }
+static constexpr uint64_t ready_sequence(uint64_t pos) { return (pos / s_num_slots) * 2 + 1; }
+
+static inline bool is_message_pending()
+{
+	return s_slots[s_read_pos % s_num_slots].sequence.load(std::memory_order_seq_cst) == ready_sequence(s_read_pos);
+}
+
+// Writes all messages in the ring that were completely published so far to the log file, which requires holding 's_consumer_mutex'
+static void write_pending_messages()
+{
+	s_write_buffer.clear();
+
+	while (is_message_pending())
+	{
+		log_slot &slot = s_slots[s_read_pos % s_num_slots];
+
+		// Replace all LF with CRLF
+		for (uint32_t i = 0; i < slot.size; ++i)
+		{
+			if (slot.data[i] == '\n')
+				s_write_buffer += '\r';
+			s_write_buffer += slot.data[i];
+		}
+
+		// Free slot for the position it will be used at the next time around the ring
+		slot.sequence.store(free_sequence(s_read_pos + s_num_slots), std::memory_order_release);
+		s_read_pos++;
+	}
+
+	if (s_write_buffer.empty())
+		return;
+
+	// Write lines to the log file
+	if (s_file_handle != INVALID_HANDLE_VALUE)
+	{
+		DWORD written = 0;
+		WriteFile(s_file_handle, s_write_buffer.data(), static_cast<DWORD>(s_write_buffer.size()), &written, nullptr);
+		assert(written == s_write_buffer.size());
+	}
+
+#ifndef NDEBUG
+	// Write lines to the debug output
+	OutputDebugStringA(s_write_buffer.c_str());
+#endif
+}
+
+static void writer_thread_main()
+{
+	while (!s_writer_stop.load(std::memory_order_acquire))
+	{
+		{
+			const std::unique_lock<std::timed_mutex> lock(s_consumer_mutex);
+			write_pending_messages();
+
+			// Announce that the writer is going to sleep before checking for new messages one last time, so that a message published in between cannot be missed
+			s_writer_waiting.store(true, std::memory_order_seq_cst);
+			if (is_message_pending())
+			{
+				s_writer_waiting.store(false, std::memory_order_relaxed);
+				continue;
+			}
+		}
+
+		// Use a timeout, so that messages are still written in a timely manner should a wake up get lost
+		WaitForSingleObject(s_writer_event, 100);
+		s_writer_waiting.store(false, std::memory_order_relaxed);
+	}
+
+	{
+		const std::unique_lock<std::timed_mutex> lock(s_consumer_mutex);
+		write_pending_messages();
+	}
+
+	// This has to be the last thing this thread does before it returns out of the module (see 'stop_writer_thread')
+	SetEvent(s_writer_stopped_event);
+}
+
+static void publish_message(const char *data, size_t size)
+{
+	size = std::min<size_t>(size, s_max_slots_per_message * log_slot::data_size);
+
+	// Reserve consecutive slots for the entire message, so that messages from multiple threads do not interleave
+	const uint64_t num_slots = std::max<uint64_t>(1, (size + log_slot::data_size - 1) / log_slot::data_size);
+	const uint64_t pos = s_write_pos.fetch_add(num_slots, std::memory_order_relaxed);
+
+	for (uint64_t i = 0; i < num_slots; ++i)
+	{
+		log_slot &slot = s_slots[(pos + i) % s_num_slots];
+
+		// Only have to wait here if the ring is full
+		while (slot.sequence.load(std::memory_order_acquire) != free_sequence(pos + i))
+		{
+			if (!s_writer_started)
+			{
+				// Write messages on this thread if there is no writer thread yet to free up slots
+				if (s_consumer_mutex.try_lock())
+					write_pending_messages(),
+					s_consumer_mutex.unlock();
+			}
+			else if (s_writer_waiting.load(std::memory_order_seq_cst))
+			{
+				SetEvent(s_writer_event);
+			}
+
+			std::this_thread::yield();
+		}
+
+		slot.size = static_cast<uint32_t>(std::min<size_t>(size - i * log_slot::data_size, log_slot::data_size));
+		std::memcpy(slot.data, data + i * log_slot::data_size, slot.size);
+		slot.sequence.store(ready_sequence(pos + i), std::memory_order_seq_cst);
+	}
+
+	if (s_writer_waiting.load(std::memory_order_seq_cst))
+		SetEvent(s_writer_event);
+}
+
+static inline char *format_digits(char *p, unsigned int value, int width)
+{
+	for (int i = width - 1; i >= 0; --i, value /= 10)
+		p[i] = '0' + static_cast<char>(value % 10);
+	return p + width;
+}
 
 reshade::log::message::message(level level)
 {
+	// Cache the formatted time stamp of the current second and the thread identifier for each thread, so that most messages only need to format the milliseconds
+	static thread_local char prefix[32] = {};
+	static thread_local size_t prefix_time_length = 0;
+	static thread_local SYSTEMTIME prefix_time = {};
+	static thread_local char thread_id[16] = {};
+
 	SYSTEMTIME time;
 	GetLocalTime(&time);
 
+	if (prefix_time_length == 0 || time.wSecond != prefix_time.wSecond || time.wMinute != prefix_time.wMinute || time.wHour != prefix_time.wHour || time.wDay != prefix_time.wDay)
+	{
+		prefix_time = time;
+
+		char *p = prefix;
+#if RESHADE_VERBOSE_LOG
+		p = format_digits(p, time.wYear, 4); *p++ = '-';
+		p = format_digits(p, time.wMonth, 2); *p++ = '-';
+		p = format_digits(p, time.wDay, 2); *p++ = 'T';
+#endif
+		p = format_digits(p, time.wHour, 2); *p++ = ':';
+		p = format_digits(p, time.wMinute, 2); *p++ = ':';
+		p = format_digits(p, time.wSecond, 2); *p++ = ':';
+		prefix_time_length = p - prefix;
+
+		if (thread_id[0] == '\0')
+		{
+			const DWORD id = GetCurrentThreadId();
+			std::snprintf(thread_id, sizeof(thread_id), " [%05lu] | ", id);
+		}
+	}
+
+	format_digits(prefix + prefix_time_length, time.wMilliseconds, 3);
+
 	const char level_names[][6] = { "ERROR", "WARN ", "INFO ", "DEBUG" };
 	assert((static_cast<size_t>(level) - 1) < ARRAYSIZE(level_names));
 
-	// Lock the stream until the message is complete
-	s_message_mutex.lock();
-
 	// Start a new line
 	line_stream.str(std::string());
 	line_stream.clear();
+	line_stream.flags(std::ios::dec | std::ios::left | std::ios::showbase);
+	line_stream.fill(' ');
 
-	line_stream << std::right << std::setfill('0')
-#if RESHADE_VERBOSE_LOG
-		<< std::setw(4) << time.wYear << '-'
-		<< std::setw(2) << time.wMonth << '-'
-		<< std::setw(2) << time.wDay << 'T'
-#endif
-		<< std::setw(2) << time.wHour << ':'
-		<< std::setw(2) << time.wMinute << ':'
-		<< std::setw(2) << time.wSecond << ':'
-		<< std::setw(3) << time.wMilliseconds << ' '
-		<< '[' << std::setw(5) << GetCurrentThreadId() << ']' << std::setfill(' ') << " | "
-		<< level_names[static_cast<unsigned int>(level) - 1] << " | " << std::left;
+	line_stream.write(prefix, prefix_time_length + 3);
+	line_stream << thread_id << level_names[static_cast<unsigned int>(level) - 1] << " | ";
 }
 reshade::log::message::~message()
 {
-	std::string line_string = line_stream.str();
-	line_string += '\n'; // Terminate line with line feed
+	line_stream << '\n'; // Terminate line with line feed
 
-	// Replace all LF with CRLF
-	for (size_t offset = 0; (offset = line_string.find('\n', offset)) != std::string::npos; offset += 2)
-		line_string.replace(offset, 1, "\r\n", 2);
-
-	// Write line to the log file
-	if (s_file_handle != INVALID_HANDLE_VALUE)
-	{
-		DWORD written = 0;
-		WriteFile(s_file_handle, line_string.data(), static_cast<DWORD>(line_string.size()), &written, nullptr);
-		assert(written == line_string.size());
-	}
-
-#ifndef NDEBUG
-	// Write line to the debug output
-	OutputDebugStringA(line_string.c_str());
-#endif
-
-	// The message is finished, we can unlock the stream
-	s_message_mutex.unlock();
+	const std::string line_string = line_stream.str();
+	publish_message(line_string.data(), line_string.size());
 }
 
 void reshade::log::open_log_file(const std::filesystem::path &path)
 {
+	const std::unique_lock<std::timed_mutex> lock(s_consumer_mutex);
+
+	// Write any messages that were logged so far to the previous file
+	write_pending_messages();
+
 	// Close the previous file first
 	if (s_file_handle != INVALID_HANDLE_VALUE)
 		CloseHandle(s_file_handle);
 
-	// Set default line stream settings
-	line_stream.setf(std::ios::left);
-	line_stream.setf(std::ios::showbase);
-
 	// Open the log file for writing (and flush on each write) and clear previous contents
 	s_file_handle = CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_WRITE_THROUGH, NULL);
+
+	if (!s_writer_started)
+	{
+		// The writer thread cannot be joined from within 'DllMain', so it is detached and told to stop instead (see 'stop_writer_thread')
+		s_writer_event = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+		s_writer_stopped_event = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+		std::thread(writer_thread_main).detach();
+		s_writer_started = true;
+	}
+}
+void reshade::log::stop_writer_thread()
+{
+	if (!s_writer_started.exchange(false))
+		return;
+
+	s_writer_stop.store(true, std::memory_order_release);
+	SetEvent(s_writer_event);
+
+	// Only wait for the writer thread to leave its loop, since it cannot finish exiting while the loader lock is held by 'DllMain'
+	// Once it has signaled the event it only returns out of the module, which the caller has to give it time for before the module is unmapped
+	WaitForSingleObject(s_writer_stopped_event, 1000);
+}
+
+void reshade::log::flush()
+{
+	// The writer thread might have been terminated while holding the lock when the process is exiting, so do not wait on it forever
+	const std::unique_lock<std::timed_mutex> lock(s_consumer_mutex, std::chrono::milliseconds(100));
+
+	// Writing without the lock would race with a writer thread that is still alive
+	if (lock.owns_lock())
+		write_pending_messages();
 }
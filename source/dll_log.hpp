@@ -40,12 +40,25 @@ namespace reshade::log
 	void open_log_file(const std::filesystem::path &path);
 
 	/// <summary>
-	/// The current log line stream.
+	/// Blocks until all messages logged so far were written to the log file.
+	/// Messages are otherwise written asynchronously by a background thread, so this should be called before the process may terminate (e.g. during shutdown or on a crash).
 	/// </summary>
-	extern std::ostringstream line_stream;
+	void flush();
 
 	/// <summary>
-	/// Constructs a single log message including current time and level and writes it to the open log file.
+	/// Stops the background thread that writes messages to the log file, so that it no longer runs code of this module once it is unloaded.
+	/// Messages logged after this are only written on the next call to <see cref="flush"/>.
+	/// </summary>
+	void stop_writer_thread();
+
+	/// <summary>
+	/// The current log line stream of the calling thread.
+	/// </summary>
+	extern thread_local std::ostringstream line_stream;
+
+	/// <summary>
+	/// Constructs a single log message including current time and level and queues it for writing to the open log file.
+	/// This does not block on file I/O, since the message is passed to a background thread through a lock-free ring buffer.
 	/// </summary>
 	struct message
 	{
@@ -828,7 +828,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow
 static PVOID g_exception_handler_handle = nullptr;
 #  endif
 
-BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
+BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID lpReserved)
 {
 	switch (fdwReason)
 	{
@@ -858,6 +858,9 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
 				code == 0xE06D7363 /* Visual C++ exception */)
 				goto continue_search;
 
+			// Make sure the log is complete in case the process crashes
+			reshade::log::flush();
+
 			// Create dump with exception information for the first 100 occurrences
 			if (static unsigned int dump_index = 0;
 				++dump_index < 100)
@@ -912,34 +915,37 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
 			}
 		}
 
-		reshade::hooks::register_module(L"user32.dll");
-		reshade::hooks::register_module(L"ws2_32.dll");
+		reshade::hooks::register_module(L"user32.dll", true);
+		reshade::hooks::register_module(L"ws2_32.dll", true);
 
-		reshade::hooks::register_module(get_system_path() / L"d2d1.dll");
-		reshade::hooks::register_module(get_system_path() / L"d3d9.dll");
-		reshade::hooks::register_module(get_system_path() / L"d3d10.dll");
-		reshade::hooks::register_module(get_system_path() / L"d3d10_1.dll");
-		reshade::hooks::register_module(get_system_path() / L"d3d11.dll");
+		reshade::hooks::register_module(get_system_path() / L"d2d1.dll", true);
+		reshade::hooks::register_module(get_system_path() / L"d3d9.dll", true);
+		reshade::hooks::register_module(get_system_path() / L"d3d10.dll", true);
+		reshade::hooks::register_module(get_system_path() / L"d3d10_1.dll", true);
+		reshade::hooks::register_module(get_system_path() / L"d3d11.dll", true);
 
 		// On Windows 7 the d3d12on7 module is not in the system path, so register to hook any d3d12.dll loaded instead
 		if (is_windows7() && _wcsicmp(g_reshade_dll_path.stem().c_str(), L"d3d12") != 0)
-			reshade::hooks::register_module(L"d3d12.dll");
+			reshade::hooks::register_module(L"d3d12.dll", true);
 		else
-			reshade::hooks::register_module(get_system_path() / L"d3d12.dll");
+			reshade::hooks::register_module(get_system_path() / L"d3d12.dll", true);
 
-		reshade::hooks::register_module(get_system_path() / L"dxgi.dll");
-		reshade::hooks::register_module(get_system_path() / L"opengl32.dll");
+		reshade::hooks::register_module(get_system_path() / L"dxgi.dll", true);
+		reshade::hooks::register_module(get_system_path() / L"opengl32.dll", true);
 		// Do not register Vulkan hooks, since Vulkan layering mechanism is used instead
 
 #  ifdef WIN64
-		reshade::hooks::register_module(L"vrclient_x64.dll");
+		reshade::hooks::register_module(L"vrclient_x64.dll", true);
 #  else
-		reshade::hooks::register_module(L"vrclient.dll");
+		reshade::hooks::register_module(L"vrclient.dll", true);
 #  endif
 
 		// Register DirectInput module in case it was used to load ReShade (but ignore otherwise)
 		if (_wcsicmp(g_reshade_dll_path.stem().c_str(), L"dinput8") == 0)
-			reshade::hooks::register_module(get_system_path() / L"dinput8.dll");
+			reshade::hooks::register_module(get_system_path() / L"dinput8.dll", true);
+
+		// Enable hooks of all modules that are already loaded in a single batch, rather than suspending all threads once per module
+		reshade::hook::apply_queued_actions();
 
 		// user32.dll will always be loaded at this point, so can safely initialize trampoline pointers
 		extern void init_message_queue_trampolines();
@@ -952,6 +958,15 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
 
 		reshade::hooks::uninstall();
 
+		// Stop the log writer thread while there is still time for it to return out of the module (see the wait below)
+		// All other threads were already terminated if the process is exiting, so no need to stop it then
+		if (lpReserved == nullptr)
+		{
+			// Configuration files saved after this (like from 'ini_file' destructors) are written synchronously
+			reshade::ini_file::stop_writer_thread();
+			reshade::log::stop_writer_thread();
+		}
+
 		// Module is now invalid, so break out of any message loops that may still have it in the call stack (see 'HookGetMessage' implementation in input.cpp)
 		// This is necessary since a different thread may have called into the 'GetMessage' hook from ReShade, but not receive a message until after the module was unloaded
 		// At that point it would return to code that was already unloaded and crash
@@ -966,6 +981,9 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
 #  endif
 
 		LOG(INFO) << "Finished exiting.";
+
+		// The log writer thread may already have been terminated at this point, so write remaining messages on this thread
+		reshade::log::flush();
 		break;
 	}
 
@@ -63,6 +63,37 @@ static void dump_sample_desc(const DXGI_SAMPLE_DESC &desc)
 	}
 }
 
+static void modify_swap_effect(DXGI_SWAP_EFFECT &swap_effect, UINT &buffer_count, UINT &flags, DXGI_FORMAT format, const DXGI_SAMPLE_DESC &sample_desc, BOOL windowed)
+{
+	if (reshade::global_config().get("APP", "ForceFlipModel") &&
+		(swap_effect == DXGI_SWAP_EFFECT_DISCARD || swap_effect == DXGI_SWAP_EFFECT_SEQUENTIAL))
+	{
+		// Flip model swap chains cannot be multisampled and only support a few back buffer formats (no sRGB formats either)
+		if (!is_windows7() && sample_desc.Count == 1 &&
+			(format == DXGI_FORMAT_R8G8B8A8_UNORM || format == DXGI_FORMAT_B8G8R8A8_UNORM || format == DXGI_FORMAT_R10G10B10A2_UNORM || format == DXGI_FORMAT_R16G16B16A16_FLOAT))
+		{
+			LOG(INFO) << "> Replacing blt model swap effect " << swap_effect << " with flip model.";
+
+			swap_effect = (swap_effect == DXGI_SWAP_EFFECT_DISCARD) ? DXGI_SWAP_EFFECT_FLIP_DISCARD : DXGI_SWAP_EFFECT_FLIP_SEQUENTIAL;
+			// Flip model requires at least two buffers
+			if (buffer_count < 2)
+				buffer_count = 2;
+		}
+		else
+		{
+			LOG(WARN) << "> Skipping flip model upgrade because the swap chain uses multisampling or a format that is not supported with flip model.";
+		}
+	}
+
+	// The frame latency waitable object is only supported with flip model swap chains in windowed mode
+	if (unsigned int max_frame_latency = 0;
+		reshade::global_config().get("APP", "MaxFrameLatency", max_frame_latency) && max_frame_latency != 0 && windowed &&
+		(swap_effect == DXGI_SWAP_EFFECT_FLIP_SEQUENTIAL || swap_effect == DXGI_SWAP_EFFECT_FLIP_DISCARD))
+	{
+		flags |= DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+	}
+}
+
 static void dump_and_modify_swapchain_desc(DXGI_SWAP_CHAIN_DESC &desc)
 {
 	LOG(INFO) << "> Dumping swap chain description:";
@@ -143,6 +174,7 @@ static void dump_and_modify_swapchain_desc(DXGI_SWAP_CHAIN_DESC &desc)
 	{
 		desc.BufferDesc.Format = DXGI_FORMAT_R10G10B10A2_UNORM;
 	}
+	modify_swap_effect(desc.SwapEffect, desc.BufferCount, desc.Flags, desc.BufferDesc.Format, desc.SampleDesc, desc.Windowed);
 }
 static void dump_and_modify_swapchain_desc(DXGI_SWAP_CHAIN_DESC1 &desc, DXGI_SWAP_CHAIN_FULLSCREEN_DESC &fullscreen_desc)
 {
@@ -226,6 +258,7 @@ static void dump_and_modify_swapchain_desc(DXGI_SWAP_CHAIN_DESC1 &desc, DXGI_SWA
 	{
 		desc.Format = DXGI_FORMAT_R10G10B10A2_UNORM;
 	}
+	modify_swap_effect(desc.SwapEffect, desc.BufferCount, desc.Flags, desc.Format, desc.SampleDesc, fullscreen_desc.Windowed);
 }
 
 UINT query_device(IUnknown *&device, com_ptr<IUnknown> &device_proxy)
@@ -254,7 +287,7 @@ UINT query_device(IUnknown *&device, com_ptr<IUnknown> &device_proxy)
 }
 
 template <typename T>
-static void init_swapchain_proxy(T *&swapchain, UINT direct3d_version, const com_ptr<IUnknown> &device_proxy, DXGI_USAGE usage)
+static void init_swapchain_proxy(T *&swapchain, UINT direct3d_version, const com_ptr<IUnknown> &device_proxy, DXGI_USAGE usage, bool flip_model_upgraded, UINT added_flags)
 {
 	DXGISwapChain *swapchain_proxy = nullptr;
 
@@ -298,6 +331,21 @@ static void init_swapchain_proxy(T *&swapchain, UINT direct3d_version, const com
 		reshade::global_config().get("APP", "ForceResolution", swapchain_proxy->_force_resolution);
 		reshade::global_config().get("APP", "Force10BitFormat", swapchain_proxy->_force_10_bit_format);
 
+		swapchain_proxy->_flip_model_upgraded = flip_model_upgraded;
+		swapchain_proxy->_added_swapchain_flags = added_flags;
+
+		if ((added_flags & DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT) != 0)
+		{
+			if (com_ptr<IDXGISwapChain2> swapchain2; SUCCEEDED(swapchain->QueryInterface(&swapchain2)))
+			{
+				unsigned int max_frame_latency = 1;
+				reshade::global_config().get("APP", "MaxFrameLatency", max_frame_latency);
+
+				swapchain2->SetMaximumFrameLatency(max_frame_latency);
+				swapchain_proxy->_frame_latency_waitable_object = swapchain2->GetFrameLatencyWaitableObject();
+			}
+		}
+
 #if RESHADE_VERBOSE_LOG
 		LOG(INFO) << "Returning IDXGISwapChain" << swapchain_proxy->_interface_version << " object " << swapchain_proxy << '.';
 #endif
@@ -332,7 +380,7 @@ HRESULT STDMETHODCALLTYPE IDXGIFactory_CreateSwapChain(IDXGIFactory *pFactory, I
 		return hr;
 	}
 
-	init_swapchain_proxy(*ppSwapChain, direct3d_version, device_proxy, desc.BufferUsage);
+	init_swapchain_proxy(*ppSwapChain, direct3d_version, device_proxy, desc.BufferUsage, desc.SwapEffect != pDesc->SwapEffect, desc.Flags & ~pDesc->Flags);
 
 	return hr;
 }
@@ -372,7 +420,7 @@ HRESULT STDMETHODCALLTYPE IDXGIFactory2_CreateSwapChainForHwnd(IDXGIFactory2 *pF
 		return hr;
 	}
 
-	init_swapchain_proxy(*ppSwapChain, direct3d_version, device_proxy, desc.BufferUsage);
+	init_swapchain_proxy(*ppSwapChain, direct3d_version, device_proxy, desc.BufferUsage, desc.SwapEffect != pDesc->SwapEffect, desc.Flags & ~pDesc->Flags);
 
 	return hr;
 }
@@ -391,7 +439,8 @@ HRESULT STDMETHODCALLTYPE IDXGIFactory2_CreateSwapChainForCoreWindow(IDXGIFactor
 		return DXGI_ERROR_INVALID_CALL;
 
 	DXGI_SWAP_CHAIN_DESC1 desc = *pDesc;
-	DXGI_SWAP_CHAIN_FULLSCREEN_DESC fullscreen_desc; // UWP applications cannot be set into fullscreen mode
+	DXGI_SWAP_CHAIN_FULLSCREEN_DESC fullscreen_desc = {}; // UWP applications cannot be set into fullscreen mode
+	fullscreen_desc.Windowed = TRUE;
 	dump_and_modify_swapchain_desc(desc, fullscreen_desc);
 
 	com_ptr<IUnknown> device_proxy;
@@ -406,7 +455,7 @@ HRESULT STDMETHODCALLTYPE IDXGIFactory2_CreateSwapChainForCoreWindow(IDXGIFactor
 		return hr;
 	}
 
-	init_swapchain_proxy(*ppSwapChain, direct3d_version, device_proxy, desc.BufferUsage);
+	init_swapchain_proxy(*ppSwapChain, direct3d_version, device_proxy, desc.BufferUsage, desc.SwapEffect != pDesc->SwapEffect, desc.Flags & ~pDesc->Flags);
 
 	return hr;
 }
@@ -424,7 +473,8 @@ HRESULT STDMETHODCALLTYPE IDXGIFactory2_CreateSwapChainForComposition(IDXGIFacto
 		return DXGI_ERROR_INVALID_CALL;
 
 	DXGI_SWAP_CHAIN_DESC1 desc = *pDesc;
-	DXGI_SWAP_CHAIN_FULLSCREEN_DESC fullscreen_desc; // Composition swap chains cannot be set into fullscreen mode
+	DXGI_SWAP_CHAIN_FULLSCREEN_DESC fullscreen_desc = {}; // Composition swap chains cannot be set into fullscreen mode
+	fullscreen_desc.Windowed = TRUE;
 	dump_and_modify_swapchain_desc(desc, fullscreen_desc);
 
 	com_ptr<IUnknown> device_proxy;
@@ -439,7 +489,7 @@ HRESULT STDMETHODCALLTYPE IDXGIFactory2_CreateSwapChainForComposition(IDXGIFacto
 		return hr;
 	}
 
-	init_swapchain_proxy(*ppSwapChain, direct3d_version, device_proxy, desc.BufferUsage);
+	init_swapchain_proxy(*ppSwapChain, direct3d_version, device_proxy, desc.BufferUsage, desc.SwapEffect != pDesc->SwapEffect, desc.Flags & ~pDesc->Flags);
 
 	return hr;
 }
@@ -13,6 +13,7 @@
 #include "d3d12/d3d12_device.hpp"
 #include "d3d12/d3d12_command_queue.hpp"
 #include "d3d12/reshade_api_swapchain.hpp"
+#include "profiling.hpp"
 
 extern UINT query_device(IUnknown *&device, com_ptr<IUnknown> &device_proxy);
 
@@ -130,6 +131,8 @@ void DXGISwapChain::runtime_present(UINT flags)
 	if (flags & DXGI_PRESENT_TEST)
 		return;
 
+	RESHADE_PROFILE_SCOPE("IDXGISwapChain::Present");
+
 	// Synchronize access to effect runtime to avoid race conditions between 'load_effects' and 'unload_effects' causing crashes
 	// This is necessary because Resident Evil 3 calls DXGI functions simultaneously from multiple threads (which is technically illegal)
 	const std::lock_guard<std::mutex> lock(_impl_mutex);
@@ -154,8 +157,51 @@ void DXGISwapChain::runtime_present(UINT flags)
 #endif
 		static_cast<reshade::d3d12::swapchain_impl *>(_impl)->on_present();
 		static_cast<D3D12CommandQueue *>(_direct3d_command_queue)->flush_immediate_command_list();
+		static_cast<D3D12CommandQueue *>(_direct3d_command_queue)->_device->advance_transient_descriptor_heaps(static_cast<D3D12CommandQueue *>(_direct3d_command_queue)->_orig);
 		break;
 	}
+
+	// Flip model unbinds the back buffer from the pipeline during present, which applications that asked for a blt model swap chain do not expect, so save the bound render targets to bind them again afterwards
+	if (_flip_model_upgraded)
+	{
+		switch (_direct3d_version)
+		{
+		case 10:
+			static_cast<D3D10Device *>(_direct3d_device)->_orig->OMGetRenderTargets(D3D10_SIMULTANEOUS_RENDER_TARGET_COUNT, reinterpret_cast<ID3D10RenderTargetView **>(_saved_render_targets), reinterpret_cast<ID3D10DepthStencilView **>(&_saved_depth_stencil));
+			break;
+		case 11:
+			static_cast<D3D11Device *>(_direct3d_device)->_immediate_context->_orig->OMGetRenderTargets(D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT, reinterpret_cast<ID3D11RenderTargetView **>(_saved_render_targets), reinterpret_cast<ID3D11DepthStencilView **>(&_saved_depth_stencil));
+			break;
+		}
+	}
+}
+void DXGISwapChain::runtime_after_present(UINT flags, HRESULT hr)
+{
+	if (flags & DXGI_PRESENT_TEST)
+		return;
+
+	if (_flip_model_upgraded)
+	{
+		switch (_direct3d_version)
+		{
+		case 10:
+			static_cast<D3D10Device *>(_direct3d_device)->_orig->OMSetRenderTargets(D3D10_SIMULTANEOUS_RENDER_TARGET_COUNT, reinterpret_cast<ID3D10RenderTargetView *const *>(_saved_render_targets), static_cast<ID3D10DepthStencilView *>(_saved_depth_stencil));
+			break;
+		case 11:
+			static_cast<D3D11Device *>(_direct3d_device)->_immediate_context->_orig->OMSetRenderTargets(D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT, reinterpret_cast<ID3D11RenderTargetView *const *>(_saved_render_targets), static_cast<ID3D11DepthStencilView *>(_saved_depth_stencil));
+			break;
+		}
+
+		for (IUnknown *&render_target : _saved_render_targets)
+			if (render_target != nullptr)
+				render_target->Release(), render_target = nullptr;
+		if (_saved_depth_stencil != nullptr)
+			_saved_depth_stencil->Release(), _saved_depth_stencil = nullptr;
+	}
+
+	// Block until the next frame can be started, so that the application cannot queue up more frames than the configured maximum frame latency
+	if (_frame_latency_waitable_object != nullptr && SUCCEEDED(hr))
+		WaitForSingleObjectEx(_frame_latency_waitable_object, 1000, TRUE);
 }
 
 void DXGISwapChain::handle_device_loss(HRESULT hr)
@@ -270,6 +316,9 @@ ULONG   STDMETHODCALLTYPE DXGISwapChain::Release()
 		break;
 	}
 
+	if (_frame_latency_waitable_object != nullptr)
+		CloseHandle(_frame_latency_waitable_object);
+
 	const auto orig = _orig;
 	const auto device = _direct3d_device;
 	const auto command_queue = _direct3d_command_queue;
@@ -323,6 +372,7 @@ HRESULT STDMETHODCALLTYPE DXGISwapChain::Present(UINT SyncInterval, UINT Flags)
 	g_in_dxgi_runtime = true;
 	const HRESULT hr = _orig->Present(SyncInterval, Flags);
 	g_in_dxgi_runtime = false;
+	runtime_after_present(Flags, hr);
 	handle_device_loss(hr);
 	return hr;
 }
@@ -370,7 +420,12 @@ HRESULT STDMETHODCALLTYPE DXGISwapChain::ResizeBuffers(UINT BufferCount, UINT Wi
 		Height = _force_resolution[1];
 	if (_force_10_bit_format)
 		NewFormat = DXGI_FORMAT_R10G10B10A2_UNORM;
+	if (_flip_model_upgraded && BufferCount == 1)
+		BufferCount = 2;
+	SwapChainFlags |= _added_swapchain_flags;
 
+	// The device stays the same, so effects can be kept if the back buffer dimensions and format turn out to not change
+	_impl->keep_effects_on_next_reset();
 	runtime_reset(Width, Height);
 
 	g_in_dxgi_runtime = true;
@@ -444,6 +499,7 @@ HRESULT STDMETHODCALLTYPE DXGISwapChain::Present1(UINT SyncInterval, UINT Presen
 	g_in_dxgi_runtime = true;
 	const HRESULT hr = static_cast<IDXGISwapChain1 *>(_orig)->Present1(SyncInterval, PresentFlags, pPresentParameters);
 	g_in_dxgi_runtime = false;
+	runtime_after_present(PresentFlags, hr);
 	handle_device_loss(hr);
 	return hr;
 }
@@ -548,7 +604,10 @@ HRESULT STDMETHODCALLTYPE DXGISwapChain::ResizeBuffers1(UINT BufferCount, UINT W
 		Height = _force_resolution[1];
 	if (_force_10_bit_format)
 		Format = DXGI_FORMAT_R10G10B10A2_UNORM;
+	SwapChainFlags |= _added_swapchain_flags;
 
+	// The device stays the same, so effects can be kept if the back buffer dimensions and format turn out to not change
+	_impl->keep_effects_on_next_reset();
 	runtime_reset(Width, Height);
 
 	// Need to extract the original command queue object from the proxies passed in
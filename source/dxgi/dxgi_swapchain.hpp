@@ -85,6 +85,7 @@ struct DECLSPEC_UUID("1F445F9F-9887-4C4C-9055-4E3BADAFCCA8") DXGISwapChain final
 	void runtime_reset(UINT width, UINT height);
 	void runtime_resize();
 	void runtime_present(UINT flags);
+	void runtime_after_present(UINT flags, HRESULT hr);
 	void handle_device_loss(HRESULT hr);
 
 	bool check_and_upgrade_interface(REFIID riid);
@@ -100,4 +101,11 @@ struct DECLSPEC_UUID("1F445F9F-9887-4C4C-9055-4E3BADAFCCA8") DXGISwapChain final
 	bool _force_vsync = false;
 	bool _force_10_bit_format = false;
 	unsigned int _force_resolution[2] = { 0, 0 };
+	// Set when the blt model swap effect the application asked for was replaced with flip model (see 'ForceFlipModel' option)
+	bool _flip_model_upgraded = false;
+	// Flags that were added to the ones the application asked for, which have to be passed on every time the buffers are resized
+	UINT _added_swapchain_flags = 0;
+	HANDLE _frame_latency_waitable_object = nullptr;
+	IUnknown *_saved_render_targets[8] = {};
+	IUnknown *_saved_depth_stencil = nullptr;
 };
@@ -7,7 +7,10 @@
 
 #include "effect_module.hpp"
 #include <memory> // std::unique_ptr
-#include <algorithm> // std::find_if
+#include <cassert>
+#include <algorithm> // std::all_of, std::find, std::find_if
+#include <limits> // std::numeric_limits
+#include <unordered_map>
 
 namespace reshadefx
 {
@@ -27,6 +30,12 @@ namespace reshadefx
 		/// </summary>
 		/// <param name="module">The target module to fill.</param>
 		virtual void write_result(module &module) = 0;
+		/// <summary>
+		/// Write result of the code generation that is specific to a single entry point of a module previously filled by <see cref="write_result"/> (e.g. a SPIR-V module that only contains that entry point).
+		/// This does not modify the code generator, so it may be called for different entry points from multiple threads at the same time.
+		/// </summary>
+		/// <param name="entry_point">The entry point in the target module to fill.</param>
+		virtual void write_entry_point_result(entry_point &entry_point) const { (void)entry_point; }
 
 	public:
 		/// <summary>
@@ -170,7 +179,7 @@ namespace reshadefx
 		/// <param name="res_type">The data type of the call result.</param>
 		/// <param name="args">A list of SSA IDs representing the call arguments.</param>
 		/// <returns>New SSA ID with the result of the function call.</returns>
-		virtual id emit_call(const location &loc, id function, const type &res_type, const std::vector<expression> &args) = 0;
+		virtual id emit_call(const location &loc, id function, const type &res_type, const expression_list &args) = 0;
 		/// <summary>
 		/// Add an intrinsic function call to the output.
 		/// </summary>
@@ -179,14 +188,14 @@ namespace reshadefx
 		/// <param name="res_type">The data type of the call result.</param>
 		/// <param name="args">A list of SSA IDs representing the call arguments.</param>
 		/// <returns>New SSA ID with the result of the function call.</returns>
-		virtual id emit_call_intrinsic(const location &loc, id function, const type &res_type, const std::vector<expression> &args) = 0;
+		virtual id emit_call_intrinsic(const location &loc, id function, const type &res_type, const expression_list &args) = 0;
 		/// <summary>
 		/// Add a type constructor call to the output.
 		/// </summary>
 		/// <param name="type">The data type to construct.</param>
 		/// <param name="args">A list of SSA IDs representing the scalar constructor arguments.</param>
 		/// <returns>New SSA ID with the constructed value.</returns>
-		virtual id emit_construct(const location &loc, const type &type, const std::vector<expression> &args) = 0;
+		virtual id emit_construct(const location &loc, const type &type, const expression_list &args) = 0;
 
 		/// <summary>
 		/// Add a structured branch control flow to the output.
@@ -329,9 +338,187 @@ namespace reshadefx
 			return align_up(size, alignment) * (elements - 1) + size;
 		}
 
+		/// <summary>
+		/// Find an order of the uniform buffer members that reduces the padding between them, by repeatedly appending the member that can be placed closest to the current end of the buffer.
+		/// Larger members are preferred when there is a choice, so that smaller ones are left to fill the gaps after them.
+		/// </summary>
+		/// <param name="count">The number of uniform buffer members.</param>
+		/// <param name="get_member">Function that returns the uniform variable of the member at the specified index (with its size already set).</param>
+		/// <param name="place_member">Function that returns the offset a uniform variable is placed at when appended to a buffer that ends at the specified offset.</param>
+		/// <returns>The member indices in the order they should be declared in.</returns>
+		template <typename G, typename F>
+		static std::vector<size_t> find_packed_uniform_order(size_t count, G get_member, F place_member)
+		{
+			std::vector<size_t> remaining(count);
+			for (size_t i = 0; i < count; ++i)
+				remaining[i] = i;
+
+			std::vector<size_t> result;
+			result.reserve(count);
+
+			uint32_t end = 0;
+			while (!remaining.empty())
+			{
+				auto best_it = remaining.begin();
+				uint32_t best_padding = std::numeric_limits<uint32_t>::max();
+				for (auto it = remaining.begin(); it != remaining.end(); ++it)
+				{
+					const uniform_info &info = get_member(*it);
+					const uint32_t padding = place_member(info, end) - end;
+					if (padding < best_padding || (padding == best_padding && info.size > get_member(*best_it).size))
+					{
+						best_it = it;
+						best_padding = padding;
+					}
+				}
+
+				const uniform_info &best = get_member(*best_it);
+				end = place_member(best, end) + best.size;
+
+				result.push_back(*best_it);
+				remaining.erase(best_it);
+			}
+
+			return result;
+		}
+
+		/// <summary>
+		/// Checks whether the specified uniform variable only selects between a few discrete options (a boolean or an integer with a list of items).
+		/// These usually toggle features of an effect and are rarely changed, so are good candidates for specialization constants.
+		/// </summary>
+		static bool is_discrete_uniform(const uniform_info &info)
+		{
+			if (!info.has_initializer_value || !info.type.is_scalar() || !info.type.is_integral())
+				return false;
+
+			std::string_view ui_type;
+			for (const annotation &annotation : info.annotations)
+			{
+				// Uniforms with a source are updated by the runtime every frame
+				if (annotation.name == "source")
+					return false;
+				if (annotation.name == "ui_type")
+					ui_type = annotation.value.string_data;
+			}
+
+			return info.type.is_boolean() || ui_type == "list" || ui_type == "combo" || ui_type == "radio";
+		}
+
+		/// <summary>
+		/// Keep track of a call from the function that is currently being defined to the specified <paramref name="function"/>.
+		/// </summary>
+		void add_call_reference(id function)
+		{
+			if (!_functions.empty())
+				_function_calls[_functions.back()->definition].insert(function);
+		}
+		/// <summary>
+		/// Keep track of a function that is used by an entry point, which is either the function the entry point was defined with or a function generated to wrap it.
+		/// </summary>
+		void add_entry_point_function(const std::string &entry_point_name, id function)
+		{
+			_entry_point_functions.emplace_back(entry_point_name, function);
+		}
+
+		/// <summary>
+		/// Find the names of all entry points that use each function, by following the calls going out from the functions of every entry point.
+		/// Functions that are not used by any entry point are not part of the result and can be removed.
+		/// </summary>
+		std::unordered_map<id, std::vector<std::string>> find_entry_points_per_function() const
+		{
+			std::unordered_map<id, std::vector<std::string>> result;
+
+			for (const auto &[entry_point_name, entry_point_function] : _entry_point_functions)
+			{
+				std::vector<id> functions = { entry_point_function };
+				while (!functions.empty())
+				{
+					const id function = functions.back();
+					functions.pop_back();
+
+					std::vector<std::string> &entry_points = result[function];
+					if (std::find(entry_points.begin(), entry_points.end(), entry_point_name) != entry_points.end())
+						continue; // Already visited this function for the current entry point
+					entry_points.push_back(entry_point_name);
+
+					if (const auto it = _function_calls.find(function); it != _function_calls.end())
+						functions.insert(functions.end(), it->second.begin(), it->second.end());
+				}
+			}
+
+			return result;
+		}
+
+		/// <summary>
+		/// Remove the code of all functions that are not used by any entry point from the specified source <paramref name="code"/>.
+		/// The code of functions only used by some entry points is enclosed in a preprocessor condition on the "ENTRY_POINT_" definitions of those, so that compiling a single entry point does not have to process it.
+		/// </summary>
+		/// <param name="code">The source code the ranges in <see cref="_function_code_ranges"/> refer to.</param>
+		/// <param name="entry_points">The list of all entry points in the module.</param>
+		std::string strip_unused_function_code(const std::string &code, const std::vector<entry_point> &entry_points) const
+		{
+			const std::unordered_map<id, std::vector<std::string>> entry_points_per_function = find_entry_points_per_function();
+
+			// Entry point names become part of a macro name in the preprocessor conditions, so this only works if they are valid identifiers
+			const bool can_use_conditions = std::all_of(entry_points.begin(), entry_points.end(),
+				[](const entry_point &ep) { return std::all_of(ep.name.begin(), ep.name.end(),
+					[](char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_'; }); });
+
+			std::string result;
+			result.reserve(code.size());
+
+			size_t offset = 0;
+			for (const function_code_range &range : _function_code_ranges)
+			{
+				// Skip functions that were not finished (which can happen when parsing failed)
+				if (range.end <= range.begin)
+					continue;
+
+				assert(range.begin >= offset && range.end <= code.size());
+				result.append(code, offset, range.begin - offset);
+				offset = range.end;
+
+				const auto it = entry_points_per_function.find(range.definition);
+				if (it == entry_points_per_function.end())
+					continue;
+
+				if (!can_use_conditions || it->second.size() == entry_points.size())
+				{
+					result.append(code, range.begin, range.end - range.begin);
+					continue;
+				}
+
+				result += "#if ";
+				for (size_t i = 0; i < it->second.size(); ++i)
+				{
+					if (i != 0)
+						result += " || ";
+					result += "defined(ENTRY_POINT_" + it->second[i] + ')';
+				}
+				result += '\n';
+				result.append(code, range.begin, range.end - range.begin);
+				result += "#endif\n";
+			}
+
+			result.append(code, offset, std::string::npos);
+
+			return result;
+		}
+
+		struct function_code_range
+		{
+			id definition;
+			size_t begin, end;
+		};
+
 		reshadefx::module _module;
 		std::vector<struct_info> _structs;
 		std::vector<std::unique_ptr<function_info>> _functions;
+		// Ranges in the generated source code the functions were written to (for source code generators)
+		std::vector<function_code_range> _function_code_ranges;
+		// Functions called by each function
+		std::unordered_map<id, std::unordered_set<id>> _function_calls;
+		std::vector<std::pair<std::string, id>> _entry_point_functions;
 		id _next_id = 1;
 		id _last_block = 0;
 		id _current_block = 0;
@@ -344,14 +531,18 @@ namespace reshadefx
 	/// <param name="uniforms_to_spec_constants">Whether to convert uniform variables to specialization constants.</param>
 	/// <param name="enable_16bit_types">Use real 16-bit types for the minimum precision types "min16int", "min16uint" and "min16float".</param>
 	/// <param name="flip_vert_y">Insert code to flip the Y component of the output position in vertex shaders.</param>
-	codegen *create_codegen_glsl(bool debug_info, bool uniforms_to_spec_constants, bool enable_16bit_types = false, bool flip_vert_y = false);
+	/// <param name="discrete_uniforms_to_spec_constants">Whether to convert only uniform variables that select between a few discrete options to specialization constants (they are kept in the uniform buffer as well).</param>
+	/// <param name="pack_uniforms">Whether to reorder the members of the uniform buffer to reduce its size, instead of laying them out in declaration order.</param>
+	codegen *create_codegen_glsl(bool debug_info, bool uniforms_to_spec_constants, bool enable_16bit_types = false, bool flip_vert_y = false, bool discrete_uniforms_to_spec_constants = false, bool pack_uniforms = false);
 	/// <summary>
 	/// Create a back-end implementation for HLSL code generation.
 	/// </summary>
 	/// <param name="shader_model">The HLSL shader model version (e.g. 30, 41, 50, 60, ...)</param>
 	/// <param name="debug_info">Whether to append debug information like line directives to the generated code.</param>
 	/// <param name="uniforms_to_spec_constants">Whether to convert uniform variables to specialization constants.</param>
-	codegen *create_codegen_hlsl(unsigned int shader_model, bool debug_info, bool uniforms_to_spec_constants);
+	/// <param name="discrete_uniforms_to_spec_constants">Whether to convert only uniform variables that select between a few discrete options to specialization constants (they are kept in the uniform buffer as well).</param>
+	/// <param name="pack_uniforms">Whether to reorder the members of the uniform buffer to reduce its size, instead of laying them out in declaration order.</param>
+	codegen *create_codegen_hlsl(unsigned int shader_model, bool debug_info, bool uniforms_to_spec_constants, bool discrete_uniforms_to_spec_constants = false, bool pack_uniforms = false);
 	/// <summary>
 	/// Create a back-end implementation for SPIR-V code generation.
 	/// </summary>
@@ -360,5 +551,6 @@ namespace reshadefx
 	/// <param name="uniforms_to_spec_constants">Whether to convert uniform variables to specialization constants.</param>
 	/// <param name="enable_16bit_types">Use real 16-bit types for the minimum precision types "min16int", "min16uint" and "min16float".</param>
 	/// <param name="flip_vert_y">Insert code to flip the Y component of the output position in vertex shaders.</param>
-	codegen *create_codegen_spirv(bool vulkan_semantics, bool debug_info, bool uniforms_to_spec_constants, bool enable_16bit_types = false, bool flip_vert_y = false);
+	/// <param name="discrete_uniforms_to_spec_constants">Whether to convert only uniform variables that select between a few discrete options to specialization constants (they are kept in the uniform buffer as well).</param>
+	codegen *create_codegen_spirv(bool vulkan_semantics, bool debug_info, bool uniforms_to_spec_constants, bool enable_16bit_types = false, bool flip_vert_y = false, bool discrete_uniforms_to_spec_constants = false);
 }
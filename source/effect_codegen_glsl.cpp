@@ -16,8 +16,8 @@ using namespace reshadefx;
 class codegen_glsl final : public codegen
 {
 public:
-	codegen_glsl(bool debug_info, bool uniforms_to_spec_constants, bool enable_16bit_types, bool flip_vert_y)
-		: _debug_info(debug_info), _uniforms_to_spec_constants(uniforms_to_spec_constants), _enable_16bit_types(enable_16bit_types), _flip_vert_y(flip_vert_y)
+	codegen_glsl(bool debug_info, bool uniforms_to_spec_constants, bool enable_16bit_types, bool flip_vert_y, bool discrete_uniforms_to_spec_constants, bool pack_uniforms)
+		: _debug_info(debug_info), _uniforms_to_spec_constants(uniforms_to_spec_constants), _discrete_uniforms_to_spec_constants(discrete_uniforms_to_spec_constants), _enable_16bit_types(enable_16bit_types), _flip_vert_y(flip_vert_y), _pack_uniforms(pack_uniforms)
 	{
 		// Create default block and reserve a memory block to avoid frequent reallocations
 		std::string &block = _blocks.emplace(0, std::string()).first->second;
@@ -43,12 +43,23 @@ private:
 	std::unordered_map<id, std::string> _blocks;
 	bool _debug_info = false;
 	bool _uniforms_to_spec_constants = false;
+	bool _discrete_uniforms_to_spec_constants = false;
 	bool _enable_16bit_types = false;
 	bool _enable_control_flow_attributes = false;
 	bool _flip_vert_y = false;
+	bool _pack_uniforms = false;
 	std::unordered_map<id, id> _remapped_sampler_variables;
 	std::unordered_map<std::string, uint32_t> _semantic_to_location;
 
+	// Uniform buffer members whose layout is only decided in 'write_result' when packing uniforms
+	struct uniform_buffer_member
+	{
+		location loc;
+		id res;
+		size_t index;
+	};
+	std::vector<uniform_buffer_member> _uniform_buffer_members;
+
 	// Only write compatibility intrinsics to result if they are actually in use
 	bool _uses_fmod = false;
 	bool _uses_componentwise_or = false;
@@ -57,6 +68,19 @@ private:
 
 	void write_result(module &module) override
 	{
+		if (_pack_uniforms)
+		{
+			const auto order = find_packed_uniform_order(_uniform_buffer_members.size(),
+				[this](size_t i) -> const uniform_info & { return _module.uniforms[_uniform_buffer_members[i].index]; },
+				[](const uniform_info &info, uint32_t end) { return align_up(end, find_uniform_buffer_alignment(info.type)); });
+
+			for (const size_t i : order)
+			{
+				const uniform_buffer_member &member = _uniform_buffer_members[i];
+				write_uniform_buffer_member(member.loc, _module.uniforms[member.index], member.res);
+			}
+		}
+
 		module = std::move(_module);
 
 		if (_enable_16bit_types)
@@ -100,7 +124,7 @@ private:
 			// TODO: This technically only works with square matrices
 			module.hlsl += "layout(std140, column_major, binding = 0) uniform _Globals {\n" + _ubo_block + "};\n";
 
-		module.hlsl += _blocks.at(0);
+		module.hlsl += strip_unused_function_code(_blocks.at(0), module.entry_points);
 	}
 
 	template <bool is_param = false, bool is_decl = true, bool is_interface = false>
@@ -510,7 +534,7 @@ private:
 
 		define_name<naming::unique>(res, info.name);
 
-		if (_uniforms_to_spec_constants && info.has_initializer_value)
+		if ((_uniforms_to_spec_constants && info.has_initializer_value) || (_discrete_uniforms_to_spec_constants && is_discrete_uniform(info)))
 		{
 			info.size = info.type.components() * 4;
 			if (info.type.is_array())
@@ -528,52 +552,71 @@ private:
 			code += "(SPEC_CONSTANT_" + info.name + ");\n";
 
 			_module.spec_constants.push_back(info);
+
+			// Keep discrete uniforms in the uniform buffer as well, so that the runtime can still treat them like any other uniform variable (the code only references the constant though)
+			if (!_uniforms_to_spec_constants)
+				define_uniform_buffer_member(loc, info, make_id());
 		}
 		else
 		{
-			// GLSL specification on std140 layout:
-			// 1. If the member is a scalar consuming N basic machine units, the base alignment is N.
-			// 2. If the member is a two- or four-component vector with components consuming N basic machine units, the base alignment is 2N or 4N, respectively.
-			// 3. If the member is a three-component vector with components consuming N basic machine units, the base alignment is 4N.
-			// 4. If the member is an array of scalars or vectors, the base alignment and array stride are set to match the base alignment of a single array element,
-			//    according to rules (1), (2), and (3), and rounded up to the base alignment of a four-component vector.
-			// 7. If the member is a row-major matrix with C columns and R rows, the matrix is stored identically to an array of R row vectors with C components each, according to rule (4).
-			// 8. If the member is an array of S row-major matrices with C columns and R rows, the matrix is stored identically to a row of S*R row vectors with C components each, according to rule (4).
-			uint32_t alignment = (info.type.rows == 3 ? 4 /* (3) */ : info.type.rows /* (2)*/) * 4 /* (1)*/;
-			info.size = info.type.rows * 4;
-
-			if (info.type.is_matrix())
-			{
-				alignment = 16 /* (4) */;
-				info.size = info.type.rows * alignment /* (7), (8) */;
-			}
-			if (info.type.is_array())
-			{
-				alignment = 16 /* (4) */;
-				info.size = align_up(info.size, alignment) * info.type.array_length;
-			}
+			define_uniform_buffer_member(loc, info, res);
+		}
 
-			// Adjust offset according to alignment rules from above
-			info.offset = _module.total_uniform_size;
-			info.offset = align_up(info.offset, alignment);
-			_module.total_uniform_size = info.offset + info.size;
+		return res;
+	}
+	void define_uniform_buffer_member(const location &loc, uniform_info &info, id res)
+	{
+		// GLSL specification on std140 layout:
+		// 1. If the member is a scalar consuming N basic machine units, the base alignment is N.
+		// 2. If the member is a two- or four-component vector with components consuming N basic machine units, the base alignment is 2N or 4N, respectively.
+		// 3. If the member is a three-component vector with components consuming N basic machine units, the base alignment is 4N.
+		// 4. If the member is an array of scalars or vectors, the base alignment and array stride are set to match the base alignment of a single array element,
+		//    according to rules (1), (2), and (3), and rounded up to the base alignment of a four-component vector.
+		// 7. If the member is a row-major matrix with C columns and R rows, the matrix is stored identically to an array of R row vectors with C components each, according to rule (4).
+		// 8. If the member is an array of S row-major matrices with C columns and R rows, the matrix is stored identically to a row of S*R row vectors with C components each, according to rule (4).
+		const uint32_t alignment = find_uniform_buffer_alignment(info.type);
+		info.size = info.type.rows * 4;
+
+		if (info.type.is_matrix())
+			info.size = info.type.rows * alignment /* (7), (8) */;
+		if (info.type.is_array())
+			info.size = align_up(info.size, alignment) * info.type.array_length;
+
+		if (_pack_uniforms)
+		{
+			// Members are declared in packed order once all of them are known
+			_uniform_buffer_members.push_back({ loc, res, _module.uniforms.size() });
+			_module.uniforms.push_back(info);
+			return;
+		}
 
-			write_location(_ubo_block, loc);
+		write_uniform_buffer_member(loc, info, res);
 
-			_ubo_block += '\t';
-			// Note: All matrices are floating-point, even if the uniform type says different!!
-			write_type(_ubo_block, info.type);
-			_ubo_block += ' ' + id_to_name(res);
+		_module.uniforms.push_back(info);
+	}
+	static uint32_t find_uniform_buffer_alignment(const type &type)
+	{
+		if (type.is_matrix() || type.is_array())
+			return 16 /* (4) */;
+		return (type.rows == 3 ? 4 /* (3) */ : type.rows /* (2)*/) * 4 /* (1)*/;
+	}
+	void write_uniform_buffer_member(const location &loc, uniform_info &info, id res)
+	{
+		// Adjust offset according to alignment rules from above
+		info.offset = align_up(_module.total_uniform_size, find_uniform_buffer_alignment(info.type));
+		_module.total_uniform_size = info.offset + info.size;
 
-			if (info.type.is_array())
-				_ubo_block += '[' + std::to_string(info.type.array_length) + ']';
+		write_location(_ubo_block, loc);
 
-			_ubo_block += ";\n";
+		_ubo_block += '\t';
+		// Note: All matrices are floating-point, even if the uniform type says different!!
+		write_type(_ubo_block, info.type);
+		_ubo_block += ' ' + id_to_name(res);
 
-			_module.uniforms.push_back(info);
-		}
+		if (info.type.is_array())
+			_ubo_block += '[' + std::to_string(info.type.array_length) + ']';
 
-		return res;
+		_ubo_block += ";\n";
 	}
 	id   define_variable(const location &loc, const type &type, std::string name, bool global, id initializer_value) override
 	{
@@ -625,6 +668,8 @@ private:
 
 		std::string &code = _blocks.at(_current_block);
 
+		_function_code_ranges.push_back({ info.definition, code.size(), 0 });
+
 		write_location(code, loc);
 
 		write_type(code, info.return_type);
@@ -673,6 +718,7 @@ private:
 			return;
 
 		_module.entry_points.push_back({ func.unique_name, stype });
+		add_entry_point_function(func.unique_name, func.definition);
 
 		_blocks.at(0) += "#ifdef ENTRY_POINT_" + func.unique_name + '\n';
 		if (stype == shader_type::cs)
@@ -774,6 +820,7 @@ private:
 
 		// Translate return value to output variable
 		define_function({}, entry_point, true);
+		add_entry_point_function(func.unique_name, entry_point.definition);
 		enter_block(create_block());
 
 		std::string &code = _blocks.at(_current_block);
@@ -1403,13 +1450,15 @@ private:
 
 		return res;
 	}
-	id   emit_call(const location &loc, id function, const type &res_type, const std::vector<expression> &args) override
+	id   emit_call(const location &loc, id function, const type &res_type, const expression_list &args) override
 	{
 #ifndef NDEBUG
 		for (const expression &arg : args)
 			assert(arg.chain.empty() && arg.base != 0);
 #endif
 
+		add_call_reference(function);
+
 		const id res = make_id();
 
 		std::string &code = _blocks.at(_current_block);
@@ -1443,7 +1492,7 @@ private:
 
 		return res;
 	}
-	id   emit_call_intrinsic(const location &loc, id intrinsic, const type &res_type, const std::vector<expression> &args) override
+	id   emit_call_intrinsic(const location &loc, id intrinsic, const type &res_type, const expression_list &args) override
 	{
 #ifndef NDEBUG
 		for (const expression &arg : args)
@@ -1482,7 +1531,7 @@ private:
 
 		return res;
 	}
-	id   emit_construct(const location &loc, const type &type, const std::vector<expression> &args) override
+	id   emit_construct(const location &loc, const type &type, const expression_list &args) override
 	{
 #ifndef NDEBUG
 		for (const auto &arg : args)
@@ -1884,10 +1933,12 @@ private:
 		assert(_last_block != 0);
 
 		_blocks.at(0) += "{\n" + _blocks.at(_last_block) + "}\n";
+
+		_function_code_ranges.back().end = _blocks.at(0).size();
 	}
 };
 
-codegen *reshadefx::create_codegen_glsl(bool debug_info, bool uniforms_to_spec_constants, bool enable_16bit_types, bool flip_vert_y)
+codegen *reshadefx::create_codegen_glsl(bool debug_info, bool uniforms_to_spec_constants, bool enable_16bit_types, bool flip_vert_y, bool discrete_uniforms_to_spec_constants, bool pack_uniforms)
 {
-	return new codegen_glsl(debug_info, uniforms_to_spec_constants, enable_16bit_types, flip_vert_y);
+	return new codegen_glsl(debug_info, uniforms_to_spec_constants, enable_16bit_types, flip_vert_y, discrete_uniforms_to_spec_constants, pack_uniforms);
 }
@@ -16,8 +16,8 @@ using namespace reshadefx;
 class codegen_hlsl final : public codegen
 {
 public:
-	codegen_hlsl(unsigned int shader_model, bool debug_info, bool uniforms_to_spec_constants)
-		: _shader_model(shader_model), _debug_info(debug_info), _uniforms_to_spec_constants(uniforms_to_spec_constants)
+	codegen_hlsl(unsigned int shader_model, bool debug_info, bool uniforms_to_spec_constants, bool discrete_uniforms_to_spec_constants, bool pack_uniforms)
+		: _shader_model(shader_model), _debug_info(debug_info), _uniforms_to_spec_constants(uniforms_to_spec_constants), _discrete_uniforms_to_spec_constants(discrete_uniforms_to_spec_constants), _pack_uniforms(pack_uniforms)
 	{
 		// Create default block and reserve a memory block to avoid frequent reallocations
 		std::string &block = _blocks.emplace(0, std::string()).first->second;
@@ -36,18 +36,42 @@ private:
 	};
 
 	std::string _cbuffer_block;
-	std::string _current_location;
+	std::string_view _current_location;
 	std::unordered_map<id, std::string> _names;
 	std::unordered_map<id, std::string> _blocks;
 	bool _debug_info = false;
 	bool _uniforms_to_spec_constants = false;
+	bool _discrete_uniforms_to_spec_constants = false;
+	bool _pack_uniforms = false;
 	unsigned int _shader_model = 0;
 
+	// Uniform buffer members whose layout is only decided in 'write_result' when packing uniforms
+	struct uniform_buffer_member
+	{
+		location loc;
+		id res;
+		size_t index;
+	};
+	std::vector<uniform_buffer_member> _uniform_buffer_members;
+
 	// Only write compatibility intrinsics to result if they are actually in use
 	bool _uses_bitwise_cast = false;
 
 	void write_result(module &module) override
 	{
+		if (_pack_uniforms)
+		{
+			const auto order = find_packed_uniform_order(_uniform_buffer_members.size(),
+				[this](size_t i) -> const uniform_info & { return _module.uniforms[_uniform_buffer_members[i].index]; },
+				[](const uniform_info &info, uint32_t end) { return find_uniform_buffer_offset(info, end); });
+
+			for (const size_t i : order)
+			{
+				const uniform_buffer_member &member = _uniform_buffer_members[i];
+				write_uniform_buffer_member(member.loc, _module.uniforms[member.index], member.res);
+			}
+		}
+
 		module = std::move(_module);
 
 		if (_shader_model >= 40)
@@ -101,7 +125,7 @@ private:
 			module.total_uniform_size *= 4;
 		}
 
-		module.hlsl += _blocks.at(0);
+		module.hlsl += strip_unused_function_code(_blocks.at(0), module.entry_points);
 	}
 
 	template <bool is_param = false, bool is_decl = true>
@@ -272,11 +296,11 @@ private:
 		// Avoid writing the file name every time to reduce output text size
 		if constexpr (force_source)
 		{
-			s += " \"" + loc.source + '\"';
+			s += " \"" + std::string(loc.source) + '\"';
 		}
 		else if (loc.source != _current_location)
 		{
-			s += " \"" + loc.source + '\"';
+			s += " \"" + std::string(loc.source) + '\"';
 
 			_current_location = loc.source;
 		}
@@ -508,7 +532,7 @@ private:
 
 		define_name<naming::unique>(res, info.name);
 
-		if (_uniforms_to_spec_constants && info.has_initializer_value)
+		if ((_uniforms_to_spec_constants && info.has_initializer_value) || (_discrete_uniforms_to_spec_constants && is_discrete_uniform(info)))
 		{
 			info.size = info.type.components() * 4;
 			if (info.type.is_array())
@@ -526,63 +550,88 @@ private:
 			code += "(SPEC_CONSTANT_" + info.name + ");\n";
 
 			_module.spec_constants.push_back(info);
+
+			// Keep discrete uniforms in the uniform buffer as well, so that the runtime can still treat them like any other uniform variable (the code only references the constant though)
+			if (!_uniforms_to_spec_constants)
+				define_uniform_buffer_member(loc, info, make_id());
 		}
 		else
 		{
-			if (info.type.is_matrix())
-				info.size = align_up(info.type.cols * 4, 16, info.type.rows);
-			else // Vectors are column major (1xN), matrices are row major (NxM)
-				info.size = info.type.rows * 4;
-			// Arrays are not packed in HLSL by default, each element is stored in a four-component vector (16 bytes)
-			if (info.type.is_array())
-				info.size = align_up(info.size, 16, info.type.array_length);
-
-			// Data is packed into 4-byte boundaries (see https://docs.microsoft.com/windows/win32/direct3dhlsl/dx-graphics-hlsl-packing-rules)
-			// This is already guaranteed, since all types are at least 4-byte in size
-			info.offset = _module.total_uniform_size;
-			// Additionally, HLSL packs data so that it does not cross a 16-byte boundary
-			const uint32_t remaining = 16 - (info.offset & 15);
-			if (remaining != 16 && info.size > remaining)
-				info.offset += remaining;
-			_module.total_uniform_size = info.offset + info.size;
-
-			write_location<true>(_cbuffer_block, loc);
-
-			if (_shader_model >= 40)
-				_cbuffer_block += '\t';
-			if (info.type.is_matrix()) // Force row major matrices
-				_cbuffer_block += "row_major ";
-
-			type type = info.type;
-			if (_shader_model < 40)
-			{
-				// The HLSL compiler tries to evaluate boolean values with temporary registers, which breaks branches, so force it to use constant float registers
-				if (type.is_boolean())
-					type.base = type::t_float;
+			define_uniform_buffer_member(loc, info, res);
+		}
 
-				// Simply put each uniform into a separate constant register in shader model 3 for now
-				info.offset *= 4;
-			}
+		return res;
+	}
+	void define_uniform_buffer_member(const location &loc, uniform_info &info, id res)
+	{
+		if (info.type.is_matrix())
+			info.size = align_up(info.type.cols * 4, 16, info.type.rows);
+		else // Vectors are column major (1xN), matrices are row major (NxM)
+			info.size = info.type.rows * 4;
+		// Arrays are not packed in HLSL by default, each element is stored in a four-component vector (16 bytes)
+		if (info.type.is_array())
+			info.size = align_up(info.size, 16, info.type.array_length);
+
+		if (_pack_uniforms)
+		{
+			// Members are declared in packed order once all of them are known
+			_uniform_buffer_members.push_back({ loc, res, _module.uniforms.size() });
+			_module.uniforms.push_back(info);
+			return;
+		}
 
-			write_type(_cbuffer_block, type);
-			_cbuffer_block += ' ' + id_to_name(res);
+		write_uniform_buffer_member(loc, info, res);
 
-			if (info.type.is_array())
-				_cbuffer_block += '[' + std::to_string(info.type.array_length) + ']';
+		_module.uniforms.push_back(info);
+	}
+	static uint32_t find_uniform_buffer_offset(const uniform_info &info, uint32_t end)
+	{
+		// Data is packed into 4-byte boundaries (see https://docs.microsoft.com/windows/win32/direct3dhlsl/dx-graphics-hlsl-packing-rules)
+		// This is already guaranteed, since all types are at least 4-byte in size
+		uint32_t offset = end;
+		// Additionally, HLSL packs data so that it does not cross a 16-byte boundary
+		const uint32_t remaining = 16 - (offset & 15);
+		if (remaining != 16 && info.size > remaining)
+			offset += remaining;
+		return offset;
+	}
+	void write_uniform_buffer_member(const location &loc, uniform_info &info, id res)
+	{
+		info.offset = find_uniform_buffer_offset(info, _module.total_uniform_size);
+		_module.total_uniform_size = info.offset + info.size;
 
-			if (_shader_model < 40)
-			{
-				// Every constant register is 16 bytes wide, so divide memory offset by 16 to get the constant register index
-				// Note: All uniforms are floating-point in shader model 3, even if the uniform type says different!!
-				_cbuffer_block += " : register(c" + std::to_string(info.offset / 16) + ')';
-			}
+		write_location<true>(_cbuffer_block, loc);
 
-			_cbuffer_block += ";\n";
+		if (_shader_model >= 40)
+			_cbuffer_block += '\t';
+		if (info.type.is_matrix()) // Force row major matrices
+			_cbuffer_block += "row_major ";
 
-			_module.uniforms.push_back(info);
+		type type = info.type;
+		if (_shader_model < 40)
+		{
+			// The HLSL compiler tries to evaluate boolean values with temporary registers, which breaks branches, so force it to use constant float registers
+			if (type.is_boolean())
+				type.base = type::t_float;
+
+			// Simply put each uniform into a separate constant register in shader model 3 for now
+			info.offset *= 4;
 		}
 
-		return res;
+		write_type(_cbuffer_block, type);
+		_cbuffer_block += ' ' + id_to_name(res);
+
+		if (info.type.is_array())
+			_cbuffer_block += '[' + std::to_string(info.type.array_length) + ']';
+
+		if (_shader_model < 40)
+		{
+			// Every constant register is 16 bytes wide, so divide memory offset by 16 to get the constant register index
+			// Note: All uniforms are floating-point in shader model 3, even if the uniform type says different!!
+			_cbuffer_block += " : register(c" + std::to_string(info.offset / 16) + ')';
+		}
+
+		_cbuffer_block += ";\n";
 	}
 	id   define_variable(const location &loc, const type &type, std::string name, bool global, id initializer_value) override
 	{
@@ -619,6 +668,10 @@ private:
 
 		std::string &code = _blocks.at(_current_block);
 
+		_function_code_ranges.push_back({ info.definition, code.size(), 0 });
+
+		// Functions may be removed from the output again, so always start with the full location, instead of relying on a previous one
+		_current_location = {};
 		write_location(code, loc);
 
 		write_type(code, info.return_type);
@@ -675,6 +728,7 @@ private:
 			return;
 
 		_module.entry_points.push_back({ func.unique_name, stype });
+		add_entry_point_function(func.unique_name, func.definition);
 
 		// Only have to rewrite the entry point function signature in shader model 3 and for compute (to write "numthreads" attribute)
 		if (_shader_model >= 40 && stype != shader_type::cs)
@@ -736,6 +790,8 @@ private:
 			}
 		}
 
+		const size_t attribute_offset = _blocks.at(_current_block).size();
+
 		if (stype == shader_type::cs)
 			_blocks.at(_current_block) += "[numthreads(" +
 				std::to_string(num_threads[0]) + ", " +
@@ -743,6 +799,10 @@ private:
 				std::to_string(num_threads[2]) + ")]\n";
 
 		define_function({}, entry_point);
+		add_entry_point_function(func.unique_name, entry_point.definition);
+
+		// The attribute belongs to the function, so include it in its code range
+		_function_code_ranges.back().begin = attribute_offset;
 		enter_block(create_block());
 
 		std::string &code = _blocks.at(_current_block);
@@ -1094,13 +1154,15 @@ private:
 
 		return res;
 	}
-	id   emit_call(const location &loc, id function, const type &res_type, const std::vector<expression> &args) override
+	id   emit_call(const location &loc, id function, const type &res_type, const expression_list &args) override
 	{
 #ifndef NDEBUG
 		for (const expression &arg : args)
 			assert(arg.chain.empty() && arg.base != 0);
 #endif
 
+		add_call_reference(function);
+
 		const id res = make_id();
 
 		std::string &code = _blocks.at(_current_block);
@@ -1134,7 +1196,7 @@ private:
 
 		return res;
 	}
-	id   emit_call_intrinsic(const location &loc, id intrinsic, const type &res_type, const std::vector<expression> &args) override
+	id   emit_call_intrinsic(const location &loc, id intrinsic, const type &res_type, const expression_list &args) override
 	{
 #ifndef NDEBUG
 		for (const expression &arg : args)
@@ -1184,7 +1246,7 @@ private:
 
 		return res;
 	}
-	id   emit_construct(const location &loc, const type &type, const std::vector<expression> &args) override
+	id   emit_construct(const location &loc, const type &type, const expression_list &args) override
 	{
 #ifndef NDEBUG
 		for (const auto &arg : args)
@@ -1645,10 +1707,13 @@ private:
 		assert(_last_block != 0);
 
 		_blocks.at(0) += "{\n" + _blocks.at(_last_block) + "}\n";
+
+		_function_code_ranges.back().end = _blocks.at(0).size();
+		_current_location = {};
 	}
 };
 
-codegen *reshadefx::create_codegen_hlsl(unsigned int shader_model, bool debug_info, bool uniforms_to_spec_constants)
+codegen *reshadefx::create_codegen_hlsl(unsigned int shader_model, bool debug_info, bool uniforms_to_spec_constants, bool discrete_uniforms_to_spec_constants, bool pack_uniforms)
 {
-	return new codegen_hlsl(shader_model, debug_info, uniforms_to_spec_constants);
+	return new codegen_hlsl(shader_model, debug_info, uniforms_to_spec_constants, discrete_uniforms_to_spec_constants, pack_uniforms);
 }
@@ -6,7 +6,7 @@
 #include "effect_parser.hpp"
 #include "effect_codegen.hpp"
 #include <cassert>
-#include <cstring> // memcmp
+#include <cstring> // std::memcmp, std::strlen
 #include <algorithm> // std::find_if, std::max
 #include <unordered_set>
 
@@ -116,8 +116,8 @@ struct spirv_basic_block
 class codegen_spirv final : public codegen
 {
 public:
-	codegen_spirv(bool vulkan_semantics, bool debug_info, bool uniforms_to_spec_constants, bool enable_16bit_types, bool flip_vert_y)
-		: _debug_info(debug_info), _vulkan_semantics(vulkan_semantics), _uniforms_to_spec_constants(uniforms_to_spec_constants), _enable_16bit_types(enable_16bit_types), _flip_vert_y(flip_vert_y)
+	codegen_spirv(bool vulkan_semantics, bool debug_info, bool uniforms_to_spec_constants, bool enable_16bit_types, bool flip_vert_y, bool discrete_uniforms_to_spec_constants)
+		: _debug_info(debug_info), _vulkan_semantics(vulkan_semantics), _uniforms_to_spec_constants(uniforms_to_spec_constants), _discrete_uniforms_to_spec_constants(discrete_uniforms_to_spec_constants), _enable_16bit_types(enable_16bit_types), _flip_vert_y(flip_vert_y)
 	{
 		_glsl_ext = make_id();
 	}
@@ -164,20 +164,24 @@ private:
 
 	std::unordered_set<spv::Id> _spec_constants;
 	std::unordered_set<spv::Capability> _capabilities;
+	std::vector<std::pair<spv::BuiltIn, spv::Id>> _builtin_variables;
 	std::vector<std::pair<type_lookup, spv::Id>> _type_lookup;
 	std::vector<std::tuple<type, constant, spv::Id>> _constant_lookup;
 	std::vector<std::pair<function_blocks, spv::Id>> _function_type_lookup;
-	std::unordered_map<std::string, spv::Id> _string_lookup;
+	std::unordered_map<std::string_view, spv::Id> _string_lookup; // Keys refer to interned source names
 	std::unordered_map<spv::Id, spv::StorageClass> _storage_lookup;
 	std::unordered_map<std::string, uint32_t> _semantic_to_location;
 
 	std::vector<function_blocks> _functions_blocks;
+	// Filled in 'write_result' and only read afterwards when writing the modules of the individual entry points
+	std::unordered_map<id, std::vector<std::string>> _entry_points_per_function;
 	std::unordered_map<id, spirv_basic_block> _block_data;
 	spirv_basic_block *_current_block_data = nullptr;
 
 	bool _debug_info = false;
 	bool _vulkan_semantics = false;
 	bool _uniforms_to_spec_constants = false;
+	bool _discrete_uniforms_to_spec_constants = false;
 	bool _enable_16bit_types = false;
 	bool _flip_vert_y = false;
 	id _glsl_ext = 0;
@@ -200,7 +204,7 @@ private:
 		else
 		{
 			add_instruction(spv::OpString, 0, _debug_a, file)
-				.add_string(loc.source.c_str());
+				.add_string(loc.source.data()); // Interned names are null-terminated
 			_string_lookup.emplace(loc.source, file);
 		}
 
@@ -258,83 +262,141 @@ private:
 
 		module = std::move(_module);
 
+		_entry_points_per_function = find_entry_points_per_function();
+
+		write_module(module.spirv, nullptr);
+	}
+	void write_entry_point_result(entry_point &entry_point) const override
+	{
+		// Multiple entry points in a single module cause issues with several drivers, so also write a separate module for every entry point
+		write_module(entry_point.spirv, &entry_point.name);
+	}
+
+	void write_module(std::vector<uint32_t> &spirv, const std::string *entry_point_name) const
+	{
+		// Checks whether a function is used by the requested entry point (or by any entry point if none was requested)
+		const auto is_function_used = [this, entry_point_name](spv::Id function) {
+			const auto it = _entry_points_per_function.find(function);
+			return it != _entry_points_per_function.end() &&
+				(entry_point_name == nullptr || std::find(it->second.begin(), it->second.end(), *entry_point_name) != it->second.end());
+		};
+
 		// Write SPIRV header info
-		module.spirv.push_back(spv::MagicNumber);
-		module.spirv.push_back(0x10300); // Force SPIR-V 1.3
-		module.spirv.push_back(0u); // Generator magic number, see https://www.khronos.org/registry/spir-v/api/spir-v.xml
-		module.spirv.push_back(_next_id); // Maximum ID
-		module.spirv.push_back(0u); // Reserved for instruction schema
+		spirv.push_back(spv::MagicNumber);
+		spirv.push_back(0x10300); // Force SPIR-V 1.3
+		spirv.push_back(0u); // Generator magic number, see https://www.khronos.org/registry/spir-v/api/spir-v.xml
+		spirv.push_back(_next_id); // Maximum ID
+		spirv.push_back(0u); // Reserved for instruction schema
 
 		// All capabilities
 		spirv_instruction(spv::OpCapability)
 			.add(spv::CapabilityShader) // Implicitly declares the Matrix capability too
-			.write(module.spirv);
+			.write(spirv);
 
 		for (spv::Capability capability : _capabilities)
 			spirv_instruction(spv::OpCapability)
 				.add(capability)
-				.write(module.spirv);
+				.write(spirv);
 
 		// Optional extension instructions
 		spirv_instruction(spv::OpExtInstImport, _glsl_ext)
 			.add_string("GLSL.std.450") // Import GLSL extension
-			.write(module.spirv);
+			.write(spirv);
 
 		// Single required memory model instruction
 		spirv_instruction(spv::OpMemoryModel)
 			.add(spv::AddressingModelLogical)
 			.add(spv::MemoryModelGLSL450)
-			.write(module.spirv);
+			.write(spirv);
+
+		// Functions that are not used are removed, along with all debug information and decorations referring to their contents
+		std::unordered_set<spv::Id> removed_ids;
+		for (size_t i = 0; i < _functions_blocks.size(); ++i)
+		{
+			if (is_function_used(_functions[i]->definition))
+				continue;
+
+			for (const spirv_basic_block *block : { &_functions_blocks[i].declaration, &_functions_blocks[i].variables, &_functions_blocks[i].definition })
+				for (const auto &node : block->instructions)
+					if (node.result != 0)
+						removed_ids.insert(node.result);
+		}
 
 		// All entry point declarations
 		for (const auto &node : _entries.instructions)
-			node.write(module.spirv);
+		{
+			assert(node.operands.size() >= 3);
+
+			if (is_function_used(node.operands[1]))
+			{
+				spirv_instruction entry_point_inst = node;
+				for (const auto &[builtin, variable] : _builtin_variables)
+					entry_point_inst.add(variable);
+
+				entry_point_inst.write(spirv);
+				continue;
+			}
+
+			// Interface variables of removed entry points are removed as well (they follow the entry point name string)
+			const size_t num_name_words = (std::strlen(reinterpret_cast<const char *>(&node.operands[2])) + 4) / 4;
+			removed_ids.insert(node.operands.begin() + 2 + num_name_words, node.operands.end());
+		}
 
 		// All execution mode declarations
 		for (const auto &node : _execution_modes.instructions)
-			node.write(module.spirv);
+			if (is_function_used(node.operands[0]))
+				node.write(spirv);
 
 		spirv_instruction(spv::OpSource)
 			.add(spv::SourceLanguageUnknown) // ReShade FX is not a reserved token at the moment
 			.add(0) // Language version, TODO: Maybe fill in ReShade version here?
-			.write(module.spirv);
+			.write(spirv);
+
+		const auto is_referring_to_removed_id = [&removed_ids](const spirv_instruction &node) {
+			return !node.operands.empty() && removed_ids.find(node.operands[0]) != removed_ids.end();
+		};
 
 		if (_debug_info)
 		{
 			// All debug instructions
 			for (const auto &node : _debug_a.instructions)
-				node.write(module.spirv);
+				node.write(spirv);
 			for (const auto &node : _debug_b.instructions)
-				node.write(module.spirv);
+				if (!is_referring_to_removed_id(node))
+					node.write(spirv);
 		}
 
 		// All annotation instructions
 		for (const auto &node : _annotations.instructions)
-			node.write(module.spirv);
+			if (!is_referring_to_removed_id(node))
+				node.write(spirv);
 
 		// All type declarations
 		for (const auto &node : _types_and_constants.instructions)
-			node.write(module.spirv);
+			node.write(spirv);
 		for (const auto &node : _variables.instructions)
-			node.write(module.spirv);
+			if (removed_ids.find(node.result) == removed_ids.end())
+				node.write(spirv);
 
 		// All function definitions
-		for (const auto &function : _functions_blocks)
+		for (size_t i = 0; i < _functions_blocks.size(); ++i)
 		{
-			if (function.definition.instructions.empty())
+			const function_blocks &function = _functions_blocks[i];
+
+			if (function.definition.instructions.empty() || removed_ids.find(_functions[i]->definition) != removed_ids.end())
 				continue;
 
 			for (const auto &node : function.declaration.instructions)
-				node.write(module.spirv);
+				node.write(spirv);
 
 			// Grab first label and move it in front of variable declarations
-			function.definition.instructions.front().write(module.spirv);
+			function.definition.instructions.front().write(spirv);
 			assert(function.definition.instructions.front().op == spv::OpLabel);
 
 			for (const auto &node : function.variables.instructions)
-				node.write(module.spirv);
+				node.write(spirv);
 			for (auto it = function.definition.instructions.begin() + 1; it != function.definition.instructions.end(); ++it)
-				it->write(module.spirv);
+				it->write(spirv);
 		}
 	}
 
@@ -637,6 +699,27 @@ private:
 		_capabilities.insert(capability);
 	}
 
+	spv::Id emit_builtin_load(spv::BuiltIn builtin, const type &res_type)
+	{
+		// Built-in input variables that are not tied to entry point parameters are created on demand and added to the interface of every entry point
+		auto it = std::find_if(_builtin_variables.begin(), _builtin_variables.end(),
+			[builtin](const auto &entry) { return entry.first == builtin; });
+		if (it == _builtin_variables.end())
+		{
+			if (builtin == spv::BuiltInSubgroupSize || builtin == spv::BuiltInSubgroupLocalInvocationId)
+				add_capability(spv::CapabilityGroupNonUniform);
+
+			const spv::Id variable = define_variable({}, res_type, nullptr, spv::StorageClassInput);
+			add_builtin(variable, builtin);
+
+			it = _builtin_variables.emplace(_builtin_variables.end(), builtin, variable);
+		}
+
+		return add_instruction(spv::OpLoad, convert_type(res_type))
+			.add(it->second)
+			.result;
+	}
+
 	id   define_struct(const location &loc, struct_info &info) override
 	{
 		// First define all member types to make sure they are declared before the struct type references them
@@ -684,7 +767,9 @@ private:
 		info.texture_binding = ~0u;
 
 		add_decoration(info.id, spv::DecorationBinding, { info.binding });
-		add_decoration(info.id, spv::DecorationDescriptorSet, { 1 });
+		// OpenGL does not have descriptor sets, samplers and storages are bound to separate texture and image units there instead
+		if (_vulkan_semantics)
+			add_decoration(info.id, spv::DecorationDescriptorSet, { 1 });
 
 		_module.samplers.push_back(info);
 
@@ -696,7 +781,8 @@ private:
 		info.binding = _module.num_storage_bindings++;
 
 		add_decoration(info.id, spv::DecorationBinding, { info.binding });
-		add_decoration(info.id, spv::DecorationDescriptorSet, { 2 });
+		if (_vulkan_semantics)
+			add_decoration(info.id, spv::DecorationDescriptorSet, { 2 });
 
 		_module.storages.push_back(info);
 
@@ -704,7 +790,7 @@ private:
 	}
 	id   define_uniform(const location &, uniform_info &info) override
 	{
-		if (_uniforms_to_spec_constants && info.has_initializer_value)
+		if ((_uniforms_to_spec_constants && info.has_initializer_value) || (_discrete_uniforms_to_spec_constants && is_discrete_uniform(info)))
 		{
 			const id res = emit_constant(info.type, info.initializer_value, true);
 
@@ -776,75 +862,84 @@ private:
 				}
 			}
 
+			// Keep discrete uniforms in the uniform buffer as well, so that the runtime can still treat them like any other uniform variable (the code only references the constant though)
+			if (!_uniforms_to_spec_constants)
+				define_uniform_buffer_member(info);
+
 			return res;
 		}
 		else
 		{
-			// Create global uniform buffer variable on demand
-			if (_global_ubo_type == 0)
-			{
-				_global_ubo_type = make_id();
+			return define_uniform_buffer_member(info);
+		}
+	}
+	id   define_uniform_buffer_member(uniform_info &info)
+	{
+		// Create global uniform buffer variable on demand
+		if (_global_ubo_type == 0)
+		{
+			_global_ubo_type = make_id();
 
-				add_decoration(_global_ubo_type, spv::DecorationBlock);
-			}
-			if (_global_ubo_variable == 0)
-			{
-				_global_ubo_variable = make_id();
+			add_decoration(_global_ubo_type, spv::DecorationBlock);
+		}
+		if (_global_ubo_variable == 0)
+		{
+			_global_ubo_variable = make_id();
 
+			if (_vulkan_semantics)
 				add_decoration(_global_ubo_variable, spv::DecorationDescriptorSet, { 0 });
-				add_decoration(_global_ubo_variable, spv::DecorationBinding, { 0 });
-			}
+			add_decoration(_global_ubo_variable, spv::DecorationBinding, { 0 });
+		}
 
-			uint32_t alignment = (info.type.rows == 3 ? 4 : info.type.rows) * 4;
-			info.size = info.type.rows * 4;
+		uint32_t alignment = (info.type.rows == 3 ? 4 : info.type.rows) * 4;
+		info.size = info.type.rows * 4;
 
-			uint32_t array_stride = 16;
-			const uint32_t matrix_stride = 16;
+		uint32_t array_stride = 16;
+		const uint32_t matrix_stride = 16;
 
-			if (info.type.is_matrix())
-			{
-				alignment = matrix_stride;
-				info.size = info.type.rows * matrix_stride;
-			}
-			if (info.type.is_array())
-			{
-				alignment = array_stride;
-				array_stride = align_up(info.size, array_stride);
-				// Uniform block rules do not permit anything in the padding of an array
-				info.size = array_stride * info.type.array_length;
-			}
+		if (info.type.is_matrix())
+		{
+			alignment = matrix_stride;
+			info.size = info.type.rows * matrix_stride;
+		}
+		if (info.type.is_array())
+		{
+			alignment = array_stride;
+			array_stride = align_up(info.size, array_stride);
+			// Uniform block rules do not permit anything in the padding of an array
+			info.size = array_stride * info.type.array_length;
+		}
 
-			info.offset = _module.total_uniform_size;
-			info.offset = align_up(info.offset, alignment);
-			_module.total_uniform_size = info.offset + info.size;
+		info.offset = _module.total_uniform_size;
+		info.offset = align_up(info.offset, alignment);
+		_module.total_uniform_size = info.offset + info.size;
 
-			type ubo_type = info.type;
-			// Convert boolean uniform variables to integer type so that they have a defined size
-			if (info.type.is_boolean())
-				ubo_type.base = type::t_uint;
+		type ubo_type = info.type;
+		// Convert boolean uniform variables to integer type so that they have a defined size
+		if (info.type.is_boolean())
+			ubo_type.base = type::t_uint;
 
-			const uint32_t member_index = static_cast<uint32_t>(_global_ubo_types.size());
+		const uint32_t member_index = static_cast<uint32_t>(_global_ubo_types.size());
 
-			// Composite objects in the uniform storage class must be explicitly laid out, which includes array types requiring a stride decoration
-			_global_ubo_types.push_back(
-				convert_type(ubo_type, false, spv::StorageClassUniform, info.type.is_array() ? array_stride : 0u));
+		// Composite objects in the uniform storage class must be explicitly laid out, which includes array types requiring a stride decoration
+		_global_ubo_types.push_back(
+			convert_type(ubo_type, false, spv::StorageClassUniform, info.type.is_array() ? array_stride : 0u));
 
-			add_member_name(_global_ubo_type, member_index, info.name.c_str());
+		add_member_name(_global_ubo_type, member_index, info.name.c_str());
 
-			add_member_decoration(_global_ubo_type, member_index, spv::DecorationOffset, { info.offset });
+		add_member_decoration(_global_ubo_type, member_index, spv::DecorationOffset, { info.offset });
 
-			if (info.type.is_matrix())
-			{
-				// Read matrices in column major layout, even though they are actually row major, to avoid transposing them on every access (since SPIR-V uses column matrices)
-				// TODO: This technically only works with square matrices
-				add_member_decoration(_global_ubo_type, member_index, spv::DecorationColMajor);
-				add_member_decoration(_global_ubo_type, member_index, spv::DecorationMatrixStride, { matrix_stride });
-			}
+		if (info.type.is_matrix())
+		{
+			// Read matrices in column major layout, even though they are actually row major, to avoid transposing them on every access (since SPIR-V uses column matrices)
+			// TODO: This technically only works with square matrices
+			add_member_decoration(_global_ubo_type, member_index, spv::DecorationColMajor);
+			add_member_decoration(_global_ubo_type, member_index, spv::DecorationMatrixStride, { matrix_stride });
+		}
 
-			_module.uniforms.push_back(info);
+		_module.uniforms.push_back(info);
 
-			return 0xF0000000 | member_index;
-		}
+		return 0xF0000000 | member_index;
 	}
 	id   define_variable(const location &loc, const type &type, std::string name, bool global, id initializer_value) override
 	{
@@ -946,16 +1041,18 @@ private:
 			return;
 
 		_module.entry_points.push_back({ func.unique_name, stype });
+		add_entry_point_function(func.unique_name, func.definition);
 
 		spv::Id position_variable = 0, point_size_variable = 0;
 		std::vector<spv::Id> inputs_and_outputs;
-		std::vector<expression> call_params;
+		expression_list call_params;
 
 		// Generate the glue entry point function
 		function_info entry_point;
 		entry_point.return_type = { type::t_void };
 
 		define_function({}, entry_point);
+		add_entry_point_function(func.unique_name, entry_point.definition);
 		enter_block(create_block());
 
 		const auto create_varying_param = [this, &call_params](const struct_member_info &param) {
@@ -1926,12 +2023,14 @@ private:
 
 		return inst.result;
 	}
-	id   emit_call(const location &loc, id function, const type &res_type, const std::vector<expression> &args) override
+	id   emit_call(const location &loc, id function, const type &res_type, const expression_list &args) override
 	{
 #ifndef NDEBUG
 		for (const expression &arg : args)
 			assert(arg.chain.empty() && arg.base != 0);
 #endif
+		add_call_reference(function);
+
 		add_location(loc, *_current_block_data);
 
 		// https://www.khronos.org/registry/spir-v/specs/unified1/SPIRV.html#OpFunctionCall
@@ -1942,7 +2041,7 @@ private:
 
 		return inst.result;
 	}
-	id   emit_call_intrinsic(const location &loc, id intrinsic, const type &res_type, const std::vector<expression> &args) override
+	id   emit_call_intrinsic(const location &loc, id intrinsic, const type &res_type, const expression_list &args) override
 	{
 #ifndef NDEBUG
 		for (const expression &arg : args)
@@ -1964,7 +2063,7 @@ private:
 			return assert(false), 0;
 		}
 	}
-	id   emit_construct(const location &loc, const type &type, const std::vector<expression> &args) override
+	id   emit_construct(const location &loc, const type &type, const expression_list &args) override
 	{
 #ifndef NDEBUG
 		for (const expression &arg : args)
@@ -2243,7 +2342,7 @@ private:
 	}
 };
 
-codegen *reshadefx::create_codegen_spirv(bool vulkan_semantics, bool debug_info, bool uniforms_to_spec_constants, bool enable_16bit_types, bool flip_vert_y)
+codegen *reshadefx::create_codegen_spirv(bool vulkan_semantics, bool debug_info, bool uniforms_to_spec_constants, bool enable_16bit_types, bool flip_vert_y, bool discrete_uniforms_to_spec_constants)
 {
-	return new codegen_spirv(vulkan_semantics, debug_info, uniforms_to_spec_constants, enable_16bit_types, flip_vert_y);
+	return new codegen_spirv(vulkan_semantics, debug_info, uniforms_to_spec_constants, enable_16bit_types, flip_vert_y, discrete_uniforms_to_spec_constants);
 }
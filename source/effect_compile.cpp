@@ -0,0 +1,268 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "effect_compile.hpp"
+#include "com_ptr.hpp"
+#include <cstring>
+#include <string_view>
+#include <Windows.h>
+#include <d3dcompiler.h>
+
+uint64_t reshade::effect_cache_key(const std::filesystem::path &source_file, const std::string &entry_point, size_t hash, const char *type)
+{
+	return std::hash<std::string>()(source_file.stem().u8string() + '-' + entry_point + '-' + std::to_string(hash) + '.' + type);
+}
+uint64_t reshade::machine_cache_key(const std::string &entry_point, size_t hash, uint64_t compiler_version, const char *type)
+{
+	return std::hash<std::string>()(entry_point + '-' + std::to_string(hash) + '-' + std::to_string(compiler_version) + '.' + type);
+}
+uint64_t reshade::compiler_version(void *module)
+{
+	if (module == nullptr)
+		return 0;
+
+	const auto dos_header = static_cast<const IMAGE_DOS_HEADER *>(module);
+	const auto nt_headers = reinterpret_cast<const IMAGE_NT_HEADERS *>(static_cast<const char *>(module) + dos_header->e_lfanew);
+	return (static_cast<uint64_t>(nt_headers->FileHeader.TimeDateStamp) << 32) | nt_headers->OptionalHeader.SizeOfImage;
+}
+
+std::string reshade::extract_entry_point_code(const std::string &code, const std::string &entry_point_name, bool keep_line_numbers)
+{
+	const std::string entry_point_define = "ENTRY_POINT_" + entry_point_name;
+
+	std::string result;
+	result.reserve(code.size());
+
+	// Each open condition is either on an entry point definition (which is dropped from the result) or other code (which is kept), and whether the code in it is skipped
+	struct condition { bool on_entry_point, skipped; };
+	std::vector<condition> conditions;
+
+	for (size_t line_offset = 0; line_offset < code.size();)
+	{
+		size_t line_end = code.find('\n', line_offset);
+		if (line_end == std::string::npos)
+			line_end = code.size();
+
+		const std::string_view line(code.data() + line_offset, line_end - line_offset);
+		const std::string_view directive = line.substr(std::min(line.find_first_not_of(" \t"), line.size()));
+
+		const bool parent_skipped = !conditions.empty() && conditions.back().skipped;
+
+		bool keep_line = !parent_skipped;
+		if (directive.compare(0, 3, "#if") == 0)
+		{
+			condition &cond = conditions.emplace_back();
+			if (directive.compare(0, 19, "#ifdef ENTRY_POINT_") == 0)
+			{
+				cond.on_entry_point = true;
+				cond.skipped = parent_skipped || directive.substr(7) != entry_point_define;
+			}
+			else if (directive.compare(0, 24, "#if defined(ENTRY_POINT_") == 0)
+			{
+				cond.on_entry_point = true;
+				cond.skipped = parent_skipped || directive.find("defined(" + entry_point_define + ')') == std::string_view::npos;
+			}
+			else
+			{
+				cond.on_entry_point = false;
+				cond.skipped = parent_skipped;
+			}
+
+			keep_line = !parent_skipped && !cond.on_entry_point;
+		}
+		else if (directive.compare(0, 6, "#endif") == 0 && !conditions.empty())
+		{
+			const condition cond = conditions.back();
+			conditions.pop_back();
+
+			keep_line = !cond.skipped && !cond.on_entry_point;
+		}
+
+		if (keep_line)
+			result.append(line);
+		if (keep_line || keep_line_numbers)
+			result += '\n';
+
+		line_offset = line_end + 1;
+	}
+
+	return result;
+}
+
+unsigned int reshade::hlsl_shader_model(uint32_t renderer_id, bool dxil)
+{
+	if (renderer_id == 0x9000)
+		return 30; // D3D9
+	else if (renderer_id < 0xa100)
+		return 40; // D3D10 (including feature level 9)
+	else if (renderer_id < 0xb000)
+		return 41; // D3D10.1
+	else if (renderer_id < 0xc000)
+		return 50; // D3D11
+	else if (!dxil)
+		return 51; // D3D12
+	else
+		return 60; // D3D12 with DXIL
+}
+
+void reshade::append_spec_constant_definition(std::string &preamble, const reshadefx::uniform_info &constant)
+{
+	preamble += "#define SPEC_CONSTANT_" + constant.name + ' ';
+
+	for (unsigned int i = 0; i < constant.type.components(); ++i)
+	{
+		switch (constant.type.base)
+		{
+		case reshadefx::type::t_bool:
+			preamble += constant.initializer_value.as_uint[i] ? "true" : "false";
+			break;
+		case reshadefx::type::t_int:
+			preamble += std::to_string(constant.initializer_value.as_int[i]);
+			break;
+		case reshadefx::type::t_uint:
+			preamble += std::to_string(constant.initializer_value.as_uint[i]);
+			break;
+		case reshadefx::type::t_float:
+			preamble += std::to_string(constant.initializer_value.as_float[i]);
+			break;
+		}
+
+		if (i + 1 < constant.type.components())
+			preamble += ", ";
+	}
+
+	preamble += '\n';
+}
+std::string reshade::hlsl_compile_source(unsigned int width, unsigned int height, const std::string &preamble, const std::string &code)
+{
+	// Add specialization constant defines to source code
+	return
+		"#define COLOR_PIXEL_SIZE 1.0 / " + std::to_string(width) + ", 1.0 / " + std::to_string(height) + "\n"
+		"#define DEPTH_PIXEL_SIZE COLOR_PIXEL_SIZE\n"
+		"#define SV_DEPTH_PIXEL_SIZE DEPTH_PIXEL_SIZE\n"
+		"#define SV_TARGET_PIXEL_SIZE COLOR_PIXEL_SIZE\n"
+		"#line 1\n" + // Reset line number, so it matches what is shown when viewing the generated code
+		preamble +
+		code;
+}
+std::string reshade::hlsl_profile(uint32_t renderer_id, reshadefx::shader_type type, bool dxil)
+{
+	std::string profile;
+	switch (type)
+	{
+	case reshadefx::shader_type::vs:
+		profile = "vs";
+		break;
+	case reshadefx::shader_type::ps:
+		profile = "ps";
+		break;
+	case reshadefx::shader_type::cs:
+		profile = "cs";
+		break;
+	}
+
+	switch (dxil ? 0 : renderer_id)
+	{
+	case 0:
+		profile += "_6_0";
+		break;
+	default:
+	case D3D_FEATURE_LEVEL_11_0:
+		profile += "_5_0";
+		break;
+	case D3D_FEATURE_LEVEL_10_1:
+		profile += "_4_1";
+		break;
+	case D3D_FEATURE_LEVEL_10_0:
+		profile += "_4_0";
+		break;
+	case D3D_FEATURE_LEVEL_9_1:
+	case D3D_FEATURE_LEVEL_9_2:
+		profile += "_4_0_level_9_1";
+		break;
+	case D3D_FEATURE_LEVEL_9_3:
+		profile += "_4_0_level_9_3";
+		break;
+	case 0x9000:
+		profile += "_3_0";
+		break;
+	}
+
+	return profile;
+}
+uint32_t reshade::hlsl_compile_flags(uint32_t renderer_id, bool performance_mode, bool debug_info, bool dxil)
+{
+	uint32_t compile_flags = (performance_mode ? D3DCOMPILE_OPTIMIZATION_LEVEL3 : D3DCOMPILE_OPTIMIZATION_LEVEL1);
+	if (renderer_id >= D3D_FEATURE_LEVEL_10_0)
+		compile_flags |= D3DCOMPILE_ENABLE_STRICTNESS;
+	// Debug information adds '#line' directives to the DXBC disassembly, which the code editor uses to show how many instructions each line of code results in (it is stripped from the compiled code again after disassembling)
+	if (debug_info && !dxil)
+		compile_flags |= D3DCOMPILE_DEBUG;
+#ifndef NDEBUG
+	compile_flags |= D3DCOMPILE_DEBUG;
+#endif
+	return compile_flags;
+}
+size_t reshade::hlsl_compile_hash(const std::string &hlsl, const std::string &entry_point_name, const std::string &profile, uint32_t compile_flags)
+{
+	std::string attributes;
+	attributes += "entrypoint=" + entry_point_name + ';';
+	attributes += "profile=" + profile + ';';
+	attributes += "flags=" + std::to_string(compile_flags) + ';';
+
+	// The line numbers of this code are part of the compiled result only through '#line' directives, so can drop lines of code used by other entry points instead of keeping them empty
+	return std::hash<std::string_view>()(attributes) ^ std::hash<std::string>()(extract_entry_point_code(hlsl, entry_point_name, false));
+}
+
+bool reshade::compile_hlsl_dxbc(void *d3d_compiler, const std::string &hlsl, const std::string &entry_point_name, reshadefx::shader_type type, const std::string &profile, uint32_t compile_flags, std::vector<char> &cso, std::string &assembly, std::string &errors)
+{
+	const auto D3DCompile = reinterpret_cast<pD3DCompile>(GetProcAddress(static_cast<HMODULE>(d3d_compiler), "D3DCompile"));
+	const auto D3DDisassemble = reinterpret_cast<pD3DDisassemble>(GetProcAddress(static_cast<HMODULE>(d3d_compiler), "D3DDisassemble"));
+	const auto D3DStripShader = reinterpret_cast<HRESULT(WINAPI *)(LPCVOID, SIZE_T, UINT, ID3DBlob **)>(GetProcAddress(static_cast<HMODULE>(d3d_compiler), "D3DStripShader"));
+	if (D3DCompile == nullptr || D3DDisassemble == nullptr)
+		return false;
+
+	// Code generation encloses functions that are only used by some entry points in conditions on this define
+	const std::string entry_point_define = "ENTRY_POINT_" + entry_point_name;
+
+	const D3D_SHADER_MACRO defines[] = {
+		{ entry_point_define.c_str(), "1" },
+		// Overwrite position semantic in pixel shaders
+		{ type == reshadefx::shader_type::ps ? "POSITION" : nullptr, "VPOS" },
+		{ nullptr, nullptr }
+	};
+
+	com_ptr<ID3DBlob> d3d_compiled, d3d_errors;
+	const HRESULT hr = D3DCompile(
+		hlsl.data(), hlsl.size(),
+		nullptr, defines, nullptr,
+		entry_point_name.c_str(),
+		profile.c_str(),
+		compile_flags, 0,
+		&d3d_compiled, &d3d_errors);
+
+	if (d3d_errors != nullptr) // Keep warnings to append them to the output error string as well
+		errors.assign(static_cast<const char *>(d3d_errors->GetBufferPointer()), d3d_errors->GetBufferSize() - 1); // Subtracting one to not append the null-terminator as well
+
+	if (FAILED(hr))
+		return false;
+
+	cso.resize(d3d_compiled->GetBufferSize());
+	std::memcpy(cso.data(), d3d_compiled->GetBufferPointer(), cso.size());
+
+	if (com_ptr<ID3DBlob> d3d_disassembled; SUCCEEDED(D3DDisassemble(cso.data(), cso.size(), 0, nullptr, &d3d_disassembled)))
+		assembly.assign(static_cast<const char *>(d3d_disassembled->GetBufferPointer()), d3d_disassembled->GetBufferSize() - 1);
+
+#ifdef NDEBUG
+	// Debug information is only needed for the disassembly above, so remove it to keep the compiled code small
+	if (com_ptr<ID3DBlob> d3d_stripped; (compile_flags & D3DCOMPILE_DEBUG) != 0 && D3DStripShader != nullptr && SUCCEEDED(D3DStripShader(cso.data(), cso.size(), D3DCOMPILER_STRIP_DEBUG_INFO, &d3d_stripped)))
+	{
+		cso.resize(d3d_stripped->GetBufferSize());
+		std::memcpy(cso.data(), d3d_stripped->GetBufferPointer(), cso.size());
+	}
+#endif
+
+	return true;
+}
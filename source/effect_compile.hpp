@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include "effect_module.hpp"
+#include <filesystem>
+
+namespace reshade
+{
+	/// <summary>
+	/// Gets the key an entry of the effect cache of an installation is stored under.
+	/// </summary>
+	/// <param name="source_file">The effect file the entry belongs to (only its name is part of the key).</param>
+	/// <param name="entry_point">The entry point the entry belongs to, or an empty string for entries that belong to the whole effect.</param>
+	/// <param name="hash">The hash of whatever input produced the entry.</param>
+	/// <param name="type">The kind of entry (e.g. "cso" or "asm").</param>
+	uint64_t effect_cache_key(const std::filesystem::path &source_file, const std::string &entry_point, size_t hash, const char *type);
+	/// <summary>
+	/// Gets the key an entry of the machine-wide effect cache is stored under, which only depends on the content, so that identical shaders in different installations share it.
+	/// </summary>
+	/// <param name="compiler_version">The build of the compiler that produced the entry (see <see cref="compiler_version"/>).</param>
+	uint64_t machine_cache_key(const std::string &entry_point, size_t hash, uint64_t compiler_version, const char *type);
+	/// <summary>
+	/// Identifies the build of the loaded compiler library <paramref name="module"/> through its image header, since different builds can produce different code for the same input.
+	/// </summary>
+	uint64_t compiler_version(void *module);
+
+	/// <summary>
+	/// Resolves the conditions on "ENTRY_POINT_" definitions that the code generator encloses code only used by some entry points in, so that a driver only has to parse the code used by the specified entry point.
+	/// </summary>
+	/// <param name="keep_line_numbers">Set to <see langword="true"/> to replace removed lines with empty ones, so that line numbers in compiler errors still match the full generated code.</param>
+	std::string extract_entry_point_code(const std::string &code, const std::string &entry_point_name, bool keep_line_numbers = true);
+
+	/// <summary>
+	/// Conversion macros for compatibility with older versions of ReShade, which are added in front of the source code of every effect.
+	/// </summary>
+	constexpr char compatibility_macro_definitions[] =
+		"#define tex2Doffset(s, coords, offset) tex2D(s, coords, offset)\n"
+		"#define tex2Dlodoffset(s, coords, offset) tex2Dlod(s, coords, offset)\n"
+		"#define tex2Dgather(s, t, c) tex2Dgather##c(s, t)\n"
+		"#define tex2Dgatheroffset(s, t, o, c) tex2Dgather##c(s, t, o)\n"
+		"#define tex2Dgather0 tex2DgatherR\n"
+		"#define tex2Dgather1 tex2DgatherG\n"
+		"#define tex2Dgather2 tex2DgatherB\n"
+		"#define tex2Dgather3 tex2DgatherA\n";
+
+	/// <summary>
+	/// Gets the HLSL shader model the code generator targets for a renderer.
+	/// </summary>
+	/// <param name="renderer_id">The renderer identifier (the D3D feature level for D3D10 and later).</param>
+	/// <param name="dxil">Set to <see langword="true"/> when compiling with the DirectX Shader Compiler.</param>
+	unsigned int hlsl_shader_model(uint32_t renderer_id, bool dxil);
+
+	/// <summary>
+	/// Appends a definition of the value of the specified specialization <paramref name="constant"/> (taken from its initializer) to <paramref name="preamble"/>, which is put in front of the generated code.
+	/// </summary>
+	void append_spec_constant_definition(std::string &preamble, const reshadefx::uniform_info &constant);
+	/// <summary>
+	/// Builds the HLSL code that is passed to the compiler for every entry point of an effect, from the code the code generator wrote and the values of its specialization constants.
+	/// </summary>
+	/// <param name="width">The width of the back buffer.</param>
+	/// <param name="height">The height of the back buffer.</param>
+	/// <param name="preamble">Definitions of the specialization constants of the effect.</param>
+	/// <param name="code">The HLSL code the code generator wrote.</param>
+	std::string hlsl_compile_source(unsigned int width, unsigned int height, const std::string &preamble, const std::string &code);
+	/// <summary>
+	/// Gets the HLSL profile entry points of the specified <paramref name="type"/> are compiled with for a renderer.
+	/// </summary>
+	std::string hlsl_profile(uint32_t renderer_id, reshadefx::shader_type type, bool dxil);
+	/// <summary>
+	/// Gets the flags entry points are compiled with for a renderer.
+	/// </summary>
+	uint32_t hlsl_compile_flags(uint32_t renderer_id, bool performance_mode, bool debug_info, bool dxil);
+	/// <summary>
+	/// Gets the hash compiled entry points are addressed by in the effect cache.
+	/// Only the code the entry point actually uses is hashed, so that editing one shader does not invalidate the cache of every other shader in the effect too.
+	/// </summary>
+	/// <param name="hlsl">The HLSL code of the effect (see <see cref="hlsl_compile_source"/>).</param>
+	size_t hlsl_compile_hash(const std::string &hlsl, const std::string &entry_point_name, const std::string &profile, uint32_t compile_flags);
+
+	/// <summary>
+	/// Compiles an entry point of the HLSL code of an effect to DXBC with the D3DCompiler library.
+	/// </summary>
+	/// <param name="d3d_compiler">Handle to the loaded "d3dcompiler_47.dll" (or "d3dcompiler_43.dll").</param>
+	/// <param name="hlsl">The HLSL code of the effect (see <see cref="hlsl_compile_source"/>).</param>
+	/// <param name="cso">Receives the compiled code.</param>
+	/// <param name="assembly">Receives the disassembly of the compiled code.</param>
+	/// <param name="errors">Receives any warnings and errors the compiler reported.</param>
+	/// <returns><see langword="true"/> if the entry point was compiled successfully, <see langword="false"/> otherwise.</returns>
+	bool compile_hlsl_dxbc(void *d3d_compiler, const std::string &hlsl, const std::string &entry_point_name, reshadefx::shader_type type, const std::string &profile, uint32_t compile_flags, std::vector<char> &cso, std::string &assembly, std::string &errors);
+}
@@ -7,9 +7,60 @@
 #include "effect_codegen.hpp"
 #include <cmath> // fmod
 #include <cassert>
+#include <cstddef> // std::max_align_t
 #include <cstring> // memcpy, memset
 #include <algorithm> // std::min, std::max
 
+// Arena used for allocations of temporary parser data on the current thread (see 'arena_allocator')
+static thread_local reshadefx::arena *t_current_arena = nullptr;
+
+// Most effects fit their temporary data into a few blocks of this size
+static constexpr size_t ARENA_BLOCK_SIZE = 64 * 1024;
+
+reshadefx::arena::scope::scope(arena &arena) : _previous(t_current_arena)
+{
+	t_current_arena = &arena;
+}
+reshadefx::arena::scope::~scope()
+{
+	t_current_arena = _previous;
+}
+
+reshadefx::arena *reshadefx::arena::current()
+{
+	return t_current_arena;
+}
+
+void *reshadefx::arena::allocate(size_t size, size_t alignment)
+{
+	assert(alignment != 0 && (alignment & (alignment - 1)) == 0 && alignment <= alignof(std::max_align_t));
+
+	for (; _block_index < _blocks.size(); ++_block_index, _block_offset = 0)
+	{
+		block &current_block = _blocks[_block_index];
+
+		const size_t offset = (_block_offset + alignment - 1) & ~(alignment - 1);
+		if (offset + size <= current_block.size)
+		{
+			_block_offset = offset + size;
+			return current_block.data.get() + offset;
+		}
+	}
+
+	// Allocations that are larger than a block get a block of their own
+	const size_t block_size = std::max(size, ARENA_BLOCK_SIZE);
+	_blocks.push_back({ std::unique_ptr<char[]>(new char[block_size]), block_size });
+
+	_block_index = _blocks.size() - 1;
+	_block_offset = size;
+	return _blocks.back().data.get();
+}
+void reshadefx::arena::reset()
+{
+	_block_index = 0;
+	_block_offset = 0;
+}
+
 reshadefx::type reshadefx::type::merge(const type &lhs, const type &rhs)
 {
 	type result = { std::max(lhs.base, rhs.base) };
@@ -6,9 +6,92 @@
 #pragma once
 
 #include "effect_token.hpp"
+#include <memory>
 
 namespace reshadefx
 {
+	/// <summary>
+	/// A monotonic memory arena for short-lived data created while parsing, which releases all its allocations at once instead of one by one.
+	/// </summary>
+	class arena
+	{
+	public:
+		/// <summary>
+		/// Makes an arena the active one on the calling thread for the lifetime of this object.
+		/// </summary>
+		class scope
+		{
+		public:
+			explicit scope(arena &arena);
+			~scope();
+
+		private:
+			arena *_previous;
+		};
+
+		arena() = default;
+		arena(const arena &) = delete;
+		arena &operator=(const arena &) = delete;
+
+		/// <summary>
+		/// Gets the arena that is active on the calling thread, or <see langword="nullptr"/> if allocations should go to the heap.
+		/// </summary>
+		static arena *current();
+
+		void *allocate(size_t size, size_t alignment);
+		/// <summary>
+		/// Releases all allocations at once, but keeps the memory blocks around for reuse.
+		/// </summary>
+		void reset();
+
+	private:
+		struct block
+		{
+			std::unique_ptr<char[]> data;
+			size_t size;
+		};
+
+		std::vector<block> _blocks;
+		size_t _block_index = 0;
+		size_t _block_offset = 0;
+	};
+
+	/// <summary>
+	/// An allocator that takes memory from the arena that was active on the calling thread when it was constructed, or from the heap if there was none.
+	/// Memory from an arena is not freed individually, but only when that arena is reset.
+	/// </summary>
+	template <typename T>
+	struct arena_allocator
+	{
+		using value_type = T;
+		using propagate_on_container_copy_assignment = std::true_type;
+		using propagate_on_container_move_assignment = std::true_type;
+		using propagate_on_container_swap = std::true_type;
+
+		arena_allocator() : source(arena::current()) {}
+		template <typename U>
+		arena_allocator(const arena_allocator<U> &other) : source(other.source) {}
+
+		T *allocate(size_t n)
+		{
+			if (source != nullptr)
+				return static_cast<T *>(source->allocate(n * sizeof(T), alignof(T)));
+			return std::allocator<T>().allocate(n);
+		}
+		void deallocate(T *p, size_t n)
+		{
+			if (source == nullptr)
+				std::allocator<T>().deallocate(p, n);
+		}
+
+		template <typename U>
+		bool operator==(const arena_allocator<U> &rhs) const { return source == rhs.source; }
+		template <typename U>
+		bool operator!=(const arena_allocator<U> &rhs) const { return source != rhs.source; }
+
+		arena *source;
+	};
+
 	/// <summary>
 	/// Structure which encapsulates a parsed value type
 	/// </summary>
@@ -147,7 +230,7 @@ namespace reshadefx
 		bool is_lvalue = false;
 		bool is_constant = false;
 		reshadefx::location location;
-		std::vector<operation> chain;
+		std::vector<operation, arena_allocator<operation>> chain;
 
 		/// <summary>
 		/// Initialize the expression to a l-value.
@@ -216,4 +299,9 @@ namespace reshadefx
 		/// <param name="rhs">The constant to use as right-hand side of the binary operation.</param>
 		bool evaluate_constant_expression(reshadefx::tokenid op, const reshadefx::constant &rhs);
 	};
+
+	/// <summary>
+	/// A list of expressions, like the arguments to a function call.
+	/// </summary>
+	using expression_list = std::vector<expression, arena_allocator<expression>>;
 }
@@ -4,9 +4,23 @@
  */
 
 #include "effect_lexer.hpp"
+#include <set>
+#include <mutex>
 #include <cassert>
+#include <algorithm>
+#include <string_view>
 #include <unordered_map> // Used for static lookup tables
 
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+	#define LEXER_SSE2 1
+	#include <emmintrin.h>
+	#ifdef _MSC_VER
+	#include <intrin.h>
+	#endif
+#else
+	#define LEXER_SSE2 0
+#endif
+
 using namespace reshadefx;
 
 enum token_type
@@ -198,7 +212,72 @@ static const std::unordered_map<tokenid, std::string> token_lookup = {
 	{ tokenid::sampler, "sampler" },
 	{ tokenid::storage, "storage" },
 };
-static const std::unordered_map<std::string, tokenid> keyword_lookup = {
+
+// Keywords and preprocessor directives are looked up in hash tables that are built at compile time
+// They are keyed directly on the characters of an identifier in the input, so no string has to be constructed or hashed at run time to check whether an identifier is a keyword
+struct keyword_info
+{
+	std::string_view name;
+	tokenid id = tokenid::unknown;
+};
+
+static constexpr uint32_t keyword_hash(std::string_view name)
+{
+	uint32_t hash = 2166136261u; // FNV-1a
+	for (const char c : name)
+		hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+	return hash;
+}
+
+/// <summary>
+/// An open addressing hash table with linear probing, which is filled in a constant expression.
+/// Lookups give up after the longest probe sequence any keyword needed, so checking an identifier that is not a keyword only touches a few entries.
+/// </summary>
+template <size_t TABLE_SIZE>
+class keyword_table
+{
+	static_assert((TABLE_SIZE & (TABLE_SIZE - 1)) == 0, "table size has to be a power of two");
+
+public:
+	template <size_t N>
+	constexpr explicit keyword_table(const keyword_info (&keywords)[N]) : _entries(), _max_probes(0)
+	{
+		static_assert(N <= TABLE_SIZE / 2, "table is too small for the number of keywords");
+
+		for (const keyword_info &keyword : keywords)
+		{
+			size_t index = keyword_hash(keyword.name) & (TABLE_SIZE - 1);
+			size_t probes = 1;
+			for (; !_entries[index].name.empty(); ++probes)
+				index = (index + 1) & (TABLE_SIZE - 1);
+
+			_entries[index] = keyword;
+			_max_probes = std::max(_max_probes, probes);
+		}
+	}
+
+	constexpr size_t max_probes() const { return _max_probes; }
+
+	bool find(std::string_view name, tokenid &id) const
+	{
+		size_t index = keyword_hash(name) & (TABLE_SIZE - 1);
+		for (size_t probes = 0; probes < _max_probes && !_entries[index].name.empty(); ++probes, index = (index + 1) & (TABLE_SIZE - 1))
+		{
+			if (_entries[index].name == name)
+			{
+				id = _entries[index].id;
+				return true;
+			}
+		}
+		return false;
+	}
+
+private:
+	keyword_info _entries[TABLE_SIZE];
+	size_t _max_probes;
+};
+
+static constexpr keyword_info keyword_list[] = {
 	{ "asm", tokenid::reserved },
 	{ "asm_fragment", tokenid::reserved },
 	{ "auto", tokenid::reserved },
@@ -281,18 +360,18 @@ static const std::unordered_map<std::string, tokenid> keyword_lookup = {
 	{ "globallycoherent", tokenid::reserved },
 	{ "goto", tokenid::reserved },
 	{ "groupshared", tokenid::groupshared },
-	{ "half", tokenid::reserved },
-	{ "half2", tokenid::reserved },
+	{ "half", tokenid::min16float },
+	{ "half2", tokenid::min16float2 },
 	{ "half2x1", tokenid::reserved },
 	{ "half2x2", tokenid::reserved },
 	{ "half2x3", tokenid::reserved },
 	{ "half2x4", tokenid::reserved },
-	{ "half3", tokenid::reserved },
+	{ "half3", tokenid::min16float3 },
 	{ "half3x1", tokenid::reserved },
 	{ "half3x2", tokenid::reserved },
 	{ "half3x3", tokenid::reserved },
 	{ "half3x4", tokenid::reserved },
-	{ "half4", tokenid::reserved },
+	{ "half4", tokenid::min16float4 },
 	{ "half4x1", tokenid::reserved },
 	{ "half4x2", tokenid::reserved },
 	{ "half4x3", tokenid::reserved },
@@ -432,7 +511,10 @@ static const std::unordered_map<std::string, tokenid> keyword_lookup = {
 	{ "volatile", tokenid::volatile_ },
 	{ "while", tokenid::while_ }
 };
-static const std::unordered_map<std::string, tokenid> pp_directive_lookup = {
+static constexpr keyword_table<1024> keyword_lookup(keyword_list);
+static_assert(keyword_lookup.max_probes() <= 4, "keyword hash has too many collisions");
+
+static constexpr keyword_info pp_directive_list[] = {
 	{ "define", tokenid::hash_def },
 	{ "undef", tokenid::hash_undef },
 	{ "if", tokenid::hash_if },
@@ -446,6 +528,46 @@ static const std::unordered_map<std::string, tokenid> pp_directive_lookup = {
 	{ "pragma", tokenid::hash_pragma },
 	{ "include", tokenid::hash_include },
 };
+static constexpr keyword_table<32> pp_directive_lookup(pp_directive_list);
+static_assert(pp_directive_lookup.max_probes() <= 4, "preprocessor directive hash has too many collisions");
+
+#if LEXER_SSE2
+// Long runs of white space, comments and identifiers are scanned in blocks of 16 characters, with the scalar loops only handling the remainder near the end of the input
+static inline unsigned int first_set_bit(unsigned int mask)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+static inline __m128i load_block(const char *p)
+{
+	return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+
+// These return a bit mask with a bit set for every character in a block that does not match the respective type in 'type_lookup'
+static inline unsigned int non_space_mask(__m128i block)
+{
+	// Matches ' ', '\t' and '\v', '\f', '\r' (but not '\n', which has its own type)
+	const __m128i space = _mm_or_si128(
+		_mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(block, _mm_set1_epi8('\t'))),
+		_mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8('\n')), _mm_cmplt_epi8(block, _mm_set1_epi8('\r' + 1))));
+	return ~static_cast<unsigned int>(_mm_movemask_epi8(space)) & 0xFFFF;
+}
+static inline unsigned int non_identifier_mask(__m128i block)
+{
+	// Setting the lower case bit maps upper case letters to lower case ones, without mapping any other character into that range (characters outside ASCII compare as negative)
+	const __m128i lower = _mm_or_si128(block, _mm_set1_epi8(0x20));
+	const __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+	const __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(block, _mm_set1_epi8('9' + 1)));
+	const __m128i underscore = _mm_cmpeq_epi8(block, _mm_set1_epi8('_'));
+	return ~static_cast<unsigned int>(_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(letter, digit), underscore))) & 0xFFFF;
+}
+#endif
 
 static inline bool is_octal_digit(char c)
 {
@@ -495,6 +617,24 @@ static long long octal_to_decimal(long long n)
 	return n;
 }
 
+std::string_view reshadefx::intern_source_name(std::string_view name)
+{
+	if (name.empty())
+		return {};
+
+	// Names are only ever added, so views into the set nodes remain valid even while other threads insert
+	static std::mutex s_mutex;
+	static std::set<std::string, std::less<>> s_names;
+
+	const std::lock_guard<std::mutex> lock(s_mutex);
+
+	auto it = s_names.find(name);
+	if (it == s_names.end())
+		it = s_names.emplace(name).first;
+
+	return *it;
+}
+
 std::string reshadefx::token::id_to_name(tokenid id)
 {
 	const auto it = token_lookup.find(id);
@@ -648,6 +788,20 @@ next_token:
 		{
 			while (_cur < _end)
 			{
+#if LEXER_SSE2
+				// Skip ahead to the next character that can end the comment or a line
+				for (unsigned int mask; _end - _cur >= 16; skip(16))
+				{
+					const __m128i block = load_block(_cur);
+					if ((mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('*')), _mm_cmpeq_epi8(block, _mm_set1_epi8('\n'))))) != 0)
+					{
+						skip(first_set_bit(mask));
+						break;
+					}
+				}
+				if (_cur >= _end)
+					break;
+#endif
 				if (*_cur == '\n')
 				{
 					_cur_location.line++;
@@ -775,12 +929,34 @@ void reshadefx::lexer::skip(size_t length)
 }
 void reshadefx::lexer::skip_space()
 {
+#if LEXER_SSE2
+	for (unsigned int mask; _end - _cur >= 16; skip(16))
+	{
+		if ((mask = non_space_mask(load_block(_cur))) != 0)
+		{
+			skip(first_set_bit(mask));
+			return;
+		}
+	}
+#endif
+
 	// Skip each character until a space is found
 	while (type_lookup[uint8_t(*_cur)] == SPACE && _cur < _end)
 		skip(1);
 }
 void reshadefx::lexer::skip_to_next_line()
 {
+#if LEXER_SSE2
+	for (unsigned int mask; _end - _cur >= 16; skip(16))
+	{
+		if ((mask = _mm_movemask_epi8(_mm_cmpeq_epi8(load_block(_cur), _mm_set1_epi8('\n')))) != 0)
+		{
+			skip(first_set_bit(mask));
+			return;
+		}
+	}
+#endif
+
 	// Skip each character until a new line feed is found
 	while (*_cur != '\n' && _cur < _end)
 		skip(1);
@@ -797,7 +973,19 @@ void reshadefx::lexer::parse_identifier(token &tok) const
 	auto *const begin = _cur, *end = begin;
 
 	// Skip to the end of the identifier sequence
-	do end++; while (type_lookup[uint8_t(*end)] == IDENT || type_lookup[uint8_t(*end)] == DIGIT);
+	end++;
+#if LEXER_SSE2
+	for (unsigned int mask; _end - end >= 16; end += 16)
+	{
+		if ((mask = non_identifier_mask(load_block(end))) != 0)
+		{
+			end += first_set_bit(mask);
+			break;
+		}
+	}
+#endif
+	while (type_lookup[uint8_t(*end)] == IDENT || type_lookup[uint8_t(*end)] == DIGIT)
+		end++;
 
 	tok.id = tokenid::identifier;
 	tok.offset = input_offset();
@@ -807,9 +995,7 @@ void reshadefx::lexer::parse_identifier(token &tok) const
 	if (_ignore_keywords)
 		return;
 
-	if (const auto it = keyword_lookup.find(tok.literal_as_string);
-		it != keyword_lookup.end())
-		tok.id = it->second;
+	keyword_lookup.find(std::string_view(begin, end - begin), tok.id);
 }
 bool reshadefx::lexer::parse_pp_directive(token &tok)
 {
@@ -817,12 +1003,8 @@ bool reshadefx::lexer::parse_pp_directive(token &tok)
 	skip_space(); // Skip any space between the '#' and directive
 	parse_identifier(tok);
 
-	if (const auto it = pp_directive_lookup.find(tok.literal_as_string);
-		it != pp_directive_lookup.end())
-	{
-		tok.id = it->second;
+	if (pp_directive_lookup.find(tok.literal_as_string, tok.id))
 		return true;
-	}
 	else if (!_ignore_line_directives && tok.literal_as_string == "line") // The #line directive needs special handling
 	{
 		skip(tok.length); // The 'parse_identifier' does not update the pointer to the current character, so do that now
@@ -844,7 +1026,7 @@ bool reshadefx::lexer::parse_pp_directive(token &tok)
 			token temptok;
 			parse_string_literal(temptok, false);
 
-			_cur_location.source = std::move(temptok.literal_as_string);
+			_cur_location.source = intern_source_name(temptok.literal_as_string);
 		}
 
 		// Do not return the #line directive as token to the caller
@@ -242,6 +242,8 @@ namespace reshadefx
 	{
 		std::string name;
 		shader_type type;
+		// SPIR-V module that only contains this entry point and the code it uses (only filled in by the SPIR-V code generator)
+		std::vector<uint32_t> spirv;
 	};
 
 	/// <summary>
@@ -276,6 +278,7 @@ namespace reshadefx
 		uint8_t color_write_mask = 0xF;
 		uint8_t stencil_read_mask = 0xFF;
 		uint8_t stencil_write_mask = 0xFF;
+		uint8_t shading_rate = 0; // Encoded as '(log2(width) << 2) | log2(height)', see 'reshade::api::dynamic_state::shading_rate'
 		pass_blend_op blend_op = pass_blend_op::add;
 		pass_blend_op blend_op_alpha = pass_blend_op::add;
 		pass_blend_func src_blend = pass_blend_func::one;
@@ -292,6 +295,7 @@ namespace reshadefx
 		uint32_t viewport_width = 0;
 		uint32_t viewport_height = 0;
 		uint32_t viewport_dispatch_z = 1;
+		std::string scissor_rect_uniform;
 		std::vector<sampler_info> samplers;
 		std::vector<storage_info> storages;
 	};
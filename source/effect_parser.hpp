@@ -83,5 +83,7 @@ namespace reshadefx
 		std::vector<uint32_t> _loop_break_target_stack;
 		std::vector<uint32_t> _loop_continue_target_stack;
 		reshadefx::function_info *_current_function = nullptr;
+		// Memory for temporary expressions and argument lists, which is released in one go when the next parse starts
+		reshadefx::arena _arena;
 	};
 }
@@ -582,7 +582,7 @@ bool reshadefx::parser::parse_expression_unary(expression &exp)
 	else if (accept('{'))
 	{
 		bool is_constant = true;
-		std::vector<expression> elements;
+		expression_list elements;
 		type composite_type = { type::t_void, 1, 1 };
 
 		while (!peek('}'))
@@ -692,7 +692,7 @@ bool reshadefx::parser::parse_expression_unary(expression &exp)
 		// Parse entire argument expression list
 		bool is_constant = true;
 		unsigned int num_components = 0;
-		std::vector<expression> arguments;
+		expression_list arguments;
 
 		while (!peek(')'))
 		{
@@ -797,7 +797,7 @@ bool reshadefx::parser::parse_expression_unary(expression &exp)
 				return error(location, 3005, "identifier '" + identifier + "' represents a variable, not a function"), false;
 
 			// Parse entire argument expression list
-			std::vector<expression> arguments;
+			expression_list arguments;
 
 			while (!peek(')'))
 			{
@@ -834,7 +834,7 @@ bool reshadefx::parser::parse_expression_unary(expression &exp)
 
 			assert(symbol.function != nullptr);
 
-			std::vector<expression> parameters(arguments.size());
+			expression_list parameters(arguments.size());
 
 			// We need to allocate some temporary variables to pass in and load results from pointer parameters
 			for (size_t i = 0; i < arguments.size(); ++i)
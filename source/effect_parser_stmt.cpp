@@ -19,6 +19,10 @@ struct on_scope_exit
 
 bool reshadefx::parser::parse(std::string input, codegen *backend)
 {
+	// No expressions from a previous parse can still be alive at this point, so their memory can be reused
+	_arena.reset();
+	const arena::scope arena_scope(_arena);
+
 	_lexer.reset(new lexer(std::move(input)));
 
 	// Set backend for subsequent code-generation
@@ -1545,9 +1549,10 @@ bool reshadefx::parser::parse_technique_pass(pass_info &info)
 
 		const bool is_shader_state = state == "VertexShader" || state == "PixelShader" || state == "ComputeShader";
 		const bool is_texture_state = state.compare(0, 12, "RenderTarget") == 0 && (state.size() == 12 || (state[12] >= '0' && state[12] < '8'));
+		const bool is_uniform_state = state == "ScissorRect";
 
-		// Shader and render target assignment looks up values in the symbol table, so handle those separately from the other states
-		if (is_shader_state || is_texture_state)
+		// Shader, render target and scissor assignment looks up values in the symbol table, so handle those separately from the other states
+		if (is_shader_state || is_texture_state || is_uniform_state)
 		{
 			std::string identifier;
 			scoped_symbol symbol;
@@ -1621,6 +1626,18 @@ bool reshadefx::parser::parse_technique_pass(pass_info &info)
 						}
 					}
 				}
+				else if (is_uniform_state)
+				{
+					if (!symbol.id)
+						parse_success = false,
+						error(location, 3004, "undeclared identifier '" + identifier + "', expected uniform name");
+					else if (!symbol.type.has(type::q_uniform) || !symbol.type.is_numeric() || !symbol.type.is_vector() || symbol.type.rows != 4 || symbol.type.is_array())
+						parse_success = false,
+						error(location, 3020, "type mismatch, expected four-component uniform vector");
+					else
+						// Uniforms are identified by their unqualified name
+						info.scissor_rect_uniform = identifier.substr(identifier.rfind(':') + 1);
+				}
 				else
 				{
 					assert(is_texture_state);
@@ -1707,6 +1724,13 @@ bool reshadefx::parser::parse_technique_pass(pass_info &info)
 					{ "TRIANGLES", uint32_t(primitive_topology::triangle_list) },
 					{ "TRIANGLELIST", uint32_t(primitive_topology::triangle_list) },
 					{ "TRIANGLESTRIP", uint32_t(primitive_topology::triangle_strip) },
+					{ "RATE_1X1", 0x0 },
+					{ "RATE_1X2", 0x1 },
+					{ "RATE_2X1", 0x4 },
+					{ "RATE_2X2", 0x5 },
+					{ "RATE_2X4", 0x6 },
+					{ "RATE_4X2", 0x9 },
+					{ "RATE_4X4", 0xA },
 				};
 
 				// Look up identifier in list of possible enumeration names
@@ -1768,6 +1792,12 @@ bool reshadefx::parser::parse_technique_pass(pass_info &info)
 				info.num_vertices = value;
 			else if (state == "PrimitiveType" || state == "PrimitiveTopology")
 				info.topology = static_cast<primitive_topology>(value);
+			else if (state == "ShadingRate")
+				if (value == 0x0 || value == 0x1 || value == 0x4 || value == 0x5 || value == 0x6 || value == 0x9 || value == 0xA)
+					info.shading_rate = static_cast<uint8_t>(value);
+				else
+					parse_success = false,
+					error(expression.location, 3020, "invalid shading rate, expected one of RATE_1X1, RATE_1X2, RATE_2X1, RATE_2X2, RATE_2X4, RATE_4X2 or RATE_4X4");
 			else if (state == "DispatchSizeX")
 				info.viewport_width = value;
 			else if (state == "DispatchSizeY")
@@ -1797,6 +1827,10 @@ bool reshadefx::parser::parse_technique_pass(pass_info &info)
 				warning(pass_location, 3089, "pass is specifying both 'VertexShader' and 'ComputeShader' which cannot be used together");
 			if (!info.ps_entry_point.empty())
 				warning(pass_location, 3089,  "pass is specifying both 'PixelShader' and 'ComputeShader' which cannot be used together");
+			if (!info.scissor_rect_uniform.empty())
+				warning(pass_location, 3089, "pass is specifying 'ScissorRect' which has no effect on 'ComputeShader'");
+			if (info.shading_rate != 0)
+				warning(pass_location, 3089, "pass is specifying 'ShadingRate' which has no effect on 'ComputeShader'");
 
 			for (codegen::id id : cs_info.referenced_samplers)
 				info.samplers.push_back(_codegen->find_sampler(id));
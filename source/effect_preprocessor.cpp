@@ -5,6 +5,7 @@
 
 #include "effect_lexer.hpp"
 #include "effect_preprocessor.hpp"
+#include <mutex>
 #include <cassert>
 #include <algorithm> // std::find_if
 
@@ -98,6 +99,98 @@ static bool read_file(const std::filesystem::path &path, std::string &data)
 	return true;
 }
 
+// Included files are shared between all preprocessor instances, so that common headers are only read once when many effects are preprocessed in parallel
+static std::mutex s_include_cache_mutex;
+static std::unordered_map<std::string, std::pair<std::filesystem::file_time_type, std::shared_ptr<const std::string>>> s_include_cache;
+
+static std::shared_ptr<const std::string> read_file_cached(const std::filesystem::path &path, const std::string &path_string)
+{
+	// The cached contents are only valid as long as the file was not modified since
+	std::error_code ec;
+	const std::filesystem::file_time_type last_write_time = std::filesystem::last_write_time(path, ec);
+	if (ec)
+		return nullptr;
+
+	{	const std::lock_guard<std::mutex> lock(s_include_cache_mutex);
+
+		if (const auto it = s_include_cache.find(path_string);
+			it != s_include_cache.end() && it->second.first == last_write_time)
+			return it->second.second;
+	}
+
+	// Read outside the lock, so that other threads are not blocked by file operations (in the worst case a file is read twice)
+	std::string data;
+	if (!read_file(path, data))
+		return nullptr;
+
+	auto shared_data = std::make_shared<const std::string>(std::move(data));
+
+	{	const std::lock_guard<std::mutex> lock(s_include_cache_mutex);
+
+		s_include_cache[path_string] = { last_write_time, shared_data };
+	}
+
+	return shared_data;
+}
+
+// Result of processing an included file, along with the state the including preprocessor instance was in, so that other instances can skip processing that file when they reach it in the same state
+struct include_result
+{
+	std::string file_path;
+	std::vector<std::filesystem::path> include_paths;
+	std::unordered_map<std::string, reshadefx::preprocessor::macro> macros;
+	std::vector<std::string> once_files;
+	std::vector<std::pair<std::string, std::shared_ptr<const std::string>>> dependencies;
+
+	std::string output;
+	reshadefx::location output_location;
+	std::vector<std::pair<std::string, reshadefx::preprocessor::macro>> defined_macros;
+	std::vector<std::string> undefined_macros;
+	std::vector<std::string> used_macros;
+	std::vector<std::pair<std::string, std::shared_ptr<const std::string>>> file_cache_entries;
+};
+
+struct reshadefx::preprocessor::include_recording
+{
+	include_result result;
+	size_t input_index = 0;
+	size_t output_offset = 0;
+	size_t errors_offset = 0;
+	size_t if_stack_size = 0;
+	std::unordered_set<std::string> used_macros;
+	std::unordered_map<std::string, std::shared_ptr<const std::string>> file_cache;
+};
+
+static constexpr size_t MAX_INCLUDE_RESULTS = 64;
+
+static std::vector<std::shared_ptr<const include_result>> s_include_results;
+
+static bool is_same_macro(const reshadefx::preprocessor::macro &lhs, const reshadefx::preprocessor::macro &rhs)
+{
+	return lhs.replacement_list == rhs.replacement_list && lhs.parameters == rhs.parameters && lhs.is_variadic == rhs.is_variadic && lhs.is_function_like == rhs.is_function_like;
+}
+static bool is_same_macro_table(const std::unordered_map<std::string, reshadefx::preprocessor::macro> &lhs, const std::unordered_map<std::string, reshadefx::preprocessor::macro> &rhs)
+{
+	if (lhs.size() != rhs.size())
+		return false;
+
+	for (const auto &[name, macro] : lhs)
+		if (const auto it = rhs.find(name); it == rhs.end() || !is_same_macro(it->second, macro))
+			return false;
+
+	return true;
+}
+
+static std::vector<std::string> once_files(const std::unordered_map<std::string, std::shared_ptr<const std::string>> &file_cache)
+{
+	std::vector<std::string> files;
+	for (const auto &[file_path, data] : file_cache)
+		if (data == nullptr)
+			files.push_back(file_path);
+	std::sort(files.begin(), files.end());
+	return files;
+}
+
 static std::string escape_string(std::string s)
 {
 	for (size_t offset = 0; (offset = s.find('\\', offset)) != std::string::npos; offset += 2)
@@ -112,6 +205,14 @@ reshadefx::preprocessor::~preprocessor()
 {
 }
 
+void reshadefx::preprocessor::clear_include_cache()
+{
+	const std::lock_guard<std::mutex> lock(s_include_cache_mutex);
+
+	s_include_cache.clear();
+	s_include_results.clear();
+}
+
 void reshadefx::preprocessor::add_include_path(const std::filesystem::path &path)
 {
 	assert(!path.empty());
@@ -174,12 +275,12 @@ std::vector<std::pair<std::string, std::string>> reshadefx::preprocessor::used_m
 
 void reshadefx::preprocessor::error(const location &location, const std::string &message)
 {
-	_errors += location.source + '(' + std::to_string(location.line) + ", " + std::to_string(location.column) + ')' + ": preprocessor error: " + message + '\n';
+	_errors += std::string(location.source) + '(' + std::to_string(location.line) + ", " + std::to_string(location.column) + ')' + ": preprocessor error: " + message + '\n';
 	_success = false; // Unset success flag
 }
 void reshadefx::preprocessor::warning(const location &location, const std::string &message)
 {
-	_errors += location.source + '(' + std::to_string(location.line) + ", " + std::to_string(location.column) + ')' + ": preprocessor warning: " + message + '\n';
+	_errors += std::string(location.source) + '(' + std::to_string(location.line) + ", " + std::to_string(location.column) + ')' + ": preprocessor warning: " + message + '\n';
 }
 
 void reshadefx::preprocessor::push(std::string input, const std::string &name)
@@ -203,10 +304,6 @@ void reshadefx::preprocessor::push(std::string input, const std::string &name)
 	level.next_token.id = tokenid::unknown;
 	level.next_token.location = start_location; // This is used in 'consume' to initialize the output location
 
-	// Inherit hidden macros from parent
-	if (!_input_stack.empty())
-		level.hidden_macros = _input_stack.back().hidden_macros;
-
 	_input_stack.push_back(std::move(level));
 	_next_input_index = _input_stack.size() - 1;
 
@@ -220,6 +317,10 @@ bool reshadefx::preprocessor::peek(tokenid token) const
 }
 bool reshadefx::preprocessor::consume()
 {
+	// An include that ends in the middle of a directive cannot be replayed, since the rest of that directive belongs to the including file
+	if (_include_recording != nullptr && _next_input_index < _include_recording->input_index)
+		_include_recording.reset();
+
 	_current_input_index = _next_input_index;
 
 	if (_input_stack.empty())
@@ -239,7 +340,7 @@ bool reshadefx::preprocessor::consume()
 	{
 		_output += "#line " + std::to_string(input.next_token.location.line) + " \"" + input.name + "\"\n";
 		_output_location.line = input.next_token.location.line;
-		_output_location.source = input.name;
+		_output_location.source = intern_source_name(input.name);
 	}
 
 	// Set current token
@@ -318,8 +419,15 @@ void reshadefx::preprocessor::parse()
 {
 	std::string line;
 
-	while (consume())
+	while (true)
 	{
+		// Store the result of an include once all its tokens were processed, before the location is switched back to the including file
+		if (_include_recording != nullptr && _next_input_index < _include_recording->input_index)
+			finish_include_recording(line.empty());
+
+		if (!consume())
+			break;
+
 		_recursion_count = 0;
 
 		const bool skip = !_if_stack.empty() && _if_stack.back().skipping;
@@ -421,6 +529,9 @@ void reshadefx::preprocessor::parse()
 		}
 	}
 
+	// Input ended before an include was finished, so there is nothing to store
+	_include_recording.reset();
+
 	// Append the last line after the EOF was reached to the output
 	_output += line;
 	_output += '\n';
@@ -620,8 +731,8 @@ void reshadefx::preprocessor::parse_pragma()
 
 	if (pragma == "once")
 	{
-		if (const auto it = _file_cache.find(_output_location.source); it != _file_cache.end())
-			it->second.clear();
+		if (const auto it = _file_cache.find(std::string(_output_location.source)); it != _file_cache.end())
+			it->second.reset();
 		return;
 	}
 
@@ -667,28 +778,151 @@ void reshadefx::preprocessor::parse_include()
 		return;
 	}
 
-	std::string data;
+	std::shared_ptr<const std::string> file_data;
 	if (auto it = _file_cache.find(file_path_string);
 		it != _file_cache.end())
 	{
-		data = it->second;
+		file_data = it->second;
 	}
 	else
 	{
-		if (!read_file(file_path, data))
+		file_data = read_file_cached(file_path, file_path_string);
+		if (file_data == nullptr)
 		{
 			error(keyword_location, "could not open included file '" + file_path_string + '\'');
 			consume_until(tokenid::end_of_line);
 			return;
 		}
 
-		_file_cache.emplace(file_path_string, data);
+		_file_cache.emplace(file_path_string, file_data);
 	}
 
 	// Clear out input stack before pushing include so that hidden macros do not bleed into the include
 	while (_input_stack.size() > (_next_input_index + 1))
 		_input_stack.pop_back();
-	push(std::move(data), file_path_string);
+
+	// Files that were skipped due to '#pragma once' have no contents
+	if (file_data == nullptr)
+	{
+		push(std::string(), file_path_string);
+		return;
+	}
+
+	if (_include_recording != nullptr)
+		_include_recording->result.dependencies.emplace_back(file_path_string, file_data);
+
+	if (replay_include(file_path_string))
+		return;
+
+	// Only record the outermost include, since that already covers everything the files it includes in turn do
+	if (_include_recording == nullptr)
+	{
+		_include_recording = std::make_unique<include_recording>();
+		_include_recording->input_index = _input_stack.size();
+		_include_recording->output_offset = _output.size();
+		_include_recording->errors_offset = _errors.size();
+		_include_recording->if_stack_size = _if_stack.size();
+		_include_recording->used_macros = _used_macros;
+		_include_recording->file_cache = _file_cache;
+
+		include_result &result = _include_recording->result;
+		result.file_path = file_path_string;
+		result.include_paths = _include_paths;
+		result.macros = _macros;
+		result.once_files = once_files(_file_cache);
+		result.dependencies.emplace_back(file_path_string, file_data);
+	}
+
+	push(*file_data, file_path_string);
+}
+
+bool reshadefx::preprocessor::replay_include(const std::string &file_path)
+{
+	const std::vector<std::string> current_once_files = once_files(_file_cache);
+
+	std::shared_ptr<const include_result> result;
+
+	{	const std::lock_guard<std::mutex> lock(s_include_cache_mutex);
+
+		for (auto it = s_include_results.rbegin(); it != s_include_results.rend(); ++it)
+		{
+			if ((*it)->file_path == file_path &&
+				(*it)->include_paths == _include_paths &&
+				(*it)->once_files == current_once_files &&
+				is_same_macro_table((*it)->macros, _macros))
+			{
+				result = *it;
+				break;
+			}
+		}
+	}
+
+	if (result == nullptr)
+		return false;
+
+	for (const auto &[dependency_path, dependency_data] : result->dependencies)
+	{
+		// Any file that was modified since the result was recorded invalidates it
+		if (read_file_cached(std::filesystem::u8path(dependency_path), dependency_path) != dependency_data)
+			return false;
+
+		// Processing the include again would report a recursive include for this file, so do that instead
+		if (std::find_if(_input_stack.begin(), _input_stack.end(),
+			[&dependency_path](const input_level &level) { return level.name == dependency_path; }) != _input_stack.end())
+			return false;
+	}
+
+	_output += result->output;
+	_output_location = result->output_location;
+
+	for (const auto &[name, macro] : result->defined_macros)
+		_macros[name] = macro;
+	for (const std::string &name : result->undefined_macros)
+		_macros.erase(name);
+
+	_used_macros.insert(result->used_macros.begin(), result->used_macros.end());
+
+	for (const auto &[dependency_path, dependency_data] : result->file_cache_entries)
+		_file_cache[dependency_path] = dependency_data;
+
+	// Make the outer include that is currently being recorded depend on the files of this one too
+	if (_include_recording != nullptr)
+		_include_recording->result.dependencies.insert(_include_recording->result.dependencies.end(), result->dependencies.begin(), result->dependencies.end());
+
+	return true;
+}
+void reshadefx::preprocessor::finish_include_recording(bool complete)
+{
+	const std::unique_ptr<include_recording> recording = std::move(_include_recording);
+
+	// Results that caused errors or warnings are not stored, so that every instance reports those again
+	if (!complete || _errors.size() != recording->errors_offset || _if_stack.size() != recording->if_stack_size)
+		return;
+
+	const auto result = std::make_shared<include_result>(std::move(recording->result));
+	result->output = _output.substr(recording->output_offset);
+	result->output_location = _output_location;
+
+	for (const auto &[name, macro] : _macros)
+		if (const auto it = result->macros.find(name); it == result->macros.end() || !is_same_macro(it->second, macro))
+			result->defined_macros.emplace_back(name, macro);
+	for (const auto &[name, macro] : result->macros)
+		if (_macros.find(name) == _macros.end())
+			result->undefined_macros.push_back(name);
+
+	for (const std::string &name : _used_macros)
+		if (recording->used_macros.find(name) == recording->used_macros.end())
+			result->used_macros.push_back(name);
+
+	for (const auto &[file_path, data] : _file_cache)
+		if (const auto it = recording->file_cache.find(file_path); it == recording->file_cache.end() || it->second != data)
+			result->file_cache_entries.emplace_back(file_path, data);
+
+	const std::lock_guard<std::mutex> lock(s_include_cache_mutex);
+
+	if (s_include_results.size() >= MAX_INCLUDE_RESULTS)
+		s_include_results.erase(s_include_results.begin());
+	s_include_results.push_back(result);
 }
 
 bool reshadefx::preprocessor::evaluate_expression()
@@ -1039,7 +1273,7 @@ bool reshadefx::preprocessor::evaluate_identifier_as_macro()
 	}
 	if (_token.literal_as_string == "__FILE__")
 	{
-		push(escape_string(_token.location.source));
+		push(escape_string(std::string(_token.location.source)));
 		return true;
 	}
 	if (_token.literal_as_string == "__FILE_STEM__")
@@ -1059,8 +1293,7 @@ bool reshadefx::preprocessor::evaluate_identifier_as_macro()
 	if (it == _macros.end())
 		return false;
 
-	const std::unordered_set<std::string> &hidden_macros = _input_stack[_current_input_index].hidden_macros;
-	if (hidden_macros.find(_token.literal_as_string) != hidden_macros.end())
+	if (is_macro_hidden(_token.literal_as_string))
 		return false;
 
 	const auto macro_location = _token.location;
@@ -1129,14 +1362,29 @@ bool reshadefx::preprocessor::evaluate_identifier_as_macro()
 	{
 		push(std::move(input));
 
-		_input_stack[_current_input_index].hidden_macros.insert(it->first);
+		_input_stack[_current_input_index].hidden_macro = it->first;
 	}
 
 	return true;
 }
+bool reshadefx::preprocessor::is_macro_hidden(const std::string &name) const
+{
+	// Levels are only ever pushed on top of the current one, so the hide set of the current level is made up of the macros of it and all levels below
+	// This avoids having to copy a set of names for every pushed level
+	for (size_t i = 0; i <= _current_input_index && i < _input_stack.size(); ++i)
+		if (_input_stack[i].hidden_macro == name)
+			return true;
+	return false;
+}
 
 void reshadefx::preprocessor::expand_macro(const std::string &name, const macro &macro, const std::vector<std::string> &arguments, std::string &out)
 {
+	// Arguments are fully macro-expanded only once, no matter how often they are referenced in the replacement list (e.g. in generated tap loops)
+	std::vector<std::string> expanded_arguments;
+	std::vector<bool> expanded_arguments_valid;
+
+	out.reserve(macro.replacement_list.size());
+
 	for (size_t offset = 0; offset < macro.replacement_list.size(); ++offset)
 	{
 		if (macro.replacement_list[offset] != macro_replacement_start)
@@ -1181,18 +1429,33 @@ void reshadefx::preprocessor::expand_macro(const std::string &name, const macro
 			out += '"';
 			break;
 		case macro_replacement_argument:
-			push(arguments[index] + static_cast<char>(macro_replacement_argument));
-			while (true)
+			if (expanded_arguments.empty())
 			{
-				// Consume all tokens here, so spaces are added to the output too
-				consume();
-				if (_token == tokenid::unknown) // 'macro_replacement_argument' is 'tokenid::unknown'
-					break;
-				if (_token == tokenid::identifier && evaluate_identifier_as_macro())
-					continue;
-				out += _current_token_raw_data;
+				expanded_arguments.resize(arguments.size());
+				expanded_arguments_valid.resize(arguments.size());
+			}
+
+			if (!expanded_arguments_valid[index])
+			{
+				std::string &expanded_argument = expanded_arguments[index];
+
+				push(arguments[index] + static_cast<char>(macro_replacement_argument));
+				while (true)
+				{
+					// Consume all tokens here, so spaces are added to the output too
+					consume();
+					if (_token == tokenid::unknown) // 'macro_replacement_argument' is 'tokenid::unknown'
+						break;
+					if (_token == tokenid::identifier && evaluate_identifier_as_macro())
+						continue;
+					expanded_argument += _current_token_raw_data;
+				}
+				assert(_current_token_raw_data[0] == macro_replacement_argument);
+
+				expanded_arguments_valid[index] = true;
 			}
-			assert(_current_token_raw_data[0] == macro_replacement_argument);
+
+			out += expanded_arguments[index];
 			break;
 		}
 	}
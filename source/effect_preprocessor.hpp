@@ -55,6 +55,12 @@ namespace reshadefx
 			return add_macro_definition(name, macro { std::move(value), {} });
 		}
 
+		/// <summary>
+		/// Remove all files and recorded include results from the include cache that is shared between all preprocessor instances.
+		/// Files in that cache are read again anyway if they were modified since, so this only frees memory.
+		/// </summary>
+		static void clear_include_cache();
+
 		/// <summary>
 		/// Open the specified file, parse its contents and append them to the output.
 		/// </summary>
@@ -103,8 +109,10 @@ namespace reshadefx
 			std::string name;
 			std::unique_ptr<class lexer> lexer;
 			token next_token;
-			std::unordered_set<std::string> hidden_macros;
+			// Name of the macro this level is the expansion of, which together with those of all parent levels makes up the hide set
+			std::string hidden_macro;
 		};
+		struct include_recording;
 
 		void error(const location &location, const std::string &message);
 		void warning(const location &location, const std::string &message);
@@ -131,8 +139,12 @@ namespace reshadefx
 		void parse_pragma();
 		void parse_include();
 
+		bool replay_include(const std::string &file_path);
+		void finish_include_recording(bool complete);
+
 		bool evaluate_expression();
 		bool evaluate_identifier_as_macro();
+		bool is_macro_hidden(const std::string &name) const;
 
 		void expand_macro(const std::string &name, const macro &macro, const std::vector<std::string> &arguments, std::string &out);
 		void create_macro_replacement_list(macro &macro);
@@ -150,6 +162,9 @@ namespace reshadefx
 		std::unordered_set<std::string> _used_macros;
 		std::unordered_map<std::string, macro> _macros;
 		std::vector<std::filesystem::path> _include_paths;
-		std::unordered_map<std::string, std::string> _file_cache;
+		// Contents of all files included by this instance (or null after '#pragma once' was encountered in that file)
+		std::unordered_map<std::string, std::shared_ptr<const std::string>> _file_cache;
+		// State before the outermost include that is currently being processed, so that its result can be stored and replayed by other instances
+		std::unique_ptr<include_recording> _include_recording;
 	};
 }
@@ -7,6 +7,7 @@
 #include <cassert>
 #include <malloc.h> // alloca
 #include <algorithm> // std::upper_bound, std::sort
+#include <string_view>
 
 #pragma region Import intrinsic functions
 
@@ -114,6 +115,24 @@ static const intrinsic s_intrinsics[] =
 #undef sampler
 #undef storage
 
+// Intrinsic function overloads grouped by name and then by number of parameters (in the order they are defined in)
+static const std::unordered_map<std::string_view, std::vector<std::vector<const intrinsic *>>> &intrinsic_overloads()
+{
+	static const auto s_overloads = []() {
+		std::unordered_map<std::string_view, std::vector<std::vector<const intrinsic *>>> overloads;
+		for (const intrinsic &intrinsic : s_intrinsics)
+		{
+			auto &by_num_parameters = overloads[intrinsic.function.name];
+			if (by_num_parameters.size() <= intrinsic.function.parameter_list.size())
+				by_num_parameters.resize(intrinsic.function.parameter_list.size() + 1);
+			by_num_parameters[intrinsic.function.parameter_list.size()].push_back(&intrinsic);
+		}
+		return overloads;
+	}();
+
+	return s_overloads;
+}
+
 #pragma endregion
 
 unsigned int reshadefx::type::rank(const type &src, const type &dst)
@@ -285,7 +304,7 @@ reshadefx::scoped_symbol reshadefx::symbol_table::find_symbol(const std::string
 	return result;
 }
 
-static int compare_functions(const std::vector<reshadefx::expression> &arguments, const reshadefx::function_info *function1, const reshadefx::function_info *function2)
+static int compare_functions(const reshadefx::expression_list &arguments, const reshadefx::function_info *function1, const reshadefx::function_info *function2)
 {
 	const size_t num_arguments = arguments.size();
 
@@ -334,7 +353,7 @@ static int compare_functions(const std::vector<reshadefx::expression> &arguments
 	return 0; // Both functions are equally viable
 }
 
-bool reshadefx::symbol_table::resolve_function_call(const std::string &name, const std::vector<expression> &arguments, const scope &scope, symbol &out_data, bool &is_ambiguous) const
+bool reshadefx::symbol_table::resolve_function_call(const std::string &name, const expression_list &arguments, const scope &scope, symbol &out_data, bool &is_ambiguous) const
 {
 	out_data.op = symbol_type::function;
 
@@ -401,27 +420,62 @@ bool reshadefx::symbol_table::resolve_function_call(const std::string &name, con
 	// Try matching against intrinsic functions if no matching user-defined function was found up to this point
 	if (num_overloads == 0)
 	{
-		for (const intrinsic &intrinsic : s_intrinsics)
+		// The result only depends on the argument types (and whether ambiguity is possible), so can reuse it for subsequent calls with the same signature
+		std::string cache_key = name;
+		cache_key += overload_namespace == 0 ? '\1' : '\0';
+		for (const expression &argument : arguments)
 		{
-			if (intrinsic.function.name != name || intrinsic.function.parameter_list.size() != arguments.size())
-				continue;
-
-			// A new possibly-matching intrinsic function was found, compare it against the current result
-			const int comparison = compare_functions(arguments, &intrinsic.function, result);
+			const uint32_t signature[] = { argument.type.base, argument.type.rows, argument.type.cols, static_cast<uint32_t>(argument.type.array_length), argument.type.definition };
+			cache_key.append(reinterpret_cast<const char *>(signature), sizeof(signature));
+		}
 
-			if (comparison < 0) // The new function is a better match
+		if (const auto it = _intrinsic_call_cache.find(cache_key);
+			it != _intrinsic_call_cache.end())
+		{
+			if (it->second.function != nullptr)
 			{
 				out_data.op = symbol_type::intrinsic;
-				out_data.id = intrinsic.id;
-				out_data.type = intrinsic.function.return_type;
-				out_data.function = &intrinsic.function;
-				result = out_data.function;
-				num_overloads = 1;
+				out_data.id = it->second.id;
+				out_data.type = it->second.function->return_type;
+				out_data.function = it->second.function;
 			}
-			else if (comparison == 0 && overload_namespace == 0) // Both functions are equally viable, so the call is ambiguous (intrinsics are always in the global namespace)
+
+			num_overloads = it->second.num_overloads;
+		}
+		else
+		{
+			intrinsic_call call = { 0, nullptr, 0 };
+
+			const auto &overloads = intrinsic_overloads();
+			if (const auto overloads_it = overloads.find(name);
+				overloads_it != overloads.end() && arguments.size() < overloads_it->second.size())
 			{
-				++num_overloads;
+				for (const intrinsic *const intrinsic : overloads_it->second[arguments.size()])
+				{
+					// A new possibly-matching intrinsic function was found, compare it against the current result
+					const int comparison = compare_functions(arguments, &intrinsic->function, result);
+
+					if (comparison < 0) // The new function is a better match
+					{
+						out_data.op = symbol_type::intrinsic;
+						out_data.id = intrinsic->id;
+						out_data.type = intrinsic->function.return_type;
+						out_data.function = &intrinsic->function;
+						result = out_data.function;
+						num_overloads = 1;
+
+						call.id = intrinsic->id;
+						call.function = result;
+					}
+					else if (comparison == 0 && overload_namespace == 0) // Both functions are equally viable, so the call is ambiguous (intrinsics are always in the global namespace)
+					{
+						++num_overloads;
+					}
+				}
 			}
+
+			call.num_overloads = num_overloads;
+			_intrinsic_call_cache.emplace(std::move(cache_key), call);
 		}
 	}
 
@@ -93,11 +93,20 @@ namespace reshadefx
 		/// <summary>
 		/// Search for the best function or intrinsic overload matching the argument list.
 		/// </summary>
-		bool resolve_function_call(const std::string &name, const std::vector<expression> &args, const scope &scope, symbol &data, bool &ambiguous) const;
+		bool resolve_function_call(const std::string &name, const expression_list &args, const scope &scope, symbol &data, bool &ambiguous) const;
 
 	private:
+		struct intrinsic_call
+		{
+			uint32_t id;
+			const function_info *function;
+			unsigned int num_overloads;
+		};
+
 		scope _current_scope;
 		std::unordered_map<std::string, // Lookup table from name to matching symbols
 			std::vector<scoped_symbol>> _symbol_stack;
+		// Results of previous overload resolutions against intrinsic functions, keyed by name and argument types
+		mutable std::unordered_map<std::string, intrinsic_call> _intrinsic_call_cache;
 	};
 }
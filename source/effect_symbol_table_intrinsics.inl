@@ -2523,6 +2523,229 @@ IMPLEMENT_INTRINSIC_SPIRV(atomicCompareExchange, 0, {
 		.result;
 	})
 
+// Wave intrinsics are only available in shader model 6 and SPIR-V, other targets emulate a wave with a single lane
+
+// ret WaveGetLaneCount()
+DEFINE_INTRINSIC(WaveGetLaneCount, 0, uint)
+IMPLEMENT_INTRINSIC_GLSL(WaveGetLaneCount, 0, {
+	code += "1u";
+	})
+IMPLEMENT_INTRINSIC_HLSL(WaveGetLaneCount, 0, {
+	if (_shader_model >= 60)
+		code += "WaveGetLaneCount()";
+	else
+		code += '1';
+	})
+IMPLEMENT_INTRINSIC_SPIRV(WaveGetLaneCount, 0, {
+	return emit_builtin_load(spv::BuiltInSubgroupSize, res_type);
+	})
+
+// ret WaveGetLaneIndex()
+DEFINE_INTRINSIC(WaveGetLaneIndex, 0, uint)
+IMPLEMENT_INTRINSIC_GLSL(WaveGetLaneIndex, 0, {
+	code += "0u";
+	})
+IMPLEMENT_INTRINSIC_HLSL(WaveGetLaneIndex, 0, {
+	if (_shader_model >= 60)
+		code += "WaveGetLaneIndex()";
+	else
+		code += '0';
+	})
+IMPLEMENT_INTRINSIC_SPIRV(WaveGetLaneIndex, 0, {
+	return emit_builtin_load(spv::BuiltInSubgroupLocalInvocationId, res_type);
+	})
+
+// ret WaveIsFirstLane()
+DEFINE_INTRINSIC(WaveIsFirstLane, 0, bool)
+IMPLEMENT_INTRINSIC_GLSL(WaveIsFirstLane, 0, {
+	code += "true";
+	})
+IMPLEMENT_INTRINSIC_HLSL(WaveIsFirstLane, 0, {
+	if (_shader_model >= 60)
+		code += "WaveIsFirstLane()";
+	else
+		code += "true";
+	})
+IMPLEMENT_INTRINSIC_SPIRV(WaveIsFirstLane, 0, {
+	add_capability(spv::CapabilityGroupNonUniform);
+
+	return add_instruction(spv::OpGroupNonUniformElect, convert_type(res_type))
+		.add(emit_constant(spv::ScopeSubgroup))
+		.result;
+	})
+
+// ret WaveActiveAnyTrue(x)
+DEFINE_INTRINSIC(WaveActiveAnyTrue, 0, bool, bool)
+IMPLEMENT_INTRINSIC_GLSL(WaveActiveAnyTrue, 0, {
+	code += id_to_name(args[0].base);
+	})
+IMPLEMENT_INTRINSIC_HLSL(WaveActiveAnyTrue, 0, {
+	if (_shader_model >= 60)
+		code += "WaveActiveAnyTrue(" + id_to_name(args[0].base) + ')';
+	else
+		code += id_to_name(args[0].base);
+	})
+IMPLEMENT_INTRINSIC_SPIRV(WaveActiveAnyTrue, 0, {
+	add_capability(spv::CapabilityGroupNonUniformVote);
+
+	return add_instruction(spv::OpGroupNonUniformAny, convert_type(res_type))
+		.add(emit_constant(spv::ScopeSubgroup))
+		.add(args[0].base)
+		.result;
+	})
+
+// ret WaveActiveAllTrue(x)
+DEFINE_INTRINSIC(WaveActiveAllTrue, 0, bool, bool)
+IMPLEMENT_INTRINSIC_GLSL(WaveActiveAllTrue, 0, {
+	code += id_to_name(args[0].base);
+	})
+IMPLEMENT_INTRINSIC_HLSL(WaveActiveAllTrue, 0, {
+	if (_shader_model >= 60)
+		code += "WaveActiveAllTrue(" + id_to_name(args[0].base) + ')';
+	else
+		code += id_to_name(args[0].base);
+	})
+IMPLEMENT_INTRINSIC_SPIRV(WaveActiveAllTrue, 0, {
+	add_capability(spv::CapabilityGroupNonUniformVote);
+
+	return add_instruction(spv::OpGroupNonUniformAll, convert_type(res_type))
+		.add(emit_constant(spv::ScopeSubgroup))
+		.add(args[0].base)
+		.result;
+	})
+
+// ret WaveReadLaneFirst(x)
+DEFINE_INTRINSIC(WaveReadLaneFirst, 0, int, int)
+DEFINE_INTRINSIC(WaveReadLaneFirst, 0, uint, uint)
+DEFINE_INTRINSIC(WaveReadLaneFirst, 0, float, float)
+DEFINE_INTRINSIC(WaveReadLaneFirst, 0, float2, float2)
+DEFINE_INTRINSIC(WaveReadLaneFirst, 0, float3, float3)
+DEFINE_INTRINSIC(WaveReadLaneFirst, 0, float4, float4)
+IMPLEMENT_INTRINSIC_GLSL(WaveReadLaneFirst, 0, {
+	code += id_to_name(args[0].base);
+	})
+IMPLEMENT_INTRINSIC_HLSL(WaveReadLaneFirst, 0, {
+	if (_shader_model >= 60)
+		code += "WaveReadLaneFirst(" + id_to_name(args[0].base) + ')';
+	else
+		code += id_to_name(args[0].base);
+	})
+IMPLEMENT_INTRINSIC_SPIRV(WaveReadLaneFirst, 0, {
+	add_capability(spv::CapabilityGroupNonUniformBallot);
+
+	return add_instruction(spv::OpGroupNonUniformBroadcastFirst, convert_type(res_type))
+		.add(emit_constant(spv::ScopeSubgroup))
+		.add(args[0].base)
+		.result;
+	})
+
+// ret WaveActiveSum(x)
+DEFINE_INTRINSIC(WaveActiveSum, 0, int, int)
+DEFINE_INTRINSIC(WaveActiveSum, 0, uint, uint)
+DEFINE_INTRINSIC(WaveActiveSum, 0, float, float)
+DEFINE_INTRINSIC(WaveActiveSum, 0, float2, float2)
+DEFINE_INTRINSIC(WaveActiveSum, 0, float3, float3)
+DEFINE_INTRINSIC(WaveActiveSum, 0, float4, float4)
+IMPLEMENT_INTRINSIC_GLSL(WaveActiveSum, 0, {
+	code += id_to_name(args[0].base);
+	})
+IMPLEMENT_INTRINSIC_HLSL(WaveActiveSum, 0, {
+	if (_shader_model >= 60)
+		code += "WaveActiveSum(" + id_to_name(args[0].base) + ')';
+	else
+		code += id_to_name(args[0].base);
+	})
+IMPLEMENT_INTRINSIC_SPIRV(WaveActiveSum, 0, {
+	add_capability(spv::CapabilityGroupNonUniformArithmetic);
+
+	return add_instruction(res_type.is_floating_point() ? spv::OpGroupNonUniformFAdd : res_type.is_signed() ? spv::OpGroupNonUniformIAdd : spv::OpGroupNonUniformIAdd, convert_type(res_type))
+		.add(emit_constant(spv::ScopeSubgroup))
+		.add(spv::GroupOperationReduce)
+		.add(args[0].base)
+		.result;
+	})
+
+// ret WaveActiveMin(x)
+DEFINE_INTRINSIC(WaveActiveMin, 0, int, int)
+DEFINE_INTRINSIC(WaveActiveMin, 0, uint, uint)
+DEFINE_INTRINSIC(WaveActiveMin, 0, float, float)
+DEFINE_INTRINSIC(WaveActiveMin, 0, float2, float2)
+DEFINE_INTRINSIC(WaveActiveMin, 0, float3, float3)
+DEFINE_INTRINSIC(WaveActiveMin, 0, float4, float4)
+IMPLEMENT_INTRINSIC_GLSL(WaveActiveMin, 0, {
+	code += id_to_name(args[0].base);
+	})
+IMPLEMENT_INTRINSIC_HLSL(WaveActiveMin, 0, {
+	if (_shader_model >= 60)
+		code += "WaveActiveMin(" + id_to_name(args[0].base) + ')';
+	else
+		code += id_to_name(args[0].base);
+	})
+IMPLEMENT_INTRINSIC_SPIRV(WaveActiveMin, 0, {
+	add_capability(spv::CapabilityGroupNonUniformArithmetic);
+
+	return add_instruction(res_type.is_floating_point() ? spv::OpGroupNonUniformFMin : res_type.is_signed() ? spv::OpGroupNonUniformSMin : spv::OpGroupNonUniformUMin, convert_type(res_type))
+		.add(emit_constant(spv::ScopeSubgroup))
+		.add(spv::GroupOperationReduce)
+		.add(args[0].base)
+		.result;
+	})
+
+// ret WaveActiveMax(x)
+DEFINE_INTRINSIC(WaveActiveMax, 0, int, int)
+DEFINE_INTRINSIC(WaveActiveMax, 0, uint, uint)
+DEFINE_INTRINSIC(WaveActiveMax, 0, float, float)
+DEFINE_INTRINSIC(WaveActiveMax, 0, float2, float2)
+DEFINE_INTRINSIC(WaveActiveMax, 0, float3, float3)
+DEFINE_INTRINSIC(WaveActiveMax, 0, float4, float4)
+IMPLEMENT_INTRINSIC_GLSL(WaveActiveMax, 0, {
+	code += id_to_name(args[0].base);
+	})
+IMPLEMENT_INTRINSIC_HLSL(WaveActiveMax, 0, {
+	if (_shader_model >= 60)
+		code += "WaveActiveMax(" + id_to_name(args[0].base) + ')';
+	else
+		code += id_to_name(args[0].base);
+	})
+IMPLEMENT_INTRINSIC_SPIRV(WaveActiveMax, 0, {
+	add_capability(spv::CapabilityGroupNonUniformArithmetic);
+
+	return add_instruction(res_type.is_floating_point() ? spv::OpGroupNonUniformFMax : res_type.is_signed() ? spv::OpGroupNonUniformSMax : spv::OpGroupNonUniformUMax, convert_type(res_type))
+		.add(emit_constant(spv::ScopeSubgroup))
+		.add(spv::GroupOperationReduce)
+		.add(args[0].base)
+		.result;
+	})
+
+// ret WavePrefixSum(x)
+DEFINE_INTRINSIC(WavePrefixSum, 0, int, int)
+DEFINE_INTRINSIC(WavePrefixSum, 0, uint, uint)
+DEFINE_INTRINSIC(WavePrefixSum, 0, float, float)
+DEFINE_INTRINSIC(WavePrefixSum, 0, float2, float2)
+DEFINE_INTRINSIC(WavePrefixSum, 0, float3, float3)
+DEFINE_INTRINSIC(WavePrefixSum, 0, float4, float4)
+IMPLEMENT_INTRINSIC_GLSL(WavePrefixSum, 0, {
+	if (res_type.rows > 1)
+		code += "vec" + std::to_string(res_type.rows) + "(0.0)";
+	else
+		code += res_type.is_floating_point() ? "0.0" : res_type.is_signed() ? "0" : "0u";
+	})
+IMPLEMENT_INTRINSIC_HLSL(WavePrefixSum, 0, {
+	if (_shader_model >= 60)
+		code += "WavePrefixSum(" + id_to_name(args[0].base) + ')';
+	else
+		code += '0'; // The sum of all previous lanes is always zero with a single lane
+	})
+IMPLEMENT_INTRINSIC_SPIRV(WavePrefixSum, 0, {
+	add_capability(spv::CapabilityGroupNonUniformArithmetic);
+
+	return add_instruction(res_type.is_floating_point() ? spv::OpGroupNonUniformFAdd : spv::OpGroupNonUniformIAdd, convert_type(res_type))
+		.add(emit_constant(spv::ScopeSubgroup))
+		.add(spv::GroupOperationExclusiveScan)
+		.add(args[0].base)
+		.result;
+	})
+
 #undef DEFINE_INTRINSIC
 #undef IMPLEMENT_INTRINSIC_GLSL
 #undef IMPLEMENT_INTRINSIC_HLSL
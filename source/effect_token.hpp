@@ -7,9 +7,16 @@
 
 #include <string>
 #include <vector>
+#include <string_view>
 
 namespace reshadefx
 {
+	/// <summary>
+	/// Adds a source file name to the process-wide table of interned names and returns a view of the stored copy.
+	/// The returned view stays valid for the lifetime of the process and is always null-terminated.
+	/// </summary>
+	std::string_view intern_source_name(std::string_view name);
+
 	/// <summary>
 	/// Structure which keeps track of a code location
 	/// </summary>
@@ -17,9 +24,12 @@ namespace reshadefx
 	{
 		location() : line(1), column(1) {}
 		explicit location(unsigned int line, unsigned int column = 1) : line(line), column(column) {}
-		explicit location(std::string source, unsigned int line, unsigned int column = 1) : source(std::move(source)), line(line), column(column) {}
+		explicit location(std::string_view source, unsigned int line, unsigned int column = 1) : source(intern_source_name(source)), line(line), column(column) {}
 
-		std::string source;
+		/// <summary>
+		/// Name of the source file, which refers to an entry in the interned name table, so copying a location never allocates.
+		/// </summary>
+		std::string_view source;
 		unsigned int line, column;
 	};
 
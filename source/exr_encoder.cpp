@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "exr_encoder.hpp"
+#include <cstring>
+
+// See https://www.openexr.com/documentation/openexrfilelayout.pdf
+
+static void write_bytes(std::vector<uint8_t> &out, const void *data, size_t size)
+{
+	out.insert(out.end(), static_cast<const uint8_t *>(data), static_cast<const uint8_t *>(data) + size);
+}
+template <typename T>
+static void write_value(std::vector<uint8_t> &out, T value)
+{
+	// OpenEXR stores everything in little-endian byte order, which is what x86 uses too
+	write_bytes(out, &value, sizeof(value));
+}
+static void write_attribute(std::vector<uint8_t> &out, const char *name, const char *type, uint32_t size)
+{
+	write_bytes(out, name, std::strlen(name) + 1);
+	write_bytes(out, type, std::strlen(type) + 1);
+	write_value<uint32_t>(out, size);
+}
+
+bool reshade::encode_exr(const uint16_t *data, uint32_t width, uint32_t height, std::vector<uint8_t> &out)
+{
+	if (data == nullptr || width == 0 || height == 0)
+		return false;
+
+	// Channels have to be sorted alphabetically, each one is stored as a separate plane in every scanline
+	static const struct { char name; uint32_t component; } channels[4] = { { 'A', 3 }, { 'B', 2 }, { 'G', 1 }, { 'R', 0 } };
+
+	const size_t scanline_size = static_cast<size_t>(width) * 4 * sizeof(uint16_t);
+
+	out.clear();
+	out.reserve(1024 + height * (sizeof(uint64_t) + 2 * sizeof(uint32_t) + scanline_size));
+
+	write_value<uint32_t>(out, 20000630); // Magic number
+	write_value<uint32_t>(out, 2); // Version 2, single-part scanline file
+
+	write_attribute(out, "channels", "chlist", 4 * (2 + 16) + 1);
+	for (const auto &channel : channels)
+	{
+		write_value<char>(out, channel.name);
+		write_value<char>(out, '\0');
+		write_value<uint32_t>(out, 1); // HALF
+		write_value<uint32_t>(out, 0); // Not linear and reserved
+		write_value<uint32_t>(out, 1); // x sampling
+		write_value<uint32_t>(out, 1); // y sampling
+	}
+	write_value<char>(out, '\0');
+
+	write_attribute(out, "compression", "compression", 1);
+	write_value<uint8_t>(out, 0); // NO_COMPRESSION
+
+	for (const char *const name : { "dataWindow", "displayWindow" })
+	{
+		write_attribute(out, name, "box2i", 16);
+		write_value<int32_t>(out, 0);
+		write_value<int32_t>(out, 0);
+		write_value<int32_t>(out, static_cast<int32_t>(width - 1));
+		write_value<int32_t>(out, static_cast<int32_t>(height - 1));
+	}
+
+	write_attribute(out, "lineOrder", "lineOrder", 1);
+	write_value<uint8_t>(out, 0); // INCREASING_Y
+
+	write_attribute(out, "pixelAspectRatio", "float", 4);
+	write_value<float>(out, 1.0f);
+
+	write_attribute(out, "screenWindowCenter", "v2f", 8);
+	write_value<float>(out, 0.0f);
+	write_value<float>(out, 0.0f);
+
+	write_attribute(out, "screenWindowWidth", "float", 4);
+	write_value<float>(out, 1.0f);
+
+	write_value<char>(out, '\0'); // End of header
+
+	// Without compression every block consists of a single scanline, so the offsets are known up front
+	const size_t block_size = 2 * sizeof(uint32_t) + scanline_size;
+	const size_t first_block_offset = out.size() + height * sizeof(uint64_t);
+	for (uint32_t y = 0; y < height; ++y)
+		write_value<uint64_t>(out, first_block_offset + y * block_size);
+
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		write_value<int32_t>(out, static_cast<int32_t>(y));
+		write_value<uint32_t>(out, static_cast<uint32_t>(scanline_size));
+
+		const size_t offset = out.size();
+		out.resize(offset + scanline_size);
+		uint16_t *const dest = reinterpret_cast<uint16_t *>(out.data() + offset);
+		const uint16_t *const src = data + static_cast<size_t>(y) * width * 4;
+
+		// Convert interleaved RGBA to planar ABGR
+		for (uint32_t c = 0; c < 4; ++c)
+			for (uint32_t x = 0; x < width; ++x)
+				dest[c * width + x] = src[x * 4 + channels[c].component];
+	}
+
+	return true;
+}
@@ -0,0 +1,22 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace reshade
+{
+	/// <summary>
+	/// Encodes a 64bpp RGBA image with half-precision floating-point channels as an uncompressed scanline OpenEXR file.
+	/// </summary>
+	/// <param name="data">The image data, with rows tightly packed and channel values stored as 16-bit floating-point numbers.</param>
+	/// <param name="width">The width of the image.</param>
+	/// <param name="height">The height of the image.</param>
+	/// <param name="out">The buffer the OpenEXR file is written to.</param>
+	/// <returns><see langword="true"/> if the image was encoded successfully, <see langword="false"/> otherwise.</returns>
+	bool encode_exr(const uint16_t *data, uint32_t width, uint32_t height, std::vector<uint8_t> &out);
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "dll_log.hpp"
+#include "file_watcher.hpp"
+#include <algorithm>
+#include <Windows.h>
+
+struct reshade::file_watcher::directory
+{
+	std::filesystem::path path;
+	HANDLE handle = INVALID_HANDLE_VALUE;
+	DWORD filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE;
+	OVERLAPPED overlapped = {};
+	// Notifications are written into this buffer asynchronously, so it has to stay at the same address while a read is pending
+	alignas(DWORD) BYTE buffer[16384];
+
+	bool read()
+	{
+		return ReadDirectoryChangesW(handle, buffer, sizeof(buffer), TRUE, filter, nullptr, &overlapped, nullptr) != FALSE;
+	}
+};
+
+reshade::file_watcher::file_watcher(const std::vector<std::filesystem::path> &paths, bool report_removed) :
+	_report_removed(report_removed)
+{
+	for (const std::filesystem::path &path : paths)
+	{
+		// Ignore duplicates, since search paths may be listed multiple times
+		if (std::find_if(_directories.begin(), _directories.end(),
+				[&path](const std::unique_ptr<directory> &dir) { return dir->path == path; }) != _directories.end())
+			continue;
+
+		auto dir = std::make_unique<directory>();
+		dir->path = path;
+		if (report_removed)
+			dir->filter |= FILE_NOTIFY_CHANGE_DIR_NAME;
+
+		dir->handle = CreateFileW(path.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+		if (dir->handle == INVALID_HANDLE_VALUE)
+			continue;
+
+		dir->overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+
+		if (dir->overlapped.hEvent == nullptr || !dir->read())
+		{
+			LOG(WARN) << "Failed to watch directory " << path << " for changes with error code " << GetLastError() << '.';
+
+			if (dir->overlapped.hEvent != nullptr)
+				CloseHandle(dir->overlapped.hEvent);
+			CloseHandle(dir->handle);
+			continue;
+		}
+
+		_directories.push_back(std::move(dir));
+	}
+}
+reshade::file_watcher::~file_watcher()
+{
+	for (const std::unique_ptr<directory> &dir : _directories)
+	{
+		if (dir->handle == INVALID_HANDLE_VALUE)
+			continue;
+
+		// Have to wait for the pending read to be canceled before the buffer it writes to can be freed
+		CancelIoEx(dir->handle, &dir->overlapped);
+		DWORD size = 0;
+		GetOverlappedResult(dir->handle, &dir->overlapped, &size, TRUE);
+
+		CloseHandle(dir->overlapped.hEvent);
+		CloseHandle(dir->handle);
+	}
+}
+
+bool reshade::file_watcher::check(std::vector<std::filesystem::path> &modified_files)
+{
+	const size_t num_modified_files = modified_files.size();
+
+	for (const std::unique_ptr<directory> &dir : _directories)
+	{
+		DWORD size = 0;
+		if (dir->handle == INVALID_HANDLE_VALUE || !GetOverlappedResult(dir->handle, &dir->overlapped, &size, FALSE))
+			continue; // Read is still pending, so nothing changed
+
+		// A size of zero means the buffer overflowed and individual changes were lost
+		if (size == 0)
+		{
+			modified_files.push_back(dir->path);
+		}
+		else
+		{
+			for (const BYTE *offset = dir->buffer;;)
+			{
+				const auto info = reinterpret_cast<const FILE_NOTIFY_INFORMATION *>(offset);
+
+				if (_report_removed || (info->Action != FILE_ACTION_REMOVED && info->Action != FILE_ACTION_RENAMED_OLD_NAME))
+				{
+					std::filesystem::path file_path = dir->path / std::wstring(info->FileName, info->FileNameLength / sizeof(WCHAR));
+					if (std::find(modified_files.begin() + num_modified_files, modified_files.end(), file_path) == modified_files.end())
+						modified_files.push_back(std::move(file_path));
+				}
+
+				if (info->NextEntryOffset == 0)
+					break;
+				offset += info->NextEntryOffset;
+			}
+		}
+
+		// Queue the next read, so that changes keep being recorded until the next check
+		ResetEvent(dir->overlapped.hEvent);
+		if (!dir->read())
+		{
+			LOG(WARN) << "Stopped watching directory " << dir->path << " for changes after error code " << GetLastError() << '.';
+
+			CloseHandle(dir->overlapped.hEvent);
+			CloseHandle(dir->handle);
+			dir->handle = INVALID_HANDLE_VALUE;
+		}
+	}
+
+	return modified_files.size() != num_modified_files;
+}
@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <filesystem>
+
+namespace reshade
+{
+	/// <summary>
+	/// Watches a set of directories (including their subdirectories) for files that are created, renamed or written to.
+	/// Notifications are queued by the operating system in the background, so checking for changes never blocks.
+	/// </summary>
+	class file_watcher
+	{
+	public:
+		/// <summary>
+		/// Starts watching all existing directories in the specified list of <paramref name="paths"/>.
+		/// If <paramref name="report_removed"/> is set, files and directories that are removed or renamed away are reported as well, and so are new directories.
+		/// </summary>
+		explicit file_watcher(const std::vector<std::filesystem::path> &paths, bool report_removed = false);
+		~file_watcher();
+
+		/// <summary>
+		/// Appends the paths of all files that changed since the last call to <paramref name="modified_files"/>.
+		/// If too many changes happened in a directory to keep track of them individually, the path of that directory is appended instead.
+		/// </summary>
+		/// <returns>Returns whether any changes were detected.</returns>
+		bool check(std::vector<std::filesystem::path> &modified_files);
+
+	private:
+		struct directory;
+
+		std::vector<std::unique_ptr<directory>> _directories;
+		bool _report_removed = false;
+	};
+}
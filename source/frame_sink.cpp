@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "frame_sink.hpp"
+#include "dll_log.hpp"
+#include <cassert>
+#include <algorithm>
+#include <Windows.h>
+
+reshade::frame_sink::frame_sink(size_t frame_size, size_t queue_size) :
+	_frame_size(frame_size)
+{
+	if (queue_size == 0)
+		queue_size = 1;
+
+	_buffers.resize(queue_size);
+	_free_buffers.reserve(queue_size);
+	_queued_buffers.resize(queue_size);
+
+	for (size_t i = 0; i < queue_size; ++i)
+	{
+		_buffers[i].resize(frame_size);
+		_free_buffers.push_back(i);
+	}
+}
+reshade::frame_sink::~frame_sink()
+{
+	close();
+}
+
+bool reshade::frame_sink::open_file(const std::filesystem::path &path)
+{
+	assert(_output == nullptr);
+
+	const HANDLE file = CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		LOG(ERROR) << "Failed to open " << path << " for writing captured frames with error code " << GetLastError() << '!';
+		return false;
+	}
+
+	_output = file;
+
+	return start();
+}
+bool reshade::frame_sink::open_process(const std::wstring &command_line)
+{
+	assert(_output == nullptr);
+
+	SECURITY_ATTRIBUTES sa = { sizeof(sa) };
+	sa.bInheritHandle = TRUE;
+
+	HANDLE read_pipe = nullptr, write_pipe = nullptr;
+	// Use a pipe buffer that holds a couple of frames, so that the encoder process can consume them in larger batches
+	if (!CreatePipe(&read_pipe, &write_pipe, &sa, static_cast<DWORD>(std::min<size_t>(_frame_size * 2, 64 * 1024 * 1024))))
+	{
+		LOG(ERROR) << "Failed to create pipe for writing captured frames with error code " << GetLastError() << '!';
+		return false;
+	}
+
+	// Only the read end of the pipe should be inherited by the child process
+	SetHandleInformation(write_pipe, HANDLE_FLAG_INHERIT, 0);
+
+	STARTUPINFOW si = { sizeof(si) };
+	si.dwFlags = STARTF_USESTDHANDLES;
+	si.hStdInput = read_pipe;
+	si.hStdOutput = GetStdHandle(STD_OUTPUT_HANDLE);
+	si.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+	PROCESS_INFORMATION pi = {};
+
+	// 'CreateProcessW' may modify the command-line buffer, so pass a copy
+	std::wstring command_line_copy = command_line;
+	if (!CreateProcessW(nullptr, command_line_copy.data(), nullptr, nullptr, TRUE, CREATE_NO_WINDOW, nullptr, nullptr, &si, &pi))
+	{
+		LOG(ERROR) << "Failed to launch frame capture process with error code " << GetLastError() << '!';
+		CloseHandle(read_pipe);
+		CloseHandle(write_pipe);
+		return false;
+	}
+
+	CloseHandle(pi.hThread);
+	// The child process holds its own copy of the read end now
+	CloseHandle(read_pipe);
+
+	_output = write_pipe;
+	_process = pi.hProcess;
+
+	return start();
+}
+void reshade::frame_sink::close()
+{
+	if (_thread.joinable())
+	{
+		{ const std::lock_guard<std::mutex> lock(_mutex);
+			_exit = true;
+		}
+
+		_signal.notify_all();
+		_thread.join();
+	}
+
+	if (_output != nullptr)
+	{
+		// Closing the pipe signals end of input to the encoder process
+		CloseHandle(_output);
+		_output = nullptr;
+	}
+
+	if (_process != nullptr)
+	{
+		// Give the encoder some time to finish writing its output, but do not block the application forever
+		if (WaitForSingleObject(_process, 10000) == WAIT_TIMEOUT)
+			LOG(WARN) << "Frame capture process did not exit after its input was closed.";
+
+		CloseHandle(_process);
+		_process = nullptr;
+	}
+}
+
+uint8_t *reshade::frame_sink::acquire_frame(bool wait)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	if (wait && _output != nullptr)
+		_signal.wait(lock, [this]() { return !_free_buffers.empty() || _exit; });
+
+	if (_free_buffers.empty() || _output == nullptr || _exit)
+		return nullptr;
+
+	const size_t index = _free_buffers.back();
+	_free_buffers.pop_back();
+
+	return _buffers[index].data();
+}
+void reshade::frame_sink::submit_frame(uint8_t *frame)
+{
+	const size_t index = buffer_index(frame);
+
+	{ const std::lock_guard<std::mutex> lock(_mutex);
+		assert(_queue_count < _queued_buffers.size());
+		_queued_buffers[(_queue_head + _queue_count++) % _queued_buffers.size()] = index;
+	}
+
+	_signal.notify_all();
+}
+
+void reshade::frame_sink::discard_frame(uint8_t *frame)
+{
+	const size_t index = buffer_index(frame);
+
+	const std::lock_guard<std::mutex> lock(_mutex);
+	_free_buffers.push_back(index);
+	_num_frames_dropped++;
+}
+
+size_t reshade::frame_sink::buffer_index(const uint8_t *frame) const
+{
+	size_t index = 0;
+	while (index < _buffers.size() && _buffers[index].data() != frame)
+		++index;
+	assert(index < _buffers.size());
+	return index;
+}
+
+bool reshade::frame_sink::start()
+{
+	_exit = false;
+	_thread = std::thread(&frame_sink::thread_main, this);
+
+	return true;
+}
+
+void reshade::frame_sink::thread_main()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	while (true)
+	{
+		_signal.wait(lock, [this]() { return _queue_count != 0 || _exit; });
+
+		// Drain remaining frames before exiting
+		if (_queue_count == 0)
+			break;
+
+		const size_t index = _queued_buffers[_queue_head];
+
+		lock.unlock();
+
+		bool success = true;
+		for (size_t offset = 0; offset < _frame_size && success;)
+		{
+			DWORD bytes_written = 0;
+			const DWORD bytes_to_write = static_cast<DWORD>(std::min<size_t>(_frame_size - offset, 0x40000000));
+			success = WriteFile(_output, _buffers[index].data() + offset, bytes_to_write, &bytes_written, nullptr) && bytes_written != 0;
+			offset += bytes_written;
+		}
+
+		lock.lock();
+
+		_queue_head = (_queue_head + 1) % _queued_buffers.size();
+		_queue_count--;
+		_free_buffers.push_back(index);
+		// Wake up any 'acquire_frame' call waiting for a free buffer
+		_signal.notify_all();
+
+		if (success)
+		{
+			_num_frames_written++;
+		}
+		else
+		{
+			// The encoder process probably exited, so drop all remaining frames and stop writing
+			LOG(ERROR) << "Failed to write captured frame with error code " << GetLastError() << '!';
+			_num_frames_dropped++;
+
+			while (_queue_count != 0)
+			{
+				_free_buffers.push_back(_queued_buffers[_queue_head]);
+				_queue_head = (_queue_head + 1) % _queued_buffers.size();
+				_queue_count--;
+				_num_frames_dropped++;
+			}
+
+			_exit = true;
+			_signal.notify_all();
+			break;
+		}
+	}
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <string>
+#include <filesystem>
+#include <condition_variable>
+
+namespace reshade
+{
+	/// <summary>
+	/// Streams a sequence of frames of fixed size to a raw file or to the standard input of an external process (e.g. a video encoder) on a background thread.
+	/// Frames are passed to that thread through a bounded queue of buffers that are allocated up front, so that no memory is allocated while capturing.
+	/// </summary>
+	class frame_sink
+	{
+	public:
+		/// <summary>
+		/// Creates a sink for frames of <paramref name="frame_size"/> bytes with <paramref name="queue_size"/> buffers to queue them in.
+		/// </summary>
+		frame_sink(size_t frame_size, size_t queue_size);
+		~frame_sink();
+
+		/// <summary>
+		/// Starts writing frames to the file at the specified <paramref name="path"/>, which is overwritten if it already exists.
+		/// </summary>
+		bool open_file(const std::filesystem::path &path);
+		/// <summary>
+		/// Starts writing frames to the standard input of a new process launched with the specified <paramref name="command_line"/>.
+		/// </summary>
+		bool open_process(const std::wstring &command_line);
+		/// <summary>
+		/// Waits for all queued frames to be written and closes the file or standard input of the process.
+		/// </summary>
+		void close();
+
+		/// <summary>
+		/// Gets a free buffer to write the next frame to.
+		/// </summary>
+		/// <param name="wait">Set to <c>true</c> to wait for a buffer to become free instead of failing when all buffers are still queued.</param>
+		/// <returns>A pointer to a buffer of the frame size, or <see langword="nullptr"/> if all buffers are still queued or writing failed, in which case the frame should be dropped.</returns>
+		uint8_t *acquire_frame(bool wait = false);
+		/// <summary>
+		/// Queues a buffer previously returned by <see cref="acquire_frame"/> to be written.
+		/// </summary>
+		void submit_frame(uint8_t *frame);
+		/// <summary>
+		/// Returns a buffer previously returned by <see cref="acquire_frame"/> without writing it, e.g. because filling it failed, and counts it as dropped.
+		/// </summary>
+		void discard_frame(uint8_t *frame);
+		/// <summary>
+		/// Notes that a frame was dropped, since no buffer was available.
+		/// </summary>
+		void drop_frame() { _num_frames_dropped++; }
+
+		uint64_t num_frames_written() const { return _num_frames_written; }
+		uint64_t num_frames_dropped() const { return _num_frames_dropped; }
+
+	private:
+		size_t buffer_index(const uint8_t *frame) const;
+		bool start();
+		void thread_main();
+
+		size_t _frame_size;
+		std::vector<std::vector<uint8_t>> _buffers;
+		// Free buffers and buffers queued for writing, in order (both store indices into '_buffers')
+		std::vector<size_t> _free_buffers;
+		std::vector<size_t> _queued_buffers;
+		size_t _queue_head = 0;
+		size_t _queue_count = 0;
+		std::mutex _mutex;
+		std::condition_variable _signal;
+		bool _exit = false;
+		std::thread _thread;
+		void *_output = nullptr;
+		void *_process = nullptr;
+		std::atomic<uint64_t> _num_frames_written = 0;
+		std::atomic<uint64_t> _num_frames_dropped = 0;
+	};
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "frame_timeline.hpp"
+#include "dll_log.hpp"
+#include <fstream>
+#include <algorithm>
+
+bool reshade::frame_timeline::frame::gpu_range(uint64_t &beg, uint64_t &end) const
+{
+	beg = std::numeric_limits<uint64_t>::max();
+	end = 0;
+
+	for (const event &e : events)
+	{
+		if (e.gpu_end == 0)
+			continue;
+
+		beg = std::min(beg, e.gpu_beg);
+		end = std::max(end, e.gpu_end);
+	}
+
+	return end != 0;
+}
+
+reshade::frame_timeline::frame &reshade::frame_timeline::begin_frame(uint64_t frame_index, uint64_t cpu_time)
+{
+	frame &frame = _frames[_head];
+	_head = (_head + 1) % max_frames;
+	_num_frames = std::min(_num_frames + 1, max_frames);
+
+	frame.frame_index = frame_index;
+	frame.cpu_beg = frame.cpu_end = cpu_time;
+	// Keep the allocated event storage around, so that recording does not allocate every frame
+	frame.events.clear();
+
+	return frame;
+}
+reshade::frame_timeline::frame *reshade::frame_timeline::find_frame(uint64_t frame_index)
+{
+	for (size_t i = 0; i < _num_frames; ++i)
+		if (frame &frame = _frames[(_head + max_frames - 1 - i) % max_frames]; frame.frame_index == frame_index)
+			return &frame;
+	return nullptr;
+}
+
+static void write_json_string(std::ofstream &file, const std::string &value)
+{
+	file << '\"';
+	for (const char c : value)
+	{
+		if (c == '\"' || c == '\\')
+			file << '\\' << c;
+		else if (static_cast<unsigned char>(c) >= 0x20)
+			file << c;
+	}
+	file << '\"';
+}
+
+bool reshade::frame_timeline::export_chrome_trace(const std::filesystem::path &path) const
+{
+	std::ofstream file(path, std::ios::trunc);
+	if (!file)
+	{
+		LOG(ERROR) << "Failed to open " << path << " for writing timeline!";
+		return false;
+	}
+
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"CPU\"}},\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":1,\"args\":{\"name\":\"GPU\"}}";
+
+	// Trace event times are in microseconds, relative to the first recorded frame
+	const uint64_t time_base = _num_frames != 0 ? operator[](0).cpu_beg : 0;
+	const auto write_event = [&file](const std::string &name, const char *category, uint32_t tid, uint64_t beg, uint64_t end, uint64_t frame_index) {
+		file << ",\n{\"name\":";
+		write_json_string(file, name);
+		file << ",\"cat\":\"" << category << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << tid << ",\"ts\":" << (beg / 1000.0) << ",\"dur\":" << ((end - beg) / 1000.0) << ",\"args\":{\"frame\":" << frame_index << "}}";
+	};
+
+	static const char *const categories[] = { "technique", "pass", "copy", "hook" };
+
+	for (size_t i = 0; i < _num_frames; ++i)
+	{
+		const frame &frame = operator[](i);
+
+		write_event("Frame " + std::to_string(frame.frame_index), "frame", 0, frame.cpu_beg - time_base, frame.cpu_end - time_base, frame.frame_index);
+
+		// Hook scopes are put on a track per thread (thread identifiers are never zero or one, so do not clash with the CPU and GPU tracks)
+		for (const event &e : frame.events)
+			write_event(e.name, categories[e.type], e.type == event::hook ? e.thread_id : 0, e.cpu_beg - time_base, e.cpu_end - time_base, frame.frame_index);
+
+		if (uint64_t gpu_beg, gpu_end; frame.gpu_range(gpu_beg, gpu_end))
+		{
+			const uint64_t gpu_offset = frame.events.empty() ? frame.cpu_beg - time_base : frame.events.front().cpu_beg - time_base;
+
+			for (const event &e : frame.events)
+				if (e.gpu_end != 0)
+					write_event(e.name, categories[e.type], 1, e.gpu_beg - gpu_beg + gpu_offset, e.gpu_end - gpu_beg + gpu_offset, frame.frame_index);
+		}
+	}
+
+	file << "\n]}\n";
+
+	return file.good();
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <filesystem>
+
+namespace reshade
+{
+	/// <summary>
+	/// Timeline of the effect work done in the last frames, with CPU time measured around every technique and pass and GPU time stamps that are filled in once their queries were read back a few frames later.
+	/// </summary>
+	class frame_timeline
+	{
+	public:
+		static constexpr size_t max_frames = 64;
+
+		struct event
+		{
+			enum kind : uint8_t
+			{
+				technique,
+				pass,
+				copy, // Copy of the back buffer (and the barriers around it) before a pass
+				hook, // Scope recorded with 'RESHADE_PROFILE_SCOPE' (with the nesting depth stored in 'pass_index')
+			};
+
+			kind type = technique;
+			uint32_t pass_index = 0;
+			uint32_t thread_id = 0;
+			std::string name;
+			// Times in nanoseconds ('std::chrono::high_resolution_clock' for the CPU, the time stamp query values for the GPU, which are zero until available)
+			uint64_t cpu_beg = 0, cpu_end = 0;
+			uint64_t gpu_beg = 0, gpu_end = 0;
+		};
+
+		struct frame
+		{
+			uint64_t frame_index = 0;
+			uint64_t cpu_beg = 0, cpu_end = 0;
+			std::vector<event> events;
+
+			/// <summary>
+			/// Gets the range of GPU time stamps of all events in this frame that were read back so far.
+			/// </summary>
+			bool gpu_range(uint64_t &beg, uint64_t &end) const;
+		};
+
+		/// <summary>
+		/// Starts recording a new frame, which replaces the oldest one once the timeline is full.
+		/// The returned reference stays valid until the next call to <see cref="begin_frame"/> or <see cref="clear"/>.
+		/// </summary>
+		frame &begin_frame(uint64_t frame_index, uint64_t cpu_time);
+		/// <summary>
+		/// Finds a previously recorded frame, or returns <c>nullptr</c> if it is no longer part of the timeline.
+		/// </summary>
+		frame *find_frame(uint64_t frame_index);
+
+		void clear() { _num_frames = 0; }
+
+		/// <summary>
+		/// Gets the number of recorded frames.
+		/// </summary>
+		size_t size() const { return _num_frames; }
+		/// <summary>
+		/// Gets the recorded frame at the specified index, with zero being the oldest one.
+		/// </summary>
+		const frame &operator[](size_t index) const { return _frames[(_head + max_frames - _num_frames + index) % max_frames]; }
+
+		/// <summary>
+		/// Writes all recorded frames to a file in the Chrome trace event format (which can be opened in "chrome://tracing" or Perfetto).
+		/// GPU events are put on a separate track and are aligned so that the first GPU event of each frame starts together with the first CPU event of that frame, since the two clocks are not correlated.
+		/// </summary>
+		bool export_chrome_trace(const std::filesystem::path &path) const;
+
+	private:
+		frame _frames[max_frames];
+		size_t _head = 0;
+		size_t _num_frames = 0;
+	};
+}
@@ -5,9 +5,11 @@
 
 #include "dll_log.hpp"
 #include "hook_manager.hpp"
+#include "lockfree_hash_table.hpp"
 #include <mutex>
 #include <cstring>
 #include <algorithm>
+#include <deque>
 #include <vector>
 #include <Windows.h>
 
@@ -22,6 +24,8 @@ struct named_hook : public reshade::hook
 {
 	const char *name;
 	hook_method method;
+	// Next hook that uses the same replacement function (in installation order)
+	std::atomic<named_hook *> next_with_same_replacement = nullptr;
 };
 
 struct module_export
@@ -36,7 +40,11 @@ HMODULE g_export_module_handle = nullptr;
 extern std::filesystem::path g_reshade_dll_path;
 static std::filesystem::path s_export_hook_path;
 static std::mutex s_hooks_mutex;
-static std::vector<named_hook> s_hooks;
+// Entries are never moved once added, so that the look up tables below can point to them
+// The tables are only written to while holding the mutex above, but can be read from without it, so that resolving a trampoline never waits on a thread that is installing hooks
+static std::deque<named_hook> s_hooks;
+static lockfree_hash_table<reshade::hook::address, named_hook *, 8> s_hooks_by_target;
+static lockfree_hash_table<reshade::hook::address, named_hook *, 8> s_hooks_by_replacement;
 static std::mutex s_delayed_hook_paths_mutex;
 static std::vector<std::filesystem::path> s_delayed_hook_paths;
 
@@ -119,9 +127,28 @@ static bool install_internal(const char *name, reshade::hook &hook, hook_method
 		return false;
 	}
 
-	// Protect access to hook list with a mutex
+	// Protect modification of hook list with a mutex
 	{ const std::lock_guard<std::mutex> lock(s_hooks_mutex);
-		s_hooks.push_back({ hook, name, method });
+		named_hook &entry = s_hooks.emplace_back();
+		static_cast<reshade::hook &>(entry) = hook;
+		entry.name = name;
+		entry.method = method;
+
+		// Only the first hook for a target address or replacement function is added to the look up tables, which matches the order in which hooks were searched before
+		if (s_hooks_by_target.at(hook.target) == nullptr)
+			s_hooks_by_target.emplace(hook.target, &entry);
+
+		if (named_hook *existing = s_hooks_by_replacement.at(hook.replacement); existing == nullptr)
+		{
+			s_hooks_by_replacement.emplace(hook.replacement, &entry);
+		}
+		else
+		{
+			// Additional hooks using the same replacement function are appended to a list starting at the first one
+			while (named_hook *const next = existing->next_with_same_replacement.load(std::memory_order_relaxed))
+				existing = next;
+			existing->next_with_same_replacement.store(&entry, std::memory_order_release);
+		}
 	}
 
 #if RESHADE_VERBOSE_LOG
@@ -136,7 +163,7 @@ static bool install_internal(HMODULE target_module, HMODULE replacement_module,
 
 	// Load export tables from both modules
 	const auto target_exports = enumerate_module_exports(target_module);
-	const auto replacement_exports = enumerate_module_exports(replacement_module);
+	auto replacement_exports = enumerate_module_exports(replacement_module);
 
 	if (target_exports.empty())
 	{
@@ -155,6 +182,12 @@ static bool install_internal(HMODULE target_module, HMODULE replacement_module,
 	LOG(DEBUG) << "  +--------------------+---------+----------------------------------------------------+";
 #endif
 
+	// Sort replacement exports by name, so that matches can be found with a binary search instead of comparing every pair of exports (both modules have hundreds of them)
+	std::sort(replacement_exports.begin(), replacement_exports.end(),
+		[](const module_export &lhs, const module_export &rhs) {
+			return std::strcmp(lhs.name, rhs.name) < 0;
+		});
+
 	// Analyze export tables and find entries that exist in both modules
 	for (const auto &symbol : target_exports)
 	{
@@ -162,13 +195,13 @@ static bool install_internal(HMODULE target_module, HMODULE replacement_module,
 			continue;
 
 		// Find appropriate replacement
-		const auto it = std::find_if(replacement_exports.cbegin(), replacement_exports.cend(),
-			[&symbol](const auto &module_export) {
-				return std::strcmp(module_export.name, symbol.name) == 0;
+		const auto it = std::lower_bound(replacement_exports.cbegin(), replacement_exports.cend(), symbol.name,
+			[](const module_export &replacement_export, const char *name) {
+				return std::strcmp(replacement_export.name, name) < 0;
 			});
 
 		// Filter out uninteresting functions
-		if (it != replacement_exports.cend() &&
+		if (it != replacement_exports.cend() && std::strcmp(it->name, symbol.name) == 0 &&
 			std::strcmp(symbol.name, "CompatValue") != 0 &&
 			std::strcmp(symbol.name, "CompatString") != 0 &&
 			std::strcmp(symbol.name, "DXGIDumpJournal") != 0 &&
@@ -273,8 +306,10 @@ static void install_delayed_hooks(const std::filesystem::path &loaded_path)
 	// Ignore this call if unable to acquire the mutex to avoid possible deadlock
 	if (std::unique_lock<std::mutex> lock(s_delayed_hook_paths_mutex, std::try_to_lock); lock.owns_lock())
 	{
+		bool installed_any = false;
+
 		const auto remove = std::remove_if(s_delayed_hook_paths.begin(), s_delayed_hook_paths.end(),
-			[&loaded_path](const std::filesystem::path &path) {
+			[&loaded_path, &installed_any](const std::filesystem::path &path) {
 				// Pin the module so it cannot be unloaded by the application and cause problems when ReShade tries to call into it afterwards
 				HMODULE delayed_handle = nullptr;
 				if (!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_PIN, path.c_str(), &delayed_handle))
@@ -282,9 +317,17 @@ static void install_delayed_hooks(const std::filesystem::path &loaded_path)
 
 				LOG(INFO) << "Installing delayed hooks for " << path << " (Just loaded via LoadLibrary(" << loaded_path << ")) ...";
 
-				return install_internal(delayed_handle, g_module_handle, hook_method::function_hook) && reshade::hook::apply_queued_actions();
+				if (!install_internal(delayed_handle, g_module_handle, hook_method::function_hook))
+					return false;
+
+				installed_any = true;
+				return true;
 			});
 
+		// Enable hooks of all modules that were loaded as a dependency of this one in a single batch
+		if (installed_any && !reshade::hook::apply_queued_actions())
+			LOG(ERROR) << "Failed to enable delayed hooks!";
+
 		s_delayed_hook_paths.erase(remove, s_delayed_hook_paths.end());
 	}
 	else
@@ -297,22 +340,22 @@ static reshade::hook find_internal(reshade::hook::address target, reshade::hook:
 {
 	assert(target != nullptr || replacement != nullptr);
 
-	// Protect access to hook list with a mutex
-	const std::lock_guard<std::mutex> lock(s_hooks_mutex);
-
-	// Enumerate list of installed hooks and find matching one
-	const auto it = std::find_if(s_hooks.cbegin(), s_hooks.cend(),
-		[target, replacement](const named_hook &hook) {
-			// If only a target address is provided, find the matching hook
-			if (replacement == nullptr)
-				return hook.target == target;
-			// Otherwise search with the replacement function address (since the target address may not be known inside a replacement function)
-			return hook.replacement == replacement &&
-				// Optionally compare the target address too, in case the replacement function is used to hook multiple targets (do not do this if it is unknown)
-				(target == nullptr || hook.target == target);
-		});
+	// If only a target address is provided, find the matching hook
+	if (replacement == nullptr)
+	{
+		const named_hook *const hook = s_hooks_by_target.at(target);
+		return hook != nullptr ? static_cast<const reshade::hook &>(*hook) : reshade::hook {};
+	}
 
-	return it != s_hooks.cend() ? *it : reshade::hook {};
+	// Otherwise search with the replacement function address (since the target address may not be known inside a replacement function)
+	for (const named_hook *hook = s_hooks_by_replacement.at(replacement); hook != nullptr; hook = hook->next_with_same_replacement.load(std::memory_order_acquire))
+	{
+		// Optionally compare the target address too, in case the replacement function is used to hook multiple targets (do not do this if it is unknown)
+		if (target == nullptr || hook->target == target)
+			return *hook;
+	}
+
+	return reshade::hook {};
 }
 
 template <typename T>
@@ -407,7 +450,11 @@ void reshade::hooks::uninstall()
 	for (auto &hook_info : s_hooks)
 		uninstall_internal(hook_info.name, hook_info, hook_info.method);
 
-	s_hooks.clear();
+	{ const std::lock_guard<std::mutex> lock(s_hooks_mutex);
+		s_hooks_by_target.clear();
+		s_hooks_by_replacement.clear();
+		s_hooks.clear();
+	}
 
 	// Free reference to the module loaded for export hooks
 	// Otherwise a subsequent call to 'LoadLibrary' could return the handle to the still loaded export module, instead of loading the ReShade module again
@@ -416,17 +463,14 @@ void reshade::hooks::uninstall()
 	g_export_module_handle = nullptr;
 }
 
-void reshade::hooks::register_module(const std::filesystem::path &target_path)
+void reshade::hooks::register_module(const std::filesystem::path &target_path, bool queue_enable)
 {
 #ifndef RESHADE_TEST_APPLICATION
+	// Skip this in the test application to make RenderDoc work (which hooks these too)
 	install("LoadLibraryA", reinterpret_cast<hook::address>(&LoadLibraryA), reinterpret_cast<hook::address>(&HookLoadLibraryA), true);
 	install("LoadLibraryExA", reinterpret_cast<hook::address>(&LoadLibraryExA), reinterpret_cast<hook::address>(&HookLoadLibraryExA), true);
 	install("LoadLibraryW", reinterpret_cast<hook::address>(&LoadLibraryW), reinterpret_cast<hook::address>(&HookLoadLibraryW), true);
 	install("LoadLibraryExW", reinterpret_cast<hook::address>(&LoadLibraryExW), reinterpret_cast<hook::address>(&HookLoadLibraryExW), true);
-
-	// Install all "LoadLibrary" hooks in one go immediately
-	// Skip this in the test application to make RenderDoc work (which hooks these too)
-	hook::apply_queued_actions();
 #endif
 
 	LOG(INFO) << "Registering hooks for " << target_path << " ...";
@@ -456,9 +500,11 @@ void reshade::hooks::register_module(const std::filesystem::path &target_path)
 		LOG(INFO) << "> Libraries loaded.";
 
 		install_internal(handle, g_module_handle, hook_method::function_hook);
+	}
 
+	// Install all queued up hooks (including the "LoadLibrary" ones) in one go, unless the caller wants to batch them with those of other modules
+	if (!queue_enable)
 		hook::apply_queued_actions();
-	}
 }
 
 void reshade::hooks::ensure_export_module_loaded()
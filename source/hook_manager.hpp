@@ -50,7 +50,8 @@ namespace reshade::hooks
 	/// Only call this function as long as the loader-lock is active, since it is not thread-safe.
 	/// </summary>
 	/// <param name="path">The file path to the target module.</param>
-	void register_module(const std::filesystem::path &path);
+	/// <param name="queue_enable">Set to <see langword="true"/> to queue the enable action instead of immediately executing it, so that hooks for multiple modules can be enabled in a single batch with <see cref="hook::apply_queued_actions"/> (which suspends all threads only once).</param>
+	void register_module(const std::filesystem::path &path, bool queue_enable = false);
 
 	/// <summary>
 	/// Loads the module for export hooks if not already loaded.
@@ -110,7 +110,11 @@ void reshade::gui::code_editor::render(const char *title, const uint32_t palette
 
 	// Deduce text start offset by evaluating maximum number of lines plus two spaces as text width
 	snprintf(buf, 16, " %zu ", _lines.size());
-	const float text_start = ImGui::CalcTextSize(buf).x + _left_margin;
+	// Annotations are drawn in a column to the left of the line numbers, which is as wide as the longest one
+	float annotation_width = 0.0f;
+	for (const auto &annotation : _annotations)
+		annotation_width = std::max(annotation_width, ImGui::CalcTextSize(annotation.second.c_str()).x + ImGui::CalcTextSize(" ").x);
+	const float text_start = ImGui::CalcTextSize(buf).x + annotation_width + _left_margin;
 	// The following holds the approximate width and height of a default character for offset calculation
 	const ImVec2 char_advance = ImVec2(calc_text_size(" ").x, ImGui::GetTextLineHeightWithSpacing() * _line_spacing);
 
@@ -411,6 +415,10 @@ void reshade::gui::code_editor::render(const char *title, const uint32_t palette
 
 		draw_list->AddText(ImVec2(text_screen_pos.x - ImGui::CalcTextSize(buf).x, line_screen_pos.y), palette[color_line_number], buf);
 
+		// Draw annotation (right aligned in its column)
+		if (const auto it = _annotations.find(line_no + 1); it != _annotations.end())
+			draw_list->AddText(ImVec2(line_screen_pos.x + _left_margin + annotation_width - ImGui::CalcTextSize((it->second + ' ').c_str()).x, line_screen_pos.y), palette[color_line_number], it->second.c_str());
+
 		// Nothing to draw if the line is empty, so continue on
 		if (line.empty())
 			continue;
@@ -656,6 +664,7 @@ void reshade::gui::code_editor::set_text(const std::string &text)
 	_undo_index = 0;
 	_undo_base_index = 0;
 	_errors.clear();
+	_annotations.clear();
 
 	for (char c : text)
 	{
@@ -811,6 +820,13 @@ void reshade::gui::code_editor::insert_character(char c, bool auto_indent)
 			errors.insert({ i.first >= _cursor_pos.line + 1 ? i.first + 1 : i.first, i.second });
 		_errors = std::move(errors);
 
+		// Same for annotations
+		std::unordered_map<size_t, std::string> annotations;
+		annotations.reserve(_annotations.size());
+		for (auto &i : _annotations)
+			annotations.insert({ i.first >= _cursor_pos.line + 1 ? i.first + 1 : i.first, std::move(i.second) });
+		_annotations = std::move(annotations);
+
 		auto &new_line = *_lines.emplace(_lines.begin() + _cursor_pos.line + 1);
 		auto &line = _lines[_cursor_pos.line];
 
@@ -1134,6 +1150,14 @@ void reshade::gui::code_editor::delete_lines(size_t first_line, size_t last_line
 			errors.insert({ i.first > last_line ? i.first - (last_line - first_line) : i.first, i.second });
 	_errors = std::move(errors);
 
+	// Annotations of the deleted lines are removed, those after them are moved down
+	std::unordered_map<size_t, std::string> annotations;
+	annotations.reserve(_annotations.size());
+	for (auto &i : _annotations)
+		if (i.first - 1 < first_line || i.first - 1 > last_line)
+			annotations.insert({ i.first - 1 > last_line ? i.first - (last_line - first_line + 1) : i.first, std::move(i.second) });
+	_annotations = std::move(annotations);
+
 	_lines.erase(_lines.begin() + first_line, _lines.begin() + last_line + 1);
 }
 
@@ -1651,28 +1675,73 @@ bool reshade::gui::code_editor::find_and_scroll_to_text(const std::string &text,
 
 void reshade::gui::code_editor::colorize()
 {
+	// Merge results of a previous background tokenization as soon as it finished
+	if (_colorize_task.valid() && _colorize_task.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		apply_colors(_colorize_task.get());
+
+	if (_colorize_line_end > _lines.size())
+		_colorize_line_end = _lines.size();
 	if (_colorize_line_beg >= _colorize_line_end)
 		return;
 
-	// Step through code incrementally rather than coloring everything at once
-	const size_t from = _colorize_line_beg, to = std::min(from + 1000, _colorize_line_end);
-	_colorize_line_beg = to;
+	const size_t from = _colorize_line_beg, to = _colorize_line_end;
 
-	// Reset coloring range if we have finished coloring it after this iteration
-	if (_colorize_line_end > _lines.size())
-		_colorize_line_end = _lines.size();
-	if (_colorize_line_beg == _colorize_line_end)
-	{
-		_colorize_line_beg = std::numeric_limits<size_t>::max();
-		_colorize_line_end = 0;
-	}
+	// Small ranges (like the lines around an edit) are tokenized right away, so that typed text does not stay uncolored for a frame
+	// Larger ones (like a newly opened file) are tokenized on a worker thread, one range at a time, so that the UI does not freeze
+	const bool background = (to - from) > 1000;
+	if (background && _colorize_task.valid())
+		return; // Wait for the current task to finish before starting another one
+
+	// Reset coloring range, since it is handled now
+	_colorize_line_beg = std::numeric_limits<size_t>::max();
+	_colorize_line_end = 0;
 
 	// Copy lines into string for consumption by the lexer
 	std::string input_string;
-	for (size_t l = from; l < to && l < _lines.size(); ++l, input_string.push_back('\n'))
+	for (size_t l = from; l < to; ++l, input_string.push_back('\n'))
 		for (size_t k = 0; k < _lines[l].size(); ++k)
 			input_string.push_back(_lines[l][k].c);
 
+	if (background)
+		_colorize_task = std::async(std::launch::async, &code_editor::tokenize, std::move(input_string), from, _lines.size());
+	else
+		apply_colors(tokenize(std::move(input_string), from, _lines.size()));
+}
+void reshade::gui::code_editor::apply_colors(const colorize_result &result)
+{
+	// The text may have been edited while it was tokenized in the background, in which case lines no longer line up with the result when lines were added or removed
+	if (result.num_lines != _lines.size())
+	{
+		// Try again with the current text
+		_colorize_line_beg = std::min(_colorize_line_beg, std::min(result.line_beg, _lines.size()));
+		_colorize_line_end = std::max(_colorize_line_end, std::min(result.line_beg + std::count(result.text.begin(), result.text.end(), '\n'), _lines.size()));
+		return;
+	}
+
+	for (size_t line = result.line_beg, offset = 0; offset < result.text.size() && line < _lines.size(); ++line, ++offset)
+	{
+		const size_t line_end = result.text.find('\n', offset);
+		const size_t line_length = line_end - offset;
+
+		// Skip lines that were modified in the meantime (those were marked for coloring again when they were modified)
+		if (_lines[line].size() == line_length &&
+			std::equal(_lines[line].begin(), _lines[line].end(), result.text.begin() + offset, [](const glyph &glyph, char c) { return glyph.c == c; }))
+		{
+			for (size_t k = 0; k < line_length; ++k)
+				_lines[line][k].col = result.colors[offset + k];
+		}
+
+		offset = line_end;
+	}
+}
+
+reshade::gui::code_editor::colorize_result reshade::gui::code_editor::tokenize(std::string input_string, size_t line_beg, size_t num_lines)
+{
+	colorize_result result;
+	result.line_beg = line_beg;
+	result.num_lines = num_lines;
+	result.colors.resize(input_string.size(), color_default);
+
 	reshadefx::lexer lexer(
 		input_string,
 		false /* ignore_comments */,
@@ -1881,19 +1950,10 @@ void reshade::gui::code_editor::colorize()
 		}
 
 		// Update character range matching the current the token
-		size_t line = from + tok.location.line - 1;
-		size_t column = tok.location.column - 1;
+		std::fill_n(result.colors.begin() + tok.offset, std::min(tok.length, result.colors.size() - tok.offset), col);
+	}
 
-		for (size_t k = 0; k < tok.length; ++k)
-		{
-			if (column >= _lines[line].size())
-			{
-				line++;
-				column = 0;
-				continue;
-			}
+	result.text = std::move(input_string);
 
-			_lines[line][column++].col = col;
-		}
-	}
+	return result;
 }
@@ -7,6 +7,7 @@
 
 #include <string>
 #include <vector>
+#include <future>
 #include <unordered_map>
 
 struct ImFont;
@@ -171,6 +172,16 @@ namespace reshade::gui
 		/// </summary>
 		void clear_errors() { _errors.clear(); }
 		/// <summary>
+		/// Sets a short text to be displayed in the gutter to the left of the line numbers at the specified <paramref name="line"/>, replacing any text that was there before.
+		/// </summary>
+		/// <param name="line">The line the text should be displayed next to.</param>
+		/// <param name="text">The text that should be displayed.</param>
+		void add_annotation(size_t line, const std::string &text) { _annotations[line] = text; }
+		/// <summary>
+		/// Removes all texts displayed in the gutter that were previously added via <see cref="add_annotation"/>.
+		/// </summary>
+		void clear_annotations() { _annotations.clear(); }
+		/// <summary>
 		/// Marks the editor as no longer being modified.
 		/// </summary>
 		void clear_modified() { _undo_base_index = _undo_index; }
@@ -234,7 +245,17 @@ namespace reshade::gui
 		void move_lines_up();
 		void move_lines_down();
 
+		struct colorize_result
+		{
+			size_t line_beg = 0;
+			size_t num_lines = 0;
+			std::string text;
+			std::vector<color> colors;
+		};
+
 		void colorize();
+		void apply_colors(const colorize_result &result);
+		static colorize_result tokenize(std::string text, size_t line_beg, size_t num_lines);
 
 		// Holds the entire text split up into individual character glyphs
 		std::vector<std::vector<glyph>> _lines;
@@ -263,6 +284,7 @@ namespace reshade::gui
 		std::vector<undo_record> _undo;
 
 		std::unordered_map<size_t, std::pair<std::string, bool>> _errors;
+		std::unordered_map<size_t, std::string> _annotations;
 
 		char _search_text[256] = "";
 		char _replace_text[256] = "";
@@ -273,5 +295,6 @@ namespace reshade::gui
 
 		size_t _colorize_line_beg = 0;
 		size_t _colorize_line_end = 0;
+		std::future<colorize_result> _colorize_task;
 	};
 }
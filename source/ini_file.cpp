@@ -7,6 +7,222 @@
 #include <cassert>
 #include <fstream>
 #include <sstream>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <condition_variable>
+
+namespace
+{
+	bool write_file(const std::filesystem::path &path, const std::string &data, std::filesystem::file_time_type modified_at)
+	{
+		// Write to a temporary file and replace the original with it afterwards, so that the original is never left truncated if the process dies while writing
+		std::filesystem::path temp_path = path;
+		temp_path += L".tmp";
+
+		std::ofstream file(temp_path);
+		if (!file)
+			return false;
+
+		file.imbue(std::locale("en-us.UTF-8"));
+		file.write(data.data(), data.size());
+
+		// Flush stream to disk before replacing the original
+		file.close();
+		if (file.fail())
+			return false;
+
+		std::error_code ec;
+		std::filesystem::rename(temp_path, path, ec);
+		if (ec)
+		{
+			std::filesystem::remove(temp_path, ec);
+			return false;
+		}
+
+		// Stamp the file with the time the data was serialized at, so that 'load' and 'save' do not mistake this write for a modification by another program
+		std::filesystem::last_write_time(path, modified_at, ec);
+
+		assert(std::filesystem::file_size(path, ec) > 0);
+
+		return true;
+	}
+
+	/// <summary>
+	/// Writes serialized INI files on a background thread, so that saving does not block the render thread on disk I/O.
+	/// Multiple pending writes to the same file are coalesced, with only the most recent data being written.
+	/// </summary>
+	class ini_writer
+	{
+	public:
+		void queue(const std::filesystem::path &path, std::string &&data, std::filesystem::file_time_type modified_at)
+		{
+			{
+				const std::unique_lock<std::timed_mutex> lock(_mutex);
+
+				if (!_stopped)
+				{
+					pending_write &write = _pending[path.native()];
+					write.data = std::move(data);
+					write.modified_at = modified_at;
+
+					if (!_thread_started)
+					{
+						// The thread cannot be joined from within 'DllMain', so it is detached and told to stop instead (see 'stop')
+						std::thread(&ini_writer::thread_main, this).detach();
+						_thread_started = true;
+					}
+
+					_signal.notify_all();
+					return;
+				}
+			}
+
+			// Shutdown has begun (see 'stop'), so write synchronously rather than start another thread that would outlive the module
+			write(path, data, modified_at);
+		}
+
+		bool write(const std::filesystem::path &path, const std::string &data, std::filesystem::file_time_type modified_at)
+		{
+			// Use a timeout, in case the writer thread was terminated while holding a lock (which happens when the process exits)
+			if (const std::unique_lock<std::timed_mutex> lock(_mutex, std::chrono::seconds(1)); lock.owns_lock())
+				_pending.erase(path.native()); // Any pending write for this file has older data, so is superseded by this one
+
+			const std::unique_lock<std::timed_mutex> io_lock(_io_mutex, std::chrono::seconds(1));
+			if (!io_lock.owns_lock())
+				return false;
+
+			return write_locked(path, data, modified_at);
+		}
+
+		/// <summary>
+		/// Performs a pending write to the specified file on the calling thread, instead of waiting for the writer thread to get to it.
+		/// </summary>
+		bool flush(const std::filesystem::path &path)
+		{
+			pending_write write;
+			{
+				const std::unique_lock<std::timed_mutex> lock(_mutex, std::chrono::seconds(1));
+				if (!lock.owns_lock())
+					return false;
+
+				if (const auto it = _pending.find(path.native()); it != _pending.end())
+					write = std::move(it->second), _pending.erase(it);
+				else if (_in_flight != path.native())
+					return true;
+			}
+
+			const std::unique_lock<std::timed_mutex> io_lock(_io_mutex, std::chrono::seconds(1));
+			if (!io_lock.owns_lock())
+				return false;
+
+			// If the writer thread was already busy with this file, then it has finished with it now that the I/O lock was acquired
+			return write.data.empty() || write_locked(path, write.data, write.modified_at);
+		}
+
+		/// <summary>
+		/// Checks whether a write to the specified file was queued but has not finished yet.
+		/// </summary>
+		bool is_pending(const std::filesystem::path &path)
+		{
+			const std::unique_lock<std::timed_mutex> lock(_mutex);
+			return _in_flight == path.native() || _pending.find(path.native()) != _pending.end();
+		}
+
+		/// <summary>
+		/// Stops the writer thread after it finished all pending writes. Any writes queued after this are performed synchronously.
+		/// </summary>
+		void stop()
+		{
+			std::unique_lock<std::timed_mutex> lock(_mutex, std::chrono::seconds(1));
+			if (!lock.owns_lock())
+				return;
+
+			_stopped = true;
+			_signal.notify_all();
+
+			// Only wait for the writer thread to leave its loop, since it cannot finish exiting while the loader lock is held by 'DllMain' (see 'reshade::log::stop_writer_thread')
+			_signal.wait_for(lock, std::chrono::seconds(1), [this]() { return !_thread_started; });
+		}
+
+		/// <summary>
+		/// Checks whether any background write failed since the last call and resets that status.
+		/// </summary>
+		bool take_failure()
+		{
+			const std::unique_lock<std::timed_mutex> lock(_mutex);
+			return std::exchange(_failed, false);
+		}
+
+	private:
+		struct pending_write
+		{
+			std::string data;
+			std::filesystem::file_time_type modified_at;
+		};
+
+		bool write_locked(const std::filesystem::path &path, const std::string &data, std::filesystem::file_time_type modified_at)
+		{
+			// Skip data that is older than what was last written to this file (in case a synchronous write overtook a background one)
+			std::filesystem::file_time_type &last_written = _last_written[path.native()];
+			if (modified_at < last_written)
+				return true;
+
+			last_written = modified_at;
+			return write_file(path, data, modified_at);
+		}
+
+		void thread_main()
+		{
+			std::unique_lock<std::timed_mutex> lock(_mutex);
+
+			while (true)
+			{
+				_signal.wait(lock, [this]() { return !_pending.empty() || _stopped; });
+
+				// Finish all pending writes before stopping
+				if (_pending.empty())
+					break;
+
+				auto write = _pending.extract(_pending.begin());
+				_in_flight = write.key();
+
+				lock.unlock();
+
+				bool success = true;
+				{
+					const std::unique_lock<std::timed_mutex> io_lock(_io_mutex);
+					success = write_locked(write.key(), write.mapped().data, write.mapped().modified_at);
+				}
+
+				lock.lock();
+
+				_in_flight.clear();
+				_failed |= !success;
+			}
+
+			// This has to be the last thing this thread does before it returns out of the module (see 'stop')
+			_thread_started = false;
+			_signal.notify_all();
+		}
+
+		std::timed_mutex _mutex;
+		std::timed_mutex _io_mutex;
+		std::condition_variable_any _signal;
+		bool _thread_started = false;
+		bool _stopped = false;
+		bool _failed = false;
+		std::wstring _in_flight;
+		std::unordered_map<std::wstring, pending_write> _pending;
+		std::unordered_map<std::wstring, std::filesystem::file_time_type> _last_written;
+	};
+
+	ini_writer &writer()
+	{
+		static ini_writer *const instance = new ini_writer(); // Intentionally leaked, so that it is still usable by 'ini_file' destructors during static destruction
+		return *instance;
+	}
+}
 
 static std::unordered_map<std::wstring, reshade::ini_file> g_ini_cache;
 
@@ -17,6 +233,9 @@ reshade::ini_file::ini_file(const std::filesystem::path &path) : _path(path)
 reshade::ini_file::~ini_file()
 {
 	save();
+
+	// Make sure data of a previous background save makes it to disk too
+	writer().flush(_path);
 }
 
 void reshade::ini_file::load()
@@ -95,7 +314,7 @@ void reshade::ini_file::load()
 		}
 	}
 }
-bool reshade::ini_file::save()
+bool reshade::ini_file::save(bool async)
 {
 	if (!_modified)
 		return true;
@@ -105,8 +324,8 @@ bool reshade::ini_file::save()
 
 	std::error_code ec;
 	const std::filesystem::file_time_type modified_at = std::filesystem::last_write_time(_path, ec);
-	if (!ec && modified_at >= _modified_at)
-		return true; // File exists and was modified on disk and therefore may have different data, so cannot save
+	if (!ec && modified_at >= _modified_at && !writer().is_pending(_path))
+		return true; // File exists and was modified on disk and therefore may have different data, so cannot save (unless that modification is a background save of this file that is still in progress)
 
 	std::stringstream data;
 	std::vector<std::string> section_names, key_names;
@@ -170,21 +389,16 @@ bool reshade::ini_file::save()
 		data << '\n';
 	}
 
-	std::ofstream file(_path);
-	if (!file)
-		return false;
-
-	const std::string str = data.str();
-	file.imbue(std::locale("en-us.UTF-8"));
-	file.write(str.data(), str.size());
+	// The file is stamped with this time once written (see 'write_file')
+	_modified_at = std::filesystem::file_time_type::clock::now();
 
-	// Flush stream to disk before updating last write time
-	file.close();
-	_modified_at = std::filesystem::last_write_time(_path, ec);
-
-	assert(std::filesystem::file_size(_path, ec) > 0);
+	if (async)
+	{
+		writer().queue(_path, data.str(), _modified_at);
+		return true;
+	}
 
-	return true;
+	return writer().write(_path, data.str(), _modified_at);
 }
 
 reshade::ini_file &reshade::ini_file::load_cache(const std::filesystem::path &path)
@@ -205,15 +419,20 @@ bool reshade::ini_file::flush_cache()
 	{
 		// Check modified status before requesting file time, since the latter is costly and therefore should be avoided when not necessary
 		if (file.second._modified && (std::filesystem::file_time_type::clock::now() - file.second._modified_at) > std::chrono::seconds(1))
-			success &= file.second.save();
+			success &= file.second.save(true);
 	}
 
-	return success;
+	return success && !writer().take_failure();
 }
 bool reshade::ini_file::flush_cache(const std::filesystem::path &path)
 {
 	const auto it = g_ini_cache.find(path);
-	return it != g_ini_cache.end() && it->second.save();
+	return it != g_ini_cache.end() && it->second.save() && writer().flush(path);
+}
+
+void reshade::ini_file::stop_writer_thread()
+{
+	writer().stop();
 }
 
 reshade::ini_file &reshade::global_config()
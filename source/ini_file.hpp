@@ -129,18 +129,11 @@ namespace reshade
 		template <>
 		void set(const std::string &section, const std::string &key, const std::string &value)
 		{
-			auto &v = _sections[section][key];
-			v.assign(1, value);
-			_modified = true;
-			_modified_at = std::filesystem::file_time_type::clock::now();
+			assign(section, key, { value });
 		}
 		void set(const std::string &section, const std::string &key, std::string &&value)
 		{
-			auto &v = _sections[section][key];
-			v.resize(1);
-			v[0] = std::forward<std::string>(value);
-			_modified = true;
-			_modified_at = std::filesystem::file_time_type::clock::now();
+			assign(section, key, { std::forward<std::string>(value) });
 		}
 		template <>
 		void set(const std::string &section, const std::string &key, const std::filesystem::path &value)
@@ -150,37 +143,27 @@ namespace reshade
 		template <typename T, size_t SIZE>
 		void set(const std::string &section, const std::string &key, const T(&values)[SIZE], const size_t size = SIZE)
 		{
-			auto &v = _sections[section][key];
-			v.resize(size);
+			std::vector<std::string> v(size);
 			for (size_t i = 0; i < size; ++i)
 				v[i] = std::to_string(values[i]);
-			_modified = true;
-			_modified_at = std::filesystem::file_time_type::clock::now();
+			assign(section, key, std::move(v));
 		}
 		template <>
 		void set(const std::string &section, const std::string &key, const std::vector<std::string> &values)
 		{
-			auto &v = _sections[section][key];
-			v = values;
-			_modified = true;
-			_modified_at = std::filesystem::file_time_type::clock::now();
+			assign(section, key, std::vector<std::string>(values));
 		}
 		void set(const std::string &section, const std::string &key, std::vector<std::string> &&values)
 		{
-			auto &v = _sections[section][key];
-			v = std::forward<std::vector<std::string>>(values);
-			_modified = true;
-			_modified_at = std::filesystem::file_time_type::clock::now();
+			assign(section, key, std::forward<std::vector<std::string>>(values));
 		}
 		template <>
 		void set(const std::string &section, const std::string &key, const std::vector<std::filesystem::path> &values)
 		{
-			auto &v = _sections[section][key];
-			v.resize(values.size());
+			std::vector<std::string> v(values.size());
 			for (size_t i = 0; i < values.size(); ++i)
 				v[i] = values[i].u8string();
-			_modified = true;
-			_modified_at = std::filesystem::file_time_type::clock::now();
+			assign(section, key, std::move(v));
 		}
 
 		/// <summary>
@@ -203,12 +186,39 @@ namespace reshade
 		/// <returns>A reference to the cached data. This reference is valid until the next call to <see cref="load_cache"/>.</returns>
 		static reshade::ini_file &load_cache(const std::filesystem::path &path);
 
+		/// <summary>
+		/// Saves all cached files that were modified more than a second ago, so that continuous changes (like dragging a slider) are coalesced into a single write.
+		/// The files are written on a background thread, so this returns <see langword="false"/> if a previous background write failed.
+		/// </summary>
 		static bool flush_cache();
+		/// <summary>
+		/// Saves the specified cached file immediately and blocks until it was written to disk.
+		/// </summary>
 		static bool flush_cache(const std::filesystem::path &path);
 
+		/// <summary>
+		/// Stops the background thread that writes files saved by <see cref="flush_cache"/>, so that it no longer runs code of this module once it is unloaded.
+		/// Files saved after this are written synchronously.
+		/// </summary>
+		static void stop_writer_thread();
+
 	private:
 		void load();
-		bool save();
+		bool save(bool async = false);
+
+		/// <summary>
+		/// Replaces the value of the specified <paramref name="section"/> and <paramref name="key"/>.
+		/// This only marks the file as modified if the value actually changed, so that setting the same state again (like 'runtime::save_current_preset' does after every edit) does not cause another write to disk and does not delay a pending one (see <see cref="flush_cache"/>).
+		/// </summary>
+		void assign(const std::string &section, const std::string &key, std::vector<std::string> &&values)
+		{
+			auto &keys = _sections[section];
+			if (const auto it = keys.find(key); it != keys.end() && it->second == values)
+				return;
+			keys[key] = std::move(values);
+			_modified = true;
+			_modified_at = std::filesystem::file_time_type::clock::now();
+		}
 
 		template <typename T>
 		static const T convert(const std::vector<std::string> &values, size_t i) = delete;
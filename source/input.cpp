@@ -6,14 +6,42 @@
 #include "input.hpp"
 #include "dll_log.hpp"
 #include "hook_manager.hpp"
-#include <algorithm>
-#include <unordered_map>
+#include "lockfree_hash_table.hpp"
+#include <cstring>
 #include <Windows.h>
 
 extern HMODULE g_module_handle;
+
+struct window_info
+{
+	std::atomic<bool> raw_input = false;
+	std::atomic<unsigned int> raw_input_flags = 0;
+	// Input instances are never destroyed once created for a window, so that message processing can access them without holding a lock or reference
+	// The number of references handed out by 'register_window' tracks whether any runtime is still using it instead
+	std::atomic<reshade::input *> instance = nullptr;
+	std::atomic<unsigned long> references = 0;
+};
+
+// Windows are only added while holding the mutex, but can be looked up without it, so that processing window messages never waits on another thread
 static std::mutex s_windows_mutex;
-static std::unordered_map<HWND, unsigned int> s_raw_input_windows;
-static std::unordered_map<HWND, std::weak_ptr<reshade::input>> s_windows;
+static lockfree_hash_table<HWND, window_info *, 6> s_windows;
+
+static window_info &get_or_create_window_info(HWND window)
+{
+	// Entries are never removed, so a pointer to one stays valid forever (there usually are only a handful of windows in a process)
+	window_info *info = s_windows.at(window);
+	if (info == nullptr)
+		s_windows.emplace(window, info = new window_info());
+	return *info;
+}
+
+static reshade::input *find_active_input(HWND window)
+{
+	const window_info *const info = s_windows.at(window);
+	if (info == nullptr || info->references.load(std::memory_order_acquire) == 0)
+		return nullptr;
+	return info->instance.load(std::memory_order_acquire);
+}
 
 reshade::input::input(window_handle window)
 	: _window(window)
@@ -44,10 +72,11 @@ void reshade::input::register_window_with_raw_input(window_handle window, bool n
 
 	const std::lock_guard<std::mutex> lock(s_windows_mutex);
 
-	const auto flags = (no_legacy_keyboard ? 0x1u : 0u) | (no_legacy_mouse ? 0x2u : 0u);
-	const auto insert = s_raw_input_windows.emplace(static_cast<HWND>(window), flags);
+	window_info &info = get_or_create_window_info(static_cast<HWND>(window));
 
-	if (!insert.second) insert.first->second |= flags;
+	const auto flags = (no_legacy_keyboard ? 0x1u : 0u) | (no_legacy_mouse ? 0x2u : 0u);
+	info.raw_input_flags.fetch_or(flags, std::memory_order_relaxed);
+	info.raw_input.store(true, std::memory_order_release);
 }
 std::shared_ptr<reshade::input> reshade::input::register_window(window_handle window)
 {
@@ -55,24 +84,41 @@ std::shared_ptr<reshade::input> reshade::input::register_window(window_handle wi
 
 	const std::lock_guard<std::mutex> lock(s_windows_mutex);
 
-	const auto insert = s_windows.emplace(static_cast<HWND>(window), std::weak_ptr<input>());
+	window_info &info = get_or_create_window_info(static_cast<HWND>(window));
 
-	if (insert.second || insert.first->second.expired())
+	input *instance = info.instance.load(std::memory_order_relaxed);
+	if (instance == nullptr)
+	{
+		instance = new input(window);
+		info.instance.store(instance, std::memory_order_release);
+	}
+
+	if (info.references.load(std::memory_order_relaxed) == 0)
 	{
 #if RESHADE_VERBOSE_LOG
 		LOG(DEBUG) << "Starting input capture for window " << window << " ...";
 #endif
 
-		const auto instance = std::make_shared<input>(window);
+		// Start with a clean state, as if a new instance was created
+		instance->reset();
+	}
 
-		insert.first->second = instance;
+	info.references.fetch_add(1, std::memory_order_acq_rel);
 
-		return instance;
-	}
-	else
-	{
-		return insert.first->second.lock();
-	}
+	// Hand out a reference that does not own the instance, but just keeps track of whether it is still in use
+	return std::shared_ptr<input>(instance, [&info](input *) { info.references.fetch_sub(1, std::memory_order_acq_rel); });
+}
+
+void reshade::input::reset()
+{
+	const std::lock_guard<std::mutex> lock(_mutex);
+
+	_pending = {};
+	_frame = {};
+	_last_mouse_position[0] = _last_mouse_position[1] = 0;
+	_block_mouse.store(false, std::memory_order_relaxed);
+	_block_keyboard.store(false, std::memory_order_relaxed);
+	_frame_count.store(0, std::memory_order_relaxed);
 }
 
 bool reshade::input::handle_window_message(const void *message_data)
@@ -88,62 +134,54 @@ bool reshade::input::handle_window_message(const void *message_data)
 	if (details.message != WM_INPUT && !is_mouse_message && !is_keyboard_message)
 		return false;
 
-	// Guard access to windows list against race conditions
-	std::unique_lock<std::mutex> lock(s_windows_mutex);
-
-	// Remove any expired entry from the list
-	for (auto it = s_windows.begin(); it != s_windows.end();)
-		if (it->second.expired())
-			it = s_windows.erase(it);
-		else
-			++it;
-
 	// Look up the window in the list of known input windows
-	auto input_window = s_windows.find(details.hwnd);
-	const auto raw_input_window = s_raw_input_windows.find(details.hwnd);
+	input *input = find_active_input(details.hwnd);
 
-	if (input_window == s_windows.end())
+	if (input == nullptr)
 	{
 		// Walk through the window chain and until an known window is found
 		EnumChildWindows(details.hwnd, [](HWND hwnd, LPARAM lparam) -> BOOL {
-			auto &input_window = *reinterpret_cast<decltype(s_windows)::iterator *>(lparam);
+			auto &input = *reinterpret_cast<reshade::input **>(lparam);
 			// Return true to continue enumeration
-			return (input_window = s_windows.find(hwnd)) == s_windows.end();
-		}, reinterpret_cast<LPARAM>(&input_window));
+			return (input = find_active_input(hwnd)) == nullptr;
+		}, reinterpret_cast<LPARAM>(&input));
 	}
-	if (input_window == s_windows.end())
+	if (input == nullptr)
 	{
 		// Some applications handle input in a child window to the main render window
 		if (const HWND parent = GetParent(details.hwnd); parent != NULL)
-			input_window = s_windows.find(parent);
+			input = find_active_input(parent);
 	}
 
-	if (input_window == s_windows.end() && raw_input_window != s_raw_input_windows.end())
+	unsigned int raw_input_flags = 0;
+	const window_info *const raw_input_window = s_windows.at(details.hwnd);
+	const bool is_raw_input_window = raw_input_window != nullptr && raw_input_window->raw_input.load(std::memory_order_acquire);
+	if (is_raw_input_window)
+		raw_input_flags = raw_input_window->raw_input_flags.load(std::memory_order_relaxed);
+
+	if (input == nullptr && is_raw_input_window)
 	{
 		// Reroute this raw input message to the window with the most rendering
-		input_window = std::max_element(s_windows.begin(), s_windows.end(),
-			[](auto lhs, auto rhs) { return lhs.second.lock()->_frame_count < rhs.second.lock()->_frame_count; });
+		uint64_t max_frame_count = 0;
+		s_windows.for_each([&input, &max_frame_count](HWND window, window_info *) {
+			if (reshade::input *const candidate = find_active_input(window);
+				candidate != nullptr && (input == nullptr || candidate->_frame_count.load(std::memory_order_relaxed) > max_frame_count))
+				input = candidate,
+				max_frame_count = candidate->_frame_count.load(std::memory_order_relaxed);
+		});
 	}
 
-	if (input_window == s_windows.end())
-		return false;
-
-	const std::shared_ptr<input> input = input_window->second.lock();
-	// It may happen that the input was destroyed between the removal of expired entries above and here, so need to abort in this case
 	if (input == nullptr)
 		return false;
 
-	// At this point we have a shared pointer to the input object and no longer reference any memory from the windows list, so can release the lock
-	lock.unlock();
-
 	// Calculate window client mouse position
 	ScreenToClient(static_cast<HWND>(input->_window), &details.pt);
 
-	// Prevent input threads from modifying input while it is accessed elsewhere
-	const std::lock_guard<std::mutex> input_lock = input->lock();
+	// Only the pending state is modified here, which is not accessed by the render thread apart from briefly in 'next_frame', so this lock is never held for long
+	const std::lock_guard<std::mutex> input_lock(input->_mutex);
 
-	input->_mouse_position[0] = details.pt.x;
-	input->_mouse_position[1] = details.pt.y;
+	input->_pending.mouse_position[0] = details.pt.x;
+	input->_pending.mouse_position[1] = details.pt.y;
 
 	switch (details.message)
 	{
@@ -158,34 +196,34 @@ bool reshade::input::handle_window_message(const void *message_data)
 		case RIM_TYPEMOUSE:
 			is_mouse_message = true;
 
-			if (raw_input_window == s_raw_input_windows.end() || (raw_input_window->second & 0x2) == 0)
+			if ((raw_input_flags & 0x2) == 0)
 				break; // Input is already handled (since legacy mouse messages are enabled), so nothing to do here
 
 			if (raw_data.data.mouse.usButtonFlags & RI_MOUSE_LEFT_BUTTON_DOWN)
-				input->_keys[VK_LBUTTON] = 0x88;
+				input->_pending.keys[VK_LBUTTON] = 0x88;
 			else if (raw_data.data.mouse.usButtonFlags & RI_MOUSE_LEFT_BUTTON_UP)
-				input->_keys[VK_LBUTTON] = 0x08;
+				input->_pending.keys[VK_LBUTTON] = 0x08;
 			if (raw_data.data.mouse.usButtonFlags & RI_MOUSE_RIGHT_BUTTON_DOWN)
-				input->_keys[VK_RBUTTON] = 0x88;
+				input->_pending.keys[VK_RBUTTON] = 0x88;
 			else if (raw_data.data.mouse.usButtonFlags & RI_MOUSE_RIGHT_BUTTON_UP)
-				input->_keys[VK_RBUTTON] = 0x08;
+				input->_pending.keys[VK_RBUTTON] = 0x08;
 			if (raw_data.data.mouse.usButtonFlags & RI_MOUSE_MIDDLE_BUTTON_DOWN)
-				input->_keys[VK_MBUTTON] = 0x88;
+				input->_pending.keys[VK_MBUTTON] = 0x88;
 			else if (raw_data.data.mouse.usButtonFlags & RI_MOUSE_MIDDLE_BUTTON_UP)
-				input->_keys[VK_MBUTTON] = 0x08;
+				input->_pending.keys[VK_MBUTTON] = 0x08;
 
 			if (raw_data.data.mouse.usButtonFlags & RI_MOUSE_BUTTON_4_DOWN)
-				input->_keys[VK_XBUTTON1] = 0x88;
+				input->_pending.keys[VK_XBUTTON1] = 0x88;
 			else if (raw_data.data.mouse.usButtonFlags & RI_MOUSE_BUTTON_4_UP)
-				input->_keys[VK_XBUTTON1] = 0x08;
+				input->_pending.keys[VK_XBUTTON1] = 0x08;
 
 			if (raw_data.data.mouse.usButtonFlags & RI_MOUSE_BUTTON_5_DOWN)
-				input->_keys[VK_XBUTTON2] = 0x88;
+				input->_pending.keys[VK_XBUTTON2] = 0x88;
 			else if (raw_data.data.mouse.usButtonFlags & RI_MOUSE_BUTTON_5_UP)
-				input->_keys[VK_XBUTTON2] = 0x08;
+				input->_pending.keys[VK_XBUTTON2] = 0x08;
 
 			if (raw_data.data.mouse.usButtonFlags & RI_MOUSE_WHEEL)
-				input->_mouse_wheel_delta += static_cast<short>(raw_data.data.mouse.usButtonData) / WHEEL_DELTA;
+				input->_pending.mouse_wheel_delta += static_cast<short>(raw_data.data.mouse.usButtonData) / WHEEL_DELTA;
 			break;
 		case RIM_TYPEKEYBOARD:
 			if (raw_data.data.keyboard.VKey == 0)
@@ -193,91 +231,91 @@ bool reshade::input::handle_window_message(const void *message_data)
 
 			is_keyboard_message = true;
 			// Do not block key up messages if the key down one was not blocked previously
-			if (input->_block_keyboard && (raw_data.data.keyboard.Flags & RI_KEY_BREAK) != 0 && raw_data.data.keyboard.VKey < 0xFF && (input->_keys[raw_data.data.keyboard.VKey] & 0x04) == 0)
+			if (input->is_blocking_keyboard_input() && (raw_data.data.keyboard.Flags & RI_KEY_BREAK) != 0 && raw_data.data.keyboard.VKey < 0xFF && (input->_pending.keys[raw_data.data.keyboard.VKey] & 0x04) == 0)
 				is_keyboard_message = false;
 
-			if (raw_input_window == s_raw_input_windows.end() || (raw_input_window->second & 0x1) == 0)
+			if ((raw_input_flags & 0x1) == 0)
 				break; // Input is already handled by 'WM_KEYDOWN' and friends (since legacy keyboard messages are enabled), so nothing to do here
 
 			// Filter out prefix messages without a key code
 			if (raw_data.data.keyboard.VKey < 0xFF)
-				input->_keys[raw_data.data.keyboard.VKey] = (raw_data.data.keyboard.Flags & RI_KEY_BREAK) == 0 ? 0x88 : 0x08,
-				input->_keys_time[raw_data.data.keyboard.VKey] = details.time;
+				input->_pending.keys[raw_data.data.keyboard.VKey] = (raw_data.data.keyboard.Flags & RI_KEY_BREAK) == 0 ? 0x88 : 0x08,
+				input->_pending.keys_time[raw_data.data.keyboard.VKey] = details.time;
 
 			// No 'WM_CHAR' messages are sent if legacy keyboard messages are disabled, so need to generate text input manually here
 			// Cannot use the ToUnicode function always as it seems to reset dead key state and thus calling it can break subsequent application input, should be fine here though since the application is already explicitly using raw input
 			// Since Windows 10 version 1607 this supports the 0x2 flag, which prevents the keyboard state from being changed, so it is not a problem there anymore either way
-			if (WCHAR ch[3] = {}; (raw_data.data.keyboard.Flags & RI_KEY_BREAK) == 0 && ToUnicode(raw_data.data.keyboard.VKey, raw_data.data.keyboard.MakeCode, input->_keys, ch, 2, 0x2))
-				input->_text_input += ch;
+			if (WCHAR ch[3] = {}; (raw_data.data.keyboard.Flags & RI_KEY_BREAK) == 0 && ToUnicode(raw_data.data.keyboard.VKey, raw_data.data.keyboard.MakeCode, input->_pending.keys, ch, 2, 0x2))
+				input->_pending.text_input += ch;
 			break;
 		}
 		break;
 	case WM_CHAR:
-		input->_text_input += static_cast<wchar_t>(details.wParam);
+		input->_pending.text_input += static_cast<wchar_t>(details.wParam);
 		break;
 	case WM_KEYDOWN:
 	case WM_SYSKEYDOWN:
-		assert(details.wParam > 0 && details.wParam < ARRAYSIZE(input->_keys));
-		input->_keys[details.wParam] = 0x88;
-		input->_keys_time[details.wParam] = details.time;
-		if (input->_block_keyboard)
-			input->_keys[details.wParam] |= 0x04;
+		assert(details.wParam > 0 && details.wParam < ARRAYSIZE(input->_pending.keys));
+		input->_pending.keys[details.wParam] = 0x88;
+		input->_pending.keys_time[details.wParam] = details.time;
+		if (input->is_blocking_keyboard_input())
+			input->_pending.keys[details.wParam] |= 0x04;
 		break;
 	case WM_KEYUP:
 	case WM_SYSKEYUP:
-		assert(details.wParam > 0 && details.wParam < ARRAYSIZE(input->_keys));
+		assert(details.wParam > 0 && details.wParam < ARRAYSIZE(input->_pending.keys));
 		// Do not block key up messages if the key down one was not blocked previously (so key does not get stuck for the application)
-		if (input->_block_keyboard && (input->_keys[details.wParam] & 0x04) == 0)
+		if (input->is_blocking_keyboard_input() && (input->_pending.keys[details.wParam] & 0x04) == 0)
 			is_keyboard_message = false;
-		input->_keys[details.wParam] = 0x08;
-		input->_keys_time[details.wParam] = details.time;
+		input->_pending.keys[details.wParam] = 0x08;
+		input->_pending.keys_time[details.wParam] = details.time;
 		break;
 	case WM_LBUTTONDOWN:
 	case WM_LBUTTONDBLCLK: // Double clicking generates this sequence: WM_LBUTTONDOWN -> WM_LBUTTONUP -> WM_LBUTTONDBLCLK -> WM_LBUTTONUP, so handle it like a normal down
-		input->_keys[VK_LBUTTON] = 0x88;
+		input->_pending.keys[VK_LBUTTON] = 0x88;
 		break;
 	case WM_LBUTTONUP:
-		input->_keys[VK_LBUTTON] = 0x08;
+		input->_pending.keys[VK_LBUTTON] = 0x08;
 		break;
 	case WM_RBUTTONDOWN:
 	case WM_RBUTTONDBLCLK:
-		input->_keys[VK_RBUTTON] = 0x88;
+		input->_pending.keys[VK_RBUTTON] = 0x88;
 		break;
 	case WM_RBUTTONUP:
-		input->_keys[VK_RBUTTON] = 0x08;
+		input->_pending.keys[VK_RBUTTON] = 0x08;
 		break;
 	case WM_MBUTTONDOWN:
 	case WM_MBUTTONDBLCLK:
-		input->_keys[VK_MBUTTON] = 0x88;
+		input->_pending.keys[VK_MBUTTON] = 0x88;
 		break;
 	case WM_MBUTTONUP:
-		input->_keys[VK_MBUTTON] = 0x08;
+		input->_pending.keys[VK_MBUTTON] = 0x08;
 		break;
 	case WM_MOUSEWHEEL:
-		input->_mouse_wheel_delta += GET_WHEEL_DELTA_WPARAM(details.wParam) / WHEEL_DELTA;
+		input->_pending.mouse_wheel_delta += GET_WHEEL_DELTA_WPARAM(details.wParam) / WHEEL_DELTA;
 		break;
 	case WM_XBUTTONDOWN:
 		assert(HIWORD(details.wParam) == XBUTTON1 || HIWORD(details.wParam) == XBUTTON2);
-		input->_keys[VK_XBUTTON1 + (HIWORD(details.wParam) - XBUTTON1)] = 0x88;
+		input->_pending.keys[VK_XBUTTON1 + (HIWORD(details.wParam) - XBUTTON1)] = 0x88;
 		break;
 	case WM_XBUTTONUP:
 		assert(HIWORD(details.wParam) == XBUTTON1 || HIWORD(details.wParam) == XBUTTON2);
-		input->_keys[VK_XBUTTON1 + (HIWORD(details.wParam) - XBUTTON1)] = 0x08;
+		input->_pending.keys[VK_XBUTTON1 + (HIWORD(details.wParam) - XBUTTON1)] = 0x08;
 		break;
 	}
 
-	return (is_mouse_message && input->_block_mouse) || (is_keyboard_message && input->_block_keyboard);
+	return (is_mouse_message && input->is_blocking_mouse_input()) || (is_keyboard_message && input->is_blocking_keyboard_input());
 }
 
 bool reshade::input::is_key_down(unsigned int keycode) const
 {
-	assert(keycode < ARRAYSIZE(_keys));
-	return keycode < ARRAYSIZE(_keys) && (_keys[keycode] & 0x80) == 0x80;
+	assert(keycode < ARRAYSIZE(_frame.keys));
+	return keycode < ARRAYSIZE(_frame.keys) && (_frame.keys[keycode] & 0x80) == 0x80;
 }
 bool reshade::input::is_key_pressed(unsigned int keycode) const
 {
-	assert(keycode < ARRAYSIZE(_keys));
-	return keycode > 0 && keycode < ARRAYSIZE(_keys) && (_keys[keycode] & 0x88) == 0x88;
+	assert(keycode < ARRAYSIZE(_frame.keys));
+	return keycode > 0 && keycode < ARRAYSIZE(_frame.keys) && (_frame.keys[keycode] & 0x88) == 0x88;
 }
 bool reshade::input::is_key_pressed(unsigned int keycode, bool ctrl, bool shift, bool alt, bool force_modifiers) const
 {
@@ -292,14 +330,14 @@ bool reshade::input::is_key_pressed(unsigned int keycode, bool ctrl, bool shift,
 }
 bool reshade::input::is_key_released(unsigned int keycode) const
 {
-	assert(keycode < ARRAYSIZE(_keys));
-	return keycode > 0 && keycode < ARRAYSIZE(_keys) && (_keys[keycode] & 0x88) == 0x08;
+	assert(keycode < ARRAYSIZE(_frame.keys));
+	return keycode > 0 && keycode < ARRAYSIZE(_frame.keys) && (_frame.keys[keycode] & 0x88) == 0x08;
 }
 
 bool reshade::input::is_any_key_down() const
 {
 	// Skip mouse buttons
-	for (unsigned int i = VK_XBUTTON2 + 1; i < ARRAYSIZE(_keys); i++)
+	for (unsigned int i = VK_XBUTTON2 + 1; i < ARRAYSIZE(_frame.keys); i++)
 		if (is_key_down(i))
 			return true;
 	return false;
@@ -315,14 +353,14 @@ bool reshade::input::is_any_key_released() const
 
 unsigned int reshade::input::last_key_pressed() const
 {
-	for (unsigned int i = VK_XBUTTON2 + 1; i < ARRAYSIZE(_keys); i++)
+	for (unsigned int i = VK_XBUTTON2 + 1; i < ARRAYSIZE(_frame.keys); i++)
 		if (is_key_pressed(i))
 			return i;
 	return 0;
 }
 unsigned int reshade::input::last_key_released() const
 {
-	for (unsigned int i = VK_XBUTTON2 + 1; i < ARRAYSIZE(_keys); i++)
+	for (unsigned int i = VK_XBUTTON2 + 1; i < ARRAYSIZE(_frame.keys); i++)
 		if (is_key_released(i))
 			return i;
 	return 0;
@@ -368,40 +406,54 @@ bool reshade::input::is_any_mouse_button_released() const
 
 void reshade::input::next_frame()
 {
-	_frame_count++;
+	_frame_count.fetch_add(1, std::memory_order_relaxed);
 
-	for (auto &state : _keys)
-		state &= ~0x08;
+	// Query system key state before taking the lock, to keep the time it is held as short as possible
+	const DWORD time = GetTickCount();
+	const bool caps_lock_toggled = (GetKeyState(VK_CAPITAL) & 0x1) != 0;
+	const bool menu_down = (GetKeyState(VK_MENU) & 0x8000) != 0;
+	const bool snapshot_down = (GetAsyncKeyState(VK_SNAPSHOT) & 0x8000) != 0;
+
+	const std::lock_guard<std::mutex> lock(_mutex);
 
 	// Reset any pressed down key states (apart from mouse buttons) that have not been updated for more than 5 seconds
 	// Do not check mouse buttons here, since 'GetAsyncKeyState' always returns the state of the physical mouse buttons, not the logical ones in case they were remapped
 	// See https://docs.microsoft.com/windows/win32/api/winuser/nf-winuser-getasynckeystate
 	// And time is not tracked for mouse buttons anyway
-	const DWORD time = GetTickCount();
 	for (unsigned int i = 8; i < 256; ++i)
-		if ((_keys[i] & 0x80) != 0 &&
-			(time - _keys_time[i]) > 5000 &&
+		if ((_pending.keys[i] & 0x80) != 0 &&
+			(time - _pending.keys_time[i]) > 5000 &&
 			(GetAsyncKeyState(i) & 0x8000) == 0)
-			(_keys[i] = 0x08);
-
-	_text_input.clear();
-	_mouse_wheel_delta = 0;
-	_last_mouse_position[0] = _mouse_position[0];
-	_last_mouse_position[1] = _mouse_position[1];
+			(_pending.keys[i] = 0x08);
 
 	// Update caps lock state
-	_keys[VK_CAPITAL] |= GetKeyState(VK_CAPITAL) & 0x1;
+	_pending.keys[VK_CAPITAL] |= caps_lock_toggled ? 0x1 : 0x0;
 
 	// Update modifier key state
-	if ((_keys[VK_MENU] & 0x88) != 0 &&
-		(GetKeyState(VK_MENU) & 0x8000) == 0)
-		(_keys[VK_MENU] = 0x08);
+	if ((_pending.keys[VK_MENU] & 0x88) != 0 && !menu_down)
+		(_pending.keys[VK_MENU] = 0x08);
 
 	// Update print screen state (there is no key down message, but the key up one is received via the message queue)
-	if ((_keys[VK_SNAPSHOT] & 0x80) == 0 &&
-		(GetAsyncKeyState(VK_SNAPSHOT) & 0x8000) != 0)
-		(_keys[VK_SNAPSHOT] = 0x88),
-		(_keys_time[VK_SNAPSHOT] = time);
+	if ((_pending.keys[VK_SNAPSHOT] & 0x80) == 0 && snapshot_down)
+		(_pending.keys[VK_SNAPSHOT] = 0x88),
+		(_pending.keys_time[VK_SNAPSHOT] = time);
+
+	// Publish the state accumulated since the last frame, so that it can be read without holding the lock while window messages keep modifying the pending state
+	_last_mouse_position[0] = _frame.mouse_position[0];
+	_last_mouse_position[1] = _frame.mouse_position[1];
+
+	std::memcpy(_frame.keys, _pending.keys, sizeof(_frame.keys));
+	_frame.mouse_wheel_delta = _pending.mouse_wheel_delta;
+	_frame.mouse_position[0] = _pending.mouse_position[0];
+	_frame.mouse_position[1] = _pending.mouse_position[1];
+	_frame.text_input.swap(_pending.text_input);
+
+	// Reset state that only applies to a single frame
+	for (auto &state : _pending.keys)
+		state &= ~0x08;
+
+	_pending.text_input.clear();
+	_pending.mouse_wheel_delta = 0;
 }
 
 std::string reshade::input::key_name(unsigned int keycode)
@@ -458,17 +510,21 @@ std::string reshade::input::key_name(const unsigned int key[4])
 
 static inline bool is_blocking_mouse_input()
 {
-	const auto predicate = [](auto input_window) {
-		return !input_window.second.expired() && input_window.second.lock()->is_blocking_mouse_input();
-	};
-	return std::any_of(s_windows.cbegin(), s_windows.cend(), predicate);
+	bool blocking = false;
+	s_windows.for_each([&blocking](HWND window, window_info *) {
+		if (const reshade::input *const input = find_active_input(window))
+			blocking |= input->is_blocking_mouse_input();
+	});
+	return blocking;
 }
 static inline bool is_blocking_keyboard_input()
 {
-	const auto predicate = [](auto input_window) {
-		return !input_window.second.expired() && input_window.second.lock()->is_blocking_keyboard_input();
-	};
-	return std::any_of(s_windows.cbegin(), s_windows.cend(), predicate);
+	bool blocking = false;
+	s_windows.for_each([&blocking](HWND window, window_info *) {
+		if (const reshade::input *const input = find_active_input(window))
+			blocking |= input->is_blocking_keyboard_input();
+	});
+	return blocking;
 }
 
 // The "PeekMessage" functions may be called very frequently, so cache trampoline pointers
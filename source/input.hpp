@@ -6,6 +6,7 @@
 #pragma once
 
 #include <mutex>
+#include <atomic>
 #include <memory>
 #include <string>
 
@@ -51,37 +52,32 @@ namespace reshade
 		bool is_any_mouse_button_down() const;
 		bool is_any_mouse_button_pressed() const;
 		bool is_any_mouse_button_released() const;
-		short mouse_wheel_delta() const { return _mouse_wheel_delta; }
-		int mouse_movement_delta_x() const { return _mouse_position[0] - _last_mouse_position[0]; }
-		int mouse_movement_delta_y() const { return _mouse_position[1] - _last_mouse_position[1]; }
-		unsigned int mouse_position_x() const { return _mouse_position[0]; }
-		unsigned int mouse_position_y() const { return _mouse_position[1]; }
+		short mouse_wheel_delta() const { return _frame.mouse_wheel_delta; }
+		int mouse_movement_delta_x() const { return _frame.mouse_position[0] - _last_mouse_position[0]; }
+		int mouse_movement_delta_y() const { return _frame.mouse_position[1] - _last_mouse_position[1]; }
+		unsigned int mouse_position_x() const { return _frame.mouse_position[0]; }
+		unsigned int mouse_position_y() const { return _frame.mouse_position[1]; }
 
 		/// <summary>
 		/// Returns the character input as captured by 'WM_CHAR' for the current frame.
 		/// </summary>
-		const std::wstring &text_input() const { return _text_input; }
+		const std::wstring &text_input() const { return _frame.text_input; }
 
 		/// <summary>
 		/// Set to <c>true</c> to prevent mouse input window messages from reaching the application.
 		/// </summary>
-		void block_mouse_input(bool enable) { _block_mouse = enable; }
-		bool is_blocking_mouse_input() const { return _block_mouse; }
+		void block_mouse_input(bool enable) { _block_mouse.store(enable, std::memory_order_relaxed); }
+		bool is_blocking_mouse_input() const { return _block_mouse.load(std::memory_order_relaxed); }
 		/// <summary>
 		/// Set to <c>true</c> to prevent keyboard input window messages from reaching the application.
 		/// </summary>
-		void block_keyboard_input(bool enable) { _block_keyboard = enable; }
-		bool is_blocking_keyboard_input() const { return _block_keyboard; }
-
-		/// <summary>
-		/// Locks access to the input data to the current thread.
-		/// </summary>
-		/// <returns>A RAII object holding the lock, which releases it after going out of scope.</returns>
-		auto lock() { return std::lock_guard<std::mutex>(_mutex); }
+		void block_keyboard_input(bool enable) { _block_keyboard.store(enable, std::memory_order_relaxed); }
+		bool is_blocking_keyboard_input() const { return _block_keyboard.load(std::memory_order_relaxed); }
 
 		/// <summary>
 		/// Notifies the input manager to advance a frame.
-		/// This updates input state to e.g. track whether a key was pressed this frame or before.
+		/// This publishes all input received since the last call to the state returned by the query functions above, so call it before reading input for a frame.
+		/// The query functions read that state without any synchronization, so only call them from the thread that calls this function.
 		/// </summary>
 		void next_frame();
 
@@ -104,16 +100,25 @@ namespace reshade
 		static bool handle_window_message(const void *message_data);
 
 	private:
+		struct state
+		{
+			uint8_t keys[256] = {};
+			unsigned int keys_time[256] = {};
+			short mouse_wheel_delta = 0;
+			unsigned int mouse_position[2] = {};
+			std::wstring text_input;
+		};
+
+		void reset();
+
+		// Protects the pending state, which is only held for short durations by either the window message processing or while publishing it in 'next_frame'
 		std::mutex _mutex;
 		window_handle _window;
-		bool _block_mouse = false;
-		bool _block_keyboard = false;
-		uint8_t _keys[256] = {};
-		unsigned int _keys_time[256] = {};
-		short _mouse_wheel_delta = 0;
-		unsigned int _mouse_position[2] = {};
+		std::atomic<bool> _block_mouse = false;
+		std::atomic<bool> _block_keyboard = false;
+		state _pending; // State modified by window messages
+		state _frame; // State published for the current frame
 		unsigned int _last_mouse_position[2] = {};
-		uint64_t _frame_count = 0; // Keep track of frame count to identify windows with a lot of rendering
-		std::wstring _text_input;
+		std::atomic<uint64_t> _frame_count = 0; // Keep track of frame count to identify windows with a lot of rendering
 	};
 }
@@ -0,0 +1,363 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <cassert>
+#include <utility>
+#include <type_traits>
+#include <emmintrin.h>
+
+/// <summary>
+/// A lock-free open addressing hash table of pointers, which grows by chaining additional, larger tables once a key no longer fits into the existing ones.
+/// Keys are stored separately from values and grouped into cache lines, which are compared against a key with SIMD instructions, so that a look up usually touches a single cache line of keys.
+/// Levels are only freed when the table is destroyed, so readers never access freed memory while the table grows (and no further memory reclamation scheme is necessary).
+/// The key values "zero", "one" and "two" hold a special meaning (see <see cref="no_value"/>, <see cref="update_value"/> and <see cref="erased_value"/>), so do not use them.
+/// </summary>
+template <typename TKey, typename TValue, size_t INITIAL_SIZE_LOG2 = 12>
+class lockfree_hash_table
+{
+	static_assert(std::is_pointer_v<TValue>);
+	static_assert(sizeof(TKey) == 4 || sizeof(TKey) == 8);
+	static_assert(sizeof(std::atomic<TKey>) == sizeof(TKey) && std::atomic<TKey>::is_always_lock_free);
+
+	// Number of keys that fit into a single cache line
+	static constexpr size_t KEYS_PER_LINE = 64 / sizeof(TKey);
+	static constexpr size_t KEYS_PER_LINE_LOG2 = sizeof(TKey) == 8 ? 3 : 4;
+	// Number of cache lines that are probed in every level before moving on to the next one
+	static constexpr size_t MAX_LINE_PROBES = 4;
+
+	static_assert(INITIAL_SIZE_LOG2 >= KEYS_PER_LINE_LOG2);
+
+public:
+	/// <summary>
+	/// Special key indicating that the entry was never used.
+	/// </summary>
+	static constexpr TKey no_value = (TKey)0;
+	/// <summary>
+	/// Special key indicating that the entry is currently being updated.
+	/// </summary>
+	static constexpr TKey update_value = (TKey)1;
+	/// <summary>
+	/// Special key indicating that the entry was used before, but its value was erased since.
+	/// Entries never become empty again, so that a look up may stop probing at the first empty entry.
+	/// </summary>
+	static constexpr TKey erased_value = (TKey)2;
+
+	lockfree_hash_table() : _first(INITIAL_SIZE_LOG2) {}
+	~lockfree_hash_table()
+	{
+		for (level *it = _first.next.load(std::memory_order_acquire), *next; it != nullptr; it = next)
+		{
+			next = it->next.load(std::memory_order_acquire);
+			delete it;
+		}
+	}
+
+	/// <summary>
+	/// Gets the pointer associated with the specified <paramref name="key"/>.
+	/// This is a weak look up and may fail if another thread is erasing a value at the same time.
+	/// </summary>
+	/// <param name="key">The key to look up.</param>
+	/// <returns>The pointer associated with the key or <c>nullptr</c> if it was not found.</returns>
+	TValue at(TKey key) const
+	{
+		assert(key != no_value && key != update_value && key != erased_value);
+
+		for (const level *it = &_first; it != nullptr; it = it->next.load(std::memory_order_acquire))
+		{
+			for (size_t probe = 0, line = it->line_of(key); probe < MAX_LINE_PROBES; ++probe, line = (line + 1) & it->line_mask)
+			{
+				const key_line &keys = it->keys[line];
+
+				for (uint32_t mask = keys.match(key), i = 0; mask != 0; mask >>= 1, ++i)
+				{
+					// The SIMD comparison is only a filter, so confirm the match with an atomic load (which also orders the load of the value after it)
+					if ((mask & 1) == 0 || keys.keys[i].load(std::memory_order_acquire) != key)
+						continue;
+
+					return it->values[(line << KEYS_PER_LINE_LOG2) + i].load(std::memory_order_relaxed);
+				}
+
+				// Keys are added to the first line with a free entry, so if this line has an empty entry, the key cannot be in any later line or level
+				if (keys.match(no_value) != 0)
+					return nullptr;
+			}
+		}
+
+		return nullptr;
+	}
+
+	/// <summary>
+	/// Adds the specified key-pointer pair to the table.
+	/// The key must not already exist in the table.
+	/// </summary>
+	/// <param name="key">The key to add.</param>
+	/// <param name="value">The pointer to add.</param>
+	void emplace(TKey key, TValue value)
+	{
+		assert(key != no_value && key != update_value && key != erased_value);
+
+		// Adds a new level if the key does not fit into any of the existing ones, so this never fails
+		for (level *it = &_first;; it = it->next_or_grow())
+		{
+			for (size_t probe = 0, line = it->line_of(key); probe < MAX_LINE_PROBES; ++probe, line = (line + 1) & it->line_mask)
+			{
+				key_line &keys = it->keys[line];
+
+				for (uint32_t mask = keys.match(no_value) | keys.match(erased_value), i = 0; mask != 0; mask >>= 1, ++i)
+				{
+					if ((mask & 1) == 0)
+						continue;
+
+					if (TKey test_key = keys.keys[i].load(std::memory_order_relaxed);
+						(test_key == no_value || test_key == erased_value) &&
+						keys.keys[i].compare_exchange_strong(test_key, update_value, std::memory_order_relaxed))
+					{
+						it->values[(line << KEYS_PER_LINE_LOG2) + i].store(value, std::memory_order_relaxed);
+
+						keys.keys[i].store(key, std::memory_order_release);
+						return;
+					}
+				}
+			}
+		}
+	}
+
+	/// <summary>
+	/// Removes and returns the pointer associated with the specified <paramref name="key"/> from the table.
+	/// </summary>
+	/// <param name="key">The key to look up.</param>
+	/// <returns>The removed pointer if the key existed, <c>nullptr</c> otherwise.</returns>
+	TValue erase(TKey key)
+	{
+		if (key == no_value || key == update_value || key == erased_value) // Cannot remove special keys
+			return nullptr;
+
+		for (level *it = &_first; it != nullptr; it = it->next.load(std::memory_order_acquire))
+		{
+			for (size_t probe = 0, line = it->line_of(key); probe < MAX_LINE_PROBES; ++probe, line = (line + 1) & it->line_mask)
+			{
+				key_line &keys = it->keys[line];
+
+				for (uint32_t mask = keys.match(key), i = 0; mask != 0; mask >>= 1, ++i)
+				{
+					if ((mask & 1) == 0)
+						continue;
+
+					// Load and check before doing an expensive CAS
+					if (TKey test_key = keys.keys[i].load(std::memory_order_acquire);
+						test_key == key)
+					{
+						// Get the value before freeing the entry up for other threads to fill again
+						const TValue old_value = it->values[(line << KEYS_PER_LINE_LOG2) + i].load(std::memory_order_relaxed);
+
+						if (keys.keys[i].compare_exchange_strong(test_key, erased_value, std::memory_order_relaxed))
+							return old_value;
+					}
+				}
+
+				if (keys.match(no_value) != 0)
+					return nullptr;
+			}
+		}
+
+		return nullptr;
+	}
+
+	/// <summary>
+	/// Calls the specified function for every key-pointer pair in the table.
+	/// Pairs that are added or removed by other threads at the same time may or may not be visited.
+	/// </summary>
+	template <typename F>
+	void for_each(F &&func) const
+	{
+		for (const level *it = &_first; it != nullptr; it = it->next.load(std::memory_order_acquire))
+		{
+			for (size_t line = 0; line <= it->line_mask; ++line)
+			{
+				for (size_t i = 0; i < KEYS_PER_LINE; ++i)
+				{
+					if (const TKey key = it->keys[line].keys[i].load(std::memory_order_acquire);
+						key != no_value && key != update_value && key != erased_value)
+						func(key, it->values[(line << KEYS_PER_LINE_LOG2) + i].load(std::memory_order_relaxed));
+				}
+			}
+		}
+	}
+
+	/// <summary>
+	/// Clears the entire table.
+	/// Levels that were added are kept around, so that they do not have to be allocated again.
+	/// </summary>
+	void clear()
+	{
+		for (level *it = &_first; it != nullptr; it = it->next.load(std::memory_order_acquire))
+			for (size_t line = 0; line <= it->line_mask; ++line)
+				for (std::atomic<TKey> &key : it->keys[line].keys)
+					key.exchange(no_value);
+	}
+
+private:
+	static uint64_t key_bits(TKey key)
+	{
+		if constexpr (std::is_pointer_v<TKey>)
+			return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(key));
+		else
+			return static_cast<uint64_t>(key);
+	}
+
+	struct alignas(64) key_line
+	{
+		std::atomic<TKey> keys[KEYS_PER_LINE] = {};
+
+		/// <summary>
+		/// Returns a bit mask with a bit set for every key in this line that is equal to the specified one.
+		/// This reads the keys non-atomically, so the result may be out of date and has to be confirmed with an atomic load.
+		/// </summary>
+		uint32_t match(TKey key) const
+		{
+			const __m128i *const data = reinterpret_cast<const __m128i *>(keys);
+			const uint64_t bits = key_bits(key);
+
+			uint32_t mask = 0;
+			if constexpr (sizeof(TKey) == 8)
+			{
+				const __m128i value = _mm_set_epi32(static_cast<int>(bits >> 32), static_cast<int>(bits), static_cast<int>(bits >> 32), static_cast<int>(bits));
+
+				for (uint32_t i = 0; i < 4; ++i)
+				{
+					// There is no 64-bit comparison in SSE2, so compare both halves separately and combine the results
+					const __m128i equal_halves = _mm_cmpeq_epi32(_mm_load_si128(data + i), value);
+					const __m128i equal = _mm_and_si128(equal_halves, _mm_shuffle_epi32(equal_halves, _MM_SHUFFLE(2, 3, 0, 1)));
+					mask |= static_cast<uint32_t>(_mm_movemask_pd(_mm_castsi128_pd(equal))) << (i * 2);
+				}
+			}
+			else
+			{
+				const __m128i value = _mm_set1_epi32(static_cast<int>(bits));
+
+				for (uint32_t i = 0; i < 4; ++i)
+					mask |= static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_load_si128(data + i), value)))) << (i * 4);
+			}
+
+			return mask;
+		}
+	};
+
+	struct level
+	{
+		explicit level(size_t size_log2) :
+			line_mask((size_t(1) << (size_log2 - KEYS_PER_LINE_LOG2)) - 1),
+			line_shift(64 - (size_log2 - KEYS_PER_LINE_LOG2)),
+			size_log2(size_log2),
+			keys(new key_line[size_t(1) << (size_log2 - KEYS_PER_LINE_LOG2)]),
+			values(new std::atomic<TValue>[size_t(1) << size_log2]) {}
+
+		size_t line_of(TKey key) const
+		{
+			// Fibonacci hashing, so that handles which only differ in their low bits (like pointers aligned to the allocation granularity) still end up in different lines
+			// The shift is split in two, so that it is well defined for a level that consists of a single line too
+			return static_cast<size_t>(((key_bits(key) * 0x9E3779B97F4A7C15ull) >> 1) >> (line_shift - 1));
+		}
+
+		level *next_or_grow()
+		{
+			if (level *const existing = next.load(std::memory_order_acquire); existing != nullptr)
+				return existing;
+
+			// Each level is twice as big as the previous one, so only a few levels are ever needed
+			level *const new_level = new level(size_log2 + 1);
+			if (level *expected = nullptr; !next.compare_exchange_strong(expected, new_level, std::memory_order_acq_rel))
+			{
+				// Another thread added a level in the meantime, so use that one instead
+				delete new_level;
+				return expected;
+			}
+
+			return new_level;
+		}
+
+		const size_t line_mask;
+		const size_t line_shift;
+		const size_t size_log2;
+		const std::unique_ptr<key_line[]> keys;
+		const std::unique_ptr<std::atomic<TValue>[]> values;
+		std::atomic<level *> next = nullptr;
+	};
+
+	level _first;
+};
+
+/// <summary>
+/// Overload of the lock-free hash table for non-pointer value types, which owns a heap allocated copy of every value.
+/// </summary>
+template <typename TKey, typename TValue, size_t INITIAL_SIZE_LOG2 = 12>
+class lockfree_hash_table_of_values
+{
+public:
+	~lockfree_hash_table_of_values()
+	{
+		_table.for_each([](TKey, TValue *value) { delete value; });
+	}
+
+	/// <summary>
+	/// Gets the value associated with the specified <paramref name="key"/>.
+	/// This is a weak look up and may fail if another thread is erasing a value at the same time.
+	/// </summary>
+	/// <param name="key">The key to look up.</param>
+	/// <returns>A reference to the associated value.</returns>
+	TValue &at(TKey key) const
+	{
+		TValue *const value = _table.at(key);
+		if (value != nullptr)
+			return *value;
+
+		assert(false);
+		return default_value(); // Fall back if key does not exist
+	}
+
+	/// <summary>
+	/// Adds the specified key-value pair to the table.
+	/// </summary>
+	/// <param name="key">The key to add.</param>
+	/// <param name="args">The constructor arguments to use for creation.</param>
+	/// <returns>A reference to the newly added value.</returns>
+	template <typename... Args>
+	TValue &emplace(TKey key, Args... args)
+	{
+		TValue *const new_value = new TValue(std::forward<Args>(args)...);
+		_table.emplace(key, new_value);
+		return *new_value;
+	}
+
+	/// <summary>
+	/// Removes the value associated with the specified <paramref name="key"/> from the table.
+	/// </summary>
+	/// <param name="key">The key to look up.</param>
+	/// <returns><c>true</c> if the key existed and was removed, <c>false</c> otherwise.</returns>
+	bool erase(TKey key)
+	{
+		TValue *const old_value = _table.erase(key);
+		if (old_value != nullptr)
+		{
+			delete old_value;
+			return true;
+		}
+		return false;
+	}
+
+private:
+	static inline TValue &default_value()
+	{
+		// Make default value thread local, so no data races occur after multiple threads failed to access a value
+		static thread_local TValue _ = {}; return _;
+	}
+
+	lockfree_hash_table<TKey, TValue *, INITIAL_SIZE_LOG2> _table;
+};
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+namespace reshade
+{
+	/// <summary>
+	/// Log-linear histogram of the last <typeparamref name="SAMPLES"/> values (in the style of an HDR histogram), to read percentiles from in fixed memory.
+	/// Values below 32 are counted exactly, every following power of two is split into 32 buckets, so percentiles have a relative error of at most 1/32.
+	/// </summary>
+	template <size_t SAMPLES>
+	class moving_histogram
+	{
+		static constexpr unsigned int sub_bucket_bits = 5;
+		static constexpr unsigned int sub_bucket_count = 1u << sub_bucket_bits;
+		// Values up to 2^40 are distinguished (about 18 minutes in nanoseconds), larger ones all end up in the last bucket
+		static constexpr unsigned int max_value_bits = 40;
+		static constexpr size_t bucket_count = (max_value_bits - sub_bucket_bits + 1) * sub_bucket_count;
+
+	public:
+		moving_histogram() : _index(0), _count(0), _samples(), _buckets() {}
+
+		size_t count() const { return _count; }
+
+		void clear()
+		{
+			_index = 0;
+			_count = 0;
+
+			for (size_t i = 0; i < SAMPLES; i++)
+				_samples[i] = 0;
+			for (size_t i = 0; i < bucket_count; i++)
+				_buckets[i] = 0;
+		}
+		void append(uint64_t value)
+		{
+			// Remove the oldest value from the histogram once the window is full
+			if (_count == SAMPLES)
+				_buckets[_samples[_index]]--;
+			else
+				_count++;
+
+			const uint16_t bucket = bucket_index(value);
+			_samples[_index] = bucket;
+			_buckets[bucket]++;
+
+			_index = ++_index % SAMPLES;
+		}
+
+		/// <summary>
+		/// Gets the values at the specified percentiles (in ascending order and in the range 0 to 100) in a single pass over the buckets.
+		/// Each value is the highest one that falls into the same bucket as the actual value, so is never lower than it (zero if no values were appended yet).
+		/// </summary>
+		template <size_t N>
+		void percentiles(const float (&p)[N], uint64_t (&values)[N]) const
+		{
+			size_t i = 0;
+			size_t total = 0;
+			for (size_t bucket = 0; bucket < bucket_count && i < N && _count != 0; ++bucket)
+			{
+				total += _buckets[bucket];
+
+				for (; i < N && total >= rank(p[i]); ++i)
+					values[i] = highest_equivalent_value(bucket);
+			}
+			for (; i < N; ++i)
+				values[i] = 0;
+		}
+		uint64_t percentile(float p) const
+		{
+			const float ps[1] = { p };
+			uint64_t values[1];
+			percentiles(ps, values);
+			return values[0];
+		}
+
+	private:
+		// Number of values that are lower than or equal to the value at percentile 'p'
+		size_t rank(float p) const
+		{
+			const size_t rank = static_cast<size_t>(std::ceil(p * _count / 100.0f));
+			return std::min(std::max(rank, size_t(1)), _count);
+		}
+		static uint16_t bucket_index(uint64_t value)
+		{
+			if (value < sub_bucket_count)
+				return static_cast<uint16_t>(value);
+
+			unsigned int msb = sub_bucket_bits;
+			while (msb < 63 && (value >> (msb + 1)) != 0)
+				++msb;
+			if (msb >= max_value_bits)
+				return static_cast<uint16_t>(bucket_count - 1);
+
+			// The top bits below the most significant one select the sub-bucket within the power of two
+			const unsigned int shift = msb - sub_bucket_bits;
+			return static_cast<uint16_t>((shift + 1) * sub_bucket_count + ((value >> shift) & (sub_bucket_count - 1)));
+		}
+		static uint64_t highest_equivalent_value(size_t bucket)
+		{
+			if (bucket < sub_bucket_count)
+				return bucket;
+
+			const unsigned int shift = static_cast<unsigned int>(bucket / sub_bucket_count) - 1;
+			const uint64_t lowest = (uint64_t(1) << (shift + sub_bucket_bits)) | (uint64_t(bucket % sub_bucket_count) << shift);
+			return lowest + (uint64_t(1) << shift) - 1;
+		}
+
+		size_t _index;
+		size_t _count;
+		uint16_t _samples[SAMPLES];
+		uint32_t _buckets[bucket_count];
+	};
+}
@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include "opengl.hpp"
+#include <cstdint>
+#include <algorithm>
+
+namespace reshade::opengl
+{
+	/// <summary>
+	/// Shadow copy of the object bindings of a context, which the hooks keep up to date as the application changes them, so that translating calls into add-on events does not have to query the driver (which may synchronize with the driver thread).
+	/// Bindings that were not set through a hook since they were last invalidated are queried from the driver on first use.
+	/// Anything else that modifies these bindings without restoring them afterwards has to update or invalidate them.
+	/// </summary>
+	class binding_cache
+	{
+	public:
+		/// <summary>
+		/// Number of texture units for which the 2D texture and sampler bindings are tracked individually (matches what <see cref="state_block"/> saves and restores).
+		/// </summary>
+		static constexpr GLuint num_texture_units = 32;
+
+		/// <summary>
+		/// Gets the value of the binding with the specified <paramref name="pname"/>, same as <c>glGetIntegerv</c>.
+		/// </summary>
+		GLint get(GLenum pname)
+		{
+			if (pname == GL_TEXTURE_BINDING_2D || pname == GL_SAMPLER_BINDING)
+			{
+				if (const GLuint unit = get(GL_ACTIVE_TEXTURE) - GL_TEXTURE0; unit < num_texture_units)
+				{
+					const bool is_sampler = pname == GL_SAMPLER_BINDING;
+					uint32_t &valid_mask = is_sampler ? _sampler_valid_mask : _texture_2d_valid_mask;
+					GLint &value = is_sampler ? _samplers[unit] : _textures_2d[unit];
+
+					if ((valid_mask & (1u << unit)) == 0)
+					{
+						value = 0;
+						glGetIntegerv(pname, &value);
+						valid_mask |= (1u << unit);
+					}
+
+					return value;
+				}
+			}
+
+			const uint32_t slot = slot_of(pname);
+			if (slot == invalid_slot)
+			{
+				GLint value = 0;
+				glGetIntegerv(pname, &value);
+				return value;
+			}
+
+			if ((_valid_mask & (1u << slot)) == 0)
+			{
+				_values[slot] = 0;
+				glGetIntegerv(pname, &_values[slot]);
+				_valid_mask |= (1u << slot);
+			}
+
+			return _values[slot];
+		}
+		/// <summary>
+		/// Checks whether the binding with the specified <paramref name="pname"/> is known to have the specified <paramref name="value"/>, without querying the driver.
+		/// </summary>
+		bool matches(GLenum pname, GLint value) const
+		{
+			const uint32_t slot = slot_of(pname);
+			return slot != invalid_slot && (_valid_mask & (1u << slot)) != 0 && _values[slot] == value;
+		}
+		/// <summary>
+		/// Gets the 2D texture and sampler bound to the specified texture <paramref name="unit"/>, without querying the driver.
+		/// </summary>
+		/// <returns><see langword="true"/> if both bindings are known, <see langword="false"/> otherwise.</returns>
+		bool get_texture_unit(GLuint unit, GLint &texture_2d, GLint &sampler) const
+		{
+			if (unit >= num_texture_units || (_texture_2d_valid_mask & _sampler_valid_mask & (1u << unit)) == 0)
+				return false;
+
+			texture_2d = _textures_2d[unit];
+			sampler = _samplers[unit];
+			return true;
+		}
+
+		/// <summary>
+		/// Updates the value of the binding with the specified <paramref name="pname"/> after it was changed.
+		/// </summary>
+		void set(GLenum pname, GLint value)
+		{
+			if (pname == GL_TEXTURE_BINDING_2D || pname == GL_SAMPLER_BINDING)
+			{
+				if (const GLuint unit = get(GL_ACTIVE_TEXTURE) - GL_TEXTURE0; unit < num_texture_units)
+				{
+					if (pname == GL_SAMPLER_BINDING)
+						set_sampler(unit, value);
+					else
+						set_texture_unit_2d(unit, value);
+				}
+				return;
+			}
+
+			if (const uint32_t slot = slot_of(pname); slot != invalid_slot)
+			{
+				// All other texture bindings are only tracked for the active texture unit, so have to start over when it changes
+				if (slot == 0 && ((_valid_mask & 1u) == 0 || _values[0] != value))
+					_valid_mask &= ~active_unit_texture_slots_mask;
+
+				_values[slot] = value;
+				_valid_mask |= (1u << slot);
+			}
+		}
+		/// <summary>
+		/// Updates the 2D texture binding of the specified texture <paramref name="unit"/> after it was changed.
+		/// </summary>
+		void set_texture_unit_2d(GLuint unit, GLint texture)
+		{
+			if (unit < num_texture_units)
+			{
+				_textures_2d[unit] = texture;
+				_texture_2d_valid_mask |= (1u << unit);
+			}
+		}
+		/// <summary>
+		/// Updates the sampler binding of the specified texture <paramref name="unit"/> after it was changed.
+		/// </summary>
+		void set_sampler(GLuint unit, GLint sampler)
+		{
+			if (unit < num_texture_units)
+			{
+				_samplers[unit] = sampler;
+				_sampler_valid_mask |= (1u << unit);
+			}
+		}
+
+		/// <summary>
+		/// Marks the binding with the specified <paramref name="pname"/> as unknown, so that it is queried again on next use.
+		/// </summary>
+		void invalidate(GLenum pname)
+		{
+			if (const uint32_t slot = slot_of(pname); slot != invalid_slot)
+				_valid_mask &= ~(1u << slot);
+		}
+		/// <summary>
+		/// Marks all buffer bindings as unknown, e.g. after buffers were deleted (which resets the bindings they were bound to).
+		/// </summary>
+		void invalidate_buffers()
+		{
+			_valid_mask &= ~buffer_slots_mask;
+		}
+		/// <summary>
+		/// Marks all texture bindings of all texture units as unknown, e.g. after textures were deleted.
+		/// </summary>
+		void invalidate_textures()
+		{
+			_valid_mask &= ~active_unit_texture_slots_mask;
+			_texture_2d_valid_mask = 0;
+		}
+		/// <summary>
+		/// Marks the texture bindings of the specified range of texture units as unknown, e.g. after textures were bound without specifying their target.
+		/// </summary>
+		void invalidate_texture_units(GLuint first, GLuint count)
+		{
+			// Cannot tell whether the active texture unit is part of the range without querying it, so always invalidate those as well
+			_valid_mask &= ~active_unit_texture_slots_mask;
+			_texture_2d_valid_mask &= ~unit_range_mask(first, count);
+		}
+		/// <summary>
+		/// Marks the sampler bindings of the specified range of texture units as unknown.
+		/// </summary>
+		void invalidate_samplers(GLuint first = 0, GLuint count = num_texture_units)
+		{
+			_sampler_valid_mask &= ~unit_range_mask(first, count);
+		}
+		/// <summary>
+		/// Marks all bindings as unknown.
+		/// </summary>
+		void invalidate()
+		{
+			_valid_mask = 0;
+			_texture_2d_valid_mask = 0;
+			_sampler_valid_mask = 0;
+		}
+
+	private:
+		static constexpr uint32_t invalid_slot = ~0u;
+		static constexpr uint32_t first_buffer_slot = 5;
+		static constexpr uint32_t first_texture_slot = 18;
+		static constexpr uint32_t num_slots = 27;
+		static constexpr uint32_t buffer_slots_mask = ((1u << first_texture_slot) - 1) & ~((1u << first_buffer_slot) - 1);
+		static constexpr uint32_t active_unit_texture_slots_mask = ((1u << num_slots) - 1) & ~((1u << first_texture_slot) - 1);
+
+		static uint32_t unit_range_mask(GLuint first, GLuint count)
+		{
+			if (first >= num_texture_units)
+				return 0;
+			const GLuint last = std::min(first + count, num_texture_units);
+			return (last == 32 ? ~0u : (1u << last) - 1) & ~((1u << first) - 1);
+		}
+
+		static uint32_t slot_of(GLenum pname)
+		{
+			switch (pname)
+			{
+			case GL_ACTIVE_TEXTURE:
+				return 0;
+			case GL_READ_FRAMEBUFFER_BINDING:
+				return 1;
+			case GL_DRAW_FRAMEBUFFER_BINDING:
+				return 2;
+			case GL_VERTEX_ARRAY_BINDING:
+				return 3;
+			case GL_CURRENT_PROGRAM:
+				return 4;
+			case GL_ARRAY_BUFFER_BINDING:
+				return first_buffer_slot + 0;
+			case GL_ELEMENT_ARRAY_BUFFER_BINDING:
+				return first_buffer_slot + 1;
+			case GL_PIXEL_PACK_BUFFER_BINDING:
+				return first_buffer_slot + 2;
+			case GL_PIXEL_UNPACK_BUFFER_BINDING:
+				return first_buffer_slot + 3;
+			case GL_UNIFORM_BUFFER_BINDING:
+				return first_buffer_slot + 4;
+			case GL_TRANSFORM_FEEDBACK_BUFFER_BINDING:
+				return first_buffer_slot + 5;
+			case GL_COPY_READ_BUFFER_BINDING:
+				return first_buffer_slot + 6;
+			case GL_COPY_WRITE_BUFFER_BINDING:
+				return first_buffer_slot + 7;
+			case GL_DRAW_INDIRECT_BUFFER_BINDING:
+				return first_buffer_slot + 8;
+			case GL_SHADER_STORAGE_BUFFER_BINDING:
+				return first_buffer_slot + 9;
+			case GL_DISPATCH_INDIRECT_BUFFER_BINDING:
+				return first_buffer_slot + 10;
+			case GL_QUERY_BUFFER_BINDING:
+				return first_buffer_slot + 11;
+			case GL_ATOMIC_COUNTER_BUFFER_BINDING:
+				return first_buffer_slot + 12;
+			// 2D texture bindings are tracked per texture unit instead (see above)
+			case GL_TEXTURE_BINDING_1D:
+				return first_texture_slot + 0;
+			case GL_TEXTURE_BINDING_1D_ARRAY:
+				return first_texture_slot + 1;
+			case GL_TEXTURE_BINDING_2D_ARRAY:
+				return first_texture_slot + 2;
+			case GL_TEXTURE_BINDING_2D_MULTISAMPLE:
+				return first_texture_slot + 3;
+			case GL_TEXTURE_BINDING_2D_MULTISAMPLE_ARRAY:
+				return first_texture_slot + 4;
+			case GL_TEXTURE_BINDING_3D:
+				return first_texture_slot + 5;
+			case GL_TEXTURE_BINDING_CUBE_MAP:
+				return first_texture_slot + 6;
+			case GL_TEXTURE_BINDING_CUBE_MAP_ARRAY:
+				return first_texture_slot + 7;
+			case GL_TEXTURE_BINDING_RECTANGLE:
+				return first_texture_slot + 8;
+			default:
+				// Everything else (including 'GL_TEXTURE_BINDING_BUFFER', which 'glBindBuffer' with 'GL_TEXTURE_BUFFER' does not modify) is always queried
+				return invalid_slot;
+			}
+		}
+
+		uint32_t _valid_mask = 0;
+		GLint _values[num_slots] = {};
+		uint32_t _texture_2d_valid_mask = 0;
+		GLint _textures_2d[num_texture_units] = {};
+		uint32_t _sampler_valid_mask = 0;
+		GLint _samplers[num_texture_units] = {};
+	};
+}
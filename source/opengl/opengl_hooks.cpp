@@ -5,6 +5,7 @@
 
 #include "dll_log.hpp"
 #include "hook_manager.hpp"
+#include "profiling.hpp"
 #include "reshade_api_swapchain.hpp"
 #include "reshade_api_type_convert.hpp"
 #include "opengl_hooks.hpp" // Fix name clashes with gl3w
@@ -27,19 +28,41 @@ struct DrawElementsIndirectCommand
 
 extern thread_local reshade::opengl::swapchain_impl *g_current_context;
 
+// Gets the value of a binding from the shadow copy in the current context, to avoid querying the driver for values the hooks already know
+static inline GLint get_binding(GLenum pname)
+{
+	if (g_current_context != nullptr)
+		return g_current_context->_current_bindings.get(pname);
+
+	GLint value = 0;
+	glGetIntegerv(pname, &value);
+	return value;
+}
+
 HOOK_EXPORT void WINAPI glAccum(GLenum op, GLfloat value)
 {
 	static const auto trampoline = reshade::hooks::call(glAccum);
 	trampoline(op, value);
 }
 
+			void WINAPI glActiveTexture(GLenum texture)
+{
+	static const auto trampoline = reshade::hooks::call(glActiveTexture);
+	trampoline(texture);
+
+#if RESHADE_ADDON
+	if (g_current_context)
+		g_current_context->_current_bindings.set(GL_ACTIVE_TEXTURE, texture);
+#endif
+}
+
 HOOK_EXPORT void WINAPI glAlphaFunc(GLenum func, GLclampf ref)
 {
 	static const auto trampoline = reshade::hooks::call(glAlphaFunc);
 	trampoline(func, ref);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::bind_pipeline_states>())
 	{
 		const reshade::api::dynamic_state states[2] = { reshade::api::dynamic_state::alpha_func, reshade::api::dynamic_state::alpha_reference_value };
 		const uint32_t values[2] = { static_cast<uint32_t>(reshade::opengl::convert_compare_op(func)), *reinterpret_cast<const uint32_t *>(&ref) };
@@ -75,7 +98,12 @@ HOOK_EXPORT void WINAPI glBegin(GLenum mode)
 	trampoline(target, buffer);
 
 #if RESHADE_ADDON
+	RESHADE_PROFILE_CALL("glBindBuffer");
+
 	if (g_current_context)
+		g_current_context->_current_bindings.set(reshade::opengl::get_binding_for_target(target), buffer);
+
+	if (g_current_context && (reshade::has_addon_event<reshade::addon_event::bind_index_buffer>() || reshade::has_addon_event<reshade::addon_event::bind_vertex_buffers>()))
 	{
 		const reshade::api::resource resource = reshade::opengl::make_resource_handle(target, buffer);
 		const uint64_t offset = 0;
@@ -100,7 +128,11 @@ HOOK_EXPORT void WINAPI glBegin(GLenum mode)
 	trampoline(target, index, buffer);
 
 #if RESHADE_ADDON
+	// This also binds the buffer to the generic binding point of the target
 	if (g_current_context)
+		g_current_context->_current_bindings.set(reshade::opengl::get_binding_for_target(target), buffer);
+
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::push_descriptors>())
 	{
 		const reshade::api::resource resource = reshade::opengl::make_resource_handle(target, buffer);
 
@@ -121,6 +153,9 @@ HOOK_EXPORT void WINAPI glBegin(GLenum mode)
 
 #if RESHADE_ADDON
 	if (g_current_context)
+		g_current_context->_current_bindings.set(reshade::opengl::get_binding_for_target(target), buffer);
+
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::push_descriptors>())
 	{
 		// TODO: Offset
 		const reshade::api::resource resource = reshade::opengl::make_resource_handle(target, buffer);
@@ -141,7 +176,11 @@ HOOK_EXPORT void WINAPI glBegin(GLenum mode)
 	trampoline(target, first, count, buffers);
 
 #if RESHADE_ADDON
+	// Whether this modifies the generic binding point is not well defined across drivers, so simply query it again on next use
 	if (g_current_context)
+		g_current_context->_current_bindings.invalidate(reshade::opengl::get_binding_for_target(target));
+
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::push_descriptors>())
 	{
 		const auto buffer_handles = static_cast<reshade::api::resource *>(alloca(count * sizeof(reshade::api::resource)));
 		for (GLsizei i = 0; i < count; ++i)
@@ -164,6 +203,9 @@ HOOK_EXPORT void WINAPI glBegin(GLenum mode)
 
 #if RESHADE_ADDON
 	if (g_current_context)
+		g_current_context->_current_bindings.invalidate(reshade::opengl::get_binding_for_target(target));
+
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::push_descriptors>())
 	{
 		// TODO: Offsets
 		const auto buffer_handles = static_cast<reshade::api::resource *>(alloca(count * sizeof(reshade::api::resource)));
@@ -187,7 +229,18 @@ HOOK_EXPORT void WINAPI glBegin(GLenum mode)
 	trampoline(target, framebuffer);
 
 #if RESHADE_ADDON
+	RESHADE_PROFILE_CALL("glBindFramebuffer");
+
+	if (g_current_context)
+	{
+		if (target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER)
+			g_current_context->_current_bindings.set(GL_READ_FRAMEBUFFER_BINDING, framebuffer);
+		if (target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER)
+			g_current_context->_current_bindings.set(GL_DRAW_FRAMEBUFFER_BINDING, framebuffer);
+	}
+
 	if (g_current_context && (target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER) &&
+		(reshade::has_addon_event<reshade::addon_event::finish_render_pass>() || reshade::has_addon_event<reshade::addon_event::begin_render_pass>()) &&
 		glCheckFramebufferStatus(target) == GL_FRAMEBUFFER_COMPLETE) // Skip incomplete frame buffer bindings (e.g. during set up)
 	{
 		reshade::invoke_addon_event<reshade::addon_event::finish_render_pass>(g_current_context);
@@ -202,7 +255,7 @@ HOOK_EXPORT void WINAPI glBegin(GLenum mode)
 	trampoline(unit, texture, level, layered, layer, access, format);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::push_descriptors>())
 	{
 		const reshade::api::resource_view view = reshade::opengl::make_resource_view_handle(GL_TEXTURE, texture);
 
@@ -217,7 +270,7 @@ HOOK_EXPORT void WINAPI glBegin(GLenum mode)
 	trampoline(first, count, textures);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::push_descriptors>())
 	{
 		const auto view_handles = static_cast<reshade::api::resource_view *>(alloca(count * sizeof(reshade::api::resource_view)));
 		for (GLsizei i = 0; i < count; ++i)
@@ -236,6 +289,9 @@ HOOK_EXPORT void WINAPI glBegin(GLenum mode)
 
 #if RESHADE_ADDON
 	if (g_current_context)
+		g_current_context->_current_bindings.set_sampler(unit, sampler);
+
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::push_descriptors>())
 	{
 		const reshade::api::sampler sampler_handle = { sampler };
 
@@ -251,6 +307,12 @@ HOOK_EXPORT void WINAPI glBegin(GLenum mode)
 
 #if RESHADE_ADDON
 	if (g_current_context)
+	{
+		for (GLsizei i = 0; i < count; ++i)
+			g_current_context->_current_bindings.set_sampler(first + i, samplers != nullptr ? samplers[i] : 0);
+	}
+
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::push_descriptors>())
 	{
 		const auto sampler_handles = static_cast<reshade::api::sampler *>(alloca(count * sizeof(reshade::api::sampler)));
 		for (GLsizei i = 0; i < count; ++i)
@@ -268,11 +330,14 @@ HOOK_EXPORT void WINAPI glBindTexture(GLenum target, GLuint texture)
 	trampoline(target, texture);
 
 #if RESHADE_ADDON
+	RESHADE_PROFILE_CALL("glBindTexture");
+
 	if (g_current_context)
+		g_current_context->_current_bindings.set(reshade::opengl::get_binding_for_target(target), texture);
+
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::push_descriptors>())
 	{
-		GLint unit = GL_TEXTURE0;
-		glGetIntegerv(GL_ACTIVE_TEXTURE, &unit);
-		unit -= GL_TEXTURE0;
+		const GLint unit = get_binding(GL_ACTIVE_TEXTURE) - GL_TEXTURE0;
 
 		const reshade::api::resource_view view = reshade::opengl::make_resource_view_handle(target, texture);
 
@@ -287,7 +352,11 @@ HOOK_EXPORT void WINAPI glBindTexture(GLenum target, GLuint texture)
 	trampoline(unit, texture);
 
 #if RESHADE_ADDON
+	// Target of the texture is not known here, so have to query the bindings of this texture unit again on next use
 	if (g_current_context)
+		g_current_context->_current_bindings.invalidate_texture_units(unit, 1);
+
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::push_descriptors>())
 	{
 		const reshade::api::resource_view view = reshade::opengl::make_resource_view_handle(GL_TEXTURE, texture);
 
@@ -303,6 +372,9 @@ HOOK_EXPORT void WINAPI glBindTexture(GLenum target, GLuint texture)
 
 #if RESHADE_ADDON
 	if (g_current_context)
+		g_current_context->_current_bindings.invalidate_texture_units(first, count);
+
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::push_descriptors>())
 	{
 		const auto view_handles = static_cast<reshade::api::resource_view *>(alloca(count * sizeof(reshade::api::resource_view)));
 		for (GLsizei i = 0; i < count; ++i)
@@ -314,13 +386,27 @@ HOOK_EXPORT void WINAPI glBindTexture(GLenum target, GLuint texture)
 #endif
 }
 
+			void WINAPI glBindVertexArray(GLuint array)
+{
+	static const auto trampoline = reshade::hooks::call(glBindVertexArray);
+	trampoline(array);
+
+#if RESHADE_ADDON
+	// The index buffer binding is part of the vertex array object state
+	if (g_current_context)
+	{
+		g_current_context->_current_bindings.set(GL_VERTEX_ARRAY_BINDING, array);
+		g_current_context->_current_bindings.invalidate(GL_ELEMENT_ARRAY_BUFFER_BINDING);
+	}
+#endif
+}
 			void WINAPI glBindVertexBuffer(GLuint bindingindex, GLuint buffer, GLintptr offset, GLsizei stride)
 {
 	static const auto trampoline = reshade::hooks::call(glBindVertexBuffer);
 	trampoline(bindingindex, buffer, offset, stride);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::bind_vertex_buffers>())
 	{
 		const reshade::api::resource resource = reshade::opengl::make_resource_handle(GL_ARRAY_BUFFER, buffer);
 		const uint64_t offset_64 = offset;
@@ -338,7 +424,7 @@ HOOK_EXPORT void WINAPI glBindTexture(GLenum target, GLuint texture)
 	trampoline(first, count, buffers, offsets, strides);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::bind_vertex_buffers>())
 	{
 		const auto buffer_handles = static_cast<reshade::api::resource *>(alloca(count * sizeof(reshade::api::resource)));
 		const auto offsets_64 = static_cast<uint64_t *>(alloca(count * sizeof(uint64_t)));
@@ -367,7 +453,7 @@ HOOK_EXPORT void WINAPI glBlendFunc(GLenum sfactor, GLenum dfactor)
 	trampoline(sfactor, dfactor);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::bind_pipeline_states>())
 	{
 		const reshade::api::dynamic_state states[2] = { reshade::api::dynamic_state::src_color_blend_factor, reshade::api::dynamic_state::dst_color_blend_factor };
 		const uint32_t values[2] = { static_cast<uint32_t>(reshade::opengl::convert_blend_factor(sfactor)), static_cast<uint32_t>(reshade::opengl::convert_blend_factor(dfactor)) };
@@ -380,12 +466,10 @@ HOOK_EXPORT void WINAPI glBlendFunc(GLenum sfactor, GLenum dfactor)
 			void WINAPI glBlitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter)
 {
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && (reshade::has_addon_event<reshade::addon_event::copy_texture_region>() || reshade::has_addon_event<reshade::addon_event::resolve_texture_region>()))
 	{
-		GLint src_fbo = 0;
-		glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &src_fbo);
-		GLint dst_fbo = 0;
-		glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &dst_fbo);
+		GLint src_fbo = get_binding(GL_READ_FRAMEBUFFER_BINDING);
+		GLint dst_fbo = get_binding(GL_DRAW_FRAMEBUFFER_BINDING);
 
 		const reshade::api::attachment_type type = reshade::opengl::convert_buffer_bits_to_aspect(mask);
 
@@ -422,7 +506,7 @@ HOOK_EXPORT void WINAPI glBlendFunc(GLenum sfactor, GLenum dfactor)
 			void WINAPI glBlitNamedFramebuffer(GLuint readFramebuffer, GLuint drawFramebuffer, GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter)
 {
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && (reshade::has_addon_event<reshade::addon_event::copy_texture_region>() || reshade::has_addon_event<reshade::addon_event::resolve_texture_region>()))
 	{
 		const reshade::api::attachment_type type = reshade::opengl::convert_buffer_bits_to_aspect(mask);
 
@@ -460,8 +544,7 @@ HOOK_EXPORT void WINAPI glBlendFunc(GLenum sfactor, GLenum dfactor)
 			void WINAPI glBufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage)
 {
 #if RESHADE_ADDON
-	GLint object = 0;
-	glGetIntegerv(reshade::opengl::get_binding_for_target(target), &object);
+	GLint object = get_binding(reshade::opengl::get_binding_for_target(target));
 
 	reshade::api::resource_desc desc = reshade::opengl::convert_resource_desc(target, size);
 	reshade::opengl::convert_memory_heap_from_usage(desc, usage);
@@ -485,7 +568,7 @@ HOOK_EXPORT void WINAPI glBlendFunc(GLenum sfactor, GLenum dfactor)
 	trampoline(target, size, data, usage);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::init_resource>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::init_resource>(
 			g_current_context,
@@ -500,8 +583,7 @@ HOOK_EXPORT void WINAPI glBlendFunc(GLenum sfactor, GLenum dfactor)
 			void WINAPI glBufferStorage(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags)
 {
 #if RESHADE_ADDON
-	GLint object = 0;
-	glGetIntegerv(reshade::opengl::get_binding_for_target(target), &object);
+	GLint object = get_binding(reshade::opengl::get_binding_for_target(target));
 
 	reshade::api::resource_desc desc = reshade::opengl::convert_resource_desc(target, size);
 	reshade::opengl::convert_memory_heap_from_flags(desc, flags);
@@ -525,7 +607,7 @@ HOOK_EXPORT void WINAPI glBlendFunc(GLenum sfactor, GLenum dfactor)
 	trampoline(target, size, data, flags);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::init_resource>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::init_resource>(
 			g_current_context,
@@ -541,17 +623,29 @@ HOOK_EXPORT void WINAPI glCallList(GLuint list)
 {
 	static const auto trampoline = reshade::hooks::call(glCallList);
 	trampoline(list);
+
+#if RESHADE_ADDON
+	// Display lists may contain arbitrary binding changes
+	if (g_current_context)
+		g_current_context->_current_bindings.invalidate();
+#endif
 }
 HOOK_EXPORT void WINAPI glCallLists(GLsizei n, GLenum type, const GLvoid *lists)
 {
 	static const auto trampoline = reshade::hooks::call(glCallLists);
 	trampoline(n, type, lists);
+
+#if RESHADE_ADDON
+	// Display lists may contain arbitrary binding changes
+	if (g_current_context)
+		g_current_context->_current_bindings.invalidate();
+#endif
 }
 
 HOOK_EXPORT void WINAPI glClear(GLbitfield mask)
 {
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::clear_attachments>())
 	{
 		GLfloat color_value[4] = {};
 		glGetFloatv(GL_COLOR_CLEAR_VALUE, color_value);
@@ -571,10 +665,9 @@ HOOK_EXPORT void WINAPI glClear(GLbitfield mask)
 			void WINAPI glClearBufferfv(GLenum buffer, GLint drawbuffer, const GLfloat *value)
 {
 #if RESHADE_ADDON
-	if (g_current_context && buffer == GL_COLOR)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::clear_render_target_view>() && buffer == GL_COLOR)
 	{
-		GLint fbo = 0;
-		glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &fbo);
+		GLint fbo = get_binding(GL_DRAW_FRAMEBUFFER_BINDING);
 
 		reshade::api::resource_view view = { 0 };
 		g_current_context->get_attachment(reshade::opengl::make_render_pass_handle(fbo), reshade::api::attachment_type::color, drawbuffer, &view);
@@ -590,14 +683,13 @@ HOOK_EXPORT void WINAPI glClear(GLbitfield mask)
 			void WINAPI glClearBufferfi(GLenum buffer, GLint drawbuffer, GLfloat depth, GLint stencil)
 {
 #if RESHADE_ADDON
-	if (g_current_context && buffer != GL_COLOR)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::clear_depth_stencil_view>() && buffer != GL_COLOR)
 	{
 		assert(drawbuffer == 0);
 
 		const reshade::api::attachment_type type = reshade::opengl::convert_buffer_type_to_aspect(buffer);
 
-		GLint fbo = 0;
-		glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &fbo);
+		GLint fbo = get_binding(GL_DRAW_FRAMEBUFFER_BINDING);
 
 		reshade::api::resource_view view = { 0 };
 		g_current_context->get_attachment(reshade::opengl::make_render_pass_handle(fbo), type, drawbuffer, &view);
@@ -613,7 +705,7 @@ HOOK_EXPORT void WINAPI glClear(GLbitfield mask)
 			void WINAPI glClearNamedFramebufferfv(GLuint framebuffer, GLenum buffer, GLint drawbuffer, const GLfloat *value)
 {
 #if RESHADE_ADDON
-	if (g_current_context && buffer == GL_COLOR)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::clear_render_target_view>() && buffer == GL_COLOR)
 	{
 		reshade::api::resource_view view = { 0 };
 		g_current_context->get_attachment(reshade::opengl::make_render_pass_handle(framebuffer), reshade::api::attachment_type::color, drawbuffer, &view);
@@ -629,7 +721,7 @@ HOOK_EXPORT void WINAPI glClear(GLbitfield mask)
 			void WINAPI glClearNamedFramebufferfi(GLuint framebuffer, GLenum buffer, GLint drawbuffer, GLfloat depth, GLint stencil)
 {
 #if RESHADE_ADDON
-	if (g_current_context && buffer != GL_COLOR)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::clear_depth_stencil_view>() && buffer != GL_COLOR)
 	{
 		assert(drawbuffer == 0);
 
@@ -846,7 +938,7 @@ HOOK_EXPORT void WINAPI glColorMask(GLboolean red, GLboolean green, GLboolean bl
 	trampoline(red, green, blue, alpha);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::bind_pipeline_states>())
 	{
 		const reshade::api::dynamic_state states[1] = { reshade::api::dynamic_state::render_target_write_mask };
 		const uint32_t values[1] = { static_cast<uint32_t>((red) | (green << 1) | (blue << 2) | (alpha << 3)) };
@@ -871,12 +963,10 @@ HOOK_EXPORT void WINAPI glColorPointer(GLint size, GLenum type, GLsizei stride,
 			void WINAPI glCopyBufferSubData(GLenum readTarget, GLenum writeTarget, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size)
 {
 #if RESHADE_ADDON
-	if (g_current_context && !reshade::addon::event_list[static_cast<size_t>(reshade::addon_event::copy_buffer_region)].empty())
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::copy_buffer_region>())
 	{
-		GLint src_object = 0;
-		glGetIntegerv(reshade::opengl::get_binding_for_target(readTarget), &src_object);
-		GLint dst_object = 0;
-		glGetIntegerv(reshade::opengl::get_binding_for_target(writeTarget), &dst_object);
+		GLint src_object = get_binding(reshade::opengl::get_binding_for_target(readTarget));
+		GLint dst_object = get_binding(reshade::opengl::get_binding_for_target(writeTarget));
 
 		if (reshade::invoke_addon_event<reshade::addon_event::copy_buffer_region>(g_current_context,
 			reshade::opengl::make_resource_handle(readTarget, src_object), readOffset,
@@ -892,7 +982,7 @@ HOOK_EXPORT void WINAPI glColorPointer(GLint size, GLenum type, GLsizei stride,
 			void WINAPI glCopyImageSubData(GLuint srcName, GLenum srcTarget, GLint srcLevel, GLint srcX, GLint srcY, GLint srcZ, GLuint dstName, GLenum dstTarget, GLint dstLevel, GLint dstX, GLint dstY, GLint dstZ, GLsizei srcWidth, GLsizei srcHeight, GLsizei srcDepth)
 {
 #if RESHADE_ADDON
-	if (g_current_context && !reshade::addon::event_list[static_cast<size_t>(reshade::addon_event::copy_texture_region)].empty())
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::copy_texture_region>())
 	{
 		const int32_t src_box[6] = { srcX, srcY, srcZ, srcX + srcWidth, srcY + srcHeight, srcZ + srcDepth };
 		const int32_t dst_box[6] = { dstX, dstY, dstZ, dstX + srcWidth, dstY + srcHeight, dstZ + srcDepth };
@@ -912,7 +1002,7 @@ HOOK_EXPORT void WINAPI glColorPointer(GLint size, GLenum type, GLsizei stride,
 			void WINAPI glCopyNamedBufferSubData(GLuint readBuffer, GLuint writeBuffer, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size)
 {
 #if RESHADE_ADDON
-	if (g_current_context && !reshade::addon::event_list[static_cast<size_t>(reshade::addon_event::copy_buffer_region)].empty())
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::copy_buffer_region>())
 	{
 		if (reshade::invoke_addon_event<reshade::addon_event::copy_buffer_region>(g_current_context,
 			reshade::opengl::make_resource_handle(GL_COPY_READ_BUFFER, readBuffer), readOffset,
@@ -935,18 +1025,16 @@ HOOK_EXPORT void WINAPI glCopyTexImage1D(GLenum target, GLint level, GLenum inte
 {
 #if RESHADE_ADDON
 	// TODO: Call "create_resource" event here too
-	if (g_current_context && !reshade::addon::event_list[static_cast<size_t>(reshade::addon_event::copy_texture_region)].empty())
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::copy_texture_region>())
 	{
 		GLint src_mode = GL_BACK;
 		glGetIntegerv(GL_READ_BUFFER, &src_mode);
-		GLint dst_object = 0;
-		glGetIntegerv(reshade::opengl::get_binding_for_target(target), &dst_object);
+		GLint dst_object = get_binding(reshade::opengl::get_binding_for_target(target));
 
 		reshade::api::resource src = reshade::opengl::make_resource_handle(GL_FRAMEBUFFER_DEFAULT, src_mode);
 		if (src_mode != GL_BACK)
 		{
-			GLint src_fbo = 0;
-			glGetIntegerv(GL_FRAMEBUFFER_BINDING, &src_fbo);
+			GLint src_fbo = get_binding(GL_FRAMEBUFFER_BINDING);
 
 			reshade::api::resource_view srv_view = { 0 };
 			g_current_context->get_attachment(reshade::opengl::make_render_pass_handle(src_fbo), reshade::api::attachment_type::color, src_mode - GL_COLOR_ATTACHMENT0, &srv_view);
@@ -971,18 +1059,16 @@ HOOK_EXPORT void WINAPI glCopyTexImage2D(GLenum target, GLint level, GLenum inte
 {
 #if RESHADE_ADDON
 	// TODO: Call "create_resource" event here too
-	if (g_current_context && !reshade::addon::event_list[static_cast<size_t>(reshade::addon_event::copy_texture_region)].empty())
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::copy_texture_region>())
 	{
 		GLint src_mode = GL_BACK;
 		glGetIntegerv(GL_READ_BUFFER, &src_mode);
-		GLint dst_object = 0;
-		glGetIntegerv(reshade::opengl::get_binding_for_target(target), &dst_object);
+		GLint dst_object = get_binding(reshade::opengl::get_binding_for_target(target));
 
 		reshade::api::resource src = reshade::opengl::make_resource_handle(GL_FRAMEBUFFER_DEFAULT, src_mode);
 		if (src_mode != GL_BACK)
 		{
-			GLint src_fbo = 0;
-			glGetIntegerv(GL_FRAMEBUFFER_BINDING, &src_fbo);
+			GLint src_fbo = get_binding(GL_FRAMEBUFFER_BINDING);
 
 			reshade::api::resource_view srv_view = { 0 };
 			g_current_context->get_attachment(reshade::opengl::make_render_pass_handle(src_fbo), reshade::api::attachment_type::color, src_mode - GL_COLOR_ATTACHMENT0, &srv_view);
@@ -1006,18 +1092,16 @@ HOOK_EXPORT void WINAPI glCopyTexImage2D(GLenum target, GLint level, GLenum inte
 HOOK_EXPORT void WINAPI glCopyTexSubImage1D(GLenum target, GLint level, GLint xoffset, GLint x, GLint y, GLsizei width)
 {
 #if RESHADE_ADDON
-	if (g_current_context && !reshade::addon::event_list[static_cast<size_t>(reshade::addon_event::copy_texture_region)].empty())
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::copy_texture_region>())
 	{
 		GLint src_mode = GL_BACK;
 		glGetIntegerv(GL_READ_BUFFER, &src_mode);
-		GLint dst_object = 0;
-		glGetIntegerv(reshade::opengl::get_binding_for_target(target), &dst_object);
+		GLint dst_object = get_binding(reshade::opengl::get_binding_for_target(target));
 
 		reshade::api::resource src = reshade::opengl::make_resource_handle(GL_FRAMEBUFFER_DEFAULT, src_mode);
 		if (src_mode != GL_BACK)
 		{
-			GLint src_fbo = 0;
-			glGetIntegerv(GL_FRAMEBUFFER_BINDING, &src_fbo);
+			GLint src_fbo = get_binding(GL_FRAMEBUFFER_BINDING);
 
 			reshade::api::resource_view srv_view = { 0 };
 			g_current_context->get_attachment(reshade::opengl::make_render_pass_handle(src_fbo), reshade::api::attachment_type::color, src_mode - GL_COLOR_ATTACHMENT0, &srv_view);
@@ -1041,18 +1125,16 @@ HOOK_EXPORT void WINAPI glCopyTexSubImage1D(GLenum target, GLint level, GLint xo
 HOOK_EXPORT void WINAPI glCopyTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint x, GLint y, GLsizei width, GLsizei height)
 {
 #if RESHADE_ADDON
-	if (g_current_context && !reshade::addon::event_list[static_cast<size_t>(reshade::addon_event::copy_texture_region)].empty())
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::copy_texture_region>())
 	{
 		GLint src_mode = GL_BACK;
 		glGetIntegerv(GL_READ_BUFFER, &src_mode);
-		GLint dst_object = 0;
-		glGetIntegerv(reshade::opengl::get_binding_for_target(target), &dst_object);
+		GLint dst_object = get_binding(reshade::opengl::get_binding_for_target(target));
 
 		reshade::api::resource src = reshade::opengl::make_resource_handle(GL_FRAMEBUFFER_DEFAULT, src_mode);
 		if (src_mode != GL_BACK)
 		{
-			GLint src_fbo = 0;
-			glGetIntegerv(GL_FRAMEBUFFER_BINDING, &src_fbo);
+			GLint src_fbo = get_binding(GL_FRAMEBUFFER_BINDING);
 
 			reshade::api::resource_view srv_view = { 0 };
 			g_current_context->get_attachment(reshade::opengl::make_render_pass_handle(src_fbo), reshade::api::attachment_type::color, src_mode - GL_COLOR_ATTACHMENT0, &srv_view);
@@ -1076,18 +1158,16 @@ HOOK_EXPORT void WINAPI glCopyTexSubImage2D(GLenum target, GLint level, GLint xo
 			void WINAPI glCopyTexSubImage3D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLint x, GLint y, GLsizei width, GLsizei height)
 {
 #if RESHADE_ADDON
-	if (g_current_context && !reshade::addon::event_list[static_cast<size_t>(reshade::addon_event::copy_texture_region)].empty())
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::copy_texture_region>())
 	{
 		GLint src_mode = GL_BACK;
 		glGetIntegerv(GL_READ_BUFFER, &src_mode);
-		GLint dst_object = 0;
-		glGetIntegerv(reshade::opengl::get_binding_for_target(target), &dst_object);
+		GLint dst_object = get_binding(reshade::opengl::get_binding_for_target(target));
 
 		reshade::api::resource src = reshade::opengl::make_resource_handle(GL_FRAMEBUFFER_DEFAULT, src_mode);
 		if (src_mode != GL_BACK)
 		{
-			GLint src_fbo = 0;
-			glGetIntegerv(GL_FRAMEBUFFER_BINDING, &src_fbo);
+			GLint src_fbo = get_binding(GL_FRAMEBUFFER_BINDING);
 
 			reshade::api::resource_view srv_view = { 0 };
 			g_current_context->get_attachment(reshade::opengl::make_render_pass_handle(src_fbo), reshade::api::attachment_type::color, src_mode - GL_COLOR_ATTACHMENT0, &srv_view);
@@ -1111,7 +1191,7 @@ HOOK_EXPORT void WINAPI glCopyTexSubImage2D(GLenum target, GLint level, GLint xo
 			void WINAPI glCopyTextureSubImage1D(GLuint texture, GLint level, GLint xoffset, GLint x, GLint y, GLsizei width)
 {
 #if RESHADE_ADDON
-	if (g_current_context && !reshade::addon::event_list[static_cast<size_t>(reshade::addon_event::copy_texture_region)].empty())
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::copy_texture_region>())
 	{
 		GLint src_mode = GL_BACK;
 		glGetIntegerv(GL_READ_BUFFER, &src_mode);
@@ -1119,8 +1199,7 @@ HOOK_EXPORT void WINAPI glCopyTexSubImage2D(GLenum target, GLint level, GLint xo
 		reshade::api::resource src = reshade::opengl::make_resource_handle(GL_FRAMEBUFFER_DEFAULT, src_mode);
 		if (src_mode != GL_BACK)
 		{
-			GLint src_fbo = 0;
-			glGetIntegerv(GL_FRAMEBUFFER_BINDING, &src_fbo);
+			GLint src_fbo = get_binding(GL_FRAMEBUFFER_BINDING);
 
 			reshade::api::resource_view srv_view = { 0 };
 			g_current_context->get_attachment(reshade::opengl::make_render_pass_handle(src_fbo), reshade::api::attachment_type::color, src_mode - GL_COLOR_ATTACHMENT0, &srv_view);
@@ -1144,7 +1223,7 @@ HOOK_EXPORT void WINAPI glCopyTexSubImage2D(GLenum target, GLint level, GLint xo
 			void WINAPI glCopyTextureSubImage2D(GLuint texture, GLint level, GLint xoffset, GLint yoffset, GLint x, GLint y, GLsizei width, GLsizei height)
 {
 #if RESHADE_ADDON
-	if (g_current_context && !reshade::addon::event_list[static_cast<size_t>(reshade::addon_event::copy_texture_region)].empty())
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::copy_texture_region>())
 	{
 		GLint src_mode = GL_BACK;
 		glGetIntegerv(GL_READ_BUFFER, &src_mode);
@@ -1152,8 +1231,7 @@ HOOK_EXPORT void WINAPI glCopyTexSubImage2D(GLenum target, GLint level, GLint xo
 		reshade::api::resource src = reshade::opengl::make_resource_handle(GL_FRAMEBUFFER_DEFAULT, src_mode);
 		if (src_mode != GL_BACK)
 		{
-			GLint src_fbo = 0;
-			glGetIntegerv(GL_FRAMEBUFFER_BINDING, &src_fbo);
+			GLint src_fbo = get_binding(GL_FRAMEBUFFER_BINDING);
 
 			reshade::api::resource_view srv_view = { 0 };
 			g_current_context->get_attachment(reshade::opengl::make_render_pass_handle(src_fbo), reshade::api::attachment_type::color, src_mode - GL_COLOR_ATTACHMENT0, &srv_view);
@@ -1177,7 +1255,7 @@ HOOK_EXPORT void WINAPI glCopyTexSubImage2D(GLenum target, GLint level, GLint xo
 			void WINAPI glCopyTextureSubImage3D(GLuint texture, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLint x, GLint y, GLsizei width, GLsizei height)
 {
 #if RESHADE_ADDON
-	if (g_current_context && !reshade::addon::event_list[static_cast<size_t>(reshade::addon_event::copy_texture_region)].empty())
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::copy_texture_region>())
 	{
 		GLint src_mode = GL_BACK;
 		glGetIntegerv(GL_READ_BUFFER, &src_mode);
@@ -1185,8 +1263,7 @@ HOOK_EXPORT void WINAPI glCopyTexSubImage2D(GLenum target, GLint level, GLint xo
 		reshade::api::resource src = reshade::opengl::make_resource_handle(GL_FRAMEBUFFER_DEFAULT, src_mode);
 		if (src_mode != GL_BACK)
 		{
-			GLint src_fbo = 0;
-			glGetIntegerv(GL_FRAMEBUFFER_BINDING, &src_fbo);
+			GLint src_fbo = get_binding(GL_FRAMEBUFFER_BINDING);
 
 			reshade::api::resource_view srv_view = { 0 };
 			g_current_context->get_attachment(reshade::opengl::make_render_pass_handle(src_fbo), reshade::api::attachment_type::color, src_mode - GL_COLOR_ATTACHMENT0, &srv_view);
@@ -1214,7 +1291,7 @@ HOOK_EXPORT void WINAPI glCullFace(GLenum mode)
 	trampoline(mode);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::bind_pipeline_states>())
 	{
 		const reshade::api::dynamic_state states[1] = { reshade::api::dynamic_state::cull_mode };
 		const uint32_t values[1] = { static_cast<uint32_t>(reshade::opengl::convert_cull_mode(mode)) };
@@ -1227,7 +1304,7 @@ HOOK_EXPORT void WINAPI glCullFace(GLenum mode)
 			void WINAPI glDeleteBuffers(GLsizei n, const GLuint *buffers)
 {
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::destroy_resource>())
 	{
 		for (int i = 0; i < n; ++i)
 			reshade::invoke_addon_event<reshade::addon_event::destroy_resource>(g_current_context, reshade::opengl::make_resource_handle(GL_BUFFER, buffers[i]));
@@ -1236,6 +1313,27 @@ HOOK_EXPORT void WINAPI glCullFace(GLenum mode)
 
 	static const auto trampoline = reshade::hooks::call(glDeleteBuffers);
 	trampoline(n, buffers);
+
+#if RESHADE_ADDON
+	// Deleting a buffer resets all bindings it was bound to
+	if (g_current_context)
+		g_current_context->_current_bindings.invalidate_buffers();
+#endif
+}
+
+			void WINAPI glDeleteFramebuffers(GLsizei n, const GLuint *framebuffers)
+{
+	static const auto trampoline = reshade::hooks::call(glDeleteFramebuffers);
+	trampoline(n, framebuffers);
+
+#if RESHADE_ADDON
+	// Deleting a bound framebuffer reverts the binding to the default framebuffer
+	if (g_current_context)
+	{
+		g_current_context->_current_bindings.invalidate(GL_READ_FRAMEBUFFER_BINDING);
+		g_current_context->_current_bindings.invalidate(GL_DRAW_FRAMEBUFFER_BINDING);
+	}
+#endif
 }
 
 HOOK_EXPORT void WINAPI glDeleteLists(GLuint list, GLsizei range)
@@ -1247,7 +1345,7 @@ HOOK_EXPORT void WINAPI glDeleteLists(GLuint list, GLsizei range)
 			void WINAPI glDeleteSamplers(GLsizei n, const GLuint *samplers)
 {
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::destroy_sampler>())
 	{
 		for (int i = 0; i < n; ++i)
 			reshade::invoke_addon_event<reshade::addon_event::destroy_sampler>(g_current_context, reshade::api::sampler { samplers[i] });
@@ -1256,12 +1354,18 @@ HOOK_EXPORT void WINAPI glDeleteLists(GLuint list, GLsizei range)
 
 	static const auto trampoline = reshade::hooks::call(glDeleteSamplers);
 	trampoline(n, samplers);
+
+#if RESHADE_ADDON
+	// Deleting a sampler resets all bindings it was bound to
+	if (g_current_context)
+		g_current_context->_current_bindings.invalidate_samplers();
+#endif
 }
 
 			void WINAPI glDeleteShader(GLuint shader)
 {
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::destroy_pipeline>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::destroy_pipeline>(g_current_context, reshade::api::pipeline { shader });
 	}
@@ -1274,7 +1378,7 @@ HOOK_EXPORT void WINAPI glDeleteLists(GLuint list, GLsizei range)
 HOOK_EXPORT void WINAPI glDeleteTextures(GLsizei n, const GLuint *textures)
 {
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::destroy_resource>())
 	{
 		for (int i = 0; i < n; ++i)
 			reshade::invoke_addon_event<reshade::addon_event::destroy_resource>(g_current_context, reshade::opengl::make_resource_handle(GL_TEXTURE, textures[i]));
@@ -1283,6 +1387,27 @@ HOOK_EXPORT void WINAPI glDeleteTextures(GLsizei n, const GLuint *textures)
 
 	static const auto trampoline = reshade::hooks::call(glDeleteTextures);
 	trampoline(n, textures);
+
+#if RESHADE_ADDON
+	// Deleting a texture resets all bindings it was bound to
+	if (g_current_context)
+		g_current_context->_current_bindings.invalidate_textures();
+#endif
+}
+
+			void WINAPI glDeleteVertexArrays(GLsizei n, const GLuint *arrays)
+{
+	static const auto trampoline = reshade::hooks::call(glDeleteVertexArrays);
+	trampoline(n, arrays);
+
+#if RESHADE_ADDON
+	// Deleting the bound vertex array object reverts the binding to the default one, which has a different index buffer binding
+	if (g_current_context)
+	{
+		g_current_context->_current_bindings.invalidate(GL_VERTEX_ARRAY_BINDING);
+		g_current_context->_current_bindings.invalidate(GL_ELEMENT_ARRAY_BUFFER_BINDING);
+	}
+#endif
 }
 
 HOOK_EXPORT void WINAPI glDepthFunc(GLenum func)
@@ -1291,7 +1416,7 @@ HOOK_EXPORT void WINAPI glDepthFunc(GLenum func)
 	trampoline(func);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::bind_pipeline_states>())
 	{
 		const reshade::api::dynamic_state states[1] = { reshade::api::dynamic_state::depth_func };
 		const uint32_t values[1] = { static_cast<uint32_t>(reshade::opengl::convert_compare_op(func)) };
@@ -1306,7 +1431,7 @@ HOOK_EXPORT void WINAPI glDepthMask(GLboolean flag)
 	trampoline(flag);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::bind_pipeline_states>())
 	{
 		const reshade::api::dynamic_state states[1] = { reshade::api::dynamic_state::depth_write_mask };
 		const uint32_t values[1] = { flag };
@@ -1327,7 +1452,7 @@ HOOK_EXPORT void WINAPI glDisable(GLenum cap)
 	trampoline(cap);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::bind_pipeline_states>())
 	{
 		uint32_t value = GL_FALSE;
 		reshade::api::dynamic_state state = reshade::api::dynamic_state::unknown;
@@ -1386,7 +1511,7 @@ HOOK_EXPORT void WINAPI glDisableClientState(GLenum array)
 			void WINAPI glDispatchCompute(GLuint num_groups_x, GLuint num_groups_y, GLuint num_groups_z)
 {
 #if RESHADE_ADDON
-	if (g_current_context &&
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::dispatch>() &&
 		reshade::invoke_addon_event<reshade::addon_event::dispatch>(g_current_context, num_groups_x, num_groups_y, num_groups_z))
 		return;
 #endif
@@ -1397,8 +1522,7 @@ HOOK_EXPORT void WINAPI glDisableClientState(GLenum array)
 			void WINAPI glDispatchComputeIndirect(GLintptr indirect)
 {
 #if RESHADE_ADDON
-	GLint indirect_buffer_binding = 0;
-	glGetIntegerv(GL_DISPATCH_INDIRECT_BUFFER_BINDING, &indirect_buffer_binding);
+	GLint indirect_buffer_binding = get_binding(GL_DISPATCH_INDIRECT_BUFFER_BINDING);
 
 	if (0 != indirect_buffer_binding)
 	{
@@ -1419,9 +1543,13 @@ HOOK_EXPORT void WINAPI glDisableClientState(GLenum array)
 HOOK_EXPORT void WINAPI glDrawArrays(GLenum mode, GLint first, GLsizei count)
 {
 #if RESHADE_ADDON
-	if (g_current_context &&
-		reshade::invoke_addon_event<reshade::addon_event::draw>(g_current_context, count, 1, first, 0))
-		return;
+	{
+		RESHADE_PROFILE_CALL("glDrawArrays");
+
+		if (g_current_context && reshade::has_addon_event<reshade::addon_event::draw>() &&
+			reshade::invoke_addon_event<reshade::addon_event::draw>(g_current_context, count, 1, first, 0))
+			return;
+	}
 #endif
 
 	static const auto trampoline = reshade::hooks::call(glDrawArrays);
@@ -1430,8 +1558,7 @@ HOOK_EXPORT void WINAPI glDrawArrays(GLenum mode, GLint first, GLsizei count)
 			void WINAPI glDrawArraysIndirect(GLenum mode, const GLvoid *indirect)
 {
 #if RESHADE_ADDON
-	GLint indirect_buffer_binding = 0;
-	glGetIntegerv(GL_DRAW_INDIRECT_BUFFER_BINDING, &indirect_buffer_binding);
+	GLint indirect_buffer_binding = get_binding(GL_DRAW_INDIRECT_BUFFER_BINDING);
 
 	if (0 != indirect_buffer_binding)
 	{
@@ -1454,9 +1581,13 @@ HOOK_EXPORT void WINAPI glDrawArrays(GLenum mode, GLint first, GLsizei count)
 			void WINAPI glDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei primcount)
 {
 #if RESHADE_ADDON
-	if (g_current_context &&
-		reshade::invoke_addon_event<reshade::addon_event::draw>(g_current_context, primcount, count, first, 0))
-		return;
+	{
+		RESHADE_PROFILE_CALL("glDrawArraysInstanced");
+
+		if (g_current_context && reshade::has_addon_event<reshade::addon_event::draw>() &&
+			reshade::invoke_addon_event<reshade::addon_event::draw>(g_current_context, primcount, count, first, 0))
+			return;
+	}
 #endif
 
 	static const auto trampoline = reshade::hooks::call(glDrawArraysInstanced);
@@ -1466,7 +1597,7 @@ HOOK_EXPORT void WINAPI glDrawArrays(GLenum mode, GLint first, GLsizei count)
 {
 
 #if RESHADE_ADDON
-	if (g_current_context &&
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::draw>() &&
 		reshade::invoke_addon_event<reshade::addon_event::draw>(g_current_context, primcount, count, first, baseinstance))
 		return;
 #endif
@@ -1486,6 +1617,8 @@ HOOK_EXPORT void WINAPI glDrawElements(GLenum mode, GLsizei count, GLenum type,
 #if RESHADE_ADDON
 	if (g_current_context)
 	{
+		RESHADE_PROFILE_CALL("glDrawElements");
+
 		if (mode != g_current_context->_current_prim_mode)
 		{
 			const reshade::api::dynamic_state state = reshade::api::dynamic_state::primitive_topology;
@@ -1496,11 +1629,13 @@ HOOK_EXPORT void WINAPI glDrawElements(GLenum mode, GLsizei count, GLenum type,
 		g_current_context->_current_prim_mode = mode;
 		g_current_context->_current_index_type = type;
 
-		GLint index_buffer_binding = 0;
-		glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &index_buffer_binding);
+		if (reshade::has_addon_event<reshade::addon_event::draw_indexed>())
+		{
+			GLint index_buffer_binding = get_binding(GL_ELEMENT_ARRAY_BUFFER_BINDING);
 
-		if (reshade::invoke_addon_event<reshade::addon_event::draw_indexed>(g_current_context, count, 1, index_buffer_binding != 0 ? static_cast<uint32_t>(reinterpret_cast<uintptr_t>(indices) / reshade::opengl::get_index_type_size(type)) : 0, 0, 0))
-			return;
+			if (reshade::invoke_addon_event<reshade::addon_event::draw_indexed>(g_current_context, count, 1, index_buffer_binding != 0 ? static_cast<uint32_t>(reinterpret_cast<uintptr_t>(indices) / reshade::opengl::get_index_type_size(type)) : 0, 0, 0))
+				return;
+		}
 	}
 #endif
 
@@ -1522,11 +1657,13 @@ HOOK_EXPORT void WINAPI glDrawElements(GLenum mode, GLsizei count, GLenum type,
 		g_current_context->_current_prim_mode = mode;
 		g_current_context->_current_index_type = type;
 
-		GLint index_buffer_binding = 0;
-		glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &index_buffer_binding);
+		if (reshade::has_addon_event<reshade::addon_event::draw_indexed>())
+		{
+			GLint index_buffer_binding = get_binding(GL_ELEMENT_ARRAY_BUFFER_BINDING);
 
-		if (reshade::invoke_addon_event<reshade::addon_event::draw_indexed>(g_current_context, count, 1, index_buffer_binding != 0 ? static_cast<uint32_t>(reinterpret_cast<uintptr_t>(indices) / reshade::opengl::get_index_type_size(type)) : 0, basevertex, 0))
-			return;
+			if (reshade::invoke_addon_event<reshade::addon_event::draw_indexed>(g_current_context, count, 1, index_buffer_binding != 0 ? static_cast<uint32_t>(reinterpret_cast<uintptr_t>(indices) / reshade::opengl::get_index_type_size(type)) : 0, basevertex, 0))
+				return;
+		}
 	}
 #endif
 
@@ -1536,8 +1673,7 @@ HOOK_EXPORT void WINAPI glDrawElements(GLenum mode, GLsizei count, GLenum type,
 			void WINAPI glDrawElementsIndirect(GLenum mode, GLenum type, const GLvoid *indirect)
 {
 #if RESHADE_ADDON
-	GLint indirect_buffer_binding = 0;
-	glGetIntegerv(GL_DRAW_INDIRECT_BUFFER_BINDING, &indirect_buffer_binding);
+	GLint indirect_buffer_binding = get_binding(GL_DRAW_INDIRECT_BUFFER_BINDING);
 
 	if (0 != indirect_buffer_binding)
 	{
@@ -1574,6 +1710,8 @@ HOOK_EXPORT void WINAPI glDrawElements(GLenum mode, GLsizei count, GLenum type,
 #if RESHADE_ADDON
 	if (g_current_context)
 	{
+		RESHADE_PROFILE_CALL("glDrawElementsInstanced");
+
 		if (mode != g_current_context->_current_prim_mode)
 		{
 			const reshade::api::dynamic_state state = reshade::api::dynamic_state::primitive_topology;
@@ -1584,11 +1722,13 @@ HOOK_EXPORT void WINAPI glDrawElements(GLenum mode, GLsizei count, GLenum type,
 		g_current_context->_current_prim_mode = mode;
 		g_current_context->_current_index_type = type;
 
-		GLint index_buffer_binding = 0;
-		glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &index_buffer_binding);
+		if (reshade::has_addon_event<reshade::addon_event::draw_indexed>())
+		{
+			GLint index_buffer_binding = get_binding(GL_ELEMENT_ARRAY_BUFFER_BINDING);
 
-		if (reshade::invoke_addon_event<reshade::addon_event::draw_indexed>(g_current_context, primcount, count, index_buffer_binding != 0 ? static_cast<uint32_t>(reinterpret_cast<uintptr_t>(indices) / reshade::opengl::get_index_type_size(type)) : 0, 0, 0))
-			return;
+			if (reshade::invoke_addon_event<reshade::addon_event::draw_indexed>(g_current_context, primcount, count, index_buffer_binding != 0 ? static_cast<uint32_t>(reinterpret_cast<uintptr_t>(indices) / reshade::opengl::get_index_type_size(type)) : 0, 0, 0))
+				return;
+		}
 	}
 #endif
 
@@ -1610,11 +1750,13 @@ HOOK_EXPORT void WINAPI glDrawElements(GLenum mode, GLsizei count, GLenum type,
 		g_current_context->_current_prim_mode = mode;
 		g_current_context->_current_index_type = type;
 
-		GLint index_buffer_binding = 0;
-		glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &index_buffer_binding);
+		if (reshade::has_addon_event<reshade::addon_event::draw_indexed>())
+		{
+			GLint index_buffer_binding = get_binding(GL_ELEMENT_ARRAY_BUFFER_BINDING);
 
-		if (reshade::invoke_addon_event<reshade::addon_event::draw_indexed>(g_current_context, primcount, count, index_buffer_binding != 0 ? static_cast<uint32_t>(reinterpret_cast<uintptr_t>(indices) / reshade::opengl::get_index_type_size(type)) : 0, basevertex, 0))
-			return;
+			if (reshade::invoke_addon_event<reshade::addon_event::draw_indexed>(g_current_context, primcount, count, index_buffer_binding != 0 ? static_cast<uint32_t>(reinterpret_cast<uintptr_t>(indices) / reshade::opengl::get_index_type_size(type)) : 0, basevertex, 0))
+				return;
+		}
 	}
 #endif
 
@@ -1636,11 +1778,13 @@ HOOK_EXPORT void WINAPI glDrawElements(GLenum mode, GLsizei count, GLenum type,
 		g_current_context->_current_prim_mode = mode;
 		g_current_context->_current_index_type = type;
 
-		GLint index_buffer_binding = 0;
-		glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &index_buffer_binding);
+		if (reshade::has_addon_event<reshade::addon_event::draw_indexed>())
+		{
+			GLint index_buffer_binding = get_binding(GL_ELEMENT_ARRAY_BUFFER_BINDING);
 
-		if (reshade::invoke_addon_event<reshade::addon_event::draw_indexed>(g_current_context, primcount, count, index_buffer_binding != 0 ? static_cast<uint32_t>(reinterpret_cast<uintptr_t>(indices) / reshade::opengl::get_index_type_size(type)) : 0, 0, baseinstance))
-			return;
+			if (reshade::invoke_addon_event<reshade::addon_event::draw_indexed>(g_current_context, primcount, count, index_buffer_binding != 0 ? static_cast<uint32_t>(reinterpret_cast<uintptr_t>(indices) / reshade::opengl::get_index_type_size(type)) : 0, 0, baseinstance))
+				return;
+		}
 	}
 #endif
 
@@ -1662,11 +1806,13 @@ HOOK_EXPORT void WINAPI glDrawElements(GLenum mode, GLsizei count, GLenum type,
 		g_current_context->_current_prim_mode = mode;
 		g_current_context->_current_index_type = type;
 
-		GLint index_buffer_binding = 0;
-		glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &index_buffer_binding);
+		if (reshade::has_addon_event<reshade::addon_event::draw_indexed>())
+		{
+			GLint index_buffer_binding = get_binding(GL_ELEMENT_ARRAY_BUFFER_BINDING);
 
-		if (reshade::invoke_addon_event<reshade::addon_event::draw_indexed>(g_current_context, primcount, count, index_buffer_binding != 0 ? static_cast<uint32_t>(reinterpret_cast<uintptr_t>(indices) / reshade::opengl::get_index_type_size(type)) : 0, basevertex, baseinstance))
-			return;
+			if (reshade::invoke_addon_event<reshade::addon_event::draw_indexed>(g_current_context, primcount, count, index_buffer_binding != 0 ? static_cast<uint32_t>(reinterpret_cast<uintptr_t>(indices) / reshade::opengl::get_index_type_size(type)) : 0, basevertex, baseinstance))
+				return;
+		}
 	}
 #endif
 
@@ -1695,11 +1841,13 @@ HOOK_EXPORT void WINAPI glDrawPixels(GLsizei width, GLsizei height, GLenum forma
 		g_current_context->_current_prim_mode = mode;
 		g_current_context->_current_index_type = type;
 
-		GLint index_buffer_binding = 0;
-		glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &index_buffer_binding);
+		if (reshade::has_addon_event<reshade::addon_event::draw_indexed>())
+		{
+			GLint index_buffer_binding = get_binding(GL_ELEMENT_ARRAY_BUFFER_BINDING);
 
-		if (reshade::invoke_addon_event<reshade::addon_event::draw_indexed>(g_current_context, count, 1, index_buffer_binding != 0 ? static_cast<uint32_t>(reinterpret_cast<uintptr_t>(indices) / reshade::opengl::get_index_type_size(type)) : 0, 0, 0))
-			return;
+			if (reshade::invoke_addon_event<reshade::addon_event::draw_indexed>(g_current_context, count, 1, index_buffer_binding != 0 ? static_cast<uint32_t>(reinterpret_cast<uintptr_t>(indices) / reshade::opengl::get_index_type_size(type)) : 0, 0, 0))
+				return;
+		}
 	}
 #endif
 
@@ -1721,11 +1869,13 @@ HOOK_EXPORT void WINAPI glDrawPixels(GLsizei width, GLsizei height, GLenum forma
 		g_current_context->_current_prim_mode = mode;
 		g_current_context->_current_index_type = type;
 
-		GLint index_buffer_binding = 0;
-		glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &index_buffer_binding);
+		if (reshade::has_addon_event<reshade::addon_event::draw_indexed>())
+		{
+			GLint index_buffer_binding = get_binding(GL_ELEMENT_ARRAY_BUFFER_BINDING);
 
-		if (reshade::invoke_addon_event<reshade::addon_event::draw_indexed>(g_current_context, count, 1, index_buffer_binding != 0 ? static_cast<uint32_t>(reinterpret_cast<uintptr_t>(indices) / reshade::opengl::get_index_type_size(type)) : 0, basevertex, 0))
-			return;
+			if (reshade::invoke_addon_event<reshade::addon_event::draw_indexed>(g_current_context, count, 1, index_buffer_binding != 0 ? static_cast<uint32_t>(reinterpret_cast<uintptr_t>(indices) / reshade::opengl::get_index_type_size(type)) : 0, basevertex, 0))
+				return;
+		}
 	}
 #endif
 
@@ -1755,7 +1905,7 @@ HOOK_EXPORT void WINAPI glEnable(GLenum cap)
 	trampoline(cap);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::bind_pipeline_states>())
 	{
 		uint32_t value = GL_TRUE;
 		reshade::api::dynamic_state state = { reshade::api::dynamic_state::unknown };
@@ -1938,7 +2088,7 @@ HOOK_EXPORT void WINAPI glFrontFace(GLenum mode)
 	trampoline(mode);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::bind_pipeline_states>())
 	{
 		const reshade::api::dynamic_state states[1] = { reshade::api::dynamic_state::front_counter_clockwise };
 		const uint32_t values[1] = { mode == GL_CCW };
@@ -1957,10 +2107,9 @@ HOOK_EXPORT void WINAPI glFrustum(GLdouble left, GLdouble right, GLdouble bottom
 			void WINAPI glGenerateMipmap(GLenum target)
 {
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::generate_mipmaps>())
 	{
-		GLint object = 0;
-		glGetIntegerv(reshade::opengl::get_binding_for_target(target), &object);
+		GLint object = get_binding(reshade::opengl::get_binding_for_target(target));
 
 		if (reshade::invoke_addon_event<reshade::addon_event::generate_mipmaps>(g_current_context, reshade::opengl::make_resource_view_handle(target, object)))
 			return;
@@ -1973,7 +2122,7 @@ HOOK_EXPORT void WINAPI glFrustum(GLdouble left, GLdouble right, GLdouble bottom
 			void WINAPI glGenerateTextureMipmap(GLuint texture)
 {
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::generate_mipmaps>())
 	{
 		if (reshade::invoke_addon_event<reshade::addon_event::generate_mipmaps>(g_current_context, reshade::opengl::make_resource_view_handle(GL_TEXTURE, texture)))
 			return;
@@ -2341,7 +2490,7 @@ HOOK_EXPORT void WINAPI glLogicOp(GLenum opcode)
 	trampoline(opcode);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::bind_pipeline_states>())
 	{
 		const reshade::api::dynamic_state states[1] = { reshade::api::dynamic_state::logic_op };
 		const uint32_t values[1] = { static_cast<uint32_t>(reshade::opengl::convert_logic_op(opcode)) };
@@ -2445,8 +2594,7 @@ HOOK_EXPORT void WINAPI glMultMatrixf(const GLfloat *m)
 {
 
 #if RESHADE_ADDON
-	GLint indirect_buffer_binding = 0;
-	glGetIntegerv(GL_DRAW_INDIRECT_BUFFER_BINDING, &indirect_buffer_binding);
+	GLint indirect_buffer_binding = get_binding(GL_DRAW_INDIRECT_BUFFER_BINDING);
 
 	if (0 != indirect_buffer_binding)
 	{
@@ -2492,8 +2640,7 @@ HOOK_EXPORT void WINAPI glMultMatrixf(const GLfloat *m)
 			void WINAPI glMultiDrawElementsIndirect(GLenum mode, GLenum type, const void *indirect, GLsizei drawcount, GLsizei stride)
 {
 #if RESHADE_ADDON
-	GLint indirect_buffer_binding = 0;
-	glGetIntegerv(GL_DRAW_INDIRECT_BUFFER_BINDING, &indirect_buffer_binding);
+	GLint indirect_buffer_binding = get_binding(GL_DRAW_INDIRECT_BUFFER_BINDING);
 
 	if (0 != indirect_buffer_binding)
 	{
@@ -2554,7 +2701,7 @@ HOOK_EXPORT void WINAPI glMultMatrixf(const GLfloat *m)
 	trampoline(buffer, size, data, usage);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::init_resource>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::init_resource>(
 			g_current_context,
@@ -2591,7 +2738,7 @@ HOOK_EXPORT void WINAPI glMultMatrixf(const GLfloat *m)
 	trampoline(buffer, size, data, flags);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::init_resource>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::init_resource>(
 			g_current_context,
@@ -2627,7 +2774,7 @@ HOOK_EXPORT void WINAPI glMultMatrixf(const GLfloat *m)
 	trampoline(renderbuffer, internalformat, width, height);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::init_resource>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::init_resource>(
 			g_current_context,
@@ -2662,7 +2809,7 @@ HOOK_EXPORT void WINAPI glMultMatrixf(const GLfloat *m)
 	trampoline(renderbuffer, samples, internalformat, width, height);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::init_resource>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::init_resource>(
 			g_current_context,
@@ -2805,7 +2952,7 @@ HOOK_EXPORT void WINAPI glPolygonMode(GLenum face, GLenum mode)
 	trampoline(face, mode);
 
 #if RESHADE_ADDON
-	if (g_current_context && face == GL_FRONT_AND_BACK)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::bind_pipeline_states>() && face == GL_FRONT_AND_BACK)
 	{
 		const reshade::api::dynamic_state states[1] = { reshade::api::dynamic_state::fill_mode };
 		const uint32_t values[1] = { static_cast<uint32_t>(reshade::opengl::convert_fill_mode(mode)) };
@@ -2820,7 +2967,7 @@ HOOK_EXPORT void WINAPI glPolygonOffset(GLfloat factor, GLfloat units)
 	trampoline(factor, units);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::bind_pipeline_states>())
 	{
 		const reshade::api::dynamic_state states[2] = { reshade::api::dynamic_state::depth_bias_slope_scaled, reshade::api::dynamic_state::depth_bias };
 		const uint32_t values[2] = { *reinterpret_cast<const uint32_t *>(&factor), *reinterpret_cast<const uint32_t *>(&units) };
@@ -2839,11 +2986,23 @@ HOOK_EXPORT void WINAPI glPopAttrib()
 {
 	static const auto trampoline = reshade::hooks::call(glPopAttrib);
 	trampoline();
+
+#if RESHADE_ADDON
+	// Restoring the attribute stack may change any of the tracked bindings
+	if (g_current_context)
+		g_current_context->_current_bindings.invalidate();
+#endif
 }
 HOOK_EXPORT void WINAPI glPopClientAttrib()
 {
 	static const auto trampoline = reshade::hooks::call(glPopClientAttrib);
 	trampoline();
+
+#if RESHADE_ADDON
+	// Restoring the attribute stack may change any of the tracked bindings
+	if (g_current_context)
+		g_current_context->_current_bindings.invalidate();
+#endif
 }
 
 HOOK_EXPORT void WINAPI glPopMatrix()
@@ -3065,8 +3224,7 @@ HOOK_EXPORT void WINAPI glRectsv(const GLshort *v1, const GLshort *v2)
 			void WINAPI glRenderbufferStorage(GLenum target, GLenum internalformat, GLsizei width, GLsizei height)
 {
 #if RESHADE_ADDON
-	GLint object = 0;
-	glGetIntegerv(reshade::opengl::get_binding_for_target(target), &object);
+	GLint object = get_binding(reshade::opengl::get_binding_for_target(target));
 
 	const reshade::api::resource_desc desc =
 		reshade::opengl::convert_resource_desc(target, 1, 1, internalformat, width, height);
@@ -3089,7 +3247,7 @@ HOOK_EXPORT void WINAPI glRectsv(const GLshort *v1, const GLshort *v2)
 	trampoline(target, internalformat, width, height);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::init_resource>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::init_resource>(
 			g_current_context,
@@ -3103,8 +3261,7 @@ HOOK_EXPORT void WINAPI glRectsv(const GLshort *v1, const GLshort *v2)
 			void WINAPI glRenderbufferStorageMultisample(GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height)
 {
 #if RESHADE_ADDON
-	GLint object = 0;
-	glGetIntegerv(reshade::opengl::get_binding_for_target(target), &object);
+	GLint object = get_binding(reshade::opengl::get_binding_for_target(target));
 
 	const reshade::api::resource_desc desc =
 		reshade::opengl::convert_resource_desc(target, 1, samples, internalformat, width, height);
@@ -3127,7 +3284,7 @@ HOOK_EXPORT void WINAPI glRectsv(const GLshort *v1, const GLshort *v2)
 	trampoline(target, samples, internalformat, width, height);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::init_resource>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::init_resource>(
 			g_current_context,
@@ -3173,7 +3330,7 @@ HOOK_EXPORT void WINAPI glScissor(GLint x, GLint y, GLsizei width, GLsizei heigh
 	trampoline(x, y, width, height);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::bind_scissor_rects>())
 	{
 		const int32_t rect_data[4] = { x, y, x + width, y + height };
 
@@ -3188,7 +3345,7 @@ HOOK_EXPORT void WINAPI glScissor(GLint x, GLint y, GLsizei width, GLsizei heigh
 	trampoline(first, count, v);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::bind_scissor_rects>())
 	{
 		const auto rect_data = static_cast<int32_t *>(alloca(count * sizeof(int32_t) * 4));
 		for (GLsizei i = 0, k = 0; i < count; ++i, k += 4)
@@ -3209,7 +3366,7 @@ HOOK_EXPORT void WINAPI glScissor(GLint x, GLint y, GLsizei width, GLsizei heigh
 	trampoline(index, left, bottom, width, height);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::bind_scissor_rects>())
 	{
 		const int32_t rect_data[4] = { left, bottom, left + width, bottom + height };
 
@@ -3223,7 +3380,7 @@ HOOK_EXPORT void WINAPI glScissor(GLint x, GLint y, GLsizei width, GLsizei heigh
 	trampoline(index, v);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::bind_scissor_rects>())
 	{
 		const int32_t rect_data[4] = { v[0], v[1], v[0] + v[2], v[1] + v[3] };
 
@@ -3315,6 +3472,7 @@ HOOK_EXPORT void WINAPI glShadeModel(GLenum mode)
 			break;
 		}
 
+		reshade::addon::compute_shader_hashes(desc);
 
 		if (reshade::api::pipeline replacement = { shader };
 			reshade::invoke_addon_event<reshade::addon_event::create_pipeline>(
@@ -3338,7 +3496,7 @@ HOOK_EXPORT void WINAPI glStencilFunc(GLenum func, GLint ref, GLuint mask)
 	trampoline(func, ref, mask);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::bind_pipeline_states>())
 	{
 		const reshade::api::dynamic_state states[4] = { reshade::api::dynamic_state::front_stencil_func, reshade::api::dynamic_state::back_stencil_func, reshade::api::dynamic_state::stencil_reference_value, reshade::api::dynamic_state::stencil_read_mask };
 		const uint32_t values[4] = { static_cast<uint32_t>(reshade::opengl::convert_compare_op(func)), static_cast<uint32_t>(reshade::opengl::convert_compare_op(func)), static_cast<uint32_t>(ref), mask };
@@ -3353,7 +3511,7 @@ HOOK_EXPORT void WINAPI glStencilMask(GLuint mask)
 	trampoline(mask);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::bind_pipeline_states>())
 	{
 		const reshade::api::dynamic_state states[1] = { reshade::api::dynamic_state::stencil_write_mask };
 		const uint32_t values[1] = { mask };
@@ -3368,7 +3526,7 @@ HOOK_EXPORT void WINAPI glStencilOp(GLenum fail, GLenum zfail, GLenum zpass)
 	trampoline(fail, zfail, zpass);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::bind_pipeline_states>())
 	{
 		const reshade::api::dynamic_state states[6] = { reshade::api::dynamic_state::front_stencil_fail_op, reshade::api::dynamic_state::back_stencil_fail_op, reshade::api::dynamic_state::front_stencil_depth_fail_op, reshade::api::dynamic_state::back_stencil_depth_fail_op, reshade::api::dynamic_state::front_stencil_pass_op, reshade::api::dynamic_state::back_stencil_pass_op };
 		const uint32_t values[6] = { static_cast<uint32_t>(reshade::opengl::convert_stencil_op(fail)), static_cast<uint32_t>(reshade::opengl::convert_stencil_op(fail)), static_cast<uint32_t>(reshade::opengl::convert_stencil_op(zfail)), static_cast<uint32_t>(reshade::opengl::convert_stencil_op(zfail)), static_cast<uint32_t>(reshade::opengl::convert_stencil_op(zpass)), static_cast<uint32_t>(reshade::opengl::convert_stencil_op(zpass)) };
@@ -3381,8 +3539,7 @@ HOOK_EXPORT void WINAPI glStencilOp(GLenum fail, GLenum zfail, GLenum zpass)
 			void WINAPI glTexBuffer(GLenum target, GLenum internalformat, GLuint buffer)
 {
 #if RESHADE_ADDON
-	GLint object = 0;
-	glGetIntegerv(reshade::opengl::get_binding_for_target(target), &object);
+	GLint object = get_binding(reshade::opengl::get_binding_for_target(target));
 
 	const reshade::api::resource_view_desc desc =
 		reshade::opengl::convert_resource_view_desc(target, internalformat, 0, 0);
@@ -3406,7 +3563,7 @@ HOOK_EXPORT void WINAPI glStencilOp(GLenum fail, GLenum zfail, GLenum zpass)
 	trampoline(target, internalformat, buffer);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::init_resource_view>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::init_resource_view>(
 			g_current_context,
@@ -3441,7 +3598,7 @@ HOOK_EXPORT void WINAPI glStencilOp(GLenum fail, GLenum zfail, GLenum zpass)
 	trampoline(texture, internalformat, buffer);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::init_resource_view>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::init_resource_view>(
 			g_current_context,
@@ -3456,8 +3613,7 @@ HOOK_EXPORT void WINAPI glStencilOp(GLenum fail, GLenum zfail, GLenum zpass)
 			void WINAPI glTexBufferRange(GLenum target, GLenum internalformat, GLuint buffer, GLintptr offset, GLsizeiptr size)
 {
 #if RESHADE_ADDON
-	GLint object = 0;
-	glGetIntegerv(reshade::opengl::get_binding_for_target(target), &object);
+	GLint object = get_binding(reshade::opengl::get_binding_for_target(target));
 
 	const reshade::api::resource_view_desc desc =
 		reshade::opengl::convert_resource_view_desc(target, internalformat, offset, size);
@@ -3480,7 +3636,7 @@ HOOK_EXPORT void WINAPI glStencilOp(GLenum fail, GLenum zfail, GLenum zpass)
 	trampoline(target, internalformat, buffer, offset, size);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::init_resource_view>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::init_resource_view>(
 			g_current_context,
@@ -3515,7 +3671,7 @@ HOOK_EXPORT void WINAPI glStencilOp(GLenum fail, GLenum zfail, GLenum zpass)
 	trampoline(texture, internalformat, buffer, offset, size);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::init_resource_view>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::init_resource_view>(
 			g_current_context,
@@ -3772,10 +3928,8 @@ HOOK_EXPORT void WINAPI glTexImage1D(GLenum target, GLint level, GLint internalf
 	}
 
 #if RESHADE_ADDON
-	GLint object = 0;
-	glGetIntegerv(reshade::opengl::get_binding_for_target(target), &object);
-	GLint unpack = 0;
-	glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &unpack);
+	GLint object = get_binding(reshade::opengl::get_binding_for_target(target));
+	GLint unpack = get_binding(GL_PIXEL_UNPACK_BUFFER_BINDING);
 
 	const reshade::api::resource_desc desc = reshade::opengl::convert_resource_desc(target, 1, 1, static_cast<GLenum>(internalformat), width);
 	const reshade::api::subresource_data initial_data = reshade::opengl::convert_mapped_subresource(format, type, pixels, width);
@@ -3798,7 +3952,7 @@ HOOK_EXPORT void WINAPI glTexImage1D(GLenum target, GLint level, GLint internalf
 	trampoline(target, level, internalformat, width, border, format, type, pixels);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::init_resource>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::init_resource>(
 			g_current_context,
@@ -3835,10 +3989,8 @@ HOOK_EXPORT void WINAPI glTexImage2D(GLenum target, GLint level, GLint internalf
 	}
 
 #if RESHADE_ADDON
-	GLint object = 0;
-	glGetIntegerv(reshade::opengl::get_binding_for_target(target), &object);
-	GLint unpack = 0;
-	glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &unpack);
+	GLint object = get_binding(reshade::opengl::get_binding_for_target(target));
+	GLint unpack = get_binding(GL_PIXEL_UNPACK_BUFFER_BINDING);
 
 	const reshade::api::resource_desc desc = reshade::opengl::convert_resource_desc(target, 1, 1, static_cast<GLenum>(internalformat), width, height);
 	const reshade::api::subresource_data initial_data = reshade::opengl::convert_mapped_subresource(format, type, pixels, width, height);
@@ -3862,7 +4014,7 @@ HOOK_EXPORT void WINAPI glTexImage2D(GLenum target, GLint level, GLint internalf
 	trampoline(target, level, internalformat, width, height, border, format, type, pixels);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::init_resource>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::init_resource>(
 			g_current_context,
@@ -3876,8 +4028,7 @@ HOOK_EXPORT void WINAPI glTexImage2D(GLenum target, GLint level, GLint internalf
 			void WINAPI glTexImage2DMultisample(GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height, GLboolean fixedsamplelocations)
 {
 #if RESHADE_ADDON
-	GLint object = 0;
-	glGetIntegerv(reshade::opengl::get_binding_for_target(target), &object);
+	GLint object = get_binding(reshade::opengl::get_binding_for_target(target));
 
 	const reshade::api::resource_desc desc =
 		reshade::opengl::convert_resource_desc(target, 1, samples, internalformat, width, height);
@@ -3900,7 +4051,7 @@ HOOK_EXPORT void WINAPI glTexImage2D(GLenum target, GLint level, GLint internalf
 	trampoline(target, samples, internalformat, width, height, fixedsamplelocations);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::init_resource>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::init_resource>(
 			g_current_context,
@@ -3937,10 +4088,8 @@ HOOK_EXPORT void WINAPI glTexImage2D(GLenum target, GLint level, GLint internalf
 	}
 
 #if RESHADE_ADDON
-	GLint object = 0;
-	glGetIntegerv(reshade::opengl::get_binding_for_target(target), &object);
-	GLint unpack = 0;
-	glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &unpack);
+	GLint object = get_binding(reshade::opengl::get_binding_for_target(target));
+	GLint unpack = get_binding(GL_PIXEL_UNPACK_BUFFER_BINDING);
 
 	const reshade::api::resource_desc desc = reshade::opengl::convert_resource_desc(target, 1, 1, static_cast<GLenum>(internalformat), width, height, depth);
 	const reshade::api::subresource_data initial_data = reshade::opengl::convert_mapped_subresource(format, type, pixels, width, height, depth);
@@ -3963,7 +4112,7 @@ HOOK_EXPORT void WINAPI glTexImage2D(GLenum target, GLint level, GLint internalf
 	trampoline(target, level, internalformat, width, height, depth, border, format, type, pixels);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::init_resource>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::init_resource>(
 			g_current_context,
@@ -3977,8 +4126,7 @@ HOOK_EXPORT void WINAPI glTexImage2D(GLenum target, GLint level, GLint internalf
 			void WINAPI glTexImage3DMultisample(GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth, GLboolean fixedsamplelocations)
 {
 #if RESHADE_ADDON
-	GLint object = 0;
-	glGetIntegerv(reshade::opengl::get_binding_for_target(target), &object);
+	GLint object = get_binding(reshade::opengl::get_binding_for_target(target));
 
 	const reshade::api::resource_desc desc =
 		reshade::opengl::convert_resource_desc(target, 1, samples, internalformat, width, height, depth);
@@ -4001,7 +4149,7 @@ HOOK_EXPORT void WINAPI glTexImage2D(GLenum target, GLint level, GLint internalf
 	trampoline(target, samples, internalformat, width, height, depth, fixedsamplelocations);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::init_resource>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::init_resource>(
 			g_current_context,
@@ -4048,8 +4196,7 @@ HOOK_EXPORT void WINAPI glTexSubImage2D(GLenum target, GLint level, GLint xoffse
 			void WINAPI glTexStorage1D(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width)
 {
 #if RESHADE_ADDON
-	GLint object = 0;
-	glGetIntegerv(reshade::opengl::get_binding_for_target(target), &object);
+	GLint object = get_binding(reshade::opengl::get_binding_for_target(target));
 
 	const reshade::api::resource_desc desc =
 		reshade::opengl::convert_resource_desc(target, levels, 1, internalformat, width);
@@ -4072,7 +4219,7 @@ HOOK_EXPORT void WINAPI glTexSubImage2D(GLenum target, GLint level, GLint xoffse
 	trampoline(target, levels, internalformat, width);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::init_resource>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::init_resource>(
 			g_current_context,
@@ -4086,8 +4233,7 @@ HOOK_EXPORT void WINAPI glTexSubImage2D(GLenum target, GLint level, GLint xoffse
 			void WINAPI glTexStorage2D(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height)
 {
 #if RESHADE_ADDON
-	GLint object = 0;
-	glGetIntegerv(reshade::opengl::get_binding_for_target(target), &object);
+	GLint object = get_binding(reshade::opengl::get_binding_for_target(target));
 
 	const reshade::api::resource_desc desc =
 		reshade::opengl::convert_resource_desc(target, levels, 1, internalformat, width, height);
@@ -4110,7 +4256,7 @@ HOOK_EXPORT void WINAPI glTexSubImage2D(GLenum target, GLint level, GLint xoffse
 	trampoline(target, levels, internalformat, width, height);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::init_resource>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::init_resource>(
 			g_current_context,
@@ -4124,8 +4270,7 @@ HOOK_EXPORT void WINAPI glTexSubImage2D(GLenum target, GLint level, GLint xoffse
 			void WINAPI glTexStorage2DMultisample(GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height, GLboolean fixedsamplelocations)
 {
 #if RESHADE_ADDON
-	GLint object = 0;
-	glGetIntegerv(reshade::opengl::get_binding_for_target(target), &object);
+	GLint object = get_binding(reshade::opengl::get_binding_for_target(target));
 
 	const reshade::api::resource_desc desc =
 		reshade::opengl::convert_resource_desc(target, 1, samples, internalformat, width, height);
@@ -4148,7 +4293,7 @@ HOOK_EXPORT void WINAPI glTexSubImage2D(GLenum target, GLint level, GLint xoffse
 	trampoline(target, samples, internalformat, width, height, fixedsamplelocations);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::init_resource>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::init_resource>(
 			g_current_context,
@@ -4162,8 +4307,7 @@ HOOK_EXPORT void WINAPI glTexSubImage2D(GLenum target, GLint level, GLint xoffse
 			void WINAPI glTexStorage3D(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth)
 {
 #if RESHADE_ADDON
-	GLint object = 0;
-	glGetIntegerv(reshade::opengl::get_binding_for_target(target), &object);
+	GLint object = get_binding(reshade::opengl::get_binding_for_target(target));
 
 	const reshade::api::resource_desc desc =
 		reshade::opengl::convert_resource_desc(target, levels, 1, internalformat, width, height, depth);
@@ -4186,7 +4330,7 @@ HOOK_EXPORT void WINAPI glTexSubImage2D(GLenum target, GLint level, GLint xoffse
 	trampoline(target, levels, internalformat, width, height, depth);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::init_resource>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::init_resource>(
 			g_current_context,
@@ -4200,8 +4344,7 @@ HOOK_EXPORT void WINAPI glTexSubImage2D(GLenum target, GLint level, GLint xoffse
 			void WINAPI glTexStorage3DMultisample(GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth, GLboolean fixedsamplelocations)
 {
 #if RESHADE_ADDON
-	GLint object = 0;
-	glGetIntegerv(reshade::opengl::get_binding_for_target(target), &object);
+	GLint object = get_binding(reshade::opengl::get_binding_for_target(target));
 
 	const reshade::api::resource_desc desc =
 		reshade::opengl::convert_resource_desc(target, 1, samples, internalformat, width, height, depth);
@@ -4224,7 +4367,7 @@ HOOK_EXPORT void WINAPI glTexSubImage2D(GLenum target, GLint level, GLint xoffse
 	trampoline(target, samples, internalformat, width, height, depth, fixedsamplelocations);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::init_resource>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::init_resource>(
 			g_current_context,
@@ -4259,7 +4402,7 @@ HOOK_EXPORT void WINAPI glTexSubImage2D(GLenum target, GLint level, GLint xoffse
 	trampoline(texture, levels, internalformat, width);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::init_resource>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::init_resource>(
 			g_current_context,
@@ -4294,7 +4437,7 @@ HOOK_EXPORT void WINAPI glTexSubImage2D(GLenum target, GLint level, GLint xoffse
 	trampoline(texture, levels, internalformat, width, height);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::init_resource>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::init_resource>(
 			g_current_context,
@@ -4329,7 +4472,7 @@ HOOK_EXPORT void WINAPI glTexSubImage2D(GLenum target, GLint level, GLint xoffse
 	trampoline(texture, samples, internalformat, width, height, fixedsamplelocations);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::init_resource>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::init_resource>(
 			g_current_context,
@@ -4364,7 +4507,7 @@ HOOK_EXPORT void WINAPI glTexSubImage2D(GLenum target, GLint level, GLint xoffse
 	trampoline(texture, levels, internalformat, width, height, depth);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::init_resource>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::init_resource>(
 			g_current_context,
@@ -4399,7 +4542,7 @@ HOOK_EXPORT void WINAPI glTexSubImage2D(GLenum target, GLint level, GLint xoffse
 	trampoline(texture, samples, internalformat, width, height, depth, fixedsamplelocations);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::init_resource>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::init_resource>(
 			g_current_context,
@@ -4436,7 +4579,7 @@ HOOK_EXPORT void WINAPI glTexSubImage2D(GLenum target, GLint level, GLint xoffse
 	trampoline(texture, target, origtexture, internalformat, minlevel, numlevels, minlayer, numlayers);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::init_resource_view>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::init_resource_view>(
 			g_current_context,
@@ -4465,7 +4608,7 @@ HOOK_EXPORT void WINAPI glTranslatef(GLfloat x, GLfloat y, GLfloat z)
 	trampoline(location, v0);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::push_constants>())
 	{
 		const GLfloat v[1] = { v0 };
 		reshade::invoke_addon_event<reshade::addon_event::push_constants>(
@@ -4479,7 +4622,7 @@ HOOK_EXPORT void WINAPI glTranslatef(GLfloat x, GLfloat y, GLfloat z)
 	trampoline(location, v0, v1);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::push_constants>())
 	{
 		const GLfloat v[2] = { v0, v1 };
 		reshade::invoke_addon_event<reshade::addon_event::push_constants>(
@@ -4493,7 +4636,7 @@ HOOK_EXPORT void WINAPI glTranslatef(GLfloat x, GLfloat y, GLfloat z)
 	trampoline(location, v0, v1, v2);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::push_constants>())
 	{
 		const GLfloat v[3] = { v0, v1, v2 };
 		reshade::invoke_addon_event<reshade::addon_event::push_constants>(
@@ -4507,7 +4650,7 @@ HOOK_EXPORT void WINAPI glTranslatef(GLfloat x, GLfloat y, GLfloat z)
 	trampoline(location, v0, v1, v2, v3);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::push_constants>())
 	{
 		const GLfloat v[4] = { v0, v1, v2, v3 };
 		reshade::invoke_addon_event<reshade::addon_event::push_constants>(
@@ -4521,7 +4664,7 @@ HOOK_EXPORT void WINAPI glTranslatef(GLfloat x, GLfloat y, GLfloat z)
 	trampoline(location, v0);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::push_constants>())
 	{
 		const GLint v[1] = { v0 };
 		reshade::invoke_addon_event<reshade::addon_event::push_constants>(
@@ -4535,7 +4678,7 @@ HOOK_EXPORT void WINAPI glTranslatef(GLfloat x, GLfloat y, GLfloat z)
 	trampoline(location, v0, v1);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::push_constants>())
 	{
 		const GLint v[2] = { v0, v1 };
 		reshade::invoke_addon_event<reshade::addon_event::push_constants>(
@@ -4549,7 +4692,7 @@ HOOK_EXPORT void WINAPI glTranslatef(GLfloat x, GLfloat y, GLfloat z)
 	trampoline(location, v0, v1, v2);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::push_constants>())
 	{
 		const GLint v[3] = { v0, v1, v2 };
 		reshade::invoke_addon_event<reshade::addon_event::push_constants>(
@@ -4563,7 +4706,7 @@ HOOK_EXPORT void WINAPI glTranslatef(GLfloat x, GLfloat y, GLfloat z)
 	trampoline(location, v0, v1, v2, v3);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::push_constants>())
 	{
 		const GLint v[4] = { v0, v1, v2, v3 };
 		reshade::invoke_addon_event<reshade::addon_event::push_constants>(
@@ -4577,7 +4720,7 @@ HOOK_EXPORT void WINAPI glTranslatef(GLfloat x, GLfloat y, GLfloat z)
 	trampoline(location, v0);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::push_constants>())
 	{
 		const GLuint v[1] = { v0 };
 		reshade::invoke_addon_event<reshade::addon_event::push_constants>(
@@ -4591,7 +4734,7 @@ HOOK_EXPORT void WINAPI glTranslatef(GLfloat x, GLfloat y, GLfloat z)
 	trampoline(location, v0, v1);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::push_constants>())
 	{
 		const GLuint v[2] = { v0, v1 };
 		reshade::invoke_addon_event<reshade::addon_event::push_constants>(
@@ -4605,7 +4748,7 @@ HOOK_EXPORT void WINAPI glTranslatef(GLfloat x, GLfloat y, GLfloat z)
 	trampoline(location, v0, v1, v2);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::push_constants>())
 	{
 		const GLuint v[3] = { v0, v1, v2 };
 		reshade::invoke_addon_event<reshade::addon_event::push_constants>(
@@ -4619,7 +4762,7 @@ HOOK_EXPORT void WINAPI glTranslatef(GLfloat x, GLfloat y, GLfloat z)
 	trampoline(location, v0, v1, v2, v3);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::push_constants>())
 	{
 		const GLuint v[4] = { v0, v1, v2, v3 };
 		reshade::invoke_addon_event<reshade::addon_event::push_constants>(
@@ -4633,7 +4776,7 @@ HOOK_EXPORT void WINAPI glTranslatef(GLfloat x, GLfloat y, GLfloat z)
 	trampoline(location, count, v);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::push_constants>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::push_constants>(
 			g_current_context, reshade::api::shader_stage::all, reshade::api::pipeline_layout { 0 }, 0, location, 1 * count, reinterpret_cast<const uint32_t *>(v));
@@ -4646,7 +4789,7 @@ HOOK_EXPORT void WINAPI glTranslatef(GLfloat x, GLfloat y, GLfloat z)
 	trampoline(location, count, v);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::push_constants>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::push_constants>(
 			g_current_context, reshade::api::shader_stage::all, reshade::api::pipeline_layout { 0 }, 0, location, 2 * count, reinterpret_cast<const uint32_t *>(v));
@@ -4659,7 +4802,7 @@ HOOK_EXPORT void WINAPI glTranslatef(GLfloat x, GLfloat y, GLfloat z)
 	trampoline(location, count, v);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::push_constants>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::push_constants>(
 			g_current_context, reshade::api::shader_stage::all, reshade::api::pipeline_layout { 0 }, 0, location, 3 * count, reinterpret_cast<const uint32_t *>(v));
@@ -4672,7 +4815,7 @@ HOOK_EXPORT void WINAPI glTranslatef(GLfloat x, GLfloat y, GLfloat z)
 	trampoline(location, count, v);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::push_constants>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::push_constants>(
 			g_current_context, reshade::api::shader_stage::all, reshade::api::pipeline_layout { 0 }, 0, location, 4 * count, reinterpret_cast<const uint32_t *>(v));
@@ -4685,7 +4828,7 @@ HOOK_EXPORT void WINAPI glTranslatef(GLfloat x, GLfloat y, GLfloat z)
 	trampoline(location, count, v);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::push_constants>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::push_constants>(
 			g_current_context, reshade::api::shader_stage::all, reshade::api::pipeline_layout { 0 }, 1, location, 1 * count, reinterpret_cast<const uint32_t *>(v));
@@ -4698,7 +4841,7 @@ HOOK_EXPORT void WINAPI glTranslatef(GLfloat x, GLfloat y, GLfloat z)
 	trampoline(location, count, v);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::push_constants>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::push_constants>(
 			g_current_context, reshade::api::shader_stage::all, reshade::api::pipeline_layout { 0 }, 1, location, 2 * count, reinterpret_cast<const uint32_t *>(v));
@@ -4711,7 +4854,7 @@ HOOK_EXPORT void WINAPI glTranslatef(GLfloat x, GLfloat y, GLfloat z)
 	trampoline(location, count, v);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::push_constants>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::push_constants>(
 			g_current_context, reshade::api::shader_stage::all, reshade::api::pipeline_layout { 0 }, 1, location, 3 * count, reinterpret_cast<const uint32_t *>(v));
@@ -4724,7 +4867,7 @@ HOOK_EXPORT void WINAPI glTranslatef(GLfloat x, GLfloat y, GLfloat z)
 	trampoline(location, count, v);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::push_constants>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::push_constants>(
 			g_current_context, reshade::api::shader_stage::all, reshade::api::pipeline_layout { 0 }, 1, location, 4 * count, reinterpret_cast<const uint32_t *>(v));
@@ -4737,7 +4880,7 @@ HOOK_EXPORT void WINAPI glTranslatef(GLfloat x, GLfloat y, GLfloat z)
 	trampoline(location, count, v);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::push_constants>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::push_constants>(
 			g_current_context, reshade::api::shader_stage::all, reshade::api::pipeline_layout { 0 }, 1, location, 1 * count, v);
@@ -4750,7 +4893,7 @@ HOOK_EXPORT void WINAPI glTranslatef(GLfloat x, GLfloat y, GLfloat z)
 	trampoline(location, count, v);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::push_constants>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::push_constants>(
 			g_current_context, reshade::api::shader_stage::all, reshade::api::pipeline_layout { 0 }, 1, location, 2 * count, v);
@@ -4763,7 +4906,7 @@ HOOK_EXPORT void WINAPI glTranslatef(GLfloat x, GLfloat y, GLfloat z)
 	trampoline(location, count, v);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::push_constants>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::push_constants>(
 			g_current_context, reshade::api::shader_stage::all, reshade::api::pipeline_layout { 0 }, 1, location, 3 * count, v);
@@ -4776,7 +4919,7 @@ HOOK_EXPORT void WINAPI glTranslatef(GLfloat x, GLfloat y, GLfloat z)
 	trampoline(location, count, v);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::push_constants>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::push_constants>(
 			g_current_context, reshade::api::shader_stage::all, reshade::api::pipeline_layout { 0 }, 1, location, 4 * count, v);
@@ -4790,7 +4933,12 @@ HOOK_EXPORT void WINAPI glTranslatef(GLfloat x, GLfloat y, GLfloat z)
 	trampoline(program);
 
 #if RESHADE_ADDON
+	RESHADE_PROFILE_CALL("glUseProgram");
+
 	if (g_current_context)
+		g_current_context->_current_bindings.set(GL_CURRENT_PROGRAM, program);
+
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::bind_pipeline>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::bind_pipeline>(
 			g_current_context,
@@ -5005,7 +5153,9 @@ HOOK_EXPORT void WINAPI glViewport(GLint x, GLint y, GLsizei width, GLsizei heig
 	trampoline(x, y, width, height);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	RESHADE_PROFILE_CALL("glViewport");
+
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::bind_viewports>())
 	{
 		const float viewport_data[4] = {
 			static_cast<float>(x),
@@ -5024,7 +5174,7 @@ HOOK_EXPORT void WINAPI glViewport(GLint x, GLint y, GLsizei width, GLsizei heig
 	trampoline(first, count, v);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::bind_viewports>())
 	{
 		auto viewport_data = static_cast<float *>(alloca(count * sizeof(float) * 6));
 		for (GLsizei i = 0, k = 0; i < count; ++i, k += 6, v += 4)
@@ -5047,7 +5197,7 @@ HOOK_EXPORT void WINAPI glViewport(GLint x, GLint y, GLsizei width, GLsizei heig
 	trampoline(index, x, y, w, h);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::bind_viewports>())
 	{
 		const float viewport_data[4] = { x, y, w, h };
 
@@ -5061,7 +5211,7 @@ HOOK_EXPORT void WINAPI glViewport(GLint x, GLint y, GLsizei width, GLsizei heig
 	trampoline(index, v);
 
 #if RESHADE_ADDON
-	if (g_current_context)
+	if (g_current_context && reshade::has_addon_event<reshade::addon_event::bind_viewports>())
 	{
 		reshade::invoke_addon_event<reshade::addon_event::bind_viewports>(g_current_context, 0, 1, v);
 	}
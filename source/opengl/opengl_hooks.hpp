@@ -5,6 +5,8 @@
 
 #include <GL/gl3w.h>
 
+#undef glActiveTexture
+extern "C" void WINAPI glActiveTexture(GLenum texture);
 #undef glBindBuffer
 extern "C" void WINAPI glBindBuffer(GLenum target, GLuint buffer);
 #undef glBindBufferBase
@@ -31,6 +33,8 @@ extern "C" void WINAPI glBindTexture(GLenum target, GLuint texture);
 extern "C" void WINAPI glBindTextureUnit(GLuint unit, GLuint texture);
 #undef glBindTextures
 extern "C" void WINAPI glBindTextures(GLuint first, GLsizei count, const GLuint *textures);
+#undef glBindVertexArray
+extern "C" void WINAPI glBindVertexArray(GLuint array);
 #undef glBindVertexBuffer
 extern "C" void WINAPI glBindVertexBuffer(GLuint bindingindex, GLuint buffer, GLintptr offset, GLsizei stride);
 #undef glBindVertexBuffers
@@ -89,12 +93,16 @@ extern "C" void WINAPI glCopyTextureSubImage3D(GLuint texture, GLint level, GLin
 extern "C" void WINAPI glCullFace(GLenum mode);
 #undef glDeleteBuffers
 extern "C" void WINAPI glDeleteBuffers(GLsizei n, const GLuint *buffers);
+#undef glDeleteFramebuffers
+extern "C" void WINAPI glDeleteFramebuffers(GLsizei n, const GLuint *framebuffers);
 #undef glDeleteSamplers
 extern "C" void WINAPI glDeleteSamplers(GLsizei n, const GLuint *samplers);
 #undef glDeleteShader
 extern "C" void WINAPI glDeleteShader(GLuint shader);
 #undef glDeleteTextures
 extern "C" void WINAPI glDeleteTextures(GLsizei n, const GLuint *textures);
+#undef glDeleteVertexArrays
+extern "C" void WINAPI glDeleteVertexArrays(GLsizei n, const GLuint *arrays);
 #undef glDepthFunc
 extern "C" void WINAPI glDepthFunc(GLenum func);
 #undef glDepthMask
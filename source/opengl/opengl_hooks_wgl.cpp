@@ -5,6 +5,7 @@
 
 #include "dll_log.hpp"
 #include "hook_manager.hpp"
+#include "profiling.hpp"
 #include "reshade_api_swapchain.hpp"
 #include "opengl_hooks.hpp"
 #include <mutex>
@@ -697,6 +698,19 @@ HOOK_EXPORT BOOL  WINAPI wglMakeCurrent(HDC hdc, HGLRC hglrc)
 			if (s_legacy_contexts.find(hglrc) != s_legacy_contexts.end())
 				runtime->_compatibility_context = true;
 
+			// Create a hidden render context that shares objects with this one, through which texture data is uploaded on a background thread
+			// Call the original functions directly, so that no effect runtime is created for it
+			const int upload_attribs[] = {
+				0x2091 /* WGL_CONTEXT_MAJOR_VERSION_ARB */, 4,
+				0x2092 /* WGL_CONTEXT_MINOR_VERSION_ARB */, 3,
+				0x9126 /* WGL_CONTEXT_PROFILE_MASK_ARB */, runtime->_compatibility_context ? 0x2 /* WGL_CONTEXT_COMPATIBILITY_PROFILE_BIT_ARB */ : 0x1 /* WGL_CONTEXT_CORE_PROFILE_BIT_ARB */,
+				0
+			};
+			if (const HGLRC upload_hglrc = reshade::hooks::call(wglCreateContextAttribsARB)(hdc, hglrc, upload_attribs))
+				runtime->start_texture_upload_thread(hdc, upload_hglrc, reshade::hooks::call(wglMakeCurrent), reshade::hooks::call(wglDeleteContext));
+			else
+				LOG(WARN) << "Failed to create render context for texture uploads (error code " << (GetLastError() & 0xFFFF) << "). Uploading textures on the application thread instead.";
+
 			g_current_context = s_opengl_contexts[hglrc] = runtime;
 
 #if RESHADE_VERBOSE_LOG
@@ -863,6 +877,8 @@ HOOK_EXPORT BOOL  WINAPI wglSwapBuffers(HDC hdc)
 	if (const HWND hwnd = WindowFromDC(hdc);
 		hwnd != nullptr && runtime != nullptr)
 	{
+		RESHADE_PROFILE_SCOPE("wglSwapBuffers");
+
 		RECT rect = { 0, 0, 0, 0 };
 		GetClientRect(hwnd, &rect);
 
@@ -962,6 +978,12 @@ HOOK_EXPORT PROC  WINAPI wglGetProcAddress(LPCSTR lpszProc)
 	if (lpszProc == nullptr)
 		return nullptr;
 #if RESHADE_ADDON
+	else if (0 == strcmp(lpszProc, "glActiveTextureARB")) // GL_ARB_multitexture
+		lpszProc = "glActiveTexture";
+	else if (0 == strcmp(lpszProc, "glBindBufferARB")) // GL_ARB_vertex_buffer_object
+		lpszProc = "glBindBuffer";
+	else if (0 == strcmp(lpszProc, "glDeleteBuffersARB"))
+		lpszProc = "glDeleteBuffers";
 	else if (0 == strcmp(lpszProc, "glIsRenderbufferEXT")) // GL_EXT_framebuffer_object
 		lpszProc = "glIsRenderbuffer";
 	else if (0 == strcmp(lpszProc, "glBindRenderbufferEXT"))
@@ -1136,6 +1158,7 @@ HOOK_EXPORT PROC  WINAPI wglGetProcAddress(LPCSTR lpszProc)
 
 		// Install all OpenGL hooks in a single batch job
 #if RESHADE_ADDON
+		HOOK_PROC(glActiveTexture);
 		HOOK_PROC(glBindBuffer);
 		HOOK_PROC(glBindBufferBase);
 		HOOK_PROC(glBindBufferRange);
@@ -1148,6 +1171,7 @@ HOOK_EXPORT PROC  WINAPI wglGetProcAddress(LPCSTR lpszProc)
 		HOOK_PROC(glBindSamplers);
 		HOOK_PROC(glBindTextureUnit);
 		HOOK_PROC(glBindTextures);
+		HOOK_PROC(glBindVertexArray);
 		HOOK_PROC(glBindVertexBuffer);
 		HOOK_PROC(glBindVertexBuffers);
 		HOOK_PROC(glBlitFramebuffer);
@@ -1166,8 +1190,10 @@ HOOK_EXPORT PROC  WINAPI wglGetProcAddress(LPCSTR lpszProc)
 		HOOK_PROC(glCopyTextureSubImage2D);
 		HOOK_PROC(glCopyTextureSubImage3D);
 		HOOK_PROC(glDeleteBuffers);
+		HOOK_PROC(glDeleteFramebuffers);
 		HOOK_PROC(glDeleteSamplers);
 		HOOK_PROC(glDeleteShader);
+		HOOK_PROC(glDeleteVertexArrays);
 		HOOK_PROC(glDispatchCompute);
 		HOOK_PROC(glDispatchComputeIndirect);
 		HOOK_PROC(glDrawArraysIndirect);
@@ -103,12 +103,41 @@ void reshade::opengl::pipeline_impl::apply_graphics() const
 	}
 }
 
+void reshade::opengl::device_impl::barrier(uint32_t count, const api::resource *, const api::resource_usage *old_states, const api::resource_usage *new_states)
+{
+	// OpenGL keeps track of resource states itself, except for writes through image load/store, which only become visible to subsequent operations after a memory barrier
+	GLbitfield barriers = 0;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		if ((old_states[i] & api::resource_usage::unordered_access) == api::resource_usage::undefined)
+			continue;
+
+		if ((new_states[i] & api::resource_usage::unordered_access) != api::resource_usage::undefined)
+			barriers |= GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT;
+		if ((new_states[i] & api::resource_usage::shader_resource) != api::resource_usage::undefined)
+			barriers |= GL_TEXTURE_FETCH_BARRIER_BIT;
+		if ((new_states[i] & api::resource_usage::constant_buffer) != api::resource_usage::undefined)
+			barriers |= GL_UNIFORM_BARRIER_BIT;
+		if ((new_states[i] & (api::resource_usage::copy_source | api::resource_usage::copy_dest | api::resource_usage::resolve_source | api::resource_usage::resolve_dest)) != api::resource_usage::undefined)
+			barriers |= GL_TEXTURE_UPDATE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT;
+		if ((new_states[i] & (api::resource_usage::render_target | api::resource_usage::depth_stencil)) != api::resource_usage::undefined)
+			barriers |= GL_FRAMEBUFFER_BARRIER_BIT;
+		if ((new_states[i] & (api::resource_usage::vertex_buffer | api::resource_usage::index_buffer)) != api::resource_usage::undefined)
+			barriers |= GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT;
+	}
+
+	if (barriers != 0)
+		glMemoryBarrier(barriers);
+}
+
 void reshade::opengl::device_impl::begin_render_pass(api::render_pass pass)
 {
 	const GLuint fbo_object = pass.handle & 0xFFFFFFFF;
 	const GLuint num_color_attachments = static_cast<uint32_t>(pass.handle >> 40);
 
 	glBindFramebuffer(GL_FRAMEBUFFER, fbo_object);
+	_current_bindings.set(GL_READ_FRAMEBUFFER_BINDING, fbo_object);
+	_current_bindings.set(GL_DRAW_FRAMEBUFFER_BINDING, fbo_object);
 
 	if (num_color_attachments == 0)
 	{
@@ -134,16 +163,24 @@ void reshade::opengl::device_impl::bind_pipeline(api::pipeline_stage type, api::
 {
 	assert(pipeline.handle != 0);
 
+	// Using a program before it finished linking would wait on that anyway, but need to also release its shader objects and report errors
+	if (type == api::pipeline_stage::all_compute || type == api::pipeline_stage::all_graphics)
+		finish_program_link(*reinterpret_cast<pipeline_impl *>(pipeline.handle), true);
+
 	switch (type)
 	{
 	case api::pipeline_stage::all_compute:
 		reinterpret_cast<pipeline_impl *>(pipeline.handle)->apply_compute();
+		_current_bindings.set(GL_CURRENT_PROGRAM, reinterpret_cast<pipeline_impl *>(pipeline.handle)->program);
 		break;
 	case api::pipeline_stage::all_graphics:
 		// Always disable alpha test in case the application set that (fixes broken GUI rendering in Quake)
 		if (_compatibility_context)
 			glDisable(GL_ALPHA_TEST);
 		reinterpret_cast<pipeline_impl *>(pipeline.handle)->apply_graphics();
+		_current_bindings.set(GL_CURRENT_PROGRAM, reinterpret_cast<pipeline_impl *>(pipeline.handle)->program);
+		_current_bindings.set(GL_VERTEX_ARRAY_BINDING, reinterpret_cast<pipeline_impl *>(pipeline.handle)->vao);
+		_current_bindings.invalidate(GL_ELEMENT_ARRAY_BUFFER_BINDING); // Index buffer binding is part of the vertex array object that was just bound
 		_current_prim_mode = reinterpret_cast<pipeline_impl *>(pipeline.handle)->prim_mode;
 		break;
 	default:
@@ -243,6 +280,7 @@ void reshade::opengl::device_impl::push_constants(api::shader_stage, api::pipeli
 
 	// Binds the push constant buffer to the requested indexed binding point as well as the generic binding point
 	glBindBufferBase(GL_UNIFORM_BUFFER, push_constants_binding, _push_constants);
+	_current_bindings.set(GL_UNIFORM_BUFFER_BINDING, _push_constants);
 
 	// Recreate the buffer data store in case it is no longer large enough
 	if (count > _push_constants_size)
@@ -263,11 +301,107 @@ void reshade::opengl::device_impl::push_constants(api::shader_stage, api::pipeli
 		glUnmapBuffer(GL_UNIFORM_BUFFER);
 	}
 }
+static void push_descriptors_multi_bind(reshade::opengl::binding_cache &bindings, reshade::api::descriptor_type type, GLuint first, GLuint count, const void *descriptors)
+{
+	using namespace reshade;
+
+	// Descriptors are bound in batches of consecutive units, which are split at empty views (since those are skipped, rather than unbound)
+	constexpr GLuint max_batch_size = 32;
+	GLuint objects[max_batch_size];
+	GLuint samplers[max_batch_size];
+
+	for (GLuint i = 0; i < count;)
+	{
+		GLuint batch_size = 0;
+
+		switch (type)
+		{
+		case api::descriptor_type::sampler:
+			for (; batch_size < max_batch_size && i + batch_size < count; ++batch_size)
+			{
+				const auto &descriptor = static_cast<const api::sampler *>(descriptors)[i + batch_size];
+				samplers[batch_size] = descriptor.handle & 0xFFFFFFFF;
+				bindings.set_sampler(first + i + batch_size, samplers[batch_size]);
+			}
+			glBindSamplers(first + i, batch_size, samplers);
+			break;
+		case api::descriptor_type::sampler_with_resource_view:
+			for (; batch_size < max_batch_size && i + batch_size < count; ++batch_size)
+			{
+				const auto &descriptor = static_cast<const api::sampler_with_resource_view *>(descriptors)[i + batch_size];
+				if (descriptor.view.handle == 0)
+					break;
+				objects[batch_size] = descriptor.view.handle & 0xFFFFFFFF;
+				samplers[batch_size] = descriptor.sampler.handle & 0xFFFFFFFF;
+				bindings.set_sampler(first + i + batch_size, samplers[batch_size]);
+				if ((descriptor.view.handle >> 40) == GL_TEXTURE_2D)
+					bindings.set_texture_unit_2d(first + i + batch_size, objects[batch_size]);
+				else
+					bindings.invalidate_texture_units(first + i + batch_size, 1);
+			}
+			if (batch_size != 0)
+			{
+				glBindSamplers(first + i, batch_size, samplers);
+				glBindTextures(first + i, batch_size, objects);
+			}
+			break;
+		case api::descriptor_type::shader_resource_view:
+			for (; batch_size < max_batch_size && i + batch_size < count; ++batch_size)
+			{
+				const auto &descriptor = static_cast<const api::resource_view *>(descriptors)[i + batch_size];
+				if (descriptor.handle == 0)
+					break;
+				objects[batch_size] = descriptor.handle & 0xFFFFFFFF;
+				if ((descriptor.handle >> 40) == GL_TEXTURE_2D)
+					bindings.set_texture_unit_2d(first + i + batch_size, objects[batch_size]);
+				else
+					bindings.invalidate_texture_units(first + i + batch_size, 1);
+			}
+			if (batch_size != 0)
+				glBindTextures(first + i, batch_size, objects);
+			break;
+		case api::descriptor_type::unordered_access_view:
+			for (; batch_size < max_batch_size && i + batch_size < count; ++batch_size)
+			{
+				const auto &descriptor = static_cast<const api::resource_view *>(descriptors)[i + batch_size];
+				if (descriptor.handle == 0)
+					break;
+				objects[batch_size] = descriptor.handle & 0xFFFFFFFF;
+			}
+			// This takes the format from the texture, so does not need to query its internal format like 'glBindImageTexture'
+			if (batch_size != 0)
+				glBindImageTextures(first + i, batch_size, objects);
+			break;
+		case api::descriptor_type::constant_buffer:
+			for (; batch_size < max_batch_size && i + batch_size < count; ++batch_size)
+			{
+				const auto &descriptor = static_cast<const api::resource *>(descriptors)[i + batch_size];
+				objects[batch_size] = descriptor.handle & 0xFFFFFFFF;
+			}
+			// Unlike 'glBindBufferBase' this does not modify the generic binding point
+			glBindBuffersBase(GL_UNIFORM_BUFFER, first + i, batch_size, objects);
+			break;
+		default:
+			return;
+		}
+
+		// An empty batch means the view at this position is empty, so skip over it
+		i += std::max(batch_size, 1u);
+	}
+}
+
 void reshade::opengl::device_impl::push_descriptors(api::shader_stage, api::pipeline_layout layout, uint32_t layout_index, api::descriptor_type type, uint32_t first, uint32_t count, const void *descriptors)
 {
 	if (layout.handle != 0)
 		first += reinterpret_cast<pipeline_layout_impl *>(layout.handle)->bindings[layout_index];
 
+	// Bind consecutive descriptors with a single call where 'GL_ARB_multi_bind' is available (core since OpenGL 4.4), which also avoids switching the active texture unit
+	if (gl3wProcs.gl.BindTextures != nullptr)
+	{
+		push_descriptors_multi_bind(_current_bindings, type, first, count, descriptors);
+		return;
+	}
+
 	switch (type)
 	{
 	case api::descriptor_type::sampler:
@@ -275,6 +409,7 @@ void reshade::opengl::device_impl::push_descriptors(api::shader_stage, api::pipe
 		{
 			const auto &descriptor = static_cast<const api::sampler *>(descriptors)[i];
 			glBindSampler(i + first, descriptor.handle & 0xFFFFFFFF);
+			_current_bindings.set_sampler(i + first, descriptor.handle & 0xFFFFFFFF);
 		}
 		break;
 	case api::descriptor_type::sampler_with_resource_view:
@@ -286,6 +421,9 @@ void reshade::opengl::device_impl::push_descriptors(api::shader_stage, api::pipe
 			glBindSampler(i + first, descriptor.sampler.handle & 0xFFFFFFFF);
 			glActiveTexture(GL_TEXTURE0 + i + first);
 			glBindTexture(descriptor.view.handle >> 40, descriptor.view.handle & 0xFFFFFFFF);
+			_current_bindings.set_sampler(i + first, descriptor.sampler.handle & 0xFFFFFFFF);
+			_current_bindings.set(GL_ACTIVE_TEXTURE, GL_TEXTURE0 + i + first);
+			_current_bindings.set(get_binding_for_target(descriptor.view.handle >> 40), descriptor.view.handle & 0xFFFFFFFF);
 		}
 		break;
 	case api::descriptor_type::shader_resource_view:
@@ -296,6 +434,8 @@ void reshade::opengl::device_impl::push_descriptors(api::shader_stage, api::pipe
 				continue;
 			glActiveTexture(GL_TEXTURE0 + i + first);
 			glBindTexture(descriptor.handle >> 40, descriptor.handle & 0xFFFFFFFF);
+			_current_bindings.set(GL_ACTIVE_TEXTURE, GL_TEXTURE0 + i + first);
+			_current_bindings.set(get_binding_for_target(descriptor.handle >> 40), descriptor.handle & 0xFFFFFFFF);
 		}
 		break;
 	case api::descriptor_type::unordered_access_view:
@@ -330,6 +470,7 @@ void reshade::opengl::device_impl::push_descriptors(api::shader_stage, api::pipe
 		{
 			const auto &descriptor = static_cast<const api::resource *>(descriptors)[i];
 			glBindBufferBase(GL_UNIFORM_BUFFER, i + first, descriptor.handle & 0xFFFFFFFF);
+			_current_bindings.set(GL_UNIFORM_BUFFER_BINDING, descriptor.handle & 0xFFFFFFFF);
 		}
 		break;
 	}
@@ -356,6 +497,7 @@ void reshade::opengl::device_impl::bind_index_buffer(api::resource buffer, uint6
 	assert(offset == 0);
 
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer.handle & 0xFFFFFFFF);
+	_current_bindings.set(GL_ELEMENT_ARRAY_BUFFER_BINDING, buffer.handle & 0xFFFFFFFF);
 
 	switch (index_size)
 	{
@@ -401,14 +543,17 @@ void reshade::opengl::device_impl::draw_or_dispatch_indirect(api::indirect_comma
 	{
 	case api::indirect_command::draw:
 		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer.handle & 0xFFFFFFFF);
+		_current_bindings.set(GL_DRAW_INDIRECT_BUFFER_BINDING, buffer.handle & 0xFFFFFFFF);
 		glMultiDrawArraysIndirect(_current_prim_mode, reinterpret_cast<const void *>(static_cast<uintptr_t>(offset)), static_cast<GLsizei>(draw_count), static_cast<GLsizei>(stride));
 		break;
 	case api::indirect_command::draw_indexed:
 		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer.handle & 0xFFFFFFFF);
+		_current_bindings.set(GL_DRAW_INDIRECT_BUFFER_BINDING, buffer.handle & 0xFFFFFFFF);
 		glMultiDrawElementsIndirect(_current_prim_mode, _current_index_type, reinterpret_cast<const void *>(static_cast<uintptr_t>(offset)), static_cast<GLsizei>(draw_count), static_cast<GLsizei>(stride));
 		break;
 	case api::indirect_command::dispatch:
 		glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, buffer.handle & 0xFFFFFFFF);
+		_current_bindings.set(GL_DISPATCH_INDIRECT_BUFFER_BINDING, buffer.handle & 0xFFFFFFFF);
 		for (GLuint i = 0; i < draw_count; ++i)
 		{
 			assert(offset <= static_cast<uint64_t>(std::numeric_limits<GLintptr>::max()));
@@ -563,8 +708,8 @@ void reshade::opengl::device_impl::copy_buffer_to_texture(api::resource src, uin
 			glGetTexLevelParameteriv(dst_target, level, GL_TEXTURE_DEPTH,  &d);
 		}
 
-		const auto row_size_packed = (row_length != 0 ? row_length : w) * api::format_bpp(convert_format(format));
-		const auto slice_size_packed = (slice_height != 0 ? slice_height : h) * row_size_packed;
+		const auto row_size_packed = api::format_row_pitch(convert_format(format), row_length != 0 ? row_length : w);
+		const auto slice_size_packed = api::format_slice_pitch(convert_format(format), row_size_packed, slice_height != 0 ? slice_height : h);
 		const auto total_size = d * slice_size_packed;
 
 		format = convert_upload_format(format, type);
@@ -914,8 +1059,8 @@ void reshade::opengl::device_impl::copy_texture_to_buffer(api::resource src, uin
 		GLenum format = GL_NONE, type;
 		glGetTexLevelParameteriv(src_target, 0, GL_TEXTURE_INTERNAL_FORMAT, reinterpret_cast<GLint *>(&format));
 
-		const auto row_size_packed = (row_length != 0 ? row_length : w) * api::format_bpp(convert_format(format));
-		const auto slice_size_packed = (slice_height != 0 ? slice_height : h) * row_size_packed;
+		const auto row_size_packed = api::format_row_pitch(convert_format(format), row_length != 0 ? row_length : w);
+		const auto slice_size_packed = api::format_slice_pitch(convert_format(format), row_size_packed, slice_height != 0 ? slice_height : h);
 		const auto total_size = d * slice_size_packed;
 
 		format = convert_upload_format(format, type);
@@ -1024,18 +1169,40 @@ void reshade::opengl::device_impl::clear_unordered_access_view_float(api::resour
 void reshade::opengl::device_impl::generate_mipmaps(api::resource_view srv)
 {
 	assert(srv.handle != 0);
+
+	// Mipmaps can only be generated once the texture upload thread finished writing the texture, so defer until the last upload to it is retired
+	if (!_texture_uploads.empty())
+	{
+		api::resource resource = {};
+		get_resource_from_view(srv, &resource);
+
+		const std::lock_guard<std::mutex> lock(_upload_mutex);
+
+		for (auto it = _texture_uploads.rbegin(); it != _texture_uploads.rend(); ++it)
+		{
+			if (it->dst.handle == resource.handle)
+			{
+				it->deferred_mipmaps.push_back(srv);
+				return;
+			}
+		}
+	}
 	const GLenum target = srv.handle >> 40;
 	const GLuint object = srv.handle & 0xFFFFFFFF;
 
 	glBindSampler(0, 0);
 	glActiveTexture(GL_TEXTURE0); // src
 	glBindTexture(target, object);
+	_current_bindings.set_sampler(0, 0);
+	_current_bindings.set(GL_ACTIVE_TEXTURE, GL_TEXTURE0);
+	_current_bindings.set(get_binding_for_target(target), object);
 
 #if 0
 	glGenerateMipmap(target);
 #else
 	// Use custom mipmap generation implementation because 'glGenerateMipmap' generates shifted results
 	glUseProgram(_mipmap_program);
+	_current_bindings.set(GL_CURRENT_PROGRAM, _mipmap_program);
 
 	GLuint levels = 0;
 	GLuint base_width = 0;
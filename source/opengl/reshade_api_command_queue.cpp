@@ -9,3 +9,69 @@ void reshade::opengl::device_impl::flush_immediate_command_list() const
 {
 	glFlush();
 }
+
+uint64_t reshade::opengl::device_impl::get_pending_fence_value()
+{
+	const GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	// OpenGL keeps objects alive and synchronizes access to them on its own, so a value that was already reached is still safe to hand out if no fence can be created
+	if (fence == nullptr)
+		return get_completed_fence_value();
+
+	_fences.emplace_back(++_fence_value, fence);
+
+	return _fence_value;
+}
+uint64_t reshade::opengl::device_impl::get_completed_fence_value() const
+{
+	// Fences are signaled in the order they were issued, so can stop at the first one that has not yet (and poll without flushing)
+	while (!_fences.empty())
+	{
+		const GLenum status = glClientWaitSync(_fences.front().second, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			break;
+
+		glDeleteSync(_fences.front().second);
+		_completed_fence_value = _fences.front().first;
+		_fences.pop_front();
+	}
+
+	return _completed_fence_value;
+}
+
+bool reshade::opengl::device_impl::allocate_upload_memory(uint64_t size, uint64_t alignment, void **out_data, api::resource *out_buffer, uint64_t *out_offset)
+{
+	// Persistently mapped buffers require 'GL_ARB_buffer_storage' (core since OpenGL 4.4)
+	// Only create the ring buffer once it is actually used
+	if (gl3wProcs.gl.BufferStorage == nullptr || (!_upload_ring.is_valid() && !_upload_ring.create(this)))
+	{
+		*out_data = nullptr;
+		return false;
+	}
+
+	if (!_upload_ring.allocate(size, alignment, out_data, out_buffer, out_offset))
+		return false;
+
+	_has_pending_uploads = true;
+	return true;
+}
+void reshade::opengl::device_impl::submit_upload_memory()
+{
+	if (!_has_pending_uploads)
+		return;
+	_has_pending_uploads = false;
+
+	_upload_ring.submit(_upload_frame_index);
+	_upload_fences[_upload_frame_index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	_upload_frame_index = (_upload_frame_index + 1) % NUM_UPLOAD_FRAMES;
+
+	// Wait for the GPU to finish reading the allocations of the oldest frame before handing out that memory again
+	if (GLsync &fence = _upload_fences[_upload_frame_index]; fence != nullptr)
+	{
+		glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX);
+		glDeleteSync(fence);
+		fence = nullptr;
+
+		_upload_ring.reclaim(_upload_frame_index);
+	}
+}
@@ -7,7 +7,11 @@
 #include "ini_file.hpp"
 #include "reshade_api_device.hpp"
 #include "reshade_api_type_convert.hpp"
+#include "resource_ledger.hpp"
 #include <cassert>
+#include <algorithm>
+
+extern HMODULE g_module_handle;
 
 static GLint get_rbo_param(GLuint id, GLenum param)
 {
@@ -148,10 +152,20 @@ reshade::opengl::device_impl::device_impl(HDC initial_hdc, HGLRC hglrc) :
 	{
 		const GLubyte *const extension = glGetStringi(GL_EXTENSIONS, i);
 		if (std::strcmp(reinterpret_cast<const char *>(extension), "GL_ARB_compatibility") == 0)
-		{
 			_compatibility_context = true;
-			break;
-		}
+		else if (std::strcmp(reinterpret_cast<const char *>(extension), "GL_KHR_parallel_shader_compile") == 0 && gl3wProcs.gl.MaxShaderCompilerThreadsKHR != nullptr)
+			_parallel_shader_compile = true;
+		else if (std::strcmp(reinterpret_cast<const char *>(extension), "GL_ARB_parallel_shader_compile") == 0 && gl3wProcs.gl.MaxShaderCompilerThreadsARB != nullptr)
+			_parallel_shader_compile = true;
+	}
+
+	// Let the driver compile and link shaders on as many background threads as it wants, so that programs can be created without blocking on the result (see 'finish_program_link')
+	if (_parallel_shader_compile)
+	{
+		if (gl3wProcs.gl.MaxShaderCompilerThreadsKHR != nullptr)
+			glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+		else
+			glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
 	}
 
 #ifndef NDEBUG
@@ -221,6 +235,20 @@ reshade::opengl::device_impl::~device_impl()
 	addon::unload_addons();
 #endif
 
+	// Stop texture upload thread (which finishes all uploads that are still pending before exiting)
+	if (_upload_thread.joinable())
+	{
+		{ const std::lock_guard<std::mutex> lock(_upload_mutex);
+			_upload_thread_exit = true;
+		}
+
+		_upload_condition.notify_all();
+		_upload_thread.join();
+	}
+
+	for (const texture_upload &upload : _texture_uploads)
+		glDeleteSync(upload.done_fence);
+
 	// Destroy mipmap generation program
 	glDeleteProgram(_mipmap_program);
 
@@ -230,6 +258,15 @@ reshade::opengl::device_impl::~device_impl()
 	// Destroy push constants buffer
 	glDeleteBuffers(1, &_push_constants);
 
+	// Destroy upload ring buffer and the fences guarding it
+	for (GLsync &fence : _upload_fences)
+		glDeleteSync(fence);
+	_upload_ring.destroy(this);
+
+	// Destroy fences that were issued for fence values which were not yet found to be reached
+	for (const std::pair<uint64_t, GLsync> &fence : _fences)
+		glDeleteSync(fence.second);
+
 	// Free range of reserved texture names
 	glDeleteTextures(static_cast<GLsizei>(_reserved_texture_names.size()), _reserved_texture_names.data());
 }
@@ -315,6 +352,10 @@ bool reshade::opengl::device_impl::check_format_support(api::format format, api:
 
 	return supported && (supported_depth || supported_stencil) && (supported_color_render && supported_render_target) && (supported_unordered_access_load && supported_unordered_access_store);
 }
+uint64_t reshade::opengl::device_impl::get_resource_memory_usage(api::resource_memory_owner owner, api::resource_memory_category category) const
+{
+	return resource_ledger::get_usage(this, owner, category);
+}
 
 bool reshade::opengl::device_impl::is_resource_handle_valid(api::resource handle) const
 {
@@ -449,6 +490,9 @@ bool reshade::opengl::device_impl::create_sampler(const api::sampler_desc &desc,
 }
 bool reshade::opengl::device_impl::create_resource(const api::resource_desc &desc, const api::subresource_data *initial_data, api::resource_usage, api::resource *out)
 {
+	// Keep track of how much memory ReShade and add-ons allocate (this also covers all the return paths below)
+	const resource_ledger::create_scope ledger_scope(this, desc, out, _ReturnAddress());
+
 	GLenum target = GL_NONE;
 	switch (desc.type)
 	{
@@ -519,6 +563,10 @@ bool reshade::opengl::device_impl::create_resource(const api::resource_desc &des
 		GLbitfield usage_flags = GL_NONE;
 		convert_memory_heap_to_flags(desc, usage_flags);
 
+		// Allow 'upload_buffer_region' to fall back to 'glBufferSubData' for buffers that are updated from the CPU
+		if ((desc.usage & api::resource_usage::copy_dest) != api::resource_usage::undefined)
+			usage_flags |= GL_DYNAMIC_STORAGE_BIT;
+
 		assert(desc.buffer.size <= static_cast<uint64_t>(std::numeric_limits<GLsizeiptr>::max()));
 		glBufferStorage(target, static_cast<GLsizeiptr>(desc.buffer.size), nullptr, usage_flags);
 
@@ -578,7 +626,7 @@ bool reshade::opengl::device_impl::create_resource(const api::resource_desc &des
 		if (initial_data != nullptr)
 		{
 			for (uint32_t subresource = 0; subresource < static_cast<uint32_t>(desc.texture.depth_or_layers) * desc.texture.levels; ++subresource)
-				upload_texture_region(initial_data[subresource], make_resource_handle(target, object), subresource, nullptr);
+				upload_texture_region_immediate(initial_data[subresource], make_resource_handle(target, object), subresource, nullptr);
 		}
 
 		glBindTexture(target, prev_object);
@@ -699,7 +747,50 @@ bool reshade::opengl::device_impl::create_resource_view(api::resource resource,
 	}
 }
 
-static bool create_shader_module(GLenum type, const reshade::api::shader_desc &desc, GLuint &shader_object, bool existing_shader_object = false)
+static inline void hash_combine(uint64_t &hash, const void *data, size_t size)
+{
+	hash ^= std::hash<std::string_view>()(std::string_view(static_cast<const char *>(data), size)) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+}
+static inline void hash_combine(uint64_t &hash, const reshade::api::shader_desc &desc)
+{
+	hash_combine(hash, desc.code, desc.code_size);
+	hash_combine(hash, &desc.format, sizeof(desc.format));
+	if (desc.entry_point != nullptr)
+		hash_combine(hash, desc.entry_point, std::strlen(desc.entry_point));
+	hash_combine(hash, desc.spec_constant_ids, desc.num_spec_constants * sizeof(uint32_t));
+	hash_combine(hash, desc.spec_constant_values, desc.num_spec_constants * sizeof(uint32_t));
+}
+static inline auto program_binary_key(const reshade::api::pipeline_desc &desc) -> uint64_t
+{
+	uint64_t hash = static_cast<uint64_t>(desc.type);
+	if (desc.type == reshade::api::pipeline_stage::all_compute || desc.type == reshade::api::pipeline_stage::compute_shader)
+	{
+		hash_combine(hash, desc.compute.shader);
+	}
+	else
+	{
+		hash_combine(hash, desc.graphics.vertex_shader);
+		hash_combine(hash, desc.graphics.hull_shader);
+		hash_combine(hash, desc.graphics.domain_shader);
+		hash_combine(hash, desc.graphics.geometry_shader);
+		hash_combine(hash, desc.graphics.pixel_shader);
+	}
+	return hash;
+}
+
+static std::string get_driver_identity()
+{
+	// Program binaries are only valid for the driver that created them, so identify it by its renderer and version strings
+	std::string identity;
+	if (const GLubyte *const renderer = glGetString(GL_RENDERER))
+		identity += reinterpret_cast<const char *>(renderer);
+	identity += '\n';
+	if (const GLubyte *const version = glGetString(GL_VERSION))
+		identity += reinterpret_cast<const char *>(version);
+	return identity;
+}
+
+static bool create_shader_module(GLenum type, const reshade::api::shader_desc &desc, GLuint &shader_object, bool existing_shader_object = false, bool check_status = true)
 {
 	if (!existing_shader_object)
 		shader_object = 0;
@@ -728,6 +819,10 @@ static bool create_shader_module(GLenum type, const reshade::api::shader_desc &d
 		glSpecializeShader(shader_object, desc.entry_point, desc.num_spec_constants, desc.spec_constant_ids, desc.spec_constant_values);
 	}
 
+	// Querying the compile status waits for the compilation to finish, so skip that when it is checked when the program finished linking instead
+	if (!check_status)
+		return true;
+
 	GLint status = GL_FALSE;
 	glGetShaderiv(shader_object, GL_COMPILE_STATUS, &status);
 	if (GL_FALSE != status)
@@ -780,103 +875,155 @@ bool reshade::opengl::device_impl::create_pipeline(const api::pipeline_desc &des
 }
 bool reshade::opengl::device_impl::create_compute_pipeline(const api::pipeline_desc &desc, api::pipeline *out)
 {
-	GLuint cs;
-	const GLuint program = glCreateProgram();
+	GLuint program = 0;
+	bool link_pending = false;
+	const uint64_t binary_key = program_binary_key(desc);
 
-	if (create_shader_module(GL_COMPUTE_SHADER, desc.compute.shader, cs))
-		glAttachShader(program, cs);
+	if (!load_program_binary(binary_key, program))
+	{
+		GLuint cs;
+		program = glCreateProgram();
 
-	glLinkProgram(program);
+		if (create_shader_module(GL_COMPUTE_SHADER, desc.compute.shader, cs, false, !_parallel_shader_compile))
+			glAttachShader(program, cs);
 
-	if (cs != 0)
-		glDetachShader(program, cs);
+		if (_program_binaries_enabled)
+			glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 
-	glDeleteShader(cs);
+		glLinkProgram(program);
 
-	GLint status = GL_FALSE;
-	glGetProgramiv(program, GL_LINK_STATUS, &status);
-	if (GL_FALSE == status ||
-		(desc.compute.shader.code_size != 0 && cs == 0))
-	{
-		GLint log_size = 0;
-		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &log_size);
-		std::vector<char> log(log_size);
-		glGetProgramInfoLog(program, log_size, nullptr, log.data());
+		if (_parallel_shader_compile)
+		{
+			// Shader objects are only flagged for deletion while still attached, so they are released together with the program once the link finished
+			glDeleteShader(cs);
 
-		LOG(ERROR) << "Failed to link GLSL program:\n" << log.data();
+			link_pending = true;
+		}
+		else
+		{
+			if (cs != 0)
+				glDetachShader(program, cs);
 
-		glDeleteProgram(program);
+			glDeleteShader(cs);
 
-		*out = { 0 };
-		return false;
+			GLint status = GL_FALSE;
+			glGetProgramiv(program, GL_LINK_STATUS, &status);
+			if (GL_FALSE == status ||
+				(desc.compute.shader.code_size != 0 && cs == 0))
+			{
+				GLint log_size = 0;
+				glGetProgramiv(program, GL_INFO_LOG_LENGTH, &log_size);
+				std::vector<char> log(log_size);
+				glGetProgramInfoLog(program, log_size, nullptr, log.data());
+
+				LOG(ERROR) << "Failed to link GLSL program:\n" << log.data();
+
+				glDeleteProgram(program);
+
+				*out = { 0 };
+				return false;
+			}
+
+			save_program_binary(binary_key, program);
+		}
 	}
 
 	const auto state = new pipeline_impl();
 	state->program = program;
+	state->link_pending = link_pending;
+	state->binary_key = binary_key;
 
 	*out = { reinterpret_cast<uintptr_t>(state) };
 	return true;
 }
 bool reshade::opengl::device_impl::create_graphics_pipeline(const api::pipeline_desc &desc, api::pipeline *out)
 {
-	GLuint vs, hs, ds, gs, ps;
-	const GLuint program = glCreateProgram();
-
-	if (create_shader_module(GL_VERTEX_SHADER, desc.graphics.vertex_shader, vs))
-		glAttachShader(program, vs);
-	if (create_shader_module(GL_TESS_CONTROL_SHADER, desc.graphics.hull_shader, hs))
-		glAttachShader(program, hs);
-	if (create_shader_module(GL_TESS_EVALUATION_SHADER, desc.graphics.domain_shader, ds))
-		glAttachShader(program, ds);
-	if (create_shader_module(GL_GEOMETRY_SHADER, desc.graphics.geometry_shader, gs))
-		glAttachShader(program, gs);
-	if (create_shader_module(GL_FRAGMENT_SHADER, desc.graphics.pixel_shader, ps))
-		glAttachShader(program, ps);
-
-	glLinkProgram(program);
-
-	if (vs != 0)
-		glDetachShader(program, vs);
-	if (hs != 0)
-		glDetachShader(program, hs);
-	if (ds != 0)
-		glDetachShader(program, ds);
-	if (gs != 0)
-		glDetachShader(program, gs);
-	if (ps != 0)
-		glDetachShader(program, ps);
-
-	glDeleteShader(vs);
-	glDeleteShader(hs);
-	glDeleteShader(ds);
-	glDeleteShader(gs);
-	glDeleteShader(ps);
+	GLuint program = 0;
+	bool link_pending = false;
+	const uint64_t binary_key = program_binary_key(desc);
 
-	GLint status = GL_FALSE;
-	glGetProgramiv(program, GL_LINK_STATUS, &status);
-
-	if (GL_FALSE == status ||
-		(desc.graphics.vertex_shader.code_size != 0 && vs == 0) ||
-		(desc.graphics.hull_shader.code_size != 0 && hs == 0) ||
-		(desc.graphics.domain_shader.code_size != 0 && ds == 0) ||
-		(desc.graphics.geometry_shader.code_size != 0 && gs == 0) ||
-		(desc.graphics.pixel_shader.code_size != 0 && ps == 0))
+	if (!load_program_binary(binary_key, program))
 	{
-		GLint log_size = 0;
-		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &log_size);
-		std::vector<char> log(log_size);
-		glGetProgramInfoLog(program, log_size, nullptr, log.data());
+		GLuint vs, hs, ds, gs, ps;
+		program = glCreateProgram();
 
-		LOG(ERROR) << "Failed to link GLSL program: " << log.data();
+		if (create_shader_module(GL_VERTEX_SHADER, desc.graphics.vertex_shader, vs, false, !_parallel_shader_compile))
+			glAttachShader(program, vs);
+		if (create_shader_module(GL_TESS_CONTROL_SHADER, desc.graphics.hull_shader, hs, false, !_parallel_shader_compile))
+			glAttachShader(program, hs);
+		if (create_shader_module(GL_TESS_EVALUATION_SHADER, desc.graphics.domain_shader, ds, false, !_parallel_shader_compile))
+			glAttachShader(program, ds);
+		if (create_shader_module(GL_GEOMETRY_SHADER, desc.graphics.geometry_shader, gs, false, !_parallel_shader_compile))
+			glAttachShader(program, gs);
+		if (create_shader_module(GL_FRAGMENT_SHADER, desc.graphics.pixel_shader, ps, false, !_parallel_shader_compile))
+			glAttachShader(program, ps);
 
-		glDeleteProgram(program);
+		if (_program_binaries_enabled)
+			glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 
-		*out = { 0 };
-		return false;
+		glLinkProgram(program);
+
+		if (_parallel_shader_compile)
+		{
+			// Shader objects are only flagged for deletion while still attached, so they are released together with the program once the link finished
+			glDeleteShader(vs);
+			glDeleteShader(hs);
+			glDeleteShader(ds);
+			glDeleteShader(gs);
+			glDeleteShader(ps);
+
+			link_pending = true;
+		}
+		else
+		{
+			if (vs != 0)
+				glDetachShader(program, vs);
+			if (hs != 0)
+				glDetachShader(program, hs);
+			if (ds != 0)
+				glDetachShader(program, ds);
+			if (gs != 0)
+				glDetachShader(program, gs);
+			if (ps != 0)
+				glDetachShader(program, ps);
+
+			glDeleteShader(vs);
+			glDeleteShader(hs);
+			glDeleteShader(ds);
+			glDeleteShader(gs);
+			glDeleteShader(ps);
+
+			GLint status = GL_FALSE;
+			glGetProgramiv(program, GL_LINK_STATUS, &status);
+
+			if (GL_FALSE == status ||
+				(desc.graphics.vertex_shader.code_size != 0 && vs == 0) ||
+				(desc.graphics.hull_shader.code_size != 0 && hs == 0) ||
+				(desc.graphics.domain_shader.code_size != 0 && ds == 0) ||
+				(desc.graphics.geometry_shader.code_size != 0 && gs == 0) ||
+				(desc.graphics.pixel_shader.code_size != 0 && ps == 0))
+			{
+				GLint log_size = 0;
+				glGetProgramiv(program, GL_INFO_LOG_LENGTH, &log_size);
+				std::vector<char> log(log_size);
+				glGetProgramInfoLog(program, log_size, nullptr, log.data());
+
+				LOG(ERROR) << "Failed to link GLSL program: " << log.data();
+
+				glDeleteProgram(program);
+
+				*out = { 0 };
+				return false;
+			}
+
+			save_program_binary(binary_key, program);
+		}
 	}
 
 	const auto state = new pipeline_impl();
 	state->program = program;
+	state->link_pending = link_pending;
+	state->binary_key = binary_key;
 
 	{
 		GLuint prev_vao = 0;
@@ -1151,9 +1298,16 @@ void reshade::opengl::device_impl::destroy_sampler(api::sampler handle)
 
 	const GLuint object = handle.handle & 0xFFFFFFFF;
 	glDeleteSamplers(1, &object);
+	_current_bindings.invalidate_samplers();
 }
 void reshade::opengl::device_impl::destroy_resource(api::resource handle)
 {
+	// The texture upload thread may still be writing to the resource (or one of its views), so have to wait for it to finish before deleting
+	if (!_texture_uploads.empty())
+		wait_for_texture_uploads();
+
+	resource_ledger::unregister_resource(this, handle);
+
 	const GLuint object = handle.handle & 0xFFFFFFFF;
 	switch (handle.handle >> 40)
 	{
@@ -1172,6 +1326,7 @@ void reshade::opengl::device_impl::destroy_resource(api::resource handle)
 	case GL_QUERY_BUFFER:
 	case GL_ATOMIC_COUNTER_BUFFER:
 		glDeleteBuffers(1, &object);
+		_current_bindings.invalidate_buffers();
 		break;
 	case GL_TEXTURE:
 	case GL_TEXTURE_BUFFER:
@@ -1186,6 +1341,7 @@ void reshade::opengl::device_impl::destroy_resource(api::resource handle)
 	case GL_TEXTURE_CUBE_MAP_ARRAY:
 	case GL_TEXTURE_RECTANGLE:
 		glDeleteTextures(1, &object);
+		_current_bindings.invalidate_textures();
 		break;
 	case GL_RENDERBUFFER:
 		glDeleteRenderbuffers(1, &object);
@@ -1207,6 +1363,9 @@ void reshade::opengl::device_impl::destroy_resource_view(api::resource_view hand
 void reshade::opengl::device_impl::destroy_pipeline(api::pipeline_stage, api::pipeline handle)
 {
 	delete reinterpret_cast<pipeline_impl *>(handle.handle);
+	// Deleting a bound vertex array object reverts to the default one
+	_current_bindings.invalidate(GL_VERTEX_ARRAY_BINDING);
+	_current_bindings.invalidate(GL_ELEMENT_ARRAY_BUFFER_BINDING);
 }
 void reshade::opengl::device_impl::destroy_pipeline_layout(api::pipeline_layout handle)
 {
@@ -1225,6 +1384,8 @@ void reshade::opengl::device_impl::destroy_render_pass(api::render_pass handle)
 {
 	const GLuint object = handle.handle & 0xFFFFFFFF;
 	glDeleteFramebuffers(1, &object);
+	_current_bindings.invalidate(GL_READ_FRAMEBUFFER_BINDING);
+	_current_bindings.invalidate(GL_DRAW_FRAMEBUFFER_BINDING);
 }
 void reshade::opengl::device_impl::destroy_descriptor_sets(api::descriptor_set_layout, uint32_t count, const api::descriptor_set *sets)
 {
@@ -1340,6 +1501,21 @@ bool reshade::opengl::device_impl::map_resource(api::resource resource, uint32_t
 	case GL_QUERY_BUFFER:
 	case GL_ATOMIC_COUNTER_BUFFER:
 		assert(subresource == 0);
+		if (gl3wProcs.gl.BufferStorage != nullptr)
+		{
+			const GLbitfield storage_flags = get_buf_param(target, object, GL_BUFFER_STORAGE_FLAGS);
+
+			// Immutable buffer storage that was not created for this kind of access cannot be mapped (mutable buffers always report both read and write access), so fail without causing an error
+			if ((map_access & ~storage_flags & (GL_MAP_READ_BIT | GL_MAP_WRITE_BIT)) != 0)
+			{
+				*data = nullptr;
+				break;
+			}
+
+			// Map persistently if the buffer storage allows it, so that the buffer may stay mapped while the GPU is using it (see 'convert_memory_heap_to_flags')
+			map_access |= storage_flags & (GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+		}
+
 		if (gl3wProcs.gl.MapNamedBuffer != nullptr)
 		{
 			const GLuint length = get_buf_param(target, object, GL_BUFFER_SIZE);
@@ -1413,6 +1589,17 @@ void reshade::opengl::device_impl::upload_buffer_region(const void *data, api::r
 	assert(dst.handle != 0);
 	assert(dst_offset <= static_cast<uint64_t>(std::numeric_limits<GLintptr>::max()) && size <= static_cast<uint64_t>(std::numeric_limits<GLsizeiptr>::max()));
 
+	// Copy from the persistently mapped upload ring buffer on the GPU timeline, which avoids the implicit synchronization or copy the driver has to do for 'glBufferSubData'
+	void *upload_data = nullptr;
+	api::resource upload_buffer = {};
+	uint64_t upload_offset = 0;
+	if (allocate_upload_memory(size, 16, &upload_data, &upload_buffer, &upload_offset))
+	{
+		std::memcpy(upload_data, data, static_cast<size_t>(size));
+		copy_buffer_region(upload_buffer, upload_offset, dst, dst_offset, size);
+		return;
+	}
+
 	const GLenum target = dst.handle >> 40;
 	const GLuint object = dst.handle & 0xFFFFFFFF;
 
@@ -1429,6 +1616,46 @@ void reshade::opengl::device_impl::upload_buffer_region(const void *data, api::r
 
 }
 void reshade::opengl::device_impl::upload_texture_region(const api::subresource_data &data, api::resource dst, uint32_t dst_subresource, const int32_t dst_box[6])
+{
+	assert(dst.handle != 0);
+
+	// Hand uploads of entire 2D texture levels to the texture upload thread, so that loading large textures does not stall the application
+	// This is limited to uploads made by ReShade itself, since add-ons expect the data to be visible to the next command, rather than only after the next present
+	HMODULE caller_module = nullptr;
+	if (_upload_thread_ready && dst_box == nullptr && (dst.handle >> 40) == GL_TEXTURE_2D && data.slice_pitch != 0 &&
+		GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, static_cast<LPCWSTR>(_ReturnAddress()), &caller_module) && caller_module == g_module_handle)
+	{
+		texture_upload upload = { dst, dst_subresource, data };
+		// The data pointer is only valid during this call, so have to copy it
+		upload.pixels.assign(static_cast<const uint8_t *>(data.data), static_cast<const uint8_t *>(data.data) + data.slice_pitch);
+		upload.data.data = upload.pixels.data();
+		// Order the upload after all commands that were issued on this render context so far
+		upload.ready_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glFlush();
+
+		{ const std::lock_guard<std::mutex> lock(_upload_mutex);
+			_texture_uploads.push_back(std::move(upload));
+		}
+
+		_upload_condition.notify_all();
+		return;
+	}
+
+	// Uploads to the same texture have to happen in order, so finish any that are still in flight first
+	if (!_texture_uploads.empty())
+	{
+		std::unique_lock<std::mutex> lock(_upload_mutex);
+		const bool pending = std::any_of(_texture_uploads.begin(), _texture_uploads.end(),
+			[dst](const texture_upload &upload) { return upload.dst.handle == dst.handle; });
+		lock.unlock();
+
+		if (pending)
+			wait_for_texture_uploads();
+	}
+
+	upload_texture_region_immediate(data, dst, dst_subresource, dst_box);
+}
+void reshade::opengl::device_impl::upload_texture_region_immediate(const api::subresource_data &data, api::resource dst, uint32_t dst_subresource, const int32_t dst_box[6])
 {
 	assert(dst.handle != 0);
 	const GLenum target = dst.handle >> 40;
@@ -1500,23 +1727,25 @@ void reshade::opengl::device_impl::upload_texture_region(const api::subresource_
 		glGetTexLevelParameteriv(target, level, GL_TEXTURE_DEPTH,  &depth);
 	}
 
-	const auto row_size_packed = width * api::format_bpp(convert_format(format));
-	const auto slice_size_packed = height * row_size_packed;
+	const auto row_size_packed = api::format_row_pitch(convert_format(format), width);
+	const auto slice_size_packed = api::format_slice_pitch(convert_format(format), row_size_packed, height);
 	const auto total_size = depth * slice_size_packed;
+	// Block compressed formats store a row of 4x4 blocks per row
+	const auto num_rows = static_cast<GLint>(slice_size_packed / row_size_packed);
 
 	format = convert_upload_format(format, type);
 
 	std::vector<uint8_t> temp_pixels;
 	const uint8_t *pixels = static_cast<const uint8_t *>(data.data);
 
-	if ((row_size_packed != data.row_pitch && height == 1) ||
+	if ((row_size_packed != data.row_pitch && num_rows == 1) ||
 		(slice_size_packed != data.slice_pitch && depth == 1))
 	{
 		temp_pixels.resize(total_size);
 		uint8_t *dst_pixels = temp_pixels.data();
 
 		for (GLint z = 0; z < depth; ++z)
-			for (GLint y = 0; y < height; ++y, dst_pixels += row_size_packed)
+			for (GLint y = 0; y < num_rows; ++y, dst_pixels += row_size_packed)
 				std::memcpy(dst_pixels, pixels + z * data.slice_pitch + y * data.row_pitch, row_size_packed);
 
 		pixels = temp_pixels.data();
@@ -1581,6 +1810,103 @@ void reshade::opengl::device_impl::upload_texture_region(const api::subresource_
 	glPixelStorei(GL_UNPACK_SKIP_IMAGES, previous_unpack_skip_images);
 }
 
+void reshade::opengl::device_impl::start_texture_upload_thread(HDC hdc, HGLRC upload_hglrc, BOOL(WINAPI *make_current)(HDC, HGLRC), BOOL(WINAPI *delete_context)(HGLRC))
+{
+	assert(!_upload_thread.joinable());
+
+	_upload_thread = std::thread([this, hdc, upload_hglrc, make_current, delete_context]() {
+		if (!make_current(hdc, upload_hglrc))
+		{
+			LOG(WARN) << "Failed to make texture upload render context current (error code " << (GetLastError() & 0xFFFF) << "). Uploading textures on the application thread instead.";
+
+			delete_context(upload_hglrc);
+			return;
+		}
+
+		_upload_thread_ready = true;
+
+		std::unique_lock<std::mutex> lock(_upload_mutex);
+
+		while (true)
+		{
+			// Entries are only ever removed by the application thread after they were finished, so the iterator stays valid while unlocked below
+			const auto it = std::find_if(_texture_uploads.begin(), _texture_uploads.end(),
+				[](const texture_upload &upload) { return !upload.started; });
+			if (it == _texture_uploads.end())
+			{
+				if (_upload_thread_exit)
+					break;
+
+				_upload_condition.wait(lock);
+				continue;
+			}
+
+			it->started = true;
+
+			lock.unlock();
+
+			glWaitSync(it->ready_fence, 0, GL_TIMEOUT_IGNORED);
+			glDeleteSync(it->ready_fence);
+
+			upload_texture_region_immediate(it->data, it->dst, it->dst_subresource, nullptr);
+
+			const GLsync done_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			// Submit the upload right away, so that the application render context does not wait on a fence that was never flushed
+			glFlush();
+
+			lock.lock();
+
+			it->done_fence = done_fence;
+			it->pixels.clear();
+			it->pixels.shrink_to_fit();
+
+			_upload_condition.notify_all();
+		}
+
+		_upload_thread_ready = false;
+
+		lock.unlock();
+
+		make_current(nullptr, nullptr);
+		delete_context(upload_hglrc);
+	});
+}
+void reshade::opengl::device_impl::retire_texture_uploads()
+{
+	if (_texture_uploads.empty())
+		return;
+
+	std::vector<api::resource_view> deferred_mipmaps;
+
+	{ const std::lock_guard<std::mutex> lock(_upload_mutex);
+		while (!_texture_uploads.empty() && _texture_uploads.front().done_fence != nullptr)
+		{
+			texture_upload &upload = _texture_uploads.front();
+
+			// Make this render context wait for the upload to finish before the texture is used
+			glWaitSync(upload.done_fence, 0, GL_TIMEOUT_IGNORED);
+			glDeleteSync(upload.done_fence);
+
+			deferred_mipmaps.insert(deferred_mipmaps.end(), upload.deferred_mipmaps.begin(), upload.deferred_mipmaps.end());
+
+			_texture_uploads.pop_front();
+		}
+	}
+
+	for (const api::resource_view srv : deferred_mipmaps)
+		generate_mipmaps(srv);
+}
+void reshade::opengl::device_impl::wait_for_texture_uploads()
+{
+	{ std::unique_lock<std::mutex> lock(_upload_mutex);
+		_upload_condition.wait(lock, [this]() {
+			return std::all_of(_texture_uploads.begin(), _texture_uploads.end(), [](const texture_upload &upload) { return upload.done_fence != nullptr; });
+		});
+	}
+
+	retire_texture_uploads();
+}
+
 bool reshade::opengl::device_impl::get_attachment(api::render_pass pass, api::attachment_type type, uint32_t index, api::resource_view *out) const
 {
 	assert(pass.handle != 0);
@@ -1762,6 +2088,199 @@ void reshade::opengl::device_impl::wait_idle() const
 	glFinish();
 }
 
+void reshade::opengl::device_impl::load_pipeline_cache(std::vector<char> &&data)
+{
+	const std::unique_lock<std::mutex> lock(_program_binaries_mutex);
+
+	// Cache is shared between all swap chains of this device, so only need to load it once
+	if (_program_binaries_enabled)
+		return;
+
+	GLint num_binary_formats = 0;
+	if (gl3wProcs.gl.GetProgramBinary != nullptr && gl3wProcs.gl.ProgramBinary != nullptr)
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_binary_formats);
+	if (num_binary_formats == 0)
+		return; // Program binaries are not supported before OpenGL 4.1 (or 'GL_ARB_get_program_binary') and some drivers do not expose any formats
+
+	_program_binaries_enabled = true;
+
+	size_t offset = 0;
+	const auto read = [&data, &offset](void *value, size_t size) {
+		if (offset + size > data.size())
+			return false;
+		std::memcpy(value, data.data() + offset, size);
+		offset += size;
+		return true;
+	};
+
+	// Data may be from a different driver version or adapter, so start over with an empty cache in that case
+	const std::string driver_identity = get_driver_identity();
+	uint32_t identity_size = 0, num_binaries = 0;
+	if (!read(&identity_size, sizeof(identity_size)) || identity_size != driver_identity.size() ||
+		offset + identity_size > data.size() || std::memcmp(data.data() + offset, driver_identity.data(), identity_size) != 0)
+		return;
+	offset += identity_size;
+	if (!read(&num_binaries, sizeof(num_binaries)))
+		return;
+
+	for (uint32_t i = 0; i < num_binaries; ++i)
+	{
+		uint64_t key = 0;
+		uint32_t size = 0;
+		if (!read(&key, sizeof(key)) || !read(&size, sizeof(size)) || size < sizeof(GLenum) || offset + size > data.size())
+			break;
+
+		_program_binaries[key].assign(data.data() + offset, data.data() + offset + size);
+		offset += size;
+	}
+}
+bool reshade::opengl::device_impl::save_pipeline_cache(std::vector<char> &data)
+{
+	const std::unique_lock<std::mutex> lock(_program_binaries_mutex);
+
+	if (!_program_binaries_enabled || !_program_binaries_dirty)
+		return false;
+
+	const std::string driver_identity = get_driver_identity();
+
+	data.clear();
+	const auto write = [&data](const void *value, size_t size) {
+		data.insert(data.end(), static_cast<const char *>(value), static_cast<const char *>(value) + size);
+	};
+
+	const uint32_t identity_size = static_cast<uint32_t>(driver_identity.size());
+	write(&identity_size, sizeof(identity_size));
+	write(driver_identity.data(), identity_size);
+	const uint32_t num_binaries = static_cast<uint32_t>(_program_binaries.size());
+	write(&num_binaries, sizeof(num_binaries));
+
+	for (const std::pair<const uint64_t, std::vector<char>> &binary : _program_binaries)
+	{
+		const uint32_t size = static_cast<uint32_t>(binary.second.size());
+		write(&binary.first, sizeof(binary.first));
+		write(&size, sizeof(size));
+		write(binary.second.data(), size);
+	}
+
+	_program_binaries_dirty = false;
+	return true;
+}
+
+bool reshade::opengl::device_impl::load_program_binary(uint64_t key, GLuint &program)
+{
+	const std::unique_lock<std::mutex> lock(_program_binaries_mutex);
+
+	const auto it = _program_binaries.find(key);
+	if (it == _program_binaries.end())
+		return false;
+
+	GLenum format = GL_NONE;
+	std::memcpy(&format, it->second.data(), sizeof(format));
+
+	program = glCreateProgram();
+	glProgramBinary(program, format, it->second.data() + sizeof(format), static_cast<GLsizei>(it->second.size() - sizeof(format)));
+
+	GLint status = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (GL_FALSE != status)
+		return true;
+
+	// Driver may reject binaries at any time (e.g. after a driver update that did not change the version string), in which case the program has to be linked from source again
+	glDeleteProgram(program);
+	program = 0;
+
+	_program_binaries.erase(it);
+	_program_binaries_dirty = true;
+	return false;
+}
+void reshade::opengl::device_impl::save_program_binary(uint64_t key, GLuint program)
+{
+	const std::unique_lock<std::mutex> lock(_program_binaries_mutex);
+
+	if (!_program_binaries_enabled)
+		return;
+
+	GLint size = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+	if (size <= 0)
+		return;
+
+	std::vector<char> &binary = _program_binaries[key];
+	binary.resize(sizeof(GLenum) + size);
+
+	GLenum format = GL_NONE;
+	glGetProgramBinary(program, size, &size, &format, binary.data() + sizeof(format));
+	if (size <= 0)
+	{
+		_program_binaries.erase(key);
+		return;
+	}
+
+	std::memcpy(binary.data(), &format, sizeof(format));
+	binary.resize(sizeof(format) + size);
+
+	_program_binaries_dirty = true;
+}
+
+bool reshade::opengl::device_impl::finish_program_link(pipeline_impl &state, bool wait)
+{
+	if (!state.link_pending)
+		return true;
+
+	if (!wait)
+	{
+		GLint completed = GL_FALSE;
+		glGetProgramiv(state.program, GL_COMPLETION_STATUS_KHR, &completed);
+		if (GL_FALSE == completed)
+			return false;
+	}
+
+	state.link_pending = false;
+
+	GLuint shaders[5] = {};
+	GLsizei num_shaders = 0;
+	glGetAttachedShaders(state.program, 5, &num_shaders, shaders);
+
+	GLint status = GL_FALSE;
+	glGetProgramiv(state.program, GL_LINK_STATUS, &status);
+	if (GL_FALSE != status)
+	{
+		save_program_binary(state.binary_key, state.program);
+	}
+	else
+	{
+		state.link_failed = true;
+
+		// Compile errors were not checked when the shaders were created, so report them here
+		for (GLsizei i = 0; i < num_shaders; ++i)
+		{
+			glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &status);
+			if (GL_FALSE != status)
+				continue;
+
+			GLint log_size = 0;
+			glGetShaderiv(shaders[i], GL_INFO_LOG_LENGTH, &log_size);
+			std::vector<char> log(log_size);
+			glGetShaderInfoLog(shaders[i], log_size, nullptr, log.data());
+
+			LOG(ERROR) << "Failed to compile GLSL shader: " << log.data();
+		}
+
+		GLint log_size = 0;
+		glGetProgramiv(state.program, GL_INFO_LOG_LENGTH, &log_size);
+		std::vector<char> log(log_size);
+		glGetProgramInfoLog(state.program, log_size, nullptr, log.data());
+
+		LOG(ERROR) << "Failed to link GLSL program: " << log.data();
+	}
+
+	// Detaching releases the shader objects, since they were already flagged for deletion
+	for (GLsizei i = 0; i < num_shaders; ++i)
+		glDetachShader(state.program, shaders[i]);
+
+	return true;
+}
+
 void reshade::opengl::device_impl::set_resource_name(api::resource resource, const char *name)
 {
 	GLenum id = resource.handle >> 40;
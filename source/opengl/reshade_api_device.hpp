@@ -7,11 +7,21 @@
 
 #include "opengl.hpp"
 #include "addon_manager.hpp"
+#include "binding_cache.hpp"
+#include "upload_ring_buffer.hpp"
+#include <list>
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
 #include <unordered_map>
 #include <unordered_set>
 
 namespace reshade::opengl
 {
+	struct pipeline_impl;
+
 	inline auto make_resource_handle(GLenum target, GLuint object) -> api::resource
 	{
 		if (!object)
@@ -40,6 +50,9 @@ namespace reshade::opengl
 		bool check_capability(api::device_caps capability) const final;
 		bool check_format_support(api::format format, api::resource_usage usage) const final;
 
+		bool get_memory_budget(uint64_t *, uint64_t *) const final { return false; }
+		uint64_t get_resource_memory_usage(api::resource_memory_owner owner, api::resource_memory_category category) const final;
+
 		bool is_resource_handle_valid(api::resource handle) const final;
 		bool is_resource_view_handle_valid(api::resource_view handle) const final;
 
@@ -70,6 +83,9 @@ namespace reshade::opengl
 		void destroy_render_pass(api::render_pass handle) final;
 		void destroy_descriptor_sets(api::descriptor_set_layout layout, uint32_t count, const api::descriptor_set *sets) final;
 
+		bool create_command_list(api::command_list **out) final { *out = nullptr; return false; }
+		void destroy_command_list(api::command_list *) final { assert(false); }
+
 		bool get_attachment(api::render_pass pass, api::attachment_type type, uint32_t index, api::resource_view *out) const final;
 		uint32_t get_attachment_count(api::render_pass pass, api::attachment_type type) const final;
 
@@ -90,13 +106,47 @@ namespace reshade::opengl
 
 		void set_resource_name(api::resource resource, const char *name) final;
 
+		/// <summary>
+		/// Initializes the program binary cache used for all pipelines created through this device with previously serialized <paramref name="data"/>.
+		/// </summary>
+		void load_pipeline_cache(std::vector<char> &&data);
+		/// <summary>
+		/// Serializes the contents of the program binary cache into <paramref name="data"/>.
+		/// </summary>
+		/// <returns>Returns whether there were any changes since the cache was loaded.</returns>
+		bool save_pipeline_cache(std::vector<char> &data);
+
+		/// <summary>
+		/// Checks the result of a program the driver is linking in the background, which happens for all pipelines created while parallel shader compilation is available.
+		/// </summary>
+		/// <param name="state">The pipeline to check.</param>
+		/// <param name="wait">Set to <see langword="true"/> to block until linking finished, or <see langword="false"/> to only poll for completion.</param>
+		/// <returns>Returns <see langword="false"/> if linking is still in progress, or <see langword="true"/> otherwise (with the result stored in the pipeline).</returns>
+		bool finish_program_link(pipeline_impl &state, bool wait);
+
+		/// <summary>
+		/// Starts a thread that uploads texture data through the specified render context in the background, which has to share objects with the render context of this device.
+		/// The thread takes ownership of the render context and deletes it again when the device is destroyed.
+		/// </summary>
+		void start_texture_upload_thread(HDC hdc, HGLRC upload_hglrc, BOOL(WINAPI *make_current)(HDC, HGLRC), BOOL(WINAPI *delete_context)(HGLRC));
+		/// <summary>
+		/// Makes all texture uploads the background thread finished so far visible to the render context of this device.
+		/// </summary>
+		void retire_texture_uploads();
+
 		api::device *get_device() override { return this; }
 
 		api::command_list *get_immediate_command_list() final { return this; }
 
 		void flush_immediate_command_list() const final;
 
-		void barrier(uint32_t, const api::resource *, const api::resource_usage *, const api::resource_usage *) final { /* no-op */ }
+		void execute_command_list(api::command_list *cmd_list) final { assert(cmd_list == this); flush_immediate_command_list(); }
+		bool allocate_upload_memory(uint64_t size, uint64_t alignment, void **out_data, api::resource *out_buffer, uint64_t *out_offset) final;
+
+		uint64_t get_pending_fence_value() final;
+		uint64_t get_completed_fence_value() const final;
+
+		void barrier(uint32_t count, const api::resource *resources, const api::resource_usage *old_states, const api::resource_usage *new_states) final;
 
 		void begin_render_pass(api::render_pass pass) final;
 		void finish_render_pass() final;
@@ -143,11 +193,13 @@ namespace reshade::opengl
 
 	public:
 		bool _compatibility_context = false;
+		bool _parallel_shader_compile = false;
 		std::unordered_set<HDC> _hdcs;
 		GLenum _current_prim_mode = GL_NONE;
 		GLenum _current_index_type = GL_UNSIGNED_INT;
 		GLuint _current_vertex_count = 0; // Used to calculate vertex count inside glBegin/glEnd pairs
 		void * _current_event_handle = nullptr;
+		binding_cache _current_bindings;
 
 	private:
 		std::vector<GLuint> _reserved_texture_names;
@@ -156,7 +208,61 @@ namespace reshade::opengl
 		GLuint _push_constants = 0;
 		GLuint _push_constants_size = 0;
 
+		bool load_program_binary(uint64_t key, GLuint &program);
+		void save_program_binary(uint64_t key, GLuint program);
+
+		std::mutex _program_binaries_mutex;
+		// Program binaries by a hash of the shader stages they were linked from, each prefixed with the binary format
+		std::unordered_map<uint64_t, std::vector<char>> _program_binaries;
+		bool _program_binaries_enabled = false;
+		bool _program_binaries_dirty = false;
+
+		static constexpr uint32_t NUM_UPLOAD_FRAMES = 4;
+		upload_ring_buffer<NUM_UPLOAD_FRAMES> _upload_ring;
+		GLsync _upload_fences[NUM_UPLOAD_FRAMES] = {};
+		uint32_t _upload_frame_index = 0;
+		bool _has_pending_uploads = false;
+
+		// Fences that were issued for fence values, in the order they were issued
+		uint64_t _fence_value = 0;
+		mutable uint64_t _completed_fence_value = 0;
+		mutable std::deque<std::pair<uint64_t, GLsync>> _fences;
+
+		struct texture_upload
+		{
+			api::resource dst;
+			uint32_t dst_subresource;
+			api::subresource_data data;
+			std::vector<uint8_t> pixels;
+			// Signaled on this render context once the destination texture is ready to be written
+			GLsync ready_fence;
+			// Signaled on the upload render context once the data was written to the destination texture
+			GLsync done_fence = nullptr;
+			bool started = false;
+			// Mipmap generation requests for the destination texture, which have to wait for the upload to finish
+			std::vector<api::resource_view> deferred_mipmaps;
+		};
+
+		void upload_texture_region_immediate(const api::subresource_data &data, api::resource dst, uint32_t dst_subresource, const int32_t dst_box[6]);
+		/// <summary>
+		/// Blocks until the background thread finished all texture uploads and retires them.
+		/// </summary>
+		void wait_for_texture_uploads();
+
+		std::thread _upload_thread;
+		std::mutex _upload_mutex;
+		std::condition_variable _upload_condition;
+		// Uploads in submission order, which are only removed once they were retired
+		std::list<texture_upload> _texture_uploads;
+		bool _upload_thread_exit = false;
+		std::atomic<bool> _upload_thread_ready = false;
+
 	protected:
+		/// <summary>
+		/// Marks the end of all upload memory allocations made for the current frame and waits for the GPU to finish with the oldest frame, so that its memory can be reused.
+		/// </summary>
+		void submit_upload_memory();
+
 		// Cached context information for quick access
 		GLuint _default_fbo_width = 0;
 		GLuint _default_fbo_height = 0;
@@ -10,6 +10,9 @@
 reshade::opengl::swapchain_impl::swapchain_impl(HDC hdc, HGLRC hglrc) :
 	device_impl(hdc, hglrc), runtime(this, this)
 {
+	// Custom data is shared with the device (see 'get_user_data' overrides), which includes the slots
+	runtime::_user_data_slots = api::device::_user_data_slots;
+
 	GLint major = 0, minor = 0;
 	glGetIntegerv(GL_MAJOR_VERSION, &major);
 	glGetIntegerv(GL_MINOR_VERSION, &minor);
@@ -68,7 +71,7 @@ bool reshade::opengl::swapchain_impl::on_init(HWND hwnd, unsigned int width, uns
 	}
 
 	// Capture and later restore so that the resource creation code below does not affect the application state
-	_app_state.capture(_compatibility_context);
+	_app_state.capture(_compatibility_context, _current_bindings);
 
 	glGenFramebuffers(2, _fbo);
 	glGenRenderbuffers(1, &_rbo);
@@ -77,10 +80,18 @@ bool reshade::opengl::swapchain_impl::on_init(HWND hwnd, unsigned int width, uns
 	glRenderbufferStorage(GL_RENDERBUFFER, GL_SRGB8_ALPHA8, _width, _height);
 
 	glBindFramebuffer(GL_FRAMEBUFFER, _fbo[0]);
+	_current_bindings.set(GL_READ_FRAMEBUFFER_BINDING, _fbo[0]);
+	_current_bindings.set(GL_DRAW_FRAMEBUFFER_BINDING, _fbo[0]);
 	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _rbo);
 	assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
 
-	_app_state.apply(_compatibility_context);
+	_app_state.apply(_compatibility_context, _current_bindings);
+
+	// Initialize program binary cache with the data from the previous session, so that effect programs do not have to be compiled and linked again
+	{	std::vector<char> pipeline_cache_data;
+		runtime::load_pipeline_cache(pipeline_cache_data);
+		device_impl::load_pipeline_cache(std::move(pipeline_cache_data));
+	}
 
 	return runtime::on_init(hwnd);
 }
@@ -88,6 +99,9 @@ void reshade::opengl::swapchain_impl::on_reset()
 {
 	runtime::on_reset();
 
+	if (std::vector<char> pipeline_cache_data; device_impl::save_pipeline_cache(pipeline_cache_data))
+		runtime::save_pipeline_cache(pipeline_cache_data);
+
 	glDeleteFramebuffers(2, _fbo);
 	glDeleteRenderbuffers(1, &_rbo);
 
@@ -102,7 +116,10 @@ void reshade::opengl::swapchain_impl::on_present(bool default_fbo)
 	if (!is_initialized())
 		return;
 
-	_app_state.capture(_compatibility_context);
+	_app_state.capture(_compatibility_context, _current_bindings);
+
+	// Make textures the upload thread finished in the meantime available to effects
+	retire_texture_uploads();
 
 	// Set clip space to something consistent
 	if (gl3wProcs.gl.ClipControl != nullptr)
@@ -115,6 +132,8 @@ void reshade::opengl::swapchain_impl::on_present(bool default_fbo)
 		glDisable(GL_FRAMEBUFFER_SRGB);
 		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
 		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _fbo[0]);
+		_current_bindings.set(GL_READ_FRAMEBUFFER_BINDING, 0);
+		_current_bindings.set(GL_DRAW_FRAMEBUFFER_BINDING, _fbo[0]);
 		glReadBuffer(GL_BACK);
 		glDrawBuffer(GL_COLOR_ATTACHMENT0);
 		glBlitFramebuffer(0, 0, _width, _height, 0, _height, _width, 0, GL_COLOR_BUFFER_BIT, GL_NEAREST);
@@ -122,6 +141,7 @@ void reshade::opengl::swapchain_impl::on_present(bool default_fbo)
 	else
 	{
 		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _fbo[0]);
+		_current_bindings.set(GL_DRAW_FRAMEBUFFER_BINDING, _fbo[0]);
 		glDrawBuffer(GL_COLOR_ATTACHMENT0);
 	}
 
@@ -134,6 +154,8 @@ void reshade::opengl::swapchain_impl::on_present(bool default_fbo)
 		glDisable(GL_FRAMEBUFFER_SRGB);
 		glBindFramebuffer(GL_READ_FRAMEBUFFER, _fbo[0]);
 		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+		_current_bindings.set(GL_READ_FRAMEBUFFER_BINDING, _fbo[0]);
+		_current_bindings.set(GL_DRAW_FRAMEBUFFER_BINDING, 0);
 		glReadBuffer(GL_COLOR_ATTACHMENT0);
 		glDrawBuffer(GL_BACK);
 		glBlitFramebuffer(0, 0, _width, _height, 0, _height, _width, 0, GL_COLOR_BUFFER_BIT, GL_NEAREST);
@@ -141,13 +163,16 @@ void reshade::opengl::swapchain_impl::on_present(bool default_fbo)
 	else
 	{
 		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _fbo[0]);
+		_current_bindings.set(GL_DRAW_FRAMEBUFFER_BINDING, _fbo[0]);
 		glDrawBuffer(GL_COLOR_ATTACHMENT0);
 	}
 
 	// Apply previous state from application
-	_app_state.apply(_compatibility_context);
+	_app_state.apply(_compatibility_context, _current_bindings);
+
+	submit_upload_memory();
 }
-bool reshade::opengl::swapchain_impl::on_layer_submit(uint32_t eye, GLuint source_object, bool is_rbo, bool is_array, const float bounds[4], GLuint *target_rbo)
+bool reshade::opengl::swapchain_impl::on_layer_submit(uint32_t eye, GLuint source_object, bool is_rbo, bool is_array, const float bounds[4], bool side_by_side, GLuint *target_rbo)
 {
 	assert(eye < 2 && source_object != 0);
 
@@ -164,7 +189,7 @@ bool reshade::opengl::swapchain_impl::on_layer_submit(uint32_t eye, GLuint sourc
 	}
 
 	const GLint region_width = source_region[2] - source_region[0];
-	object_desc.texture.width = region_width * 2;
+	object_desc.texture.width = side_by_side ? region_width * 2 : region_width;
 
 	if (object_desc.texture.width != _width || object_desc.texture.height != _height)
 	{
@@ -184,6 +209,8 @@ bool reshade::opengl::swapchain_impl::on_layer_submit(uint32_t eye, GLuint sourc
 	glDisable(GL_FRAMEBUFFER_SRGB);
 	glBindFramebuffer(GL_READ_FRAMEBUFFER, _fbo[1]); // Use clear FBO here, since it is reset on every use anyway
 	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _fbo[0]);
+	_current_bindings.set(GL_READ_FRAMEBUFFER_BINDING, _fbo[1]);
+	_current_bindings.set(GL_DRAW_FRAMEBUFFER_BINDING, _fbo[0]);
 
 	if (is_rbo) {
 		// TODO: This or the second blit below will fail if RBO is multisampled
@@ -198,9 +225,21 @@ bool reshade::opengl::swapchain_impl::on_layer_submit(uint32_t eye, GLuint sourc
 
 	glReadBuffer(GL_COLOR_ATTACHMENT0);
 	glDrawBuffer(GL_COLOR_ATTACHMENT0);
-	glBlitFramebuffer(source_region[0], source_region[1], source_region[2], source_region[3], eye * region_width, 0, (eye + 1) * region_width, _height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	const GLint target_x = side_by_side ? eye * region_width : 0;
+	glBlitFramebuffer(source_region[0], source_region[1], source_region[2], source_region[3], target_x, 0, target_x + region_width, _height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
 
 	*target_rbo = _rbo;
 
 	return true;
 }
+
+bool reshade::opengl::swapchain_impl::query_pipeline_status(api::pipeline pipeline, bool &success)
+{
+	pipeline_impl &state = *reinterpret_cast<pipeline_impl *>(pipeline.handle);
+
+	if (!finish_program_link(state, false))
+		return false;
+
+	success &= !state.link_failed;
+	return true;
+}
@@ -30,7 +30,9 @@ namespace reshade::opengl
 		bool on_init(HWND hwnd, unsigned int width, unsigned int height);
 		void on_reset();
 		void on_present(bool default_fbo = true);
-		bool on_layer_submit(uint32_t eye, GLuint source_object, bool is_rbo, bool is_array, const float bounds[4], GLuint *target_rbo);
+		bool on_layer_submit(uint32_t eye, GLuint source_object, bool is_rbo, bool is_array, const float bounds[4], bool side_by_side, GLuint *target_rbo);
+
+		bool query_pipeline_status(api::pipeline pipeline, bool &success) final;
 
 	private:
 		state_block _app_state;
@@ -655,7 +655,8 @@ void reshade::opengl::convert_memory_heap_to_flags(const api::resource_desc &des
 		flags |= GL_CLIENT_STORAGE_BIT;
 		break;
 	case api::memory_heap::cpu_to_gpu:
-		flags |= GL_MAP_WRITE_BIT;
+		// Allow buffers to be mapped persistently, so that they may stay mapped while in use (e.g. the upload ring buffer)
+		flags |= GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
 		break;
 	case api::memory_heap::gpu_to_cpu:
 		flags |= GL_MAP_READ_BIT;
@@ -18,6 +18,11 @@ namespace reshade::opengl
 		GLuint program;
 		GLuint vao;
 
+		// Whether the program is still being linked in the background (see 'device_impl::finish_program_link')
+		bool link_pending = false;
+		bool link_failed = false;
+		uint64_t binary_key = 0;
+
 		GLboolean sample_alpha_to_coverage;
 		GLboolean blend_enable;
 		GLboolean logic_op_enable;
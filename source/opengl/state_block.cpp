@@ -18,26 +18,45 @@ reshade::opengl::state_block::state_block()
 	memset(this, 0, sizeof(*this));
 }
 
-void reshade::opengl::state_block::capture(bool compatibility)
+static void set_active_texture(reshade::opengl::binding_cache &bindings, GLenum texture)
 {
-	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &_vao);
-	glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &_vbo);
-	glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &_ibo);
+	if (bindings.matches(GL_ACTIVE_TEXTURE, texture))
+		return;
 
-	glGetIntegerv(GL_CURRENT_PROGRAM, &_program);
-	glGetIntegerv(GL_UNIFORM_BUFFER_BINDING, &_ubo);
+	glActiveTexture(texture);
+	bindings.set(GL_ACTIVE_TEXTURE, texture);
+}
+
+void reshade::opengl::state_block::capture(bool compatibility, binding_cache &bindings)
+{
+#if !RESHADE_ADDON
+	// The hooks only keep the cache up to date with add-on support enabled, so have to query everything from the driver otherwise
+	bindings.invalidate();
+#endif
+
+	_vao = bindings.get(GL_VERTEX_ARRAY_BINDING);
+	_vbo = bindings.get(GL_ARRAY_BUFFER_BINDING);
+	_ibo = bindings.get(GL_ELEMENT_ARRAY_BUFFER_BINDING);
+
+	_program = bindings.get(GL_CURRENT_PROGRAM);
+	_ubo = bindings.get(GL_UNIFORM_BUFFER_BINDING);
 
 	// Technically should capture image bindings here as well ...
-	glGetIntegerv(GL_ACTIVE_TEXTURE, &_active_texture);
-	for (GLuint i = 0; i < 32; i++)
+	_active_texture = bindings.get(GL_ACTIVE_TEXTURE);
+	for (GLuint i = 0; i < binding_cache::num_texture_units; i++)
 	{
-		glActiveTexture(GL_TEXTURE0 + i);
-		glGetIntegerv(GL_SAMPLER_BINDING, &_samplers[i]);
-		glGetIntegerv(GL_TEXTURE_BINDING_2D, &_textures2d[i]);
+		// Only have to switch texture units and query those the cache does not know about (which usually are none after the first frame)
+		if (bindings.get_texture_unit(i, _textures2d[i], _samplers[i]))
+			continue;
+
+		set_active_texture(bindings, GL_TEXTURE0 + i);
+		_samplers[i] = bindings.get(GL_SAMPLER_BINDING);
+		_textures2d[i] = bindings.get(GL_TEXTURE_BINDING_2D);
 	}
+	set_active_texture(bindings, _active_texture);
 
-	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &_read_fbo);
-	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &_draw_fbo);
+	_read_fbo = bindings.get(GL_READ_FRAMEBUFFER_BINDING);
+	_draw_fbo = bindings.get(GL_DRAW_FRAMEBUFFER_BINDING);
 
 	glGetIntegerv(GL_VIEWPORT, _viewport);
 
@@ -94,25 +113,61 @@ void reshade::opengl::state_block::capture(bool compatibility)
 		glGetIntegerv(GL_CLIP_DEPTH_MODE, &_clip_depthmode);
 	}
 }
-void reshade::opengl::state_block::apply(bool compatibility) const
+void reshade::opengl::state_block::apply(bool compatibility, binding_cache &bindings) const
 {
-	glBindVertexArray(_vao);
-	glBindBuffer(GL_ARRAY_BUFFER, _vbo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ibo);
+	// Skip restoring bindings that were not modified since the state was captured
+	if (!bindings.matches(GL_VERTEX_ARRAY_BINDING, _vao))
+	{
+		glBindVertexArray(_vao);
+		bindings.set(GL_VERTEX_ARRAY_BINDING, _vao);
+		bindings.invalidate(GL_ELEMENT_ARRAY_BUFFER_BINDING);
+	}
+	if (!bindings.matches(GL_ARRAY_BUFFER_BINDING, _vbo))
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+		bindings.set(GL_ARRAY_BUFFER_BINDING, _vbo);
+	}
+	if (!bindings.matches(GL_ELEMENT_ARRAY_BUFFER_BINDING, _ibo))
+	{
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ibo);
+		bindings.set(GL_ELEMENT_ARRAY_BUFFER_BINDING, _ibo);
+	}
 
-	glUseProgram(_program);
-	glBindBuffer(GL_UNIFORM_BUFFER, _ubo);
+	if (!bindings.matches(GL_CURRENT_PROGRAM, _program))
+	{
+		glUseProgram(_program);
+		bindings.set(GL_CURRENT_PROGRAM, _program);
+	}
+	if (!bindings.matches(GL_UNIFORM_BUFFER_BINDING, _ubo))
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, _ubo);
+		bindings.set(GL_UNIFORM_BUFFER_BINDING, _ubo);
+	}
 
-	for (GLuint i = 0; i < 32; i++)
+	for (GLuint i = 0; i < binding_cache::num_texture_units; i++)
 	{
-		glActiveTexture(GL_TEXTURE0 + i);
+		if (GLint texture = 0, sampler = 0;
+			bindings.get_texture_unit(i, texture, sampler) && texture == _textures2d[i] && sampler == _samplers[i])
+			continue;
+
+		set_active_texture(bindings, GL_TEXTURE0 + i);
 		glBindTexture(GL_TEXTURE_2D, _textures2d[i]);
 		glBindSampler(i, _samplers[i]);
+		bindings.set_texture_unit_2d(i, _textures2d[i]);
+		bindings.set_sampler(i, _samplers[i]);
 	}
-	glActiveTexture(_active_texture);
+	set_active_texture(bindings, _active_texture);
 
-	glBindFramebuffer(GL_READ_FRAMEBUFFER, _read_fbo);
-	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _draw_fbo);
+	if (!bindings.matches(GL_READ_FRAMEBUFFER_BINDING, _read_fbo))
+	{
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, _read_fbo);
+		bindings.set(GL_READ_FRAMEBUFFER_BINDING, _read_fbo);
+	}
+	if (!bindings.matches(GL_DRAW_FRAMEBUFFER_BINDING, _draw_fbo))
+	{
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _draw_fbo);
+		bindings.set(GL_DRAW_FRAMEBUFFER_BINDING, _draw_fbo);
+	}
 
 	glViewport(_viewport[0], _viewport[1], _viewport[2], _viewport[3]);
 
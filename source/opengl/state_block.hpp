@@ -5,7 +5,7 @@
 
 #pragma once
 
-#include "opengl.hpp"
+#include "binding_cache.hpp"
 
 namespace reshade::opengl
 {
@@ -14,8 +14,14 @@ namespace reshade::opengl
 	public:
 		state_block();
 
-		void capture(bool compatibility);
-		void apply(bool compatibility) const;
+		/// <summary>
+		/// Saves the current state of the context. Bindings already known to the cache are taken from there instead of querying the driver.
+		/// </summary>
+		void capture(bool compatibility, binding_cache &bindings);
+		/// <summary>
+		/// Restores the previously saved state. Bindings the cache knows to still have the saved value are skipped, all others are updated in the cache.
+		/// </summary>
+		void apply(bool compatibility, binding_cache &bindings) const;
 
 	private:
 		GLint _vao;
@@ -23,7 +29,7 @@ namespace reshade::opengl
 		GLint _ibo;
 		GLint _ubo;
 		GLint _program;
-		GLint _textures2d[32], _samplers[32];
+		GLint _textures2d[binding_cache::num_texture_units], _samplers[binding_cache::num_texture_units];
 		GLint _active_texture;
 
 		GLint _read_fbo;
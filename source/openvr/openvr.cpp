@@ -4,8 +4,9 @@
  */
 
 #include "dll_log.hpp"
+#include "ini_file.hpp"
 #include "hook_manager.hpp"
-#include "lockfree_table.hpp"
+#include "lockfree_hash_table.hpp"
 #include "d3d11/d3d11_device.hpp"
 #include "d3d11/d3d11_device_context.hpp"
 #include "d3d11/reshade_api_swapchain.hpp"
@@ -24,6 +25,25 @@
 // There can only be a single global effect runtime in OpenVR (since its API is based on singletons)
 static std::pair<reshade::api::swapchain *, vr::ETextureType> s_vr_swapchain = { nullptr, vr::TextureType_Invalid };
 
+// Instead of combining both eyes into a single side-by-side texture, effects can be applied to every eye separately, so that each eye is submitted right away instead of having to wait on the other
+// This halves the size of the copy target and avoids delaying submission of the left eye, but effects are then rendered twice per frame
+// The second eye is presented as another view of the same frame, so all per-frame work (input, uniform updates, loading) is only done once and both eyes see the same timer and random values
+static bool is_per_eye_submission_enabled()
+{
+	static const bool enabled = reshade::global_config().get("VR", "SubmitPerEye");
+	return enabled;
+}
+
+static inline vr::VRTextureBounds_t calc_per_eye_bounds(const vr::VRTextureBounds_t *orig_bounds)
+{
+	// The eye was copied to cover the entire target texture, but keep the orientation of the original bounds
+	vr::VRTextureBounds_t bounds = { 0.0f, 0.0f, 1.0f, 1.0f };
+	if (orig_bounds != nullptr && orig_bounds->uMin > orig_bounds->uMax)
+		std::swap(bounds.uMin, bounds.uMax);
+	if (orig_bounds != nullptr && orig_bounds->vMin > orig_bounds->vMax)
+		std::swap(bounds.vMin, bounds.vMax);
+	return bounds;
+}
 static inline vr::VRTextureBounds_t calc_side_by_side_bounds(vr::EVREye eye, const vr::VRTextureBounds_t *orig_bounds)
 {
 	vr::VRTextureBounds_t bounds = (eye != vr::Eye_Right) ?
@@ -36,6 +56,47 @@ static inline vr::VRTextureBounds_t calc_side_by_side_bounds(vr::EVREye eye, con
 	return bounds;
 }
 
+extern vr::IVRClientCore *g_client_core;
+
+// Pixels hidden by the lenses of the headset are marked in the stencil buffer, so that effects skip them
+static void init_hidden_area_mask(reshade::runtime *runtime, const vr::VRTextureBounds_t *orig_bounds)
+{
+	// The runtime only has a single mask, which is not correct for both eyes when they are submitted separately
+	if (is_per_eye_submission_enabled())
+		return;
+	if (!reshade::global_config().get("VR", "MaskHiddenArea"))
+		return;
+
+	vr::EVRInitError init_e = vr::VRInitError_None;
+	const auto system = static_cast<vr::IVRSystem *>(g_client_core->GetGenericInterface(vr::IVRSystem_Version, &init_e));
+	if (system == nullptr)
+	{
+		LOG(WARN) << "Failed to get OpenVR system interface with error code " << init_e << ", so hidden area of the headset lenses is not masked.";
+		return;
+	}
+
+	const bool flip_u = orig_bounds != nullptr && orig_bounds->uMin > orig_bounds->uMax;
+	const bool flip_v = orig_bounds != nullptr && orig_bounds->vMin > orig_bounds->vMax;
+
+	std::vector<float> vertices;
+	for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right })
+	{
+		const vr::HiddenAreaMesh_t mesh = system->GetHiddenAreaMesh(eye, vr::k_eHiddenAreaMesh_Standard);
+
+		// Transform vertices from the texture space of the eye to its half of the side-by-side texture (see 'calc_side_by_side_bounds')
+		for (uint32_t i = 0; i < mesh.unTriangleCount * 3; ++i)
+		{
+			const float u = flip_u ? 1.0f - mesh.pVertexData[i].v[0] : mesh.pVertexData[i].v[0];
+			const float v = flip_v ? 1.0f - mesh.pVertexData[i].v[1] : mesh.pVertexData[i].v[1];
+			vertices.push_back(u * 0.5f + (eye != vr::Eye_Right ? 0.0f : 0.5f));
+			vertices.push_back(v);
+		}
+	}
+
+	if (!vertices.empty())
+		runtime->set_hidden_area_mesh(vertices.data(), static_cast<uint32_t>(vertices.size() / 6));
+}
+
 static vr::EVRCompositorError on_submit_d3d11(vr::EVREye eye, ID3D11Texture2D *texture, const vr::VRTextureBounds_t *bounds, vr::EVRSubmitFlags flags,
 	std::function<vr::EVRCompositorError(vr::EVREye eye, void *texture, const vr::VRTextureBounds_t *bounds, vr::EVRSubmitFlags flags)> submit)
 {
@@ -49,6 +110,7 @@ static vr::EVRCompositorError on_submit_d3d11(vr::EVREye eye, ID3D11Texture2D *t
 	if (s_vr_swapchain.first == nullptr)
 	{
 		s_vr_swapchain = { new reshade::d3d11::swapchain_impl(device_proxy, device_proxy->_immediate_context, nullptr), vr::TextureType_DirectX };
+		init_hidden_area_mask(static_cast<reshade::d3d11::swapchain_impl *>(s_vr_swapchain.first), bounds);
 	}
 
 	// It is not valid to switch the texture type once submitted for the first time
@@ -56,13 +118,15 @@ static vr::EVRCompositorError on_submit_d3d11(vr::EVREye eye, ID3D11Texture2D *t
 		return vr::VRCompositorError_InvalidTexture;
 
 	ID3D11Texture2D *target_texture = nullptr;
+	const bool per_eye = is_per_eye_submission_enabled();
 
 	const auto runtime = static_cast<reshade::d3d11::swapchain_impl *>(s_vr_swapchain.first);
-	// Copy current eye texture to single side-by-side texture for use by the effect runtime
+	// Copy current eye texture to single side-by-side texture (or a texture for just this eye) for use by the effect runtime
 	if (!runtime->on_layer_submit(
 		static_cast<UINT>(eye),
 		texture,
 		reinterpret_cast<const float *>(bounds),
+		!per_eye,
 		&target_texture))
 	{
 	normal_submit:
@@ -71,7 +135,7 @@ static vr::EVRCompositorError on_submit_d3d11(vr::EVREye eye, ID3D11Texture2D *t
 	}
 
 	// Skip submission of the first eye and instead submit both left and right eye in one step after application submitted both
-	if (eye != vr::Eye_Right)
+	if (eye != vr::Eye_Right && !per_eye)
 	{
 		return vr::VRCompositorError_None;
 	}
@@ -81,8 +145,18 @@ static vr::EVRCompositorError on_submit_d3d11(vr::EVREye eye, ID3D11Texture2D *t
 		reshade::invoke_addon_event<reshade::addon_event::present>(device_proxy->_immediate_context, runtime);
 #endif
 
+		// Both eyes are views of the same frame, so only advance the frame for the first one and just render effects again for the second
+		if (per_eye && eye == vr::Eye_Right)
+			runtime->present_next_view_of_frame();
+
 		runtime->on_present();
 
+		if (per_eye)
+		{
+			const vr::VRTextureBounds_t target_bounds = calc_per_eye_bounds(bounds);
+			return submit(eye, target_texture, &target_bounds, flags);
+		}
+
 		// The left and right eye were copied side-by-side to a single texture in 'on_layer_submit', so set bounds accordingly
 		const vr::VRTextureBounds_t left_bounds = calc_side_by_side_bounds(vr::Eye_Left, bounds);
 		submit(vr::Eye_Left, target_texture, &left_bounds, flags);
@@ -100,19 +174,22 @@ static vr::EVRCompositorError on_submit_d3d12(vr::EVREye eye, const vr::D3D12Tex
 	if (s_vr_swapchain.first == nullptr)
 	{
 		s_vr_swapchain = { new reshade::d3d12::swapchain_impl(command_queue_proxy->_device, command_queue_proxy.get(), nullptr), vr::TextureType_DirectX12 };
+		init_hidden_area_mask(static_cast<reshade::d3d12::swapchain_impl *>(s_vr_swapchain.first), bounds);
 	}
 
 	if (s_vr_swapchain.second != vr::TextureType_DirectX12)
 		return vr::VRCompositorError_InvalidTexture;
 
 	vr::D3D12TextureData_t target_texture = *texture;
+	const bool per_eye = is_per_eye_submission_enabled();
 
 	const auto runtime = static_cast<reshade::d3d12::swapchain_impl *>(s_vr_swapchain.first);
-	// Copy current eye texture to single side-by-side texture for use by the effect runtime
+	// Copy current eye texture to single side-by-side texture (or a texture for just this eye) for use by the effect runtime
 	if (!runtime->on_layer_submit(
 		static_cast<UINT>(eye),
 		texture->m_pResource, // Resource should be in D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE state at this point
 		reinterpret_cast<const float *>(bounds),
+		!per_eye,
 		&target_texture.m_pResource))
 	{
 	normal_submit:
@@ -121,7 +198,7 @@ static vr::EVRCompositorError on_submit_d3d12(vr::EVREye eye, const vr::D3D12Tex
 	}
 
 	// Skip submission of the first eye and instead submit both left and right eye in one step after application submitted both
-	if (eye != vr::Eye_Right)
+	if (eye != vr::Eye_Right && !per_eye)
 	{
 		return vr::VRCompositorError_None;
 	}
@@ -131,10 +208,20 @@ static vr::EVRCompositorError on_submit_d3d12(vr::EVREye eye, const vr::D3D12Tex
 		reshade::invoke_addon_event<reshade::addon_event::present>(command_queue_proxy.get(), runtime);
 #endif
 
+		// Both eyes are views of the same frame, so only advance the frame for the first one and just render effects again for the second
+		if (per_eye && eye == vr::Eye_Right)
+			runtime->present_next_view_of_frame();
+
 		runtime->on_present();
 
 		command_queue_proxy->flush_immediate_command_list();
 
+		if (per_eye)
+		{
+			const vr::VRTextureBounds_t target_bounds = calc_per_eye_bounds(bounds);
+			return submit(eye, &target_texture, &target_bounds, flags);
+		}
+
 		const vr::VRTextureBounds_t left_bounds = calc_side_by_side_bounds(vr::Eye_Left, bounds);
 		submit(vr::Eye_Left, &target_texture, &left_bounds, flags);
 		const vr::VRTextureBounds_t right_bounds = calc_side_by_side_bounds(vr::Eye_Right, bounds);
@@ -150,21 +237,24 @@ static vr::EVRCompositorError on_submit_opengl(vr::EVREye eye, GLuint object, co
 		const HGLRC render_context = wglGetCurrentContext();
 
 		s_vr_swapchain = { new reshade::opengl::swapchain_impl(device_context, render_context), vr::TextureType_OpenGL };
+		init_hidden_area_mask(static_cast<reshade::opengl::swapchain_impl *>(s_vr_swapchain.first), bounds);
 	}
 
 	if (s_vr_swapchain.second != vr::TextureType_OpenGL)
 		return vr::VRCompositorError_InvalidTexture;
 
 	GLuint target_rbo = 0;
+	const bool per_eye = is_per_eye_submission_enabled();
 
 	const auto runtime = static_cast<reshade::opengl::swapchain_impl *>(s_vr_swapchain.first);
-	// Copy current eye texture to single side-by-side texture for use by the effect runtime
+	// Copy current eye texture to single side-by-side texture (or a texture for just this eye) for use by the effect runtime
 	if (!runtime->on_layer_submit(
 		static_cast<uint32_t>(eye),
 		object,
 		(flags & vr::Submit_GlRenderBuffer) != 0,
 		(flags & vr::Submit_GlArrayTexture) != 0,
 		reinterpret_cast<const float *>(bounds),
+		!per_eye,
 		&target_rbo))
 	{
 		// Failed to initialize effect runtime or copy the eye texture, so submit normally without applying effects
@@ -172,7 +262,7 @@ static vr::EVRCompositorError on_submit_opengl(vr::EVREye eye, GLuint object, co
 	}
 
 	// Skip submission of the first eye and instead submit both left and right eye in one step after application submitted both
-	if (eye != vr::Eye_Right)
+	if (eye != vr::Eye_Right && !per_eye)
 	{
 		return vr::VRCompositorError_None;
 	}
@@ -182,12 +272,22 @@ static vr::EVRCompositorError on_submit_opengl(vr::EVREye eye, GLuint object, co
 		reshade::invoke_addon_event<reshade::addon_event::present>(runtime, runtime);
 #endif
 
+		// Both eyes are views of the same frame, so only advance the frame for the first one and just render effects again for the second
+		if (per_eye && eye == vr::Eye_Right)
+			runtime->present_next_view_of_frame();
+
 		// Skip copy, data was already copied in 'on_layer_submit' above
 		runtime->on_present(false);
 
 		// Target object created in 'on_layer_submit' is a RBO, not a texture or array texture
 		flags = static_cast<vr::EVRSubmitFlags>((flags & ~vr::Submit_GlArrayTexture) | vr::Submit_GlRenderBuffer);
 
+		if (per_eye)
+		{
+			const vr::VRTextureBounds_t target_bounds = calc_per_eye_bounds(bounds);
+			return submit(eye, reinterpret_cast<void *>(static_cast<uintptr_t>(target_rbo)), &target_bounds, flags);
+		}
+
 		const vr::VRTextureBounds_t left_bounds = calc_side_by_side_bounds(vr::Eye_Left, bounds);
 		submit(vr::Eye_Left, reinterpret_cast<void *>(static_cast<uintptr_t>(target_rbo)), &left_bounds, flags);
 		const vr::VRTextureBounds_t right_bounds = calc_side_by_side_bounds(vr::Eye_Right, bounds);
@@ -197,7 +297,7 @@ static vr::EVRCompositorError on_submit_opengl(vr::EVREye eye, GLuint object, co
 static vr::EVRCompositorError on_submit_vulkan(vr::EVREye eye, const vr::VRVulkanTextureData_t *texture, const vr::VRTextureBounds_t *bounds, vr::EVRSubmitFlags flags,
 	std::function<vr::EVRCompositorError(vr::EVREye eye, void *texture, const vr::VRTextureBounds_t *bounds, vr::EVRSubmitFlags flags)> submit)
 {
-	extern lockfree_table<void *, reshade::vulkan::device_impl *, 16> g_vulkan_devices;
+	extern lockfree_hash_table<void *, reshade::vulkan::device_impl *, 6> g_vulkan_devices;
 	reshade::vulkan::device_impl *const device = g_vulkan_devices.at(dispatch_key_from_handle(texture->m_pDevice));
 	reshade::vulkan::command_queue_impl *queue = nullptr;
 	if (device == nullptr)
@@ -214,15 +314,17 @@ static vr::EVRCompositorError on_submit_vulkan(vr::EVREye eye, const vr::VRVulka
 	{
 		// OpenVR requires the passed in queue to be a graphics queue, so can safely use it
 		s_vr_swapchain = { new reshade::vulkan::swapchain_impl(device, queue), vr::TextureType_Vulkan };
+		init_hidden_area_mask(static_cast<reshade::vulkan::swapchain_impl *>(s_vr_swapchain.first), bounds);
 	}
 
 	if (s_vr_swapchain.second != vr::TextureType_Vulkan)
 		return vr::VRCompositorError_InvalidTexture;
 
 	VkImage target_image = VK_NULL_HANDLE;
+	const bool per_eye = is_per_eye_submission_enabled();
 
 	const auto runtime = static_cast<reshade::vulkan::swapchain_impl *>(s_vr_swapchain.first);
-	// Copy current eye texture to single side-by-side texture for use by the effect runtime
+	// Copy current eye texture to single side-by-side texture (or a texture for just this eye) for use by the effect runtime
 	if (!runtime->on_layer_submit(
 		static_cast<uint32_t>(eye),
 		(VkImage)texture->m_nImage, // Image should be in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL layout at this point
@@ -231,6 +333,7 @@ static vr::EVRCompositorError on_submit_vulkan(vr::EVREye eye, const vr::VRVulka
 		static_cast<VkSampleCountFlags>(texture->m_nSampleCount),
 		(flags & vr::Submit_VulkanTextureWithArrayData) != 0 ? static_cast<const vr::VRVulkanTextureArrayData_t *>(texture)->m_unArrayIndex : 0,
 		reinterpret_cast<const float *>(bounds),
+		!per_eye,
 		&target_image))
 	{
 	normal_submit:
@@ -239,7 +342,7 @@ static vr::EVRCompositorError on_submit_vulkan(vr::EVREye eye, const vr::VRVulka
 	}
 
 	// Skip submission of the first eye and instead submit both left and right eye in one step after application submitted both
-	if (eye != vr::Eye_Right)
+	if (eye != vr::Eye_Right && !per_eye)
 	{
 		return vr::VRCompositorError_None;
 	}
@@ -249,6 +352,10 @@ static vr::EVRCompositorError on_submit_vulkan(vr::EVREye eye, const vr::VRVulka
 		reshade::invoke_addon_event<reshade::addon_event::present>(queue, runtime);
 #endif
 
+		// Both eyes are views of the same frame, so only advance the frame for the first one and just render effects again for the second
+		if (per_eye && eye == vr::Eye_Right)
+			runtime->present_next_view_of_frame();
+
 		std::vector<VkSemaphore> wait_semaphores;
 		runtime->on_present(texture->m_pQueue, 0, wait_semaphores);
 
@@ -262,6 +369,12 @@ static vr::EVRCompositorError on_submit_vulkan(vr::EVREye eye, const vr::VRVulka
 		// Target texture created in 'on_layer_submit' is not an array texture
 		flags = static_cast<vr::EVRSubmitFlags>(flags & ~vr::Submit_VulkanTextureWithArrayData);
 
+		if (per_eye)
+		{
+			const vr::VRTextureBounds_t target_bounds = calc_per_eye_bounds(bounds);
+			return submit(eye, &target_texture, &target_bounds, flags);
+		}
+
 		const vr::VRTextureBounds_t left_bounds = calc_side_by_side_bounds(vr::Eye_Left, bounds);
 		submit(vr::Eye_Left, &target_texture, &left_bounds, flags);
 		const vr::VRTextureBounds_t right_bounds = calc_side_by_side_bounds(vr::Eye_Right, bounds);
@@ -0,0 +1,496 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "png_encoder.hpp"
+#include "thread_pool.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+	#define PNG_ENCODER_SSE2 1
+	#include <emmintrin.h>
+#else
+	#define PNG_ENCODER_SSE2 0
+#endif
+
+namespace
+{
+	constexpr size_t bytes_per_pixel = 4;
+	// Each strip covers about this much image data, which is large enough for compression to not suffer much from starting over at the beginning of every strip
+	constexpr size_t strip_size = 256 * 1024;
+
+	constexpr uint32_t window_size = 32768;
+	constexpr uint32_t min_match_length = 3;
+	constexpr uint32_t max_match_length = 258;
+	// Positions within longer matches are not added to the hash chains, which speeds up long runs of identical bytes (e.g. in flat-colored areas) considerably
+	constexpr uint32_t max_insert_length = 32;
+	constexpr uint32_t max_chain_length = 8;
+	constexpr uint32_t hash_bits = 15;
+
+	constexpr uint16_t length_base[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	constexpr uint8_t length_extra_bits[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	constexpr uint16_t distance_base[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	constexpr uint8_t distance_extra_bits[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	// Fixed Huffman codes (see RFC 1951, section 3.2.6), already bit-reversed, since they are packed starting with their most significant bit, as opposed to all other values
+	struct huffman_tables
+	{
+		huffman_tables()
+		{
+			const auto reverse = [](uint32_t code, uint32_t num_bits) {
+				uint32_t reversed = 0;
+				for (uint32_t i = 0; i < num_bits; ++i, code >>= 1)
+					reversed = (reversed << 1) | (code & 1);
+				return static_cast<uint16_t>(reversed);
+			};
+
+			for (uint32_t symbol = 0; symbol < 288; ++symbol)
+			{
+				if (symbol < 144)
+					literal_lengths[symbol] = 8, literal_codes[symbol] = reverse(0x30 + symbol, 8);
+				else if (symbol < 256)
+					literal_lengths[symbol] = 9, literal_codes[symbol] = reverse(0x190 + symbol - 144, 9);
+				else if (symbol < 280)
+					literal_lengths[symbol] = 7, literal_codes[symbol] = reverse(symbol - 256, 7);
+				else
+					literal_lengths[symbol] = 8, literal_codes[symbol] = reverse(0xC0 + symbol - 280, 8);
+			}
+
+			for (uint32_t code = 0; code < 30; ++code)
+				distance_codes[code] = reverse(code, 5);
+
+			for (uint32_t length = min_match_length, code = 0; length <= max_match_length; ++length)
+			{
+				while (code < 28 && length_base[code + 1] <= length)
+					++code;
+				length_code_of[length - min_match_length] = static_cast<uint8_t>(code);
+			}
+
+			// Distances above 256 share a code for every 128 consecutive values, so only need a table entry for each of those
+			for (uint32_t distance = 1, code = 0; distance <= window_size; ++distance)
+			{
+				while (code < 29 && distance_base[code + 1] <= distance)
+					++code;
+				if (distance <= 256)
+					distance_code_of[distance - 1] = static_cast<uint8_t>(code);
+				else
+					distance_code_of[256 + ((distance - 1) >> 7)] = static_cast<uint8_t>(code);
+			}
+		}
+
+		uint16_t literal_codes[288];
+		uint8_t literal_lengths[288];
+		uint16_t distance_codes[30];
+		uint8_t length_code_of[max_match_length - min_match_length + 1];
+		uint8_t distance_code_of[256 + 256];
+	};
+
+	const huffman_tables &fixed_huffman_tables()
+	{
+		static const huffman_tables s_tables;
+		return s_tables;
+	}
+
+	struct bit_writer
+	{
+		explicit bit_writer(std::vector<uint8_t> &out) : out(out), tables(fixed_huffman_tables()) {}
+
+		void put(uint32_t value, uint32_t num_bits)
+		{
+			bits |= static_cast<uint64_t>(value) << count;
+			count += num_bits;
+			if (count >= 32)
+			{
+				out.push_back(bits & 0xFF);
+				out.push_back((bits >> 8) & 0xFF);
+				out.push_back((bits >> 16) & 0xFF);
+				out.push_back((bits >> 24) & 0xFF);
+				bits >>= 32;
+				count -= 32;
+			}
+		}
+
+		// Writes out all remaining bits, padding the last byte with zeros
+		void align()
+		{
+			for (; count > 0; bits >>= 8, count = count > 8 ? count - 8 : 0)
+				out.push_back(bits & 0xFF);
+			bits = 0;
+		}
+
+		void put_literal(uint32_t symbol)
+		{
+			put(tables.literal_codes[symbol], tables.literal_lengths[symbol]);
+		}
+		void put_match(uint32_t length, uint32_t distance)
+		{
+			const uint32_t length_code = tables.length_code_of[length - min_match_length];
+			put_literal(257 + length_code);
+			put(length - length_base[length_code], length_extra_bits[length_code]);
+
+			const uint32_t distance_code = tables.distance_code_of[distance <= 256 ? distance - 1 : 256 + ((distance - 1) >> 7)];
+			put(tables.distance_codes[distance_code], 5);
+			put(distance - distance_base[distance_code], distance_extra_bits[distance_code]);
+		}
+
+		std::vector<uint8_t> &out;
+		const huffman_tables &tables;
+		uint64_t bits = 0;
+		uint32_t count = 0;
+	};
+
+	const uint32_t *crc32_table()
+	{
+		static const struct table
+		{
+			table()
+			{
+				for (uint32_t i = 0; i < 256; ++i)
+				{
+					uint32_t c = i;
+					for (int k = 0; k < 8; ++k)
+						c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+					values[i] = c;
+				}
+			}
+
+			uint32_t values[256];
+		} s_table;
+
+		return s_table.values;
+	}
+
+	uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t size)
+	{
+		const uint32_t *const table = crc32_table();
+		for (size_t i = 0; i < size; ++i)
+			crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		return crc;
+	}
+
+	uint32_t adler32_update(uint32_t adler, const uint8_t *data, size_t size)
+	{
+		uint32_t a = adler & 0xFFFF, b = adler >> 16;
+		while (size != 0)
+		{
+			// Largest number of bytes that can be summed up before the 32-bit sums could overflow
+			const size_t block_size = std::min<size_t>(size, 5552);
+			for (size_t i = 0; i < block_size; ++i)
+				b += (a += data[i]);
+			a %= 65521;
+			b %= 65521;
+			data += block_size;
+			size -= block_size;
+		}
+		return (b << 16) | a;
+	}
+	// Computes the checksum of two concatenated blocks of data from their individual checksums (same as 'adler32_combine' in zlib)
+	uint32_t adler32_combine(uint32_t adler1, uint32_t adler2, size_t size2)
+	{
+		constexpr uint32_t base = 65521;
+
+		const uint32_t rem = static_cast<uint32_t>(size2 % base);
+		uint32_t sum1 = adler1 & 0xFFFF;
+		uint32_t sum2 = static_cast<uint32_t>((static_cast<uint64_t>(rem) * sum1) % base);
+		sum1 += (adler2 & 0xFFFF) + base - 1;
+		sum2 += (adler1 >> 16) + (adler2 >> 16) + base - rem;
+		if (sum1 >= base) sum1 -= base;
+		if (sum1 >= base) sum1 -= base;
+		if (sum2 >= (base << 1)) sum2 -= (base << 1);
+		if (sum2 >= base) sum2 -= base;
+		return sum1 | (sum2 << 16);
+	}
+
+	void put_u32(std::vector<uint8_t> &out, uint32_t value)
+	{
+		out.push_back((value >> 24) & 0xFF);
+		out.push_back((value >> 16) & 0xFF);
+		out.push_back((value >> 8) & 0xFF);
+		out.push_back(value & 0xFF);
+	}
+	void put_chunk(std::vector<uint8_t> &out, const char type[4], const uint8_t *data, size_t size)
+	{
+		put_u32(out, static_cast<uint32_t>(size));
+		out.insert(out.end(), type, type + 4);
+		out.insert(out.end(), data, data + size);
+		put_u32(out, crc32_update(crc32_update(0xFFFFFFFF, reinterpret_cast<const uint8_t *>(type), 4), data, size) ^ 0xFFFFFFFF);
+	}
+
+	uint8_t paeth_predictor(uint8_t a, uint8_t b, uint8_t c)
+	{
+		const int p = a + b - c;
+		const int pa = std::abs(p - a);
+		const int pb = std::abs(p - b);
+		const int pc = std::abs(p - c);
+		return pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+	}
+
+	// Computes the output of all five filter types for a row in 'candidates' and writes the one that is expected to compress best to 'out', preceded by the filter type
+	// The expectation is based on the sum of absolute values of the filtered bytes interpreted as signed, which is the heuristic suggested by the PNG specification
+	void filter_row(const uint8_t *row, const uint8_t *prev_row, size_t row_size, uint8_t *candidates, uint8_t *out)
+	{
+		uint8_t *const filtered[5] = { candidates, candidates + row_size, candidates + row_size * 2, candidates + row_size * 3, candidates + row_size * 4 };
+		uint64_t costs[5] = {};
+
+		size_t x = 0;
+#if PNG_ENCODER_SSE2
+		const __m128i zero = _mm_setzero_si128();
+		__m128i cost_sums[5] = { zero, zero, zero, zero, zero };
+
+		for (; x + 16 <= row_size; x += 16)
+		{
+			const __m128i cur = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + x));
+			const __m128i up = _mm_loadu_si128(reinterpret_cast<const __m128i *>(prev_row + x));
+			// The first pixel of a row has no left neighbor, which is treated as zero
+			const __m128i left = x == 0 ? _mm_slli_si128(cur, bytes_per_pixel) : _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + x - bytes_per_pixel));
+			const __m128i up_left = x == 0 ? _mm_slli_si128(up, bytes_per_pixel) : _mm_loadu_si128(reinterpret_cast<const __m128i *>(prev_row + x - bytes_per_pixel));
+
+			// Average filter rounds down, whereas '_mm_avg_epu8' rounds up
+			const __m128i average = _mm_sub_epi8(_mm_avg_epu8(left, up), _mm_and_si128(_mm_xor_si128(left, up), _mm_set1_epi8(1)));
+
+			// Paeth predictor needs more than 8 bits for the intermediate values
+			__m128i paeth[2];
+			for (int half = 0; half < 2; ++half)
+			{
+				const __m128i a = half == 0 ? _mm_unpacklo_epi8(left, zero) : _mm_unpackhi_epi8(left, zero);
+				const __m128i b = half == 0 ? _mm_unpacklo_epi8(up, zero) : _mm_unpackhi_epi8(up, zero);
+				const __m128i c = half == 0 ? _mm_unpacklo_epi8(up_left, zero) : _mm_unpackhi_epi8(up_left, zero);
+
+				__m128i pa = _mm_sub_epi16(b, c);
+				__m128i pb = _mm_sub_epi16(a, c);
+				__m128i pc = _mm_add_epi16(pa, pb);
+				pa = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+				pb = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+				pc = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+
+				const __m128i not_a = _mm_or_si128(_mm_cmpgt_epi16(pa, pb), _mm_cmpgt_epi16(pa, pc));
+				const __m128i use_b = _mm_andnot_si128(_mm_cmpgt_epi16(pb, pc), not_a);
+				const __m128i use_c = _mm_andnot_si128(use_b, not_a);
+
+				paeth[half] = _mm_or_si128(_mm_andnot_si128(not_a, a), _mm_or_si128(_mm_and_si128(use_b, b), _mm_and_si128(use_c, c)));
+			}
+
+			const __m128i results[5] = {
+				cur,
+				_mm_sub_epi8(cur, left),
+				_mm_sub_epi8(cur, up),
+				_mm_sub_epi8(cur, average),
+				_mm_sub_epi8(cur, _mm_packus_epi16(paeth[0], paeth[1]))
+			};
+
+			for (int i = 0; i < 5; ++i)
+			{
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(filtered[i] + x), results[i]);
+				// Absolute value of signed bytes is the smaller of the value and its negation when interpreted as unsigned
+				cost_sums[i] = _mm_add_epi64(cost_sums[i], _mm_sad_epu8(_mm_min_epu8(results[i], _mm_sub_epi8(zero, results[i])), zero));
+			}
+		}
+
+		for (int i = 0; i < 5; ++i)
+		{
+			uint64_t sums[2];
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(sums), cost_sums[i]);
+			costs[i] = sums[0] + sums[1];
+		}
+#endif
+
+		for (; x < row_size; ++x)
+		{
+			const uint8_t a = x >= bytes_per_pixel ? row[x - bytes_per_pixel] : 0;
+			const uint8_t b = prev_row[x];
+			const uint8_t c = x >= bytes_per_pixel ? prev_row[x - bytes_per_pixel] : 0;
+
+			filtered[0][x] = row[x];
+			filtered[1][x] = row[x] - a;
+			filtered[2][x] = row[x] - b;
+			filtered[3][x] = row[x] - static_cast<uint8_t>((a + b) / 2);
+			filtered[4][x] = row[x] - paeth_predictor(a, b, c);
+
+			for (int i = 0; i < 5; ++i)
+				costs[i] += std::min<uint8_t>(filtered[i][x], static_cast<uint8_t>(0 - filtered[i][x]));
+		}
+
+		const size_t best_filter = std::min_element(costs, costs + 5) - costs;
+
+		out[0] = static_cast<uint8_t>(best_filter);
+		std::memcpy(out + 1, filtered[best_filter], row_size);
+	}
+
+	// Compresses data with LZ77 and the fixed Huffman codes into a single non-final deflate block, followed by an empty stored block to align the end to a byte boundary (same as a sync flush in zlib)
+	// This makes it possible to simply concatenate the output of multiple calls into one deflate stream
+	void compress(const uint8_t *data, size_t size, std::vector<uint8_t> &out)
+	{
+		bit_writer writer(out);
+		writer.put(0, 1); // BFINAL
+		writer.put(1, 2); // BTYPE (fixed Huffman codes)
+
+		std::vector<int32_t> head(1 << hash_bits, -1);
+		std::vector<int32_t> prev(size);
+
+		const auto hash = [data](size_t i) {
+			return ((data[i] << 16 | data[i + 1] << 8 | data[i + 2]) * 2654435761u) >> (32 - hash_bits);
+		};
+		const auto insert = [&head, &prev, &hash](size_t i) {
+			const uint32_t h = hash(i);
+			prev[i] = head[h];
+			head[h] = static_cast<int32_t>(i);
+		};
+
+		for (size_t i = 0; i < size;)
+		{
+			uint32_t best_length = 0;
+			uint32_t best_distance = 0;
+
+			if (i + min_match_length <= size)
+			{
+				const uint32_t max_length = static_cast<uint32_t>(std::min<size_t>(max_match_length, size - i));
+
+				uint32_t chain_length = max_chain_length;
+				for (int32_t candidate = head[hash(i)]; candidate >= 0 && i - candidate <= window_size && chain_length-- != 0; candidate = prev[candidate])
+				{
+					const uint8_t *const a = data + candidate;
+					const uint8_t *const b = data + i;
+					if (a[best_length] != b[best_length])
+						continue;
+
+					uint32_t length = 0;
+					while (length < max_length && a[length] == b[length])
+						++length;
+
+					if (length > best_length)
+					{
+						best_length = length;
+						best_distance = static_cast<uint32_t>(i - candidate);
+						if (length == max_length)
+							break;
+					}
+				}
+
+				insert(i);
+			}
+
+			if (best_length >= min_match_length)
+			{
+				writer.put_match(best_length, best_distance);
+
+				const size_t end = i + best_length;
+				if (best_length <= max_insert_length)
+					for (++i; i < end && i + min_match_length <= size; ++i)
+						insert(i);
+				i = end;
+			}
+			else
+			{
+				writer.put_literal(data[i]);
+				++i;
+			}
+		}
+
+		writer.put_literal(256); // End of block
+
+		writer.put(0, 1); // BFINAL
+		writer.put(0, 2); // BTYPE (no compression)
+		writer.align();
+		out.push_back(0x00);
+		out.push_back(0x00);
+		out.push_back(0xFF);
+		out.push_back(0xFF);
+	}
+
+	struct strip
+	{
+		std::vector<uint8_t> chunk_data;
+		size_t filtered_size = 0;
+		uint32_t adler = 0;
+	};
+}
+
+bool reshade::encode_png(const uint8_t *data, uint32_t width, uint32_t height, std::vector<uint8_t> &out, thread_pool *pool)
+{
+	if (data == nullptr || width == 0 || height == 0)
+		return false;
+
+	const size_t row_size = static_cast<size_t>(width) * bytes_per_pixel;
+	const size_t rows_per_strip = std::max<size_t>(strip_size / row_size, 1);
+	const size_t num_strips = (height + rows_per_strip - 1) / rows_per_strip;
+
+	std::vector<strip> strips(num_strips);
+
+	const auto encode_strip = [&](size_t strip_index) {
+		const size_t first_row = strip_index * rows_per_strip;
+		const size_t num_rows = std::min<size_t>(rows_per_strip, height - first_row);
+
+		// The row before the first row of the image is treated as zero
+		std::vector<uint8_t> zero_row(first_row == 0 ? row_size : 0);
+		std::vector<uint8_t> candidates(row_size * 5);
+		std::vector<uint8_t> filtered(num_rows * (row_size + 1));
+
+		for (size_t y = 0; y < num_rows; ++y)
+		{
+			const uint8_t *const row = data + (first_row + y) * row_size;
+			filter_row(row, first_row + y == 0 ? zero_row.data() : row - row_size, row_size, candidates.data(), filtered.data() + y * (row_size + 1));
+		}
+
+		strip &s = strips[strip_index];
+		s.filtered_size = filtered.size();
+		s.adler = adler32_update(1, filtered.data(), filtered.size());
+
+		s.chunk_data.reserve(filtered.size() / 2);
+		if (strip_index == 0)
+		{
+			// Header of the zlib stream (deflate compression with 32K window, no preset dictionary)
+			s.chunk_data.push_back(0x78);
+			s.chunk_data.push_back(0x01);
+		}
+
+		compress(filtered.data(), filtered.size(), s.chunk_data);
+	};
+
+	if (pool != nullptr)
+		pool->parallel_for(num_strips, encode_strip);
+	else
+		for (size_t i = 0; i < num_strips; ++i)
+			encode_strip(i);
+
+	out.clear();
+
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	out.insert(out.end(), signature, signature + 8);
+
+	uint8_t header[13] = {};
+	header[0] = (width >> 24) & 0xFF;
+	header[1] = (width >> 16) & 0xFF;
+	header[2] = (width >> 8) & 0xFF;
+	header[3] = width & 0xFF;
+	header[4] = (height >> 24) & 0xFF;
+	header[5] = (height >> 16) & 0xFF;
+	header[6] = (height >> 8) & 0xFF;
+	header[7] = height & 0xFF;
+	header[8] = 8; // Bit depth
+	header[9] = 6; // Color type (RGBA)
+	put_chunk(out, "IHDR", header, sizeof(header));
+
+	uint32_t adler = 1;
+	for (const strip &s : strips)
+	{
+		put_chunk(out, "IDAT", s.chunk_data.data(), s.chunk_data.size());
+		adler = adler32_combine(adler, s.adler, s.filtered_size);
+	}
+
+	// Terminate the deflate stream with an empty final block, followed by the checksum of the zlib stream
+	std::vector<uint8_t> trailer;
+	bit_writer writer(trailer);
+	writer.put(1, 1); // BFINAL
+	writer.put(1, 2); // BTYPE (fixed Huffman codes)
+	writer.put_literal(256);
+	writer.align();
+	put_u32(trailer, adler);
+	put_chunk(out, "IDAT", trailer.data(), trailer.size());
+
+	put_chunk(out, "IEND", nullptr, 0);
+
+	return true;
+}
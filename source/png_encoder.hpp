@@ -0,0 +1,26 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace reshade
+{
+	class thread_pool;
+
+	/// <summary>
+	/// Encodes a 32bpp RGBA image as a PNG file.
+	/// The image is split into horizontal strips that are filtered and compressed independently of each other in parallel on the specified <paramref name="pool"/>, each of which ends up in its own IDAT chunk.
+	/// </summary>
+	/// <param name="data">The image data, with rows tightly packed.</param>
+	/// <param name="width">The width of the image.</param>
+	/// <param name="height">The height of the image.</param>
+	/// <param name="out">The buffer the PNG file is written to.</param>
+	/// <param name="pool">The thread pool to spread the work across, or <see langword="nullptr"/> to do everything on the calling thread.</param>
+	/// <returns><see langword="true"/> if the image was encoded successfully, <see langword="false"/> otherwise.</returns>
+	bool encode_png(const uint8_t *data, uint32_t width, uint32_t height, std::vector<uint8_t> &out, thread_pool *pool = nullptr);
+}
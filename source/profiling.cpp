@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#if RESHADE_PROFILING
+
+#include "profiling.hpp"
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <Windows.h>
+
+namespace
+{
+	// Single-producer single-consumer ring of samples owned by one thread
+	struct thread_buffer
+	{
+		static constexpr uint32_t capacity = 4096;
+
+		reshade::profiling::sample samples[capacity];
+		std::atomic<uint32_t> write_pos = 0;
+		std::atomic<uint32_t> read_pos = 0;
+		uint32_t thread_id = 0;
+		std::atomic<bool> in_use = false;
+	};
+
+	// Buffers are never freed, but are handed to new threads once the thread that owned them exited
+	std::mutex s_buffers_mutex;
+	std::vector<std::unique_ptr<thread_buffer>> s_buffers;
+
+	thread_buffer *acquire_buffer()
+	{
+		const std::unique_lock<std::mutex> lock(s_buffers_mutex);
+
+		thread_buffer *buffer = nullptr;
+		for (const std::unique_ptr<thread_buffer> &existing : s_buffers)
+		{
+			if (!existing->in_use.load(std::memory_order_relaxed))
+			{
+				buffer = existing.get();
+				break;
+			}
+		}
+
+		if (buffer == nullptr)
+			buffer = s_buffers.emplace_back(std::make_unique<thread_buffer>()).get();
+
+		buffer->thread_id = GetCurrentThreadId();
+		buffer->in_use.store(true, std::memory_order_relaxed);
+		return buffer;
+	}
+
+	// Intrusive list of all call counters, which only ever grows
+	std::atomic<reshade::profiling::call_counter *> s_call_counters = nullptr;
+
+	struct thread_buffer_owner
+	{
+		thread_buffer *const buffer = acquire_buffer();
+
+		~thread_buffer_owner()
+		{
+			// Samples still in the buffer are collected together with those of the next thread using it
+			buffer->in_use.store(false, std::memory_order_release);
+		}
+	};
+}
+
+thread_local uint32_t reshade::profiling::scope::s_depth = 0;
+
+reshade::profiling::call_counter::call_counter(const char *name) : name(name)
+{
+	next = s_call_counters.load(std::memory_order_relaxed);
+	while (!s_call_counters.compare_exchange_weak(next, this, std::memory_order_release, std::memory_order_relaxed))
+		continue;
+}
+
+uint64_t reshade::profiling::now_ns()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+}
+
+void reshade::profiling::record(const char *name, uint64_t beg_ns, uint64_t end_ns, uint32_t depth)
+{
+	static thread_local thread_buffer_owner s_owner;
+	thread_buffer &buffer = *s_owner.buffer;
+
+	const uint32_t write_pos = buffer.write_pos.load(std::memory_order_relaxed);
+	if (write_pos - buffer.read_pos.load(std::memory_order_acquire) >= thread_buffer::capacity)
+		return;
+
+	buffer.samples[write_pos % thread_buffer::capacity] = { name, beg_ns, end_ns, buffer.thread_id, depth };
+	buffer.write_pos.store(write_pos + 1, std::memory_order_release);
+}
+
+void reshade::profiling::collect(std::vector<sample> &samples)
+{
+	// Only blocks while a new thread records its first sample
+	const std::unique_lock<std::mutex> lock(s_buffers_mutex);
+
+	for (const std::unique_ptr<thread_buffer> &buffer : s_buffers)
+	{
+		const uint32_t write_pos = buffer->write_pos.load(std::memory_order_acquire);
+		uint32_t read_pos = buffer->read_pos.load(std::memory_order_relaxed);
+
+		for (; read_pos != write_pos; ++read_pos)
+			samples.push_back(buffer->samples[read_pos % thread_buffer::capacity]);
+
+		buffer->read_pos.store(read_pos, std::memory_order_release);
+	}
+}
+
+void reshade::profiling::collect(std::vector<call_statistics> &calls)
+{
+	for (call_counter *counter = s_call_counters.load(std::memory_order_acquire); counter != nullptr; counter = counter->next)
+	{
+		// Calls that finish between the two exchanges are attributed to the next collection, which is fine for averages
+		const uint64_t count = counter->count.exchange(0, std::memory_order_relaxed);
+		if (count == 0)
+			continue;
+
+		calls.push_back({ counter->name, count, counter->duration_ns.exchange(0, std::memory_order_relaxed) });
+	}
+}
+
+#endif
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#if RESHADE_PROFILING
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace reshade::profiling
+{
+	/// <summary>
+	/// A single measurement of a scope recorded with <see cref="RESHADE_PROFILE_SCOPE"/>.
+	/// </summary>
+	struct sample
+	{
+		const char *name;
+		// Times in nanoseconds, on the same clock as the runtime uses for the frame timeline ('std::chrono::high_resolution_clock')
+		uint64_t beg_ns;
+		uint64_t end_ns;
+		uint32_t thread_id;
+		// Number of profiled scopes this one is nested in on the same thread (zero for the outermost scope)
+		uint32_t depth;
+	};
+
+	uint64_t now_ns();
+
+	/// <summary>
+	/// Appends a sample to the buffer of the calling thread. This never blocks (samples are dropped if the buffer is full, because nobody is collecting them).
+	/// </summary>
+	void record(const char *name, uint64_t beg_ns, uint64_t end_ns, uint32_t depth);
+
+	/// <summary>
+	/// Moves all samples recorded by any thread since the last call into the specified list.
+	/// Samples are consumed by whoever collects them first, so this should only be called from a single thread at a time.
+	/// </summary>
+	void collect(std::vector<sample> &samples);
+
+	/// <summary>
+	/// Number and total duration of the calls through a hook recorded with <see cref="RESHADE_PROFILE_CALL"/> since they were last collected.
+	/// </summary>
+	struct call_statistics
+	{
+		const char *name;
+		uint64_t count;
+		uint64_t duration_ns;
+	};
+
+	/// <summary>
+	/// Accumulates calls through a single hook. Unlike recording a sample per call, this is cheap enough for functions that are called thousands of times per frame (draw calls, state changes, ...).
+	/// Counters are static, so they register themselves in a global list the first time the hook is called and are never removed again.
+	/// </summary>
+	struct call_counter
+	{
+		explicit call_counter(const char *name);
+
+		const char *const name;
+		std::atomic<uint64_t> count = 0;
+		std::atomic<uint64_t> duration_ns = 0;
+		call_counter *next = nullptr;
+	};
+
+	/// <summary>
+	/// Moves the statistics of all counters that were called since the last call into the specified list and resets them.
+	/// </summary>
+	void collect(std::vector<call_statistics> &calls);
+
+	class call_scope
+	{
+	public:
+		explicit call_scope(call_counter &counter) : _counter(counter), _beg_ns(now_ns()) {}
+		~call_scope()
+		{
+			_counter.count.fetch_add(1, std::memory_order_relaxed);
+			_counter.duration_ns.fetch_add(now_ns() - _beg_ns, std::memory_order_relaxed);
+		}
+
+		call_scope(const call_scope &) = delete;
+		call_scope &operator=(const call_scope &) = delete;
+
+	private:
+		call_counter &_counter;
+		const uint64_t _beg_ns;
+	};
+
+	class scope
+	{
+	public:
+		explicit scope(const char *name) : _name(name), _depth(s_depth++), _beg_ns(now_ns()) {}
+		~scope() { record(_name, _beg_ns, now_ns(), _depth); s_depth--; }
+
+		scope(const scope &) = delete;
+		scope &operator=(const scope &) = delete;
+
+	private:
+		static thread_local uint32_t s_depth;
+
+		const char *const _name;
+		const uint32_t _depth;
+		const uint64_t _beg_ns;
+	};
+}
+
+#define RESHADE_PROFILE_SCOPE_CONCAT2(a, b) a##b
+#define RESHADE_PROFILE_SCOPE_CONCAT(a, b) RESHADE_PROFILE_SCOPE_CONCAT2(a, b)
+#define RESHADE_PROFILE_SCOPE(name) const reshade::profiling::scope RESHADE_PROFILE_SCOPE_CONCAT(_profile_scope_, __LINE__)(name)
+#define RESHADE_PROFILE_CALL(name) \
+	static reshade::profiling::call_counter RESHADE_PROFILE_SCOPE_CONCAT(_profile_counter_, __LINE__)(name); \
+	const reshade::profiling::call_scope RESHADE_PROFILE_SCOPE_CONCAT(_profile_call_, __LINE__)(RESHADE_PROFILE_SCOPE_CONCAT(_profile_counter_, __LINE__))
+
+#else
+
+// Profiling is compiled out unless 'RESHADE_PROFILING' is defined (build with "msbuild /p:ReShadeProfiling=true"), so these expand to nothing
+#define RESHADE_PROFILE_SCOPE(name) ((void)0)
+#define RESHADE_PROFILE_CALL(name) ((void)0)
+
+#endif
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include "reshade_api_resource.hpp"
+#include <mutex>
+#include <atomic>
+#include <cstring>
+
+namespace reshade
+{
+	/// <summary>
+	/// A fixed size set-associative cache of resource descriptions, which can be queried without taking a lock.
+	/// Every entry is guarded by a sequence counter, so that readers can detect (and treat as a miss) an entry that was modified while reading it. Modifications are serialized by a mutex.
+	/// </summary>
+	class resource_desc_cache
+	{
+		static constexpr size_t NUM_WAYS = 4;
+		static constexpr size_t NUM_SETS_LOG2 = 10;
+		static constexpr size_t NUM_SETS = size_t(1) << NUM_SETS_LOG2;
+
+	public:
+		/// <summary>
+		/// Gets the current generation, which is incremented every time an entry is erased.
+		/// Pass this to <see cref="insert"/> when the description was retrieved from the resource after checking that it is still alive, so that the insertion is dropped if it was destroyed in the meantime.
+		/// </summary>
+		uint64_t generation() const
+		{
+			return _generation.load(std::memory_order_acquire);
+		}
+
+		/// <summary>
+		/// Looks up the description of the resource with the specified <paramref name="handle"/>.
+		/// </summary>
+		/// <returns><see langword="true"/> if the resource is in the cache, <see langword="false"/> otherwise.</returns>
+		bool lookup(uint64_t handle, api::resource_desc &desc) const
+		{
+			const entry *const set = _entries + index_of(handle) * NUM_WAYS;
+
+			for (size_t way = 0; way < NUM_WAYS; ++way)
+			{
+				const entry &e = set[way];
+
+				const uint32_t sequence = e.sequence.load(std::memory_order_acquire);
+				if ((sequence & 1) != 0 || e.handle.load(std::memory_order_relaxed) != handle)
+					continue; // Entry is empty, belongs to a different resource or is currently being written
+
+				std::memcpy(&desc, &e.desc, sizeof(desc));
+
+				// Only use the copied description if the entry was not modified while copying it
+				std::atomic_thread_fence(std::memory_order_acquire);
+				return e.sequence.load(std::memory_order_relaxed) == sequence;
+			}
+
+			return false;
+		}
+
+		/// <summary>
+		/// Adds or updates the description of the resource with the specified <paramref name="handle"/>, evicting another entry if the set it maps to is full.
+		/// </summary>
+		/// <param name="generation">The generation that was current when the resource was last known to be alive (see <see cref="generation"/>).</param>
+		void insert(uint64_t handle, const api::resource_desc &desc, uint64_t generation)
+		{
+			const std::lock_guard<std::mutex> lock(_mutex);
+
+			if (generation != _generation.load(std::memory_order_relaxed))
+				return;
+
+			const size_t set_index = index_of(handle);
+			entry *const set = _entries + set_index * NUM_WAYS;
+
+			entry *target = nullptr;
+			for (size_t way = 0; way < NUM_WAYS && target == nullptr; ++way)
+				if (set[way].handle.load(std::memory_order_relaxed) == handle)
+					target = &set[way];
+			for (size_t way = 0; way < NUM_WAYS && target == nullptr; ++way)
+				if (set[way].handle.load(std::memory_order_relaxed) == 0)
+					target = &set[way];
+			if (target == nullptr)
+				target = &set[_next_victim[set_index]++ % NUM_WAYS];
+
+			write(*target, handle, desc);
+		}
+		void insert(uint64_t handle, const api::resource_desc &desc)
+		{
+			insert(handle, desc, generation());
+		}
+
+		/// <summary>
+		/// Removes the resource with the specified <paramref name="handle"/> from the cache.
+		/// This has to be called before the resource is destroyed, since the handle may be reused by a new resource afterwards.
+		/// </summary>
+		void erase(uint64_t handle)
+		{
+			const std::lock_guard<std::mutex> lock(_mutex);
+
+			_generation.fetch_add(1, std::memory_order_release);
+
+			entry *const set = _entries + index_of(handle) * NUM_WAYS;
+
+			for (size_t way = 0; way < NUM_WAYS; ++way)
+				if (set[way].handle.load(std::memory_order_relaxed) == handle)
+					write(set[way], 0, {});
+		}
+
+	private:
+		struct entry
+		{
+			std::atomic<uint32_t> sequence = 0;
+			std::atomic<uint64_t> handle = 0;
+			api::resource_desc desc;
+		};
+
+		static size_t index_of(uint64_t handle)
+		{
+			// Fibonacci hashing, which distributes pointers that only differ in their low bits well
+			return static_cast<size_t>((handle * 0x9E3779B97F4A7C15ull) >> (64 - NUM_SETS_LOG2));
+		}
+
+		static void write(entry &e, uint64_t handle, const api::resource_desc &desc)
+		{
+			const uint32_t sequence = e.sequence.load(std::memory_order_relaxed);
+
+			// Mark entry as being written, so that readers ignore it until the write finished
+			e.sequence.store(sequence + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+
+			e.handle.store(handle, std::memory_order_relaxed);
+			std::memcpy(&e.desc, &desc, sizeof(desc));
+
+			e.sequence.store(sequence + 2, std::memory_order_release);
+		}
+
+		std::mutex _mutex;
+		std::atomic<uint64_t> _generation = 0;
+		entry _entries[NUM_SETS * NUM_WAYS];
+		uint8_t _next_victim[NUM_SETS] = {};
+	};
+}
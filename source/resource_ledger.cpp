@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "resource_ledger.hpp"
+#include <mutex>
+#include <algorithm>
+#include <unordered_map>
+#include <Windows.h>
+
+using namespace reshade::api;
+using namespace reshade::resource_ledger;
+
+extern HMODULE g_module_handle;
+
+struct resource_record
+{
+	size_t owner_index;
+	size_t category;
+	uint64_t size;
+};
+struct device_ledger
+{
+	std::unordered_map<uint64_t, resource_record> resources;
+	// Only ever grows, which is fine, since there are just a few owners per device
+	std::vector<owner_usage> owners;
+};
+
+// Resources are only created and destroyed through the API every now and then (and not every frame), so a single lock is good enough
+static std::mutex s_ledger_mutex;
+static std::unordered_map<const device *, device_ledger> s_ledgers;
+static thread_local bool s_in_overlay_scope = false;
+
+static uint64_t calc_resource_size(const resource_desc &desc)
+{
+	if (desc.type == resource_type::buffer)
+		return desc.buffer.size;
+
+	const uint32_t depth = (desc.type == resource_type::texture_3d) ? desc.texture.depth_or_layers : 1;
+	const uint32_t layers = (desc.type == resource_type::texture_3d) ? 1 : desc.texture.depth_or_layers;
+	// Zero levels means a full mipmap chain
+	const uint32_t levels = (desc.texture.levels != 0) ? desc.texture.levels : 32;
+
+	uint64_t size = 0;
+	for (uint32_t level = 0; level < levels; ++level)
+	{
+		const uint32_t width = std::max(1u, desc.texture.width >> level);
+		const uint32_t height = std::max(1u, desc.texture.height >> level);
+
+		size += static_cast<uint64_t>(format_slice_pitch(desc.texture.format, format_row_pitch(desc.texture.format, width), height)) * std::max(1u, depth >> level);
+
+		if (width == 1 && height == 1 && (depth >> level) <= 1)
+			break;
+	}
+
+	return size * std::max(1u, layers) * std::max<uint32_t>(1, desc.texture.samples);
+}
+static size_t calc_resource_category(const resource_desc &desc)
+{
+	if (desc.heap == memory_heap::cpu_to_gpu || desc.heap == memory_heap::gpu_to_cpu || desc.heap == memory_heap::cpu_only)
+		return static_cast<size_t>(resource_memory_category::staging);
+	if (desc.type == resource_type::buffer)
+		return static_cast<size_t>(resource_memory_category::buffer);
+	if ((desc.usage & (resource_usage::render_target | resource_usage::depth_stencil)) != resource_usage::undefined)
+		return static_cast<size_t>(resource_memory_category::render_target);
+	return static_cast<size_t>(resource_memory_category::texture);
+}
+
+void reshade::resource_ledger::register_resource(const device *device, const resource_desc &desc, resource resource, void *return_address)
+{
+	// Attribute the resource to the add-on whose code called 'create_resource', everything else in the ReShade module belongs to either the effect runtime or the overlay
+	HMODULE module = nullptr;
+	GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, static_cast<LPCWSTR>(return_address), &module);
+	if (module == g_module_handle)
+		module = nullptr;
+	const resource_memory_owner owner = (module != nullptr) ? resource_memory_owner::addons : s_in_overlay_scope ? resource_memory_owner::overlay : resource_memory_owner::effect_runtime;
+
+	const resource_record record = { 0, calc_resource_category(desc), calc_resource_size(desc) };
+
+	const std::lock_guard<std::mutex> lock(s_ledger_mutex);
+
+	device_ledger &ledger = s_ledgers[device];
+
+	const auto owner_it = std::find_if(ledger.owners.begin(), ledger.owners.end(),
+		[owner, module](const owner_usage &usage) { return usage.owner == owner && usage.module == module; });
+	owner_usage &usage = (owner_it != ledger.owners.end()) ? *owner_it : ledger.owners.emplace_back(owner_usage { owner, module });
+
+	usage.bytes[record.category] += record.size;
+
+	ledger.resources[resource.handle] = { static_cast<size_t>(&usage - ledger.owners.data()), record.category, record.size };
+}
+void reshade::resource_ledger::unregister_resource(const device *device, resource resource)
+{
+	const std::lock_guard<std::mutex> lock(s_ledger_mutex);
+
+	const auto ledger_it = s_ledgers.find(device);
+	if (ledger_it == s_ledgers.end())
+		return;
+
+	device_ledger &ledger = ledger_it->second;
+
+	const auto resource_it = ledger.resources.find(resource.handle);
+	if (resource_it == ledger.resources.end())
+		return;
+
+	const resource_record &record = resource_it->second;
+	ledger.owners[record.owner_index].bytes[record.category] -= record.size;
+	ledger.resources.erase(resource_it);
+}
+
+uint64_t reshade::resource_ledger::get_usage(const device *device, resource_memory_owner owner, resource_memory_category category)
+{
+	const std::lock_guard<std::mutex> lock(s_ledger_mutex);
+
+	const auto ledger_it = s_ledgers.find(device);
+	if (ledger_it == s_ledgers.end())
+		return 0;
+
+	uint64_t bytes = 0;
+	for (const owner_usage &usage : ledger_it->second.owners)
+		if (usage.owner == owner)
+			bytes += usage.bytes[static_cast<size_t>(category)];
+	return bytes;
+}
+void reshade::resource_ledger::get_usage(const device *device, std::vector<owner_usage> &usage)
+{
+	const std::lock_guard<std::mutex> lock(s_ledger_mutex);
+
+	usage.clear();
+	if (const auto ledger_it = s_ledgers.find(device); ledger_it != s_ledgers.end())
+		usage = ledger_it->second.owners;
+}
+
+reshade::resource_ledger::overlay_scope::overlay_scope() : _prev_state(s_in_overlay_scope)
+{
+	s_in_overlay_scope = true;
+}
+reshade::resource_ledger::overlay_scope::~overlay_scope()
+{
+	s_in_overlay_scope = _prev_state;
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include "reshade_api.hpp"
+#include <vector>
+#include <intrin.h>
+
+namespace reshade::resource_ledger
+{
+	constexpr size_t num_categories = static_cast<size_t>(api::resource_memory_category::staging) + 1;
+
+	/// <summary>
+	/// Memory occupied by the resources a single owner created on a device.
+	/// </summary>
+	struct owner_usage
+	{
+		api::resource_memory_owner owner;
+		/// <summary>
+		/// Module handle of the add-on that created the resources (or <c>nullptr</c> if they were created by ReShade itself).
+		/// </summary>
+		void *module;
+		uint64_t bytes[num_categories];
+	};
+
+	/// <summary>
+	/// Records a resource that was created through <see cref="api::device::create_resource"/>.
+	/// </summary>
+	/// <param name="return_address">Address in the code that called <see cref="api::device::create_resource"/>, which is used to determine the module the resource belongs to.</param>
+	void register_resource(const api::device *device, const api::resource_desc &desc, api::resource resource, void *return_address);
+	/// <summary>
+	/// Removes a resource that is about to be destroyed from the records (does nothing if it was not created through <see cref="api::device::create_resource"/>).
+	/// </summary>
+	void unregister_resource(const api::device *device, api::resource resource);
+
+	/// <summary>
+	/// Gets the memory usage of all resources of the specified owner and category on a device.
+	/// </summary>
+	uint64_t get_usage(const api::device *device, api::resource_memory_owner owner, api::resource_memory_category category);
+	/// <summary>
+	/// Gets the memory usage on a device broken down by owner, with a separate entry for every add-on.
+	/// </summary>
+	void get_usage(const api::device *device, std::vector<owner_usage> &usage);
+
+	/// <summary>
+	/// Attributes resources that ReShade creates on the calling thread to the overlay instead of the effect runtime while this is in scope.
+	/// </summary>
+	class overlay_scope
+	{
+	public:
+		overlay_scope();
+		~overlay_scope();
+
+		overlay_scope(const overlay_scope &) = delete;
+		overlay_scope &operator=(const overlay_scope &) = delete;
+
+	private:
+		bool _prev_state;
+	};
+
+	/// <summary>
+	/// Registers the resource written to <paramref name="out"/> when going out of scope, if creating it succeeded.
+	/// This is placed at the top of the 'create_resource' implementations, so that all their return paths are covered.
+	/// </summary>
+	class create_scope
+	{
+	public:
+		create_scope(const api::device *device, const api::resource_desc &desc, const api::resource *out, void *return_address) :
+			_device(device), _desc(desc), _out(out), _return_address(return_address) {}
+		~create_scope()
+		{
+			if (_out->handle != 0)
+				register_resource(_device, _desc, *_out, _return_address);
+		}
+
+		create_scope(const create_scope &) = delete;
+		create_scope &operator=(const create_scope &) = delete;
+
+	private:
+		const api::device *const _device;
+		const api::resource_desc &_desc;
+		const api::resource *const _out;
+		void *const _return_address;
+	};
+}
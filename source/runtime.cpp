@@ -9,6 +9,16 @@
 #include "addon_manager.hpp"
 #include "runtime.hpp"
 #include "runtime_objects.hpp"
+#include "dll_resources.hpp"
+#include "cache_archive.hpp"
+#include "effect_compile.hpp"
+#include "file_watcher.hpp"
+#include "directory_index.hpp"
+#include "png_encoder.hpp"
+#include "bc_encoder.hpp"
+#include "exr_encoder.hpp"
+#include "frame_sink.hpp"
+#include "telemetry.hpp"
 #include "effect_parser.hpp"
 #include "effect_codegen.hpp"
 #include "effect_preprocessor.hpp"
@@ -16,6 +26,7 @@
 #include "input_freepie.hpp"
 #include "com_ptr.hpp"
 #include <set>
+#include <deque>
 #include <thread>
 #include <algorithm>
 #include <stb_image.h>
@@ -23,6 +34,7 @@
 #include <stb_image_write.h>
 #include <stb_image_resize.h>
 #include <d3dcompiler.h>
+#include <dxcapi.h>
 
 extern volatile long g_network_traffic;
 
@@ -49,31 +61,609 @@ bool resolve_preset_path(std::filesystem::path &path)
 	return !resolve_path(path) || reshade::ini_file::load_cache(path).has({}, "Techniques");
 }
 
-static bool find_file(const std::vector<std::filesystem::path> &search_paths, std::filesystem::path &path)
+static std::vector<std::filesystem::path> resolve_search_paths(const std::vector<std::filesystem::path> &search_paths)
+{
+	std::vector<std::filesystem::path> resolved_paths;
+	for (std::filesystem::path search_path : search_paths)
+		if (resolve_path(search_path))
+			resolved_paths.push_back(std::move(search_path));
+	return resolved_paths;
+}
+static bool find_file(reshade::directory_index &index, const std::vector<std::filesystem::path> &resolved_search_paths, std::filesystem::path &path)
 {
-	std::error_code ec;
 	// Do not have to perform a search if the path is already absolute
 	if (path.is_absolute())
-		return std::filesystem::exists(path, ec);
-	for (std::filesystem::path search_path : search_paths)
+		return index.exists(path);
+	for (std::filesystem::path search_path : resolved_search_paths)
 		// Append relative file path to absolute search path
-		if (search_path /= path; resolve_path(search_path))
+		if (search_path = (search_path / path).lexically_normal(); index.exists(search_path))
 			return path = std::move(search_path), true;
 	return false;
 }
-static std::vector<std::filesystem::path> find_files(const std::vector<std::filesystem::path> &search_paths, std::initializer_list<std::filesystem::path> extensions)
+static std::vector<std::filesystem::path> find_files(reshade::directory_index &index, const std::vector<std::filesystem::path> &resolved_search_paths, std::initializer_list<std::filesystem::path> extensions)
 {
-	std::error_code ec;
 	std::vector<std::filesystem::path> files;
-	for (std::filesystem::path search_path : search_paths)
-		if (resolve_path(search_path))
-			for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(search_path, std::filesystem::directory_options::skip_permission_denied, ec))
-				if (!entry.is_directory(ec) &&
-					std::find(extensions.begin(), extensions.end(), entry.path().extension()) != extensions.end())
-					files.emplace_back(entry); // Construct path from directory entry in-place
+	for (const std::filesystem::path &search_path : resolved_search_paths)
+		for (std::filesystem::path &file : index.list_files(search_path))
+			if (std::find(extensions.begin(), extensions.end(), file.extension()) != extensions.end())
+				files.push_back(std::move(file));
 	return files;
 }
 
+static bool is_block_compressed_format(reshade::api::format value)
+{
+	using reshade::api::format;
+
+	return (value >= format::bc1_typeless && value <= format::bc5_snorm) || (value >= format::bc6h_typeless && value <= format::bc7_unorm_srgb);
+}
+static reshade::api::format parse_dds_block_compressed_header(const uint8_t *data, size_t size, uint32_t &width, uint32_t &height, uint32_t &levels, size_t &data_offset)
+{
+	using reshade::api::format;
+
+	// See https://docs.microsoft.com/windows/win32/direct3ddds/dds-header
+	if (size < 128 || std::memcmp(data, "DDS ", 4) != 0)
+		return format::unknown;
+
+	const auto read_uint = [data](size_t offset) { uint32_t value; std::memcpy(&value, data + offset, sizeof(value)); return value; };
+	const auto make_fourcc = [](const char fourcc[5]) { return static_cast<uint32_t>(fourcc[0]) | (static_cast<uint32_t>(fourcc[1]) << 8) | (static_cast<uint32_t>(fourcc[2]) << 16) | (static_cast<uint32_t>(fourcc[3]) << 24); };
+
+	height = read_uint(4 + 8);
+	width = read_uint(4 + 12);
+	levels = std::max(1u, read_uint(4 + 24));
+	data_offset = 128;
+
+	// Only plain 2D textures are supported, not cube maps or volume textures
+	if (read_uint(4 + 108) != 0 || (read_uint(4 + 76) & 0x4 /* DDPF_FOURCC */) == 0)
+		return format::unknown;
+
+	const uint32_t fourcc = read_uint(4 + 80);
+	if (fourcc == make_fourcc("DXT1"))
+		return format::bc1_unorm;
+	if (fourcc == make_fourcc("DXT2") || fourcc == make_fourcc("DXT3"))
+		return format::bc2_unorm;
+	if (fourcc == make_fourcc("DXT4") || fourcc == make_fourcc("DXT5"))
+		return format::bc3_unorm;
+	if (fourcc == make_fourcc("ATI1") || fourcc == make_fourcc("BC4U"))
+		return format::bc4_unorm;
+	if (fourcc == make_fourcc("BC4S"))
+		return format::bc4_snorm;
+	if (fourcc == make_fourcc("ATI2") || fourcc == make_fourcc("BC5U"))
+		return format::bc5_unorm;
+	if (fourcc == make_fourcc("BC5S"))
+		return format::bc5_snorm;
+	if (fourcc != make_fourcc("DX10"))
+		return format::unknown;
+
+	// See https://docs.microsoft.com/windows/win32/direct3ddds/dds-header-dxt10
+	if (size < 148 || read_uint(128 + 4) != 3 /* D3D10_RESOURCE_DIMENSION_TEXTURE2D */ || (read_uint(128 + 8) & 0x4 /* D3D10_RESOURCE_MISC_TEXTURECUBE */) != 0 || read_uint(128 + 12) > 1)
+		return format::unknown;
+
+	data_offset = 148;
+
+	// Formats share their values with 'DXGI_FORMAT'
+	if (const auto dxgi_format = static_cast<format>(read_uint(128));
+		is_block_compressed_format(dxgi_format))
+		return dxgi_format;
+	return format::unknown;
+}
+static bool is_compatible_block_compressed_format(reshadefx::texture_format texture_format, reshade::api::format block_format)
+{
+	using reshade::api::format;
+
+	// The block compressed format is only used if it has the same channels as the format the effect declared for the texture
+	switch (format_to_typeless(block_format))
+	{
+	case format::bc1_typeless:
+	case format::bc2_typeless:
+	case format::bc3_typeless:
+	case format::bc7_typeless:
+		return texture_format == reshadefx::texture_format::rgba8;
+	case format::bc4_typeless:
+		return texture_format == reshadefx::texture_format::r8;
+	case format::bc5_typeless:
+		return texture_format == reshadefx::texture_format::rg8;
+	case format::bc6h_typeless:
+		return texture_format == reshadefx::texture_format::rgba16f;
+	default:
+		return false;
+	}
+}
+// Textures with the 'compress' annotation are encoded to the block compressed format with the same channels as the format the effect declared for them
+static reshade::api::format find_compressed_texture_format(const reshadefx::texture_info &info)
+{
+	using reshade::api::format;
+
+	// Block compressed textures need to have a size that is a multiple of the block size
+	if ((info.width % 4) != 0 || (info.height % 4) != 0)
+		return format::unknown;
+
+	switch (info.format)
+	{
+	case reshadefx::texture_format::r8:
+		return format::bc4_unorm;
+	case reshadefx::texture_format::rg8:
+		return format::bc5_unorm;
+	case reshadefx::texture_format::rgba8:
+		return format::bc7_unorm;
+	default:
+		return format::unknown;
+	}
+}
+static std::filesystem::path compressed_texture_cache_path(const std::filesystem::path &cache_path, const std::filesystem::path &source_path, const reshadefx::texture_info &info)
+{
+	// Include the modification time of the source image in the name, so that changes to it are picked up (the stale file is left behind until the cache is cleared)
+	std::error_code ec;
+	const auto modified_at = std::filesystem::last_write_time(source_path, ec);
+
+	const size_t hash = std::hash<std::string>()(
+		source_path.u8string() + '|' + std::to_string(modified_at.time_since_epoch().count()) + '|' + std::to_string(info.width) + 'x' + std::to_string(info.height) + '|' + std::to_string(static_cast<int>(info.format)) + '|' + std::to_string(info.levels));
+
+	return cache_path / std::filesystem::u8path("reshade-texture-" + source_path.stem().u8string() + '-' + std::to_string(hash) + ".dds");
+}
+
+static bool is_same_or_parent_path(const std::filesystem::path &parent, const std::filesystem::path &path)
+{
+	const std::filesystem::path normal_parent = parent.lexically_normal();
+	const std::filesystem::path normal_path = path.lexically_normal();
+
+	// Compare case-insensitive, since file names on Windows are too
+	auto it = normal_path.begin();
+	for (const std::filesystem::path &element : normal_parent)
+		if (it == normal_path.end() || _wcsicmp((it++)->c_str(), element.c_str()) != 0)
+			return false;
+	return true;
+}
+
+// Extend the range of float constant registers to include those the specified D3D9 shader reads, using the constant table the HLSL compiler embeds into the bytecode as a comment
+// Falls back to the full range if the shader has no constant table (e.g. because it was stripped)
+static void merge_d3d9_constant_registers(const std::vector<char> &cso, uint32_t full_range_end, uint32_t range[2])
+{
+	const auto merge = [range](uint32_t begin, uint32_t end) {
+		if (begin >= end)
+			return;
+		if (range[0] >= range[1])
+			range[0] = begin, range[1] = end;
+		else
+			range[0] = std::min(range[0], begin), range[1] = std::max(range[1], end);
+	};
+
+	const uint32_t *const tokens = reinterpret_cast<const uint32_t *>(cso.data());
+	const size_t num_tokens = cso.size() / sizeof(uint32_t);
+
+	// Comments follow right after the version token
+	for (size_t i = 1; i < num_tokens && (tokens[i] & 0xFFFF) == 0xFFFE;)
+	{
+		const size_t comment_size = (tokens[i] >> 16) & 0x7FFF;
+		if (comment_size >= 8 && i + 1 + comment_size <= num_tokens && tokens[i + 1] == 0x42415443 /* 'CTAB' */)
+		{
+			// See 'D3DXSHADER_CONSTANTTABLE' and 'D3DXSHADER_CONSTANTINFO' structures
+			const uint8_t *const table = reinterpret_cast<const uint8_t *>(tokens + i + 2);
+			const size_t table_size = (comment_size - 1) * sizeof(uint32_t);
+			const uint32_t num_constants = reinterpret_cast<const uint32_t *>(table)[3];
+			const uint32_t constant_info_offset = reinterpret_cast<const uint32_t *>(table)[4];
+
+			if (constant_info_offset + num_constants * 20ull > table_size)
+				break;
+
+			for (uint32_t k = 0; k < num_constants; ++k)
+			{
+				const uint16_t *const constant_info = reinterpret_cast<const uint16_t *>(table + constant_info_offset + k * 20);
+				const uint16_t register_set = constant_info[2], register_index = constant_info[3], register_count = constant_info[4];
+
+				// Only interested in float registers, but skip the one '__TEXEL_SIZE__' is bound to, since that is set separately for every pass
+				if (register_set == 2 /* D3DXRS_FLOAT4 */ && register_index < 255)
+					merge(register_index, std::min<uint32_t>(register_index + register_count, std::min(full_range_end, 255u)));
+			}
+			return;
+		}
+
+		i += 1 + comment_size;
+	}
+
+	merge(0, std::min(full_range_end, 255u));
+}
+
+// Serialization of parsed effects to the effect cache, so that a warm start can skip preprocessing and parsing them
+// The same functions are used for reading and writing, so that the two cannot get out of sync, but have to be updated whenever a field is added to the effect module
+static constexpr uint32_t EFFECT_MODULE_CACHE_VERSION = 1;
+
+template <typename S>
+static void serialize(S &s, reshadefx::type &type)
+{
+	s(type.base);
+	s(type.rows);
+	s(type.cols);
+	s(type.qualifiers);
+	s(type.array_length);
+	s(type.definition);
+}
+template <typename S>
+static void serialize(S &s, reshadefx::constant &value)
+{
+	for (uint32_t &element : value.as_uint)
+		s(element);
+	s(value.string_data);
+	s(value.array_data);
+}
+template <typename S>
+static void serialize(S &s, reshadefx::annotation &annotation)
+{
+	s(annotation.type);
+	s(annotation.name);
+	s(annotation.value);
+}
+template <typename S>
+static void serialize(S &s, reshadefx::texture_info &info)
+{
+	s(info.id);
+	s(info.binding);
+	s(info.semantic);
+	s(info.unique_name);
+	s(info.annotations);
+	s(info.width);
+	s(info.height);
+	s(info.levels);
+	s(info.format);
+	s(info.render_target);
+	s(info.storage_access);
+}
+template <typename S>
+static void serialize(S &s, reshadefx::sampler_info &info)
+{
+	s(info.id);
+	s(info.binding);
+	s(info.texture_binding);
+	s(info.unique_name);
+	s(info.texture_name);
+	s(info.annotations);
+	s(info.filter);
+	s(info.address_u);
+	s(info.address_v);
+	s(info.address_w);
+	s(info.min_lod);
+	s(info.max_lod);
+	s(info.lod_bias);
+	s(info.srgb);
+}
+template <typename S>
+static void serialize(S &s, reshadefx::storage_info &info)
+{
+	s(info.id);
+	s(info.binding);
+	s(info.unique_name);
+	s(info.texture_name);
+}
+template <typename S>
+static void serialize(S &s, reshadefx::uniform_info &info)
+{
+	s(info.name);
+	s(info.type);
+	s(info.size);
+	s(info.offset);
+	s(info.annotations);
+	s(info.has_initializer_value);
+	s(info.initializer_value);
+}
+template <typename S>
+static void serialize(S &s, reshadefx::entry_point &info)
+{
+	s(info.name);
+	s(info.type);
+	s(info.spirv);
+}
+template <typename S>
+static void serialize(S &s, reshadefx::pass_info &info)
+{
+	s(info.name);
+	for (std::string &render_target_name : info.render_target_names)
+		s(render_target_name);
+	s(info.vs_entry_point);
+	s(info.ps_entry_point);
+	s(info.cs_entry_point);
+	s(info.clear_render_targets);
+	s(info.srgb_write_enable);
+	s(info.blend_enable);
+	s(info.stencil_enable);
+	s(info.color_write_mask);
+	s(info.stencil_read_mask);
+	s(info.stencil_write_mask);
+	s(info.shading_rate);
+	s(info.blend_op);
+	s(info.blend_op_alpha);
+	s(info.src_blend);
+	s(info.dest_blend);
+	s(info.src_blend_alpha);
+	s(info.dest_blend_alpha);
+	s(info.stencil_comparison_func);
+	s(info.stencil_reference_value);
+	s(info.stencil_op_pass);
+	s(info.stencil_op_fail);
+	s(info.stencil_op_depth_fail);
+	s(info.num_vertices);
+	s(info.topology);
+	s(info.viewport_width);
+	s(info.viewport_height);
+	s(info.viewport_dispatch_z);
+	s(info.scissor_rect_uniform);
+	s(info.samplers);
+	s(info.storages);
+}
+template <typename S>
+static void serialize(S &s, reshadefx::technique_info &info)
+{
+	s(info.name);
+	s(info.passes);
+	s(info.annotations);
+}
+template <typename S>
+static void serialize(S &s, reshadefx::module &module)
+{
+	s(module.hlsl);
+	s(module.spirv);
+	s(module.entry_points);
+	s(module.textures);
+	s(module.samplers);
+	s(module.storages);
+	s(module.uniforms);
+	s(module.spec_constants);
+	s(module.techniques);
+	s(module.total_uniform_size);
+	s(module.num_texture_bindings);
+	s(module.num_sampler_bindings);
+	s(module.num_storage_bindings);
+}
+
+struct effect_cache_writer
+{
+	template <typename T>
+	void operator()(T &value)
+	{
+		if constexpr (std::is_arithmetic_v<T> || std::is_enum_v<T>)
+			data.append(reinterpret_cast<const char *>(&value), sizeof(value));
+		else
+			serialize(*this, value);
+	}
+	template <typename T1, typename T2>
+	void operator()(std::pair<T1, T2> &value)
+	{
+		(*this)(value.first);
+		(*this)(value.second);
+	}
+	template <typename T>
+	void operator()(std::vector<T> &values)
+	{
+		uint32_t size = static_cast<uint32_t>(values.size());
+		(*this)(size);
+		if constexpr (std::is_arithmetic_v<T>)
+			data.append(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(T));
+		else
+			for (T &value : values)
+				(*this)(value);
+	}
+	void operator()(std::string &value)
+	{
+		uint32_t size = static_cast<uint32_t>(value.size());
+		(*this)(size);
+		data.append(value);
+	}
+	void operator()(std::filesystem::path &value)
+	{
+		std::string path = value.u8string();
+		(*this)(path);
+	}
+
+	std::string data;
+};
+struct effect_cache_reader
+{
+	explicit effect_cache_reader(const std::string &data) : data(data) {}
+
+	template <typename T>
+	void operator()(T &value)
+	{
+		if constexpr (std::is_arithmetic_v<T> || std::is_enum_v<T>)
+			read(&value, sizeof(value));
+		else
+			serialize(*this, value);
+	}
+	template <typename T1, typename T2>
+	void operator()(std::pair<T1, T2> &value)
+	{
+		(*this)(value.first);
+		(*this)(value.second);
+	}
+	template <typename T>
+	void operator()(std::vector<T> &values)
+	{
+		uint32_t size = 0;
+		(*this)(size);
+		// Every element takes up at least one byte, so this catches sizes read from corrupted data before allocating for them
+		if (failed || size > data.size() - offset)
+		{
+			failed = true;
+			return;
+		}
+
+		values.resize(size);
+		if constexpr (std::is_arithmetic_v<T>)
+			read(values.data(), values.size() * sizeof(T));
+		else
+			for (T &value : values)
+				if (!failed)
+					(*this)(value);
+	}
+	void operator()(std::string &value)
+	{
+		uint32_t size = 0;
+		(*this)(size);
+		if (failed || size > data.size() - offset)
+		{
+			failed = true;
+			return;
+		}
+
+		value.assign(data, offset, size);
+		offset += size;
+	}
+	void operator()(std::filesystem::path &value)
+	{
+		std::string path;
+		(*this)(path);
+		value = std::filesystem::u8path(path);
+	}
+
+	void read(void *value, size_t size)
+	{
+		if (failed || size > data.size() - offset)
+		{
+			failed = true;
+			return;
+		}
+
+		std::memcpy(value, data.data() + offset, size);
+		offset += size;
+	}
+
+	const std::string &data;
+	size_t offset = 0;
+	bool failed = false;
+};
+
+static bool find_transient_texture_techniques(const reshadefx::module &module, const std::string &texture_name, std::vector<std::string> &techniques)
+{
+	// A texture is transient if every technique accessing it always overwrites it before reading from it, so its contents never need to be preserved between techniques or frames
+	techniques.clear();
+
+	for (const reshadefx::technique_info &technique_info : module.techniques)
+	{
+		for (const reshadefx::pass_info &pass_info : technique_info.passes)
+		{
+			const bool is_render_target = std::find(std::begin(pass_info.render_target_names), std::end(pass_info.render_target_names), texture_name) != std::end(pass_info.render_target_names);
+			const bool is_sampled = std::any_of(pass_info.samplers.begin(), pass_info.samplers.end(),
+				[&texture_name](const reshadefx::sampler_info &info) { return info.texture_name == texture_name; });
+			const bool is_storage = std::any_of(pass_info.storages.begin(), pass_info.storages.end(),
+				[&texture_name](const reshadefx::storage_info &info) { return info.texture_name == texture_name; });
+
+			if (!is_render_target && !is_sampled && !is_storage)
+				continue;
+
+			if (!techniques.empty() && techniques.back() == technique_info.name)
+				continue;
+
+			// First access of each technique has to overwrite every pixel, which cannot be guaranteed for storage writes or when blending, stencil or write masks are involved
+			// This also means the technique contains a graphics pass and is therefore never executed on the async compute queue
+			if (!is_render_target || is_sampled || is_storage || pass_info.blend_enable || pass_info.stencil_enable || pass_info.color_write_mask != 0xF || !pass_info.scissor_rect_uniform.empty())
+				return techniques.clear(), false;
+
+			techniques.push_back(technique_info.name);
+		}
+	}
+
+	return !techniques.empty();
+}
+
+static bool find_triangle_span(const float *vertices, float y, float &span_min, float &span_max)
+{
+	span_min = std::numeric_limits<float>::max();
+	span_max = std::numeric_limits<float>::lowest();
+
+	for (int i = 0; i < 3; ++i)
+	{
+		const float *const a = vertices + i * 2;
+		const float *const b = vertices + ((i + 1) % 3) * 2;
+		if (a[1] == b[1] || y < std::min(a[1], b[1]) || y > std::max(a[1], b[1]))
+			continue;
+
+		const float x = a[0] + (b[0] - a[0]) * (y - a[1]) / (b[1] - a[1]);
+		span_min = std::min(span_min, x);
+		span_max = std::max(span_max, x);
+	}
+
+	return span_min <= span_max;
+}
+static void rasterize_hidden_area_mesh(const std::vector<float> &vertices, uint32_t width, uint32_t height, std::vector<int32_t> &rects)
+{
+	// Coarse rows keep the number of rectangles that have to be cleared every frame down, at the cost of masking a few less pixels along the edges
+	constexpr uint32_t band_height = 4;
+
+	rects.clear();
+
+	std::vector<std::pair<float, float>> spans;
+	std::vector<size_t> prev_band_rects, band_rects;
+
+	for (uint32_t y0 = 0; y0 < height; y0 += band_height)
+	{
+		const uint32_t y1 = std::min(y0 + band_height, height);
+
+		spans.clear();
+		for (size_t i = 0; i + 6 <= vertices.size(); i += 6)
+		{
+			// Only pixels that are covered across the entire band may be masked, which for a triangle is the overlap of its spans at the top and bottom of the band
+			float top_min, top_max, bottom_min, bottom_max;
+			if (!find_triangle_span(vertices.data() + i, static_cast<float>(y0) / height, top_min, top_max) ||
+				!find_triangle_span(vertices.data() + i, static_cast<float>(y1) / height, bottom_min, bottom_max))
+				continue;
+
+			const float span_min = std::max(top_min, bottom_min) * width;
+			const float span_max = std::min(top_max, bottom_max) * width;
+			if (span_min < span_max)
+				spans.emplace_back(span_min, span_max);
+		}
+
+		std::sort(spans.begin(), spans.end());
+
+		band_rects.clear();
+		for (size_t k = 0; k < spans.size();)
+		{
+			const float span_min = spans[k].first;
+			float span_max = spans[k].second;
+			// Merge overlapping spans of neighboring triangles
+			for (++k; k < spans.size() && spans[k].first <= span_max; ++k)
+				span_max = std::max(span_max, spans[k].second);
+
+			const int32_t left = std::max(static_cast<int32_t>(std::ceil(span_min)), 0);
+			const int32_t right = std::min(static_cast<int32_t>(std::floor(span_max)), static_cast<int32_t>(width));
+			if (left >= right)
+				continue;
+
+			// Extend a rectangle of the previous band downwards if it has the same horizontal extent, instead of adding a new one
+			if (const auto it = std::find_if(prev_band_rects.begin(), prev_band_rects.end(),
+					[&rects, left, right](size_t index) { return rects[index * 4 + 0] == left && rects[index * 4 + 2] == right; });
+				it != prev_band_rects.end())
+			{
+				rects[*it * 4 + 3] = static_cast<int32_t>(y1);
+				band_rects.push_back(*it);
+				continue;
+			}
+
+			band_rects.push_back(rects.size() / 4);
+			rects.insert(rects.end(), { left, static_cast<int32_t>(y0), right, static_cast<int32_t>(y1) });
+		}
+
+		prev_band_rects.swap(band_rects);
+	}
+}
+
+static std::shared_ptr<reshade::shared_effect_cache> acquire_shared_effect_cache(reshade::api::device *device)
+{
+	static std::mutex s_mutex;
+	static std::unordered_map<reshade::api::device *, std::weak_ptr<reshade::shared_effect_cache>> s_caches;
+
+	const std::lock_guard<std::mutex> lock(s_mutex);
+
+	// Drop entries of devices whose runtimes were all destroyed
+	for (auto it = s_caches.begin(); it != s_caches.end();)
+		it = it->second.expired() ? s_caches.erase(it) : std::next(it);
+
+	std::weak_ptr<reshade::shared_effect_cache> &cache = s_caches[device];
+	if (std::shared_ptr<reshade::shared_effect_cache> existing = cache.lock())
+		return existing;
+
+	std::shared_ptr<reshade::shared_effect_cache> created = std::make_shared<reshade::shared_effect_cache>();
+	cache = created;
+	return created;
+}
+
 reshade::runtime::runtime(api::device *device, api::command_queue *graphics_queue) :
 	_device(device),
 	_graphics_queue(graphics_queue),
@@ -86,6 +676,7 @@ reshade::runtime::runtime(api::device *device, api::command_queue *graphics_queu
 	_performance_mode_key_data(),
 	_effects_key_data(),
 	_screenshot_key_data(),
+	_capture_key_data(),
 	_prev_preset_key_data(),
 	_next_preset_key_data(),
 	_config_path(g_reshade_base_path / L"ReShade.ini"),
@@ -93,6 +684,10 @@ reshade::runtime::runtime(api::device *device, api::command_queue *graphics_queu
 {
 	assert(device != nullptr && graphics_queue != nullptr);
 
+	// Runtimes on the same device compile the same effects for the same renderer, so share the results between them
+	_shared_effect_cache = acquire_shared_effect_cache(device);
+	_search_path_index = std::make_unique<directory_index>();
+
 	_needs_update = check_for_update(_latest_version);
 
 	// Default shortcut PrtScrn
@@ -111,11 +706,13 @@ reshade::runtime::runtime(api::device *device, api::command_queue *graphics_queu
 }
 reshade::runtime::~runtime()
 {
-	assert(_worker_threads.empty());
+	assert(_worker_pool.is_idle());
 	assert(!_is_initialized && _techniques.empty());
 
 	if (_d3d_compiler != nullptr)
 		FreeLibrary(static_cast<HMODULE>(_d3d_compiler));
+	if (_dxc_compiler != nullptr)
+		FreeLibrary(static_cast<HMODULE>(_dxc_compiler));
 
 #if RESHADE_GUI
 	deinit_gui();
@@ -126,99 +723,162 @@ bool reshade::runtime::on_init(input::window_handle window)
 {
 	assert(!_is_initialized);
 
-	// Create back buffer shader resource
-	if (_backbuffer_texture.handle == 0)
+	// Effects kept through the last reset can only be used as is if they were built for the same back buffer description, otherwise have to load them again
+	bool effects_kept = _effects_kept_on_reset;
+	_effects_kept_on_reset = false;
+	if (effects_kept && (_width != _kept_effects_width || _height != _kept_effects_height || _backbuffer_format != _kept_effects_backbuffer_format))
 	{
-		if (!_device->create_resource(
-			api::resource_desc(_width, _height, 1, 1, api::format_to_typeless(_backbuffer_format), 1, api::memory_heap::gpu_only, api::resource_usage::copy_dest | api::resource_usage::shader_resource),
-			nullptr, api::resource_usage::shader_resource, &_backbuffer_texture))
-		{
-			LOG(ERROR) << "Failed to create back buffer resource!";
-			goto exit_failure;
-		}
-
-		_device->set_resource_name(_backbuffer_texture, "ReShade back buffer");
+		effects_kept = false;
 
-		if (!_device->create_resource_view(_backbuffer_texture, api::resource_usage::shader_resource, api::resource_view_desc(api::format_to_default_typed(_backbuffer_format, 0)), &_backbuffer_texture_view[0]) ||
-			!_device->create_resource_view(_backbuffer_texture, api::resource_usage::shader_resource, api::resource_view_desc(api::format_to_default_typed(_backbuffer_format, 1)), &_backbuffer_texture_view[1]))
-		{
-			LOG(ERROR) << "Failed to create back buffer resource view!";
-			goto exit_failure;
-		}
+		unload_effects();
+		destroy_shared_effect_resources();
 	}
 
-	// Create effect stencil buffer
-	if (_effect_stencil.handle == 0)
+	// Creating these objects is independent of each other, so do so in parallel on D3D12 and Vulkan, where the device is free-threaded
+	// This is not guaranteed for the other APIs (e.g. D3D11 devices may have been created with 'D3D11_CREATE_DEVICE_SINGLETHREADED'), so those still create them one after another
+	const bool free_threaded_device = (_renderer_id >= 0xc000 && _renderer_id < 0x10000) || _renderer_id >= 0x20000;
+	bool init_succeeded = true;
 	{
-		// Find a supported stencil format
-		constexpr api::format possible_stencil_formats[] = {
-			api::format::s8_uint,
-			api::format::d16_unorm_s8_uint,
-			api::format::d24_unorm_s8_uint,
-			api::format::d32_float_s8_uint
-		};
-
-		for (const api::format format : possible_stencil_formats)
-		{
-			if (_device->check_format_support(format, api::resource_usage::depth_stencil))
-			{
-				_effect_stencil_format = format;
-				break;
-			}
-		}
+		const std::function<bool()> init_tasks[] = {
+			// Create back buffer shader resource
+			[this]() {
+				if (_backbuffer_texture.handle == 0)
+				{
+					if (!_device->create_resource(
+						api::resource_desc(_width, _height, 1, 1, api::format_to_typeless(_backbuffer_format), 1, api::memory_heap::gpu_only, api::resource_usage::copy_dest | api::resource_usage::shader_resource),
+						nullptr, api::resource_usage::shader_resource, &_backbuffer_texture))
+					{
+						LOG(ERROR) << "Failed to create back buffer resource!";
+						return false;
+					}
 
-		assert(_effect_stencil_format != api::format::unknown);
+					_device->set_resource_name(_backbuffer_texture, "ReShade back buffer");
 
-		if (!_device->create_resource(
-			api::resource_desc(_width, _height, 1, 1, _effect_stencil_format, 1, api::memory_heap::gpu_only, api::resource_usage::depth_stencil),
-			nullptr, api::resource_usage::depth_stencil_write, &_effect_stencil))
-		{
-			LOG(ERROR) << "Failed to create effect stencil buffer resource!";
-			goto exit_failure;
-		}
+					if (!_device->create_resource_view(_backbuffer_texture, api::resource_usage::shader_resource, api::resource_view_desc(api::format_to_default_typed(_backbuffer_format, 0)), &_backbuffer_texture_view[0]) ||
+						!_device->create_resource_view(_backbuffer_texture, api::resource_usage::shader_resource, api::resource_view_desc(api::format_to_default_typed(_backbuffer_format, 1)), &_backbuffer_texture_view[1]))
+					{
+						LOG(ERROR) << "Failed to create back buffer resource view!";
+						return false;
+					}
+				}
+				return true;
+			},
+			// Create effect stencil buffer
+			[this]() {
+				if (_effect_stencil.handle == 0)
+				{
+					// Find a supported stencil format
+					constexpr api::format possible_stencil_formats[] = {
+						api::format::s8_uint,
+						api::format::d16_unorm_s8_uint,
+						api::format::d24_unorm_s8_uint,
+						api::format::d32_float_s8_uint
+					};
 
-		_device->set_resource_name(_effect_stencil, "ReShade stencil buffer");
+					for (const api::format format : possible_stencil_formats)
+					{
+						if (_device->check_format_support(format, api::resource_usage::depth_stencil))
+						{
+							_effect_stencil_format = format;
+							break;
+						}
+					}
 
-		if (!_device->create_resource_view(_effect_stencil, api::resource_usage::depth_stencil, api::resource_view_desc(_effect_stencil_format), &_effect_stencil_target))
-		{
-			LOG(ERROR) << "Failed to create effect stencil buffer resource view!";
-			goto exit_failure;
-		}
-	}
+					assert(_effect_stencil_format != api::format::unknown);
 
-	// Create an empty texture, which is used when no depth buffer was detected (since you cannot bind nothing to a descriptor in Vulkan)
-	// Use VK_FORMAT_R16_SFLOAT format, since it is mandatory according to the spec (see https://www.khronos.org/registry/vulkan/specs/1.1/html/vkspec.html#features-required-format-support)
-	if (_empty_texture.handle == 0)
-	{
-		if (!_device->create_resource(
-			api::resource_desc(1, 1, 1, 1, api::format::r16_float, 1, api::memory_heap::gpu_only, api::resource_usage::shader_resource),
-			nullptr, api::resource_usage::shader_resource, &_empty_texture))
-		{
-			LOG(ERROR) << "Failed to create empty texture resource!";
-			goto exit_failure;
-		}
+					if (!_device->create_resource(
+						api::resource_desc(_width, _height, 1, 1, _effect_stencil_format, 1, api::memory_heap::gpu_only, api::resource_usage::depth_stencil),
+						nullptr, api::resource_usage::depth_stencil_write, &_effect_stencil))
+					{
+						LOG(ERROR) << "Failed to create effect stencil buffer resource!";
+						return false;
+					}
 
-		_device->set_resource_name(_empty_texture, "ReShade empty texture");
+					_device->set_resource_name(_effect_stencil, "ReShade stencil buffer");
 
-		if (!_device->create_resource_view(_empty_texture, api::resource_usage::shader_resource, api::resource_view_desc(api::format::r16_float), &_empty_texture_view))
-		{
-			LOG(ERROR) << "Failed to create empty texture resource view!";
-			goto exit_failure;
-		}
-	}
+					if (!_device->create_resource_view(_effect_stencil, api::resource_usage::depth_stencil, api::resource_view_desc(_effect_stencil_format), &_effect_stencil_target))
+					{
+						LOG(ERROR) << "Failed to create effect stencil buffer resource view!";
+						return false;
+					}
+				}
+				return true;
+			},
+			// Create an empty texture, which is used when no depth buffer was detected (since you cannot bind nothing to a descriptor in Vulkan)
+			// Use VK_FORMAT_R16_SFLOAT format, since it is mandatory according to the spec (see https://www.khronos.org/registry/vulkan/specs/1.1/html/vkspec.html#features-required-format-support)
+			[this]() {
+				if (_empty_texture.handle == 0)
+				{
+					if (!_device->create_resource(
+						api::resource_desc(1, 1, 1, 1, api::format::r16_float, 1, api::memory_heap::gpu_only, api::resource_usage::shader_resource),
+						nullptr, api::resource_usage::shader_resource, &_empty_texture))
+					{
+						LOG(ERROR) << "Failed to create empty texture resource!";
+						return false;
+					}
 
-	// Create render passes for the back buffer
-	for (uint32_t i = 0; i < get_back_buffer_count(); ++i)
-	{
-		api::resource backbuffer = { 0 };
-		get_back_buffer(i, &backbuffer);
+					_device->set_resource_name(_empty_texture, "ReShade empty texture");
 
-		api::render_pass_desc pass_desc = {};
-		pass_desc.depth_stencil = _effect_stencil_target;
-		pass_desc.depth_stencil_format = _effect_stencil_format;
-		pass_desc.render_targets_format[0] = api::format_to_default_typed(_backbuffer_format, 0);
-		api::render_pass_desc pass_desc_srgb = pass_desc;
-		pass_desc_srgb.render_targets_format[0] = api::format_to_default_typed(_backbuffer_format, 1);
+					if (!_device->create_resource_view(_empty_texture, api::resource_usage::shader_resource, api::resource_view_desc(api::format::r16_float), &_empty_texture_view))
+					{
+						LOG(ERROR) << "Failed to create empty texture resource view!";
+						return false;
+					}
+				}
+				return true;
+			},
+			// Not being able to convert screenshots on the GPU is not fatal, since 8-bit and 10-bit back buffers can still be converted on the CPU
+			[this]() {
+				if (_screenshot_convert_pipeline.handle == 0)
+					create_screenshot_convert_pipeline();
+				return true;
+			},
+#if RESHADE_GUI
+			// Rendering the glyphs of the fonts takes a while, so do it alongside the rest (the atlas is kept across resets, so this usually only happens on the first initialization)
+			[this, free_threaded_device]() {
+				if (_rebuild_font_atlas)
+					build_font_atlas();
+				if (free_threaded_device)
+					init_font_atlas_texture();
+				return true;
+			},
+#endif
+		};
+
+		bool init_results[std::size(init_tasks)] = {};
+		if (free_threaded_device)
+			_worker_pool.parallel_for(std::size(init_tasks), [&init_tasks, &init_results](size_t task_index) { init_results[task_index] = init_tasks[task_index](); });
+		else
+			for (size_t task_index = 0; task_index < std::size(init_tasks); ++task_index)
+				init_results[task_index] = init_tasks[task_index]();
+
+		init_succeeded = std::all_of(std::begin(init_results), std::end(init_results), [](bool result) { return result; });
+	}
+
+	if (!init_succeeded)
+		goto exit_failure;
+
+#if RESHADE_GUI
+	// Without a free-threaded device the font atlas texture is created here on the calling thread instead
+	if (!free_threaded_device)
+		init_font_atlas_texture();
+#endif
+
+	// Convert the area that is never visible into rectangles in the stencil buffer, which is the same size as the back buffer
+	rasterize_hidden_area_mesh(_hidden_area_vertices, _width, _height, _hidden_area_rects);
+
+	// Create render passes for the back buffer
+	for (uint32_t i = 0; i < get_back_buffer_count(); ++i)
+	{
+		api::resource backbuffer = { 0 };
+		get_back_buffer(i, &backbuffer);
+
+		api::render_pass_desc pass_desc = {};
+		pass_desc.depth_stencil = _effect_stencil_target;
+		pass_desc.depth_stencil_format = _effect_stencil_format;
+		pass_desc.render_targets_format[0] = api::format_to_default_typed(_backbuffer_format, 0);
+		api::render_pass_desc pass_desc_srgb = pass_desc;
+		pass_desc_srgb.render_targets_format[0] = api::format_to_default_typed(_backbuffer_format, 1);
 
 		if (!_device->create_resource_view(backbuffer, api::resource_usage::render_target, api::resource_view_desc(pass_desc.render_targets_format[0]), &_backbuffer_targets.emplace_back()) ||
 			!_device->create_resource_view(backbuffer, api::resource_usage::render_target, api::resource_view_desc(pass_desc_srgb.render_targets_format[0]), &_backbuffer_targets.emplace_back()))
@@ -293,7 +953,10 @@ bool reshade::runtime::on_init(input::window_handle window)
 	}
 
 	// Reset frame count to zero so effects are loaded in 'update_and_render_effects'
-	_framecount = 0;
+	if (effects_kept)
+		LOG(INFO) << "Keeping effects loaded, since the back buffer dimensions and format did not change.";
+	else
+		_framecount = 0;
 
 	_is_initialized = true;
 	_last_reload_time = std::chrono::high_resolution_clock::now();
@@ -309,6 +972,10 @@ bool reshade::runtime::on_init(input::window_handle window)
 	return true;
 
 exit_failure:
+	// Effects that were kept through the last reset reference the resources destroyed below
+	if (effects_kept)
+		unload_effects();
+
 	for (api::render_pass pass : _backbuffer_passes)
 		_device->destroy_render_pass(pass);
 	_backbuffer_passes.clear();
@@ -316,22 +983,8 @@ exit_failure:
 		_device->destroy_resource_view(view);
 	_backbuffer_targets.clear();
 
-	_device->destroy_resource(_backbuffer_texture);
-	_backbuffer_texture = {};
-	_device->destroy_resource_view(_backbuffer_texture_view[0]);
-	_backbuffer_texture_view[0] = {};
-	_device->destroy_resource_view(_backbuffer_texture_view[1]);
-	_backbuffer_texture_view[1] = {};
-
-	_device->destroy_resource(_effect_stencil);
-	_effect_stencil = {};
-	_device->destroy_resource_view(_effect_stencil_target);
-	_effect_stencil_target = {};
-
-	_device->destroy_resource(_empty_texture);
-	_empty_texture = {};
-	_device->destroy_resource_view(_empty_texture_view);
-	_empty_texture_view = {};
+	destroy_shared_effect_resources();
+	destroy_screenshot_convert_pipeline();
 
 #if RESHADE_GUI
 	if (_is_vr)
@@ -350,7 +1003,33 @@ void reshade::runtime::on_reset()
 	else
 		return; // Nothing to do if the runtime was already destroyed or not successfully initialized in the first place
 
-	unload_effects(); // Already performs a wait for idle, so no need to do it again before destroying resources below
+	// Screenshots still waiting for their copy need to be read back before the back buffer format and dimensions are reset
+	process_pending_screenshots(true);
+	stop_capture();
+
+	// Rectangles refer to the old back buffer dimensions, so wait for the add-on to provide new ones
+	_sky_rects.clear();
+
+	// Effects can only be kept if the device stays the same, which is not the case for D3D9, where resetting the device loses all resources in the default pool
+	// Effects still being loaded on worker threads abort when the runtime is no longer initialized, so those have to be loaded again either way
+	_effects_kept_on_reset = _keep_effects_on_reset && _renderer_id != 0x9000 && !is_loading() && _reload_compile_queue.empty() && _effect_variants.empty() && _worker_pool.is_idle();
+	_keep_effects_on_reset = false;
+
+	if (_effects_kept_on_reset)
+	{
+		_kept_effects_width = _width;
+		_kept_effects_height = _height;
+		_kept_effects_backbuffer_format = _backbuffer_format;
+
+		// Recorded commands reference the back buffer render passes destroyed below
+		destroy_technique_recordings();
+
+		_device->wait_idle();
+	}
+	else
+	{
+		unload_effects(); // Already performs a wait for idle, so no need to do it again before destroying resources below
+	}
 
 	_width = _height = 0;
 
@@ -361,6 +1040,32 @@ void reshade::runtime::on_reset()
 		_device->destroy_resource_view(view);
 	_backbuffer_targets.clear();
 
+	// The back buffer copy, stencil buffer and empty texture are referenced by the descriptor sets and render passes of the kept effects, so keep them too (their dimensions are checked in 'on_init')
+	if (!_effects_kept_on_reset)
+		destroy_shared_effect_resources();
+
+	destroy_screenshot_convert_pipeline();
+
+	_device->destroy_query_pool(_latency_query_pool);
+	_latency_query_pool = {};
+	_latency_query_framecount = 0;
+	_latency_query_timestamp = 0;
+
+#if RESHADE_GUI
+	if (_is_vr)
+		deinit_gui_vr();
+
+	destroy_imgui_resources();
+#endif
+
+#if RESHADE_ADDON
+	invoke_addon_event<addon_event::destroy_effect_runtime>(this);
+#endif
+
+	LOG(INFO) << "Destroyed runtime environment on runtime " << this << '.';
+}
+void reshade::runtime::destroy_shared_effect_resources()
+{
 	_device->destroy_resource(_backbuffer_texture);
 	_backbuffer_texture = {};
 	_device->destroy_resource_view(_backbuffer_texture_view[0]);
@@ -377,36 +1082,44 @@ void reshade::runtime::on_reset()
 	_empty_texture = {};
 	_device->destroy_resource_view(_empty_texture_view);
 	_empty_texture_view = {};
-
-#if RESHADE_GUI
-	if (_is_vr)
-		deinit_gui_vr();
-
-	destroy_imgui_resources();
-#endif
-
-#if RESHADE_ADDON
-	invoke_addon_event<addon_event::destroy_effect_runtime>(this);
-#endif
-
-	LOG(INFO) << "Destroyed runtime environment on runtime " << this << '.';
 }
+
 void reshade::runtime::on_present()
 {
 	assert(is_initialized());
 
+	// Another view of the same frame only needs the effects rendered again, all per-frame work was already done for the first view
+	if (_present_next_view)
+	{
+		_present_next_view = false;
+		render_effects_for_next_view();
+		return;
+	}
+
+	const auto present_started = std::chrono::high_resolution_clock::now();
+
+	collect_profiling_samples();
+
+	RESHADE_PROFILE_SCOPE("runtime::on_present");
+
+	// Take a snapshot of all input received since the last frame, which is then used throughout this frame without blocking window message processing
+	_input->next_frame();
+
+	process_pending_screenshots(false);
+
+	const auto effects_started = std::chrono::high_resolution_clock::now();
 	update_and_render_effects();
+	const auto effects_finished = std::chrono::high_resolution_clock::now();
+
+	if (_capture_sink != nullptr)
+		capture_frame();
 
 	_framecount++;
 	const auto current_time = std::chrono::high_resolution_clock::now();
 	_last_frame_duration = current_time - _last_present_time;
+	_frame_time_histogram.append(std::chrono::duration_cast<std::chrono::nanoseconds>(_last_frame_duration).count());
 	_last_present_time = current_time;
 
-#ifdef NDEBUG
-	// Lock input so it cannot be modified by other threads while we are reading it here
-	const auto input_lock = _input->lock();
-#endif
-
 #if RESHADE_GUI
 	// Draw overlay
 	if (_is_vr)
@@ -414,6 +1127,10 @@ void reshade::runtime::on_present()
 	else
 		draw_gui();
 
+	// Keep measuring GPU durations of techniques for the telemetry and benchmark, even if the overlay does not show them
+	if (_export_telemetry || (_benchmark_frames != 0 && !_benchmark_finished))
+		_gather_gpu_statistics = true;
+
 	if (_should_save_screenshot && _screenshot_save_gui && (_show_overlay || (_preview_texture.handle != 0 && _effects_enabled)))
 		save_screenshot(L" overlay");
 #endif
@@ -430,6 +1147,14 @@ void reshade::runtime::on_present()
 		if (_input->is_key_pressed(_screenshot_key_data, _force_shortcut_modifiers))
 			_should_save_screenshot = true; // Notify 'update_and_render_effects' that we want to save a screenshot next frame
 
+		if (_input->is_key_pressed(_capture_key_data, _force_shortcut_modifiers))
+		{
+			if (_capture_sink != nullptr)
+				stop_capture();
+			else
+				start_capture();
+		}
+
 		// Do not allow the next shortcuts while effects are being loaded or compiled (since they affect that state)
 		if (!is_loading() && _reload_compile_queue.empty())
 		{
@@ -452,22 +1177,24 @@ void reshade::runtime::on_present()
 					_last_preset_switching_time = current_time;
 					_is_in_between_presets_transition = true;
 					save_config();
+
+					// Apply the new preset right away, which collects the values to interpolate for the rest of the transition
+					load_current_preset();
 				}
 			}
 
 			// Continuously update preset values while a transition is in progress
 			if (_is_in_between_presets_transition)
-				load_current_preset();
+				update_preset_transition();
 		}
 	}
 
-	// Reset input status
-	_input->next_frame();
-
 	// Save modified INI files
 	if (!ini_file::flush_cache())
 		_preset_save_success = false;
 
+	update_memory_budget();
+
 #if RESHADE_ADDON
 	// Detect high network traffic
 	static int cooldown = 0, traffic = 0;
@@ -485,17 +1212,99 @@ void reshade::runtime::on_present()
 
 	// Reset frame statistics
 	g_network_traffic = 0;
+
+	if (_export_telemetry)
+		publish_telemetry(present_started, effects_finished - effects_started);
+	else if (_telemetry != nullptr)
+		_telemetry.reset();
+
+	update_benchmark();
+
+	limit_frame_latency();
 }
 
-bool reshade::runtime::load_effect(const std::filesystem::path &source_file, const reshade::ini_file &preset, size_t effect_index, bool preprocess_required)
+void reshade::runtime::collect_profiling_samples()
+{
+#if RESHADE_PROFILING
+	// Always drain the per-thread buffers, so that they do not fill up with stale samples while nobody is looking at them
+	_profiling_samples.clear();
+	profiling::collect(_profiling_samples);
+
+	_hook_cpu_duration_ns = 0;
+	for (const profiling::sample &sample : _profiling_samples)
+		if (sample.depth == 0)
+			_hook_cpu_duration_ns += sample.end_ns - sample.beg_ns;
+
+	_profiling_calls.clear();
+	profiling::collect(_profiling_calls);
+
+#if RESHADE_GUI
+	// The samples cover the time since the effects of the last frame started rendering, so add them to that frame of the timeline
+	if (frame_timeline::frame *const frame = _gather_timeline && !_timeline_paused ? _timeline.find_frame(_framecount - 1) : nullptr;
+		frame != nullptr)
+	{
+		for (const profiling::sample &sample : _profiling_samples)
+		{
+			frame_timeline::event &e = frame->events.emplace_back();
+			e.type = frame_timeline::event::hook;
+			e.pass_index = sample.depth;
+			e.thread_id = sample.thread_id;
+			e.name = sample.name;
+			e.cpu_beg = sample.beg_ns;
+			e.cpu_end = sample.end_ns;
+
+			frame->cpu_beg = std::min(frame->cpu_beg, sample.beg_ns);
+			frame->cpu_end = std::max(frame->cpu_end, sample.end_ns);
+		}
+	}
+#endif
+#endif
+}
+
+namespace
+{
+	// Adds the time spent in a scope to the duration of a load phase (see 'update_benchmark')
+	class load_phase_timer
+	{
+	public:
+		explicit load_phase_timer(std::atomic<uint64_t> &duration) : _duration(duration), _start(std::chrono::high_resolution_clock::now()) {}
+		~load_phase_timer() { _duration.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - _start).count(), std::memory_order_relaxed); }
+
+		load_phase_timer(const load_phase_timer &) = delete;
+		load_phase_timer &operator=(const load_phase_timer &) = delete;
+
+	private:
+		std::atomic<uint64_t> &_duration;
+		const std::chrono::high_resolution_clock::time_point _start;
+	};
+}
+
+bool reshade::runtime::build_effect(effect &effect, const std::filesystem::path &source_file, const reshade::ini_file &preset, const std::vector<std::string> &preset_preprocessor_definitions, size_t effect_index, bool preprocess_required, bool &source_cached)
 {
+	// Effects selected in the preset are rendered at a scaled internal resolution, by compiling them with reduced buffer dimensions
+	// The last pass that writes to the back buffer still runs at full resolution and upsamples the results when sampling from the scaled textures
+	std::vector<std::string> render_scale_effects;
+	preset.get({}, "RenderScaleEffects", render_scale_effects);
+	const bool render_scaled = std::find(render_scale_effects.begin(), render_scale_effects.end(), source_file.filename().u8string()) != render_scale_effects.end();
+	const float render_scale = render_scaled ? _current_effect_render_scale : 1.0f;
+	const unsigned int buffer_width = std::max(1u, static_cast<unsigned int>(_width * render_scale + 0.5f));
+	const unsigned int buffer_height = std::max(1u, static_cast<unsigned int>(_height * render_scale + 0.5f));
+
+	// Wave intrinsics map to native instructions with shader model 6 and SPIR-V, everywhere else they are emulated with a wave of a single lane
+	const bool wave_intrinsics = (_renderer_id & 0x20000) != 0 || uses_dxil_codegen();
+
 	std::string attributes;
 	attributes += "app=" + g_target_executable_path.stem().u8string() + ';';
-	attributes += "width=" + std::to_string(_width) + ';';
-	attributes += "height=" + std::to_string(_height) + ';';
+	attributes += "width=" + std::to_string(buffer_width) + ';';
+	attributes += "height=" + std::to_string(buffer_height) + ';';
 	attributes += "color_bit_depth=" + std::to_string(_color_bit_depth) + ';';
 	attributes += "version=" + std::to_string(VERSION_MAJOR * 10000 + VERSION_MINOR * 100 + VERSION_REVISION) + ';';
 	attributes += "performance_mode=" + std::string(_performance_mode ? "1" : "0") + ';';
+	attributes += "wave_intrinsics=" + std::string(wave_intrinsics ? "1" : "0") + ';';
+	attributes += "specialize_discrete_uniforms=" + std::string(_specialize_discrete_uniforms ? "1" : "0") + ';';
+	attributes += "pack_uniforms=" + std::string(_pack_uniforms ? "1" : "0") + ';';
+	attributes += "spirv=" + std::string(uses_spirv_codegen() ? "1" : "0") + ';';
+	attributes += "debug_info=" + std::string(_no_debug_info ? "0" : "1") + ';';
 	attributes += "vendor=" + std::to_string(_vendor_id) + ';';
 	attributes += "device=" + std::to_string(_device_id) + ';';
 
@@ -525,22 +1334,24 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 	}
 
 	std::vector<std::string> preprocessor_definitions = _global_preprocessor_definitions;
-	preprocessor_definitions.insert(preprocessor_definitions.end(), _preset_preprocessor_definitions.begin(), _preset_preprocessor_definitions.end());
+	preprocessor_definitions.insert(preprocessor_definitions.end(), preset_preprocessor_definitions.begin(), preset_preprocessor_definitions.end());
 	for (const std::string &definition : preprocessor_definitions)
 		attributes += definition + ';';
 
 	const size_t source_hash = std::hash<std::string>()(attributes);
 
-	effect &effect = _effects[effect_index];
 	const std::string effect_name = source_file.filename().u8string();
-	if (source_file != effect.source_file || source_hash != effect.source_hash)
+	// Start over if the generated code of a previous load was released and cannot be read back from the effect cache
+	if (source_file != effect.source_file || source_hash != effect.source_hash || !restore_effect_code(effect))
 	{
 		effect = {};
 		effect.source_file = source_file;
 		effect.source_hash = source_hash;
 	}
 
-	if (_effect_load_skipping && !_load_option_disable_skipping && !_worker_threads.empty()) // Only skip during 'load_effects'
+	effect.render_scaled = render_scaled;
+
+	if (_effect_load_skipping && !_load_option_disable_skipping && is_loading()) // Only skip during 'load_effects'
 	{
 		if (std::vector<std::string> techniques;
 			preset.get({}, "Techniques", techniques))
@@ -550,27 +1361,42 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 				return at_pos == 0 || technique.find(effect_name, at_pos) == at_pos; }) == techniques.cend();
 
 			if (effect.skipped)
-			{
-				if (_reload_remaining_effects != 0 && _reload_remaining_effects != std::numeric_limits<size_t>::max())
-					_reload_remaining_effects--;
 				return false;
-			}
 		}
 	}
 
-	bool source_cached = false; std::string source;
-	if (!effect.preprocessed && (preprocess_required || (source_cached = load_effect_cache(source_file, source_hash, source)) == false))
+	// Switching back to definitions that were used before can skip preprocessing and parsing entirely
+	bool module_changed = false;
+	if (!effect.compiled && !preprocess_required && load_effect_permutation(effect))
+	{
+		module_changed = true;
+		effect.preprocessed = true;
+	}
+	// The same goes for definitions that were used in a previous session, in which case the parsed effect is read from the effect cache
+	else if (!effect.compiled && !preprocess_required && load_effect_cache(source_file, source_hash, effect))
+	{
+		module_changed = true;
+		effect.preprocessed = true;
+
+		save_effect_permutation(effect);
+	}
+
+	std::string source;
+	if (!effect.preprocessed && (preprocess_required || (source_cached = load_effect_cache(source_file, source_hash, source, effect.included_files)) == false))
 	{
+		const load_phase_timer timer(_load_phase_durations_ns[static_cast<size_t>(benchmark_load_phase::preprocess)]);
+
 		reshadefx::preprocessor pp;
 		pp.add_macro_definition("__RESHADE__", std::to_string(VERSION_MAJOR * 10000 + VERSION_MINOR * 100 + VERSION_REVISION));
 		pp.add_macro_definition("__RESHADE_PERFORMANCE_MODE__", _performance_mode ? "1" : "0");
+		pp.add_macro_definition("__RESHADE_WAVE_INTRINSICS__", wave_intrinsics ? "1" : "0");
 		pp.add_macro_definition("__VENDOR__", std::to_string(_vendor_id));
 		pp.add_macro_definition("__DEVICE__", std::to_string(_device_id));
 		pp.add_macro_definition("__RENDERER__", std::to_string(_renderer_id));
 		pp.add_macro_definition("__APPLICATION__", std::to_string( // Truncate hash to 32-bit, since lexer currently only supports 32-bit numbers anyway
 			std::hash<std::string>()(g_target_executable_path.stem().u8string()) & 0xFFFFFFFF));
-		pp.add_macro_definition("BUFFER_WIDTH", std::to_string(_width));
-		pp.add_macro_definition("BUFFER_HEIGHT", std::to_string(_height));
+		pp.add_macro_definition("BUFFER_WIDTH", std::to_string(buffer_width));
+		pp.add_macro_definition("BUFFER_HEIGHT", std::to_string(buffer_height));
 		pp.add_macro_definition("BUFFER_RCP_WIDTH", "(1.0 / BUFFER_WIDTH)");
 		pp.add_macro_definition("BUFFER_RCP_HEIGHT", "(1.0 / BUFFER_HEIGHT)");
 		pp.add_macro_definition("BUFFER_COLOR_BIT_DEPTH", std::to_string(_color_bit_depth));
@@ -593,15 +1419,7 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 			pp.add_include_path(include_path);
 
 		// Add some conversion macros for compatibility with older versions of ReShade
-		pp.append_string(
-			"#define tex2Doffset(s, coords, offset) tex2D(s, coords, offset)\n"
-			"#define tex2Dlodoffset(s, coords, offset) tex2Dlod(s, coords, offset)\n"
-			"#define tex2Dgather(s, t, c) tex2Dgather##c(s, t)\n"
-			"#define tex2Dgatheroffset(s, t, o, c) tex2Dgather##c(s, t, o)\n"
-			"#define tex2Dgather0 tex2DgatherR\n"
-			"#define tex2Dgather1 tex2DgatherG\n"
-			"#define tex2Dgather2 tex2DgatherB\n"
-			"#define tex2Dgather3 tex2DgatherA\n");
+		pp.append_string(compatibility_macro_definitions);
 
 		// Load and preprocess the source file
 		effect.preprocessed = pp.append_file(source_file);
@@ -612,7 +1430,6 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 		if (effect.preprocessed)
 		{
 			source = std::move(pp.output());
-			source_cached = save_effect_cache(source_file, source_hash, source);
 
 			// Keep track of used preprocessor definitions (so they can be displayed in the overlay)
 			effect.definitions.clear();
@@ -629,266 +1446,171 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 			// Keep track of included files
 			effect.included_files = pp.included_files();
 			std::sort(effect.included_files.begin(), effect.included_files.end()); // Sort file names alphabetically
+
+			source_cached = save_effect_cache(source_file, source_hash, source, effect.included_files);
 		}
 	}
 
 	if (!effect.compiled && !source.empty())
 	{
-		unsigned shader_model;
-		if (_renderer_id == 0x9000)
-			shader_model = 30; // D3D9
-		else if (_renderer_id < 0xa100)
-			shader_model = 40; // D3D10 (including feature level 9)
-		else if (_renderer_id < 0xb000)
-			shader_model = 41; // D3D10.1
-		else if (_renderer_id < 0xc000)
-			shader_model = 50; // D3D11
-		else
-			shader_model = 51; // D3D12
+		const unsigned int shader_model = hlsl_shader_model(_renderer_id, uses_dxil_codegen());
 
 		std::unique_ptr<reshadefx::codegen> codegen;
 		if ((_renderer_id & 0xF0000) == 0)
-			codegen.reset(reshadefx::create_codegen_hlsl(shader_model, !_no_debug_info, _performance_mode));
-		else if (_renderer_id < 0x20000)
-			codegen.reset(reshadefx::create_codegen_glsl(!_no_debug_info, _performance_mode, false, true));
-		else // Vulkan uses SPIR-V input
-			codegen.reset(reshadefx::create_codegen_spirv(true, !_no_debug_info, _performance_mode, false, false));
+			codegen.reset(reshadefx::create_codegen_hlsl(shader_model, !_no_debug_info, _performance_mode, _specialize_discrete_uniforms, _pack_uniforms));
+		else if (_renderer_id < 0x20000 && !uses_spirv_codegen())
+			codegen.reset(reshadefx::create_codegen_glsl(!_no_debug_info, _performance_mode, false, true, _specialize_discrete_uniforms, _pack_uniforms));
+		else // Vulkan and OpenGL 4.6 use SPIR-V input (which keeps uniforms in declaration order, since the generated code refers to them by member index)
+			codegen.reset(reshadefx::create_codegen_spirv(_renderer_id >= 0x20000, !_no_debug_info, _performance_mode, false, _renderer_id < 0x20000, _specialize_discrete_uniforms));
 
 		reshadefx::parser parser;
 
 		// Compile the pre-processed source code (try the compile even if the preprocessor step failed to get additional error information)
-		effect.compiled = parser.parse(std::move(source), codegen.get());
+		{
+			const load_phase_timer timer(_load_phase_durations_ns[static_cast<size_t>(benchmark_load_phase::parse)]);
+			effect.compiled = parser.parse(std::move(source), codegen.get());
+		}
 
 		// Append parser errors to the error list
 		effect.errors  += parser.errors();
 
 		// Write result to effect module
-		codegen->write_result(effect.module);
-
-		if (effect.compiled)
 		{
-			effect.uniforms.clear();
-
-			// Create space for all variables (aligned to 16 bytes)
-			effect.uniform_data_storage.resize((effect.module.total_uniform_size + 15) & ~15);
-
-			for (uniform variable : effect.module.uniforms)
-			{
-				variable.effect_index = effect_index;
-
-				// Copy initial data into uniform storage area
-				reset_uniform_value(variable);
+			const load_phase_timer timer(_load_phase_durations_ns[static_cast<size_t>(benchmark_load_phase::codegen)]);
+			codegen->write_result(effect.module);
 
-				const std::string_view special = variable.annotation_as_string("source");
-				if (special.empty()) /* Ignore if annotation is missing */;
-				else if (special == "frametime")
-					variable.special = special_uniform::frame_time;
-				else if (special == "framecount")
-					variable.special = special_uniform::frame_count;
-				else if (special == "random")
-					variable.special = special_uniform::random;
-				else if (special == "pingpong")
-					variable.special = special_uniform::ping_pong;
-				else if (special == "date")
-					variable.special = special_uniform::date;
-				else if (special == "timer")
-					variable.special = special_uniform::timer;
-				else if (special == "key")
-					variable.special = special_uniform::key;
-				else if (special == "mousepoint")
-					variable.special = special_uniform::mouse_point;
-				else if (special == "mousedelta")
-					variable.special = special_uniform::mouse_delta;
-				else if (special == "mousebutton")
-					variable.special = special_uniform::mouse_button;
-				else if (special == "mousewheel")
-					variable.special = special_uniform::mouse_wheel;
-				else if (special == "freepie")
-					variable.special = special_uniform::freepie;
-				else if (special == "ui_open" ||special == "overlay_open")
-					variable.special = special_uniform::overlay_open;
-				else if (special == "ui_active" || special == "overlay_active")
-					variable.special = special_uniform::overlay_active;
-				else if (special == "ui_hovered" || special == "overlay_hovered")
-					variable.special = special_uniform::overlay_hovered;
-
-				effect.uniforms.push_back(std::move(variable));
-			}
-
-			// Fill all specialization constants with values from the current preset
-			if (_performance_mode)
-			{
-				effect.preamble.clear();
-
-				for (reshadefx::uniform_info &constant : effect.module.spec_constants)
-				{
-					effect.preamble += "#define SPEC_CONSTANT_" + constant.name + ' ';
-
-					switch (constant.type.base)
-					{
-					case reshadefx::type::t_int:
-						preset.get(effect_name, constant.name, constant.initializer_value.as_int);
-						break;
-					case reshadefx::type::t_bool:
-					case reshadefx::type::t_uint:
-						preset.get(effect_name, constant.name, constant.initializer_value.as_uint);
-						break;
-					case reshadefx::type::t_float:
-						preset.get(effect_name, constant.name, constant.initializer_value.as_float);
-						break;
-					}
-
-					// Check if this is a split specialization constant and move data accordingly
-					if (constant.type.is_scalar() && constant.offset != 0)
-						constant.initializer_value.as_uint[0] = constant.initializer_value.as_uint[constant.offset];
-
-					for (unsigned int i = 0; i < constant.type.components(); ++i)
-					{
-						switch (constant.type.base)
-						{
-						case reshadefx::type::t_bool:
-							effect.preamble += constant.initializer_value.as_uint[i] ? "true" : "false";
-							break;
-						case reshadefx::type::t_int:
-							effect.preamble += std::to_string(constant.initializer_value.as_int[i]);
-							break;
-						case reshadefx::type::t_uint:
-							effect.preamble += std::to_string(constant.initializer_value.as_uint[i]);
-							break;
-						case reshadefx::type::t_float:
-							effect.preamble += std::to_string(constant.initializer_value.as_float[i]);
-							break;
-						}
+			// Code specific to each entry point only reads the shared state of the code generator, so can be written in parallel (this is significant for the SPIR-V modules of effects with many passes)
+			_worker_pool.parallel_for(effect.module.entry_points.size(), [&codegen, &effect](size_t entry_point_index) {
+				codegen->write_entry_point_result(effect.module.entry_points[entry_point_index]);
+			});
+		}
 
-						if (i + 1 < constant.type.components())
-							effect.preamble += ", ";
-					}
+		module_changed = true;
 
-					effect.preamble += '\n';
-				}
-			}
+		if (effect.compiled)
+		{
+			save_effect_permutation(effect);
+			save_effect_cache(source_file, source_hash, effect);
 		}
 	}
 
-	if ( effect.compiled && (effect.preprocessed || source_cached))
+	if (effect.compiled && module_changed)
 	{
-		const std::lock_guard<std::mutex> lock(_reload_mutex);
-
-		for (texture texture : effect.module.textures)
-		{
-			texture.effect_index = effect_index;
-
-			// Try to share textures with the same name across effects
-			if (const auto existing_texture = std::find_if(_textures.begin(), _textures.end(),
-				[&texture](const auto &item) { return item.unique_name == texture.unique_name; });
-				existing_texture != _textures.end())
-			{
-				// Cannot share texture if this is a normal one, but the existing one is a reference and vice versa
-				if (texture.semantic != existing_texture->semantic)
-				{
-					effect.errors += "error: " + texture.unique_name + ": another effect (";
-					effect.errors += _effects[existing_texture->effect_index].source_file.filename().u8string();
-					effect.errors += ") already created a texture with the same name but different semantic\n";
-					effect.compiled = false;
-					break;
-				}
+		effect.uniforms.clear();
 
-				if (texture.semantic.empty() && !existing_texture->matches_description(texture))
-				{
-					effect.errors += "warning: " + texture.unique_name + ": another effect (";
-					effect.errors += _effects[existing_texture->effect_index].source_file.filename().u8string();
-					effect.errors += ") already created a texture with the same name but different dimensions\n";
-				}
-				if (texture.semantic.empty() && (existing_texture->annotation_as_string("source") != texture.annotation_as_string("source")))
-				{
-					effect.errors += "warning: " + texture.unique_name + ": another effect (";
-					effect.errors += _effects[existing_texture->effect_index].source_file.filename().u8string();
-					effect.errors += ") already created a texture with a different image file\n";
-				}
+		// Create space for all variables (aligned to 16 bytes)
+		effect.uniform_data_storage.resize((effect.module.total_uniform_size + 15) & ~15);
 
-				if (existing_texture->semantic == "COLOR" && _color_bit_depth != 8)
-				{
-					for (const auto &sampler_info : effect.module.samplers)
-					{
-						if (sampler_info.srgb && sampler_info.texture_name == texture.unique_name)
-						{
-							effect.errors += "warning: " + sampler_info.unique_name + ": texture does not support sRGB sampling (back buffer format is not RGBA8)";
-						}
-					}
-				}
+		for (uniform variable : effect.module.uniforms)
+		{
+			variable.effect_index = effect_index;
+
+			// Copy initial data into uniform storage area
+			reset_uniform_value(variable);
+
+			const std::string_view special = variable.annotation_as_string("source");
+			if (special.empty()) /* Ignore if annotation is missing */;
+			else if (special == "frametime")
+				variable.special = special_uniform::frame_time;
+			else if (special == "framecount")
+				variable.special = special_uniform::frame_count;
+			else if (special == "random")
+				variable.special = special_uniform::random;
+			else if (special == "pingpong")
+				variable.special = special_uniform::ping_pong;
+			else if (special == "date")
+				variable.special = special_uniform::date;
+			else if (special == "timer")
+				variable.special = special_uniform::timer;
+			else if (special == "key")
+				variable.special = special_uniform::key;
+			else if (special == "mousepoint")
+				variable.special = special_uniform::mouse_point;
+			else if (special == "mousedelta")
+				variable.special = special_uniform::mouse_delta;
+			else if (special == "mousebutton")
+				variable.special = special_uniform::mouse_button;
+			else if (special == "mousewheel")
+				variable.special = special_uniform::mouse_wheel;
+			else if (special == "freepie")
+				variable.special = special_uniform::freepie;
+			else if (special == "ui_open" ||special == "overlay_open")
+				variable.special = special_uniform::overlay_open;
+			else if (special == "ui_active" || special == "overlay_active")
+				variable.special = special_uniform::overlay_active;
+			else if (special == "ui_hovered" || special == "overlay_hovered")
+				variable.special = special_uniform::overlay_hovered;
+
+			variable.specialized = std::find_if(effect.module.spec_constants.begin(), effect.module.spec_constants.end(),
+				[&variable](const reshadefx::uniform_info &constant) { return constant.name == variable.name; }) != effect.module.spec_constants.end();
+
+			variable.hidden = variable.annotation_as_int("hidden") != 0;
+			variable.ui_category_closed = variable.annotation_as_int("ui_category_closed") != 0;
+			variable.ui_spacing = variable.annotation_as_int("ui_spacing");
+			variable.ui_label = variable.annotation_as_string("ui_label");
+			if (variable.ui_label.empty())
+				variable.ui_label = variable.name;
+			variable.ui_type = variable.annotation_as_string("ui_type");
+			variable.ui_category = variable.annotation_as_string("ui_category");
+			variable.ui_items = variable.annotation_as_string("ui_items");
+			variable.ui_text = variable.annotation_as_string("ui_text");
+			variable.ui_tooltip = variable.annotation_as_string("ui_tooltip");
+
+			effect.uniforms.push_back(std::move(variable));
+		}
 
-				if (std::find(existing_texture->shared.begin(), existing_texture->shared.end(), effect_index) == existing_texture->shared.end())
-					existing_texture->shared.push_back(effect_index);
+		// Indices of the variables changed, so have to rebuild the index of variables by source and any handles to them (see 'update_effect_handles')
+		_effect_handles_outdated = true;
+	}
 
-				// Always make shared textures render targets, since they may be used as such in a different effect
-				existing_texture->render_target = true;
-				existing_texture->storage_access = true;
-				continue;
-			}
+	if (effect.compiled)
+	{
+		effect.preamble.clear();
 
-			if (texture.annotation_as_int("pooled") && texture.semantic.empty())
+		// Fill all specialization constants with values from the current preset
+		// This has to be done on every build, not only when the module changed, since changing a specialized variable reloads the effect with the same module (see 'draw_variable_editor')
+		// Outside of performance mode these are only the discrete uniforms
+		for (reshadefx::uniform_info &constant : effect.module.spec_constants)
+		{
+			switch (constant.type.base)
 			{
-				// Try to find another pooled texture to share with (and do not share within the same effect)
-				if (const auto existing_texture = std::find_if(_textures.begin(), _textures.end(),
-					[&texture](const auto &item) { return item.annotation_as_int("pooled") && item.effect_index != texture.effect_index && item.matches_description(texture); });
-					existing_texture != _textures.end())
-				{
-					// Overwrite referenced texture in samplers with the pooled one
-					for (auto &sampler_info : effect.module.samplers)
-						if (sampler_info.texture_name == texture.unique_name)
-							sampler_info.texture_name  = existing_texture->unique_name;
-					// Overwrite referenced texture in storages with the pooled one
-					for (auto &storage_info : effect.module.storages)
-						if (storage_info.texture_name == texture.unique_name)
-							storage_info.texture_name  = existing_texture->unique_name;
-					// Overwrite referenced texture in render targets with the pooled one
-					for (auto &technique_info : effect.module.techniques)
-					{
-						for (auto &pass_info : technique_info.passes)
-						{
-							std::replace(std::begin(pass_info.render_target_names), std::end(pass_info.render_target_names),
-								texture.unique_name, existing_texture->unique_name);
-
-							for (auto &sampler_info : pass_info.samplers)
-								if (sampler_info.texture_name == texture.unique_name)
-									sampler_info.texture_name  = existing_texture->unique_name;
-							for (auto &storage_info : pass_info.storages)
-								if (storage_info.texture_name == texture.unique_name)
-									storage_info.texture_name  = existing_texture->unique_name;
-						}
-					}
-
-					if (std::find(existing_texture->shared.begin(), existing_texture->shared.end(), effect_index) == existing_texture->shared.end())
-						existing_texture->shared.push_back(effect_index);
-
-					existing_texture->render_target = true;
-					existing_texture->storage_access = true;
-					continue;
-				}
+			case reshadefx::type::t_int:
+				preset.get(effect_name, constant.name, constant.initializer_value.as_int);
+				break;
+			case reshadefx::type::t_bool:
+			case reshadefx::type::t_uint:
+				preset.get(effect_name, constant.name, constant.initializer_value.as_uint);
+				break;
+			case reshadefx::type::t_float:
+				preset.get(effect_name, constant.name, constant.initializer_value.as_float);
+				break;
 			}
 
-			if (!texture.semantic.empty() && (texture.semantic != "COLOR" && texture.semantic != "DEPTH"))
-				effect.errors += "warning: " + texture.unique_name + ": unknown semantic '" + texture.semantic + "'\n";
-
-			// This is the first effect using this texture
-			texture.shared.push_back(effect_index);
+			// Check if this is a split specialization constant and move data accordingly
+			if (constant.type.is_scalar() && constant.offset != 0)
+				constant.initializer_value.as_uint[0] = constant.initializer_value.as_uint[constant.offset];
 
-			_textures.push_back(std::move(texture));
+			append_spec_constant_definition(effect.preamble, constant);
 		}
+	}
 
-		for (technique technique : effect.module.techniques)
-		{
-			technique.effect_index = effect_index;
-
-			technique.hidden = technique.annotation_as_int("hidden") != 0;
-
-			if (technique.annotation_as_int("enabled"))
-				enable_technique(technique);
+	return true;
+}
+bool reshade::runtime::load_effect(const std::filesystem::path &source_file, const reshade::ini_file &preset, size_t effect_index, bool preprocess_required)
+{
+	effect &effect = _effects[effect_index];
 
-			_techniques.push_back(std::move(technique));
-		}
+	bool source_cached = false;
+	if (!build_effect(effect, source_file, preset, _preset_preprocessor_definitions, effect_index, preprocess_required, source_cached))
+	{
+		if (_reload_remaining_effects != 0 && _reload_remaining_effects != std::numeric_limits<size_t>::max())
+			_reload_remaining_effects--;
+		return false;
 	}
 
+	// Check before updating the remaining count below, since it is reset to zero after loading a single effect too
+	const bool is_loading_all = is_loading();
+
 	if (_reload_remaining_effects != 0 && _reload_remaining_effects != std::numeric_limits<size_t>::max())
 		_reload_remaining_effects--;
 	else
@@ -896,11 +1618,16 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 
 	if ( effect.compiled && (effect.preprocessed || source_cached))
 	{
-		if (effect.errors.empty())
-			LOG(INFO) << "Successfully loaded " << source_file << '.';
-		else
-			LOG(WARN) << "Successfully loaded " << source_file << " with warnings:\n" << effect.errors;
-		return true;
+		// Textures and techniques are only merged into the lists shared by all effects on the main thread, so that loader threads do not have to synchronize with each other
+		// While loading, 'update_and_render_effects' does this and activates the effect right away instead of waiting for the remaining ones (so this has to be the last access to the effect from this thread)
+		if (is_loading_all)
+		{
+			const std::lock_guard<std::mutex> lock(_reload_mutex);
+			_reload_loaded_effects.push_back(effect_index);
+			return true;
+		}
+
+		return merge_loaded_effect(effect_index);
 	}
 	else
 	{
@@ -913,16 +1640,199 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 		return false;
 	}
 }
-void reshade::runtime::load_effects()
+bool reshade::runtime::merge_loaded_effect(size_t effect_index)
 {
-	// Reload preprocessor definitions from current preset before compiling
-	_preset_preprocessor_definitions.clear();
-	ini_file &preset = ini_file::load_cache(_current_preset_path);
-	preset.get({}, "PreprocessorDefinitions", _preset_preprocessor_definitions);
+	effect &effect = _effects[effect_index];
+
+	for (texture texture : effect.module.textures)
+	{
+		texture.effect_index = effect_index;
+
+		// Try to share textures with the same name across effects
+		if (const auto existing_index_it = _texture_indices.find(texture.unique_name);
+			existing_index_it != _texture_indices.end())
+		{
+			reshade::texture *const existing_texture = &_textures[existing_index_it->second];
+
+			// Cannot share texture if this is a normal one, but the existing one is a reference and vice versa
+			if (texture.semantic != existing_texture->semantic)
+			{
+				effect.errors += "error: " + texture.unique_name + ": another effect (";
+				effect.errors += _effects[existing_texture->effect_index].source_file.filename().u8string();
+				effect.errors += ") already created a texture with the same name but different semantic\n";
+				effect.compiled = false;
+				break;
+			}
+
+			if (texture.semantic.empty() && !existing_texture->matches_description(texture))
+			{
+				effect.errors += "warning: " + texture.unique_name + ": another effect (";
+				effect.errors += _effects[existing_texture->effect_index].source_file.filename().u8string();
+				effect.errors += ") already created a texture with the same name but different dimensions\n";
+			}
+			if (texture.semantic.empty() && (existing_texture->source != texture.source))
+			{
+				effect.errors += "warning: " + texture.unique_name + ": another effect (";
+				effect.errors += _effects[existing_texture->effect_index].source_file.filename().u8string();
+				effect.errors += ") already created a texture with a different image file\n";
+			}
+
+			if (existing_texture->semantic == "COLOR" && _color_bit_depth != 8)
+			{
+				for (const auto &sampler_info : effect.module.samplers)
+				{
+					if (sampler_info.srgb && sampler_info.texture_name == texture.unique_name)
+					{
+						effect.errors += "warning: " + sampler_info.unique_name + ": texture does not support sRGB sampling (back buffer format is not RGBA8)";
+					}
+				}
+			}
+
+			if (!existing_texture->transient_techniques.empty())
+			{
+				effect.errors += "warning: " + texture.unique_name + ": another effect (";
+				effect.errors += _effects[existing_texture->effect_index].source_file.filename().u8string();
+				effect.errors += ") created this texture without preserving its contents between techniques (reload all effects to share it)\n";
+			}
+
+			if (std::find(existing_texture->shared.begin(), existing_texture->shared.end(), effect_index) == existing_texture->shared.end())
+				existing_texture->shared.push_back(effect_index);
+
+			// Always make shared textures render targets, since they may be used as such in a different effect
+			existing_texture->render_target = true;
+			existing_texture->storage_access = true;
+			continue;
+		}
+
+		if (texture.pooled && texture.semantic.empty())
+		{
+			// Try to find another pooled texture to share with (and do not share within the same effect)
+			if (const auto existing_texture = std::find_if(_textures.begin(), _textures.end(),
+				[&texture](const auto &item) { return item.pooled && item.effect_index != texture.effect_index && item.matches_description(texture); });
+				existing_texture != _textures.end())
+			{
+				// Overwrite referenced texture in samplers with the pooled one
+				for (auto &sampler_info : effect.module.samplers)
+					if (sampler_info.texture_name == texture.unique_name)
+						sampler_info.texture_name  = existing_texture->unique_name;
+				// Overwrite referenced texture in storages with the pooled one
+				for (auto &storage_info : effect.module.storages)
+					if (storage_info.texture_name == texture.unique_name)
+						storage_info.texture_name  = existing_texture->unique_name;
+				// Overwrite referenced texture in render targets with the pooled one
+				for (auto &technique_info : effect.module.techniques)
+				{
+					for (auto &pass_info : technique_info.passes)
+					{
+						std::replace(std::begin(pass_info.render_target_names), std::end(pass_info.render_target_names),
+							texture.unique_name, existing_texture->unique_name);
+
+						for (auto &sampler_info : pass_info.samplers)
+							if (sampler_info.texture_name == texture.unique_name)
+								sampler_info.texture_name  = existing_texture->unique_name;
+						for (auto &storage_info : pass_info.storages)
+							if (storage_info.texture_name == texture.unique_name)
+								storage_info.texture_name  = existing_texture->unique_name;
+					}
+				}
+
+				if (std::find(existing_texture->shared.begin(), existing_texture->shared.end(), effect_index) == existing_texture->shared.end())
+					existing_texture->shared.push_back(effect_index);
+
+				existing_texture->render_target = true;
+				existing_texture->storage_access = true;
+				continue;
+			}
+		}
+
+		if (!texture.semantic.empty() && (texture.semantic != "COLOR" && texture.semantic != "DEPTH"))
+			effect.errors += "warning: " + texture.unique_name + ": unknown semantic '" + texture.semantic + "'\n";
+
+		// This is the first effect using this texture
+		texture.shared.push_back(effect_index);
+
+		_texture_indices.emplace(texture.unique_name, _textures.size());
+		_textures.push_back(std::move(texture));
+	}
+
+	for (technique technique : effect.module.techniques)
+	{
+		technique.effect_index = effect_index;
+
+		technique.hidden = technique.annotation_as_int("hidden") != 0;
+		technique.always_enabled = technique.annotation_as_int("enabled") != 0;
+
+		// Skipping frames is only possible for techniques that render to textures, since the back buffer is overwritten by the application every frame
+		if (const int interval = technique.annotation_as_int("interval"); interval > 1)
+		{
+			if (std::any_of(technique.passes.begin(), technique.passes.end(),
+					[](const reshadefx::pass_info &pass_info) { return pass_info.cs_entry_point.empty() && pass_info.render_target_names[0].empty(); }))
+				effect.errors += "warning: " + technique.name + ": technique renders to the back buffer and therefore ignores the 'interval' annotation\n";
+			else
+				technique.render_interval = static_cast<uint32_t>(interval);
+		}
+
+		technique.ui_label = technique.annotation_as_string("ui_label");
+		if (technique.ui_label.empty())
+			technique.ui_label = technique.name;
+		technique.ui_label += " [" + effect.source_file.filename().u8string() + ']';
+		technique.ui_tooltip = technique.annotation_as_string("ui_tooltip");
+
+		if (technique.always_enabled)
+			enable_technique(technique);
+
+		_techniques.push_back(std::move(technique));
+	}
+
+	if (effect.compiled)
+	{
+		if (effect.errors.empty())
+			LOG(INFO) << "Successfully loaded " << effect.source_file << '.';
+		else
+			LOG(WARN) << "Successfully loaded " << effect.source_file << " with warnings:\n" << effect.errors;
+		return true;
+	}
+	else
+	{
+		_last_reload_successfull = false;
+
+		LOG(ERROR) << "Failed to load " << effect.source_file << ":\n" << effect.errors;
+		return false;
+	}
+}
+void reshade::runtime::load_effects()
+{
+	// Start out with the configured render scale again, it is adjusted from there based on the GPU time budget (see 'update_effect_render_scale')
+	_current_effect_render_scale = std::clamp(_effect_render_scale, 0.1f, 1.0f);
+
+	// Reload preprocessor definitions from current preset before compiling
+	_preset_preprocessor_definitions.clear();
+	ini_file &preset = ini_file::load_cache(_current_preset_path);
+	preset.get({}, "PreprocessorDefinitions", _preset_preprocessor_definitions);
+
+	// Resolve search paths only once per reload and keep the contents of the directories they point to in memory, since walking them again for every effect and texture is slow on network shares
+	_resolved_effect_search_paths = resolve_search_paths(_effect_search_paths);
+	_resolved_texture_search_paths = resolve_search_paths(_texture_search_paths);
+	{
+		std::vector<std::filesystem::path> index_roots = _resolved_effect_search_paths;
+		index_roots.insert(index_roots.end(), _resolved_texture_search_paths.begin(), _resolved_texture_search_paths.end());
+		_search_path_index->set_roots(index_roots);
+		_search_path_index->update();
+	}
 
 	// Build a list of effect files by walking through the effect search paths
 	const std::vector<std::filesystem::path> effect_files =
-		find_files(_effect_search_paths, { L".fx" });
+		find_files(*_search_path_index, _resolved_effect_search_paths, { L".fx" });
+
+	// Watch search paths for changes, so that effects can be reloaded when any of the files they depend on is modified
+	if (_reload_effects_on_file_change)
+	{
+		_effect_watcher = std::make_unique<file_watcher>(_resolved_effect_search_paths);
+	}
+	else
+	{
+		_effect_watcher.reset();
+	}
 
 	if (effect_files.empty())
 		return; // No effect files found, so nothing more to do
@@ -930,60 +1840,237 @@ void reshade::runtime::load_effects()
 	// Have to be initialized at this point or else the threads spawned below will immediately exit without reducing the remaining effects count
 	assert(_is_initialized);
 
+	// Keep the worker threads out of the way of the application, since this is usually called on its render thread (via 'update_and_render_effects'), whose core can be avoided
+	_worker_pool.set_low_priority(_worker_low_priority);
+	if (!_worker_pool.set_processor_affinity(_worker_avoid_render_thread_core, _worker_prefer_efficiency_cores) && (_worker_avoid_render_thread_core || _worker_prefer_efficiency_cores))
+		LOG(WARN) << "Processor affinity of worker threads cannot be changed on this system.";
+	if (_worker_foreground_limit == 0)
+		_worker_pool.set_max_active_threads(0);
+
+	// Open the effect cache archive for the current renderer (or open it again in case the cache path changed)
+	if (!_no_effect_cache)
+	{
+		std::filesystem::path cache_path = g_reshade_base_path / _intermediate_cache_path;
+		cache_path /= L"reshade-effects-" + std::to_wstring(_renderer_id) + L".cache";
+
+		if (_effect_cache == nullptr || _effect_cache->path() != cache_path)
+		{
+			const std::lock_guard<std::mutex> lock(_shared_effect_cache->archive_mutex);
+
+			// Another runtime on the same device may have opened the archive already, in which case this one shares its entries (including those that were not written to disk yet)
+			if (_shared_effect_cache->archive == nullptr || _shared_effect_cache->archive->path() != cache_path)
+				_shared_effect_cache->archive = std::make_shared<cache_archive>(cache_path, static_cast<uint64_t>(_effect_cache_size_limit) * 1024 * 1024);
+
+			_effect_cache = _shared_effect_cache->archive;
+		}
+
+		if (!_machine_cache_path.empty())
+		{
+			cache_path = _machine_cache_path;
+			cache_path /= L"reshade-effects-" + std::to_wstring(_renderer_id) + L".cache";
+
+			if (_machine_effect_cache == nullptr || _machine_effect_cache->path() != cache_path)
+			{
+				const std::lock_guard<std::mutex> lock(_shared_effect_cache->archive_mutex);
+
+				if (std::error_code ec; !std::filesystem::is_directory(_machine_cache_path, ec) && !std::filesystem::create_directories(_machine_cache_path, ec))
+					LOG(ERROR) << "Failed to create machine-wide effect cache directory " << _machine_cache_path << " with error code " << ec.value() << '!';
+
+				if (_shared_effect_cache->machine_archive == nullptr || _shared_effect_cache->machine_archive->path() != cache_path)
+					_shared_effect_cache->machine_archive = std::make_shared<cache_archive>(cache_path, static_cast<uint64_t>(_machine_cache_size_limit) * 1024 * 1024);
+
+				_machine_effect_cache = _shared_effect_cache->machine_archive;
+			}
+		}
+		else
+		{
+			_machine_effect_cache.reset();
+		}
+	}
+
+	// D3D12 can consume DXIL, so compile to shader model 6 with the DirectX Shader Compiler if enabled (which has to be known before generating code)
+	// Otherwise effects keep being compiled to shader model 5.1 with the D3DCompiler library, which is also the fallback if loading the DirectX Shader Compiler fails
+	if ((_renderer_id & 0xF0000) == 0 && _renderer_id >= 0xc000 && _d3d12_dxil)
+		load_dxc_compiler();
+
 	// Allocate space for effects which are placed in this array during the 'load_effect' call
 	const size_t offset = _effects.size();
 	_effects.resize(offset + effect_files.size());
 	_reload_remaining_effects = effect_files.size();
 
-	// Now that we have a list of files, load them in parallel
-	// Split workload into batches instead of launching a thread for every file to avoid launch overhead and stutters due to too many threads being in flight
-	const size_t num_splits = std::min<size_t>(effect_files.size(), std::max<size_t>(std::thread::hardware_concurrency(), 2u) - 1);
+	_reload_active_effects.assign(_effects.size(), false);
+	std::fill_n(_reload_active_effects.begin(), offset, true);
 
-	// Keep track of the spawned threads, so the runtime cannot be destroyed while they are still running
-	for (size_t n = 0; n < num_splits; ++n)
-		// Create copy of preset instead of reference, so it stays valid even if 'ini_file::load_cache' is called while effects are still being loaded
-		_worker_threads.emplace_back([this, effect_files, offset, num_splits, n, preset]() {
+	// Create copy of preset instead of reference, so it stays valid even if 'ini_file::load_cache' is called while effects are still being loaded
+	const auto preset_copy = std::make_shared<const ini_file>(preset);
+
+	// Now that we have a list of files, load them in parallel
+	// Each file is a separate task, so that idle workers pick up the remaining files while another one is busy with a large effect
+	for (size_t i = 0; i < effect_files.size(); ++i)
+		_worker_pool.submit([this, source_file = effect_files[i], effect_index = offset + i, preset_copy]() {
 			// Abort loading when initialization state changes (indicating that 'on_reset' was called in the meantime)
-			for (size_t i = 0; i < effect_files.size() && _is_initialized; ++i)
-				if (i * num_splits / effect_files.size() == n)
-					load_effect(effect_files[i], preset, offset + i);
+			if (_is_initialized)
+				load_effect(source_file, *preset_copy, effect_index);
 		});
 }
 void reshade::runtime::load_textures()
 {
+	const load_phase_timer timer(_load_phase_durations_ns[static_cast<size_t>(benchmark_load_phase::textures)]);
+
 	_last_texture_reload_successfull = true;
 
+	// Textures may be loaded again after only a single effect was reloaded, so pick up changes to the search paths since the last full reload
+	_search_path_index->update();
+
 	LOG(INFO) << "Loading image files for textures ...";
 
+	// All image data is uploaded again below, so give textures that were still streaming in access to all their levels again
+	for (const texture_stream &stream : _texture_streams)
+		update_texture_views(_textures[_texture_indices.at(stream.texture_name)], 0);
+	_texture_streams.clear();
+
+	struct texture_load_job
+	{
+		texture *tex;
+		std::filesystem::path source_path;
+		api::format format;
+		std::vector<uint8_t> pixels;
+		std::vector<api::subresource_data> levels;
+		// Most detailed level that is uploaded right away, with the more detailed ones being streamed in over the next frames (see 'update_texture_streams')
+		uint32_t first_level = 0;
+		std::string error;
+		std::string shadow_copy_key;
+		std::filesystem::file_time_type modified_at;
+		// Image data comes from a shadow copy, so does not have to be decoded
+		bool from_shadow_copy = false;
+		// Path in the cache directory to write a block compressed copy of the decoded image to, for textures with the 'compress' annotation that do not have one yet
+		std::filesystem::path compressed_path;
+	};
+
+	std::vector<texture_load_job> jobs;
+
+	// D3D9 needs to load all textures again after every device reset, so keep their image data around in system memory (similar to what 'D3DPOOL_MANAGED' does)
+	const bool keep_shadow_copies = _renderer_id == 0x9000;
+	std::unordered_map<std::string, texture_shadow_copy> used_shadow_copies;
+
 	for (texture &texture : _textures)
 	{
 		if (texture.resource.handle == 0 || !texture.semantic.empty())
 			continue; // Ignore textures that are not created yet and those that are handled in the runtime implementation
 
-		std::filesystem::path source_path = std::filesystem::u8path(
-			texture.annotation_as_string("source"));
+		std::filesystem::path source_path = std::filesystem::u8path(texture.source);
 		// Ignore textures that have no image file attached to them (e.g. plain render targets)
 		if (source_path.empty())
 			continue;
 
 		// Search for image file using the provided search paths unless the path provided is already absolute
-		if (!find_file(_texture_search_paths, source_path))
+		if (!find_file(*_search_path_index, _resolved_texture_search_paths, source_path))
 		{
 			LOG(ERROR) << "Source " << source_path << " for texture '" << texture.unique_name << "' could not be found in any of the texture search paths!";
 			_last_texture_reload_successfull = false;
 			continue;
 		}
 
-		unsigned char *filedata = nullptr;
-		int width = 0, height = 0, channels = 0;
+		texture_load_job &job = jobs.emplace_back();
+		job.tex = &texture;
+		job.source_path = std::move(source_path);
+		// The resource format tells whether the texture was created to hold block compressed data (see 'init_texture')
+		job.format = _device->get_resource_desc(texture.resource).texture.format;
 
-		if (FILE *file; _wfopen_s(&file, source_path.c_str(), L"rb") == 0)
+		if (texture.compress && !_no_effect_cache && _renderer_id != 0x9000 && !texture.render_target && !texture.storage_access && find_compressed_texture_format(texture) != api::format::unknown && _wcsicmp(job.source_path.extension().c_str(), L".dds") != 0)
+		{
+			std::filesystem::path compressed_path = compressed_texture_cache_path(g_reshade_base_path / _intermediate_cache_path, job.source_path, texture);
+
+			// The texture was created with a block compressed format if 'init_texture' found a copy of the image from a previous load, so read that instead of the source image
+			if (is_block_compressed_format(job.format))
+				job.source_path = std::move(compressed_path);
+			else
+				job.compressed_path = std::move(compressed_path);
+		}
+
+		if (keep_shadow_copies)
+		{
+			std::error_code ec;
+			job.modified_at = std::filesystem::last_write_time(job.source_path, ec);
+			job.shadow_copy_key = job.source_path.u8string() + '|' + std::to_string(texture.width) + 'x' + std::to_string(texture.height) + '|' + std::to_string(static_cast<int>(texture.format)) + '|' + std::to_string(texture.levels);
+
+			// Reuse image data from a previous load if the file was not modified since
+			if (const auto it = _texture_shadow_copies.find(job.shadow_copy_key);
+				it != _texture_shadow_copies.end() && it->second.modified_at == job.modified_at)
+			{
+				job.from_shadow_copy = true;
+				job.levels = it->second.levels;
+				for (api::subresource_data &level : job.levels)
+					level.data = it->second.pixels.data() + reinterpret_cast<uintptr_t>(level.data);
+			}
+		}
+	}
+
+	// Block compressed images come with all their levels, so large ones can be rendered with only their smallest levels at first and the rest is uploaded over the next frames (with views clamped to what was uploaded so far)
+	// There is no need to keep those around for D3D9 device resets, since D3D9 does not load block compressed data as is
+	constexpr uint32_t min_streamed_level_size = 4 * 1024 * 1024;
+
+	// Decode all images in parallel, since that is what takes the most time here
+	_worker_pool.parallel_for(jobs.size(), [this, &jobs, keep_shadow_copies](size_t job_index) {
+		texture_load_job &job = jobs[job_index];
+		const texture &texture = *job.tex;
+
+		if (job.from_shadow_copy)
+			return;
+
+		std::vector<uint8_t> mem;
+		if (FILE *file; _wfopen_s(&file, job.source_path.c_str(), L"rb") == 0)
 		{
 			// Read texture data into memory in one go since that is faster than reading chunk by chunk
-			std::vector<uint8_t> mem(static_cast<size_t>(std::filesystem::file_size(source_path)));
-			fread(mem.data(), 1, mem.size(), file);
+			std::error_code ec;
+			mem.resize(static_cast<size_t>(std::filesystem::file_size(job.source_path, ec)));
+			mem.resize(fread(mem.data(), 1, mem.size(), file));
 			fclose(file);
+		}
+
+		if (is_block_compressed_format(job.format))
+		{
+			// Block compressed data can be uploaded straight from the file, one level after another
+			uint32_t width = 0, height = 0, levels = 0;
+			size_t data_offset = 0;
+			if (parse_dds_block_compressed_header(mem.data(), mem.size(), width, height, levels, data_offset) == api::format::unknown)
+			{
+				job.error = "could not be loaded! Make sure it is of a compatible file format.";
+				return;
+			}
+
+			std::vector<size_t> level_offsets;
+			for (uint32_t level = 0; level < texture.levels; ++level, width = std::max(1u, width / 2), height = std::max(1u, height / 2))
+			{
+				const uint32_t row_pitch = api::format_row_pitch(job.format, width);
+				const uint32_t slice_pitch = api::format_slice_pitch(job.format, row_pitch, height);
+				if (data_offset + slice_pitch > mem.size())
+				{
+					job.levels.clear(); // Failed jobs must not have any levels, since those would be laid out in the staging buffer
+					job.error = "is truncated!";
+					return;
+				}
+
+				level_offsets.push_back(data_offset);
+				job.levels.push_back({ nullptr, row_pitch, slice_pitch });
+				data_offset += slice_pitch;
+			}
+
+			job.pixels = std::move(mem);
+			for (size_t level = 0; level < job.levels.size(); ++level)
+				job.levels[level].data = job.pixels.data() + level_offsets[level];
 
+			if (!keep_shadow_copies)
+				while (job.first_level + 1 < job.levels.size() && job.levels[job.first_level].slice_pitch >= min_streamed_level_size)
+					job.first_level++;
+			return;
+		}
+
+		unsigned char *filedata = nullptr;
+		int width = 0, height = 0, channels = 0;
+
+		if (!mem.empty())
+		{
 			if (stbi_dds_test_memory(mem.data(), static_cast<int>(mem.size())))
 				filedata = stbi_dds_load_from_memory(mem.data(), static_cast<int>(mem.size()), &width, &height, &channels, STBI_rgb_alpha);
 			else
@@ -992,13 +2079,13 @@ void reshade::runtime::load_textures()
 
 		if (filedata == nullptr)
 		{
-			LOG(ERROR) << "Source " << source_path << " for texture '" << texture.unique_name << "' could not be loaded! Make sure it is of a compatible file format.";
-			_last_texture_reload_successfull = false;
-			continue;
+			job.error = "could not be loaded! Make sure it is of a compatible file format.";
+			return;
 		}
 
 		// Need to potentially resize image data to the texture dimensions
-		std::vector<uint8_t> resized(texture.width * texture.height * 4);
+		std::vector<uint8_t> &resized = job.pixels;
+		resized.resize(texture.width * texture.height * 4);
 		if (texture.width != uint32_t(width) || texture.height != uint32_t(height))
 		{
 			LOG(INFO) << "Resizing image data for texture '" << texture.unique_name << "' from " << width << "x" << height << " to " << texture.width << "x" << texture.height << " ...";
@@ -1012,6 +2099,36 @@ void reshade::runtime::load_textures()
 
 		stbi_image_free(filedata);
 
+		// Encode the block compressed copy in the background, so that it does not delay loading (it is only used the next time the texture is created)
+		if (!job.compressed_path.empty())
+		{
+			_worker_pool.submit([pixels = resized, width = texture.width, height = texture.height, levels = texture.levels, format = find_compressed_texture_format(texture), path = job.compressed_path, name = texture.unique_name]() {
+				std::vector<uint8_t> encoded;
+				if (!encode_bc_dds(pixels.data(), width, height, levels, format, encoded))
+					return;
+
+				// Write to a temporary file that is renamed afterwards, so that 'init_texture' never sees a partially written file
+				std::filesystem::path temp_path = path;
+				temp_path += L".tmp";
+
+				std::error_code ec;
+				if (FILE *file; _wfopen_s(&file, temp_path.c_str(), L"wb") == 0)
+				{
+					const bool written = fwrite(encoded.data(), 1, encoded.size(), file) == encoded.size();
+					fclose(file);
+
+					if (written)
+						std::filesystem::rename(temp_path, path, ec);
+					if (!written || ec)
+						std::filesystem::remove(temp_path, ec);
+					else
+						return;
+				}
+
+				LOG(WARN) << "Failed to write block compressed copy of texture '" << name << "' to " << path << '!';
+			});
+		}
+
 		// Collapse data to the correct number of components per pixel based on the texture format
 		uint32_t row_pitch = texture.width;
 		switch (texture.format)
@@ -1030,31 +2147,202 @@ void reshade::runtime::load_textures()
 			row_pitch *= 4;
 			break;
 		default:
-			LOG(ERROR) << "Texture upload is not supported for format " << static_cast<int>(texture.format) << " of texture '" << texture.unique_name << "'!";
-			continue;
+			job.error = "uses format " + std::to_string(static_cast<int>(texture.format)) + ", for which texture upload is not supported!";
+			return;
 		}
 
-		api::command_list *const cmd_list = _graphics_queue->get_immediate_command_list();
-		cmd_list->barrier(texture.resource, api::resource_usage::shader_resource, api::resource_usage::copy_dest);
-		_device->upload_texture_region({ resized.data(), row_pitch, row_pitch * texture.height }, texture.resource, 0);
-		cmd_list->barrier(texture.resource, api::resource_usage::copy_dest, api::resource_usage::shader_resource);
+		job.levels.push_back({ resized.data(), row_pitch, row_pitch * texture.height });
+	});
+
+	// D3D12 and Vulkan have to wait for every single upload to finish, so instead copy data of all textures into shared staging buffers and upload them all at once
+	const bool use_staging_buffer = (_renderer_id >= 0xc000 && _renderer_id < 0x10000) || _renderer_id >= 0x20000;
+	// Keep individual staging buffers reasonably small, so that loading many large textures does not fail to allocate
+	constexpr uint64_t max_staging_buffer_size = 64 * 1024 * 1024;
+	// D3D10/11 cannot copy from buffers to textures, so instead have the device fill an intermediate staging texture with the image data on creation (without going through the immediate context like 'UpdateSubresource' does) and copy from that
+	const bool use_staging_texture = _renderer_id > 0x9000 && _renderer_id < 0xc000;
+
+	api::command_list *const cmd_list = _graphics_queue->get_immediate_command_list();
+
+	for (size_t batch_begin = 0, batch_end; batch_begin < jobs.size(); batch_begin = batch_end)
+	{
+		// Lay out all levels of the textures in this batch in the staging buffer (D3D12 requires rows to be aligned to 256 bytes and levels to 512 bytes)
+		std::vector<uint64_t> staging_offsets;
+		uint64_t staging_size = 0;
+		for (batch_end = batch_begin; batch_end < jobs.size() && staging_size < max_staging_buffer_size; ++batch_end)
+		{
+			// Failed jobs are skipped during upload below without advancing through the staging offsets, so they must not take up any here either
+			if (!jobs[batch_end].error.empty())
+				continue;
+
+			for (size_t level_index = jobs[batch_end].first_level; level_index < jobs[batch_end].levels.size(); ++level_index)
+			{
+				const api::subresource_data &level = jobs[batch_end].levels[level_index];
+				const uint32_t row_pitch = _renderer_id < 0x10000 ? (level.row_pitch + 255) & ~255u : level.row_pitch;
+
+				staging_offsets.push_back(staging_size);
+				staging_size += (static_cast<uint64_t>(level.slice_pitch / level.row_pitch) * row_pitch + 511) & ~511ull;
+			}
+		}
+
+		api::resource staging = {};
+		uint8_t *staging_data = nullptr;
+		if (use_staging_buffer && staging_size != 0)
+		{
+			if (_device->create_resource(api::resource_desc(staging_size, api::memory_heap::cpu_to_gpu, api::resource_usage::copy_source), nullptr, api::resource_usage::cpu_access, &staging))
+			{
+				if (!_device->map_resource(staging, 0, api::map_access::write_only, reinterpret_cast<void **>(&staging_data)))
+				{
+					_device->destroy_resource(staging);
+					staging = {};
+				}
+			}
+
+			if (staging.handle == 0)
+				LOG(WARN) << "Failed to create staging buffer for texture upload! Uploading textures one by one instead.";
+		}
+
+		for (size_t job_index = batch_begin, level_index = 0; job_index < batch_end; ++job_index)
+		{
+			texture_load_job &job = jobs[job_index];
+			texture &texture = *job.tex;
+
+			if (!job.error.empty())
+			{
+				LOG(ERROR) << "Source " << job.source_path << " for texture '" << texture.unique_name << "' " << job.error;
+				_last_texture_reload_successfull = false;
+				continue;
+			}
+
+			cmd_list->barrier(texture.resource, api::resource_usage::shader_resource, api::resource_usage::copy_dest);
+
+			api::resource staging_texture = {};
+			if (use_staging_texture)
+			{
+				api::resource_desc staging_desc = _device->get_resource_desc(texture.resource);
+				staging_desc.texture.width = std::max(1u, staging_desc.texture.width >> job.first_level);
+				staging_desc.texture.height = std::max(1u, staging_desc.texture.height >> job.first_level);
+				staging_desc.texture.levels = static_cast<uint16_t>(job.levels.size() - job.first_level);
+				staging_desc.heap = api::memory_heap::cpu_only;
+				staging_desc.usage = api::resource_usage::copy_source;
+				staging_desc.flags = api::resource_flags::none;
+
+				if (!_device->create_resource(staging_desc, job.levels.data() + job.first_level, api::resource_usage::copy_source, &staging_texture))
+					staging_texture = {}; // Fall back to uploading every level separately below
+			}
+
+			for (uint32_t level = job.first_level; level < job.levels.size(); ++level, ++level_index)
+			{
+				const api::subresource_data &data = job.levels[level];
+
+				if (staging.handle != 0)
+				{
+					const uint32_t row_pitch = _renderer_id < 0x10000 ? (data.row_pitch + 255) & ~255u : data.row_pitch;
+					for (uint32_t y = 0; y < data.slice_pitch / data.row_pitch; ++y)
+						std::memcpy(staging_data + staging_offsets[level_index] + y * row_pitch, static_cast<const uint8_t *>(data.data) + y * data.row_pitch, data.row_pitch);
+
+					cmd_list->copy_buffer_to_texture(staging, staging_offsets[level_index], 0, 0, texture.resource, level);
+				}
+				else if (staging_texture.handle != 0)
+				{
+					cmd_list->copy_texture_region(staging_texture, level - job.first_level, nullptr, texture.resource, level, nullptr);
+				}
+				else
+				{
+					_device->upload_texture_region(data, texture.resource, level);
+				}
+			}
+
+			// The copy holds a reference to the staging texture until it is done, so it can be released right away
+			if (staging_texture.handle != 0)
+				_device->destroy_resource(staging_texture);
+
+			cmd_list->barrier(texture.resource, api::resource_usage::copy_dest, api::resource_usage::shader_resource);
+
+			// Block compressed textures contain all levels already
+			if (texture.levels > job.levels.size())
+				cmd_list->generate_mipmaps(texture.srv[0]);
+
+			if (job.first_level != 0)
+			{
+				if (update_texture_views(texture, job.first_level))
+				{
+					_texture_streams.push_back({ texture.resource, texture.unique_name, std::move(job.pixels), std::move(job.levels), job.first_level });
+				}
+				else
+				{
+					// Fall back to uploading the remaining levels right away if the views cannot be clamped
+					cmd_list->barrier(texture.resource, api::resource_usage::shader_resource, api::resource_usage::copy_dest);
+					for (uint32_t level = 0; level < job.first_level; ++level)
+						_device->upload_texture_region(job.levels[level], texture.resource, level);
+					cmd_list->barrier(texture.resource, api::resource_usage::copy_dest, api::resource_usage::shader_resource);
+				}
+			}
+
+			texture.loaded = true;
+
+			if (keep_shadow_copies)
+			{
+				if (job.from_shadow_copy)
+				{
+					// Moving the node keeps the image data in place, so that other textures using the same image can still reference it (in which case it was already moved)
+					if (const auto it = _texture_shadow_copies.find(job.shadow_copy_key); it != _texture_shadow_copies.end())
+						used_shadow_copies.insert(_texture_shadow_copies.extract(it));
+				}
+				else
+				{
+					texture_shadow_copy &shadow_copy = used_shadow_copies[job.shadow_copy_key];
+					shadow_copy.modified_at = job.modified_at;
+					shadow_copy.levels = job.levels;
+					for (api::subresource_data &level : shadow_copy.levels)
+						level.data = reinterpret_cast<void *>(static_cast<const uint8_t *>(level.data) - job.pixels.data());
+					shadow_copy.pixels = std::move(job.pixels);
+				}
+			}
+
+			// Free image data as soon as it is no longer needed
+			job.pixels = {};
+		}
+
+		if (staging.handle != 0)
+		{
+			_device->unmap_resource(staging, 0);
 
-		if (texture.levels > 1)
-			cmd_list->generate_mipmaps(texture.srv[0]);
+			// Wait for all copies to finish before the staging buffer can be destroyed
+			_graphics_queue->wait_idle();
 
-		texture.loaded = true;
+			_device->destroy_resource(staging);
+		}
 	}
 
+	// Drop shadow copies of images that none of the currently loaded textures use anymore
+	if (keep_shadow_copies)
+		_texture_shadow_copies = std::move(used_shadow_copies);
+
 	_textures_loaded = true;
 }
 
-bool reshade::runtime::init_effect(size_t effect_index)
+reshade::compiled_shaders reshade::runtime::compile_effect_shaders(const effect &effect)
 {
-	effect &effect = _effects[effect_index];
+	const load_phase_timer timer(_load_phase_durations_ns[static_cast<size_t>(benchmark_load_phase::compile)]);
 
-	// Compile shader modules
-	api::shader_format shader_format = _renderer_id & 0x10000 ? api::shader_format::glsl : _renderer_id & 0x20000 ? api::shader_format::spirv : api::shader_format::dxbc;
-	std::unordered_map<std::string, std::vector<char>> entry_points;
+	compiled_shaders result;
+
+	// HLSL entry points are collected in the loop below and compiled afterwards all at once
+	struct hlsl_compile_job
+	{
+		const reshadefx::entry_point *entry_point;
+		api::shader_stage type;
+		std::string profile;
+		UINT compile_flags;
+		size_t hash;
+		std::vector<char> *cso;
+		std::string *assembly;
+		std::string errors;
+		bool succeeded = false;
+	};
+
+	std::string hlsl;
+	std::vector<hlsl_compile_job> hlsl_compile_jobs;
 
 	for (const reshadefx::entry_point &entry_point : effect.module.entry_points)
 	{
@@ -1071,13 +2359,13 @@ bool reshade::runtime::init_effect(size_t effect_index)
 			type = api::shader_stage::compute;
 			if (!_device->check_capability(api::device_caps::compute_shader))
 			{
-				effect.errors += "Compute shaders are not supported in D3D9.";
-				return false;
+				result.errors += "Compute shaders are not supported in D3D9.";
+				return result;
 			}
 			break;
 		}
 
-		auto &cso = entry_points[entry_point.name];
+		auto &cso = result.entry_points[entry_point.name];
 
 		if (!effect.module.spirv.empty())
 		{
@@ -1085,82 +2373,17 @@ bool reshade::runtime::init_effect(size_t effect_index)
 
 			// There are various issues with SPIR-V modules that have multiple entry points on all major GPU vendors.
 			// On AMD for instance creating a graphics pipeline just fails with a generic VK_ERROR_OUT_OF_HOST_MEMORY. On NVIDIA artifacts occur on some driver versions.
-			// To work around these problems, create a separate shader module for every entry point and rewrite the SPIR-V module for each to removes all but a single entry point (and associated functions/variables).
-			uint32_t current_function = 0, current_function_offset = 0;
-			std::vector<uint32_t> spirv = effect.module.spirv;
-			std::vector<uint32_t> functions_to_remove, variables_to_remove;
+			// To work around these problems, use the separate module the code generator wrote for every entry point, which only contains that entry point (and associated functions/variables).
+			const std::vector<uint32_t> &spirv = entry_point.spirv;
+			assert(!spirv.empty());
 
-			for (uint32_t inst = 5 /* Skip SPIR-V header information */; inst < spirv.size();)
-			{
-				const uint32_t op = spirv[inst] & 0xFFFF;
-				const uint32_t len = (spirv[inst] >> 16) & 0xFFFF;
-				assert(len != 0);
-
-				switch (op)
-				{
-				case 15: // OpEntryPoint
-					// Look for any non-matching entry points
-					if (entry_point.name != reinterpret_cast<const char *>(&spirv[inst + 3]))
-					{
-						functions_to_remove.push_back(spirv[inst + 2]);
-
-						// Get interface variables
-						for (uint32_t k = inst + 3 + static_cast<uint32_t>((strlen(reinterpret_cast<const char *>(&spirv[inst + 3])) + 4) / 4); k < inst + len; ++k)
-							variables_to_remove.push_back(spirv[k]);
-
-						// Remove this entry point from the module
-						spirv.erase(spirv.begin() + inst, spirv.begin() + inst + len);
-						continue;
-					}
-					break;
-				case 16: // OpExecutionMode
-					if (std::find(functions_to_remove.begin(), functions_to_remove.end(), spirv[inst + 1]) != functions_to_remove.end())
-					{
-						spirv.erase(spirv.begin() + inst, spirv.begin() + inst + len);
-						continue;
-					}
-					break;
-				case 59: // OpVariable
-					// Remove all declarations of the interface variables for non-matching entry points
-					if (std::find(variables_to_remove.begin(), variables_to_remove.end(), spirv[inst + 2]) != variables_to_remove.end())
-					{
-						spirv.erase(spirv.begin() + inst, spirv.begin() + inst + len);
-						continue;
-					}
-					break;
-				case 71: // OpDecorate
-					// Remove all decorations targeting any of the interface variables for non-matching entry points
-					if (std::find(variables_to_remove.begin(), variables_to_remove.end(), spirv[inst + 1]) != variables_to_remove.end())
-					{
-						spirv.erase(spirv.begin() + inst, spirv.begin() + inst + len);
-						continue;
-					}
-					break;
-				case 54: // OpFunction
-					current_function = spirv[inst + 2];
-					current_function_offset = inst;
-					break;
-				case 56: // OpFunctionEnd
-					// Remove all function definitions for non-matching entry points
-					if (std::find(functions_to_remove.begin(), functions_to_remove.end(), current_function) != functions_to_remove.end())
-					{
-						spirv.erase(spirv.begin() + current_function_offset, spirv.begin() + inst + len);
-						inst = current_function_offset;
-						continue;
-					}
-					break;
-				}
-
-				inst += len;
-			}
-
-			cso.resize(spirv.size() * sizeof(uint32_t));
-			std::memcpy(cso.data(), spirv.data(), cso.size());
-		}
-		else if (_renderer_id & 0x10000)
-		{
-			std::string source = "#version 430\n";
-			source += "#define ENTRY_POINT_" + entry_point.name + " 1\n";
+			cso.resize(spirv.size() * sizeof(uint32_t));
+			std::memcpy(cso.data(), spirv.data(), cso.size());
+		}
+		else if (_renderer_id & 0x10000)
+		{
+			std::string source = "#version 430\n";
+			source += "#define ENTRY_POINT_" + entry_point.name + " 1\n";
 
 			if (type == api::shader_stage::vertex)
 			{
@@ -1191,128 +2414,283 @@ bool reshade::runtime::init_effect(size_t effect_index)
 
 			source += "#line 1 0\n"; // Reset line number, so it matches what is shown when viewing the generated code
 			source += effect.preamble;
-			source += effect.module.hlsl;
+			source += extract_entry_point_code(effect.module.hlsl, entry_point.name);
 
 			cso.resize(source.size());
 			std::memcpy(cso.data(), source.data(), cso.size());
 		}
 		else
 		{
-			if (_d3d_compiler == nullptr)
-				_d3d_compiler = LoadLibraryW(L"d3dcompiler_47.dll");
-			if (_d3d_compiler == nullptr)
-				_d3d_compiler = LoadLibraryW(L"d3dcompiler_43.dll");
-
-			if (_d3d_compiler == nullptr)
+			// Compiler library is loaded in 'update_and_render_effects' before any compilation is started
+			if (_d3d_compiler == nullptr && !uses_dxil_codegen())
 			{
 				LOG(ERROR) << "Unable to load HLSL compiler (\"d3dcompiler_47.dll\")!";
-				return false;
+				return result;
 			}
 
-			const auto D3DCompile = reinterpret_cast<pD3DCompile>(GetProcAddress(static_cast<HMODULE>(_d3d_compiler), "D3DCompile"));
-			const auto D3DDisassemble = reinterpret_cast<pD3DDisassemble>(GetProcAddress(static_cast<HMODULE>(_d3d_compiler), "D3DDisassemble"));
-
-			// Add specialization constant defines to source code
-			const std::string hlsl =
-				"#define COLOR_PIXEL_SIZE 1.0 / " + std::to_string(_width) + ", 1.0 / " + std::to_string(_height) + "\n"
-				"#define DEPTH_PIXEL_SIZE COLOR_PIXEL_SIZE\n"
-				"#define SV_DEPTH_PIXEL_SIZE DEPTH_PIXEL_SIZE\n"
-				"#define SV_TARGET_PIXEL_SIZE COLOR_PIXEL_SIZE\n"
-				"#line 1\n" + // Reset line number, so it matches what is shown when viewing the generated code
-				effect.preamble +
-				effect.module.hlsl;
+			// Only need to build the code once, since it is the same for all entry points
+			if (hlsl.empty())
+				hlsl = hlsl_compile_source(_width, _height, effect.preamble, effect.module.hlsl);
+
+			hlsl_compile_job &job = hlsl_compile_jobs.emplace_back();
+			job.entry_point = &entry_point;
+			job.type = type;
+			// The offline compiler ('tools/fxc.cpp') uses the same profile, flags and hash, so that the effect cache archives it builds are found here
+			job.profile = hlsl_profile(_renderer_id, entry_point.type, uses_dxil_codegen());
+			job.compile_flags = hlsl_compile_flags(_renderer_id, _performance_mode, !_no_debug_info, uses_dxil_codegen());
+			job.hash = hlsl_compile_hash(hlsl, entry_point.name, job.profile, job.compile_flags);
+			job.cso = &cso;
+			job.assembly = &result.assembly[entry_point.name]; // Insert all map entries up front, so that the compile tasks below do not modify the map concurrently
+			result.assembly_hashes[entry_point.name] = job.hash;
+		}
+	}
 
-			// Overwrite position semantic in pixel shaders
-			const D3D_SHADER_MACRO ps_defines[] = {
-				{ "POSITION", "VPOS" }, { nullptr, nullptr }
-			};
+	// Compile all HLSL entry points in parallel on the worker threads, since this is the most time consuming part of effect initialization
+	if (!hlsl_compile_jobs.empty())
+	{
+		_worker_pool.parallel_for(hlsl_compile_jobs.size(), [&](size_t job_index) {
+			hlsl_compile_job &job = hlsl_compile_jobs[job_index];
 
-			std::string profile;
-			switch (type)
+			if (load_effect_cache(effect.source_file, job.entry_point->name, job.hash, *job.cso, *job.assembly))
 			{
-			case api::shader_stage::vertex:
-				profile = "vs";
-				break;
-			case api::shader_stage::pixel:
-				profile = "ps";
-				break;
-			case api::shader_stage::compute:
-				profile = "cs";
-				break;
+				job.succeeded = true;
+				return;
 			}
 
-			switch (_renderer_id)
+			if (uses_dxil_codegen())
+				job.succeeded = compile_dxil(hlsl, "ENTRY_POINT_" + job.entry_point->name, job.entry_point->name, job.profile, job.compile_flags, *job.cso, *job.assembly, job.errors);
+			else
+				job.succeeded = compile_hlsl_dxbc(_d3d_compiler, hlsl, job.entry_point->name, job.entry_point->type, job.profile, job.compile_flags, *job.cso, *job.assembly, job.errors);
+
+			if (job.succeeded)
+				save_effect_cache(effect.source_file, job.entry_point->name, job.hash, *job.cso, *job.assembly);
+		});
+
+		// Append messages in entry point order, so that the output is the same regardless of which compile finished first
+		bool compile_succeeded = true;
+		for (const hlsl_compile_job &job : hlsl_compile_jobs)
+		{
+			result.errors += job.errors;
+
+			if (!job.succeeded)
 			{
-			default:
-			case D3D_FEATURE_LEVEL_11_0:
-				profile += "_5_0";
-				break;
-			case D3D_FEATURE_LEVEL_10_1:
-				profile += "_4_1";
-				break;
-			case D3D_FEATURE_LEVEL_10_0:
-				profile += "_4_0";
-				break;
-			case D3D_FEATURE_LEVEL_9_1:
-			case D3D_FEATURE_LEVEL_9_2:
-				profile += "_4_0_level_9_1";
-				break;
-			case D3D_FEATURE_LEVEL_9_3:
-				profile += "_4_0_level_9_3";
-				break;
-			case 0x9000:
-				profile += "_3_0";
-				break;
+				LOG(ERROR) << "Failed to compile shader module for effect file '" << effect.source_file << "' entry point '" << job.entry_point->name << "'!";
+				compile_succeeded = false;
 			}
+		}
 
-			UINT compile_flags = (_performance_mode ? D3DCOMPILE_OPTIMIZATION_LEVEL3 : D3DCOMPILE_OPTIMIZATION_LEVEL1);
-			if (_renderer_id >= D3D_FEATURE_LEVEL_10_0)
-				compile_flags |= D3DCOMPILE_ENABLE_STRICTNESS;
-#ifndef NDEBUG
-			compile_flags |= D3DCOMPILE_DEBUG;
-#endif
+		// No need to setup resources if any of the shaders failed to compile
+		if (!compile_succeeded)
+			return result;
+	}
 
-			std::string attributes;
-			attributes += "entrypoint=" + entry_point.name + ';';
-			attributes += "profile=" + profile + ';';
-			attributes += "flags=" + std::to_string(compile_flags) + ';';
+	result.succeeded = true;
+	return result;
+}
+bool reshade::runtime::load_dxc_compiler()
+{
+	if (_dxc_compiler != nullptr)
+		return true;
 
-			const size_t hash = std::hash<std::string_view>()(attributes) ^ std::hash<std::string_view>()(hlsl);
-			if (!load_effect_cache(effect.source_file, entry_point.name, hash, cso, effect.assembly[entry_point.name]))
-			{
-				com_ptr<ID3DBlob> d3d_compiled, d3d_errors;
-				const HRESULT hr = D3DCompile(
-					hlsl.data(), hlsl.size(),
-					nullptr, type == api::shader_stage::pixel ? ps_defines : nullptr, nullptr,
-					entry_point.name.c_str(),
-					profile.c_str(),
-					compile_flags, 0,
-					&d3d_compiled, &d3d_errors);
+	// Resolve relative to the ReShade directory and load dependencies (like "dxil.dll") from the same directory as the compiler
+	const std::filesystem::path path = g_reshade_base_path / _dxc_compiler_path;
+	_dxc_compiler = LoadLibraryExW(path.c_str(), nullptr, LOAD_WITH_ALTERED_SEARCH_PATH);
+	if (_dxc_compiler == nullptr)
+	{
+		LOG(WARN) << "Failed to load DirectX Shader Compiler from " << path << " with error code " << GetLastError() << ", falling back to shader model 5.1.";
+		return false;
+	}
+
+	return true;
+}
+bool reshade::runtime::compile_dxil(const std::string &hlsl, const std::string &entry_point_define, const std::string &entry_point, const std::string &profile, unsigned int compile_flags, std::vector<char> &cso, std::string &assembly, std::string &errors) const
+{
+	const auto DxcCreateInstance = reinterpret_cast<DxcCreateInstanceProc>(GetProcAddress(static_cast<HMODULE>(_dxc_compiler), "DxcCreateInstance"));
+	if (DxcCreateInstance == nullptr)
+		return false;
 
-				if (d3d_errors != nullptr) // Append warnings to the output error string as well
-					effect.errors.append(static_cast<const char *>(d3d_errors->GetBufferPointer()), d3d_errors->GetBufferSize() - 1); // Subtracting one to not append the null-terminator as well
+	// Compiler instances are not thread-safe, so create a separate one for every compilation
+	com_ptr<IDxcLibrary> library;
+	com_ptr<IDxcCompiler> compiler;
+	if (FAILED(DxcCreateInstance(CLSID_DxcLibrary, IID_PPV_ARGS(&library))) ||
+		FAILED(DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&compiler))))
+		return false;
 
-				// No need to setup resources if any of the shaders failed to compile
-				if (FAILED(hr))
-				{
-					LOG(ERROR) << "Failed to compile shader module for effect file '" << effect.source_file << "' entry point '" << entry_point.name << "'!";
-					return false;
-				}
+	com_ptr<IDxcBlobEncoding> source_blob;
+	if (FAILED(library->CreateBlobWithEncodingFromPinned(hlsl.data(), static_cast<UINT32>(hlsl.size()), CP_UTF8, &source_blob)))
+		return false;
+
+	// Entry point names and profiles are plain identifiers, so simply widen them
+	const std::wstring entry_point_w(entry_point.begin(), entry_point.end());
+	const std::wstring profile_w(profile.begin(), profile.end());
+	const std::wstring entry_point_define_w(entry_point_define.begin(), entry_point_define.end());
+
+	const DxcDefine defines[] = {
+		{ entry_point_define_w.c_str(), L"1" }
+	};
+
+	// Translate the flags used with 'D3DCompile' to the equivalent command-line arguments
+	std::vector<LPCWSTR> arguments;
+	arguments.push_back((compile_flags & D3DCOMPILE_OPTIMIZATION_LEVEL3) == D3DCOMPILE_OPTIMIZATION_LEVEL3 ? L"-O3" : L"-O1");
+	if (compile_flags & D3DCOMPILE_ENABLE_STRICTNESS)
+		arguments.push_back(L"-Ges");
+	if (compile_flags & D3DCOMPILE_DEBUG)
+		arguments.push_back(L"-Zi");
+
+	com_ptr<IDxcOperationResult> dxc_result;
+	if (FAILED(compiler->Compile(source_blob.get(), nullptr, entry_point_w.c_str(), profile_w.c_str(), arguments.data(), static_cast<UINT32>(arguments.size()), defines, static_cast<UINT32>(std::size(defines)), nullptr, &dxc_result)))
+		return false;
+
+	if (com_ptr<IDxcBlobEncoding> dxc_errors; SUCCEEDED(dxc_result->GetErrorBuffer(&dxc_errors)) && dxc_errors != nullptr && dxc_errors->GetBufferSize() != 0)
+		errors.assign(static_cast<const char *>(dxc_errors->GetBufferPointer()), strnlen(static_cast<const char *>(dxc_errors->GetBufferPointer()), dxc_errors->GetBufferSize()));
+
+	HRESULT hr = E_FAIL;
+	if (FAILED(dxc_result->GetStatus(&hr)) || FAILED(hr))
+		return false;
+
+	com_ptr<IDxcBlob> dxc_compiled;
+	if (FAILED(dxc_result->GetResult(&dxc_compiled)))
+		return false;
+
+	cso.resize(dxc_compiled->GetBufferSize());
+	std::memcpy(cso.data(), dxc_compiled->GetBufferPointer(), cso.size());
+
+	if (com_ptr<IDxcBlobEncoding> dxc_disassembled; SUCCEEDED(compiler->Disassemble(dxc_compiled.get(), &dxc_disassembled)))
+		assembly.assign(static_cast<const char *>(dxc_disassembled->GetBufferPointer()), strnlen(static_cast<const char *>(dxc_disassembled->GetBufferPointer()), dxc_disassembled->GetBufferSize()));
+
+	return true;
+}
+
+bool reshade::runtime::init_effect(size_t effect_index, compiled_shaders &shaders)
+{
+	const load_phase_timer timer(_load_phase_durations_ns[static_cast<size_t>(benchmark_load_phase::setup)]);
+
+	effect &effect = _effects[effect_index];
+
+	effect.errors += shaders.errors;
+	for (auto &[entry_point_name, assembly] : shaders.assembly)
+		effect.assembly[entry_point_name] = std::move(assembly);
+	for (const auto &[entry_point_name, hash] : shaders.assembly_hashes)
+		effect.assembly_hashes[entry_point_name] = hash;
+
+	if (!shaders.succeeded)
+		return false;
+
+	// Recorded commands of other effects may reference textures that are shared with this one and about to be recreated
+	destroy_technique_recordings();
+
+	// OpenGL takes either GLSL or SPIR-V, depending on which code generator was used for this effect
+	const api::shader_format shader_format = _renderer_id & 0x20000 ? api::shader_format::spirv : _renderer_id & 0x10000 ? (!effect.module.spirv.empty() ? api::shader_format::spirv : api::shader_format::glsl) : api::shader_format::dxbc;
+
+	// D3D12 and Vulkan devices are free-threaded, so pipelines are created on worker threads there instead of stalling the render thread (see 'update_pending_pipelines')
+	// The shader code and everything else the pipeline descriptions point to is moved into shared storage, which is kept alive until the last of these is created
+	const bool create_pipelines_async = (_renderer_id >= 0xc000 && _renderer_id < 0x10000) || _renderer_id >= 0x20000;
+	struct pipeline_creation_data
+	{
+		std::unordered_map<std::string, std::vector<char>> entry_points;
+		std::vector<uint32_t> spec_data;
+		std::vector<uint32_t> spec_constants;
+		std::deque<std::string> entry_point_names;
+	};
+	const auto creation_data = std::make_shared<pipeline_creation_data>();
+	creation_data->entry_points = std::move(shaders.entry_points);
+
+	const std::unordered_map<std::string, std::vector<char>> &entry_points = creation_data->entry_points;
+	std::atomic<uint64_t> &pipelines_duration = _load_phase_durations_ns[static_cast<size_t>(benchmark_load_phase::pipelines)];
+	const auto create_pipeline = [this, create_pipelines_async, &creation_data, &pipelines_duration](technique &tech, size_t pass_index, const api::pipeline_desc &desc) {
+		if (!create_pipelines_async)
+		{
+			const auto pipeline_started = std::chrono::high_resolution_clock::now();
+			const bool result = _device->create_pipeline(desc, &tech.passes_data[pass_index].pipeline);
+
+			// Count pipelines separately from the rest of the setup, even though they are created in the middle of it here
+			const uint64_t duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - pipeline_started).count();
+			pipelines_duration.fetch_add(duration_ns, std::memory_order_relaxed);
+			_load_phase_durations_ns[static_cast<size_t>(benchmark_load_phase::setup)].fetch_sub(duration_ns, std::memory_order_relaxed);
+			return result;
+		}
+
+		if (tech.pending_pipelines.empty())
+			tech.pending_pipelines.resize(tech.passes.size());
+
+		const auto task = std::make_shared<std::packaged_task<api::pipeline()>>([device = _device, desc, creation_data, &pipelines_duration]() {
+			const load_phase_timer timer(pipelines_duration);
+			api::pipeline pipeline = {};
+			device->create_pipeline(desc, &pipeline);
+			return pipeline;
+		});
+		tech.pending_pipelines[pass_index] = task->get_future();
+		_worker_pool.submit([task]() { (*task)(); });
+		return true;
+	};
+
+	// Build table of special variables that are updated every frame, with their annotations already decoded
+	effect.special_uniforms.clear();
+	for (size_t uniform_index = 0; uniform_index < effect.uniforms.size(); ++uniform_index)
+	{
+		const uniform &variable = effect.uniforms[uniform_index];
+		if (variable.special == special_uniform::none)
+			continue;
+
+		special_uniform_update update;
+		update.type = variable.special;
+		update.uniform_index = uniform_index;
 
-				cso.resize(d3d_compiled->GetBufferSize());
-				std::memcpy(cso.data(), d3d_compiled->GetBufferPointer(), cso.size());
+		switch (variable.special)
+		{
+			case special_uniform::random:
+			{
+				update.min_int = variable.annotation_as_int("min", 0, 0);
+				update.max_int = variable.annotation_as_int("max", 0, RAND_MAX);
+				break;
+			}
+			case special_uniform::ping_pong:
+			{
+				update.min = variable.annotation_as_float("min", 0, 0.0f);
+				update.max = variable.annotation_as_float("max", 0, 1.0f);
+				update.step[0] = variable.annotation_as_float("step", 0);
+				update.step[1] = variable.annotation_as_float("step", 1);
+				update.smoothing = variable.annotation_as_float("smoothing");
+				break;
+			}
+			case special_uniform::key:
+			case special_uniform::mouse_button:
+			{
+				update.keycode = variable.annotation_as_int("keycode");
 
-				if (com_ptr<ID3DBlob> d3d_disassembled; SUCCEEDED(D3DDisassemble(cso.data(), cso.size(), 0, nullptr, &d3d_disassembled)))
-					effect.assembly[entry_point.name].assign(static_cast<const char *>(d3d_disassembled->GetBufferPointer()), d3d_disassembled->GetBufferSize() - 1);
+				// Variables with an invalid key code are never updated, so do not need an entry
+				if (variable.special == special_uniform::key ? (update.keycode <= 7 || update.keycode >= 256) : (update.keycode < 0 || update.keycode >= 5))
+					continue;
 
-				save_effect_cache(effect.source_file, entry_point.name, hash, cso, effect.assembly[entry_point.name]);
+				if (const std::string_view mode = variable.annotation_as_string("mode");
+					mode == "toggle" || variable.annotation_as_int("toggle"))
+					update.mode = special_uniform_update::input_mode::toggle;
+				else if (mode == "press")
+					update.mode = special_uniform_update::input_mode::press;
+				break;
+			}
+			case special_uniform::mouse_wheel:
+			{
+				update.min = variable.annotation_as_float("min");
+				update.max = variable.annotation_as_float("max");
+				update.step[0] = variable.annotation_as_float("step");
+				if (update.step[0] == 0.0f)
+					update.step[0] = 1.0f;
+				break;
+			}
+			case special_uniform::freepie:
+			{
+				update.keycode = variable.annotation_as_int("index");
+				break;
 			}
 		}
+
+		effect.special_uniforms.push_back(update);
 	}
 
 	// Build specialization constants
-	std::vector<uint32_t> spec_data;
-	std::vector<uint32_t> spec_constants;
+	std::vector<uint32_t> &spec_data = creation_data->spec_data;
+	std::vector<uint32_t> &spec_constants = creation_data->spec_constants;
 	for (const reshadefx::uniform_info &constant : effect.module.spec_constants)
 	{
 		uint32_t id = static_cast<uint32_t>(spec_constants.size());
@@ -1320,24 +2698,34 @@ bool reshade::runtime::init_effect(size_t effect_index)
 		spec_constants.push_back(id);
 	}
 
-	// Create query pool for time measurements
-	if (!_device->create_query_pool(api::query_type::timestamp, static_cast<uint32_t>(effect.module.techniques.size() * 2 * 4), &effect.query_heap))
+	size_t total_passes = 0;
+	std::vector<api::descriptor_set_write> descriptor_writes;
+	for (const reshadefx::technique_info &info : effect.module.techniques)
+		total_passes += info.passes.size();
+
+	// Create query pool for time measurements (a time stamp before every technique and two for every pass, one after the back buffer copy and one after the pass itself, for each frame that can be in flight)
+	const uint32_t query_ring_depth = std::clamp(_gpu_statistics_latency, 2u, 16u);
+	if (!_device->create_query_pool(api::query_type::timestamp, static_cast<uint32_t>(effect.module.techniques.size() + total_passes * 2) * query_ring_depth, &effect.query_heap))
 	{
 		LOG(ERROR) << "Failed to create query pool for effect file '" << effect.source_file << "'!";
 		return false;
 	}
 
-	size_t total_passes = 0;
-	std::vector<api::descriptor_set_write> descriptor_writes;
-	for (const reshadefx::technique_info &info : effect.module.techniques)
-		total_passes += info.passes.size();
+	// Create query pool for pipeline statistics (a query around every technique, for each frame that can be in flight), which is optional since not all APIs support them
+	if (!_device->create_query_pool(api::query_type::pipeline_statistics, static_cast<uint32_t>(effect.module.techniques.size()) * query_ring_depth, &effect.statistics_query_heap))
+		effect.statistics_query_heap = {};
 
 	// Create global constant buffer (except in D3D9, which does not have constant buffers)
 	if (_renderer_id != 0x9000 && !effect.uniform_data_storage.empty())
 	{
+		// D3D12, OpenGL and Vulkan stream uniform data through the upload ring buffer of the queue into a buffer in video memory (see 'update_effect_constants')
+		const bool upload_through_ring = _renderer_id >= 0xc000;
+
 		if (!_device->create_resource(
-			api::resource_desc(effect.uniform_data_storage.size(), api::memory_heap::cpu_to_gpu, api::resource_usage::constant_buffer),
-			nullptr, api::resource_usage::cpu_access, &effect.cb))
+			upload_through_ring ?
+				api::resource_desc(effect.uniform_data_storage.size(), api::memory_heap::gpu_only, api::resource_usage::constant_buffer | api::resource_usage::copy_dest) :
+				api::resource_desc(effect.uniform_data_storage.size(), api::memory_heap::cpu_to_gpu, api::resource_usage::constant_buffer),
+			nullptr, upload_through_ring ? api::resource_usage::constant_buffer : api::resource_usage::cpu_access, &effect.cb))
 		{
 			LOG(ERROR) << "Failed to create constant buffer for effect file '" << effect.source_file << "'!";
 			return false;
@@ -1345,6 +2733,10 @@ bool reshade::runtime::init_effect(size_t effect_index)
 
 		_device->set_resource_name(effect.cb, "ReShade constant buffer");
 
+		// Contents of a new buffer are undefined, so upload all uniform data on first use
+		effect.uniform_data_dirty_begin = 0;
+		effect.uniform_data_dirty_end = effect.uniform_data_storage.size();
+
 		api::descriptor_range range;
 		range.binding = 0;
 		range.dx_shader_register = 0; // b0 (global constant buffer)
@@ -1373,8 +2765,6 @@ bool reshade::runtime::init_effect(size_t effect_index)
 	}
 
 	// Initialize sampler and storage bindings
-	std::vector<api::descriptor_set> texture_tables;
-	std::vector<api::descriptor_set> storage_tables;
 	const bool sampler_with_resource_view = _device->check_capability(api::device_caps::sampler_with_resource_view);
 
 	if (effect.module.num_sampler_bindings != 0)
@@ -1391,16 +2781,8 @@ bool reshade::runtime::init_effect(size_t effect_index)
 			return false;
 		}
 
-		if (sampler_with_resource_view)
-		{
-			texture_tables.resize(total_passes);
-			if (!_device->create_descriptor_sets(effect.set_layouts[1], static_cast<uint32_t>(total_passes), texture_tables.data()))
-			{
-				LOG(ERROR) << "Failed to create sampler descriptor set for effect file '" << effect.source_file << "'!";
-				return false;
-			}
-		}
-		else
+		// With combined sampler and resource view descriptors, the sets are created per unique pass binding below instead
+		if (!sampler_with_resource_view)
 		{
 			if (!_device->create_descriptor_sets(effect.set_layouts[1], 1, &effect.sampler_set))
 			{
@@ -1471,13 +2853,6 @@ bool reshade::runtime::init_effect(size_t effect_index)
 			LOG(ERROR) << "Failed to create texture descriptor set layout for effect file '" << effect.source_file << "'!";
 			return false;
 		}
-
-		texture_tables.resize(total_passes);
-		if (!_device->create_descriptor_sets(effect.set_layouts[2], static_cast<uint32_t>(total_passes), texture_tables.data()))
-		{
-			LOG(ERROR) << "Failed to create texture descriptor set for effect file '" << effect.source_file << "'!";
-			return false;
-		}
 	}
 
 	if (effect.module.num_storage_bindings != 0)
@@ -1493,13 +2868,6 @@ bool reshade::runtime::init_effect(size_t effect_index)
 			LOG(ERROR) << "Failed to create storage descriptor set layout for effect file '" << effect.source_file << "'!";
 			return false;
 		}
-
-		storage_tables.resize(total_passes);
-		if (!_device->create_descriptor_sets(effect.set_layouts[sampler_with_resource_view ? 2 : 3], static_cast<uint32_t>(total_passes), storage_tables.data()))
-		{
-			LOG(ERROR) << "Failed to create storage descriptor set for effect file '" << effect.source_file << "'!";
-			return false;
-		}
 	}
 
 	// Initialize pipeline layout
@@ -1509,8 +2877,56 @@ bool reshade::runtime::init_effect(size_t effect_index)
 		return false;
 	}
 
-	uint32_t technique_index = 0;
-	uint32_t total_pass_index = 0;
+	// Passes often bind exactly the same resources (e.g. when a technique ping-pongs between the same textures), so share descriptor sets between those
+	struct unique_descriptor_set
+	{
+		api::descriptor_set set;
+		std::vector<api::descriptor_set_write> writes;
+		std::vector<std::string> semantics;
+	};
+	std::vector<unique_descriptor_set> unique_texture_sets;
+	std::vector<unique_descriptor_set> unique_storage_sets;
+
+	const auto find_or_create_descriptor_set = [this, &effect, &descriptor_writes](api::descriptor_set_layout layout, std::vector<unique_descriptor_set> &unique_sets, std::vector<api::descriptor_set> &owned_sets, std::vector<api::descriptor_set_write> &writes, std::vector<std::string> &semantics, api::descriptor_set &set) {
+		for (const unique_descriptor_set &existing : unique_sets)
+		{
+			// Textures bound to different semantics may currently point to the same view, but can be updated independently later, so cannot share a set
+			if (existing.semantics == semantics &&
+				std::equal(existing.writes.begin(), existing.writes.end(), writes.begin(), writes.end(),
+					[](const api::descriptor_set_write &lhs, const api::descriptor_set_write &rhs) {
+						return lhs.binding == rhs.binding && lhs.type == rhs.type && lhs.descriptor.view == rhs.descriptor.view && lhs.descriptor.sampler == rhs.descriptor.sampler;
+					}))
+			{
+				set = existing.set;
+				return true;
+			}
+		}
+
+		if (!_device->create_descriptor_sets(layout, 1, &set))
+			return false;
+
+		owned_sets.push_back(set);
+
+		for (size_t i = 0; i < writes.size(); ++i)
+		{
+			writes[i].set = set;
+
+			// Keep track of the texture descriptor to simplify updating it
+			if (!semantics[i].empty())
+				effect.texture_semantic_to_binding[semantics[i]].push_back({ set, writes[i].binding, writes[i].descriptor.sampler });
+		}
+
+		// Keep track of all texture descriptors, so that sets can be updated when a semantic binding changes or a texture view is replaced during streaming
+		if (&owned_sets == &effect.texture_sets)
+			effect.texture_set_writes.emplace(set.handle, writes);
+
+		descriptor_writes.insert(descriptor_writes.end(), writes.begin(), writes.end());
+		unique_sets.push_back({ set, std::move(writes), std::move(semantics) });
+		return true;
+	};
+
+	uint32_t query_base_index = 0;
+	uint32_t statistics_query_base_index = 0;
 	for (technique &tech : _techniques)
 	{
 		if (!tech.passes_data.empty() || tech.effect_index != effect_index)
@@ -1518,10 +2934,31 @@ bool reshade::runtime::init_effect(size_t effect_index)
 
 		tech.passes_data.resize(tech.passes.size());
 
-		// Offset index so that a query exists for each command frame and two subsequent ones are used for before/after stamps
-		tech.query_base_index = technique_index++ * 2 * 4;
+		// Driver may still be building pipelines in the background after they were created, so wait for that before rendering (see 'update_pending_pipelines')
+		tech.pipelines_pending = true;
+
+		tech.queries = {};
+		tech.queries.base_index = query_base_index;
+		tech.queries.set_size = static_cast<uint32_t>(tech.passes.size() * 2 + 1);
+		tech.queries.depth = query_ring_depth;
+		query_base_index += tech.queries.num_queries();
+		tech.queries.statistics_base_index = statistics_query_base_index;
+		statistics_query_base_index += query_ring_depth;
+
+		tech.async_compute = true;
 
-		for (size_t pass_index = 0; pass_index < tech.passes.size(); ++pass_index, ++total_pass_index)
+		std::fill_n(tech.vs_constant_registers, 2, 0u);
+		std::fill_n(tech.ps_constant_registers, 2, 0u);
+
+		// Techniques that make use of the stencil buffer themselves are never masked, since the mask would interfere with their stencil values
+		const bool uses_stencil = std::any_of(tech.passes.begin(), tech.passes.end(), [](const reshadefx::pass_info &pass_info) { return pass_info.stencil_enable; });
+		const bool mask_hidden_area = !_hidden_area_vertices.empty() && !uses_stencil;
+		// Depth-based techniques can opt into skipping tiles that only contain sky, which add-ons determine from the depth buffer
+		const bool mask_sky = tech.annotation_as_int("mask_sky") != 0 && !uses_stencil;
+
+		tech.sky_masked = false;
+
+		for (size_t pass_index = 0; pass_index < tech.passes.size(); ++pass_index)
 		{
 			reshadefx::pass_info &pass_info = tech.passes[pass_index];
 			technique::pass_data &pass_data = tech.passes_data[pass_index];
@@ -1537,13 +2974,13 @@ bool reshade::runtime::init_effect(size_t effect_index)
 				desc.compute.shader.format = shader_format;
 				if (shader_format == api::shader_format::spirv)
 				{
-					desc.compute.shader.entry_point = pass_info.cs_entry_point.c_str();
+					desc.compute.shader.entry_point = creation_data->entry_point_names.emplace_back(pass_info.cs_entry_point).c_str();
 					desc.compute.shader.num_spec_constants = static_cast<uint32_t>(effect.module.spec_constants.size());
 					desc.compute.shader.spec_constant_ids = spec_constants.data();
 					desc.compute.shader.spec_constant_values = spec_data.data();
 				}
 
-				if (!_device->create_pipeline(desc, &pass_data.pipeline))
+				if (!create_pipeline(tech, pass_index, desc))
 				{
 					LOG(ERROR) << "Failed to create compute pipeline for pass " << pass_index << " in technique '" << tech.name << "'!";
 					return false;
@@ -1551,6 +2988,8 @@ bool reshade::runtime::init_effect(size_t effect_index)
 			}
 			else
 			{
+				tech.async_compute = false;
+
 				api::pipeline_desc desc = { api::pipeline_stage::all_graphics };
 				desc.layout = effect.layout;
 
@@ -1560,7 +2999,7 @@ bool reshade::runtime::init_effect(size_t effect_index)
 				desc.graphics.vertex_shader.format = shader_format;
 				if (shader_format == api::shader_format::spirv)
 				{
-					desc.graphics.vertex_shader.entry_point = pass_info.vs_entry_point.c_str();
+					desc.graphics.vertex_shader.entry_point = creation_data->entry_point_names.emplace_back(pass_info.vs_entry_point).c_str();
 					desc.graphics.vertex_shader.num_spec_constants = static_cast<uint32_t>(effect.module.spec_constants.size());
 					desc.graphics.vertex_shader.spec_constant_ids = spec_constants.data();
 					desc.graphics.vertex_shader.spec_constant_values = spec_data.data();
@@ -1572,12 +3011,19 @@ bool reshade::runtime::init_effect(size_t effect_index)
 				desc.graphics.pixel_shader.format = shader_format;
 				if (shader_format == api::shader_format::spirv)
 				{
-					desc.graphics.pixel_shader.entry_point = pass_info.ps_entry_point.c_str();
+					desc.graphics.pixel_shader.entry_point = creation_data->entry_point_names.emplace_back(pass_info.ps_entry_point).c_str();
 					desc.graphics.pixel_shader.num_spec_constants = static_cast<uint32_t>(effect.module.spec_constants.size());
 					desc.graphics.pixel_shader.spec_constant_ids = spec_constants.data();
 					desc.graphics.pixel_shader.spec_constant_values = spec_data.data();
 				}
 
+				if (_renderer_id == 0x9000)
+				{
+					const uint32_t num_registers = static_cast<uint32_t>(effect.uniform_data_storage.size() / 16);
+					merge_d3d9_constant_registers(vs, num_registers, tech.vs_constant_registers);
+					merge_d3d9_constant_registers(ps, num_registers, tech.ps_constant_registers);
+				}
+
 				desc.graphics.viewport_count = 1;
 
 				if (pass_info.render_target_names[0].empty())
@@ -1592,7 +3038,7 @@ bool reshade::runtime::init_effect(size_t effect_index)
 					api::render_pass_desc pass_desc = {};
 
 					// Only need to attach stencil if stencil is actually used in this pass
-					if (pass_info.stencil_enable &&
+					if ((pass_info.stencil_enable || mask_sky) &&
 						pass_info.viewport_width == _width &&
 						pass_info.viewport_height == _height)
 					{
@@ -1607,7 +3053,10 @@ bool reshade::runtime::init_effect(size_t effect_index)
 						pass_data.modified_resources.push_back(texture.resource);
 
 						if (texture.levels > 1)
+						{
 							pass_data.generate_mipmap_views.push_back(texture.srv[pass_info.srgb_write_enable]);
+							pass_data.generate_mipmap_resources.push_back(texture.resource);
+						}
 
 						const api::resource_desc res_desc = _device->get_resource_desc(texture.resource);
 
@@ -1690,6 +3139,14 @@ bool reshade::runtime::init_effect(size_t effect_index)
 				rasterizer_state.fill_mode = api::fill_mode::solid;
 				rasterizer_state.cull_mode = api::cull_mode::none;
 				rasterizer_state.depth_clip_enable = true;
+				rasterizer_state.scissor_enable = !pass_info.scissor_rect_uniform.empty();
+
+				// Coarse shading is only a hint, so passes asking for it are rendered at full rate where the device does not support it
+				if (pass_info.shading_rate != 0 && _device->check_capability(api::device_caps::shading_rate))
+				{
+					desc.graphics.dynamic_states[0] = api::dynamic_state::shading_rate;
+					pass_data.coarse_shading = true;
+				}
 
 				const auto convert_stencil_op = [](reshadefx::pass_stencil_op value) {
 					switch (value) {
@@ -1735,7 +3192,31 @@ bool reshade::runtime::init_effect(size_t effect_index)
 				depth_stencil_state.front_stencil_pass_op = depth_stencil_state.back_stencil_pass_op;
 				depth_stencil_state.front_stencil_func = depth_stencil_state.back_stencil_func;
 
-				if (!_device->create_pipeline(desc, &pass_data.pipeline))
+				// Skip pixels in the hidden area of the back buffer, which were marked in the stencil buffer before the first pass of the technique (see 'render_technique')
+				if (mask_hidden_area && pass_info.render_target_names[0].empty())
+					pass_data.hidden_area_masked = true;
+				// Sky tiles can be skipped in any pass that is rendered at the back buffer resolution, since the stencil buffer matches it
+				if (mask_sky && pass_info.viewport_width == _width && pass_info.viewport_height == _height)
+					pass_data.sky_masked = tech.sky_masked = true;
+
+				if (pass_data.hidden_area_masked || pass_data.sky_masked)
+				{
+					depth_stencil_state.stencil_enable = true;
+					// Hidden area and sky tiles are marked with separate bits, so that each pass only tests the ones it is masked by
+					depth_stencil_state.stencil_read_mask = (pass_data.hidden_area_masked ? 0x1 : 0x0) | (pass_data.sky_masked ? 0x2 : 0x0);
+					depth_stencil_state.stencil_write_mask = 0x0;
+					depth_stencil_state.stencil_reference_value = 0x0;
+					depth_stencil_state.back_stencil_fail_op = api::stencil_op::keep;
+					depth_stencil_state.back_stencil_depth_fail_op = api::stencil_op::keep;
+					depth_stencil_state.back_stencil_pass_op = api::stencil_op::keep;
+					depth_stencil_state.back_stencil_func = api::compare_op::equal;
+					depth_stencil_state.front_stencil_fail_op = depth_stencil_state.back_stencil_fail_op;
+					depth_stencil_state.front_stencil_depth_fail_op = depth_stencil_state.back_stencil_depth_fail_op;
+					depth_stencil_state.front_stencil_pass_op = depth_stencil_state.back_stencil_pass_op;
+					depth_stencil_state.front_stencil_func = depth_stencil_state.back_stencil_func;
+				}
+
+				if (!create_pipeline(tech, pass_index, desc))
 				{
 					LOG(ERROR) << "Failed to create graphics pipeline for pass " << pass_index << " in technique '" << tech.name << "'!";
 					return false;
@@ -1744,12 +3225,13 @@ bool reshade::runtime::init_effect(size_t effect_index)
 
 			if (effect.module.num_sampler_bindings != 0)
 			{
-				pass_data.texture_set = texture_tables[total_pass_index];
+				std::vector<api::descriptor_set_write> pass_writes;
+				std::vector<std::string> pass_semantics;
 
 				for (const reshadefx::sampler_info &info : pass_info.samplers)
 				{
-					api::descriptor_set_write &write = descriptor_writes.emplace_back();
-					write.set = pass_data.texture_set;
+					api::descriptor_set_write &write = pass_writes.emplace_back();
+					std::string &semantic = pass_semantics.emplace_back();
 
 					if (sampler_with_resource_view)
 					{
@@ -1799,6 +3281,8 @@ bool reshade::runtime::init_effect(size_t effect_index)
 					if (texture.semantic == "COLOR")
 					{
 						write.descriptor.view = _backbuffer_texture_view[info.srgb];
+
+						pass_data.samples_backbuffer = true;
 					}
 					else if (!texture.semantic.empty())
 					{
@@ -1808,26 +3292,37 @@ bool reshade::runtime::init_effect(size_t effect_index)
 						else
 							write.descriptor.view = _empty_texture_view;
 
-						// Keep track of the texture descriptor to simplify updating it
-						effect.texture_semantic_to_binding.push_back({ texture.semantic, write.set, write.binding, write.descriptor.sampler });
+						semantic = texture.semantic;
+
+						// Resources bound to semantics are owned by someone else, so their state cannot be managed across queues
+						tech.async_compute = false;
 					}
 					else
 					{
 						write.descriptor.view = texture.srv[info.srgb];
+
+						pass_data.sampled_resources.push_back(texture.resource);
 					}
 
 					assert(write.descriptor.view.handle != 0);
 				}
+
+				if (!find_or_create_descriptor_set(effect.set_layouts[sampler_with_resource_view ? 1 : 2], unique_texture_sets, effect.texture_sets, pass_writes, pass_semantics, pass_data.texture_set))
+				{
+					LOG(ERROR) << "Failed to create texture descriptor set for effect file '" << effect.source_file << "'!";
+					return false;
+				}
 			}
 
 			if (effect.module.num_storage_bindings != 0)
 			{
-				pass_data.storage_set = storage_tables[total_pass_index];
+				std::vector<api::descriptor_set_write> pass_writes;
+				std::vector<std::string> pass_semantics;
 
 				for (const reshadefx::storage_info &info : pass_info.storages)
 				{
-					api::descriptor_set_write &write = descriptor_writes.emplace_back();
-					write.set = pass_data.storage_set;
+					api::descriptor_set_write &write = pass_writes.emplace_back();
+					pass_semantics.emplace_back();
 					write.binding = info.binding;
 					write.type = api::descriptor_type::unordered_access_view;
 
@@ -1840,11 +3335,47 @@ bool reshade::runtime::init_effect(size_t effect_index)
 						pass_data.modified_resources.push_back(texture.resource);
 
 						if (texture.levels > 1)
+						{
 							pass_data.generate_mipmap_views.push_back(texture.srv[0]);
+							pass_data.generate_mipmap_resources.push_back(texture.resource);
+						}
 					}
 
 					assert(write.descriptor.view.handle != 0);
 				}
+
+				if (!find_or_create_descriptor_set(effect.set_layouts[sampler_with_resource_view ? 2 : 3], unique_storage_sets, effect.storage_sets, pass_writes, pass_semantics, pass_data.storage_set))
+				{
+					LOG(ERROR) << "Failed to create storage descriptor set for effect file '" << effect.source_file << "'!";
+					return false;
+				}
+			}
+
+			// Generating mipmaps is done on the graphics queue
+			if (!pass_data.generate_mipmap_views.empty())
+				tech.async_compute = false;
+
+			// Bake the arguments of the commands issued for this pass, so that 'render_technique' does not have to compute or allocate them again every frame
+			const bool is_compute_pass = !pass_info.cs_entry_point.empty();
+			pass_data.shader_resource_states.assign(pass_data.modified_resources.size(), api::resource_usage::shader_resource);
+			pass_data.shader_resource_non_pixel_states.assign(is_compute_pass ? pass_data.modified_resources.size() : 0, api::resource_usage::shader_resource_non_pixel);
+			pass_data.target_states.assign(pass_data.modified_resources.size(), is_compute_pass ? api::resource_usage::unordered_access : api::resource_usage::render_target);
+
+			pass_data.texture_set_index = sampler_with_resource_view ? 1 : 2;
+			pass_data.storage_set_index = sampler_with_resource_view ? 2 : 3;
+
+			pass_data.viewport[2] = static_cast<float>(pass_info.viewport_width);
+			pass_data.viewport[3] = static_cast<float>(pass_info.viewport_height);
+			pass_data.scissor_rect[2] = static_cast<int32_t>(pass_info.viewport_width);
+			pass_data.scissor_rect[3] = static_cast<int32_t>(pass_info.viewport_height);
+
+			// The scissor rectangle of region-limited passes is read from the uniform every frame in 'update_render_graph'
+			if (!pass_info.scissor_rect_uniform.empty())
+			{
+				const auto it = std::find_if(effect.uniforms.begin(), effect.uniforms.end(),
+					[&pass_info](const uniform &variable) { return variable.name == pass_info.scissor_rect_uniform; });
+				if (it != effect.uniforms.end())
+					pass_data.scissor_uniform_index = std::distance(effect.uniforms.begin(), it);
 			}
 		}
 	}
@@ -1909,6 +3440,46 @@ bool reshade::runtime::init_texture(texture &tex)
 	if (view_format == api::format::unknown)
 		view_format_srgb = view_format = format;
 
+	// Keep block compressed image data as is instead of decompressing it in 'load_textures', which saves memory and upload time (D3D9 uploads do not handle block compressed data)
+	// Textures with the 'compress' annotation use the block compressed copy of their image that a previous call to 'load_textures' wrote to the cache directory, if there is one
+	bool block_compressed = false;
+	if (std::filesystem::path source_path = std::filesystem::u8path(tex.source);
+		_renderer_id != 0x9000 && !tex.render_target && !tex.storage_access && !source_path.empty() &&
+		(_wcsicmp(source_path.extension().c_str(), L".dds") == 0 || (tex.compress && !_no_effect_cache && find_compressed_texture_format(tex) != api::format::unknown)) &&
+		find_file(*_search_path_index, _resolved_texture_search_paths, source_path))
+	{
+		if (_wcsicmp(source_path.extension().c_str(), L".dds") != 0)
+			source_path = compressed_texture_cache_path(g_reshade_base_path / _intermediate_cache_path, source_path, tex);
+
+		if (FILE *file; _wfopen_s(&file, source_path.c_str(), L"rb") == 0)
+		{
+			uint8_t header[148] = {};
+			const size_t header_size = fread(header, 1, sizeof(header), file);
+			fclose(file);
+
+			uint32_t width = 0, height = 0, levels = 0;
+			size_t data_offset = 0;
+			// Mipmaps cannot be generated for block compressed textures, so the file has to contain all of them
+			if (const api::format block_format = parse_dds_block_compressed_header(header, header_size, width, height, levels, data_offset);
+				block_format != api::format::unknown && is_compatible_block_compressed_format(tex.format, block_format) && width == tex.width && height == tex.height && levels >= tex.levels)
+			{
+				block_compressed = true;
+
+				format = api::format_to_typeless(block_format);
+				if (format == api::format::bc4_typeless || format == api::format::bc5_typeless || format == api::format::bc6h_typeless)
+				{
+					// These formats have no sRGB variant, so use them unchanged (to not lose whether they are signed)
+					view_format_srgb = view_format = format = block_format;
+				}
+				else
+				{
+					view_format = api::format_to_default_typed(format, 0);
+					view_format_srgb = api::format_to_default_typed(format, 1);
+				}
+			}
+		}
+	}
+
 	api::resource_usage usage = api::resource_usage::shader_resource;
 	if (tex.semantic.empty())
 		usage |= api::resource_usage::copy_dest; // For texture data upload
@@ -1918,26 +3489,63 @@ bool reshade::runtime::init_texture(texture &tex)
 		usage |= api::resource_usage::unordered_access;
 
 	api::resource_flags flags = api::resource_flags::none;
-	if (tex.levels > 1)
+	if (tex.levels > 1 && !block_compressed)
 		flags |= api::resource_flags::generate_mipmaps;
 
-	// Clear texture to zero since by default its contents are undefined
-	std::vector<uint8_t> zero_data(tex.width * tex.height * 16);
-	std::vector<api::subresource_data> initial_data(tex.levels);
-	for (uint32_t level = 0, width = tex.width; level < tex.levels; ++level, width /= 2)
-	{
-		initial_data[level].data = zero_data.data();
-		initial_data[level].row_pitch = width * 16;
-	}
+	// Textures whose contents are not preserved outside of a technique can share memory with those of other techniques (including ones of other effects), since techniques are executed one after another
+	tex.transient_techniques.clear();
+	if (_alias_transient_textures && tex.render_target && tex.shared.size() <= 1 && tex.effect_index < _effects.size() && tex.source.empty() && !tex.pooled)
+		find_transient_texture_techniques(_effects[tex.effect_index].module, tex.unique_name, tex.transient_techniques);
+
+	// The pool is keyed by the resource description, and a resource can be leased to any texture that is not accessed by a technique already using it
+	const auto aliased = tex.transient_techniques.empty() ? _aliased_resources.end() : std::find_if(_aliased_resources.begin(), _aliased_resources.end(),
+		[&tex](const aliased_resource &res) {
+			return res.width == tex.width && res.height == tex.height && res.levels == tex.levels && res.format == tex.format && res.storage_access == tex.storage_access &&
+				std::none_of(tex.transient_techniques.begin(), tex.transient_techniques.end(),
+					[&res, &tex](const std::string &technique_name) { return std::find(res.users.begin(), res.users.end(), std::make_pair(tex.effect_index, technique_name)) != res.users.end(); });
+		});
 
-	if (!_device->create_resource(api::resource_desc(tex.width, tex.height, 1, tex.levels, format, 1, api::memory_heap::gpu_only, usage, flags), initial_data.data(), api::resource_usage::shader_resource, &tex.resource))
+	if (aliased != _aliased_resources.end())
 	{
-		LOG(ERROR) << "Failed to create texture '" << tex.unique_name << "'!";
-		LOG(DEBUG) << "> Details: Width = " << tex.width << ", Height = " << tex.height << ", Levels = " << tex.levels << ", Format = " << static_cast<uint32_t>(format) << ", Usage = " << std::hex << static_cast<uint32_t>(usage) << std::dec;
-		return false;
+		tex.resource = aliased->resource;
+		for (const std::string &technique_name : tex.transient_techniques)
+			aliased->users.emplace_back(tex.effect_index, technique_name);
 	}
+	else
+	{
+		// Clear texture to zero since by default its contents are undefined
+		std::vector<uint8_t> zero_data(tex.width * tex.height * 16);
+		std::vector<api::subresource_data> initial_data(tex.levels);
+		for (uint32_t level = 0, width = tex.width; level < tex.levels; ++level, width /= 2)
+		{
+			initial_data[level].data = zero_data.data();
+			initial_data[level].row_pitch = width * 16;
+		}
+
+		if (!_device->create_resource(api::resource_desc(tex.width, tex.height, 1, tex.levels, format, 1, api::memory_heap::gpu_only, usage, flags), initial_data.data(), api::resource_usage::shader_resource, &tex.resource))
+		{
+			tex.transient_techniques.clear();
+
+			LOG(ERROR) << "Failed to create texture '" << tex.unique_name << "'!";
+			LOG(DEBUG) << "> Details: Width = " << tex.width << ", Height = " << tex.height << ", Levels = " << tex.levels << ", Format = " << static_cast<uint32_t>(format) << ", Usage = " << std::hex << static_cast<uint32_t>(usage) << std::dec;
+			return false;
+		}
 
-	_device->set_resource_name(tex.resource, tex.unique_name.c_str());
+		_device->set_resource_name(tex.resource, tex.unique_name.c_str());
+
+		if (!tex.transient_techniques.empty())
+		{
+			aliased_resource &res = _aliased_resources.emplace_back();
+			res.resource = tex.resource;
+			res.width = tex.width;
+			res.height = tex.height;
+			res.levels = tex.levels;
+			res.format = tex.format;
+			res.storage_access = tex.storage_access;
+			for (const std::string &technique_name : tex.transient_techniques)
+				res.users.emplace_back(tex.effect_index, technique_name);
+		}
+	}
 
 	// Always create shader resource views
 	{
@@ -1993,64 +3601,87 @@ bool reshade::runtime::init_texture(texture &tex)
 	return true;
 }
 
-void reshade::runtime::unload_effect(size_t effect_index)
+void reshade::runtime::uninit_effect(size_t effect_index)
 {
 	assert(effect_index < _effects.size());
 
-	// Make sure no effect resources are currently in use
-	_device->wait_idle();
+	destroy_technique_recordings();
+
+	const bool sampler_with_resource_view = _device->check_capability(api::device_caps::sampler_with_resource_view);
 
 	for (technique &tech : _techniques)
 	{
 		if (tech.effect_index != effect_index)
 			continue;
 
+		finish_pipeline_creation(tech);
+
 		for (size_t i = 0; i < tech.passes_data.size(); ++i)
 		{
 			_device->destroy_render_pass(tech.passes_data[i].pass);
 
 			const bool is_compute_pass = !tech.passes[i].cs_entry_point.empty();
 			_device->destroy_pipeline(is_compute_pass ? api::pipeline_stage::all_compute : api::pipeline_stage::all_graphics, tech.passes_data[i].pipeline);
-
-			_device->destroy_descriptor_sets(_effects[effect_index].set_layouts[2], 1, &tech.passes_data[i].texture_set);
-			_device->destroy_descriptor_sets(_effects[effect_index].set_layouts[3], 1, &tech.passes_data[i].storage_set);
 		}
 
 		tech.passes_data.clear();
 	}
 
-	{	effect &effect = _effects[effect_index];
-
-		_device->destroy_resource(effect.cb);
-		effect.cb = {};
+	effect &effect = _effects[effect_index];
 
-		_device->destroy_pipeline_layout(effect.layout);
-		effect.layout = {};
-
-		_device->destroy_descriptor_sets(effect.set_layouts[0], 1, &effect.cb_set);
-		effect.cb_set = {};
-		_device->destroy_descriptor_sets(effect.set_layouts[1], 1, &effect.sampler_set);
-		effect.sampler_set = {};
+	_device->destroy_resource(effect.cb);
+	effect.cb = {};
+
+	_device->destroy_pipeline_layout(effect.layout);
+	effect.layout = {};
+
+	_device->destroy_descriptor_sets(effect.set_layouts[0], 1, &effect.cb_set);
+	effect.cb_set = {};
+	_device->destroy_descriptor_sets(effect.set_layouts[1], 1, &effect.sampler_set);
+	effect.sampler_set = {};
+	_device->destroy_descriptor_sets(effect.set_layouts[sampler_with_resource_view ? 1 : 2], static_cast<uint32_t>(effect.texture_sets.size()), effect.texture_sets.data());
+	effect.texture_sets.clear();
+	for (const std::pair<uint64_t, api::descriptor_set> &retired : effect.retired_texture_sets)
+		_device->destroy_descriptor_sets(effect.set_layouts[sampler_with_resource_view ? 1 : 2], 1, &retired.second);
+	effect.retired_texture_sets.clear();
+	_device->destroy_descriptor_sets(effect.set_layouts[sampler_with_resource_view ? 2 : 3], static_cast<uint32_t>(effect.storage_sets.size()), effect.storage_sets.data());
+	effect.storage_sets.clear();
+
+	for (size_t i = 0; i < std::size(effect.set_layouts); ++i)
+	{
+		_device->destroy_descriptor_set_layout(effect.set_layouts[i]);
+		effect.set_layouts[i] = {};
+	}
 
-		for (size_t i = 0; i < std::size(effect.set_layouts); ++i)
-		{
-			_device->destroy_descriptor_set_layout(effect.set_layouts[i]);
-			effect.set_layouts[i] = {};
-		}
+	_device->destroy_query_pool(effect.query_heap);
+	effect.query_heap = {};
+	_device->destroy_query_pool(effect.statistics_query_heap);
+	effect.statistics_query_heap = {};
 
-		_device->destroy_query_pool(effect.query_heap);
-		effect.query_heap = {};
+	effect.texture_semantic_to_binding.clear();
+	effect.texture_set_writes.clear();
+}
+void reshade::runtime::unload_effect(size_t effect_index)
+{
+	assert(effect_index < _effects.size());
 
-		effect.texture_semantic_to_binding.clear();
+	// Make sure shaders are no longer being compiled in the background, since that accesses the effect module
+	if (std::future<compiled_shaders> &pending_shaders = _effects[effect_index].pending_shaders;
+		pending_shaders.valid())
+	{
+		pending_shaders.wait();
+		pending_shaders = {};
 	}
 
+	// Make sure no effect resources are currently in use
+	_device->wait_idle();
+
+	uninit_effect(effect_index);
+
 #if RESHADE_GUI
 	_preview_texture.handle = 0;
 #endif
 
-	// Lock here to be safe in case another effect is still loading
-	const std::lock_guard<std::mutex> lock(_reload_mutex);
-
 	// Destroy textures belonging to this effect
 	_textures.erase(std::remove_if(_textures.begin(), _textures.end(),
 		[this, effect_index](texture &tex) {
@@ -2061,6 +3692,11 @@ void reshade::runtime::unload_effect(size_t effect_index)
 			}
 			return false;
 		}), _textures.end());
+
+	// Erasing shifted the remaining textures, so have to rebuild the index
+	_texture_indices.clear();
+	for (size_t texture_index = 0; texture_index < _textures.size(); ++texture_index)
+		_texture_indices.emplace(_textures[texture_index].unique_name, texture_index);
 	// Clean up techniques belonging to this effect
 	_techniques.erase(std::remove_if(_techniques.begin(), _techniques.end(),
 		[effect_index](const technique &tech) {
@@ -2069,23 +3705,28 @@ void reshade::runtime::unload_effect(size_t effect_index)
 
 	_effects[effect_index].rendering = 0;
 	// Do not clear effect here, since it is common to be re-used immediately
+
+	_effect_handles_outdated = true;
 }
 void reshade::runtime::unload_effects()
 {
 	// Make sure no effect resources are currently in use
 	_device->wait_idle();
 
+	destroy_technique_recordings();
+
+	const bool sampler_with_resource_view = _device->check_capability(api::device_caps::sampler_with_resource_view);
+
 	for (technique &tech : _techniques)
 	{
+		finish_pipeline_creation(tech);
+
 		for (size_t i = 0; i < tech.passes_data.size(); ++i)
 		{
 			_device->destroy_render_pass(tech.passes_data[i].pass);
 
 			const bool is_compute_pass = !tech.passes[i].cs_entry_point.empty();
 			_device->destroy_pipeline(is_compute_pass ? api::pipeline_stage::all_compute : api::pipeline_stage::all_graphics, tech.passes_data[i].pipeline);
-
-			_device->destroy_descriptor_sets(_effects[tech.effect_index].set_layouts[2], 1, &tech.passes_data[i].texture_set);
-			_device->destroy_descriptor_sets(_effects[tech.effect_index].set_layouts[3], 1, &tech.passes_data[i].storage_set);
 		}
 
 		tech.passes_data.clear();
@@ -2099,6 +3740,10 @@ void reshade::runtime::unload_effects()
 
 		_device->destroy_descriptor_sets(effect.set_layouts[0], 1, &effect.cb_set);
 		_device->destroy_descriptor_sets(effect.set_layouts[1], 1, &effect.sampler_set);
+		_device->destroy_descriptor_sets(effect.set_layouts[sampler_with_resource_view ? 1 : 2], static_cast<uint32_t>(effect.texture_sets.size()), effect.texture_sets.data());
+		_device->destroy_descriptor_sets(effect.set_layouts[sampler_with_resource_view ? 2 : 3], static_cast<uint32_t>(effect.storage_sets.size()), effect.storage_sets.data());
+		for (const std::pair<uint64_t, api::descriptor_set> &retired : effect.retired_texture_sets)
+			_device->destroy_descriptor_sets(effect.set_layouts[sampler_with_resource_view ? 1 : 2], 1, &retired.second);
 
 		for (size_t i = 0; i < std::size(effect.set_layouts); ++i)
 		{
@@ -2106,6 +3751,7 @@ void reshade::runtime::unload_effects()
 		}
 
 		_device->destroy_query_pool(effect.query_heap);
+		_device->destroy_query_pool(effect.statistics_query_heap);
 	}
 
 	for (auto &[hash, sampler] : _effect_sampler_states)
@@ -2118,26 +3764,70 @@ void reshade::runtime::unload_effects()
 #endif
 
 	// Make sure no threads are still accessing effect data
-	for (std::thread &thread : _worker_threads)
-		if (thread.joinable())
-			thread.join();
-	_worker_threads.clear();
+	_worker_pool.wait_idle();
+
+	// Discard effects that were built for a preset transition or file change, since everything is loaded again anyway
+	_effect_variants.clear();
+	_effect_variants_outdated = false;
+	_modified_effect_files.clear();
+
+	// Include files are read again when effects are loaded next, so drop them to not keep files around that are no longer used
+	reshadefx::preprocessor::clear_include_cache();
+
+	// Write any newly compiled effect data to disk
+	if (_effect_cache != nullptr)
+		_effect_cache->flush();
+	if (_machine_effect_cache != nullptr)
+		_machine_effect_cache->flush();
 
 	// Destroy all textures
 	for (texture &tex : _textures)
 		destroy_texture(tex);
 	_textures.clear();
+	_texture_indices.clear();
 	_textures_loaded = false;
 	// Clean up all techniques
 	_techniques.clear();
 
 	// Reset the effect list after all resources have been destroyed
 	_effects.clear();
+	_effect_handles_outdated = true;
 }
 void reshade::runtime::destroy_texture(texture &tex)
 {
-	_device->destroy_resource(tex.resource);
+	// Aliased resources are only destroyed once the last texture using them is
+	if (const auto aliased = std::find_if(_aliased_resources.begin(), _aliased_resources.end(),
+			[&tex](const aliased_resource &res) { return res.resource == tex.resource; });
+		aliased != _aliased_resources.end())
+	{
+		aliased->users.erase(std::remove_if(aliased->users.begin(), aliased->users.end(),
+			[&tex](const std::pair<size_t, std::string> &user) {
+				return user.first == tex.effect_index && std::find(tex.transient_techniques.begin(), tex.transient_techniques.end(), user.second) != tex.transient_techniques.end();
+			}), aliased->users.end());
+
+		if (aliased->users.empty())
+		{
+			_device->destroy_resource(tex.resource);
+			_aliased_resources.erase(aliased);
+		}
+	}
+	else
+	{
+		_device->destroy_resource(tex.resource);
+	}
+	// Stop streaming into the resource and destroy the views that were replaced while doing so
+	_texture_streams.erase(std::remove_if(_texture_streams.begin(), _texture_streams.end(),
+		[&tex](const texture_stream &stream) { return stream.resource == tex.resource; }), _texture_streams.end());
+	_retired_texture_views.erase(std::remove_if(_retired_texture_views.begin(), _retired_texture_views.end(),
+		[this, &tex](const retired_texture_view &retired) {
+			if (retired.resource != tex.resource)
+				return false;
+			_device->destroy_resource_view(retired.view);
+			return true;
+		}), _retired_texture_views.end());
+
 	tex.resource = {};
+	tex.transient_techniques.clear();
 
 	_device->destroy_resource_view(tex.srv[0]);
 	if (tex.srv[1] != tex.srv[0])
@@ -2154,6 +3844,123 @@ void reshade::runtime::destroy_texture(texture &tex)
 	_device->destroy_resource_view(tex.uav);
 	tex.uav = {};
 }
+bool reshade::runtime::update_texture_views(texture &tex, uint32_t first_level)
+{
+	assert(first_level < tex.levels);
+
+	// Views are created with the default typed formats of the resource format, which is what 'init_texture' does for block compressed textures as well
+	const api::format format = _device->get_resource_desc(tex.resource).texture.format;
+
+	api::resource_view new_srv[2] = {};
+	if (!_device->create_resource_view(tex.resource, api::resource_usage::shader_resource, api::resource_view_desc(api::format_to_default_typed(format, 0), first_level, tex.levels - first_level, 0, 1), &new_srv[0]))
+	{
+		LOG(ERROR) << "Failed to create shader resource view for texture '" << tex.unique_name << "'!";
+		LOG(DEBUG) << "> Details: Format = " << static_cast<uint32_t>(format) << ", First Level = " << first_level << ", Levels = " << tex.levels;
+		return false;
+	}
+	if (tex.srv[1] == tex.srv[0])
+	{
+		new_srv[1] = new_srv[0];
+	}
+	else if (!_device->create_resource_view(tex.resource, api::resource_usage::shader_resource, api::resource_view_desc(api::format_to_default_typed(format, 1), first_level, tex.levels - first_level, 0, 1), &new_srv[1]))
+	{
+		_device->destroy_resource_view(new_srv[0]);
+
+		LOG(ERROR) << "Failed to create shader resource view for texture '" << tex.unique_name << "'!";
+		LOG(DEBUG) << "> Details: Format = " << static_cast<uint32_t>(format) << ", First Level = " << first_level << ", Levels = " << tex.levels;
+		return false;
+	}
+
+	const bool sampler_with_resource_view = _device->check_capability(api::device_caps::sampler_with_resource_view);
+
+	// Same as in 'update_texture_bindings', write new versions of all sets referencing the texture instead of updating them in place
+	std::vector<api::descriptor_set_write> descriptor_writes;
+	std::vector<std::pair<api::descriptor_set, api::descriptor_set>> replaced_sets;
+
+	for (size_t effect_index = 0; effect_index < _effects.size(); ++effect_index)
+	{
+		effect &effect_data = _effects[effect_index];
+
+		replaced_sets.clear();
+
+		for (auto &[set_handle, writes] : effect_data.texture_set_writes)
+		{
+			bool referenced = false;
+			for (api::descriptor_set_write &write : writes)
+			{
+				if (write.descriptor.view == tex.srv[0])
+					write.descriptor.view = new_srv[0], referenced = true;
+				else if (write.descriptor.view == tex.srv[1])
+					write.descriptor.view = new_srv[1], referenced = true;
+			}
+
+			if (!referenced)
+				continue;
+
+			api::descriptor_set new_set = {};
+			if (!_device->create_descriptor_sets(effect_data.set_layouts[sampler_with_resource_view ? 1 : 2], 1, &new_set))
+			{
+				LOG(ERROR) << "Failed to create texture descriptor set for effect file '" << effect_data.source_file << "'!";
+				continue;
+			}
+
+			replaced_sets.emplace_back(api::descriptor_set { set_handle }, new_set);
+		}
+
+		replace_texture_sets(effect_index, replaced_sets, descriptor_writes);
+	}
+
+	_device->update_descriptor_sets(static_cast<uint32_t>(descriptor_writes.size()), descriptor_writes.data());
+
+#if RESHADE_GUI
+	if (_preview_texture == tex.srv[0])
+		_preview_texture = new_srv[0];
+#endif
+
+	// Commands recorded so far may still reference the previous views
+	const uint64_t retire_fence_value = _graphics_queue->get_pending_fence_value();
+	_retired_texture_views.push_back({ retire_fence_value, tex.resource, tex.srv[0] });
+	if (tex.srv[1] != tex.srv[0])
+		_retired_texture_views.push_back({ retire_fence_value, tex.resource, tex.srv[1] });
+
+	tex.srv[0] = new_srv[0];
+	tex.srv[1] = new_srv[1];
+
+	return true;
+}
+void reshade::runtime::update_texture_streams()
+{
+	// Limit how much image data is uploaded per frame, so that streaming in large levels does not cause a hitch, but always make progress on at least one level
+	constexpr uint64_t max_upload_size_per_frame = 16 * 1024 * 1024;
+
+	api::command_list *const cmd_list = _graphics_queue->get_immediate_command_list();
+
+	uint64_t upload_size = 0;
+	for (auto it = _texture_streams.begin(); it != _texture_streams.end() && upload_size < max_upload_size_per_frame;)
+	{
+		texture_stream &stream = *it;
+		texture &tex = _textures[_texture_indices.at(stream.texture_name)];
+		assert(tex.resource == stream.resource && stream.resident_level != 0);
+
+		const uint32_t level = stream.resident_level - 1;
+		const api::subresource_data &data = stream.levels[level];
+
+		cmd_list->barrier(tex.resource, api::resource_usage::shader_resource, api::resource_usage::copy_dest);
+		_device->upload_texture_region(data, tex.resource, level);
+		cmd_list->barrier(tex.resource, api::resource_usage::copy_dest, api::resource_usage::shader_resource);
+
+		upload_size += data.slice_pitch;
+
+		// Views stay clamped to a less detailed level if they cannot be replaced, which still looks correct, so continue with the next level regardless
+		update_texture_views(tex, level);
+		stream.resident_level = level;
+
+		if (level == 0)
+			it = _texture_streams.erase(it);
+		else
+			++it;
+	}
+}
 
 bool reshade::runtime::reload_effect(size_t effect_index, bool preprocess_required)
 {
@@ -2175,142 +3982,451 @@ void reshade::runtime::reload_effects()
 	_reload_count++;
 #endif
 	_last_reload_successfull = true;
+	_last_reload_start_time = std::chrono::high_resolution_clock::now();
+	for (std::atomic<uint64_t> &duration : _load_phase_durations_ns)
+		duration.store(0, std::memory_order_relaxed);
 
 	load_effects();
 }
 
-bool reshade::runtime::load_effect_cache(const std::filesystem::path &source_file, const size_t hash, std::string &source) const
+void reshade::runtime::build_effect_variants(std::vector<std::string> &&preset_preprocessor_definitions, const std::vector<size_t> &effect_indices, bool preprocess_required)
 {
-	if (_no_effect_cache)
-		return false;
+	assert(_effect_variants.empty() && !is_loading());
 
-	std::filesystem::path path = g_reshade_base_path / _intermediate_cache_path;
-	path /= std::filesystem::u8path("reshade-" + source_file.stem().u8string() + '-' + std::to_string(_renderer_id) + '-' + std::to_string(hash) + ".i");
+	if ((_renderer_id & 0xF0000) == 0 && _d3d_compiler == nullptr)
+	{
+		// Load the HLSL compiler here, so that the background compilation below does not have to synchronize this
+		_d3d_compiler = LoadLibraryW(L"d3dcompiler_47.dll");
+		if (_d3d_compiler == nullptr)
+			_d3d_compiler = LoadLibraryW(L"d3dcompiler_43.dll");
+	}
 
-	{	const HANDLE file = CreateFileW(path.c_str(), FILE_GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
-		if (file == INVALID_HANDLE_VALUE)
-			return false;
-		DWORD size = GetFileSize(file, nullptr);
-		source.resize(size);
-		const BOOL result = ReadFile(file, source.data(), size, &size, nullptr);
-		CloseHandle(file);
-		return result != FALSE;
+	_effect_variants.resize(_effects.size());
+	_effect_variants_definitions = std::move(preset_preprocessor_definitions);
+	_effect_variants_outdated = false;
+
+	// Create copy of preset instead of reference, so it stays valid even if 'ini_file::load_cache' is called while effects are still being built
+	const auto preset_copy = std::make_shared<const ini_file>(ini_file::load_cache(_current_preset_path));
+
+	_effect_variants_remaining = effect_indices.size();
+
+	for (const size_t effect_index : effect_indices)
+	{
+		_worker_pool.submit([this, source_file = _effects[effect_index].source_file, effect_index, preset_copy, preprocess_required]() {
+			// Abort building when initialization state changes (indicating that 'on_reset' was called in the meantime)
+			if (_is_initialized)
+			{
+				effect &variant = _effect_variants[effect_index];
+
+				bool source_cached = false;
+				build_effect(variant, source_file, *preset_copy, _effect_variants_definitions, effect_index, preprocess_required, source_cached);
+
+				// Compile shaders right away as well, so that the variant can be initialized without waiting for that after it was swapped in
+				if (variant.compiled)
+				{
+					std::promise<compiled_shaders> shaders;
+					variant.pending_shaders = shaders.get_future();
+					shaders.set_value(compile_effect_shaders(variant));
+				}
+			}
+
+			_effect_variants_remaining--;
+		});
+	}
+}
+void reshade::runtime::update_effect_variants()
+{
+	if (_effect_variants_remaining != 0)
+		return; // Keep rendering the current effects until all variants were built
+
+	_preset_preprocessor_definitions = std::move(_effect_variants_definitions);
+	std::vector<effect> variants = std::move(_effect_variants);
+	_effect_variants.clear();
+
+	// Create copy of preset, since 'load_effect' below may load other cached files
+	const ini_file preset = ini_file::load_cache(_current_preset_path);
+
+	for (size_t effect_index = 0; effect_index < variants.size(); ++effect_index)
+	{
+		effect &variant = variants[effect_index];
+		if (variant.source_file.empty())
+			continue;
+
+		// Effects whose generated code did not change keep their resources and continue rendering uninterrupted
+		if (effect &current = _effects[effect_index];
+			restore_effect_code(current) &&
+			variant.compiled == current.compiled && variant.preamble == current.preamble && variant.module.hlsl == current.module.hlsl && variant.module.spirv == current.module.spirv)
+		{
+			current.source_hash = variant.source_hash;
+			current.definitions_outdated = false;
+			if (variant.preprocessed)
+			{
+				current.definitions = std::move(variant.definitions);
+				current.included_files = std::move(variant.included_files);
+			}
+			continue;
+		}
+
+		const std::filesystem::path source_file = variant.source_file;
+
+		// Since the variant matches the source file and definitions already, loading skips straight to adding its textures and techniques
+		// Its shaders were compiled already as well, so it is only missing for the frame until it is initialized
+		unload_effect(effect_index);
+		_effects[effect_index] = std::move(variant);
+		load_effect(source_file, preset, effect_index);
+	}
+
+	// The preset may have been changed again while effects were being built, so start over with its definitions
+	if (_effect_variants_outdated)
+	{
+		std::vector<std::string> preset_preprocessor_definitions;
+		preset.get({}, "PreprocessorDefinitions", preset_preprocessor_definitions);
+		std::vector<std::string> technique_list;
+		preset.get({}, "Techniques", technique_list);
+
+		build_effect_variants(std::move(preset_preprocessor_definitions), select_effect_variants(technique_list));
+		return;
+	}
+
+	// Effects that were outdated and had a technique enabled while the variants were being built still need to catch up
+	std::vector<size_t> effect_indices;
+	for (size_t effect_index = 0; effect_index < _effects.size(); ++effect_index)
+		if (_effects[effect_index].definitions_outdated && _effects[effect_index].rendering != 0)
+			effect_indices.push_back(effect_index);
+
+	if (!effect_indices.empty())
+		build_effect_variants(std::vector<std::string>(_preset_preprocessor_definitions), effect_indices);
+}
+std::vector<size_t> reshade::runtime::select_effect_variants(const std::vector<std::string> &technique_list)
+{
+	// Effects that were skipped are not loaded at all, so there is nothing to replace for them
+	std::vector<size_t> effect_indices;
+	for (size_t effect_index = 0; effect_index < _effects.size(); ++effect_index)
+	{
+		effect &effect = _effects[effect_index];
+		if (effect.skipped)
+			continue;
+
+		const std::string effect_name = effect.source_file.filename().u8string();
+
+		if (effect.rendering != 0 || std::any_of(_techniques.begin(), _techniques.end(),
+				[&technique_list, &effect_name, effect_index](const technique &tech) {
+					return tech.effect_index == effect_index &&
+						std::any_of(technique_list.begin(), technique_list.end(),
+							[&tech, &effect_name](const std::string &technique_name) { return technique_name == tech.name || technique_name == tech.name + '@' + effect_name; }); }))
+			effect_indices.push_back(effect_index);
+		else
+			effect.definitions_outdated = true;
+	}
+	return effect_indices;
+}
+void reshade::runtime::reload_modified_effects()
+{
+	if (_effect_watcher->check(_modified_effect_files))
+	{
+		// Wait a short while after the last change before reloading, since editors often write a file in several steps
+		_last_effect_file_change = _last_present_time;
+		return;
+	}
+
+	if (_modified_effect_files.empty() || (_last_present_time - _last_effect_file_change) < std::chrono::milliseconds(250))
+		return;
+
+	std::vector<size_t> effect_indices;
+	for (size_t effect_index = 0; effect_index < _effects.size(); ++effect_index)
+	{
+		const effect &effect = _effects[effect_index];
+		if (effect.skipped)
+			continue;
+
+		if (std::any_of(_modified_effect_files.begin(), _modified_effect_files.end(),
+				[&effect](const std::filesystem::path &modified_file) {
+					return is_same_or_parent_path(modified_file, effect.source_file) || std::any_of(effect.included_files.begin(), effect.included_files.end(),
+						[&modified_file](const std::filesystem::path &included_file) { return is_same_or_parent_path(modified_file, included_file); }); }))
+			effect_indices.push_back(effect_index);
 	}
+
+	_modified_effect_files.clear();
+
+	if (effect_indices.empty())
+		return;
+
+	LOG(INFO) << "Reloading " << effect_indices.size() << " effect(s) after files they depend on were modified.";
+
+	// Have to preprocess again, since the effect cache does not know about modifications to files that are not part of the source hash
+	build_effect_variants(std::vector<std::string>(_preset_preprocessor_definitions), effect_indices, true);
+}
+
+bool reshade::runtime::load_effect_cache(const std::filesystem::path &source_file, const size_t hash, std::string &source, std::vector<std::filesystem::path> &included_files) const
+{
+	if (_no_effect_cache || _effect_cache == nullptr)
+		return false;
+
+	// Included files are stored along with the source, since they are needed to find the effects affected by a file change (see 'reload_modified_effects')
+	std::string included_files_list;
+	if (!_effect_cache->get(effect_cache_key(source_file, std::string(), hash, "i"), source) ||
+		!_effect_cache->get(effect_cache_key(source_file, std::string(), hash, "deps"), included_files_list))
+		return false;
+
+	included_files.clear();
+	for (size_t offset = 0, next_offset; (next_offset = included_files_list.find('\n', offset)) != std::string::npos; offset = next_offset + 1)
+		included_files.push_back(std::filesystem::u8path(included_files_list.substr(offset, next_offset - offset)));
+
+	return true;
 }
 bool reshade::runtime::load_effect_cache(const std::filesystem::path &source_file, const std::string &entry_point, const size_t hash, std::vector<char> &cso, std::string &dasm) const
 {
-	if (_no_effect_cache)
+	if (_no_effect_cache || _effect_cache == nullptr)
 		return false;
 
-	std::filesystem::path path = g_reshade_base_path / _intermediate_cache_path;
-	path /= std::filesystem::u8path("reshade-" + source_file.stem().u8string() + '-' + entry_point + '-' + std::to_string(_renderer_id) + '-' + std::to_string(hash) + ".cso");
+	if (_effect_cache->get(effect_cache_key(source_file, entry_point, hash, "cso"), cso) &&
+		_effect_cache->get(effect_cache_key(source_file, entry_point, hash, "asm"), dasm))
+		return true;
 
-	{	const HANDLE file = CreateFileW(path.c_str(), FILE_GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
-		if (file == INVALID_HANDLE_VALUE)
-			return false;
-		DWORD size = GetFileSize(file, nullptr);
-		cso.resize(size);
-		const BOOL result = ReadFile(file, cso.data(), size, &size, nullptr);
-		CloseHandle(file);
-		if (result == FALSE)
-			return false;
+	// Fall back to the machine-wide cache, in case another application already compiled the same shader
+	if (_machine_effect_cache == nullptr)
+		return false;
+
+	const uint64_t version = compiler_version(uses_dxil_codegen() ? _dxc_compiler : _d3d_compiler);
+	if (!_machine_effect_cache->get(machine_cache_key(entry_point, hash, version, "cso"), cso) ||
+		!_machine_effect_cache->get(machine_cache_key(entry_point, hash, version, "asm"), dasm))
+		return false;
+
+	// Copy to the local cache too, so that this entry is found there next time even if it is evicted from the machine-wide cache
+	_effect_cache->put(effect_cache_key(source_file, entry_point, hash, "cso"), cso.data(), cso.size());
+	_effect_cache->put(effect_cache_key(source_file, entry_point, hash, "asm"), dasm.data(), dasm.size());
+	return true;
+}
+bool reshade::runtime::save_effect_cache(const std::filesystem::path &source_file, const size_t hash, const std::string &source, const std::vector<std::filesystem::path> &included_files) const
+{
+	if (_no_effect_cache || _effect_cache == nullptr)
+		return false;
+
+	std::string included_files_list;
+	for (const std::filesystem::path &included_file : included_files)
+		included_files_list += included_file.u8string() + '\n';
+
+	_effect_cache->put(effect_cache_key(source_file, std::string(), hash, "i"), source.data(), source.size());
+	_effect_cache->put(effect_cache_key(source_file, std::string(), hash, "deps"), included_files_list.data(), included_files_list.size());
+	return true;
+}
+bool reshade::runtime::save_effect_cache(const std::filesystem::path &source_file, const std::string &entry_point, const size_t hash, const std::vector<char> &cso, const std::string &dasm) const
+{
+	if (_no_effect_cache || _effect_cache == nullptr)
+		return false;
+
+	_effect_cache->put(effect_cache_key(source_file, entry_point, hash, "cso"), cso.data(), cso.size());
+	_effect_cache->put(effect_cache_key(source_file, entry_point, hash, "asm"), dasm.data(), dasm.size());
+
+	if (_machine_effect_cache != nullptr)
+	{
+		const uint64_t version = compiler_version(uses_dxil_codegen() ? _dxc_compiler : _d3d_compiler);
+		_machine_effect_cache->put(machine_cache_key(entry_point, hash, version, "cso"), cso.data(), cso.size());
+		_machine_effect_cache->put(machine_cache_key(entry_point, hash, version, "asm"), dasm.data(), dasm.size());
 	}
+	return true;
+}
+bool reshade::runtime::load_effect_cache(const std::filesystem::path &source_file, const size_t hash, effect &effect) const
+{
+	if (_no_effect_cache || _effect_cache == nullptr)
+		return false;
+
+	std::string data;
+	if (!_effect_cache->get(effect_cache_key(source_file, std::string(), hash, "module"), data))
+		return false;
 
-	path.replace_extension(L".asm");
+	std::string errors;
+	reshadefx::module module;
+	std::vector<std::filesystem::path> included_files;
+	std::vector<std::pair<std::string, std::string>> definitions;
 
-	{	const HANDLE file = CreateFileW(path.c_str(), FILE_GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
-		if (file == INVALID_HANDLE_VALUE)
-			return false;
-		DWORD size = GetFileSize(file, nullptr);
-		dasm.resize(size);
-		const BOOL result = ReadFile(file, dasm.data(), size, &size, nullptr);
-		CloseHandle(file);
-		if (result == FALSE)
-			return false;
+	effect_cache_reader reader(data);
+	uint32_t version = 0;
+	reader(version);
+	if (version != EFFECT_MODULE_CACHE_VERSION)
+		return false;
+	reader(errors);
+	reader(definitions);
+	reader(included_files);
+	reader(module);
+	if (reader.failed || reader.offset != data.size())
+	{
+		LOG(WARN) << "Ignoring corrupted effect cache entry for " << source_file << '.';
+		return false;
 	}
 
+	effect.compiled = true;
+	effect.errors += errors;
+	effect.module = std::move(module);
+	effect.included_files = std::move(included_files);
+	effect.definitions = std::move(definitions);
+
+	return true;
+}
+bool reshade::runtime::save_effect_cache(const std::filesystem::path &source_file, const size_t hash, const effect &effect) const
+{
+	if (_no_effect_cache || _effect_cache == nullptr)
+		return false;
+
+	// The serialization functions take mutable references, since they are shared with reading, but writing does not modify anything
+	reshade::effect &mutable_effect = const_cast<reshade::effect &>(effect);
+
+	effect_cache_writer writer;
+	uint32_t version = EFFECT_MODULE_CACHE_VERSION;
+	writer(version);
+	writer(mutable_effect.errors);
+	writer(mutable_effect.definitions);
+	writer(mutable_effect.included_files);
+	writer(mutable_effect.module);
+
+	_effect_cache->put(effect_cache_key(source_file, std::string(), hash, "module"), writer.data.data(), writer.data.size());
+
 	return true;
 }
-bool reshade::runtime::save_effect_cache(const std::filesystem::path &source_file, const size_t hash, const std::string &source) const
+bool reshade::runtime::load_pipeline_cache(std::vector<char> &data) const
 {
 	if (_no_effect_cache)
 		return false;
 
 	std::filesystem::path path = g_reshade_base_path / _intermediate_cache_path;
-	path /= std::filesystem::u8path("reshade-" + source_file.stem().u8string() + '-' + std::to_string(_renderer_id) + '-' + std::to_string(hash) + ".i");
+	path /= std::filesystem::u8path("reshade-pipelines-" + std::to_string(_renderer_id) + '-' + std::to_string(_vendor_id) + '-' + std::to_string(_device_id) + ".bin");
 
-	{	const HANDLE file = CreateFileW(path.c_str(), FILE_GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_NEW, FILE_ATTRIBUTE_ARCHIVE | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	{	const HANDLE file = CreateFileW(path.c_str(), FILE_GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
 		if (file == INVALID_HANDLE_VALUE)
 			return false;
-		DWORD size = static_cast<DWORD>(source.size());
-		const BOOL result = WriteFile(file, source.data(), size, &size, nullptr);
+		DWORD size = GetFileSize(file, nullptr);
+		data.resize(size);
+		const BOOL result = ReadFile(file, data.data(), size, &size, nullptr);
 		CloseHandle(file);
 		return result != FALSE;
 	}
 }
-bool reshade::runtime::save_effect_cache(const std::filesystem::path &source_file, const std::string &entry_point, const size_t hash, const std::vector<char> &cso, const std::string &dasm) const
+bool reshade::runtime::save_pipeline_cache(const std::vector<char> &data) const
 {
 	if (_no_effect_cache)
 		return false;
 
 	std::filesystem::path path = g_reshade_base_path / _intermediate_cache_path;
-	path /= std::filesystem::u8path("reshade-" + source_file.stem().u8string() + '-' + entry_point + '-' + std::to_string(_renderer_id) + '-' + std::to_string(hash) + ".cso");
+	path /= std::filesystem::u8path("reshade-pipelines-" + std::to_string(_renderer_id) + '-' + std::to_string(_vendor_id) + '-' + std::to_string(_device_id) + ".bin");
 
-	{	const HANDLE file = CreateFileW(path.c_str(), FILE_GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_NEW, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	// Overwrite any existing file, since the pipeline cache accumulates pipelines across sessions
+	{	const HANDLE file = CreateFileW(path.c_str(), FILE_GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_ARCHIVE | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
 		if (file == INVALID_HANDLE_VALUE)
 			return false;
-		DWORD size = static_cast<DWORD>(cso.size());
-		const BOOL result = WriteFile(file, cso.data(), size, &size, nullptr);
+		DWORD size = static_cast<DWORD>(data.size());
+		const BOOL result = WriteFile(file, data.data(), size, &size, nullptr);
 		CloseHandle(file);
-		if (result == FALSE)
-			return false;
+		return result != FALSE;
 	}
+}
+bool reshade::runtime::load_effect_permutation(effect &effect)
+{
+	const std::lock_guard<std::mutex> lock(_shared_effect_cache->permutations_mutex);
 
-	path.replace_extension(L".asm");
+	// The source hash covers all preprocessor definitions (as well as the modification time of all included files), so a match is guaranteed to produce the same module
+	const auto it = std::find_if(_shared_effect_cache->permutations.rbegin(), _shared_effect_cache->permutations.rend(),
+		[&effect](const effect_permutation &permutation) { return permutation.source_hash == effect.source_hash && permutation.source_file == effect.source_file; });
+	if (it == _shared_effect_cache->permutations.rend())
+		return false;
 
-	{	const HANDLE file = CreateFileW(path.c_str(), FILE_GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_NEW, FILE_ATTRIBUTE_ARCHIVE | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
-		if (file == INVALID_HANDLE_VALUE)
-			return false;
-		DWORD size = static_cast<DWORD>(dasm.size());
-		const BOOL result = WriteFile(file, dasm.c_str(), size, &size, NULL);
-		CloseHandle(file);
-		if (result == FALSE)
-			return false;
-	}
+	effect.compiled = true;
+	effect.errors += it->errors;
+	effect.module = it->module;
+	effect.included_files = it->included_files;
+	effect.definitions = it->definitions;
+
+	// Move entry to the back, so that it is evicted last
+	std::rotate(std::prev(it.base()), it.base(), _shared_effect_cache->permutations.end());
 
 	return true;
 }
-void reshade::runtime::clear_effect_cache()
+void reshade::runtime::save_effect_permutation(const effect &effect)
 {
-	// Find all cached effect files and delete them
-	std::error_code ec;
-	for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(g_reshade_base_path / _intermediate_cache_path, std::filesystem::directory_options::skip_permission_denied, ec))
-	{
-		if (entry.is_directory(ec))
-			continue;
+	// Permutations hold a full copy of the module, which is what low memory mode is trying to avoid
+	if (_effect_permutation_cache_size == 0 || _low_memory_mode)
+		return;
+
+	const std::lock_guard<std::mutex> lock(_shared_effect_cache->permutations_mutex);
+
+	// Replace any existing entry for the same permutation (e.g. after the effect was forced to preprocess again because an included file changed)
+	_shared_effect_cache->permutations.erase(std::remove_if(_shared_effect_cache->permutations.begin(), _shared_effect_cache->permutations.end(),
+		[&effect](const effect_permutation &permutation) { return permutation.source_hash == effect.source_hash && permutation.source_file == effect.source_file; }), _shared_effect_cache->permutations.end());
+
+	// Evict the least recently used entries when the cache is full
+	if (_shared_effect_cache->permutations.size() >= _effect_permutation_cache_size)
+		_shared_effect_cache->permutations.erase(_shared_effect_cache->permutations.begin(), _shared_effect_cache->permutations.begin() + (_shared_effect_cache->permutations.size() - _effect_permutation_cache_size + 1));
+
+	effect_permutation &permutation = _shared_effect_cache->permutations.emplace_back();
+	permutation.source_file = effect.source_file;
+	permutation.source_hash = effect.source_hash;
+	permutation.errors = effect.errors;
+	permutation.module = effect.module;
+	permutation.included_files = effect.included_files;
+	permutation.definitions = effect.definitions;
+}
+
+void reshade::runtime::clear_effect_cache()
+{
+	// Only the cache of this installation is cleared, the machine-wide cache is still in use by other applications
+	if (_effect_cache != nullptr)
+		_effect_cache->clear();
+
+	{	const std::lock_guard<std::mutex> lock(_shared_effect_cache->permutations_mutex);
+		_shared_effect_cache->permutations.clear();
+	}
+
+	// Find all cached effect files (including loose files from older versions) and delete them
+	std::error_code ec;
+	for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(g_reshade_base_path / _intermediate_cache_path, std::filesystem::directory_options::skip_permission_denied, ec))
+	{
+		if (entry.is_directory(ec))
+			continue;
 
 		const std::filesystem::path filename = entry.path().filename();
 		const std::filesystem::path extension = entry.path().extension();
-		if (filename.native().compare(0, 8, L"reshade-") != 0 || (extension != L".i" && extension != L".cso" && extension != L".asm"))
+		if (filename.native().compare(0, 8, L"reshade-") != 0 || (extension != L".i" && extension != L".cso" && extension != L".asm" && extension != L".bin" && extension != L".cache" && extension != L".lock" && extension != L".dds"))
 			continue;
 
 		DeleteFileW(entry.path().c_str());
 	}
 }
 
+#if RESHADE_GUI
+static inline uint64_t timeline_time_ns()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+}
+#endif
+
 void reshade::runtime::update_and_render_effects()
 {
+	RESHADE_PROFILE_SCOPE("runtime::update_and_render_effects");
+
 	// Delay first load to the first render call to avoid loading while the application is still initializing
 	if (_framecount == 0 && !_no_reload_on_init && !(_no_reload_for_non_vr && !_is_vr))
 		reload_effects();
 
+	// Use fewer workers while the application is in the foreground, so that loading effects in the background does not take processor time away from it
+	if (_worker_foreground_limit != 0)
+	{
+		DWORD foreground_process_id = 0;
+		GetWindowThreadProcessId(GetForegroundWindow(), &foreground_process_id);
+		_worker_pool.set_max_active_threads(foreground_process_id == GetCurrentProcessId() ? _worker_foreground_limit : 0);
+	}
+
 	if (_reload_remaining_effects == 0)
 	{
-		// Clear the thread list now that they all have finished
-		for (std::thread &thread : _worker_threads)
-			if (thread.joinable())
-				thread.join(); // Threads have exited, but still need to join them prior to destruction
-		_worker_threads.clear();
+		// All effects were loaded, but the last tasks may still be finishing up, so wait for them before touching effect data
+		// Only loading all effects runs on the worker threads, so do not wait on them after a single effect was reloaded or swapped in (which would block on unrelated background work, like building other effect variants)
+		if (!_reload_active_effects.empty())
+			_worker_pool.wait_idle();
+
+		// Merge the effects that finished loading since the last frame, so that their techniques are known to the preset
+		for (const size_t effect_index : _reload_loaded_effects)
+			merge_loaded_effect(effect_index);
+
+		_reload_loaded_effects.clear();
+		_reload_active_effects.clear();
 
 		// Finished loading effects, so apply preset to figure out which ones need compiling
 		load_current_preset();
@@ -2340,110 +4456,181 @@ void reshade::runtime::update_and_render_effects()
 	}
 	else if (_reload_remaining_effects != std::numeric_limits<size_t>::max())
 	{
-		return; // Cannot render while effects are still being loaded
+		std::vector<size_t> loaded_effects;
+		{
+			const std::lock_guard<std::mutex> lock(_reload_mutex);
+			loaded_effects.swap(_reload_loaded_effects);
+		}
+
+		// Merge and apply preset to the effects that finished loading since the last frame, so that their techniques are compiled and rendered without waiting for the slowest effect
+		if (!loaded_effects.empty())
+		{
+			for (const size_t effect_index : loaded_effects)
+			{
+				merge_loaded_effect(effect_index);
+				_reload_active_effects[effect_index] = true;
+			}
+
+			load_current_preset(&loaded_effects);
+		}
 	}
-	else if (!_reload_compile_queue.empty())
+
+	if (!_reload_compile_queue.empty())
 	{
-		// Pop an effect from the queue
-		const size_t effect_index = _reload_compile_queue.back();
-		_reload_compile_queue.pop_back();
-		effect &effect = _effects[effect_index];
+		if ((_renderer_id & 0xF0000) == 0 && _d3d_compiler == nullptr)
+		{
+			// Load the HLSL compiler here, so that the background compilation below does not have to synchronize this
+			_d3d_compiler = LoadLibraryW(L"d3dcompiler_47.dll");
+			if (_d3d_compiler == nullptr)
+				_d3d_compiler = LoadLibraryW(L"d3dcompiler_43.dll");
+		}
 
-		// Create textures now, since they are referenced when building samplers in the 'init_effect' call below
-		for (texture &tex : _textures)
+		// Compile shaders of all queued effects in the background, so that rendering can continue while that is in progress
+		// Techniques of these effects are skipped until they were initialized below, so the frame is shown without them in the meantime
+		for (const size_t effect_index : _reload_compile_queue)
 		{
-			if (tex.resource.handle != 0 || (
-				// Always create shared textures, since they may be in use by this effect already
-				tex.effect_index != effect_index && tex.shared.size() <= 1))
+			if (_effects[effect_index].pending_shaders.valid())
 				continue;
 
-			if (!init_texture(tex))
-			{
-				effect.errors += "Failed to create texture " + tex.unique_name;
-				effect.compiled = false;
-				break;
-			}
-		}
+			// Effects that were evicted may have released their generated code after they were initialized the last time
+			if (!restore_effect_code(_effects[effect_index]))
+				LOG(ERROR) << "Generated code of " << _effects[effect_index].source_file << " is no longer in the effect cache! Reload effects to compile it again.";
 
-		// Compile the effect with the back-end implementation (unless texture creation failed)
-		if (effect.compiled)
-			effect.compiled = init_effect(effect_index);
+			const auto task = std::make_shared<std::packaged_task<compiled_shaders()>>([this, effect_index]() { return compile_effect_shaders(_effects[effect_index]); });
+			_effects[effect_index].pending_shaders = task->get_future();
+			_worker_pool.submit([task]() { (*task)(); });
+		}
 
-		// De-duplicate error lines (D3DCompiler sometimes repeats the same error multiple times)
-		for (size_t line_offset = 0, next_line_offset;
-			(next_line_offset = effect.errors.find('\n', line_offset)) != std::string::npos; line_offset = next_line_offset + 1)
+		// Pop an effect from the queue that finished compiling
+		if (const auto it = std::find_if(_reload_compile_queue.rbegin(), _reload_compile_queue.rend(),
+				[this](size_t effect_index) { return _effects[effect_index].pending_shaders.wait_for(std::chrono::seconds(0)) == std::future_status::ready; });
+			it != _reload_compile_queue.rend())
 		{
-			const std::string_view cur_line(effect.errors.c_str() + line_offset, next_line_offset - line_offset);
+			const size_t effect_index = *it;
+			_reload_compile_queue.erase(std::next(it).base());
+			effect &effect = _effects[effect_index];
+
+			compiled_shaders shaders = effect.pending_shaders.get();
 
-			if (const size_t end_offset = effect.errors.find('\n', next_line_offset + 1);
-				end_offset != std::string::npos)
+			// Create textures now, since they are referenced when building samplers in the 'init_effect' call below
+			for (texture &tex : _textures)
 			{
-				const std::string_view next_line(effect.errors.c_str() + next_line_offset + 1, end_offset - next_line_offset - 1);
-				if (cur_line == next_line)
+				if (tex.resource.handle != 0 || (
+					// Always create shared textures, since they may be in use by this effect already
+					tex.effect_index != effect_index && tex.shared.size() <= 1))
+					continue;
+
+				if (!init_texture(tex))
 				{
-					effect.errors.erase(next_line_offset, end_offset - next_line_offset);
-					next_line_offset = line_offset - 1;
+					effect.errors += "Failed to create texture " + tex.unique_name;
+					effect.compiled = false;
+					break;
 				}
 			}
 
-			// Also remove D3DCompiler warnings about 'groupshared' specifier used in VS/PS modules
-			if (cur_line.find("X3579") != std::string_view::npos)
+			// Compile the effect with the back-end implementation (unless texture creation failed)
+			if (effect.compiled)
+				effect.compiled = init_effect(effect_index, shaders);
+
+			// Pipelines were created from the shaders compiled above, so the generated code is not needed anymore
+			if (effect.compiled)
+				release_effect_code(effect_index);
+
+			// De-duplicate error lines (D3DCompiler sometimes repeats the same error multiple times)
+			for (size_t line_offset = 0, next_line_offset;
+				(next_line_offset = effect.errors.find('\n', line_offset)) != std::string::npos; line_offset = next_line_offset + 1)
 			{
-				effect.errors.erase(line_offset, next_line_offset + 1 - line_offset);
-				next_line_offset = line_offset - 1;
-			}
-		}
+				const std::string_view cur_line(effect.errors.c_str() + line_offset, next_line_offset - line_offset);
 
-		if (!effect.compiled) // Something went wrong, do clean up
-		{
-			if (effect.errors.empty())
-				LOG(ERROR) << "Failed initializing " << effect.source_file << '!';
-			else
-				LOG(ERROR) << "Failed initializing " << effect.source_file << ":\n" << effect.errors;
+				if (const size_t end_offset = effect.errors.find('\n', next_line_offset + 1);
+					end_offset != std::string::npos)
+				{
+					const std::string_view next_line(effect.errors.c_str() + next_line_offset + 1, end_offset - next_line_offset - 1);
+					if (cur_line == next_line)
+					{
+						effect.errors.erase(next_line_offset, end_offset - next_line_offset);
+						next_line_offset = line_offset - 1;
+					}
+				}
 
-			// Destroy all textures belonging to this effect
-			for (texture &tex : _textures)
-				if (tex.effect_index == effect_index && tex.shared.size() <= 1)
-					destroy_texture(tex);
-			// Disable all techniques belonging to this effect
-			for (technique &tech : _techniques)
-				if (tech.effect_index == effect_index)
-					disable_technique(tech);
+				// Also remove D3DCompiler warnings about 'groupshared' specifier used in VS/PS modules
+				if (cur_line.find("X3579") != std::string_view::npos)
+				{
+					effect.errors.erase(line_offset, next_line_offset + 1 - line_offset);
+					next_line_offset = line_offset - 1;
+				}
+			}
 
-			_last_reload_successfull = false;
-		}
+			if (!effect.compiled) // Something went wrong, do clean up
+			{
+				if (effect.errors.empty())
+					LOG(ERROR) << "Failed initializing " << effect.source_file << '!';
+				else
+					LOG(ERROR) << "Failed initializing " << effect.source_file << ":\n" << effect.errors;
+
+				// Destroy all textures belonging to this effect
+				for (texture &tex : _textures)
+					if (tex.effect_index == effect_index && tex.shared.size() <= 1)
+						destroy_texture(tex);
+				// Disable all techniques belonging to this effect
+				for (technique &tech : _techniques)
+					if (tech.effect_index == effect_index)
+						disable_technique(tech);
+
+				_last_reload_successfull = false;
+			}
 
-		// An effect has changed, need to reload textures
-		_textures_loaded = false;
+			// An effect has changed, need to reload textures
+			_textures_loaded = false;
 
 #if RESHADE_GUI
-		if (effect.compiled)
-		{
-			// Update assembly in all editors after a reload
-			for (editor_instance &instance : _editors)
+			if (effect.compiled)
 			{
-				if (instance.entry_point_name.empty() || instance.file_path != effect.source_file)
-					continue;
-				assert(instance.effect_index == effect_index);
+				// Update assembly in all editors after a reload
+				for (editor_instance &instance : _editors)
+				{
+					if (instance.entry_point_name.empty() || instance.file_path != effect.source_file)
+						continue;
+					assert(instance.effect_index == effect_index);
 
-				if (const auto assembly_it = effect.assembly.find(instance.entry_point_name);
-					assembly_it != effect.assembly.end())
-					open_code_editor(instance);
+					if (const auto assembly_it = effect.assembly.find(instance.entry_point_name);
+						assembly_it != effect.assembly.end())
+						open_code_editor(instance);
+				}
 			}
-		}
 #endif
+		}
+	}
+	else if (is_loading())
+	{
+		// Textures are only loaded and effects are only reloaded or evicted once all effects finished loading
 	}
 	else if (!_textures_loaded)
 	{
-		// Now that all effects were compiled, load all textures
+		// Now that all effects were compiled, write any new compiled effect data to disk
+		if (_effect_cache != nullptr)
+			_effect_cache->flush();
+
+		// Load all textures
 		load_textures();
 	}
+	else if (!_texture_streams.empty())
+	{
+		// Finish streaming in the most detailed levels of large textures before doing anything else that may cause a hitch
+		update_texture_streams();
+	}
+	else if (!_effect_variants.empty())
+	{
+		update_effect_variants();
+	}
+	else
+	{
+		if (_effect_watcher != nullptr)
+			reload_modified_effects();
 
-#ifdef NDEBUG
-	// Lock input so it cannot be modified by other threads while we are reading it here
-	// TODO: This does not catch input happening between now and 'on_present'
-	const auto input_lock = _input->lock();
-#endif
+		if (_effect_eviction_frames != 0)
+			evict_unused_effects();
+	}
 
 	if (_should_save_screenshot && (_screenshot_save_before || !_effects_enabled))
 		save_screenshot(_effects_enabled ? L" original" : std::wstring(), !_effects_enabled);
@@ -2452,19 +4639,25 @@ void reshade::runtime::update_and_render_effects()
 	if (!_effects_enabled || _techniques.empty())
 		return;
 
-	// Update special uniform variables
-	for (effect &effect : _effects)
+	// Change to next value of variables whose associated shortcut key was pressed (only need to check them at all if any key was pressed)
+	// This is not done while effects are still loading, since changing specialized variables reloads the effect
+	if (!_ignore_shortcuts && !is_loading() && (_input->is_any_key_pressed() || _input->is_any_mouse_button_pressed()))
 	{
-		if (!effect.rendering)
-			continue;
-
-		for (uniform &variable : effect.uniforms)
+		for (size_t effect_index = 0; effect_index < _effects.size(); ++effect_index)
 		{
-			if (!_ignore_shortcuts && _input->is_key_pressed(variable.toggle_key_data, _force_shortcut_modifiers))
+			effect &effect = _effects[effect_index];
+			if (!effect.rendering)
+				continue;
+
+			bool reload_required = false;
+
+			for (uniform &variable : effect.uniforms)
 			{
+				if (!_input->is_key_pressed(variable.toggle_key_data, _force_shortcut_modifiers))
+					continue;
+
 				assert(variable.supports_toggle_key());
 
-				// Change to next value if the associated shortcut key was pressed
 				switch (variable.type.base)
 				{
 					case reshadefx::type::t_bool:
@@ -2489,13 +4682,51 @@ void reshade::runtime::update_and_render_effects()
 					}
 				}
 				save_current_preset();
+
+				reload_required |= variable.specialized;
 			}
 
-			switch (variable.special)
+			// Specialized variables only take effect after the effect was compiled again with the new value (which is cached per value)
+			if (reload_required)
+				reload_effect(effect_index);
+		}
+	}
+
+#if RESHADE_GUI
+	update_effect_render_scale();
+	update_frame_time_budget();
+#endif
+
+	// Values of special uniform variables that are the same for all effects are only computed once per frame
+	const float frame_time_ms = _last_frame_duration.count() * 1e-6f;
+	const unsigned int timer_ms = static_cast<unsigned int>(std::chrono::duration_cast<std::chrono::milliseconds>(_last_present_time - _start_time).count());
+	const uint32_t mouse_point[2] = {
+		_input->mouse_position_x() > _window_width ? _window_width : std::max(_input->mouse_position_x(), 0U),
+		_input->mouse_position_y() > _window_height ? _window_height : std::max(_input->mouse_position_y(), 0U)
+	};
+	int date[4] = {};
+	bool date_valid = false;
+
+	// Update special uniform variables
+	for (size_t effect_index = 0; effect_index < _effects.size(); ++effect_index)
+	{
+		// Effects that are still being loaded are modified by the worker threads
+		if (!_reload_active_effects.empty() && !_reload_active_effects[effect_index])
+			continue;
+
+		effect &effect = _effects[effect_index];
+		if (!effect.rendering)
+			continue;
+
+		for (const special_uniform_update &update : effect.special_uniforms)
+		{
+			uniform &variable = effect.uniforms[update.uniform_index];
+
+			switch (update.type)
 			{
 				case special_uniform::frame_time:
 				{
-					set_uniform_value(variable, _last_frame_duration.count() * 1e-6f);
+					set_uniform_value(variable, frame_time_ms);
 					break;
 				}
 				case special_uniform::frame_count:
@@ -2508,25 +4739,20 @@ void reshade::runtime::update_and_render_effects()
 				}
 				case special_uniform::random:
 				{
-					const int min = variable.annotation_as_int("min", 0, 0);
-					const int max = variable.annotation_as_int("max", 0, RAND_MAX);
-					set_uniform_value(variable, min + (std::rand() % (std::abs(max - min) + 1)));
+					set_uniform_value(variable, update.min_int + (std::rand() % (std::abs(update.max_int - update.min_int) + 1)));
 					break;
 				}
 				case special_uniform::ping_pong:
 				{
-					const float min = variable.annotation_as_float("min", 0, 0.0f);
-					const float max = variable.annotation_as_float("max", 0, 1.0f);
-					const float step_min = variable.annotation_as_float("step", 0);
-					const float step_max = variable.annotation_as_float("step", 1);
-					float increment = step_max == 0 ? step_min : (step_min + std::fmodf(static_cast<float>(std::rand()), step_max - step_min + 1));
-					const float smoothing = variable.annotation_as_float("smoothing");
+					const float min = update.min;
+					const float max = update.max;
+					float increment = update.step[1] == 0 ? update.step[0] : (update.step[0] + std::fmodf(static_cast<float>(std::rand()), update.step[1] - update.step[0] + 1));
 
 					float value[2] = { 0, 0 };
 					get_uniform_value(variable, value, 2);
 					if (value[1] >= 0)
 					{
-						increment = std::max(increment - std::max(0.0f, smoothing - (max - value[0])), 0.05f);
+						increment = std::max(increment - std::max(0.0f, update.smoothing - (max - value[0])), 0.05f);
 						increment *= _last_frame_duration.count() * 1e-9f;
 
 						if ((value[0] += increment) >= max)
@@ -2534,7 +4760,7 @@ void reshade::runtime::update_and_render_effects()
 					}
 					else
 					{
-						increment = std::max(increment - std::max(0.0f, smoothing - (value[0] - min)), 0.05f);
+						increment = std::max(increment - std::max(0.0f, update.smoothing - (value[0] - min)), 0.05f);
 						increment *= _last_frame_duration.count() * 1e-9f;
 
 						if ((value[0] -= increment) <= min)
@@ -2545,50 +4771,43 @@ void reshade::runtime::update_and_render_effects()
 				}
 				case special_uniform::date:
 				{
-					const std::time_t t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-					tm tm; localtime_s(&tm, &t);
-
-					const int value[4] = {
-						tm.tm_year + 1900,
-						tm.tm_mon + 1,
-						tm.tm_mday,
-						tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec
-					};
-					set_uniform_value(variable, value, 4);
+					if (!date_valid)
+					{
+						const std::time_t t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+						tm tm; localtime_s(&tm, &t);
+
+						date[0] = tm.tm_year + 1900;
+						date[1] = tm.tm_mon + 1;
+						date[2] = tm.tm_mday;
+						date[3] = tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec;
+						date_valid = true;
+					}
+					set_uniform_value(variable, date, 4);
 					break;
 				}
 				case special_uniform::timer:
 				{
-					const unsigned long long timer_ms = std::chrono::duration_cast<std::chrono::milliseconds>(_last_present_time - _start_time).count();
-					set_uniform_value(variable, static_cast<unsigned int>(timer_ms));
+					set_uniform_value(variable, timer_ms);
 					break;
 				}
 				case special_uniform::key:
 				{
-					if (const int keycode = variable.annotation_as_int("keycode");
-						keycode > 7 && keycode < 256)
+					if (update.mode == special_uniform_update::input_mode::toggle)
 					{
-						if (const std::string_view mode = variable.annotation_as_string("mode");
-							mode == "toggle" || variable.annotation_as_int("toggle"))
-						{
-							bool current_value = false;
-							get_uniform_value(variable, &current_value, 1);
-							if (_input->is_key_pressed(keycode))
-								set_uniform_value(variable, !current_value);
-						}
-						else if (mode == "press")
-							set_uniform_value(variable, _input->is_key_pressed(keycode));
-						else
-							set_uniform_value(variable, _input->is_key_down(keycode));
+						bool current_value = false;
+						get_uniform_value(variable, &current_value, 1);
+						if (_input->is_key_pressed(update.keycode))
+							set_uniform_value(variable, !current_value);
 					}
+					else if (update.mode == special_uniform_update::input_mode::press)
+						set_uniform_value(variable, _input->is_key_pressed(update.keycode));
+					else
+						set_uniform_value(variable, _input->is_key_down(update.keycode));
 					break;
 				}
 				case special_uniform::mouse_point:
 				{
-					const uint32_t posx = _input->mouse_position_x() > _window_width ? _window_width : std::max(_input->mouse_position_x(), 0U);
-					const uint32_t posy = _input->mouse_position_y() > _window_height ? _window_height : std::max(_input->mouse_position_y(), 0U);
-
-					set_uniform_value(variable, posx, posy);
+					set_uniform_value(variable, mouse_point[0], mouse_point[1]);
 					break;
 				}
 				case special_uniform::mouse_delta:
@@ -2598,40 +4817,29 @@ void reshade::runtime::update_and_render_effects()
 				}
 				case special_uniform::mouse_button:
 				{
-					if (const int keycode = variable.annotation_as_int("keycode");
-						keycode >= 0 && keycode < 5)
+					if (update.mode == special_uniform_update::input_mode::toggle)
 					{
-						if (const std::string_view mode = variable.annotation_as_string("mode");
-							mode == "toggle" || variable.annotation_as_int("toggle"))
-						{
-							bool current_value = false;
-							get_uniform_value(variable, &current_value, 1);
-							if (_input->is_mouse_button_pressed(keycode))
-								set_uniform_value(variable, !current_value);
-						}
-						else if (mode == "press")
-							set_uniform_value(variable, _input->is_mouse_button_pressed(keycode));
-						else
-							set_uniform_value(variable, _input->is_mouse_button_down(keycode));
+						bool current_value = false;
+						get_uniform_value(variable, &current_value, 1);
+						if (_input->is_mouse_button_pressed(update.keycode))
+							set_uniform_value(variable, !current_value);
 					}
+					else if (update.mode == special_uniform_update::input_mode::press)
+						set_uniform_value(variable, _input->is_mouse_button_pressed(update.keycode));
+					else
+						set_uniform_value(variable, _input->is_mouse_button_down(update.keycode));
 					break;
 				}
 				case special_uniform::mouse_wheel:
 				{
-					const float min = variable.annotation_as_float("min");
-					const float max = variable.annotation_as_float("max");
-					float step = variable.annotation_as_float("step");
-					if (step == 0.0f)
-						step  = 1.0f;
-
 					float value[2] = { 0, 0 };
 					get_uniform_value(variable, value, 2);
 					value[1] = _input->mouse_wheel_delta();
-					value[0] = value[0] + value[1] * step;
-					if (min != max)
+					value[0] = value[0] + value[1] * update.step[0];
+					if (update.min != update.max)
 					{
-						value[0] = std::max(value[0], min);
-						value[0] = std::min(value[0], max);
+						value[0] = std::max(value[0], update.min);
+						value[0] = std::min(value[0], update.max);
 					}
 					set_uniform_value(variable, value, 2);
 					break;
@@ -2639,7 +4847,7 @@ void reshade::runtime::update_and_render_effects()
 				case special_uniform::freepie:
 				{
 					if (freepie_io_data data;
-						freepie_io_read(variable.annotation_as_int("index"), &data))
+						freepie_io_read(update.keycode, &data))
 						set_uniform_value(variable, &data.yaw, 3 * 2);
 					break;
 				}
@@ -2672,25 +4880,84 @@ void reshade::runtime::update_and_render_effects()
 	invoke_addon_event<addon_event::reshade_begin_effects>(this, cmd_list);
 #endif
 
-	// Render all enabled techniques
-	for (technique &tech : _techniques)
+	// Handle technique shortcuts before rendering, so that the render graph matches the list of techniques that are rendered this frame
+	if (!_ignore_shortcuts)
 	{
-		if (!_ignore_shortcuts && _input->is_key_pressed(tech.toggle_key_data, _force_shortcut_modifiers))
+		for (technique &tech : _techniques)
 		{
-			if (!tech.enabled)
-				enable_technique(tech);
-			else
-				disable_technique(tech);
+			if (!_reload_active_effects.empty() && !_reload_active_effects[tech.effect_index])
+				continue;
+
+			if (_input->is_key_pressed(tech.toggle_key_data, _force_shortcut_modifiers))
+			{
+				if (!tech.enabled)
+					enable_technique(tech);
+				else
+					disable_technique(tech);
+			}
 		}
+	}
+
+	// Destroy previous versions of descriptor sets once the GPU finished executing all commands that may have referenced them (see 'update_texture_bindings')
+	const bool sampler_with_resource_view = _device->check_capability(api::device_caps::sampler_with_resource_view);
+	const uint64_t completed_fence_value = _graphics_queue->get_completed_fence_value();
+	for (size_t effect_index = 0; effect_index < _effects.size(); ++effect_index)
+	{
+		if (!_reload_active_effects.empty() && !_reload_active_effects[effect_index])
+			continue;
+
+		effect &effect = _effects[effect_index];
+		const auto retired_end = std::find_if(effect.retired_texture_sets.begin(), effect.retired_texture_sets.end(),
+			[completed_fence_value](const std::pair<uint64_t, api::descriptor_set> &retired) { return completed_fence_value < retired.first; });
+
+		for (auto it = effect.retired_texture_sets.begin(); it != retired_end; ++it)
+			_device->destroy_descriptor_sets(effect.set_layouts[sampler_with_resource_view ? 1 : 2], 1, &it->second);
 
+		effect.retired_texture_sets.erase(effect.retired_texture_sets.begin(), retired_end);
+	}
+
+	// Views replaced while streaming textures may have been referenced by the same frames (see 'update_texture_views')
+	const auto retired_views_end = std::find_if(_retired_texture_views.begin(), _retired_texture_views.end(),
+		[completed_fence_value](const retired_texture_view &retired) { return completed_fence_value < retired.fence_value; });
+	for (auto it = _retired_texture_views.begin(); it != retired_views_end; ++it)
+		_device->destroy_resource_view(it->view);
+	_retired_texture_views.erase(_retired_texture_views.begin(), retired_views_end);
+
+	update_pending_pipelines();
+
+	// Techniques with an 'interval' annotation only render every few frames and keep their last results in textures in between
+	// Their frames are staggered by technique index, so that multiple such techniques do not all render in the same frame
+	for (size_t technique_index = 0; technique_index < _techniques.size(); ++technique_index)
+	{
+		technique &tech = _techniques[technique_index];
+		tech.skipped = tech.budget_suspended || tech.pipelines_pending || (tech.render_interval > 1 && (_framecount + technique_index) % tech.render_interval != 0);
+	}
+
+	update_render_graph();
+
+#if RESHADE_GUI
+	// Only record the timeline while it is shown in the statistics window
+	_timeline_frame = _gather_timeline && !_timeline_paused ? &_timeline.begin_frame(_framecount, timeline_time_ns()) : nullptr;
+#endif
+
+	// The application may have changed the D3D9 constant registers since effects were last rendered, so have to upload uniforms again
+	_d3d9_constants_effect_index = std::numeric_limits<size_t>::max();
+	std::fill_n(_d3d9_texel_size, 2, 0.0f);
+
+	// Render all enabled techniques
+	for (technique &tech : _techniques)
+	{
 		if (tech.passes_data.empty() || !tech.enabled)
 			continue; // Ignore techniques that are not fully loaded or currently disabled
 
-		const auto time_technique_started = std::chrono::high_resolution_clock::now();
-		render_technique(tech);
-		const auto time_technique_finished = std::chrono::high_resolution_clock::now();
+		if (!tech.skipped)
+		{
+			const auto time_technique_started = std::chrono::high_resolution_clock::now();
+			render_technique(tech);
+			const auto time_technique_finished = std::chrono::high_resolution_clock::now();
 
-		tech.average_cpu_duration.append(std::chrono::duration_cast<std::chrono::nanoseconds>(time_technique_finished - time_technique_started).count());
+			tech.average_cpu_duration.append(std::chrono::duration_cast<std::chrono::nanoseconds>(time_technique_finished - time_technique_started).count());
+		}
 
 		if (tech.time_left > 0)
 		{
@@ -2700,6 +4967,17 @@ void reshade::runtime::update_and_render_effects()
 		}
 	}
 
+	// Any async compute work has to be finished before the end of the frame, since add-ons and the overlay may access the resources it used
+	finish_async_compute(nullptr);
+
+#if RESHADE_GUI
+	if (_timeline_frame != nullptr)
+	{
+		_timeline_frame->cpu_end = timeline_time_ns();
+		_timeline_frame = nullptr;
+	}
+#endif
+
 #if RESHADE_ADDON
 	invoke_addon_event<addon_event::reshade_finish_effects>(this, cmd_list);
 #endif
@@ -2709,398 +4987,1469 @@ void reshade::runtime::update_and_render_effects()
 	if (_should_save_screenshot)
 		save_screenshot(std::wstring(), true);
 }
-
-void reshade::runtime::render_technique(technique &tech)
+void reshade::runtime::render_effects_for_next_view()
 {
-	const effect &effect = _effects[tech.effect_index];
+	RESHADE_PROFILE_SCOPE("runtime::render_effects_for_next_view");
 
-	api::command_list *const cmd_list = _graphics_queue->get_immediate_command_list();
+	if (!_effects_enabled || _techniques.empty())
+		return;
 
 	api::resource backbuffer;
 	get_current_back_buffer(&backbuffer);
 
+	api::command_list *const cmd_list = _graphics_queue->get_immediate_command_list();
+	cmd_list->barrier(backbuffer, api::resource_usage::present, api::resource_usage::render_target);
+
+#if RESHADE_ADDON
+	invoke_addon_event<addon_event::reshade_begin_effects>(this, cmd_list);
+#endif
+
 #if RESHADE_GUI
-	if (_gather_gpu_statistics)
+	// Only the first view writes queries, so that there is a single set of GPU durations per technique and frame
+	// This also lets every view replay the technique recordings, which skips the per-pass setup entirely
+	const bool gather_gpu_statistics = std::exchange(_gather_gpu_statistics, false);
+	const bool gather_gpu_durations = std::exchange(_gather_gpu_durations, false);
+#endif
+
+	_d3d9_constants_effect_index = std::numeric_limits<size_t>::max();
+	std::fill_n(_d3d9_texel_size, 2, 0.0f);
+
+	// Uniform values were not modified since the first view, so the constant buffers are not uploaded again either (see 'update_effect_constants')
+	for (technique &tech : _techniques)
 	{
-		// Evaluate queries from oldest frame in queue
-		if (uint64_t timestamps[2];
-			_device->get_query_pool_results(effect.query_heap, tech.query_base_index + ((_framecount + 1) % 4) * 2, 2, timestamps, sizeof(uint64_t)))
-			tech.average_gpu_duration.append(timestamps[1] - timestamps[0]);
+		if (tech.passes_data.empty() || !tech.enabled || tech.skipped)
+			continue;
 
-		cmd_list->finish_query(effect.query_heap, api::query_type::timestamp, tech.query_base_index + (_framecount % 4) * 2);
+		render_technique(tech);
 	}
+
+	finish_async_compute(nullptr);
+
+#if RESHADE_GUI
+	_gather_gpu_statistics = gather_gpu_statistics;
+	_gather_gpu_durations = gather_gpu_durations;
 #endif
 
-#ifndef NDEBUG
-	const float debug_event_col[4] = { 1.0f, 0.8f, 0.8f, 1.0f };
-	cmd_list->begin_debug_event(tech.name.c_str(), debug_event_col);
+#if RESHADE_ADDON
+	invoke_addon_event<addon_event::reshade_finish_effects>(this, cmd_list);
 #endif
 
-	// Update shader constants
-	if (void *mapped_ptr; effect.cb.handle != 0 &&
-		_device->map_resource(effect.cb, 0, api::map_access::write_discard, &mapped_ptr))
+	cmd_list->barrier(backbuffer, api::resource_usage::render_target, api::resource_usage::present);
+}
+
+void reshade::runtime::limit_frame_latency()
+{
+	// D3D12 query results are read from a readback buffer that does not tell whether they are available yet, so there is no way to poll for completion there
+	if (!_limit_frame_latency || (_renderer_id >= 0xc000 && _renderer_id < 0x10000))
 	{
-		std::memcpy(mapped_ptr, effect.uniform_data_storage.data(), effect.uniform_data_storage.size());
-		_device->unmap_resource(effect.cb, 0);
+		_last_latency_wait_duration = {};
+		return;
 	}
-	else if (_renderer_id == 0x9000)
+
+	if (_latency_query_pool.handle == 0 && !_device->create_query_pool(api::query_type::timestamp, 2, &_latency_query_pool))
 	{
-		cmd_list->push_constants(api::shader_stage::all, effect.layout, 0, 0, static_cast<uint32_t>(effect.uniform_data_storage.size() / sizeof(uint32_t)), reinterpret_cast<const uint32_t *>(effect.uniform_data_storage.data()));
+		LOG(ERROR) << "Failed to create query pool for frame latency limiter!";
+		_limit_frame_latency = false;
+		return;
 	}
 
-	const bool sampler_with_resource_view = _device->check_capability(api::device_caps::sampler_with_resource_view);
+	// Mark the end of all work of this frame (including effects and overlay), which is what the next frame waits on
+	api::command_list *const cmd_list = _graphics_queue->get_immediate_command_list();
+	cmd_list->finish_query(_latency_query_pool, api::query_type::timestamp, _framecount % 2);
 
-	bool is_effect_stencil_cleared = false;
-	bool needs_implicit_backbuffer_copy = true; // First pass always needs the back buffer updated
+	// Submit the work of this frame before waiting, so that the GPU does not go idle after finishing the previous frame
+	_graphics_queue->flush_immediate_command_list();
 
-	for (size_t pass_index = 0; pass_index < tech.passes.size(); ++pass_index)
+	const uint64_t previous_framecount = _latency_query_framecount;
+	_latency_query_framecount = _framecount;
+	if (previous_framecount == 0 || previous_framecount + 1 != _framecount)
+		return; // No timestamp of the previous frame to wait on
+
+	// Wait until the GPU finished the previous frame, which leaves only the current one queued up when the application continues with the next, so that its input is sampled as late as possible
+	// Vulkan resets the query on the GPU right before writing it, so until then it still reports the result from two frames ago, which is why the timestamp has to have advanced as well
+	// Give up after a while in case the query never becomes available (e.g. because the device was lost), rather than freezing the application
+	const auto wait_started = std::chrono::high_resolution_clock::now();
+	for (uint64_t timestamp = 0; true; std::this_thread::yield())
 	{
-		if (needs_implicit_backbuffer_copy)
+		if (_device->get_query_pool_results(_latency_query_pool, previous_framecount % 2, 1, &timestamp, sizeof(timestamp)) && timestamp > _latency_query_timestamp)
 		{
-			// Save back buffer of previous pass
-			const api::resource resources[2] = { backbuffer, _backbuffer_texture };
-			const api::resource_usage state_old[2] = { api::resource_usage::render_target, api::resource_usage::shader_resource };
-			const api::resource_usage state_new[2] = { api::resource_usage::copy_source, api::resource_usage::copy_dest };
-
-			cmd_list->barrier(2, resources, state_old, state_new);
-			cmd_list->copy_resource(backbuffer, _backbuffer_texture);
-			cmd_list->barrier(2, resources, state_new, state_old);
+			_latency_query_timestamp = timestamp;
+			break;
 		}
 
-		const reshadefx::pass_info &pass_info = tech.passes[pass_index];
-		const technique::pass_data &pass_data = tech.passes_data[pass_index];
+		if (std::chrono::high_resolution_clock::now() - wait_started > std::chrono::milliseconds(100))
+			break;
+	}
 
-#ifndef NDEBUG
-		cmd_list->begin_debug_event((pass_info.name.empty() ? "Pass " + std::to_string(pass_index) : pass_info.name).c_str(), debug_event_col);
-#endif
+	_last_latency_wait_duration = std::chrono::high_resolution_clock::now() - wait_started;
+}
 
-		if (!pass_info.cs_entry_point.empty())
-		{
-			// Compute shaders do not write to the back buffer, so no update necessary
-			needs_implicit_backbuffer_copy = false;
+void reshade::runtime::update_memory_budget()
+{
+	// Querying the budget goes through the driver, so do not do it every frame
+	if (_last_present_time - _last_memory_budget_check < std::chrono::seconds(1))
+		return;
 
-			cmd_list->bind_pipeline(api::pipeline_stage::all_compute, pass_data.pipeline);
+	_last_memory_budget_check = _last_present_time;
 
-			std::vector<api::resource_usage> state_old(pass_data.modified_resources.size(), api::resource_usage::shader_resource);
-			std::vector<api::resource_usage> state_new(pass_data.modified_resources.size(), api::resource_usage::unordered_access);
-			cmd_list->barrier(static_cast<uint32_t>(pass_data.modified_resources.size()), pass_data.modified_resources.data(), state_old.data(), state_new.data());
+	uint64_t budget = 0, usage = 0;
+	if (!_device->get_memory_budget(&budget, &usage))
+		return;
 
-			// Reset bindings on every pass (since they get invalidated by the call to 'generate_mipmaps' below)
-			if (effect.cb.handle != 0)
-				cmd_list->bind_descriptor_sets(api::shader_stage::all_compute, effect.layout, 0, 1, &effect.cb_set);
-			if (effect.sampler_set.handle != 0)
-				assert(!sampler_with_resource_view),
-				cmd_list->bind_descriptor_sets(api::shader_stage::all_compute, effect.layout, 1, 1, &effect.sampler_set);
-			if (pass_data.texture_set.handle != 0)
-				cmd_list->bind_descriptor_sets(api::shader_stage::all_compute, effect.layout, sampler_with_resource_view ? 1 : 2, 1, &pass_data.texture_set);
-			if (pass_data.storage_set.handle != 0)
-				cmd_list->bind_descriptor_sets(api::shader_stage::all_compute, effect.layout, sampler_with_resource_view ? 2 : 3, 1, &pass_data.storage_set);
+	_memory_usage = usage;
 
-			cmd_list->dispatch(pass_info.viewport_width, pass_info.viewport_height, pass_info.viewport_dispatch_z);
+	const bool over_budget = usage > budget;
+	if (budget == _memory_budget && over_budget == _over_memory_budget)
+		return;
 
-			cmd_list->barrier(static_cast<uint32_t>(pass_data.modified_resources.size()), pass_data.modified_resources.data(), state_new.data(), state_old.data());
-		}
-		else
-		{
-			cmd_list->bind_pipeline(api::pipeline_stage::all_graphics, pass_data.pipeline);
+	if (over_budget && !_over_memory_budget)
+		LOG(WARN) << "Video memory usage of " << (usage / (1024 * 1024)) << " MiB exceeds the budget of " << (budget / (1024 * 1024)) << " MiB. Effects without enabled techniques are freed right away until usage is back within it.";
 
-			// Transition resource state for render targets
-			std::vector<api::resource_usage> state_old(pass_data.modified_resources.size(), api::resource_usage::shader_resource);
-			std::vector<api::resource_usage> state_new(pass_data.modified_resources.size(), api::resource_usage::render_target);
-			cmd_list->barrier(static_cast<uint32_t>(pass_data.modified_resources.size()), pass_data.modified_resources.data(), state_old.data(), state_new.data());
+	_memory_budget = budget;
+	_over_memory_budget = over_budget;
 
-			// Setup render targets
-			if (pass_info.render_target_names[0].empty())
-			{
-				needs_implicit_backbuffer_copy = true;
+#if RESHADE_ADDON
+	invoke_addon_event<addon_event::memory_budget_change>(_device, budget, usage);
+#endif
+}
 
-				uint32_t index = get_current_back_buffer_index();
-				index = (index * 2) + pass_info.srgb_write_enable;
-				cmd_list->begin_render_pass(_backbuffer_passes[index]);
-			}
-			else
-			{
-				needs_implicit_backbuffer_copy = false;
+#if RESHADE_GUI
+void reshade::runtime::update_effect_render_scale()
+{
+	// Adjusting the scale requires GPU time measurements of the techniques, but not the pipeline statistics the overlay shows, so request only those
+	_gather_gpu_durations = _effect_render_scale_budget > 0.0f;
 
-				cmd_list->begin_render_pass(pass_data.pass);
-			}
+	if (_effect_render_scale_budget <= 0.0f || is_loading())
+		return;
 
-			if (pass_info.clear_render_targets)
-			{
-				constexpr float clear_color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
-				cmd_list->clear_attachments(api::attachment_type::color, clear_color, 0, 0);
-			}
+	// Changing the scale reloads effects, so wait for the measurements to settle before considering another change
+	if (_last_present_time - _last_render_scale_change < std::chrono::seconds(3))
+		return;
 
-			// First pass to use the stencil buffer should clear it
-			if (pass_info.stencil_enable && !is_effect_stencil_cleared)
-			{
-				is_effect_stencil_cleared = true;
+	uint64_t gpu_duration = 0;
+	bool any_render_scaled = false;
+	for (const technique &tech : _techniques)
+	{
+		if (tech.passes_data.empty() || !tech.enabled || !_effects[tech.effect_index].render_scaled)
+			continue;
 
-				cmd_list->clear_attachments(api::attachment_type::stencil, nullptr, 1.0f, 0x0);
-			}
+		if (tech.average_gpu_duration == 0)
+			return; // Measurements for this technique are not available yet
 
-			// Reset bindings on every pass (since they get invalidated by the call to 'generate_mipmaps' below)
-			if (effect.cb.handle != 0)
-				cmd_list->bind_descriptor_sets(api::shader_stage::all_graphics, effect.layout, 0, 1, &effect.cb_set);
-			if (effect.sampler_set.handle != 0)
-				assert(!sampler_with_resource_view),
-				cmd_list->bind_descriptor_sets(api::shader_stage::all_graphics, effect.layout, 1, 1, &effect.sampler_set);
-			// Setup shader resources after binding render targets, to ensure any OM bindings by the application are unset at this point (e.g. a depth buffer that was bound to the OM and is now bound as shader resource)
-			if (pass_data.texture_set.handle != 0)
-				cmd_list->bind_descriptor_sets(api::shader_stage::all_graphics, effect.layout, sampler_with_resource_view ? 1 : 2, 1, &pass_data.texture_set);
-
-			const float viewport[6] = {
-				0.0f, 0.0f,
-				static_cast<float>(pass_info.viewport_width),
-				static_cast<float>(pass_info.viewport_height),
-				0.0f, 1.0f
-			};
-			cmd_list->bind_viewports(0, 1, viewport);
-			const int32_t scissor_rect[4] = {
-				0, 0,
-				static_cast<int32_t>(pass_info.viewport_width),
-				static_cast<int32_t>(pass_info.viewport_height)
-			};
-			cmd_list->bind_scissor_rects(0, 1, scissor_rect);
+		gpu_duration += tech.average_gpu_duration;
+		any_render_scaled = true;
+	}
 
-			if (_renderer_id == 0x9000)
-			{
-				// Set __TEXEL_SIZE__ constant (see effect_codegen_hlsl.cpp)
-				const float texel_size[4] = {
-					-1.0f / pass_info.viewport_width,
-					 1.0f / pass_info.viewport_height
-				};
-				cmd_list->push_constants(api::shader_stage::vertex, effect.layout, 0, 255 * 4, 4, texel_size);
-			}
+	if (!any_render_scaled)
+		return;
 
-			// Draw primitives
-			cmd_list->draw(pass_info.num_vertices, 1, 0, 0);
+	constexpr float scale_step = 0.125f;
+	const float min_scale = std::clamp(_effect_render_scale_min, 0.1f, 1.0f);
+	const float duration_ms = gpu_duration * 1e-6f;
 
-			cmd_list->finish_render_pass();
+	// Cost is roughly proportional to the number of pixels, so estimate the duration at a larger scale quadratically and only go up if that still fits into the budget with some headroom
+	float scale = _current_effect_render_scale;
+	if (duration_ms > _effect_render_scale_budget && scale > min_scale)
+		scale = std::max(scale - scale_step, min_scale);
+	else if (scale < 1.0f && !_over_memory_budget && duration_ms * ((scale + scale_step) * (scale + scale_step)) / (scale * scale) < _effect_render_scale_budget * 0.9f)
+		scale = std::min(scale + scale_step, 1.0f);
 
-			// Transition resource state back to shader access
-			cmd_list->barrier(static_cast<uint32_t>(pass_data.modified_resources.size()), pass_data.modified_resources.data(), state_new.data(), state_old.data());
-		}
+	if (scale == _current_effect_render_scale)
+		return;
 
-		// Generate mipmaps for modified resources
-		for (const auto modified_texture : pass_data.generate_mipmap_views)
-			cmd_list->generate_mipmaps(modified_texture);
+	LOG(INFO) << "Changing render scale of effects from " << _current_effect_render_scale << " to " << scale << " (GPU time was " << duration_ms << " ms with a budget of " << _effect_render_scale_budget << " ms).";
 
-#ifndef NDEBUG
-		cmd_list->finish_debug_event();
-#endif
-	}
+	_current_effect_render_scale = scale;
+	_last_render_scale_change = _last_present_time;
 
-#ifndef NDEBUG
-	cmd_list->finish_debug_event();
-#endif
+	// Make sure technique state is restored after reloading (see 'reload_effect')
+	// This only updates the cached preset, which is written to disk along with other edits and only if anything in it actually changed (see 'ini_file::flush_cache')
+	save_current_preset();
 
-#if RESHADE_GUI
-	if (_gather_gpu_statistics)
-		cmd_list->finish_query(effect.query_heap, api::query_type::timestamp, tech.query_base_index + (_framecount % 4) * 2 + 1);
-#endif
+	for (size_t effect_index = 0; effect_index < _effects.size(); ++effect_index)
+		if (_effects[effect_index].render_scaled && _effects[effect_index].compiled)
+			reload_effect(effect_index);
 }
-
-void reshade::runtime::enable_technique(technique &tech)
+void reshade::runtime::update_frame_time_budget()
 {
-	assert(tech.effect_index < _effects.size());
+	if (_frame_time_budget <= 0.0f)
+	{
+		for (technique &tech : _techniques)
+			tech.budget_suspended = false;
+		return;
+	}
 
-	if (!_effects[tech.effect_index].compiled)
-		return; // Cannot enable techniques that failed to compile
+	// Resuming a technique requires GPU time measurements of it, which are kept from before it was suspended
+	_gather_gpu_statistics = true;
 
-	const bool status_changed = !tech.enabled;
-	tech.enabled = true;
-	tech.time_left = tech.annotation_as_int("timeout");
+	_frame_time_budget_sum += _last_frame_duration;
+	_frame_time_budget_frames++;
 
-	// Queue effect file for compilation if it was not fully loaded yet
-	if (tech.passes_data.empty() && // Avoid adding the same effect multiple times to the queue if it contains multiple techniques that were enabled simultaneously
-		std::find(_reload_compile_queue.begin(), _reload_compile_queue.end(), tech.effect_index) == _reload_compile_queue.end())
-		_reload_compile_queue.push_back(tech.effect_index);
+	// Wait for the frame time to settle after a change before considering another one
+	if (_last_present_time - _last_frame_time_budget_change < std::chrono::seconds(1) || is_loading())
+		return;
 
-	if (status_changed) // Increase rendering reference count
-		_effects[tech.effect_index].rendering++;
-}
-void reshade::runtime::disable_technique(technique &tech)
-{
-	assert(tech.effect_index < _effects.size());
+	const float frame_time_ms = std::chrono::duration_cast<std::chrono::microseconds>(_frame_time_budget_sum).count() * 1e-3f / _frame_time_budget_frames;
 
-	const bool status_changed =  tech.enabled;
-	tech.enabled = false;
-	tech.time_left = 0;
-	tech.average_cpu_duration.clear();
-	tech.average_gpu_duration.clear();
+	_frame_time_budget_sum = {};
+	_frame_time_budget_frames = 0;
 
-	if (status_changed) // Decrease rendering reference count
-		_effects[tech.effect_index].rendering--;
-}
+	if (frame_time_ms > _frame_time_budget)
+	{
+		// Suspend the technique that comes first in the priority order and is still rendering
+		technique *candidate = nullptr;
+		for (technique &tech : _techniques)
+			if (tech.budget_priority != 0 && tech.enabled && !tech.budget_suspended && !tech.passes_data.empty() && (candidate == nullptr || tech.budget_priority < candidate->budget_priority))
+				candidate = &tech;
 
-void reshade::runtime::load_config()
-{
-	const ini_file &config = ini_file::load_cache(_config_path);
+		if (candidate == nullptr)
+			return;
 
-	config.get("INPUT", "ForceShortcutModifiers", _force_shortcut_modifiers);
-	config.get("INPUT", "KeyEffects", _effects_key_data);
-	config.get("INPUT", "KeyNextPreset", _next_preset_key_data);
-	config.get("INPUT", "KeyPerformanceMode", _performance_mode_key_data);
-	config.get("INPUT", "KeyPreviousPreset", _prev_preset_key_data);
-	config.get("INPUT", "KeyReload", _reload_key_data);
-	config.get("INPUT", "KeyScreenshot", _screenshot_key_data);
+		LOG(INFO) << "Suspending technique '" << candidate->name << "' (frame time was " << frame_time_ms << " ms with a budget of " << _frame_time_budget << " ms).";
 
-	config.get("GENERAL", "NoDebugInfo", _no_debug_info);
-	config.get("GENERAL", "NoEffectCache", _no_effect_cache);
-	config.get("GENERAL", "NoReloadOnInit", _no_reload_on_init);
-	config.get("GENERAL", "NoReloadOnInitForNonVR", _no_reload_for_non_vr);
+		candidate->budget_suspended = true;
+	}
+	else
+	{
+		// Resume techniques in reverse order, and only once the cost measured before suspending them fits into the budget with some headroom, to avoid toggling them back and forth
+		technique *candidate = nullptr;
+		for (technique &tech : _techniques)
+			if (tech.budget_suspended && (candidate == nullptr || tech.budget_priority > candidate->budget_priority))
+				candidate = &tech;
 
-	config.get("GENERAL", "EffectSearchPaths", _effect_search_paths);
-	config.get("GENERAL", "PerformanceMode", _performance_mode);
-	config.get("GENERAL", "PreprocessorDefinitions", _global_preprocessor_definitions);
-	config.get("GENERAL", "SkipLoadingDisabledEffects", _effect_load_skipping);
-	config.get("GENERAL", "TextureSearchPaths", _texture_search_paths);
-	config.get("GENERAL", "IntermediateCachePath", _intermediate_cache_path);
+		if (candidate == nullptr || frame_time_ms + candidate->average_gpu_duration * 1e-6f > _frame_time_budget * 0.9f)
+			return;
 
-	config.get("GENERAL", "PresetPath", _current_preset_path);
-	config.get("GENERAL", "PresetTransitionDelay", _preset_transition_delay);
+		LOG(INFO) << "Resuming technique '" << candidate->name << "' (frame time was " << frame_time_ms << " ms with a budget of " << _frame_time_budget << " ms).";
 
-	// Fall back to temp directory if cache path does not exist
-	if (_intermediate_cache_path.empty() || !resolve_path(_intermediate_cache_path))
-	{
-		WCHAR temp_path[MAX_PATH] = L"";
-		GetTempPathW(MAX_PATH, temp_path);
-		_intermediate_cache_path = temp_path;
+		candidate->budget_suspended = false;
 	}
 
-	// Use default if the preset file does not exist yet
-	if (!resolve_preset_path(_current_preset_path))
-		_current_preset_path = g_reshade_base_path / L"ReShadePreset.ini";
+	_last_frame_time_budget_change = _last_present_time;
+}
+#endif
 
-	config.get("SCREENSHOT", "ClearAlpha", _screenshot_clear_alpha);
-	config.get("SCREENSHOT", "FileFormat", _screenshot_format);
-	config.get("SCREENSHOT", "FileNamingFormat", _screenshot_naming);
-	config.get("SCREENSHOT", "JPEGQuality", _screenshot_jpeg_quality);
-	config.get("SCREENSHOT", "SaveBeforeShot", _screenshot_save_before);
-	config.get("SCREENSHOT", "SaveOverlayShot", _screenshot_save_gui);
-	config.get("SCREENSHOT", "SavePath", _screenshot_path);
-	config.get("SCREENSHOT", "SavePresetFile", _screenshot_include_preset);
+void reshade::runtime::update_effect_constants(api::command_list *cmd_list, effect &effect)
+{
+	const size_t dirty_begin = effect.uniform_data_dirty_begin;
+	const size_t dirty_end = std::min(effect.uniform_data_dirty_end, effect.uniform_data_storage.size());
+	if (dirty_begin >= dirty_end)
+		return;
 
-#if RESHADE_GUI
-	load_config_gui(config);
-#endif
+	// D3D12, OpenGL and Vulkan
+	if (_renderer_id >= 0xc000)
+	{
+		// Copy the modified range from the upload ring buffer, so that the buffer is never written while previous frames are still reading it on the GPU
+		// The ring buffer memory is only valid for commands submitted to the queue before its next flush, so fall back to a synchronous upload when recording to a different command list
+		void *upload_data = nullptr;
+		api::resource upload_buffer = {};
+		uint64_t upload_offset = 0;
+		if (cmd_list == _graphics_queue->get_immediate_command_list() &&
+			_graphics_queue->allocate_upload_memory(dirty_end - dirty_begin, 16, &upload_data, &upload_buffer, &upload_offset))
+		{
+			std::memcpy(upload_data, effect.uniform_data_storage.data() + dirty_begin, dirty_end - dirty_begin);
+
+			cmd_list->barrier(effect.cb, api::resource_usage::constant_buffer, api::resource_usage::copy_dest);
+			cmd_list->copy_buffer_region(upload_buffer, upload_offset, effect.cb, dirty_begin, dirty_end - dirty_begin);
+			cmd_list->barrier(effect.cb, api::resource_usage::copy_dest, api::resource_usage::constant_buffer);
+		}
+		// OpenGL without persistently mapped buffers (before 'GL_ARB_buffer_storage') has no upload ring buffer, and an update through 'glBufferSubData' would wait for previous frames still reading the buffer
+		// So invalidate the entire buffer instead, which lets the driver hand out new memory right away, but requires writing all of it again
+		else if (void *mapped_ptr; (_renderer_id & 0x10000) != 0 &&
+			_device->map_resource(effect.cb, 0, api::map_access::write_discard, &mapped_ptr))
+		{
+			std::memcpy(mapped_ptr, effect.uniform_data_storage.data(), effect.uniform_data_storage.size());
+			_device->unmap_resource(effect.cb, 0);
+		}
+		else
+		{
+			_device->upload_buffer_region(effect.uniform_data_storage.data() + dirty_begin, effect.cb, dirty_begin, dirty_end - dirty_begin);
+		}
+
+		effect.uniform_data_dirty_begin = std::numeric_limits<size_t>::max();
+		effect.uniform_data_dirty_end = 0;
+		return;
+	}
+
+	// D3D10/11 rename the buffer on every discard, which requires writing all of it again
+	if (void *mapped_ptr;
+		_device->map_resource(effect.cb, 0, api::map_access::write_discard, &mapped_ptr))
+	{
+		std::memcpy(mapped_ptr, effect.uniform_data_storage.data(), effect.uniform_data_storage.size());
+		_device->unmap_resource(effect.cb, 0);
+
+		effect.uniform_data_dirty_begin = std::numeric_limits<size_t>::max();
+		effect.uniform_data_dirty_end = 0;
+	}
 }
-void reshade::runtime::save_config() const
+void reshade::runtime::update_d3d9_effect_constants(api::command_list *cmd_list, effect &effect, const technique &tech)
 {
-	ini_file &config = ini_file::load_cache(_config_path);
+	const size_t effect_index = &effect - _effects.data();
+	const bool modified = effect.uniform_data_dirty_begin < effect.uniform_data_dirty_end;
 
-	config.set("INPUT", "ForceShortcutModifiers", _force_shortcut_modifiers);
-	config.set("INPUT", "KeyEffects", _effects_key_data);
-	config.set("INPUT", "KeyNextPreset", _next_preset_key_data);
-	config.set("INPUT", "KeyPerformanceMode", _performance_mode_key_data);
-	config.set("INPUT", "KeyPreviousPreset", _prev_preset_key_data);
-	config.set("INPUT", "KeyReload", _reload_key_data);
-	config.set("INPUT", "KeyScreenshot", _screenshot_key_data);
+	// Constant registers are shared by all effects, so only those of the effect that uploaded its uniforms last are still in them
+	if (effect_index != _d3d9_constants_effect_index || modified)
+	{
+		_d3d9_vs_constant_registers[0] = _d3d9_vs_constant_registers[1] = 0;
+		_d3d9_ps_constant_registers[0] = _d3d9_ps_constant_registers[1] = 0;
+	}
 
-	config.set("GENERAL", "NoDebugInfo", _no_debug_info);
-	config.set("GENERAL", "NoEffectCache", _no_effect_cache);
-	config.set("GENERAL", "NoReloadOnInit", _no_reload_on_init);
-	config.set("GENERAL", "NoReloadOnInitForNonVR", _no_reload_for_non_vr);
+	const auto upload = [&](api::shader_stage stage, const uint32_t (&range)[2], uint32_t (&uploaded_range)[2]) {
+		if (range[0] >= range[1] || (range[0] >= uploaded_range[0] && range[1] <= uploaded_range[1]))
+			return;
 
-	config.set("GENERAL", "EffectSearchPaths", _effect_search_paths);
-	config.set("GENERAL", "PerformanceMode", _performance_mode);
-	config.set("GENERAL", "PreprocessorDefinitions", _global_preprocessor_definitions);
-	config.set("GENERAL", "SkipLoadingDisabledEffects", _effect_load_skipping);
-	config.set("GENERAL", "TextureSearchPaths", _texture_search_paths);
-	config.set("GENERAL", "IntermediateCachePath", _intermediate_cache_path);
+		// Every constant register consists of four 32-bit values
+		cmd_list->push_constants(stage, effect.layout, 0, range[0] * 4, (range[1] - range[0]) * 4, effect.uniform_data_storage.data() + range[0] * 16);
 
-	// Use ReShade DLL directory as base for relative preset paths (see 'resolve_preset_path')
-	std::filesystem::path relative_preset_path = _current_preset_path.lexically_proximate(g_reshade_base_path);
-	if (relative_preset_path.wstring().rfind(L"..", 0) != std::wstring::npos)
-		relative_preset_path = _current_preset_path; // Do not use relative path if preset is in a parent directory
-	if (relative_preset_path.is_relative()) // Prefix preset path with dot character to better indicate it being a relative path
-		relative_preset_path = L"." / relative_preset_path;
-	config.set("GENERAL", "PresetPath", relative_preset_path);
-	config.set("GENERAL", "PresetTransitionDelay", _preset_transition_delay);
+		if (uploaded_range[0] >= uploaded_range[1])
+			uploaded_range[0] = range[0], uploaded_range[1] = range[1];
+		else if (range[0] <= uploaded_range[1] && range[1] >= uploaded_range[0])
+			uploaded_range[0] = std::min(uploaded_range[0], range[0]), uploaded_range[1] = std::max(uploaded_range[1], range[1]);
+		else
+			uploaded_range[0] = range[0], uploaded_range[1] = range[1]; // Only track one contiguous range, so forget about the previous one if they are disjoint
+	};
 
-	config.set("SCREENSHOT", "ClearAlpha", _screenshot_clear_alpha);
-	config.set("SCREENSHOT", "FileFormat", _screenshot_format);
-	config.set("SCREENSHOT", "FileNamingFormat", _screenshot_naming);
-	config.set("SCREENSHOT", "JPEGQuality", _screenshot_jpeg_quality);
-	config.set("SCREENSHOT", "SaveBeforeShot", _screenshot_save_before);
-	config.set("SCREENSHOT", "SaveOverlayShot", _screenshot_save_gui);
-	config.set("SCREENSHOT", "SavePath", _screenshot_path);
-	config.set("SCREENSHOT", "SavePresetFile", _screenshot_include_preset);
+	upload(api::shader_stage::vertex, tech.vs_constant_registers, _d3d9_vs_constant_registers);
+	upload(api::shader_stage::pixel, tech.ps_constant_registers, _d3d9_ps_constant_registers);
 
-#if RESHADE_GUI
-	save_config_gui(config);
-#endif
-}
+	_d3d9_constants_effect_index = effect_index;
 
-void reshade::runtime::load_current_preset()
+	effect.uniform_data_dirty_begin = std::numeric_limits<size_t>::max();
+	effect.uniform_data_dirty_end = 0;
+}
+void reshade::runtime::evict_unused_effects()
 {
-	_preset_save_success = true;
-
-	ini_file config = ini_file::load_cache(_config_path); // Copy config, because reference becomes invalid in the next line
-	const ini_file &preset = ini_file::load_cache(_current_preset_path);
-
-	std::vector<std::string> technique_list;
-	preset.get({}, "Techniques", technique_list);
-	std::vector<std::string> sorted_technique_list;
-	preset.get({}, "TechniqueSorting", sorted_technique_list);
-	std::vector<std::string> preset_preprocessor_definitions;
-	preset.get({}, "PreprocessorDefinitions", preset_preprocessor_definitions);
+	std::vector<size_t> evicted_effects;
+	const uint64_t completed_fence_value = _graphics_queue->get_completed_fence_value();
 
-	// Recompile effects if preprocessor definitions have changed or running in performance mode (in which case all preset values are compile-time constants)
-	if (_reload_remaining_effects != 0) // ... unless this is the 'load_current_preset' call in 'update_and_render_effects'
+	for (size_t effect_index = 0; effect_index < _effects.size(); ++effect_index)
 	{
-		if (_performance_mode || preset_preprocessor_definitions != _preset_preprocessor_definitions)
-		{
-			_preset_preprocessor_definitions = std::move(preset_preprocessor_definitions);
-			reload_effects();
-			return; // Preset values are loaded in 'update_and_render_effects' during effect loading
-		}
+		effect &effect = _effects[effect_index];
 
-		if (std::find_if(technique_list.begin(), technique_list.end(), [this](const std::string &technique_name) {
-				if (const size_t at_pos = technique_name.find('@'); at_pos == std::string::npos)
-					return true;
-				else if (const auto it = std::find_if(_effects.begin(), _effects.end(),
-					[effect_name = static_cast<std::string_view>(technique_name).substr(at_pos + 1)](const effect &effect) { return effect_name == effect.source_file.filename().u8string(); }); it == _effects.end())
-					return true;
-				else
-					return it->skipped; }) != technique_list.end())
+		if (effect.rendering != 0)
 		{
-			reload_effects();
-			return;
+			effect.frames_without_rendering = 0;
+			continue;
 		}
-	}
 
-	if (sorted_technique_list.empty())
-		config.get("GENERAL", "TechniqueSorting", sorted_technique_list);
-	if (sorted_technique_list.empty())
-		sorted_technique_list = technique_list;
+		// All commands that used resources of this effect were recorded before it stopped rendering
+		if (effect.frames_without_rendering == 0)
+			effect.last_render_fence_value = _graphics_queue->get_pending_fence_value();
+		if (effect.frames_without_rendering < _effect_eviction_frames)
+			effect.frames_without_rendering++;
 
-	// Reorder techniques
-	std::sort(_techniques.begin(), _techniques.end(), [this, &sorted_technique_list](const technique &lhs, const technique &rhs) {
-		const std::string lhs_unique = lhs.name + '@' + _effects[lhs.effect_index].source_file.filename().u8string();
-		const std::string rhs_unique = rhs.name + '@' + _effects[rhs.effect_index].source_file.filename().u8string();
-		auto lhs_it = std::find(sorted_technique_list.begin(), sorted_technique_list.end(), lhs_unique);
-		auto rhs_it = std::find(sorted_technique_list.begin(), sorted_technique_list.end(), rhs_unique);
-		if (lhs_it == sorted_technique_list.end())
-			lhs_it = std::find(sorted_technique_list.begin(), sorted_technique_list.end(), lhs.name);
-		if (rhs_it == sorted_technique_list.end())
-			rhs_it = std::find(sorted_technique_list.begin(), sorted_technique_list.end(), rhs.name);
-		return lhs_it < rhs_it; });
+		// Do not wait the configured number of frames while video memory is over budget (see 'update_memory_budget')
+		if (effect.frames_without_rendering < _effect_eviction_frames && !_over_memory_budget)
+			continue;
 
-	// Compute times since the transition has started and how much is left till it should end
-	auto transition_time = std::chrono::duration_cast<std::chrono::microseconds>(_last_present_time - _last_preset_switching_time).count();
-	auto transition_ms_left = _preset_transition_delay - transition_time / 1000;
-	auto transition_ms_left_from_last_frame = transition_ms_left + std::chrono::duration_cast<std::chrono::microseconds>(_last_frame_duration).count() / 1000;
+		// Defer freeing until the GPU finished those commands, instead of waiting for the device to go idle
+		if (completed_fence_value < effect.last_render_fence_value)
+			continue;
 
-	if (_is_in_between_presets_transition && transition_ms_left <= 0)
-		_is_in_between_presets_transition = false;
+		// Only effects that were initialized have anything to free
+		if (std::any_of(_techniques.begin(), _techniques.end(),
+				[effect_index](const technique &tech) { return tech.effect_index == effect_index && !tech.passes_data.empty(); }))
+			evicted_effects.push_back(effect_index);
+	}
+
+	if (evicted_effects.empty())
+		return;
 
-	for (effect &effect : _effects)
+	for (const size_t effect_index : evicted_effects)
 	{
-		for (uniform &variable : effect.uniforms)
-		{
-			if (variable.special != special_uniform::none)
+		LOG(INFO) << "Freeing resources of " << _effects[effect_index].source_file << " after none of its techniques were enabled for " << _effect_eviction_frames << " frames.";
+
+		uninit_effect(effect_index);
+
+		// Textures shared with other effects may still be in use by those, so only destroy private ones
+		for (texture &tex : _textures)
+			if (tex.effect_index == effect_index && tex.shared.size() <= 1)
+				destroy_texture(tex);
+	}
+
+#if RESHADE_GUI
+	_preview_texture.handle = 0;
+#endif
+}
+void reshade::runtime::release_effect_code(size_t effect_index)
+{
+	// Without the effect cache there would be no way to get the code back when the effect has to be initialized again
+	if (!_low_memory_mode || _no_effect_cache || _effect_cache == nullptr)
+		return;
+
+	effect &effect = _effects[effect_index];
+
+#if RESHADE_GUI
+	// Keep the code of effects that are currently shown in an editor
+	if (std::any_of(_editors.begin(), _editors.end(),
+			[effect_index](const editor_instance &instance) { return instance.effect_index == effect_index && !instance.entry_point_name.empty(); }))
+		return;
+#endif
+
+	std::string().swap(effect.module.hlsl);
+	std::vector<uint32_t>().swap(effect.module.spirv);
+	for (reshadefx::entry_point &entry_point : effect.module.entry_points)
+		std::vector<uint32_t>().swap(entry_point.spirv);
+
+	// Keep the map entries, so that the list of entry points with assembly can still be shown
+	for (auto &[entry_point_name, assembly] : effect.assembly)
+		std::string().swap(assembly);
+
+	effect.code_released = true;
+}
+bool reshade::runtime::restore_effect_code(effect &effect) const
+{
+	if (!effect.code_released)
+		return true;
+
+	// The parsed module is stored in the effect cache under the same hash it was loaded with, so only need to move over the generated code from it
+	reshade::effect cached_effect;
+	if (!load_effect_cache(effect.source_file, effect.source_hash, cached_effect) ||
+		cached_effect.module.entry_points.size() != effect.module.entry_points.size())
+		return false;
+
+	effect.module.hlsl = std::move(cached_effect.module.hlsl);
+	effect.module.spirv = std::move(cached_effect.module.spirv);
+	for (size_t i = 0; i < effect.module.entry_points.size(); ++i)
+		effect.module.entry_points[i].spirv = std::move(cached_effect.module.entry_points[i].spirv);
+
+	// Assembly is optional, so missing entries are not an error
+	for (auto &[entry_point_name, assembly] : effect.assembly)
+	{
+		std::vector<char> cso;
+		if (const auto hash_it = effect.assembly_hashes.find(entry_point_name); hash_it != effect.assembly_hashes.end())
+			load_effect_cache(effect.source_file, entry_point_name, hash_it->second, cso, assembly);
+	}
+
+	effect.code_released = false;
+
+	return true;
+}
+
+void reshade::runtime::update_pending_pipelines()
+{
+	for (technique &tech : _techniques)
+	{
+		if (!tech.pipelines_pending)
+			continue;
+
+		// Only poll, so that checking on pipelines that are still being built is spread over frames instead of blocking
+		if (std::any_of(tech.pending_pipelines.begin(), tech.pending_pipelines.end(),
+				[](const std::future<api::pipeline> &pipeline) { return pipeline.valid() && pipeline.wait_for(std::chrono::seconds(0)) != std::future_status::ready; }))
+			continue;
+
+		finish_pipeline_creation(tech);
+
+		bool success = true;
+		const bool ready = std::all_of(tech.passes_data.begin(), tech.passes_data.end(),
+			[this, &success](const technique::pass_data &pass_data) {
+				if (pass_data.pipeline.handle != 0)
+					return query_pipeline_status(pass_data.pipeline, success);
+				success = false; // Creation on a worker thread failed
+				return true;
+			});
+		if (!ready)
+			continue;
+
+		tech.pipelines_pending = false;
+
+		if (!success)
+		{
+			effect &effect = _effects[tech.effect_index];
+			effect.errors += "error: failed to create pipelines for technique '" + tech.name + "'\n";
+
+			LOG(ERROR) << "Failed to create pipelines for technique '" << tech.name << "' in " << effect.source_file << '!';
+
+			disable_technique(tech);
+
+			_last_reload_successfull = false;
+		}
+	}
+}
+
+void reshade::runtime::finish_pipeline_creation(technique &tech)
+{
+	for (size_t pass_index = 0; pass_index < tech.pending_pipelines.size(); ++pass_index)
+		if (tech.pending_pipelines[pass_index].valid())
+			tech.passes_data[pass_index].pipeline = tech.pending_pipelines[pass_index].get();
+
+	tech.pending_pipelines.clear();
+}
+
+void reshade::runtime::render_technique(technique &tech)
+{
+	effect &effect = _effects[tech.effect_index];
+
+	// Execute compute-only techniques on the async compute queue, so that they can overlap with subsequent graphics work that does not depend on them
+	const bool async_compute = tech.async_compute && _async_compute_queue != nullptr;
+	if (async_compute)
+		begin_async_compute(tech);
+	else
+		finish_async_compute(&tech);
+
+	api::command_list *cmd_list = (async_compute ? _async_compute_queue : _graphics_queue)->get_immediate_command_list();
+
+	// Time stamps are written to different queries every frame, so cannot be part of commands that are executed again
+#if RESHADE_GUI
+	const bool can_record = !async_compute && !tech.sky_masked && !_gather_gpu_statistics && !_gather_gpu_durations;
+#else
+	const bool can_record = !async_compute && !tech.sky_masked;
+#endif
+
+	// Commands reference the current back buffer, so are recorded separately for every back buffer of the swap chain
+	const uint32_t back_buffer_index = get_current_back_buffer_index();
+
+	if (can_record && back_buffer_index < tech.recordings.size() && tech.recordings[back_buffer_index] != 0)
+	{
+		// Constants are updated through a separate buffer write, so that the recorded commands pick up the current values without having to record them again
+		if (effect.cb.handle != 0)
+			update_effect_constants(cmd_list, effect);
+
+		execute_technique_recording(tech.recordings[back_buffer_index]);
+		return;
+	}
+
+	api::command_list *const recording_cmd_list = can_record ? begin_technique_recording() : nullptr;
+	if (recording_cmd_list != nullptr)
+	{
+		if (effect.cb.handle != 0)
+			update_effect_constants(cmd_list, effect);
+
+		cmd_list = recording_cmd_list;
+	}
+
+	api::resource backbuffer;
+	get_current_back_buffer(&backbuffer);
+
+#if RESHADE_GUI
+	// Record CPU scopes of this technique and its passes into the frame timeline while it is shown in the statistics window
+	uint32_t timeline_event = std::numeric_limits<uint32_t>::max();
+	const auto add_timeline_event = [this](frame_timeline::event::kind type, uint32_t pass_index, std::string name, uint64_t cpu_beg) {
+		frame_timeline::event &e = _timeline_frame->events.emplace_back();
+		e.type = type;
+		e.pass_index = pass_index;
+		e.name = std::move(name);
+		e.cpu_beg = cpu_beg;
+		e.cpu_end = timeline_time_ns();
+	};
+
+	if (_timeline_frame != nullptr)
+	{
+		timeline_event = static_cast<uint32_t>(_timeline_frame->events.size());
+		add_timeline_event(frame_timeline::event::technique, 0, tech.name, timeline_time_ns());
+	}
+
+	bool write_timestamps = false;
+	bool write_statistics = false;
+	if (_gather_gpu_statistics || _gather_gpu_durations)
+	{
+		// Evaluate queries of previous frames in order, but stop at the first one that is not finished yet instead of waiting for it
+		while (tech.queries.oldest_due())
+		{
+			const uint32_t oldest_set = tech.queries.oldest_set();
+
+			_timestamp_query_results.resize(tech.queries.set_size);
+			if (!_device->get_query_pool_results(effect.query_heap, tech.queries.oldest_index(), tech.queries.set_size, _timestamp_query_results.data(), sizeof(uint64_t)))
+				break;
+
+			// Statistics were written in the same frame as the time stamps, so should be available as well
+			if (api::pipeline_statistics statistics = {};
+				tech.queries.has_statistics[oldest_set] && _device->get_query_pool_results(effect.statistics_query_heap, tech.queries.oldest_statistics_index(), 1, &statistics, sizeof(statistics)))
+			{
+				tech.average_pixel_invocations.append(statistics.pixel_shader_invocations);
+				tech.average_compute_invocations.append(statistics.compute_shader_invocations);
+				tech.average_primitives.append(statistics.input_assembler_primitives);
+			}
+
+			tech.queries.pop();
+
+			tech.average_gpu_duration.append(_timestamp_query_results.back() - _timestamp_query_results.front());
+			tech.gpu_duration_histogram.append(_timestamp_query_results.back() - _timestamp_query_results.front());
+			for (size_t pass_index = 0; pass_index < tech.passes_data.size(); ++pass_index)
+				tech.passes_data[pass_index].average_gpu_duration.append(_timestamp_query_results[pass_index * 2 + 2] - _timestamp_query_results[pass_index * 2]);
+
+			// Fill in GPU times of the events recorded for this technique in the frame the queries were written in, if that is still part of the timeline
+			if (frame_timeline::frame *const frame = _timeline.find_frame(tech.queries.frame_index[oldest_set]);
+				frame != nullptr && tech.queries.timeline_event[oldest_set] < frame->events.size() && frame->events[tech.queries.timeline_event[oldest_set]].name == tech.name)
+			{
+				for (size_t i = tech.queries.timeline_event[oldest_set]; i < frame->events.size(); ++i)
+				{
+					frame_timeline::event &e = frame->events[i];
+					if ((e.type == frame_timeline::event::technique && i != tech.queries.timeline_event[oldest_set]) || e.type == frame_timeline::event::hook)
+						break;
+
+					switch (e.type)
+					{
+					case frame_timeline::event::technique:
+						e.gpu_beg = _timestamp_query_results.front();
+						e.gpu_end = _timestamp_query_results.back();
+						break;
+					case frame_timeline::event::copy:
+						e.gpu_beg = _timestamp_query_results[e.pass_index * 2];
+						e.gpu_end = _timestamp_query_results[e.pass_index * 2 + 1];
+						break;
+					case frame_timeline::event::pass:
+						e.gpu_beg = _timestamp_query_results[e.pass_index * 2 + 1];
+						e.gpu_end = _timestamp_query_results[e.pass_index * 2 + 2];
+						break;
+					}
+				}
+			}
+		}
+
+		// Skip measuring this frame if the GPU is so far behind that all query sets are still in use
+		write_timestamps = !tech.queries.full();
+		if (write_timestamps)
+			cmd_list->finish_query(effect.query_heap, api::query_type::timestamp, tech.queries.current_index());
+
+		// Pipeline statistics with graphics counters are not available on compute queues
+		write_statistics = write_timestamps && effect.statistics_query_heap.handle != 0 && !async_compute && _gather_gpu_statistics;
+		if (write_statistics)
+			cmd_list->begin_query(effect.statistics_query_heap, api::query_type::pipeline_statistics, tech.queries.current_statistics_index());
+	}
+#endif
+
+#ifndef NDEBUG
+	const float debug_event_col[4] = { 1.0f, 0.8f, 0.8f, 1.0f };
+	cmd_list->begin_debug_event(tech.name.c_str(), debug_event_col);
+#endif
+
+	// Update shader constants (only once for all techniques of an effect and only if any of them changed)
+	if (effect.cb.handle != 0)
+	{
+		update_effect_constants(cmd_list, effect);
+	}
+	else if (_renderer_id == 0x9000)
+	{
+		update_d3d9_effect_constants(cmd_list, effect, tech);
+	}
+
+	// Descriptor sets stay bound across pipeline changes in D3D12 and Vulkan, so only need to bind those that changed between passes
+	// D3D10/11 unbind shader resource views that conflict with render targets set up by a pass, so always have to rebind everything there
+	const bool skip_redundant_bindings = (_renderer_id >= 0xc000 && _renderer_id < 0x10000) || (_renderer_id >= 0x20000);
+	api::descriptor_set current_sets[2][4] = {}; // Indexed by graphics or compute and then the set index in the pipeline layout
+
+	const auto bind_descriptor_set = [&](api::shader_stage stages, uint32_t index, api::descriptor_set set) {
+		api::descriptor_set &current_set = current_sets[stages == api::shader_stage::all_compute][index];
+		if (skip_redundant_bindings && current_set == set)
+			return;
+
+		cmd_list->bind_descriptor_sets(stages, effect.layout, index, 1, &set);
+		current_set = set;
+	};
+
+	// Mipmaps of modified textures are only generated once a later pass samples them or the technique finished, so that textures written by multiple passes only have them generated once
+	_pending_mipmaps.clear();
+
+	// Generates the pending mipmaps of textures the specified range of passes samples, or all of them if no range was specified
+	const auto generate_pending_mipmaps = [&](const technique::pass_data *first_pass_data, const technique::pass_data *last_pass_data) {
+		bool has_generated = false;
+
+		for (auto it = _pending_mipmaps.begin(); it != _pending_mipmaps.end();)
+		{
+			bool is_sampled = first_pass_data == nullptr;
+			for (const technique::pass_data *pass_data = first_pass_data; pass_data != nullptr && pass_data <= last_pass_data && !is_sampled; ++pass_data)
+				is_sampled = std::find(pass_data->sampled_resources.begin(), pass_data->sampled_resources.end(), it->first) != pass_data->sampled_resources.end();
+
+			if (!is_sampled)
+			{
+				++it;
+				continue;
+			}
+
+			cmd_list->generate_mipmaps(it->second);
+			it = _pending_mipmaps.erase(it);
+			has_generated = true;
+		}
+
+		// Mipmap generation may use its own pipeline layout and descriptors, so have to bind everything again in the next pass
+		if (has_generated)
+			std::memset(current_sets, 0, sizeof(current_sets));
+	};
+
+	bool is_effect_stencil_cleared = false;
+
+	for (size_t pass_index = 0; pass_index < tech.passes.size(); ++pass_index)
+	{
+		const reshadefx::pass_info &pass_info = tech.passes[pass_index];
+		const technique::pass_data &pass_data = tech.passes_data[pass_index];
+
+#if RESHADE_GUI
+		uint64_t timeline_pass_beg = _timeline_frame != nullptr ? timeline_time_ns() : 0;
+#endif
+
+		// Passes merged into a single render pass cannot generate mipmaps in between, so have to do so for all passes of the render pass before it begins
+		if (!_pending_mipmaps.empty() && !pass_data.merged_with_prev)
+		{
+			size_t last_pass_index = pass_index;
+			while (tech.passes_data[last_pass_index].merged_with_next)
+				++last_pass_index;
+
+			generate_pending_mipmaps(&pass_data, &tech.passes_data[last_pass_index]);
+		}
+
+		// Only copy back buffer if it was modified since the last copy (see 'update_render_graph')
+		// This was already done on the graphics queue for techniques executed on the async compute queue (see 'begin_async_compute')
+		if (pass_data.copy_backbuffer && !async_compute)
+		{
+			// Save back buffer of previous pass
+			const api::resource resources[2] = { backbuffer, _backbuffer_texture };
+			const api::resource_usage state_old[2] = { api::resource_usage::render_target, api::resource_usage::shader_resource };
+			const api::resource_usage state_new[2] = { api::resource_usage::copy_source, api::resource_usage::copy_dest };
+
+			cmd_list->barrier(2, resources, state_old, state_new);
+			cmd_list->copy_resource(backbuffer, _backbuffer_texture);
+			cmd_list->barrier(2, resources, state_new, state_old);
+
+#if RESHADE_GUI
+			if (_timeline_frame != nullptr)
+			{
+				add_timeline_event(frame_timeline::event::copy, static_cast<uint32_t>(pass_index), "Back buffer copy", timeline_pass_beg);
+				timeline_pass_beg = _timeline_frame->events.back().cpu_end;
+			}
+#endif
+		}
+
+#if RESHADE_GUI
+		if (write_timestamps)
+			cmd_list->finish_query(effect.query_heap, api::query_type::timestamp, tech.queries.current_index() + 1 + static_cast<uint32_t>(pass_index) * 2);
+#endif
+
+#ifndef NDEBUG
+		cmd_list->begin_debug_event((pass_info.name.empty() ? "Pass " + std::to_string(pass_index) : pass_info.name).c_str(), debug_event_col);
+#endif
+
+		if (!pass_info.cs_entry_point.empty())
+		{
+			cmd_list->bind_pipeline(api::pipeline_stage::all_compute, pass_data.pipeline);
+
+			// Compute queues do not support the pixel shader resource state, so resources are kept in the non-pixel shader resource state while they are in use by the async compute queue
+			const api::resource_usage *const state_old = async_compute ? pass_data.shader_resource_non_pixel_states.data() : pass_data.shader_resource_states.data();
+			const api::resource_usage *const state_new = pass_data.target_states.data();
+			cmd_list->barrier(static_cast<uint32_t>(pass_data.modified_resources.size()), pass_data.modified_resources.data(), state_old, state_new);
+
+			// Bindings are invalidated by the call to 'generate_mipmaps' below, in which case they are set again here
+			if (effect.cb.handle != 0)
+				bind_descriptor_set(api::shader_stage::all_compute, 0, effect.cb_set);
+			if (effect.sampler_set.handle != 0)
+				assert(pass_data.texture_set_index == 2),
+				bind_descriptor_set(api::shader_stage::all_compute, 1, effect.sampler_set);
+			if (pass_data.texture_set.handle != 0)
+				bind_descriptor_set(api::shader_stage::all_compute, pass_data.texture_set_index, pass_data.texture_set);
+			if (pass_data.storage_set.handle != 0)
+				bind_descriptor_set(api::shader_stage::all_compute, pass_data.storage_set_index, pass_data.storage_set);
+
+			cmd_list->dispatch(pass_info.viewport_width, pass_info.viewport_height, pass_info.viewport_dispatch_z);
+
+			cmd_list->barrier(static_cast<uint32_t>(pass_data.modified_resources.size()), pass_data.modified_resources.data(), state_new, state_old);
+		}
+		else
+		{
+			cmd_list->bind_pipeline(api::pipeline_stage::all_graphics, pass_data.pipeline);
+
+			if (pass_data.coarse_shading)
+			{
+				const api::dynamic_state state = api::dynamic_state::shading_rate;
+				const uint32_t value = pass_info.shading_rate;
+				cmd_list->bind_pipeline_states(1, &state, &value);
+			}
+
+			const api::resource_usage *const state_old = pass_data.shader_resource_states.data();
+			const api::resource_usage *const state_new = pass_data.target_states.data();
+
+			// Render targets are still bound and in the right state if the render pass was kept open by the previous pass
+			if (!pass_data.merged_with_prev)
+			{
+				// Transition resource state for render targets
+				cmd_list->barrier(static_cast<uint32_t>(pass_data.modified_resources.size()), pass_data.modified_resources.data(), state_old, state_new);
+
+				// Setup render targets
+				if (pass_info.render_target_names[0].empty())
+				{
+					uint32_t index = get_current_back_buffer_index();
+					index = (index * 2) + pass_info.srgb_write_enable;
+					cmd_list->begin_render_pass(_backbuffer_passes[index]);
+				}
+				else
+				{
+					cmd_list->begin_render_pass(pass_data.pass);
+				}
+			}
+
+			if (pass_info.clear_render_targets)
+			{
+				constexpr float clear_color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+				cmd_list->clear_attachments(api::attachment_type::color, clear_color, 0, 0);
+			}
+
+			// First pass to use the stencil buffer should clear it
+			if (pass_info.stencil_enable && !is_effect_stencil_cleared)
+			{
+				is_effect_stencil_cleared = true;
+
+				cmd_list->clear_attachments(api::attachment_type::stencil, nullptr, 1.0f, 0x0);
+			}
+			// First masked pass marks the hidden area and sky tiles in the stencil buffer, since effects of other techniques may have overwritten it with their own stencil values
+			if ((pass_data.hidden_area_masked || pass_data.sky_masked) && !is_effect_stencil_cleared)
+			{
+				is_effect_stencil_cleared = true;
+
+				cmd_list->clear_attachments(api::attachment_type::stencil, nullptr, 1.0f, 0x0);
+				if (!_sky_rects.empty() && tech.sky_masked)
+					cmd_list->clear_attachments(api::attachment_type::stencil, nullptr, 1.0f, 0x2, static_cast<uint32_t>(_sky_rects.size() / 4), _sky_rects.data());
+				// Cleared last, so that the hidden area takes precedence where both overlap (shading those pixels in sky-masked passes is wasted, but harmless)
+				if (!_hidden_area_rects.empty())
+					cmd_list->clear_attachments(api::attachment_type::stencil, nullptr, 1.0f, 0x1, static_cast<uint32_t>(_hidden_area_rects.size() / 4), _hidden_area_rects.data());
+			}
+
+			// Bindings are invalidated by the call to 'generate_mipmaps' below, in which case they are set again here
+			if (effect.cb.handle != 0)
+				bind_descriptor_set(api::shader_stage::all_graphics, 0, effect.cb_set);
+			if (effect.sampler_set.handle != 0)
+				assert(pass_data.texture_set_index == 2),
+				bind_descriptor_set(api::shader_stage::all_graphics, 1, effect.sampler_set);
+			// Setup shader resources after binding render targets, to ensure any OM bindings by the application are unset at this point (e.g. a depth buffer that was bound to the OM and is now bound as shader resource)
+			if (pass_data.texture_set.handle != 0)
+				bind_descriptor_set(api::shader_stage::all_graphics, pass_data.texture_set_index, pass_data.texture_set);
+
+			cmd_list->bind_viewports(0, 1, pass_data.viewport);
+			cmd_list->bind_scissor_rects(0, 1, pass_data.scissor_rect);
+
+			if (_renderer_id == 0x9000)
+			{
+				// Set __TEXEL_SIZE__ constant (see effect_codegen_hlsl.cpp), unless the previous pass already used the same viewport size
+				const float texel_size[4] = {
+					-1.0f / pass_info.viewport_width,
+					 1.0f / pass_info.viewport_height
+				};
+				if (texel_size[0] != _d3d9_texel_size[0] || texel_size[1] != _d3d9_texel_size[1])
+				{
+					cmd_list->push_constants(api::shader_stage::vertex, effect.layout, 0, 255 * 4, 4, texel_size);
+					_d3d9_texel_size[0] = texel_size[0];
+					_d3d9_texel_size[1] = texel_size[1];
+				}
+			}
+
+			// Draw primitives (unless the scissor rectangle is empty, in which case there is nothing to shade)
+			if (pass_data.scissor_rect[2] > pass_data.scissor_rect[0] && pass_data.scissor_rect[3] > pass_data.scissor_rect[1])
+				cmd_list->draw(pass_info.num_vertices, 1, 0, 0);
+
+			// The shading rate is command list state in D3D12, so reset it to not affect subsequent passes
+			if (pass_data.coarse_shading)
+			{
+				const api::dynamic_state state = api::dynamic_state::shading_rate;
+				const uint32_t value = 0;
+				cmd_list->bind_pipeline_states(1, &state, &value);
+			}
+
+			if (!pass_data.merged_with_next)
+			{
+				cmd_list->finish_render_pass();
+
+				// Transition resource state back to shader access
+				cmd_list->barrier(static_cast<uint32_t>(pass_data.modified_resources.size()), pass_data.modified_resources.data(), state_new, state_old);
+			}
+		}
+
+		// Mark mipmaps of modified resources as out of date
+		for (size_t k = 0; k < pass_data.generate_mipmap_resources.size(); ++k)
+		{
+			if (std::find_if(_pending_mipmaps.begin(), _pending_mipmaps.end(),
+					[resource = pass_data.generate_mipmap_resources[k]](const std::pair<api::resource, api::resource_view> &pending) { return pending.first == resource; }) == _pending_mipmaps.end())
+				_pending_mipmaps.emplace_back(pass_data.generate_mipmap_resources[k], pass_data.generate_mipmap_views[k]);
+		}
+
+#if RESHADE_GUI
+		if (write_timestamps)
+			cmd_list->finish_query(effect.query_heap, api::query_type::timestamp, tech.queries.current_index() + 2 + static_cast<uint32_t>(pass_index) * 2);
+
+		if (_timeline_frame != nullptr)
+			add_timeline_event(frame_timeline::event::pass, static_cast<uint32_t>(pass_index), pass_info.name.empty() ? "Pass " + std::to_string(pass_index) : pass_info.name, timeline_pass_beg);
+#endif
+
+#ifndef NDEBUG
+		cmd_list->finish_debug_event();
+#endif
+	}
+
+	// Subsequent techniques may sample any of the modified textures, so generate all mipmaps that are still out of date
+	generate_pending_mipmaps(nullptr, nullptr);
+
+#ifndef NDEBUG
+	cmd_list->finish_debug_event();
+#endif
+
+#if RESHADE_GUI
+	if (write_statistics)
+		cmd_list->finish_query(effect.statistics_query_heap, api::query_type::pipeline_statistics, tech.queries.current_statistics_index());
+	if (write_timestamps)
+		tech.queries.push(_framecount, timeline_event, write_statistics);
+
+	if (_timeline_frame != nullptr)
+		_timeline_frame->events[timeline_event].cpu_end = timeline_time_ns();
+#endif
+
+	if (recording_cmd_list != nullptr)
+	{
+		if (back_buffer_index >= tech.recordings.size())
+			tech.recordings.resize(std::max(back_buffer_index + 1, get_back_buffer_count()));
+
+		tech.recordings[back_buffer_index] = finish_technique_recording();
+		if (tech.recordings[back_buffer_index] != 0)
+			execute_technique_recording(tech.recordings[back_buffer_index]);
+	}
+}
+void reshade::runtime::set_hidden_area_mesh(const float *vertices, uint32_t num_triangles)
+{
+	_hidden_area_vertices.assign(vertices, vertices + num_triangles * 3 * 2);
+
+	if (!_is_initialized)
+		return; // Rectangles are generated in 'on_init' once the back buffer size is known
+
+	rasterize_hidden_area_mesh(_hidden_area_vertices, _width, _height, _hidden_area_rects);
+
+	// Recorded techniques contain clear commands with the previous rectangles
+	destroy_technique_recordings();
+}
+void reshade::runtime::update_sky_mask(uint32_t num_rects, const int32_t *rects)
+{
+	// Techniques that are masked by these are never recorded, so there is nothing to invalidate here
+	_sky_rects.assign(rects, rects + num_rects * 4);
+}
+void reshade::runtime::destroy_technique_recordings()
+{
+	for (technique &tech : _techniques)
+		destroy_technique_recordings(tech);
+}
+void reshade::runtime::destroy_technique_recordings(technique &tech)
+{
+	for (const uint64_t recording : tech.recordings)
+		if (recording != 0)
+			destroy_technique_recording(recording);
+
+	tech.recordings.clear();
+}
+
+void reshade::runtime::begin_async_compute(const technique &tech)
+{
+	api::command_list *const cmd_list = _graphics_queue->get_immediate_command_list();
+
+	const auto is_handed_over = [this](api::resource resource) {
+		return std::find(_async_compute_modified_resources.begin(), _async_compute_modified_resources.end(), resource) != _async_compute_modified_resources.end() ||
+			std::find(_async_compute_sampled_resources.begin(), _async_compute_sampled_resources.end(), resource) != _async_compute_sampled_resources.end();
+	};
+
+	// Compute queues cannot access the back buffer, so update the copy of it on the graphics queue
+	// Only a single pass can require this, since compute passes never modify the back buffer (see 'update_render_graph')
+	if (std::any_of(tech.passes_data.begin(), tech.passes_data.end(), [](const technique::pass_data &pass_data) { return pass_data.copy_backbuffer; }))
+	{
+		// The copy is still in use by previous compute work (and in a state only compute work can use), so have to wait for that first
+		if (is_handed_over(_backbuffer_texture))
+			finish_async_compute(nullptr);
+
+		api::resource backbuffer;
+		get_current_back_buffer(&backbuffer);
+
+		const api::resource resources[2] = { backbuffer, _backbuffer_texture };
+		const api::resource_usage state_old[2] = { api::resource_usage::render_target, api::resource_usage::shader_resource };
+		const api::resource_usage state_new[2] = { api::resource_usage::copy_source, api::resource_usage::copy_dest };
+
+		cmd_list->barrier(2, resources, state_old, state_new);
+		cmd_list->copy_resource(backbuffer, _backbuffer_texture);
+		cmd_list->barrier(2, resources, state_new, state_old);
+	}
+
+	// Transition resources the compute queue accesses from the combined shader resource state, which includes the pixel shader resource state that compute queues cannot use, to the non-pixel one (only those that were not already handed over by a previous technique)
+	std::vector<api::resource> handed_over_resources;
+	for (const technique::pass_data &pass_data : tech.passes_data)
+	{
+		for (const api::resource resource : pass_data.modified_resources)
+		{
+			if (std::find(_async_compute_modified_resources.begin(), _async_compute_modified_resources.end(), resource) != _async_compute_modified_resources.end())
+				continue;
+
+			if (!is_handed_over(resource))
+				handed_over_resources.push_back(resource);
+			_async_compute_modified_resources.push_back(resource);
+		}
+
+		for (const api::resource resource : pass_data.sampled_resources)
+		{
+			if (std::find(_async_compute_sampled_resources.begin(), _async_compute_sampled_resources.end(), resource) != _async_compute_sampled_resources.end())
+				continue;
+
+			if (!is_handed_over(resource))
+				handed_over_resources.push_back(resource);
+			_async_compute_sampled_resources.push_back(resource);
+		}
+	}
+
+	// The back buffer copy may be sampled as well, so must not be overwritten before the compute work finished
+	if (!is_handed_over(_backbuffer_texture))
+	{
+		handed_over_resources.push_back(_backbuffer_texture);
+		_async_compute_sampled_resources.push_back(_backbuffer_texture);
+	}
+
+	if (!handed_over_resources.empty())
+	{
+		const std::vector<api::resource_usage> state_old(handed_over_resources.size(), api::resource_usage::shader_resource);
+		const std::vector<api::resource_usage> state_new(handed_over_resources.size(), api::resource_usage::shader_resource_non_pixel);
+		cmd_list->barrier(static_cast<uint32_t>(handed_over_resources.size()), handed_over_resources.data(), state_old.data(), state_new.data());
+	}
+
+	// Start compute work only after all graphics work recorded so far finished
+	synchronize_queues(_async_compute_queue, _graphics_queue);
+
+	_async_compute_pending = true;
+}
+void reshade::runtime::finish_async_compute(const technique *tech)
+{
+	if (!_async_compute_pending)
+		return;
+
+	if (tech != nullptr)
+	{
+		const auto contains = [](const std::vector<api::resource> &list, api::resource resource) {
+			return std::find(list.begin(), list.end(), resource) != list.end();
+		};
+
+		// Only need to wait if the technique accesses a resource the compute work accesses, since those are in a state the graphics queue cannot sample from in pixel shaders until they are returned
+		// Resources bound to semantics other than the back buffer are never accessed by async compute work, so do not need to be considered
+		bool depends_on_async_compute = false;
+		for (const technique::pass_data &pass_data : tech->passes_data)
+		{
+			if (pass_data.copy_backbuffer && contains(_async_compute_sampled_resources, _backbuffer_texture))
+				depends_on_async_compute = true;
+
+			for (const api::resource resource : pass_data.modified_resources)
+				if (contains(_async_compute_modified_resources, resource) || contains(_async_compute_sampled_resources, resource))
+					depends_on_async_compute = true;
+			for (const api::resource resource : pass_data.sampled_resources)
+				if (contains(_async_compute_modified_resources, resource) || contains(_async_compute_sampled_resources, resource))
+					depends_on_async_compute = true;
+		}
+
+		if (!depends_on_async_compute)
+			return;
+	}
+
+	synchronize_queues(_graphics_queue, _async_compute_queue);
+
+	// Return resources to the graphics queue (each one only once, even if it was both written and read by the compute work)
+	std::vector<api::resource> handed_over_resources = _async_compute_modified_resources;
+	for (const api::resource resource : _async_compute_sampled_resources)
+		if (std::find(_async_compute_modified_resources.begin(), _async_compute_modified_resources.end(), resource) == _async_compute_modified_resources.end())
+			handed_over_resources.push_back(resource);
+
+	if (!handed_over_resources.empty())
+	{
+		api::command_list *const cmd_list = _graphics_queue->get_immediate_command_list();
+
+		const std::vector<api::resource_usage> state_old(handed_over_resources.size(), api::resource_usage::shader_resource_non_pixel);
+		const std::vector<api::resource_usage> state_new(handed_over_resources.size(), api::resource_usage::shader_resource);
+		cmd_list->barrier(static_cast<uint32_t>(handed_over_resources.size()), handed_over_resources.data(), state_old.data(), state_new.data());
+	}
+
+	_async_compute_modified_resources.clear();
+	_async_compute_sampled_resources.clear();
+	_async_compute_pending = false;
+}
+
+void reshade::runtime::update_render_graph()
+{
+	// The application rendered to the back buffer before effects are applied, so the first pass sampling it needs an updated copy
+	bool backbuffer_modified = true;
+
+	for (technique &tech : _techniques)
+	{
+		if (tech.passes_data.empty() || !tech.enabled || tech.skipped)
+			continue; // Ignore techniques that are not rendered this frame (same condition as in 'update_and_render_effects')
+
+		bool schedule_changed = false;
+
+		for (size_t pass_index = 0; pass_index < tech.passes.size(); ++pass_index)
+		{
+			const reshadefx::pass_info &pass_info = tech.passes[pass_index];
+			technique::pass_data &pass_data = tech.passes_data[pass_index];
+
+			// Clamp the scissor rectangle to the viewport, so that an empty or out-of-bounds region from the uniform simply skips the pass
+			if (pass_data.scissor_uniform_index < _effects[tech.effect_index].uniforms.size())
+			{
+				int32_t region[4] = {};
+				get_uniform_value(_effects[tech.effect_index].uniforms[pass_data.scissor_uniform_index], region, 4);
+
+				int32_t scissor_rect[4];
+				scissor_rect[0] = std::clamp(region[0], 0, static_cast<int32_t>(pass_info.viewport_width));
+				scissor_rect[1] = std::clamp(region[1], 0, static_cast<int32_t>(pass_info.viewport_height));
+				scissor_rect[2] = std::clamp(region[2], scissor_rect[0], static_cast<int32_t>(pass_info.viewport_width));
+				scissor_rect[3] = std::clamp(region[3], scissor_rect[1], static_cast<int32_t>(pass_info.viewport_height));
+
+				// Recorded commands bind the scissor rectangle the pass had when they were recorded
+				schedule_changed |= std::memcmp(pass_data.scissor_rect, scissor_rect, sizeof(scissor_rect)) != 0;
+
+				std::memcpy(pass_data.scissor_rect, scissor_rect, sizeof(scissor_rect));
+			}
+
+			// The back buffer copy stays valid across technique boundaries for as long as no pass renders to the back buffer, and only has to be updated right before a pass that actually samples it
+			const bool copy_backbuffer = backbuffer_modified && pass_data.samples_backbuffer;
+			backbuffer_modified = (backbuffer_modified && !copy_backbuffer) || (pass_info.cs_entry_point.empty() && pass_info.render_target_names[0].empty());
+
+			// Keep the render pass open between subsequent graphics passes that render to the exact same set of render targets, which avoids ending and beginning it again and the barriers around that
+			// Passes rendering to the back buffer are not merged, since the next pass would need a back buffer copy in between
+			bool merged_with_prev = false;
+			if (pass_index != 0)
+			{
+				const reshadefx::pass_info &prev_pass_info = tech.passes[pass_index - 1];
+				technique::pass_data &prev_pass_data = tech.passes_data[pass_index - 1];
+
+				merged_with_prev =
+					pass_info.cs_entry_point.empty() && prev_pass_info.cs_entry_point.empty() &&
+					!copy_backbuffer &&
+					!pass_data.modified_resources.empty() && pass_data.modified_resources == prev_pass_data.modified_resources &&
+					pass_info.srgb_write_enable == prev_pass_info.srgb_write_enable &&
+					pass_info.stencil_enable == prev_pass_info.stencil_enable &&
+					pass_data.sky_masked == prev_pass_data.sky_masked;
+
+				prev_pass_data.merged_with_next = merged_with_prev;
+			}
+
+			// The merge flags of subsequent passes mirror each other, so comparing one of them is enough to detect any change
+			schedule_changed |= pass_data.copy_backbuffer != copy_backbuffer || pass_data.merged_with_prev != merged_with_prev;
+
+			pass_data.copy_backbuffer = copy_backbuffer;
+			pass_data.merged_with_prev = merged_with_prev;
+			pass_data.merged_with_next = false;
+		}
+
+		// Commands recorded for this technique in a previous frame were scheduled differently, so have to record them again
+		if (schedule_changed)
+			destroy_technique_recordings(tech);
+	}
+}
+
+void reshade::runtime::enable_technique(technique &tech)
+{
+	assert(tech.effect_index < _effects.size());
+
+	if (!_effects[tech.effect_index].compiled)
+		return; // Cannot enable techniques that failed to compile
+
+	const bool status_changed = !tech.enabled;
+	tech.enabled = true;
+	tech.time_left = tech.annotation_as_int("timeout");
+
+	// Queue effect file for compilation if it was not fully loaded yet
+	if (tech.passes_data.empty() && // Avoid adding the same effect multiple times to the queue if it contains multiple techniques that were enabled simultaneously
+		std::find(_reload_compile_queue.begin(), _reload_compile_queue.end(), tech.effect_index) == _reload_compile_queue.end())
+		_reload_compile_queue.push_back(tech.effect_index);
+
+	if (status_changed) // Increase rendering reference count
+		_effects[tech.effect_index].rendering++;
+
+	// Effects that were not built for the current preprocessor definitions are built now (or once the variants currently being built were swapped in, see 'update_effect_variants')
+	if (_effects[tech.effect_index].definitions_outdated && _effect_variants.empty() && !is_loading())
+		build_effect_variants(std::vector<std::string>(_preset_preprocessor_definitions), { tech.effect_index });
+}
+void reshade::runtime::disable_technique(technique &tech)
+{
+	assert(tech.effect_index < _effects.size());
+
+	const bool status_changed =  tech.enabled;
+	tech.enabled = false;
+	tech.time_left = 0;
+	tech.budget_suspended = false;
+	tech.average_cpu_duration.clear();
+	tech.average_gpu_duration.clear();
+	tech.gpu_duration_histogram.clear();
+	tech.average_pixel_invocations.clear();
+	tech.average_compute_invocations.clear();
+	tech.average_primitives.clear();
+	for (technique::pass_data &pass_data : tech.passes_data)
+		pass_data.average_gpu_duration.clear();
+
+	if (status_changed) // Decrease rendering reference count
+		_effects[tech.effect_index].rendering--;
+}
+
+void reshade::runtime::load_config()
+{
+	const ini_file &config = ini_file::load_cache(_config_path);
+
+	config.get("INPUT", "ForceShortcutModifiers", _force_shortcut_modifiers);
+	config.get("INPUT", "KeyEffects", _effects_key_data);
+	config.get("INPUT", "KeyNextPreset", _next_preset_key_data);
+	config.get("INPUT", "KeyPerformanceMode", _performance_mode_key_data);
+	config.get("INPUT", "KeyPreviousPreset", _prev_preset_key_data);
+	config.get("INPUT", "KeyReload", _reload_key_data);
+	config.get("INPUT", "KeyScreenshot", _screenshot_key_data);
+	config.get("INPUT", "KeyCapture", _capture_key_data);
+
+	config.get("GENERAL", "NoDebugInfo", _no_debug_info);
+	config.get("GENERAL", "NoEffectCache", _no_effect_cache);
+	config.get("GENERAL", "NoReloadOnInit", _no_reload_on_init);
+	config.get("GENERAL", "NoReloadOnInitForNonVR", _no_reload_for_non_vr);
+
+	config.get("GENERAL", "BenchmarkFrames", _benchmark_frames);
+	config.get("GENERAL", "BenchmarkReloads", _benchmark_reloads);
+	config.get("GENERAL", "BenchmarkReportPath", _benchmark_report_path);
+	config.get("GENERAL", "EffectSearchPaths", _effect_search_paths);
+	config.get("GENERAL", "ExportTelemetry", _export_telemetry);
+	config.get("GENERAL", "OpenGLSPIRV", _opengl_spirv);
+	config.get("GENERAL", "D3D12DXIL", _d3d12_dxil);
+	config.get("GENERAL", "DXCompilerPath", _dxc_compiler_path);
+	config.get("GENERAL", "PackUniforms", _pack_uniforms);
+	config.get("GENERAL", "PerformanceMode", _performance_mode);
+	config.get("GENERAL", "PreprocessorDefinitions", _global_preprocessor_definitions);
+	config.get("GENERAL", "SkipLoadingDisabledEffects", _effect_load_skipping);
+	config.get("GENERAL", "SpecializeDiscreteUniforms", _specialize_discrete_uniforms);
+	config.get("GENERAL", "TextureSearchPaths", _texture_search_paths);
+	config.get("GENERAL", "IntermediateCachePath", _intermediate_cache_path);
+	config.get("GENERAL", "IntermediateCacheSizeLimit", _effect_cache_size_limit);
+	config.get("GENERAL", "MachineCachePath", _machine_cache_path);
+	config.get("GENERAL", "MachineCacheSizeLimit", _machine_cache_size_limit);
+	config.get("GENERAL", "EffectPermutationCacheSize", _effect_permutation_cache_size);
+	config.get("GENERAL", "LowMemoryMode", _low_memory_mode);
+	config.get("GENERAL", "WorkerThreadsAvoidRenderCore", _worker_avoid_render_thread_core);
+	config.get("GENERAL", "WorkerThreadsForegroundLimit", _worker_foreground_limit);
+	config.get("GENERAL", "WorkerThreadsLowPriority", _worker_low_priority);
+	config.get("GENERAL", "WorkerThreadsPreferEfficiencyCores", _worker_prefer_efficiency_cores);
+	config.get("GENERAL", "EffectRenderScale", _effect_render_scale);
+	config.get("GENERAL", "EffectRenderScaleBudget", _effect_render_scale_budget);
+	config.get("GENERAL", "EffectRenderScaleMin", _effect_render_scale_min);
+	config.get("GENERAL", "FrameTimeBudget", _frame_time_budget);
+	config.get("GENERAL", "LimitFrameLatency", _limit_frame_latency);
+	config.get("GENERAL", "GPUStatisticsLatency", _gpu_statistics_latency);
+	config.get("GENERAL", "AliasTransientTextures", _alias_transient_textures);
+	config.get("GENERAL", "EffectEvictionFrames", _effect_eviction_frames);
+	config.get("GENERAL", "ReloadEffectsOnFileChange", _reload_effects_on_file_change);
+
+	config.get("GENERAL", "PresetPath", _current_preset_path);
+	config.get("GENERAL", "PresetTransitionDelay", _preset_transition_delay);
+
+	// Fall back to temp directory if cache path does not exist
+	if (_intermediate_cache_path.empty() || !resolve_path(_intermediate_cache_path))
+	{
+		WCHAR temp_path[MAX_PATH] = L"";
+		GetTempPathW(MAX_PATH, temp_path);
+		_intermediate_cache_path = temp_path;
+	}
+
+	// Use default if the preset file does not exist yet
+	if (!resolve_preset_path(_current_preset_path))
+		_current_preset_path = g_reshade_base_path / L"ReShadePreset.ini";
+
+	// The command line may contain commas, which the configuration file treats as list separators, so join them back together
+	if (std::vector<std::string> capture_command; config.get("SCREENSHOT", "CaptureCommand", capture_command))
+	{
+		_capture_command.clear();
+		for (size_t i = 0; i < capture_command.size(); ++i)
+			_capture_command += (i != 0 ? "," : "") + capture_command[i];
+	}
+	config.get("SCREENSHOT", "CaptureFrameInterval", _capture_frame_interval);
+	config.get("SCREENSHOT", "CaptureQueueSize", _capture_queue_size);
+	config.get("SCREENSHOT", "ClearAlpha", _screenshot_clear_alpha);
+	config.get("SCREENSHOT", "FileFormat", _screenshot_format);
+	config.get("SCREENSHOT", "FileNamingFormat", _screenshot_naming);
+	config.get("SCREENSHOT", "JPEGQuality", _screenshot_jpeg_quality);
+	config.get("SCREENSHOT", "SaveBeforeShot", _screenshot_save_before);
+	config.get("SCREENSHOT", "SaveOverlayShot", _screenshot_save_gui);
+	config.get("SCREENSHOT", "SavePath", _screenshot_path);
+	config.get("SCREENSHOT", "SavePresetFile", _screenshot_include_preset);
+
+#if RESHADE_GUI
+	load_config_gui(config);
+#endif
+}
+void reshade::runtime::save_config() const
+{
+	ini_file &config = ini_file::load_cache(_config_path);
+
+	config.set("INPUT", "ForceShortcutModifiers", _force_shortcut_modifiers);
+	config.set("INPUT", "KeyEffects", _effects_key_data);
+	config.set("INPUT", "KeyNextPreset", _next_preset_key_data);
+	config.set("INPUT", "KeyPerformanceMode", _performance_mode_key_data);
+	config.set("INPUT", "KeyPreviousPreset", _prev_preset_key_data);
+	config.set("INPUT", "KeyReload", _reload_key_data);
+	config.set("INPUT", "KeyScreenshot", _screenshot_key_data);
+	config.set("INPUT", "KeyCapture", _capture_key_data);
+
+	config.set("GENERAL", "NoDebugInfo", _no_debug_info);
+	config.set("GENERAL", "NoEffectCache", _no_effect_cache);
+	config.set("GENERAL", "NoReloadOnInit", _no_reload_on_init);
+	config.set("GENERAL", "NoReloadOnInitForNonVR", _no_reload_for_non_vr);
+
+	config.set("GENERAL", "BenchmarkFrames", _benchmark_frames);
+	config.set("GENERAL", "BenchmarkReloads", _benchmark_reloads);
+	config.set("GENERAL", "BenchmarkReportPath", _benchmark_report_path);
+	config.set("GENERAL", "EffectSearchPaths", _effect_search_paths);
+	config.set("GENERAL", "ExportTelemetry", _export_telemetry);
+	config.set("GENERAL", "OpenGLSPIRV", _opengl_spirv);
+	config.set("GENERAL", "D3D12DXIL", _d3d12_dxil);
+	config.set("GENERAL", "DXCompilerPath", _dxc_compiler_path);
+	config.set("GENERAL", "PackUniforms", _pack_uniforms);
+	config.set("GENERAL", "PerformanceMode", _performance_mode);
+	config.set("GENERAL", "PreprocessorDefinitions", _global_preprocessor_definitions);
+	config.set("GENERAL", "SkipLoadingDisabledEffects", _effect_load_skipping);
+	config.set("GENERAL", "SpecializeDiscreteUniforms", _specialize_discrete_uniforms);
+	config.set("GENERAL", "TextureSearchPaths", _texture_search_paths);
+	config.set("GENERAL", "IntermediateCachePath", _intermediate_cache_path);
+	config.set("GENERAL", "IntermediateCacheSizeLimit", _effect_cache_size_limit);
+	config.set("GENERAL", "MachineCachePath", _machine_cache_path);
+	config.set("GENERAL", "MachineCacheSizeLimit", _machine_cache_size_limit);
+	config.set("GENERAL", "EffectPermutationCacheSize", _effect_permutation_cache_size);
+	config.set("GENERAL", "LowMemoryMode", _low_memory_mode);
+	config.set("GENERAL", "WorkerThreadsAvoidRenderCore", _worker_avoid_render_thread_core);
+	config.set("GENERAL", "WorkerThreadsForegroundLimit", _worker_foreground_limit);
+	config.set("GENERAL", "WorkerThreadsLowPriority", _worker_low_priority);
+	config.set("GENERAL", "WorkerThreadsPreferEfficiencyCores", _worker_prefer_efficiency_cores);
+	config.set("GENERAL", "EffectRenderScale", _effect_render_scale);
+	config.set("GENERAL", "EffectRenderScaleBudget", _effect_render_scale_budget);
+	config.set("GENERAL", "EffectRenderScaleMin", _effect_render_scale_min);
+	config.set("GENERAL", "FrameTimeBudget", _frame_time_budget);
+	config.set("GENERAL", "LimitFrameLatency", _limit_frame_latency);
+	config.set("GENERAL", "GPUStatisticsLatency", _gpu_statistics_latency);
+	config.set("GENERAL", "AliasTransientTextures", _alias_transient_textures);
+	config.set("GENERAL", "EffectEvictionFrames", _effect_eviction_frames);
+	config.set("GENERAL", "ReloadEffectsOnFileChange", _reload_effects_on_file_change);
+
+	// Use ReShade DLL directory as base for relative preset paths (see 'resolve_preset_path')
+	std::filesystem::path relative_preset_path = _current_preset_path.lexically_proximate(g_reshade_base_path);
+	if (relative_preset_path.wstring().rfind(L"..", 0) != std::wstring::npos)
+		relative_preset_path = _current_preset_path; // Do not use relative path if preset is in a parent directory
+	if (relative_preset_path.is_relative()) // Prefix preset path with dot character to better indicate it being a relative path
+		relative_preset_path = L"." / relative_preset_path;
+	config.set("GENERAL", "PresetPath", relative_preset_path);
+	config.set("GENERAL", "PresetTransitionDelay", _preset_transition_delay);
+
+	config.set("SCREENSHOT", "CaptureCommand", _capture_command);
+	config.set("SCREENSHOT", "CaptureFrameInterval", _capture_frame_interval);
+	config.set("SCREENSHOT", "CaptureQueueSize", _capture_queue_size);
+	config.set("SCREENSHOT", "ClearAlpha", _screenshot_clear_alpha);
+	config.set("SCREENSHOT", "FileFormat", _screenshot_format);
+	config.set("SCREENSHOT", "FileNamingFormat", _screenshot_naming);
+	config.set("SCREENSHOT", "JPEGQuality", _screenshot_jpeg_quality);
+	config.set("SCREENSHOT", "SaveBeforeShot", _screenshot_save_before);
+	config.set("SCREENSHOT", "SaveOverlayShot", _screenshot_save_gui);
+	config.set("SCREENSHOT", "SavePath", _screenshot_path);
+	config.set("SCREENSHOT", "SavePresetFile", _screenshot_include_preset);
+
+#if RESHADE_GUI
+	save_config_gui(config);
+#endif
+}
+
+void reshade::runtime::load_current_preset(const std::vector<size_t> *effect_indices)
+{
+	_preset_save_success = true;
+
+	ini_file config = ini_file::load_cache(_config_path); // Copy config, because reference becomes invalid in the next line
+	const ini_file &preset = ini_file::load_cache(_current_preset_path);
+
+	std::vector<std::string> technique_list;
+	preset.get({}, "Techniques", technique_list);
+	std::vector<std::string> sorted_technique_list;
+	preset.get({}, "TechniqueSorting", sorted_technique_list);
+	std::vector<std::string> budget_priority_list;
+	preset.get({}, "BudgetPriority", budget_priority_list);
+	std::vector<std::string> preset_preprocessor_definitions;
+	preset.get({}, "PreprocessorDefinitions", preset_preprocessor_definitions);
+
+	// Recompile effects if preprocessor definitions have changed or running in performance mode (in which case all preset values are compile-time constants)
+	if (_reload_remaining_effects != 0 && effect_indices == nullptr) // ... unless this is one of the 'load_current_preset' calls in 'update_and_render_effects'
+	{
+		// Compare against the definitions effects are currently being built with, in case a previous transition is still in progress
+		if (_performance_mode || preset_preprocessor_definitions != (_effect_variants.empty() ? _preset_preprocessor_definitions : _effect_variants_definitions))
+		{
+			// Effects are still being loaded with the old definitions, so have to start over
+			if (is_loading())
+			{
+				_preset_preprocessor_definitions = std::move(preset_preprocessor_definitions);
+				reload_effects();
+				return; // Preset values are loaded in 'update_and_render_effects' during effect loading
+			}
+
+			// The current effects keep rendering with the new preset values until the variants are ready (see 'update_effect_variants')
+			if (_effect_variants.empty())
+				build_effect_variants(std::move(preset_preprocessor_definitions), select_effect_variants(technique_list));
+			else
+				_effect_variants_outdated = true;
+		}
+
+		if (std::find_if(technique_list.begin(), technique_list.end(), [this](const std::string &technique_name) {
+				if (const size_t at_pos = technique_name.find('@'); at_pos == std::string::npos)
+					return true;
+				else if (const auto it = std::find_if(_effects.begin(), _effects.end(),
+					[effect_name = static_cast<std::string_view>(technique_name).substr(at_pos + 1)](const effect &effect) { return effect_name == effect.source_file.filename().u8string(); }); it == _effects.end())
+					return true;
+				else
+					return it->skipped; }) != technique_list.end())
+		{
+			reload_effects();
+			return;
+		}
+	}
+
+	if (sorted_technique_list.empty())
+		config.get("GENERAL", "TechniqueSorting", sorted_technique_list);
+	if (sorted_technique_list.empty())
+		sorted_technique_list = technique_list;
+
+	// Reorder techniques
+	std::sort(_techniques.begin(), _techniques.end(), [this, &sorted_technique_list](const technique &lhs, const technique &rhs) {
+		const std::string lhs_unique = lhs.name + '@' + _effects[lhs.effect_index].source_file.filename().u8string();
+		const std::string rhs_unique = rhs.name + '@' + _effects[rhs.effect_index].source_file.filename().u8string();
+		auto lhs_it = std::find(sorted_technique_list.begin(), sorted_technique_list.end(), lhs_unique);
+		auto rhs_it = std::find(sorted_technique_list.begin(), sorted_technique_list.end(), rhs_unique);
+		if (lhs_it == sorted_technique_list.end())
+			lhs_it = std::find(sorted_technique_list.begin(), sorted_technique_list.end(), lhs.name);
+		if (rhs_it == sorted_technique_list.end())
+			rhs_it = std::find(sorted_technique_list.begin(), sorted_technique_list.end(), rhs.name);
+		return lhs_it < rhs_it; });
+	_effect_handles_outdated = true;
+
+	// Techniques are suspended in the order they are listed in when the frame time budget is exceeded (see 'update_frame_time_budget')
+	for (technique &tech : _techniques)
+	{
+		const std::string unique_name = tech.name + '@' + _effects[tech.effect_index].source_file.filename().u8string();
+		auto it = std::find(budget_priority_list.begin(), budget_priority_list.end(), unique_name);
+		if (it == budget_priority_list.end())
+			it = std::find(budget_priority_list.begin(), budget_priority_list.end(), tech.name);
+
+		tech.budget_priority = it != budget_priority_list.end() ? static_cast<uint32_t>(std::distance(budget_priority_list.begin(), it) + 1) : 0;
+		tech.budget_suspended = false;
+	}
+
+	// Compute times since the transition has started and how much is left till it should end
+	auto transition_time = std::chrono::duration_cast<std::chrono::microseconds>(_last_present_time - _last_preset_switching_time).count();
+	auto transition_ms_left = _preset_transition_delay - transition_time / 1000;
+	auto transition_ms_left_from_last_frame = transition_ms_left + std::chrono::duration_cast<std::chrono::microseconds>(_last_frame_duration).count() / 1000;
+
+	// Effects that are activated while others are still loading only get the preset values, the transition is handled for all effects at once after loading finished
+	if (effect_indices == nullptr)
+	{
+		if (_is_in_between_presets_transition && transition_ms_left <= 0)
+			_is_in_between_presets_transition = false;
+
+		_preset_transition_values.clear();
+		_preset_transition_values_time = _last_present_time;
+	}
+
+	const bool is_in_transition = _is_in_between_presets_transition && effect_indices == nullptr;
+	const auto is_effect_selected = [effect_indices](size_t effect_index) {
+		return effect_indices == nullptr || std::find(effect_indices->begin(), effect_indices->end(), effect_index) != effect_indices->end();
+	};
+
+	for (size_t effect_index = 0; effect_index < _effects.size(); ++effect_index)
+	{
+		if (!is_effect_selected(effect_index))
+			continue;
+
+		effect &effect = _effects[effect_index];
+
+		for (uniform &variable : effect.uniforms)
+		{
+			if (variable.special != special_uniform::none)
 				continue;
 			const std::string section = effect.source_file.filename().u8string();
 
@@ -3111,7 +6460,7 @@ void reshade::runtime::load_current_preset()
 			}
 
 			// Reset values to defaults before loading from a new preset
-			if (!_is_in_between_presets_transition)
+			if (!is_in_transition)
 				reset_uniform_value(variable);
 
 			reshadefx::constant values, values_old;
@@ -3132,8 +6481,18 @@ void reshade::runtime::load_current_preset()
 				get_uniform_value(variable, values.as_float, variable.type.components());
 				values_old = values;
 				preset.get(section, variable.name, values.as_float);
-				if (_is_in_between_presets_transition)
+				if (is_in_transition)
 				{
+					// Remember both values, so that 'update_preset_transition' can interpolate between them without reading the preset again
+					if (std::memcmp(values.as_float, values_old.as_float, variable.type.components() * sizeof(float)) != 0)
+					{
+						preset_transition_value &transition_value = _preset_transition_values.emplace_back();
+						transition_value.effect_index = variable.effect_index;
+						transition_value.uniform_index = &variable - effect.uniforms.data();
+						std::memcpy(transition_value.start, values_old.as_float, sizeof(transition_value.start));
+						std::memcpy(transition_value.target, values.as_float, sizeof(transition_value.target));
+					}
+
 					// Perform smooth transition on floating point values
 					for (unsigned int i = 0; i < variable.type.components(); i++)
 					{
@@ -3147,31 +6506,70 @@ void reshade::runtime::load_current_preset()
 		}
 	}
 
+	const size_t queued_effects = _reload_compile_queue.size();
+
 	for (technique &tech : _techniques)
 	{
+		if (!is_effect_selected(tech.effect_index))
+			continue;
+
 		const std::string unique_name =
 			tech.name + '@' + _effects[tech.effect_index].source_file.filename().u8string();
 
 		// Ignore preset if "enabled" annotation is set
-		if (tech.annotation_as_int("enabled") ||
+		if (tech.always_enabled ||
 			std::find(technique_list.begin(), technique_list.end(), unique_name) != technique_list.end() ||
 			std::find(technique_list.begin(), technique_list.end(), tech.name) != technique_list.end())
 			enable_technique(tech);
 		else
 			disable_technique(tech);
 
-		if (!preset.get({}, "Key" + unique_name, tech.toggle_key_data) &&
-			!preset.get({}, "Key" + tech.name, tech.toggle_key_data))
-		{
-			tech.toggle_key_data[0] = tech.annotation_as_int("toggle");
-			tech.toggle_key_data[1] = tech.annotation_as_int("togglectrl");
-			tech.toggle_key_data[2] = tech.annotation_as_int("toggleshift");
-			tech.toggle_key_data[3] = tech.annotation_as_int("togglealt");
-		}
+		if (!preset.get({}, "Key" + unique_name, tech.toggle_key_data) &&
+			!preset.get({}, "Key" + tech.name, tech.toggle_key_data))
+		{
+			tech.toggle_key_data[0] = tech.annotation_as_int("toggle");
+			tech.toggle_key_data[1] = tech.annotation_as_int("togglectrl");
+			tech.toggle_key_data[2] = tech.annotation_as_int("toggleshift");
+			tech.toggle_key_data[3] = tech.annotation_as_int("togglealt");
+		}
+	}
+
+	// Reverse newly queued effects so that they are enabled in the order they are defined in the preset (since the queue is worked from back to front), after those that were already queued before
+	std::reverse(_reload_compile_queue.begin() + queued_effects, _reload_compile_queue.end());
+	std::rotate(_reload_compile_queue.begin(), _reload_compile_queue.begin() + queued_effects, _reload_compile_queue.end());
+}
+void reshade::runtime::update_preset_transition()
+{
+	const auto transition_end_time = _last_preset_switching_time + std::chrono::milliseconds(_preset_transition_delay);
+	const auto transition_duration = transition_end_time - _preset_transition_values_time;
+
+	// Interpolate linearly from where the values were collected to the end of the transition
+	float ratio = 1.0f;
+	if (_last_present_time < transition_end_time && transition_duration.count() > 0)
+		ratio = std::chrono::duration<float>(_last_present_time - _preset_transition_values_time) / std::chrono::duration<float>(transition_duration);
+	ratio = std::clamp(ratio, 0.0f, 1.0f);
+
+	for (const preset_transition_value &transition_value : _preset_transition_values)
+	{
+		// Effects may have been reloaded since the values were collected
+		if (transition_value.effect_index >= _effects.size() || transition_value.uniform_index >= _effects[transition_value.effect_index].uniforms.size())
+			continue;
+
+		uniform &variable = _effects[transition_value.effect_index].uniforms[transition_value.uniform_index];
+		if (variable.type.base != reshadefx::type::t_float)
+			continue;
+
+		float values[16];
+		for (unsigned int i = 0; i < variable.type.components(); i++)
+			values[i] = transition_value.start[i] + (transition_value.target[i] - transition_value.start[i]) * ratio;
+		set_uniform_value(variable, values, variable.type.components());
 	}
 
-	// Reverse compile queue so that effects are enabled in the order they are defined in the preset (since the queue is worked from back to front)
-	std::reverse(_reload_compile_queue.begin(), _reload_compile_queue.end());
+	if (ratio >= 1.0f)
+	{
+		_is_in_between_presets_transition = false;
+		_preset_transition_values.clear();
+	}
 }
 void reshade::runtime::save_current_preset() const
 {
@@ -3179,6 +6577,7 @@ void reshade::runtime::save_current_preset() const
 
 	// Build list of active techniques and effects
 	std::vector<std::string> technique_list, sorted_technique_list;
+	std::vector<std::pair<uint32_t, std::string>> budget_priority_list;
 	std::unordered_set<size_t> effect_list;
 	effect_list.reserve(_techniques.size());
 	technique_list.reserve(_techniques.size());
@@ -3197,6 +6596,9 @@ void reshade::runtime::save_current_preset() const
 		// Keep track of the order of all techniques and not just the enabled ones
 		sorted_technique_list.push_back(unique_name);
 
+		if (tech.budget_priority != 0)
+			budget_priority_list.emplace_back(tech.budget_priority, unique_name);
+
 		if (tech.toggle_key_data[0] != 0)
 			preset.set({}, "Key" + unique_name, tech.toggle_key_data);
 		else if (tech.annotation_as_int("toggle") != 0)
@@ -3207,6 +6609,22 @@ void reshade::runtime::save_current_preset() const
 
 	preset.set({}, "Techniques", std::move(technique_list));
 	preset.set({}, "TechniqueSorting", std::move(sorted_technique_list));
+
+	if (!budget_priority_list.empty())
+	{
+		std::sort(budget_priority_list.begin(), budget_priority_list.end());
+
+		std::vector<std::string> budget_priority_names;
+		budget_priority_names.reserve(budget_priority_list.size());
+		for (std::pair<uint32_t, std::string> &entry : budget_priority_list)
+			budget_priority_names.push_back(std::move(entry.second));
+
+		preset.set({}, "BudgetPriority", std::move(budget_priority_names));
+	}
+	else
+	{
+		preset.remove_key({}, "BudgetPriority");
+	}
 	preset.set({}, "PreprocessorDefinitions", _preset_preprocessor_definitions);
 
 	// TODO: Do we want to save spec constants here too? The preset will be rather empty in performance mode otherwise.
@@ -3222,256 +6640,843 @@ void reshade::runtime::save_current_preset() const
 			if (variable.special != special_uniform::none)
 				continue;
 
-			const std::string section = effect.source_file.filename().u8string();
-			const unsigned int components = variable.type.components();
-			reshadefx::constant values;
+			const std::string section = effect.source_file.filename().u8string();
+			const unsigned int components = variable.type.components();
+			reshadefx::constant values;
+
+			if (variable.supports_toggle_key())
+			{
+				// save the shortcut key into the preset files
+				if (variable.toggle_key_data[0] != 0)
+					preset.set(section, "Key" + variable.name, variable.toggle_key_data);
+				else
+					preset.remove_key(section, "Key" + variable.name);
+			}
+
+			switch (variable.type.base)
+			{
+			case reshadefx::type::t_int:
+				get_uniform_value(variable, values.as_int, components);
+				preset.set(section, variable.name, values.as_int, components);
+				break;
+			case reshadefx::type::t_bool:
+			case reshadefx::type::t_uint:
+				get_uniform_value(variable, values.as_uint, components);
+				preset.set(section, variable.name, values.as_uint, components);
+				break;
+			case reshadefx::type::t_float:
+				get_uniform_value(variable, values.as_float, components);
+				preset.set(section, variable.name, values.as_float, components);
+				break;
+			}
+		}
+	}
+}
+
+bool reshade::runtime::switch_to_next_preset(std::filesystem::path filter_path, bool reversed)
+{
+	std::error_code ec; // This is here to ignore file system errors below
+
+	std::filesystem::path filter_text;
+	if (resolve_path(filter_path); !std::filesystem::is_directory(filter_path, ec))
+		if (filter_text = filter_path.filename(); !filter_text.empty())
+			filter_path = filter_path.parent_path();
+
+	size_t current_preset_index = std::numeric_limits<size_t>::max();
+	std::vector<std::filesystem::path> preset_paths;
+
+	for (std::filesystem::path preset_path : std::filesystem::directory_iterator(filter_path, std::filesystem::directory_options::skip_permission_denied, ec))
+	{
+		// Skip anything that is not a valid preset file
+		if (!resolve_preset_path(preset_path))
+			continue;
+
+		// Keep track of the index of the current preset in the list of found preset files that is being build
+		if (std::filesystem::equivalent(preset_path, _current_preset_path, ec)) {
+			current_preset_index = preset_paths.size();
+			preset_paths.push_back(std::move(preset_path));
+			continue;
+		}
+
+		const std::wstring preset_name = preset_path.stem();
+		// Only add those files that are matching the filter text
+		if (filter_text.empty() || std::search(preset_name.begin(), preset_name.end(), filter_text.native().begin(), filter_text.native().end(),
+			[](wchar_t c1, wchar_t c2) { return towlower(c1) == towlower(c2); }) != preset_name.end())
+			preset_paths.push_back(std::move(preset_path));
+	}
+
+	if (preset_paths.begin() == preset_paths.end())
+		return false; // No valid preset files were found, so nothing more to do
+
+	if (current_preset_index == std::numeric_limits<size_t>::max())
+	{
+		// Current preset was not in the container path, so just use the first or last file
+		if (reversed)
+			_current_preset_path = preset_paths.back();
+		else
+			_current_preset_path = preset_paths.front();
+	}
+	else
+	{
+		// Current preset was found in the container path, so use the file before or after it
+		if (auto it = std::next(preset_paths.begin(), current_preset_index); reversed)
+			_current_preset_path = it == preset_paths.begin() ? preset_paths.back() : *--it;
+		else
+			_current_preset_path = it == std::prev(preset_paths.end()) ? preset_paths.front() : *++it;
+	}
+
+	return true;
+}
+
+bool reshade::runtime::take_screenshot(uint8_t *buffer)
+{
+	api::resource intermediate;
+	uint32_t intermediate_pitch;
+	api::format data_format;
+	if (!begin_screenshot_readback(intermediate, intermediate_pitch, data_format))
+		return false;
+
+	// Wait for any rendering by the application finish before submitting
+	// It may have submitted that to a different queue, so simply wait for all to idle here
+	_device->wait_idle();
+
+	return finish_screenshot_readback(intermediate, intermediate_pitch, data_format, buffer);
+}
+void reshade::runtime::save_screenshot(const std::wstring &postfix, const bool should_save_preset)
+{
+	char timestamp[21];
+	const std::time_t t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+	tm tm; localtime_s(&tm, &t);
+	sprintf_s(timestamp, " %.4d-%.2d-%.2d %.2d-%.2d-%.2d", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+
+	std::wstring filename = g_target_executable_path.stem().concat(timestamp);
+	if (_screenshot_naming == 1)
+		filename += L' ' + _current_preset_path.stem().wstring();
+
+	filename += postfix;
+	filename += _screenshot_format == 0 ? L".bmp" : _screenshot_format == 1 ? L".png" : _screenshot_format == 2 ? L".jpg" : L".exr";
+
+	std::filesystem::path screenshot_path = g_reshade_base_path / _screenshot_path / filename;
+
+	LOG(INFO) << "Saving screenshot to " << screenshot_path << " ...";
+
+	pending_screenshot &screenshot = _pending_screenshots.emplace_back();
+	screenshot.path = std::move(screenshot_path);
+	// Flush the preset now, so that the copy made once the screenshot was written matches the state at the time it was taken
+	if (_screenshot_include_preset && should_save_preset && ini_file::flush_cache(_current_preset_path))
+		screenshot.preset_path = _current_preset_path;
+	screenshot.format = _screenshot_format;
+	screenshot.jpeg_quality = _screenshot_jpeg_quality;
+	// The alpha channel doesn't need to be cleared if we're saving a JPEG, stbi ignores it
+	screenshot.clear_alpha = _screenshot_clear_alpha && _screenshot_format != 2;
+
+	if (begin_screenshot_readback(screenshot.intermediate, screenshot.intermediate_pitch, screenshot.data_format, _screenshot_format == 3))
+	{
+		_screenshots_in_progress++;
+
+		// Submit the copy right away, so that it has the most time to finish before the data is read back
+		screenshot.fence_value = _graphics_queue->get_pending_fence_value();
+		_graphics_queue->flush_immediate_command_list();
+		return;
+	}
+
+	const std::lock_guard<std::mutex> lock(_screenshot_mutex);
+
+	_screenshot_save_success = false;
+	_last_screenshot_file = std::move(screenshot.path);
+	_last_screenshot_time = std::chrono::high_resolution_clock::now();
+
+	_pending_screenshots.pop_back();
+
+	LOG(ERROR) << "Failed to write screenshot to " << _last_screenshot_file << '!';
+}
+
+bool reshade::runtime::create_screenshot_convert_pipeline()
+{
+	api::pipeline_desc desc = { api::pipeline_stage::all_compute };
+
+	// The DXBC shader is used for D3D11 and D3D12 and the GLSL one for OpenGL
+	// D3D9 and D3D10 lack compute shaders and no SPIR-V version is provided, so those are left to convert on the CPU
+	switch (_device->get_api())
+	{
+	case api::device_api::d3d11:
+	case api::device_api::d3d12:
+	{
+		const resources::data_resource cs = resources::load_data_resource(IDR_SCREENSHOT_CS);
+		desc.compute.shader.code = cs.data;
+		desc.compute.shader.code_size = cs.data_size;
+		desc.compute.shader.format = api::shader_format::dxbc;
+		break;
+	}
+	case api::device_api::opengl:
+	{
+		static constexpr char compute_shader[] =
+			"#version 430\n"
+			"layout(local_size_x = 8, local_size_y = 8) in;\n"
+			"layout(binding = 0) uniform sampler2D t0;\n"
+			"layout(binding = 0) uniform writeonly image2D dest;\n"
+			"layout(binding = 0) uniform Buf { uvec2 size; uint flags; };\n"
+			"void main()\n"
+			"{\n"
+			"	uvec2 tid = gl_GlobalInvocationID.xy;\n"
+			"	if (any(greaterThanEqual(tid, size))) return;\n"
+			"	vec4 color = texelFetch(t0, ivec2(tid), 0);\n"
+			"	if ((flags & 0x1) != 0) { color.rgb = clamp(color.rgb, 0.0, 1.0); color.rgb = mix(1.055 * pow(color.rgb, vec3(1.0 / 2.4)) - 0.055, color.rgb * 12.92, lessThanEqual(color.rgb, vec3(0.0031308))); }\n"
+			"	if ((flags & 0x2) != 0) { color.rgb = mix(pow((color.rgb + 0.055) / 1.055, vec3(2.4)), color.rgb / 12.92, lessThanEqual(color.rgb, vec3(0.04045))); }\n"
+			"	imageStore(dest, ivec2(tid), color);\n"
+			"}\n";
+
+		desc.compute.shader.code = compute_shader;
+		desc.compute.shader.code_size = sizeof(compute_shader);
+		desc.compute.shader.format = api::shader_format::glsl;
+		desc.compute.shader.entry_point = "main";
+		break;
+	}
+	default:
+		return false;
+	}
+
+	if (!_device->check_capability(api::device_caps::compute_shader))
+		return false;
+
+	const api::descriptor_range srv_range = { 0, 0, api::descriptor_type::shader_resource_view, 1, api::shader_stage::compute };
+	const api::descriptor_range uav_range = { 0, 0, api::descriptor_type::unordered_access_view, 1, api::shader_stage::compute };
+	const api::constant_range constants = { 0, 0, 4, api::shader_stage::compute };
+
+	if (!_device->create_descriptor_set_layout({ 1, &srv_range, true }, &_screenshot_convert_set_layouts[0]) ||
+		!_device->create_descriptor_set_layout({ 1, &uav_range, true }, &_screenshot_convert_set_layouts[1]) ||
+		!_device->create_pipeline_layout({ 2, _screenshot_convert_set_layouts, 1, &constants }, &_screenshot_convert_layout))
+	{
+		LOG(ERROR) << "Failed to create screenshot conversion pipeline layout!";
+		destroy_screenshot_convert_pipeline();
+		return false;
+	}
+
+	desc.layout = _screenshot_convert_layout;
+
+	if (!_device->create_pipeline(desc, &_screenshot_convert_pipeline))
+	{
+		LOG(ERROR) << "Failed to create screenshot conversion pipeline!";
+		destroy_screenshot_convert_pipeline();
+		return false;
+	}
+
+	return true;
+}
+void reshade::runtime::destroy_screenshot_convert_pipeline()
+{
+	for (size_t i = 0; i < 2; ++i)
+	{
+		_device->destroy_resource_view(_screenshot_convert_uavs[i]);
+		_screenshot_convert_uavs[i] = {};
+		_device->destroy_resource(_screenshot_convert_textures[i]);
+		_screenshot_convert_textures[i] = {};
+	}
+
+	_device->destroy_pipeline(api::pipeline_stage::all_compute, _screenshot_convert_pipeline);
+	_screenshot_convert_pipeline = {};
+	_device->destroy_pipeline_layout(_screenshot_convert_layout);
+	_screenshot_convert_layout = {};
+	for (api::descriptor_set_layout &set_layout : _screenshot_convert_set_layouts)
+	{
+		_device->destroy_descriptor_set_layout(set_layout);
+		set_layout = {};
+	}
+}
+
+bool reshade::runtime::create_screenshot_intermediate(api::resource &intermediate, uint32_t &intermediate_pitch, api::format &data_format, bool hdr)
+{
+	data_format = hdr ? api::format::r16g16b16a16_float : api::format::r8g8b8a8_unorm;
+
+	// Can copy the back buffer as is if it already matches the requested format, otherwise it is converted on the GPU if possible
+	if (_backbuffer_format != data_format)
+	{
+		if (_screenshot_convert_pipeline.handle != 0)
+		{
+			const size_t index = hdr ? 1 : 0;
+
+			if (_screenshot_convert_textures[index].handle == 0)
+			{
+				if (!_device->create_resource(api::resource_desc(_width, _height, 1, 1, data_format, 1, api::memory_heap::gpu_only, api::resource_usage::unordered_access | api::resource_usage::copy_source), nullptr, api::resource_usage::unordered_access, &_screenshot_convert_textures[index]))
+				{
+					LOG(ERROR) << "Failed to create screenshot conversion texture!";
+					return false;
+				}
+
+				_device->set_resource_name(_screenshot_convert_textures[index], "ReShade screenshot conversion texture");
+
+				if (!_device->create_resource_view(_screenshot_convert_textures[index], api::resource_usage::unordered_access, api::resource_view_desc(data_format), &_screenshot_convert_uavs[index]))
+				{
+					LOG(ERROR) << "Failed to create screenshot conversion texture view!";
+					_device->destroy_resource(_screenshot_convert_textures[index]);
+					_screenshot_convert_textures[index] = {};
+					return false;
+				}
+			}
+		}
+		else if (!hdr && (_color_bit_depth == 8 || _color_bit_depth == 10))
+		{
+			// Fall back to converting on the CPU in 'read_screenshot_intermediate'
+			data_format = _backbuffer_format;
+		}
+		else
+		{
+			LOG(ERROR) << (hdr ? "HDR screenshots" : "Screenshots") << " are not supported for back buffer format " << static_cast<uint32_t>(_backbuffer_format) << '!';
+			return false;
+		}
+	}
+
+	intermediate_pitch = api::format_row_pitch(data_format, _width);
+	if (_device->get_api() == api::device_api::d3d12) // See D3D12_TEXTURE_DATA_PITCH_ALIGNMENT
+		intermediate_pitch = (intermediate_pitch + 255) & ~255;
+
+	if (_device->check_capability(api::device_caps::copy_buffer_to_texture))
+	{
+		if (!_device->create_resource(api::resource_desc(intermediate_pitch * _height, api::memory_heap::gpu_to_cpu, api::resource_usage::copy_dest), nullptr, api::resource_usage::copy_dest, &intermediate))
+		{
+			LOG(ERROR) << "Failed to create system memory buffer for screenshot capture!";
+			return false;
+		}
+
+		_device->set_resource_name(intermediate, "ReShade screenshot buffer");
+	}
+	else
+	{
+		if (!_device->create_resource(api::resource_desc(_width, _height, 1, 1, data_format, 1, api::memory_heap::gpu_to_cpu, api::resource_usage::copy_dest), nullptr, api::resource_usage::copy_dest, &intermediate))
+		{
+			LOG(ERROR) << "Failed to create system memory texture for screenshot capture!";
+			return false;
+		}
+
+		_device->set_resource_name(intermediate, "ReShade screenshot texture");
+	}
+
+	return true;
+}
+void reshade::runtime::record_screenshot_copy(api::resource intermediate, api::format data_format)
+{
+	api::resource backbuffer;
+	get_current_back_buffer(&backbuffer);
+
+	api::command_list *const cmd_list = _graphics_queue->get_immediate_command_list();
+
+	api::resource source = backbuffer;
+	api::resource_usage source_state = api::resource_usage::present;
+
+	if (data_format != _backbuffer_format)
+	{
+		const size_t index = data_format == api::format::r16g16b16a16_float ? 1 : 0;
+
+		// The back buffer itself usually cannot be sampled, so update the copy of it first (all effects finished rendering at this point, so it is no longer in use)
+		{
+			const api::resource resources[2] = { backbuffer, _backbuffer_texture };
+			const api::resource_usage state_old[2] = { api::resource_usage::present, api::resource_usage::shader_resource };
+			const api::resource_usage state_new[2] = { api::resource_usage::copy_source, api::resource_usage::copy_dest };
+
+			cmd_list->barrier(2, resources, state_old, state_new);
+			cmd_list->copy_resource(backbuffer, _backbuffer_texture);
+			cmd_list->barrier(2, resources, state_new, state_old);
+		}
+
+		// A floating-point back buffer contains linear scRGB values, which need to be encoded for 8-bit output, while other formats are assumed to be sRGB encoded, which need to be decoded for floating-point output
+		const bool linear_input = _backbuffer_format == api::format::r16g16b16a16_float;
+		const uint32_t constants[4] = { _width, _height, (!index && linear_input ? 0x1u : 0u) | (index && !linear_input ? 0x2u : 0u), 0 };
+
+		cmd_list->bind_pipeline(api::pipeline_stage::all_compute, _screenshot_convert_pipeline);
+		cmd_list->push_constants(api::shader_stage::compute, _screenshot_convert_layout, 2, 0, 4, constants);
+		// Use the view without sRGB decoding, so that the encoded values are read
+		cmd_list->push_descriptors(api::shader_stage::compute, _screenshot_convert_layout, 0, api::descriptor_type::shader_resource_view, 0, 1, &_backbuffer_texture_view[0]);
+		cmd_list->push_descriptors(api::shader_stage::compute, _screenshot_convert_layout, 1, api::descriptor_type::unordered_access_view, 0, 1, &_screenshot_convert_uavs[index]);
+		cmd_list->dispatch((_width + 7) / 8, (_height + 7) / 8, 1);
+
+		source = _screenshot_convert_textures[index];
+		source_state = api::resource_usage::unordered_access;
+	}
+
+	// Copy data into system memory resource
+	cmd_list->barrier(source, source_state, api::resource_usage::copy_source);
+	if (_device->check_capability(api::device_caps::copy_buffer_to_texture))
+		cmd_list->copy_texture_to_buffer(source, 0, nullptr, intermediate, 0, _width, _height);
+	else
+		cmd_list->copy_resource(source, intermediate);
+	cmd_list->barrier(source, api::resource_usage::copy_source, source_state);
+}
+bool reshade::runtime::read_screenshot_intermediate(api::resource intermediate, uint32_t intermediate_pitch, api::format data_format, uint8_t *buffer)
+{
+	// Data that was converted on the GPU (or already was in the target format) can be copied as is, otherwise it still needs to be converted to 32bpp RGBA here
+	const bool is_target_format = data_format == api::format::r8g8b8a8_unorm || data_format == api::format::r16g16b16a16_float;
+	const uint32_t data_pitch = _width * (data_format == api::format::r16g16b16a16_float ? 8 : 4);
+	uint32_t texture_pitch = intermediate_pitch, mapped_pitch = 0;
+
+	// Copy data from intermediate image into output buffer
+	uint8_t *mapped_data = nullptr;
+	if (!_device->map_resource(intermediate, 0, api::map_access::read_only, reinterpret_cast<void **>(&mapped_data), &mapped_pitch))
+		return false;
+
+	if (mapped_pitch != 0)
+		texture_pitch = mapped_pitch;
 
-			if (variable.supports_toggle_key())
+	if (is_target_format && texture_pitch == data_pitch)
+	{
+		std::memcpy(buffer, mapped_data, static_cast<size_t>(data_pitch) * _height);
+	}
+	else for (uint32_t y = 0; y < _height; y++, buffer += data_pitch, mapped_data += texture_pitch)
+	{
+		if (is_target_format)
+		{
+			std::memcpy(buffer, mapped_data, data_pitch);
+		}
+		else if (_color_bit_depth == 10)
+		{
+			for (uint32_t x = 0; x < data_pitch; x += 4)
 			{
-				// save the shortcut key into the preset files
-				if (variable.toggle_key_data[0] != 0)
-					preset.set(section, "Key" + variable.name, variable.toggle_key_data);
-				else
-					preset.remove_key(section, "Key" + variable.name);
+				const uint32_t rgba = *reinterpret_cast<const uint32_t *>(mapped_data + x);
+				// Divide by 4 to get 10-bit range (0-1023) into 8-bit range (0-255)
+				buffer[x + 0] = (( rgba & 0x000003FF)        /  4) & 0xFF;
+				buffer[x + 1] = (((rgba & 0x000FFC00) >> 10) /  4) & 0xFF;
+				buffer[x + 2] = (((rgba & 0x3FF00000) >> 20) /  4) & 0xFF;
+				buffer[x + 3] = (((rgba & 0xC0000000) >> 30) * 85) & 0xFF;
+				if (_backbuffer_format >= api::format::b10g10r10a2_typeless &&
+					_backbuffer_format <= api::format::b10g10r10a2_uint)
+					std::swap(buffer[x + 0], buffer[x + 2]);
 			}
+		}
+		else
+		{
+			std::memcpy(buffer, mapped_data, data_pitch);
 
-			switch (variable.type.base)
+			if (_backbuffer_format >= api::format::b8g8r8a8_unorm &&
+				_backbuffer_format <= api::format::b8g8r8a8_unorm_srgb)
 			{
-			case reshadefx::type::t_int:
-				get_uniform_value(variable, values.as_int, components);
-				preset.set(section, variable.name, values.as_int, components);
-				break;
-			case reshadefx::type::t_bool:
-			case reshadefx::type::t_uint:
-				get_uniform_value(variable, values.as_uint, components);
-				preset.set(section, variable.name, values.as_uint, components);
-				break;
-			case reshadefx::type::t_float:
-				get_uniform_value(variable, values.as_float, components);
-				preset.set(section, variable.name, values.as_float, components);
-				break;
+				// Format is BGRA, but output should be RGBA, so flip channels
+				for (uint32_t x = 0; x < data_pitch; x += 4)
+					std::swap(buffer[x + 0], buffer[x + 2]);
 			}
 		}
 	}
+
+	_device->unmap_resource(intermediate, 0);
+
+	return true;
 }
+bool reshade::runtime::begin_screenshot_readback(api::resource &intermediate, uint32_t &intermediate_pitch, api::format &data_format, bool hdr)
+{
+	if (!create_screenshot_intermediate(intermediate, intermediate_pitch, data_format, hdr))
+		return false;
 
-bool reshade::runtime::switch_to_next_preset(std::filesystem::path filter_path, bool reversed)
+	record_screenshot_copy(intermediate, data_format);
+
+	return true;
+}
+bool reshade::runtime::finish_screenshot_readback(api::resource intermediate, uint32_t intermediate_pitch, api::format data_format, uint8_t *buffer)
 {
-	std::error_code ec; // This is here to ignore file system errors below
+	const bool success = read_screenshot_intermediate(intermediate, intermediate_pitch, data_format, buffer);
 
-	std::filesystem::path filter_text;
-	if (resolve_path(filter_path); !std::filesystem::is_directory(filter_path, ec))
-		if (filter_text = filter_path.filename(); !filter_text.empty())
-			filter_path = filter_path.parent_path();
+	_device->destroy_resource(intermediate);
 
-	size_t current_preset_index = std::numeric_limits<size_t>::max();
-	std::vector<std::filesystem::path> preset_paths;
+	return success;
+}
+void reshade::runtime::process_pending_screenshots(bool wait)
+{
+	if (_pending_screenshots.empty())
+		return;
 
-	for (std::filesystem::path preset_path : std::filesystem::directory_iterator(filter_path, std::filesystem::directory_options::skip_permission_denied, ec))
-	{
-		// Skip anything that is not a valid preset file
-		if (!resolve_preset_path(preset_path))
-			continue;
+	if (wait)
+		_device->wait_idle();
 
-		// Keep track of the index of the current preset in the list of found preset files that is being build
-		if (std::filesystem::equivalent(preset_path, _current_preset_path, ec)) {
-			current_preset_index = preset_paths.size();
-			preset_paths.push_back(std::move(preset_path));
+	// Only read back screenshots whose copy the GPU finished executing, so that mapping the intermediate resource does not stall
+	const uint64_t completed_fence_value = _graphics_queue->get_completed_fence_value();
+
+	for (auto it = _pending_screenshots.begin(); it != _pending_screenshots.end();)
+	{
+		if (!wait && completed_fence_value < it->fence_value)
+		{
+			++it;
 			continue;
 		}
 
-		const std::wstring preset_name = preset_path.stem();
-		// Only add those files that are matching the filter text
-		if (filter_text.empty() || std::search(preset_name.begin(), preset_name.end(), filter_text.native().begin(), filter_text.native().end(),
-			[](wchar_t c1, wchar_t c2) { return towlower(c1) == towlower(c2); }) != preset_name.end())
-			preset_paths.push_back(std::move(preset_path));
-	}
+		std::vector<uint8_t> data(static_cast<size_t>(_width) * _height * (it->data_format == api::format::r16g16b16a16_float ? 8 : 4));
+		const bool readback_success = finish_screenshot_readback(it->intermediate, it->intermediate_pitch, it->data_format, data.data());
 
-	if (preset_paths.begin() == preset_paths.end())
-		return false; // No valid preset files were found, so nothing more to do
+		// Encoding and writing the image file takes a long time, so do that on a worker thread to avoid stalling rendering
+		_worker_pool.submit([this, screenshot = std::move(*it), data = std::move(data), width = _width, height = _height, readback_success]() mutable {
+			bool save_success = false;
 
-	if (current_preset_index == std::numeric_limits<size_t>::max())
-	{
-		// Current preset was not in the container path, so just use the first or last file
-		if (reversed)
-			_current_preset_path = preset_paths.back();
-		else
-			_current_preset_path = preset_paths.front();
-	}
-	else
-	{
-		// Current preset was found in the container path, so use the file before or after it
-		if (auto it = std::next(preset_paths.begin(), current_preset_index); reversed)
-			_current_preset_path = it == preset_paths.begin() ? preset_paths.back() : *--it;
-		else
-			_current_preset_path = it == std::prev(preset_paths.end()) ? preset_paths.front() : *++it;
-	}
+			if (readback_success)
+			{
+				if (screenshot.clear_alpha)
+				{
+					if (screenshot.format == 3)
+						for (size_t i = 6; i < data.size(); i += 8)
+							data[i] = 0x00, data[i + 1] = 0x3C; // 1.0 in half-precision floating-point
+					else
+						for (size_t i = 3; i < data.size(); i += 4)
+							data[i] = 0xFF;
+				}
 
-	return true;
+				if (FILE *file; _wfopen_s(&file, screenshot.path.c_str(), L"wb") == 0)
+				{
+					const auto write_callback = [](void *context, void *data, int size) {
+						fwrite(data, 1, size, static_cast<FILE *>(context));
+					};
+
+					switch (screenshot.format)
+					{
+					case 0:
+						save_success = stbi_write_bmp_to_func(write_callback, file, width, height, 4, data.data()) != 0;
+						break;
+					case 1:
+						// Use own encoder for PNG, which compresses the image in parallel and is much faster than 'stbi_write_png_to_func'
+						if (std::vector<uint8_t> encoded; encode_png(data.data(), width, height, encoded, &_worker_pool))
+							save_success = fwrite(encoded.data(), 1, encoded.size(), file) == encoded.size();
+						break;
+					case 2:
+						save_success = stbi_write_jpg_to_func(write_callback, file, width, height, 4, data.data(), screenshot.jpeg_quality) != 0;
+						break;
+					case 3:
+						if (std::vector<uint8_t> encoded; encode_exr(reinterpret_cast<const uint16_t *>(data.data()), width, height, encoded))
+							save_success = fwrite(encoded.data(), 1, encoded.size(), file) == encoded.size();
+						break;
+					}
+
+					fclose(file);
+				}
+			}
+
+			if (!save_success)
+			{
+				LOG(ERROR) << "Failed to write screenshot to " << screenshot.path << '!';
+			}
+			else if (!screenshot.preset_path.empty())
+			{
+				// Preset was flushed to disk, so can just copy it over to the new location
+				std::error_code ec; std::filesystem::copy_file(screenshot.preset_path, std::filesystem::path(screenshot.path).replace_extension(L".ini"), std::filesystem::copy_options::overwrite_existing, ec);
+			}
+
+			const std::lock_guard<std::mutex> lock(_screenshot_mutex);
+
+			_screenshot_save_success = save_success;
+			_last_screenshot_file = std::move(screenshot.path);
+			_last_screenshot_time = std::chrono::high_resolution_clock::now();
+
+			_screenshots_in_progress--;
+		});
+
+		it = _pending_screenshots.erase(it);
+	}
 }
 
-bool reshade::runtime::take_screenshot(uint8_t *buffer)
+bool reshade::runtime::start_capture()
 {
-	if (_color_bit_depth != 8 && _color_bit_depth != 10)
-	{
-		LOG(ERROR) << "Screenshots are not supported for back buffer format " << static_cast<uint32_t>(_backbuffer_format) << '!';
+	if (_capture_sink != nullptr || _width == 0 || _height == 0)
 		return false;
-	}
-
-	api::resource backbuffer;
-	get_current_back_buffer(&backbuffer);
 
-	const uint32_t data_pitch = _width * 4;
-	uint32_t texture_pitch = data_pitch, mapped_pitch = 0;
-	if (_device->get_api() == api::device_api::d3d12) // See D3D12_TEXTURE_DATA_PITCH_ALIGNMENT
-		texture_pitch = (texture_pitch + 255) & ~255;
+	// The copy recorded into a slot is only read back once the ring wraps around to it again and the GPU finished it, so size it to cover the frames the application can usually get ahead (see 'capture_frame')
+	_capture_ring.resize(std::max(get_back_buffer_count(), 1u) + 1);
+	_capture_ring_index = 0;
 
-	// Copy back buffer data into system memory buffer
-	api::resource intermediate;
-	if (_device->check_capability(api::device_caps::copy_buffer_to_texture))
+	for (capture_slot &slot : _capture_ring)
 	{
-		if (!_device->create_resource(api::resource_desc(texture_pitch * _height, api::memory_heap::gpu_to_cpu, api::resource_usage::copy_dest), nullptr, api::resource_usage::copy_dest, &intermediate))
+		if (!create_screenshot_intermediate(slot.intermediate, _capture_intermediate_pitch, _capture_data_format))
 		{
-			LOG(ERROR) << "Failed to create system memory buffer for screenshot capture!";
+			stop_capture();
 			return false;
 		}
+	}
 
-		_device->set_resource_name(intermediate, "ReShade screenshot buffer");
+	_capture_sink = std::make_unique<frame_sink>(static_cast<size_t>(_width) * _height * 4, _capture_queue_size);
 
-		api::command_list *const cmd_list = _graphics_queue->get_immediate_command_list();
-		cmd_list->barrier(backbuffer, api::resource_usage::present, api::resource_usage::copy_source);
-		cmd_list->copy_texture_to_buffer(backbuffer, 0, nullptr, intermediate, 0, _width, _height);
-		cmd_list->barrier(backbuffer, api::resource_usage::copy_source, api::resource_usage::present);
-	}
-	else
+	if (_capture_command.empty())
 	{
-		if (!_device->create_resource(api::resource_desc(_width, _height, 1, 1, _backbuffer_format, 1, api::memory_heap::gpu_to_cpu, api::resource_usage::copy_dest), nullptr, api::resource_usage::copy_dest, &intermediate))
+		char timestamp[21];
+		const std::time_t t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+		tm tm; localtime_s(&tm, &t);
+		sprintf_s(timestamp, " %.4d-%.2d-%.2d %.2d-%.2d-%.2d", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+
+		// Raw file has no header, so put the frame dimensions into the file name instead
+		const std::filesystem::path capture_path = g_reshade_base_path / _screenshot_path /
+			g_target_executable_path.stem().concat(timestamp).concat(L' ' + std::to_wstring(_width) + L'x' + std::to_wstring(_height) + L".rgba");
+
+		LOG(INFO) << "Capturing frames to " << capture_path << " ...";
+
+		if (!_capture_sink->open_file(capture_path))
 		{
-			LOG(ERROR) << "Failed to create system memory texture for screenshot capture!";
+			stop_capture();
 			return false;
 		}
+	}
+	else
+	{
+		// Replace size placeholders in the command line, so that the encoder can be told how to interpret the raw input
+		std::string command_line = _capture_command;
+		for (const auto &[placeholder, value] : { std::make_pair(std::string("{width}"), _width), std::make_pair(std::string("{height}"), _height) })
+			for (size_t offset = 0; (offset = command_line.find(placeholder, offset)) != std::string::npos;)
+				command_line.replace(offset, placeholder.size(), std::to_string(value));
 
-		_device->set_resource_name(intermediate, "ReShade screenshot texture");
+		LOG(INFO) << "Capturing frames to process \"" << command_line << "\" ...";
 
-		api::command_list *const cmd_list = _graphics_queue->get_immediate_command_list();
-		cmd_list->barrier(backbuffer, api::resource_usage::present, api::resource_usage::copy_source);
-		cmd_list->copy_resource(backbuffer, intermediate);
-		cmd_list->barrier(backbuffer, api::resource_usage::copy_source, api::resource_usage::present);
+		if (!_capture_sink->open_process(std::filesystem::u8path(command_line).wstring()))
+		{
+			stop_capture();
+			return false;
+		}
 	}
 
-	// Wait for any rendering by the application finish before submitting
-	// It may have submitted that to a different queue, so simply wait for all to idle here
+	return true;
+}
+void reshade::runtime::stop_capture()
+{
+	if (_capture_sink == nullptr && _capture_ring.empty())
+		return;
+
 	_device->wait_idle();
 
-	// Copy data from intermediate image into output buffer
-	uint8_t *mapped_data = nullptr;
-	if (_device->map_resource(intermediate, 0, api::map_access::read_only, reinterpret_cast<void **>(&mapped_data), &mapped_pitch))
+	if (_capture_sink != nullptr)
 	{
-		if (mapped_pitch != 0)
-			texture_pitch = mapped_pitch;
-
-		for (uint32_t y = 0; y < _height; y++, buffer += data_pitch, mapped_data += texture_pitch)
+		// Write out all frames still in flight, starting with the oldest
+		for (size_t i = 0; i < _capture_ring.size(); ++i)
 		{
-			if (_color_bit_depth == 10)
+			capture_slot &slot = _capture_ring[(_capture_ring_index + i) % _capture_ring.size()];
+			if (!slot.pending)
+				continue;
+
+			// Wait for a free buffer instead of dropping the frame, since nothing is rendering anymore
+			if (uint8_t *const frame = _capture_sink->acquire_frame(true))
 			{
-				for (uint32_t x = 0; x < data_pitch; x += 4)
-				{
-					const uint32_t rgba = *reinterpret_cast<const uint32_t *>(mapped_data + x);
-					// Divide by 4 to get 10-bit range (0-1023) into 8-bit range (0-255)
-					buffer[x + 0] = (( rgba & 0x000003FF)        /  4) & 0xFF;
-					buffer[x + 1] = (((rgba & 0x000FFC00) >> 10) /  4) & 0xFF;
-					buffer[x + 2] = (((rgba & 0x3FF00000) >> 20) /  4) & 0xFF;
-					buffer[x + 3] = (((rgba & 0xC0000000) >> 30) * 85) & 0xFF;
-					if (_backbuffer_format >= api::format::b10g10r10a2_typeless &&
-						_backbuffer_format <= api::format::b10g10r10a2_uint)
-						std::swap(buffer[x + 0], buffer[x + 2]);
-				}
+				if (read_screenshot_intermediate(slot.intermediate, _capture_intermediate_pitch, _capture_data_format, frame))
+					_capture_sink->submit_frame(frame);
+				else
+					_capture_sink->discard_frame(frame);
 			}
 			else
 			{
-				std::memcpy(buffer, mapped_data, data_pitch);
-
-				if (_backbuffer_format >= api::format::b8g8r8a8_unorm &&
-					_backbuffer_format <= api::format::b8g8r8a8_unorm_srgb)
-				{
-					// Format is BGRA, but output should be RGBA, so flip channels
-					for (uint32_t x = 0; x < data_pitch; x += 4)
-						std::swap(buffer[x + 0], buffer[x + 2]);
-				}
+				_capture_sink->drop_frame();
 			}
+
+			slot.pending = false;
 		}
 
-		_device->unmap_resource(intermediate, 0);
+		_capture_sink->close();
+
+		LOG(INFO) << "Finished capturing frames (" << _capture_sink->num_frames_written() << " written, " << _capture_sink->num_frames_dropped() << " dropped).";
+
+		_capture_sink.reset();
 	}
 
-	_device->destroy_resource(intermediate);
+	for (capture_slot &slot : _capture_ring)
+		if (slot.intermediate.handle != 0)
+			_device->destroy_resource(slot.intermediate);
+	_capture_ring.clear();
+}
+void reshade::runtime::capture_frame()
+{
+	assert(_capture_sink != nullptr && !_capture_ring.empty());
+
+	if (_capture_frame_interval > 1 && (_framecount % _capture_frame_interval) != 0)
+		return;
+
+	capture_slot &slot = _capture_ring[_capture_ring_index];
+
+	if (slot.pending)
+	{
+		// The copy into this slot may still be executing, in which case mapping it would stall, so drop this frame and try the same slot again next frame
+		if (_graphics_queue->get_completed_fence_value() < slot.fence_value)
+		{
+			_capture_sink->drop_frame();
+			return;
+		}
+
+		// Drop the frame if the sink cannot keep up, rather than stalling the application
+		if (uint8_t *const frame = _capture_sink->acquire_frame())
+		{
+			if (read_screenshot_intermediate(slot.intermediate, _capture_intermediate_pitch, _capture_data_format, frame))
+				_capture_sink->submit_frame(frame);
+			else
+				_capture_sink->discard_frame(frame);
+		}
+		else
+		{
+			_capture_sink->drop_frame();
+		}
+	}
+
+	record_screenshot_copy(slot.intermediate, _capture_data_format);
+	slot.fence_value = _graphics_queue->get_pending_fence_value();
+	slot.pending = true;
 
-	return mapped_data != nullptr;
+	_capture_ring_index = (_capture_ring_index + 1) % _capture_ring.size();
 }
-void reshade::runtime::save_screenshot(const std::wstring &postfix, const bool should_save_preset)
+
+// Percentiles published with each frame record (the last one is the maximum)
+static const float s_telemetry_percentiles[4] = { 50.0f, 95.0f, 99.0f, 100.0f };
+
+void reshade::runtime::publish_telemetry(std::chrono::high_resolution_clock::time_point present_started, std::chrono::nanoseconds effects_cpu_duration)
 {
-	char timestamp[21];
-	const std::time_t t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-	tm tm; localtime_s(&tm, &t);
-	sprintf_s(timestamp, " %.4d-%.2d-%.2d %.2d-%.2d-%.2d", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+	if (_telemetry == nullptr)
+	{
+		_telemetry = std::make_unique<telemetry>();
 
-	std::wstring filename = g_target_executable_path.stem().concat(timestamp);
-	if (_screenshot_naming == 1)
-		filename += L' ' + _current_preset_path.stem().wstring();
+		if (!_telemetry->open())
+		{
+			// Do not try again every frame
+			_export_telemetry = false;
+			_telemetry.reset();
+			return;
+		}
+	}
 
-	filename += postfix;
-	filename += _screenshot_format == 0 ? L".bmp" : _screenshot_format == 1 ? L".png" : L".jpg";
+	if (_telemetry_last_reload_time != _last_reload_time)
+	{
+		_telemetry_last_reload_time = _last_reload_time;
+		_telemetry_reload_count++;
+	}
 
-	std::filesystem::path screenshot_path = g_reshade_base_path / _screenshot_path / filename;
+	telemetry_frame_record &record = _telemetry->begin_record();
+	record.frame_index = _framecount;
+	record.timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(_last_present_time.time_since_epoch()).count();
+	record.present_to_present_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(_last_frame_duration).count();
+	record.runtime_cpu_duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - present_started).count();
+	record.effects_cpu_duration_ns = effects_cpu_duration.count();
+	record.hook_cpu_duration_ns = _hook_cpu_duration_ns;
+	_frame_time_histogram.percentiles(s_telemetry_percentiles, record.frame_time_percentiles_ns);
+	record.effect_reload_count = _telemetry_reload_count;
+	record.num_techniques = 0;
 
-	LOG(INFO) << "Saving screenshot to " << screenshot_path << " ...";
+	for (const technique &tech : _techniques)
+	{
+		if (tech.passes_data.empty() || !tech.enabled)
+			continue;
+		if (record.num_techniques >= telemetry_frame_record::max_techniques)
+			break;
+
+		telemetry_technique_record &tech_record = record.techniques[record.num_techniques++];
+		tech_record.name[tech.name.copy(tech_record.name, sizeof(tech_record.name) - 1)] = '\0';
+		tech_record.cpu_duration_ns = tech.average_cpu_duration.last();
+		tech_record.gpu_duration_ns = tech.average_gpu_duration.last();
+		tech.gpu_duration_histogram.percentiles(s_telemetry_percentiles, tech_record.gpu_duration_percentiles_ns);
+	}
+
+	_telemetry->publish_record(record);
+}
 
-	_screenshot_save_success = false; // Default to a save failure unless it is reported to succeed below
+void reshade::runtime::update_benchmark()
+{
+	if ((_benchmark_frames == 0 && _benchmark_reloads == 0) || _benchmark_finished)
+		return;
 
-	if (std::vector<uint8_t> data(_width * _height * 4); take_screenshot(data.data()))
+	// Only start measuring once all effects are loaded and their pipelines are ready, and start over if they are reloaded in the middle of the run
+	if (is_loading() || !_reload_compile_queue.empty() || !_textures_loaded ||
+		std::any_of(_techniques.begin(), _techniques.end(), [](const technique &tech) { return tech.enabled && tech.pipelines_pending; }))
 	{
-		// Clear alpha channel
-		// The alpha channel doesn't need to be cleared if we're saving a JPEG, stbi ignores it
-		if (_screenshot_clear_alpha && _screenshot_format != 2)
-			for (uint32_t h = 0; h < _height; ++h)
-				for (uint32_t w = 0; w < _width; ++w)
-					data[(h * _width + w) * 4 + 3] = 0xFF;
+		_benchmark_start_frame = 0;
+		return;
+	}
 
-		if (FILE *file; _wfopen_s(&file, screenshot_path.c_str(), L"wb") == 0)
+	// Reload all effects a number of times with a cold cache first, then the same number of times with a warm cache, before measuring frames
+	if (_benchmark_loads.size() < _benchmark_reloads * 2)
+	{
+		if (_benchmark_reload_started)
 		{
-			const auto write_callback = [](void *context, void *data, int size) {
-				fwrite(data, 1, size, static_cast<FILE *>(context));
-			};
+			benchmark_load_result &load = _benchmark_loads.emplace_back();
+			load.cold_cache = _benchmark_loads.size() <= _benchmark_reloads;
+			load.duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - _last_reload_start_time).count();
+			for (size_t phase = 0; phase < static_cast<size_t>(benchmark_load_phase::count); ++phase)
+				load.phase_durations_ns[phase] = _load_phase_durations_ns[phase].load(std::memory_order_relaxed);
 
-			switch (_screenshot_format)
-			{
-			case 0:
-				_screenshot_save_success = stbi_write_bmp_to_func(write_callback, file, _width, _height, 4, data.data()) != 0;
-				break;
-			case 1:
-				_screenshot_save_success = stbi_write_png_to_func(write_callback, file, _width, _height, 4, data.data(), 0) != 0;
-				break;
-			case 2:
-				_screenshot_save_success = stbi_write_jpg_to_func(write_callback, file, _width, _height, 4, data.data(), _screenshot_jpeg_quality) != 0;
-				break;
-			}
+			LOG(INFO) << "Reloading effects with a " << (load.cold_cache ? "cold" : "warm") << " cache took " << (load.duration_ns * 1e-6) << " ms.";
+		}
 
-			fclose(file);
+		if (_benchmark_loads.size() < _benchmark_reloads * 2)
+		{
+			if (_benchmark_loads.size() < _benchmark_reloads)
+				clear_effect_cache();
+
+			_benchmark_reload_started = true;
+			reload_effects();
+			return;
 		}
 	}
 
-	_last_screenshot_file = screenshot_path;
-	_last_screenshot_time = std::chrono::high_resolution_clock::now();
+	if (_benchmark_start_frame == 0)
+	{
+		_benchmark_start_frame = _framecount;
+		_benchmark_peak_memory_usage = 0;
+		_benchmark_duration_sums.assign(_techniques.size(), {});
+#if RESHADE_PROFILING
+		_benchmark_calls.clear();
+#endif
+	}
+
+	_benchmark_peak_memory_usage = std::max(_benchmark_peak_memory_usage, _memory_usage);
+
+	for (size_t technique_index = 0; technique_index < _techniques.size(); ++technique_index)
+	{
+		const technique &tech = _techniques[technique_index];
+		_benchmark_duration_sums[technique_index].first += tech.average_cpu_duration.last();
+		_benchmark_duration_sums[technique_index].second += tech.average_gpu_duration.last();
+	}
 
-	if (!_screenshot_save_success)
+#if RESHADE_PROFILING
+	for (const profiling::call_statistics &call : _profiling_calls)
 	{
-		LOG(ERROR) << "Failed to write screenshot to " << screenshot_path << '!';
+		// Counters are static, so the name pointer identifies the hook
+		if (const auto it = std::find_if(_benchmark_calls.begin(), _benchmark_calls.end(), [&call](const profiling::call_statistics &existing) { return existing.name == call.name; });
+			it != _benchmark_calls.end())
+		{
+			it->count += call.count;
+			it->duration_ns += call.duration_ns;
+		}
+		else
+		{
+			_benchmark_calls.push_back(call);
+		}
 	}
-	else if (_screenshot_include_preset && should_save_preset && ini_file::flush_cache(_current_preset_path))
+#endif
+
+	const uint64_t num_frames = _framecount - _benchmark_start_frame + 1;
+	if (num_frames < _benchmark_frames)
+		return;
+
+	_benchmark_finished = true;
+
+	benchmark_report report = {};
+	report.renderer_id = _renderer_id;
+	report.width = _width;
+	report.height = _height;
+	report.num_frames = static_cast<uint32_t>(num_frames);
+	if (_last_reload_time > _last_reload_start_time)
+		report.reload_duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(_last_reload_time - _last_reload_start_time).count();
+	_frame_time_histogram.percentiles(s_telemetry_percentiles, report.frame_time_percentiles_ns);
+	report.peak_video_memory_usage = _benchmark_peak_memory_usage;
+	report.loads = std::move(_benchmark_loads);
+
+	for (size_t technique_index = 0; technique_index < _techniques.size(); ++technique_index)
 	{
-		// Preset was flushed to disk, so can just copy it over to the new location
-		std::error_code ec; std::filesystem::copy_file(_current_preset_path, screenshot_path.replace_extension(L".ini"), std::filesystem::copy_options::overwrite_existing, ec);
+		const technique &tech = _techniques[technique_index];
+		if (tech.passes_data.empty() || !tech.enabled)
+			continue;
+
+		benchmark_technique_result &result = report.techniques.emplace_back();
+		result.name = tech.name;
+		result.effect_name = _effects[tech.effect_index].source_file.filename().u8string();
+		result.average_cpu_duration_ns = _benchmark_duration_sums[technique_index].first / num_frames;
+		result.average_gpu_duration_ns = _benchmark_duration_sums[technique_index].second / num_frames;
+		tech.gpu_duration_histogram.percentiles(s_telemetry_percentiles, result.gpu_duration_percentiles_ns);
+		result.pixel_invocations = tech.average_pixel_invocations;
+		result.compute_invocations = tech.average_compute_invocations;
 	}
+
+#if RESHADE_PROFILING
+	for (const profiling::call_statistics &call : _benchmark_calls)
+		report.calls.push_back({ call.name, call.count, call.duration_ns });
+#endif
+
+	std::filesystem::path report_path = _benchmark_report_path;
+	if (report_path.empty())
+		report_path = g_reshade_base_path / L"ReShadeBenchmark.json";
+
+	if (report.write(report_path))
+		LOG(INFO) << "Wrote benchmark results of " << num_frames << " frames to " << report_path << '.';
 }
 
 static inline bool force_floating_point_value(const reshadefx::type &type, uint32_t renderer_id)
@@ -3483,6 +7488,48 @@ static inline bool force_floating_point_value(const reshadefx::type &type, uint3
 	return false;
 }
 
+template <size_t row_size>
+static void copy_strided_rows(uint8_t *dst, size_t dst_stride, const uint8_t *src, size_t src_stride, size_t num_rows)
+{
+	// The row size is a compile-time constant, so each copy turns into a few plain moves instead of a call
+	for (size_t i = 0; i < num_rows; ++i, dst += dst_stride, src += src_stride)
+		std::memcpy(dst, src, row_size);
+}
+// Copies 4-byte scalars between tightly packed values and uniform storage, which places every row of a matrix and every element of an array at a 16-byte boundary
+static void copy_uniform_rows(uint8_t *dst, const uint8_t *src, size_t row_components, size_t num_scalars, bool to_storage)
+{
+	assert(row_components != 0 && row_components <= 4);
+
+	// Rows with four components have no padding, so are laid out the same way and can be copied all at once
+	if (row_components == 4)
+	{
+		std::memcpy(dst, src, num_scalars * 4);
+		return;
+	}
+
+	const size_t packed_stride = row_components * 4;
+	const size_t dst_stride = to_storage ? 16 : packed_stride;
+	const size_t src_stride = to_storage ? packed_stride : 16;
+
+	const size_t num_rows = num_scalars / row_components;
+	switch (row_components)
+	{
+	case 1:
+		copy_strided_rows<4>(dst, dst_stride, src, src_stride, num_rows);
+		break;
+	case 2:
+		copy_strided_rows<8>(dst, dst_stride, src, src_stride, num_rows);
+		break;
+	case 3:
+		copy_strided_rows<12>(dst, dst_stride, src, src_stride, num_rows);
+		break;
+	}
+
+	// Copy the part of the last row that was requested
+	if (const size_t remaining = num_scalars % row_components; remaining != 0)
+		std::memcpy(dst + num_rows * dst_stride, src + num_rows * src_stride, remaining * 4);
+}
+
 void reshade::runtime::get_uniform_value(const uniform &variable, uint8_t *data, size_t size, size_t base_index) const
 {
 	size = std::min(size, static_cast<size_t>(variable.size));
@@ -3495,24 +7542,14 @@ void reshade::runtime::get_uniform_value(const uniform &variable, uint8_t *data,
 	if (assert(base_index < array_length); base_index >= array_length)
 		return;
 
-	if (variable.type.is_matrix())
+	if (variable.type.is_matrix() || array_length > 1)
 	{
-		for (size_t a = base_index, i = 0; a < array_length; ++a)
-			// Each row of a matrix is 16-byte aligned, so needs special handling
-			for (size_t row = 0; row < variable.type.rows; ++row)
-				for (size_t col = 0; i < (size / 4) && col < variable.type.cols; ++col, ++i)
-					std::memcpy(
-						data + ((a - base_index) * variable.type.components() + (row * variable.type.cols + col)) * 4,
-						data_storage.data() + variable.offset + (a * (variable.type.rows * 4) + (row * 4 + col)) * 4, 4);
-	}
-	else if (array_length > 1)
-	{
-		for (size_t a = base_index, i = 0; a < array_length; ++a)
-			// Each element in the array is 16-byte aligned, so needs special handling
-			for (size_t row = 0; i < (size / 4) && row < variable.type.rows; ++row, ++i)
-				std::memcpy(
-					data + ((a - base_index) * variable.type.components() + row) * 4,
-					data_storage.data() + variable.offset + (a * 4 + row) * 4, 4);
+		// Each row of a matrix and each element in an array is 16-byte aligned, so needs special handling
+		const size_t row_components = variable.type.is_matrix() ? variable.type.cols : variable.type.rows;
+		const size_t rows_per_element = variable.type.is_matrix() ? variable.type.rows : 1;
+		const size_t num_scalars = std::min(size / 4, (array_length - base_index) * rows_per_element * row_components);
+
+		copy_uniform_rows(data, data_storage.data() + variable.offset + base_index * rows_per_element * 16, row_components, num_scalars, false);
 	}
 	else
 	{
@@ -3583,24 +7620,20 @@ void reshade::runtime::set_uniform_value(uniform &variable, const uint8_t *data,
 	if (assert(base_index < array_length); base_index >= array_length)
 		return;
 
-	if (variable.type.is_matrix())
-	{
-		for (size_t a = base_index, i = 0; a < array_length; ++a)
-			// Each row of a matrix is 16-byte aligned, so needs special handling
-			for (size_t row = 0; row < variable.type.rows; ++row)
-				for (size_t col = 0; i < (size / 4) && col < variable.type.cols; ++col, ++i)
-					std::memcpy(
-						data_storage.data() + variable.offset + (a * variable.type.rows * 4 + (row * 4 + col)) * 4,
-						data + ((a - base_index) * variable.type.components() + (row * variable.type.cols + col)) * 4, 4);
-	}
-	else if (array_length > 1)
+	// Most special variables (like key states, the date or the mouse position) keep the same value for many frames, so avoid uploading them again when nothing changed
+	if (array_length == 1 && !variable.type.is_matrix() && std::memcmp(data_storage.data() + variable.offset, data, size) == 0)
+		return;
+
+	mark_uniform_value_dirty(variable);
+
+	if (variable.type.is_matrix() || array_length > 1)
 	{
-		for (size_t a = base_index, i = 0; a < array_length; ++a)
-			// Each element in the array is 16-byte aligned, so needs special handling
-			for (size_t row = 0; i < (size / 4) && row < variable.type.rows; ++row, ++i)
-				std::memcpy(
-					data_storage.data() + variable.offset + (a * 4 + row) * 4,
-					data + ((a - base_index) * variable.type.components() + row) * 4, 4);
+		// Each row of a matrix and each element in an array is 16-byte aligned, so needs special handling
+		const size_t row_components = variable.type.is_matrix() ? variable.type.cols : variable.type.rows;
+		const size_t rows_per_element = variable.type.is_matrix() ? variable.type.rows : 1;
+		const size_t num_scalars = std::min(size / 4, (array_length - base_index) * rows_per_element * row_components);
+
+		copy_uniform_rows(data_storage.data() + variable.offset + base_index * rows_per_element * 16, data, row_components, num_scalars, true);
 	}
 	else
 	{
@@ -3672,11 +7705,18 @@ void reshade::runtime::set_uniform_value(uniform &variable, const float *values,
 	}
 }
 
+void reshade::runtime::mark_uniform_value_dirty(const uniform &variable)
+{
+	effect &effect = _effects[variable.effect_index];
+	effect.uniform_data_dirty_begin = std::min<size_t>(effect.uniform_data_dirty_begin, variable.offset);
+	effect.uniform_data_dirty_end = std::max<size_t>(effect.uniform_data_dirty_end, variable.offset + variable.size);
+}
 void reshade::runtime::reset_uniform_value(uniform &variable)
 {
 	if (!variable.has_initializer_value)
 	{
 		std::memset(_effects[variable.effect_index].uniform_data_storage.data() + variable.offset, 0, variable.size);
+		mark_uniform_value_dirty(variable);
 		return;
 	}
 
@@ -3716,76 +7756,543 @@ void reshade::runtime::update_texture_bindings(const char *semantic, api::resour
 		srv = _empty_texture_view;
 	}
 
-	// Make sure all previous frames have finished before freeing the image view and updating descriptors (since they may be in use otherwise)
-	_device->wait_idle();
+	const bool sampler_with_resource_view = _device->check_capability(api::device_caps::sampler_with_resource_view);
 
-	// Update texture bindings
+	// Descriptor sets may still be referenced by frames in flight, so instead of waiting for those to finish and updating them in place, write a new version of every affected set and retire the old one
 	std::vector<api::descriptor_set_write> descriptor_writes;
+	std::vector<std::pair<api::descriptor_set, api::descriptor_set>> replaced_sets;
 
-	for (effect &effect_data : _effects)
+	for (size_t effect_index = 0; effect_index < _effects.size(); ++effect_index)
 	{
-		for (const auto &binding : effect_data.texture_semantic_to_binding)
+		effect &effect_data = _effects[effect_index];
+
+		const auto semantic_bindings = effect_data.texture_semantic_to_binding.find(semantic);
+		if (semantic_bindings == effect_data.texture_semantic_to_binding.end())
+			continue;
+
+		replaced_sets.clear();
+
+		for (const effect::binding_data &binding : semantic_bindings->second)
 		{
-			if (binding.semantic != semantic)
-				continue;
+			auto replaced = std::find_if(replaced_sets.begin(), replaced_sets.end(),
+				[&binding](const std::pair<api::descriptor_set, api::descriptor_set> &sets) { return sets.first == binding.set; });
+			if (replaced == replaced_sets.end())
+			{
+				api::descriptor_set new_set = {};
+				if (!_device->create_descriptor_sets(effect_data.set_layouts[sampler_with_resource_view ? 1 : 2], 1, &new_set))
+				{
+					LOG(ERROR) << "Failed to create texture descriptor set for effect file '" << effect_data.source_file << "'!";
+					continue;
+				}
+
+				replaced = replaced_sets.emplace(replaced_sets.end(), binding.set, new_set);
+			}
 
-			api::descriptor_set_write &write = descriptor_writes.emplace_back();
-			write.set = binding.set;
-			write.binding = binding.index;
-			write.type = binding.sampler.handle != 0 ? api::descriptor_type::sampler_with_resource_view : api::descriptor_type::shader_resource_view;
-			write.descriptor.sampler = binding.sampler;
-			write.descriptor.view = srv;
+			std::vector<api::descriptor_set_write> &writes = effect_data.texture_set_writes.at(binding.set.handle);
+			for (api::descriptor_set_write &write : writes)
+				if (write.binding == binding.index)
+					write.descriptor.view = srv;
 		}
+
+		replace_texture_sets(effect_index, replaced_sets, descriptor_writes);
 	}
 
 	_device->update_descriptor_sets(static_cast<uint32_t>(descriptor_writes.size()), descriptor_writes.data());
 }
+void reshade::runtime::replace_texture_sets(size_t effect_index, const std::vector<std::pair<api::descriptor_set, api::descriptor_set>> &replaced_sets, std::vector<api::descriptor_set_write> &descriptor_writes)
+{
+	effect &effect_data = _effects[effect_index];
+
+	// Commands recorded so far may still reference the previous versions of these sets
+	const uint64_t retire_fence_value = replaced_sets.empty() ? 0 : _graphics_queue->get_pending_fence_value();
+
+	for (const std::pair<api::descriptor_set, api::descriptor_set> &sets : replaced_sets)
+	{
+		auto writes_node = effect_data.texture_set_writes.extract(sets.first.handle);
+		for (api::descriptor_set_write &write : writes_node.mapped())
+			write.set = sets.second;
+		descriptor_writes.insert(descriptor_writes.end(), writes_node.mapped().begin(), writes_node.mapped().end());
+		writes_node.key() = sets.second.handle;
+		effect_data.texture_set_writes.insert(std::move(writes_node));
+
+		std::replace(effect_data.texture_sets.begin(), effect_data.texture_sets.end(), sets.first, sets.second);
+		effect_data.retired_texture_sets.emplace_back(retire_fence_value, sets.first);
+
+		// Sets may contain bindings of other semantics too, which have to refer to the new version as well
+		for (auto &[other_semantic, bindings] : effect_data.texture_semantic_to_binding)
+			for (effect::binding_data &binding : bindings)
+				if (binding.set == sets.first)
+					binding.set = sets.second;
+	}
+
+	for (technique &tech : _techniques)
+	{
+		if (tech.effect_index != effect_index)
+			continue;
+
+		bool modified = false;
+		for (technique::pass_data &pass_data : tech.passes_data)
+		{
+			for (const std::pair<api::descriptor_set, api::descriptor_set> &sets : replaced_sets)
+			{
+				if (pass_data.texture_set == sets.first)
+				{
+					pass_data.texture_set = sets.second;
+					modified = true;
+				}
+			}
+		}
+
+		// Descriptor sets are referenced by the recorded commands, so those would keep using the old bindings
+		if (modified)
+			destroy_technique_recordings(tech);
+	}
+}
 
 void reshade::runtime::update_uniform_variables(const char *source, const bool *values, size_t count, size_t array_index)
 {
 	if (is_loading())
 		return;
 
-	for (effect &effect : _effects)
-		for (uniform &variable : effect.uniforms)
-			if (variable.annotation_as_string("source") == source)
-				set_uniform_value(variable, values, count, array_index);
+	update_uniform_source_variables(find_uniform_source(source), values, count, array_index);
 }
 void reshade::runtime::update_uniform_variables(const char *source, const float *values, size_t count, size_t array_index)
 {
 	if (is_loading())
 		return;
 
-	for (effect &effect : _effects)
-		for (uniform &variable : effect.uniforms)
-			if (variable.annotation_as_string("source") == source)
-				set_uniform_value(variable, values, count, array_index);
+	update_uniform_source_variables(find_uniform_source(source), values, count, array_index);
 }
 void reshade::runtime::update_uniform_variables(const char *source, const int32_t *values, size_t count, size_t array_index)
 {
 	if (is_loading())
 		return;
 
-	for (effect &effect : _effects)
-		for (uniform &variable : effect.uniforms)
-			if (variable.annotation_as_string("source") == source)
-				set_uniform_value(variable, values, count, array_index);
+	update_uniform_source_variables(find_uniform_source(source), values, count, array_index);
 }
 void reshade::runtime::update_uniform_variables(const char *source, const uint32_t *values, size_t count, size_t array_index)
 {
 	if (is_loading())
 		return;
 
-	for (effect &effect : _effects)
-		for (uniform &variable : effect.uniforms)
-			if (variable.annotation_as_string("source") == source)
-				set_uniform_value(variable, values, count, array_index);
+	update_uniform_source_variables(find_uniform_source(source), values, count, array_index);
+}
+
+reshade::api::effect_uniform_source reshade::runtime::find_uniform_source(const char *source)
+{
+	// Nodes of an unordered map never move, so the address of an entry stays valid as a handle
+	return { reinterpret_cast<uintptr_t>(&*_uniform_sources.try_emplace(source).first) };
+}
+void reshade::runtime::update_uniform_source_variables(api::effect_uniform_source source, const bool *values, size_t count, size_t array_index)
+{
+	if (is_loading() || source.handle == 0)
+		return;
+
+	if (_effect_handles_outdated)
+		update_effect_handles();
+
+	for (const auto &[effect_index, uniform_index] : reinterpret_cast<const decltype(_uniform_sources)::value_type *>(source.handle)->second)
+		set_uniform_value(_effects[effect_index].uniforms[uniform_index], values, count, array_index);
+}
+void reshade::runtime::update_uniform_source_variables(api::effect_uniform_source source, const float *values, size_t count, size_t array_index)
+{
+	if (is_loading() || source.handle == 0)
+		return;
+
+	if (_effect_handles_outdated)
+		update_effect_handles();
+
+	for (const auto &[effect_index, uniform_index] : reinterpret_cast<const decltype(_uniform_sources)::value_type *>(source.handle)->second)
+		set_uniform_value(_effects[effect_index].uniforms[uniform_index], values, count, array_index);
+}
+void reshade::runtime::update_uniform_source_variables(api::effect_uniform_source source, const int32_t *values, size_t count, size_t array_index)
+{
+	if (is_loading() || source.handle == 0)
+		return;
+
+	if (_effect_handles_outdated)
+		update_effect_handles();
+
+	for (const auto &[effect_index, uniform_index] : reinterpret_cast<const decltype(_uniform_sources)::value_type *>(source.handle)->second)
+		set_uniform_value(_effects[effect_index].uniforms[uniform_index], values, count, array_index);
+}
+void reshade::runtime::update_uniform_source_variables(api::effect_uniform_source source, const uint32_t *values, size_t count, size_t array_index)
+{
+	if (is_loading() || source.handle == 0)
+		return;
+
+	if (_effect_handles_outdated)
+		update_effect_handles();
+
+	for (const auto &[effect_index, uniform_index] : reinterpret_cast<const decltype(_uniform_sources)::value_type *>(source.handle)->second)
+		set_uniform_value(_effects[effect_index].uniforms[uniform_index], values, count, array_index);
+}
+void reshade::runtime::update_effect_handles()
+{
+	_effect_handles_outdated = false;
+
+	// Keep existing entries, since their address may have been handed out as a handle
+	for (auto &entry : _uniform_sources)
+		entry.second.clear();
+	for (auto &entry : _uniform_handles)
+		entry.second = { std::numeric_limits<size_t>::max(), std::numeric_limits<size_t>::max() };
+	for (auto &entry : _texture_handles)
+		entry.second = std::numeric_limits<size_t>::max();
+	for (auto &entry : _technique_handles)
+		entry.second = std::numeric_limits<size_t>::max();
+
+	std::vector<std::string> effect_names(_effects.size());
+	for (size_t effect_index = 0; effect_index < _effects.size(); ++effect_index)
+	{
+		effect_names[effect_index] = '@' + _effects[effect_index].source_file.filename().u8string();
+
+		const std::vector<uniform> &uniforms = _effects[effect_index].uniforms;
+		for (size_t uniform_index = 0; uniform_index < uniforms.size(); ++uniform_index)
+		{
+			if (const std::string_view source = uniforms[uniform_index].annotation_as_string("source"); !source.empty())
+				_uniform_sources[std::string(source)].emplace_back(effect_index, uniform_index);
+
+			if (!_uniform_handles.empty())
+				if (const auto it = _uniform_handles.find(uniforms[uniform_index].name + effect_names[effect_index]); it != _uniform_handles.end())
+					it->second = { effect_index, uniform_index };
+		}
+	}
+
+	if (!_texture_handles.empty())
+	{
+		for (size_t texture_index = 0; texture_index < _textures.size(); ++texture_index)
+			for (const size_t effect_index : _textures[texture_index].shared)
+				if (const auto it = _texture_handles.find(_textures[texture_index].unique_name + effect_names[effect_index]); it != _texture_handles.end())
+					it->second = texture_index;
+	}
+
+	if (!_technique_handles.empty())
+	{
+		for (size_t technique_index = 0; technique_index < _techniques.size(); ++technique_index)
+			if (const auto it = _technique_handles.find(_techniques[technique_index].name + effect_names[_techniques[technique_index].effect_index]); it != _technique_handles.end())
+				it->second = technique_index;
+	}
+}
+
+reshade::uniform *reshade::runtime::resolve_handle(api::effect_uniform_variable handle)
+{
+	if (is_loading() || handle.handle == 0)
+		return nullptr;
+
+	if (_effect_handles_outdated)
+		update_effect_handles();
+
+	const auto &[effect_index, uniform_index] = reinterpret_cast<const decltype(_uniform_handles)::value_type *>(handle.handle)->second;
+	if (effect_index >= _effects.size())
+		return nullptr;
+
+	return &_effects[effect_index].uniforms[uniform_index];
+}
+reshade::texture *reshade::runtime::resolve_handle(api::effect_texture_variable handle)
+{
+	if (is_loading() || handle.handle == 0)
+		return nullptr;
+
+	if (_effect_handles_outdated)
+		update_effect_handles();
+
+	const size_t texture_index = reinterpret_cast<const decltype(_texture_handles)::value_type *>(handle.handle)->second;
+	if (texture_index >= _textures.size())
+		return nullptr;
+
+	return &_textures[texture_index];
+}
+reshade::technique *reshade::runtime::resolve_handle(api::effect_technique handle)
+{
+	if (is_loading() || handle.handle == 0)
+		return nullptr;
+
+	if (_effect_handles_outdated)
+		update_effect_handles();
+
+	const size_t technique_index = reinterpret_cast<const decltype(_technique_handles)::value_type *>(handle.handle)->second;
+	if (technique_index >= _techniques.size())
+		return nullptr;
+
+	return &_techniques[technique_index];
+}
+
+void reshade::runtime::enumerate_uniform_variables(const char *effect_name, void(*callback)(api::effect_runtime *runtime, api::effect_uniform_variable variable, const char *name, void *user_data), void *user_data)
+{
+	if (is_loading())
+		return;
+
+	for (size_t effect_index = 0; effect_index < _effects.size(); ++effect_index)
+	{
+		const std::string current_effect_name = _effects[effect_index].source_file.filename().u8string();
+		if (effect_name != nullptr && current_effect_name != effect_name)
+			continue;
+
+		for (size_t uniform_index = 0; uniform_index < _effects[effect_index].uniforms.size(); ++uniform_index)
+		{
+			const uniform &variable = _effects[effect_index].uniforms[uniform_index];
+
+			// Enumerating walks the current effect list, so the indices are known and can be assigned right away
+			auto &entry = *_uniform_handles.insert_or_assign(variable.name + '@' + current_effect_name, std::make_pair(effect_index, uniform_index)).first;
+
+			callback(this, { reinterpret_cast<uintptr_t>(&entry) }, variable.name.c_str(), user_data);
+		}
+	}
+}
+reshade::api::effect_uniform_variable reshade::runtime::find_uniform_variable(const char *effect_name, const char *variable_name)
+{
+	const auto it = _uniform_handles.try_emplace(std::string(variable_name) + '@' + effect_name, std::numeric_limits<size_t>::max(), std::numeric_limits<size_t>::max());
+	if (it.second)
+		_effect_handles_outdated = true; // Resolve the new handle on first use
+
+	return { reinterpret_cast<uintptr_t>(&*it.first) };
+}
+bool reshade::runtime::get_uniform_value(api::effect_uniform_variable variable, bool *values, size_t count, size_t array_index)
+{
+	const uniform *const variable_object = resolve_handle(variable);
+	if (variable_object == nullptr)
+		return false;
+
+	get_uniform_value(*variable_object, values, count, array_index);
+	return true;
+}
+bool reshade::runtime::get_uniform_value(api::effect_uniform_variable variable, float *values, size_t count, size_t array_index)
+{
+	const uniform *const variable_object = resolve_handle(variable);
+	if (variable_object == nullptr)
+		return false;
+
+	get_uniform_value(*variable_object, values, count, array_index);
+	return true;
+}
+bool reshade::runtime::get_uniform_value(api::effect_uniform_variable variable, int32_t *values, size_t count, size_t array_index)
+{
+	const uniform *const variable_object = resolve_handle(variable);
+	if (variable_object == nullptr)
+		return false;
+
+	get_uniform_value(*variable_object, values, count, array_index);
+	return true;
+}
+bool reshade::runtime::get_uniform_value(api::effect_uniform_variable variable, uint32_t *values, size_t count, size_t array_index)
+{
+	const uniform *const variable_object = resolve_handle(variable);
+	if (variable_object == nullptr)
+		return false;
+
+	get_uniform_value(*variable_object, values, count, array_index);
+	return true;
+}
+void reshade::runtime::set_uniform_value(api::effect_uniform_variable variable, const bool *values, size_t count, size_t array_index)
+{
+	if (uniform *const variable_object = resolve_handle(variable))
+		set_uniform_value(*variable_object, values, count, array_index);
+}
+void reshade::runtime::set_uniform_value(api::effect_uniform_variable variable, const float *values, size_t count, size_t array_index)
+{
+	if (uniform *const variable_object = resolve_handle(variable))
+		set_uniform_value(*variable_object, values, count, array_index);
+}
+void reshade::runtime::set_uniform_value(api::effect_uniform_variable variable, const int32_t *values, size_t count, size_t array_index)
+{
+	if (uniform *const variable_object = resolve_handle(variable))
+		set_uniform_value(*variable_object, values, count, array_index);
+}
+void reshade::runtime::set_uniform_value(api::effect_uniform_variable variable, const uint32_t *values, size_t count, size_t array_index)
+{
+	if (uniform *const variable_object = resolve_handle(variable))
+		set_uniform_value(*variable_object, values, count, array_index);
+}
+
+void reshade::runtime::enumerate_texture_variables(const char *effect_name, void(*callback)(api::effect_runtime *runtime, api::effect_texture_variable variable, const char *name, void *user_data), void *user_data)
+{
+	if (is_loading())
+		return;
+
+	for (size_t effect_index = 0; effect_index < _effects.size(); ++effect_index)
+	{
+		const std::string current_effect_name = _effects[effect_index].source_file.filename().u8string();
+		if (effect_name != nullptr && current_effect_name != effect_name)
+			continue;
+
+		for (size_t texture_index = 0; texture_index < _textures.size(); ++texture_index)
+		{
+			const texture &tex = _textures[texture_index];
+			if (std::find(tex.shared.begin(), tex.shared.end(), effect_index) == tex.shared.end())
+				continue;
+
+			auto &entry = *_texture_handles.insert_or_assign(tex.unique_name + '@' + current_effect_name, texture_index).first;
+
+			callback(this, { reinterpret_cast<uintptr_t>(&entry) }, tex.unique_name.c_str(), user_data);
+		}
+	}
+}
+reshade::api::effect_texture_variable reshade::runtime::find_texture_variable(const char *effect_name, const char *variable_name)
+{
+	const auto it = _texture_handles.try_emplace(std::string(variable_name) + '@' + effect_name, std::numeric_limits<size_t>::max());
+	if (it.second)
+		_effect_handles_outdated = true;
+
+	return { reinterpret_cast<uintptr_t>(&*it.first) };
+}
+bool reshade::runtime::get_texture_resource_view(api::effect_texture_variable variable, api::resource_view *out_srv, api::resource_view *out_srv_srgb)
+{
+	const texture *const tex = resolve_handle(variable);
+	if (tex == nullptr)
+		return false;
+
+	if (out_srv != nullptr)
+		*out_srv = tex->srv[0];
+	if (out_srv_srgb != nullptr)
+		*out_srv_srgb = tex->srv[1];
+	return true;
+}
+
+void reshade::runtime::enumerate_techniques(const char *effect_name, void(*callback)(api::effect_runtime *runtime, api::effect_technique technique, const char *name, void *user_data), void *user_data)
+{
+	if (is_loading())
+		return;
+
+	std::string current_effect_name;
+	for (size_t technique_index = 0; technique_index < _techniques.size(); ++technique_index)
+	{
+		const technique &tech = _techniques[technique_index];
+
+		current_effect_name = _effects[tech.effect_index].source_file.filename().u8string();
+		if (effect_name != nullptr && current_effect_name != effect_name)
+			continue;
+
+		auto &entry = *_technique_handles.insert_or_assign(tech.name + '@' + current_effect_name, technique_index).first;
+
+		callback(this, { reinterpret_cast<uintptr_t>(&entry) }, tech.name.c_str(), user_data);
+	}
+}
+reshade::api::effect_technique reshade::runtime::find_technique(const char *effect_name, const char *technique_name)
+{
+	const auto it = _technique_handles.try_emplace(std::string(technique_name) + '@' + effect_name, std::numeric_limits<size_t>::max());
+	if (it.second)
+		_effect_handles_outdated = true;
+
+	return { reinterpret_cast<uintptr_t>(&*it.first) };
+}
+bool reshade::runtime::get_technique_state(api::effect_technique technique)
+{
+	const reshade::technique *const tech = resolve_handle(technique);
+	return tech != nullptr && tech->enabled;
+}
+void reshade::runtime::set_technique_state(api::effect_technique technique, bool enabled)
+{
+	reshade::technique *const tech = resolve_handle(technique);
+	if (tech == nullptr)
+		return;
+
+	if (enabled)
+		enable_technique(*tech);
+	else
+		disable_technique(*tech);
+}
+uint64_t reshade::runtime::get_technique_gpu_duration(api::effect_technique technique)
+{
+	const reshade::technique *const tech = resolve_handle(technique);
+	return tech != nullptr ? static_cast<uint64_t>(tech->average_gpu_duration) : 0;
+}
+
+void reshade::runtime::compile_shader(const char *source, size_t source_size, const char *entry_point, const char *profile, void(*callback)(api::effect_runtime *runtime, const void *code, size_t code_size, const char *errors, void *user_data), void *user_data)
+{
+	assert(source != nullptr && entry_point != nullptr && profile != nullptr && callback != nullptr);
+
+	if ((_renderer_id & 0xF0000) != 0)
+	{
+		callback(this, nullptr, 0, "error: compiling shaders is only supported with D3D9, D3D10, D3D11 and D3D12", user_data);
+		return;
+	}
+
+	// Load the compilers here (on the thread that presents), so that the background compilation below does not have to synchronize this
+	if (_d3d_compiler == nullptr)
+	{
+		_d3d_compiler = LoadLibraryW(L"d3dcompiler_47.dll");
+		if (_d3d_compiler == nullptr)
+			_d3d_compiler = LoadLibraryW(L"d3dcompiler_43.dll");
+	}
+
+	std::string profile_string = profile;
+	// Shader model 6 profiles can only be compiled to DXIL by DXC, which only D3D12 can make use of
+	const bool use_dxc = _renderer_id >= 0xc000 && profile_string.size() > 3 && profile_string.compare(profile_string.size() - 3, 2, "6_") == 0;
+	if (use_dxc ? !load_dxc_compiler() : _d3d_compiler == nullptr)
+	{
+		callback(this, nullptr, 0, use_dxc ? "error: unable to load dxcompiler.dll" : "error: unable to load d3dcompiler_47.dll", user_data);
+		return;
+	}
+
+	_worker_pool.submit([this, hlsl = std::string(source, source_size), entry_point = std::string(entry_point), profile = std::move(profile_string), use_dxc, callback, user_data]() {
+		const unsigned int compile_flags = D3DCOMPILE_OPTIMIZATION_LEVEL3;
+
+		std::string attributes;
+		attributes += "entrypoint=" + entry_point + ';';
+		attributes += "profile=" + profile + ';';
+		attributes += "flags=" + std::to_string(compile_flags) + ';';
+
+		const size_t hash = std::hash<std::string_view>()(attributes) ^ std::hash<std::string_view>()(hlsl);
+		// All add-on shaders share a pseudo source file name in the cache, which is fine, since the key includes the hash of the source code
+		const std::filesystem::path source_file = L"addon";
+
+		std::vector<char> cso;
+		std::string assembly, errors;
+
+		if (load_effect_cache(source_file, entry_point, hash, cso, assembly))
+		{
+			callback(this, cso.data(), cso.size(), "", user_data);
+			return;
+		}
+
+		if (use_dxc)
+		{
+			const bool succeeded = compile_dxil(hlsl, "RESHADE_ADDON_SHADER", entry_point, profile, compile_flags, cso, assembly, errors);
+			if (succeeded)
+				save_effect_cache(source_file, entry_point, hash, cso, assembly);
+
+			callback(this, succeeded ? cso.data() : nullptr, succeeded ? cso.size() : 0, errors.c_str(), user_data);
+			return;
+		}
+
+		const auto D3DCompile = reinterpret_cast<pD3DCompile>(GetProcAddress(static_cast<HMODULE>(_d3d_compiler), "D3DCompile"));
+		const auto D3DDisassemble = reinterpret_cast<pD3DDisassemble>(GetProcAddress(static_cast<HMODULE>(_d3d_compiler), "D3DDisassemble"));
+
+		com_ptr<ID3DBlob> d3d_compiled, d3d_errors;
+		const HRESULT hr = D3DCompile(
+			hlsl.data(), hlsl.size(),
+			nullptr, nullptr, nullptr,
+			entry_point.c_str(),
+			profile.c_str(),
+			compile_flags, 0,
+			&d3d_compiled, &d3d_errors);
+
+		if (d3d_errors != nullptr)
+			errors.assign(static_cast<const char *>(d3d_errors->GetBufferPointer()), d3d_errors->GetBufferSize() - 1);
+
+		if (FAILED(hr))
+		{
+			callback(this, nullptr, 0, errors.c_str(), user_data);
+			return;
+		}
+
+		cso.resize(d3d_compiled->GetBufferSize());
+		std::memcpy(cso.data(), d3d_compiled->GetBufferPointer(), cso.size());
+
+		if (com_ptr<ID3DBlob> d3d_disassembled; SUCCEEDED(D3DDisassemble(cso.data(), cso.size(), 0, nullptr, &d3d_disassembled)))
+			assembly.assign(static_cast<const char *>(d3d_disassembled->GetBufferPointer()), d3d_disassembled->GetBufferSize() - 1);
+
+		save_effect_cache(source_file, entry_point, hash, cso, assembly);
+
+		callback(this, cso.data(), cso.size(), errors.c_str(), user_data);
+	});
 }
 
 reshade::texture &reshade::runtime::look_up_texture_by_name(const std::string &unique_name)
 {
-	const auto it = std::find_if(_textures.begin(), _textures.end(),
-		[&unique_name](const auto &item) { return item.unique_name == unique_name && (item.resource.handle != 0 || !item.semantic.empty()); });
-	assert(it != _textures.end());
-	return *it;
+	const auto it = _texture_indices.find(unique_name);
+	assert(it != _texture_indices.end());
+	texture &tex = _textures[it->second];
+	assert(tex.resource.handle != 0 || !tex.semantic.empty());
+	return tex;
 }
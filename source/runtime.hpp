@@ -6,8 +6,13 @@
 #pragma once
 
 #include "reshade_api.hpp"
+#include "thread_pool.hpp"
+#include "moving_histogram.hpp"
+#include "profiling.hpp"
+#include "benchmark.hpp"
 #if RESHADE_GUI
 #include "imgui_code_editor.hpp"
+#include "frame_timeline.hpp"
 
 struct ImDrawData;
 struct ImGuiContext;
@@ -23,10 +28,19 @@ struct ImGuiContext;
 namespace reshade
 {
 	class ini_file; // Forward declarations to avoid excessive #include
+	class cache_archive;
+	class file_watcher;
+	class directory_index;
+	class frame_sink;
+	class telemetry;
 	struct effect;
+	struct compiled_shaders;
 	struct uniform;
 	struct texture;
 	struct technique;
+	struct aliased_resource;
+	struct effect_permutation;
+	struct shared_effect_cache;
 
 	/// <summary>
 	/// Platform independent base class for the main ReShade effect runtime.
@@ -44,6 +58,12 @@ namespace reshade
 		/// </summary>
 		void get_frame_width_and_height(uint32_t *width, uint32_t *height) const final { *width = _width; *height = _height; }
 
+		/// <summary>
+		/// Keeps loaded effects alive through the next reset, because the swap chain is only resized and the device stays the same.
+		/// If the back buffer ends up with the same dimensions and format afterwards (e.g. when switching in and out of fullscreen), the effects are used as is instead of being loaded again.
+		/// </summary>
+		void keep_effects_on_next_reset() { _keep_effects_on_reset = true; }
+
 		/// <summary>
 		/// Creates a copy of the current frame image in system memory.
 		/// </summary>
@@ -51,9 +71,31 @@ namespace reshade
 		bool take_screenshot(uint8_t *buffer);
 		/// <summary>
 		/// Creates a copy of the current frame and write it to an image file on disk.
+		/// This only records the copy, the data is read back once the GPU finished it and then encoded and written to disk on a worker thread (see <see cref="process_pending_screenshots"/>).
 		/// </summary>
 		void save_screenshot(const std::wstring &postfix = std::wstring(), bool should_save_preset = false);
 
+		/// <summary>
+		/// Starts capturing every frame (or every Nth frame, see 'CaptureFrameInterval') and streaming it to a raw file or an external encoder process.
+		/// </summary>
+		bool start_capture();
+		/// <summary>
+		/// Stops capturing frames, after writing out all frames that are still in flight.
+		/// </summary>
+		void stop_capture();
+		/// <summary>
+		/// Gets a boolean indicating whether frames are currently being captured.
+		/// </summary>
+		bool is_capturing() const { return _capture_sink != nullptr; }
+
+		/// <summary>
+		/// Sets the area of the back buffer that is never visible (e.g. the part hidden by the lenses of a VR headset), so that effects skip shading those pixels.
+		/// Only affects effects that are loaded afterwards, so should be called before the runtime is initialized.
+		/// </summary>
+		/// <param name="vertices">List of triangles, with each vertex being a 2D position in normalized texture coordinates (with the origin being the top-left corner).</param>
+		/// <param name="num_triangles">Number of triangles in the <paramref name="vertices"/> list.</param>
+		void set_hidden_area_mesh(const float *vertices, uint32_t num_triangles);
+
 		/// <summary>
 		/// Gets the value of a uniform variable.
 		/// </summary>
@@ -105,6 +147,40 @@ namespace reshade
 		void update_uniform_variables(const char *source, const int32_t *values, size_t count, size_t array_index) final;
 		void update_uniform_variables(const char *source, const uint32_t *values, size_t count, size_t array_index) final;
 
+		/// <summary>
+		/// Gets a handle to the list of uniform variables with a "source" annotation set to <paramref name="source"/>.
+		/// </summary>
+		api::effect_uniform_source find_uniform_source(const char *source) final;
+		void update_uniform_source_variables(api::effect_uniform_source source, const bool *values, size_t count, size_t array_index) final;
+		void update_uniform_source_variables(api::effect_uniform_source source, const float *values, size_t count, size_t array_index) final;
+		void update_uniform_source_variables(api::effect_uniform_source source, const int32_t *values, size_t count, size_t array_index) final;
+		void update_uniform_source_variables(api::effect_uniform_source source, const uint32_t *values, size_t count, size_t array_index) final;
+
+		void enumerate_uniform_variables(const char *effect_name, void(*callback)(api::effect_runtime *runtime, api::effect_uniform_variable variable, const char *name, void *user_data), void *user_data) final;
+		api::effect_uniform_variable find_uniform_variable(const char *effect_name, const char *variable_name) final;
+		bool get_uniform_value(api::effect_uniform_variable variable, bool *values, size_t count, size_t array_index) final;
+		bool get_uniform_value(api::effect_uniform_variable variable, float *values, size_t count, size_t array_index) final;
+		bool get_uniform_value(api::effect_uniform_variable variable, int32_t *values, size_t count, size_t array_index) final;
+		bool get_uniform_value(api::effect_uniform_variable variable, uint32_t *values, size_t count, size_t array_index) final;
+		void set_uniform_value(api::effect_uniform_variable variable, const bool *values, size_t count, size_t array_index) final;
+		void set_uniform_value(api::effect_uniform_variable variable, const float *values, size_t count, size_t array_index) final;
+		void set_uniform_value(api::effect_uniform_variable variable, const int32_t *values, size_t count, size_t array_index) final;
+		void set_uniform_value(api::effect_uniform_variable variable, const uint32_t *values, size_t count, size_t array_index) final;
+
+		void enumerate_texture_variables(const char *effect_name, void(*callback)(api::effect_runtime *runtime, api::effect_texture_variable variable, const char *name, void *user_data), void *user_data) final;
+		api::effect_texture_variable find_texture_variable(const char *effect_name, const char *variable_name) final;
+		bool get_texture_resource_view(api::effect_texture_variable variable, api::resource_view *out_srv, api::resource_view *out_srv_srgb) final;
+
+		void enumerate_techniques(const char *effect_name, void(*callback)(api::effect_runtime *runtime, api::effect_technique technique, const char *name, void *user_data), void *user_data) final;
+		api::effect_technique find_technique(const char *effect_name, const char *technique_name) final;
+		bool get_technique_state(api::effect_technique technique) final;
+		void set_technique_state(api::effect_technique technique, bool enabled) final;
+		uint64_t get_technique_gpu_duration(api::effect_technique technique) final;
+
+		void update_sky_mask(uint32_t num_rects, const int32_t *rects) final;
+
+		void compile_shader(const char *source, size_t source_size, const char *entry_point, const char *profile, void(*callback)(api::effect_runtime *runtime, const void *code, size_t code_size, const char *errors, void *user_data), void *user_data) final;
+
 	protected:
 		runtime(api::device *device, api::command_queue *graphics_queue);
 		~runtime();
@@ -125,9 +201,60 @@ namespace reshade
 		/// Callback function called every frame.
 		/// </summary>
 		void on_present();
+		/// <summary>
+		/// Marks the next call to <see cref="on_present"/> as presenting another view of the frame that was just presented (e.g. the second eye in VR when eyes are submitted separately).
+		/// That call then only renders the effects again, with the techniques, uniform values and render graph of the first view, instead of advancing to a new frame.
+		/// </summary>
+		void present_next_view_of_frame() { _present_next_view = true; }
+
+		/// <summary>
+		/// Load serialized pipeline state data of the device from the disk cache.
+		/// </summary>
+		bool load_pipeline_cache(std::vector<char> &data) const;
+		/// <summary>
+		/// Save serialized pipeline state data of the device to the disk cache.
+		/// </summary>
+		bool save_pipeline_cache(const std::vector<char> &data) const;
+
+		/// <summary>
+		/// Makes all work submitted to <paramref name="queue"/> from now on wait on the GPU for all work submitted to <paramref name="other_queue"/> so far.
+		/// Only has to be implemented by backends that provide an async compute queue.
+		/// </summary>
+		virtual void synchronize_queues(api::command_queue *queue, api::command_queue *other_queue) { (void)queue; (void)other_queue; }
+
+		/// <summary>
+		/// Starts recording the commands of a technique into a separate command list, which can then be executed again in later frames for as long as nothing it depends on changed.
+		/// Only has to be implemented by backends where executing such a command list is cheaper than translating all passes of the technique again every frame.
+		/// </summary>
+		/// <returns>The command list to record the technique into, or <see langword="nullptr"/> if not supported.</returns>
+		virtual api::command_list *begin_technique_recording() { return nullptr; }
+		/// <summary>
+		/// Finishes recording the commands started with <see cref="begin_technique_recording"/>.
+		/// </summary>
+		/// <returns>An opaque handle to the recorded commands, or zero on failure.</returns>
+		virtual uint64_t finish_technique_recording() { return 0; }
+		/// <summary>
+		/// Executes commands previously recorded with <see cref="begin_technique_recording"/> on the graphics queue.
+		/// </summary>
+		virtual void execute_technique_recording(uint64_t recording) { (void)recording; }
+		/// <summary>
+		/// Frees commands previously recorded with <see cref="begin_technique_recording"/>.
+		/// </summary>
+		virtual void destroy_technique_recording(uint64_t recording) { (void)recording; }
+
+		/// <summary>
+		/// Checks whether the driver finished building a pipeline in the background, without waiting for it.
+		/// Only has to be implemented by backends where pipeline creation can return before the pipeline is ready.
+		/// </summary>
+		/// <param name="pipeline">The pipeline to check.</param>
+		/// <param name="success">Set to <see langword="false"/> if building the pipeline finished, but failed.</param>
+		/// <returns>Returns <see langword="false"/> while the pipeline is still being built, <see langword="true"/> otherwise.</returns>
+		virtual bool query_pipeline_status(api::pipeline pipeline, bool &success) { (void)pipeline; (void)success; return true; }
 
 		api::device *const _device;
 		api::command_queue *const _graphics_queue;
+		// Optional queue that compute-only techniques are executed on, so they can overlap with graphics work
+		api::command_queue *_async_compute_queue = nullptr;
 		unsigned int _width = 0;
 		unsigned int _height = 0;
 		unsigned int _vendor_id = 0;
@@ -137,6 +264,8 @@ namespace reshade
 		bool _is_vr = false;
 
 	private:
+		bool _present_next_view = false;
+
 		/// <summary>
 		/// Compare current version against the latest published one.
 		/// </summary>
@@ -156,7 +285,13 @@ namespace reshade
 		/// <summary>
 		/// Load the selected preset and apply it.
 		/// </summary>
-		void load_current_preset();
+		/// <param name="effect_indices">Optional list of effects to apply the preset to, in which case all others are left untouched (used to activate effects while the remaining ones are still loading).</param>
+		void load_current_preset(const std::vector<size_t> *effect_indices = nullptr);
+		/// <summary>
+		/// Interpolate floating-point variables towards the values of the selected preset while a transition between presets is in progress.
+		/// The values to interpolate between are collected once by <see cref="load_current_preset"/>, so this does not have to read the preset again every frame.
+		/// </summary>
+		void update_preset_transition();
 		/// <summary>
 		/// Save the current value configuration to the currently selected preset.
 		/// </summary>
@@ -170,6 +305,50 @@ namespace reshade
 		/// <returns><c>true</c> if there was another preset to switch to, <c>false</c> if not and therefore no changes were made.</returns>
 		bool switch_to_next_preset(std::filesystem::path filter_path, bool reversed = false);
 
+		/// <summary>
+		/// Creates the compute pipeline used to convert the back buffer to the screenshot formats on the GPU.
+		/// This is not supported on all render APIs, in which case screenshots of 8-bit and 10-bit back buffers are converted on the CPU instead.
+		/// </summary>
+		bool create_screenshot_convert_pipeline();
+		void destroy_screenshot_convert_pipeline();
+		/// <summary>
+		/// Destroys the back buffer copy, stencil buffer and empty texture, which all loaded effects reference.
+		/// </summary>
+		void destroy_shared_effect_resources();
+		/// <summary>
+		/// Creates a system memory resource that can hold a copy of the current frame image.
+		/// </summary>
+		/// <param name="hdr">Set to <c>true</c> to get 64bpp RGBA data with linear half-precision floating-point channels instead of 32bpp RGBA data.</param>
+		/// <param name="data_format">Set to the format of the data in the intermediate resource, which is the back buffer format if it has to be converted on the CPU.</param>
+		bool create_screenshot_intermediate(api::resource &intermediate, uint32_t &intermediate_pitch, api::format &data_format, bool hdr = false);
+		/// <summary>
+		/// Records a copy of the current frame image into a system memory resource created via <see cref="create_screenshot_intermediate"/> on the graphics queue, converting it on the GPU if necessary.
+		/// </summary>
+		void record_screenshot_copy(api::resource intermediate, api::format data_format);
+		/// <summary>
+		/// Reads the contents of a system memory resource created via <see cref="create_screenshot_intermediate"/> into the specified 32bpp RGBA (or 64bpp RGBA for HDR) buffer.
+		/// The GPU has to have finished the copy at this point.
+		/// </summary>
+		bool read_screenshot_intermediate(api::resource intermediate, uint32_t intermediate_pitch, api::format data_format, uint8_t *buffer);
+		/// <summary>
+		/// Records a copy of the current frame image into a new system memory resource on the graphics queue.
+		/// </summary>
+		bool begin_screenshot_readback(api::resource &intermediate, uint32_t &intermediate_pitch, api::format &data_format, bool hdr = false);
+		/// <summary>
+		/// Reads the contents of a system memory resource created via <see cref="begin_screenshot_readback"/> into the specified 32bpp RGBA buffer and destroys it afterwards.
+		/// The GPU has to have finished the copy at this point.
+		/// </summary>
+		bool finish_screenshot_readback(api::resource intermediate, uint32_t intermediate_pitch, api::format data_format, uint8_t *buffer);
+		/// <summary>
+		/// Reads back screenshots whose copy was recorded enough frames ago for the GPU to have finished it, and hands them off to a worker thread for encoding and writing to disk.
+		/// </summary>
+		/// <param name="wait">Set to <c>true</c> to wait for the GPU and process all pending screenshots, regardless of how long ago they were recorded.</param>
+		void process_pending_screenshots(bool wait);
+		/// <summary>
+		/// Reads back the oldest frame in the capture ring into the frame sink and records a copy of the current frame in its place.
+		/// </summary>
+		void capture_frame();
+
 		/// <summary>
 		/// Enable a technique so it is rendered.
 		/// </summary>
@@ -194,6 +373,42 @@ namespace reshade
 		/// <param name="effect_index">The ID of the effect.</param>
 		bool load_effect(const std::filesystem::path &source_file, const reshade::ini_file &preset, size_t effect_index, bool preprocess_required = false);
 		/// <summary>
+		/// Add the textures and techniques of an effect that finished loading to the lists shared by all effects, sharing textures with the same name.
+		/// This has to be called on the main thread, which is what allows loader threads to work without any synchronization.
+		/// </summary>
+		/// <param name="effect_index">The ID of the effect.</param>
+		bool merge_loaded_effect(size_t effect_index);
+		/// <summary>
+		/// Preprocess and parse an effect source file into the specified effect object, without adding its textures and techniques to the runtime yet.
+		/// This does not modify any other runtime state and may therefore be called from a worker thread for an effect object that is not in the effect list.
+		/// </summary>
+		/// <param name="effect">The effect object to fill. It is reset first unless it already contains the result for the same source file and definitions.</param>
+		/// <param name="preset_preprocessor_definitions">The preprocessor definitions of the preset to compile with.</param>
+		/// <param name="source_cached">Set to whether the preprocessed source code was found in the effect cache.</param>
+		/// <returns><see langword="false"/> if loading was skipped because the effect is not used by the preset, <see langword="true"/> otherwise.</returns>
+		bool build_effect(effect &effect, const std::filesystem::path &source_file, const reshade::ini_file &preset, const std::vector<std::string> &preset_preprocessor_definitions, size_t effect_index, bool preprocess_required, bool &source_cached);
+		/// <summary>
+		/// Build the specified effects again on the worker threads, while the current ones keep rendering.
+		/// </summary>
+		/// <param name="preset_preprocessor_definitions">The preprocessor definitions of the preset to switch to.</param>
+		/// <param name="effect_indices">The IDs of the effects to build.</param>
+		/// <param name="preprocess_required">Whether to ignore preprocessed source code in the effect cache.</param>
+		void build_effect_variants(std::vector<std::string> &&preset_preprocessor_definitions, const std::vector<size_t> &effect_indices, bool preprocess_required = false);
+		/// <summary>
+		/// Replace the effects whose code changed with those built in <see cref="build_effect_variants"/>, once all of them are finished.
+		/// </summary>
+		void update_effect_variants();
+		/// <summary>
+		/// Get the IDs of all effects that were not skipped during loading and have a technique that is enabled or in the specified list, and mark all others as outdated.
+		/// Outdated effects are built with the new preprocessor definitions once one of their techniques is enabled, instead of building every effect right away.
+		/// </summary>
+		/// <param name="technique_list">The techniques of the preset that is switched to.</param>
+		std::vector<size_t> select_effect_variants(const std::vector<std::string> &technique_list);
+		/// <summary>
+		/// Build all effects again that depend on files which were modified since the last call, as reported by the file watcher.
+		/// </summary>
+		void reload_modified_effects();
+		/// <summary>
 		/// Load all effects found in the effect search paths.
 		/// </summary>
 		void load_effects();
@@ -220,11 +435,57 @@ namespace reshade
 		/// </summary>
 		void reload_effects();
 
+		/// <summary>
+		/// Compile the shader modules for all entry points of the effect.
+		/// This does not modify the effect and may therefore be called from a worker thread.
+		/// </summary>
+		/// <param name="effect">The effect to compile.</param>
+		compiled_shaders compile_effect_shaders(const effect &effect);
+		/// <summary>
+		/// Checks whether effects are compiled to SPIR-V, which Vulkan always consumes and OpenGL only with 4.6 contexts (where 'GL_ARB_gl_spirv' is core) and unless disabled in the configuration.
+		/// </summary>
+		bool uses_spirv_codegen() const { return _renderer_id >= 0x20000 || (_renderer_id >= 0x14600 && _renderer_id < 0x20000 && _opengl_spirv); }
+		/// <summary>
+		/// Checks whether effects are compiled to DXIL with the DirectX Shader Compiler, which only D3D12 can consume and only happens when enabled in the configuration and the compiler library was loaded from the configured path.
+		/// </summary>
+		bool uses_dxil_codegen() const { return _renderer_id >= 0xc000 && _renderer_id < 0x10000 && _d3d12_dxil && _dxc_compiler != nullptr; }
+		/// <summary>
+		/// Loads the DirectX Shader Compiler from the configured path (instead of the library search path, so that a different library the application ships is never picked up).
+		/// </summary>
+		bool load_dxc_compiler();
+		/// <summary>
+		/// Compile HLSL source code to DXIL with the DirectX Shader Compiler.
+		/// </summary>
+		bool compile_dxil(const std::string &hlsl, const std::string &entry_point_define, const std::string &entry_point, const std::string &profile, unsigned int compile_flags, std::vector<char> &cso, std::string &assembly, std::string &errors) const;
 		/// <summary>
 		/// Initialize resources for the effect and load the effect module.
 		/// </summary>
 		/// <param name="effect_index">The ID of the effect.</param>
-		bool init_effect(size_t effect_index);
+		/// <param name="shaders">The shader modules previously compiled with <see cref="compile_effect_shaders"/>.</param>
+		bool init_effect(size_t effect_index, compiled_shaders &shaders);
+		/// <summary>
+		/// Destroy all objects created for the effect in <see cref="init_effect"/>, which returns it to the state it was in after loading.
+		/// The caller has to make sure that none of them are still in use by the GPU.
+		/// </summary>
+		/// <param name="effect_index">The ID of the effect.</param>
+		void uninit_effect(size_t effect_index);
+		/// <summary>
+		/// Free pipelines and private textures of effects that had no technique enabled for a configured number of frames.
+		/// These effects are initialized again as soon as one of their techniques is enabled (see <see cref="enable_technique"/>).
+		/// </summary>
+		void evict_unused_effects();
+		/// <summary>
+		/// Free the generated code and assembly of an effect after it was initialized, which are only needed again to initialize it another time or to show them in the code editor.
+		/// This only does something in low memory mode and when the effect cache can restore them.
+		/// </summary>
+		/// <param name="effect_index">The ID of the effect.</param>
+		void release_effect_code(size_t effect_index);
+		/// <summary>
+		/// Read the generated code and assembly of an effect that were freed by <see cref="release_effect_code"/> again from the effect cache.
+		/// </summary>
+		/// <param name="effect">The effect object to fill.</param>
+		/// <returns><see langword="true"/> if the code is available, <see langword="false"/> if it was no longer found in the effect cache.</returns>
+		bool restore_effect_code(effect &effect) const;
 		/// <summary>
 		/// Create a new texture with the specified dimensions.
 		/// </summary>
@@ -235,31 +496,135 @@ namespace reshade
 		/// </summary>
 		/// <param name="texture">The texture to destroy.</param>
 		void destroy_texture(texture &texture);
+		/// <summary>
+		/// Replace the shader resource views of a texture with ones that only cover the levels starting at <paramref name="first_level"/> and update all descriptor sets referencing them.
+		/// </summary>
+		/// <param name="texture">The texture to update.</param>
+		/// <param name="first_level">The most detailed level the new views should give access to.</param>
+		bool update_texture_views(texture &texture, uint32_t first_level);
+		/// <summary>
+		/// Upload the next levels of textures that are still being streamed in, within a fixed budget per frame.
+		/// </summary>
+		void update_texture_streams();
+		/// <summary>
+		/// Write new versions of texture descriptor sets of an effect whose bindings were changed and retire the old ones, since those may still be referenced by frames in flight.
+		/// </summary>
+		void replace_texture_sets(size_t effect_index, const std::vector<std::pair<api::descriptor_set, api::descriptor_set>> &replaced_sets, std::vector<api::descriptor_set_write> &descriptor_writes);
 
 		/// <summary>
 		/// Load compiled effect data from the disk cache.
 		/// </summary>
-		bool load_effect_cache(const std::filesystem::path &source_file, const size_t hash, std::string &source) const;
+		bool load_effect_cache(const std::filesystem::path &source_file, const size_t hash, std::string &source, std::vector<std::filesystem::path> &included_files) const;
 		bool load_effect_cache(const std::filesystem::path &source_file, const std::string &entry_point, const size_t hash, std::vector<char> &cso, std::string &dasm) const;
+		bool load_effect_cache(const std::filesystem::path &source_file, const size_t hash, effect &effect) const;
 		/// <summary>
 		/// Save compiled effect data to the disk cache.
 		/// </summary>
-		bool save_effect_cache(const std::filesystem::path &source_file, const size_t hash, const std::string &source) const;
+		bool save_effect_cache(const std::filesystem::path &source_file, const size_t hash, const std::string &source, const std::vector<std::filesystem::path> &included_files) const;
 		bool save_effect_cache(const std::filesystem::path &source_file, const std::string &entry_point, const size_t hash, const std::vector<char> &cso, const std::string &dasm) const;
+		bool save_effect_cache(const std::filesystem::path &source_file, const size_t hash, const effect &effect) const;
 		/// <summary>
 		/// Remove all compiled effect data from disk.
 		/// </summary>
 		void clear_effect_cache();
 
+		/// <summary>
+		/// Restore the parsed effect module from a previous build with the same source file and preprocessor definitions.
+		/// This may be called from a worker thread.
+		/// </summary>
+		/// <param name="effect">The effect object to fill.</param>
+		/// <returns><see langword="true"/> if a matching permutation was found, <see langword="false"/> otherwise.</returns>
+		bool load_effect_permutation(effect &effect);
+		/// <summary>
+		/// Keep a copy of the parsed effect module in memory, so that switching back to the same preprocessor definitions later does not have to parse it again.
+		/// This may be called from a worker thread.
+		/// </summary>
+		/// <param name="effect">The effect that was just parsed.</param>
+		void save_effect_permutation(const effect &effect);
+
 		/// <summary>
 		/// Apply post-processing effects to the frame.
 		/// </summary>
 		void update_and_render_effects();
 		/// <summary>
+		/// Apply post-processing effects to another view of the current frame, reusing everything <see cref="update_and_render_effects"/> set up for the first view.
+		/// </summary>
+		void render_effects_for_next_view();
+		/// <summary>
+		/// Build the render graph for the current frame from the list of enabled techniques.
+		/// This determines which passes need a copy of the back buffer and which subsequent passes can share a render pass.
+		/// </summary>
+		void update_render_graph();
+		/// <summary>
+		/// Rebuild the index of uniform variables by their "source" annotation and resolve all handles handed out to add-ons again after effects were loaded, unloaded or reordered.
+		/// </summary>
+		void update_effect_handles();
+		/// <summary>
+		/// Look up the object the specified handle currently refers to, or <see langword="nullptr"/> if it does not exist or effects are being loaded.
+		/// </summary>
+		uniform *resolve_handle(api::effect_uniform_variable handle);
+		texture *resolve_handle(api::effect_texture_variable handle);
+		technique *resolve_handle(api::effect_technique handle);
+
+		/// <summary>
+		/// Query the video memory budget of the device about once per second and notify add-ons when it changed or the usage went above or below it.
+		/// </summary>
+		void update_memory_budget();
+		/// <summary>
+		/// Wait until the GPU finished the previous frame before allowing the application to continue with the next one, so that at most a single frame is queued up.
+		/// </summary>
+		void limit_frame_latency();
+#if RESHADE_GUI
+		/// <summary>
+		/// Adjust the internal resolution of effects that are rendered at a scaled resolution to keep their GPU time within the configured budget.
+		/// </summary>
+		void update_effect_render_scale();
+		/// <summary>
+		/// Suspend techniques in the priority order of the current preset while the frame time exceeds the configured budget, and resume them once there is room again.
+		/// </summary>
+		void update_frame_time_budget();
+#endif
+		/// <summary>
+		/// Write modified uniform data of an effect to its constant buffer.
+		/// </summary>
+		void update_effect_constants(api::command_list *cmd_list, effect &effect);
+		/// <summary>
+		/// Upload the uniforms the shaders of a technique read to the D3D9 constant registers, skipping those that still hold the current values.
+		/// </summary>
+		void update_d3d9_effect_constants(api::command_list *cmd_list, effect &effect, const technique &tech);
+		/// <summary>
+		/// Mark the storage of a uniform variable as modified, so that it is uploaded during the next frame.
+		/// </summary>
+		void mark_uniform_value_dirty(const uniform &variable);
+		/// <summary>
+		/// Check on pipelines of techniques that are still being created in the background and enable rendering of those techniques once they are done.
+		/// </summary>
+		void update_pending_pipelines();
+		/// <summary>
+		/// Wait for pipelines of a technique that are still being created on worker threads and store them with its passes.
+		/// </summary>
+		/// <param name="technique">The technique to wait for.</param>
+		void finish_pipeline_creation(technique &technique);
+		/// <summary>
 		/// Render all passes in a technique.
 		/// </summary>
 		/// <param name="technique">The technique to render.</param>
 		void render_technique(technique &technique);
+		/// <summary>
+		/// Free the commands recorded for all techniques, so that they are recorded again the next time they are rendered.
+		/// This has to be called whenever anything the recorded commands reference changes (e.g. resources or descriptors).
+		/// </summary>
+		void destroy_technique_recordings();
+		void destroy_technique_recordings(technique &tech);
+		/// <summary>
+		/// Hand over the resources of a compute-only technique to the async compute queue, after all preceding graphics work.
+		/// </summary>
+		void begin_async_compute(const technique &technique);
+		/// <summary>
+		/// Make the graphics queue wait for pending async compute work and return all resources it used to the graphics queue.
+		/// </summary>
+		/// <param name="technique">The graphics technique that is about to be rendered, or <see langword="nullptr"/> to always wait. If it does not access any of the resources of the async compute work, this does nothing.</param>
+		void finish_async_compute(const technique *technique);
 
 		/// <summary>
 		/// Returns the texture object corresponding to the passed <paramref name="unique_name"/>.
@@ -276,9 +641,16 @@ namespace reshade
 		unsigned int _effects_key_data[4];
 		std::shared_ptr<class input> _input;
 		std::chrono::high_resolution_clock::duration _last_frame_duration;
+		moving_histogram<1024> _frame_time_histogram;
 		std::chrono::high_resolution_clock::time_point _start_time;
 		std::chrono::high_resolution_clock::time_point _last_present_time;
 		uint64_t _framecount = 0;
+		// Set by 'keep_effects_on_next_reset' and consumed by 'on_reset', which then records the back buffer description the kept effects were built for, so that 'on_init' can tell whether they still fit
+		bool _keep_effects_on_reset = false;
+		bool _effects_kept_on_reset = false;
+		uint32_t _kept_effects_width = 0;
+		uint32_t _kept_effects_height = 0;
+		api::format _kept_effects_backbuffer_format = api::format::unknown;
 		unsigned int _color_bit_depth = 8;
 
 		// === Configuration ===
@@ -294,27 +666,133 @@ namespace reshade
 		bool _no_reload_on_init = false;
 		bool _no_reload_for_non_vr = false;
 		bool _performance_mode = false;
+		bool _specialize_discrete_uniforms = false;
+		bool _pack_uniforms = false;
+		// Only takes effect with OpenGL 4.6 contexts, which are guaranteed to support SPIR-V shaders (see 'uses_spirv_codegen')
+		bool _opengl_spirv = true;
+		// Only takes effect with D3D12 and if "dxcompiler.dll" could be loaded from '_dxc_compiler_path' (see 'uses_dxil_codegen')
+		bool _d3d12_dxil = false;
 		bool _effect_load_skipping = false;
 		bool _load_option_disable_skipping = false;
 		std::atomic<int> _last_reload_successfull = true;
 		bool _last_texture_reload_successfull = true;
 		bool _textures_loaded = false;
+		// System memory copies of the image data uploaded to textures in D3D9, indexed by source file and texture dimensions, which are reused when effects are loaded again after a device reset (since all effect resources are lost then) instead of reading and decoding the same image files anew
+		struct texture_shadow_copy
+		{
+			std::filesystem::file_time_type modified_at;
+			std::vector<uint8_t> pixels;
+			std::vector<api::subresource_data> levels; // Data pointers are offsets into 'pixels'
+		};
+		std::unordered_map<std::string, texture_shadow_copy> _texture_shadow_copies;
+		// Image data of large block compressed textures whose most detailed levels are uploaded over the next frames (smallest first), while their views are clamped to the levels that are resident already
+		struct texture_stream
+		{
+			api::resource resource;
+			std::string texture_name;
+			std::vector<uint8_t> pixels;
+			std::vector<api::subresource_data> levels;
+			uint32_t resident_level;
+		};
+		std::vector<texture_stream> _texture_streams;
+		// Views replaced during streaming, which are only destroyed once the GPU finished executing all commands that may have referenced them
+		struct retired_texture_view
+		{
+			// Fence value on the graphics queue that was pending when the view was replaced
+			uint64_t fence_value;
+			api::resource resource;
+			api::resource_view view;
+		};
+		std::vector<retired_texture_view> _retired_texture_views;
 		unsigned int _reload_key_data[4];
 		unsigned int _performance_mode_key_data[4];
 		std::vector<size_t> _reload_compile_queue;
 		std::atomic<size_t> _reload_remaining_effects = 0;
+		// Effects that finished loading, but were not merged and activated by 'update_and_render_effects' yet (protected by '_reload_mutex')
+		std::vector<size_t> _reload_loaded_effects;
+		// Effects that can already render while the remaining ones are still loading, which is empty when no effects are loading (only accessed on the main thread)
+		std::vector<bool> _reload_active_effects;
+		// Effect and uniform indices of all variables with a "source" annotation, indexed by its value (entries are never erased, since their address is handed out as 'api::effect_uniform_source')
+		std::unordered_map<std::string, std::vector<std::pair<size_t, size_t>>> _uniform_sources;
+		// Current indices of the objects referenced by handles handed out to add-ons, indexed by "<name>@<effect file name>" (for the same reason as above, entries are never erased)
+		std::unordered_map<std::string, std::pair<size_t, size_t>> _uniform_handles;
+		std::unordered_map<std::string, size_t> _texture_handles;
+		std::unordered_map<std::string, size_t> _technique_handles;
+		std::atomic<bool> _effect_handles_outdated = true;
+		std::vector<effect> _effect_variants;
+		std::vector<std::string> _effect_variants_definitions;
+		std::atomic<size_t> _effect_variants_remaining = 0;
+		bool _effect_variants_outdated = false;
 		std::mutex _reload_mutex;
-		std::vector<std::thread> _worker_threads;
+		thread_pool _worker_pool;
+		bool _worker_low_priority = false;
+		unsigned int _worker_foreground_limit = 0; // Maximum number of worker threads loading effects at the same time while the application is in the foreground, zero disables this
+		bool _worker_avoid_render_thread_core = false;
+		bool _worker_prefer_efficiency_cores = false;
 		std::vector<std::string> _global_preprocessor_definitions;
 		std::vector<std::string> _preset_preprocessor_definitions;
 		std::vector<std::filesystem::path> _effect_search_paths;
 		std::vector<std::filesystem::path> _texture_search_paths;
 		std::filesystem::path _intermediate_cache_path;
+		std::filesystem::path _dxc_compiler_path = L"dxcompiler.dll";
+		unsigned int _effect_cache_size_limit = 256; // In megabytes
+		// Reference to the archive in the shared cache that this runtime is using, which is kept alive even if another runtime replaces it there with one at a different path
+		std::shared_ptr<cache_archive> _effect_cache;
+		std::shared_ptr<shared_effect_cache> _shared_effect_cache;
+		// Compiled shaders are additionally stored in an archive at this path that is shared by all applications on the machine (empty disables this)
+		std::filesystem::path _machine_cache_path;
+		unsigned int _machine_cache_size_limit = 1024; // In megabytes
+		std::shared_ptr<cache_archive> _machine_effect_cache;
+		unsigned int _effect_permutation_cache_size = 32; // Number of parsed effect permutations kept in memory, zero disables this
+		bool _low_memory_mode = false; // Frees generated code after effects were initialized and does not keep parsed effect permutations in memory
+		float _effect_render_scale = 1.0f;
+		float _effect_render_scale_min = 0.5f;
+		float _effect_render_scale_budget = 0.0f; // In milliseconds, zero disables dynamic adjustment of the render scale
+		float _current_effect_render_scale = 1.0f;
+		std::chrono::high_resolution_clock::time_point _last_render_scale_change;
+		float _frame_time_budget = 0.0f; // In milliseconds, zero disables suspending techniques to stay within it
+		std::chrono::high_resolution_clock::duration _frame_time_budget_sum = {};
+		uint32_t _frame_time_budget_frames = 0;
+		std::chrono::high_resolution_clock::time_point _last_frame_time_budget_change;
+		unsigned int _effect_eviction_frames = 0; // Number of frames after which an effect without enabled techniques is freed, zero disables eviction
+		// Last video memory budget reported by the device (see 'update_memory_budget'), while over it effects without enabled techniques are freed right away and the render scale is not increased
+		uint64_t _memory_budget = 0;
+		uint64_t _memory_usage = 0;
+		bool _over_memory_budget = false;
+		std::chrono::high_resolution_clock::time_point _last_memory_budget_check;
+		bool _limit_frame_latency = false;
+		// Timestamps written at the end of every frame, alternating between two slots, to tell when the GPU finished the previous frame (see 'limit_frame_latency')
+		api::query_pool _latency_query_pool = {};
+		uint64_t _latency_query_framecount = 0;
+		uint64_t _latency_query_timestamp = 0;
+		std::chrono::high_resolution_clock::duration _last_latency_wait_duration = {};
+		bool _reload_effects_on_file_change = false;
+		std::unique_ptr<file_watcher> _effect_watcher;
+		// Contents of the effect and texture search paths, which are resolved once at the start of every reload in 'load_effects'
+		std::unique_ptr<directory_index> _search_path_index;
+		std::vector<std::filesystem::path> _resolved_effect_search_paths;
+		std::vector<std::filesystem::path> _resolved_texture_search_paths;
+		std::vector<std::filesystem::path> _modified_effect_files;
+		std::chrono::high_resolution_clock::time_point _last_effect_file_change;
+		unsigned int _gpu_statistics_latency = 4; // Number of frames time stamp queries may be in flight before their results are read
+		std::vector<uint64_t> _timestamp_query_results;
+		// Effect whose uniforms are in the D3D9 constant registers and the ranges of registers that were uploaded per stage, along with the last '__TEXEL_SIZE__' value (see 'update_d3d9_effect_constants')
+		size_t _d3d9_constants_effect_index = std::numeric_limits<size_t>::max();
+		uint32_t _d3d9_vs_constant_registers[2] = {};
+		uint32_t _d3d9_ps_constant_registers[2] = {};
+		float _d3d9_texel_size[2] = {};
+		std::vector<api::resource> _async_compute_modified_resources;
+		std::vector<api::resource> _async_compute_sampled_resources;
+		bool _async_compute_pending = false;
 		std::chrono::high_resolution_clock::time_point _last_reload_time;
+		std::chrono::high_resolution_clock::time_point _last_reload_start_time;
 		void *_d3d_compiler = nullptr;
+		void *_dxc_compiler = nullptr;
 
 		std::vector<effect> _effects;
 		std::vector<texture> _textures;
+		// Index into the texture list by unique name, which is unique across all effects, since textures with the same name are shared
+		std::unordered_map<std::string, size_t> _texture_indices;
 		std::vector<technique> _techniques;
 
 		// === Effect Rendering ===
@@ -326,10 +804,16 @@ namespace reshade
 		api::format _effect_stencil_format = api::format::unknown;
 		api::resource _effect_stencil = {};
 		api::resource_view _effect_stencil_target = {};
+		std::vector<float> _hidden_area_vertices;
+		std::vector<int32_t> _hidden_area_rects;
+		std::vector<int32_t> _sky_rects;
+		std::vector<std::pair<api::resource, api::resource_view>> _pending_mipmaps;
 		api::resource _empty_texture = {};
 		api::resource_view _empty_texture_view = {};
 		std::unordered_map<size_t, api::sampler> _effect_sampler_states;
 		std::unordered_map<std::string, api::resource_view> _texture_semantic_bindings;
+		bool _alias_transient_textures = true;
+		std::vector<aliased_resource> _aliased_resources;
 
 		// === Screenshots ===
 
@@ -346,6 +830,94 @@ namespace reshade
 		std::filesystem::path _last_screenshot_file;
 		std::chrono::high_resolution_clock::time_point _last_screenshot_time;
 		unsigned int _screenshot_jpeg_quality = 90;
+		// Protects the save result and last screenshot file and time, which are updated by the worker thread that writes the screenshot to disk
+		std::mutex _screenshot_mutex;
+		std::atomic<unsigned int> _screenshots_in_progress = 0;
+
+		struct pending_screenshot
+		{
+			api::resource intermediate;
+			uint32_t intermediate_pitch;
+			api::format data_format;
+			// Fence value on the graphics queue that is reached once the copy into the intermediate resource finished
+			uint64_t fence_value;
+			std::filesystem::path path;
+			std::filesystem::path preset_path;
+			unsigned int format;
+			unsigned int jpeg_quality;
+			bool clear_alpha;
+		};
+		std::vector<pending_screenshot> _pending_screenshots;
+
+		// === Frame Capture ===
+
+		unsigned int _capture_key_data[4];
+		unsigned int _capture_frame_interval = 1;
+		unsigned int _capture_queue_size = 8;
+		std::string _capture_command;
+		std::unique_ptr<frame_sink> _capture_sink;
+
+		struct capture_slot
+		{
+			api::resource intermediate = {};
+			// Fence value on the graphics queue that is reached once the copy into the intermediate resource finished
+			uint64_t fence_value = 0;
+			bool pending = false;
+		};
+		// Ring of system memory resources allocated once when capturing starts, each one is read back when the ring wraps around to it again and its copy finished
+		std::vector<capture_slot> _capture_ring;
+		size_t _capture_ring_index = 0;
+		uint32_t _capture_intermediate_pitch = 0;
+		api::format _capture_data_format = api::format::unknown;
+
+		// Compute pipeline that converts the back buffer to 8-bit RGBA or to linear 16-bit floating-point RGBA, and a target texture for each of those
+		api::descriptor_set_layout _screenshot_convert_set_layouts[2] = {};
+		api::pipeline_layout _screenshot_convert_layout = {};
+		api::pipeline _screenshot_convert_pipeline = {};
+		api::resource _screenshot_convert_textures[2] = {};
+		api::resource_view _screenshot_convert_uavs[2] = {};
+
+		// === Telemetry ===
+
+		void publish_telemetry(std::chrono::high_resolution_clock::time_point present_started, std::chrono::nanoseconds effects_cpu_duration);
+
+		bool _export_telemetry = false;
+		std::unique_ptr<telemetry> _telemetry;
+		uint32_t _telemetry_reload_count = 0;
+		std::chrono::high_resolution_clock::time_point _telemetry_last_reload_time;
+
+		// === Benchmark ===
+
+		void update_benchmark();
+
+		// Number of frames to measure once all effects finished loading, before writing the results to '_benchmark_report_path' (zero disables the benchmark)
+		unsigned int _benchmark_frames = 0;
+		// Number of times all effects are reloaded with a cleared effect cache and then again with a warm one, before the frames are measured
+		unsigned int _benchmark_reloads = 0;
+		bool _benchmark_reload_started = false;
+		std::vector<benchmark_load_result> _benchmark_loads;
+		// Time spent in each phase of loading effects since the last reload, summed over all worker threads
+		std::atomic<uint64_t> _load_phase_durations_ns[static_cast<size_t>(benchmark_load_phase::count)] = {};
+		std::filesystem::path _benchmark_report_path;
+		bool _benchmark_finished = false;
+		uint64_t _benchmark_start_frame = 0;
+		uint64_t _benchmark_peak_memory_usage = 0;
+		// Sums of the last CPU and GPU duration measured for every technique in each frame of the run, indexed like '_techniques'
+		std::vector<std::pair<uint64_t, uint64_t>> _benchmark_duration_sums;
+#if RESHADE_PROFILING
+		std::vector<profiling::call_statistics> _benchmark_calls;
+#endif
+
+		// === Profiling ===
+
+		void collect_profiling_samples();
+
+		// Time spent in the outermost profiled scopes of the hook layer since the last present (zero unless built with 'RESHADE_PROFILING')
+		uint64_t _hook_cpu_duration_ns = 0;
+#if RESHADE_PROFILING
+		std::vector<profiling::sample> _profiling_samples;
+		std::vector<profiling::call_statistics> _profiling_calls;
+#endif
 
 		// === Preset Switching ===
 
@@ -356,6 +928,16 @@ namespace reshade
 		unsigned int _preset_transition_delay = 1000;
 		std::filesystem::path _current_preset_path;
 		std::chrono::high_resolution_clock::time_point _last_preset_switching_time;
+		struct preset_transition_value
+		{
+			size_t effect_index;
+			size_t uniform_index;
+			float start[16];
+			float target[16];
+		};
+		// Floating-point variables that differ between the previous and the selected preset, which are interpolated from the point in time they were collected at until the transition ends
+		std::vector<preset_transition_value> _preset_transition_values;
+		std::chrono::high_resolution_clock::time_point _preset_transition_values_time;
 
 #if RESHADE_GUI
 		// === ImGui ===
@@ -364,7 +946,8 @@ namespace reshade
 		void init_gui_vr();
 		void deinit_gui();
 		void deinit_gui_vr();
-		void build_font_atlas();
+		void build_font_atlas(); // Does not access the device, so may be called from a worker thread
+		bool init_font_atlas_texture();
 
 		void load_config_gui(const ini_file &config);
 		void save_config_gui(ini_file &config) const;
@@ -391,6 +974,11 @@ namespace reshade
 		api::resource _imgui_vertices[4] = {};
 		int _imgui_num_indices[4] = {};
 		int _imgui_num_vertices[4] = {};
+		// Persistently mapped pointers to the above (only in D3D12 and Vulkan, where buffers may stay mapped while the GPU reads from them)
+		void *_imgui_indices_data[4] = {};
+		void *_imgui_vertices_data[4] = {};
+		// Buffers replaced by larger ones, which may still be referenced by frames in flight, so are only destroyed together with the other ImGui resources
+		std::vector<api::resource> _imgui_retired_buffers;
 
 		api::resource _vr_overlay_texture = {};
 		api::render_pass _vr_overlay_pass = {};
@@ -401,6 +989,7 @@ namespace reshade
 		void draw_gui_home();
 		void draw_gui_settings();
 		void draw_gui_statistics();
+		void draw_gui_timeline();
 		void draw_gui_log();
 		void draw_gui_about();
 #if RESHADE_ADDON
@@ -421,6 +1010,13 @@ namespace reshade
 		bool _no_font_scaling = false;
 		bool _rebuild_font_atlas = true;
 		bool _gather_gpu_statistics = false;
+		// Set while GPU durations of techniques are needed for automatic adjustments, without gathering the pipeline statistics shown in the overlay (see 'update_effect_render_scale')
+		bool _gather_gpu_durations = false;
+		bool _gather_timeline = false;
+		bool _timeline_paused = false;
+		size_t _timeline_selected_frame = std::numeric_limits<size_t>::max();
+		frame_timeline _timeline;
+		frame_timeline::frame *_timeline_frame = nullptr;
 		unsigned int _reload_count = 0;
 		unsigned int _overlay_key_data[4];
 		int _fps_pos = 1;
@@ -436,6 +1032,7 @@ namespace reshade
 		bool _was_preprocessor_popup_edited = false;
 		size_t _focused_effect = std::numeric_limits<size_t>::max();
 		size_t _selected_technique = std::numeric_limits<size_t>::max();
+		std::vector<size_t> _technique_editor_items;
 		unsigned int _tutorial_index = 0;
 		unsigned int _effects_expanded_state = 2;
 		float _variable_editor_height = 300.0f;
@@ -12,7 +12,9 @@
 #include "addon_manager.hpp"
 #include "runtime.hpp"
 #include "runtime_objects.hpp"
+#include "resource_ledger.hpp"
 #include "input.hpp"
+#include "frame_sink.hpp"
 #include "imgui_widgets.hpp"
 #include "fonts/forkawesome.inl"
 #include <fstream>
@@ -28,6 +30,61 @@ static std::string s_window_state_path;
 static const ImVec4 COLOR_RED = ImColor(240, 100, 100);
 static const ImVec4 COLOR_YELLOW = ImColor(204, 204, 0);
 
+struct line_cost
+{
+	uint32_t instructions = 0;
+	uint32_t samples = 0;
+};
+
+// Attribute the instructions in a DXBC disassembly to lines in the specified source file, using the '#line' directives the compiler writes for shaders with debug information
+static void count_instructions_per_line(const std::string &assembly, const std::filesystem::path &file_path, std::unordered_map<size_t, line_cost> &costs)
+{
+	size_t current_line = 0;
+	bool current_file_matches = false;
+
+	for (size_t line_offset = 0; line_offset < assembly.size();)
+	{
+		size_t line_end = assembly.find('\n', line_offset);
+		if (line_end == std::string::npos)
+			line_end = assembly.size();
+
+		std::string_view line(assembly.data() + line_offset, line_end - line_offset);
+		line_offset = line_end + 1;
+
+		line.remove_prefix(std::min(line.find_first_not_of(" \t"), line.size()));
+		if (!line.empty() && line.back() == '\r')
+			line.remove_suffix(1);
+		if (line.empty() || line.compare(0, 2, "//") == 0)
+			continue;
+
+		if (line.compare(0, 6, "#line ") == 0)
+		{
+			current_line = std::strtoul(line.data() + 6, nullptr, 10);
+
+			// The file name is only written when it changes
+			if (const size_t path_beg = line.find('\"'), path_end = line.rfind('\"'); path_beg != std::string_view::npos && path_end > path_beg)
+			{
+				std::string path(line.substr(path_beg + 1, path_end - path_beg - 1));
+				for (size_t offset = 0; (offset = path.find("\\\\", offset)) != std::string::npos; ++offset)
+					path.erase(offset, 1); // Paths may be escaped
+
+				current_file_matches = std::filesystem::u8path(path) == file_path;
+			}
+			continue;
+		}
+
+		// Skip the version token, declarations and the final return, which do not reflect the cost of any particular line of code
+		if (current_line == 0 || !current_file_matches ||
+			line.compare(0, 3, "dcl") == 0 || line.compare(0, 4, "def ") == 0 || line.compare(0, 3, "vs_") == 0 || line.compare(0, 3, "ps_") == 0 || line.compare(0, 3, "cs_") == 0 || line == "ret")
+			continue;
+
+		line_cost &cost = costs[current_line];
+		cost.instructions++;
+		if (line.compare(0, 6, "sample") == 0 || line.compare(0, 6, "gather") == 0 || line.compare(0, 3, "ld ") == 0 || line.compare(0, 5, "ld_ms") == 0 || line.compare(0, 12, "ld_indexable") == 0 || line.compare(0, 5, "texld") == 0)
+			cost.samples++;
+	}
+}
+
 void reshade::runtime::init_gui()
 {
 	if (s_window_state_path.empty())
@@ -137,10 +194,12 @@ void reshade::runtime::build_font_atlas()
 
 	_show_splash = true;
 	_rebuild_font_atlas = false;
-
+}
+bool reshade::runtime::init_font_atlas_texture()
+{
 	int width, height;
 	unsigned char *pixels;
-	atlas->GetTexDataAsRGBA32(&pixels, &width, &height);
+	_imgui_context->IO.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
 
 	_device->destroy_resource(_font_atlas);
 	_font_atlas.handle = {};
@@ -150,20 +209,22 @@ void reshade::runtime::build_font_atlas()
 	const api::subresource_data initial_data = { pixels, static_cast<uint32_t>(width * 4), static_cast<uint32_t>(width * height * 4) };
 
 	// Create font atlas texture and upload it
+	const resource_ledger::overlay_scope ledger_scope;
 	if (!_device->create_resource(
 		api::resource_desc(width, height, 1, 1, api::format::r8g8b8a8_unorm, 1, api::memory_heap::gpu_only, api::resource_usage::shader_resource),
 		&initial_data, api::resource_usage::shader_resource, &_font_atlas))
 	{
 		LOG(ERROR) << "Failed to create front atlas resource!";
-		return;
+		return false;
 	}
 	if (!_device->create_resource_view(_font_atlas, api::resource_usage::shader_resource, api::resource_view_desc(api::format::r8g8b8a8_unorm), &_font_atlas_srv))
 	{
 		LOG(ERROR) << "Failed to create font atlas resource view!";
-		return;
+		return false;
 	}
 
 	_device->set_resource_name(_font_atlas, "ImGui Font Atlas");
+	return true;
 }
 
 void reshade::runtime::load_config_gui(const ini_file &config)
@@ -548,11 +609,22 @@ void reshade::runtime::draw_gui()
 {
 	assert(_is_initialized);
 
+	RESHADE_PROFILE_SCOPE("runtime::draw_gui");
+
 	bool show_splash = _show_splash && (is_loading() || !_reload_compile_queue.empty() || (_reload_count <= 1 && (_last_present_time - _last_reload_time) < std::chrono::seconds(5)));
+	// Screenshots are written to disk on a worker thread, which updates the result when done, so take a copy of it here
+	std::unique_lock<std::mutex> screenshot_lock(_screenshot_mutex);
+	const bool screenshot_save_success = _screenshot_save_success;
+	const bool screenshot_in_progress = _screenshots_in_progress != 0;
+	const std::chrono::high_resolution_clock::time_point last_screenshot_time = _last_screenshot_time;
+	screenshot_lock.unlock();
+
 	// Do not show this message in the same frame the screenshot is taken (so that it won't show up on the GUI screenshot)
-	const bool show_screenshot_message = (_show_screenshot_message || !_screenshot_save_success) && !_should_save_screenshot && (_last_present_time - _last_screenshot_time) < std::chrono::seconds(_screenshot_save_success ? 3 : 5);
+	const bool show_screenshot_message = (_show_screenshot_message || !screenshot_save_success) && !_should_save_screenshot && (screenshot_in_progress || (_last_present_time - last_screenshot_time) < std::chrono::seconds(screenshot_save_success ? 3 : 5));
+
+	const bool show_capture_message = _show_screenshot_message && _capture_sink != nullptr;
 
-	if (show_screenshot_message || !_preset_save_success || (!_show_overlay && _tutorial_index == 0))
+	if (show_screenshot_message || show_capture_message || !_preset_save_success || (!_show_overlay && _tutorial_index == 0))
 		show_splash = true;
 	const bool show_stats_window = _show_clock || _show_fps || _show_frametime;
 
@@ -563,6 +635,7 @@ void reshade::runtime::draw_gui()
 
 	_ignore_shortcuts = false;
 	_gather_gpu_statistics = false;
+	_gather_timeline = false;
 	_effects_expanded_state &= 2;
 
 	if (!show_splash && !show_stats_window && !_show_overlay && _preview_texture.handle == 0)
@@ -573,7 +646,10 @@ void reshade::runtime::draw_gui()
 	}
 
 	if (_rebuild_font_atlas)
+	{
 		build_font_atlas();
+		init_font_atlas_texture();
+	}
 	if (_font_atlas_srv.handle == 0)
 		return; // Cannot render GUI without font atlas
 
@@ -635,13 +711,23 @@ void reshade::runtime::draw_gui()
 		}
 		else if (show_screenshot_message)
 		{
-			if (!_screenshot_save_success)
+			screenshot_lock.lock();
+			const std::filesystem::path last_screenshot_file = _last_screenshot_file;
+			screenshot_lock.unlock();
+
+			if (screenshot_in_progress)
+				ImGui::TextUnformatted("Saving screenshot ...");
+			else if (!screenshot_save_success)
 				if (std::error_code ec; std::filesystem::exists(_screenshot_path, ec))
 					ImGui::TextColored(COLOR_RED, "Unable to save screenshot because of an internal error (the format may not be supported).");
 				else
 					ImGui::TextColored(COLOR_RED, "Unable to save screenshot because path doesn't exist: %s.", _screenshot_path.u8string().c_str());
 			else
-				ImGui::Text("Screenshot successfully saved to %s", _last_screenshot_file.u8string().c_str());
+				ImGui::Text("Screenshot successfully saved to %s", last_screenshot_file.u8string().c_str());
+		}
+		else if (show_capture_message)
+		{
+			ImGui::Text("Capturing frames (%llu written, %llu dropped) ...", _capture_sink->num_frames_written(), _capture_sink->num_frames_dropped());
 		}
 		else
 		{
@@ -1125,7 +1211,7 @@ void reshade::runtime::draw_gui_home()
 	{
 		std::string texture_list;
 		for (const texture &tex : _textures)
-			if (tex.resource.handle != 0 && !tex.loaded && !tex.annotation_as_string("source").empty())
+			if (tex.resource.handle != 0 && !tex.loaded && !tex.source.empty())
 				texture_list += ' ' + tex.unique_name + ',';
 
 		if (texture_list.empty())
@@ -1393,6 +1479,84 @@ void reshade::runtime::draw_gui_settings()
 			reload_effects();
 		}
 
+		if (ImGui::Checkbox("Specialize discrete variables", &_specialize_discrete_uniforms))
+		{
+			modified = true;
+			reload_effects();
+		}
+
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Compiles checkboxes, combo boxes and lists into the shaders like performance mode does, while keeping sliders editable.\nChanging one of these recompiles only the affected effect, which is cached for every combination of values.");
+
+		if (ImGui::Checkbox("Pack uniform variables", &_pack_uniforms))
+		{
+			modified = true;
+			reload_effects();
+		}
+
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Reorders the variables of each effect in its constant buffer to reduce padding, which makes it smaller to upload every frame.\nThis has no effect in Vulkan, where variables are always laid out in declaration order.");
+
+		if (_renderer_id >= 0x14600 && _renderer_id < 0x20000 && ImGui::Checkbox("Compile effects to SPIR-V", &_opengl_spirv))
+		{
+			modified = true;
+			reload_effects();
+		}
+
+		if (_renderer_id >= 0x14600 && _renderer_id < 0x20000 && ImGui::IsItemHovered())
+			ImGui::SetTooltip("Passes SPIR-V to the driver instead of GLSL, which skips its GLSL compiler and makes loading effects faster.\nDisable this if effects do not render correctly, since SPIR-V support differs between drivers.");
+
+		if (_renderer_id >= 0xc000 && _renderer_id < 0x10000 && ImGui::Checkbox("Compile effects to DXIL", &_d3d12_dxil))
+		{
+			modified = true;
+			reload_effects();
+		}
+
+		if (_renderer_id >= 0xc000 && _renderer_id < 0x10000 && ImGui::IsItemHovered())
+			ImGui::SetTooltip("Compiles effects to shader model 6 with the DirectX Shader Compiler, which enables native wave intrinsics.\nRequires \"dxcompiler.dll\" and \"dxil.dll\" next to ReShade (or at the path configured with \"DXCompilerPath\"). Some effects may not compile, since it is stricter than the default compiler.");
+
+		if (ImGui::Checkbox("Low memory mode", &_low_memory_mode))
+		{
+			modified = true;
+			reload_effects();
+		}
+
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Frees the generated code of effects after they were initialized and reads it back from the effect cache when it is needed again.\nThis has no effect while the effect cache is disabled.");
+
+		modified |= ImGui::Checkbox("Load effects at low priority", &_worker_low_priority);
+
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Runs the threads loading and compiling effects below normal priority, so that they do not cause stutter in the application.\nThis takes effect on the next reload.");
+
+		int worker_foreground_limit = static_cast<int>(_worker_foreground_limit);
+		if (ImGui::SliderInt("Foreground loading threads", &worker_foreground_limit, 0, static_cast<int>(_worker_pool.num_threads()), worker_foreground_limit == 0 ? "Unlimited" : "%d"))
+		{
+			modified = true;
+			_worker_foreground_limit = static_cast<unsigned int>(worker_foreground_limit);
+			if (_worker_foreground_limit == 0)
+				_worker_pool.set_max_active_threads(0);
+		}
+
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Maximum number of threads loading and compiling effects at the same time while the application is in the foreground.");
+
+		if (ImGui::Checkbox("Reload effects on file change", &_reload_effects_on_file_change))
+		{
+			modified = true;
+
+			// The file watcher is created when loading effects
+			reload_effects();
+		}
+
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Watches the effect search paths and recompiles only the effects that include a file after it was saved.");
+
+		modified |= ImGui::Checkbox("Limit frame latency", &_limit_frame_latency);
+
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Waits for the GPU to finish the previous frame before the application continues with the next one, so that at most one frame is queued up.\nThis reduces input latency at the cost of some frame rate when GPU bound. It has no effect in D3D12.");
+
 		if (ImGui::Button("Clear effect cache", ImVec2(ImGui::CalcItemWidth(), 0)))
 			clear_effect_cache();
 	}
@@ -1407,7 +1571,9 @@ void reshade::runtime::draw_gui_settings()
 		screenshot_naming_items += g_target_executable_path.stem().string() + " yyyy-MM-dd HH-mm-ss " + _current_preset_path.stem().string() + '\0';
 		modified |= ImGui::Combo("Screenshot name", reinterpret_cast<int *>(&_screenshot_naming), screenshot_naming_items.c_str());
 
-		modified |= ImGui::Combo("Screenshot format", reinterpret_cast<int *>(&_screenshot_format), "Bitmap (*.bmp)\0Portable Network Graphics (*.png)\0JPEG (*.jpeg)\0");
+		modified |= ImGui::Combo("Screenshot format", reinterpret_cast<int *>(&_screenshot_format), "Bitmap (*.bmp)\0Portable Network Graphics (*.png)\0JPEG (*.jpeg)\0OpenEXR (*.exr)\0");
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("OpenEXR images store linear 16-bit floating-point values, which preserves the full range of HDR back buffers.");
 
 		if (_screenshot_format == 2)
 			modified |= ImGui::SliderInt("JPEG quality", reinterpret_cast<int *>(&_screenshot_jpeg_quality), 1, 100);
@@ -1417,6 +1583,26 @@ void reshade::runtime::draw_gui_settings()
 		modified |= ImGui::Checkbox("Save current preset file", &_screenshot_include_preset);
 		modified |= ImGui::Checkbox("Save before and after images", &_screenshot_save_before);
 		modified |= ImGui::Checkbox("Save separate image with the overlay visible", &_screenshot_save_gui);
+
+		modified |= widgets::key_input_box("Frame capture key", _capture_key_data, *_input);
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Starts or stops streaming frames to a raw RGBA file in the screenshot path, or to the standard input of the frame capture command.");
+
+		if (ImGui::SliderInt("Frame capture interval", reinterpret_cast<int *>(&_capture_frame_interval), 1, 60))
+		{
+			modified = true;
+			_capture_frame_interval = std::max(_capture_frame_interval, 1u);
+		}
+
+		char capture_command[1024];
+		capture_command[_capture_command.copy(capture_command, sizeof(capture_command) - 1)] = '\0';
+		if (ImGui::InputText("Frame capture command", capture_command, sizeof(capture_command)))
+		{
+			modified = true;
+			_capture_command = capture_command;
+		}
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Command line of an encoder process to pipe raw RGBA frames to (e.g. ffmpeg -f rawvideo -pix_fmt rgba -s {width}x{height} -i - video.mp4).\nLeave empty to write a raw file instead.");
 	}
 
 	if (ImGui::CollapsingHeader("Overlay & Styling", ImGuiTreeNodeFlags_DefaultOpen))
@@ -1634,6 +1820,11 @@ void reshade::runtime::draw_gui_statistics()
 		ImGui::TextUnformatted("Time:");
 		ImGui::Text("Frame %llu:", _framecount + 1);
 		ImGui::TextUnformatted("Post-Processing:");
+		ImGui::TextUnformatted("Frame Time:");
+		if (_memory_budget != 0)
+			ImGui::TextUnformatted("Video Memory:");
+		if (_limit_frame_latency)
+			ImGui::TextUnformatted("Latency Wait:");
 
 		ImGui::EndGroup();
 		ImGui::SameLine(ImGui::GetWindowWidth() * 0.33333333f);
@@ -1648,6 +1839,16 @@ void reshade::runtime::draw_gui_statistics()
 		ImGui::Text("%.2f fps", _imgui_context->IO.Framerate);
 		ImGui::Text("%*.3f ms CPU", cpu_digits + 4, post_processing_time_cpu * 1e-6f);
 
+		static const float frame_time_percentiles[4] = { 50.0f, 95.0f, 99.0f, 100.0f };
+		uint64_t frame_time_values[4];
+		_frame_time_histogram.percentiles(frame_time_percentiles, frame_time_values);
+
+		ImGui::Text("p50 %.3f ms, p95 %.3f ms", frame_time_values[0] * 1e-6f, frame_time_values[1] * 1e-6f);
+		if (_memory_budget != 0)
+			ImGui::Text("%llu MiB used", _memory_usage / (1024 * 1024));
+		if (_limit_frame_latency)
+			ImGui::Text("%.3f ms", std::chrono::duration_cast<std::chrono::microseconds>(_last_latency_wait_duration).count() * 1e-3f);
+
 		ImGui::EndGroup();
 		ImGui::SameLine(ImGui::GetWindowWidth() * 0.66666666f);
 		ImGui::BeginGroup();
@@ -1661,6 +1862,11 @@ void reshade::runtime::draw_gui_statistics()
 		ImGui::Text("%*.3f ms", gpu_digits + 4, _last_frame_duration.count() * 1e-6f);
 		if (_gather_gpu_statistics && post_processing_time_gpu != 0)
 			ImGui::Text("%*.3f ms GPU", gpu_digits + 4, (post_processing_time_gpu * 1e-6f));
+		else
+			ImGui::NewLine();
+		ImGui::Text("p99 %.3f ms, max %.3f ms", frame_time_values[2] * 1e-6f, frame_time_values[3] * 1e-6f);
+		if (_memory_budget != 0)
+			ImGui::TextColored(_over_memory_budget ? COLOR_RED : ImGui::GetStyle().Colors[ImGuiCol_Text], "%llu MiB budget", _memory_budget / (1024 * 1024));
 
 		ImGui::EndGroup();
 	}
@@ -1680,6 +1886,18 @@ void reshade::runtime::draw_gui_statistics()
 				ImGui::Text("%s (%zu passes)", tech.name.c_str(), tech.passes.size());
 			else
 				ImGui::TextUnformatted(tech.name.c_str());
+
+			// Pipeline statistics are only available on some APIs
+			if (tech.average_primitives != 0 || tech.average_compute_invocations != 0)
+				ImGui::TextDisabled("  Invocations");
+
+			// List individual passes below the technique once their GPU timings are available
+			if (tech.passes.size() > 1 && tech.average_gpu_duration != 0)
+				for (size_t pass_index = 0; pass_index < tech.passes.size(); ++pass_index)
+					if (tech.passes[pass_index].name.empty())
+						ImGui::TextDisabled("  Pass %zu", pass_index);
+					else
+						ImGui::TextDisabled("  %s", tech.passes[pass_index].name.c_str());
 		}
 
 		ImGui::EndGroup();
@@ -1695,6 +1913,15 @@ void reshade::runtime::draw_gui_statistics()
 				ImGui::Text("%*.3f ms CPU", cpu_digits + 4, tech.average_cpu_duration * 1e-6f);
 			else
 				ImGui::NewLine();
+
+			// Show pixel shader invocations relative to the screen size too, which makes overdraw easy to spot
+			if (tech.average_primitives != 0 || tech.average_compute_invocations != 0)
+				ImGui::TextDisabled("%llu pixels (%.2fx screen)", static_cast<uint64_t>(tech.average_pixel_invocations), static_cast<double>(tech.average_pixel_invocations) / (static_cast<double>(_width) * _height));
+
+			// CPU timings are only measured per technique
+			if (tech.passes.size() > 1 && tech.average_gpu_duration != 0)
+				for (size_t pass_index = 0; pass_index < tech.passes.size(); ++pass_index)
+					ImGui::NewLine();
 		}
 
 		ImGui::EndGroup();
@@ -1708,14 +1935,115 @@ void reshade::runtime::draw_gui_statistics()
 
 			// GPU timings are not available for all APIs
 			if (_gather_gpu_statistics && tech.average_gpu_duration != 0)
+			{
 				ImGui::Text("%*.3f ms GPU", gpu_digits + 4, tech.average_gpu_duration * 1e-6f);
+
+				if (ImGui::IsItemHovered())
+				{
+					static const float gpu_duration_percentiles[4] = { 50.0f, 95.0f, 99.0f, 100.0f };
+					uint64_t gpu_duration_values[4];
+					tech.gpu_duration_histogram.percentiles(gpu_duration_percentiles, gpu_duration_values);
+
+					ImGui::SetTooltip("p50 %.3f ms\np95 %.3f ms\np99 %.3f ms\nmax %.3f ms", gpu_duration_values[0] * 1e-6f, gpu_duration_values[1] * 1e-6f, gpu_duration_values[2] * 1e-6f, gpu_duration_values[3] * 1e-6f);
+				}
+			}
 			else
 				ImGui::NewLine();
+
+			if (tech.average_primitives != 0 || tech.average_compute_invocations != 0)
+				ImGui::TextDisabled("%llu compute, %llu primitives", static_cast<uint64_t>(tech.average_compute_invocations), static_cast<uint64_t>(tech.average_primitives));
+
+			if (tech.passes.size() > 1 && tech.average_gpu_duration != 0)
+				for (const technique::pass_data &pass_data : tech.passes_data)
+					ImGui::TextDisabled("%*.3f ms GPU", gpu_digits + 4, pass_data.average_gpu_duration * 1e-6f);
 		}
 
 		ImGui::EndGroup();
 	}
 
+	if (ImGui::CollapsingHeader("Timeline") && !is_loading() && _effects_enabled)
+	{
+		draw_gui_timeline();
+	}
+
+#if RESHADE_PROFILING
+	if (ImGui::CollapsingHeader("Hooks") && !_profiling_calls.empty())
+	{
+		// List the hooks that took the most time in the last frame first
+		std::vector<profiling::call_statistics> calls = _profiling_calls;
+		std::sort(calls.begin(), calls.end(), [](const profiling::call_statistics &lhs, const profiling::call_statistics &rhs) { return lhs.duration_ns > rhs.duration_ns; });
+
+		ImGui::BeginGroup();
+		for (const profiling::call_statistics &call : calls)
+			ImGui::TextUnformatted(call.name);
+		ImGui::EndGroup();
+		ImGui::SameLine(ImGui::GetWindowWidth() * 0.33333333f);
+		ImGui::BeginGroup();
+		for (const profiling::call_statistics &call : calls)
+			ImGui::Text("%llu calls", call.count);
+		ImGui::EndGroup();
+		ImGui::SameLine(ImGui::GetWindowWidth() * 0.66666666f);
+		ImGui::BeginGroup();
+		for (const profiling::call_statistics &call : calls)
+			ImGui::Text("%.0f ns per call, %.3f ms total", static_cast<double>(call.duration_ns) / call.count, call.duration_ns * 1e-6);
+		ImGui::EndGroup();
+	}
+#endif
+
+	if (ImGui::CollapsingHeader("Resource Memory"))
+	{
+		std::vector<resource_ledger::owner_usage> usage;
+		resource_ledger::get_usage(_device, usage);
+
+		uint64_t total_bytes = 0;
+		for (const resource_ledger::owner_usage &owner : usage)
+			for (const uint64_t bytes : owner.bytes)
+				total_bytes += bytes;
+
+		const auto get_owner_name = [](const resource_ledger::owner_usage &owner) -> const char * {
+			switch (owner.owner)
+			{
+			case api::resource_memory_owner::effect_runtime:
+				return "Effect runtime";
+			case api::resource_memory_owner::overlay:
+				return "Overlay";
+			}
+#if RESHADE_ADDON
+			const auto info_it = std::find_if(addon::loaded_info.begin(), addon::loaded_info.end(),
+				[&owner](const addon::info &info) { return info.handle == owner.module; });
+			if (info_it != addon::loaded_info.end())
+				return info_it->name.c_str();
+#endif
+			return "Unknown add-on";
+		};
+
+		ImGui::BeginGroup();
+		for (const resource_ledger::owner_usage &owner : usage)
+			ImGui::TextUnformatted(get_owner_name(owner));
+		ImGui::TextUnformatted("Total:");
+		// Everything else the process uses was allocated by the application
+		if (_memory_budget != 0)
+			ImGui::TextUnformatted("Application:");
+		ImGui::EndGroup();
+		ImGui::SameLine(ImGui::GetWindowWidth() * 0.33333333f);
+		ImGui::BeginGroup();
+		for (const resource_ledger::owner_usage &owner : usage)
+			ImGui::Text("%.1f MiB textures, %.1f MiB render targets",
+				owner.bytes[static_cast<size_t>(api::resource_memory_category::texture)] / (1024.0 * 1024.0),
+				owner.bytes[static_cast<size_t>(api::resource_memory_category::render_target)] / (1024.0 * 1024.0));
+		ImGui::Text("%.1f MiB", total_bytes / (1024.0 * 1024.0));
+		if (_memory_budget != 0)
+			ImGui::Text("%.1f MiB", (_memory_usage > total_bytes ? _memory_usage - total_bytes : 0) / (1024.0 * 1024.0));
+		ImGui::EndGroup();
+		ImGui::SameLine(ImGui::GetWindowWidth() * 0.66666666f);
+		ImGui::BeginGroup();
+		for (const resource_ledger::owner_usage &owner : usage)
+			ImGui::Text("%.1f MiB buffers, %.1f MiB staging",
+				owner.bytes[static_cast<size_t>(api::resource_memory_category::buffer)] / (1024.0 * 1024.0),
+				owner.bytes[static_cast<size_t>(api::resource_memory_category::staging)] / (1024.0 * 1024.0));
+		ImGui::EndGroup();
+	}
+
 	if (ImGui::CollapsingHeader("Render Targets & Textures", ImGuiTreeNodeFlags_DefaultOpen) && !is_loading())
 	{
 		static const char *texture_formats[] = {
@@ -1738,6 +2066,8 @@ void reshade::runtime::draw_gui_statistics()
 		lldiv_t memory_view;
 		int64_t post_processing_memory_size = 0;
 		const char *memory_size_unit;
+		// Aliased textures share the same resource, so only count the memory of that once
+		std::vector<api::resource> counted_resources;
 
 		for (const texture &tex : _textures)
 		{
@@ -1751,7 +2081,11 @@ void reshade::runtime::draw_gui_statistics()
 			for (uint32_t level = 0, width = tex.width, height = tex.height; level < tex.levels; ++level, width /= 2, height /= 2)
 				memory_size += width * height * pixel_sizes[static_cast<int>(tex.format)];
 
-			post_processing_memory_size += memory_size;
+			if (std::find(counted_resources.begin(), counted_resources.end(), tex.resource) == counted_resources.end())
+			{
+				counted_resources.push_back(tex.resource);
+				post_processing_memory_size += memory_size;
+			}
 
 			if (memory_size >= 1024 * 1024) {
 				memory_view = std::lldiv(memory_size, 1024 * 1024);
@@ -1763,7 +2097,7 @@ void reshade::runtime::draw_gui_statistics()
 				memory_size_unit = "KiB";
 			}
 
-			ImGui::TextColored(ImVec4(1, 1, 1, 1), "%s%s", tex.unique_name.c_str(), tex.shared.size() > 1 ? " (Pooled)" : "");
+			ImGui::TextColored(ImVec4(1, 1, 1, 1), "%s%s", tex.unique_name.c_str(), tex.shared.size() > 1 ? " (Pooled)" : !tex.transient_techniques.empty() ? " (Transient)" : "");
 			ImGui::Text("%ux%u | %u mipmap(s) | %s | %lld.%03lld %s",
 				tex.width,
 				tex.height,
@@ -1921,6 +2255,171 @@ void reshade::runtime::draw_gui_statistics()
 		ImGui::Text("Total memory usage: %lld.%03lld %s", memory_view.quot, memory_view.rem, memory_size_unit);
 	}
 }
+void reshade::runtime::draw_gui_timeline()
+{
+	_gather_timeline = true;
+	_gather_gpu_statistics = true;
+
+	ImGui::Checkbox("Pause", &_timeline_paused);
+	ImGui::SameLine();
+	if (ImGui::Button("Export as Chrome trace") && _timeline.size() != 0)
+	{
+		const std::filesystem::path path = g_reshade_base_path / (g_target_executable_path.stem().u8string() + "_timeline.json");
+		if (_timeline.export_chrome_trace(path))
+			LOG(INFO) << "Saved timeline to " << path << '.';
+	}
+
+	if (_timeline.size() == 0)
+		return;
+
+	const auto frame_duration = [](const frame_timeline::frame &frame) {
+		if (uint64_t gpu_beg, gpu_end; frame.gpu_range(gpu_beg, gpu_end))
+			return std::max(gpu_end - gpu_beg, frame.cpu_end - frame.cpu_beg);
+		return frame.cpu_end - frame.cpu_beg;
+	};
+
+	// Default to the newest frame for which all GPU times were read back already
+	size_t selected_index = std::numeric_limits<size_t>::max();
+	for (size_t i = _timeline.size(); i-- > 0 && selected_index == std::numeric_limits<size_t>::max();)
+	{
+		const frame_timeline::frame &frame = _timeline[i];
+
+		if (frame.frame_index == _timeline_selected_frame)
+			selected_index = i;
+	}
+	if (selected_index == std::numeric_limits<size_t>::max())
+	{
+		for (selected_index = _timeline.size() - 1; selected_index > 0; --selected_index)
+			if (const auto &events = _timeline[selected_index].events;
+				std::all_of(events.begin(), events.end(), [](const frame_timeline::event &e) { return e.gpu_end != 0 || e.type == frame_timeline::event::hook; }))
+				break;
+	}
+
+	ImDrawList *const draw_list = ImGui::GetWindowDrawList();
+
+	// Bar chart of the duration of all frames in the timeline, which can be clicked to select the frame shown below
+	{
+		uint64_t max_duration = 1;
+		for (size_t i = 0; i < _timeline.size(); ++i)
+			max_duration = std::max(max_duration, frame_duration(_timeline[i]));
+
+		const ImVec2 chart_pos = ImGui::GetCursorScreenPos();
+		const ImVec2 chart_size = ImVec2(ImGui::GetContentRegionAvail().x, 50.0f);
+		const float bar_width = chart_size.x / frame_timeline::max_frames;
+
+		ImGui::InvisibleButton("##frames", chart_size);
+
+		size_t hovered_index = std::numeric_limits<size_t>::max();
+		if (ImGui::IsItemHovered())
+		{
+			hovered_index = static_cast<size_t>((ImGui::GetIO().MousePos.x - chart_pos.x) / bar_width);
+
+			if (hovered_index < _timeline.size())
+			{
+				ImGui::SetTooltip("Frame %llu: %.3f ms", _timeline[hovered_index].frame_index, frame_duration(_timeline[hovered_index]) * 1e-6f);
+
+				if (ImGui::IsItemClicked())
+					_timeline_selected_frame = _timeline[hovered_index].frame_index;
+			}
+		}
+
+		draw_list->AddRectFilled(chart_pos, chart_pos + chart_size, ImGui::GetColorU32(ImGuiCol_FrameBg));
+
+		for (size_t i = 0; i < _timeline.size(); ++i)
+		{
+			const float bar_height = chart_size.y * frame_duration(_timeline[i]) / max_duration;
+			const ImVec2 bar_min = ImVec2(chart_pos.x + i * bar_width, chart_pos.y + chart_size.y - bar_height);
+			const ImVec2 bar_max = ImVec2(chart_pos.x + (i + 1) * bar_width - 1.0f, chart_pos.y + chart_size.y);
+
+			draw_list->AddRectFilled(bar_min, bar_max, ImGui::GetColorU32(i == selected_index || i == hovered_index ? ImGuiCol_PlotHistogramHovered : ImGuiCol_PlotHistogram));
+		}
+	}
+
+	const frame_timeline::frame &frame = _timeline[selected_index];
+
+	uint64_t gpu_beg = 0, gpu_end = 0;
+	const bool has_gpu_times = frame.gpu_range(gpu_beg, gpu_end);
+
+	ImGui::Text("Frame %llu: %.3f ms CPU", frame.frame_index, (frame.cpu_end - frame.cpu_beg) * 1e-6f);
+	if (has_gpu_times)
+	{
+		ImGui::SameLine();
+		ImGui::Text(", %.3f ms GPU", (gpu_end - gpu_beg) * 1e-6f);
+	}
+
+	// Scopes of the hook layer are only recorded when built with 'RESHADE_PROFILING', with one row per nesting level
+	uint32_t num_hook_rows = 0;
+	for (const frame_timeline::event &e : frame.events)
+		if (e.type == frame_timeline::event::hook)
+			num_hook_rows = std::max(num_hook_rows, std::min(e.pass_index + 1, 4u));
+
+	// Draw CPU and GPU track with two rows each (techniques on top and their passes below) and the hook track below, using the same time scale for all
+	const float row_height = ImGui::GetTextLineHeightWithSpacing();
+	const float label_width = ImGui::CalcTextSize("Hooks ").x;
+	const float track_height = row_height * 2 + _imgui_context->Style.ItemSpacing.y;
+	const ImVec2 tracks_pos = ImGui::GetCursorScreenPos();
+	const ImVec2 tracks_size = ImVec2(ImGui::GetContentRegionAvail().x, track_height * 2 + row_height * num_hook_rows);
+	const float time_scale = (tracks_size.x - label_width) / std::max<uint64_t>(1, std::max(frame.cpu_end - frame.cpu_beg, gpu_end - gpu_beg));
+
+	ImGui::InvisibleButton("##tracks", tracks_size);
+	const bool tracks_hovered = ImGui::IsItemHovered();
+
+	draw_list->AddText(tracks_pos, ImGui::GetColorU32(ImGuiCol_Text), "CPU");
+	draw_list->AddText(ImVec2(tracks_pos.x, tracks_pos.y + track_height), ImGui::GetColorU32(ImGuiCol_Text), "GPU");
+	if (num_hook_rows != 0)
+		draw_list->AddText(ImVec2(tracks_pos.x, tracks_pos.y + track_height * 2), ImGui::GetColorU32(ImGuiCol_Text), "Hooks");
+
+	const frame_timeline::event *hovered_event = nullptr;
+
+	for (int track = 0; track < 3; ++track)
+	{
+		if (track == 1 && !has_gpu_times)
+			continue;
+
+		const float track_y = tracks_pos.y + track * track_height;
+
+		for (const frame_timeline::event &e : frame.events)
+		{
+			if ((track == 1 && e.gpu_end == 0) || (track == 2) != (e.type == frame_timeline::event::hook) || (track == 2 && e.pass_index >= num_hook_rows))
+				continue;
+
+			const uint64_t beg = track != 1 ? e.cpu_beg - frame.cpu_beg : e.gpu_beg - gpu_beg;
+			const uint64_t end = track != 1 ? e.cpu_end - frame.cpu_beg : e.gpu_end - gpu_beg;
+
+			const float row_y = track_y + (e.type == frame_timeline::event::hook ? e.pass_index * row_height : e.type == frame_timeline::event::technique ? 0.0f : row_height);
+			const ImVec2 rect_min = ImVec2(tracks_pos.x + label_width + beg * time_scale, row_y);
+			const ImVec2 rect_max = ImVec2(std::max(rect_min.x + 1.0f, tracks_pos.x + label_width + end * time_scale), row_y + row_height - 1.0f);
+
+			ImU32 col = ImGui::GetColorU32(ImGuiCol_Button);
+			if (e.type == frame_timeline::event::pass)
+				col = ImGui::GetColorU32(ImGuiCol_FrameBgActive);
+			else if (e.type == frame_timeline::event::copy)
+				col = ImGui::GetColorU32(COLOR_YELLOW);
+			else if (e.type == frame_timeline::event::hook)
+				col = ImGui::GetColorU32(ImGuiCol_PlotLines);
+
+			draw_list->AddRectFilled(rect_min, rect_max, col);
+
+			const ImVec4 clip_rect(rect_min.x, rect_min.y, rect_max.x, rect_max.y);
+			draw_list->AddText(nullptr, 0.0f, ImVec2(rect_min.x + 2.0f, rect_min.y), ImGui::GetColorU32(e.type == frame_timeline::event::copy ? ImGuiCol_WindowBg : ImGuiCol_Text), e.name.c_str(), e.name.c_str() + e.name.size(), 0.0f, &clip_rect);
+
+			if (tracks_hovered && ImGui::IsMouseHoveringRect(rect_min, rect_max))
+				hovered_event = &e;
+		}
+	}
+
+	if (hovered_event != nullptr)
+	{
+		ImGui::BeginTooltip();
+		ImGui::TextUnformatted(hovered_event->name.c_str());
+		if (hovered_event->type == frame_timeline::event::hook)
+			ImGui::Text("Thread %u", hovered_event->thread_id);
+		ImGui::Text("%.3f ms CPU", (hovered_event->cpu_end - hovered_event->cpu_beg) * 1e-6f);
+		if (hovered_event->gpu_end != 0)
+			ImGui::Text("%.3f ms GPU", (hovered_event->gpu_end - hovered_event->gpu_beg) * 1e-6f);
+		ImGui::EndTooltip();
+	}
+}
 void reshade::runtime::draw_gui_log()
 {
 	const std::filesystem::path log_path =
@@ -2086,6 +2585,39 @@ void reshade::runtime::draw_gui_addons()
 
 	ImGui::Spacing();
 
+	bool profile_callbacks = addon::profile_callbacks.load(std::memory_order_relaxed);
+	if (ImGui::Checkbox("Measure time spent in event callbacks", &profile_callbacks))
+	{
+		if (profile_callbacks)
+			addon::reset_callback_profile();
+		addon::profile_callbacks.store(profile_callbacks, std::memory_order_relaxed);
+	}
+
+	std::vector<addon::callback_profile> profile;
+	double profile_seconds = 0.0;
+	if (profile_callbacks)
+	{
+		profile_seconds = std::max(addon::get_callback_profile(profile), 0.001);
+
+		ImGui::SameLine();
+		if (ImGui::Button("Reset"))
+			addon::reset_callback_profile();
+		ImGui::SameLine();
+		if (ImGui::Button("Write to log"))
+		{
+			LOG(INFO) << "Add-on event callback profile over the last " << profile_seconds << " seconds:";
+			for (const addon::callback_profile &entry : profile)
+			{
+				const auto info_it = std::find_if(addon::loaded_info.begin(), addon::loaded_info.end(),
+					[&entry](const addon::info &info) { return info.handle == entry.handle; });
+				LOG(INFO) << "  " << (info_it != addon::loaded_info.end() ? info_it->name : "Unknown") << ' ' << addon::addon_event_to_string(entry.ev) << ": "
+					<< entry.num_calls << " calls, " << (entry.seconds * 1000.0) << " ms";
+			}
+		}
+	}
+
+	ImGui::Spacing();
+
 	for (size_t i = 0; i < addon::loaded_info.size(); ++i)
 	{
 		const addon::info &info = addon::loaded_info[i];
@@ -2114,9 +2646,27 @@ void reshade::runtime::draw_gui_addons()
 		ImGui::SameLine();
 		ImGui::TextUnformatted(info.name.c_str());
 
+		if (profile_callbacks)
+		{
+			double seconds = 0.0;
+			for (const addon::callback_profile &entry : profile)
+				if (entry.handle == info.handle)
+					seconds += entry.seconds;
+
+			ImGui::SameLine();
+			ImGui::TextDisabled("%.3f ms/s", seconds * 1000.0 / profile_seconds);
+		}
+
 		if (open && !info.description.empty())
 			ImGui::TextUnformatted(info.description.c_str());
 
+		if (open && profile_callbacks)
+		{
+			for (const addon::callback_profile &entry : profile)
+				if (entry.handle == info.handle)
+					ImGui::Text("%s: %.3f ms/s (%.0f calls/s)", addon::addon_event_to_string(entry.ev), entry.seconds * 1000.0 / profile_seconds, entry.num_calls / profile_seconds);
+		}
+
 		ImGui::GetCurrentWindow()->Size.x += spacing.x;
 		ImGui::GetCurrentWindow()->WorkRect.Max.x += spacing.x;
 		ImGui::GetCurrentWindow()->InnerRect.Max.x += spacing.x;
@@ -2303,6 +2853,7 @@ void reshade::runtime::draw_variable_editor()
 		assert(effect.compiled);
 
 		bool force_reload_effect = false;
+		bool specialized_variable_modified = false;
 		const bool is_focused = _focused_effect == effect_index;
 		const std::string effect_name = effect.source_file.filename().u8string();
 
@@ -2342,7 +2893,10 @@ void reshade::runtime::draw_variable_editor()
 			{
 				// Reset all uniform variables
 				for (uniform &variable_it : effect.uniforms)
+				{
 					reset_uniform_value(variable_it);
+					specialized_variable_modified |= variable_it.specialized;
+				}
 
 				// Reset all preprocessor definitions
 				for (const std::pair<std::string, std::string> &definition : effect.definitions)
@@ -2374,7 +2928,7 @@ void reshade::runtime::draw_variable_editor()
 			reshade::uniform &variable = effect.uniforms[variable_index];
 
 			// Skip hidden and special variables
-			if (variable.annotation_as_int("hidden") || variable.special != special_uniform::none)
+			if (variable.hidden || variable.special != special_uniform::none)
 			{
 				if (variable.special == special_uniform::overlay_active)
 					active_variable_index = variable_index;
@@ -2383,33 +2937,32 @@ void reshade::runtime::draw_variable_editor()
 				continue;
 			}
 
-			if (const std::string_view category = variable.annotation_as_string("ui_category");
+			if (const std::string &category = variable.ui_category;
 				category != current_category)
 			{
 				current_category = category;
 
 				if (!category.empty())
 				{
-					std::string category_label(category.data(), category.size());
+					std::string category_label = category;
 					if (!_variable_editor_tabs)
-						for (float x = 0, space_x = ImGui::CalcTextSize(" ").x, width = (ImGui::CalcItemWidth() - ImGui::CalcTextSize(category_label.data()).x - 45) / 2; x < width; x += space_x)
+						for (float x = 0, space_x = ImGui::CalcTextSize(" ").x, width = (ImGui::CalcItemWidth() - ImGui::CalcTextSize(category_label.c_str()).x - 45) / 2; x < width; x += space_x)
 							category_label.insert(0, " ");
 
 					ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_NoTreePushOnOpen;
-					if (!variable.annotation_as_int("ui_category_closed"))
+					if (!variable.ui_category_closed)
 						flags |= ImGuiTreeNodeFlags_DefaultOpen;
 
 					category_closed = !ImGui::TreeNodeEx(category_label.c_str(), flags);
 
 					if (ImGui::BeginPopupContextItem(category_label.c_str()))
 					{
-						std::string reset_button_label(category.data(), category.size());
-						reset_button_label = ICON_FK_UNDO " Reset all in '" + reset_button_label + "' to default";
+						const std::string reset_button_label = ICON_FK_UNDO " Reset all in '" + category + "' to default";
 
 						if (ImGui::Button(reset_button_label.c_str(), ImVec2(ImGui::GetContentRegionAvail().x, 0)))
 						{
 							for (uniform &variable_it : effect.uniforms)
-								if (variable_it.annotation_as_string("ui_category") == category)
+								if (variable_it.ui_category == category)
 									reset_uniform_value(variable_it);
 
 							save_current_preset();
@@ -2430,24 +2983,31 @@ void reshade::runtime::draw_variable_editor()
 			if (category_closed)
 				continue;
 
+			// Skip variables that are scrolled out of view, but still advance the cursor by the height they had when last drawn, so that the scroll range stays the same
+			if (variable.ui_height > 0.0f && !ImGui::IsRectVisible(ImVec2(ImGui::GetContentRegionAvail().x, variable.ui_height)))
+			{
+				ImGui::Dummy(ImVec2(0.0f, variable.ui_height - _imgui_context->Style.ItemSpacing.y));
+				id++;
+				continue;
+			}
+
+			const float cursor_start_y = ImGui::GetCursorPosY();
+
 			// Add spacing before variable widget
-			for (int i = 0, spacing = variable.annotation_as_int("ui_spacing"); i < spacing; ++i)
+			for (int i = 0; i < variable.ui_spacing; ++i)
 				ImGui::Spacing();
 
 			// Add user-configurable text before variable widget
-			if (const std::string_view text = variable.annotation_as_string("ui_text");
-				!text.empty())
+			if (!variable.ui_text.empty())
 			{
 				ImGui::PushTextWrapPos();
-				ImGui::TextUnformatted(text.data());
+				ImGui::TextUnformatted(variable.ui_text.c_str(), variable.ui_text.c_str() + variable.ui_text.size());
 				ImGui::PopTextWrapPos();
 			}
 
 			bool modified = false;
-			std::string_view label = variable.annotation_as_string("ui_label");
-			if (label.empty())
-				label = variable.name;
-			const std::string_view ui_type = variable.annotation_as_string("ui_type");
+			const std::string &label = variable.ui_label;
+			const std::string &ui_type = variable.ui_type;
 
 			ImGui::PushID(static_cast<int>(id++));
 
@@ -2459,9 +3019,9 @@ void reshade::runtime::draw_variable_editor()
 				get_uniform_value(variable, &data, 1);
 
 				if (ui_type == "combo")
-					modified = widgets::combo_with_buttons(label.data(), data);
+					modified = widgets::combo_with_buttons(label.c_str(), data);
 				else
-					modified = ImGui::Checkbox(label.data(), &data);
+					modified = ImGui::Checkbox(label.c_str(), &data);
 
 				if (modified)
 					set_uniform_value(variable, &data, 1);
@@ -2478,22 +3038,22 @@ void reshade::runtime::draw_variable_editor()
 				const auto ui_stp_val = std::max(1, variable.annotation_as_int("ui_step"));
 
 				if (ui_type == "slider")
-					modified = widgets::slider_with_buttons(label.data(), variable.type.is_signed() ? ImGuiDataType_S32 : ImGuiDataType_U32, data, variable.type.rows, &ui_stp_val, &ui_min_val, &ui_max_val);
+					modified = widgets::slider_with_buttons(label.c_str(), variable.type.is_signed() ? ImGuiDataType_S32 : ImGuiDataType_U32, data, variable.type.rows, &ui_stp_val, &ui_min_val, &ui_max_val);
 				else if (ui_type == "drag")
 					modified = variable.annotation_as_int("ui_step") == 0 ?
-						ImGui::DragScalarN(label.data(), variable.type.is_signed() ? ImGuiDataType_S32 : ImGuiDataType_U32, data, variable.type.rows, 1.0f, &ui_min_val, &ui_max_val) :
-						widgets::drag_with_buttons(label.data(), variable.type.is_signed() ? ImGuiDataType_S32 : ImGuiDataType_U32, data, variable.type.rows, &ui_stp_val, &ui_min_val, &ui_max_val);
+						ImGui::DragScalarN(label.c_str(), variable.type.is_signed() ? ImGuiDataType_S32 : ImGuiDataType_U32, data, variable.type.rows, 1.0f, &ui_min_val, &ui_max_val) :
+						widgets::drag_with_buttons(label.c_str(), variable.type.is_signed() ? ImGuiDataType_S32 : ImGuiDataType_U32, data, variable.type.rows, &ui_stp_val, &ui_min_val, &ui_max_val);
 				else if (ui_type == "list")
-					modified = widgets::list_with_buttons(label.data(), variable.annotation_as_string("ui_items"), data[0]);
+					modified = widgets::list_with_buttons(label.c_str(), variable.ui_items, data[0]);
 				else if (ui_type == "combo")
-					modified = widgets::combo_with_buttons(label.data(), variable.annotation_as_string("ui_items"), data[0]);
+					modified = widgets::combo_with_buttons(label.c_str(), variable.ui_items, data[0]);
 				else if (ui_type == "radio")
-					modified = widgets::radio_list(label.data(), variable.annotation_as_string("ui_items"), data[0]);
+					modified = widgets::radio_list(label.c_str(), variable.ui_items, data[0]);
 				else if (variable.type.is_matrix())
 					for (unsigned int row = 0; row < variable.type.rows; ++row)
 						modified = ImGui::InputScalarN((std::string(label) + " [row " + std::to_string(row) + ']').c_str(), variable.type.is_signed() ? ImGuiDataType_S32 : ImGuiDataType_U32, &data[0] + row * variable.type.cols, variable.type.cols) || modified;
 				else
-					modified = ImGui::InputScalarN(label.data(), variable.type.is_signed() ? ImGuiDataType_S32 : ImGuiDataType_U32, data, variable.type.rows);
+					modified = ImGui::InputScalarN(label.c_str(), variable.type.is_signed() ? ImGuiDataType_S32 : ImGuiDataType_U32, data, variable.type.rows);
 
 				if (modified)
 					set_uniform_value(variable, data, 16);
@@ -2514,22 +3074,22 @@ void reshade::runtime::draw_variable_editor()
 					++precision_format[2]; // This changes the text to "%.1f", "%.2f", "%.3f", ...
 
 				if (ui_type == "slider")
-					modified = widgets::slider_with_buttons(label.data(), ImGuiDataType_Float, data, variable.type.rows, &ui_stp_val, &ui_min_val, &ui_max_val, precision_format);
+					modified = widgets::slider_with_buttons(label.c_str(), ImGuiDataType_Float, data, variable.type.rows, &ui_stp_val, &ui_min_val, &ui_max_val, precision_format);
 				else if (ui_type == "drag")
 					modified = variable.annotation_as_float("ui_step") == 0 ?
-						ImGui::DragScalarN(label.data(), ImGuiDataType_Float, data, variable.type.rows, ui_stp_val, &ui_min_val, &ui_max_val, precision_format) :
-						widgets::drag_with_buttons(label.data(), ImGuiDataType_Float, data, variable.type.rows, &ui_stp_val, &ui_min_val, &ui_max_val, precision_format);
+						ImGui::DragScalarN(label.c_str(), ImGuiDataType_Float, data, variable.type.rows, ui_stp_val, &ui_min_val, &ui_max_val, precision_format) :
+						widgets::drag_with_buttons(label.c_str(), ImGuiDataType_Float, data, variable.type.rows, &ui_stp_val, &ui_min_val, &ui_max_val, precision_format);
 				else if (ui_type == "color" && variable.type.rows == 1)
-					modified = widgets::slider_for_alpha_value(label.data(), data);
+					modified = widgets::slider_for_alpha_value(label.c_str(), data);
 				else if (ui_type == "color" && variable.type.rows == 3)
-					modified = ImGui::ColorEdit3(label.data(), data, ImGuiColorEditFlags_NoOptions);
+					modified = ImGui::ColorEdit3(label.c_str(), data, ImGuiColorEditFlags_NoOptions);
 				else if (ui_type == "color" && variable.type.rows == 4)
-					modified = ImGui::ColorEdit4(label.data(), data, ImGuiColorEditFlags_NoOptions | ImGuiColorEditFlags_AlphaPreview | ImGuiColorEditFlags_AlphaBar);
+					modified = ImGui::ColorEdit4(label.c_str(), data, ImGuiColorEditFlags_NoOptions | ImGuiColorEditFlags_AlphaPreview | ImGuiColorEditFlags_AlphaBar);
 				else if (variable.type.is_matrix())
 					for (unsigned int row = 0; row < variable.type.rows; ++row)
 						modified = ImGui::InputScalarN((std::string(label) + " [row " + std::to_string(row) + ']').c_str(), ImGuiDataType_Float, &data[0] + row * variable.type.cols, variable.type.cols) || modified;
 				else
-					modified = ImGui::InputScalarN(label.data(), ImGuiDataType_Float, data, variable.type.rows);
+					modified = ImGui::InputScalarN(label.c_str(), ImGuiDataType_Float, data, variable.type.rows);
 
 				if (modified)
 					set_uniform_value(variable, data, 16);
@@ -2543,9 +3103,8 @@ void reshade::runtime::draw_variable_editor()
 				hovered_variable = variable_index + 1;
 
 			// Display tooltip
-			if (const std::string_view tooltip = variable.annotation_as_string("ui_tooltip");
-				!tooltip.empty() && ImGui::IsItemHovered())
-				ImGui::SetTooltip("%s", tooltip.data());
+			if (!variable.ui_tooltip.empty() && ImGui::IsItemHovered())
+				ImGui::SetTooltip("%s", variable.ui_tooltip.c_str());
 
 			// Create context menu
 			if (ImGui::BeginPopupContextItem("##context"))
@@ -2574,9 +3133,15 @@ void reshade::runtime::draw_variable_editor()
 
 			ImGui::PopID();
 
+			variable.ui_height = ImGui::GetCursorPosY() - cursor_start_y;
+
 			// A value has changed, so save the current preset
 			if (modified)
+			{
 				save_current_preset();
+
+				specialized_variable_modified |= variable.specialized;
+			}
 		}
 
 		if (active_variable_index < effect.uniforms.size())
@@ -2698,6 +3263,13 @@ void reshade::runtime::draw_variable_editor()
 			// Reloading an effect file invalidates all textures, but the statistics window may already have drawn references to those, so need to reset it
 			ImGui::FindWindowByName("Statistics")->DrawList->CmdBuffer.clear();
 		}
+		else if (specialized_variable_modified)
+		{
+			// Specialized variables are baked into the shaders, so only need to compile those again (the effect module is reused and compiled shaders are cached per value)
+			reload_effect(effect_index);
+
+			ImGui::FindWindowByName("Statistics")->DrawList->CmdBuffer.clear();
+		}
 	}
 
 	if (ImGui::BeginPopup("##pperror"))
@@ -2781,7 +3353,7 @@ void reshade::runtime::draw_technique_editor()
 						}
 					}
 
-					if (!effect.module.hlsl.empty() && // Hide if using SPIR-V, since that cannot easily be shown here
+					if ((!effect.module.hlsl.empty() || (effect.code_released && !uses_spirv_codegen())) && // Hide if using SPIR-V, since that cannot easily be shown here
 						widgets::popup_button("Show compiled results", 230.0f))
 					{
 						std::string entry_point_name;
@@ -2807,188 +3379,197 @@ void reshade::runtime::draw_technique_editor()
 	size_t force_reload_effect = std::numeric_limits<size_t>::max();
 	size_t hovered_technique_index = std::numeric_limits<size_t>::max();
 
+	// Collect techniques to show, so that only those scrolled into view need to be drawn (every item in the list has the same height)
+	_technique_editor_items.clear();
 	for (size_t index = 0; index < _techniques.size(); ++index)
-	{
-		reshade::technique &technique = _techniques[index];
-
-		// Skip hidden techniques
-		if (technique.hidden || !_effects[technique.effect_index].compiled)
-			continue;
-
-		ImGui::PushID(static_cast<int>(index));
-
-		// Look up effect that contains this technique
-		const reshade::effect &effect = _effects[technique.effect_index];
+		if (!_techniques[index].hidden && _effects[_techniques[index].effect_index].compiled)
+			_technique_editor_items.push_back(index);
 
-		// Draw border around the item if it is selected
-		const bool draw_border = _selected_technique == index;
-		if (draw_border)
-			ImGui::Separator();
-
-		// Prevent user from disabling the technique when it is set to always be enabled via annotation
-		ImGui::PushItemFlag(ImGuiItemFlags_Disabled, technique.annotation_as_int("enabled"));
-		// Gray out disabled techniques and mark those with warnings yellow
-		ImGui::PushStyleColor(ImGuiCol_Text,
-			effect.errors.empty() || technique.enabled ?
-				_imgui_context->Style.Colors[technique.enabled ? ImGuiCol_Text : ImGuiCol_TextDisabled] : COLOR_YELLOW);
-
-		std::string label(technique.annotation_as_string("ui_label"));
-		if (label.empty())
-			label = technique.name;
-		label += " [" + effect.source_file.filename().u8string() + ']';
-
-		if (bool status = technique.enabled;
-			ImGui::Checkbox(label.c_str(), &status))
+	ImGuiListClipper clipper;
+	clipper.Begin(static_cast<int>(_technique_editor_items.size()), ImGui::GetFrameHeightWithSpacing());
+	while (clipper.Step())
+	{
+		for (int item_index = clipper.DisplayStart; item_index < clipper.DisplayEnd; ++item_index)
 		{
-			if (status)
-				enable_technique(technique);
-			else
-				disable_technique(technique);
-			save_current_preset();
-		}
+			const size_t index = _technique_editor_items[item_index];
 
-		ImGui::PopStyleColor();
-		ImGui::PopItemFlag();
+			reshade::technique &technique = _techniques[index];
 
-		if (ImGui::IsItemActive())
-			_selected_technique = index;
-		if (ImGui::IsItemClicked())
-			_focused_effect = technique.effect_index;
-		if (ImGui::IsItemHovered(ImGuiHoveredFlags_RectOnly))
-			hovered_technique_index = index;
-
-		// Display tooltip
-		if (const std::string_view tooltip = technique.annotation_as_string("ui_tooltip");
-			ImGui::IsItemHovered() && (!tooltip.empty() || !effect.errors.empty()))
-		{
-			ImGui::BeginTooltip();
-			if (!tooltip.empty())
-			{
-				ImGui::TextUnformatted(tooltip.data());
-				ImGui::Spacing();
-			}
-			if (!effect.errors.empty())
-			{
-				ImGui::PushStyleColor(ImGuiCol_Text, COLOR_YELLOW);
-				ImGui::TextUnformatted(effect.errors.c_str());
-				ImGui::PopStyleColor();
-			}
-			ImGui::EndTooltip();
-		}
+			ImGui::PushID(static_cast<int>(index));
 
-		// Create context menu
-		if (ImGui::BeginPopupContextItem("##context"))
-		{
-			ImGui::TextUnformatted(technique.name.c_str());
-			ImGui::Separator();
+			// Look up effect that contains this technique
+			const reshade::effect &effect = _effects[technique.effect_index];
 
-			ImGui::PushItemWidth(230.0f);
+			// Prevent user from disabling the technique when it is set to always be enabled via annotation
+			ImGui::PushItemFlag(ImGuiItemFlags_Disabled, technique.always_enabled);
+			// Gray out disabled techniques and mark those with warnings yellow
+			ImGui::PushStyleColor(ImGuiCol_Text,
+				effect.errors.empty() || technique.enabled ?
+					_imgui_context->Style.Colors[technique.enabled ? ImGuiCol_Text : ImGuiCol_TextDisabled] : COLOR_YELLOW);
 
-			if (widgets::key_input_box("##toggle_key", technique.toggle_key_data, *_input))
+			if (bool status = technique.enabled;
+				ImGui::Checkbox(technique.ui_label.c_str(), &status))
+			{
+				if (status)
+					enable_technique(technique);
+				else
+					disable_technique(technique);
 				save_current_preset();
+			}
 
-			const bool is_not_top = index > 0;
-			const bool is_not_bottom = index < _techniques.size() - 1;
-
-			ImGui::PopItemWidth();
+			ImGui::PopStyleColor();
+			ImGui::PopItemFlag();
 
-			if (is_not_top && ImGui::Button("Move to top", ImVec2(230.0f, 0)))
+			// Draw border around the item if it is selected (without adding separators, which would change the height of the item)
+			if (_selected_technique == index)
 			{
-				_techniques.insert(_techniques.begin(), std::move(_techniques[index]));
-				_techniques.erase(_techniques.begin() + 1 + index);
-				save_current_preset();
-				ImGui::CloseCurrentPopup();
+				const float border_offset = _imgui_context->Style.ItemSpacing.y * 0.5f;
+				const ImVec2 window_pos = ImGui::GetWindowPos();
+				const float x_min = window_pos.x + ImGui::GetWindowContentRegionMin().x;
+				const float x_max = window_pos.x + ImGui::GetWindowContentRegionMax().x;
+				ImGui::GetWindowDrawList()->AddLine(ImVec2(x_min, ImGui::GetItemRectMin().y - border_offset), ImVec2(x_max, ImGui::GetItemRectMin().y - border_offset), ImGui::GetColorU32(ImGuiCol_Separator));
+				ImGui::GetWindowDrawList()->AddLine(ImVec2(x_min, ImGui::GetItemRectMax().y + border_offset), ImVec2(x_max, ImGui::GetItemRectMax().y + border_offset), ImGui::GetColorU32(ImGuiCol_Separator));
 			}
-			if (is_not_bottom && ImGui::Button("Move to bottom", ImVec2(230.0f, 0)))
+
+			if (ImGui::IsItemActive())
+				_selected_technique = index;
+			if (ImGui::IsItemClicked())
+				_focused_effect = technique.effect_index;
+			if (ImGui::IsItemHovered(ImGuiHoveredFlags_RectOnly))
+				hovered_technique_index = index;
+
+			// Display tooltip
+			if (const std::string &tooltip = technique.ui_tooltip;
+				ImGui::IsItemHovered() && (!tooltip.empty() || !effect.errors.empty()))
 			{
-				_techniques.push_back(std::move(_techniques[index]));
-				_techniques.erase(_techniques.begin() + index);
-				save_current_preset();
-				ImGui::CloseCurrentPopup();
+				ImGui::BeginTooltip();
+				if (!tooltip.empty())
+				{
+					ImGui::TextUnformatted(tooltip.c_str(), tooltip.c_str() + tooltip.size());
+					ImGui::Spacing();
+				}
+				if (!effect.errors.empty())
+				{
+					ImGui::PushStyleColor(ImGuiCol_Text, COLOR_YELLOW);
+					ImGui::TextUnformatted(effect.errors.c_str());
+					ImGui::PopStyleColor();
+				}
+				ImGui::EndTooltip();
 			}
 
-			ImGui::Separator();
-
-			if (ImGui::Button("Open folder in explorer", ImVec2(230.0f, 0)))
+			// Create context menu
+			if (ImGui::BeginPopupContextItem("##context"))
 			{
-				// Use absolute path to explorer to avoid potential security issues when executable is replaced
-				WCHAR explorer_path[260] = L"";
-				GetWindowsDirectoryW(explorer_path, ARRAYSIZE(explorer_path));
-				wcscat_s(explorer_path, L"\\explorer.exe");
+				ImGui::TextUnformatted(technique.name.c_str());
+				ImGui::Separator();
 
-				ShellExecuteW(nullptr, L"open", explorer_path, (L"/select,\"" + effect.source_file.wstring() + L"\"").c_str(), nullptr, SW_SHOWDEFAULT);
-			}
+				ImGui::PushItemWidth(230.0f);
 
-			ImGui::Separator();
+				if (widgets::key_input_box("##toggle_key", technique.toggle_key_data, *_input))
+					save_current_preset();
 
-			if (widgets::popup_button(ICON_FK_PENCIL " Edit source code", 230.0f))
-			{
-				std::filesystem::path source_file;
-				if (ImGui::MenuItem(effect.source_file.filename().u8string().c_str()))
-					source_file = effect.source_file;
+				const bool is_not_top = index > 0;
+				const bool is_not_bottom = index < _techniques.size() - 1;
 
-				if (!effect.preprocessed)
+				ImGui::PopItemWidth();
+
+				if (is_not_top && ImGui::Button("Move to top", ImVec2(230.0f, 0)))
 				{
-					// Force preprocessor to run to update included files
-					force_reload_effect = technique.effect_index;
+					_techniques.insert(_techniques.begin(), std::move(_techniques[index]));
+					_techniques.erase(_techniques.begin() + 1 + index);
+					_effect_handles_outdated = true;
+					save_current_preset();
+					ImGui::CloseCurrentPopup();
 				}
-				else if (!effect.included_files.empty())
+				if (is_not_bottom && ImGui::Button("Move to bottom", ImVec2(230.0f, 0)))
 				{
-					ImGui::Separator();
-
-					for (const std::filesystem::path &included_file : effect.included_files)
-						if (ImGui::MenuItem(included_file.filename().u8string().c_str()))
-							source_file = included_file;
+					_techniques.push_back(std::move(_techniques[index]));
+					_techniques.erase(_techniques.begin() + index);
+					_effect_handles_outdated = true;
+					save_current_preset();
+					ImGui::CloseCurrentPopup();
 				}
 
-				ImGui::EndPopup();
+				ImGui::Separator();
 
-				if (!source_file.empty())
+				if (ImGui::Button("Open folder in explorer", ImVec2(230.0f, 0)))
 				{
-					open_code_editor(technique.effect_index, source_file);
-					ImGui::CloseCurrentPopup();
+					// Use absolute path to explorer to avoid potential security issues when executable is replaced
+					WCHAR explorer_path[260] = L"";
+					GetWindowsDirectoryW(explorer_path, ARRAYSIZE(explorer_path));
+					wcscat_s(explorer_path, L"\\explorer.exe");
+
+					ShellExecuteW(nullptr, L"open", explorer_path, (L"/select,\"" + effect.source_file.wstring() + L"\"").c_str(), nullptr, SW_SHOWDEFAULT);
 				}
-			}
 
-			if (!effect.module.hlsl.empty() && // Hide if using SPIR-V, since that cannot easily be shown here
-				widgets::popup_button("Show compiled results", 230.0f))
-			{
-				std::string entry_point_name;
-				if (ImGui::MenuItem("Generated code"))
-					entry_point_name = "Generated code";
+				ImGui::Separator();
 
-				if (!effect.assembly.empty())
+				if (widgets::popup_button(ICON_FK_PENCIL " Edit source code", 230.0f))
 				{
-					ImGui::Separator();
+					std::filesystem::path source_file;
+					if (ImGui::MenuItem(effect.source_file.filename().u8string().c_str()))
+						source_file = effect.source_file;
 
-					for (const reshadefx::entry_point &entry_point : effect.module.entry_points)
-						if (const auto assembly_it = effect.assembly.find(entry_point.name);
-							assembly_it != effect.assembly.end() && ImGui::MenuItem(entry_point.name.c_str()))
-							entry_point_name = entry_point.name;
-				}
+					if (!effect.preprocessed)
+					{
+						// Force preprocessor to run to update included files
+						force_reload_effect = technique.effect_index;
+					}
+					else if (!effect.included_files.empty())
+					{
+						ImGui::Separator();
 
-				ImGui::EndPopup();
+						for (const std::filesystem::path &included_file : effect.included_files)
+							if (ImGui::MenuItem(included_file.filename().u8string().c_str()))
+								source_file = included_file;
+					}
+
+					ImGui::EndPopup();
+
+					if (!source_file.empty())
+					{
+						open_code_editor(technique.effect_index, source_file);
+						ImGui::CloseCurrentPopup();
+					}
+				}
 
-				if (!entry_point_name.empty())
+				if ((!effect.module.hlsl.empty() || (effect.code_released && !uses_spirv_codegen())) && // Hide if using SPIR-V, since that cannot easily be shown here
+					widgets::popup_button("Show compiled results", 230.0f))
 				{
-					open_code_editor(technique.effect_index, entry_point_name);
-					ImGui::CloseCurrentPopup();
+					std::string entry_point_name;
+					if (ImGui::MenuItem("Generated code"))
+						entry_point_name = "Generated code";
+
+					if (!effect.assembly.empty())
+					{
+						ImGui::Separator();
+
+						for (const reshadefx::entry_point &entry_point : effect.module.entry_points)
+							if (const auto assembly_it = effect.assembly.find(entry_point.name);
+								assembly_it != effect.assembly.end() && ImGui::MenuItem(entry_point.name.c_str()))
+								entry_point_name = entry_point.name;
+					}
+
+					ImGui::EndPopup();
+
+					if (!entry_point_name.empty())
+					{
+						open_code_editor(technique.effect_index, entry_point_name);
+						ImGui::CloseCurrentPopup();
+					}
 				}
+
+				ImGui::EndPopup();
 			}
 
-			ImGui::EndPopup();
-		}
+			if (technique.toggle_key_data[0] != 0)
+			{
+				ImGui::SameLine(ImGui::GetWindowContentRegionWidth() - 120);
+				ImGui::TextDisabled("%s", reshade::input::key_name(technique.toggle_key_data).c_str());
+			}
 
-		if (technique.toggle_key_data[0] != 0)
-		{
-			ImGui::SameLine(ImGui::GetWindowContentRegionWidth() - 120);
-			ImGui::TextDisabled("%s", reshade::input::key_name(technique.toggle_key_data).c_str());
+			ImGui::PopID();
 		}
-
-		if (draw_border)
-			ImGui::Separator();
-
-		ImGui::PopID();
 	}
 
 	// Move the selected technique to the position of the mouse in the list
@@ -2997,6 +3578,7 @@ void reshade::runtime::draw_technique_editor()
 		if (hovered_technique_index < _techniques.size() && hovered_technique_index != _selected_technique)
 		{
 			const auto move_technique = [this](size_t from_index, size_t to_index) {
+				_effect_handles_outdated = true;
 				if (to_index < from_index) // Up
 					for (size_t i = from_index; to_index < i; --i)
 						std::swap(_techniques[i - 1], _techniques[i]);
@@ -3084,10 +3666,14 @@ void reshade::runtime::open_code_editor(size_t effect_index, const std::filesyst
 }
 void reshade::runtime::open_code_editor(editor_instance &instance)
 {
-	const effect &effect = _effects[instance.effect_index];
+	effect &effect = _effects[instance.effect_index];
 
 	if (!instance.entry_point_name.empty())
 	{
+		// Generated code may have been released in low memory mode, so read it back from the effect cache
+		if (!restore_effect_code(effect))
+			LOG(WARN) << "Generated code of " << effect.source_file << " is no longer in the effect cache.";
+
 		instance.editor.set_text(instance.entry_point_name == "Generated code" ?
 			effect.preamble + effect.module.hlsl : effect.assembly.at(instance.entry_point_name));
 		instance.editor.set_readonly(true);
@@ -3125,6 +3711,26 @@ void reshade::runtime::open_code_editor(editor_instance &instance)
 
 			instance.editor.add_error(error_line, error_text, error_text.find("warning") != std::string::npos);
 		}
+
+		// Show how many instructions and texture samples every line of code results in, summed over all entry points (only available for DXBC with debug information)
+		instance.editor.clear_annotations();
+
+		if (!_no_debug_info && restore_effect_code(effect))
+		{
+			std::unordered_map<size_t, line_cost> costs;
+			for (const auto &[entry_point_name, assembly] : effect.assembly)
+				count_instructions_per_line(assembly, instance.file_path, costs);
+
+			for (const auto &[line, cost] : costs)
+			{
+				char text[32];
+				if (cost.samples != 0)
+					snprintf(text, sizeof(text), "%u (%u tex)", cost.instructions, cost.samples);
+				else
+					snprintf(text, sizeof(text), "%u", cost.instructions);
+				instance.editor.add_annotation(line, text);
+			}
+		}
 	}
 }
 void reshade::runtime::draw_code_editor(editor_instance &instance)
@@ -3148,6 +3754,31 @@ void reshade::runtime::draw_code_editor(editor_instance &instance)
 		}
 	}
 
+	// Show the GPU time of all passes using this entry point next to the first line of its disassembly
+	if (!instance.entry_point_name.empty() && _gather_gpu_statistics)
+	{
+		uint64_t gpu_duration = 0;
+		for (const technique &tech : _techniques)
+		{
+			if (tech.effect_index != instance.effect_index || !tech.enabled)
+				continue;
+
+			for (size_t pass_index = 0; pass_index < tech.passes.size() && pass_index < tech.passes_data.size(); ++pass_index)
+			{
+				const reshadefx::pass_info &pass = tech.passes[pass_index];
+				if (pass.vs_entry_point == instance.entry_point_name || pass.ps_entry_point == instance.entry_point_name || pass.cs_entry_point == instance.entry_point_name)
+					gpu_duration += tech.passes_data[pass_index].average_gpu_duration;
+			}
+		}
+
+		if (gpu_duration != 0)
+		{
+			char text[32];
+			snprintf(text, sizeof(text), "%.3f ms GPU", gpu_duration * 1e-6f);
+			instance.editor.add_annotation(1, text);
+		}
+	}
+
 	instance.editor.render("##editor", _editor_palette, false, _imgui_context->IO.Fonts->Fonts[1]);
 
 	// Disable keyboard shortcuts when the window is focused so they don't get triggered while editing text
@@ -3354,43 +3985,52 @@ void reshade::runtime::render_imgui_draw_data(ImDrawData *draw_data, api::render
 	const size_t buffer_index = _framecount % std::size(_imgui_vertices);
 
 	// Create and grow vertex/index buffers if needed
-	if (_imgui_num_indices[buffer_index] < draw_data->TotalIdxCount)
-	{
-		_device->wait_idle(); // Be safe and ensure nothing still uses this buffer
-
-		if (_imgui_indices[buffer_index].handle != 0)
-			_device->destroy_resource(_imgui_indices[buffer_index]);
-
-		const int new_size = draw_data->TotalIdxCount + 10000;
-		if (!_device->create_resource(api::resource_desc(new_size * sizeof(ImDrawIdx), api::memory_heap::cpu_to_gpu, api::resource_usage::index_buffer), nullptr, api::resource_usage::cpu_access, &_imgui_indices[buffer_index]))
+	// Growth is geometric, so that lists that slowly get longer (e.g. in the code editor) do not cause a new buffer every frame, and replaced buffers are retired instead of destroyed, so that there is no need to wait for the GPU
+	const bool persistent_mapping = _device->get_api() == api::device_api::d3d12 || _device->get_api() == api::device_api::vulkan;
+	const auto grow_buffer = [this, persistent_mapping](api::resource &buffer, void *&mapped_data, int &num_elements, int min_num_elements, uint32_t stride, api::resource_usage usage, const char *name) {
+		if (num_elements >= min_num_elements)
+			return true;
+
+		int new_num_elements = std::max(num_elements, 8192);
+		while (new_num_elements < min_num_elements)
+			new_num_elements *= 2;
+
+		api::resource new_buffer = {};
+		const resource_ledger::overlay_scope ledger_scope;
+		if (!_device->create_resource(api::resource_desc(static_cast<uint64_t>(new_num_elements) * stride, api::memory_heap::cpu_to_gpu, usage), nullptr, api::resource_usage::cpu_access, &new_buffer))
 		{
-			LOG(ERROR) << "Failed to create ImGui index buffer!";
-			return;
+			LOG(ERROR) << "Failed to create " << name << '!';
+			return false;
 		}
-		_device->set_resource_name(_imgui_indices[buffer_index], "ImGui index buffer");
-
-		_imgui_num_indices[buffer_index] = new_size;
-	}
-	if (_imgui_num_vertices[buffer_index] < draw_data->TotalVtxCount)
-	{
-		_device->wait_idle();
+		_device->set_resource_name(new_buffer, name);
 
-		if (_imgui_vertices[buffer_index].handle != 0)
-			_device->destroy_resource(_imgui_vertices[buffer_index]);
+		void *new_mapped_data = nullptr;
+		if (persistent_mapping && !_device->map_resource(new_buffer, 0, api::map_access::write_only, &new_mapped_data))
+		{
+			LOG(ERROR) << "Failed to map " << name << '!';
+			_device->destroy_resource(new_buffer);
+			return false;
+		}
 
-		const int new_size = draw_data->TotalVtxCount + 5000;
-		if (!_device->create_resource(api::resource_desc(new_size * sizeof(ImDrawVert), api::memory_heap::cpu_to_gpu, api::resource_usage::vertex_buffer), nullptr, api::resource_usage::cpu_access, &_imgui_vertices[buffer_index]))
+		if (buffer.handle != 0)
 		{
-			LOG(ERROR) << "Failed to create ImGui vertex buffer!";
-			return;
+			if (mapped_data != nullptr)
+				_device->unmap_resource(buffer, 0);
+			_imgui_retired_buffers.push_back(buffer);
 		}
-		_device->set_resource_name(_imgui_vertices[buffer_index], "ImGui vertex buffer");
 
-		_imgui_num_vertices[buffer_index] = new_size;
-	}
+		buffer = new_buffer;
+		mapped_data = new_mapped_data;
+		num_elements = new_num_elements;
+		return true;
+	};
 
-	if (ImDrawIdx *idx_dst = nullptr;
-		_device->map_resource(_imgui_indices[buffer_index], 0, api::map_access::write_only, reinterpret_cast<void **>(&idx_dst)))
+	if (!grow_buffer(_imgui_indices[buffer_index], _imgui_indices_data[buffer_index], _imgui_num_indices[buffer_index], draw_data->TotalIdxCount, sizeof(ImDrawIdx), api::resource_usage::index_buffer, "ImGui index buffer") ||
+		!grow_buffer(_imgui_vertices[buffer_index], _imgui_vertices_data[buffer_index], _imgui_num_vertices[buffer_index], draw_data->TotalVtxCount, sizeof(ImDrawVert), api::resource_usage::vertex_buffer, "ImGui vertex buffer"))
+		return;
+
+	if (ImDrawIdx *idx_dst = static_cast<ImDrawIdx *>(_imgui_indices_data[buffer_index]);
+		idx_dst != nullptr || _device->map_resource(_imgui_indices[buffer_index], 0, api::map_access::write_only, reinterpret_cast<void **>(&idx_dst)))
 	{
 		for (int n = 0; n < draw_data->CmdListsCount; ++n)
 		{
@@ -3399,10 +4039,11 @@ void reshade::runtime::render_imgui_draw_data(ImDrawData *draw_data, api::render
 			idx_dst += draw_list->IdxBuffer.Size;
 		}
 
-		_device->unmap_resource(_imgui_indices[buffer_index], 0);
+		if (_imgui_indices_data[buffer_index] == nullptr)
+			_device->unmap_resource(_imgui_indices[buffer_index], 0);
 	}
-	if (ImDrawVert *vtx_dst = nullptr;
-		_device->map_resource(_imgui_vertices[buffer_index], 0, api::map_access::write_only, reinterpret_cast<void **>(&vtx_dst)))
+	if (ImDrawVert *vtx_dst = static_cast<ImDrawVert *>(_imgui_vertices_data[buffer_index]);
+		vtx_dst != nullptr || _device->map_resource(_imgui_vertices[buffer_index], 0, api::map_access::write_only, reinterpret_cast<void **>(&vtx_dst)))
 	{
 		for (int n = 0; n < draw_data->CmdListsCount; ++n)
 		{
@@ -3411,7 +4052,8 @@ void reshade::runtime::render_imgui_draw_data(ImDrawData *draw_data, api::render
 			vtx_dst += draw_list->VtxBuffer.Size;
 		}
 
-		_device->unmap_resource(_imgui_vertices[buffer_index], 0);
+		if (_imgui_vertices_data[buffer_index] == nullptr)
+			_device->unmap_resource(_imgui_vertices[buffer_index], 0);
 	}
 
 	api::command_list *const cmd_list = _graphics_queue->get_immediate_command_list();
@@ -3490,18 +4132,28 @@ void reshade::runtime::destroy_imgui_resources()
 	_font_atlas = {};
 	_device->destroy_resource_view(_font_atlas_srv);
 	_font_atlas_srv = {};
-	_rebuild_font_atlas = true;
+	// Keep the glyphs that were rendered into the atlas in system memory, since they do not depend on the device, so that 'on_init' only has to upload them again
 
 	for (size_t i = 0; i < std::size(_imgui_vertices); ++i)
 	{
+		if (_imgui_indices_data[i] != nullptr)
+			_device->unmap_resource(_imgui_indices[i], 0);
+		_imgui_indices_data[i] = nullptr;
 		_device->destroy_resource(_imgui_indices[i]);
 		_imgui_indices[i] = {};
 		_imgui_num_indices[i] = 0;
+		if (_imgui_vertices_data[i] != nullptr)
+			_device->unmap_resource(_imgui_vertices[i], 0);
+		_imgui_vertices_data[i] = nullptr;
 		_device->destroy_resource(_imgui_vertices[i]);
 		_imgui_vertices[i] = {};
 		_imgui_num_vertices[i] = 0;
 	}
 
+	for (const api::resource buffer : _imgui_retired_buffers)
+		_device->destroy_resource(buffer);
+	_imgui_retired_buffers.clear();
+
 	_device->destroy_sampler(_imgui_sampler_state);
 	_imgui_sampler_state = {};
 	_device->destroy_pipeline(api::pipeline_stage::all_graphics, _imgui_pipeline);
@@ -8,6 +8,7 @@
 #include "version.h"
 #include "dll_log.hpp"
 #include "runtime.hpp"
+#include "resource_ledger.hpp"
 #include "hook_manager.hpp"
 #include "dll_resources.hpp"
 #include "vulkan/reshade_api_device.hpp"
@@ -65,6 +66,7 @@ void reshade::runtime::init_gui_vr()
 	s_overlay->SetOverlayWidthInMeters(s_main_handle, 1.5f);
 	s_overlay->SetOverlayFlag(s_main_handle, vr::VROverlayFlags_SendVRSmoothScrollEvents, true);
 
+	const resource_ledger::overlay_scope ledger_scope;
 	if (!_device->create_resource(api::resource_desc(OVERLAY_WIDTH, OVERLAY_HEIGHT, 1, 1, api::format::r8g8b8a8_unorm, 1, api::memory_heap::gpu_only, api::resource_usage::render_target | api::resource_usage::shader_resource), nullptr, api::resource_usage::shader_resource_pixel, &_vr_overlay_texture))
 	{
 		LOG(ERROR) << "Failed to create VR dashboard overlay texture!";
@@ -115,7 +117,10 @@ void reshade::runtime::draw_gui_vr()
 		return;
 
 	if (_rebuild_font_atlas)
+	{
 		build_font_atlas();
+		init_font_atlas_texture();
+	}
 	if (_font_atlas_srv.handle == 0)
 		return; // Cannot render GUI without font atlas
 
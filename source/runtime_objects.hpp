@@ -6,9 +6,16 @@
 #pragma once
 
 #include "effect_module.hpp"
+#include "moving_histogram.hpp"
+#include <future>
+#include <algorithm>
+#include <string_view>
+#include <limits>
 
 namespace reshade
 {
+	class cache_archive;
+
 	enum class special_uniform
 	{
 		none,
@@ -37,6 +44,11 @@ namespace reshade
 
 		inline operator T() const { return _average; }
 
+		/// <summary>
+		/// Gets the most recently appended value.
+		/// </summary>
+		T last() const { return _tick_list[(_index + SAMPLES - 1) % SAMPLES]; }
+
 		void clear()
 		{
 			_index = 0;
@@ -59,30 +71,90 @@ namespace reshade
 		T _average, _tick_sum, _tick_list[SAMPLES];
 	};
 
+	/// <summary>
+	/// A ring of timestamp query sets in a query pool, with one set per frame that can be in flight.
+	/// Results are read back from the oldest set only after a few frames have passed, so that reading them never has to wait for the GPU.
+	/// </summary>
+	struct query_ring
+	{
+		uint32_t base_index = 0;
+		uint32_t set_size = 0;
+		uint32_t depth = 0;
+		uint32_t head = 0;
+		uint32_t num_pending = 0;
+		// Frame each set was written in and the index of the technique event recorded into the frame timeline for it (see 'frame_timeline')
+		uint64_t frame_index[16] = {};
+		uint32_t timeline_event[16] = {};
+		// Index of the first pipeline statistics query (one per set), and whether one was written for each set, since not all APIs and queues support them
+		uint32_t statistics_base_index = 0;
+		bool has_statistics[16] = {};
+
+		uint32_t num_queries() const { return set_size * depth; }
+
+		bool full() const { return num_pending == depth; }
+		// Give the GPU time to finish the oldest set before the ring fills up, since some backends (D3D12) cannot report whether results are available yet
+		bool oldest_due() const { return num_pending != 0 && num_pending + 1 >= depth; }
+
+		uint32_t oldest_set() const { return (head + depth - num_pending) % depth; }
+		uint32_t oldest_index() const { return base_index + oldest_set() * set_size; }
+		uint32_t current_index() const { return base_index + head * set_size; }
+		uint32_t oldest_statistics_index() const { return statistics_base_index + oldest_set(); }
+		uint32_t current_statistics_index() const { return statistics_base_index + head; }
+
+		void push(uint64_t frame, uint32_t event_index, bool statistics) { frame_index[head] = frame; timeline_event[head] = event_index; has_statistics[head] = statistics; head = (head + 1) % depth; num_pending++; }
+		void pop() { num_pending--; }
+	};
+
+	/// <summary>
+	/// Sorts annotations by name, so that they can be looked up with a binary search via <see cref="find_annotation"/>.
+	/// </summary>
+	inline void sort_annotations(std::vector<reshadefx::annotation> &annotations)
+	{
+		// Keep the order of annotations with the same name, so that the first one declared is still the one found
+		std::stable_sort(annotations.begin(), annotations.end(),
+			[](const reshadefx::annotation &lhs, const reshadefx::annotation &rhs) { return lhs.name < rhs.name; });
+	}
+	/// <summary>
+	/// Finds the annotation with the specified name in a list of annotations sorted with <see cref="sort_annotations"/>.
+	/// </summary>
+	inline const reshadefx::annotation *find_annotation(const std::vector<reshadefx::annotation> &annotations, const std::string_view name)
+	{
+		const auto it = std::lower_bound(annotations.begin(), annotations.end(), name,
+			[](const reshadefx::annotation &annotation, const std::string_view name) { return std::string_view(annotation.name) < name; });
+		return it != annotations.end() && it->name == name ? &*it : nullptr;
+	}
+
 	struct texture final : reshadefx::texture_info
 	{
 		texture() {} // For standalone textures like the font atlas
-		texture(const reshadefx::texture_info &init) : texture_info(init) {}
+		texture(const reshadefx::texture_info &init) : texture_info(init)
+		{
+			sort_annotations(annotations);
+
+			if (const reshadefx::annotation *const source_annotation = find_annotation(annotations, "source"))
+				source = source_annotation->value.string_data;
+			if (const reshadefx::annotation *const pooled_annotation = find_annotation(annotations, "pooled"))
+				pooled = pooled_annotation->type.is_integral() ? pooled_annotation->value.as_int[0] != 0 : pooled_annotation->value.as_float[0] != 0.0f;
+			if (const reshadefx::annotation *const compress_annotation = find_annotation(annotations, "compress"))
+				compress = compress_annotation->type.is_integral() ? compress_annotation->value.as_int[0] != 0 : compress_annotation->value.as_float[0] != 0.0f;
+		}
 
 		auto annotation_as_int(const char *ann_name, size_t i = 0) const
 		{
-			const auto it = std::find_if(annotations.begin(), annotations.end(),
-				[ann_name](const auto &annotation) { return annotation.name == ann_name; });
-			if (it == annotations.end()) return 0;
+			const auto it = find_annotation(annotations, ann_name);
+			if (it == nullptr) return 0;
 			return it->type.is_integral() ? it->value.as_int[i] : static_cast<int>(it->value.as_float[i]);
 		}
 		auto annotation_as_float(const char *ann_name, size_t i = 0) const
 		{
-			const auto it = std::find_if(annotations.begin(), annotations.end(),
-				[ann_name](const auto &annotation) { return annotation.name == ann_name; });
-			if (it == annotations.end()) return 0.0f;
+			const auto it = find_annotation(annotations, ann_name);
+			if (it == nullptr) return 0.0f;
 			return it->type.is_floating_point() ? it->value.as_float[i] : static_cast<float>(it->value.as_int[i]);
 		}
 		auto annotation_as_string(const char *ann_name) const
 		{
-			const auto it = std::find_if(annotations.begin(), annotations.end(),
-				[ann_name](const auto &annotation) { return annotation.name == ann_name; });
-			if (it == annotations.end()) return std::string_view();
+			const auto it = find_annotation(annotations, ann_name);
+			if (it == nullptr) return std::string_view();
 			return std::string_view(it->value.string_data);
 		}
 
@@ -94,6 +166,12 @@ namespace reshade
 		size_t effect_index = std::numeric_limits<size_t>::max();
 		std::vector<size_t> shared;
 		bool loaded = false;
+		// Path of the image file from the 'source' annotation and whether the 'pooled' and 'compress' annotations are set, which are decoded once instead of on every access
+		std::string source;
+		bool pooled = false;
+		bool compress = false;
+		// Names of the techniques accessing this texture if its contents are not preserved outside of each of them, in which case the resource is aliased with textures of other techniques
+		std::vector<std::string> transient_techniques;
 
 		api::resource resource = {};
 		api::resource_view srv[2] = {};
@@ -101,29 +179,38 @@ namespace reshade
 		api::resource_view uav = {};
 	};
 
+	struct aliased_resource
+	{
+		api::resource resource = {};
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint16_t levels = 0;
+		reshadefx::texture_format format = reshadefx::texture_format::unknown;
+		bool storage_access = false;
+		// Effect index and technique name of every technique accessing a texture using this resource (textures accessed by the same technique cannot share it)
+		std::vector<std::pair<size_t, std::string>> users;
+	};
+
 	struct uniform final : reshadefx::uniform_info
 	{
-		uniform(const reshadefx::uniform_info &init) : uniform_info(init) {}
+		uniform(const reshadefx::uniform_info &init) : uniform_info(init) { sort_annotations(annotations); }
 
 		auto annotation_as_int(const char *ann_name, size_t i = 0, int default_value = 0) const
 		{
-			const auto it = std::find_if(annotations.begin(), annotations.end(),
-				[ann_name](const auto &annotation) { return annotation.name == ann_name; });
-			if (it == annotations.end()) return default_value;
+			const auto it = find_annotation(annotations, ann_name);
+			if (it == nullptr) return default_value;
 			return it->type.is_integral() ? it->value.as_int[i] : static_cast<int>(it->value.as_float[i]);
 		}
 		auto annotation_as_float(const char *ann_name, size_t i = 0, float default_value = 0.0f) const
 		{
-			const auto it = std::find_if(annotations.begin(), annotations.end(),
-				[ann_name](const auto &annotation) { return annotation.name == ann_name; });
-			if (it == annotations.end()) return default_value;
+			const auto it = find_annotation(annotations, ann_name);
+			if (it == nullptr) return default_value;
 			return it->type.is_floating_point() ? it->value.as_float[i] : static_cast<float>(it->value.as_int[i]);
 		}
 		auto annotation_as_string(const char *ann_name, const std::string_view &default_value = std::string_view()) const
 		{
-			const auto it = std::find_if(annotations.begin(), annotations.end(),
-				[ann_name](const auto &annotation) { return annotation.name == ann_name; });
-			if (it == annotations.end()) return default_value;
+			const auto it = find_annotation(annotations, ann_name);
+			if (it == nullptr) return default_value;
 			return std::string_view(it->value.string_data);
 		}
 
@@ -140,54 +227,158 @@ namespace reshade
 		size_t effect_index = std::numeric_limits<size_t>::max();
 		special_uniform special = special_uniform::none;
 		uint32_t toggle_key_data[4] = {};
+		// The value of this variable was baked into the shaders as a specialization constant, so changing it requires a reload
+		bool specialized = false;
+
+		// Annotations used by the variable editor, which are looked up once when the effect is loaded instead of every frame
+		bool hidden = false;
+		bool ui_category_closed = false;
+		int ui_spacing = 0;
+		std::string ui_label;
+		std::string ui_type;
+		std::string ui_category;
+		std::string ui_items;
+		std::string ui_text;
+		std::string ui_tooltip;
+		// Height of the widget when it was last drawn, so that it can be skipped while scrolled out of view
+		float ui_height = 0.0f;
 	};
 
 	struct technique final : reshadefx::technique_info
 	{
-		technique(const reshadefx::technique_info &init) : technique_info(init) {}
+		technique(const reshadefx::technique_info &init) : technique_info(init) { sort_annotations(annotations); }
 
 		auto annotation_as_int(const char *ann_name, size_t i = 0) const
 		{
-			const auto it = std::find_if(annotations.begin(), annotations.end(),
-				[ann_name](const auto &annotation) { return annotation.name == ann_name; });
-			if (it == annotations.end()) return 0;
+			const auto it = find_annotation(annotations, ann_name);
+			if (it == nullptr) return 0;
 			return it->type.is_integral() ? it->value.as_int[i] : static_cast<int>(it->value.as_float[i]);
 		}
 		auto annotation_as_float(const char *ann_name, size_t i = 0) const
 		{
-			const auto it = std::find_if(annotations.begin(), annotations.end(),
-				[ann_name](const auto &annotation) { return annotation.name == ann_name; });
-			if (it == annotations.end()) return 0.0f;
+			const auto it = find_annotation(annotations, ann_name);
+			if (it == nullptr) return 0.0f;
 			return it->type.is_floating_point() ? it->value.as_float[i] : static_cast<float>(it->value.as_int[i]);
 		}
 		auto annotation_as_string(const char *ann_name) const
 		{
-			const auto it = std::find_if(annotations.begin(), annotations.end(),
-				[ann_name](const auto &annotation) { return annotation.name == ann_name; });
-			if (it == annotations.end()) return std::string_view();
+			const auto it = find_annotation(annotations, ann_name);
+			if (it == nullptr) return std::string_view();
 			return std::string_view(it->value.string_data);
 		}
 
 		size_t effect_index = std::numeric_limits<size_t>::max();
 		bool hidden = false;
 		bool enabled = false;
+		// Technique was marked to always be enabled via annotation, so cannot be disabled in the technique editor
+		bool always_enabled = false;
+		// Label and tooltip shown in the technique editor, which are built once when the effect is loaded instead of every frame
+		std::string ui_label;
+		std::string ui_tooltip;
 		int64_t time_left = 0;
+		// Technique is only rendered every this many frames (see 'interval' annotation)
+		uint32_t render_interval = 1;
+		// Position in the preset's budget priority list (starting at one), or zero if this technique is never suspended to stay within the frame time budget
+		uint32_t budget_priority = 0;
+		// Technique is temporarily not rendered, because the frame time exceeded the budget (see 'runtime::update_frame_time_budget')
+		bool budget_suspended = false;
+		// Technique is not rendered this frame due to its render interval or being suspended
+		bool skipped = false;
+		// Pipelines of this technique may still be built by the driver in the background (see 'runtime::update_pending_pipelines')
+		bool pipelines_pending = false;
+		// Pipelines that are still being created on worker threads, indexed by pass (see 'runtime::init_effect')
+		std::vector<std::future<api::pipeline>> pending_pipelines;
 		uint32_t toggle_key_data[4] = {};
 		moving_average<uint64_t, 60> average_cpu_duration;
 		moving_average<uint64_t, 60> average_gpu_duration;
+		moving_histogram<256> gpu_duration_histogram;
+		// Pipeline statistics of all passes of this technique, which are only gathered on APIs that support them
+		moving_average<uint64_t, 60> average_pixel_invocations;
+		moving_average<uint64_t, 60> average_compute_invocations;
+		moving_average<uint64_t, 60> average_primitives;
 
 		struct pass_data
 		{
 			api::render_pass pass = {};
 			api::pipeline pipeline = {};
 			std::vector<api::resource> modified_resources;
+			std::vector<api::resource> sampled_resources;
 			std::vector<api::resource_view> generate_mipmap_views;
+			std::vector<api::resource> generate_mipmap_resources;
 			api::descriptor_set texture_set = {};
 			api::descriptor_set storage_set = {};
+			// Pass samples the back buffer copy (a texture with the "COLOR" semantic), so needs it to be up to date
+			bool samples_backbuffer = false;
+			// Pixels in the hidden area of the back buffer are skipped by this pass via the stencil test (see 'runtime::set_hidden_area_mesh')
+			bool hidden_area_masked = false;
+			// Pixels in sky tiles of the back buffer are skipped by this pass via the stencil test (see 'runtime::update_sky_mask')
+			bool sky_masked = false;
+			// Index of the uniform in the effect that limits this pass to a scissor rectangle (see 'ScissorRect' pass state), or -1 if it covers the full viewport
+			size_t scissor_uniform_index = std::numeric_limits<size_t>::max();
+			// Pass is rendered at the coarser shading rate from its 'ShadingRate' pass state, which the device supports
+			bool coarse_shading = false;
+
+			// Command arguments that are baked in 'runtime::init_effect', so that 'runtime::render_technique' does not have to compute or allocate them every frame
+			uint32_t texture_set_index = 0;
+			uint32_t storage_set_index = 0;
+			std::vector<api::resource_usage> shader_resource_states;
+			std::vector<api::resource_usage> shader_resource_non_pixel_states;
+			std::vector<api::resource_usage> target_states;
+			float viewport[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+			int32_t scissor_rect[4] = {};
+
+			// Scheduling state that is updated every frame in 'runtime::update_render_graph'
+			bool copy_backbuffer = true;
+			bool merged_with_prev = false;
+			bool merged_with_next = false;
+
+			moving_average<uint64_t, 60> average_gpu_duration;
 		};
 
 		std::vector<pass_data> passes_data;
-		uint32_t query_base_index = 0;
+		// Technique consists only of compute passes that access resources owned by the runtime, so can be executed on an async compute queue
+		bool async_compute = false;
+		// Technique has passes that skip sky tiles (see 'mask_sky' annotation), which change every frame, so its commands are not recorded
+		bool sky_masked = false;
+		// Float constant registers the vertex and pixel shaders of all passes read uniforms from in D3D9, as first and last plus one, so that only those are uploaded
+		uint32_t vs_constant_registers[2] = {};
+		uint32_t ps_constant_registers[2] = {};
+		// Time stamps are written before the first and after every pass
+		query_ring queries;
+		// Commands recorded when this technique was rendered in a previous frame, which are executed again instead of translating all passes anew (see 'runtime::begin_technique_recording')
+		// Indexed by the back buffer they were recorded for, since they render to it
+		std::vector<uint64_t> recordings;
+	};
+
+	struct compiled_shaders
+	{
+		bool succeeded = false;
+		std::string errors;
+		std::unordered_map<std::string, std::vector<char>> entry_points;
+		std::unordered_map<std::string, std::string> assembly;
+		// Effect cache hashes of the compiled entry points, so that their assembly can be read again later (see 'runtime::restore_effect_code')
+		std::unordered_map<std::string, size_t> assembly_hashes;
+	};
+
+	struct special_uniform_update
+	{
+		enum class input_mode
+		{
+			down,
+			press,
+			toggle,
+		};
+
+		special_uniform type;
+		size_t uniform_index;
+
+		// Annotation values are decoded once when the effect is initialized, so that they do not have to be looked up every frame
+		int keycode = 0;
+		input_mode mode = input_mode::down;
+		int min_int = 0, max_int = 0;
+		float min = 0.0f, max = 0.0f;
+		float step[2] = {};
+		float smoothing = 0.0f;
 	};
 
 	struct effect final
@@ -195,6 +386,7 @@ namespace reshade
 		unsigned int rendering = 0;
 		bool skipped = false;
 		bool compiled = false;
+		bool render_scaled = false;
 		bool preprocessed = false;
 		std::string errors;
 		std::string preamble;
@@ -204,12 +396,25 @@ namespace reshade
 		std::vector<std::filesystem::path> included_files;
 		std::vector<std::pair<std::string, std::string>> definitions;
 		std::unordered_map<std::string, std::string> assembly;
+		std::unordered_map<std::string, size_t> assembly_hashes;
+		// Set while the generated code and assembly are released to save memory (see 'runtime::release_effect_code')
+		bool code_released = false;
+		// Set when the preprocessor definitions changed while none of the techniques of this effect was enabled, so it is only built with the new ones once one is (see 'runtime::select_effect_variants')
+		bool definitions_outdated = false;
+		std::future<compiled_shaders> pending_shaders;
 		std::vector<uniform> uniforms;
+		std::vector<special_uniform_update> special_uniforms;
+		// Number of consecutive frames in which none of the techniques of this effect was enabled (see 'runtime::evict_unused_effects')
+		unsigned int frames_without_rendering = 0;
+		// Fence value on the graphics queue that was pending when this effect stopped rendering, after which its resources can be freed without waiting for the device to go idle
+		uint64_t last_render_fence_value = 0;
 		std::vector<unsigned char> uniform_data_storage;
+		// Byte range of the uniform data storage that was modified since the constant buffer was last updated
+		size_t uniform_data_dirty_begin = 0;
+		size_t uniform_data_dirty_end = std::numeric_limits<size_t>::max();
 
 		struct binding_data
 		{
-			std::string semantic;
 			api::descriptor_set set;
 			uint32_t index;
 			api::sampler sampler;
@@ -220,7 +425,39 @@ namespace reshade
 		api::descriptor_set_layout set_layouts[4] = {};
 		api::descriptor_set cb_set = {};
 		api::descriptor_set sampler_set = {};
+		// Passes that bind the same resources share a single descriptor set, which is owned by the effect
+		std::vector<api::descriptor_set> texture_sets;
+		std::vector<api::descriptor_set> storage_sets;
 		api::query_pool query_heap = {};
-		std::vector<binding_data> texture_semantic_to_binding;
+		// Optional query pool for pipeline statistics of every technique, which is empty when not supported
+		api::query_pool statistics_query_heap = {};
+		// Texture descriptors bound to semantics, indexed by semantic so that updating one only has to visit its own bindings
+		std::unordered_map<std::string, std::vector<binding_data>> texture_semantic_to_binding;
+		// Writes of the descriptor sets in 'texture_sets', from which a new version of a set is created when a binding changes (see 'runtime::update_texture_bindings' and 'runtime::update_texture_views')
+		std::unordered_map<uint64_t, std::vector<api::descriptor_set_write>> texture_set_writes;
+		// Previous versions of descriptor sets along with the fence value on the graphics queue that is reached once commands recorded before they were replaced finished executing, at which point they are destroyed
+		std::vector<std::pair<uint64_t, api::descriptor_set>> retired_texture_sets;
+	};
+
+	struct effect_permutation
+	{
+		std::filesystem::path source_file;
+		size_t source_hash = 0;
+		std::string errors;
+		reshadefx::module module;
+		std::vector<std::filesystem::path> included_files;
+		std::vector<std::pair<std::string, std::string>> definitions;
+	};
+
+	/// <summary>
+	/// Effect data that only depends on the effect source, its preprocessor definitions and the renderer, which is therefore shared by all effect runtimes created on the same device (e.g. for an application with multiple windows).
+	/// </summary>
+	struct shared_effect_cache
+	{
+		std::mutex archive_mutex;
+		std::shared_ptr<cache_archive> archive;
+		std::shared_ptr<cache_archive> machine_archive;
+		std::mutex permutations_mutex;
+		std::vector<effect_permutation> permutations; // Sorted from least to most recently used
 	};
 }
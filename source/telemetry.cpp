@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "telemetry.hpp"
+#include "dll_log.hpp"
+#include <mutex>
+#include <cassert>
+#include <string>
+#include <Windows.h>
+#include <TraceLoggingProvider.h>
+
+// {8E5E6A14-3C1F-4F5B-9B43-2E6A1D1C7A53}
+TRACELOGGING_DEFINE_PROVIDER(s_provider, "ReShade", (0x8e5e6a14, 0x3c1f, 0x4f5b, 0x9b, 0x43, 0x2e, 0x6a, 0x1d, 0x1c, 0x7a, 0x53));
+
+// The provider can only be registered once per process, but there may be multiple runtimes publishing telemetry
+static std::mutex s_provider_mutex;
+static unsigned int s_provider_references = 0;
+static std::atomic<unsigned int> s_next_runtime_index = 0;
+
+reshade::telemetry::~telemetry()
+{
+	close();
+}
+
+bool reshade::telemetry::open()
+{
+	if (_header != nullptr)
+		return true;
+
+	const size_t size = sizeof(telemetry_shared_header) + sizeof(telemetry_frame_record) * capacity;
+	const std::string name = "Local\\ReShadeTelemetry_" + std::to_string(GetCurrentProcessId()) + '_' + std::to_string(s_next_runtime_index++);
+
+	const HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, static_cast<DWORD>(static_cast<uint64_t>(size) >> 32), static_cast<DWORD>(size), name.c_str());
+	if (mapping == nullptr)
+	{
+		LOG(ERROR) << "Failed to create shared memory for telemetry with error code " << GetLastError() << '!';
+		return false;
+	}
+
+	void *const mapped = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (mapped == nullptr)
+	{
+		LOG(ERROR) << "Failed to map shared memory for telemetry with error code " << GetLastError() << '!';
+		CloseHandle(mapping);
+		return false;
+	}
+
+	_mapping = mapping;
+	_header = static_cast<telemetry_shared_header *>(mapped);
+	_records = reinterpret_cast<telemetry_frame_record *>(_header + 1);
+
+	// Mapping is zero-initialized, so only need to fill in the header (magic value last, so that readers do not see a partial header)
+	_header->version = telemetry_shared_header::version_value;
+	_header->record_size = sizeof(telemetry_frame_record);
+	_header->capacity = capacity;
+	_header->write_index.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	_header->magic = telemetry_shared_header::magic_value;
+
+	const std::lock_guard<std::mutex> lock(s_provider_mutex);
+	if (s_provider_references++ == 0)
+		TraceLoggingRegister(s_provider);
+
+	LOG(INFO) << "Publishing telemetry to shared memory \"" << name << "\".";
+
+	return true;
+}
+void reshade::telemetry::close()
+{
+	if (_header == nullptr)
+		return;
+
+	UnmapViewOfFile(_header);
+	CloseHandle(_mapping);
+
+	_mapping = nullptr;
+	_header = nullptr;
+	_records = nullptr;
+
+	const std::lock_guard<std::mutex> lock(s_provider_mutex);
+	if (--s_provider_references == 0)
+		TraceLoggingUnregister(s_provider);
+}
+
+reshade::telemetry_frame_record &reshade::telemetry::begin_record()
+{
+	assert(_header != nullptr);
+
+	telemetry_frame_record &record = _records[_header->write_index.load(std::memory_order_relaxed) % capacity];
+	// Mark record as being written, before any of its contents are modified
+	record.sequence.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	return record;
+}
+void reshade::telemetry::publish_record(telemetry_frame_record &record)
+{
+	const uint64_t sequence = _header->write_index.load(std::memory_order_relaxed) + 1;
+
+	record.sequence.store(sequence, std::memory_order_release);
+	_header->write_index.store(sequence, std::memory_order_release);
+
+	// These are no-ops unless a trace session enabled the provider
+	TraceLoggingWrite(s_provider, "Frame",
+		TraceLoggingUInt64(record.frame_index, "FrameIndex"),
+		TraceLoggingUInt64(record.present_to_present_ns, "PresentToPresentNs"),
+		TraceLoggingUInt64(record.runtime_cpu_duration_ns, "RuntimeCpuNs"),
+		TraceLoggingUInt64(record.effects_cpu_duration_ns, "EffectsCpuNs"),
+		TraceLoggingUInt64(record.hook_cpu_duration_ns, "HookCpuNs"),
+		TraceLoggingUInt64(record.frame_time_percentiles_ns[0], "FrameTimeP50Ns"),
+		TraceLoggingUInt64(record.frame_time_percentiles_ns[1], "FrameTimeP95Ns"),
+		TraceLoggingUInt64(record.frame_time_percentiles_ns[2], "FrameTimeP99Ns"),
+		TraceLoggingUInt64(record.frame_time_percentiles_ns[3], "FrameTimeMaxNs"),
+		TraceLoggingUInt32(record.effect_reload_count, "EffectReloadCount"),
+		TraceLoggingUInt32(record.num_techniques, "TechniqueCount"));
+
+	if (TraceLoggingProviderEnabled(s_provider, 0, 0))
+	{
+		for (uint32_t i = 0; i < record.num_techniques; ++i)
+		{
+			TraceLoggingWrite(s_provider, "Technique",
+				TraceLoggingUInt64(record.frame_index, "FrameIndex"),
+				TraceLoggingString(record.techniques[i].name, "Name"),
+				TraceLoggingUInt64(record.techniques[i].cpu_duration_ns, "CpuNs"),
+				TraceLoggingUInt64(record.techniques[i].gpu_duration_ns, "GpuNs"),
+				TraceLoggingUInt64(record.techniques[i].gpu_duration_percentiles_ns[1], "GpuP95Ns"),
+				TraceLoggingUInt64(record.techniques[i].gpu_duration_percentiles_ns[2], "GpuP99Ns"));
+		}
+	}
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace reshade
+{
+	/// <summary>
+	/// Timing of a single technique in a frame record.
+	/// </summary>
+	struct telemetry_technique_record
+	{
+		char name[64];
+		uint64_t cpu_duration_ns;
+		// Timestamp queries are only resolved a few frames later, so this is the most recent measurement available at the time the record is written (zero if none)
+		uint64_t gpu_duration_ns;
+		// 50th, 95th and 99th percentile and maximum of the GPU duration over the last frames
+		uint64_t gpu_duration_percentiles_ns[4];
+	};
+
+	/// <summary>
+	/// Per-frame record published into the shared memory ring and as a TraceLogging event.
+	/// </summary>
+	struct telemetry_frame_record
+	{
+		static constexpr uint32_t max_techniques = 32;
+
+		// Sequence number of this record (starting at one), which is zero while the record is being written (see <see cref="telemetry_shared_header"/>)
+		std::atomic<uint64_t> sequence;
+		uint64_t frame_index;
+		// Time at which the frame was presented, as a 'QueryPerformanceCounter' value converted to nanoseconds
+		uint64_t timestamp_ns;
+		uint64_t present_to_present_ns;
+		// Time spent in ReShade for this frame (rendering effects, the overlay and handling input)
+		uint64_t runtime_cpu_duration_ns;
+		uint64_t effects_cpu_duration_ns;
+		// Time spent in the hook layer since the last present (only measured when built with 'RESHADE_PROFILING', zero otherwise)
+		uint64_t hook_cpu_duration_ns;
+		// 50th, 95th and 99th percentile and maximum of the present-to-present time over the last frames
+		uint64_t frame_time_percentiles_ns[4];
+		uint32_t effect_reload_count;
+		uint32_t num_techniques;
+		telemetry_technique_record techniques[max_techniques];
+	};
+
+	/// <summary>
+	/// Header at the beginning of the shared memory, which is followed by an array of <see cref="capacity"/> frame records.
+	/// The runtime is the only writer. Readers find the newest record at index '(write_index - 1) % capacity', read its sequence number, copy it and read the sequence number again.
+	/// The copy is valid only if both sequence numbers are equal and not zero, otherwise the record was overwritten in the meantime.
+	/// </summary>
+	struct telemetry_shared_header
+	{
+		static constexpr uint32_t magic_value = 0x4D4C4554; // 'TELM'
+		static constexpr uint32_t version_value = 3;
+
+		uint32_t magic;
+		uint32_t version;
+		uint32_t record_size;
+		uint32_t capacity;
+		// Number of records written so far
+		std::atomic<uint64_t> write_index;
+	};
+
+	/// <summary>
+	/// Publishes per-frame timing records into a named shared memory ring ("Local\ReShadeTelemetry_<process id>_<runtime index>") and as TraceLogging events of the "ReShade" provider, so that external tools can consume them without the overlay.
+	/// </summary>
+	class telemetry
+	{
+	public:
+		static constexpr uint32_t capacity = 256;
+
+		telemetry() = default;
+		~telemetry();
+
+		bool open();
+		void close();
+
+		bool is_open() const { return _header != nullptr; }
+
+		/// <summary>
+		/// Gets the record to fill for the current frame, which is marked as being written until <see cref="publish_record"/> is called.
+		/// </summary>
+		telemetry_frame_record &begin_record();
+		/// <summary>
+		/// Publishes the record previously returned by <see cref="begin_record"/>.
+		/// </summary>
+		void publish_record(telemetry_frame_record &record);
+
+	private:
+		void *_mapping = nullptr;
+		telemetry_shared_header *_header = nullptr;
+		telemetry_frame_record *_records = nullptr;
+	};
+}
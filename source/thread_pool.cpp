@@ -0,0 +1,282 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "thread_pool.hpp"
+#include <cassert>
+#include <algorithm>
+#include <Windows.h>
+
+// Identifies the pool and queue of the worker the current thread belongs to (if any)
+static thread_local const reshade::thread_pool *t_current_pool = nullptr;
+static thread_local size_t t_current_worker_index = 0;
+
+reshade::thread_pool::thread_pool(size_t num_threads)
+{
+	if (num_threads == 0)
+		num_threads = std::max<size_t>(std::thread::hardware_concurrency(), 2u) - 1;
+
+	_workers.reserve(num_threads);
+	for (size_t i = 0; i < num_threads; ++i)
+		_workers.push_back(std::make_unique<worker>());
+
+	// Only start threads after all workers were created, since they may steal from each other immediately
+	for (size_t i = 0; i < num_threads; ++i)
+		_workers[i]->thread = std::thread(&thread_pool::worker_main, this, i);
+}
+reshade::thread_pool::~thread_pool()
+{
+	{	const std::lock_guard<std::mutex> lock(_mutex);
+		_exit = true;
+	}
+
+	_task_signal.notify_all();
+
+	for (const std::unique_ptr<worker> &worker : _workers)
+		worker->thread.join();
+}
+
+void reshade::thread_pool::submit(std::function<void()> &&task)
+{
+	// Add to the queue of the current worker when called from a task, otherwise distribute round-robin
+	const size_t worker_index = (t_current_pool == this) ?
+		t_current_worker_index : _next_worker++ % _workers.size();
+
+	_num_pending++;
+	_num_queued++;
+
+	{	const std::lock_guard<std::mutex> lock(_workers[worker_index]->mutex);
+		_workers[worker_index]->tasks.push_back(std::move(task));
+	}
+
+	// Lock is required so that the notification cannot happen in between a worker checking the queue count and starting to wait
+	{	const std::lock_guard<std::mutex> lock(_mutex);
+	}
+
+	_task_signal.notify_one();
+}
+
+void reshade::thread_pool::parallel_for(size_t count, const std::function<void(size_t)> &func)
+{
+	if (count == 0)
+		return;
+
+	struct batch
+	{
+		std::atomic<size_t> next_index = 0;
+		std::atomic<size_t> num_finished = 0;
+		std::mutex mutex;
+		std::condition_variable signal;
+	};
+
+	// Helper tasks may only start running after this call returned, so the state they access needs to be kept alive by them
+	const auto state = std::make_shared<batch>();
+	const auto process = [state, count, &func]() {
+		for (size_t index; (index = state->next_index++) < count;)
+		{
+			func(index);
+
+			if (++state->num_finished == count)
+			{
+				const std::lock_guard<std::mutex> lock(state->mutex);
+				state->signal.notify_all();
+			}
+		}
+	};
+
+	const size_t num_helpers = std::min(count, _workers.size() + 1) - 1;
+	for (size_t i = 0; i < num_helpers; ++i)
+		submit(process);
+
+	process();
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->signal.wait(lock, [&state, count]() { return state->num_finished == count; });
+}
+
+void reshade::thread_pool::wait_idle()
+{
+	assert(t_current_pool != this);
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	_idle_signal.wait(lock, [this]() { return _num_pending == 0; });
+}
+
+void reshade::thread_pool::set_low_priority(bool enable)
+{
+	for (const std::unique_ptr<worker> &worker : _workers)
+		SetThreadPriority(worker->thread.native_handle(), enable ? THREAD_PRIORITY_BELOW_NORMAL : THREAD_PRIORITY_NORMAL);
+}
+
+void reshade::thread_pool::set_max_active_threads(size_t count)
+{
+	if (_max_active.exchange(count) == count)
+		return;
+
+	// Wake up workers that were waiting for a slot in case the limit was raised
+	{	const std::lock_guard<std::mutex> lock(_mutex);
+	}
+
+	_task_signal.notify_all();
+}
+
+bool reshade::thread_pool::set_processor_affinity(bool avoid_calling_thread_core, bool prefer_efficiency_cores)
+{
+	// CPU sets were only added in Windows 10, so look up the functions dynamically
+	const HMODULE kernel32 = GetModuleHandleW(L"kernel32.dll");
+	const auto get_system_cpu_set_information = reinterpret_cast<BOOL(WINAPI *)(PSYSTEM_CPU_SET_INFORMATION, ULONG, PULONG, HANDLE, ULONG)>(GetProcAddress(kernel32, "GetSystemCpuSetInformation"));
+	const auto set_thread_selected_cpu_sets = reinterpret_cast<BOOL(WINAPI *)(HANDLE, const ULONG *, ULONG)>(GetProcAddress(kernel32, "SetThreadSelectedCpuSets"));
+	if (get_system_cpu_set_information == nullptr || set_thread_selected_cpu_sets == nullptr)
+		return false;
+
+	std::vector<ULONG> cpu_set_ids;
+
+	if (avoid_calling_thread_core || prefer_efficiency_cores)
+	{
+		ULONG size = 0;
+		get_system_cpu_set_information(nullptr, 0, &size, GetCurrentProcess(), 0);
+		std::vector<BYTE> data(size);
+		if (!get_system_cpu_set_information(reinterpret_cast<PSYSTEM_CPU_SET_INFORMATION>(data.data()), size, &size, GetCurrentProcess(), 0))
+			return false;
+
+		const auto for_each_cpu_set = [&data, size](auto &&func) {
+			for (ULONG offset = 0; offset < size;)
+			{
+				const auto &info = *reinterpret_cast<const SYSTEM_CPU_SET_INFORMATION *>(data.data() + offset);
+				if (info.Type == CpuSetInformation)
+					func(info.CpuSet);
+				offset += info.Size;
+			}
+		};
+
+		PROCESSOR_NUMBER ideal_processor = {};
+		const bool has_ideal_processor = avoid_calling_thread_core && GetThreadIdealProcessorEx(GetCurrentThread(), &ideal_processor);
+
+		// Find the core of the calling thread (which includes all its logical processors) and the range of efficiency classes
+		BYTE excluded_core_index = 0;
+		bool has_excluded_core = false;
+		BYTE min_efficiency_class = 0xFF;
+		BYTE max_efficiency_class = 0;
+		for_each_cpu_set([&](const auto &cpu_set) {
+			if (has_ideal_processor && cpu_set.Group == ideal_processor.Group && cpu_set.LogicalProcessorIndex == ideal_processor.Number)
+				excluded_core_index = cpu_set.CoreIndex, has_excluded_core = true;
+			min_efficiency_class = std::min(min_efficiency_class, cpu_set.EfficiencyClass);
+			max_efficiency_class = std::max(max_efficiency_class, cpu_set.EfficiencyClass);
+		});
+
+		// Processors with only one kind of core have nothing to prefer
+		prefer_efficiency_cores = prefer_efficiency_cores && min_efficiency_class != max_efficiency_class;
+
+		for_each_cpu_set([&](const auto &cpu_set) {
+			if (has_excluded_core && cpu_set.Group == ideal_processor.Group && cpu_set.CoreIndex == excluded_core_index)
+				return;
+			if (prefer_efficiency_cores && cpu_set.EfficiencyClass != min_efficiency_class)
+				return;
+			cpu_set_ids.push_back(cpu_set.Id);
+		});
+	}
+
+	// An empty list removes any previous restriction, which is also what happens if there is no processor left after excluding the above
+	for (const std::unique_ptr<worker> &worker : _workers)
+		set_thread_selected_cpu_sets(worker->thread.native_handle(), cpu_set_ids.empty() ? nullptr : cpu_set_ids.data(), static_cast<ULONG>(cpu_set_ids.size()));
+
+	return true;
+}
+
+bool reshade::thread_pool::try_acquire_active_slot()
+{
+	for (size_t num_active = _num_active.load(); true;)
+	{
+		if (const size_t max_active = _max_active.load(); max_active != 0 && num_active >= max_active)
+			return false;
+		if (_num_active.compare_exchange_weak(num_active, num_active + 1))
+			return true;
+	}
+}
+void reshade::thread_pool::release_active_slot()
+{
+	_num_active--;
+
+	// Only other workers waiting for a slot need to be notified
+	if (_max_active != 0)
+	{
+		{	const std::lock_guard<std::mutex> lock(_mutex);
+		}
+
+		_task_signal.notify_one();
+	}
+}
+
+bool reshade::thread_pool::try_pop(size_t worker_index, std::function<void()> &task)
+{
+	// Take the most recently added task from the own queue first
+	{	worker &self = *_workers[worker_index];
+		const std::lock_guard<std::mutex> lock(self.mutex);
+		if (!self.tasks.empty())
+		{
+			task = std::move(self.tasks.back());
+			self.tasks.pop_back();
+			return true;
+		}
+	}
+
+	// Otherwise steal the oldest task from one of the other workers
+	for (size_t i = 1; i < _workers.size(); ++i)
+	{
+		worker &victim = *_workers[(worker_index + i) % _workers.size()];
+		const std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.tasks.empty())
+		{
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void reshade::thread_pool::run_task(std::function<void()> &task)
+{
+	_num_queued--;
+
+	task();
+	task = nullptr; // Destroy any captured state before signaling completion
+
+	if (--_num_pending == 0)
+	{
+		const std::lock_guard<std::mutex> lock(_mutex);
+		_idle_signal.notify_all();
+	}
+}
+
+void reshade::thread_pool::worker_main(size_t worker_index)
+{
+	t_current_pool = this;
+	t_current_worker_index = worker_index;
+
+	std::function<void()> task;
+
+	while (true)
+	{
+		if (try_acquire_active_slot())
+		{
+			const bool has_task = try_pop(worker_index, task);
+			if (has_task)
+				run_task(task);
+
+			release_active_slot();
+
+			if (has_task)
+				continue;
+		}
+
+		// Wait for new tasks, or for another worker to finish when the number of active workers is limited
+		std::unique_lock<std::mutex> lock(_mutex);
+		_task_signal.wait(lock, [this]() { return _exit || (_num_queued != 0 && (_max_active == 0 || _num_active < _max_active)); });
+
+		if (_exit && _num_queued == 0)
+			break;
+	}
+}
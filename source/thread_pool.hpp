@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+namespace reshade
+{
+	/// <summary>
+	/// A persistent pool of worker threads with a task queue per worker.
+	/// Workers that run out of tasks steal from the queues of other workers, so that a single long task does not hold up the rest of the work.
+	/// </summary>
+	class thread_pool
+	{
+	public:
+		/// <summary>
+		/// Creates a pool with <paramref name="num_threads"/> worker threads (defaults to one less than the number of hardware threads, but at least one).
+		/// </summary>
+		explicit thread_pool(size_t num_threads = 0);
+		~thread_pool();
+
+		/// <summary>
+		/// Gets the number of worker threads in this pool.
+		/// </summary>
+		size_t num_threads() const { return _workers.size(); }
+
+		/// <summary>
+		/// Checks whether all submitted tasks have finished executing.
+		/// </summary>
+		bool is_idle() const { return _num_pending == 0; }
+
+		/// <summary>
+		/// Queues a task for execution on one of the worker threads.
+		/// Tasks submitted from within a worker thread are added to the queue of that worker, so follow-up work stays local unless stolen.
+		/// </summary>
+		void submit(std::function<void()> &&task);
+
+		/// <summary>
+		/// Calls <paramref name="func"/> for every index in the range [0, <paramref name="count"/>) distributed across the worker threads and blocks until all calls have returned.
+		/// The calling thread processes indices as well, so this is safe to use from within a task.
+		/// </summary>
+		void parallel_for(size_t count, const std::function<void(size_t)> &func);
+
+		/// <summary>
+		/// Blocks the calling thread until all submitted tasks have finished executing.
+		/// This must not be called from within a task, since it would wait for itself.
+		/// </summary>
+		void wait_idle();
+
+		/// <summary>
+		/// Runs all worker threads below normal priority, so that they yield to the threads of the application when there is contention.
+		/// </summary>
+		void set_low_priority(bool enable);
+		/// <summary>
+		/// Limits the number of worker threads that execute tasks at the same time, with the rest waiting until one of them finishes its task (zero removes the limit).
+		/// </summary>
+		void set_max_active_threads(size_t count);
+		/// <summary>
+		/// Restricts the worker threads to a subset of the logical processors of the system (requires Windows 10, with both options disabled every processor is allowed again).
+		/// </summary>
+		/// <param name="avoid_calling_thread_core">Set to <see langword="true"/> to exclude the core the calling thread would ideally run on (call this from the render thread of the application).</param>
+		/// <param name="prefer_efficiency_cores">Set to <see langword="true"/> to only use the cores with the lowest efficiency class on processors that have different kinds of cores.</param>
+		/// <returns><see langword="true"/> if the affinity was changed, <see langword="false"/> if this is not supported.</returns>
+		bool set_processor_affinity(bool avoid_calling_thread_core, bool prefer_efficiency_cores);
+
+	private:
+		struct worker
+		{
+			std::thread thread;
+			std::mutex mutex;
+			std::deque<std::function<void()>> tasks;
+		};
+
+		bool try_acquire_active_slot();
+		void release_active_slot();
+		bool try_pop(size_t worker_index, std::function<void()> &task);
+		void run_task(std::function<void()> &task);
+		void worker_main(size_t worker_index);
+
+		std::vector<std::unique_ptr<worker>> _workers;
+		std::mutex _mutex;
+		std::condition_variable _task_signal;
+		std::condition_variable _idle_signal;
+		std::atomic<size_t> _num_queued = 0;
+		std::atomic<size_t> _num_pending = 0;
+		std::atomic<size_t> _next_worker = 0;
+		std::atomic<size_t> _num_active = 0;
+		std::atomic<size_t> _max_active = 0;
+		bool _exit = false;
+	};
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include "reshade_api.hpp"
+#include <cassert>
+
+namespace reshade
+{
+	/// <summary>
+	/// A persistently mapped buffer in CPU-visible memory that is sub-allocated linearly and recycled in the same frames an immediate command list cycles through.
+	/// Allocations made while recording frame N become available again once the immediate command list waited on the fence of frame N before reusing it.
+	/// </summary>
+	template <uint32_t NUM_FRAMES>
+	class upload_ring_buffer
+	{
+	public:
+		static constexpr uint64_t DEFAULT_SIZE = 8 * 1024 * 1024;
+
+		bool create(api::device *device, uint64_t size = DEFAULT_SIZE)
+		{
+			assert(_buffer.handle == 0 && (size & (size - 1)) == 0);
+
+			if (!device->create_resource(
+				api::resource_desc(size, api::memory_heap::cpu_to_gpu, api::resource_usage::copy_source | api::resource_usage::index_buffer | api::resource_usage::vertex_buffer | api::resource_usage::constant_buffer),
+				nullptr, api::resource_usage::cpu_access, &_buffer))
+				return false;
+
+			device->set_resource_name(_buffer, "ReShade upload ring buffer");
+
+			// Buffer stays mapped for its entire lifetime, which is fine for upload heaps in D3D12 and host visible memory in Vulkan
+			if (!device->map_resource(_buffer, 0, api::map_access::write_only, reinterpret_cast<void **>(&_mapped_data)))
+			{
+				device->destroy_resource(_buffer);
+				_buffer = {};
+				return false;
+			}
+
+			_size = size;
+			return true;
+		}
+		void destroy(api::device *device)
+		{
+			if (_buffer.handle == 0)
+				return;
+
+			device->unmap_resource(_buffer, 0);
+			device->destroy_resource(_buffer);
+
+			_buffer = {};
+			_mapped_data = nullptr;
+			_size = _head = _tail = 0;
+			for (uint32_t i = 0; i < NUM_FRAMES; ++i)
+				_frame_end[i] = 0;
+		}
+
+		bool is_valid() const { return _buffer.handle != 0; }
+
+		bool allocate(uint64_t size, uint64_t alignment, void **out_data, api::resource *out_buffer, uint64_t *out_offset)
+		{
+			assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+			if (size == 0 || size > _size || alignment > _size)
+				return false;
+
+			// Positions grow monotonically and are only wrapped to the buffer size when computing the actual offset, so that a full ring can be distinguished from an empty one
+			uint64_t position = (_head + alignment - 1) & ~(alignment - 1);
+			// Allocations must not straddle the end of the buffer, so skip to the beginning in that case
+			if ((position % _size) + size > _size)
+				position = (position / _size + 1) * _size;
+
+			if (position + size - _tail > _size)
+				return false; // Ring is full until the GPU finished with older frames
+
+			_head = position + size;
+
+			*out_data = _mapped_data + (position % _size);
+			*out_buffer = _buffer;
+			*out_offset = position % _size;
+			return true;
+		}
+
+		/// <summary>
+		/// Marks the end of all allocations that are referenced by the commands submitted for the specified frame.
+		/// </summary>
+		void submit(uint32_t frame_index)
+		{
+			_frame_end[frame_index] = _head;
+		}
+		/// <summary>
+		/// Releases all allocations that were made up until the specified frame was submitted, after the GPU finished executing it.
+		/// </summary>
+		void reclaim(uint32_t frame_index)
+		{
+			if (_frame_end[frame_index] > _tail)
+				_tail = _frame_end[frame_index];
+		}
+
+	private:
+		api::resource _buffer = {};
+		uint8_t *_mapped_data = nullptr;
+		uint64_t _size = 0;
+		uint64_t _head = 0;
+		uint64_t _tail = 0;
+		uint64_t _frame_end[NUM_FRAMES] = {};
+	};
+}
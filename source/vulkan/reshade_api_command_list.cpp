@@ -48,6 +48,74 @@ void reshade::vulkan::command_list_impl::barrier(uint32_t count, const api::reso
 
 	_has_commands = true;
 
+	if (_defer_barriers)
+		_pending_barriers.add(count, resources, old_states, new_states);
+	else
+		submit_barriers(count, resources, old_states, new_states);
+}
+void reshade::vulkan::command_list_impl::flush_barriers()
+{
+	if (_pending_barriers.empty())
+		return;
+
+	submit_barriers(_pending_barriers.size(), _pending_barriers.resources.data(), _pending_barriers.old_states.data(), _pending_barriers.new_states.data());
+	_pending_barriers.clear();
+}
+void reshade::vulkan::command_list_impl::submit_barriers(uint32_t count, const api::resource *resources, const api::resource_usage *old_states, const api::resource_usage *new_states)
+{
+	if (_device_impl->_synchronization2_ext)
+	{
+		// Synchronization 2 specifies stages per barrier, so that a transition of one resource does not stall unrelated work waiting on the combined stages of all others
+		std::vector<VkImageMemoryBarrier2KHR> image_barriers;
+		image_barriers.reserve(count);
+		std::vector<VkBufferMemoryBarrier2KHR> buffer_barriers;
+		buffer_barriers.reserve(count);
+
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const resource_data data = _device_impl->lookup_resource(resources[i]);
+
+			if (data.is_image())
+			{
+				VkImageMemoryBarrier2KHR &transition = image_barriers.emplace_back();
+				transition = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR };
+				transition.srcStageMask = convert_usage_to_pipeline_stage2(old_states[i]);
+				transition.srcAccessMask = convert_usage_to_access2(old_states[i]);
+				transition.dstStageMask = convert_usage_to_pipeline_stage2(new_states[i]);
+				transition.dstAccessMask = convert_usage_to_access2(new_states[i]);
+				transition.oldLayout = convert_usage_to_image_layout(old_states[i]);
+				transition.newLayout = convert_usage_to_image_layout(new_states[i]);
+				transition.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				transition.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				transition.image = data.image;
+				transition.subresourceRange = { aspect_flags_from_format(data.image_create_info.format), 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+			}
+			else
+			{
+				VkBufferMemoryBarrier2KHR &transition = buffer_barriers.emplace_back();
+				transition = { VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2_KHR };
+				transition.srcStageMask = convert_usage_to_pipeline_stage2(old_states[i]);
+				transition.srcAccessMask = convert_usage_to_access2(old_states[i]);
+				transition.dstStageMask = convert_usage_to_pipeline_stage2(new_states[i]);
+				transition.dstAccessMask = convert_usage_to_access2(new_states[i]);
+				transition.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				transition.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				transition.buffer = data.buffer;
+				transition.offset = 0;
+				transition.size = VK_WHOLE_SIZE;
+			}
+		}
+
+		VkDependencyInfoKHR dependency_info { VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR };
+		dependency_info.bufferMemoryBarrierCount = static_cast<uint32_t>(buffer_barriers.size());
+		dependency_info.pBufferMemoryBarriers = buffer_barriers.data();
+		dependency_info.imageMemoryBarrierCount = static_cast<uint32_t>(image_barriers.size());
+		dependency_info.pImageMemoryBarriers = image_barriers.data();
+
+		vk.CmdPipelineBarrier2KHR(_orig, &dependency_info);
+		return;
+	}
+
 	std::vector<VkImageMemoryBarrier> image_barriers;
 	image_barriers.reserve(count);
 	std::vector<VkBufferMemoryBarrier> buffer_barriers;
@@ -97,6 +165,8 @@ void reshade::vulkan::command_list_impl::barrier(uint32_t count, const api::reso
 
 void reshade::vulkan::command_list_impl::begin_render_pass(api::render_pass pass)
 {
+	flush_barriers();
+
 	_has_commands = true;
 
 	assert(pass.handle != 0);
@@ -111,12 +181,14 @@ void reshade::vulkan::command_list_impl::begin_render_pass(api::render_pass pass
 	vk.CmdBeginRenderPass(_orig, &begin_info, VK_SUBPASS_CONTENTS_INLINE);
 
 	_current_fbo = pass_impl->fbo;
+	_current_fbo_data = &pass_impl->fbo_data;
 	_current_render_area = pass_impl->render_area;
 }
 void reshade::vulkan::command_list_impl::finish_render_pass()
 {
 	vk.CmdEndRenderPass(_orig);
 
+	_current_fbo_data = nullptr;
 #ifndef NDEBUG
 	_current_fbo = VK_NULL_HANDLE;
 #endif
@@ -156,6 +228,15 @@ void reshade::vulkan::command_list_impl::bind_pipeline_states(uint32_t count, co
 		case api::dynamic_state::stencil_reference_value:
 			vk.CmdSetStencilReference(_orig, VK_STENCIL_FACE_FRONT_AND_BACK, values[i]);
 			break;
+		case api::dynamic_state::shading_rate:
+		{
+			const VkExtent2D fragment_size = { 1u << ((values[i] >> 2) & 0x3), 1u << (values[i] & 0x3) };
+			// Keep the pipeline rate, ignoring any per-primitive or attachment rates
+			const VkFragmentShadingRateCombinerOpKHR combiner_ops[2] = { VK_FRAGMENT_SHADING_RATE_COMBINER_OP_KEEP_KHR, VK_FRAGMENT_SHADING_RATE_COMBINER_OP_KEEP_KHR };
+
+			vk.CmdSetFragmentShadingRateKHR(_orig, &fragment_size, combiner_ops);
+			break;
+		}
 		default:
 			assert(false);
 			break;
@@ -213,13 +294,34 @@ void reshade::vulkan::command_list_impl::push_descriptors(api::shader_stage stag
 {
 	assert(count != 0);
 
+	const VkPipelineBindPoint bind_point = stages == api::shader_stage::compute ? VK_PIPELINE_BIND_POINT_COMPUTE : VK_PIPELINE_BIND_POINT_GRAPHICS;
+
 	VkWriteDescriptorSet write { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
 	write.dstBinding = first;
 	write.descriptorCount = count;
 	write.descriptorType = static_cast<VkDescriptorType>(type);
 
-	std::vector<VkDescriptorImageInfo> image_info(count);
-	std::vector<VkDescriptorBufferInfo> buffer_info(count);
+	// Translate into a stack buffer for the common case of only a few descriptors, to avoid heap allocations on every call
+	VkDescriptorImageInfo image_info_stack[16];
+	VkDescriptorBufferInfo buffer_info_stack[16];
+	std::vector<VkDescriptorImageInfo> image_info_heap;
+	std::vector<VkDescriptorBufferInfo> buffer_info_heap;
+
+	VkDescriptorImageInfo *image_info = image_info_stack;
+	VkDescriptorBufferInfo *buffer_info = buffer_info_stack;
+	if (count > std::size(image_info_stack))
+	{
+		if (type == api::descriptor_type::constant_buffer)
+		{
+			buffer_info_heap.resize(count);
+			buffer_info = buffer_info_heap.data();
+		}
+		else
+		{
+			image_info_heap.resize(count);
+			image_info = image_info_heap.data();
+		}
+	}
 
 	switch (type)
 	{
@@ -228,8 +330,10 @@ void reshade::vulkan::command_list_impl::push_descriptors(api::shader_stage stag
 		{
 			const auto &descriptor = static_cast<const api::sampler *>(descriptors)[i];
 			image_info[i].sampler = (VkSampler)descriptor.handle;
+			image_info[i].imageView = VK_NULL_HANDLE;
+			image_info[i].imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 		}
-		write.pImageInfo = image_info.data();
+		write.pImageInfo = image_info;
 		break;
 	case api::descriptor_type::sampler_with_resource_view:
 		for (uint32_t i = 0; i < count; ++i)
@@ -239,25 +343,27 @@ void reshade::vulkan::command_list_impl::push_descriptors(api::shader_stage stag
 			image_info[i].imageView = (VkImageView)descriptor.view.handle;
 			image_info[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 		}
-		write.pImageInfo = image_info.data();
+		write.pImageInfo = image_info;
 		break;
 	case api::descriptor_type::shader_resource_view:
 		for (uint32_t i = 0; i < count; ++i)
 		{
 			const auto &descriptor = static_cast<const api::resource_view *>(descriptors)[i];
+			image_info[i].sampler = VK_NULL_HANDLE;
 			image_info[i].imageView = (VkImageView)descriptor.handle;
 			image_info[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 		}
-		write.pImageInfo = image_info.data();
+		write.pImageInfo = image_info;
 		break;
 	case api::descriptor_type::unordered_access_view:
 		for (uint32_t i = 0; i < count; ++i)
 		{
 			const auto &descriptor = static_cast<const api::resource_view *>(descriptors)[i];
+			image_info[i].sampler = VK_NULL_HANDLE;
 			image_info[i].imageView = (VkImageView)descriptor.handle;
 			image_info[i].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
 		}
-		write.pImageInfo = image_info.data();
+		write.pImageInfo = image_info;
 		break;
 	case api::descriptor_type::constant_buffer:
 		for (uint32_t i = 0; i < count; ++i)
@@ -267,16 +373,24 @@ void reshade::vulkan::command_list_impl::push_descriptors(api::shader_stage stag
 			buffer_info[i].offset = 0;
 			buffer_info[i].range = VK_WHOLE_SIZE;
 		}
-		write.pBufferInfo = buffer_info.data();
+		write.pBufferInfo = buffer_info;
 		break;
 	}
 
 	if (vk.CmdPushDescriptorSetKHR != nullptr)
 	{
-		vk.CmdPushDescriptorSetKHR(_orig,
-			stages == api::shader_stage::compute ? VK_PIPELINE_BIND_POINT_COMPUTE : VK_PIPELINE_BIND_POINT_GRAPHICS,
-			(VkPipelineLayout)layout.handle, layout_index,
-			1, &write);
+		// Prefer a descriptor update template, which lets the driver skip parsing the write structure
+		if (const VkDescriptorUpdateTemplate update_template = _device_impl->get_push_descriptor_template(
+				bind_point, (VkPipelineLayout)layout.handle, layout_index, write.descriptorType, first, count);
+			update_template != VK_NULL_HANDLE)
+		{
+			vk.CmdPushDescriptorSetWithTemplateKHR(_orig, update_template, (VkPipelineLayout)layout.handle, layout_index,
+				type == api::descriptor_type::constant_buffer ? static_cast<const void *>(buffer_info) : static_cast<const void *>(image_info));
+		}
+		else
+		{
+			vk.CmdPushDescriptorSetKHR(_orig, bind_point, (VkPipelineLayout)layout.handle, layout_index, 1, &write);
+		}
 	}
 	else
 	{
@@ -285,18 +399,15 @@ void reshade::vulkan::command_list_impl::push_descriptors(api::shader_stage stag
 		VkDescriptorSetAllocateInfo alloc_info { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
 		alloc_info.descriptorPool = _device_impl->_transient_descriptor_pool[_device_impl->_transient_index % 4];
 		alloc_info.descriptorSetCount = 1;
-		alloc_info.pSetLayouts = &_device_impl->_pipeline_layout_list[(VkPipelineLayout)layout.handle][layout_index];
+		const VkDescriptorSetLayout set_layout = _device_impl->_pipeline_layout_list.read((VkPipelineLayout)layout.handle, [layout_index](const std::vector<VkDescriptorSetLayout> &set_layouts) { return set_layouts[layout_index]; });
+		alloc_info.pSetLayouts = &set_layout;
 
 		if (vk.AllocateDescriptorSets(_device_impl->_orig, &alloc_info, &write.dstSet) != VK_SUCCESS)
 			return;
 
 		vk.UpdateDescriptorSets(_device_impl->_orig, 1, &write, 0, nullptr);
 
-		vk.CmdBindDescriptorSets(_orig,
-			stages == api::shader_stage::compute ? VK_PIPELINE_BIND_POINT_COMPUTE : VK_PIPELINE_BIND_POINT_GRAPHICS,
-			(VkPipelineLayout)layout.handle,
-			layout_index, 1, &write.dstSet,
-			0, nullptr);
+		vk.CmdBindDescriptorSets(_orig, bind_point, (VkPipelineLayout)layout.handle, layout_index, 1, &write.dstSet, 0, nullptr);
 	}
 }
 void reshade::vulkan::command_list_impl::bind_descriptor_sets(api::shader_stage stages, api::pipeline_layout layout, uint32_t first, uint32_t count, const api::descriptor_set *sets)
@@ -319,6 +430,8 @@ void reshade::vulkan::command_list_impl::bind_vertex_buffers(uint32_t first, uin
 
 void reshade::vulkan::command_list_impl::draw(uint32_t vertices, uint32_t instances, uint32_t first_vertex, uint32_t first_instance)
 {
+	flush_barriers();
+
 	_has_commands = true;
 
 	assert(_current_fbo != VK_NULL_HANDLE);
@@ -327,6 +440,8 @@ void reshade::vulkan::command_list_impl::draw(uint32_t vertices, uint32_t instan
 }
 void reshade::vulkan::command_list_impl::draw_indexed(uint32_t indices, uint32_t instances, uint32_t first_index, int32_t vertex_offset, uint32_t first_instance)
 {
+	flush_barriers();
+
 	_has_commands = true;
 
 	assert(_current_fbo != VK_NULL_HANDLE);
@@ -335,12 +450,16 @@ void reshade::vulkan::command_list_impl::draw_indexed(uint32_t indices, uint32_t
 }
 void reshade::vulkan::command_list_impl::dispatch(uint32_t num_groups_x, uint32_t num_groups_y, uint32_t num_groups_z)
 {
+	flush_barriers();
+
 	_has_commands = true;
 
 	vk.CmdDispatch(_orig, num_groups_x, num_groups_y, num_groups_z);
 }
 void reshade::vulkan::command_list_impl::draw_or_dispatch_indirect(api::indirect_command type, api::resource buffer, uint64_t offset, uint32_t draw_count, uint32_t stride)
 {
+	flush_barriers();
+
 	_has_commands = true;
 
 	switch (type)
@@ -360,6 +479,8 @@ void reshade::vulkan::command_list_impl::draw_or_dispatch_indirect(api::indirect
 
 void reshade::vulkan::command_list_impl::copy_resource(api::resource src, api::resource dst)
 {
+	flush_barriers();
+
 	const api::resource_desc desc = _device_impl->get_resource_desc(src);
 
 	if (desc.type == api::resource_type::buffer)
@@ -381,6 +502,8 @@ void reshade::vulkan::command_list_impl::copy_resource(api::resource src, api::r
 }
 void reshade::vulkan::command_list_impl::copy_buffer_region(api::resource src, uint64_t src_offset, api::resource dst, uint64_t dst_offset, uint64_t size)
 {
+	flush_barriers();
+
 	_has_commands = true;
 
 	if (size == std::numeric_limits<uint64_t>::max())
@@ -398,6 +521,8 @@ void reshade::vulkan::command_list_impl::copy_buffer_region(api::resource src, u
 }
 void reshade::vulkan::command_list_impl::copy_buffer_to_texture(api::resource src, uint64_t src_offset, uint32_t row_length, uint32_t slice_height, api::resource dst, uint32_t dst_subresource, const int32_t dst_box[6])
 {
+	flush_barriers();
+
 	_has_commands = true;
 
 	const resource_data dst_data = _device_impl->lookup_resource(dst);
@@ -428,6 +553,8 @@ void reshade::vulkan::command_list_impl::copy_buffer_to_texture(api::resource sr
 }
 void reshade::vulkan::command_list_impl::copy_texture_region(api::resource src, uint32_t src_subresource, const int32_t src_box[6], api::resource dst, uint32_t dst_subresource, const int32_t dst_box[6], api::filter_type filter)
 {
+	flush_barriers();
+
 	_has_commands = true;
 
 	const resource_data src_data = _device_impl->lookup_resource(src);
@@ -512,6 +639,8 @@ void reshade::vulkan::command_list_impl::copy_texture_region(api::resource src,
 }
 void reshade::vulkan::command_list_impl::copy_texture_to_buffer(api::resource src, uint32_t src_subresource, const int32_t src_box[6], api::resource dst, uint64_t dst_offset, uint32_t row_length, uint32_t slice_height)
 {
+	flush_barriers();
+
 	_has_commands = true;
 
 	const resource_data src_data = _device_impl->lookup_resource(src);
@@ -542,6 +671,8 @@ void reshade::vulkan::command_list_impl::copy_texture_to_buffer(api::resource sr
 }
 void reshade::vulkan::command_list_impl::resolve_texture_region(api::resource src, uint32_t src_subresource, const int32_t src_box[6], api::resource dst, uint32_t dst_subresource, const int32_t dst_offset[3], api::format)
 {
+	flush_barriers();
+
 	_has_commands = true;
 
 	const resource_data src_data = _device_impl->lookup_resource(src);
@@ -583,6 +714,8 @@ void reshade::vulkan::command_list_impl::resolve_texture_region(api::resource sr
 
 void reshade::vulkan::command_list_impl::clear_attachments(api::attachment_type clear_flags, const float color[4], float depth, uint8_t stencil, uint32_t num_rects, const int32_t *rects)
 {
+	flush_barriers();
+
 	_has_commands = true;
 
 	assert(_current_fbo != VK_NULL_HANDLE);
@@ -593,21 +726,24 @@ void reshade::vulkan::command_list_impl::clear_attachments(api::attachment_type
 
 	if (aspect_mask & (VK_IMAGE_ASPECT_COLOR_BIT))
 	{
-		std::unique_lock<std::mutex> lock(_device_impl->_mutex);
-
-		const auto &framebuffer_data = _device_impl->_framebuffer_list.at(_current_fbo);
+		const auto add_color_attachments = [&](const framebuffer_data &framebuffer_data) {
+			uint32_t index = 0;
+			for (VkImageAspectFlags format_flags : framebuffer_data.attachment_types)
+			{
+				if (format_flags != VK_IMAGE_ASPECT_COLOR_BIT)
+					continue;
 
-		uint32_t index = 0;
-		for (VkImageAspectFlags format_flags : framebuffer_data.attachment_types)
-		{
-			if (format_flags != VK_IMAGE_ASPECT_COLOR_BIT)
-				continue;
+				clear_attachments[num_clear_attachments].aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				clear_attachments[num_clear_attachments].colorAttachment = index++;
+				std::memcpy(clear_attachments[num_clear_attachments].clearValue.color.float32, color, 4 * sizeof(float));
+				++num_clear_attachments;
+			}
+		};
 
-			clear_attachments[num_clear_attachments].aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			clear_attachments[num_clear_attachments].colorAttachment = index++;
-			std::memcpy(clear_attachments[num_clear_attachments].clearValue.color.float32, color, 4 * sizeof(float));
-			++num_clear_attachments;
-		}
+		if (_current_fbo_data != nullptr)
+			add_color_attachments(*_current_fbo_data);
+		else
+			_device_impl->_framebuffer_list.read(_current_fbo, add_color_attachments);
 	}
 
 	if (aspect_mask & (VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT))
@@ -648,6 +784,8 @@ void reshade::vulkan::command_list_impl::clear_attachments(api::attachment_type
 }
 void reshade::vulkan::command_list_impl::clear_depth_stencil_view(api::resource_view dsv, api::attachment_type clear_flags, float depth, uint8_t stencil, uint32_t num_rects, const int32_t *)
 {
+	flush_barriers();
+
 	_has_commands = true;
 
 	assert(num_rects == 0);
@@ -672,6 +810,8 @@ void reshade::vulkan::command_list_impl::clear_depth_stencil_view(api::resource_
 }
 void reshade::vulkan::command_list_impl::clear_render_target_view(api::resource_view rtv, const float color[4], uint32_t num_rects, const int32_t *)
 {
+	flush_barriers();
+
 	_has_commands = true;
 
 	assert(num_rects == 0);
@@ -698,6 +838,8 @@ void reshade::vulkan::command_list_impl::clear_render_target_view(api::resource_
 }
 void reshade::vulkan::command_list_impl::clear_unordered_access_view_uint(api::resource_view uav, const uint32_t values[4], uint32_t num_rects, const int32_t *)
 {
+	flush_barriers();
+
 	_has_commands = true;
 
 	assert(num_rects == 0);
@@ -713,6 +855,8 @@ void reshade::vulkan::command_list_impl::clear_unordered_access_view_uint(api::r
 }
 void reshade::vulkan::command_list_impl::clear_unordered_access_view_float(api::resource_view uav, const float values[4], uint32_t num_rects, const int32_t *)
 {
+	flush_barriers();
+
 	_has_commands = true;
 
 	assert(num_rects == 0);
@@ -729,6 +873,8 @@ void reshade::vulkan::command_list_impl::clear_unordered_access_view_float(api::
 
 void reshade::vulkan::command_list_impl::generate_mipmaps(api::resource_view srv)
 {
+	flush_barriers();
+
 	assert(srv.handle != 0);
 	const resource_view_data view_data = _device_impl->lookup_resource_view(srv);
 	assert(view_data.is_image_view());
@@ -810,6 +956,8 @@ void reshade::vulkan::command_list_impl::finish_query(api::query_pool pool, api:
 }
 void reshade::vulkan::command_list_impl::copy_query_pool_results(api::query_pool pool, api::query_type, uint32_t first, uint32_t count, api::resource dst, uint64_t dst_offset, uint32_t stride)
 {
+	flush_barriers();
+
 	_has_commands = true;
 
 	assert(pool.handle != 0);
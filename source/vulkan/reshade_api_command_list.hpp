@@ -5,6 +5,8 @@
 
 #pragma once
 
+#include "barrier_batch.hpp"
+
 namespace reshade::vulkan
 {
 	class device_impl;
@@ -21,6 +23,11 @@ namespace reshade::vulkan
 
 		void barrier(uint32_t count, const api::resource *resources, const api::resource_usage *old_states, const api::resource_usage *new_states) final;
 
+		/// <summary>
+		/// Submits all barriers that were deferred since the last command that depended on them (see <see cref="_defer_barriers"/>).
+		/// </summary>
+		void flush_barriers();
+
 		void begin_render_pass(api::render_pass pass) final;
 		void finish_render_pass() final;
 
@@ -66,9 +73,20 @@ namespace reshade::vulkan
 
 		VkRect2D _current_render_area = {};
 		VkFramebuffer _current_fbo = VK_NULL_HANDLE;
+		// Attachments of the current render pass if it was created through 'device_impl::create_render_pass', otherwise they are looked up by the framebuffer handle
+		const framebuffer_data *_current_fbo_data = nullptr;
+
+		// Collect barriers until the next command that depends on them instead of submitting them right away, so that they are batched and redundant transitions cancel out
+		// Only enabled on command lists ReShade records itself, since commands the application records directly would not flush them
+		bool _defer_barriers = false;
 
 	protected:
 		device_impl *const _device_impl;
 		bool _has_commands = false;
+
+	private:
+		void submit_barriers(uint32_t count, const api::resource *resources, const api::resource_usage *old_states, const api::resource_usage *new_states);
+
+		barrier_batch _pending_barriers;
 	};
 }
@@ -6,12 +6,15 @@
 #include "dll_log.hpp"
 #include "reshade_api_device.hpp"
 #include "reshade_api_command_list_immediate.hpp"
+#include <algorithm>
 
 #define vk _device_impl->_dispatch_table
 
 reshade::vulkan::command_list_immediate_impl::command_list_immediate_impl(device_impl *device, uint32_t queue_family_index) :
 	command_list_impl(device, VK_NULL_HANDLE)
 {
+	_defer_barriers = true;
+
 	{	VkCommandPoolCreateInfo create_info { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
 		create_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 		create_info.queueFamilyIndex = queue_family_index;
@@ -20,42 +23,23 @@ reshade::vulkan::command_list_immediate_impl::command_list_immediate_impl(device
 			return;
 	}
 
-	{   VkCommandBufferAllocateInfo alloc_info { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
-		alloc_info.commandPool = _cmd_pool;
-		alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		alloc_info.commandBufferCount = NUM_COMMAND_FRAMES;
-
-		if (vk.AllocateCommandBuffers(_device_impl->_orig, &alloc_info, _cmd_buffers) != VK_SUCCESS)
-			return;
-	}
-
-	for (uint32_t i = 0; i < NUM_COMMAND_FRAMES; ++i)
+	if (_device_impl->_timeline_semaphore_ext)
 	{
-		// The validation layers expect the loader to have set the dispatch pointer, but this does not happen when calling down the layer chain from here, so fix it
-		*reinterpret_cast<void **>(_cmd_buffers[i]) = *reinterpret_cast<void **>(device->_orig);
-
-		if (vk.SetDebugUtilsObjectNameEXT != nullptr)
-		{
-			std::string debug_name = "ReShade immediate command list";
-			debug_name += " (" + std::to_string(i) + ')';
+		VkSemaphoreTypeCreateInfo type_create_info { VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO };
+		type_create_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		type_create_info.initialValue = _timeline_value;
 
-			VkDebugUtilsObjectNameInfoEXT name_info { VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT };
-			name_info.objectType = VK_OBJECT_TYPE_COMMAND_BUFFER;
-			name_info.objectHandle = (uint64_t)_cmd_buffers[i];
-			name_info.pObjectName = debug_name.c_str();
+		VkSemaphoreCreateInfo create_info { VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+		create_info.pNext = &type_create_info;
 
-			vk.SetDebugUtilsObjectNameEXT(_device_impl->_orig, &name_info);
-		}
-
-		VkFenceCreateInfo create_info { VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
-		create_info.flags = VK_FENCE_CREATE_SIGNALED_BIT; // Create signaled so waiting on it when no commands where submitted succeeds
-
-		if (vk.CreateFence(_device_impl->_orig, &create_info, nullptr, &_cmd_fences[i]) != VK_SUCCESS)
-			return;
-
-		VkSemaphoreCreateInfo sem_create_info { VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+		// Fall back to fences if creation fails
+		if (vk.CreateSemaphore(_device_impl->_orig, &create_info, nullptr, &_timeline_semaphore) != VK_SUCCESS)
+			_timeline_semaphore = VK_NULL_HANDLE;
+	}
 
-		if (vk.CreateSemaphore(_device_impl->_orig, &sem_create_info, nullptr, &_cmd_semaphores[i]) != VK_SUCCESS)
+	for (uint32_t i = 0; i < MIN_COMMAND_FRAMES; ++i)
+	{
+		if (!create_command_frame(i))
 			return;
 	}
 
@@ -71,22 +55,81 @@ reshade::vulkan::command_list_immediate_impl::command_list_immediate_impl(device
 }
 reshade::vulkan::command_list_immediate_impl::~command_list_immediate_impl()
 {
+	vk.DestroySemaphore(_device_impl->_orig, _timeline_semaphore, nullptr);
 	for (VkFence fence : _cmd_fences)
 		vk.DestroyFence(_device_impl->_orig, fence, nullptr);
 	for (VkSemaphore semaphore : _cmd_semaphores)
 		vk.DestroySemaphore(_device_impl->_orig, semaphore, nullptr);
 
-	vk.FreeCommandBuffers(_device_impl->_orig, _cmd_pool, NUM_COMMAND_FRAMES, _cmd_buffers);
+	// Release pending objects before destroying the command pool, since that includes secondary command buffers allocated from it
+	for (uint32_t i = 0; i < MAX_COMMAND_FRAMES; ++i)
+		release_pending(i);
+
+	if (_num_frames != 0)
+		vk.FreeCommandBuffers(_device_impl->_orig, _cmd_pool, _num_frames, _cmd_buffers);
 	vk.DestroyCommandPool(_device_impl->_orig, _cmd_pool, nullptr);
 
+	_upload_ring.destroy(_device_impl);
+
 	// Signal to 'command_list_impl' destructor that this is an immediate command list
 	_has_commands = false;
 }
 
+bool reshade::vulkan::command_list_immediate_impl::create_command_frame(uint32_t index)
+{
+	assert(index == _num_frames && index < MAX_COMMAND_FRAMES);
+
+	{   VkCommandBufferAllocateInfo alloc_info { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+		alloc_info.commandPool = _cmd_pool;
+		alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		alloc_info.commandBufferCount = 1;
+
+		if (vk.AllocateCommandBuffers(_device_impl->_orig, &alloc_info, &_cmd_buffers[index]) != VK_SUCCESS)
+			return false;
+	}
+
+	// The validation layers expect the loader to have set the dispatch pointer, but this does not happen when calling down the layer chain from here, so fix it
+	*reinterpret_cast<void **>(_cmd_buffers[index]) = *reinterpret_cast<void **>(_device_impl->_orig);
+
+	if (vk.SetDebugUtilsObjectNameEXT != nullptr)
+	{
+		std::string debug_name = "ReShade immediate command list";
+		debug_name += " (" + std::to_string(index) + ')';
+
+		VkDebugUtilsObjectNameInfoEXT name_info { VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT };
+		name_info.objectType = VK_OBJECT_TYPE_COMMAND_BUFFER;
+		name_info.objectHandle = (uint64_t)_cmd_buffers[index];
+		name_info.pObjectName = debug_name.c_str();
+
+		vk.SetDebugUtilsObjectNameEXT(_device_impl->_orig, &name_info);
+	}
+
+	// Count the frame right away, so that the destructor frees the command buffer even if creating the synchronization objects fails
+	_num_frames++;
+
+	if (_timeline_semaphore == VK_NULL_HANDLE)
+	{
+		VkFenceCreateInfo create_info { VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+		create_info.flags = VK_FENCE_CREATE_SIGNALED_BIT; // Create signaled so waiting on it when no commands where submitted succeeds
+
+		if (vk.CreateFence(_device_impl->_orig, &create_info, nullptr, &_cmd_fences[index]) != VK_SUCCESS)
+			return false;
+	}
+
+	VkSemaphoreCreateInfo sem_create_info { VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+
+	if (vk.CreateSemaphore(_device_impl->_orig, &sem_create_info, nullptr, &_cmd_semaphores[index]) != VK_SUCCESS)
+		return false;
+
+	return true;
+}
+
 bool reshade::vulkan::command_list_immediate_impl::flush(VkQueue queue, std::vector<VkSemaphore> &wait_semaphores)
 {
 	if (!_has_commands)
 		return true;
+
+	flush_barriers();
 	_has_commands = false;
 
 	assert(_orig != VK_NULL_HANDLE);
@@ -108,22 +151,65 @@ bool reshade::vulkan::command_list_immediate_impl::flush(VkQueue queue, std::vec
 	submit_info.commandBufferCount = 1;
 	submit_info.pCommandBuffers = &_orig;
 
-	std::vector<VkPipelineStageFlags> wait_stages(wait_semaphores.size(), VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+	uint32_t num_signal_semaphores = 0;
+	VkSemaphore signal_semaphores[2];
+	uint64_t signal_semaphore_values[2] = {};
+
+	// Presents rarely wait on more than a few semaphores, so avoid allocating the stage masks for them on the heap
+	VkPipelineStageFlags wait_stages_local[8];
+	std::vector<VkPipelineStageFlags> wait_stages_heap;
+	VkPipelineStageFlags *wait_stages = wait_stages_local;
+	if (wait_semaphores.size() > std::size(wait_stages_local))
+	{
+		wait_stages_heap.resize(wait_semaphores.size());
+		wait_stages = wait_stages_heap.data();
+	}
+	std::fill_n(wait_stages, wait_semaphores.size(), VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+
 	if (!wait_semaphores.empty())
 	{
 		submit_info.waitSemaphoreCount = static_cast<uint32_t>(wait_semaphores.size());
 		submit_info.pWaitSemaphores = wait_semaphores.data();
-		submit_info.pWaitDstStageMask = wait_stages.data();
-		submit_info.signalSemaphoreCount = 1;
-		submit_info.pSignalSemaphores = &_cmd_semaphores[_cmd_index];
+		submit_info.pWaitDstStageMask = wait_stages;
+
+		// Presentation cannot wait on timeline semaphores, so still need a binary semaphore to pass on
+		signal_semaphores[num_signal_semaphores++] = _cmd_semaphores[_cmd_index];
 	}
 
-	// Only reset fence before an actual submit which can signal it again
-	vk.ResetFences(_device_impl->_orig, 1, &_cmd_fences[_cmd_index]);
+	VkFence fence = VK_NULL_HANDLE;
+	VkTimelineSemaphoreSubmitInfo timeline_submit_info { VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO };
 
-	if (vk.QueueSubmit(queue, 1, &submit_info, _cmd_fences[_cmd_index]) != VK_SUCCESS)
+	if (_timeline_semaphore != VK_NULL_HANDLE)
+	{
+		signal_semaphore_values[num_signal_semaphores] = _timeline_value + 1;
+		signal_semaphores[num_signal_semaphores++] = _timeline_semaphore;
+
+		// Values for binary semaphores are ignored, so only the signal values need to be provided
+		timeline_submit_info.signalSemaphoreValueCount = num_signal_semaphores;
+		timeline_submit_info.pSignalSemaphoreValues = signal_semaphore_values;
+		submit_info.pNext = &timeline_submit_info;
+	}
+	else
+	{
+		fence = _cmd_fences[_cmd_index];
+
+		// Only reset fence before an actual submit which can signal it again
+		vk.ResetFences(_device_impl->_orig, 1, &fence);
+	}
+
+	submit_info.signalSemaphoreCount = num_signal_semaphores;
+	submit_info.pSignalSemaphores = signal_semaphores;
+
+	if (vk.QueueSubmit(queue, 1, &submit_info, fence) != VK_SUCCESS)
 		return false;
 
+	if (_timeline_semaphore != VK_NULL_HANDLE)
+		_cmd_timeline_values[_cmd_index] = ++_timeline_value;
+
+	_cmd_submissions[_cmd_index] = ++_num_submissions;
+
+	_upload_ring.submit(_cmd_index);
+
 	// Only signal and wait on a semaphore if the submit this flush is executed in originally did
 	if (!wait_semaphores.empty())
 	{
@@ -134,14 +220,31 @@ bool reshade::vulkan::command_list_immediate_impl::flush(VkQueue queue, std::vec
 	}
 
 	// Continue with next command buffer now that the current one was submitted
-	_cmd_index = (_cmd_index + 1) % NUM_COMMAND_FRAMES;
+	_cmd_index = (_cmd_index + 1) % _num_frames;
 
 	// Make sure the next command buffer has finished executing before reusing it this frame
-	if (vk.GetFenceStatus(_device_impl->_orig, _cmd_fences[_cmd_index]) == VK_NOT_READY)
+	if (!is_frame_complete(_cmd_index))
 	{
-		vk.WaitForFences(_device_impl->_orig, 1, &_cmd_fences[_cmd_index], VK_TRUE, UINT64_MAX);
+		// Add another command frame instead of waiting if the GPU is behind, but only when wrapping around, so that frames keep being used in submission order
+		if (_cmd_index == 0 && _num_frames < MAX_COMMAND_FRAMES && create_command_frame(_num_frames))
+		{
+			_cmd_index = _num_frames - 1;
+		}
+		else
+		{
+			const auto wait_start = std::chrono::high_resolution_clock::now();
+
+			wait_for_frame(_cmd_index);
+
+			_num_waits++;
+			_total_wait_time += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - wait_start);
+		}
 	}
 
+	// Upload memory and buffers that were referenced by the commands of the next command buffer can be reused now as well
+	_upload_ring.reclaim(_cmd_index);
+	release_pending(_cmd_index);
+
 	// Command buffer is now ready for a reset
 	VkCommandBufferBeginInfo begin_info { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
 	begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
@@ -153,6 +256,44 @@ bool reshade::vulkan::command_list_immediate_impl::flush(VkQueue queue, std::vec
 	_orig = _cmd_buffers[_cmd_index];
 	return true;
 }
+bool reshade::vulkan::command_list_immediate_impl::allocate_upload_memory(uint64_t size, uint64_t alignment, void **out_data, api::resource *out_buffer, uint64_t *out_offset)
+{
+	// Only create the ring buffer once it is actually used, since most queues never need it
+	if (!_upload_ring.is_valid() && !_upload_ring.create(_device_impl))
+	{
+		*out_data = nullptr;
+		return false;
+	}
+
+	return _upload_ring.allocate(size, alignment, out_data, out_buffer, out_offset);
+}
+
+bool reshade::vulkan::command_list_immediate_impl::allocate_secondary_command_buffer(VkCommandBuffer *out_cmd_buffer)
+{
+	VkCommandBufferAllocateInfo alloc_info { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+	alloc_info.commandPool = _cmd_pool;
+	alloc_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+	alloc_info.commandBufferCount = 1;
+
+	if (vk.AllocateCommandBuffers(_device_impl->_orig, &alloc_info, out_cmd_buffer) != VK_SUCCESS)
+		return false;
+
+	// Set the dispatch pointer, same as for the primary command buffers (see 'create_command_frame')
+	*reinterpret_cast<void **>(*out_cmd_buffer) = *reinterpret_cast<void **>(_device_impl->_orig);
+	return true;
+}
+
+void reshade::vulkan::command_list_immediate_impl::release_pending(uint32_t cmd_index)
+{
+	for (const auto &[buffer, allocation] : _pending_releases[cmd_index])
+		vmaDestroyBuffer(_device_impl->_alloc, buffer, allocation);
+	_pending_releases[cmd_index].clear();
+
+	if (!_pending_cmd_buffer_releases[cmd_index].empty())
+		vk.FreeCommandBuffers(_device_impl->_orig, _cmd_pool, static_cast<uint32_t>(_pending_cmd_buffer_releases[cmd_index].size()), _pending_cmd_buffer_releases[cmd_index].data());
+	_pending_cmd_buffer_releases[cmd_index].clear();
+}
+
 bool reshade::vulkan::command_list_immediate_impl::flush_and_wait(VkQueue queue)
 {
 	if (!_has_commands)
@@ -165,6 +306,49 @@ bool reshade::vulkan::command_list_immediate_impl::flush_and_wait(VkQueue queue)
 	if (!flush(queue, wait_semaphores))
 		return false;
 
-	// Wait for the submitted work to finish and reset fence again for next use
-	return vk.WaitForFences(_device_impl->_orig, 1, &_cmd_fences[cmd_index_to_wait_on], VK_TRUE, UINT64_MAX) == VK_SUCCESS;
+	// Wait for the submitted work to finish
+	return wait_for_frame(cmd_index_to_wait_on);
+}
+
+bool reshade::vulkan::command_list_immediate_impl::has_completed(uint64_t value) const
+{
+	if (_timeline_semaphore == VK_NULL_HANDLE)
+		return value == 0;
+
+	uint64_t completed_value = 0;
+	return vk.GetSemaphoreCounterValueKHR(_device_impl->_orig, _timeline_semaphore, &completed_value) == VK_SUCCESS && completed_value >= value;
+}
+
+uint64_t reshade::vulkan::command_list_immediate_impl::get_completed_submission() const
+{
+	// Command frames finish in submission order, so the latest submission of any finished frame means all earlier ones finished too
+	for (uint32_t i = 0; i < _num_frames; ++i)
+		if (_cmd_submissions[i] > _completed_submission && is_frame_complete(i))
+			_completed_submission = _cmd_submissions[i];
+
+	return _completed_submission;
+}
+
+bool reshade::vulkan::command_list_immediate_impl::is_frame_complete(uint32_t cmd_index) const
+{
+	if (_timeline_semaphore != VK_NULL_HANDLE)
+		return has_completed(_cmd_timeline_values[cmd_index]);
+	else
+		return vk.GetFenceStatus(_device_impl->_orig, _cmd_fences[cmd_index]) != VK_NOT_READY;
+}
+bool reshade::vulkan::command_list_immediate_impl::wait_for_frame(uint32_t cmd_index)
+{
+	if (_timeline_semaphore != VK_NULL_HANDLE)
+	{
+		VkSemaphoreWaitInfo wait_info { VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO };
+		wait_info.semaphoreCount = 1;
+		wait_info.pSemaphores = &_timeline_semaphore;
+		wait_info.pValues = &_cmd_timeline_values[cmd_index];
+
+		return vk.WaitSemaphoresKHR(_device_impl->_orig, &wait_info, UINT64_MAX) == VK_SUCCESS;
+	}
+	else
+	{
+		return vk.WaitForFences(_device_impl->_orig, 1, &_cmd_fences[cmd_index], VK_TRUE, UINT64_MAX) == VK_SUCCESS;
+	}
 }
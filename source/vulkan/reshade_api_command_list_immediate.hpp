@@ -6,12 +6,16 @@
 #pragma once
 
 #include "reshade_api_command_list.hpp"
+#include "upload_ring_buffer.hpp"
+#include <chrono>
 
 namespace reshade::vulkan
 {
 	class command_list_immediate_impl : public command_list_impl
 	{
-		static const uint32_t NUM_COMMAND_FRAMES = 4; // Use power of two so that modulo can be replaced with bitwise operation
+		// Start with a shallow ring of command frames and only add more (up to the maximum) when the GPU falls behind, so that deep frame queues do not make flushes block, while low latency setups do not waste memory
+		static const uint32_t MIN_COMMAND_FRAMES = 2;
+		static const uint32_t MAX_COMMAND_FRAMES = 8;
 
 	public:
 		command_list_immediate_impl(device_impl *device, uint32_t queue_family_index);
@@ -20,13 +24,78 @@ namespace reshade::vulkan
 		bool flush(VkQueue queue, std::vector<VkSemaphore> &wait_semaphores);
 		bool flush_and_wait(VkQueue queue);
 
-		const VkCommandBuffer begin_commands() { _has_commands = true; return _orig; }
+		const VkCommandBuffer begin_commands() { flush_barriers(); _has_commands = true; return _orig; }
+
+		bool allocate_upload_memory(uint64_t size, uint64_t alignment, void **out_data, api::resource *out_buffer, uint64_t *out_offset);
+
+		/// <summary>
+		/// Keeps the specified <paramref name="buffer"/> alive until the commands recorded so far finished executing on the GPU, instead of having to wait for that.
+		/// </summary>
+		void release_after_completion(VkBuffer buffer, VmaAllocation allocation) { _pending_releases[_cmd_index].push_back({ buffer, allocation }); }
+		/// <summary>
+		/// Frees the specified <paramref name="cmd_buffer"/> once the commands recorded so far finished executing on the GPU, so that it can be freed while executions of it are still pending.
+		/// </summary>
+		void release_after_completion(VkCommandBuffer cmd_buffer) { _pending_cmd_buffer_releases[_cmd_index].push_back(cmd_buffer); }
+
+		/// <summary>
+		/// Allocates a secondary command buffer from the command pool of this command list, which can then be executed as part of it.
+		/// </summary>
+		bool allocate_secondary_command_buffer(VkCommandBuffer *out_cmd_buffer);
+
+		/// <summary>
+		/// Gets the value the timeline semaphore of this command list is signaled to once all commands submitted so far finished executing.
+		/// This is always zero if timeline semaphores are not supported by the device.
+		/// </summary>
+		uint64_t get_submitted_timeline_value() const { return _timeline_value; }
+		/// <summary>
+		/// Checks whether all commands submitted up to when <see cref="get_submitted_timeline_value"/> returned the specified <paramref name="value"/> finished executing, without blocking.
+		/// </summary>
+		bool has_completed(uint64_t value) const;
+
+		/// <summary>
+		/// Gets the number of the submission the commands recorded so far are executed with, which was reached once <see cref="get_completed_submission"/> returns that number or a higher one.
+		/// This works with and without timeline semaphores, unlike <see cref="get_submitted_timeline_value"/>.
+		/// </summary>
+		uint64_t get_pending_submission() const { return _has_commands ? _num_submissions + 1 : _num_submissions; }
+		/// <summary>
+		/// Gets the number of the last submission that finished executing on the GPU, without blocking.
+		/// </summary>
+		uint64_t get_completed_submission() const;
+
+		/// <summary>
+		/// Gets the number of command frames currently in use, and how often and for how long in total flushes had to block waiting for the GPU to finish with a command frame.
+		/// </summary>
+		void get_wait_statistics(uint32_t &num_frames, uint64_t &num_waits, std::chrono::nanoseconds &total_wait_time) const
+		{
+			num_frames = _num_frames;
+			num_waits = _num_waits;
+			total_wait_time = _total_wait_time;
+		}
 
 	private:
+		bool create_command_frame(uint32_t index);
+		void release_pending(uint32_t cmd_index);
+
+		bool is_frame_complete(uint32_t cmd_index) const;
+		bool wait_for_frame(uint32_t cmd_index);
+
 		uint32_t _cmd_index = 0;
+		uint32_t _num_frames = 0;
 		VkCommandPool _cmd_pool = VK_NULL_HANDLE;
-		VkFence _cmd_fences[NUM_COMMAND_FRAMES] = {};
-		VkSemaphore _cmd_semaphores[NUM_COMMAND_FRAMES] = {};
-		VkCommandBuffer _cmd_buffers[NUM_COMMAND_FRAMES] = {};
+		// Either a single timeline semaphore is used to track completion of all command frames, or a fence per frame if timeline semaphores are not supported
+		VkSemaphore _timeline_semaphore = VK_NULL_HANDLE;
+		uint64_t _timeline_value = 0;
+		uint64_t _cmd_timeline_values[MAX_COMMAND_FRAMES] = {};
+		uint64_t _num_submissions = 0;
+		uint64_t _cmd_submissions[MAX_COMMAND_FRAMES] = {};
+		mutable uint64_t _completed_submission = 0;
+		VkFence _cmd_fences[MAX_COMMAND_FRAMES] = {};
+		VkSemaphore _cmd_semaphores[MAX_COMMAND_FRAMES] = {};
+		VkCommandBuffer _cmd_buffers[MAX_COMMAND_FRAMES] = {};
+		upload_ring_buffer<MAX_COMMAND_FRAMES> _upload_ring;
+		std::vector<std::pair<VkBuffer, VmaAllocation>> _pending_releases[MAX_COMMAND_FRAMES];
+		std::vector<VkCommandBuffer> _pending_cmd_buffer_releases[MAX_COMMAND_FRAMES];
+		uint64_t _num_waits = 0;
+		std::chrono::nanoseconds _total_wait_time = {};
 	};
 }
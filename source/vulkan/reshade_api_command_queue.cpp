@@ -62,6 +62,26 @@ void reshade::vulkan::command_queue_impl::flush_immediate_command_list(std::vect
 		_immediate_cmd_list->flush(_orig, wait_semaphores);
 }
 
+void reshade::vulkan::command_queue_impl::execute_command_list(api::command_list *cmd_list)
+{
+	// Commands recorded on the immediate command list so far have to execute before the ones in the specified command list
+	flush_immediate_command_list();
+
+	std::vector<VkSemaphore> wait_semaphores; // No semaphores to wait on
+	static_cast<command_list_immediate_impl *>(cmd_list)->flush(_orig, wait_semaphores);
+}
+
+bool reshade::vulkan::command_queue_impl::allocate_upload_memory(uint64_t size, uint64_t alignment, void **out_data, api::resource *out_buffer, uint64_t *out_offset)
+{
+	if (_immediate_cmd_list == nullptr)
+	{
+		*out_data = nullptr;
+		return false;
+	}
+
+	return _immediate_cmd_list->allocate_upload_memory(size, alignment, out_data, out_buffer, out_offset);
+}
+
 void reshade::vulkan::command_queue_impl::wait_idle() const
 {
 	flush_immediate_command_list();
@@ -20,6 +20,12 @@ namespace reshade::vulkan
 		api::command_list *get_immediate_command_list() final { return _immediate_cmd_list; }
 
 		void flush_immediate_command_list() const final;
+
+		void execute_command_list(api::command_list *cmd_list) final;
+		bool allocate_upload_memory(uint64_t size, uint64_t alignment, void **out_data, api::resource *out_buffer, uint64_t *out_offset) final;
+
+		uint64_t get_pending_fence_value() final { return _immediate_cmd_list != nullptr ? _immediate_cmd_list->get_pending_submission() : 0; }
+		uint64_t get_completed_fence_value() const final { return _immediate_cmd_list != nullptr ? _immediate_cmd_list->get_completed_submission() : 0; }
 		void flush_immediate_command_list(std::vector<VkSemaphore> &wait_semaphores) const;
 
 		void wait_idle() const final;
@@ -7,7 +7,9 @@
 #include "reshade_api_device.hpp"
 #include "reshade_api_command_queue.hpp"
 #include "reshade_api_type_convert.hpp"
+#include "resource_ledger.hpp"
 #include <algorithm>
+#include <string_view>
 
 #define vk _dispatch_table
 
@@ -61,6 +63,27 @@ reshade::vulkan::device_impl::device_impl(VkDevice device, VkPhysicalDevice phys
 		vmaCreateAllocator(&create_info, &_alloc);
 	}
 
+	// Upload buffers are short-lived and released in the order they were submitted, so sub-allocate them from a single block used as a ring buffer, instead of scattering them across the blocks that hold long-lived resources
+	{	VkBufferCreateInfo buffer_info { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+		buffer_info.size = 1024;
+		buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+
+		VmaAllocationCreateInfo alloc_info = {};
+		alloc_info.usage = VMA_MEMORY_USAGE_CPU_ONLY;
+
+		VmaPoolCreateInfo create_info = {};
+		create_info.flags = VMA_POOL_CREATE_LINEAR_ALGORITHM_BIT;
+		create_info.blockSize = 32 * 1024 * 1024;
+		create_info.maxBlockCount = 1;
+
+		if (vmaFindMemoryTypeIndexForBufferInfo(_alloc, &buffer_info, &alloc_info, &create_info.memoryTypeIndex) != VK_SUCCESS ||
+			vmaCreatePool(_alloc, &create_info, &_upload_pool) != VK_SUCCESS)
+		{
+			LOG(WARN) << "Failed to create upload memory pool, falling back to default allocations.";
+			_upload_pool = VK_NULL_HANDLE;
+		}
+	}
+
 	const VkDescriptorPoolSize pool_sizes[] = {
 		{ VK_DESCRIPTOR_TYPE_SAMPLER, 128 },
 		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1024 },
@@ -116,10 +139,138 @@ reshade::vulkan::device_impl::~device_impl()
 	vk.DestroyDescriptorPool(_orig, _descriptor_pool, nullptr);
 	for (uint32_t i = 0; i < 4; ++i)
 		vk.DestroyDescriptorPool(_orig, _transient_descriptor_pool[i], nullptr);
+	for (const auto &[key, pool_data] : _descriptor_pool_cache)
+		for (const VkDescriptorPool pool : pool_data.pools)
+			vk.DestroyDescriptorPool(_orig, pool, nullptr);
+
+	vk.DestroyPipelineCache(_orig, _pipeline_cache, nullptr);
+
+	for (const auto &[key, render_pass] : _render_pass_cache)
+	{
+		_render_pass_list.erase(render_pass);
+		vk.DestroyRenderPass(_orig, render_pass, nullptr);
+	}
+
+	for (const auto &[key, update_template] : _push_descriptor_templates)
+		vk.DestroyDescriptorUpdateTemplate(_orig, update_template, nullptr);
 
+	// Destroy any shared layouts that were not released before the device went away
+	for (const auto &[key, pipeline_layout] : _pipeline_layout_cache)
+		vk.DestroyPipelineLayout(_orig, pipeline_layout.first, nullptr);
+	for (const auto &[key, set_layout] : _descriptor_set_layout_cache)
+		vk.DestroyDescriptorSetLayout(_orig, set_layout.first, nullptr);
+
+	if (_upload_pool != VK_NULL_HANDLE)
+		vmaDestroyPool(_alloc, _upload_pool);
 	vmaDestroyAllocator(_alloc);
 }
 
+void reshade::vulkan::device_impl::load_pipeline_cache(const std::vector<char> &data)
+{
+	// Cache is shared between all swap chains of this device, so only need to create it once
+	if (_pipeline_cache != VK_NULL_HANDLE)
+		return;
+
+	VkPipelineCacheCreateInfo create_info { VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO };
+
+	// Only pass on data that was generated by the same driver and device (some drivers are not robust against foreign data)
+	if (data.size() >= 16 + VK_UUID_SIZE)
+	{
+		VkPhysicalDeviceProperties device_props = {};
+		_instance_dispatch_table.GetPhysicalDeviceProperties(_physical_device, &device_props);
+
+		uint32_t header[4];
+		std::memcpy(header, data.data(), sizeof(header));
+
+		if (header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+			header[2] == device_props.vendorID &&
+			header[3] == device_props.deviceID &&
+			std::memcmp(data.data() + 16, device_props.pipelineCacheUUID, VK_UUID_SIZE) == 0)
+		{
+			create_info.initialDataSize = data.size();
+			create_info.pInitialData = data.data();
+
+			_pipeline_cache_data_hash = std::hash<std::string_view>()(std::string_view(data.data(), data.size()));
+		}
+	}
+
+	if (vk.CreatePipelineCache(_orig, &create_info, nullptr, &_pipeline_cache) != VK_SUCCESS)
+	{
+		LOG(ERROR) << "Failed to create pipeline cache!";
+		_pipeline_cache = VK_NULL_HANDLE;
+	}
+}
+bool reshade::vulkan::device_impl::save_pipeline_cache(std::vector<char> &data)
+{
+	if (_pipeline_cache == VK_NULL_HANDLE || !_pipeline_cache_dirty.exchange(false))
+		return false;
+
+	size_t size = 0;
+	if (vk.GetPipelineCacheData(_orig, _pipeline_cache, &size, nullptr) == VK_SUCCESS)
+	{
+		data.resize(size);
+		if (vk.GetPipelineCacheData(_orig, _pipeline_cache, &size, data.data()) != VK_SUCCESS)
+			size = 0;
+	}
+
+	if (size == 0)
+	{
+		_pipeline_cache_dirty = true; // Try again next time
+		return false;
+	}
+
+	data.resize(size);
+
+	// Pipelines that were created again after a reset are usually all found in the cache already, in which case there is nothing new to write
+	const size_t data_hash = std::hash<std::string_view>()(std::string_view(data.data(), data.size()));
+	if (data_hash == _pipeline_cache_data_hash)
+		return false;
+
+	_pipeline_cache_data_hash = data_hash;
+	return true;
+}
+
+VkDescriptorUpdateTemplate reshade::vulkan::device_impl::get_push_descriptor_template(VkPipelineBindPoint bind_point, VkPipelineLayout layout, uint32_t layout_index, VkDescriptorType type, uint32_t first, uint32_t count)
+{
+	if (vk.CreateDescriptorUpdateTemplate == nullptr || vk.CmdPushDescriptorSetWithTemplateKHR == nullptr)
+		return VK_NULL_HANDLE;
+	// Only pipeline layouts created through this device are known to be destroyed through 'destroy_pipeline_layout' too, which is where the template is released
+	if (!_pipeline_layout_list.contains(layout))
+		return VK_NULL_HANDLE;
+
+	const std::lock_guard<std::mutex> lock(_push_descriptor_template_mutex);
+
+	const auto key = std::make_tuple(layout, layout_index, bind_point, type, first, count);
+	if (const auto it = _push_descriptor_templates.find(key); it != _push_descriptor_templates.end())
+		return it->second;
+
+	// Descriptors are passed as a tightly packed array of image or buffer info structures (see 'command_list_impl::push_descriptors')
+	VkDescriptorUpdateTemplateEntry entry;
+	entry.dstBinding = first;
+	entry.dstArrayElement = 0;
+	entry.descriptorCount = count;
+	entry.descriptorType = type;
+	entry.offset = 0;
+	entry.stride = type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER ? sizeof(VkDescriptorBufferInfo) : sizeof(VkDescriptorImageInfo);
+
+	VkDescriptorUpdateTemplateCreateInfo create_info { VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO };
+	create_info.descriptorUpdateEntryCount = 1;
+	create_info.pDescriptorUpdateEntries = &entry;
+	create_info.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_PUSH_DESCRIPTORS_KHR;
+	create_info.pipelineBindPoint = bind_point;
+	create_info.pipelineLayout = layout;
+	create_info.set = layout_index;
+
+	// Cache failures too, so that creation is not attempted again on every call
+	VkDescriptorUpdateTemplate update_template = VK_NULL_HANDLE;
+	if (vk.CreateDescriptorUpdateTemplate(_orig, &create_info, nullptr, &update_template) != VK_SUCCESS)
+		update_template = VK_NULL_HANDLE;
+
+	_push_descriptor_templates.emplace(key, update_template);
+
+	return update_template;
+}
+
 void reshade::vulkan::device_impl::advance_transient_descriptor_pool()
 {
 	if (vk.CmdPushDescriptorSetKHR != nullptr)
@@ -169,6 +320,8 @@ bool reshade::vulkan::device_impl::check_capability(api::device_caps capability)
 	case api::device_caps::resolve_region:
 	case api::device_caps::copy_query_pool_results:
 		return true;
+	case api::device_caps::shading_rate:
+		return _fragment_shading_rate_ext;
 	default:
 		return false;
 	}
@@ -206,21 +359,52 @@ bool reshade::vulkan::device_impl::check_format_support(api::format format, api:
 	return true;
 }
 
+bool reshade::vulkan::device_impl::get_memory_budget(uint64_t *budget, uint64_t *usage) const
+{
+	if (!_memory_budget_ext || _instance_dispatch_table.GetPhysicalDeviceMemoryProperties2 == nullptr)
+		return false;
+
+	VkPhysicalDeviceMemoryBudgetPropertiesEXT budget_props { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT };
+	VkPhysicalDeviceMemoryProperties2 memory_props { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2 };
+	memory_props.pNext = &budget_props;
+	_instance_dispatch_table.GetPhysicalDeviceMemoryProperties2(_physical_device, &memory_props);
+
+	// Sum up all heaps in video memory, to match what DXGI reports for the local segment group
+	*budget = 0;
+	*usage = 0;
+	for (uint32_t i = 0; i < memory_props.memoryProperties.memoryHeapCount; ++i)
+	{
+		if ((memory_props.memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) == 0)
+			continue;
+
+		*budget += budget_props.heapBudget[i];
+		*usage += budget_props.heapUsage[i];
+	}
+
+	return true;
+}
+uint64_t reshade::vulkan::device_impl::get_resource_memory_usage(api::resource_memory_owner owner, api::resource_memory_category category) const
+{
+	return resource_ledger::get_usage(this, owner, category);
+}
+
 bool reshade::vulkan::device_impl::is_resource_handle_valid(api::resource handle) const
 {
 	if (handle.handle == 0)
 		return false;
 
-	const std::lock_guard<std::mutex> lock(_mutex);
-	return _resources.find(handle.handle) != _resources.end();
+	// Entries are removed from the cache when the resource is destroyed, so a hit means the handle is still valid
+	if (api::resource_desc desc; _resource_desc_cache.lookup(handle.handle, desc))
+		return true;
+
+	return _resources.contains(handle.handle);
 }
 bool reshade::vulkan::device_impl::is_resource_view_handle_valid(api::resource_view handle) const
 {
 	if (handle.handle == 0)
 		return false;
 
-	const std::lock_guard<std::mutex> lock(_mutex);
-	return _views.find(handle.handle) != _views.end();
+	return _views.contains(handle.handle);
 }
 
 bool reshade::vulkan::device_impl::create_sampler(const api::sampler_desc &desc, api::sampler *out)
@@ -242,6 +426,9 @@ bool reshade::vulkan::device_impl::create_sampler(const api::sampler_desc &desc,
 }
 bool reshade::vulkan::device_impl::create_resource(const api::resource_desc &desc, const api::subresource_data *initial_data, api::resource_usage initial_state, api::resource *out)
 {
+	// Keep track of how much memory ReShade and add-ons allocate (this also covers all the return paths below)
+	const resource_ledger::create_scope ledger_scope(this, desc, out, _ReturnAddress());
+
 	assert((desc.usage & initial_state) == initial_state || initial_state == api::resource_usage::cpu_access);
 
 	VmaAllocation allocation = VK_NULL_HANDLE;
@@ -251,6 +438,9 @@ bool reshade::vulkan::device_impl::create_resource(const api::resource_desc &des
 	default:
 	case api::memory_heap::gpu_only:
 		alloc_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+		// Render targets are large and recreated whenever effects are reloaded or the back buffer is resized, so give them their own memory, which is returned to the driver as soon as they are destroyed, instead of leaving holes in shared blocks that smaller resources cannot fill
+		if (desc.type != api::resource_type::buffer && (desc.usage & (api::resource_usage::render_target | api::resource_usage::unordered_access)) != api::resource_usage::undefined)
+			alloc_info.flags |= VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
 		break;
 	case api::memory_heap::cpu_to_gpu:
 		alloc_info.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
@@ -451,8 +641,10 @@ bool reshade::vulkan::device_impl::create_compute_pipeline(const api::pipeline_d
 	}
 
 	if (VkPipeline object = VK_NULL_HANDLE;
-		vk.CreateComputePipelines(_orig, VK_NULL_HANDLE, 1, &create_info, nullptr, &object) == VK_SUCCESS)
+		vk.CreateComputePipelines(_orig, _pipeline_cache, 1, &create_info, nullptr, &object) == VK_SUCCESS)
 	{
+		_pipeline_cache_dirty = true;
+
 		vk.DestroyShaderModule(_orig, create_info.stage.module, nullptr);
 
 		*out = { (uint64_t)object };
@@ -541,6 +733,11 @@ bool reshade::vulkan::device_impl::create_graphics_pipeline(const api::pipeline_
 			case api::dynamic_state::stencil_reference_value:
 				dyn_states.push_back(VK_DYNAMIC_STATE_STENCIL_REFERENCE);
 				break;
+			case api::dynamic_state::shading_rate:
+				if (!_fragment_shading_rate_ext)
+					goto exit_failure;
+				dyn_states.push_back(VK_DYNAMIC_STATE_FRAGMENT_SHADING_RATE_KHR);
+				break;
 			default:
 				goto exit_failure;
 			}
@@ -667,14 +864,16 @@ bool reshade::vulkan::device_impl::create_graphics_pipeline(const api::pipeline_
 
 		const auto pass_impl = reinterpret_cast<const render_pass_impl *>(desc.graphics.render_pass_template.handle);
 
-		uint32_t num_color_attachments = 0;
-		{
-			const std::lock_guard<std::mutex> lock(_mutex);
-			const auto &framebuffer_data = _framebuffer_list.at(pass_impl->fbo);
+		const auto count_color_attachments = [](const framebuffer_data &framebuffer_data) {
+			uint32_t count = 0;
 			for (VkImageAspectFlags format_flags : framebuffer_data.attachment_types)
 				if (format_flags == VK_IMAGE_ASPECT_COLOR_BIT)
-					num_color_attachments++;
-		}
+					count++;
+			return count;
+		};
+
+		const uint32_t num_color_attachments = !pass_impl->fbo_data.attachments.empty() ?
+			count_color_attachments(pass_impl->fbo_data) : _framebuffer_list.read(pass_impl->fbo, count_color_attachments);
 
 		VkPipelineColorBlendStateCreateInfo color_blend_state_info { VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO };
 		create_info.pColorBlendState = &color_blend_state_info;
@@ -690,8 +889,10 @@ bool reshade::vulkan::device_impl::create_graphics_pipeline(const api::pipeline_
 		create_info.renderPass = pass_impl->render_pass;
 
 		if (VkPipeline object = VK_NULL_HANDLE;
-			vk.CreateGraphicsPipelines(_orig, VK_NULL_HANDLE, 1, &create_info, nullptr, &object) == VK_SUCCESS)
+			vk.CreateGraphicsPipelines(_orig, _pipeline_cache, 1, &create_info, nullptr, &object) == VK_SUCCESS)
 		{
+			_pipeline_cache_dirty = true;
+
 			for (uint32_t stage_index = 0; stage_index < create_info.stageCount; ++stage_index)
 				vk.DestroyShaderModule(_orig, create_info.pStages[stage_index].module, nullptr);
 
@@ -710,6 +911,29 @@ exit_failure:
 
 bool reshade::vulkan::device_impl::create_pipeline_layout(const api::pipeline_layout_desc &desc, api::pipeline_layout *out)
 {
+	// Pipeline layouts only depend on the set layouts and push constant ranges, so reuse an identical one if it exists already (e.g. when multiple effects use the same bindings)
+	std::vector<uint64_t> layout_key;
+	layout_key.reserve(1 + desc.num_set_layouts + desc.num_constant_ranges * 3);
+	layout_key.push_back(desc.num_set_layouts);
+	for (uint32_t i = 0; i < desc.num_set_layouts; ++i)
+		layout_key.push_back(desc.set_layouts[i].handle);
+	for (uint32_t i = 0; i < desc.num_constant_ranges; ++i)
+	{
+		layout_key.push_back(static_cast<uint64_t>(desc.constant_ranges[i].visibility));
+		layout_key.push_back(desc.constant_ranges[i].offset);
+		layout_key.push_back(desc.constant_ranges[i].count);
+	}
+
+	const std::lock_guard<std::mutex> lock(_layout_cache_mutex);
+
+	if (const auto it = _pipeline_layout_cache.find(layout_key); it != _pipeline_layout_cache.end())
+	{
+		it->second.second++;
+
+		*out = { (uint64_t)it->second.first };
+		return true;
+	}
+
 	VkDescriptorSetLayout dummy_layout = VK_NULL_HANDLE;
 
 	std::vector<VkDescriptorSetLayout> internal_set_layouts(desc.num_set_layouts);
@@ -754,7 +978,12 @@ bool reshade::vulkan::device_impl::create_pipeline_layout(const api::pipeline_la
 	if (VkPipelineLayout object = VK_NULL_HANDLE;
 		vk.CreatePipelineLayout(_orig, &create_info, nullptr, &object) == VK_SUCCESS)
 	{
-		_pipeline_layout_list[object].assign(create_info.pSetLayouts, create_info.pSetLayouts + create_info.setLayoutCount);
+		_pipeline_layout_list.emplace(object, create_info.pSetLayouts, create_info.pSetLayouts + create_info.setLayoutCount);
+		_pipeline_layout_cache.emplace(std::move(layout_key), std::make_pair(object, 1u));
+
+		// Keep cached set layouts alive for as long as this pipeline layout is cached, since their handles are part of its key and could otherwise be reused by a different layout
+		for (auto &entry : _descriptor_set_layout_cache)
+			entry.second.second += static_cast<uint32_t>(std::count(internal_set_layouts.begin(), internal_set_layouts.end(), entry.second.first));
 
 		vk.DestroyDescriptorSetLayout(_orig, dummy_layout, nullptr);
 
@@ -793,9 +1022,55 @@ bool reshade::vulkan::device_impl::create_descriptor_set_layout(const api::descr
 	if (desc.push_descriptors && vk.CmdPushDescriptorSetKHR != nullptr)
 		set_create_info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR;
 
+	// Reuse an identical set layout if it exists already, which in turn lets pipeline layouts built from it be shared too (see 'create_pipeline_layout')
+	std::vector<uint64_t> layout_key;
+	layout_key.reserve(1 + internal_bindings.size() * 4);
+	layout_key.push_back(set_create_info.flags);
+	for (const VkDescriptorSetLayoutBinding &internal_binding : internal_bindings)
+	{
+		layout_key.push_back(internal_binding.binding);
+		layout_key.push_back(internal_binding.descriptorType);
+		layout_key.push_back(internal_binding.descriptorCount);
+		layout_key.push_back(internal_binding.stageFlags);
+	}
+
+	const std::lock_guard<std::mutex> lock(_layout_cache_mutex);
+
+	if (const auto it = _descriptor_set_layout_cache.find(layout_key); it != _descriptor_set_layout_cache.end())
+	{
+		it->second.second++;
+
+		*out = { (uint64_t)it->second.first };
+		return true;
+	}
+
 	if (VkDescriptorSetLayout object = VK_NULL_HANDLE;
 		vk.CreateDescriptorSetLayout(_orig, &set_create_info, nullptr, &object) == VK_SUCCESS)
 	{
+		// Push descriptor layouts cannot be used to allocate sets, and empty layouts do not need a pool of their own
+		if ((set_create_info.flags & VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR) == 0 && !internal_bindings.empty())
+		{
+			const std::lock_guard<std::mutex> pool_lock(_descriptor_pool_mutex);
+
+			descriptor_pool_data &pool_data = _descriptor_pool_cache[layout_key];
+			if (pool_data.set_sizes.empty())
+			{
+				for (const VkDescriptorSetLayoutBinding &internal_binding : internal_bindings)
+				{
+					const auto size_it = std::find_if(pool_data.set_sizes.begin(), pool_data.set_sizes.end(),
+						[&internal_binding](const VkDescriptorPoolSize &size) { return size.type == internal_binding.descriptorType; });
+					if (size_it != pool_data.set_sizes.end())
+						size_it->descriptorCount += internal_binding.descriptorCount;
+					else
+						pool_data.set_sizes.push_back({ internal_binding.descriptorType, internal_binding.descriptorCount });
+				}
+			}
+
+			_descriptor_pools_by_layout[object] = &pool_data;
+		}
+
+		_descriptor_set_layout_cache.emplace(std::move(layout_key), std::make_pair(object, 1u));
+
 		*out = { (uint64_t)object };
 		return true;
 	}
@@ -814,6 +1089,12 @@ bool reshade::vulkan::device_impl::create_query_pool(api::query_type type, uint3
 
 	if (type == api::query_type::pipeline_statistics)
 	{
+		if (!_enabled_features.pipelineStatisticsQuery)
+		{
+			*out = { 0 };
+			return false;
+		}
+
 		create_info.pipelineStatistics =
 			VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
 			VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
@@ -926,6 +1207,23 @@ bool reshade::vulkan::device_impl::create_render_pass(const api::render_pass_des
 		pass_data.attachments.push_back({ attach.initialLayout, 0, aspect_flags_from_format(attach.format) });
 	}
 
+	// Render passes only depend on the attachment formats and sample counts, so reuse a compatible one if it exists already (e.g. when recreating effect passes after a resize)
+	std::vector<uint32_t> render_pass_key;
+	render_pass_key.reserve(1 + attachment_descs.size() * 2);
+	render_pass_key.push_back(num_color_attachments);
+	for (const VkAttachmentDescription &attach : attachment_descs)
+	{
+		render_pass_key.push_back(static_cast<uint32_t>(attach.format));
+		render_pass_key.push_back(static_cast<uint32_t>(attach.samples));
+	}
+
+	const std::lock_guard<std::mutex> lock(_render_pass_cache_mutex);
+
+	if (const auto it = _render_pass_cache.find(render_pass_key); it != _render_pass_cache.end())
+	{
+		pass_impl.render_pass = it->second;
+	}
+	else
 	{
 		// Synchronize any writes to render targets in previous passes with reads from them in this pass
 		VkSubpassDependency subdep = {};
@@ -955,6 +1253,9 @@ bool reshade::vulkan::device_impl::create_render_pass(const api::render_pass_des
 			*out = { 0 };
 			return false;
 		}
+
+		_render_pass_cache.emplace(std::move(render_pass_key), pass_impl.render_pass);
+		_render_pass_list.emplace(pass_impl.render_pass, render_pass_data(pass_data));
 	}
 
 	{
@@ -975,16 +1276,15 @@ bool reshade::vulkan::device_impl::create_render_pass(const api::render_pass_des
 
 		if (vk.CreateFramebuffer(_orig, &create_info, nullptr, &pass_impl.fbo) != VK_SUCCESS)
 		{
-			vk.DestroyRenderPass(_orig, pass_impl.render_pass, nullptr);
-
 			*out = { 0 };
-			return false;
+			return false; // Render pass stays in the cache, so no need to destroy it here
 		}
 	}
 
-	std::lock_guard<std::mutex> lock(_mutex);
-	_render_pass_list.emplace(pass_impl.render_pass, std::move(pass_data));
-	_framebuffer_list.emplace(pass_impl.fbo, std::move(fbo_data));
+	_framebuffer_list.emplace(pass_impl.fbo, framebuffer_data(fbo_data));
+
+	pass_impl.pass_data = std::move(pass_data);
+	pass_impl.fbo_data = std::move(fbo_data);
 
 	*out = { reinterpret_cast<uintptr_t>(new render_pass_impl(std::move(pass_impl))) };
 	return true;
@@ -1000,7 +1300,56 @@ bool reshade::vulkan::device_impl::create_descriptor_sets(api::descriptor_set_la
 	alloc_info.descriptorSetCount = count;
 	alloc_info.pSetLayouts = set_layouts.data();
 
-	return vk.AllocateDescriptorSets(_orig, &alloc_info, reinterpret_cast<VkDescriptorSet *>(out)) == VK_SUCCESS;
+	const std::lock_guard<std::mutex> lock(_descriptor_pool_mutex);
+
+	// Layouts that were not created through 'create_descriptor_set_layout' fall back to the shared pool
+	const auto layout_it = _descriptor_pools_by_layout.find((VkDescriptorSetLayout)layout.handle);
+	if (layout_it == _descriptor_pools_by_layout.end())
+		return vk.AllocateDescriptorSets(_orig, &alloc_info, reinterpret_cast<VkDescriptorSet *>(out)) == VK_SUCCESS;
+
+	descriptor_pool_data &pool_data = *layout_it->second;
+
+	const auto allocate_from_pool = [&](VkDescriptorPool pool) {
+		alloc_info.descriptorPool = pool;
+		if (vk.AllocateDescriptorSets(_orig, &alloc_info, reinterpret_cast<VkDescriptorSet *>(out)) != VK_SUCCESS)
+			return false;
+
+		for (uint32_t i = 0; i < count; ++i)
+			pool_data.live_sets.emplace((VkDescriptorSet)out[i].handle, pool);
+		pool_data.peak_live_sets = std::max(pool_data.peak_live_sets, static_cast<uint32_t>(pool_data.live_sets.size()));
+		return true;
+	};
+
+	// Try the most recently created pool first, since the older ones are likely full
+	for (auto pool_it = pool_data.pools.rbegin(); pool_it != pool_data.pools.rend(); ++pool_it)
+		if (allocate_from_pool(*pool_it))
+			return true;
+
+	// All pools are full (or there are none yet), so add another one, which is twice as large as the last one if that was not enough
+	const uint32_t max_sets = std::max(count, pool_data.pools.empty() ? pool_data.sets_per_pool : pool_data.sets_per_pool * 2);
+
+	std::vector<VkDescriptorPoolSize> pool_sizes = pool_data.set_sizes;
+	for (VkDescriptorPoolSize &size : pool_sizes)
+		size.descriptorCount *= max_sets;
+
+	VkDescriptorPoolCreateInfo create_info { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+	// Sets are still freed individually while the layout is in use (e.g. when texture bindings change), which cannot fragment the pool, since all sets in it have the same size
+	create_info.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+	create_info.maxSets = max_sets;
+	create_info.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
+	create_info.pPoolSizes = pool_sizes.data();
+
+	VkDescriptorPool pool = VK_NULL_HANDLE;
+	if (vk.CreateDescriptorPool(_orig, &create_info, nullptr, &pool) != VK_SUCCESS)
+	{
+		LOG(ERROR) << "Failed to create descriptor pool for " << max_sets << " descriptor sets!";
+		return false;
+	}
+
+	pool_data.pools.push_back(pool);
+	pool_data.sets_per_pool = max_sets;
+
+	return allocate_from_pool(pool);
 }
 
 void reshade::vulkan::device_impl::destroy_sampler(api::sampler handle)
@@ -1009,11 +1358,19 @@ void reshade::vulkan::device_impl::destroy_sampler(api::sampler handle)
 }
 void reshade::vulkan::device_impl::destroy_resource(api::resource handle)
 {
+	resource_ledger::unregister_resource(this, handle);
+
 	if (handle.handle == 0)
 		return;
 	const resource_data data = lookup_resource(handle);
 	assert(data.owned);
 
+	// Unregister before destroying, since the handle may be reused by another thread right after
+	if (data.is_image())
+		unregister_image(data.image);
+	else
+		unregister_buffer(data.buffer);
+
 	if (data.allocation == VK_NULL_HANDLE)
 	{
 		if (data.is_image())
@@ -1028,9 +1385,6 @@ void reshade::vulkan::device_impl::destroy_resource(api::resource handle)
 		else
 			vmaDestroyBuffer(_alloc, data.buffer, data.allocation);
 	}
-
-	const std::lock_guard<std::mutex> lock(_mutex);
-	_resources.erase(handle.handle);
 }
 void reshade::vulkan::device_impl::destroy_resource_view(api::resource_view handle)
 {
@@ -1044,7 +1398,6 @@ void reshade::vulkan::device_impl::destroy_resource_view(api::resource_view hand
 	else
 		vk.DestroyBufferView(_orig, data.buffer_view, nullptr);
 
-	const std::lock_guard<std::mutex> lock(_mutex);
 	_views.erase(handle.handle);
 }
 
@@ -1054,13 +1407,75 @@ void reshade::vulkan::device_impl::destroy_pipeline(api::pipeline_stage, api::pi
 }
 void reshade::vulkan::device_impl::destroy_pipeline_layout(api::pipeline_layout handle)
 {
+	if (handle.handle == 0)
+		return;
+
+	{
+		const std::lock_guard<std::mutex> lock(_layout_cache_mutex);
+
+		if (const auto it = std::find_if(_pipeline_layout_cache.begin(), _pipeline_layout_cache.end(),
+				[handle](const auto &entry) { return entry.second.first == (VkPipelineLayout)handle.handle; });
+			it != _pipeline_layout_cache.end())
+		{
+			// Other users of this shared pipeline layout remain
+			if (--it->second.second != 0)
+				return;
+
+			for (uint64_t i = 1; i <= it->first[0]; ++i)
+				if (it->first[i] != 0)
+					release_descriptor_set_layout((VkDescriptorSetLayout)it->first[i]);
+
+			_pipeline_layout_cache.erase(it);
+		}
+	}
+
 	_pipeline_layout_list.erase((VkPipelineLayout)handle.handle);
 
+	// Templates reference the pipeline layout, so have to go with it (and the handle may be reused by a different layout afterwards)
+	{
+		const std::lock_guard<std::mutex> lock(_push_descriptor_template_mutex);
+
+		for (auto it = _push_descriptor_templates.lower_bound({ (VkPipelineLayout)handle.handle, 0, VkPipelineBindPoint(0), VkDescriptorType(0), 0, 0 });
+			it != _push_descriptor_templates.end() && std::get<0>(it->first) == (VkPipelineLayout)handle.handle;)
+		{
+			vk.DestroyDescriptorUpdateTemplate(_orig, it->second, nullptr);
+			it = _push_descriptor_templates.erase(it);
+		}
+	}
+
 	vk.DestroyPipelineLayout(_orig, (VkPipelineLayout)handle.handle, nullptr);
 }
 void reshade::vulkan::device_impl::destroy_descriptor_set_layout(api::descriptor_set_layout handle)
 {
-	vk.DestroyDescriptorSetLayout(_orig, (VkDescriptorSetLayout)handle.handle, nullptr);
+	if (handle.handle == 0)
+		return;
+
+	const std::lock_guard<std::mutex> lock(_layout_cache_mutex);
+
+	if (!release_descriptor_set_layout((VkDescriptorSetLayout)handle.handle))
+		vk.DestroyDescriptorSetLayout(_orig, (VkDescriptorSetLayout)handle.handle, nullptr);
+}
+bool reshade::vulkan::device_impl::release_descriptor_set_layout(VkDescriptorSetLayout layout)
+{
+	const auto it = std::find_if(_descriptor_set_layout_cache.begin(), _descriptor_set_layout_cache.end(),
+		[layout](const auto &entry) { return entry.second.first == layout; });
+	if (it == _descriptor_set_layout_cache.end())
+		return false;
+
+	// Only destroy the set layout along with the last reference to it
+	if (--it->second.second == 0)
+	{
+		// Keep the pools of the layout around for when it is created again, but the handle may be reused for a different layout
+		{
+			const std::lock_guard<std::mutex> pool_lock(_descriptor_pool_mutex);
+			_descriptor_pools_by_layout.erase(layout);
+		}
+
+		vk.DestroyDescriptorSetLayout(_orig, layout, nullptr);
+		_descriptor_set_layout_cache.erase(it);
+	}
+
+	return true;
 }
 
 void reshade::vulkan::device_impl::destroy_query_pool(api::query_pool handle)
@@ -1073,26 +1488,121 @@ void reshade::vulkan::device_impl::destroy_render_pass(api::render_pass handle)
 		return;
 	const auto pass_impl = reinterpret_cast<const render_pass_impl *>(handle.handle);
 
-	vk.DestroyRenderPass(_orig, pass_impl->render_pass, nullptr);
+	// The render pass object is shared with other compatible render passes (see 'create_render_pass'), so only the framebuffer is destroyed here
 	vk.DestroyFramebuffer(_orig, pass_impl->fbo, nullptr);
 
-	const std::lock_guard<std::mutex> lock(_mutex);
-	_render_pass_list.erase(pass_impl->render_pass);
 	_framebuffer_list.erase(pass_impl->fbo);
 
 	delete pass_impl;
 }
-void reshade::vulkan::device_impl::destroy_descriptor_sets(api::descriptor_set_layout, uint32_t count, const api::descriptor_set *sets)
+void reshade::vulkan::device_impl::destroy_descriptor_sets(api::descriptor_set_layout layout, uint32_t count, const api::descriptor_set *sets)
 {
-	vk.FreeDescriptorSets(_orig, _descriptor_pool, count, reinterpret_cast<const VkDescriptorSet *>(sets));
+	const std::lock_guard<std::mutex> lock(_descriptor_pool_mutex);
+
+	const auto layout_it = _descriptor_pools_by_layout.find((VkDescriptorSetLayout)layout.handle);
+	if (layout_it == _descriptor_pools_by_layout.end())
+	{
+		vk.FreeDescriptorSets(_orig, _descriptor_pool, count, reinterpret_cast<const VkDescriptorSet *>(sets));
+		return;
+	}
+
+	descriptor_pool_data &pool_data = *layout_it->second;
+
+	uint32_t num_sets = 0;
+	for (uint32_t i = 0; i < count; ++i)
+		num_sets += sets[i].handle != 0 ? 1 : 0;
+	if (num_sets == 0)
+		return;
+
+	// When these are the last sets of the layout (e.g. because the effects using it are unloaded), reset the pools as a whole instead of freeing every set separately
+	if (num_sets >= pool_data.live_sets.size())
+	{
+		reset_descriptor_pools(pool_data);
+		return;
+	}
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const auto set_it = pool_data.live_sets.find((VkDescriptorSet)sets[i].handle);
+		if (set_it == pool_data.live_sets.end())
+			continue;
+
+		vk.FreeDescriptorSets(_orig, set_it->second, 1, &set_it->first);
+		pool_data.live_sets.erase(set_it);
+	}
+
+	if (pool_data.live_sets.empty())
+		reset_descriptor_pools(pool_data);
 }
+void reshade::vulkan::device_impl::reset_descriptor_pools(descriptor_pool_data &data)
+{
+	data.live_sets.clear();
 
-void reshade::vulkan::device_impl::update_descriptor_sets(uint32_t num_writes, const api::descriptor_set_write *writes, uint32_t num_copies, const api::descriptor_set_copy *copies)
+	// If more than one pool was needed, replace them with a single one that fits all the sets that were allocated at once, so that the next load gets by without creating more pools
+	if (data.pools.size() > 1)
+	{
+		for (const VkDescriptorPool pool : data.pools)
+			vk.DestroyDescriptorPool(_orig, pool, nullptr);
+		data.pools.clear();
+
+		data.sets_per_pool = data.peak_live_sets;
+	}
+	else if (!data.pools.empty())
+	{
+		vk.ResetDescriptorPool(_orig, data.pools[0], 0);
+	}
+
+	data.peak_live_sets = 0;
+}
+
+bool reshade::vulkan::device_impl::create_command_list(api::command_list **out)
 {
-	std::vector<VkWriteDescriptorSet> writes_internal(num_writes);
+	if (_graphics_queue_family_index == std::numeric_limits<uint32_t>::max())
+	{
+		*out = nullptr;
+		return false;
+	}
+
+	// Immediate command lists already manage their own command pool and end, submit and begin themselves when flushed, which is exactly what is needed here
+	const auto cmd_list_impl = new command_list_immediate_impl(this, _graphics_queue_family_index);
+	if (cmd_list_impl->_orig == VK_NULL_HANDLE)
+	{
+		delete cmd_list_impl;
+
+		*out = nullptr;
+		return false;
+	}
 
-	std::vector<VkDescriptorImageInfo> image_info(num_writes);
-	std::vector<VkDescriptorBufferInfo> buffer_info(num_writes);
+	*out = cmd_list_impl;
+	return true;
+}
+void reshade::vulkan::device_impl::destroy_command_list(api::command_list *cmd_list)
+{
+	delete static_cast<command_list_immediate_impl *>(cmd_list);
+}
+
+void reshade::vulkan::device_impl::update_descriptor_sets(uint32_t num_writes, const api::descriptor_set_write *writes, uint32_t num_copies, const api::descriptor_set_copy *copies)
+{
+	// Translate into stack buffers for the common case of only a few writes, to avoid heap allocations on every call
+	VkWriteDescriptorSet writes_internal_stack[16];
+	VkDescriptorImageInfo image_info_stack[16];
+	VkDescriptorBufferInfo buffer_info_stack[16];
+	std::vector<VkWriteDescriptorSet> writes_internal_heap;
+	std::vector<VkDescriptorImageInfo> image_info_heap;
+	std::vector<VkDescriptorBufferInfo> buffer_info_heap;
+
+	VkWriteDescriptorSet *writes_internal = writes_internal_stack;
+	VkDescriptorImageInfo *image_info = image_info_stack;
+	VkDescriptorBufferInfo *buffer_info = buffer_info_stack;
+	if (num_writes > std::size(writes_internal_stack))
+	{
+		writes_internal_heap.resize(num_writes);
+		writes_internal = writes_internal_heap.data();
+		image_info_heap.resize(num_writes);
+		image_info = image_info_heap.data();
+		buffer_info_heap.resize(num_writes);
+		buffer_info = buffer_info_heap.data();
+	}
 
 	for (uint32_t i = 0; i < num_writes; ++i)
 	{
@@ -1126,7 +1636,15 @@ void reshade::vulkan::device_impl::update_descriptor_sets(uint32_t num_writes, c
 		}
 	}
 
-	std::vector<VkCopyDescriptorSet> copies_internal(num_copies);
+	VkCopyDescriptorSet copies_internal_stack[16];
+	std::vector<VkCopyDescriptorSet> copies_internal_heap;
+
+	VkCopyDescriptorSet *copies_internal = copies_internal_stack;
+	if (num_copies > std::size(copies_internal_stack))
+	{
+		copies_internal_heap.resize(num_copies);
+		copies_internal = copies_internal_heap.data();
+	}
 
 	for (uint32_t i = 0; i < num_copies; ++i)
 	{
@@ -1140,7 +1658,7 @@ void reshade::vulkan::device_impl::update_descriptor_sets(uint32_t num_writes, c
 		copies_internal[i].descriptorCount = copies[i].count;
 	}
 
-	vk.UpdateDescriptorSets(_orig, num_writes, writes_internal.data(), num_copies, copies_internal.data());
+	vk.UpdateDescriptorSets(_orig, num_writes, writes_internal, num_copies, copies_internal);
 }
 
 bool reshade::vulkan::device_impl::map_resource(api::resource resource, uint32_t subresource, api::map_access, void **data, uint32_t *row_pitch, uint32_t *slice_pitch)
@@ -1183,11 +1701,11 @@ void reshade::vulkan::device_impl::upload_buffer_region(const void *data, api::r
 		const auto immediate_command_list = static_cast<command_list_immediate_impl *>(queue->get_immediate_command_list());
 		if (immediate_command_list != nullptr)
 		{
-			immediate_command_list->_has_commands = true;
-
-			vk.CmdUpdateBuffer(immediate_command_list->_orig, (VkBuffer)dst.handle, dst_offset, size, data);
+			vk.CmdUpdateBuffer(immediate_command_list->begin_commands(), (VkBuffer)dst.handle, dst_offset, size, data);
 
-			immediate_command_list->flush_and_wait((VkQueue)queue->get_native_object());
+			// Data is copied into the command buffer when recording, so there is no need to wait for it to finish executing
+			std::vector<VkSemaphore> wait_semaphores;
+			immediate_command_list->flush((VkQueue)queue->get_native_object(), wait_semaphores);
 			break;
 		}
 	}
@@ -1207,9 +1725,11 @@ void reshade::vulkan::device_impl::upload_texture_region(const api::subresource_
 		extent.depth  = dst_box[5] - dst_box[2];
 	}
 
-	const auto row_size_packed = extent.width * api::format_bpp(convert_format(dst_data.image_create_info.format));
-	const auto slice_size_packed = extent.height * row_size_packed;
+	const auto row_size_packed = api::format_row_pitch(convert_format(dst_data.image_create_info.format), extent.width);
+	const auto slice_size_packed = api::format_slice_pitch(convert_format(dst_data.image_create_info.format), row_size_packed, extent.height);
 	const auto total_size = extent.depth * slice_size_packed;
+	// Block compressed formats store a row of 4x4 blocks per row
+	const auto num_rows = slice_size_packed / row_size_packed;
 
 	// Allocate host memory for upload
 	VkBuffer intermediate = VK_NULL_HANDLE;
@@ -1221,8 +1741,17 @@ void reshade::vulkan::device_impl::upload_texture_region(const api::subresource_
 
 		VmaAllocationCreateInfo alloc_info = {};
 		alloc_info.usage = VMA_MEMORY_USAGE_CPU_ONLY;
+		alloc_info.pool = _upload_pool;
 
-		if (vmaCreateBuffer(_alloc, &create_info, &alloc_info, &intermediate, &intermediate_mem, nullptr) != VK_SUCCESS)
+		VkResult res = vmaCreateBuffer(_alloc, &create_info, &alloc_info, &intermediate, &intermediate_mem, nullptr);
+		if (res != VK_SUCCESS && alloc_info.pool != VK_NULL_HANDLE)
+		{
+			// Fall back to a default allocation in case the upload pool is full (or the data does not fit into it at all)
+			alloc_info.pool = VK_NULL_HANDLE;
+			res = vmaCreateBuffer(_alloc, &create_info, &alloc_info, &intermediate, &intermediate_mem, nullptr);
+		}
+
+		if (res != VK_SUCCESS)
 		{
 			LOG(ERROR) << "Failed to create upload buffer!";
 			LOG(DEBUG) << "> Details: Width = " << create_info.size;
@@ -1234,7 +1763,7 @@ void reshade::vulkan::device_impl::upload_texture_region(const api::subresource_
 	uint8_t *mapped_data = nullptr;
 	if (vmaMapMemory(_alloc, intermediate_mem, reinterpret_cast<void **>(&mapped_data)) == VK_SUCCESS)
 	{
-		if ((row_size_packed == data.row_pitch || extent.height == 1) &&
+		if ((row_size_packed == data.row_pitch || num_rows == 1) &&
 			(slice_size_packed == data.slice_pitch || extent.depth == 1))
 		{
 			std::memcpy(mapped_data, data.data, total_size);
@@ -1242,7 +1771,7 @@ void reshade::vulkan::device_impl::upload_texture_region(const api::subresource_
 		else
 		{
 			for (uint32_t z = 0; z < extent.depth; ++z)
-				for (uint32_t y = 0; y < extent.height; ++y, mapped_data += row_size_packed)
+				for (uint32_t y = 0; y < num_rows; ++y, mapped_data += row_size_packed)
 					std::memcpy(mapped_data, static_cast<const uint8_t *>(data.data) + z * data.slice_pitch + y * data.row_pitch, row_size_packed);
 		}
 
@@ -1256,14 +1785,19 @@ void reshade::vulkan::device_impl::upload_texture_region(const api::subresource_
 			{
 				immediate_command_list->copy_buffer_to_texture({ (uint64_t)intermediate }, 0, 0, 0, dst, dst_subresource, dst_box);
 
-				// Wait for command to finish executing before destroying the upload buffer
-				immediate_command_list->flush_and_wait((VkQueue)queue->get_native_object());
+				// Submit without waiting for the copy to finish, the upload buffer is destroyed once the GPU is done with it
+				immediate_command_list->release_after_completion(intermediate, intermediate_mem);
+				intermediate = VK_NULL_HANDLE;
+
+				std::vector<VkSemaphore> wait_semaphores;
+				immediate_command_list->flush((VkQueue)queue->get_native_object(), wait_semaphores);
 				break;
 			}
 		}
 	}
 
-	vmaDestroyBuffer(_alloc, intermediate, intermediate_mem);
+	if (intermediate != VK_NULL_HANDLE)
+		vmaDestroyBuffer(_alloc, intermediate, intermediate_mem);
 }
 
 bool reshade::vulkan::device_impl::get_attachment(api::render_pass pass, api::attachment_type type, uint32_t index, api::resource_view *out) const
@@ -1271,45 +1805,55 @@ bool reshade::vulkan::device_impl::get_attachment(api::render_pass pass, api::at
 	assert(pass.handle != 0);
 	const auto pass_impl = reinterpret_cast<const render_pass_impl *>(pass.handle);
 
-	std::lock_guard<std::mutex> lock(_mutex);
-	const auto &info = _framebuffer_list.at(pass_impl->fbo);
-	const auto &pass_info = _render_pass_list.at(pass_impl->render_pass);
+	// Find the index of the requested attachment in the render pass first, then look it up in the framebuffer
+	const auto find_attachment_index = [type, index](const render_pass_data &pass_info) mutable {
+		assert(index <= pass_info.attachments.size());
 
-	assert(index <= pass_info.attachments.size());
-
-	for (uint32_t i = 0; i < pass_info.attachments.size(); ++i)
-	{
-		if (pass_info.attachments[i].format_flags & static_cast<VkImageAspectFlags>(type))
+		for (uint32_t i = 0; i < pass_info.attachments.size(); ++i)
 		{
-			if (index == 0)
+			if (pass_info.attachments[i].format_flags & static_cast<VkImageAspectFlags>(type))
 			{
-				*out = info.attachments[i];
-				return true;
-			}
-			else
-			{
-				index -= 1;
+				if (index == 0)
+					return i;
+				else
+					index -= 1;
 			}
 		}
+
+		return std::numeric_limits<uint32_t>::max();
+	};
+
+	// Render passes created through 'create_render_pass' carry their attachment information with them, so only need to look up those begun by the application
+	const bool has_local_data = !pass_impl->fbo_data.attachments.empty();
+
+	const uint32_t attachment_index = has_local_data ?
+		find_attachment_index(pass_impl->pass_data) : _render_pass_list.read(pass_impl->render_pass, find_attachment_index);
+
+	if (attachment_index == std::numeric_limits<uint32_t>::max())
+	{
+		*out = { 0 };
+		return false;
 	}
 
-	*out = { 0 };
-	return false;
+	*out = has_local_data ?
+		pass_impl->fbo_data.attachments[attachment_index] : _framebuffer_list.read(pass_impl->fbo, [attachment_index](const framebuffer_data &info) { return info.attachments[attachment_index]; });
+	return true;
 }
 uint32_t reshade::vulkan::device_impl::get_attachment_count(api::render_pass pass, api::attachment_type type) const
 {
 	assert(pass.handle != 0);
 	const auto pass_impl = reinterpret_cast<const render_pass_impl *>(pass.handle);
 
-	std::lock_guard<std::mutex> lock(_mutex);
-	const auto &pass_info = _render_pass_list.at(pass_impl->render_pass);
-
-	uint32_t count = 0;
-	for (uint32_t i = 0; i < pass_info.attachments.size(); ++i)
-		if (pass_info.attachments[i].format_flags & static_cast<VkImageAspectFlags>(type))
-			count++;
+	const auto count_attachments = [type](const render_pass_data &pass_info) {
+		uint32_t count = 0;
+		for (uint32_t i = 0; i < pass_info.attachments.size(); ++i)
+			if (pass_info.attachments[i].format_flags & static_cast<VkImageAspectFlags>(type))
+				count++;
+		return count;
+	};
 
-	return count;
+	return !pass_impl->fbo_data.attachments.empty() ?
+		count_attachments(pass_impl->pass_data) : _render_pass_list.read(pass_impl->render_pass, count_attachments);
 }
 
 void reshade::vulkan::device_impl::get_resource_from_view(api::resource_view view, api::resource *out) const
@@ -1324,12 +1868,22 @@ void reshade::vulkan::device_impl::get_resource_from_view(api::resource_view vie
 
 reshade::api::resource_desc reshade::vulkan::device_impl::get_resource_desc(api::resource resource) const
 {
+	api::resource_desc desc;
+	if (_resource_desc_cache.lookup(resource.handle, desc))
+		return desc;
+
+	// Cache the description (which never changes) until the resource is destroyed, to avoid taking the lock for subsequent queries
+	const uint64_t generation = _resource_desc_cache.generation();
 	const resource_data data = lookup_resource(resource);
 
 	if (data.is_image())
-		return convert_resource_desc(data.image_create_info);
+		desc = convert_resource_desc(data.image_create_info);
 	else
-		return convert_resource_desc(data.buffer_create_info);
+		desc = convert_resource_desc(data.buffer_create_info);
+
+	_resource_desc_cache.insert(resource.handle, desc, generation);
+
+	return desc;
 }
 
 bool reshade::vulkan::device_impl::get_query_pool_results(api::query_pool pool, uint32_t first, uint32_t count, void *results, uint32_t stride)
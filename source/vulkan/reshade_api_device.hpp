@@ -6,12 +6,17 @@
 #pragma once
 
 #include "addon_manager.hpp"
+#include "concurrent_map.hpp"
+#include "resource_desc_cache.hpp"
 #pragma warning(push)
 #pragma warning(disable: 4100 4127 4324 4703) // Disable a bunch of warnings thrown by VMA code
 #include <vk_mem_alloc.h>
 #pragma warning(pop)
 #include <vk_layer_dispatch_table.h>
+#include <map>
 #include <mutex>
+#include <tuple>
+#include <atomic>
 #include <cassert>
 #include <unordered_map>
 
@@ -74,9 +79,21 @@ namespace reshade::vulkan
 		std::vector<VkImageAspectFlags> attachment_types;
 	};
 
+	struct descriptor_pool_data
+	{
+		// Number of descriptors of each type a single set with the layout consists of
+		std::vector<VkDescriptorPoolSize> set_sizes;
+		std::vector<VkDescriptorPool> pools;
+		// Number of sets the pool created next should fit, which is learned from the highest number of sets that were allocated at once before
+		uint32_t sets_per_pool = 16;
+		uint32_t peak_live_sets = 0;
+		std::unordered_map<VkDescriptorSet, VkDescriptorPool> live_sets;
+	};
+
 	class device_impl : public api::api_object_impl<VkDevice, api::device>
 	{
 		friend class command_list_impl;
+		friend class command_list_immediate_impl;
 		friend class command_queue_impl;
 
 	public:
@@ -88,6 +105,9 @@ namespace reshade::vulkan
 		bool check_capability(api::device_caps capability) const final;
 		bool check_format_support(api::format format, api::resource_usage usage) const final;
 
+		bool get_memory_budget(uint64_t *budget, uint64_t *usage) const final;
+		uint64_t get_resource_memory_usage(api::resource_memory_owner owner, api::resource_memory_category category) const final;
+
 		bool is_resource_handle_valid(api::resource handle) const final;
 		bool is_resource_view_handle_valid(api::resource_view handle) const final;
 
@@ -118,6 +138,9 @@ namespace reshade::vulkan
 		void destroy_render_pass(api::render_pass handle) final;
 		void destroy_descriptor_sets(api::descriptor_set_layout layout, uint32_t count, const api::descriptor_set *sets) final;
 
+		bool create_command_list(api::command_list **out) final;
+		void destroy_command_list(api::command_list *cmd_list) final;
+
 		bool get_attachment(api::render_pass pass, api::attachment_type type, uint32_t index, api::resource_view *out) const final;
 		uint32_t get_attachment_count(api::render_pass pass, api::attachment_type type) const final;
 
@@ -140,11 +163,26 @@ namespace reshade::vulkan
 
 		void advance_transient_descriptor_pool();
 
+		/// <summary>
+		/// Creates the pipeline cache used for all pipelines created through this device and initializes it with previously serialized <paramref name="data"/>.
+		/// </summary>
+		void load_pipeline_cache(const std::vector<char> &data);
+		/// <summary>
+		/// Serializes the contents of the pipeline cache into <paramref name="data"/>.
+		/// </summary>
+		/// <returns>Returns whether there were any changes since the cache was loaded.</returns>
+		bool save_pipeline_cache(std::vector<char> &data);
+
+		/// <summary>
+		/// Gets a descriptor update template that pushes <paramref name="count"/> descriptors of the specified <paramref name="type"/>, starting at binding <paramref name="first"/> of a set in the specified pipeline layout.
+		/// Templates are created on first use and kept until the pipeline layout is destroyed. Returns <see langword="VK_NULL_HANDLE"/> if templates are not supported.
+		/// </summary>
+		VkDescriptorUpdateTemplate get_push_descriptor_template(VkPipelineBindPoint bind_point, VkPipelineLayout layout, uint32_t layout_index, VkDescriptorType type, uint32_t first, uint32_t count);
+
 #if RESHADE_ADDON
 		uint32_t get_subresource_index(VkImage image, const VkImageSubresourceLayers &layers, uint32_t layer = 0) const
 		{
-			const std::lock_guard<std::mutex> lock(_mutex);
-			return layers.mipLevel + (layers.baseArrayLayer + layer) * _resources.at((uint64_t)image).image_create_info.mipLevels;
+			return layers.mipLevel + (layers.baseArrayLayer + layer) * _resources.read((uint64_t)image, [](const resource_data &data) { return data.image_create_info.mipLevels; });
 		}
 
 		api::resource_view get_default_view(VkImage image)
@@ -158,23 +196,19 @@ namespace reshade::vulkan
 		resource_data lookup_resource(api::resource resource) const
 		{
 			assert(resource.handle != 0);
-			const std::lock_guard<std::mutex> lock(_mutex);
 			return _resources.at(resource.handle);
 		}
 		resource_view_data lookup_resource_view(api::resource_view view) const
 		{
 			assert(view.handle != 0);
-			const std::lock_guard<std::mutex> lock(_mutex);
 			return _views.at(view.handle);
 		}
 		render_pass_data lookup_render_pass(VkRenderPass pass) const
 		{
-			const std::lock_guard<std::mutex> lock(_mutex);
 			return _render_pass_list.at(pass);
 		}
 		framebuffer_data lookup_framebuffer(VkFramebuffer fbo) const
 		{
-			const std::lock_guard<std::mutex> lock(_mutex);
 			return _framebuffer_list.at(fbo);
 		}
 
@@ -186,7 +220,6 @@ namespace reshade::vulkan
 			data.allocation = allocation;
 			data.owned = owned;
 
-			const std::lock_guard<std::mutex> lock(_mutex);
 			_resources.emplace((uint64_t)image, std::move(data));
 		}
 		void register_image_view(VkImageView image_view, const VkImageViewCreateInfo &create_info, bool owned = false)
@@ -196,7 +229,6 @@ namespace reshade::vulkan
 			data.image_create_info = create_info;
 			data.owned = owned;
 
-			const std::lock_guard<std::mutex> lock(_mutex);
 			_views.emplace((uint64_t)image_view, std::move(data));
 		}
 		void register_buffer(VkBuffer buffer, const VkBufferCreateInfo &create_info, VmaAllocation allocation = VK_NULL_HANDLE, bool owned = false)
@@ -207,7 +239,6 @@ namespace reshade::vulkan
 			data.allocation = allocation;
 			data.owned = owned;
 
-			const std::lock_guard<std::mutex> lock(_mutex);
 			_resources.emplace((uint64_t)buffer, std::move(data));
 		}
 		void register_buffer_view(VkBufferView buffer_view, const VkBufferViewCreateInfo &create_info, bool owned = false)
@@ -217,48 +248,41 @@ namespace reshade::vulkan
 			data.buffer_create_info = create_info;
 			data.owned = owned;
 
-			const std::lock_guard<std::mutex> lock(_mutex);
 			_views.emplace((uint64_t)buffer_view, std::move(data));
 		}
 		void register_render_pass(VkRenderPass pass, render_pass_data &&data)
 		{
-			const std::lock_guard<std::mutex> lock(_mutex);
 			_render_pass_list.emplace(pass, std::move(data));
 		}
 		void register_framebuffer(VkFramebuffer fbo, framebuffer_data &&data)
 		{
-			const std::lock_guard<std::mutex> lock(_mutex);
 			_framebuffer_list.emplace(fbo, std::move(data));
 		}
 
 		void unregister_image(VkImage image)
 		{
-			const std::lock_guard<std::mutex> lock(_mutex);
 			_resources.erase((uint64_t)image);
+			_resource_desc_cache.erase((uint64_t)image);
 		}
 		void unregister_image_view(VkImageView image_view)
 		{
-			const std::lock_guard<std::mutex> lock(_mutex);
 			_views.erase((uint64_t)image_view);
 		}
 		void unregister_buffer(VkBuffer buffer)
 		{
-			const std::lock_guard<std::mutex> lock(_mutex);
 			_resources.erase((uint64_t)buffer);
+			_resource_desc_cache.erase((uint64_t)buffer);
 		}
 		void unregister_buffer_view(VkBufferView buffer_view)
 		{
-			const std::lock_guard<std::mutex> lock(_mutex);
 			_views.erase((uint64_t)buffer_view);
 		}
 		void unregister_render_pass(VkRenderPass pass)
 		{
-			const std::lock_guard<std::mutex> lock(_mutex);
 			_render_pass_list.erase(pass);
 		}
 		void unregister_framebuffer(VkFramebuffer fbo)
 		{
-			const std::lock_guard<std::mutex> lock(_mutex);
 			_framebuffer_list.erase(fbo);
 		}
 
@@ -269,6 +293,10 @@ namespace reshade::vulkan
 		uint32_t _graphics_queue_family_index = std::numeric_limits<uint32_t>::max();
 		std::vector<command_queue_impl *> _queues;
 		VkPhysicalDeviceFeatures _enabled_features = {};
+		bool _timeline_semaphore_ext = false;
+		bool _fragment_shading_rate_ext = false;
+		bool _synchronization2_ext = false;
+		bool _memory_budget_ext = false;
 
 #ifndef NDEBUG
 		mutable bool _wait_for_idle_happened = false;
@@ -276,16 +304,40 @@ namespace reshade::vulkan
 
 	private:
 		bool create_shader_module(VkShaderStageFlagBits stage, const api::shader_desc &desc, VkPipelineShaderStageCreateInfo &stage_info, VkSpecializationInfo &spec_info, std::vector<VkSpecializationMapEntry> &spec_map);
-
-		mutable std::mutex _mutex;
+		bool release_descriptor_set_layout(VkDescriptorSetLayout layout);
+		void reset_descriptor_pools(descriptor_pool_data &data);
 
 		VmaAllocator _alloc = nullptr;
-		std::unordered_map<uint64_t, resource_data> _resources;
-		std::unordered_map<uint64_t, resource_view_data> _views;
-
-		std::unordered_map<VkRenderPass, render_pass_data> _render_pass_list;
-		std::unordered_map<VkFramebuffer, framebuffer_data> _framebuffer_list;
-		std::unordered_map<VkPipelineLayout, std::vector<VkDescriptorSetLayout>> _pipeline_layout_list;
+		VmaPool _upload_pool = VK_NULL_HANDLE;
+		// Objects are created and looked up from many threads at once, so use sharded maps that do not serialize those operations behind a single lock
+		concurrent_map<uint64_t, resource_data> _resources;
+		mutable resource_desc_cache _resource_desc_cache;
+		concurrent_map<uint64_t, resource_view_data> _views;
+
+		concurrent_map<VkRenderPass, render_pass_data> _render_pass_list;
+		concurrent_map<VkFramebuffer, framebuffer_data> _framebuffer_list;
+		// Render pass objects created for 'create_render_pass', indexed by their attachment formats and sample counts
+		std::mutex _render_pass_cache_mutex;
+		std::map<std::vector<uint32_t>, VkRenderPass> _render_pass_cache;
+		concurrent_map<VkPipelineLayout, std::vector<VkDescriptorSetLayout>> _pipeline_layout_list;
+		// Descriptor update templates created for 'command_list_impl::push_descriptors', indexed by pipeline layout, set index, bind point, descriptor type, first binding and count
+		std::mutex _push_descriptor_template_mutex;
+		std::map<std::tuple<VkPipelineLayout, uint32_t, VkPipelineBindPoint, VkDescriptorType, uint32_t, uint32_t>, VkDescriptorUpdateTemplate> _push_descriptor_templates;
+		// Descriptor set layouts and pipeline layouts created for 'create_descriptor_set_layout' and 'create_pipeline_layout', indexed by their description, so that effects with identical layouts share them
+		// Each entry counts the references that were handed out, so that the object is only destroyed along with the last one
+		std::mutex _layout_cache_mutex;
+		std::map<std::vector<uint64_t>, std::pair<VkDescriptorSetLayout, uint32_t>> _descriptor_set_layout_cache;
+		std::map<std::vector<uint64_t>, std::pair<VkPipelineLayout, uint32_t>> _pipeline_layout_cache;
+		// Descriptor pools dedicated to a single set layout, indexed by the same description as the set layout cache above
+		// These outlive the set layout, so that an effect that is reloaded with the same layouts allocates its sets from the pools that were reset when it was unloaded
+		std::mutex _descriptor_pool_mutex;
+		std::map<std::vector<uint64_t>, descriptor_pool_data> _descriptor_pool_cache;
+		std::unordered_map<VkDescriptorSetLayout, descriptor_pool_data *> _descriptor_pools_by_layout;
+
+		VkPipelineCache _pipeline_cache = VK_NULL_HANDLE;
+		// Set by pipeline creation on any thread, even if the pipeline was found in the cache, so the serialized data is compared against the last loaded or saved one before writing it
+		std::atomic<bool> _pipeline_cache_dirty = false;
+		size_t _pipeline_cache_data_hash = 0;
 
 		VkDescriptorPool _descriptor_pool = VK_NULL_HANDLE;
 		VkDescriptorPool _transient_descriptor_pool[4] = {};
@@ -109,12 +109,21 @@ bool reshade::vulkan::swapchain_impl::on_init(VkSwapchainKHR swapchain, const Vk
 			return false;
 	}
 
+	// Initialize pipeline cache with the data from the previous session, so that effect pipelines do not have to be compiled again
+	{	std::vector<char> pipeline_cache_data;
+		load_pipeline_cache(pipeline_cache_data);
+		static_cast<device_impl *>(_device)->load_pipeline_cache(pipeline_cache_data);
+	}
+
 	return runtime::on_init(hwnd);
 }
 void reshade::vulkan::swapchain_impl::on_reset()
 {
 	runtime::on_reset();
 
+	if (std::vector<char> pipeline_cache_data; static_cast<device_impl *>(_device)->save_pipeline_cache(pipeline_cache_data))
+		save_pipeline_cache(pipeline_cache_data);
+
 	if (_orig == VK_NULL_HANDLE)
 		for (VkImage image : _swapchain_images)
 			static_cast<device_impl *>(_device)->destroy_resource(reinterpret_cast<api::resource &>(image));
@@ -129,6 +138,61 @@ void reshade::vulkan::swapchain_impl::on_reset()
 		semaphore = VK_NULL_HANDLE;
 }
 
+reshade::api::command_list *reshade::vulkan::swapchain_impl::begin_technique_recording()
+{
+	const auto immediate_cmd_list = static_cast<command_list_immediate_impl *>(_graphics_queue->get_immediate_command_list());
+
+	VkCommandBuffer cmd_buffer = VK_NULL_HANDLE;
+	if (!immediate_cmd_list->allocate_secondary_command_buffer(&cmd_buffer))
+		return nullptr;
+
+	// Not continuing a render pass, since techniques begin and finish their own render passes
+	VkCommandBufferInheritanceInfo inheritance_info { VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO };
+
+	VkCommandBufferBeginInfo begin_info { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+	// The recorded commands are executed again every frame, while executions of previous frames may still be pending
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+	begin_info.pInheritanceInfo = &inheritance_info;
+
+	if (vk.BeginCommandBuffer(cmd_buffer, &begin_info) != VK_SUCCESS)
+	{
+		immediate_cmd_list->release_after_completion(cmd_buffer);
+		return nullptr;
+	}
+
+	_recording_cmd_list = std::make_unique<command_list_impl>(static_cast<device_impl *>(_device), cmd_buffer);
+	_recording_cmd_list->_defer_barriers = true;
+	return _recording_cmd_list.get();
+}
+uint64_t reshade::vulkan::swapchain_impl::finish_technique_recording()
+{
+	assert(_recording_cmd_list != nullptr);
+
+	_recording_cmd_list->flush_barriers();
+
+	const VkCommandBuffer cmd_buffer = _recording_cmd_list->_orig;
+	_recording_cmd_list.reset();
+
+	if (vk.EndCommandBuffer(cmd_buffer) != VK_SUCCESS)
+	{
+		static_cast<command_list_immediate_impl *>(_graphics_queue->get_immediate_command_list())->release_after_completion(cmd_buffer);
+		return 0;
+	}
+
+	return reinterpret_cast<uintptr_t>(cmd_buffer);
+}
+void reshade::vulkan::swapchain_impl::execute_technique_recording(uint64_t recording)
+{
+	const VkCommandBuffer cmd_buffer = reinterpret_cast<VkCommandBuffer>(static_cast<uintptr_t>(recording));
+
+	vk.CmdExecuteCommands(static_cast<command_list_immediate_impl *>(_graphics_queue->get_immediate_command_list())->begin_commands(), 1, &cmd_buffer);
+}
+void reshade::vulkan::swapchain_impl::destroy_technique_recording(uint64_t recording)
+{
+	// The command buffer may still be referenced by immediate command buffers that were not executed yet, so have to wait for those to finish before freeing it
+	static_cast<command_list_immediate_impl *>(_graphics_queue->get_immediate_command_list())->release_after_completion(reinterpret_cast<VkCommandBuffer>(static_cast<uintptr_t>(recording)));
+}
+
 void reshade::vulkan::swapchain_impl::on_present(VkQueue queue, const uint32_t swapchain_image_index, std::vector<VkSemaphore> &wait)
 {
 	if (!is_initialized())
@@ -174,7 +238,7 @@ void reshade::vulkan::swapchain_impl::on_present(VkQueue queue, const uint32_t s
 		static_cast<command_queue_impl *>(_graphics_queue)->flush_immediate_command_list(wait);
 	}
 }
-bool reshade::vulkan::swapchain_impl::on_layer_submit(uint32_t eye, VkImage source, const VkExtent2D &source_extent, VkFormat source_format, VkSampleCountFlags source_samples, uint32_t source_layer_index, const float bounds[4], VkImage *target_image)
+bool reshade::vulkan::swapchain_impl::on_layer_submit(uint32_t eye, VkImage source, const VkExtent2D &source_extent, VkFormat source_format, VkSampleCountFlags source_samples, uint32_t source_layer_index, const float bounds[4], bool side_by_side, VkImage *target_image)
 {
 	assert(eye < 2 && source != VK_NULL_HANDLE);
 
@@ -189,7 +253,10 @@ bool reshade::vulkan::swapchain_impl::on_layer_submit(uint32_t eye, VkImage sour
 	}
 
 	VkExtent2D target_extent = { source_region_extent.width, source_region_extent.height };
-	target_extent.width *= 2;
+	if (side_by_side)
+		target_extent.width *= 2;
+
+	const int32_t target_x = side_by_side ? static_cast<int32_t>(eye * source_region_extent.width) : 0;
 
 	VkCommandBuffer cmd_list = VK_NULL_HANDLE;
 
@@ -257,7 +324,7 @@ bool reshade::vulkan::swapchain_impl::on_layer_submit(uint32_t eye, VkImage sour
 	{
 		const VkImageCopy copy_region = {
 			{ VK_IMAGE_ASPECT_COLOR_BIT, 0, source_layer_index, 1 }, source_region_offset,
-			{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 }, { static_cast<int32_t>(eye * source_region_extent.width), 0, 0 }, source_region_extent
+			{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 }, { target_x, 0, 0 }, source_region_extent
 		};
 		vk.CmdCopyImage(cmd_list, source, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, _swapchain_images[0], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy_region);
 	}
@@ -265,7 +332,7 @@ bool reshade::vulkan::swapchain_impl::on_layer_submit(uint32_t eye, VkImage sour
 	{
 		const VkImageResolve resolve_region = {
 			{ VK_IMAGE_ASPECT_COLOR_BIT, 0, source_layer_index, 1 }, source_region_offset,
-			{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 }, { static_cast<int32_t>(eye * source_region_extent.width), 0, 0 }, source_region_extent
+			{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 }, { target_x, 0, 0 }, source_region_extent
 		};
 		vk.CmdResolveImage(cmd_list, source, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, _swapchain_images[0], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &resolve_region);
 	}
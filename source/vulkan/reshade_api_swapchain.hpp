@@ -10,6 +10,7 @@
 namespace reshade::vulkan
 {
 	class device_impl;
+	class command_list_impl;
 	class command_queue_impl;
 
 	class swapchain_impl : public api::api_object_impl<VkSwapchainKHR, runtime>
@@ -28,14 +29,22 @@ namespace reshade::vulkan
 		bool on_init(VkSwapchainKHR swapchain, const VkSwapchainCreateInfoKHR &desc, HWND hwnd);
 		void on_reset();
 		void on_present(VkQueue queue, const uint32_t swapchain_image_index, std::vector<VkSemaphore> &wait);
-		bool on_layer_submit(uint32_t eye, VkImage source, const VkExtent2D &source_extent, VkFormat source_format, VkSampleCountFlags source_samples, uint32_t source_layer_index, const float bounds[4], VkImage *target_image);
+		bool on_layer_submit(uint32_t eye, VkImage source, const VkExtent2D &source_extent, VkFormat source_format, VkSampleCountFlags source_samples, uint32_t source_layer_index, const float bounds[4], bool side_by_side, VkImage *target_image);
 
 	private:
+		api::command_list *begin_technique_recording() final;
+		uint64_t finish_technique_recording() final;
+		void execute_technique_recording(uint64_t recording) final;
+		void destroy_technique_recording(uint64_t recording) final;
+
 		VkQueue  _queue = VK_NULL_HANDLE;
 		uint32_t _queue_sync_index = 0;
 		VkSemaphore _queue_sync_semaphores[NUM_SYNC_SEMAPHORES] = {};
 
 		uint32_t _swap_index = 0;
 		std::vector<VkImage> _swapchain_images;
+
+		// Wrapper around the secondary command buffer that a technique is currently being recorded into
+		std::unique_ptr<command_list_impl> _recording_cmd_list;
 	};
 }
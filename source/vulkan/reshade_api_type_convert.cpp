@@ -503,6 +503,72 @@ auto reshade::vulkan::convert_usage_to_pipeline_stage(api::resource_usage state,
 		result |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
 	return result;
 }
+auto reshade::vulkan::convert_usage_to_access2(api::resource_usage state) -> VkAccessFlags2KHR
+{
+	if (state == api::resource_usage::present || state == api::resource_usage::undefined)
+		return VK_ACCESS_2_NONE_KHR;
+	if (state == api::resource_usage::cpu_access)
+		return VK_ACCESS_2_HOST_READ_BIT_KHR | VK_ACCESS_2_HOST_WRITE_BIT_KHR;
+
+	VkAccessFlags2KHR result = VK_ACCESS_2_NONE_KHR;
+	if ((state & api::resource_usage::depth_stencil_read) != api::resource_usage::undefined)
+		result |= VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT_KHR;
+	if ((state & api::resource_usage::depth_stencil_write) != api::resource_usage::undefined)
+		result |= VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT_KHR;
+	if ((state & api::resource_usage::render_target) != api::resource_usage::undefined)
+		result |= VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT_KHR | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT_KHR;
+	if ((state & api::resource_usage::shader_resource) != api::resource_usage::undefined)
+		result |= VK_ACCESS_2_SHADER_SAMPLED_READ_BIT_KHR;
+	if ((state & api::resource_usage::unordered_access) != api::resource_usage::undefined)
+		result |= VK_ACCESS_2_SHADER_STORAGE_READ_BIT_KHR | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT_KHR;
+	if ((state & (api::resource_usage::copy_dest | api::resource_usage::resolve_dest)) != api::resource_usage::undefined)
+		result |= VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR;
+	if ((state & (api::resource_usage::copy_source | api::resource_usage::resolve_source)) != api::resource_usage::undefined)
+		result |= VK_ACCESS_2_TRANSFER_READ_BIT_KHR;
+	if ((state & api::resource_usage::index_buffer) != api::resource_usage::undefined)
+		result |= VK_ACCESS_2_INDEX_READ_BIT_KHR;
+	if ((state & api::resource_usage::vertex_buffer) != api::resource_usage::undefined)
+		result |= VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT_KHR;
+	if ((state & api::resource_usage::constant_buffer) != api::resource_usage::undefined)
+		result |= VK_ACCESS_2_UNIFORM_READ_BIT_KHR;
+	return result;
+}
+auto reshade::vulkan::convert_usage_to_pipeline_stage2(api::resource_usage state) -> VkPipelineStageFlags2KHR
+{
+	if (state == api::resource_usage::general)
+		return VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR;
+	if (state == api::resource_usage::present || state == api::resource_usage::undefined)
+		// Synchronization 2 allows to express that there is no execution dependency at all
+		return VK_PIPELINE_STAGE_2_NONE_KHR;
+	if (state == api::resource_usage::cpu_access)
+		return VK_PIPELINE_STAGE_2_HOST_BIT_KHR;
+
+	VkPipelineStageFlags2KHR result = VK_PIPELINE_STAGE_2_NONE_KHR;
+	if ((state & api::resource_usage::depth_stencil_read) != api::resource_usage::undefined)
+		result |= VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT_KHR;
+	if ((state & api::resource_usage::depth_stencil_write) != api::resource_usage::undefined)
+		result |= VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT_KHR;
+	if ((state & api::resource_usage::render_target) != api::resource_usage::undefined)
+		result |= VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR;
+	if ((state & (api::resource_usage::shader_resource_pixel | api::resource_usage::constant_buffer)) != api::resource_usage::undefined)
+		result |= VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR;
+	if ((state & (api::resource_usage::shader_resource_non_pixel | api::resource_usage::constant_buffer)) != api::resource_usage::undefined)
+		// This stage covers all shader stages before rasterization, without having to check which of them are supported by the device
+		result |= VK_PIPELINE_STAGE_2_PRE_RASTERIZATION_SHADERS_BIT_KHR | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR;
+	if ((state & api::resource_usage::unordered_access) != api::resource_usage::undefined)
+		result |= VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR;
+	if ((state & (api::resource_usage::copy_dest | api::resource_usage::copy_source)) != api::resource_usage::undefined)
+		result |= VK_PIPELINE_STAGE_2_COPY_BIT_KHR | VK_PIPELINE_STAGE_2_BLIT_BIT_KHR;
+	if ((state & api::resource_usage::copy_dest) != api::resource_usage::undefined)
+		result |= VK_PIPELINE_STAGE_2_CLEAR_BIT_KHR;
+	if ((state & (api::resource_usage::resolve_dest | api::resource_usage::resolve_source)) != api::resource_usage::undefined)
+		result |= VK_PIPELINE_STAGE_2_RESOLVE_BIT_KHR;
+	if ((state & api::resource_usage::index_buffer) != api::resource_usage::undefined)
+		result |= VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT_KHR;
+	if ((state & api::resource_usage::vertex_buffer) != api::resource_usage::undefined)
+		result |= VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT_KHR;
+	return result;
+}
 
 void reshade::vulkan::convert_usage_to_image_usage_flags(api::resource_usage usage, VkImageUsageFlags &image_flags)
 {
@@ -1258,6 +1324,9 @@ reshade::api::pipeline_desc reshade::vulkan::convert_pipeline_desc(const VkGraph
 			case VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_EXT:
 				desc.graphics.dynamic_states[k++] = api::dynamic_state::primitive_topology;
 				break;
+			case VK_DYNAMIC_STATE_FRAGMENT_SHADING_RATE_KHR:
+				desc.graphics.dynamic_states[k++] = api::dynamic_state::shading_rate;
+				break;
 			case VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT:
 				desc.graphics.dynamic_states[k++] = api::dynamic_state::depth_enable;
 				break;
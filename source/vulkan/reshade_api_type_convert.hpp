@@ -12,6 +12,10 @@ namespace reshade::vulkan
 		VkFramebuffer fbo;
 		VkRect2D render_area = {};
 		VkRenderPass render_pass;
+
+		// Render passes created through 'device_impl::create_render_pass' keep their attachment information here, so that it does not have to be looked up in the device lists (these are left empty for render passes begun by the application)
+		render_pass_data pass_data;
+		framebuffer_data fbo_data;
 	};
 
 	auto convert_format(api::format format) -> VkFormat;
@@ -25,6 +29,8 @@ namespace reshade::vulkan
 	auto convert_usage_to_access(api::resource_usage state) -> VkAccessFlags;
 	auto convert_usage_to_image_layout(api::resource_usage state) -> VkImageLayout;
 	auto convert_usage_to_pipeline_stage(api::resource_usage state, bool src_stage, const VkPhysicalDeviceFeatures &enabled_features) -> VkPipelineStageFlags;
+	auto convert_usage_to_access2(api::resource_usage state) -> VkAccessFlags2KHR;
+	auto convert_usage_to_pipeline_stage2(api::resource_usage state) -> VkPipelineStageFlags2KHR;
 
 	void convert_usage_to_image_usage_flags(api::resource_usage usage, VkImageUsageFlags &image_flags);
 	void convert_usage_to_buffer_usage_flags(api::resource_usage usage, VkBufferUsageFlags &buffer_flags);
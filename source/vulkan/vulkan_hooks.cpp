@@ -4,12 +4,12 @@
  */
 
 #include "hook_manager.hpp"
-#include "lockfree_table.hpp"
+#include "lockfree_hash_table.hpp"
 #include "vulkan_hooks.hpp"
 #include "reshade_api_device.hpp"
 
-extern lockfree_table<void *, VkLayerInstanceDispatchTable, 16> g_instance_dispatch;
-extern lockfree_table<void *, reshade::vulkan::device_impl *, 16>  g_vulkan_devices;
+extern lockfree_hash_table_of_values<void *, VkLayerInstanceDispatchTable, 6> g_instance_dispatch;
+extern lockfree_hash_table<void *, reshade::vulkan::device_impl *, 6>  g_vulkan_devices;
 
 #define HOOK_PROC(name) \
 	if (0 == strcmp(pName, "vk" #name)) \
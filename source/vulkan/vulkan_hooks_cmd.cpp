@@ -5,14 +5,24 @@
 
 #include "dll_log.hpp"
 #include "hook_manager.hpp"
-#include "lockfree_table.hpp"
+#include "lockfree_hash_table.hpp"
+#include "profiling.hpp"
 #include "vulkan_hooks.hpp"
 #include "reshade_api_device.hpp"
 #include "reshade_api_command_list.hpp"
 #include "reshade_api_type_convert.hpp"
 
-extern lockfree_table<void *, reshade::vulkan::device_impl *, 16> g_vulkan_devices;
-lockfree_table<VkCommandBuffer, reshade::vulkan::command_list_impl *, 4096> g_vulkan_command_buffers;
+extern lockfree_hash_table<void *, reshade::vulkan::device_impl *, 6> g_vulkan_devices;
+lockfree_hash_table<VkCommandBuffer, reshade::vulkan::command_list_impl *> g_vulkan_command_buffers;
+
+#if RESHADE_ADDON
+// Only look up the command list when an add-on registered a callback for the event, since these hooks are called for every recorded command
+template <reshade::addon_event ev>
+static inline reshade::vulkan::command_list_impl *lookup_command_list(VkCommandBuffer commandBuffer)
+{
+	return reshade::has_addon_event<ev>() ? g_vulkan_command_buffers.at(commandBuffer) : nullptr;
+}
+#endif
 
 #define GET_DISPATCH_PTR(name, object) \
 	GET_DISPATCH_PTR_FROM(name, g_vulkan_devices.at(dispatch_key_from_handle(object)))
@@ -24,7 +34,7 @@ lockfree_table<VkCommandBuffer, reshade::vulkan::command_list_impl *, 4096> g_vu
 VkResult VKAPI_CALL vkBeginCommandBuffer(VkCommandBuffer commandBuffer, const VkCommandBufferBeginInfo *pBeginInfo)
 {
 #if RESHADE_ADDON
-	if (reshade::vulkan::command_list_impl *const cmd_impl = g_vulkan_command_buffers.at(commandBuffer); cmd_impl != nullptr)
+	if (reshade::vulkan::command_list_impl *const cmd_impl = lookup_command_list<reshade::addon_event::reset_command_list>(commandBuffer); cmd_impl != nullptr)
 	{
 		// Begin does perform an implicit reset if command pool was created with 'VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT'
 		reshade::invoke_addon_event<reshade::addon_event::reset_command_list>(cmd_impl);
@@ -41,7 +51,9 @@ void     VKAPI_CALL vkCmdBindPipeline(VkCommandBuffer commandBuffer, VkPipelineB
 	trampoline(commandBuffer, pipelineBindPoint, pipeline);
 
 #if RESHADE_ADDON
-	if (reshade::vulkan::command_list_impl *const cmd_impl = g_vulkan_command_buffers.at(commandBuffer); cmd_impl != nullptr)
+	RESHADE_PROFILE_CALL("vkCmdBindPipeline");
+
+	if (reshade::vulkan::command_list_impl *const cmd_impl = lookup_command_list<reshade::addon_event::bind_pipeline>(commandBuffer); cmd_impl != nullptr)
 	{
 		reshade::invoke_addon_event<reshade::addon_event::bind_pipeline>(
 			cmd_impl,
@@ -57,7 +69,7 @@ void     VKAPI_CALL vkCmdSetViewport(VkCommandBuffer commandBuffer, uint32_t fir
 	trampoline(commandBuffer, firstViewport, viewportCount, pViewports);
 
 #if RESHADE_ADDON
-	if (reshade::vulkan::command_list_impl *const cmd_impl = g_vulkan_command_buffers.at(commandBuffer); cmd_impl != nullptr)
+	if (reshade::vulkan::command_list_impl *const cmd_impl = lookup_command_list<reshade::addon_event::bind_viewports>(commandBuffer); cmd_impl != nullptr)
 	{
 		static_assert(sizeof(*pViewports) == (sizeof(float) * 6));
 
@@ -72,7 +84,7 @@ void     VKAPI_CALL vkCmdSetScissor(VkCommandBuffer commandBuffer, uint32_t firs
 	trampoline(commandBuffer, firstScissor, scissorCount, pScissors);
 
 #if RESHADE_ADDON
-	if (reshade::vulkan::command_list_impl *const cmd_impl = g_vulkan_command_buffers.at(commandBuffer); cmd_impl != nullptr)
+	if (reshade::vulkan::command_list_impl *const cmd_impl = lookup_command_list<reshade::addon_event::bind_scissor_rects>(commandBuffer); cmd_impl != nullptr)
 	{
 		const auto rect_data = static_cast<int32_t *>(alloca(sizeof(int32_t) * 4 * scissorCount));
 		for (uint32_t i = 0, k = 0; i < scissorCount; ++i, k += 4)
@@ -95,7 +107,7 @@ void     VKAPI_CALL vkCmdSetDepthBias(VkCommandBuffer commandBuffer, float depth
 	trampoline(commandBuffer, depthBiasConstantFactor, depthBiasClamp, depthBiasSlopeFactor);
 
 #if RESHADE_ADDON
-	if (reshade::vulkan::command_list_impl *const cmd_impl = g_vulkan_command_buffers.at(commandBuffer); cmd_impl != nullptr)
+	if (reshade::vulkan::command_list_impl *const cmd_impl = lookup_command_list<reshade::addon_event::bind_pipeline_states>(commandBuffer); cmd_impl != nullptr)
 	{
 		const reshade::api::dynamic_state states[3] = { reshade::api::dynamic_state::depth_bias, reshade::api::dynamic_state::depth_bias_clamp, reshade::api::dynamic_state::depth_bias_slope_scaled };
 		const uint32_t values[3] = { *reinterpret_cast<const uint32_t *>(&depthBiasConstantFactor), *reinterpret_cast<const uint32_t *>(&depthBiasClamp), *reinterpret_cast<const uint32_t *>(&depthBiasSlopeFactor) };
@@ -113,7 +125,7 @@ void     VKAPI_CALL vkCmdSetBlendConstants(VkCommandBuffer commandBuffer, const
 #if RESHADE_ADDON
 	assert(blendConstants != nullptr);
 
-	if (reshade::vulkan::command_list_impl *const cmd_impl = g_vulkan_command_buffers.at(commandBuffer); cmd_impl != nullptr)
+	if (reshade::vulkan::command_list_impl *const cmd_impl = lookup_command_list<reshade::addon_event::bind_pipeline_states>(commandBuffer); cmd_impl != nullptr)
 	{
 		const reshade::api::dynamic_state state = reshade::api::dynamic_state::blend_constant;
 		const uint32_t value =
@@ -135,7 +147,7 @@ void     VKAPI_CALL vkCmdSetStencilCompareMask(VkCommandBuffer commandBuffer, Vk
 	if (faceMask != VK_STENCIL_FACE_FRONT_AND_BACK)
 		return;
 
-	if (reshade::vulkan::command_list_impl *const cmd_impl = g_vulkan_command_buffers.at(commandBuffer); cmd_impl != nullptr)
+	if (reshade::vulkan::command_list_impl *const cmd_impl = lookup_command_list<reshade::addon_event::bind_pipeline_states>(commandBuffer); cmd_impl != nullptr)
 	{
 		const reshade::api::dynamic_state state = reshade::api::dynamic_state::stencil_read_mask;
 
@@ -152,7 +164,7 @@ void     VKAPI_CALL vkCmdSetStencilWriteMask(VkCommandBuffer commandBuffer, VkSt
 	if (faceMask != VK_STENCIL_FACE_FRONT_AND_BACK)
 		return;
 
-	if (reshade::vulkan::command_list_impl *const cmd_impl = g_vulkan_command_buffers.at(commandBuffer); cmd_impl != nullptr)
+	if (reshade::vulkan::command_list_impl *const cmd_impl = lookup_command_list<reshade::addon_event::bind_pipeline_states>(commandBuffer); cmd_impl != nullptr)
 	{
 		const reshade::api::dynamic_state state = reshade::api::dynamic_state::stencil_write_mask;
 
@@ -169,7 +181,7 @@ void     VKAPI_CALL vkCmdSetStencilReference(VkCommandBuffer commandBuffer, VkSt
 	if (faceMask != VK_STENCIL_FACE_FRONT_AND_BACK)
 		return;
 
-	if (reshade::vulkan::command_list_impl *const cmd_impl = g_vulkan_command_buffers.at(commandBuffer); cmd_impl != nullptr)
+	if (reshade::vulkan::command_list_impl *const cmd_impl = lookup_command_list<reshade::addon_event::bind_pipeline_states>(commandBuffer); cmd_impl != nullptr)
 	{
 		const reshade::api::dynamic_state state = reshade::api::dynamic_state::stencil_reference_value;
 
@@ -184,7 +196,9 @@ void     VKAPI_CALL vkCmdBindDescriptorSets(VkCommandBuffer commandBuffer, VkPip
 	trampoline(commandBuffer, pipelineBindPoint, layout, firstSet, descriptorSetCount, pDescriptorSets, dynamicOffsetCount, pDynamicOffsets);
 
 #if RESHADE_ADDON
-	if (reshade::vulkan::command_list_impl *const cmd_impl = g_vulkan_command_buffers.at(commandBuffer); cmd_impl != nullptr)
+	RESHADE_PROFILE_CALL("vkCmdBindDescriptorSets");
+
+	if (reshade::vulkan::command_list_impl *const cmd_impl = lookup_command_list<reshade::addon_event::bind_descriptor_sets>(commandBuffer); cmd_impl != nullptr)
 	{
 		static_assert(sizeof(*pDescriptorSets) == sizeof(reshade::api::descriptor_set));
 
@@ -205,7 +219,7 @@ void     VKAPI_CALL vkCmdBindIndexBuffer(VkCommandBuffer commandBuffer, VkBuffer
 	trampoline(commandBuffer, buffer, offset, indexType);
 
 #if RESHADE_ADDON
-	if (reshade::vulkan::command_list_impl *const cmd_impl = g_vulkan_command_buffers.at(commandBuffer); cmd_impl != nullptr)
+	if (reshade::vulkan::command_list_impl *const cmd_impl = lookup_command_list<reshade::addon_event::bind_index_buffer>(commandBuffer); cmd_impl != nullptr)
 	{
 		reshade::invoke_addon_event<reshade::addon_event::bind_index_buffer>(
 			cmd_impl, reshade::api::resource { (uint64_t)buffer }, offset, indexType == VK_INDEX_TYPE_UINT8_EXT ? 1 : indexType == VK_INDEX_TYPE_UINT16 ? 2 : 4);
@@ -218,7 +232,9 @@ void     VKAPI_CALL vkCmdBindVertexBuffers(VkCommandBuffer commandBuffer, uint32
 	trampoline(commandBuffer, firstBinding, bindingCount, pBuffers, pOffsets);
 
 #if RESHADE_ADDON
-	if (reshade::vulkan::command_list_impl *const cmd_impl = g_vulkan_command_buffers.at(commandBuffer); cmd_impl != nullptr)
+	RESHADE_PROFILE_CALL("vkCmdBindVertexBuffers");
+
+	if (reshade::vulkan::command_list_impl *const cmd_impl = lookup_command_list<reshade::addon_event::bind_vertex_buffers>(commandBuffer); cmd_impl != nullptr)
 	{
 		static_assert(sizeof(*pBuffers) == sizeof(reshade::api::resource));
 
@@ -231,11 +247,15 @@ void     VKAPI_CALL vkCmdBindVertexBuffers(VkCommandBuffer commandBuffer, uint32
 void     VKAPI_CALL vkCmdDraw(VkCommandBuffer commandBuffer, uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance)
 {
 #if RESHADE_ADDON
-	if (reshade::vulkan::command_list_impl *const cmd_impl = g_vulkan_command_buffers.at(commandBuffer); cmd_impl != nullptr)
 	{
-		if (reshade::invoke_addon_event<reshade::addon_event::draw>(
-			cmd_impl, vertexCount, instanceCount, firstVertex, firstInstance))
-			return;
+		RESHADE_PROFILE_CALL("vkCmdDraw");
+
+		if (reshade::vulkan::command_list_impl *const cmd_impl = lookup_command_list<reshade::addon_event::draw>(commandBuffer); cmd_impl != nullptr)
+		{
+			if (reshade::invoke_addon_event<reshade::addon_event::draw>(
+				cmd_impl, vertexCount, instanceCount, firstVertex, firstInstance))
+				return;
+		}
 	}
 #endif
 
@@ -245,11 +265,15 @@ void     VKAPI_CALL vkCmdDraw(VkCommandBuffer commandBuffer, uint32_t vertexCoun
 void     VKAPI_CALL vkCmdDrawIndexed(VkCommandBuffer commandBuffer, uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance)
 {
 #if RESHADE_ADDON
-	if (reshade::vulkan::command_list_impl *const cmd_impl = g_vulkan_command_buffers.at(commandBuffer); cmd_impl != nullptr)
 	{
-		if (reshade::invoke_addon_event<reshade::addon_event::draw_indexed>(
-			cmd_impl, indexCount, instanceCount, firstIndex, vertexOffset, firstInstance))
-			return;
+		RESHADE_PROFILE_CALL("vkCmdDrawIndexed");
+
+		if (reshade::vulkan::command_list_impl *const cmd_impl = lookup_command_list<reshade::addon_event::draw_indexed>(commandBuffer); cmd_impl != nullptr)
+		{
+			if (reshade::invoke_addon_event<reshade::addon_event::draw_indexed>(
+				cmd_impl, indexCount, instanceCount, firstIndex, vertexOffset, firstInstance))
+				return;
+		}
 	}
 #endif
 
@@ -259,7 +283,7 @@ void     VKAPI_CALL vkCmdDrawIndexed(VkCommandBuffer commandBuffer, uint32_t ind
 void     VKAPI_CALL vkCmdDrawIndirect(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount, uint32_t stride)
 {
 #if RESHADE_ADDON
-	if (reshade::vulkan::command_list_impl *const cmd_impl = g_vulkan_command_buffers.at(commandBuffer); cmd_impl != nullptr)
+	if (reshade::vulkan::command_list_impl *const cmd_impl = lookup_command_list<reshade::addon_event::draw_or_dispatch_indirect>(commandBuffer); cmd_impl != nullptr)
 	{
 		if (reshade::invoke_addon_event<reshade::addon_event::draw_or_dispatch_indirect>(
 			cmd_impl, reshade::api::indirect_command::draw, reshade::api::resource { (uint64_t)buffer }, offset, drawCount, stride))
@@ -273,7 +297,7 @@ void     VKAPI_CALL vkCmdDrawIndirect(VkCommandBuffer commandBuffer, VkBuffer bu
 void     VKAPI_CALL vkCmdDrawIndexedIndirect(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount, uint32_t stride)
 {
 #if RESHADE_ADDON
-	if (reshade::vulkan::command_list_impl *const cmd_impl = g_vulkan_command_buffers.at(commandBuffer); cmd_impl != nullptr)
+	if (reshade::vulkan::command_list_impl *const cmd_impl = lookup_command_list<reshade::addon_event::draw_or_dispatch_indirect>(commandBuffer); cmd_impl != nullptr)
 	{
 		if (reshade::invoke_addon_event<reshade::addon_event::draw_or_dispatch_indirect>(
 			cmd_impl, reshade::api::indirect_command::draw_indexed, reshade::api::resource { (uint64_t)buffer }, offset, drawCount, stride))
@@ -287,11 +311,15 @@ void     VKAPI_CALL vkCmdDrawIndexedIndirect(VkCommandBuffer commandBuffer, VkBu
 void     VKAPI_CALL vkCmdDispatch(VkCommandBuffer commandBuffer, uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ)
 {
 #if RESHADE_ADDON
-	if (reshade::vulkan::command_list_impl *const cmd_impl = g_vulkan_command_buffers.at(commandBuffer); cmd_impl != nullptr)
 	{
-		if (reshade::invoke_addon_event<reshade::addon_event::dispatch>(
-			cmd_impl, groupCountX, groupCountY, groupCountZ))
-			return;
+		RESHADE_PROFILE_CALL("vkCmdDispatch");
+
+		if (reshade::vulkan::command_list_impl *const cmd_impl = lookup_command_list<reshade::addon_event::dispatch>(commandBuffer); cmd_impl != nullptr)
+		{
+			if (reshade::invoke_addon_event<reshade::addon_event::dispatch>(
+				cmd_impl, groupCountX, groupCountY, groupCountZ))
+				return;
+		}
 	}
 #endif
 
@@ -301,7 +329,7 @@ void     VKAPI_CALL vkCmdDispatch(VkCommandBuffer commandBuffer, uint32_t groupC
 void     VKAPI_CALL vkCmdDispatchIndirect(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset)
 {
 #if RESHADE_ADDON
-	if (reshade::vulkan::command_list_impl *const cmd_impl = g_vulkan_command_buffers.at(commandBuffer); cmd_impl != nullptr)
+	if (reshade::vulkan::command_list_impl *const cmd_impl = lookup_command_list<reshade::addon_event::draw_or_dispatch_indirect>(commandBuffer); cmd_impl != nullptr)
 	{
 		if (reshade::invoke_addon_event<reshade::addon_event::draw_or_dispatch_indirect>(
 			cmd_impl, reshade::api::indirect_command::dispatch, reshade::api::resource { (uint64_t)buffer }, offset, 1, 0))
@@ -316,7 +344,7 @@ void     VKAPI_CALL vkCmdDispatchIndirect(VkCommandBuffer commandBuffer, VkBuffe
 void     VKAPI_CALL vkCmdCopyBuffer(VkCommandBuffer commandBuffer, VkBuffer srcBuffer, VkBuffer dstBuffer, uint32_t regionCount, const VkBufferCopy *pRegions)
 {
 #if RESHADE_ADDON
-	if (reshade::vulkan::command_list_impl *const cmd_impl = g_vulkan_command_buffers.at(commandBuffer); cmd_impl != nullptr)
+	if (reshade::vulkan::command_list_impl *const cmd_impl = lookup_command_list<reshade::addon_event::copy_buffer_region>(commandBuffer); cmd_impl != nullptr)
 	{
 		for (uint32_t i = 0; i < regionCount; ++i)
 		{
@@ -337,7 +365,7 @@ void     VKAPI_CALL vkCmdCopyBuffer(VkCommandBuffer commandBuffer, VkBuffer srcB
 void     VKAPI_CALL vkCmdCopyImage(VkCommandBuffer commandBuffer, VkImage srcImage, VkImageLayout srcImageLayout, VkImage dstImage, VkImageLayout dstImageLayout, uint32_t regionCount, const VkImageCopy *pRegions)
 {
 #if RESHADE_ADDON
-	if (reshade::vulkan::command_list_impl *const cmd_impl = g_vulkan_command_buffers.at(commandBuffer); cmd_impl != nullptr)
+	if (reshade::vulkan::command_list_impl *const cmd_impl = lookup_command_list<reshade::addon_event::copy_texture_region>(commandBuffer); cmd_impl != nullptr)
 	{
 		const auto device_impl = static_cast<reshade::vulkan::device_impl *>(cmd_impl->get_device());
 
@@ -381,7 +409,7 @@ void     VKAPI_CALL vkCmdCopyImage(VkCommandBuffer commandBuffer, VkImage srcIma
 void     VKAPI_CALL vkCmdBlitImage(VkCommandBuffer commandBuffer, VkImage srcImage, VkImageLayout srcImageLayout, VkImage dstImage, VkImageLayout dstImageLayout, uint32_t regionCount, const VkImageBlit *pRegions, VkFilter filter)
 {
 #if RESHADE_ADDON
-	if (reshade::vulkan::command_list_impl *const cmd_impl = g_vulkan_command_buffers.at(commandBuffer); cmd_impl != nullptr)
+	if (reshade::vulkan::command_list_impl *const cmd_impl = lookup_command_list<reshade::addon_event::copy_texture_region>(commandBuffer); cmd_impl != nullptr)
 	{
 		const auto device_impl = static_cast<reshade::vulkan::device_impl *>(cmd_impl->get_device());
 
@@ -408,7 +436,7 @@ void     VKAPI_CALL vkCmdBlitImage(VkCommandBuffer commandBuffer, VkImage srcIma
 void     VKAPI_CALL vkCmdCopyBufferToImage(VkCommandBuffer commandBuffer, VkBuffer srcBuffer, VkImage dstImage, VkImageLayout dstImageLayout, uint32_t regionCount, const VkBufferImageCopy *pRegions)
 {
 #if RESHADE_ADDON
-	if (reshade::vulkan::command_list_impl *const cmd_impl = g_vulkan_command_buffers.at(commandBuffer); cmd_impl != nullptr)
+	if (reshade::vulkan::command_list_impl *const cmd_impl = lookup_command_list<reshade::addon_event::copy_buffer_to_texture>(commandBuffer); cmd_impl != nullptr)
 	{
 		const auto device_impl = static_cast<reshade::vulkan::device_impl *>(cmd_impl->get_device());
 
@@ -444,7 +472,7 @@ void     VKAPI_CALL vkCmdCopyBufferToImage(VkCommandBuffer commandBuffer, VkBuff
 void     VKAPI_CALL vkCmdCopyImageToBuffer(VkCommandBuffer commandBuffer, VkImage srcImage, VkImageLayout srcImageLayout, VkBuffer dstBuffer, uint32_t regionCount, const VkBufferImageCopy *pRegions)
 {
 #if RESHADE_ADDON
-	if (reshade::vulkan::command_list_impl *const cmd_impl = g_vulkan_command_buffers.at(commandBuffer); cmd_impl != nullptr)
+	if (reshade::vulkan::command_list_impl *const cmd_impl = lookup_command_list<reshade::addon_event::copy_texture_to_buffer>(commandBuffer); cmd_impl != nullptr)
 	{
 		const auto device_impl = static_cast<reshade::vulkan::device_impl *>(cmd_impl->get_device());
 
@@ -481,7 +509,7 @@ void     VKAPI_CALL vkCmdCopyImageToBuffer(VkCommandBuffer commandBuffer, VkImag
 void     VKAPI_CALL vkCmdClearColorImage(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout imageLayout, const VkClearColorValue *pColor, uint32_t rangeCount, const VkImageSubresourceRange *pRanges)
 {
 #if RESHADE_ADDON
-	if (reshade::vulkan::command_list_impl *const cmd_impl = g_vulkan_command_buffers.at(commandBuffer); cmd_impl != nullptr)
+	if (reshade::vulkan::command_list_impl *const cmd_impl = lookup_command_list<reshade::addon_event::clear_render_target_view>(commandBuffer); cmd_impl != nullptr)
 	{
 		const auto device_impl = static_cast<reshade::vulkan::device_impl *>(cmd_impl->get_device());
 
@@ -526,7 +554,7 @@ void     VKAPI_CALL vkCmdClearColorImage(VkCommandBuffer commandBuffer, VkImage
 void     VKAPI_CALL vkCmdClearDepthStencilImage(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout imageLayout, const VkClearDepthStencilValue *pDepthStencil, uint32_t rangeCount, const VkImageSubresourceRange *pRanges)
 {
 #if RESHADE_ADDON
-	if (reshade::vulkan::command_list_impl *const cmd_impl = g_vulkan_command_buffers.at(commandBuffer); cmd_impl != nullptr)
+	if (reshade::vulkan::command_list_impl *const cmd_impl = lookup_command_list<reshade::addon_event::clear_depth_stencil_view>(commandBuffer); cmd_impl != nullptr)
 	{
 		const auto device_impl = static_cast<reshade::vulkan::device_impl *>(cmd_impl->get_device());
 
@@ -573,7 +601,7 @@ void     VKAPI_CALL vkCmdClearDepthStencilImage(VkCommandBuffer commandBuffer, V
 void     VKAPI_CALL vkCmdClearAttachments(VkCommandBuffer commandBuffer, uint32_t attachmentCount, const VkClearAttachment *pAttachments, uint32_t rectCount, const VkClearRect *pRects)
 {
 #if RESHADE_ADDON
-	if (reshade::vulkan::command_list_impl *const cmd_impl = g_vulkan_command_buffers.at(commandBuffer); cmd_impl != nullptr)
+	if (reshade::vulkan::command_list_impl *const cmd_impl = lookup_command_list<reshade::addon_event::clear_attachments>(commandBuffer); cmd_impl != nullptr)
 	{
 		VkClearColorValue clear_color = {};
 		VkClearDepthStencilValue clear_depth_stencil = {};
@@ -616,7 +644,7 @@ void     VKAPI_CALL vkCmdClearAttachments(VkCommandBuffer commandBuffer, uint32_
 void     VKAPI_CALL vkCmdResolveImage(VkCommandBuffer commandBuffer, VkImage srcImage, VkImageLayout srcImageLayout, VkImage dstImage, VkImageLayout dstImageLayout, uint32_t regionCount, const VkImageResolve *pRegions)
 {
 #if RESHADE_ADDON
-	if (reshade::vulkan::command_list_impl *const cmd_impl = g_vulkan_command_buffers.at(commandBuffer); cmd_impl != nullptr)
+	if (reshade::vulkan::command_list_impl *const cmd_impl = lookup_command_list<reshade::addon_event::resolve_texture_region>(commandBuffer); cmd_impl != nullptr)
 	{
 		const auto device_impl = static_cast<reshade::vulkan::device_impl *>(cmd_impl->get_device());
 
@@ -663,9 +691,11 @@ void     VKAPI_CALL vkCmdPipelineBarrier(VkCommandBuffer commandBuffer, VkPipeli
 	trampoline(commandBuffer, srcStageMask, dstStageMask, dependencyFlags, memoryBarrierCount, pMemoryBarriers, bufferMemoryBarrierCount, pBufferMemoryBarriers, imageMemoryBarrierCount, pImageMemoryBarriers);
 
 #if RESHADE_ADDON
+	RESHADE_PROFILE_CALL("vkCmdPipelineBarrier");
+
 	const uint32_t num_barriers = bufferMemoryBarrierCount + imageMemoryBarrierCount;
 
-	if (reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::barrier)].empty() || num_barriers == 0)
+	if (!reshade::has_addon_event<reshade::addon_event::barrier>() || num_barriers == 0)
 		return;
 
 	if (reshade::vulkan::command_list_impl *const cmd_impl = g_vulkan_command_buffers.at(commandBuffer); cmd_impl != nullptr)
@@ -704,7 +734,9 @@ void     VKAPI_CALL vkCmdPushConstants(VkCommandBuffer commandBuffer, VkPipeline
 	trampoline(commandBuffer, layout, stageFlags, offset, size, pValues);
 
 #if RESHADE_ADDON
-	if (reshade::vulkan::command_list_impl *const cmd_impl = g_vulkan_command_buffers.at(commandBuffer); cmd_impl != nullptr)
+	RESHADE_PROFILE_CALL("vkCmdPushConstants");
+
+	if (reshade::vulkan::command_list_impl *const cmd_impl = lookup_command_list<reshade::addon_event::push_constants>(commandBuffer); cmd_impl != nullptr)
 	{
 		reshade::invoke_addon_event<reshade::addon_event::push_constants>(
 			cmd_impl,
@@ -725,7 +757,7 @@ void     VKAPI_CALL vkCmdBeginRenderPass(VkCommandBuffer commandBuffer, const Vk
 	// Use clear events with explicit resource view references here, since this is invoked before render pass begin
 	if (cmd_impl != nullptr &&
 		pRenderPassBegin->clearValueCount != 0 && (
-			!reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::clear_depth_stencil_view)].empty() || !reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::clear_render_target_view)].empty()))
+			reshade::has_addon_event<reshade::addon_event::clear_depth_stencil_view>() || reshade::has_addon_event<reshade::addon_event::clear_render_target_view>()))
 	{
 		const auto device_impl = static_cast<reshade::vulkan::device_impl *>(cmd_impl->get_device());
 
@@ -804,6 +836,7 @@ void     VKAPI_CALL vkCmdBeginRenderPass(VkCommandBuffer commandBuffer, const Vk
 		pass_impl.render_pass = pRenderPassBegin->renderPass;
 
 		cmd_impl->_current_fbo = pRenderPassBegin->framebuffer;
+		cmd_impl->_current_fbo_data = nullptr;
 		cmd_impl->_current_render_area = pRenderPassBegin->renderArea;
 
 		reshade::invoke_addon_event<reshade::addon_event::begin_render_pass>(cmd_impl, reshade::api::render_pass { reinterpret_cast<uintptr_t>(&pass_impl) });
@@ -829,7 +862,7 @@ void     VKAPI_CALL vkCmdEndRenderPass(VkCommandBuffer commandBuffer)
 void     VKAPI_CALL vkCmdExecuteCommands(VkCommandBuffer commandBuffer, uint32_t commandBufferCount, const VkCommandBuffer *pCommandBuffers)
 {
 #if RESHADE_ADDON
-	if (reshade::vulkan::command_list_impl *const cmd_impl = g_vulkan_command_buffers.at(commandBuffer); cmd_impl != nullptr)
+	if (reshade::vulkan::command_list_impl *const cmd_impl = lookup_command_list<reshade::addon_event::execute_secondary_command_list>(commandBuffer); cmd_impl != nullptr)
 	{
 		for (uint32_t i = 0; i < commandBufferCount; ++i)
 		{
@@ -5,19 +5,20 @@
 
 #include "dll_log.hpp"
 #include "hook_manager.hpp"
-#include "lockfree_table.hpp"
+#include "lockfree_hash_table.hpp"
+#include "profiling.hpp"
 #include "vulkan_hooks.hpp"
 #include "reshade_api_device.hpp"
 #include "reshade_api_command_queue.hpp"
 #include "reshade_api_swapchain.hpp"
 #include "reshade_api_type_convert.hpp"
 
-lockfree_table<void *, reshade::vulkan::device_impl *, 16> g_vulkan_devices;
-static lockfree_table<VkQueue, reshade::vulkan::command_queue_impl *, 16> s_vulkan_queues;
-extern lockfree_table<VkCommandBuffer, reshade::vulkan::command_list_impl *, 4096> g_vulkan_command_buffers;
-extern lockfree_table<void *, VkLayerInstanceDispatchTable, 16> g_instance_dispatch;
-extern lockfree_table<VkSurfaceKHR, HWND, 16> g_surface_windows;
-static lockfree_table<VkSwapchainKHR, reshade::vulkan::swapchain_impl *, 16> s_vulkan_swapchains;
+lockfree_hash_table<void *, reshade::vulkan::device_impl *, 6> g_vulkan_devices;
+static lockfree_hash_table<VkQueue, reshade::vulkan::command_queue_impl *, 6> s_vulkan_queues;
+extern lockfree_hash_table<VkCommandBuffer, reshade::vulkan::command_list_impl *> g_vulkan_command_buffers;
+extern lockfree_hash_table_of_values<void *, VkLayerInstanceDispatchTable, 6> g_instance_dispatch;
+extern lockfree_hash_table<VkSurfaceKHR, HWND, 6> g_surface_windows;
+static lockfree_hash_table<VkSwapchainKHR, reshade::vulkan::swapchain_impl *, 6> s_vulkan_swapchains;
 
 #define GET_DISPATCH_PTR(name, object) \
 	GET_DISPATCH_PTR_FROM(name, g_vulkan_devices.at(dispatch_key_from_handle(object)))
@@ -131,6 +132,18 @@ VkResult VKAPI_CALL vkCreateDevice(VkPhysicalDevice physicalDevice, const VkDevi
 	else if (pCreateInfo->pEnabledFeatures != nullptr)
 		enabled_features = *pCreateInfo->pEnabledFeatures;
 
+	// Timeline semaphores are optional, but allow the runtime to track completion of its submissions with a single semaphore per queue (see 'command_list_immediate_impl')
+	bool timeline_semaphore_ext = false;
+	VkPhysicalDeviceTimelineSemaphoreFeatures timeline_semaphore_features { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES };
+	// Pipeline fragment shading rates are optional, but allow effect passes to shade at a coarser rate (see 'dynamic_state::shading_rate')
+	bool fragment_shading_rate_ext = false;
+	VkPhysicalDeviceFragmentShadingRateFeaturesKHR fragment_shading_rate_features { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FRAGMENT_SHADING_RATE_FEATURES_KHR };
+	// Synchronization 2 is optional, but allows barriers to specify the exact pipeline stages and accesses per resource (see 'command_list_impl::barrier')
+	bool synchronization2_ext = false;
+	VkPhysicalDeviceSynchronization2FeaturesKHR synchronization2_features { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR };
+	// Memory budget queries are optional, but let the runtime and add-ons check how much video memory is left (see 'device_impl::get_memory_budget')
+	bool memory_budget_ext = false;
+
 	std::vector<const char *> enabled_extensions;
 	enabled_extensions.reserve(pCreateInfo->enabledExtensionCount);
 	for (uint32_t i = 0; i < pCreateInfo->enabledExtensionCount; ++i)
@@ -189,6 +202,51 @@ VkResult VKAPI_CALL vkCreateDevice(VkPhysicalDevice physicalDevice, const VkDevi
 		add_extension(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME, false); // This is optional, see imgui code in 'swapchain_impl'
 		add_extension(VK_KHR_IMAGE_FORMAT_LIST_EXTENSION_NAME, true);
 		add_extension(VK_KHR_SWAPCHAIN_MUTABLE_FORMAT_EXTENSION_NAME, true);
+
+		memory_budget_ext = std::find_if(enabled_extensions.begin(), enabled_extensions.end(),
+			[](const char *name) { return strcmp(name, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0; }) != enabled_extensions.end() ||
+			add_extension(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME, false);
+
+		if (const auto get_features2 = g_instance_dispatch.at(dispatch_key_from_handle(physicalDevice)).GetPhysicalDeviceFeatures2; get_features2 != nullptr)
+		{
+			VkPhysicalDeviceFeatures2 supported_features { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2 };
+			supported_features.pNext = &timeline_semaphore_features;
+			timeline_semaphore_features.pNext = &fragment_shading_rate_features;
+			fragment_shading_rate_features.pNext = &synchronization2_features;
+			get_features2(physicalDevice, &supported_features);
+			timeline_semaphore_features.pNext = nullptr;
+			fragment_shading_rate_features.pNext = nullptr;
+
+			// Pipeline statistics queries are optional, but let the runtime show how many invocations each technique causes
+			if (supported_features.features.pipelineStatisticsQuery)
+				enabled_features.pipelineStatisticsQuery = true;
+
+			if (timeline_semaphore_features.timelineSemaphore)
+			{
+				timeline_semaphore_ext = std::find_if(enabled_extensions.begin(), enabled_extensions.end(),
+					[](const char *name) { return strcmp(name, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME) == 0; }) != enabled_extensions.end() ||
+					add_extension(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME, false);
+			}
+
+			// The fragment shading rate extension depends on render pass 2, which is core since Vulkan 1.2
+			if (fragment_shading_rate_features.pipelineFragmentShadingRate)
+			{
+				const auto is_enabled = [&enabled_extensions](const char *name) {
+					return std::find_if(enabled_extensions.begin(), enabled_extensions.end(), [name](const char *enabled_name) { return strcmp(enabled_name, name) == 0; }) != enabled_extensions.end();
+				};
+
+				fragment_shading_rate_ext = is_enabled(VK_KHR_FRAGMENT_SHADING_RATE_EXTENSION_NAME) || (
+					(is_enabled(VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME) || add_extension(VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME, false)) &&
+					add_extension(VK_KHR_FRAGMENT_SHADING_RATE_EXTENSION_NAME, false));
+			}
+
+			if (synchronization2_features.synchronization2)
+			{
+				synchronization2_ext = std::find_if(enabled_extensions.begin(), enabled_extensions.end(),
+					[](const char *name) { return strcmp(name, VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME) == 0; }) != enabled_extensions.end() ||
+					add_extension(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME, false);
+			}
+		}
 	}
 
 	VkDeviceCreateInfo create_info = *pCreateInfo;
@@ -202,6 +260,53 @@ VkResult VKAPI_CALL vkCreateDevice(VkPhysicalDevice physicalDevice, const VkDevi
 	else
 		create_info.pEnabledFeatures = &enabled_features;
 
+	// Enable the timeline semaphore feature, either in a feature structure the application already passed in or by adding one to the chain
+	if (timeline_semaphore_ext)
+	{
+		if (const auto vulkan_12_features = find_in_structure_chain<VkPhysicalDeviceVulkan12Features>(
+				pCreateInfo->pNext, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES); vulkan_12_features != nullptr)
+			const_cast<VkPhysicalDeviceVulkan12Features *>(vulkan_12_features)->timelineSemaphore = VK_TRUE;
+		else if (const auto existing_timeline_semaphore_features = find_in_structure_chain<VkPhysicalDeviceTimelineSemaphoreFeatures>(
+				pCreateInfo->pNext, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES); existing_timeline_semaphore_features != nullptr)
+			const_cast<VkPhysicalDeviceTimelineSemaphoreFeatures *>(existing_timeline_semaphore_features)->timelineSemaphore = VK_TRUE;
+		else
+		{
+			timeline_semaphore_features.pNext = const_cast<void *>(create_info.pNext);
+			timeline_semaphore_features.timelineSemaphore = VK_TRUE;
+			create_info.pNext = &timeline_semaphore_features;
+		}
+	}
+
+	// Enable the pipeline fragment shading rate feature in the same way
+	if (fragment_shading_rate_ext)
+	{
+		if (const auto existing_fragment_shading_rate_features = find_in_structure_chain<VkPhysicalDeviceFragmentShadingRateFeaturesKHR>(
+				pCreateInfo->pNext, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FRAGMENT_SHADING_RATE_FEATURES_KHR); existing_fragment_shading_rate_features != nullptr)
+			const_cast<VkPhysicalDeviceFragmentShadingRateFeaturesKHR *>(existing_fragment_shading_rate_features)->pipelineFragmentShadingRate = VK_TRUE;
+		else
+		{
+			fragment_shading_rate_features = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FRAGMENT_SHADING_RATE_FEATURES_KHR };
+			fragment_shading_rate_features.pNext = const_cast<void *>(create_info.pNext);
+			fragment_shading_rate_features.pipelineFragmentShadingRate = VK_TRUE;
+			create_info.pNext = &fragment_shading_rate_features;
+		}
+	}
+
+	// Enable the synchronization 2 feature in the same way
+	if (synchronization2_ext)
+	{
+		if (const auto existing_synchronization2_features = find_in_structure_chain<VkPhysicalDeviceSynchronization2FeaturesKHR>(
+				pCreateInfo->pNext, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR); existing_synchronization2_features != nullptr)
+			const_cast<VkPhysicalDeviceSynchronization2FeaturesKHR *>(existing_synchronization2_features)->synchronization2 = VK_TRUE;
+		else
+		{
+			synchronization2_features = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR };
+			synchronization2_features.pNext = const_cast<void *>(create_info.pNext);
+			synchronization2_features.synchronization2 = VK_TRUE;
+			create_info.pNext = &synchronization2_features;
+		}
+	}
+
 	// Continue calling down the chain
 	const VkResult result = trampoline(physicalDevice, &create_info, pAllocator, pDevice);
 	if (result < VK_SUCCESS)
@@ -251,6 +356,9 @@ VkResult VKAPI_CALL vkCreateDevice(VkPhysicalDevice physicalDevice, const VkDevi
 	INIT_DISPATCH_PTR(DestroyImageView);
 	INIT_DISPATCH_PTR(CreateShaderModule);
 	INIT_DISPATCH_PTR(DestroyShaderModule);
+	INIT_DISPATCH_PTR(CreatePipelineCache);
+	INIT_DISPATCH_PTR(DestroyPipelineCache);
+	INIT_DISPATCH_PTR(GetPipelineCacheData);
 	INIT_DISPATCH_PTR(CreateGraphicsPipelines);
 	INIT_DISPATCH_PTR(CreateComputePipelines);
 	INIT_DISPATCH_PTR(DestroyPipeline);
@@ -322,6 +430,9 @@ VkResult VKAPI_CALL vkCreateDevice(VkPhysicalDevice physicalDevice, const VkDevi
 	INIT_DISPATCH_PTR(GetBufferMemoryRequirements2);
 	INIT_DISPATCH_PTR(GetImageMemoryRequirements2);
 	INIT_DISPATCH_PTR(GetDeviceQueue2);
+	INIT_DISPATCH_PTR(CreateDescriptorUpdateTemplate);
+	INIT_DISPATCH_PTR(DestroyDescriptorUpdateTemplate);
+	INIT_DISPATCH_PTR(UpdateDescriptorSetWithTemplate);
 	// ---- Core 1_2 commands
 	INIT_DISPATCH_PTR(CreateRenderPass2);
 	if (dispatch_table.CreateRenderPass2 == nullptr) // Try the KHR version if the core version does not exist
@@ -333,6 +444,15 @@ VkResult VKAPI_CALL vkCreateDevice(VkPhysicalDevice physicalDevice, const VkDevi
 	INIT_DISPATCH_PTR(QueuePresentKHR);
 	// ---- VK_KHR_push_descriptor extension commands
 	INIT_DISPATCH_PTR(CmdPushDescriptorSetKHR);
+	INIT_DISPATCH_PTR(CmdPushDescriptorSetWithTemplateKHR);
+	// ---- VK_KHR_timeline_semaphore extension commands
+	INIT_DISPATCH_PTR(GetSemaphoreCounterValueKHR);
+	INIT_DISPATCH_PTR(WaitSemaphoresKHR);
+	INIT_DISPATCH_PTR(SignalSemaphoreKHR);
+	// ---- VK_KHR_fragment_shading_rate extension commands
+	INIT_DISPATCH_PTR(CmdSetFragmentShadingRateKHR);
+	// ---- VK_KHR_synchronization2 extension commands
+	INIT_DISPATCH_PTR(CmdPipelineBarrier2KHR);
 	// ---- VK_EXT_debug_utils extension commands
 	INIT_DISPATCH_PTR(SetDebugUtilsObjectNameEXT);
 	INIT_DISPATCH_PTR(QueueBeginDebugUtilsLabelEXT);
@@ -351,6 +471,10 @@ VkResult VKAPI_CALL vkCreateDevice(VkPhysicalDevice physicalDevice, const VkDevi
 		enabled_features);
 
 	device_impl->_graphics_queue_family_index = graphics_queue_family_index;
+	device_impl->_timeline_semaphore_ext = timeline_semaphore_ext && dispatch_table.GetSemaphoreCounterValueKHR != nullptr && dispatch_table.WaitSemaphoresKHR != nullptr;
+	device_impl->_fragment_shading_rate_ext = fragment_shading_rate_ext && dispatch_table.CmdSetFragmentShadingRateKHR != nullptr;
+	device_impl->_synchronization2_ext = synchronization2_ext && dispatch_table.CmdPipelineBarrier2KHR != nullptr;
+	device_impl->_memory_budget_ext = memory_budget_ext;
 
 	g_vulkan_devices.emplace(dispatch_key_from_handle(device), device_impl);
 
@@ -557,6 +681,8 @@ VkResult VKAPI_CALL vkCreateSwapchainKHR(VkDevice device, const VkSwapchainCreat
 #endif
 
 			// Re-use the existing effect runtime if this swap chain was not created from scratch, but reset it before initializing again below
+			// Effects are kept loaded if the new swap chain ends up with the same image extent and format (e.g. after the window was minimized)
+			swapchain_impl->keep_effects_on_next_reset();
 			swapchain_impl->on_reset();
 		}
 		else
@@ -570,8 +696,7 @@ VkResult VKAPI_CALL vkCreateSwapchainKHR(VkDevice device, const VkSwapchainCreat
 		if (!swapchain_impl->on_init(*pSwapchain, create_info, hwnd))
 			LOG(ERROR) << "Failed to initialize Vulkan runtime environment on runtime " << swapchain_impl << '.';
 
-		if (!s_vulkan_swapchains.emplace(*pSwapchain, swapchain_impl))
-			delete swapchain_impl;
+		s_vulkan_swapchains.emplace(*pSwapchain, swapchain_impl);
 	}
 	else
 	{
@@ -604,15 +729,21 @@ VkResult VKAPI_CALL vkQueueSubmit(VkQueue queue, uint32_t submitCount, const VkS
 #if RESHADE_ADDON
 	if (reshade::vulkan::command_queue_impl *const queue_impl = s_vulkan_queues.at(queue); queue_impl != nullptr)
 	{
-		for (uint32_t i = 0; i < submitCount; ++i)
+		RESHADE_PROFILE_SCOPE("vkQueueSubmit");
+
+		// Looking up every command buffer is only worth it if there is someone to pass them to (applications may submit dozens of times per frame)
+		if (reshade::has_addon_event<reshade::addon_event::execute_command_list>() || reshade::has_addon_event<reshade::addon_event::execute_command_stream>())
 		{
-			for (uint32_t k = 0; k < pSubmits[i].commandBufferCount; ++k)
+			for (uint32_t i = 0; i < submitCount; ++i)
 			{
-				assert(pSubmits[i].pCommandBuffers[k] != VK_NULL_HANDLE);
-
-				if (reshade::vulkan::command_list_impl *const cmd_impl = g_vulkan_command_buffers.at(pSubmits[i].pCommandBuffers[k]); cmd_impl != nullptr)
+				for (uint32_t k = 0; k < pSubmits[i].commandBufferCount; ++k)
 				{
-					reshade::invoke_addon_event<reshade::addon_event::execute_command_list>(queue_impl, cmd_impl);
+					assert(pSubmits[i].pCommandBuffers[k] != VK_NULL_HANDLE);
+
+					if (reshade::vulkan::command_list_impl *const cmd_impl = g_vulkan_command_buffers.at(pSubmits[i].pCommandBuffers[k]); cmd_impl != nullptr)
+					{
+						reshade::invoke_addon_event<reshade::addon_event::execute_command_list>(queue_impl, cmd_impl);
+					}
 				}
 			}
 		}
@@ -629,11 +760,15 @@ VkResult VKAPI_CALL vkQueuePresentKHR(VkQueue queue, const VkPresentInfoKHR *pPr
 {
 	assert(pPresentInfo != nullptr);
 
-	std::vector<VkSemaphore> wait_semaphores(
+	// Reuse the same list for every present on this thread, so that it does not have to be allocated again every frame
+	static thread_local std::vector<VkSemaphore> wait_semaphores;
+	wait_semaphores.assign(
 		pPresentInfo->pWaitSemaphores, pPresentInfo->pWaitSemaphores + pPresentInfo->waitSemaphoreCount);
 
 	if (reshade::vulkan::command_queue_impl *const queue_impl = s_vulkan_queues.at(queue); queue_impl != nullptr)
 	{
+		RESHADE_PROFILE_SCOPE("vkQueuePresentKHR");
+
 		for (uint32_t i = 0; i < pPresentInfo->swapchainCount; ++i)
 		{
 			reshade::vulkan::swapchain_impl *const swapchain_impl = s_vulkan_swapchains.at(pPresentInfo->pSwapchains[i]);
@@ -941,6 +1076,7 @@ VkResult VKAPI_CALL vkCreateGraphicsPipelines(VkDevice device, VkPipelineCache p
 	for (uint32_t i = 0; i < createInfoCount; ++i)
 	{
 		const reshade::api::pipeline_desc desc = reshade::vulkan::convert_pipeline_desc(pCreateInfos[i]);
+		reshade::addon::compute_shader_hashes(desc);
 
 		if (reshade::api::pipeline replacement = { 0 };
 			reshade::invoke_addon_event<reshade::addon_event::create_pipeline>(device_impl, desc, &replacement))
@@ -983,6 +1119,7 @@ VkResult VKAPI_CALL vkCreateComputePipelines(VkDevice device, VkPipelineCache pi
 	for (uint32_t i = 0; i < createInfoCount; ++i)
 	{
 		const reshade::api::pipeline_desc desc = reshade::vulkan::convert_pipeline_desc(pCreateInfos[i]);
+		reshade::addon::compute_shader_hashes(desc);
 
 		if (reshade::api::pipeline replacement = { 0 };
 			reshade::invoke_addon_event<reshade::addon_event::create_pipeline>(device_impl, desc, &replacement))
@@ -1281,8 +1418,7 @@ VkResult VKAPI_CALL vkAllocateCommandBuffers(VkDevice device, const VkCommandBuf
 		for (uint32_t i = 0; i < pAllocateInfo->commandBufferCount; ++i)
 		{
 			const auto cmd_impl = new reshade::vulkan::command_list_impl(device_impl, pCommandBuffers[i]);
-			if (!g_vulkan_command_buffers.emplace(pCommandBuffers[i], cmd_impl))
-				delete cmd_impl;
+			g_vulkan_command_buffers.emplace(pCommandBuffers[i], cmd_impl);
 		}
 #endif
 	}
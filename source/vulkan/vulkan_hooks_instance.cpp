@@ -5,11 +5,11 @@
 
 #include "dll_log.hpp"
 #include "hook_manager.hpp"
-#include "lockfree_table.hpp"
+#include "lockfree_hash_table.hpp"
 #include "vulkan_hooks.hpp"
 
-lockfree_table<void *, VkLayerInstanceDispatchTable, 16> g_instance_dispatch;
-lockfree_table<VkSurfaceKHR, HWND, 16> g_surface_windows;
+lockfree_hash_table_of_values<void *, VkLayerInstanceDispatchTable, 6> g_instance_dispatch;
+lockfree_hash_table<VkSurfaceKHR, HWND, 6> g_surface_windows;
 
 #define GET_DISPATCH_PTR(name, object) \
 	PFN_vk##name trampoline = g_instance_dispatch.at(dispatch_key_from_handle(object)).name; \
@@ -145,6 +145,7 @@ VkResult VKAPI_CALL vkCreateInstance(const VkInstanceCreateInfo *pCreateInfo, co
 	dispatch_table.GetInstanceProcAddr = get_instance_proc;
 	INIT_DISPATCH_PTR(EnumerateDeviceExtensionProperties);
 	// ---- Core 1_1 commands
+	INIT_DISPATCH_PTR(GetPhysicalDeviceFeatures2);
 	INIT_DISPATCH_PTR(GetPhysicalDeviceMemoryProperties2);
 	// ---- VK_KHR_surface extension commands
 	INIT_DISPATCH_PTR(DestroySurfaceKHR);
@@ -5,16 +5,59 @@
 
 #include "effect_parser.hpp"
 #include "effect_codegen.hpp"
+#include "effect_lexer.hpp"
 #include "effect_preprocessor.hpp"
+#include "effect_compile.hpp"
+#include "cache_archive.hpp"
+#include "thread_pool.hpp"
+#include "dll_log.hpp"
 #include "version.h"
+#include <new>
+#include <atomic>
+#include <chrono>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <limits>
 #include <iostream>
+#include <algorithm>
+#include <filesystem>
+#include <Windows.h>
+
+// Count heap allocations, so that benchmark mode can report them per stage
+static std::atomic<size_t> s_num_allocations = 0;
+
+void *operator new(size_t size)
+{
+	s_num_allocations.fetch_add(1, std::memory_order_relaxed);
+
+	if (void *const ptr = std::malloc(size != 0 ? size : 1))
+		return ptr;
+	throw std::bad_alloc();
+}
+void operator delete(void *ptr) noexcept
+{
+	std::free(ptr);
+}
+
+// The effect cache archive reports errors through the log, so print its messages to the console instead
+thread_local std::ostringstream reshade::log::line_stream;
+
+reshade::log::message::message(level level)
+{
+	line_stream.str(std::string());
+	line_stream.clear();
+	line_stream << (level == level::error ? "error: " : level == level::warning ? "warning: " : "");
+}
+reshade::log::message::~message()
+{
+	std::cout << line_stream.str() << std::endl;
+}
 
 static void print_usage(const char *path)
 {
 	printf(R"(usage: %s [options] <filename>
+       %s [options] --batch <directory>
 
 Options:
   -h, --help                Print this help.
@@ -35,30 +78,488 @@ Options:
   --height                  Value of the 'BUFFER_HEIGHT' preprocessor macro.
   --invert-y                Insert code to invert the Y component of the output position in vertex shaders (only applies to SPIR-V).
   --spec-constants          Convert uniform variables to specialization constants.
+  --performance-mode        Compile like ReShade does in performance mode (implies --spec-constants).
+  --specialize-discrete-uniforms
+                            Convert uniform variables that select between a few discrete options to specialization constants too.
+  --pack-uniforms           Reorder the members of the uniform buffer to reduce its size.
+  --color-bit-depth <value> Value of the 'BUFFER_COLOR_BIT_DEPTH' preprocessor macro.
 
   -Zi                       Enable debug information.
-	)", path);
+
+  --batch <directory>       Compile all effect files in the given directory and its subdirectories in parallel.
+  --report <file>           Write a JSON report with the time spent in each compilation stage per file (only applies to batch mode) or per stage (in benchmark mode). If <file> is "-", then it is written to standard output instead.
+  --threads <value>         Number of worker threads to use in batch mode. Defaults to the number of hardware threads.
+  --benchmark               Measure throughput and allocation count of the lexer, preprocessor, parser and each code generator over the input file(s) instead of compiling.
+  --iterations <value>      Number of times to process every input file in benchmark mode.
+
+  --cache <directory>       Compile all entry points of the input file(s) with "d3dcompiler_47.dll" and add them to the effect cache archive for the renderer in the given directory, which ReShade reads when it is placed in its intermediate cache path.
+                            ReShade only finds these entries if the options match its configuration (resolution, performance mode, debug information, ...).
+  --renderer <value>        Renderer identifier to build the effect cache for, which is the D3D feature level for D3D10 and later (e.g. 0x9000, 0xa000, 0xb000 or 0xc000). Defaults to 0xb000.
+	)", path, path);
+}
+
+struct compile_options
+{
+	std::vector<std::pair<std::string, std::string>> macros;
+	std::vector<std::filesystem::path> include_paths;
+	unsigned int shader_model = 50;
+	bool print_glsl = false;
+	bool print_hlsl = false;
+	bool debug_info = false;
+	bool invert_y_axis = false;
+	bool spec_constants = false;
+	bool performance_mode = false;
+	bool specialize_discrete_uniforms = false;
+	bool pack_uniforms = false;
+	// Compiled entry points are added to this archive if it is set (see '--cache')
+	reshade::cache_archive *cache = nullptr;
+	void *d3d_compiler = nullptr;
+	uint32_t renderer_id = 0xb000;
+	unsigned int width = 800;
+	unsigned int height = 600;
+};
+
+struct compile_result
+{
+	std::filesystem::path path;
+	bool success = false;
+	std::string errors;
+	// Time spent in each stage in microseconds
+	long long preprocess_time = 0;
+	long long parse_time = 0;
+	long long codegen_time = 0;
+	long long compile_time = 0;
+	size_t num_cached_entry_points = 0;
+};
+
+static reshadefx::codegen *create_backend(const compile_options &options)
+{
+	if (options.print_glsl)
+		return reshadefx::create_codegen_glsl(options.debug_info, options.spec_constants, false, false, options.specialize_discrete_uniforms, options.pack_uniforms);
+	else if (options.print_hlsl || options.cache != nullptr)
+		return reshadefx::create_codegen_hlsl(options.shader_model, options.debug_info, options.spec_constants, options.specialize_discrete_uniforms, options.pack_uniforms);
+	else
+		return reshadefx::create_codegen_spirv(true, options.debug_info, options.spec_constants, false, options.invert_y_axis);
+}
+
+static bool compile_cache_entries(const compile_options &options, const reshadefx::module &module, compile_result &result)
+{
+	// Without a preset the specialization constants keep their initial values
+	std::string preamble;
+	for (const reshadefx::uniform_info &constant : module.spec_constants)
+		reshade::append_spec_constant_definition(preamble, constant);
+
+	const std::string hlsl = reshade::hlsl_compile_source(options.width, options.height, preamble, module.hlsl);
+
+	for (const reshadefx::entry_point &entry_point : module.entry_points)
+	{
+		// Use the same profile, flags and hash as 'runtime::compile_effect_shaders', so that the entries are found there
+		const std::string profile = reshade::hlsl_profile(options.renderer_id, entry_point.type, false);
+		const uint32_t compile_flags = reshade::hlsl_compile_flags(options.renderer_id, options.performance_mode, options.debug_info, false);
+		const size_t hash = reshade::hlsl_compile_hash(hlsl, entry_point.name, profile, compile_flags);
+
+		std::vector<char> cso;
+		std::string assembly, errors;
+		const bool compiled = reshade::compile_hlsl_dxbc(options.d3d_compiler, hlsl, entry_point.name, entry_point.type, profile, compile_flags, cso, assembly, errors);
+
+		result.errors += errors;
+
+		if (!compiled)
+			return false;
+
+		options.cache->put(reshade::effect_cache_key(result.path, entry_point.name, hash, "cso"), cso.data(), cso.size());
+		options.cache->put(reshade::effect_cache_key(result.path, entry_point.name, hash, "asm"), assembly.data(), assembly.size());
+		result.num_cached_entry_points++;
+	}
+
+	return true;
+}
+
+static void compile_file(const compile_options &options, compile_result &result)
+{
+	using clock = std::chrono::high_resolution_clock;
+	const auto elapsed = [](clock::time_point start) {
+		return static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start).count());
+	};
+
+	// Every file gets its own preprocessor and parser, but the contents of included files are shared between all of them
+	reshadefx::preprocessor pp;
+	for (const auto &[name, value] : options.macros)
+		pp.add_macro_definition(name, value);
+	for (const std::filesystem::path &include_path : options.include_paths)
+		pp.add_include_path(include_path);
+
+	// ReShade adds these in front of every effect, so need to do the same for the generated code to match when building the effect cache
+	if (options.cache != nullptr)
+		pp.append_string(reshade::compatibility_macro_definitions);
+
+	auto start = clock::now();
+	const bool preprocessed = pp.append_file(result.path);
+	result.preprocess_time = elapsed(start);
+
+	if (!preprocessed)
+	{
+		result.errors = pp.errors();
+		return;
+	}
+
+	const std::unique_ptr<reshadefx::codegen> backend(create_backend(options));
+
+	reshadefx::parser parser;
+
+	start = clock::now();
+	const bool parsed = parser.parse(pp.output(), backend.get());
+	result.parse_time = elapsed(start);
+
+	result.errors = pp.errors() + parser.errors();
+
+	if (!parsed)
+		return;
+
+	reshadefx::module module;
+
+	start = clock::now();
+	backend->write_result(module);
+	result.codegen_time = elapsed(start);
+
+	if (options.cache != nullptr)
+	{
+		start = clock::now();
+		result.success = compile_cache_entries(options, module, result);
+		result.compile_time = elapsed(start);
+		return;
+	}
+
+	result.success = true;
+}
+
+static std::string escape_json(const std::string &s)
+{
+	std::string escaped;
+	escaped.reserve(s.size());
+	for (const char c : s)
+	{
+		switch (c)
+		{
+		case '\\': escaped += "\\\\"; break;
+		case '"': escaped += "\\\""; break;
+		case '\n': escaped += "\\n"; break;
+		case '\r': escaped += "\\r"; break;
+		case '\t': escaped += "\\t"; break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20)
+			{
+				char code[8];
+				snprintf(code, sizeof(code), "\\u%04x", c);
+				escaped += code;
+			}
+			else
+			{
+				escaped += c;
+			}
+			break;
+		}
+	}
+	return escaped;
+}
+
+static void write_report(std::ostream &stream, const std::vector<compile_result> &results, long long total_time)
+{
+	stream << "{\n  \"total_time_us\": " << total_time << ",\n  \"files\": [";
+
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		const compile_result &result = results[i];
+
+		stream << (i != 0 ? ",\n" : "\n")
+			<< "    { \"path\": \"" << escape_json(result.path.string()) << '"'
+			<< ", \"success\": " << (result.success ? "true" : "false")
+			<< ", \"preprocess_us\": " << result.preprocess_time
+			<< ", \"parse_us\": " << result.parse_time
+			<< ", \"codegen_us\": " << result.codegen_time
+			<< ", \"compile_us\": " << result.compile_time
+			<< ", \"cached_entry_points\": " << result.num_cached_entry_points
+			<< " }";
+	}
+
+	stream << "\n  ]\n}" << std::endl;
+}
+
+static bool find_effect_files(const std::filesystem::path &directory, std::vector<std::filesystem::path> &files)
+{
+	std::error_code ec;
+	for (const std::filesystem::directory_entry &entry : std::filesystem::recursive_directory_iterator(directory, std::filesystem::directory_options::skip_permission_denied, ec))
+		if (entry.is_regular_file(ec) && entry.path().extension() == ".fx")
+			files.push_back(entry.path());
+
+	if (ec)
+	{
+		std::cout << "error: Failed to enumerate files in " << directory << std::endl;
+		return false;
+	}
+
+	// Sort files so that reports are stable across runs
+	std::sort(files.begin(), files.end());
+	return true;
+}
+
+static int compile_directory(const std::filesystem::path &directory, const compile_options &options, const char *errorfile, const char *reportfile, size_t num_threads)
+{
+	std::vector<std::filesystem::path> files;
+	if (!find_effect_files(directory, files))
+		return 1;
+
+	std::vector<compile_result> results;
+	results.reserve(files.size());
+	for (std::filesystem::path &path : files)
+		results.push_back({ std::move(path) });
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	if (num_threads == 1)
+	{
+		for (compile_result &result : results)
+			compile_file(options, result);
+	}
+	else
+	{
+		// The calling thread takes part in processing as well, so need one worker less than requested
+		reshade::thread_pool pool(num_threads != 0 ? num_threads - 1 : 0);
+		pool.parallel_for(results.size(), [&options, &results](size_t index) { compile_file(options, results[index]); });
+	}
+
+	const long long total_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count();
+
+	size_t num_failed = 0;
+	std::string errors;
+	for (const compile_result &result : results)
+	{
+		if (!result.success)
+			num_failed++;
+		if (!result.errors.empty())
+			errors += result.errors + '\n';
+	}
+
+	if (errorfile == nullptr)
+		std::cout << errors;
+	else
+		std::ofstream(errorfile) << errors;
+
+	if (reportfile != nullptr)
+	{
+		if (std::strcmp(reportfile, "-") == 0)
+			write_report(std::cout, results, total_time);
+		else if (std::ofstream stream(reportfile); stream)
+			write_report(stream, results, total_time);
+	}
+
+	std::cerr << "Compiled " << (results.size() - num_failed) << " of " << results.size() << " effect files successfully in " << (total_time / 1000) << " ms." << std::endl;
+
+	return num_failed != 0 ? 1 : 0;
+}
+
+struct benchmark_stage
+{
+	const char *name;
+	long long time = 0;
+	size_t bytes = 0;
+	size_t tokens = 0;
+	size_t allocations = 0;
+};
+
+static int benchmark_files(const std::vector<std::filesystem::path> &files, const compile_options &options, const char *reportfile, unsigned int iterations)
+{
+	using clock = std::chrono::high_resolution_clock;
+
+	// Stages are measured one after another on a single thread, so that the allocation counter only sees the stage being measured
+	benchmark_stage stages[] = { { "preprocess" }, { "lex" }, { "parse_hlsl" }, { "parse_glsl" }, { "parse_spirv" } };
+
+	const auto measure = [](benchmark_stage &stage, const auto &func) {
+		const size_t allocations = s_num_allocations.load(std::memory_order_relaxed);
+		const auto start = clock::now();
+		func();
+		stage.time += std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start).count();
+		stage.allocations += s_num_allocations.load(std::memory_order_relaxed) - allocations;
+	};
+
+	size_t num_failed = 0;
+
+	for (unsigned int iteration = 0; iteration < iterations; ++iteration)
+	{
+		for (const std::filesystem::path &path : files)
+		{
+			reshadefx::preprocessor pp;
+			for (const auto &[name, value] : options.macros)
+				pp.add_macro_definition(name, value);
+			for (const std::filesystem::path &include_path : options.include_paths)
+				pp.add_include_path(include_path);
+
+			bool success = false;
+			measure(stages[0], [&]() { success = pp.append_file(path); });
+			if (!success)
+			{
+				if (iteration == 0)
+				{
+					std::cout << pp.errors();
+					num_failed++;
+				}
+				continue;
+			}
+
+			const std::string &source = pp.output();
+			stages[0].bytes += source.size();
+
+			size_t num_tokens = 0;
+			reshadefx::lexer lexer(source);
+			measure(stages[1], [&]() {
+				while (lexer.lex().id != reshadefx::tokenid::end_of_file)
+					num_tokens++;
+			});
+
+			for (size_t i = 1; i < std::size(stages); ++i)
+			{
+				stages[i].bytes += source.size();
+				stages[i].tokens += num_tokens;
+			}
+
+			for (size_t i = 2; i < std::size(stages); ++i)
+			{
+				measure(stages[i], [&]() {
+					std::unique_ptr<reshadefx::codegen> backend;
+					if (i == 2)
+						backend.reset(reshadefx::create_codegen_hlsl(options.shader_model, options.debug_info, options.spec_constants));
+					else if (i == 3)
+						backend.reset(reshadefx::create_codegen_glsl(options.debug_info, options.spec_constants));
+					else
+						backend.reset(reshadefx::create_codegen_spirv(true, options.debug_info, options.spec_constants));
+
+					reshadefx::parser parser;
+					if (parser.parse(source, backend.get()))
+					{
+						reshadefx::module module;
+						backend->write_result(module);
+					}
+					else if (iteration == 0 && i == 2)
+					{
+						std::cout << parser.errors();
+						num_failed++;
+					}
+				});
+			}
+		}
+	}
+
+	printf("%-12s %12s %12s %14s %14s\n", "stage", "time (ms)", "MB/s", "tokens/s", "allocations");
+	for (const benchmark_stage &stage : stages)
+	{
+		const double seconds = std::max(stage.time, 1ll) / 1000000.0;
+		printf("%-12s %12.2f %12.2f %14.0f %14zu\n", stage.name, stage.time / 1000.0, stage.bytes / seconds / 1000000.0, stage.tokens / seconds, stage.allocations);
+	}
+
+	if (reportfile != nullptr)
+	{
+		std::ofstream file;
+		if (std::strcmp(reportfile, "-") != 0)
+			file.open(reportfile);
+		std::ostream &stream = file.is_open() ? file : std::cout;
+
+		stream << "{\n  \"files\": " << files.size() << ",\n  \"iterations\": " << iterations << ",\n  \"stages\": [";
+
+		for (size_t i = 0; i < std::size(stages); ++i)
+		{
+			const benchmark_stage &stage = stages[i];
+
+			stream << (i != 0 ? ",\n" : "\n")
+				<< "    { \"name\": \"" << stage.name << '"'
+				<< ", \"time_us\": " << stage.time
+				<< ", \"bytes\": " << stage.bytes
+				<< ", \"tokens\": " << stage.tokens
+				<< ", \"allocations\": " << stage.allocations
+				<< " }";
+		}
+
+		stream << "\n  ]\n}" << std::endl;
+	}
+
+	return num_failed != 0 ? 1 : 0;
+}
+
+static int build_cache(const char *filename, const char *directory, const std::filesystem::path &cachedir, compile_options &options, const char *errorfile, const char *reportfile, size_t num_threads)
+{
+	if ((options.renderer_id & 0xF0000) != 0)
+	{
+		std::cout << "error: Effect cache can only be built for D3D renderers" << std::endl;
+		return 1;
+	}
+
+	// Compiling with the DirectX Shader Compiler is not supported, so build the cache ReShade uses on D3D12 by default (when compiling effects to DXIL is not enabled)
+	options.shader_model = reshade::hlsl_shader_model(options.renderer_id, false);
+
+	// Match the definitions of 'runtime::build_effect', but leave out the ones that depend on the system ReShade runs on (which can be added with -D if needed)
+	options.macros.emplace_back("__RESHADE_WAVE_INTRINSICS__", "0");
+	options.macros.emplace_back("__RENDERER__", std::to_string(options.renderer_id));
+
+	options.d3d_compiler = LoadLibraryW(L"d3dcompiler_47.dll");
+	if (options.d3d_compiler == nullptr)
+	{
+		std::cout << "error: Unable to load HLSL compiler (\"d3dcompiler_47.dll\")" << std::endl;
+		return 1;
+	}
+
+	std::error_code ec;
+	std::filesystem::create_directories(cachedir, ec);
+
+	// Use the same file name as 'runtime::load_effects', so that the archive can be copied to the intermediate cache path as is
+	// Entries that already exist in the archive are kept, so multiple configurations can be added to the same archive by running this more than once
+	reshade::cache_archive cache(cachedir / (L"reshade-effects-" + std::to_wstring(options.renderer_id) + L".cache"), std::numeric_limits<uint64_t>::max());
+	options.cache = &cache;
+
+	int result = 0;
+	if (directory != nullptr)
+	{
+		result = compile_directory(directory, options, errorfile, reportfile, num_threads);
+	}
+	else
+	{
+		compile_result file_result = { filename };
+		compile_file(options, file_result);
+
+		if (errorfile == nullptr)
+			std::cout << file_result.errors;
+		else
+			std::ofstream(errorfile) << file_result.errors;
+
+		std::cerr << "Added " << file_result.num_cached_entry_points << " entry points to the effect cache." << std::endl;
+
+		result = file_result.success ? 0 : 1;
+	}
+
+	if (!cache.flush())
+		result = 1;
+
+	FreeLibrary(static_cast<HMODULE>(options.d3d_compiler));
+
+	return result;
 }
 
 int main(int argc, char *argv[])
 {
 	const char *filename = nullptr;
+	const char *directory = nullptr;
 	const char *preprocess = nullptr;
 	const char *errorfile = nullptr;
 	const char *objectfile = nullptr;
+	const char *reportfile = nullptr;
+	const char *cachedir = nullptr;
 	const char *buffer_width = "800";
 	const char *buffer_height = "600";
-	bool print_glsl = false;
-	bool print_hlsl = false;
-	bool debug_info = false;
-	bool invert_y_axis = false;
-	bool spec_constants = false;
-	unsigned int shader_model = 50;
+	const char *color_bit_depth = "8";
+	size_t num_threads = 0;
+	unsigned int iterations = 1;
+	bool benchmark = false;
 
-	reshadefx::parser parser;
-	reshadefx::preprocessor pp;
-	pp.add_macro_definition("__RESHADE__", std::to_string(VERSION_MAJOR * 10000 + VERSION_MINOR * 100 + VERSION_REVISION));
-	pp.add_macro_definition("__RESHADE_PERFORMANCE_MODE__", "0");
+	compile_options options;
+	options.macros.emplace_back("__RESHADE__", std::to_string(VERSION_MAJOR * 10000 + VERSION_MINOR * 100 + VERSION_REVISION));
 
 	// Parse command-line arguments
 	for (int i = 1; i < argc; ++i)
@@ -81,26 +582,34 @@ int main(int argc, char *argv[])
 				char *macro = argv[++i];
 				char *value = std::strchr(macro, '=');
 				if (value) *value++ = '\0';
-				pp.add_macro_definition(macro, value ? value : "1");
+				options.macros.emplace_back(macro, value ? value : "1");
 				continue;
 			}
 
 			if (0 == std::strcmp(arg, "-I"))
 			{
-				pp.add_include_path(argv[++i]);
+				options.include_paths.push_back(argv[++i]);
 				continue;
 			}
 
 			if (0 == std::strcmp(arg, "-Zi"))
-				debug_info = true;
+				options.debug_info = true;
 			else if (0 == std::strcmp(arg, "--glsl"))
-				print_glsl = true;
+				options.print_glsl = true;
 			else if (0 == std::strcmp(arg, "--hlsl"))
-				print_hlsl = true;
+				options.print_hlsl = true;
 			else if (0 == std::strcmp(arg, "--invert-y"))
-				invert_y_axis = true;
+				options.invert_y_axis = true;
 			else if (0 == std::strcmp(arg, "--spec-constants"))
-				spec_constants = true;
+				options.spec_constants = true;
+			else if (0 == std::strcmp(arg, "--performance-mode"))
+				options.performance_mode = options.spec_constants = true;
+			else if (0 == std::strcmp(arg, "--specialize-discrete-uniforms"))
+				options.specialize_discrete_uniforms = true;
+			else if (0 == std::strcmp(arg, "--pack-uniforms"))
+				options.pack_uniforms = true;
+			else if (0 == std::strcmp(arg, "--benchmark"))
+				benchmark = true;
 
 			if (i + 1 >= argc)
 				continue;
@@ -111,11 +620,25 @@ int main(int argc, char *argv[])
 			else if (0 == std::strcmp(arg, "-Fo"))
 				objectfile = argv[++i];
 			else if (0 == std::strcmp(arg, "--shader-model"))
-				shader_model = std::strtol(argv[++i], nullptr, 10);
+				options.shader_model = std::strtol(argv[++i], nullptr, 10);
 			else if (0 == std::strcmp(arg, "--width"))
 				buffer_width = argv[++i];
 			else if (0 == std::strcmp(arg, "--height"))
 				buffer_height = argv[++i];
+			else if (0 == std::strcmp(arg, "--color-bit-depth"))
+				color_bit_depth = argv[++i];
+			else if (0 == std::strcmp(arg, "--cache"))
+				cachedir = argv[++i];
+			else if (0 == std::strcmp(arg, "--renderer"))
+				options.renderer_id = std::strtoul(argv[++i], nullptr, 0);
+			else if (0 == std::strcmp(arg, "--batch"))
+				directory = argv[++i];
+			else if (0 == std::strcmp(arg, "--report"))
+				reportfile = argv[++i];
+			else if (0 == std::strcmp(arg, "--threads"))
+				num_threads = std::strtoul(argv[++i], nullptr, 10);
+			else if (0 == std::strcmp(arg, "--iterations"))
+				iterations = std::strtoul(argv[++i], nullptr, 10);
 		}
 		else
 		{
@@ -129,16 +652,45 @@ int main(int argc, char *argv[])
 		}
 	}
 
-	if (filename == nullptr)
+	if ((filename == nullptr) == (directory == nullptr))
 	{
 		print_usage(argv[0]);
 		return 1;
 	}
 
-	pp.add_macro_definition("BUFFER_WIDTH", buffer_width);
-	pp.add_macro_definition("BUFFER_HEIGHT", buffer_height);
-	pp.add_macro_definition("BUFFER_RCP_WIDTH", "(1.0 / BUFFER_WIDTH)");
-	pp.add_macro_definition("BUFFER_RCP_HEIGHT", "(1.0 / BUFFER_HEIGHT)");
+	// Definitions specified on the command-line take precedence, since they were added first
+	options.macros.emplace_back("__RESHADE_PERFORMANCE_MODE__", options.performance_mode ? "1" : "0");
+	options.macros.emplace_back("BUFFER_WIDTH", buffer_width);
+	options.macros.emplace_back("BUFFER_HEIGHT", buffer_height);
+	options.macros.emplace_back("BUFFER_RCP_WIDTH", "(1.0 / BUFFER_WIDTH)");
+	options.macros.emplace_back("BUFFER_RCP_HEIGHT", "(1.0 / BUFFER_HEIGHT)");
+	options.macros.emplace_back("BUFFER_COLOR_BIT_DEPTH", color_bit_depth);
+
+	options.width = std::strtoul(buffer_width, nullptr, 10);
+	options.height = std::strtoul(buffer_height, nullptr, 10);
+
+	if (cachedir != nullptr)
+		return build_cache(filename, directory, cachedir, options, errorfile, reportfile, num_threads);
+
+	if (benchmark)
+	{
+		std::vector<std::filesystem::path> files;
+		if (directory == nullptr)
+			files.push_back(filename);
+		else if (!find_effect_files(directory, files))
+			return 1;
+
+		return benchmark_files(files, options, reportfile, iterations);
+	}
+
+	if (directory != nullptr)
+		return compile_directory(directory, options, errorfile, reportfile, num_threads);
+
+	reshadefx::preprocessor pp;
+	for (const auto &[name, value] : options.macros)
+		pp.add_macro_definition(name, value);
+	for (const std::filesystem::path &include_path : options.include_paths)
+		pp.add_include_path(include_path);
 
 	if (!pp.append_file(filename))
 	{
@@ -158,14 +710,9 @@ int main(int argc, char *argv[])
 		return 0;
 	}
 
-	std::unique_ptr<reshadefx::codegen> backend;
-	if (print_glsl)
-		backend.reset(reshadefx::create_codegen_glsl(debug_info, spec_constants));
-	else if (print_hlsl)
-		backend.reset(reshadefx::create_codegen_hlsl(shader_model, debug_info, spec_constants));
-	else
-		backend.reset(reshadefx::create_codegen_spirv(true, debug_info, spec_constants, invert_y_axis));
+	const std::unique_ptr<reshadefx::codegen> backend(create_backend(options));
 
+	reshadefx::parser parser;
 	if (!parser.parse(pp.output(), backend.get()))
 	{
 		if (errorfile == nullptr)
@@ -178,7 +725,7 @@ int main(int argc, char *argv[])
 	reshadefx::module module;
 	backend->write_result(module);
 
-	if (print_glsl || print_hlsl)
+	if (options.print_glsl || options.print_hlsl)
 	{
 		std::cout << module.hlsl << std::endl;
 	}